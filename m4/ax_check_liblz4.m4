@@ -0,0 +1,154 @@
+dnl Copyright (C) 2004-2015 by Carnegie Mellon University.
+dnl
+dnl @OPENSOURCE_HEADER_START@
+dnl
+dnl Use of the SILK system and related source code is subject to the terms
+dnl of the following licenses:
+dnl
+dnl GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+dnl Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+dnl
+dnl NO WARRANTY
+dnl
+dnl ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+dnl PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+dnl PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+dnl "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+dnl KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+dnl LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+dnl MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+dnl OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+dnl SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+dnl TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+dnl WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+dnl LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+dnl CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+dnl CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+dnl DELIVERABLES UNDER THIS LICENSE.
+dnl
+dnl Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+dnl Mellon University, its trustees, officers, employees, and agents from
+dnl all claims or demands made against them (and any related losses,
+dnl expenses, or attorney's fees) arising out of, or relating to Licensee's
+dnl and/or its sub licensees' negligent use or willful misuse of or
+dnl negligent conduct or willful misconduct regarding the Software,
+dnl facilities, or other rights or assistance granted by Carnegie Mellon
+dnl University under this License, including, but not limited to, any
+dnl claims of product liability, personal injury, death, damage to
+dnl property, or violation of any laws or regulations.
+dnl
+dnl Carnegie Mellon University Software Engineering Institute authored
+dnl documents are sponsored by the U.S. Department of Defense under
+dnl Contract FA8721-05-C-0003. Carnegie Mellon University retains
+dnl copyrights in all material produced under this contract. The U.S.
+dnl Government retains a non-exclusive, royalty-free license to publish or
+dnl reproduce these documents, or allow others to do so, for U.S.
+dnl Government purposes only pursuant to the copyright license under the
+dnl contract clause at 252.227.7013.
+dnl
+dnl @OPENSOURCE_HEADER_END@
+
+
+dnl RCSIDENT("$SiLK: ax_check_liblz4.m4 $")
+
+
+# ---------------------------------------------------------------------------
+# AX_CHECK_LIBLZ4
+#
+#    Try to find the LZ4 library.
+#
+#    Substitutions: SK_ENABLE_LZ4
+#    Output defines: ENABLE_LZ4
+#
+AC_DEFUN([AX_CHECK_LIBLZ4],[
+    ENABLE_LZ4=0
+
+    AC_ARG_WITH([lz4],
+        AS_HELP_STRING([--with-lz4=LZ4_DIR],
+            [specify location of the LZ4 file compression library; find "lz4.h" in LZ4_DIR/include/; find "liblz4.so" in LZ4_DIR/lib/ [auto]]),
+        [
+            if test "x$withval" != "xyes"
+            then
+                lz4_dir="$withval"
+                lz4_includes="$lz4_dir/include"
+                lz4_libraries="$lz4_dir/lib"
+            fi
+    ])
+    AC_ARG_WITH([lz4-includes],[AS_HELP_STRING([--with-lz4-includes=DIR],
+            [find "lz4.h" in DIR/ (overrides LZ4_DIR/include/)])[]dnl
+        ],[
+            if test "x$withval" = "xno"
+            then
+                lz4_dir=no
+            elif test "x$withval" != "xyes"
+            then
+                lz4_includes="$withval"
+            fi
+    ])
+    AC_ARG_WITH([lz4-libraries],[AS_HELP_STRING([--with-lz4-libraries=DIR],
+            [find "liblz4.so" in DIR/ (overrides LZ4_DIR/lib/)])[]dnl
+        ],[
+            if test "x$withval" = "xno"
+            then
+                lz4_dir=no
+            elif test "x$withval" != "xyes"
+            then
+                lz4_libraries="$withval"
+            fi
+    ])
+
+    if test "x$lz4_dir" != "xno"
+    then
+        # Cache current values
+        sk_save_LDFLAGS="$LDFLAGS"
+        sk_save_LIBS="$LIBS"
+        sk_save_CFLAGS="$CFLAGS"
+        sk_save_CPPFLAGS="$CPPFLAGS"
+
+        if test "x$lz4_libraries" != "x"
+        then
+            LZ4_LDFLAGS="-L$lz4_libraries"
+            LDFLAGS="$LZ4_LDFLAGS $sk_save_LDFLAGS"
+        fi
+
+        if test "x$lz4_includes" != "x"
+        then
+            LZ4_CFLAGS="-I$lz4_includes"
+            CPPFLAGS="$LZ4_CFLAGS $sk_save_CPPFLAGS"
+        fi
+
+        AC_CHECK_LIB([lz4], [LZ4_compress_default], [
+            ENABLE_LZ4=1
+            LZ4_LDFLAGS="$LZ4_LDFLAGS -llz4"])
+
+        if test "x$ENABLE_LZ4" = "x1"
+        then
+            AC_CHECK_HEADER([lz4.h], , [
+                AC_MSG_WARN([Found liblz4 but not lz4.h.  Maybe you should install lz4-devel or lz4-dev?])
+                ENABLE_LZ4=0])
+        fi
+
+        # Restore cached values
+        LDFLAGS="$sk_save_LDFLAGS"
+        LIBS="$sk_save_LIBS"
+        CFLAGS="$sk_save_CFLAGS"
+        CPPFLAGS="$sk_save_CPPFLAGS"
+    fi
+
+    if test "x$ENABLE_LZ4" = "x0"
+    then
+        LZ4_LDFLAGS=
+        LZ4_CFLAGS=
+    fi
+
+    AC_DEFINE_UNQUOTED([ENABLE_LZ4], [$ENABLE_LZ4],
+        [Define to 1 to build with support for LZ4 compression.
+         Define to 0 otherwise.  Requires the liblz4 library and the
+         <lz4.h> header file.])
+    AC_SUBST([SK_ENABLE_LZ4],[$ENABLE_LZ4])
+])# AX_CHECK_LIBLZ4
+
+dnl Local Variables:
+dnl mode:autoconf
+dnl indent-tabs-mode:nil
+dnl End:
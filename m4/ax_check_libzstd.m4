@@ -0,0 +1,154 @@
+dnl Copyright (C) 2004-2015 by Carnegie Mellon University.
+dnl
+dnl @OPENSOURCE_HEADER_START@
+dnl
+dnl Use of the SILK system and related source code is subject to the terms
+dnl of the following licenses:
+dnl
+dnl GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+dnl Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+dnl
+dnl NO WARRANTY
+dnl
+dnl ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+dnl PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+dnl PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+dnl "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+dnl KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+dnl LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+dnl MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+dnl OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+dnl SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+dnl TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+dnl WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+dnl LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+dnl CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+dnl CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+dnl DELIVERABLES UNDER THIS LICENSE.
+dnl
+dnl Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+dnl Mellon University, its trustees, officers, employees, and agents from
+dnl all claims or demands made against them (and any related losses,
+dnl expenses, or attorney's fees) arising out of, or relating to Licensee's
+dnl and/or its sub licensees' negligent use or willful misuse of or
+dnl negligent conduct or willful misconduct regarding the Software,
+dnl facilities, or other rights or assistance granted by Carnegie Mellon
+dnl University under this License, including, but not limited to, any
+dnl claims of product liability, personal injury, death, damage to
+dnl property, or violation of any laws or regulations.
+dnl
+dnl Carnegie Mellon University Software Engineering Institute authored
+dnl documents are sponsored by the U.S. Department of Defense under
+dnl Contract FA8721-05-C-0003. Carnegie Mellon University retains
+dnl copyrights in all material produced under this contract. The U.S.
+dnl Government retains a non-exclusive, royalty-free license to publish or
+dnl reproduce these documents, or allow others to do so, for U.S.
+dnl Government purposes only pursuant to the copyright license under the
+dnl contract clause at 252.227.7013.
+dnl
+dnl @OPENSOURCE_HEADER_END@
+
+
+dnl RCSIDENT("$SiLK: ax_check_libzstd.m4 $")
+
+
+# ---------------------------------------------------------------------------
+# AX_CHECK_LIBZSTD
+#
+#    Try to find the Zstandard library.
+#
+#    Substitutions: SK_ENABLE_ZSTD
+#    Output defines: ENABLE_ZSTD
+#
+AC_DEFUN([AX_CHECK_LIBZSTD],[
+    ENABLE_ZSTD=0
+
+    AC_ARG_WITH([zstd],
+        AS_HELP_STRING([--with-zstd=ZSTD_DIR],
+            [specify location of the Zstandard file compression library; find "zstd.h" in ZSTD_DIR/include/; find "libzstd.so" in ZSTD_DIR/lib/ [auto]]),
+        [
+            if test "x$withval" != "xyes"
+            then
+                zstd_dir="$withval"
+                zstd_includes="$zstd_dir/include"
+                zstd_libraries="$zstd_dir/lib"
+            fi
+    ])
+    AC_ARG_WITH([zstd-includes],[AS_HELP_STRING([--with-zstd-includes=DIR],
+            [find "zstd.h" in DIR/ (overrides ZSTD_DIR/include/)])[]dnl
+        ],[
+            if test "x$withval" = "xno"
+            then
+                zstd_dir=no
+            elif test "x$withval" != "xyes"
+            then
+                zstd_includes="$withval"
+            fi
+    ])
+    AC_ARG_WITH([zstd-libraries],[AS_HELP_STRING([--with-zstd-libraries=DIR],
+            [find "libzstd.so" in DIR/ (overrides ZSTD_DIR/lib/)])[]dnl
+        ],[
+            if test "x$withval" = "xno"
+            then
+                zstd_dir=no
+            elif test "x$withval" != "xyes"
+            then
+                zstd_libraries="$withval"
+            fi
+    ])
+
+    if test "x$zstd_dir" != "xno"
+    then
+        # Cache current values
+        sk_save_LDFLAGS="$LDFLAGS"
+        sk_save_LIBS="$LIBS"
+        sk_save_CFLAGS="$CFLAGS"
+        sk_save_CPPFLAGS="$CPPFLAGS"
+
+        if test "x$zstd_libraries" != "x"
+        then
+            ZSTD_LDFLAGS="-L$zstd_libraries"
+            LDFLAGS="$ZSTD_LDFLAGS $sk_save_LDFLAGS"
+        fi
+
+        if test "x$zstd_includes" != "x"
+        then
+            ZSTD_CFLAGS="-I$zstd_includes"
+            CPPFLAGS="$ZSTD_CFLAGS $sk_save_CPPFLAGS"
+        fi
+
+        AC_CHECK_LIB([zstd], [ZSTD_compress], [
+            ENABLE_ZSTD=1
+            ZSTD_LDFLAGS="$ZSTD_LDFLAGS -lzstd"])
+
+        if test "x$ENABLE_ZSTD" = "x1"
+        then
+            AC_CHECK_HEADER([zstd.h], , [
+                AC_MSG_WARN([Found libzstd but not zstd.h.  Maybe you should install zstd-devel or zstd-dev?])
+                ENABLE_ZSTD=0])
+        fi
+
+        # Restore cached values
+        LDFLAGS="$sk_save_LDFLAGS"
+        LIBS="$sk_save_LIBS"
+        CFLAGS="$sk_save_CFLAGS"
+        CPPFLAGS="$sk_save_CPPFLAGS"
+    fi
+
+    if test "x$ENABLE_ZSTD" = "x0"
+    then
+        ZSTD_LDFLAGS=
+        ZSTD_CFLAGS=
+    fi
+
+    AC_DEFINE_UNQUOTED([ENABLE_ZSTD], [$ENABLE_ZSTD],
+        [Define to 1 to build with support for Zstandard compression.
+         Define to 0 otherwise.  Requires the libzstd library and the
+         <zstd.h> header file.])
+    AC_SUBST([SK_ENABLE_ZSTD],[$ENABLE_ZSTD])
+])# AX_CHECK_LIBZSTD
+
+dnl Local Variables:
+dnl mode:autoconf
+dnl indent-tabs-mode:nil
+dnl End:
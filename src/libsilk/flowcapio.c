@@ -811,6 +811,32 @@ flowcapioRecordPack_V2(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(flowcapioRecordUnpackBatch_V6,
+                           flowcapioRecordUnpack_V6)
+STREAM_DEFINE_UNPACK_BATCH(flowcapioRecordUnpackBatch_V5,
+                           flowcapioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(flowcapioRecordUnpackBatch_V4,
+                           flowcapioRecordUnpack_V4)
+STREAM_DEFINE_UNPACK_BATCH(flowcapioRecordUnpackBatch_V3,
+                           flowcapioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(flowcapioRecordUnpackBatch_V2,
+                           flowcapioRecordUnpack_V2)
+STREAM_DEFINE_PACK_BATCH(flowcapioRecordPackBatch_V5,
+                         flowcapioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(flowcapioRecordPackBatch_V4,
+                         flowcapioRecordPack_V4)
+STREAM_DEFINE_PACK_BATCH(flowcapioRecordPackBatch_V3,
+                         flowcapioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(flowcapioRecordPackBatch_V2,
+                         flowcapioRecordPack_V2)
+
+
 /* ********************************************************************* */
 
 /*
@@ -867,22 +893,32 @@ flowcapioPrepare(
       case 6:
         rwIOS->rwUnpackFn = &flowcapioRecordUnpack_V6;
         rwIOS->rwPackFn   = &flowcapioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &flowcapioRecordUnpackBatch_V6;
+        rwIOS->rwPackBatchFn   = &flowcapioRecordPackBatch_V5;
         break;
       case 5:
         rwIOS->rwUnpackFn = &flowcapioRecordUnpack_V5;
         rwIOS->rwPackFn   = &flowcapioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &flowcapioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &flowcapioRecordPackBatch_V5;
         break;
       case 4:
         rwIOS->rwUnpackFn = &flowcapioRecordUnpack_V4;
         rwIOS->rwPackFn   = &flowcapioRecordPack_V4;
+        rwIOS->rwUnpackBatchFn = &flowcapioRecordUnpackBatch_V4;
+        rwIOS->rwPackBatchFn   = &flowcapioRecordPackBatch_V4;
         break;
       case 3:
         rwIOS->rwUnpackFn = &flowcapioRecordUnpack_V3;
         rwIOS->rwPackFn   = &flowcapioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &flowcapioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &flowcapioRecordPackBatch_V3;
         break;
       case 2:
         rwIOS->rwUnpackFn = &flowcapioRecordUnpack_V2;
         rwIOS->rwPackFn   = &flowcapioRecordPack_V2;
+        rwIOS->rwUnpackBatchFn = &flowcapioRecordUnpackBatch_V2;
+        rwIOS->rwPackBatchFn   = &flowcapioRecordPackBatch_V2;
         break;
       case 1:
         /* no longer supported */
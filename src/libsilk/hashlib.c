@@ -66,22 +66,50 @@ RCSIDENT("$SiLK: hashlib.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #include <silk/sktracemsg.h>
 
 
+/*
+ *    The table is an open-addressed array of buckets whose size is a
+ *    power of 2.  Each bucket has a one-byte control value, kept in a
+ *    separate array, and a slot that holds the 32-bit hash of the key
+ *    followed by the key and the value.
+ *
+ *    The control byte is HASH_CTRL_EMPTY for an unused bucket,
+ *    HASH_CTRL_MOVED for a bucket whose entry has been moved to a
+ *    larger array (see below), or, for an occupied bucket, a 7-bit
+ *    tag taken from the hash of the key.
+ *
+ *    The buckets are probed a group of HASH_GROUP_WIDTH buckets at a
+ *    time.  The control bytes of a group are compared to the tag of
+ *    the key in a single step (with SSE2 when available, otherwise
+ *    eight at a time in a 64-bit word), and only the slots whose tag
+ *    matches are examined.  The stored hash is compared before the
+ *    key, so a key is compared only when it almost certainly matches.
+ *    Probing visits the groups in triangular order, which visits
+ *    every group of a power-of-2 table, and stops at the first group
+ *    having an empty bucket.
+ *
+ *    When the table reaches its load factor, an array twice the size
+ *    is allocated, and the entries of the old array are moved into
+ *    it a few groups at a time on each subsequent insert.  Until the
+ *    move is complete, a key is searched for in both arrays.  Moved
+ *    buckets are marked HASH_CTRL_MOVED rather than empty so the
+ *    probe sequences in the old array remain intact.
+ */
+
 /* typedef struct HashBlock_st HashBlock; */
 struct HashBlock_st {
-    uint8_t *_data_ptr;     /* Pointer to an array of variable-sized entries */
+    uint8_t *ctrl;          /* Control byte for each bucket */
+    uint8_t *_data_ptr;     /* Slots: stored hash, key, and value */
 
     /* this value is a repeat of values from HashTable so a single
      * set of macros will work on either the HashTable or HashBlock */
     uint8_t *no_value_ptr;  /* Pointer to representation of an empty value */
 
-    uint32_t block_size;    /* Total number of entries in the block */
-    uint32_t num_entries;   /* Number of occupied entries in the block */
+    uint32_t block_size;    /* Total number of buckets in the block */
+    uint32_t num_entries;   /* Number of occupied buckets in the block */
     uint32_t block_full;    /* Point at which block meets the load_factor */
 
     /* these values are a repeat of values from HashTable so a single
-     * set of macros will work on either the HashTable or HashBlock.
-     * the load_factor really isn't needed; but keep it here since we
-     * have space for it. */
+     * set of macros will work on either the HashTable or HashBlock. */
     uint8_t  key_width;     /* Size of a key in bytes */
     uint8_t  value_width;   /* Size of a value in bytes */
     uint8_t  load_factor;   /* Point at which to resize (fraction of 255) */
@@ -100,43 +128,157 @@ typedef struct BlockHeader_st {
 /* Important: minimum block size cannot be less than 256 */
 static uint32_t MIN_BLOCK_SIZE = (1 << 8);
 
-/* Maximum size of a hash block. Should be tweaked for a particular
- * platform.  Default if not defined in hashlib_conf.h. */
+/* Maximum size of the slots of a hash block. Should be tweaked for a
+ * particular platform.  Default if not defined in hashlib_conf.h. */
 #ifndef MAX_MEMORY_BLOCK
-#define MAX_MEMORY_BLOCK (1<<27)
+#define MAX_MEMORY_BLOCK (1<<28)
 #endif
 
-/* Point at which a rehash is triggered (unless we're at max block size) */
-/* This value is not static, since hashlib_metrics.c may set it. */
-uint32_t REHASH_BLOCK_COUNT = 4;
+/* Number of groups of the previous array to move into the current
+ * array on each insert while the table is growing. */
+#define HASH_MOVE_GROUPS  8
+
+/* Number of blocks a serialized table may contain */
+#define HASH_SERIALIZED_MAX_BLOCKS  8
 
 /* Distinguished values for block */
 #define HASH_ITER_BEGIN -1
 #define HASH_ITER_END -2
 
+/* Control byte values.  An occupied bucket holds a tag in the range
+ * 0x00-0x7f; these special values have the high bit set. */
+#define HASH_CTRL_EMPTY  0x80
+#define HASH_CTRL_MOVED  0xfe
+
+/* Return 1 if the control byte 'c' is for an occupied bucket */
+#define HASH_CTRL_ISFULL(c)  (0 == ((c) & 0x80))
+
+/* Compute the tag from the hash; the low bits of the hash select the
+ * group, so the tag comes from the high bits. */
+#define HASH_TAG(hash_value)  ((uint8_t)((hash_value) >> 25))
+
 
 /*
- * Secondary table size is (table_size >> SECONDARY_BLOCK_FRACTION).
- * May also have one of the following values:
- *
- * -1 means to keep halving
- *
- * -2 means to keep halving starting at a secondary block size 1/4 of
- * the main block
- *
- * -3 means block 1 is 1/2 block 0, and all other blocks are 1/4 block 0.
- *
- * -4 means block 1 is 1/4 block 0, and all other blocks are 1/8 block 0.
- *
- * In all cases, the size of blocks REHASH_BLOCK_COUNT through
- * MAX_BLOCKS is fixed.
+ *    Functions to match control bytes of a group.  Each returns a
+ *    mask having one bit (or, for the portable version, one byte) set
+ *    for every bucket in the group that matches.
+ *    HASH_MASK_FIRST() returns the position in the group of the first
+ *    bucket in the mask, and HASH_MASK_NEXT() removes that bucket
+ *    from the mask.
  */
-/* This value is not static, since hashlib_metrics.c may set it. */
-int32_t SECONDARY_BLOCK_FRACTION = -3;
+#if defined(__SSE2__) && !defined(HASHLIB_DISABLE_SSE2)
+
+#include <emmintrin.h>
+
+#define HASH_GROUP_WIDTH  16
+
+typedef uint32_t hash_mask_t;
+
+static inline hash_mask_t
+hashlib_group_match(
+    const uint8_t      *group,
+    uint8_t             tag)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (hash_mask_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+}
+
+static inline hash_mask_t
+hashlib_group_match_empty(
+    const uint8_t      *group)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (hash_mask_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)HASH_CTRL_EMPTY)));
+}
+
+static inline hash_mask_t
+hashlib_group_match_full(
+    const uint8_t      *group)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (hash_mask_t)(~_mm_movemask_epi8(ctrl) & 0xffff);
+}
+
+#define HASH_MASK_SHIFT  0
+
+#else  /* __SSE2__ */
+
+#define HASH_GROUP_WIDTH  8
+
+typedef uint64_t hash_mask_t;
+
+#define HASH_LSBS  UINT64_C(0x0101010101010101)
+#define HASH_MSBS  UINT64_C(0x8080808080808080)
+
+/* load a group so that the control byte of the first bucket is in
+ * the least significant byte */
+static inline uint64_t
+hashlib_group_load(
+    const uint8_t      *group)
+{
+    uint64_t v;
+    memcpy(&v, group, sizeof(v));
+#if SK_BIG_ENDIAN
+    v = BSWAP64(v);
+#endif
+    return v;
+}
+
+/* may report a false match for the byte after a true match; the
+ * caller compares the stored hash, so false matches are harmless */
+static inline hash_mask_t
+hashlib_group_match(
+    const uint8_t      *group,
+    uint8_t             tag)
+{
+    uint64_t x = hashlib_group_load(group) ^ (HASH_LSBS * tag);
+    return (x - HASH_LSBS) & ~x & HASH_MSBS;
+}
+
+/* EMPTY is the only control value with the high bit set and bit 1
+ * clear */
+static inline hash_mask_t
+hashlib_group_match_empty(
+    const uint8_t      *group)
+{
+    uint64_t v = hashlib_group_load(group);
+    return v & (~v << 6) & HASH_MSBS;
+}
+
+static inline hash_mask_t
+hashlib_group_match_full(
+    const uint8_t      *group)
+{
+    return ~hashlib_group_load(group) & HASH_MSBS;
+}
+
+#define HASH_MASK_SHIFT  3
+
+#endif  /* __SSE2__ */
+
+#define HASH_MASK_NEXT(mask)  ((mask) & ((mask) - 1))
+
+static inline uint32_t
+HASH_MASK_FIRST(
+    hash_mask_t         mask)
+{
+#if defined(__GNUC__)
+    if (sizeof(mask) > sizeof(unsigned int)) {
+        return (uint32_t)__builtin_ctzll(mask) >> HASH_MASK_SHIFT;
+    }
+    return (uint32_t)__builtin_ctz(mask) >> HASH_MASK_SHIFT;
+#else
+    uint32_t pos = 0;
+    while (0 == (mask & 1)) {
+        mask >>= 1;
+        ++pos;
+    }
+    return pos >> HASH_MASK_SHIFT;
+#endif
+}
 
-/* Compute the maximum number of entries per block */
-#define HASH_GET_MAX_BLOCK_ENTRIES(tbl_ptr)  \
-    ((uint32_t)(MAX_MEMORY_BLOCK/HASH_GET_ENTRY_SIZE(tbl_ptr)))
 
 /* Private functions for manipulating blocks */
 static HashBlock *
@@ -150,12 +292,8 @@ static int
 hashlib_block_find_entry(
     const HashBlock    *block_ptr,
     const uint8_t      *key_ptr,
-    uint8_t           **entry_pptr);
-static int
-hashlib_block_lookup(
-    const HashBlock    *block_ptr,
-    const uint8_t      *key_ptr,
-    uint8_t           **value_pptr);
+    uint32_t            hash_value,
+    uint32_t           *index_ptr);
 static uint32_t
 hashlib_block_count_nonempties(
     const HashBlock    *block_ptr);
@@ -167,12 +305,6 @@ static void
 hashlib_dump_block_header(
     FILE               *fp,
     const HashBlock    *table_ptr);
-static int
-hashlib_iterate_sorted(
-    const HashTable    *table_ptr,
-    HASH_ITER          *iter_ptr,
-    uint8_t           **key_pptr,
-    uint8_t           **val_pptr);
 static int hashlib_cmp_fn(const void *a, const void *b, void *v_length);
 
 
@@ -253,10 +385,25 @@ hashbig(
 #define HASH_GET_ENTRY_SIZE(tbl_ptr)                  \
     ((tbl_ptr)->key_width + (tbl_ptr)->value_width)
 
-/* Get a pointer to the entry at index hash_index; the 'blk_ptr' must
+/* Get the size of a slot: the stored hash plus the entry */
+#define HASH_GET_SLOT_SIZE(tbl_ptr)                           \
+    (sizeof(uint32_t) + HASH_GET_ENTRY_SIZE(tbl_ptr))
+
+/* Get the number of bytes allocated for the buckets of a block: a
+ * control byte and a slot for each bucket */
+#define HASH_GET_BLOCK_BYTES(blk_ptr)                                   \
+    ((uint64_t)(1 + HASH_GET_SLOT_SIZE(blk_ptr)) * (blk_ptr)->block_size)
+
+/* Get a pointer to the slot at index hash_index; the 'blk_ptr' must
  * be a HashBlock */
-#define HASH_GET_ENTRY(blk_ptr, hash_index)                           \
-    ((blk_ptr)->_data_ptr + (HASH_GET_ENTRY_SIZE(blk_ptr) * (hash_index)))
+#define HASH_GET_SLOT(blk_ptr, hash_index)                            \
+    ((blk_ptr)->_data_ptr + (HASH_GET_SLOT_SIZE(blk_ptr) * (hash_index)))
+
+/* Get a pointer to the entry (the key and value) at index
+ * hash_index */
+#define HASH_GET_ENTRY(blk_ptr, hash_index)                   \
+    (HASH_GET_SLOT((blk_ptr), (hash_index)) + sizeof(uint32_t))
+
 /* Get a pointer to a key or value in an entry */
 #define HASH_GET_KEY(blk_ptr, entry_ptr)      \
     (entry_ptr)
@@ -269,6 +416,16 @@ hashbig(
 #define HASH_GET_ENTRY_VALUE(blk_ptr, hash_index) \
     HASH_GET_VALUE((blk_ptr), HASH_GET_ENTRY((blk_ptr), (hash_index)))
 
+/* Get the hash stored in the slot at index hash_index */
+#define HASH_GET_STORED_HASH(blk_ptr, hash_index, hash_value)           \
+    memcpy(&(hash_value), HASH_GET_SLOT((blk_ptr), (hash_index)),       \
+           sizeof(uint32_t))
+
+/* Get a pointer to entry 'idx' once the block has been sorted; the
+ * stored hashes have been removed and the entries are contiguous */
+#define HASH_GET_SORTED_ENTRY(blk_ptr, idx)                   \
+    ((blk_ptr)->_data_ptr + (HASH_GET_ENTRY_SIZE(blk_ptr) * (idx)))
+
 /* Return 1 if all bytes in a pair of keys match, otherwise 0 */
 #define HASH_COMPARE_KEYS(key1_ptr, key2_ptr, key_width)                \
     (0 == memcmp((key1_ptr), (key2_ptr), (key_width)))
@@ -278,12 +435,6 @@ hashbig(
     (0 == memcmp((value_ptr), (tbl_ptr)->no_value_ptr,  \
                  HASH_GET_VALUE_SIZE(tbl_ptr)))
 
-/* Return 1 if the value for 'entry_ptr' matches empty value, otherwise 0.*/
-#define HASH_ENTRY_ISEMPTY(tbl_ptr, entry_ptr)                  \
-    (0 == memcmp(HASH_GET_VALUE((tbl_ptr), (entry_ptr)),        \
-                 (tbl_ptr)->no_value_ptr,                       \
-                 HASH_GET_VALUE_SIZE(tbl_ptr)))
-
 #ifdef NDEBUG
 #define HASH_ASSERT_SIZE_IS_POWER_2(blk_size)
 #else
@@ -296,38 +447,31 @@ hashbig(
 #endif  /* NDEBUG */
 
 
-/* HASH_COMPUTE_HASH - A simple wrapper around hash() that
- * encapsulates the probing algorithm and takes care of scaling the
- * index to the block size. Before calling this function,
- * hash_probe_increment should be set to 0. Each time it is called,
- * the probe increment is added to to the hash_value and scaled by
- * the block size (note: we don't use modulo since this is too
- * expensive, instead since sizes our powers of 2 we can mask).
- *
- * Args:
- *  index      Variable to set with the computed index
- *  key_ptr    Pointer to the key value to hash
- *  key_width  Number of bytes in the key
- *  block_size Number of bytes in the block (must be a power of 2)
- *  hash_value Variable (uint32_t) to hold the hash value
- *  hash_probe_increment Variable to hold the current probe increment
+/* HASH_COMPUTE_HASH - A simple wrapper around hash().  The low bits
+ * of the result select the first group to probe, and the high bits
+ * provide the tag stored in the control byte.  The full value is
+ * stored in the slot so the table may grow without hashing the keys
+ * again. */
+#define HASH_COMPUTE_HASH(key_ptr, key_width)           \
+    ((uint32_t)hash((key_ptr), (key_width), 0))
 
- * NOTE: This function is not thread safe, nor may a particular thread
- * interleave calls that are logically associated with
- * different tables. */
 
-#define HASH_COMPUTE_HASH(index_ptr, key_ptr, key_width, block_size,    \
-                          hash_value, hash_probe_increment)             \
-    {                                                                   \
-        if ((hash_probe_increment) == 0) {                              \
-            (hash_value) = hash((key_ptr), (key_width), 0);             \
-            (hash_probe_increment) = (hash_value) | 0x01; /* must be odd */ \
-        } else {                                                        \
-            (hash_value) = (hash_value) + (hash_probe_increment);       \
-        }                                                               \
-        *(index_ptr) = (hash_value) & ((uint32_t) (block_size)-1);      \
-    }
+/* Return the maximum number of buckets in a block: the largest power
+ * of 2 whose slots fit in MAX_MEMORY_BLOCK bytes */
+static uint32_t
+hashlib_max_block_size(
+    const HashTable    *table_ptr)
+{
+    uint64_t max_entries = MAX_MEMORY_BLOCK / HASH_GET_SLOT_SIZE(table_ptr);
+    uint32_t max_size = MIN_BLOCK_SIZE;
 
+    while (((uint64_t)max_size << 1) <= max_entries
+           && max_size < (UINT32_C(1) << 31))
+    {
+        max_size <<= 1;
+    }
+    return max_size;
+}
 
 
 /* Choose the size for initial block. This will be a power of 2 with at
@@ -339,13 +483,13 @@ hashlib_calculate_block_size(
     uint32_t            estimated_count)
 {
     uint32_t initial_size;
-    uint32_t max_size = HASH_GET_MAX_BLOCK_ENTRIES(table_ptr);
+    uint32_t max_size = hashlib_max_block_size(table_ptr);
 
     if (estimated_count < MIN_BLOCK_SIZE) {
         initial_size = MIN_BLOCK_SIZE;
     } else {
         initial_size = MIN_BLOCK_SIZE << 1;
-        while (initial_size <= max_size) {
+        while (initial_size < max_size) {
             if (initial_size
                 >= ((((uint64_t) estimated_count) << 8)
                     / table_ptr->load_factor))
@@ -382,6 +526,10 @@ hashlib_create_table(
         assert(0);
         return NULL;
     }
+    if (0 == load_factor) {
+        TRACEMSG(1,("hashlib_create_table: invalid load_factor argument 0."));
+        return NULL;
+    }
 
     /* Allocate memory for the table and initialize attributes.  */
     table_ptr = (HashTable*)calloc(1, sizeof(HashTable));
@@ -434,19 +582,13 @@ hashlib_create_table(
     /* Calculate initial block size */
     initial_size = hashlib_calculate_block_size(table_ptr, estimated_count);
 
-    TRACEMSG(1,("Adding block #1..."));
-
-    /* Start with one block */
-    table_ptr->num_blocks = 1;
     block_ptr = hashlib_create_block(table_ptr, initial_size);
     if (block_ptr == NULL) {
         free(table_ptr->no_value_ptr);
         free(table_ptr);
         return NULL;
     }
-    table_ptr->block_ptrs[0] = block_ptr;
-
-    TRACEMSG(1,("Added block #%u.", table_ptr->num_blocks));
+    table_ptr->block_ptr = block_ptr;
 
     return table_ptr;
 }
@@ -458,15 +600,16 @@ void
 hashlib_free_table(
     HashTable          *table_ptr)
 {
-    int i;
-
     if (NULL == table_ptr) {
         return;
     }
 
-    /* Free all the blocks in the table */
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        hashlib_free_block(table_ptr->block_ptrs[i]);
+    /* Free the arrays of the table */
+    if (table_ptr->block_ptr) {
+        hashlib_free_block(table_ptr->block_ptr);
+    }
+    if (table_ptr->old_block_ptr) {
+        hashlib_free_block(table_ptr->old_block_ptr);
     }
 
     /* Free the empty pointer memory */
@@ -488,18 +631,18 @@ hashlib_create_block(
     uint32_t            block_size)
 {
     HashBlock *block_ptr;
-    uint32_t entry_i;
 
     HASH_ASSERT_SIZE_IS_POWER_2(block_size);
+    assert(block_size >= MIN_BLOCK_SIZE);
 
 #ifdef HASHLIB_RECORD_STATS
     hashlib_stats_blocks_allocated++;
 #endif
 
     TRACEMSG(1,(("Creating block; requesting %" PRIu32
-                 " %" PRIu32 "-byte entries (%" PRIu32 " total bytes)..."),
-                block_size, HASH_GET_ENTRY_SIZE(table_ptr),
-                (HASH_GET_ENTRY_SIZE(table_ptr) * block_size)));
+                 " %" PRIu32 "-byte slots (%" PRIu64 " total bytes)..."),
+                block_size, (uint32_t)HASH_GET_SLOT_SIZE(table_ptr),
+                ((uint64_t)HASH_GET_SLOT_SIZE(table_ptr) * block_size)));
 
     /* Allocate memory for the block and initialize attributes.  */
     block_ptr = (HashBlock*)malloc(sizeof(HashBlock));
@@ -517,34 +660,24 @@ hashlib_create_block(
     block_ptr->load_factor = table_ptr->load_factor;
     block_ptr->no_value_ptr = table_ptr->no_value_ptr;
 
-    /* Allocate memory for the data */
-    block_ptr->_data_ptr = (uint8_t*)malloc(HASH_GET_ENTRY_SIZE(block_ptr)
+    /* Allocate memory for the control bytes and the slots.  Only the
+     * control bytes need to be initialized; a slot is written when
+     * its bucket is first used. */
+    block_ptr->ctrl = (uint8_t*)malloc(block_size);
+    if (block_ptr->ctrl == NULL) {
+        free(block_ptr);
+        TRACEMSG(1,("Failed to allocate new control bytes."));
+        return NULL;
+    }
+    block_ptr->_data_ptr = (uint8_t*)malloc(HASH_GET_SLOT_SIZE(block_ptr)
                                             * block_ptr->block_size);
     if (block_ptr->_data_ptr == NULL) {
+        free(block_ptr->ctrl);
         free(block_ptr);
         TRACEMSG(1,("Failed to allocate new data block."));
         return NULL;
     }
-
-    /* Copy "empty" value to each entry.  Garbage key values are
-     * ignored, so we don't bother writing to the keys.  When the
-     * application overestimates the amount of memory needed, this can
-     * be bottleneck.  */
-    if (table_ptr->can_memset_val) {
-        memset(block_ptr->_data_ptr, block_ptr->no_value_ptr[0],
-               (block_ptr->block_size * HASH_GET_ENTRY_SIZE(block_ptr)));
-    } else {
-        uint8_t *data_ptr = block_ptr->_data_ptr;
-        uint8_t entry_width = HASH_GET_ENTRY_SIZE(block_ptr);
-
-        /* Point to first value */
-        data_ptr += block_ptr->key_width;
-        for (entry_i = 0; entry_i < block_ptr->block_size; entry_i++) {
-            memcpy(data_ptr, block_ptr->no_value_ptr, block_ptr->value_width);
-            /* Advance to next */
-            data_ptr += entry_width;
-        }
-    }
+    memset(block_ptr->ctrl, HASH_CTRL_EMPTY, block_size);
 
     return block_ptr;
 }
@@ -555,345 +688,207 @@ hashlib_free_block(
     HashBlock          *block_ptr)
 {
     /* Free the data and the table itself */
+    free(block_ptr->ctrl);
     free(block_ptr->_data_ptr);
     free(block_ptr);
 }
 
 
-/* Rehash entire table into a single block */
-int
-hashlib_rehash(
-    HashTable          *table_ptr)
+/*
+ *    Return the index of the first empty bucket in the probe sequence
+ *    for 'hash_value' in 'block_ptr'.  The caller must know the key
+ *    is not in the block and that the block has an empty bucket.
+ */
+static uint32_t
+hashlib_block_find_empty(
+    const HashBlock    *block_ptr,
+    uint32_t            hash_value)
 {
-    HashBlock *new_block_ptr = NULL;
-    HashBlock *block_ptr = NULL;
-    uint64_t num_entries = 0;
-    uint32_t initial_size;
-    uint8_t *key_ref;
-    uint8_t *val_ref;
-    uint8_t *entry_ptr;
-    uint8_t *new_entry_ptr;
-    int rv;
-    int i;
-    uint32_t block_index;
-    uint32_t idx;
-    uint32_t max_entries;
+    const uint32_t group_mask = (block_ptr->block_size / HASH_GROUP_WIDTH) - 1;
+    uint32_t group = hash_value & group_mask;
+    uint32_t stride = 0;
+    hash_mask_t match;
+
+    for (;;) {
+        match = hashlib_group_match_empty(block_ptr->ctrl
+                                          + group * HASH_GROUP_WIDTH);
+        if (match) {
+            return group * HASH_GROUP_WIDTH + HASH_MASK_FIRST(match);
+        }
+        ++stride;
+        assert(stride <= group_mask);
+        group = (group + stride) & group_mask;
+    }
+}
 
-#ifdef HASHLIB_RECORD_STATS
-    hashlib_stats_rehashes++;
-#endif
 
-    if (table_ptr->is_sorted) {
-        TRACEMSG(1,("ERROR: Attempt to rehash a sorted table"));
-        assert(0 == table_ptr->is_sorted);
-        return ERR_SORTTABLE;
-    }
+/*
+ *    Fill the bucket at 'idx' in 'block_ptr' with 'hash_value' and
+ *    the entry at 'entry_ptr'.
+ */
+static void
+hashlib_block_fill(
+    HashBlock          *block_ptr,
+    uint32_t            idx,
+    uint32_t            hash_value,
+    const uint8_t      *entry_ptr)
+{
+    uint8_t *slot_ptr = HASH_GET_SLOT(block_ptr, idx);
 
-    max_entries = HASH_GET_MAX_BLOCK_ENTRIES(table_ptr);
+    block_ptr->ctrl[idx] = HASH_TAG(hash_value);
+    memcpy(slot_ptr, &hash_value, sizeof(uint32_t));
+    memcpy(slot_ptr + sizeof(uint32_t), entry_ptr,
+           HASH_GET_ENTRY_SIZE(block_ptr));
+    ++block_ptr->num_entries;
+}
 
-    /* Count the total number of entries so we know what we need to
-     * allocate.  We base this on the actual size of the blocks, and
-     * use the power of 2 that's double the smallest power of 2 bigger
-     * than the sum of block sizes. It's justified by the intuition
-     * that once we reach this point, we've decided that we're going
-     * to explore an order of magnitude larger table. This particular
-     * scheme seems to work well in practice although it's difficult
-     * to justify theoretically--this is a rather arbitrary definition
-     * of "order of magnitude". */
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        num_entries += table_ptr->block_ptrs[i]->block_size;
-    }
 
-    TRACEMSG(1,(("Rehashing table having %" PRIu64
-                 " %" PRIu32 "-byte entries..."),
-                num_entries, HASH_GET_ENTRY_SIZE(table_ptr)));
+/*
+ *    Move up to 'group_count' groups of the previous array of the
+ *    table into the current array.  Free the previous array once all
+ *    its groups have been moved.
+ */
+static void
+hashlib_move_groups(
+    HashTable          *table_ptr,
+    uint32_t            group_count)
+{
+    HashBlock *old_ptr = table_ptr->old_block_ptr;
+    HashBlock *new_ptr = table_ptr->block_ptr;
+    uint32_t num_groups;
+    uint32_t group;
+    uint32_t end;
+    uint32_t hash_value;
+    uint32_t idx;
+    hash_mask_t match;
 
-    if (num_entries > max_entries) {
-        TRACEMSG(1,(("Too many entries for rehash; "
-                     " num_entries=%" PRIu64 " > max_entries=%" PRIu32 "."),
-                    num_entries, max_entries));
-        return ERR_OUTOFMEMORY;
+    assert(old_ptr);
+    num_groups = old_ptr->block_size / HASH_GROUP_WIDTH;
+    if (group_count >= num_groups - table_ptr->move_group) {
+        end = num_groups;
+    } else {
+        end = table_ptr->move_group + group_count;
     }
 
-#if 0                           /* block_size should account for padding */
-
-    /* .. and add the padding we need. */
-    num_entries = ((num_entries * 255) / table_ptr->load_factor);
+    for (group = table_ptr->move_group; group < end; ++group) {
+        for (match = hashlib_group_match_full(old_ptr->ctrl
+                                              + group * HASH_GROUP_WIDTH);
+             match;
+             match = HASH_MASK_NEXT(match))
+        {
+            idx = group * HASH_GROUP_WIDTH + HASH_MASK_FIRST(match);
+            HASH_GET_STORED_HASH(old_ptr, idx, hash_value);
+            hashlib_block_fill(new_ptr,
+                               hashlib_block_find_empty(new_ptr, hash_value),
+                               hash_value, HASH_GET_ENTRY(old_ptr, idx));
+            old_ptr->ctrl[idx] = HASH_CTRL_MOVED;
+            --old_ptr->num_entries;
+#ifdef HASHLIB_RECORD_STATS
+            hashlib_stats_rehash_inserts++;
 #endif
-
-    /* Choose the size for the initial block. */
-    initial_size = MIN_BLOCK_SIZE;      /* Minimum size */
-    for (i = 0; i < 24; i++) {
-        if (initial_size >= num_entries) {
-            /* big enough */
-            break;
         }
-        /* double it */
-        initial_size <<= 1;
     }
+    table_ptr->move_group = end;
 
-    /* double it once more */
-    if (max_entries > (initial_size << 1)) {
-        initial_size <<= 1;
-    }
-    if (initial_size > max_entries) {
-        TRACEMSG(1,(("Will not rehash table; new initial_size=%" PRIu32
-                     " > max_entries=%" PRIu32 "."),
-                    initial_size, max_entries));
-        return ERR_OUTOFMEMORY;
+    if (end == num_groups) {
+        assert(0 == old_ptr->num_entries);
+        hashlib_free_block(old_ptr);
+        table_ptr->old_block_ptr = NULL;
+        table_ptr->move_group = 0;
+        TRACEMSG(1,("Finished moving entries to new block."));
     }
-
-    TRACEMSG(1,("Allocating new rehash block..."));
-
-    /* Create the new block */
-    new_block_ptr = hashlib_create_block(table_ptr, initial_size);
-    if (new_block_ptr == NULL) {
-        TRACEMSG(1,(("Allocating rehash block failed for %" PRIu32 " entries."),
-                    initial_size));
-        return ERR_OUTOFMEMORY;
-    }
-    TRACEMSG(1,("Allocated rehash block."));
-
-    /* Walk through the table looking for non-empty entries, and
-     * insert them into the new block. */
-    for (block_index = table_ptr->num_blocks; block_index > 0; ) {
-        --block_index;
-        block_ptr = table_ptr->block_ptrs[block_index];
-        entry_ptr = HASH_GET_ENTRY(block_ptr, 0);
-        for (idx = 0; idx < block_ptr->block_size; idx++) {
-            key_ref = HASH_GET_KEY(block_ptr, entry_ptr);
-            val_ref = HASH_GET_VALUE(block_ptr, entry_ptr);
-
-            /* If not empty, then copy the entry into the new block */
-            if (!HASH_VALUE_ISEMPTY(block_ptr, val_ref)) {
-                rv = hashlib_block_find_entry(new_block_ptr,
-                                              key_ref, &new_entry_ptr);
-                if (rv != ERR_NOTFOUND) {
-                    /* value is not-empty, but we cannot find the key
-                     * in the hash table. either the hashlib code is
-                     * broken, or the user set a value to the
-                     * no_value_ptr value and broke the collision
-                     * resolution mechanism.  if assert() is active,
-                     * the next line will call abort(). */
-                    assert(rv == ERR_NOTFOUND);
-                    free(new_block_ptr);
-                    table_ptr->num_blocks = 1 + block_index;
-                    return ERR_INTERNALERROR;
-                }
-                /* Copy the key and value */
-                memcpy(HASH_GET_KEY(new_block_ptr, new_entry_ptr), key_ref,
-                       HASH_GET_KEY_SIZE(block_ptr));
-                memcpy(HASH_GET_VALUE(new_block_ptr, new_entry_ptr), val_ref,
-                       HASH_GET_VALUE_SIZE(block_ptr));
-                new_block_ptr->num_entries++;
-
-#ifdef HASHLIB_RECORD_STATS
-                hashlib_stats_rehash_inserts++;
-#endif
-            } /* !HASH_VALUE_ISEMPTY */
-            entry_ptr += HASH_GET_ENTRY_SIZE(block_ptr);
-        }                       /* entries */
-
-        /* Free the block */
-        hashlib_free_block(block_ptr);
-        table_ptr->block_ptrs[block_index] = NULL;
-    }                           /* blocks */
-
-    /* Associate the new block with the table */
-    table_ptr->num_blocks = 1;
-    table_ptr->block_ptrs[0] = new_block_ptr;
-
-    TRACEMSG(1,("Rehashed table."));
-
-    return OK;
 }
 
 
-/* Add a new block to a table. */
-static int
-hashlib_add_block(
-    HashTable          *table_ptr,
-    uint32_t            new_block_size)
+/* Move any entries that remain in the previous array into the
+ * current array */
+int
+hashlib_rehash(
+    HashTable          *table_ptr)
 {
-    HashBlock *block_ptr = NULL;
-
-    assert(table_ptr->num_blocks < MAX_BLOCKS);
-    if (table_ptr->num_blocks >= MAX_BLOCKS) {
-        TRACEMSG(1,(("Cannot allocate another block:"
-                     " num_blocks=%" PRIu32 " >= MAX_BLOCKS=%u."),
-                  table_ptr->num_blocks, MAX_BLOCKS));
-        return ERR_NOMOREBLOCKS;
+    if (table_ptr->is_sorted) {
+        TRACEMSG(1,("ERROR: Attempt to rehash a sorted table"));
+        assert(0 == table_ptr->is_sorted);
+        return ERR_SORTTABLE;
     }
-    /* Create the new block */
-    TRACEMSG(1,(("Adding block #%u..."), 1 + table_ptr->num_blocks));
-    block_ptr = hashlib_create_block(table_ptr, new_block_size);
-    if (block_ptr == NULL) {
-        TRACEMSG(1,("Adding block #%u failed.", 1+table_ptr->num_blocks));
-        return ERR_OUTOFMEMORY;
+    if (table_ptr->old_block_ptr) {
+        hashlib_move_groups(table_ptr, UINT32_MAX);
     }
-
-    /* Add it to the table */
-    table_ptr->block_ptrs[table_ptr->num_blocks] = block_ptr;
-    table_ptr->num_blocks++;
-    TRACEMSG(1,("Added block #%u.", table_ptr->num_blocks));
-
     return OK;
 }
 
 
-/* See what size the next hash block should be. */
-static uint32_t
-hashlib_compute_next_block_size(
-    HashTable          *table_ptr)
-{
-    uint32_t block_size = 0;
-
-    /* This condition will only be true when the primary block has
-     * reached the maximum block size. */
-    if (table_ptr->num_blocks >= REHASH_BLOCK_COUNT) {
-        return table_ptr->block_ptrs[table_ptr->num_blocks-1]->block_size;
-    }
-    /* Otherwise, it depends on current parameters */
-    if (SECONDARY_BLOCK_FRACTION >= 0) {
-        block_size =
-            (table_ptr->block_ptrs[0]->block_size >> SECONDARY_BLOCK_FRACTION);
-    } else if (SECONDARY_BLOCK_FRACTION == -1) {
-        /* Keep halving blocks */
-        block_size =
-            (table_ptr->block_ptrs[table_ptr->num_blocks-1]->block_size >> 1);
-    } else if (SECONDARY_BLOCK_FRACTION == -2) {
-        if (table_ptr->num_blocks == 1) {
-            /* First secondary block is 1/4 size of main block */
-            block_size =
-                table_ptr->block_ptrs[table_ptr->num_blocks-1]->block_size >>2;
-        } else {
-            /* Other secondary blocks are halved */
-            block_size =
-                table_ptr->block_ptrs[table_ptr->num_blocks-1]->block_size >>1;
-        }
-    } else if (SECONDARY_BLOCK_FRACTION == -3) {
-        if (table_ptr->num_blocks == 1) {
-            /* First secondary block is 1/2 size of main block */
-            block_size = table_ptr->block_ptrs[0]->block_size >> 1;
-        } else {
-            /* All others are 1/4 size of main block */
-            block_size = table_ptr->block_ptrs[0]->block_size >> 2;
-        }
-    } else if (SECONDARY_BLOCK_FRACTION == -4) {
-        if (table_ptr->num_blocks == 1) {
-            /* First secondary block is 1/4 size of main block */
-            block_size = table_ptr->block_ptrs[0]->block_size >> 2;
-        } else {
-            /* All others are 1/8 size of main block */
-            block_size = table_ptr->block_ptrs[0]->block_size >> 3;
-        }
-    } else {
-        skAbort();
-    }
-
-    return block_size;
-}
-
 /*
- *  Algorithm:
- *  - If the primary block is at its maximum, never rehash, only add
- *    new blocks.
- *  - If we have a small table, then don't bother creating
- *    secondary tables.  Simply rehash into a new block.
- *  - If we've exceeded the maximum number of blocks, rehash
- *    into a new block.
- *  - Otherwise, create a new block
+ *    Grow the table: allocate an array twice the size of the current
+ *    array and make the current array the previous array, whose
+ *    entries hashlib_insert() moves a few groups at a time.  Return
+ *    ERR_NOMOREBLOCKS if the current array is at the maximum size, or
+ *    ERR_OUTOFMEMORY if the new array cannot be allocated.
  */
-
 static int
 hashlib_resize_table(
     HashTable          *table_ptr)
 {
+    HashBlock *block_ptr;
     uint32_t new_block_size;
-    int rv;
 
     TRACEMSG(1,("Resizing the table..."));
 
-    /* Compute the (potential) size of the new block */
-    new_block_size = hashlib_compute_next_block_size(table_ptr);
-    assert(new_block_size != 0);
+    /* finish any previous resize */
+    if (table_ptr->old_block_ptr) {
+        hashlib_move_groups(table_ptr, UINT32_MAX);
+    }
 
-    /* If we're at the maximum number of blocks (which implies that
-     * the first block is at its max, and we can't resize, then that's
-     * it. */
-    if (table_ptr->num_blocks == MAX_BLOCKS) {
-        TRACEMSG(1,(("Unable to resize table: no more blocks;"
+    if (table_ptr->block_ptr->block_size >= hashlib_max_block_size(table_ptr))
+    {
+        TRACEMSG(1,(("Unable to resize table: at maximum size;"
                      " table contains %" PRIu32 " %" PRIu32 "-byte entries"
-                     " in %" PRIu32 " buckets across %u blocks"),
+                     " in %" PRIu32 " buckets"),
                     hashlib_count_entries(table_ptr),
-                    HASH_GET_ENTRY_SIZE(table_ptr),
-                    hashlib_count_buckets(table_ptr), table_ptr->num_blocks));
+                    (uint32_t)HASH_GET_ENTRY_SIZE(table_ptr),
+                    hashlib_count_buckets(table_ptr)));
         return ERR_NOMOREBLOCKS;
     }
-    /* If the first block is at its maximum size or if we have tried
-     * and failed to rehash in the past, then add a new block. Once we
-     * reach the maximum block size, we don't rehash.  Instead we keep
-     * adding blocks until we reach the maximum. */
-    if ((table_ptr->block_ptrs[0]->block_size
-         == HASH_GET_MAX_BLOCK_ENTRIES(table_ptr))
-        || table_ptr->rehash_failed)
-    {
-        assert(new_block_size > MIN_BLOCK_SIZE);
-        return hashlib_add_block(table_ptr, new_block_size);
-    }
-    /* If we have REHASH_BLOCK_COUNT blocks, or the new block would be
-     * too small, we simply rehash. */
-    if ((new_block_size < MIN_BLOCK_SIZE) ||
-        (table_ptr->num_blocks >= REHASH_BLOCK_COUNT))
+    new_block_size = table_ptr->block_ptr->block_size << 1;
+
+    /* while growing, the table holds both arrays */
+    if (table_ptr->max_memory
+        && (3 * HASH_GET_BLOCK_BYTES(table_ptr->block_ptr)
+            > table_ptr->max_memory))
     {
-        TRACEMSG(1,(("Resize table forcing rehash; new_block_size = %" PRIu32
-                     "; num_blocks = %u; REHASH_BLOCK_COUNT = %" PRIu32 "."),
-                    new_block_size, table_ptr->num_blocks, REHASH_BLOCK_COUNT));
-        rv = hashlib_rehash(table_ptr);
-        if (rv != ERR_OUTOFMEMORY) {
-            return rv;
-        }
-        /* rehashing failed.  try instead to add a new (small) block */
-        table_ptr->rehash_failed = 1;
-        if (new_block_size < MIN_BLOCK_SIZE) {
-            new_block_size = MIN_BLOCK_SIZE;
-        }
-        TRACEMSG(1,("Rehash failed; creating new block instead..."));
+        TRACEMSG(1,(("Unable to resize table: %" PRIu32 " buckets would"
+                     " exceed the memory limit of %" PRIu64 " bytes"),
+                    new_block_size, table_ptr->max_memory));
+        return ERR_NOMOREBLOCKS;
     }
-    /* Assert several global invariants */
-    assert(new_block_size >= MIN_BLOCK_SIZE);
-    assert(new_block_size <= HASH_GET_MAX_BLOCK_ENTRIES(table_ptr));
-    assert(table_ptr->num_blocks < MAX_BLOCKS);
-
-    /* Otherwise, add new a new block */
-    return hashlib_add_block(table_ptr, new_block_size);
-}
 
+    block_ptr = hashlib_create_block(table_ptr, new_block_size);
+    if (block_ptr == NULL) {
+        TRACEMSG(1,(("Allocating larger block failed for %" PRIu32
+                     " entries."), new_block_size));
+        return ERR_OUTOFMEMORY;
+    }
+#ifdef HASHLIB_RECORD_STATS
+    hashlib_stats_rehashes++;
+#endif
 
-#if 0
-static void
-assert_not_already_there(
-    HashTable          *table_ptr,
-    uint8_t            *key_ptr)
-{
-    uint8_t *entry_ptr;
-    HashBlock *block_ptr;
-    int i;
-    int rv;
+    table_ptr->old_block_ptr = table_ptr->block_ptr;
+    table_ptr->block_ptr = block_ptr;
+    table_ptr->move_group = 0;
 
-    for (i = 0; i < (table_ptr->num_blocks-1); i++) {
-        block_ptr = table_ptr->block_ptrs[i];
-        rv = hashlib_block_find_entry(block_ptr, key_ptr, &entry_ptr);
-        if (rv == OK) {
-            getc(stdin);
-        }
-    }
+    TRACEMSG(1,("Resized table to %" PRIu32 " buckets.", new_block_size));
+    return OK;
 }
-#endif /* 0 */
 
 
-#define HASHLIB_BLOCK_IS_FULL(blk_ptr)                  \
-    ((blk_ptr)->num_entries >= (blk_ptr)->block_full)
+/* Return 1 if the table must grow before another entry is added; the
+ * entries in the previous array count against the current array,
+ * since they will be moved there */
+#define HASHLIB_TABLE_IS_FULL(tbl_ptr)                                  \
+    (((tbl_ptr)->block_ptr->num_entries                                 \
+      + ((tbl_ptr)->old_block_ptr                                       \
+         ? (tbl_ptr)->old_block_ptr->num_entries : 0))                  \
+     >= (tbl_ptr)->block_ptr->block_full)
 
 
 int
@@ -902,10 +897,12 @@ hashlib_insert(
     const uint8_t      *key_ptr,
     uint8_t           **value_pptr)
 {
-    uint32_t i;
+    HashBlock *block_ptr;
+    uint32_t hash_value;
+    uint32_t idx;
+    uint32_t old_idx;
+    uint8_t *slot_ptr;
     int rv;
-    HashBlock *block_ptr = NULL;
-    uint8_t *current_entry_ptr = NULL;
 
 #ifdef HASHLIB_RECORD_STATS
     hashlib_stats_inserts++;
@@ -916,95 +913,65 @@ hashlib_insert(
         return ERR_SORTTABLE;
     }
 
-    /* Before doing anything else, see if we're ready to do a resize
-     * by either adding a block or rehashing. */
-    if (HASHLIB_BLOCK_IS_FULL(table_ptr->block_ptrs[table_ptr->num_blocks-1])){
-        rv = hashlib_resize_table(table_ptr);
-        if (rv != OK) {
-            return rv;
-        }
+    /* Continue moving the entries from the previous array.  This is
+     * done before the search so the pointer returned to the caller
+     * remains valid until the next insert. */
+    if (table_ptr->old_block_ptr) {
+        hashlib_move_groups(table_ptr, HASH_MOVE_GROUPS);
     }
 
-    /* Look for the key in all blocks */
-    for (i = 0; i < table_ptr->num_blocks; ++i) {
-        block_ptr = table_ptr->block_ptrs[i];
-        rv = hashlib_block_find_entry(block_ptr, key_ptr, &current_entry_ptr);
-        if (rv == OK) {
-            /* Found entry, use it */
-            *value_pptr = HASH_GET_VALUE(block_ptr, current_entry_ptr);
-            return OK_DUPLICATE;
-        } else if (rv != ERR_NOTFOUND) {
-            assert(0);
-            /* An error of some sort occurred */
-            return rv;
-        }
+    hash_value = HASH_COMPUTE_HASH(key_ptr, table_ptr->key_width);
+
+    /* Look for the key in the current and the previous array */
+    block_ptr = table_ptr->block_ptr;
+    rv = hashlib_block_find_entry(block_ptr, key_ptr, hash_value, &idx);
+    if (rv == OK) {
+        *value_pptr = HASH_GET_ENTRY_VALUE(block_ptr, idx);
+        return OK_DUPLICATE;
+    }
+    if (table_ptr->old_block_ptr
+        && (hashlib_block_find_entry(table_ptr->old_block_ptr, key_ptr,
+                                     hash_value, &old_idx)
+            == OK))
+    {
+        *value_pptr = HASH_GET_ENTRY_VALUE(table_ptr->old_block_ptr, old_idx);
+        return OK_DUPLICATE;
     }
 
-    /* Didn't find it, so do an insert into the last block by setting
-     * the key AND increasing the count. The caller will set the
-     * value. Note: block_ptr is pointing at the last block. */
-    *value_pptr = HASH_GET_VALUE(block_ptr, current_entry_ptr);
-    memcpy(HASH_GET_KEY(block_ptr, current_entry_ptr),
-           key_ptr, block_ptr->key_width);
+    /* Didn't find it.  Grow the table if needed; 'idx' holds the
+     * insertion point unless the table grows. */
+    if (HASHLIB_TABLE_IS_FULL(table_ptr)) {
+        rv = hashlib_resize_table(table_ptr);
+        if (rv != OK) {
+            return rv;
+        }
+        block_ptr = table_ptr->block_ptr;
+        idx = hashlib_block_find_empty(block_ptr, hash_value);
+    }
+
+    /* Insert the key with the empty value; the caller will set the
+     * value. */
+    slot_ptr = HASH_GET_SLOT(block_ptr, idx);
+    block_ptr->ctrl[idx] = HASH_TAG(hash_value);
+    memcpy(slot_ptr, &hash_value, sizeof(uint32_t));
+    slot_ptr += sizeof(uint32_t);
+    memcpy(HASH_GET_KEY(block_ptr, slot_ptr), key_ptr, block_ptr->key_width);
+    *value_pptr = HASH_GET_VALUE(block_ptr, slot_ptr);
+    memcpy(*value_pptr, block_ptr->no_value_ptr, block_ptr->value_width);
     block_ptr->num_entries++;
 
     return OK;
 }
 
 
-
-#if 0
-/* NOTE: Since we're returning a reference to the value, the user
- * could mistakenly set the value to "empty" (e.g., put a null pointer
- * in an allocated entry).  This is problematic, since the internal
- * count will have been incremented even though in essence no entry
- * has been added.  I don't know the proper solution. */
-static int
-hashlib_block_insert(
-    HashBlock          *block_ptr,
-    uint8_t            *key_ptr,
-    uint8_t           **value_pptr)
-{
-    uint8_t *current_entry_ptr = NULL;
-    int rv;
-
-    /* Assert block won't exceed load factor */
-    assert(!HASHLIB_BLOCK_IS_FULL(block_ptr));
-    /*
-     * assert(!((block_ptr->num_entries / ((block_ptr->block_size) >> 8)) >
-     *          block_ptr->load_factor));
-     */
-
-    /* Find a slot with the specified key, or a free slot in the hash
-     * table */
-    rv = hashlib_block_find_entry(block_ptr, key_ptr, &current_entry_ptr);
-    if (rv == OK) {
-        /* Return pointer to the value in the entry structure */
-        *value_pptr = HASH_GET_VALUE(block_ptr, current_entry_ptr);
-        return OK_DUPLICATE;
-    } else if (rv == ERR_NOTFOUND) {
-        /* Got an empty entry back -- fill it the key */
-        memcpy(HASH_GET_KEY(block_ptr, current_entry_ptr),
-               key_ptr, block_ptr->key_width);
-        /* Return pointer to the value in the entry structure */
-        *value_pptr = HASH_GET_VALUE(block_ptr, current_entry_ptr);
-        /* Update the number of entries */
-        (block_ptr->num_entries)++;
-        return OK;
-    } else {
-        return rv;
-    }
-}
-#endif /* 0 */
-
-
 int
 hashlib_lookup(
     const HashTable    *table_ptr,
     const uint8_t      *key_ptr,
     uint8_t           **value_pptr)
 {
-    uint8_t i;
+    uint32_t hash_value;
+    uint32_t idx;
 
 #ifdef HASHLIB_RECORD_STATS
     hashlib_stats_lookups++;
@@ -1015,98 +982,85 @@ hashlib_lookup(
         return ERR_SORTTABLE;
     }
 
-    /* Look in each block for the entry */
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        if (hashlib_block_lookup(table_ptr->block_ptrs[i], key_ptr, value_pptr)
-            == OK)
-        {
-            return OK;
-        }
-    }
-    return ERR_NOTFOUND;
-}
-
+    hash_value = HASH_COMPUTE_HASH(key_ptr, table_ptr->key_width);
 
-static int
-hashlib_block_lookup(
-    const HashBlock    *block_ptr,
-    const uint8_t      *key_ptr,
-    uint8_t           **value_pptr)
-{
-    uint8_t *current_entry_ptr = NULL;
-    int rv = hashlib_block_find_entry(block_ptr, key_ptr, &current_entry_ptr);
-
-    if (rv == OK) {
-        /* Return pointer to the value in the entry structure */
-        *value_pptr = HASH_GET_VALUE(block_ptr, current_entry_ptr);
+    if (hashlib_block_find_entry(table_ptr->block_ptr, key_ptr,
+                                 hash_value, &idx)
+        == OK)
+    {
+        *value_pptr = HASH_GET_ENTRY_VALUE(table_ptr->block_ptr, idx);
         return OK;
-    } else {
-        return ERR_NOTFOUND;
     }
-
+    if (table_ptr->old_block_ptr
+        && (hashlib_block_find_entry(table_ptr->old_block_ptr, key_ptr,
+                                     hash_value, &idx)
+            == OK))
+    {
+        *value_pptr = HASH_GET_ENTRY_VALUE(table_ptr->old_block_ptr, idx);
+        return OK;
+    }
+    return ERR_NOTFOUND;
 }
 
 
-/* If not found, points to insertion point */
+/* If not found, sets 'index_ptr' to the insertion point */
 static int
 hashlib_block_find_entry(
     const HashBlock    *block_ptr,
     const uint8_t      *key_ptr,
-    uint8_t           **entry_pptr)
+    uint32_t            hash_value,
+    uint32_t           *index_ptr)
 {
-#ifndef NDEBUG
-    uint32_t num_tries = 0;
-#endif
-    uint32_t hash_index = 0;
-    uint8_t *current_entry_ptr = NULL;
-    uint32_t hash_value = 0;
-    uint32_t hash_probe_increment = 0;
+    const uint32_t group_mask = (block_ptr->block_size / HASH_GROUP_WIDTH) - 1;
+    const uint8_t tag = HASH_TAG(hash_value);
+    const uint8_t *group_ctrl;
+    uint32_t group = hash_value & group_mask;
+    uint32_t stride = 0;
+    uint32_t stored_hash;
+    uint32_t idx;
+    hash_mask_t match;
 
     /*
-     *  This code computes the hash for the key, and finds the bucket
-     *  at that hash-value.  If the bucket is empty, this function is
-     *  done; it passes back a handle to that bucket and returns
-     *  ERR_NOTFOUND.
+     *  This code examines the group of buckets selected by the hash
+     *  of the key.  For each bucket in the group whose control byte
+     *  matches the tag of the key, it compares the stored hash and
+     *  then the key; if both match, the entry is found: the function
+     *  passes back the index of the bucket and returns OK.
      *
-     *  If the bucket is not empty, the function checks to see if
-     *  bucket's key matches the key passed into the function.  If the
-     *  keys match, the entry is found; the function passes back
-     *  a handle that bucket and returns OK.
+     *  If the group has an empty bucket, the key is not in the block;
+     *  the function passes back the index of the first empty bucket
+     *  and returns ERR_NOTFOUND.
      *
-     *  If the keys do not match, it means multiple keys return the
-     *  same hash value; that is, there is a collision.  The
-     *  do..while() repeats and a new hash is computed---by
-     *  incrementing the 'hash_probe_increment' value.
-     *
-     *  The process repeats until either an empty bucket is found or
-     *  the keys match.
-     *
-     *  This collision resolution mechanism is what makes removal
-     *  impossible---unless a "deleted-entry" value is used or the
-     *  entire table is rehashed after a deletion.  It is also why the
-     *  caller must never set a bucket's value to the no_value_ptr
-     *  value.
+     *  Otherwise the group is full of other keys, and the search
+     *  continues in the next group in the probe sequence.
      */
-    do {
-        HASH_COMPUTE_HASH(&hash_index, key_ptr, block_ptr->key_width,
-                          block_ptr->block_size,
-                          hash_value, hash_probe_increment);
-
-        current_entry_ptr = HASH_GET_ENTRY(block_ptr, hash_index);
+    for (;;) {
+        group_ctrl = block_ptr->ctrl + group * HASH_GROUP_WIDTH;
+        for (match = hashlib_group_match(group_ctrl, tag);
+             match;
+             match = HASH_MASK_NEXT(match))
+        {
+            idx = group * HASH_GROUP_WIDTH + HASH_MASK_FIRST(match);
+            HASH_GET_STORED_HASH(block_ptr, idx, stored_hash);
+            if (stored_hash == hash_value
+                && HASH_COMPARE_KEYS(HASH_GET_ENTRY_KEY(block_ptr, idx),
+                                     key_ptr, block_ptr->key_width))
+            {
+                *index_ptr = idx;
+                return OK;
+            }
+        }
 
-        /* Hit an empty entry, we're done. */
-        if (HASH_ENTRY_ISEMPTY(block_ptr, current_entry_ptr)) {
-            *entry_pptr = current_entry_ptr;
+        match = hashlib_group_match_empty(group_ctrl);
+        if (match) {
+            *index_ptr = group * HASH_GROUP_WIDTH + HASH_MASK_FIRST(match);
             return ERR_NOTFOUND;
         }
-        assert(++num_tries < block_ptr->block_size);
 
-    } while (!HASH_COMPARE_KEYS(HASH_GET_KEY(block_ptr, current_entry_ptr),
-                                key_ptr, block_ptr->key_width));
-
-    /* Found it. */
-    *entry_pptr = current_entry_ptr;
-    return OK;
+        ++stride;
+        assert(stride <= group_mask);
+        group = (group + stride) & group_mask;
+    }
 }
 
 
@@ -1116,13 +1070,9 @@ hashlib_block_count_nonempties(
 {
     uint32_t i;
     uint32_t count = 0;
-    uint8_t *entry_ptr;
 
-    for (i = 0, entry_ptr = HASH_GET_ENTRY(block_ptr, 0);
-         i < block_ptr->block_size;
-         ++i, entry_ptr += HASH_GET_ENTRY_SIZE(block_ptr))
-    {
-        if (!HASH_ENTRY_ISEMPTY(block_ptr, entry_ptr)) {
+    for (i = 0; i < block_ptr->block_size; ++i) {
+        if (HASH_CTRL_ISFULL(block_ptr->ctrl[i])) {
             ++count;
         }
     }
@@ -1178,11 +1128,11 @@ hashlib_dump_block(
     fprintf(fp, "Data Dump:\n");
     fprintf(fp, "----------\n");
     for (i = 0; i < block_ptr->block_size; i++) {
-        entry_ptr = HASH_GET_ENTRY(block_ptr, i);
         /* Don't dump empty entries */
-        if (HASH_ENTRY_ISEMPTY(block_ptr, entry_ptr)) {
+        if (!HASH_CTRL_ISFULL(block_ptr->ctrl[i])) {
             continue;
         }
+        entry_ptr = HASH_GET_ENTRY(block_ptr, i);
         entry_index++;
 
         /* Dump hash index in table, the key and the value */
@@ -1242,186 +1192,131 @@ hashlib_iterate(
     uint8_t           **key_pptr,
     uint8_t           **val_pptr)
 {
-#ifdef TRACEMSG_LEVEL
-    static uint32_t so_far = 0;
-#endif
-    HashBlock *block_ptr;
+    const HashBlock *block_ptr;
     uint8_t *entry_ptr;
 
     if (iter_ptr->block == HASH_ITER_END) {
         return ERR_NOMOREENTRIES;
     }
 
-    if (table_ptr->is_sorted && table_ptr->num_blocks > 1) {
-        /* Use sorted iterator if we should */
-        return hashlib_iterate_sorted(table_ptr, iter_ptr, key_pptr, val_pptr);
-    }
-
     /* Start at the first entry in the first block or increment the
      * iterator to start looking at the next entry. */
     if (iter_ptr->block == HASH_ITER_BEGIN) {
         /* Initialize the iterator. */
         memset(iter_ptr, 0, sizeof(HASH_ITER));
-#ifdef TRACEMSG_LEVEL
-        so_far = 0;
-#endif
     } else {
         (iter_ptr->index)++;
     }
 
-    /* Walk through indices of current block until we find a
-     * non-empty.  Once we reach the end of the block, move on to the
-     * next block. */
-    while (iter_ptr->block < table_ptr->num_blocks) {
-
-        /* Select the current block */
-        block_ptr = table_ptr->block_ptrs[iter_ptr->block];
-
-        /* Find the next non-empty entry in the current block (if
-         * there is one). */
-        for (entry_ptr = HASH_GET_ENTRY(block_ptr, iter_ptr->index);
-             iter_ptr->index < block_ptr->block_size;
-             ++iter_ptr->index, entry_ptr += HASH_GET_ENTRY_SIZE(block_ptr))
-        {
-            if (!HASH_ENTRY_ISEMPTY(block_ptr, entry_ptr)) {
-                /* We found an entry, return it */
-                *key_pptr = HASH_GET_KEY(block_ptr, entry_ptr);
-                *val_pptr = HASH_GET_VALUE(block_ptr, entry_ptr);
-#ifdef TRACEMSG_LEVEL
-                so_far++;
-#endif
-                return OK;
+    if (table_ptr->is_sorted) {
+        /* The entries are contiguous and in order */
+        block_ptr = table_ptr->block_ptr;
+        if (iter_ptr->index < block_ptr->num_entries) {
+            entry_ptr = HASH_GET_SORTED_ENTRY(block_ptr, iter_ptr->index);
+            *key_pptr = HASH_GET_KEY(block_ptr, entry_ptr);
+            *val_pptr = HASH_GET_VALUE(block_ptr, entry_ptr);
+            return OK;
+        }
+    } else {
+        /* Walk through the buckets of the current array and then of
+         * the previous array (if any) until we find an occupied
+         * bucket. */
+        for (;;) {
+            block_ptr = ((0 == iter_ptr->block)
+                         ? table_ptr->block_ptr
+                         : table_ptr->old_block_ptr);
+            if (NULL == block_ptr) {
+                break;
             }
+            for ( ; iter_ptr->index < block_ptr->block_size; ++iter_ptr->index)
+            {
+                if (HASH_CTRL_ISFULL(block_ptr->ctrl[iter_ptr->index])) {
+                    /* We found an entry, return it */
+                    entry_ptr = HASH_GET_ENTRY(block_ptr, iter_ptr->index);
+                    *key_pptr = HASH_GET_KEY(block_ptr, entry_ptr);
+                    *val_pptr = HASH_GET_VALUE(block_ptr, entry_ptr);
+                    return OK;
+                }
+            }
+            if (iter_ptr->block > 0) {
+                break;
+            }
+            /* try the previous array */
+            iter_ptr->block++;
+            iter_ptr->index = 0;
         }
-
-        /* At the end of the block. */
-#ifdef TRACEMSG_LEVEL
-        TRACEMSG(2,(("Iterate. Moving to next block. So far %" PRIu32),
-                    so_far));
-        so_far = 0;
-#endif
-
-        /* try the next block */
-        iter_ptr->block++;
-        iter_ptr->index = 0;
     }
 
-    /* We're past the last entry of the last block, so we're done. */
+    /* We're past the last entry, so we're done. */
     *key_pptr = NULL;
     *val_pptr = NULL;
     iter_ptr->block = HASH_ITER_END;
-#ifdef TRACEMSG_LEVEL
     TRACEMSG(2,("Iterate. No more entries."));
-#endif
     return ERR_NOMOREENTRIES;
 }
 
 
-static int
-hashlib_iterate_sorted(
-    const HashTable    *table_ptr,
-    HASH_ITER          *iter_ptr,
-    uint8_t           **key_pptr,
-    uint8_t           **val_pptr)
+uint32_t
+hashlib_count_buckets(
+    const HashTable    *table_ptr)
 {
-    uint8_t *lowest_entry = NULL;
-    int k;
+    uint32_t total = table_ptr->block_ptr->block_size;
 
-    assert(iter_ptr->block != HASH_ITER_END);
-
-    /* Start at the first entry in the first block or increment the
-     * iterator to start looking at the next entry. */
-    if (iter_ptr->block == HASH_ITER_BEGIN) {
-        /* Initialize the iterator. */
-        memset(iter_ptr, 0, sizeof(HASH_ITER));
-    } else {
-        /* Increment the pointer in the block from which we took the
-         * entry last time. */
-        ++iter_ptr->block_idx[iter_ptr->block];
-    }
-
-    /* Find the first available value across all blocks; this is our
-     * arbitrary "lowest" value. */
-    for (k = 0; k < table_ptr->num_blocks; ++k) {
-        if (iter_ptr->block_idx[k] < table_ptr->block_ptrs[k]->num_entries) {
-            iter_ptr->block = k;
-            lowest_entry = HASH_GET_ENTRY(table_ptr->block_ptrs[k],
-                                          iter_ptr->block_idx[k]);
-            break;
-        }
-    }
-
-    if (k == table_ptr->num_blocks) {
-        /* We've processed all blocks.  Done. */
-        *key_pptr = NULL;
-        *val_pptr = NULL;
-        iter_ptr->block = HASH_ITER_END;
-        return ERR_NOMOREENTRIES;
-    }
-
-    /* Compare our arbitrary "lowest" with every remaining block to
-     * find the actual lowest. */
-    for ( ++k; k < table_ptr->num_blocks; ++k) {
-        if ((iter_ptr->block_idx[k] < table_ptr->block_ptrs[k]->num_entries)
-            && (table_ptr->cmp_fn(HASH_GET_ENTRY(table_ptr->block_ptrs[k],
-                                                 iter_ptr->block_idx[k]),
-                                  lowest_entry,
-                                  table_ptr->user_data)
-                < 0))
-        {
-            iter_ptr->block = k;
-            lowest_entry = HASH_GET_ENTRY(table_ptr->block_ptrs[k],
-                                          iter_ptr->block_idx[k]);
-        }
+    if (table_ptr->old_block_ptr) {
+        total += table_ptr->old_block_ptr->block_size;
     }
-
-    /* return lowest */
-    *key_pptr = HASH_GET_KEY(table_ptr, lowest_entry);
-    *val_pptr = HASH_GET_VALUE(table_ptr, lowest_entry);
-    return OK;
+    return total;
 }
 
 
 uint32_t
-hashlib_count_buckets(
+hashlib_count_entries(
     const HashTable    *table_ptr)
 {
-    int i;
-    uint32_t total = 0;
+    uint32_t total = table_ptr->block_ptr->num_entries;
 
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        total += table_ptr->block_ptrs[i]->block_size;
+    if (table_ptr->old_block_ptr) {
+        total += table_ptr->old_block_ptr->num_entries;
     }
     return total;
 }
 
 
-uint32_t
-hashlib_count_entries(
+uint64_t
+hashlib_count_bytes(
     const HashTable    *table_ptr)
 {
-    int i;
-    uint32_t total = 0;
+    uint64_t total = HASH_GET_BLOCK_BYTES(table_ptr->block_ptr);
 
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        total += table_ptr->block_ptrs[i]->num_entries;
+    if (table_ptr->old_block_ptr) {
+        total += HASH_GET_BLOCK_BYTES(table_ptr->old_block_ptr);
     }
     return total;
 }
 
 
+void
+hashlib_set_memory_limit(
+    HashTable          *table_ptr,
+    uint64_t            max_bytes)
+{
+    table_ptr->max_memory = max_bytes;
+}
+
+
 uint32_t
 hashlib_count_nonempties(
     const HashTable    *table_ptr)
 {
-    int i;
-    uint32_t total = 0;
-    uint32_t bc;
+    uint32_t total;
 
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        bc = hashlib_block_count_nonempties(table_ptr->block_ptrs[i]);
-        total += bc;
-        TRACEMSG(2,(("nonempty count for block %d is %" PRIu32 "."), i, bc));
+    if (table_ptr->is_sorted) {
+        /* control bytes are no longer maintained */
+        return table_ptr->block_ptr->num_entries;
+    }
+    total = hashlib_block_count_nonempties(table_ptr->block_ptr);
+    if (table_ptr->old_block_ptr) {
+        total += hashlib_block_count_nonempties(table_ptr->old_block_ptr);
     }
     return total;
 }
@@ -1437,63 +1332,33 @@ hashlib_cmp_fn(
 }
 
 
-/* move the entries in each block to the front of the block, in
- * preparation for sorting the entries */
+/* move the entries to the front of the block and remove the stored
+ * hashes, in preparation for sorting the entries */
 static void
 hashlib_make_contiguous(
     HashTable          *table_ptr)
 {
     HashBlock *block_ptr;
-    uint32_t i, j;
-    int k;
-    uint8_t *entry_i;
-    uint8_t *entry_j;
     uint32_t entry_size = HASH_GET_ENTRY_SIZE(table_ptr);
-    uint32_t value_size = HASH_GET_VALUE_SIZE(table_ptr);
+    uint32_t i;
+    uint32_t j;
 
-    for (k = 0; k < table_ptr->num_blocks; ++k) {
-        block_ptr = table_ptr->block_ptrs[k];
-        if (0 == block_ptr->num_entries) {
-            continue;
-        }
+    /* move everything into the current array */
+    if (table_ptr->old_block_ptr) {
+        hashlib_move_groups(table_ptr, UINT32_MAX);
+    }
+    block_ptr = table_ptr->block_ptr;
 
-        /* 'j' starts from the front of the block and moves forward to
-         * find empty entries.  'i' starts from the end of the block
-         * and moves backward to find occupied entries.  We move
-         * non-empty entries from 'i' to 'j' to get rid of holes in
-         * the block.  Stop once i and j meet. */
-        for (j = 0, entry_j = HASH_GET_ENTRY(block_ptr, 0);
-             j < block_ptr->block_size;
-             j++, entry_j += entry_size)
-        {
-            if (HASH_ENTRY_ISEMPTY(block_ptr, entry_j)) {
-                break;
-            }
+    /* the destination is never beyond the source since an entry is
+     * smaller than a slot */
+    for (i = 0, j = 0; i < block_ptr->block_size; ++i) {
+        if (HASH_CTRL_ISFULL(block_ptr->ctrl[i])) {
+            memmove(HASH_GET_SORTED_ENTRY(block_ptr, j),
+                    HASH_GET_ENTRY(block_ptr, i), entry_size);
+            ++j;
         }
-
-        for (i = block_ptr->block_size-1, entry_i =HASH_GET_ENTRY(block_ptr,i);
-             i > j;
-             --i, entry_i -= entry_size)
-        {
-            if (!HASH_ENTRY_ISEMPTY(block_ptr, entry_i)) {
-                memcpy(entry_j, entry_i, entry_size);
-                /* set i to the empty value */
-                memcpy(HASH_GET_VALUE(block_ptr, entry_i),
-                       block_ptr->no_value_ptr, value_size);
-                /* find next empty value */
-                for (++j, entry_j += entry_size;
-                     j < i;
-                     ++j, entry_j += entry_size)
-                {
-                    if (HASH_ENTRY_ISEMPTY(block_ptr, entry_j)) {
-                        break;
-                    }
-                }
-            }
-        }
-
-        assert(j <= block_ptr->num_entries);
     }
+    assert(j == block_ptr->num_entries);
 }
 
 
@@ -1505,10 +1370,9 @@ hashlib_sort_entries_helper(
 {
     HashBlock *block_ptr;
     size_t entry_size = HASH_GET_ENTRY_SIZE(table_ptr);
-    int k;
 
     if (!table_ptr->is_sorted) {
-        /* first call; make the data in each block contiguous */
+        /* first call; make the data in the block contiguous */
         hashlib_make_contiguous(table_ptr);
     }
 
@@ -1527,14 +1391,10 @@ hashlib_sort_entries_helper(
         *(size_t*)table_ptr->user_data = HASH_GET_KEY_SIZE(table_ptr);
     }
 
-    /* we use qsort to sort each block individually; when iterating,
-     * return the lowest value among all sorted blocks. */
-    for (k = 0; k < table_ptr->num_blocks; ++k) {
-        block_ptr = table_ptr->block_ptrs[k];
-        /* sort the block's entries */
-        skQSort_r(block_ptr->_data_ptr, block_ptr->num_entries,
-                  entry_size, table_ptr->cmp_fn, table_ptr->user_data);
-    }
+    /* sort the entries */
+    block_ptr = table_ptr->block_ptr;
+    skQSort_r(block_ptr->_data_ptr, block_ptr->num_entries,
+              entry_size, table_ptr->cmp_fn, table_ptr->user_data);
 
     table_ptr->is_sorted = 1;
     return 0;
@@ -1566,12 +1426,33 @@ hashlib_dump_table(
     FILE               *fp,
     const HashTable    *table_ptr)
 {
-    int i;
+    uint32_t i;
+    const HashBlock *block_ptr = table_ptr->block_ptr;
+    uint8_t *entry_ptr;
 
     hashlib_dump_table_header(fp, table_ptr);
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        fprintf(fp, "Block %d:\n", i);
-        hashlib_dump_block(fp, table_ptr->block_ptrs[i]);
+    if (table_ptr->is_sorted) {
+        fprintf(fp, "Block 0:\n");
+        hashlib_dump_block_header(fp, block_ptr);
+        fprintf(fp, "Data Dump:\n");
+        fprintf(fp, "----------\n");
+        for (i = 0; i < block_ptr->num_entries; ++i) {
+            entry_ptr = HASH_GET_SORTED_ENTRY(block_ptr, i);
+            fprintf(fp, ("%6" PRIu32 " (%" PRIu32 "). "), 1 + i, i);
+            hashlib_dump_bytes(fp, HASH_GET_KEY(block_ptr, entry_ptr),
+                               block_ptr->key_width);
+            fprintf(fp, " -- ");
+            hashlib_dump_bytes(fp, HASH_GET_VALUE(block_ptr, entry_ptr),
+                               block_ptr->value_width);
+            fprintf(fp, "\n");
+        }
+        return;
+    }
+    fprintf(fp, "Block 0:\n");
+    hashlib_dump_block(fp, block_ptr);
+    if (table_ptr->old_block_ptr) {
+        fprintf(fp, "Block 1:\n");
+        hashlib_dump_block(fp, table_ptr->old_block_ptr);
     }
 }
 
@@ -1581,10 +1462,16 @@ hashlib_dump_table_header(
     FILE               *fp,
     const HashTable    *table_ptr)
 {
+    const HashBlock *blocks[2];
+    const HashBlock *block_ptr;
+    int num_blocks;
     int i;
-    HashBlock *block_ptr;
-    uint32_t total_used_memory = 0;
-    uint32_t total_data_memory = 0;
+    uint64_t total_used_memory = 0;
+    uint64_t total_data_memory = 0;
+
+    blocks[0] = table_ptr->block_ptr;
+    blocks[1] = table_ptr->old_block_ptr;
+    num_blocks = (blocks[1] ? 2 : 1);
 
     /* Dump header info */
     fprintf(fp, "Key width:\t %d bytes\n", table_ptr->key_width);
@@ -1604,133 +1491,113 @@ hashlib_dump_table_header(
     fprintf(fp, "Load factor:\t %d = %2.0f%%\n",
             table_ptr->load_factor,
             100 * (float) table_ptr->load_factor / 255);
-    fprintf(fp, ("Table has %" PRIu8 " blocks:\n"), table_ptr->num_blocks);
-    for (i = 0; i < table_ptr->num_blocks; i++) {
-        block_ptr = table_ptr->block_ptrs[i];
+    fprintf(fp, ("Table has %d blocks:\n"), num_blocks);
+    for (i = 0; i < num_blocks; i++) {
+        block_ptr = blocks[i];
         total_data_memory +=
-            HASH_GET_ENTRY_SIZE(block_ptr) * block_ptr->block_size;
+            (uint64_t)HASH_GET_ENTRY_SIZE(block_ptr) * block_ptr->block_size;
         total_used_memory +=
-            HASH_GET_ENTRY_SIZE(block_ptr) * block_ptr->num_entries;
+            (uint64_t)HASH_GET_ENTRY_SIZE(block_ptr) * block_ptr->num_entries;
         fprintf(fp, ("  Block #%d: %" PRIu32 "/%" PRIu32 " (%3.1f%%)\n"),
                 i, block_ptr->num_entries, block_ptr->block_size,
                 100 * ((float)block_ptr->num_entries) / block_ptr->block_size);
     }
-    fprintf(fp, ("Total data memory:           %" PRIu32 " bytes\n"),
+    fprintf(fp, ("Total data memory:           %" PRIu64 " bytes\n"),
             total_data_memory);
-    fprintf(fp, ("Total allocated data memory: %" PRIu32 " bytes\n"),
+    fprintf(fp, ("Total allocated data memory: %" PRIu64 " bytes\n"),
             total_used_memory);
-    fprintf(fp, ("Excess data memory:          %" PRIu32 " bytes\n"),
+    fprintf(fp, ("Excess data memory:          %" PRIu64 " bytes\n"),
             total_data_memory - total_used_memory);
     fprintf(fp, "\n");
 }
 
 
-#if 0
-static int
-hashlib_write_block_header(
-    const HashBlock    *block_ptr,
-    FILE               *output_fp)
-{
-    size_t write_count;
-
-    /* Write out the block attributes */
-    write_count = fwrite(&(block_ptr->block_size),
-                         sizeof(block_ptr->block_size), 1, output_fp);
-    assert(write_count == 1);
-    if (write_count != 1) {
-        return ERR_FILEWRITEERROR;
-    }
-
-    write_count = fwrite(&(block_ptr->num_entries),
-                         sizeof(block_ptr->num_entries), 1, output_fp);
-    assert(write_count == 1);
-    if (write_count != 1) {
-        return ERR_FILEWRITEERROR;
-    }
-    return OK;
-}
-#endif  /* 0 */
-
-
+/*
+ *    Write the entries of 'block_ptr' in the serialized form: one
+ *    key and value for every bucket, where an unused bucket has a
+ *    zeroed key and the empty value.  When the table is sorted, the
+ *    first num_entries buckets hold the entries in order.
+ */
 static int
 hashlib_write_block(
+    const HashTable    *table_ptr,
     const HashBlock    *block_ptr,
     FILE               *output_fp)
 {
-    size_t write_count;
-
-    /* Write out the actual data */
-    write_count = fwrite(block_ptr->_data_ptr,
-                         block_ptr->value_width + block_ptr->key_width,
-                         block_ptr->block_size, output_fp);
-    assert(write_count == block_ptr->block_size);
-    if (write_count != block_ptr->block_size) {
-        return ERR_FILEWRITEERROR;
-    }
-
-    return OK;
-}
-
+    uint8_t empty_entry[HASHLIB_MAX_KEY_WIDTH + HASHLIB_MAX_VALUE_WIDTH];
+    const size_t entry_size = HASH_GET_ENTRY_SIZE(block_ptr);
+    const uint8_t *entry_ptr;
+    uint32_t i;
 
-#if 0
-static int
-hashlib_read_block_header(
-    BlockHeader        *header_ptr,
-    FILE               *input_fp)
-{
-    size_t read_count;
+    memset(empty_entry, 0, block_ptr->key_width);
+    memcpy(empty_entry + block_ptr->key_width, block_ptr->no_value_ptr,
+           block_ptr->value_width);
 
-    /* Read block attributes */
-    read_count = fread(&(header_ptr->block_size),
-                       sizeof(header_ptr->block_size),
-                       1, input_fp);
-    assert(read_count == 1);
-    if (read_count != 1) {
-        return ERR_FILEREADERROR;
-    }
-    read_count = fread(&(header_ptr->num_entries),
-                       sizeof(header_ptr->num_entries),
-                       1, input_fp);
-    assert(read_count == 1);
-    if (read_count != 1) {
-        return ERR_FILEREADERROR;
+    for (i = 0; i < block_ptr->block_size; ++i) {
+        if (table_ptr->is_sorted) {
+            entry_ptr = ((i < block_ptr->num_entries)
+                         ? HASH_GET_SORTED_ENTRY(block_ptr, i)
+                         : empty_entry);
+        } else {
+            entry_ptr = (HASH_CTRL_ISFULL(block_ptr->ctrl[i])
+                         ? HASH_GET_ENTRY(block_ptr, i)
+                         : empty_entry);
+        }
+        if (fwrite(entry_ptr, entry_size, 1, output_fp) != 1) {
+            return ERR_FILEWRITEERROR;
+        }
     }
+
     return OK;
 }
-#endif  /* 0 */
 
 
+/*
+ *    Read a serialized block of 'block_header_ptr->block_size'
+ *    entries and add the entries whose value is not the empty value
+ *    to 'table_ptr'.  When the table is sorted, the entries are
+ *    appended in the order read.
+ */
 static int
 hashlib_read_block(
-    HashBlock         **block_pptr,
     HashTable          *table_ptr,
     const BlockHeader  *block_header_ptr,
     FILE               *input_fp)
 {
-    HashBlock *block_ptr;
-    size_t read_count;
-
-    /* Create a new block to hold the data */
-    block_ptr = hashlib_create_block(table_ptr, block_header_ptr->block_size);
-    if (block_ptr == NULL) {
-        return ERR_OUTOFMEMORY;
-    }
-    block_ptr->num_entries = block_header_ptr->num_entries;
+    uint8_t entry[HASHLIB_MAX_KEY_WIDTH + HASHLIB_MAX_VALUE_WIDTH];
+    const size_t entry_size = HASH_GET_ENTRY_SIZE(table_ptr);
+    HashBlock *block_ptr = table_ptr->block_ptr;
+    uint32_t hash_value;
+    uint32_t idx;
+    uint32_t i;
 
-    /* Read the table data right into the array directly */
-    read_count = fread(block_ptr->_data_ptr,
-                       table_ptr->key_width + table_ptr->value_width,
-                       block_ptr->block_size,
-                       input_fp);
-    assert(read_count == block_ptr->block_size);
-    if (read_count != block_ptr->block_size) {
-        free(block_ptr);
-        return ERR_FILEREADERROR;
+    for (i = 0; i < block_header_ptr->block_size; ++i) {
+        if (fread(entry, entry_size, 1, input_fp) != 1) {
+            return ERR_FILEREADERROR;
+        }
+        if (HASH_VALUE_ISEMPTY(table_ptr, entry + table_ptr->key_width)) {
+            continue;
+        }
+        if (block_ptr->num_entries >= block_ptr->block_full) {
+            /* more entries than the headers promised */
+            return ERR_FILEREADERROR;
+        }
+        if (table_ptr->is_sorted) {
+            memcpy(HASH_GET_SORTED_ENTRY(block_ptr, block_ptr->num_entries),
+                   entry, entry_size);
+            ++block_ptr->num_entries;
+            continue;
+        }
+        hash_value = HASH_COMPUTE_HASH(entry, table_ptr->key_width);
+        if (hashlib_block_find_entry(block_ptr, entry, hash_value, &idx)
+            == OK)
+        {
+            /* duplicate key */
+            return ERR_FILEREADERROR;
+        }
+        hashlib_block_fill(block_ptr, idx, hash_value, entry);
     }
 
-    /* Return the pointer to the block */
-    *block_pptr = block_ptr;
-
     return OK;
 }
 
@@ -1786,8 +1653,10 @@ hashlib_serialize_table(
     const uint8_t      *header_ptr,
     uint8_t             header_length)
 {
+    const HashBlock *blocks[2];
+    uint8_t num_blocks;
+    uint8_t block_index;
     int rv = OK;
-    int block_index;
     size_t write_count;
 
     /* For the moment, we only support serialization of values, not
@@ -1860,17 +1729,20 @@ hashlib_serialize_table(
         return ERR_FILEWRITEERROR;
     }
 
-    /* Write out number of blocks */
-    write_count = fwrite(&(table_ptr->num_blocks),
-                         sizeof(table_ptr->num_blocks), 1, output_fp);
+    /* Write out number of blocks: the current array and the previous
+     * array if the table is growing */
+    blocks[0] = table_ptr->block_ptr;
+    blocks[1] = table_ptr->old_block_ptr;
+    num_blocks = (blocks[1] ? 2 : 1);
+    write_count = fwrite(&num_blocks, sizeof(num_blocks), 1, output_fp);
     assert(write_count == 1);
     if (write_count != 1) {
         return ERR_FILEWRITEERROR;
     }
 
     /* Write the block headers */
-    for (block_index = 0; block_index < table_ptr->num_blocks; block_index++) {
-        const HashBlock *block_ptr = table_ptr->block_ptrs[block_index];
+    for (block_index = 0; block_index < num_blocks; block_index++) {
+        const HashBlock *block_ptr = blocks[block_index];
 
         /* Write out the block attributes */
         write_count = fwrite(&(block_ptr->block_size),
@@ -1889,9 +1761,8 @@ hashlib_serialize_table(
     }
 
     /* Write each of the blocks, one after the other */
-    for (block_index = 0; block_index < table_ptr->num_blocks; block_index++) {
-        rv = hashlib_write_block(table_ptr->block_ptrs[block_index],
-                                 output_fp);
+    for (block_index = 0; block_index < num_blocks; block_index++) {
+        rv = hashlib_write_block(table_ptr, blocks[block_index], output_fp);
         if (rv != OK) {
             return rv;
         }
@@ -1916,10 +1787,12 @@ hashlib_deserialize_table(
     uint32_t appdata_size;
     uint8_t *no_value_ptr;
     void *appdata_ptr;
-    int block_index;
-    BlockHeader block_headers[MAX_BLOCKS];
+    uint8_t num_blocks;
+    uint8_t block_index;
+    BlockHeader block_headers[HASH_SERIALIZED_MAX_BLOCKS];
+    uint64_t total_entries;
     size_t read_count;
-    uint32_t i;
+    int rv;
 
     assert(input_fp);
 
@@ -1998,80 +1871,65 @@ hashlib_deserialize_table(
         }
     }
 
-    /* Create a table structure using the values we just read */
-    /* Allocate memory for the table and initialize attributes.  */
-    table_ptr = (HashTable*)calloc(1, sizeof(HashTable));
-    assert(table_ptr);
-    if (table_ptr == NULL) {
-        free(no_value_ptr);
-        if (appdata_ptr) {
-            free(appdata_ptr);
-        }
-        return ERR_OUTOFMEMORY;
-    }
-    /* Initialize the table structure */
-    table_ptr->value_type = HTT_INPLACE;
-    table_ptr->key_width = key_width;
-    table_ptr->value_width = value_width;
-    table_ptr->load_factor = load_factor;
-    table_ptr->is_sorted = is_sorted;
-    /* Application data */
-    table_ptr->appdata_ptr = appdata_ptr;
-    table_ptr->appdata_size = appdata_size;
-    table_ptr->no_value_ptr = no_value_ptr;
-
-    /* Determine if no_value_ptr contains a single byte value repeated
-     * (such as all 0's or all 1's, so we can memset the memory in one
-     * step.  Assume we can, and unset if we can't. */
-    table_ptr->can_memset_val = 1;
-    for (i = 1; i < table_ptr->value_width; ++i) {
-        if (no_value_ptr[0] != no_value_ptr[i]) {
-            table_ptr->can_memset_val = 0;
-            break;
-        }
-    }
-
-    /* Read the number of blocks */
-    read_count = fread(&(table_ptr->num_blocks),
-                       sizeof(table_ptr->num_blocks), 1, input_fp);
+    /* Read the number of blocks and the block header array */
+    read_count = fread(&num_blocks, sizeof(num_blocks), 1, input_fp);
     if (read_count != 1) {
-        hashlib_free_table(table_ptr);
+        free(no_value_ptr);
+        free(appdata_ptr);
         return ERR_FILEREADERROR;
     }
-    if (table_ptr->num_blocks > MAX_BLOCKS) {
-        TRACEMSG(1,(("ERROR: Serialized table num_blocks=%" PRIu32
-                     " > MAX_BLOCKS=%u."),
-                    table_ptr->num_blocks, MAX_BLOCKS));
-        table_ptr->num_blocks = 0;
-        hashlib_free_table(table_ptr);
+    if (num_blocks > HASH_SERIALIZED_MAX_BLOCKS) {
+        TRACEMSG(1,(("ERROR: Serialized table num_blocks=%u > %u."),
+                    num_blocks, HASH_SERIALIZED_MAX_BLOCKS));
+        free(no_value_ptr);
+        free(appdata_ptr);
         return ERR_NOTSUPPORTED;
     }
-
-    /* Read the block header array */
     read_count = fread(block_headers, sizeof(BlockHeader),
-                       table_ptr->num_blocks, input_fp);
-    if (read_count != table_ptr->num_blocks) {
-        table_ptr->num_blocks = 0;
-        hashlib_free_table(table_ptr);
+                       num_blocks, input_fp);
+    if (read_count != num_blocks) {
+        free(no_value_ptr);
+        free(appdata_ptr);
+        return ERR_FILEREADERROR;
+    }
+    total_entries = 0;
+    for (block_index = 0; block_index < num_blocks; block_index++) {
+        total_entries += block_headers[block_index].num_entries;
+    }
+    if (total_entries > UINT32_MAX) {
+        free(no_value_ptr);
+        free(appdata_ptr);
         return ERR_FILEREADERROR;
     }
 
-    /* Read each of the blocks */
-    for (block_index = 0; block_index < table_ptr->num_blocks; block_index++) {
-        HashBlock *block_ptr;
-        int rv;
+    /* Create a table that holds all the entries in a single array */
+    table_ptr = hashlib_create_table(key_width, value_width, HTT_INPLACE,
+                                     no_value_ptr, (uint8_t*)appdata_ptr,
+                                     appdata_size, (uint32_t)total_entries,
+                                     load_factor);
+    free(no_value_ptr);
+    if (table_ptr == NULL) {
+        free(appdata_ptr);
+        return ERR_OUTOFMEMORY;
+    }
+    table_ptr->is_sorted = is_sorted;
 
-        /* Read block based on block header */
-        rv = hashlib_read_block(&block_ptr, table_ptr,
-                                &(block_headers[block_index]),
+    /* Read each of the blocks */
+    for (block_index = 0; block_index < num_blocks; block_index++) {
+        rv = hashlib_read_block(table_ptr, &(block_headers[block_index]),
                                 input_fp);
         if (rv != OK) {
-            assert(rv == OK);
-            table_ptr->num_blocks = block_index;
             hashlib_free_table(table_ptr);
+            free(appdata_ptr);
             return rv;
         }
-        table_ptr->block_ptrs[block_index] = block_ptr;
+    }
+
+    /* A sorted table from a version that used multiple blocks holds
+     * several sorted runs; sort them into one */
+    if (is_sorted && num_blocks > 1) {
+        table_ptr->is_sorted = 0;
+        hashlib_sort_entries(table_ptr);
     }
 
     *table_pptr = table_ptr;
@@ -85,10 +85,11 @@ RCSIDENTVAR(rcsID_HASHLIB_H, "$SiLK: hashlib.h b7b8edebba12 2015-01-05 18:05:21Z
  */
 
 /**
- *    Maximum size in bytes that may be allocated with malloc. Must be a
- *    power of two.
+ *    Maximum size in bytes of the array of buckets that holds the
+ *    keys and values of a table. Must be a power of two.  A table
+ *    that would grow beyond this size returns ERR_NOMOREBLOCKS.
  */
-#define MAX_MEMORY_BLOCK (1<<28)
+#define MAX_MEMORY_BLOCK (1<<30)
 
 /*
  *  **************************************************************************
@@ -125,7 +126,7 @@ RCSIDENTVAR(rcsID_HASHLIB_H, "$SiLK: hashlib.h b7b8edebba12 2015-01-05 18:05:21Z
 #define ERR_FILEWRITEERROR -9
 /**  attempt to operate on a sorted table */
 #define ERR_SORTTABLE -10
-/**  attempted to aloc > max. # of blocks */
+/**  table is at its maximum size */
 #define ERR_NOMOREBLOCKS -254
 /**  a call to malloc failed */
 #define ERR_OUTOFMEMORY -255
@@ -147,11 +148,6 @@ RCSIDENTVAR(rcsID_HASHLIB_H, "$SiLK: hashlib.h b7b8edebba12 2015-01-05 18:05:21Z
  * be passed to hashlib_create_table for the load factor. */
 #define DEFAULT_LOAD_FACTOR 192
 
-/** Maximum number of blocks ever allocated. Once the primary block
- * reaches the maximum block size, new blocks will be allocated
- * until this maximum is reached. */
-#define MAX_BLOCKS 8
-
 /** Maximum byte-length of the key */
 #define HASHLIB_MAX_KEY_WIDTH    UINT8_MAX
 /** Maximum byte-lenght of the value */
@@ -163,7 +159,8 @@ RCSIDENTVAR(rcsID_HASHLIB_H, "$SiLK: hashlib.h b7b8edebba12 2015-01-05 18:05:21Z
  * by hash table users. Attriutes in HashTable duplicated in HashBlock
  * are copied upon block creation.*/
 
-/**  a HashTable maintains a set of HashBlocks. */
+/**  a HashTable stores its entries in a HashBlock; while the table
+ *   grows, a second HashBlock holds entries not yet moved. */
 typedef struct HashBlock_st HashBlock;
 
 /**  the HashTable structure */
@@ -178,10 +175,6 @@ typedef struct HashTable_st {
     uint8_t value_width;
     /**  Point at which to resize (fraction of 255) */
     uint8_t load_factor;
-    /**  Number of blocks */
-    uint8_t num_blocks;
-    /**  Non-zero if rehashing has failed in the past */
-    uint8_t rehash_failed;
     /**  Non-zero if hash entries are sorted */
     uint8_t is_sorted;
     /**  Non-zero if we can memset new memory to a value */
@@ -198,8 +191,14 @@ typedef struct HashTable_st {
     int    (*cmp_fn)(const void *, const void *, void *);
     /**  Caller's argument to the comparison function */
     void    *user_data;
-    /**  The blocks */
-    HashBlock *block_ptrs[MAX_BLOCKS];
+    /**  The array of buckets */
+    HashBlock *block_ptr;
+    /**  The previous array of buckets while the table is growing */
+    HashBlock *old_block_ptr;
+    /**  Next group in old_block_ptr to move to block_ptr */
+    uint32_t move_group;
+    /**  Maximum bytes the arrays of buckets may use, or 0 for no limit */
+    uint64_t max_memory;
 } HashTable;
 
 /**  HashTable iteration object */
@@ -208,8 +207,6 @@ typedef struct HashIter_st {
     int         block;
     /* Current index into block */
     uint32_t    index;
-    /* When working with a sorted table, index into each block */
-    uint32_t    block_idx[MAX_BLOCKS];
 } HASH_ITER;
 
 
@@ -237,9 +234,9 @@ typedef struct HashIter_st {
  *    estimated_size: An estimate of the number of unique entries that will
  *                    ultimately be inserted into the table.
  *    load_factor:    Generally, simply use DEFAULT_LOAD_FACTOR here. This
- *                    specifies what load level triggers the allocation of
- *                    a new hash block or a rehash (i.e., the maximum load
- *                    for a block). This is a percentage expressed as a
+ *                    specifies what load level causes the table to grow
+ *                    to twice its size (i.e., the maximum load for the
+ *                    table). This is a percentage expressed as a
  *                    fraction of 255.
  *
  *    Returns:
@@ -447,13 +444,13 @@ hashlib_free_table(
 
 
 /**
- *    Force a rehash of a table. Generally, this will be used when a
- *    series of insertions has been completed before a very large
- *    number of lookups (relative to the number of inserts). That is,
- *    when it is likely that the rehash cost is less than the cost
- *    associated with performing searches over multiple blocks.  This
- *    is an advanced function. As a rule, it never make sense to call
- *    this function when the table holds a single block.
+ *    Finish growing a table.  When a table grows, its entries are
+ *    moved to the larger array a few at a time on each insert, and
+ *    until the move completes, a lookup may search both arrays.
+ *    This function moves the remaining entries at once, and it may
+ *    be used when a series of insertions has been completed before a
+ *    very large number of lookups.  It does nothing when the table is
+ *    not growing.
  *
  *    Parameters:
  *
@@ -461,8 +458,7 @@ hashlib_free_table(
  *
  *    Returns:
  *
- *    Returns either OK or ERR_OUTOFMEMORY in the case of a memory
- *    allocation failure.
+ *    Returns OK.
  *
  *    ERR_SORTTABLE if hashlib_sort_entries() has been called on the table.
  */
@@ -493,15 +489,49 @@ hashlib_count_buckets(
  *    Returns:
  *
  *    Returns the total number of entries in the table.  This function
- *    sums the current entry count for each of the blocks that make up
- *    the table.  The return value should be equal to
- *    hashlib_count_nonempties().
+ *    sums the current entry count for the array of buckets and for
+ *    the previous array while the table is growing.  The return
+ *    value should be equal to hashlib_count_nonempties().
  */
 uint32_t
 hashlib_count_entries(
     const HashTable    *table_ptr);
 
 
+/**
+ *    Parameters:
+ *
+ *    table_ptr:      A pointer to a table.
+ *
+ *    Returns:
+ *
+ *    Returns the number of bytes allocated for the buckets of the
+ *    table, including the previous array while the table is growing.
+ */
+uint64_t
+hashlib_count_bytes(
+    const HashTable    *table_ptr);
+
+
+/**
+ *    Limit the memory used by the buckets of a table.  Once the
+ *    limit is set, hashlib_insert() returns ERR_NOMOREBLOCKS rather
+ *    than grow the table when the current array and the array twice
+ *    its size would together use more than 'max_bytes' bytes.  A
+ *    'max_bytes' of 0 removes the limit.  The limit does not shrink
+ *    a table that already exceeds it.
+ *
+ *    Parameters:
+ *
+ *    table_ptr:      A pointer to a table.
+ *    max_bytes:      The maximum number of bytes, or 0 for no limit.
+ */
+void
+hashlib_set_memory_limit(
+    HashTable          *table_ptr,
+    uint64_t            max_bytes);
+
+
 /**
  *    Parameters:
  *
@@ -58,17 +58,9 @@ RCSIDENT("$SiLK: hashlib_metrics.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $")
 
 #include <silk/hashlib.h>
 
-
-/* NOTE: normally these would not be changed by an application.  This
- * program is meant for tweaking of hashlib parameters. */
-extern uint32_t SECONDARY_BLOCK_FRACTION;
-extern uint32_t REHASH_BLOCK_COUNT;
-
 /* Description of a test to run */
 typedef struct TestDesc_st {
     uint8_t  load_factor;
-    int32_t  secondary_block_fraction;
-    uint32_t rehash_block_count;
     uint32_t num_entries;
     float    estimate_ratio;
 } TestDesc;
@@ -106,9 +98,6 @@ do_test(
 #ifdef HASHLIB_RECORD_STATS
     hashlib_clear_stats();
 #endif
-    /* Reconfigure the library */
-    SECONDARY_BLOCK_FRACTION = test_ptr->secondary_block_fraction;
-    REHASH_BLOCK_COUNT = test_ptr->rehash_block_count;
 
     fprintf(stderr, " -- BEFORE CREATE TABLE -- \n");
     gettimeofday(&tv1, NULL);
@@ -149,10 +138,8 @@ run_test(
     /* Run the test */
     fprintf(stderr, "Starting run: ");
     /* Print results */
-    fprintf(stderr, "%u\t%u\t%u\t%u\t%f\n",
+    fprintf(stderr, "%u\t%u\t%f\n",
             test_ptr->load_factor,
-            test_ptr->secondary_block_fraction,
-            test_ptr->rehash_block_count,
             test_ptr->num_entries,
             test_ptr->estimate_ratio);
 
@@ -167,7 +154,7 @@ run_test(
 
     /* Print results */
     fprintf(out_fp,
-            ("%u\t%3.3f\t%" PRIu64 "\t%u\t%d\t%u\t%3.3f"
+            ("%u\t%3.3f\t%" PRIu64 "\t%u\t%3.3f"
 #ifdef HASHLIB_RECORD_STATS
              "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%u"
 #endif
@@ -176,8 +163,6 @@ run_test(
             test_ptr->estimate_ratio,
             (uint64_t) (test_ptr->estimate_ratio * test_ptr->num_entries),
             test_ptr->load_factor,
-            test_ptr->secondary_block_fraction,
-            test_ptr->rehash_block_count,
             elapsed_time
 #ifdef HASHLIB_RECORD_STATS
             , hashlib_stats_inserts,
@@ -195,10 +180,9 @@ run_test(
 int main()
 {
     TestDesc test;
-    int32_t fracs[] = { 3, 2, 1, 0, -1, -2 };
-    uint32_t block_count[] = {2, 3, 4, 5};
+    uint8_t load_factors[] = { 128, 160, DEFAULT_LOAD_FACTOR, 224, 240 };
     float ratios[] = { 0.01, 0.125, 0.25, 0.50, 0.75, 0.875, 1.0 };
-    uint32_t i, j, k;
+    uint32_t i, k;
     FILE *out_fp;
     FILE *graph_fp;
     double elapsed_time;
@@ -210,44 +194,30 @@ int main()
     /* Write to stdout */
     out_fp = stdout;
 
-    fprintf(out_fp, ("Cnt\tRatio\tEst\tLF\tFrac\tBlks\t"
+    fprintf(out_fp, ("Cnt\tRatio\tEst\tLF\t"
                      "Time\tIns\tRehsh\tReInst\tAllocs\n"));
 
     /* Setup test variables */
-    test.load_factor = DEFAULT_LOAD_FACTOR;
     test.num_entries = (1<<20);
     test.num_entries = 419430;
 
     /* Print column headings for graph file */
-    fprintf(graph_fp, "Frac\t(%u,%u)\t", 1, 1);
-    for (i = 0; i < sizeof(fracs)/sizeof(fracs[0]); ++i) {
-        for (j = 0; j < sizeof(block_count)/sizeof(block_count[0]); ++j) {
-            fprintf(graph_fp, "(%d,%u)\t",  fracs[i], block_count[j]);
-        }
+    fprintf(graph_fp, "Frac\t");
+    for (i = 0; i < sizeof(load_factors)/sizeof(load_factors[0]); ++i) {
+        fprintf(graph_fp, "(%u)\t", load_factors[i]);
     }
     fprintf(graph_fp, "\n");
 
     /* Loop through the different combinations */
     for (k = 0; k < sizeof(ratios)/sizeof(ratios[0]); ++k) {
         test.estimate_ratio = ratios[k];
-
-        /* Baseline: one block */
-        test.secondary_block_fraction = 1; /* ignored */
-        test.rehash_block_count = 1; /* rehash when full */
-        elapsed_time = run_test(out_fp, &test);
-
         fprintf(graph_fp, "%3.4f\t", test.estimate_ratio);
-        fprintf(graph_fp, "%3.4f\t", elapsed_time);
-
-        /* Try different combinations of block sizes & counts */
-        for (i = 0; i < sizeof(fracs)/sizeof(fracs[0]); ++i) {
-            for (j = 0; j < sizeof(block_count)/sizeof(block_count[0]); ++j) {
-                /* Adjust test variables */
-                test.secondary_block_fraction = fracs[i];
-                test.rehash_block_count = block_count[j];
-                elapsed_time = run_test(out_fp, &test);
-                fprintf(graph_fp, "%3.3f\t", elapsed_time);
-            }
+
+        /* Try different load factors */
+        for (i = 0; i < sizeof(load_factors)/sizeof(load_factors[0]); ++i) {
+            test.load_factor = load_factors[i];
+            elapsed_time = run_test(out_fp, &test);
+            fprintf(graph_fp, "%3.3f\t", elapsed_time);
         }
         fprintf(graph_fp, "\n");
         fflush(graph_fp);
@@ -459,13 +459,14 @@ skIPTreeIntersect(
                 free(result_ipset->nodes[i]);
                 result_ipset->nodes[i] = NULL;
             } else  {
-                int nonzero = 0;
-                /* Need to intersect the bits in the /16 */
+                uint32_t *dst = result_ipset->nodes[i]->addressBlock;
+                const uint32_t *src = ipset->nodes[i]->addressBlock;
+                uint32_t nonzero = 0;
+                /* Need to intersect the bits in the /16.  The loop
+                 * has no branches so the compiler may vectorize it */
                 for (j = 0; j < SKIP_BBLOCK_SIZE; ++j) {
-                    result_ipset->nodes[i]->addressBlock[j] &=
-                        ipset->nodes[i]->addressBlock[j];
-                    nonzero = nonzero ||
-                              result_ipset->nodes[i]->addressBlock[j];
+                    dst[j] &= src[j];
+                    nonzero |= dst[j];
                 }
                 if (!nonzero) {
                     free(result_ipset->nodes[i]);
@@ -840,12 +841,14 @@ skIPTreeSubtract(
 
     for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
         if ((result_ipset->nodes[i] != NULL) && (ipset->nodes[i] != NULL)) {
-            int nonzero = 0;
-            /* Need to intersect with the complement in the /16 */
+            uint32_t *dst = result_ipset->nodes[i]->addressBlock;
+            const uint32_t *src = ipset->nodes[i]->addressBlock;
+            uint32_t nonzero = 0;
+            /* Need to intersect with the complement in the /16.  The
+             * loop has no branches so the compiler may vectorize it */
             for (j = 0; j < SKIP_BBLOCK_SIZE; ++j) {
-                result_ipset->nodes[i]->addressBlock[j] &=
-                    ~(ipset->nodes[i]->addressBlock[j]);
-                nonzero = nonzero || result_ipset->nodes[i]->addressBlock[j];
+                dst[j] &= ~src[j];
+                nonzero |= dst[j];
             }
             if (!nonzero) {
                 free(result_ipset->nodes[i]);
@@ -868,10 +871,11 @@ skIPTreeUnion(
     for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
         if (NULL != ipset->nodes[i]) {
             if (NULL != result_ipset->nodes[i]) {
+                uint32_t *dst = result_ipset->nodes[i]->addressBlock;
+                const uint32_t *src = ipset->nodes[i]->addressBlock;
                 /* need to merge */
                 for (j = 0; j < SKIP_BBLOCK_SIZE; ++j) {
-                    result_ipset->nodes[i]->addressBlock[j] |=
-                        ipset->nodes[i]->addressBlock[j];
+                    dst[j] |= src[j];
                 }
             } else {
                 /* copy block from ipset to result_ipset */
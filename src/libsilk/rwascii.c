@@ -826,6 +826,31 @@ rwAsciiSetNoFinalDelimiter(
 }
 
 
+uint32_t
+rwAsciiGetColumns(
+    const rwAsciiStream_t  *astream)
+{
+    uint32_t columns = 0;
+    uint32_t i;
+
+    /* when no fields were given, every field is printed */
+    if (0 == astream->as_field_count) {
+        return SK_COLUMN_ALL;
+    }
+
+    /* callback fields use SK_COLUMN_ALL since they may examine any
+     * field of the record */
+    for (i = 0; i < astream->as_field_count; ++i) {
+        columns |= skStreamGetColumnsForField(astream->as_field[i].af_field_id);
+    }
+    /* rwAsciiVerifyIcmpColumns() may add the sPort and dPort */
+    if (astream->as_legacy_icmp) {
+        columns |= SK_COLUMN_SPORT | SK_COLUMN_DPORT | SK_COLUMN_PROTO;
+    }
+    return columns;
+}
+
+
 void
 rwAsciiGetFieldName(
     char                       *buf,
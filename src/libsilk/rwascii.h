@@ -457,6 +457,17 @@ void
 rwAsciiSetIcmpTypeCode(
     rwAsciiStream_t    *astream);
 
+/**
+ *    Return the bitwise OR of the SK_COLUMN_* values (see
+ *    skstream.h) that hold the fields 'astream' prints, suitable for
+ *    passing to skStreamSetColumnProjection().  Return SK_COLUMN_ALL
+ *    when no fields have been set or when a field is printed by a
+ *    callback function.
+ */
+uint32_t
+rwAsciiGetColumns(
+    const rwAsciiStream_t  *astream);
+
 /**
  *    Put the first 'buf_len'-1 characters of the name of the
  *    field/column denoted by 'field_id' into the buffer 'buf'.  The
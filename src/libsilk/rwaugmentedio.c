@@ -514,6 +514,26 @@ augmentedioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(augmentedioRecordUnpackBatch_V5,
+                           augmentedioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(augmentedioRecordUnpackBatch_V4,
+                           augmentedioRecordUnpack_V4)
+STREAM_DEFINE_UNPACK_BATCH(augmentedioRecordUnpackBatch_V1,
+                           augmentedioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(augmentedioRecordPackBatch_V5,
+                         augmentedioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(augmentedioRecordPackBatch_V4,
+                         augmentedioRecordPack_V4)
+STREAM_DEFINE_PACK_BATCH(augmentedioRecordPackBatch_V1,
+                         augmentedioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -571,10 +591,14 @@ augmentedioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &augmentedioRecordUnpack_V5;
         rwIOS->rwPackFn   = &augmentedioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &augmentedioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &augmentedioRecordPackBatch_V5;
         break;
       case 4:
         rwIOS->rwUnpackFn = &augmentedioRecordUnpack_V4;
         rwIOS->rwPackFn   = &augmentedioRecordPack_V4;
+        rwIOS->rwUnpackBatchFn = &augmentedioRecordUnpackBatch_V4;
+        rwIOS->rwPackBatchFn   = &augmentedioRecordPackBatch_V4;
         break;
       case 3:
       case 2:
@@ -584,6 +608,8 @@ augmentedioPrepare(
          * read and write; V2 supports compression only on read */
         rwIOS->rwUnpackFn = &augmentedioRecordUnpack_V1;
         rwIOS->rwPackFn   = &augmentedioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &augmentedioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &augmentedioRecordPackBatch_V1;
         break;
       case 0:
       default:
@@ -573,6 +573,26 @@ augroutingioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(augroutingioRecordUnpackBatch_V5,
+                           augroutingioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(augroutingioRecordUnpackBatch_V4,
+                           augroutingioRecordUnpack_V4)
+STREAM_DEFINE_UNPACK_BATCH(augroutingioRecordUnpackBatch_V1,
+                           augroutingioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(augroutingioRecordPackBatch_V5,
+                         augroutingioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(augroutingioRecordPackBatch_V4,
+                         augroutingioRecordPack_V4)
+STREAM_DEFINE_PACK_BATCH(augroutingioRecordPackBatch_V1,
+                         augroutingioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -630,10 +650,14 @@ augroutingioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &augroutingioRecordUnpack_V5;
         rwIOS->rwPackFn   = &augroutingioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &augroutingioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &augroutingioRecordPackBatch_V5;
         break;
       case 4:
         rwIOS->rwUnpackFn = &augroutingioRecordUnpack_V4;
         rwIOS->rwPackFn   = &augroutingioRecordPack_V4;
+        rwIOS->rwUnpackBatchFn = &augroutingioRecordUnpackBatch_V4;
+        rwIOS->rwPackBatchFn   = &augroutingioRecordPackBatch_V4;
         break;
       case 3:
       case 2:
@@ -643,6 +667,8 @@ augroutingioPrepare(
          * read and write; V2 supports compression only on read */
         rwIOS->rwUnpackFn = &augroutingioRecordUnpack_V1;
         rwIOS->rwPackFn   = &augroutingioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &augroutingioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &augroutingioRecordPackBatch_V1;
         break;
       case 0:
       default:
@@ -542,6 +542,26 @@ augsnmpoutioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(augsnmpoutioRecordUnpackBatch_V5,
+                           augsnmpoutioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(augsnmpoutioRecordUnpackBatch_V4,
+                           augsnmpoutioRecordUnpack_V4)
+STREAM_DEFINE_UNPACK_BATCH(augsnmpoutioRecordUnpackBatch_V1,
+                           augsnmpoutioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(augsnmpoutioRecordPackBatch_V5,
+                         augsnmpoutioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(augsnmpoutioRecordPackBatch_V4,
+                         augsnmpoutioRecordPack_V4)
+STREAM_DEFINE_PACK_BATCH(augsnmpoutioRecordPackBatch_V1,
+                         augsnmpoutioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -599,10 +619,14 @@ augsnmpoutioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &augsnmpoutioRecordUnpack_V5;
         rwIOS->rwPackFn   = &augsnmpoutioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &augsnmpoutioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &augsnmpoutioRecordPackBatch_V5;
         break;
       case 4:
         rwIOS->rwUnpackFn = &augsnmpoutioRecordUnpack_V4;
         rwIOS->rwPackFn   = &augsnmpoutioRecordPack_V4;
+        rwIOS->rwUnpackBatchFn = &augsnmpoutioRecordUnpackBatch_V4;
+        rwIOS->rwPackBatchFn   = &augsnmpoutioRecordPackBatch_V4;
         break;
       case 3:
       case 2:
@@ -612,6 +636,8 @@ augsnmpoutioPrepare(
          * read and write; V2 supports compression only on read */
         rwIOS->rwUnpackFn = &augsnmpoutioRecordUnpack_V1;
         rwIOS->rwPackFn   = &augsnmpoutioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &augsnmpoutioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &augsnmpoutioRecordPackBatch_V1;
         break;
       case 0:
       default:
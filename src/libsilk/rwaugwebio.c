@@ -637,6 +637,26 @@ augwebioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(augwebioRecordUnpackBatch_V5,
+                           augwebioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(augwebioRecordUnpackBatch_V4,
+                           augwebioRecordUnpack_V4)
+STREAM_DEFINE_UNPACK_BATCH(augwebioRecordUnpackBatch_V1,
+                           augwebioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(augwebioRecordPackBatch_V5,
+                         augwebioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(augwebioRecordPackBatch_V4,
+                         augwebioRecordPack_V4)
+STREAM_DEFINE_PACK_BATCH(augwebioRecordPackBatch_V1,
+                         augwebioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -694,10 +714,14 @@ augwebioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &augwebioRecordUnpack_V5;
         rwIOS->rwPackFn   = &augwebioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &augwebioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &augwebioRecordPackBatch_V5;
         break;
       case 4:
         rwIOS->rwUnpackFn = &augwebioRecordUnpack_V4;
         rwIOS->rwPackFn   = &augwebioRecordPack_V4;
+        rwIOS->rwUnpackBatchFn = &augwebioRecordUnpackBatch_V4;
+        rwIOS->rwPackBatchFn   = &augwebioRecordPackBatch_V4;
         break;
       case 3:
       case 2:
@@ -707,6 +731,8 @@ augwebioPrepare(
          * read and write; V2 supports compression only on read */
         rwIOS->rwUnpackFn = &augwebioRecordUnpack_V1;
         rwIOS->rwPackFn   = &augwebioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &augwebioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &augwebioRecordPackBatch_V1;
         break;
       case 0:
       default:
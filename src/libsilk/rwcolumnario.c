@@ -0,0 +1,1284 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwcolumnario.c
+**
+**    Routines to read and write FT_RWCOLUMNAR records.
+**
+**    Unlike the other record formats, an FT_RWCOLUMNAR file does not
+**    hold fixed-length records.  The records are stored in groups of
+**    up to COLUMNAR_GROUP_SIZE records, and each group stores the
+**    values of each field in a separate column:
+**
+**      group header        8 bytes
+**      column directory    8 bytes per column
+**      column 1 data       length given in directory
+**      ...
+**      column N data
+**
+**    When the stream uses an IOBuf, the group header plus directory
+**    and each column end a compressed block, so every column is
+**    compressed on its own and a reader can step over a column
+**    without reading or uncompressing it.  See
+**    skStreamSetColumnProjection().
+**
+**    IP addresses are in network byte order; all other values are
+**    little endian regardless of the byte order in the file's header.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwcolumnario.c $");
+
+#include "skstream_priv.h"
+
+
+/* Version to use when SK_RECORD_VERSION_ANY is specified */
+#define DEFAULT_RECORD_VERSION 1
+
+/* Maximum number of records in a group */
+#define COLUMNAR_GROUP_SIZE     8192
+
+/*
+ *    Upper bound on the number of encoded bytes per record: the
+ *    IPv6 flag, three IPv6 addresses, a varint start time delta,
+ *    three varints, 4 bytes of flags, the protocol and flowtype, and
+ *    six 2-byte values.  Dictionary encoding is only used when it is
+ *    smaller than the raw values.
+ */
+#define COLUMNAR_MAX_RECLEN     (1 + 48 + 10 + 15 + 4 + 2 + 12)
+
+/* Size of the group header and of a column's directory entry */
+#define COLUMNAR_HEADER_LEN     8
+#define COLUMNAR_DIRENT_LEN     8
+
+/* Number of user-visible columns; the column ID is the bit position
+ * of its SK_COLUMN_* value */
+#define COLUMNAR_NUM_COLUMNS    17
+
+/* ID of the internal column holding the IPv6 flag of each record;
+ * it is present only in groups that have the COLUMNAR_FLAG_IPV6 flag
+ * and is always the first column of those groups */
+#define COLUMNAR_COL_IPV6       31
+
+/* Group flag set when the IP addresses are 16 bytes */
+#define COLUMNAR_FLAG_IPV6      0x01
+
+/* Column encodings */
+#define COLUMNAR_ENC_RAW        0
+#define COLUMNAR_ENC_DICT       1
+#define COLUMNAR_ENC_DELTA      2
+#define COLUMNAR_ENC_VARINT     3
+
+/* Maximum number of values in a dictionary-encoded column */
+#define COLUMNAR_DICT_MAX       256
+
+
+/* One entry in a group's column directory */
+typedef struct columnar_dirent_st {
+    uint32_t    len;
+    uint8_t     id;
+    uint8_t     encoding;
+} columnar_dirent_t;
+
+
+struct sk_stream_columnar_st {
+    /* the records of the current group; when writing, the records
+     * waiting to be written; when reading, the decoded records */
+    rwRec              *recs;
+    /* when reading, whether each record in 'recs' is IPv6 */
+    uint8_t            *is_ipv6;
+    /* buffer to hold encoded column data */
+    uint8_t            *buf;
+    size_t              buf_size;
+    /* temporary values while encoding a column */
+    uint16_t           *vals16;
+    /* when encoding a dictionary, the index of each value plus 1 */
+    uint16_t           *dict_index;
+    /* number of records in 'recs' */
+    uint32_t            count;
+    /* when reading, the index of the next record to return */
+    uint32_t            pos;
+    /* when reading, the columns to decode */
+    uint32_t            columns;
+    /* when reading, the directory of the group being read */
+    columnar_dirent_t   dir[COLUMNAR_NUM_COLUMNS + 1];
+    uint32_t            grp_count;
+    uint8_t             grp_columns;
+    uint8_t             grp_flags;
+};
+
+
+/* ********************************************************************* */
+
+/*
+ *    Helpers to store and fetch little-endian values.
+ */
+static void
+columnarPutU16(
+    uint8_t            *ar,
+    uint16_t            v)
+{
+    ar[0] = (uint8_t)v;
+    ar[1] = (uint8_t)(v >> 8);
+}
+
+static void
+columnarPutU32(
+    uint8_t            *ar,
+    uint32_t            v)
+{
+    ar[0] = (uint8_t)v;
+    ar[1] = (uint8_t)(v >> 8);
+    ar[2] = (uint8_t)(v >> 16);
+    ar[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t
+columnarGetU16(
+    const uint8_t      *ar)
+{
+    return (uint16_t)(ar[0] | (ar[1] << 8));
+}
+
+static uint32_t
+columnarGetU32(
+    const uint8_t      *ar)
+{
+    return ((uint32_t)ar[0] | ((uint32_t)ar[1] << 8)
+            | ((uint32_t)ar[2] << 16) | ((uint32_t)ar[3] << 24));
+}
+
+
+/*
+ *  len = columnarPutVarint(ar, v);
+ *
+ *    Store 'v' at 'ar' using 7 bits per byte with the high bit set
+ *    on all but the final byte.  Return the number of bytes used.
+ */
+static size_t
+columnarPutVarint(
+    uint8_t            *ar,
+    uint64_t            v)
+{
+    size_t len = 0;
+
+    while (v >= 0x80) {
+        ar[len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    ar[len++] = (uint8_t)v;
+    return len;
+}
+
+
+/*
+ *  ok = columnarGetVarint(&ar, end, &v);
+ *
+ *    Read the varint at '*ar', which must end before 'end', into
+ *    'v' and move '*ar' past it.  Return 0 if the varint is
+ *    malformed; 1 otherwise.
+ */
+static int
+columnarGetVarint(
+    const uint8_t     **ar,
+    const uint8_t      *end,
+    uint64_t           *v)
+{
+    const uint8_t *p = *ar;
+    unsigned int shift = 0;
+
+    *v = 0;
+    while (p < end && shift < 64) {
+        *v |= (uint64_t)(*p & 0x7F) << shift;
+        if (0 == (*p++ & 0x80)) {
+            *ar = p;
+            return 1;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+
+/* ********************************************************************* */
+
+/*
+ *  status = columnarioAllocGroup(stream);
+ *
+ *    Allocate the group buffers of 'stream' if they do not exist.
+ */
+static int
+columnarioAllocGroup(
+    skstream_t         *stream)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+
+    if (col->recs) {
+        return SKSTREAM_OK;
+    }
+    col->recs = (rwRec*)malloc(COLUMNAR_GROUP_SIZE * sizeof(rwRec));
+    col->is_ipv6 = (uint8_t*)malloc(COLUMNAR_GROUP_SIZE);
+    col->vals16 = (uint16_t*)malloc(COLUMNAR_GROUP_SIZE * sizeof(uint16_t));
+    if (!col->recs || !col->is_ipv6 || !col->vals16) {
+        free(col->recs);
+        free(col->is_ipv6);
+        free(col->vals16);
+        col->recs = NULL;
+        col->is_ipv6 = NULL;
+        col->vals16 = NULL;
+        return SKSTREAM_ERR_ALLOC;
+    }
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = columnarioGrowBuffer(col, size);
+ *
+ *    Ensure the encoding buffer of 'col' holds at least 'size'
+ *    bytes.
+ */
+static int
+columnarioGrowBuffer(
+    sk_stream_columnar_t   *col,
+    size_t                  size)
+{
+    uint8_t *b;
+
+    if (size <= col->buf_size) {
+        return SKSTREAM_OK;
+    }
+    b = (uint8_t*)realloc(col->buf, size);
+    if (NULL == b) {
+        return SKSTREAM_ERR_ALLOC;
+    }
+    col->buf = b;
+    col->buf_size = size;
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = columnarioEndBlock(stream);
+ *
+ *    When 'stream' uses an IOBuf, end its current compressed block.
+ */
+static int
+columnarioEndBlock(
+    skstream_t         *stream)
+{
+    if (stream->iobuf && skIOBufEndBlock(stream->iobuf) == -1) {
+        if (stream->is_iobuf_error) {
+            stream->is_iobuf_error = 0;
+        } else {
+            stream->err_info = SKSTREAM_ERR_IOBUF;
+        }
+        return -1;
+    }
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = columnarioWriteBytes(stream, data, len);
+ *
+ *    Write 'len' bytes of 'data' to 'stream' and end the block.
+ */
+static int
+columnarioWriteBytes(
+    skstream_t         *stream,
+    const uint8_t      *data,
+    size_t              len)
+{
+    if (len && skStreamWrite(stream, data, len) != (ssize_t)len) {
+        return -1;
+    }
+    return columnarioEndBlock(stream);
+}
+
+
+/*
+ *  status = columnarioReadBytes(stream, data, len);
+ *
+ *    Read exactly 'len' bytes from 'stream' into 'data', or skip
+ *    them when 'data' is NULL.
+ */
+static int
+columnarioReadBytes(
+    skstream_t         *stream,
+    uint8_t            *data,
+    size_t              len)
+{
+    ssize_t saw;
+
+    if (0 == len) {
+        return SKSTREAM_OK;
+    }
+    saw = skStreamRead(stream, data, len);
+    if (saw == (ssize_t)len) {
+        return SKSTREAM_OK;
+    }
+    if (-1 == saw) {
+        return (stream->iobuf ? SKSTREAM_ERR_IOBUF : -1);
+    }
+    stream->errobj.num = saw;
+    return SKSTREAM_ERR_READ_SHORT;
+}
+
+
+/* ********************************************************************* */
+
+/*
+ *  len = columnarioEncodeU16(col, count, out, &encoding);
+ *
+ *    Encode the 'count' values in col->vals16 into 'out' using a
+ *    dictionary when there are few distinct values, or as raw
+ *    values otherwise.  Return the number of bytes used.
+ */
+static size_t
+columnarioEncodeU16(
+    sk_stream_columnar_t   *col,
+    uint32_t                count,
+    uint8_t                *out,
+    uint8_t                *encoding)
+{
+    uint16_t dict[COLUMNAR_DICT_MAX];
+    uint32_t ndict = 0;
+    uint32_t i;
+    size_t len;
+
+    if (NULL == col->dict_index) {
+        col->dict_index = (uint16_t*)calloc(1u << 16, sizeof(uint16_t));
+    }
+
+    if (col->dict_index) {
+        /* find the distinct values, giving up when there are too
+         * many to be worth a dictionary */
+        for (i = 0; i < count; ++i) {
+            if (0 == col->dict_index[col->vals16[i]]) {
+                if (ndict == COLUMNAR_DICT_MAX) {
+                    break;
+                }
+                dict[ndict++] = col->vals16[i];
+                col->dict_index[col->vals16[i]] = (uint16_t)ndict;
+            }
+        }
+        if (i == count && 2 + 2 * ndict + count < 2 * count) {
+            *encoding = COLUMNAR_ENC_DICT;
+            columnarPutU16(out, (uint16_t)ndict);
+            len = 2;
+            for (i = 0; i < ndict; ++i, len += 2) {
+                columnarPutU16(out + len, dict[i]);
+            }
+            for (i = 0; i < count; ++i) {
+                out[len++] = (uint8_t)(col->dict_index[col->vals16[i]] - 1);
+            }
+        } else {
+            len = 0;
+        }
+        for (i = 0; i < ndict; ++i) {
+            col->dict_index[dict[i]] = 0;
+        }
+        if (len) {
+            return len;
+        }
+    }
+
+    *encoding = COLUMNAR_ENC_RAW;
+    for (i = 0, len = 0; i < count; ++i, len += 2) {
+        columnarPutU16(out + len, col->vals16[i]);
+    }
+    return len;
+}
+
+
+/*
+ *  ok = columnarioDecodeU16(col, count, data, len, encoding);
+ *
+ *    Decode the 'count' values in the 'len' bytes of 'data' into
+ *    col->vals16.  Return 0 if the data is malformed.
+ */
+static int
+columnarioDecodeU16(
+    sk_stream_columnar_t   *col,
+    uint32_t                count,
+    const uint8_t          *data,
+    size_t                  len,
+    uint8_t                 encoding)
+{
+    uint16_t dict[COLUMNAR_DICT_MAX];
+    uint32_t ndict;
+    uint32_t i;
+
+    switch (encoding) {
+      case COLUMNAR_ENC_RAW:
+        if (len != 2 * (size_t)count) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, data += 2) {
+            col->vals16[i] = columnarGetU16(data);
+        }
+        return 1;
+
+      case COLUMNAR_ENC_DICT:
+        if (len < 2) {
+            return 0;
+        }
+        ndict = columnarGetU16(data);
+        if (0 == ndict || ndict > COLUMNAR_DICT_MAX
+            || len != 2 + 2 * (size_t)ndict + count)
+        {
+            return 0;
+        }
+        for (i = 0; i < ndict; ++i) {
+            dict[i] = columnarGetU16(data + 2 + 2 * i);
+        }
+        data += 2 + 2 * ndict;
+        for (i = 0; i < count; ++i) {
+            if (data[i] >= ndict) {
+                return 0;
+            }
+            col->vals16[i] = dict[data[i]];
+        }
+        return 1;
+
+      default:
+        return 0;
+    }
+}
+
+
+/*
+ *  len = columnarioEncodeColumn(stream, id, ipv6, out, &encoding);
+ *
+ *    Encode the column 'id' of the pending records of 'stream' into
+ *    'out', writing 16-byte IP addresses when 'ipv6' is non-zero.
+ *    Return the number of bytes used.
+ */
+static size_t
+columnarioEncodeColumn(
+    skstream_t         *stream,
+    uint8_t             id,
+    int                 ipv6,
+    uint8_t            *out,
+    uint8_t            *encoding)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    const rwRec *r = col->recs;
+    const rwRec *end = col->recs + col->count;
+    uint8_t *p = out;
+    uint16_t *v16 = col->vals16;
+    uint32_t ip;
+    sktime_t prev;
+
+    *encoding = COLUMNAR_ENC_RAW;
+
+    switch (id) {
+      case COLUMNAR_COL_IPV6:
+        for ( ; r < end; ++r) {
+            *p++ = (uint8_t)rwRecIsIPv6(r);
+        }
+        break;
+
+      case 0:
+      case 1:
+      case 2:
+        for ( ; r < end; ++r) {
+#if SK_ENABLE_IPV6
+            if (ipv6) {
+                switch (id) {
+                  case 0: rwRecMemGetSIPv6(r, p);  break;
+                  case 1: rwRecMemGetDIPv6(r, p);  break;
+                  default: rwRecMemGetNhIPv6(r, p); break;
+                }
+                p += 16;
+                continue;
+            }
+#endif  /* SK_ENABLE_IPV6 */
+            switch (id) {
+              case 0: ip = rwRecGetSIPv4(r);  break;
+              case 1: ip = rwRecGetDIPv4(r);  break;
+              default: ip = rwRecGetNhIPv4(r); break;
+            }
+            *p++ = (uint8_t)(ip >> 24);
+            *p++ = (uint8_t)(ip >> 16);
+            *p++ = (uint8_t)(ip >> 8);
+            *p++ = (uint8_t)ip;
+        }
+        (void)ipv6;
+        break;
+
+      case 5:
+        for ( ; r < end; ++r) {
+            *p++ = rwRecGetProto(r);
+        }
+        break;
+
+      case 6:
+      case 7:
+      case 10:
+        *encoding = COLUMNAR_ENC_VARINT;
+        for ( ; r < end; ++r) {
+            p += columnarPutVarint(p, ((6 == id) ? rwRecGetPkts(r)
+                                       : ((7 == id) ? rwRecGetBytes(r)
+                                          : rwRecGetElapsed(r))));
+        }
+        break;
+
+      case 8:
+        for ( ; r < end; ++r) {
+            *p++ = rwRecGetFlags(r);
+            *p++ = rwRecGetInitFlags(r);
+            *p++ = rwRecGetRestFlags(r);
+            *p++ = rwRecGetTcpState(r);
+        }
+        break;
+
+      case 9:
+        /* zigzag-encoded difference from the previous start time */
+        *encoding = COLUMNAR_ENC_DELTA;
+        for (prev = 0; r < end; ++r) {
+            uint64_t d = ((uint64_t)rwRecGetStartTime(r) - (uint64_t)prev);
+            p += columnarPutVarint(p, ((d << 1)
+                                       ^ (uint64_t)((int64_t)d >> 63)));
+            prev = rwRecGetStartTime(r);
+        }
+        break;
+
+      case 12:
+        for ( ; r < end; ++r) {
+            *p++ = rwRecGetFlowType(r);
+        }
+        break;
+
+      default:
+        /* the 2-byte columns */
+        for ( ; r < end; ++r, ++v16) {
+            switch (id) {
+              case 3:  *v16 = rwRecGetSPort(r);       break;
+              case 4:  *v16 = rwRecGetDPort(r);       break;
+              case 11: *v16 = rwRecGetSensor(r);      break;
+              case 13: *v16 = rwRecGetInput(r);       break;
+              case 14: *v16 = rwRecGetOutput(r);      break;
+              case 15: *v16 = rwRecGetApplication(r); break;
+              default: *v16 = rwRecGetMemo(r);        break;
+            }
+        }
+        return columnarioEncodeU16(col, col->count, out, encoding);
+    }
+
+    return (p - out);
+}
+
+
+/*
+ *  ok = columnarioDecodeColumn(stream, ent, data);
+ *
+ *    Decode the column described by 'ent' whose bytes are in 'data'
+ *    into the records of the current group.  Return 0 if the data
+ *    is malformed.
+ */
+static int
+columnarioDecodeColumn(
+    skstream_t                 *stream,
+    const columnar_dirent_t    *ent,
+    const uint8_t              *data)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    const uint32_t count = col->grp_count;
+    const uint8_t *end = data + ent->len;
+    rwRec *r = col->recs;
+    uint32_t i;
+    uint32_t ip;
+    uint64_t v;
+    sktime_t prev;
+
+    switch (ent->id) {
+      case COLUMNAR_COL_IPV6:
+        if (ent->encoding != COLUMNAR_ENC_RAW || ent->len != count) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, ++r) {
+            col->is_ipv6[i] = (data[i] ? 1 : 0);
+#if SK_ENABLE_IPV6
+            if (data[i]) {
+                rwRecSetIPv6(r);
+            }
+#endif
+        }
+        return 1;
+
+      case 0:
+      case 1:
+      case 2:
+        if (ent->encoding != COLUMNAR_ENC_RAW) {
+            return 0;
+        }
+        if (0 == (col->grp_flags & COLUMNAR_FLAG_IPV6)) {
+            if (ent->len != 4 * count) {
+                return 0;
+            }
+            for (i = 0; i < count; ++i, ++r, data += 4) {
+                ip = (((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+                      | ((uint32_t)data[2] << 8) | data[3]);
+                switch (ent->id) {
+                  case 0: rwRecSetSIPv4(r, ip);  break;
+                  case 1: rwRecSetDIPv4(r, ip);  break;
+                  default: rwRecSetNhIPv4(r, ip); break;
+                }
+            }
+            return 1;
+        }
+        if (ent->len != 16 * count) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, ++r, data += 16) {
+#if SK_ENABLE_IPV6
+            if (col->is_ipv6[i]) {
+                switch (ent->id) {
+                  case 0: rwRecMemSetSIPv6(r, data);  break;
+                  case 1: rwRecMemSetDIPv6(r, data);  break;
+                  default: rwRecMemSetNhIPv6(r, data); break;
+                }
+                continue;
+            }
+#endif  /* SK_ENABLE_IPV6 */
+            ip = (((uint32_t)data[12] << 24) | ((uint32_t)data[13] << 16)
+                  | ((uint32_t)data[14] << 8) | data[15]);
+            switch (ent->id) {
+              case 0: rwRecSetSIPv4(r, ip);  break;
+              case 1: rwRecSetDIPv4(r, ip);  break;
+              default: rwRecSetNhIPv4(r, ip); break;
+            }
+        }
+        return 1;
+
+      case 5:
+      case 12:
+        if (ent->encoding != COLUMNAR_ENC_RAW || ent->len != count) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, ++r) {
+            if (5 == ent->id) {
+                rwRecSetProto(r, data[i]);
+            } else {
+                rwRecSetFlowType(r, data[i]);
+            }
+        }
+        return 1;
+
+      case 6:
+      case 7:
+      case 10:
+        if (ent->encoding != COLUMNAR_ENC_VARINT) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, ++r) {
+            if (!columnarGetVarint(&data, end, &v) || v > UINT32_MAX) {
+                return 0;
+            }
+            switch (ent->id) {
+              case 6: rwRecSetPkts(r, (uint32_t)v);    break;
+              case 7: rwRecSetBytes(r, (uint32_t)v);   break;
+              default: rwRecSetElapsed(r, (uint32_t)v); break;
+            }
+        }
+        return (data == end);
+
+      case 8:
+        if (ent->encoding != COLUMNAR_ENC_RAW || ent->len != 4 * count) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, ++r, data += 4) {
+            rwRecSetFlags(r, data[0]);
+            rwRecSetInitFlags(r, data[1]);
+            rwRecSetRestFlags(r, data[2]);
+            rwRecSetTcpState(r, data[3]);
+        }
+        return 1;
+
+      case 9:
+        if (ent->encoding != COLUMNAR_ENC_DELTA) {
+            return 0;
+        }
+        for (i = 0, prev = 0; i < count; ++i, ++r) {
+            if (!columnarGetVarint(&data, end, &v)) {
+                return 0;
+            }
+            v = (v >> 1) ^ (~(v & 1) + 1);
+            prev = (sktime_t)((uint64_t)prev + v);
+            rwRecSetStartTime(r, prev);
+        }
+        return (data == end);
+
+      case 3:
+      case 4:
+      case 11:
+      case 13:
+      case 14:
+      case 15:
+      case 16:
+        if (!columnarioDecodeU16(col, count, data, ent->len, ent->encoding)) {
+            return 0;
+        }
+        for (i = 0; i < count; ++i, ++r) {
+            switch (ent->id) {
+              case 3:  rwRecSetSPort(r, col->vals16[i]);       break;
+              case 4:  rwRecSetDPort(r, col->vals16[i]);       break;
+              case 11: rwRecSetSensor(r, col->vals16[i]);      break;
+              case 13: rwRecSetInput(r, col->vals16[i]);       break;
+              case 14: rwRecSetOutput(r, col->vals16[i]);      break;
+              case 15: rwRecSetApplication(r, col->vals16[i]); break;
+              default: rwRecSetMemo(r, col->vals16[i]);        break;
+            }
+        }
+        return 1;
+
+      default:
+        /* unknown columns are never decoded */
+        skAbort();
+    }
+    return 0;
+}
+
+
+/* ********************************************************************* */
+
+/*
+ *  status = columnarioWriteGroup(stream);
+ *
+ *    Encode and write the pending records of 'stream' as a group.
+ */
+static int
+columnarioWriteGroup(
+    skstream_t         *stream)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    uint8_t ids[COLUMNAR_NUM_COLUMNS + 1];
+    uint8_t encodings[COLUMNAR_NUM_COLUMNS + 1];
+    size_t lens[COLUMNAR_NUM_COLUMNS + 1];
+    uint8_t head[COLUMNAR_HEADER_LEN
+                 + COLUMNAR_DIRENT_LEN * (COLUMNAR_NUM_COLUMNS + 1)];
+    uint8_t *out;
+    unsigned int ncols = 0;
+    unsigned int i;
+    int ipv6 = 0;
+    int rv;
+
+    if (0 == col->count) {
+        return SKSTREAM_OK;
+    }
+
+    rv = columnarioGrowBuffer(col, ((size_t)COLUMNAR_GROUP_SIZE
+                                    * COLUMNAR_MAX_RECLEN));
+    if (rv) {
+        return rv;
+    }
+
+#if SK_ENABLE_IPV6
+    for (i = 0; i < col->count; ++i) {
+        if (rwRecIsIPv6(&col->recs[i])) {
+            ipv6 = 1;
+            ids[ncols++] = COLUMNAR_COL_IPV6;
+            break;
+        }
+    }
+#endif
+    for (i = 0; i < COLUMNAR_NUM_COLUMNS; ++i) {
+        ids[ncols++] = (uint8_t)i;
+    }
+
+    /* encode the columns one after the other into the buffer */
+    out = col->buf;
+    for (i = 0; i < ncols; ++i) {
+        lens[i] = columnarioEncodeColumn(stream, ids[i], ipv6, out,
+                                         &encodings[i]);
+        out += lens[i];
+    }
+    assert((size_t)(out - col->buf) <= col->buf_size);
+
+    /* write the header and the directory */
+    columnarPutU32(head, col->count);
+    head[4] = (uint8_t)ncols;
+    head[5] = (ipv6 ? COLUMNAR_FLAG_IPV6 : 0);
+    columnarPutU16(head + 6, 0);
+    for (i = 0; i < ncols; ++i) {
+        uint8_t *ent = head + COLUMNAR_HEADER_LEN + COLUMNAR_DIRENT_LEN * i;
+        ent[0] = ids[i];
+        ent[1] = encodings[i];
+        columnarPutU16(ent + 2, 0);
+        columnarPutU32(ent + 4, (uint32_t)lens[i]);
+    }
+    rv = columnarioWriteBytes(stream, head,
+                              COLUMNAR_HEADER_LEN + COLUMNAR_DIRENT_LEN*ncols);
+    if (rv) {
+        return rv;
+    }
+
+    /* write each column */
+    out = col->buf;
+    for (i = 0; i < ncols; ++i) {
+        rv = columnarioWriteBytes(stream, out, lens[i]);
+        if (rv) {
+            return rv;
+        }
+        out += lens[i];
+    }
+
+    col->count = 0;
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = columnarioReadGroupHeader(stream);
+ *
+ *    Read the header and the directory of the next group of
+ *    'stream'.  Return SKSTREAM_ERR_EOF at a clean end of file.
+ */
+static int
+columnarioReadGroupHeader(
+    skstream_t         *stream)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    uint8_t head[COLUMNAR_HEADER_LEN
+                 + COLUMNAR_DIRENT_LEN * (COLUMNAR_NUM_COLUMNS + 1)];
+    const uint8_t *ent;
+    unsigned int i;
+    ssize_t saw;
+    int rv;
+
+    saw = skStreamRead(stream, head, COLUMNAR_HEADER_LEN);
+    if (saw != COLUMNAR_HEADER_LEN) {
+        if (0 == saw) {
+            return SKSTREAM_ERR_EOF;
+        }
+        if (-1 == saw) {
+            return (stream->iobuf ? SKSTREAM_ERR_IOBUF : -1);
+        }
+        stream->errobj.num = saw;
+        return SKSTREAM_ERR_READ_SHORT;
+    }
+
+    col->grp_count = columnarGetU32(head);
+    col->grp_columns = head[4];
+    col->grp_flags = head[5];
+    if (0 == col->grp_count || col->grp_count > COLUMNAR_GROUP_SIZE
+        || col->grp_columns > COLUMNAR_NUM_COLUMNS + 1)
+    {
+        return SKSTREAM_ERR_BAD_COLUMNS;
+    }
+
+    rv = columnarioReadBytes(stream, head + COLUMNAR_HEADER_LEN,
+                             COLUMNAR_DIRENT_LEN * col->grp_columns);
+    if (rv) {
+        return rv;
+    }
+    for (i = 0; i < col->grp_columns; ++i) {
+        ent = head + COLUMNAR_HEADER_LEN + COLUMNAR_DIRENT_LEN * i;
+        col->dir[i].id = ent[0];
+        col->dir[i].encoding = ent[1];
+        col->dir[i].len = columnarGetU32(ent + 4);
+        if (col->dir[i].len > col->grp_count * COLUMNAR_MAX_RECLEN) {
+            return SKSTREAM_ERR_BAD_COLUMNS;
+        }
+    }
+    if ((col->grp_flags & COLUMNAR_FLAG_IPV6)
+        && (0 == col->grp_columns || COLUMNAR_COL_IPV6 != col->dir[0].id))
+    {
+        return SKSTREAM_ERR_BAD_COLUMNS;
+    }
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = columnarioReadGroupColumns(stream, decode);
+ *
+ *    Read the columns of the group whose directory was just read
+ *    from 'stream'.  When 'decode' is non-zero, decode the requested
+ *    columns into the records of the group; the other columns are
+ *    skipped.  When 'decode' is zero, skip every column.
+ */
+static int
+columnarioReadGroupColumns(
+    skstream_t         *stream,
+    int                 decode)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    const columnar_dirent_t *ent;
+    uint32_t columns;
+    uint32_t i;
+    int rv;
+
+    columns = (stream->copyInputFD ? SK_COLUMN_ALL : col->columns);
+
+    if (decode) {
+        for (i = 0; i < col->grp_count; ++i) {
+            RWREC_CLEAR(&col->recs[i]);
+        }
+        memset(col->is_ipv6, 0, col->grp_count);
+    }
+
+    for (i = 0; i < col->grp_columns; ++i) {
+        ent = &col->dir[i];
+        if (!decode
+            || (COLUMNAR_COL_IPV6 != ent->id
+                && (ent->id >= COLUMNAR_NUM_COLUMNS
+                    || 0 == (columns & (UINT32_C(1) << ent->id)))))
+        {
+            rv = columnarioReadBytes(stream, NULL, ent->len);
+            if (rv) {
+                return rv;
+            }
+            continue;
+        }
+        rv = columnarioGrowBuffer(col, ent->len);
+        if (rv) {
+            return rv;
+        }
+        rv = columnarioReadBytes(stream, col->buf, ent->len);
+        if (rv) {
+            return rv;
+        }
+        if (!columnarioDecodeColumn(stream, ent, col->buf)) {
+            return SKSTREAM_ERR_BAD_COLUMNS;
+        }
+    }
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = columnarioReadGroup(stream);
+ *
+ *    Read and decode the next group of 'stream'.
+ */
+static int
+columnarioReadGroup(
+    skstream_t         *stream)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    int rv;
+
+    col->count = 0;
+    col->pos = 0;
+
+    rv = columnarioReadGroupHeader(stream);
+    if (rv) {
+        return rv;
+    }
+    rv = columnarioReadGroupColumns(stream, 1);
+    if (rv) {
+        return rv;
+    }
+    col->count = col->grp_count;
+
+#if !SK_ENABLE_IPV6
+    /* remove the IPv6 records */
+    if (col->grp_flags & COLUMNAR_FLAG_IPV6) {
+        uint32_t i;
+        uint32_t j;
+
+        for (i = 0, j = 0; i < col->grp_count; ++i) {
+            if (!col->is_ipv6[i]) {
+                if (i != j) {
+                    RWREC_COPY(&col->recs[j], &col->recs[i]);
+                }
+                ++j;
+            }
+        }
+        col->count = j;
+    }
+#endif  /* !SK_ENABLE_IPV6 */
+
+    return SKSTREAM_OK;
+}
+
+
+/* ********************************************************************* */
+
+/*
+ *    Exported functions; see skstream_priv.h.
+ */
+
+int
+columnarioReadRecords(
+    skstream_t         *stream,
+    rwGenericRec_V5    *recs,
+    size_t              count,
+    size_t             *recs_read)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    size_t n;
+    int rv;
+
+    assert(col);
+    *recs_read = 0;
+
+    while (col->pos == col->count) {
+        rv = columnarioAllocGroup(stream);
+        if (rv) {
+            return rv;
+        }
+        rv = columnarioReadGroup(stream);
+        if (rv) {
+            return rv;
+        }
+    }
+
+    n = col->count - col->pos;
+    if (n > count) {
+        n = count;
+    }
+    memcpy(recs, &col->recs[col->pos], n * sizeof(rwRec));
+    col->pos += n;
+    *recs_read = n;
+    return SKSTREAM_OK;
+}
+
+
+int
+columnarioSkipRecords(
+    skstream_t         *stream,
+    size_t              skip_count,
+    size_t             *records_skipped)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    size_t n;
+    int rv;
+
+    assert(col);
+    *records_skipped = 0;
+
+    while (skip_count > 0) {
+        /* move over the decoded records */
+        if (col->pos < col->count) {
+            n = col->count - col->pos;
+            if (n > skip_count) {
+                n = skip_count;
+            }
+            col->pos += n;
+            skip_count -= n;
+            *records_skipped += n;
+            continue;
+        }
+
+        rv = columnarioAllocGroup(stream);
+        if (rv) {
+            return rv;
+        }
+        col->count = 0;
+        col->pos = 0;
+        rv = columnarioReadGroupHeader(stream);
+        if (rv) {
+            return rv;
+        }
+        if (col->grp_count <= skip_count) {
+            /* skip the entire group without decoding it */
+            rv = columnarioReadGroupColumns(stream, 0);
+            if (rv) {
+                return rv;
+            }
+            skip_count -= col->grp_count;
+            *records_skipped += col->grp_count;
+            continue;
+        }
+        rv = columnarioReadGroupColumns(stream, 1);
+        if (rv) {
+            return rv;
+        }
+        col->count = col->grp_count;
+    }
+    return SKSTREAM_OK;
+}
+
+
+int
+columnarioWriteRecord(
+    skstream_t             *stream,
+    const rwGenericRec_V5  *rwrec)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+    int rv;
+
+    assert(col);
+
+    rv = columnarioAllocGroup(stream);
+    if (rv) {
+        return rv;
+    }
+    RWREC_COPY(&col->recs[col->count], rwrec);
+    ++col->count;
+    if (COLUMNAR_GROUP_SIZE == col->count) {
+        return columnarioWriteGroup(stream);
+    }
+    return SKSTREAM_OK;
+}
+
+
+int
+columnarioFlush(
+    skstream_t         *stream)
+{
+    assert(stream->columnar);
+    return columnarioWriteGroup(stream);
+}
+
+
+size_t
+columnarioPendingSize(
+    const skstream_t   *stream)
+{
+    assert(stream->columnar);
+    return ((size_t)stream->columnar->count * COLUMNAR_MAX_RECLEN
+            + COLUMNAR_HEADER_LEN
+            + COLUMNAR_DIRENT_LEN * (COLUMNAR_NUM_COLUMNS + 1));
+}
+
+
+uint32_t
+columnarioGetColumns(
+    const skstream_t   *stream)
+{
+    assert(stream->columnar);
+    return stream->columnar->columns;
+}
+
+
+void
+columnarioSetColumns(
+    skstream_t         *stream,
+    uint32_t            columns)
+{
+    assert(stream->columnar);
+    stream->columnar->columns = columns;
+}
+
+
+void
+columnarioDestroy(
+    skstream_t         *stream)
+{
+    sk_stream_columnar_t *col = stream->columnar;
+
+    if (col) {
+        free(col->recs);
+        free(col->is_ipv6);
+        free(col->vals16);
+        free(col->dict_index);
+        free(col->buf);
+        free(col);
+        stream->columnar = NULL;
+    }
+}
+
+
+int
+columnarioPrepare(
+    skstream_t         *stream)
+{
+#define FILE_FORMAT "FT_RWCOLUMNAR"
+    sk_file_header_t *hdr = stream->silk_hdr;
+
+    assert(skHeaderGetFileFormat(hdr) == FT_RWCOLUMNAR);
+
+    /* Set version if none was selected by caller */
+    if ((stream->io_mode == SK_IO_WRITE)
+        && (skHeaderGetRecordVersion(hdr) == SK_RECORD_VERSION_ANY))
+    {
+        skHeaderSetRecordVersion(hdr, DEFAULT_RECORD_VERSION);
+    }
+
+    /* version check */
+    if (skHeaderGetRecordVersion(hdr) != 1) {
+        return SKSTREAM_ERR_UNSUPPORT_VERSION;
+    }
+
+    /* the records have no fixed length; the IOBuf and the header use
+     * a record length of 1 */
+    stream->recLen = 1;
+    if (stream->recLen != skHeaderGetRecordLength(hdr)) {
+        if (0 == skHeaderGetRecordLength(hdr)) {
+            skHeaderSetRecordLength(hdr, stream->recLen);
+        } else {
+            skAppPrintErr(("Record length mismatch for %s version %u\n"
+                           "\tcode = %" PRIu16 " bytes;  header = %lu bytes"),
+                          FILE_FORMAT, (unsigned)skHeaderGetRecordVersion(hdr),
+                          stream->recLen,
+                          (unsigned long)skHeaderGetRecordLength(hdr));
+            skAbort();
+        }
+    }
+
+    if (NULL == stream->columnar) {
+        stream->columnar = ((sk_stream_columnar_t*)
+                            calloc(1, sizeof(sk_stream_columnar_t)));
+        if (NULL == stream->columnar) {
+            return SKSTREAM_ERR_ALLOC;
+        }
+        stream->columnar->columns = SK_COLUMN_ALL;
+    }
+
+    return SKSTREAM_OK;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
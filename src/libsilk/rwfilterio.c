@@ -714,6 +714,26 @@ filterioRecordPack_V1V2(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(filterioRecordUnpackBatch_V4,
+                           filterioRecordUnpack_V4)
+STREAM_DEFINE_UNPACK_BATCH(filterioRecordUnpackBatch_V3,
+                           filterioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(filterioRecordUnpackBatch_V1V2,
+                           filterioRecordUnpack_V1V2)
+STREAM_DEFINE_PACK_BATCH(filterioRecordPackBatch_V4,
+                         filterioRecordPack_V4)
+STREAM_DEFINE_PACK_BATCH(filterioRecordPackBatch_V3,
+                         filterioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(filterioRecordPackBatch_V1V2,
+                         filterioRecordPack_V1V2)
+
+
 /* ********************************************************************* */
 
 /*
@@ -774,15 +794,21 @@ filterioPrepare(
          * read and write; V4 supports compression only on read */
         rwIOS->rwUnpackFn = &filterioRecordUnpack_V4;
         rwIOS->rwPackFn   = &filterioRecordPack_V4;
+        rwIOS->rwUnpackBatchFn = &filterioRecordUnpackBatch_V4;
+        rwIOS->rwPackBatchFn   = &filterioRecordPackBatch_V4;
         break;
       case 3:
         rwIOS->rwUnpackFn = &filterioRecordUnpack_V3;
         rwIOS->rwPackFn   = &filterioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &filterioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &filterioRecordPackBatch_V3;
         break;
       case 2:
       case 1:
         rwIOS->rwUnpackFn = &filterioRecordUnpack_V1V2;
         rwIOS->rwPackFn   = &filterioRecordPack_V1V2;
+        rwIOS->rwUnpackBatchFn = &filterioRecordUnpackBatch_V1V2;
+        rwIOS->rwPackBatchFn   = &filterioRecordPackBatch_V1V2;
         break;
       case 0:
         /* no longer supported */
@@ -765,6 +765,30 @@ genericioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(genericioRecordUnpackBatch_V5,
+                           genericioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(genericioRecordUnpackBatch_V3,
+                           genericioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(genericioRecordUnpackBatch_V2,
+                           genericioRecordUnpack_V2)
+STREAM_DEFINE_UNPACK_BATCH(genericioRecordUnpackBatch_V1,
+                           genericioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(genericioRecordPackBatch_V5,
+                         genericioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(genericioRecordPackBatch_V3,
+                         genericioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(genericioRecordPackBatch_V2,
+                         genericioRecordPack_V2)
+STREAM_DEFINE_PACK_BATCH(genericioRecordPackBatch_V1,
+                         genericioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -824,6 +848,8 @@ genericioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &genericioRecordUnpack_V5;
         rwIOS->rwPackFn   = &genericioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &genericioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &genericioRecordPackBatch_V5;
         break;
       case 4:
       case 3:
@@ -831,10 +857,14 @@ genericioPrepare(
          * read and write; V3 supports compression only on read */
         rwIOS->rwUnpackFn = &genericioRecordUnpack_V3;
         rwIOS->rwPackFn   = &genericioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &genericioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &genericioRecordPackBatch_V3;
         break;
       case 2:
         rwIOS->rwUnpackFn = &genericioRecordUnpack_V2;
         rwIOS->rwPackFn   = &genericioRecordPack_V2;
+        rwIOS->rwUnpackBatchFn = &genericioRecordUnpackBatch_V2;
+        rwIOS->rwPackBatchFn   = &genericioRecordPackBatch_V2;
         break;
       case 1:
       case 0:
@@ -844,6 +874,8 @@ genericioPrepare(
          * 3 bytes. */
         rwIOS->rwUnpackFn = &genericioRecordUnpack_V1;
         rwIOS->rwPackFn   = &genericioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &genericioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &genericioRecordPackBatch_V1;
         break;
       default:
         rv = SKSTREAM_ERR_UNSUPPORT_VERSION;
@@ -436,6 +436,22 @@ ipv6ioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(ipv6ioRecordUnpackBatch_V2,
+                           ipv6ioRecordUnpack_V2)
+STREAM_DEFINE_UNPACK_BATCH(ipv6ioRecordUnpackBatch_V1,
+                           ipv6ioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(ipv6ioRecordPackBatch_V2,
+                         ipv6ioRecordPack_V2)
+STREAM_DEFINE_PACK_BATCH(ipv6ioRecordPackBatch_V1,
+                         ipv6ioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -487,10 +503,14 @@ ipv6ioPrepare(
       case 2:
         rwIOS->rwUnpackFn = &ipv6ioRecordUnpack_V2;
         rwIOS->rwPackFn   = &ipv6ioRecordPack_V2;
+        rwIOS->rwUnpackBatchFn = &ipv6ioRecordUnpackBatch_V2;
+        rwIOS->rwPackBatchFn   = &ipv6ioRecordPackBatch_V2;
         break;
       case 1:
         rwIOS->rwUnpackFn = &ipv6ioRecordUnpack_V1;
         rwIOS->rwPackFn   = &ipv6ioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &ipv6ioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &ipv6ioRecordPackBatch_V1;
         break;
       case 0:
       default:
@@ -557,6 +557,24 @@ ipv6routingioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(ipv6routingioRecordUnpackBatch_V3,
+                           ipv6routingioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(ipv6routingioRecordUnpackBatch_V2,
+                           ipv6routingioRecordUnpack_V2)
+STREAM_DEFINE_UNPACK_BATCH(ipv6routingioRecordUnpackBatch_V1,
+                           ipv6routingioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(ipv6routingioRecordPackBatch_V3,
+                         ipv6routingioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(ipv6routingioRecordPackBatch_V1,
+                         ipv6routingioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -607,14 +625,20 @@ ipv6routingioPrepare(
       case 3:
         stream->rwUnpackFn = &ipv6routingioRecordUnpack_V3;
         stream->rwPackFn   = &ipv6routingioRecordPack_V3;
+        stream->rwUnpackBatchFn = &ipv6routingioRecordUnpackBatch_V3;
+        stream->rwPackBatchFn   = &ipv6routingioRecordPackBatch_V3;
         break;
       case 2:
         stream->rwUnpackFn = &ipv6routingioRecordUnpack_V2;
         stream->rwPackFn   = &ipv6routingioRecordPack_V1;
+        stream->rwUnpackBatchFn = &ipv6routingioRecordUnpackBatch_V2;
+        stream->rwPackBatchFn   = &ipv6routingioRecordPackBatch_V1;
         break;
       case 1:
         stream->rwUnpackFn = &ipv6routingioRecordUnpack_V1;
         stream->rwPackFn   = &ipv6routingioRecordPack_V1;
+        stream->rwUnpackBatchFn = &ipv6routingioRecordUnpackBatch_V1;
+        stream->rwPackBatchFn   = &ipv6routingioRecordPackBatch_V1;
         break;
       case 0:
       default:
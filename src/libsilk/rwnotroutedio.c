@@ -459,6 +459,26 @@ notroutedioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(notroutedioRecordUnpackBatch_V5,
+                           notroutedioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(notroutedioRecordUnpackBatch_V3,
+                           notroutedioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(notroutedioRecordUnpackBatch_V1,
+                           notroutedioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(notroutedioRecordPackBatch_V5,
+                         notroutedioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(notroutedioRecordPackBatch_V3,
+                         notroutedioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(notroutedioRecordPackBatch_V1,
+                         notroutedioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -516,6 +536,8 @@ notroutedioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &notroutedioRecordUnpack_V5;
         rwIOS->rwPackFn   = &notroutedioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &notroutedioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &notroutedioRecordPackBatch_V5;
         break;
       case 4:
       case 3:
@@ -523,12 +545,16 @@ notroutedioPrepare(
          * read and write; V3 supports compression only on read */
         rwIOS->rwUnpackFn = &notroutedioRecordUnpack_V3;
         rwIOS->rwPackFn   = &notroutedioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &notroutedioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &notroutedioRecordPackBatch_V3;
         break;
       case 2:
       case 1:
         /* V1 and V2 differ only in the padding of the header */
         rwIOS->rwUnpackFn = &notroutedioRecordUnpack_V1;
         rwIOS->rwPackFn   = &notroutedioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &notroutedioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &notroutedioRecordPackBatch_V1;
         break;
       case 0:
       default:
@@ -485,6 +485,26 @@ routedioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(routedioRecordUnpackBatch_V5,
+                           routedioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(routedioRecordUnpackBatch_V3,
+                           routedioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(routedioRecordUnpackBatch_V1,
+                           routedioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(routedioRecordPackBatch_V5,
+                         routedioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(routedioRecordPackBatch_V3,
+                         routedioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(routedioRecordPackBatch_V1,
+                         routedioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -542,6 +562,8 @@ routedioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &routedioRecordUnpack_V5;
         rwIOS->rwPackFn   = &routedioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &routedioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &routedioRecordPackBatch_V5;
         break;
       case 4:
       case 3:
@@ -549,12 +571,16 @@ routedioPrepare(
          * read and write; V3 supports compression only on read */
         rwIOS->rwUnpackFn = &routedioRecordUnpack_V3;
         rwIOS->rwPackFn   = &routedioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &routedioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &routedioRecordPackBatch_V3;
         break;
       case 2:
       case 1:
         /* V1 and V2 differ only in the padding of the header */
         rwIOS->rwUnpackFn = &routedioRecordUnpack_V1;
         rwIOS->rwPackFn   = &routedioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &routedioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &routedioRecordPackBatch_V1;
         break;
       case 0:
       default:
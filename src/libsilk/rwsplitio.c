@@ -436,6 +436,26 @@ splitioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(splitioRecordUnpackBatch_V5,
+                           splitioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(splitioRecordUnpackBatch_V3,
+                           splitioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(splitioRecordUnpackBatch_V1,
+                           splitioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(splitioRecordPackBatch_V5,
+                         splitioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(splitioRecordPackBatch_V3,
+                         splitioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(splitioRecordPackBatch_V1,
+                         splitioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -493,6 +513,8 @@ splitioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &splitioRecordUnpack_V5;
         rwIOS->rwPackFn   = &splitioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &splitioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &splitioRecordPackBatch_V5;
         break;
       case 4:
       case 3:
@@ -500,12 +522,16 @@ splitioPrepare(
          * read and write; V3 supports compression only on read */
         rwIOS->rwUnpackFn = &splitioRecordUnpack_V3;
         rwIOS->rwPackFn   = &splitioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &splitioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &splitioRecordPackBatch_V3;
         break;
       case 2:
       case 1:
         /* V1 and V2 differ only in the padding of the header */
         rwIOS->rwUnpackFn = &splitioRecordUnpack_V1;
         rwIOS->rwPackFn   = &splitioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &splitioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &splitioRecordPackBatch_V1;
         break;
       case 0:
       default:
@@ -574,6 +574,26 @@ wwwioRecordPack_V1(
 }
 
 
+/* ********************************************************************* */
+
+/*
+ *    Unpack and pack arrays of records for each version.
+ */
+
+STREAM_DEFINE_UNPACK_BATCH(wwwioRecordUnpackBatch_V5,
+                           wwwioRecordUnpack_V5)
+STREAM_DEFINE_UNPACK_BATCH(wwwioRecordUnpackBatch_V3,
+                           wwwioRecordUnpack_V3)
+STREAM_DEFINE_UNPACK_BATCH(wwwioRecordUnpackBatch_V1,
+                           wwwioRecordUnpack_V1)
+STREAM_DEFINE_PACK_BATCH(wwwioRecordPackBatch_V5,
+                         wwwioRecordPack_V5)
+STREAM_DEFINE_PACK_BATCH(wwwioRecordPackBatch_V3,
+                         wwwioRecordPack_V3)
+STREAM_DEFINE_PACK_BATCH(wwwioRecordPackBatch_V1,
+                         wwwioRecordPack_V1)
+
+
 /* ********************************************************************* */
 
 /*
@@ -631,6 +651,8 @@ wwwioPrepare(
       case 5:
         rwIOS->rwUnpackFn = &wwwioRecordUnpack_V5;
         rwIOS->rwPackFn   = &wwwioRecordPack_V5;
+        rwIOS->rwUnpackBatchFn = &wwwioRecordUnpackBatch_V5;
+        rwIOS->rwPackBatchFn   = &wwwioRecordPackBatch_V5;
         break;
       case 4:
       case 3:
@@ -638,12 +660,16 @@ wwwioPrepare(
          * read and write; V3 supports compression only on read */
         rwIOS->rwUnpackFn = &wwwioRecordUnpack_V3;
         rwIOS->rwPackFn   = &wwwioRecordPack_V3;
+        rwIOS->rwUnpackBatchFn = &wwwioRecordUnpackBatch_V3;
+        rwIOS->rwPackBatchFn   = &wwwioRecordPackBatch_V3;
         break;
       case 2:
       case 1:
         /* V1 and V2 differ only in the padding of the header */
         rwIOS->rwUnpackFn = &wwwioRecordUnpack_V1;
         rwIOS->rwPackFn   = &wwwioRecordPack_V1;
+        rwIOS->rwUnpackBatchFn = &wwwioRecordUnpackBatch_V1;
+        rwIOS->rwPackBatchFn   = &wwwioRecordPackBatch_V1;
         break;
       case 0:
       default:
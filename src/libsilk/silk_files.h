@@ -68,6 +68,8 @@ RCSIDENTVAR(rcsID_SILK_FILES_H, "$SiLK: silk_files.h f82f9fc3d786 2015-01-14 23:
 #define SK_COMPMETHOD_NONE      0
 #define SK_COMPMETHOD_ZLIB      1
 #define SK_COMPMETHOD_LZO1X     2
+#define SK_COMPMETHOD_LZ4       3
+#define SK_COMPMETHOD_ZSTD      4
 /* when you add a compression method, add it to the following array */
 
 #ifdef SKSITE_SOURCE
@@ -75,6 +77,8 @@ static const char *skCompressionMethods[] = {
     "none",
     "zlib",
     "lzo1x",
+    "lz4",
+    "zstd",
     ""
 };
 #endif /* SKSITE_SOURCE */
@@ -120,6 +124,9 @@ static const char *skCompressionMethods[] = {
 #define FT_RWPRINTSTATS     0x23
 #define FT_PDUFLOWCAP       0x24
 #define FT_PREFIXMAP        0x25
+#define FT_RWCOLUMNAR       0x26
+#define FT_RWTOPNSUMMARY    0x27
+#define FT_RWAGGREGATE      0x28
 /* When you add new types here; add the name to the array below. */
 
 /* old identifier names */
@@ -173,6 +180,9 @@ static const char *fileOutputFormats[] = {
     /* 0x23 */  "FT_RWPRINTSTATS",
     /* 0x24 */  "FT_PDUFLOWCAP",
     /* 0x25 */  "FT_PREFIXMAP",
+    /* 0x26 */  "FT_RWCOLUMNAR",
+    /* 0x27 */  "FT_RWTOPNSUMMARY",
+    /* 0x28 */  "FT_RWAGGREGATE",
     ""
 };
 #endif /* SKSITE_SOURCE */
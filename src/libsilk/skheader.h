@@ -1345,6 +1345,67 @@ skHentryIPSetUnpacker(
 #define skHentryIPSetGetRootIndex(hentry)       \
     (((sk_hentry_ipset_t*)(hentry))->root_idx)
 
+
+/*
+ *    **********************************************************************
+ *
+ *    The 'blockindex' header entry type is used on compressed SiLK
+ *    Flow files that end with an index of the compressed blocks in
+ *    the file.  For each block, the index holds the number of records
+ *    and the range of times, protocols, and IP addresses of the
+ *    records in the block.  Readers may use the index to skip blocks
+ *    whose records cannot match a query.  See skstream.h.
+ *
+ *    The index follows the final compressed block.  It begins with a
+ *    compressed block size of 0, which readers of the compressed
+ *    stream treat as end-of-file.  The final bytes of the file hold
+ *    the number of blocks in the index.
+ *
+ *    **********************************************************************
+ */
+
+#define SK_HENTRY_BLOCKINDEX_ID 8
+
+typedef struct sk_hentry_blockindex_st {
+    sk_header_entry_spec_t  he_spec;
+    uint32_t                version;
+} sk_hentry_blockindex_t;
+
+int
+skHeaderAddBlockindex(
+    sk_file_header_t   *hdr,
+    uint32_t            version);
+
+sk_header_entry_t *
+skHentryBlockindexCopy(
+    const sk_header_entry_t    *hentry);
+
+sk_header_entry_t *
+skHentryBlockindexCreate(
+    uint32_t            version);
+
+void
+skHentryBlockindexFree(
+    sk_header_entry_t  *hentry);
+
+ssize_t
+skHentryBlockindexPacker(
+    sk_header_entry_t  *in_hentry,
+    uint8_t            *out_packed,
+    size_t              bufsize);
+
+void
+skHentryBlockindexPrint(
+    sk_header_entry_t  *hentry,
+    FILE               *fh);
+
+sk_header_entry_t *
+skHentryBlockindexUnpacker(
+    uint8_t            *in_packed);
+
+#define skHentryBlockindexGetVersion(hentry)    \
+    (((sk_hentry_blockindex_t*)(hentry))->version)
+
 #ifdef __cplusplus
 }
 #endif
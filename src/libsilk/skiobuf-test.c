@@ -67,6 +67,9 @@ static char g_data[] =
     "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
 static int datalen;
 
+/* number of compression threads to request of each sk_iobuf_t */
+static uint32_t threads = 0;
+
 #define FAIL do {assert(0); skAbort();} while (0)
 
 
@@ -180,6 +183,11 @@ test(
         FAIL;
     }
 
+    rv = skIOBufSetThreads(buf, threads);
+    if (rv == -1) {
+        FAIL;
+    }
+
     rv = skIOBufBind(buf, fd, method);
     if (rv == -1) {
         FAIL;
@@ -223,6 +231,11 @@ test(
         FAIL;
     }
 
+    rv = skIOBufSetThreads(buf, threads);
+    if (rv == -1) {
+        FAIL;
+    }
+
     rv = skIOBufBind(buf, fd, method);
     if (rv == -1) {
         FAIL;
@@ -295,6 +308,33 @@ int main()
          0, 0);
     test(SK_COMPMETHOD_LZO1X, testfile, 10, 100000, 100, 50, 200);
 #endif
+#if SK_ENABLE_LZ4
+    test(SK_COMPMETHOD_LZ4, testfile, 10, 100000, SKIOBUF_DEFAULT_BLOCKSIZE,
+         0, 0);
+    test(SK_COMPMETHOD_LZ4, testfile, 10, 100000, 100, 50, 200);
+#endif
+#if SK_ENABLE_ZSTD
+    test(SK_COMPMETHOD_ZSTD, testfile, 10, 100000, SKIOBUF_DEFAULT_BLOCKSIZE,
+         0, 0);
+    test(SK_COMPMETHOD_ZSTD, testfile, 10, 100000, 100, 50, 200);
+#endif
+
+    /* repeat the compressed tests using the compression threads */
+    threads = 3;
+#if SK_ENABLE_ZLIB
+    test(SK_COMPMETHOD_ZLIB, testfile, 10, 100000, SKIOBUF_DEFAULT_BLOCKSIZE,
+         0, 0);
+    test(SK_COMPMETHOD_ZLIB, testfile, 10, 100000, 100, 50, 200);
+#endif
+#if SK_ENABLE_LZO
+    test(SK_COMPMETHOD_LZO1X, testfile, 10, 100000, 100, 50, 200);
+#endif
+#if SK_ENABLE_LZ4
+    test(SK_COMPMETHOD_LZ4, testfile, 10, 100000, 100, 50, 200);
+#endif
+#if SK_ENABLE_ZSTD
+    test(SK_COMPMETHOD_ZSTD, testfile, 10, 100000, 100, 50, 200);
+#endif
 
     delete_test_data(testfname, testfile, 10, 100000);
 
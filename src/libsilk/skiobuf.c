@@ -70,6 +70,12 @@ SK_DIAGNOSTIC_IGNORE_PUSH("-Wundef")
 #ifdef SK_HAVE_LZO1X_DECOMPRESS_ASM_FAST_SAFE
 #include SK_LZO_ASM_HEADER_NAME
 #endif
+#if SK_ENABLE_LZ4
+#include <lz4.h>
+#endif
+#if SK_ENABLE_ZSTD
+#include <zstd.h>
+#endif
 
 SK_DIAGNOSTIC_IGNORE_POP("-Wundef")
 
@@ -114,6 +120,15 @@ typedef union iobuf_opts_un {
     } lzo;
 #endif  /* SK_ENABLE_LZO */
 
+#if SK_ENABLE_ZSTD
+    /* zstd */
+    struct {
+        ZSTD_CCtx *cctx;
+        ZSTD_DCtx *dctx;
+        int level;
+    } zstd;
+#endif  /* SK_ENABLE_ZSTD */
+
     char nothing;        /* Just to keep the union from being empty */
 } iobuf_opts_t;
 
@@ -124,6 +139,61 @@ typedef struct compr_sizes_st {
 } compr_sizes_t;
 
 
+/* States of a block in the ring of an iobuf_pool_t */
+typedef enum {
+    SKIO_BLOCK_EMPTY,           /* Slot is unused */
+    SKIO_BLOCK_PENDING,         /* Waiting for a worker thread */
+    SKIO_BLOCK_BUSY,            /* A worker thread is processing it */
+    SKIO_BLOCK_DONE,            /* Compressed or decompressed */
+    SKIO_BLOCK_FAILED           /* Compression or decompression failed */
+} skio_block_state_t;
+
+/* A block handed to the worker threads of an iobuf_pool_t.  When
+ * writing, 'compr_buf' holds the compr_sizes_t followed by the
+ * compressed data and 'compr_size' does not include the
+ * compr_sizes_t. */
+typedef struct iobuf_block_st {
+    uint8_t            *compr_buf;
+    uint8_t            *uncompr_buf;
+    uint32_t            compr_buf_size;
+    uint32_t            uncompr_buf_size;
+    uint32_t            compr_size;
+    uint32_t            uncompr_size;
+    skio_block_state_t  state;
+} iobuf_block_t;
+
+/* The worker threads of an IO buffer and the ring of blocks they
+ * process.  The caller adds blocks at the tail of the ring and
+ * consumes them in order from the head, so the order of blocks in
+ * the file is preserved; workers take PENDING blocks in ring order.
+ * All reading and writing of the file happens on the caller's
+ * thread. */
+typedef struct iobuf_pool_st {
+    pthread_mutex_t     mutex;
+    pthread_cond_t      work_cond;      /* Signaled when work is added */
+    pthread_cond_t      done_cond;      /* Signaled when work finishes */
+    pthread_t          *threads;
+    iobuf_opts_t       *opts;           /* Per-thread compression opts */
+    uint32_t            opts_count;     /* Number of initialized opts */
+    iobuf_block_t      *blocks;
+    uint32_t            thread_count;
+    uint32_t            block_count;    /* Number of slots in ring */
+    uint32_t            head;           /* Oldest block in ring */
+    uint32_t            queued;         /* Number of blocks in ring */
+    uint32_t            next_job;       /* Next slot for a worker */
+    uint32_t            pending;        /* Number of PENDING blocks */
+    /* A read error that is reported once the ring is empty */
+    int                 read_errno;
+    unsigned            read_error : 2;
+    unsigned            read_eof   : 1;
+    unsigned            shutdown   : 1;
+} iobuf_pool_t;
+
+/* Values for iobuf_pool_t.read_error */
+#define SKIO_POOL_READ_ERR_IO        1
+#define SKIO_POOL_READ_ERR_INTERNAL  2
+
+
 /* An IO buffer. */
 struct sk_iobuf_st {
     uint8_t         compr_method;       /* Compression method */
@@ -146,7 +216,14 @@ struct sk_iobuf_st {
     void           *fd;                 /* File descriptor */
     skio_abstract_t io;                 /* IO information */
 
+    iobuf_pool_t   *pool;               /* Worker threads, if any */
+    uint32_t        thread_count;       /* Requested number of workers */
+
     off_t           total;              /* Total read or written */
+    uint64_t        blocks;             /* Number of blocks read/written */
+
+    skio_skip_fn_t  skip_fn;            /* Decides which blocks to skip */
+    void           *skip_data;          /* Data for skip_fn */
 
     int             io_errno;           /* errno of error */
     uint32_t        error_line;         /* line number of error */
@@ -295,6 +372,58 @@ lzo_uncompr_method(
 #endif  /* SK_ENABLE_LZO */
 
 
+#if SK_ENABLE_LZ4
+/* Forward declarations for lz4 methods */
+static uint32_t
+lz4_compr_size_method(
+    uint32_t            compr_size,
+    const iobuf_opts_t *opts);
+static int
+lz4_compr_method(
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen,
+    const iobuf_opts_t *opts);
+static int
+lz4_uncompr_method(
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen,
+    const iobuf_opts_t *opts);
+#endif  /* SK_ENABLE_LZ4 */
+
+
+#if SK_ENABLE_ZSTD
+/* Forward declarations for zstd methods */
+static int
+zstd_init_method(
+    iobuf_opts_t       *opts);
+static int
+zstd_uninit_method(
+    iobuf_opts_t       *opts);
+static uint32_t
+zstd_compr_size_method(
+    uint32_t            compr_size,
+    const iobuf_opts_t *opts);
+static int
+zstd_compr_method(
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen,
+    const iobuf_opts_t *opts);
+static int
+zstd_uncompr_method(
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen,
+    const iobuf_opts_t *opts);
+#endif  /* SK_ENABLE_ZSTD */
+
+
 #define SKIOBUF_METHOD_PLACEHOLDER  { NULL, NULL, NULL, NULL, NULL, 1 }
 
 static const iobuf_methods_t methods[] = {
@@ -311,14 +440,32 @@ static const iobuf_methods_t methods[] = {
 #endif  /* SK_ENABLE_ZLIB */
 
 #if  !SK_ENABLE_LZO
-    SKIOBUF_METHOD_PLACEHOLDER
+    SKIOBUF_METHOD_PLACEHOLDER,
 #else
     /* LZO1X */
     { lzo_init_method, lzo_uninit_method,
       lzo_compr_size_method,
-      lzo_compr_method, lzo_uncompr_method, 1}
+      lzo_compr_method, lzo_uncompr_method, 1},
 #endif  /* SK_ENABLE_LZO */
 
+#if  !SK_ENABLE_LZ4
+    SKIOBUF_METHOD_PLACEHOLDER,
+#else
+    /* LZ4 */
+    { NULL, NULL,
+      lz4_compr_size_method,
+      lz4_compr_method, lz4_uncompr_method, 1},
+#endif  /* SK_ENABLE_LZ4 */
+
+#if  !SK_ENABLE_ZSTD
+    SKIOBUF_METHOD_PLACEHOLDER
+#else
+    /* ZSTD */
+    { zstd_init_method, zstd_uninit_method,
+      zstd_compr_size_method,
+      zstd_compr_method, zstd_uncompr_method, 1}
+#endif  /* SK_ENABLE_ZSTD */
+
 };
 
 static int const num_methods = sizeof(methods) / sizeof(iobuf_methods_t);
@@ -357,6 +504,605 @@ static int const num_methods = sizeof(methods) / sizeof(iobuf_methods_t);
     }
 
 
+/*
+ *    True when 'fd' hands its blocks to worker threads: more than one
+ *    thread was requested and the compression method compresses.
+ */
+#define SKIO_USE_POOL(fd)                                       \
+    ((fd)->thread_count > 1                                     \
+     && methods[(fd)->compr_method].uncompr_method != NULL)
+
+
+/* Copy the settings of 'src' (e.g., the compression level) that
+ * apply to 'compmethod' into 'dest'.  Unlike the settings, any memory
+ * or contexts in the options belong to each thread. */
+static void
+skio_pool_copy_opts(
+    iobuf_opts_t       *dest,
+    const iobuf_opts_t *src,
+    int                 compmethod)
+{
+    switch (compmethod) {
+#if SK_ENABLE_ZLIB
+      case SK_COMPMETHOD_ZLIB:
+        dest->zlib.level = src->zlib.level;
+        break;
+#endif
+#if SK_ENABLE_ZSTD
+      case SK_COMPMETHOD_ZSTD:
+        dest->zstd.level = src->zstd.level;
+        break;
+#endif
+      default:
+        break;
+    }
+}
+
+
+/* Per-thread data passed to skio_pool_worker() */
+typedef struct skio_pool_arg_st {
+    sk_iobuf_t         *fd;
+    uint32_t            thread_idx;
+} skio_pool_arg_t;
+
+
+/* Body of a worker thread: compress or decompress PENDING blocks in
+ * ring order until told to shut down. */
+static void *
+skio_pool_worker(
+    void               *varg)
+{
+    skio_pool_arg_t *arg = (skio_pool_arg_t*)varg;
+    sk_iobuf_t *fd = arg->fd;
+    iobuf_pool_t *pool = fd->pool;
+    const iobuf_methods_t *method = &methods[fd->compr_method];
+    const iobuf_opts_t *opts = &pool->opts[arg->thread_idx];
+    iobuf_block_t *blk;
+    compr_sizes_t *sizes;
+    sigset_t sigs;
+    uint32_t len;
+    int rv;
+
+    free(arg);
+
+    /* leave signals to the caller's threads */
+    sigfillset(&sigs);
+    pthread_sigmask(SIG_SETMASK, &sigs, NULL);
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (0 == pool->pending && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        blk = &pool->blocks[pool->next_job];
+        assert(SKIO_BLOCK_PENDING == blk->state);
+        blk->state = SKIO_BLOCK_BUSY;
+        pool->next_job = (pool->next_job + 1) % pool->block_count;
+        --pool->pending;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (fd->write) {
+            len = blk->compr_buf_size - sizeof(compr_sizes_t);
+            rv = method->compr_method(blk->compr_buf + sizeof(compr_sizes_t),
+                                      &len, blk->uncompr_buf,
+                                      blk->uncompr_size, opts);
+            if (0 == rv) {
+                blk->compr_size = len;
+                sizes = (compr_sizes_t*)blk->compr_buf;
+                sizes->compr_size = htonl(len);
+                sizes->uncompr_size = htonl(blk->uncompr_size);
+            }
+        } else {
+            len = blk->uncompr_buf_size;
+            rv = method->uncompr_method(blk->uncompr_buf, &len,
+                                        blk->compr_buf, blk->compr_size,
+                                        opts);
+            if (0 == rv && len != blk->uncompr_size) {
+                rv = -1;
+            }
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        blk->state = (rv ? SKIO_BLOCK_FAILED : SKIO_BLOCK_DONE);
+        pthread_cond_broadcast(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+
+/* Stop the worker threads of 'fd' and free the pool.  Any blocks
+ * still in the ring are discarded; writers must drain the ring
+ * first. */
+static void
+skio_pool_destroy(
+    sk_iobuf_t         *fd)
+{
+    iobuf_pool_t *pool = fd->pool;
+    const iobuf_methods_t *method;
+    uint32_t i;
+
+    if (NULL == pool) {
+        return;
+    }
+    method = &methods[fd->compr_method];
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (i = 0; i < pool->thread_count; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    if (pool->opts) {
+        for (i = 0; i < pool->opts_count; ++i) {
+            if (method->uninit_method) {
+                method->uninit_method(&pool->opts[i]);
+            }
+        }
+        free(pool->opts);
+    }
+    if (pool->blocks) {
+        for (i = 0; i < pool->block_count; ++i) {
+            free(pool->blocks[i].compr_buf);
+            free(pool->blocks[i].uncompr_buf);
+        }
+        free(pool->blocks);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+    fd->pool = NULL;
+}
+
+
+/* Create the worker threads for 'fd'.  The ring holds two blocks per
+ * thread so that the caller can fill or drain blocks while every
+ * worker is busy.  On failure, set 'fd' to process blocks on the
+ * caller's thread and return -1. */
+static int
+skio_pool_create(
+    sk_iobuf_t         *fd)
+{
+    const iobuf_methods_t *method;
+    iobuf_pool_t *pool;
+    skio_pool_arg_t *arg;
+    uint32_t i;
+
+    assert(NULL == fd->pool);
+    method = &methods[fd->compr_method];
+
+    pool = (iobuf_pool_t*)calloc(1, sizeof(iobuf_pool_t));
+    if (NULL == pool) {
+        goto ERROR;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    fd->pool = pool;
+
+    pool->block_count = 2 * fd->thread_count;
+    pool->blocks = ((iobuf_block_t*)
+                    calloc(pool->block_count, sizeof(iobuf_block_t)));
+    pool->opts = (iobuf_opts_t*)calloc(fd->thread_count,
+                                       sizeof(iobuf_opts_t));
+    pool->threads = (pthread_t*)calloc(fd->thread_count, sizeof(pthread_t));
+    if (!pool->blocks || !pool->opts || !pool->threads) {
+        goto ERROR;
+    }
+
+    for (i = 0; i < fd->thread_count; ++i) {
+        if (method->init_method && method->init_method(&pool->opts[i])) {
+            goto ERROR;
+        }
+        ++pool->opts_count;
+        skio_pool_copy_opts(&pool->opts[i], &fd->compr_opts,
+                            fd->compr_method);
+    }
+
+    for (i = 0; i < fd->thread_count; ++i) {
+        arg = (skio_pool_arg_t*)malloc(sizeof(skio_pool_arg_t));
+        if (NULL == arg) {
+            goto ERROR;
+        }
+        arg->fd = fd;
+        arg->thread_idx = i;
+        if (pthread_create(&pool->threads[i], NULL, skio_pool_worker, arg)) {
+            free(arg);
+            goto ERROR;
+        }
+        ++pool->thread_count;
+    }
+
+    return 0;
+
+  ERROR:
+    skio_pool_destroy(fd);
+    fd->thread_count = 1;
+    return -1;
+}
+
+
+/* Wait for the block at the head of the ring to be processed */
+static iobuf_block_t *
+skio_pool_wait_head(
+    iobuf_pool_t       *pool)
+{
+    iobuf_block_t *blk;
+
+    assert(pool->queued > 0);
+    blk = &pool->blocks[pool->head];
+    pthread_mutex_lock(&pool->mutex);
+    while (SKIO_BLOCK_PENDING == blk->state
+           || SKIO_BLOCK_BUSY == blk->state)
+    {
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return blk;
+}
+
+
+/* Give the block at the tail of the ring to the workers */
+static void
+skio_pool_submit(
+    iobuf_pool_t       *pool,
+    iobuf_block_t      *blk)
+{
+    pthread_mutex_lock(&pool->mutex);
+    blk->state = SKIO_BLOCK_PENDING;
+    ++pool->queued;
+    ++pool->pending;
+    pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+
+/* Remove the block at the head of the ring */
+static void
+skio_pool_release_head(
+    iobuf_pool_t       *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->blocks[pool->head].state = SKIO_BLOCK_EMPTY;
+    pool->head = (pool->head + 1) % pool->block_count;
+    --pool->queued;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+
+/* Count the block whose sizes were just read.  When the caller's
+ * skip function says the block is not needed, seek over its
+ * 'comp_block_size' bytes of data and return 1.  Return 0 if the
+ * block must be read, or -1 if the seek fails. */
+static int
+skio_skip_block(
+    sk_iobuf_t         *fd,
+    uint32_t            comp_block_size)
+{
+    uint64_t block_number = fd->blocks++;
+
+    if (NULL == fd->skip_fn || !fd->skip_fn(block_number, fd->skip_data)) {
+        return 0;
+    }
+    if (fd->io.seek(fd->fd, comp_block_size, SEEK_CUR) == (off_t)(-1)) {
+        return -1;
+    }
+    fd->total += comp_block_size;
+    return 1;
+}
+
+
+/* Read compressed blocks from the file into the free slots of the
+ * ring and hand them to the workers.  Stop at the end of the stream.
+ * A read error is saved and reported by skio_pool_uncompr() once the
+ * blocks before it have been consumed. */
+static void
+skio_pool_fill(
+    sk_iobuf_t         *fd)
+{
+    iobuf_pool_t *pool = fd->pool;
+    iobuf_block_t *blk;
+    uint32_t sizes[2];
+    uint32_t comp_block_size;
+    uint32_t uncomp_block_size;
+    ssize_t readlen;
+    int rv;
+
+    while (!pool->read_eof && pool->queued < pool->block_count) {
+        blk = &pool->blocks[(pool->head + pool->queued) % pool->block_count];
+        assert(SKIO_BLOCK_EMPTY == blk->state);
+
+        /* Read the compressed and uncompressed sizes */
+        readlen = fd->io.read(fd->fd, &sizes[0], sizeof(sizes[0]));
+        if (readlen > 0) {
+            fd->total += readlen;
+        }
+        if (readlen == 0
+            || ((size_t)readlen == sizeof(sizes[0]) && sizes[0] == 0))
+        {
+            pool->read_eof = 1;
+            return;
+        }
+        if (readlen == -1) {
+            goto IO_ERROR;
+        }
+        if ((size_t)readlen < sizeof(sizes[0])) {
+            goto SHORT_READ;
+        }
+        readlen = fd->io.read(fd->fd, &sizes[1], sizeof(sizes[1]));
+        if (readlen == -1) {
+            goto IO_ERROR;
+        }
+        fd->total += readlen;
+        if ((size_t)readlen < sizeof(sizes[1])) {
+            goto SHORT_READ;
+        }
+        comp_block_size = ntohl(sizes[0]);
+        uncomp_block_size = ntohl(sizes[1]);
+
+        /* See skio_uncompr() for the padding */
+        if (comp_block_size > SKIOBUF_MAX_BLOCKSIZE
+            || 3 + uncomp_block_size > SKIOBUF_MAX_BLOCKSIZE)
+        {
+            pool->read_error = SKIO_POOL_READ_ERR_INTERNAL;
+            pool->read_errno = ESKIO_BLOCKSIZE;
+            pool->read_eof = 1;
+            return;
+        }
+
+        /* Do not queue a block the caller does not want */
+        rv = skio_skip_block(fd, comp_block_size);
+        if (rv == -1) {
+            goto IO_ERROR;
+        }
+        if (rv == 1) {
+            continue;
+        }
+
+        if (comp_block_size > blk->compr_buf_size || !blk->compr_buf) {
+            free(blk->compr_buf);
+            blk->compr_buf = (uint8_t*)malloc(comp_block_size);
+            blk->compr_buf_size = comp_block_size;
+        }
+        if (3 + uncomp_block_size > blk->uncompr_buf_size
+            || !blk->uncompr_buf)
+        {
+            free(blk->uncompr_buf);
+            blk->uncompr_buf = (uint8_t*)malloc(3 + uncomp_block_size);
+            blk->uncompr_buf_size = 3 + uncomp_block_size;
+        }
+        if (!blk->compr_buf || !blk->uncompr_buf) {
+            pool->read_error = SKIO_POOL_READ_ERR_INTERNAL;
+            pool->read_errno = ESKIO_MALLOC;
+            pool->read_eof = 1;
+            return;
+        }
+
+        /* Read the compressed data */
+        readlen = fd->io.read(fd->fd, blk->compr_buf, comp_block_size);
+        if (readlen == -1) {
+            goto IO_ERROR;
+        }
+        fd->total += readlen;
+        if ((size_t)readlen < comp_block_size) {
+            goto SHORT_READ;
+        }
+        blk->compr_size = comp_block_size;
+        blk->uncompr_size = uncomp_block_size;
+        skio_pool_submit(pool, blk);
+    }
+    return;
+
+  IO_ERROR:
+    pool->read_error = SKIO_POOL_READ_ERR_IO;
+    pool->read_errno = errno;
+    pool->read_eof = 1;
+    return;
+
+  SHORT_READ:
+    pool->read_error = SKIO_POOL_READ_ERR_INTERNAL;
+    pool->read_errno = ESKIO_SHORTREAD;
+    pool->read_eof = 1;
+}
+
+
+/* Replacement for skio_uncompr() when 'fd' has worker threads: make
+ * the next decompressed block the current block of 'fd'.  Return the
+ * size of the block, 0 at end of file, or -1 on error. */
+static int32_t
+skio_pool_uncompr(
+    sk_iobuf_t         *fd)
+{
+    iobuf_pool_t *pool;
+    iobuf_block_t *blk;
+    uint8_t *buf;
+    uint32_t buf_size;
+
+    if (NULL == fd->pool && skio_pool_create(fd)) {
+        /* fall back to reading on this thread */
+        return -2;
+    }
+    pool = fd->pool;
+
+    fd->in_core = 0;
+    fd->uncompr = 0;
+
+    skio_pool_fill(fd);
+    if (0 == pool->queued) {
+        if (SKIO_POOL_READ_ERR_IO == pool->read_error) {
+            errno = pool->read_errno;
+            SKIOBUF_IO_ERROR(fd);
+        }
+        if (SKIO_POOL_READ_ERR_INTERNAL == pool->read_error) {
+            if (ESKIO_SHORTREAD == pool->read_errno) {
+                fd->eof = 1;
+            }
+            SKIOBUF_INTERNAL_ERROR(fd, pool->read_errno);
+        }
+        fd->eof = 1;
+        return 0;
+    }
+
+    blk = skio_pool_wait_head(pool);
+    if (SKIO_BLOCK_FAILED == blk->state) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_UNCOMP);
+    }
+
+    /* Swap the block's buffer with that of 'fd' */
+    buf = fd->uncompr_buf;
+    buf_size = fd->uncompr_buf_size;
+    fd->uncompr_buf = blk->uncompr_buf;
+    fd->uncompr_buf_size = blk->uncompr_buf_size;
+    blk->uncompr_buf = buf;
+    blk->uncompr_buf_size = buf ? buf_size : 0;
+
+    fd->disk_block_size = blk->compr_size;
+    fd->max_bytes = blk->uncompr_size;
+    fd->pos = 0;
+    fd->in_core = 1;
+    fd->uncompr = 1;
+    skio_pool_release_head(pool);
+
+    /* Keep the workers busy while the caller uses this block */
+    skio_pool_fill(fd);
+
+    return (int32_t)fd->max_bytes;
+}
+
+
+/* Write the block at the head of the ring to the file once the
+ * workers have compressed it */
+static int
+skio_pool_write_head(
+    sk_iobuf_t         *fd)
+{
+    iobuf_pool_t *pool = fd->pool;
+    iobuf_block_t *blk;
+    ssize_t writelen;
+    uint32_t size;
+
+    blk = skio_pool_wait_head(pool);
+    if (SKIO_BLOCK_FAILED == blk->state) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_COMP);
+    }
+    size = blk->compr_size + sizeof(compr_sizes_t);
+    writelen = fd->io.write(fd->fd, blk->compr_buf, size);
+    if (writelen == -1) {
+        SKIOBUF_IO_ERROR(fd);
+    }
+    fd->total += writelen;
+    if ((size_t)writelen < size) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_SHORTWRITE);
+    }
+    skio_pool_release_head(pool);
+
+    return 0;
+}
+
+
+/* Write every block in the ring to the file, in order */
+static int
+skio_pool_drain(
+    sk_iobuf_t         *fd)
+{
+    while (fd->pool && fd->pool->queued) {
+        if (skio_pool_write_head(fd)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/* Replacement for skio_compr() when 'fd' has worker threads: hand the
+ * current block of 'fd' to the workers and give 'fd' an empty
+ * buffer.  Write blocks that the workers have finished.  Return 0 on
+ * success, -1 on error, or -2 when the threads cannot be created. */
+static int32_t
+skio_pool_compr(
+    sk_iobuf_t         *fd)
+{
+    iobuf_pool_t *pool;
+    iobuf_block_t *blk;
+    uint8_t *buf;
+    uint32_t extra;
+    int done;
+
+    if (NULL == fd->pool && skio_pool_create(fd)) {
+        return -2;
+    }
+    pool = fd->pool;
+
+    /* Make room in the ring */
+    if (pool->queued == pool->block_count) {
+        if (skio_pool_write_head(fd)) {
+            return -1;
+        }
+    }
+
+    blk = &pool->blocks[(pool->head + pool->queued) % pool->block_count];
+    assert(SKIO_BLOCK_EMPTY == blk->state);
+    if (NULL == blk->compr_buf) {
+        blk->compr_buf_size = fd->compr_buf_size + sizeof(compr_sizes_t);
+        blk->compr_buf = (uint8_t*)malloc(blk->compr_buf_size);
+        if (NULL == blk->compr_buf) {
+            SKIOBUF_INTERNAL_ERROR(fd, ESKIO_MALLOC);
+        }
+    }
+    if (NULL == blk->uncompr_buf) {
+        blk->uncompr_buf_size = fd->uncompr_buf_size;
+        blk->uncompr_buf = (uint8_t*)malloc(blk->uncompr_buf_size);
+        if (NULL == blk->uncompr_buf) {
+            SKIOBUF_INTERNAL_ERROR(fd, ESKIO_MALLOC);
+        }
+    }
+
+    blk->uncompr_size = fd->pos;
+    extra = fd->pos % fd->block_quantum;
+    /* Programmer's error if we don't have complete records */
+    assert(extra == 0);
+    if (extra != 0) {
+        memset(&fd->uncompr_buf[fd->pos], 0, extra);
+        blk->uncompr_size += extra;
+    }
+
+    /* Swap the buffer of 'fd' with that of the block */
+    buf = blk->uncompr_buf;
+    blk->uncompr_buf = fd->uncompr_buf;
+    fd->uncompr_buf = buf;
+    skio_pool_submit(pool, blk);
+
+    fd->pos = 0;
+    ++fd->blocks;
+
+    /* Write any blocks at the head that are finished */
+    while (pool->queued) {
+        blk = &pool->blocks[pool->head];
+        pthread_mutex_lock(&pool->mutex);
+        done = (SKIO_BLOCK_DONE == blk->state
+                || SKIO_BLOCK_FAILED == blk->state);
+        pthread_mutex_unlock(&pool->mutex);
+        if (!done) {
+            break;
+        }
+        if (skio_pool_write_head(fd)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 /* FUNCTION DEFINITIONS */
 
 /* Create an IO buffer reader */
@@ -411,6 +1157,7 @@ skIOBufDestroy(
     /* Will set error on reader, but that's okay, since we free the
        structure immediately afterwards. */
     skIOBufFlush(fd);
+    skio_pool_destroy(fd);
 
     if (fd->compr_buf) {
         free(fd->compr_buf);
@@ -493,6 +1240,16 @@ skio_bind_wrapper(
     if (compmethod == SK_COMPMETHOD_LZO1X) {
         SKIOBUF_INTERNAL_ERROR(fd, ESKIO_BADCOMPMETHOD);
     }
+#endif
+#if !SK_ENABLE_LZ4
+    if (compmethod == SK_COMPMETHOD_LZ4) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_BADCOMPMETHOD);
+    }
+#endif
+#if !SK_ENABLE_ZSTD
+    if (compmethod == SK_COMPMETHOD_ZSTD) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_BADCOMPMETHOD);
+    }
 #endif
     if (fd == NULL) {
         return -1;
@@ -504,9 +1261,13 @@ skio_bind_wrapper(
             SKIOBUF_INTERNAL_ERROR(fd, ESKIO_INITFAIL);
         }
     }
+    skio_pool_destroy(fd);
 
     fd->compr_method = compmethod;
     fd->total = 0;
+    fd->blocks = 0;
+    fd->skip_fn = NULL;
+    fd->skip_data = NULL;
     fd->used = 0;
     fd->error = 0;
     fd->interr = 0;
@@ -568,6 +1329,7 @@ skio_uncompr(
     ssize_t readlen;
     uint8_t *bufpos;
     const iobuf_methods_t *method;
+    int32_t rv;
 
     assert(fd);
 
@@ -576,6 +1338,15 @@ skio_uncompr(
            (mode == SKIO_UNCOMP_SKIP) ||
            (mode == SKIO_UNCOMP_REREAD && !fd->uncompr));
 
+    /* Let the worker threads decompress the block */
+    if (SKIO_USE_POOL(fd)) {
+        assert(mode == SKIO_UNCOMP_NORMAL);
+        rv = skio_pool_uncompr(fd);
+        if (rv != -2) {
+            return rv;
+        }
+    }
+
     /* Alias our methods. */
     method = &methods[fd->compr_method];
 
@@ -600,6 +1371,7 @@ skio_uncompr(
         new_block_size = fd->max_bytes;
         padded_uncomp_block_size = fd->max_bytes;
     } else {
+      next_block:
         /* Read in the compressed block sizes */
         readlen = fd->io.read(fd->fd, &comp_block_size,
                               sizeof(comp_block_size));
@@ -639,6 +1411,15 @@ skio_uncompr(
         comp_block_size = ntohl(comp_block_size);
         uncomp_block_size = new_block_size = ntohl(uncomp_block_size);
 
+        /* Seek over a block the caller does not want */
+        rv = skio_skip_block(fd, comp_block_size);
+        if (rv == -1) {
+            SKIOBUF_IO_ERROR(fd);
+        }
+        if (rv == 1) {
+            goto next_block;
+        }
+
         /*
          *   Some decompression algorithms require more space than the
          *   size of the decompressed data since they write data in
@@ -831,8 +1612,11 @@ iobufRead(
         SKIOBUF_INTERNAL_ERROR(fd, ESKIO_TOOBIG);
     }
 
-    /* If we don't need the bytes, skip them */
-    if (buf == NULL && c == NULL) {
+    /* If we don't need the bytes, skip them.  Blocks that worker
+     * threads read ahead are not skipped this way; see
+     * skIOBufSetSkipBlock() for skipping blocks with worker
+     * threads. */
+    if (buf == NULL && c == NULL && !SKIO_USE_POOL(fd)) {
         mode = SKIO_UNCOMP_SKIP;
     } else {
         mode = SKIO_UNCOMP_NORMAL;
@@ -943,9 +1727,18 @@ skio_compr(
     const iobuf_methods_t *method;
     uint32_t extra;
     uint32_t offset;
+    int32_t rv;
 
     assert(fd);
 
+    /* Let the worker threads compress the block */
+    if (SKIO_USE_POOL(fd)) {
+        rv = skio_pool_compr(fd);
+        if (rv != -2) {
+            return rv;
+        }
+    }
+
     method = &methods[fd->compr_method];
     uncompr_size = fd->pos;
 
@@ -1006,6 +1799,7 @@ skio_compr(
     }
 
     fd->pos = 0;
+    ++fd->blocks;
 
     return (int32_t)writelen;
 }
@@ -1081,6 +1875,31 @@ skIOBufWrite(
 }
 
 
+/* End the current block of an IO buffer writer */
+int
+skIOBufEndBlock(
+    sk_iobuf_t         *fd)
+{
+    assert(fd);
+    if (fd == NULL) {
+        return -1;
+    }
+    if (!fd->write) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_NOWRITE);
+    }
+    if (!fd->fd_valid) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_NOFD);
+    }
+
+    if (fd->pos) {
+        if (skio_compr(fd) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
 /* Finish writing to an IO buffer */
 off_t
 skIOBufFlush(
@@ -1104,6 +1923,9 @@ skIOBufFlush(
             return -1;
         }
     }
+    if (skio_pool_drain(fd)) {
+        return -1;
+    }
 
     if (fd->io.flush) {
         fd->io.flush(fd->fd);
@@ -1127,6 +1949,16 @@ skIOBufTotal(
 }
 
 
+/* Number of blocks written to file descriptor */
+uint64_t
+skIOBufBlockCount(
+    sk_iobuf_t         *fd)
+{
+    assert(fd);
+    return fd->blocks;
+}
+
+
 /* Maximum total number of bytes in a compressed block */
 uint32_t
 skIOBufUpperCompBlockSize(
@@ -1180,6 +2012,10 @@ skIOBufTotalUpperBound(
         total += (method->compr_size_method(fd->max_bytes, &fd->compr_opts)
                   - fd->max_bytes);
     }
+    if (fd->pool) {
+        /* blocks that the worker threads have not written */
+        total += (off_t)fd->pool->queued * skIOBufUpperCompBlockSize(fd);
+    }
 
     return total;
 }
@@ -1213,6 +2049,54 @@ skIOBufSetBlockSize(
 }
 
 
+/* Sets the function that decides which blocks a reader skips */
+int
+skIOBufSetSkipBlock(
+    sk_iobuf_t         *fd,
+    skio_skip_fn_t      skip_fn,
+    void               *cb_data)
+{
+    assert(fd);
+    if (fd == NULL) {
+        return -1;
+    }
+    if (fd->write) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_NOREAD);
+    }
+    if (fd->used) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_USED);
+    }
+    if (!methods[fd->compr_method].block_numbers || fd->no_seek) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_BADOPT);
+    }
+
+    fd->skip_fn = skip_fn;
+    fd->skip_data = cb_data;
+
+    return 0;
+}
+
+
+/* Sets the number of worker threads */
+int
+skIOBufSetThreads(
+    sk_iobuf_t         *fd,
+    uint32_t            count)
+{
+    assert(fd);
+    if (fd == NULL) {
+        return -1;
+    }
+    if (fd->pool) {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_USED);
+    }
+
+    fd->thread_count = count;
+
+    return 0;
+}
+
+
 /* Sets the write quantum */
 int
 skIOBufSetRecordSize(
@@ -1602,6 +2486,183 @@ lzo_uncompr_method(
 #endif  /* SK_ENABLE_LZO */
 
 
+#if SK_ENABLE_LZ4
+
+/* LZ4 methods */
+
+/* iobuf_methods_t.compr_size_method */
+static uint32_t
+lz4_compr_size_method(
+    uint32_t                    compr_size,
+    const iobuf_opts_t  UNUSED(*opts))
+{
+    return (uint32_t)LZ4_compressBound((int)compr_size);
+}
+
+
+/* iobuf_methods_t.compr_method */
+static int
+lz4_compr_method(
+    void                       *dest,
+    uint32_t                   *destlen,
+    const void                 *source,
+    uint32_t                    sourcelen,
+    const iobuf_opts_t  UNUSED(*opts))
+{
+    int rv;
+
+    rv = LZ4_compress_default((const char*)source, (char*)dest,
+                              (int)sourcelen, (int)*destlen);
+    if (rv <= 0) {
+        return -1;
+    }
+    *destlen = (uint32_t)rv;
+
+    return 0;
+}
+
+
+/* iobuf_methods_t.uncompr_method */
+static int
+lz4_uncompr_method(
+    void                       *dest,
+    uint32_t                   *destlen,
+    const void                 *source,
+    uint32_t                    sourcelen,
+    const iobuf_opts_t  UNUSED(*opts))
+{
+    int rv;
+
+    rv = LZ4_decompress_safe((const char*)source, (char*)dest,
+                             (int)sourcelen, (int)*destlen);
+    if (rv < 0) {
+        return -1;
+    }
+    *destlen = (uint32_t)rv;
+
+    return 0;
+}
+
+#endif  /* SK_ENABLE_LZ4 */
+
+
+#if SK_ENABLE_ZSTD
+
+/* ZSTD methods */
+
+/* iobuf_methods_t.init_method */
+static int
+zstd_init_method(
+    iobuf_opts_t       *opts)
+{
+    /* the contexts do not allocate their working memory until they
+     * are first used */
+    opts->zstd.level = SKIOBUF_ZSTD_DEFAULT_LEVEL;
+    opts->zstd.cctx = ZSTD_createCCtx();
+    opts->zstd.dctx = ZSTD_createDCtx();
+    if (opts->zstd.cctx == NULL || opts->zstd.dctx == NULL) {
+        zstd_uninit_method(opts);
+        return -1;
+    }
+    return 0;
+}
+
+
+/* iobuf_methods_t.uninit_method */
+static int
+zstd_uninit_method(
+    iobuf_opts_t       *opts)
+{
+    if (opts->zstd.cctx) {
+        ZSTD_freeCCtx(opts->zstd.cctx);
+        opts->zstd.cctx = NULL;
+    }
+    if (opts->zstd.dctx) {
+        ZSTD_freeDCtx(opts->zstd.dctx);
+        opts->zstd.dctx = NULL;
+    }
+    return 0;
+}
+
+
+/* iobuf_methods_t.compr_size_method */
+static uint32_t
+zstd_compr_size_method(
+    uint32_t                    compr_size,
+    const iobuf_opts_t  UNUSED(*opts))
+{
+    return (uint32_t)ZSTD_compressBound(compr_size);
+}
+
+
+/* iobuf_methods_t.compr_method */
+static int
+zstd_compr_method(
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen,
+    const iobuf_opts_t *opts)
+{
+    size_t rv;
+
+    rv = ZSTD_compressCCtx(opts->zstd.cctx, dest, *destlen, source, sourcelen,
+                           opts->zstd.level);
+    if (ZSTD_isError(rv)) {
+        return -1;
+    }
+    *destlen = (uint32_t)rv;
+
+    return 0;
+}
+
+
+/* iobuf_methods_t.uncompr_method */
+static int
+zstd_uncompr_method(
+    void               *dest,
+    uint32_t           *destlen,
+    const void         *source,
+    uint32_t            sourcelen,
+    const iobuf_opts_t *opts)
+{
+    size_t rv;
+
+    rv = ZSTD_decompressDCtx(opts->zstd.dctx, dest, *destlen,
+                             source, sourcelen);
+    if (ZSTD_isError(rv)) {
+        return -1;
+    }
+    *destlen = (uint32_t)rv;
+
+    return 0;
+}
+
+
+int
+skIOBufSetZstdLevel(
+    sk_iobuf_t         *fd,
+    int                 level)
+{
+    assert(fd);
+    if (fd == NULL) {
+        return -1;
+    }
+
+    if (fd->compr_method != SK_COMPMETHOD_ZSTD
+        || level < 1 || level > ZSTD_maxCLevel())
+    {
+        SKIOBUF_INTERNAL_ERROR(fd, ESKIO_BADOPT);
+    }
+
+    fd->compr_opts.zstd.level = level;
+
+    return 0;
+}
+
+#endif  /* SK_ENABLE_ZSTD */
+
+
 /*
 ** Local Variables:
 ** mode:c
@@ -160,6 +160,15 @@ typedef struct skio_abstract_st {
  *   All necessary operations on an abstract file descriptor.
  */
 
+typedef int (*skio_skip_fn_t)(uint64_t block_number, void *cb_data);
+/*
+ *    Called by an IO buffer reader with the number of each compressed
+ *    block it is about to read, where the first block after binding
+ *    is block 0, and the 'cb_data' given to skIOBufSetSkipBlock().
+ *    Returns a true value when the block is not needed, in which case
+ *    the reader seeks over it, or false to read the block.
+ */
+
 
 sk_iobuf_t *
 skIOBufCreateReader(
@@ -267,6 +276,23 @@ skIOBufWrite(
  *    less than 'count'.
  */
 
+int
+skIOBufEndBlock(
+    sk_iobuf_t         *buf);
+/*
+ *    Compresses and writes the data that is buffered in the IO buffer
+ *    writer 'buf' as a (possibly short) block, so that the next byte
+ *    written starts a new block.  Does nothing when no data is
+ *    buffered.  Unlike skIOBufFlush(), this does not wait for worker
+ *    threads or flush the underlying file descriptor.
+ *
+ *    A reader that skips the bytes of a complete block by passing a
+ *    NULL buffer to skIOBufRead() neither reads nor uncompresses that
+ *    block.
+ *
+ *    Returns 0 on success, -1 on failure.
+ */
+
 off_t
 skIOBufFlush(
     sk_iobuf_t         *buf);
@@ -288,6 +314,17 @@ skIOBufTotal(
  *    error.
  */
 
+uint64_t
+skIOBufBlockCount(
+    sk_iobuf_t         *buf);
+/*
+ *    Returns the number of blocks that have been written to or read
+ *    from the underlying file descriptor since it was bound to the IO
+ *    buffer.  A block is written when the buffer fills and when the
+ *    buffer is flushed while holding data.  Blocks that a reader
+ *    skips are included in the count.
+ */
+
 off_t
 skIOBufTotalUpperBound(
     sk_iobuf_t         *buf);
@@ -324,6 +361,39 @@ skIOBufSetRecordSize(
  *     buffer.  Returns 0 on success, -1 on error.
  */
 
+int
+skIOBufSetSkipBlock(
+    sk_iobuf_t         *buf,
+    skio_skip_fn_t      skip_fn,
+    void               *cb_data);
+/*
+ *    Sets the function that a compressed IO buffer reader calls
+ *    before reading each block to decide whether to skip it.  A
+ *    skipped block is neither read nor uncompressed, and worker
+ *    threads do not read it ahead.  The compression method must store
+ *    the block sizes and the underlying file descriptor must be
+ *    seekable.  This function can only be called before the first
+ *    read.  Returns 0 on success, -1 on error.
+ */
+
+int
+skIOBufSetThreads(
+    sk_iobuf_t         *buf,
+    uint32_t            count);
+/*
+ *    Sets the number of worker threads that compress the blocks
+ *    written to a compressed IO buffer or decompress the blocks read
+ *    from one.  A reader reads up to two blocks per thread ahead of
+ *    the caller; a writer compresses up to two blocks per thread
+ *    before writing them.  Blocks are read and written in order on
+ *    the caller's thread.  A count of 0 or 1 processes each block on
+ *    the caller's thread when it is needed, which is the default.  A
+ *    reader that uses worker threads does not seek over skipped
+ *    blocks.  The threads are started when the first block is read
+ *    or written, after which this function returns -1.  Returns 0 on
+ *    success, -1 on error.
+ */
+
 #if SK_ENABLE_ZLIB
 int
 skIOBufSetZlibLevel(
@@ -350,6 +420,25 @@ skIOBufBindGzip(
  */
 #endif  /* SK_ENABLE_ZLIB */
 
+#if SK_ENABLE_ZSTD
+/*
+ *    The compression level that Zstandard-based IO buffers use when
+ *    skIOBufSetZstdLevel() is not called.
+ */
+#define SKIOBUF_ZSTD_DEFAULT_LEVEL  3
+
+int
+skIOBufSetZstdLevel(
+    sk_iobuf_t         *buf,
+    int                 level);
+/*
+ *    Sets the compression level for Zstandard-based IO buffers.  The
+ *    level must be between 1 and the maximum level supported by the
+ *    library, and the buffer must be bound with SK_COMPMETHOD_ZSTD.
+ *    Returns 0 on success, -1 on error.
+ */
+#endif  /* SK_ENABLE_ZSTD */
+
 const char *
 skIOBufStrError(
     sk_iobuf_t         *buf);
@@ -221,6 +221,15 @@ RCSIDENT("$SiLK: skipset.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  */
 #define IPSET_REC_VERSION_RADIX             3
 
+/*
+ *    When writing an IPset in the IPSET_REC_VERSION_RADIX format, the
+ *    file's header is padded to a multiple of this many bytes so the
+ *    nodes and leaves that follow it are suitably aligned to be used
+ *    in place once the file is mmap()ed.  Files whose data section is
+ *    not aligned are read into memory.
+ */
+#define IPSET_RADIX_DATA_ALIGN              8
+
 /*
  *    Version of the IPset file compatible with SiLK versions prior to
  *    SiLK 3.0.
@@ -256,6 +265,36 @@ RCSIDENT("$SiLK: skipset.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  */
 #define IPSET_REC_VERSION_CIDR_BMAP         4
 
+/*
+ *    IPset file format version that holds only IPv4 addresses and is
+ *    modeled on "Roaring" compressed bitmaps.
+ *
+ *    The file is a sequence of containers, one for each /16 that
+ *    contains at least one IP, in ascending order.  Each container
+ *    begins with two uint32_t values.  The upper 16 bits of the first
+ *    value are the /16 (that is, the 16 most significant bits of the
+ *    IPs in the container) and the lower 16 bits are the container
+ *    type.  The second value is a count whose meaning depends on the
+ *    type.  The remainder of the container depends on the type:
+ *
+ *    SET_SLASH16_ARRAY: 'count' uint16_t values in ascending order,
+ *    each being the 16 least significant bits of an IP.
+ *
+ *    SET_SLASH16_BITMAP: a 65536-bit bitmap that has the same layout
+ *    as an skIPNode_t (2048 uint32_t's).  'count' is the number of
+ *    IPs in the /16.
+ *
+ *    SET_SLASH16_RUN: 'count' pairs of uint16_t values, where each
+ *    pair is the first and the last IP (the 16 least significant
+ *    bits) of a range of IPs.
+ *
+ *    The writer uses whichever type is the smallest for each /16, so
+ *    sparse IPsets (such as those made from scanners) use a few bytes
+ *    per IP and dense IPsets use one or two words per range.  All
+ *    values are in native byte order.
+ */
+#define IPSET_REC_VERSION_SLASH16           5
+
 /*
  *    Number to tell writer to use the default IPset file version,
  *    which is LEGACY for IPv4 and RADIX for IPv6.
@@ -271,7 +310,7 @@ RCSIDENT("$SiLK: skipset.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /*
  *    Maximum file version available
  */
-#define IPSET_REC_VERSION_MAX               IPSET_REC_VERSION_CIDR_BMAP
+#define IPSET_REC_VERSION_MAX               IPSET_REC_VERSION_SLASH16
 
 /*
  *    Name of an environment variable that, when set, is used in place
@@ -282,9 +321,10 @@ RCSIDENT("$SiLK: skipset.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 /*
  *    Name of an environment variable used to determine how
  *    IPv4-IPsets are represented internally.  Legal values are
- *    "iptree" for the SiLK-2 IPTree structure and "radix" for the
- *    Radix-Tree structure.  Not intended for end users.  Used by
- *    IPSET_USE_IPTREE and ipset_use_iptree.
+ *    "iptree" for the SiLK-2 IPTree structure, "radix" for the
+ *    Radix-Tree structure, and "container" for /16 containers.  Not
+ *    intended for end users.  Used by IPSET_USE_IPTREE,
+ *    IPSET_USE_CONTAINER, ipset_use_iptree, and ipset_use_container.
  */
 #define IPSET_ENVAR_INCORE_FORMAT           "SKIPSET_INCORE_FORMAT"
 
@@ -310,9 +350,40 @@ RCSIDENT("$SiLK: skipset.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  */
 #define IPSET_USE_IPTREE_DEFAULT           1
 
+/*
+ *    When to use /16 containers for in-memory IPv4-IPsets: never, only
+ *    for IPsets read from IPSET_REC_VERSION_SLASH16 files, or for all
+ *    IPv4-IPsets.  Uses the environment variable specified by the
+ *    IPSET_ENVAR_INCORE_FORMAT macro.
+ */
+#define IPSET_USE_CONTAINER                                             \
+    (ipset_use_iptree >= 0                                              \
+     ? ipset_use_container                                              \
+     : (ipsetCheckFormatEnvar(), ipset_use_container))
+
+#define IPSET_CONTAINER_NEVER              0
+#define IPSET_CONTAINER_SLASH16_FILES      1
+#define IPSET_CONTAINER_ALWAYS             2
+
+/*
+ *    Default value for IPSET_USE_CONTAINER if the envar is not set.
+ */
+#define IPSET_USE_CONTAINER_DEFAULT        IPSET_CONTAINER_SLASH16_FILES
+
 /* Number of nodes to create initially */
 #define  IPSET_INITIAL_ENTRY_COUNT       2048
 
+/* Number of IPs that skIPSetCheckAddresses() and skIPSetCheckRecords()
+ * look up together */
+#define  IPSET_CHECK_BATCH               256
+
+/* Ask the processor to begin loading the memory at 'p' into cache */
+#if defined(__GNUC__)
+#  define IPSET_PREFETCH(p)     __builtin_prefetch((p))
+#else
+#  define IPSET_PREFETCH(p)
+#endif
+
 /* Number of bits if IP to examine when branching at a node */
 #define  NUM_BITS  4
 
@@ -749,6 +820,23 @@ RCSIDENT("$SiLK: skipset.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  * byte to size of the bitmap */
 #define SET_CIDR_BMAP_256   0x81
 
+/* In IPSET_REC_VERSION_SLASH16 files, the types of container */
+#define SET_SLASH16_ARRAY   1
+#define SET_SLASH16_BITMAP  2
+#define SET_SLASH16_RUN     3
+
+/* In IPSET_REC_VERSION_SLASH16 files, the number of uint16_t values
+ * in the largest container (an array or a list of runs) */
+#define SET_SLASH16_MAX_VALUES  (SKIP_BBLOCK_COUNT)
+
+/* The largest number of IPs in a SET_SLASH16_ARRAY container and the
+ * largest number of ranges in a SET_SLASH16_RUN container; a bitmap
+ * is smaller than anything larger */
+#define SET_SLASH16_ARRAY_MAX                                   \
+    ((uint32_t)(sizeof(skIPNode_t) / sizeof(uint16_t)) - 1)
+#define SET_SLASH16_RUN_MAX                                     \
+    ((uint32_t)(sizeof(skIPNode_t) / (2 * sizeof(uint16_t))) - 1)
+
 
 #if   !defined(NUM_BITS)
 #  error "NUM_BITS must be defined"
@@ -837,19 +925,54 @@ typedef struct skipset_v3_st {
     unsigned                    realloc_leaves :1;
 } skipset_v3_t;
 
+/* ONE /16 OF AN IPSET THAT USES CONTAINERS */
+typedef struct ipset_slash16_st {
+    /* the IPs in the /16.  For a SET_SLASH16_ARRAY, 'vals' holds
+     * 'count' uint16_t values in ascending order.  For a
+     * SET_SLASH16_RUN, 'vals' holds 'count' pairs of uint16_t values
+     * that are the first and last IP of a range; the ranges are in
+     * ascending order and are neither adjacent nor overlapping.  For
+     * a SET_SLASH16_BITMAP, 'bmap' holds SKIP_BBLOCK_SIZE words. */
+    union slash16_body_un {
+        uint16_t       *vals;
+        uint32_t       *bmap;
+    }                           b;
+    /* the number of values in an array, the number of ranges in a
+     * list of runs, or the number of IPs in a bitmap.  The count for
+     * a bitmap is only valid when the IPset is clean. */
+    uint32_t                    count;
+    /* the number of uint16_t values allocated in 'vals' */
+    uint32_t                    capacity;
+    /* the type of container: SET_SLASH16_ARRAY, SET_SLASH16_BITMAP,
+     * or SET_SLASH16_RUN */
+    uint32_t                    type;
+} ipset_slash16_t;
+
+/* THE IPSET Structure for IPv4 IPsets that use /16 containers.  This
+ * is the in-memory form of the IPSET_REC_VERSION_SLASH16 format. */
+typedef struct skipset_cont_st {
+    /* the container for each /16, or NULL when the /16 is empty.
+     * When the IPset is dirty, a bitmap may be empty. */
+    ipset_slash16_t            *slash16[SKIP_BBLOCK_COUNT];
+} skipset_cont_t;
+
 /* A COMMON IPSET Structure */
 struct skipset_st {
     /* options used when writing an IPset */
     const skipset_options_t    *options;
     /* which pointer to use in this union depends on the setting of
-     * the 'is_iptree' member */
+     * the 'is_iptree' and 'is_container' members */
     union body_un {
         skipset_v3_t   *v3;
         skIPTree_t     *v2;
+        skipset_cont_t *cont;
     }                           s;
     /* whether the 's' member holds a SiLK-3 IPset (==0) or a SiLK-2
      * IPTree (==1).  See also 'is_ipv6'. */
     unsigned                    is_iptree :1;
+    /* whether the 's' member holds /16 containers.  When this is 1,
+     * the 'is_iptree' and 'is_ipv6' members must be 0. */
+    unsigned                    is_container :1;
     /* whether the SiLK-3 IPset holds IPv6 addresses.  When this is 1,
      * the 'is_iptree' member must be 0. */
     unsigned                    is_ipv6 :1;
@@ -1059,6 +1182,14 @@ static const char *ipset_options_help[] = {
  */
 static int ipset_use_iptree = -1;
 
+/*
+ *    When to use /16 containers for in-memory IPv4-IPsets.  Used by
+ *    IPSET_USE_CONTAINER.  This is one of the IPSET_CONTAINER_*
+ *    values, and it is set with 'ipset_use_iptree'.  See
+ *    ipsetCheckFormatEnvar().
+ */
+static int ipset_use_container = IPSET_USE_CONTAINER_DEFAULT;
+
 /* for handling IPset files Version 2 and Version 4 */
 static const uint32_t bmap256_zero[IPTREE_WORDS_PER_SLASH24] =
     {0, 0, 0, 0, 0, 0, 0, 0};
@@ -1095,6 +1226,21 @@ static int
 ipsetCheckFormatEnvar(
     void);
 static int
+ipsetContainerCheckRange(
+    const skipset_cont_t   *cont,
+    uint32_t                first,
+    uint32_t                last);
+static int
+ipsetContainerNextRange(
+    const skipset_cont_t   *cont,
+    uint32_t               *key,
+    uint32_t               *pos,
+    uint32_t               *first,
+    uint32_t               *last);
+static void
+ipsetContainerRemoveAll(
+    skipset_cont_t     *cont);
+static int
 ipsetCreate(
     skipset_t         **ipset_out,
     int                 support_ipv6,
@@ -1131,8 +1277,119 @@ ipsetReplaceNodeWithLeaf(
     ipset_node_t       *parent,
     uint32_t            which_child);
 static int
+ipsetSlash16AddRange(
+    ipset_slash16_t    *node,
+    uint32_t            first,
+    uint32_t            last);
+static uint32_t
+ipsetSlash16ChooseType(
+    uint32_t            num_ips,
+    uint32_t            num_runs);
+static void
+ipsetSlash16ClearRange(
+    uint32_t           *bmap,
+    uint32_t            first,
+    uint32_t            last);
+static int
+ipsetSlash16Contains(
+    const ipset_slash16_t  *node,
+    uint32_t                ip);
+static ipset_slash16_t *
+ipsetSlash16Copy(
+    const ipset_slash16_t  *src);
+static uint32_t
+ipsetSlash16CountIPs(
+    const ipset_slash16_t  *node);
+static ipset_slash16_t *
+ipsetSlash16Create(
+    uint32_t            type,
+    uint32_t            capacity);
+static void
+ipsetSlash16Destroy(
+    ipset_slash16_t    *node);
+static void
+ipsetSlash16FillBitmap(
+    const ipset_slash16_t  *node,
+    uint32_t               *bmap);
+static uint32_t
+ipsetSlash16FindRuns(
+    const uint32_t     *bmap,
+    uint16_t           *runs);
+static uint32_t
+ipsetSlash16FindValues(
+    const uint32_t     *bmap,
+    uint16_t           *vals);
+static int
+ipsetSlash16HasRange(
+    const ipset_slash16_t  *node,
+    uint32_t                first,
+    uint32_t                last);
+static int
+ipsetSlash16Intersect(
+    ipset_slash16_t        *dst,
+    const ipset_slash16_t  *src,
+    uint32_t               *tmp);
+static int
+ipsetSlash16Intersects(
+    const ipset_slash16_t  *a,
+    const ipset_slash16_t  *b);
+static int
+ipsetSlash16NextRange(
+    const ipset_slash16_t  *node,
+    uint32_t               *pos,
+    uint32_t               *first,
+    uint32_t               *last);
+static int
+ipsetSlash16Optimize(
+    ipset_slash16_t    *node,
+    uint32_t           *tmp);
+static int
+ipsetSlash16RemoveRange(
+    ipset_slash16_t    *node,
+    uint32_t            first,
+    uint32_t            last);
+static int
+ipsetSlash16Reserve(
+    ipset_slash16_t    *node,
+    uint32_t            capacity);
+static uint32_t
+ipsetSlash16Search(
+    const uint16_t     *vals,
+    uint32_t            count,
+    uint32_t            width,
+    uint32_t            value);
+static void
+ipsetSlash16SetRange(
+    uint32_t           *bmap,
+    uint32_t            first,
+    uint32_t            last);
+static int
+ipsetSlash16Subtract(
+    ipset_slash16_t        *dst,
+    const ipset_slash16_t  *src);
+static int
+ipsetSlash16ToBitmap(
+    ipset_slash16_t    *node);
+static int
+ipsetSlash16Union(
+    ipset_slash16_t        *dst,
+    const ipset_slash16_t  *src,
+    uint32_t               *tmp);
+static int
+ipsetUnionCallback(
+    skipaddr_t         *ipaddr,
+    uint32_t            prefix,
+    void               *v_ipset);
+static int
 ipsetVerify(
     const skipset_t    *ipset);
+static int
+ipsetWalkContainer(
+    const skipset_t    *ipset,
+    uint32_t            cidr_blocks,
+    sk_ipv6policy_t     v6_policy,
+    skipset_walk_fn_t   callback,
+    void               *cb_data);
 
 
 /* FUNCTION DEFINITIONS */
@@ -1203,6 +1460,143 @@ ipsetAllocEntries(
 }
 
 
+/*
+ *  ipsetCheckBatchV4(ipset, ips, count, hit);
+ *
+ *    Helper function for skIPSetCheckAddresses() and
+ *    skIPSetCheckRecords().
+ *
+ *    Set 'hit[i]' to 1 if the IPv4 address 'ips[i]' is in the IPv4
+ *    'ipset' or to 0 otherwise, for each 'i' less than 'count', which
+ *    must not exceed IPSET_CHECK_BATCH.
+ *
+ *    For an IPTree, the lookup is done in three passes over the IPs:
+ *    the first prefetches the /16 pointers, the second loads the
+ *    pointers and prefetches the words of the bitmaps, and the third
+ *    tests the bits.  /16 containers are visited the same way, except
+ *    the second pass prefetches the container.  For a radix tree, all the IPs descend the tree
+ *    one level per pass, and the node each IP visits next is
+ *    prefetched while the other IPs are being checked.
+ */
+static void
+ipsetCheckBatchV4(
+    const skipset_t    *ipset,
+    const uint32_t     *ips,
+    uint32_t            count,
+    uint8_t            *hit)
+{
+    uint32_t i;
+
+    assert(count <= IPSET_CHECK_BATCH);
+    assert(0 == ipset->is_ipv6);
+
+    if (ipset->is_iptree) {
+        const skIPTree_t *tree = ipset->s.v2;
+        const skIPNode_t *node[IPSET_CHECK_BATCH];
+
+        for (i = 0; i < count; ++i) {
+            IPSET_PREFETCH(&tree->nodes[ips[i] >> 16]);
+        }
+        for (i = 0; i < count; ++i) {
+            node[i] = tree->nodes[ips[i] >> 16];
+            if (node[i]) {
+                IPSET_PREFETCH(&node[i]->addressBlock[(ips[i] & 0xFFFF)>>5]);
+            }
+        }
+        for (i = 0; i < count; ++i) {
+            hit[i] = (node[i]
+                      && skIPTreeNodeHasMark((ips[i] & 0xFFFF), node[i]));
+        }
+        return;
+    }
+
+    if (ipset->is_container) {
+        const skipset_cont_t *cont = ipset->s.cont;
+        const ipset_slash16_t *node[IPSET_CHECK_BATCH];
+
+        for (i = 0; i < count; ++i) {
+            IPSET_PREFETCH(&cont->slash16[ips[i] >> 16]);
+        }
+        for (i = 0; i < count; ++i) {
+            node[i] = cont->slash16[ips[i] >> 16];
+            if (node[i]) {
+                IPSET_PREFETCH(node[i]);
+            }
+        }
+        for (i = 0; i < count; ++i) {
+            hit[i] = (node[i]
+                      && ipsetSlash16Contains(node[i], (ips[i] & 0xFFFF)));
+        }
+        return;
+    }
+
+    memset(hit, 0, count * sizeof(uint8_t));
+    if (IPSET_ISEMPTY(ipset)) {
+        return;
+    }
+
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        const ipset_leaf_v4_t *leaf;
+
+        leaf = LEAF_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
+        for (i = 0; i < count; ++i) {
+            hit[i] = (0 == leaf->prefix
+                      || 0 == ((ips[i] ^ leaf->ip) >> (32 - leaf->prefix)));
+        }
+        return;
+    }
+
+    {
+        const ipset_node_v4_t *node;
+        const ipset_leaf_v4_t *leaf;
+        uint32_t node_idx[IPSET_CHECK_BATCH];
+        uint32_t active[IPSET_CHECK_BATCH];
+        uint32_t num_active;
+        uint32_t which_child;
+        uint32_t kept;
+        uint32_t k;
+
+        IPSET_PREFETCH(NODE_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset)));
+        for (i = 0; i < count; ++i) {
+            node_idx[i] = IPSET_ROOT_INDEX(ipset);
+            active[i] = i;
+        }
+        num_active = count;
+
+        /* each pass moves every IP still being searched one level
+         * deeper; a search ends when it reaches a leaf or finds a
+         * node that does not match */
+        while (num_active) {
+            for (k = 0, kept = 0; k < num_active; ++k) {
+                i = active[k];
+                node = NODE_PTR_V4(ipset, node_idx[i]);
+                if (node->prefix
+                    && ((ips[i] ^ node->ip) >> (32 - node->prefix)))
+                {
+                    /* IP differs from the node; not found */
+                    continue;
+                }
+                which_child = WHICH_CHILD_V4(ips[i], node->prefix);
+                if (0 == node->child[which_child]) {
+                    continue;
+                }
+                if (NODEPTR_CHILD_IS_LEAF(node, which_child)) {
+                    leaf = LEAF_PTR_V4(ipset, node->child[which_child]);
+                    hit[i] = (0 == leaf->prefix
+                              || 0 == ((ips[i] ^ leaf->ip)
+                                       >> (32 - leaf->prefix)));
+                    continue;
+                }
+                node_idx[i] = node->child[which_child];
+                IPSET_PREFETCH(NODE_PTR_V4(ipset, node_idx[i]));
+                active[kept++] = i;
+            }
+            num_active = kept;
+        }
+    }
+}
+
+
 /*
  *  use_iptree = ipsetCheckFormatEnvar();
  *
@@ -1224,19 +1618,61 @@ ipsetCheckFormatEnvar(
     envar = getenv(IPSET_ENVAR_INCORE_FORMAT);
     if (envar) {
         if (0 == strcasecmp("iptree", envar)) {
+            ipset_use_container = IPSET_CONTAINER_NEVER;
             ipset_use_iptree = 1;
             return ipset_use_iptree;
         }
         if (0 == strcasecmp("radix", envar)) {
+            ipset_use_container = IPSET_CONTAINER_NEVER;
             ipset_use_iptree = 0;
             return ipset_use_iptree;
         }
+        if (0 == strcasecmp("container", envar)) {
+            /* files in the other formats are read into an IPTree and
+             * then converted to containers */
+            ipset_use_container = IPSET_CONTAINER_ALWAYS;
+            ipset_use_iptree = 1;
+            return ipset_use_iptree;
+        }
     }
+    ipset_use_container = IPSET_USE_CONTAINER_DEFAULT;
     ipset_use_iptree = IPSET_USE_IPTREE_DEFAULT;
     return ipset_use_iptree;
 }
 
 
+/*
+ *  status = ipsetCheckIPSetCallbackContainer(ipaddr, prefix, cont);
+ *
+ *    Callback function used by skIPSetCheckIPSet() when only one
+ *    IPset uses /16 containers.
+ *
+ *    Check whether any IP in 'ipaddr'/'prefix' is in the /16
+ *    containers 'cont'.  If none are, return SKIPSET_OK so iteration
+ *    continues.  Otherwise, return SKIPSET_ERR_SUBSET so iteration
+ *    stops.
+ */
+static int
+ipsetCheckIPSetCallbackContainer(
+    skipaddr_t         *ipaddr,
+    uint32_t            prefix,
+    void               *v_search_cont)
+{
+    uint32_t ipv4;
+
+    if (skipaddrGetAsV4(ipaddr, &ipv4)) {
+        return SKIPSET_OK;
+    }
+    if (ipsetContainerCheckRange(
+            (const skipset_cont_t*)v_search_cont, ipv4,
+            ((prefix < 32) ? (ipv4 | (UINT32_MAX >> prefix)) : ipv4)))
+    {
+        return SKIPSET_ERR_SUBSET;
+    }
+    return SKIPSET_OK;
+}
+
+
 /*
  *  status = ipsetCheckIPSetCallbackV4(ipaddr, prefix, ipset);
  *  status = ipsetCheckIPSetCallbackV6(ipaddr, prefix, ipset);
@@ -1793,1497 +2229,1517 @@ ipsetCompact(
 }
 
 
-#if SK_ENABLE_IPV6
 /*
- *  status = ipsetConvertIPTreetoV6(ipset);
+ *  found = ipsetContainerCheckAddress(cont, ipv4);
  *
- *    Convert the contents of a SiLK-2 based IPset (IPTree) to a
- *    SiLK-3 based IPv6 IPset.  The IPv4 addresses in the IPset will
- *    be mapped into the "::ffff:0.0.0.0/96" address space.  Return
- *    SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory cannot be
- *    allocated to hold the IPv6 addresses.
+ *    Return 1 if the /16 containers 'cont' hold 'ipv4', or 0
+ *    otherwise.
  */
 static int
-ipsetConvertIPTreetoV6(
-    skipset_t          *ipset)
+ipsetContainerCheckAddress(
+    const skipset_cont_t   *cont,
+    uint32_t                ipv4)
 {
-    skipset_t *tmp_ipset;
-    skIPTree_t *iptree;
-    skIPTreeCIDRBlockIterator_t cidr_iter;
-    skIPTreeCIDRBlock_t cidr;
-    skipaddr_t ipaddr;
-    int rv;
+    const ipset_slash16_t *node = cont->slash16[ipv4 >> 16];
 
-    assert(ipset);
-    assert(1 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
-    assert(0 == ipset->no_autoconvert);
+    return (node && ipsetSlash16Contains(node, ipv4 & 0xFFFF));
+}
 
-    rv = ipsetCreate(&tmp_ipset, 1, 1);
-    if (rv) {
-        return rv;
+
+/*
+ *  found = ipsetContainerCheckIPSet(cont1, cont2);
+ *
+ *    Helper function for skIPSetCheckIPSet().
+ *
+ *    Return 1 if the /16 containers 'cont1' and 'cont2' have any IPs
+ *    in common, or 0 otherwise.
+ */
+static int
+ipsetContainerCheckIPSet(
+    const skipset_cont_t   *cont1,
+    const skipset_cont_t   *cont2)
+{
+    uint32_t i;
+
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (cont1->slash16[i] && cont2->slash16[i]
+            && ipsetSlash16Intersects(cont1->slash16[i], cont2->slash16[i]))
+        {
+            return 1;
+        }
     }
+    return 0;
+}
 
-    iptree = ipset->s.v2;
-    ipset->s.v3 = tmp_ipset->s.v3;
-    ipset->is_iptree = 0;
-    ipset->is_ipv6 = 1;
 
-    ASSERT_OK(skIPTreeCIDRBlockIteratorBind(&cidr_iter, iptree));
-    while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
+/*
+ *  found = ipsetContainerCheckIPWildcard(cont, ipwild);
+ *
+ *    Helper function for skIPSetCheckIPWildcard().
+ *
+ *    Return 1 if the /16 containers 'cont' hold any of the IPv4
+ *    addresses in 'ipwild', or 0 otherwise.
+ */
+static int
+ipsetContainerCheckIPWildcard(
+    const skipset_cont_t   *cont,
+    const skIPWildcard_t   *ipwild)
+{
+    skIPWildcardIterator_t iter;
+    skipaddr_t ipaddr;
+    uint32_t prefix;
+    uint32_t ipv4;
+
+#if SK_ENABLE_IPV6
+    if (skIPWildcardIsV6(ipwild)) {
+        /* only visit the ::FFFF:0:0/96 netblock and return as IPv4 */
+        skIPWildcardIteratorBindV4(&iter, ipwild);
+    } else
+#endif  /* SK_ENABLE_IPV6 */
+    {
+        skIPWildcardIteratorBind(&iter, ipwild);
+    }
+
+    while (skIPWildcardIteratorNextCidr(&iter, &ipaddr, &prefix)
            == SK_ITERATOR_OK)
     {
-        skipaddrSetV6FromUint32(&ipaddr, &cidr.addr);
-        cidr.mask += 96;
+        assert(prefix <= 32);
+        ipv4 = skipaddrGetV4(&ipaddr);
+        if (ipsetContainerCheckRange(
+                cont, ipv4,
+                ((prefix < 32) ? (ipv4 | (UINT32_MAX >> prefix)) : ipv4)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-        rv = skIPSetInsertAddress(ipset, &ipaddr, cidr.mask);
-        if (rv) {
-            /* restore ipset to its original settings */
-            ipset->s.v2 = iptree;
-            ipset->is_iptree = 1;
-            ipset->is_ipv6 = 0;
 
-            skIPSetDestroy(&tmp_ipset);
-            return rv;
+/*
+ *  found = ipsetContainerCheckRange(cont, first, last);
+ *
+ *    Return 1 if the /16 containers 'cont' hold any IP from 'first'
+ *    to 'last' inclusive, or 0 otherwise.
+ */
+static int
+ipsetContainerCheckRange(
+    const skipset_cont_t   *cont,
+    uint32_t                first,
+    uint32_t                last)
+{
+    const ipset_slash16_t *node;
+    uint32_t key;
+
+    assert(first <= last);
+
+    for (key = first >> 16; key <= (last >> 16); ++key) {
+        node = cont->slash16[key];
+        if (node
+            && ipsetSlash16HasRange(
+                node,
+                ((key == (first >> 16)) ? (first & 0xFFFF) : 0),
+                ((key == (last >> 16)) ? (last & 0xFFFF) : 0xFFFF)))
+        {
+            return 1;
         }
     }
+    return 0;
+}
 
-    tmp_ipset->is_ipv6 = 0;
-    tmp_ipset->is_iptree = 1;
-    tmp_ipset->s.v2 = iptree;
 
-    skIPSetDestroy(&tmp_ipset);
+/*
+ *  prefix = ipsetContainerCidrPrefix(first, last);
+ *
+ *    Return the prefix of the largest CIDR block that begins at
+ *    'first' and does not extend past 'last'.
+ */
+static uint32_t
+ipsetContainerCidrPrefix(
+    uint32_t            first,
+    uint32_t            last)
+{
+    uint32_t bits = 0;
 
-    skIPSetClean(ipset);
+    assert(first <= last);
 
-    return SKIPSET_OK;
+    if (0 == first && UINT32_MAX == last) {
+        return 0;
+    }
+    while (bits < 31
+           && 0 == (first & ((2u << bits) - 1))
+           && (last - first) >= ((2u << bits) - 1))
+    {
+        ++bits;
+    }
+    return 32 - bits;
 }
 
 
 /*
- *  status = ipsetConvertV4toV6(ipset);
+ *  status = ipsetContainerClean(cont);
  *
- *    Helper function for skIPSetConvert();
- *
- *    Convert the contents of a Radix-Tree based 'ipset' so it
- *    contains IPv6 addresses.
+ *    Helper function for skIPSetClean().
  *
- *    The IPv4 addresses in the IPset will be mapped into the
- *    "::ffff:0.0.0.0/96" address space.  Return SKIPSET_OK on
- *    success, or SKIPSET_ERR_ALLOC if memory cannot be allocated to
- *    hold the IPv6 addresses.
+ *    Convert each /16 container in 'cont' to the type that uses the
+ *    least memory and remove the containers that are empty.  Return
+ *    SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory cannot be
+ *    allocated.
  */
 static int
-ipsetConvertV4toV6(
-    skipset_t          *ipset)
+ipsetContainerClean(
+    skipset_cont_t     *cont)
 {
-    ipset_node_v6_t *node6;
-    ipset_node_v4_t *node4;
-    ipset_leaf_v6_t *leaf6;
-    ipset_leaf_v4_t *leaf4;
-    size_t num_entries;
-    size_t ip_offset;
+    uint32_t *tmp;
     uint32_t i;
-    int rv;
-
-    assert(ipset);
-    assert(0 == ipset->is_iptree);
-    assert(sizeof(ipset_node_v4_t) == ipset->s.v3->nodes.entry_size);
-
-    if (IPSET_ISEMPTY(ipset)) {
-        goto SET_ATTRIBUTES;
-    }
 
-    /* compute the number of bytes required to hold the nodes once
-     * they are converted to IPv6, then divide by the IPv4 node size
-     * to get the number of IPv4 nodes to request.  The -1/+1 handle a
-     * partial node. */
-    num_entries
-        = (((ipset->s.v3->nodes.entry_count * sizeof(ipset_node_v6_t) - 1)
-            / sizeof(ipset_node_v4_t)) + 1);
-    if (num_entries > ipset->s.v3->nodes.entry_capacity) {
-        rv = ipsetAllocEntries(&ipset->s.v3->nodes, num_entries);
-        if (rv) {
-            return rv;
-        }
+    tmp = (uint32_t*)malloc(sizeof(skIPNode_t));
+    if (NULL == tmp) {
+        return SKIPSET_ERR_ALLOC;
     }
-
-    /* repeat for the leaves */
-    num_entries
-        = (((ipset->s.v3->leaves.entry_count * sizeof(ipset_leaf_v6_t) - 1)
-            / sizeof(ipset_leaf_v4_t)) + 1);
-    if (num_entries > ipset->s.v3->leaves.entry_capacity) {
-        rv = ipsetAllocEntries(&ipset->s.v3->leaves, num_entries);
-        if (rv) {
-            return rv;
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (cont->slash16[i]
+            && ipsetSlash16Optimize(cont->slash16[i], tmp)
+               == SKIPSET_ERR_EMPTY)
+        {
+            ipsetSlash16Destroy(cont->slash16[i]);
+            cont->slash16[i] = NULL;
         }
     }
+    free(tmp);
+    return SKIPSET_OK;
+}
 
-    /* modify the nodes */
-
-    ip_offset = offsetof(ipset_node_v4_t, ip);
-    assert(offsetof(ipset_node_v6_t, ip) >= ip_offset);
 
-    /* break the NODE_PTR() abstraction here.  Count from
-     * 'entry_count' down to 1, converting each node from a V4 node to
-     * a V6 node. */
-    node4 = &(((ipset_node_v4_t*)ipset->s.v3->nodes.buf)
-              [ipset->s.v3->nodes.entry_count-1]);
-    node6 = &(((ipset_node_v6_t*)ipset->s.v3->nodes.buf)
-              [ipset->s.v3->nodes.entry_count-1]);
+/*
+ *  num_ips = ipsetContainerCountIPs(cont);
+ *
+ *    Return the number of IPs in the /16 containers 'cont'.
+ */
+static uint64_t
+ipsetContainerCountIPs(
+    const skipset_cont_t   *cont)
+{
+    uint64_t num_ips = 0;
+    uint32_t i;
 
-    for (i = ipset->s.v3->nodes.entry_count - 1; i > 0; --i, --node4, --node6){
-        /* copy and convert the IP; must do the IP first, since its
-         * location is overwritten by the memmove() call */
-        node6->ip.ip[1] = UINT64_C(0xffff00000000) | node4->ip;
-        node6->ip.ip[0] = 0;
-        /* use memmove to copy the node except for the IP; must use
-         * memmove() since the nodes overlap */
-        memmove(node6, node4, ip_offset);
-        node6->prefix += 96;
-        /* node6->pad_align = 0 */
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (cont->slash16[i]) {
+            num_ips += ipsetSlash16CountIPs(cont->slash16[i]);
+        }
     }
-    assert(0 == i);
-    assert((void*)node4 == (void*)ipset->s.v3->nodes.buf);
-    assert((void*)node6 == (void*)ipset->s.v3->nodes.buf);
-
-    /* node-0 is unused; clear out the IP address */
-    node6->ip.ip[0] = 0;
-    node6->ip.ip[1] = 0;
+    return num_ips;
+}
 
-    /* repeat for the leaves */
 
-    ip_offset = offsetof(ipset_leaf_v4_t, ip);
-    assert(offsetof(ipset_leaf_v6_t, ip) >= ip_offset);
+/*
+ *  status = ipsetContainerInsertRange(cont, first, last);
+ *
+ *    Add the IPs from 'first' to 'last' inclusive to the /16
+ *    containers 'cont'.  A /16 that was empty or that becomes full is
+ *    given a list of runs, or an array when a single IP is added.
+ *    Return SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory
+ *    cannot be allocated.
+ */
+static int
+ipsetContainerInsertRange(
+    skipset_cont_t     *cont,
+    uint32_t            first,
+    uint32_t            last)
+{
+    ipset_slash16_t *node;
+    uint32_t key;
+    uint32_t lo;
+    uint32_t hi;
+    int rv;
 
-    /* break the LEAF_PTR() abstraction here.  Count from
-     * 'entry_count' down to 0, converting each leaf from a V4 leaf to
-     * a V6 leaf. */
-    leaf4 = &(((ipset_leaf_v4_t*)ipset->s.v3->leaves.buf)
-              [ipset->s.v3->leaves.entry_count-1]);
-    leaf6 = &(((ipset_leaf_v6_t*)ipset->s.v3->leaves.buf)
-              [ipset->s.v3->leaves.entry_count-1]);
+    assert(first <= last);
 
-    for (i = ipset->s.v3->leaves.entry_count - 1; i > 0; --i, --leaf4, --leaf6)
-    {
-        /* use memcpy to copy the leaf; can use memcpy, since leaf6 is
-         * twice the size of leaf4 */
-        memcpy(leaf6, leaf4, ip_offset);
-        leaf6->prefix += 96;
-        /* copy and convert the IP */
-        leaf6->ip.ip[1] = UINT64_C(0xffff00000000) | leaf4->ip;
-        leaf6->ip.ip[0] = 0;
+    for (key = first >> 16; key <= (last >> 16); ++key) {
+        lo = ((key == (first >> 16)) ? (first & 0xFFFF) : 0);
+        hi = ((key == (last >> 16)) ? (last & 0xFFFF) : 0xFFFF);
+        node = cont->slash16[key];
+        if (node && 0 == lo && 0xFFFF == hi) {
+            ipsetSlash16Destroy(node);
+            cont->slash16[key] = node = NULL;
+        }
+        if (node) {
+            rv = ipsetSlash16AddRange(node, lo, hi);
+            if (rv) {
+                return rv;
+            }
+        } else if (lo == hi) {
+            node = ipsetSlash16Create(SET_SLASH16_ARRAY, 0);
+            if (NULL == node) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            node->b.vals[0] = (uint16_t)lo;
+            node->count = 1;
+            cont->slash16[key] = node;
+        } else {
+            node = ipsetSlash16Create(SET_SLASH16_RUN, 0);
+            if (NULL == node) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            node->b.vals[0] = (uint16_t)lo;
+            node->b.vals[1] = (uint16_t)hi;
+            node->count = 1;
+            cont->slash16[key] = node;
+        }
     }
-    assert(0 == i);
-    assert((void*)leaf4 == (void*)ipset->s.v3->leaves.buf);
-    assert((void*)leaf6 == (void*)ipset->s.v3->leaves.buf);
-
-    /* clear the IP address in leaf-0 */
-    leaf6->ip.ip[0] = 0;
-    leaf6->ip.ip[1] = 0;
-
-  SET_ATTRIBUTES:
-    /* set the IPset attributes for IPv6 */
-    ipset->s.v3->nodes.entry_size = sizeof(ipset_node_v6_t);
-    ipset->s.v3->leaves.entry_size = sizeof(ipset_leaf_v6_t);
-    ipset->is_ipv6 = 1;
-    ipset->is_dirty = 1;
-
-    /* adjust the capacities.  this may result in a few wasted bytes
-     * until the next realloc() */
-    ipset->s.v3->nodes.entry_capacity
-        = (ipset->s.v3->nodes.entry_capacity
-           * sizeof(ipset_node_v4_t) / sizeof(ipset_node_v6_t));
-    assert(ipset->s.v3->nodes.entry_capacity >= ipset->s.v3->nodes.entry_count);
-    ipset->s.v3->leaves.entry_capacity
-        = (ipset->s.v3->leaves.entry_capacity
-           * sizeof(ipset_leaf_v4_t) / sizeof(ipset_leaf_v6_t));
-    assert(ipset->s.v3->leaves.entry_capacity
-           >= ipset->s.v3->leaves.entry_count);
-
     return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetConvertV6toV4(ipset);
+ *  status = ipsetContainerIntersect(dst, src);
  *
- *    Helper function for skIPSetConvert();
+ *    Helper function for skIPSetIntersect().
  *
- *    Convert the contents of 'ipset' so it contains only IPv4
- *    addresses.  This function should not be called on IPsets that
- *    contain IPv6 addresses outside of "::ffff:0.0.0.0/96".
+ *    Remove from the /16 containers 'dst' the IPs that are not in the
+ *    /16 containers 'src'.  Return SKIPSET_OK on success, or
+ *    SKIPSET_ERR_ALLOC if memory cannot be allocated.
  */
 static int
-ipsetConvertV6toV4(
-    skipset_t          *ipset)
+ipsetContainerIntersect(
+    skipset_cont_t         *dst,
+    const skipset_cont_t   *src)
 {
-    ipset_node_v6_t *node6;
-    ipset_node_v4_t *node4;
-    ipset_leaf_v6_t *leaf6;
-    ipset_leaf_v4_t *leaf4;
-    size_t ip_offset;
+    uint32_t *tmp;
     uint32_t i;
+    int rv = SKIPSET_OK;
 
-    assert(ipset);
-    assert(0 == ipset->is_iptree);
-    assert(sizeof(ipset_node_v6_t) == ipset->s.v3->nodes.entry_size);
-    assert(sizeof(ipset_leaf_v6_t) == ipset->s.v3->leaves.entry_size);
-    assert(0 == skIPSetContainsV6(ipset));
-
-    if (IPSET_ISEMPTY(ipset)) {
-        goto SET_ATTRIBUTES;
+    tmp = (uint32_t*)malloc(sizeof(skIPNode_t));
+    if (NULL == tmp) {
+        return SKIPSET_ERR_ALLOC;
     }
-
-    ip_offset = offsetof(ipset_node_v4_t, ip);
-    assert(offsetof(ipset_node_v6_t, ip) >= ip_offset);
-
-    /* break the NODE_PTR() abstraction here.  Count from 0 to
-     * 'entry_count', converting each node from a V6 node to a V4
-     * node. */
-    node4 = (ipset_node_v4_t*)ipset->s.v3->nodes.buf;
-    node6 = (ipset_node_v6_t*)ipset->s.v3->nodes.buf;
-
-    /* just need to set the IP to 0 for node 0 */
-    node4->ip = 0;
-
-    for (i = 1, ++node4, ++node6;
-         i < ipset->s.v3->nodes.entry_count;
-         ++i, ++node4, ++node6)
-    {
-        memmove(node4, node6, ip_offset);
-        node4->ip = (uint32_t)(node6->ip.ip[1] & UINT32_MAX);
-        node4->prefix -= 96;
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (NULL == dst->slash16[i]) {
+            continue;
+        }
+        if (src->slash16[i]) {
+            rv = ipsetSlash16Intersect(dst->slash16[i], src->slash16[i], tmp);
+            if (SKIPSET_ERR_ALLOC == rv) {
+                break;
+            }
+            if (SKIPSET_OK == rv) {
+                continue;
+            }
+            rv = SKIPSET_OK;
+        }
+        ipsetSlash16Destroy(dst->slash16[i]);
+        dst->slash16[i] = NULL;
     }
+    free(tmp);
+    return rv;
+}
 
 
-    /* Repeat the same process for the leaves */
-
-    ip_offset = offsetof(ipset_leaf_v4_t, ip);
-    assert(offsetof(ipset_leaf_v6_t, ip) >= ip_offset);
+/*
+ *  status = ipsetContainerMask(ipset, mask_prefix, fill);
+ *
+ *    Helper function for skIPSetMask() and skIPSetMaskAndFill().
+ *
+ *    Replace the /16 containers in 'ipset' with containers that have
+ *    one IP for each CIDR block of size 'mask_prefix' that holds any
+ *    IPs, or that have every IP in those blocks when 'fill' is
+ *    non-zero.  Return SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if
+ *    memory cannot be allocated, in which case 'ipset' is unchanged.
+ */
+static int
+ipsetContainerMask(
+    skipset_t          *ipset,
+    uint32_t            mask_prefix,
+    int                 fill)
+{
+    skipset_cont_t *masked;
+    uint32_t block_mask = (UINT32_MAX >> mask_prefix);
+    uint32_t key = 0;
+    uint32_t pos = 0;
+    uint32_t first;
+    uint32_t last;
+    uint32_t block;
+    int rv = SKIPSET_OK;
 
-    leaf4 = (ipset_leaf_v4_t*)ipset->s.v3->leaves.buf;
-    leaf6 = (ipset_leaf_v6_t*)ipset->s.v3->leaves.buf;
+    assert(ipset->is_container);
+    assert(0 < mask_prefix && mask_prefix < 32);
 
-    leaf4->ip = 0;
+    masked = (skipset_cont_t*)calloc(1, sizeof(skipset_cont_t));
+    if (NULL == masked) {
+        return SKIPSET_ERR_ALLOC;
+    }
 
-    for (i = 1, ++leaf4, ++leaf6;
-         i < ipset->s.v3->leaves.entry_count;
-         ++i, ++leaf4, ++leaf6)
+    while (SKIPSET_OK == rv
+           && ipsetContainerNextRange(ipset->s.cont, &key, &pos,
+                                      &first, &last))
     {
-        memcpy(leaf4, leaf6, ip_offset);
-        leaf4->ip = (uint32_t)(leaf6->ip.ip[1] & UINT32_MAX);
-        leaf4->prefix -= 96;
+        if (fill) {
+            rv = ipsetContainerInsertRange(masked, first & ~block_mask,
+                                           last | block_mask);
+            continue;
+        }
+        for (block = first & ~block_mask; ; block += block_mask + 1) {
+            rv = ipsetContainerInsertRange(masked, block, block);
+            if (rv || (block | block_mask) >= last) {
+                break;
+            }
+        }
+    }
+    if (rv) {
+        ipsetContainerRemoveAll(masked);
+        free(masked);
+        return rv;
     }
 
-  SET_ATTRIBUTES:
-    /* set the IPset attributes for IPv4 */
-    ipset->s.v3->nodes.entry_size = sizeof(ipset_node_v4_t);
-    ipset->s.v3->leaves.entry_size = sizeof(ipset_leaf_v4_t);
-    ipset->is_ipv6 = 0;
+    ipsetContainerRemoveAll(ipset->s.cont);
+    free(ipset->s.cont);
+    ipset->s.cont = masked;
     ipset->is_dirty = 1;
-
-    /* adjust the capacities.  this may result in a waste of a few
-     * bytes */
-    ipset->s.v3->nodes.entry_capacity
-        = (ipset->s.v3->nodes.entry_capacity
-           * sizeof(ipset_node_v6_t) / sizeof(ipset_node_v4_t));
-    ipset->s.v3->leaves.entry_capacity
-        = (ipset->s.v3->leaves.entry_capacity
-           * sizeof(ipset_leaf_v6_t) / sizeof(ipset_leaf_v4_t));
-
     return SKIPSET_OK;
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status  = ipsetCopyOnWrite(ipset);
- *
- *    Use the IPSET_COPY_ON_WRITE() macro to invoke this function,
- *    which only calls this function when necessary.
- *
- *    Change the IPset 'ipset' so that it uses in-core memory to hold
- *    its nodes instead of using mmap()ed data.  Return 0 on success,
- *    or SKIPSET_ERR_ALLOC if memory cannot be allocated.
+ *  found = ipsetContainerNextRange(cont, &key, &pos, &first, &last);
+ *
+ *    Find the next range of consecutive IPs in the /16 containers
+ *    'cont', set 'first' and 'last' to the range's first and last IP,
+ *    and return 1.  Return 0 when there are no more ranges.  A range
+ *    that ends at the top of a /16 is joined with a range that begins
+ *    at the bottom of the next /16.  'key' is the /16 being visited
+ *    and 'pos' is the position within it; both should be 0 on the
+ *    first call.  See ipsetSlash16NextRange().
  */
 static int
-ipsetCopyOnWrite(
-    skipset_t          *ipset)
+ipsetContainerNextRange(
+    const skipset_cont_t   *cont,
+    uint32_t               *key,
+    uint32_t               *pos,
+    uint32_t               *first,
+    uint32_t               *last)
 {
-    uint8_t *node_buf;
-    uint8_t *leaf_buf;
-    int rv;
+    uint32_t lo;
+    uint32_t hi;
 
-    assert(ipset->s.v3->mapped_file && ipset->s.v3->mapped_size);
+    for (;;) {
+        if (*key >= SKIP_BBLOCK_COUNT) {
+            return 0;
+        }
+        if (cont->slash16[*key]
+            && ipsetSlash16NextRange(cont->slash16[*key], pos, &lo, &hi))
+        {
+            break;
+        }
+        ++*key;
+        *pos = 0;
+    }
+    *first = (*key << 16) | lo;
+    *last = (*key << 16) | hi;
 
-    /* cache the current buffer values in case the allocation fails */
-    node_buf = ipset->s.v3->nodes.buf;
-    leaf_buf = ipset->s.v3->leaves.buf;
+    while (0xFFFF == hi) {
+        ++*key;
+        *pos = 0;
+        if (*key >= SKIP_BBLOCK_COUNT || NULL == cont->slash16[*key]) {
+            break;
+        }
+        if (!ipsetSlash16NextRange(cont->slash16[*key], pos, &lo, &hi)) {
+            break;
+        }
+        if (0 != lo) {
+            /* not contiguous; visit this range on the next call */
+            *pos = 0;
+            break;
+        }
+        *last = (*key << 16) | hi;
+    }
+    return 1;
+}
 
-    /* clear the values so we can allocate the space */
-    ipset->s.v3->nodes.buf = NULL;
-    ipset->s.v3->nodes.entry_capacity = 0;
-    ipset->s.v3->leaves.buf = NULL;
-    ipset->s.v3->leaves.entry_capacity = 0;
 
-    rv = ipsetAllocEntries(&ipset->s.v3->nodes, ipset->s.v3->nodes.entry_count);
-    if (rv) {
-        ipset->s.v3->nodes.buf = node_buf;
-        ipset->s.v3->nodes.entry_capacity = ipset->s.v3->nodes.entry_count;
-        ipset->s.v3->leaves.buf = leaf_buf;
-        ipset->s.v3->leaves.entry_capacity = ipset->s.v3->leaves.entry_count;
-        return rv;
-    }
-    rv = ipsetAllocEntries(&ipset->s.v3->nodes, ipset->s.v3->nodes.entry_count);
-    if (rv) {
-        free(ipset->s.v3->nodes.buf);
-        ipset->s.v3->nodes.buf = node_buf;
-        ipset->s.v3->nodes.entry_capacity = ipset->s.v3->nodes.entry_count;
-        ipset->s.v3->leaves.buf = leaf_buf;
-        ipset->s.v3->leaves.entry_capacity = ipset->s.v3->leaves.entry_count;
-        return rv;
+/*
+ *  ipsetContainerRemoveAll(cont);
+ *
+ *    Free all the /16 containers in 'cont'.  Do not free 'cont'.
+ */
+static void
+ipsetContainerRemoveAll(
+    skipset_cont_t     *cont)
+{
+    uint32_t i;
+
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (cont->slash16[i]) {
+            ipsetSlash16Destroy(cont->slash16[i]);
+            cont->slash16[i] = NULL;
+        }
     }
+}
 
-    /* copy the mmap()ed data into the newly allocated space */
-    memcpy(ipset->s.v3->nodes.buf, node_buf,
-           (ipset->s.v3->nodes.entry_count * ipset->s.v3->nodes.entry_size));
-    memcpy(ipset->s.v3->leaves.buf, leaf_buf,
-           (ipset->s.v3->leaves.entry_count * ipset->s.v3->leaves.entry_size));
 
-    /* unmap the space */
-    munmap(ipset->s.v3->mapped_file, ipset->s.v3->mapped_size);
+/*
+ *  status = ipsetContainerRemoveRange(cont, first, last);
+ *
+ *    Remove the IPs from 'first' to 'last' inclusive from the /16
+ *    containers 'cont'.  Return SKIPSET_OK on success, or
+ *    SKIPSET_ERR_ALLOC if memory cannot be allocated.
+ */
+static int
+ipsetContainerRemoveRange(
+    skipset_cont_t     *cont,
+    uint32_t            first,
+    uint32_t            last)
+{
+    ipset_slash16_t *node;
+    uint32_t key;
+    uint32_t lo;
+    uint32_t hi;
+    int rv;
 
-    ipset->s.v3->mapped_file = NULL;
-    ipset->s.v3->mapped_size = 0;
+    assert(first <= last);
 
+    for (key = first >> 16; key <= (last >> 16); ++key) {
+        node = cont->slash16[key];
+        if (NULL == node) {
+            continue;
+        }
+        lo = ((key == (first >> 16)) ? (first & 0xFFFF) : 0);
+        hi = ((key == (last >> 16)) ? (last & 0xFFFF) : 0xFFFF);
+        if (0 == lo && 0xFFFF == hi) {
+            rv = SKIPSET_ERR_EMPTY;
+        } else {
+            rv = ipsetSlash16RemoveRange(node, lo, hi);
+        }
+        if (SKIPSET_ERR_EMPTY == rv) {
+            ipsetSlash16Destroy(node);
+            cont->slash16[key] = NULL;
+        } else if (rv) {
+            return rv;
+        }
+    }
     return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetCountCallbackV4(ipv4, prefix, &count_state)
- *  status = ipsetCountCallbackV6(ipv6, prefix, &count_state)
+ *  status = ipsetContainerSubtract(dst, src);
  *
- *    Helper function for skIPSetCount().
+ *    Helper function for skIPSetSubtract().
  *
- *    Compute (1 << 'prefix') to get the number of IPs in this block
- *    and update the count in 'count_state'.
+ *    Remove from the /16 containers 'dst' the IPs that are in the /16
+ *    containers 'src'.  Return SKIPSET_OK on success, or
+ *    SKIPSET_ERR_ALLOC if memory cannot be allocated.
  */
 static int
-ipsetCountCallbackV4(
-    uint32_t     UNUSED(ipv4),
-    uint32_t            prefix,
-    void               *v_count_state)
+ipsetContainerSubtract(
+    skipset_cont_t         *dst,
+    const skipset_cont_t   *src)
 {
-    ipset_count_t *count_state = (ipset_count_t*)v_count_state;
+    uint32_t i;
+    int rv;
 
-    count_state->lower += ((uint64_t)1) << (32 - prefix);
-    return 0;
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (NULL == dst->slash16[i] || NULL == src->slash16[i]) {
+            continue;
+        }
+        rv = ipsetSlash16Subtract(dst->slash16[i], src->slash16[i]);
+        if (SKIPSET_ERR_EMPTY == rv) {
+            ipsetSlash16Destroy(dst->slash16[i]);
+            dst->slash16[i] = NULL;
+        } else if (rv) {
+            return rv;
+        }
+    }
+    return SKIPSET_OK;
 }
 
-#if SK_ENABLE_IPV6
+
+/*
+ *  status = ipsetContainerUnion(dst, src);
+ *
+ *    Helper function for skIPSetUnion().
+ *
+ *    Add to the /16 containers 'dst' the IPs in the /16 containers
+ *    'src'.  Return SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if
+ *    memory cannot be allocated.
+ */
 static int
-ipsetCountCallbackV6(
-    const ipset_ipv6_t  UNUSED(*ipv6),
-    uint32_t                    prefix,
-    void                       *v_count_state)
+ipsetContainerUnion(
+    skipset_cont_t         *dst,
+    const skipset_cont_t   *src)
 {
-    ipset_count_t *count_state = (ipset_count_t*)v_count_state;
-    uint64_t tmp;
+    uint32_t *tmp;
+    uint32_t i;
+    int rv = SKIPSET_OK;
 
-    if (prefix <= 64) {
-        count_state->upper += (((uint64_t)1) << (64 - prefix));
-    } else {
-        tmp = (((uint64_t)1) << (128 - prefix));
-        if ((UINT64_MAX - count_state->lower) > tmp) {
-            count_state->lower += tmp;
+    tmp = (uint32_t*)malloc(sizeof(skIPNode_t));
+    if (NULL == tmp) {
+        return SKIPSET_ERR_ALLOC;
+    }
+    for (i = 0; i < SKIP_BBLOCK_COUNT && SKIPSET_OK == rv; ++i) {
+        if (NULL == src->slash16[i]) {
+            continue;
+        }
+        if (dst->slash16[i]) {
+            rv = ipsetSlash16Union(dst->slash16[i], src->slash16[i], tmp);
         } else {
-            ++count_state->upper;
-            count_state->lower -= ((UINT64_MAX - tmp) + 1);
+            dst->slash16[i] = ipsetSlash16Copy(src->slash16[i]);
+            if (NULL == dst->slash16[i]) {
+                rv = SKIPSET_ERR_ALLOC;
+            }
         }
     }
-
-    return 0;
+    free(tmp);
+    return rv;
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
+#if SK_ENABLE_IPV6
 /*
- *  occupied = ipsetCountOccupiedLeaves(ipset);
+ *  status = ipsetConvertContainertoV6(ipset);
  *
- *    Return the number of occupied leaves in 'ipset'.
+ *    Convert the contents of an IPset that uses /16 containers to a
+ *    SiLK-3 based IPv6 IPset.  The IPv4 addresses in the IPset will
+ *    be mapped into the "::ffff:0.0.0.0/96" address space.  Return
+ *    SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory cannot be
+ *    allocated to hold the IPv6 addresses.
  */
-static uint32_t
-ipsetCountOccupiedLeaves(
-    const skipset_t    *ipset)
+static int
+ipsetConvertContainertoV6(
+    skipset_t          *ipset)
 {
-    const ipset_leaf_t *leaf;
-    uint32_t leaves_in_use;
-    uint32_t leaves_free_idx;
+    skipset_t *tmp_ipset;
+    skipset_cont_t *cont;
+    int rv;
 
-    /* handle a leaf at the root as a special case */
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        return 1;
-    }
+    assert(ipset);
+    assert(1 == ipset->is_container);
+    assert(0 == ipset->no_autoconvert);
 
-    /* determine the number of leaves currently in use by subtracting
-     * the leaves on the free list from the total number of leaves */
-    leaves_in_use = ipset->s.v3->leaves.entry_count;
-    for (leaves_free_idx = ipset->s.v3->leaves.free_list;
-         0 != leaves_free_idx;
-         leaves_free_idx = LEAFPTR_FREE_LIST(leaf))
-    {
-        assert(leaves_free_idx < ipset->s.v3->leaves.entry_count);
-        --leaves_in_use;
-        leaf = LEAF_PTR(ipset, leaves_free_idx);
+    rv = ipsetCreate(&tmp_ipset, 1, 1);
+    if (rv) {
+        return rv;
     }
-
-    if (ipset->s.v3->leaves.entry_count < leaves_in_use) {
-        skAbort();
+    rv = ipsetWalkContainer(ipset, 1, SK_IPV6POLICY_FORCE,
+                            &ipsetUnionCallback, (void*)tmp_ipset);
+    if (rv) {
+        skIPSetDestroy(&tmp_ipset);
+        return rv;
     }
 
-    return leaves_in_use;
+    /* swap the bodies and destroy the containers */
+    cont = ipset->s.cont;
+    ipset->s.v3 = tmp_ipset->s.v3;
+    ipset->is_container = 0;
+    ipset->is_ipv6 = 1;
+    ipset->is_dirty = 1;
+
+    tmp_ipset->s.cont = cont;
+    tmp_ipset->is_container = 1;
+    tmp_ipset->is_ipv6 = 0;
+    skIPSetDestroy(&tmp_ipset);
+
+    skIPSetClean(ipset);
+
+    return SKIPSET_OK;
 }
+#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetCreate(ipset, support_ipv6, force_radix);
- *
- *    Helper function for skIPSetCreate() and used internally.
- *
- *    Allocates and initializes a new IPset at the space specified by
- *    '*ipset'.  The set is initially empty.  When 'support_ipv6' is
- *    non-zero, the IPset will be initialized to store IPv6 addresses;
- *    otherwise it will be initialized to hold IPv4 addresses.  When
- *    creating an IPv4 IPset, the IPTree format from SiLK-2 will be
- *    used unless the 'force_radix' parameter has a non-zero value.
+ *  status = ipsetConvertIPTreetoContainer(ipset);
+ *
+ *    Convert the contents of a SiLK-2 based IPset (IPTree) to /16
+ *    containers.  The bitmap of each skIPNode_t becomes the bitmap of
+ *    a container, and the IPset is cleaned so each /16 uses its
+ *    smallest container.  Return SKIPSET_OK on success, or
+ *    SKIPSET_ERR_ALLOC if memory cannot be allocated, in which case
+ *    'ipset' is unchanged.
  */
 static int
-ipsetCreate(
-    skipset_t         **ipset_out,
-    int                 support_ipv6,
-    int                 force_radix)
+ipsetConvertIPTreetoContainer(
+    skipset_t          *ipset)
 {
-    skipset_t *set;
+    skIPTree_t *iptree;
+    skipset_cont_t *cont;
+    ipset_slash16_t *node;
+    uint32_t i;
 
-    assert(ipset_out);
+    assert(ipset);
+    assert(1 == ipset->is_iptree);
 
-    set = (skipset_t*)calloc(1, sizeof(skipset_t));
-    if (!set) {
+    cont = (skipset_cont_t*)calloc(1, sizeof(skipset_cont_t));
+    if (NULL == cont) {
         return SKIPSET_ERR_ALLOC;
     }
 
-    if (support_ipv6) {
-        set->s.v3 = (skipset_v3_t*)calloc(1, sizeof(skipset_v3_t));
-        if (!set->s.v3) {
-            free(set);
-            return SKIPSET_ERR_ALLOC;
-        }
-        set->s.v3->nodes.entry_size = sizeof(ipset_node_v6_t);
-        set->s.v3->leaves.entry_size = sizeof(ipset_leaf_v6_t);
-        set->is_ipv6 = 1;
-        set->is_iptree = 0;
-    } else if (force_radix) {
-        set->s.v3 = (skipset_v3_t*)calloc(1, sizeof(skipset_v3_t));
-        if (!set->s.v3) {
-            free(set);
-            return SKIPSET_ERR_ALLOC;
+    iptree = ipset->s.v2;
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (NULL == iptree->nodes[i]) {
+            continue;
         }
-        set->s.v3->nodes.entry_size = sizeof(ipset_node_v4_t);
-        set->s.v3->leaves.entry_size = sizeof(ipset_leaf_v4_t);
-        set->is_ipv6 = 0;
-        set->is_iptree = 0;
-    } else {
-        if (skIPTreeCreate(&set->s.v2)) {
-            free(set);
+        node = (ipset_slash16_t*)calloc(1, sizeof(ipset_slash16_t));
+        if (NULL == node) {
+            /* return the bitmaps to the IPTree */
+            while (i > 0) {
+                --i;
+                if (cont->slash16[i]) {
+                    iptree->nodes[i] = (skIPNode_t*)cont->slash16[i]->b.bmap;
+                    free(cont->slash16[i]);
+                }
+            }
+            free(cont);
             return SKIPSET_ERR_ALLOC;
         }
-        set->is_ipv6 = 0;
-        set->is_iptree = 1;
+        node->type = SET_SLASH16_BITMAP;
+        node->b.bmap = iptree->nodes[i]->addressBlock;
+        cont->slash16[i] = node;
+        iptree->nodes[i] = NULL;
     }
 
-    *ipset_out = set;
-    return SKIPSET_OK;
-
+    skIPTreeDelete(&iptree);
+    ipset->s.cont = cont;
+    ipset->is_iptree = 0;
+    ipset->is_container = 1;
+    ipset->is_dirty = 1;
 
+    return skIPSetClean(ipset);
 }
 
 
+#if SK_ENABLE_IPV6
 /*
- *  ipsetDestroySubtree(ipset, node_idx, destroy_self);
+ *  status = ipsetConvertIPTreetoV6(ipset);
  *
- *    Puts all the child nodes of 'node_idx' onto the free list.  If
- *    'destroy_self' is non-zero, the 'node_idx' node is also added to
- *    the free list.  If 'destroy_self' is zero, the child indexes on
- *    'node_idx' are set to 0.
+ *    Convert the contents of a SiLK-2 based IPset (IPTree) to a
+ *    SiLK-3 based IPv6 IPset.  The IPv4 addresses in the IPset will
+ *    be mapped into the "::ffff:0.0.0.0/96" address space.  Return
+ *    SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory cannot be
+ *    allocated to hold the IPv6 addresses.
  */
-static void
-ipsetDestroySubtree(
-    skipset_t          *ipset,
-    uint32_t            node_idx,
-    int                 destroy_self)
+static int
+ipsetConvertIPTreetoV6(
+    skipset_t          *ipset)
 {
-    uint32_t to_visit[IPSET_MAX_DEPTH];
-    uint32_t depth = 0;
-    ipset_node_t *node;
-    int i;
+    skipset_t *tmp_ipset;
+    skIPTree_t *iptree;
+    skIPTreeCIDRBlockIterator_t cidr_iter;
+    skIPTreeCIDRBlock_t cidr;
+    skipaddr_t ipaddr;
+    int rv;
 
-    if (destroy_self) {
-        /* add this node to the list of nodes to destroy */
-        to_visit[depth++] = node_idx;
-    } else {
-        /* destroy any leaves off of this node; add this node's child
-         * nodes to the list list of nodes to destroy */
-        node = NODE_PTR(ipset, node_idx);
-        for (i = 0; i < IPSET_NUM_CHILDREN; ++i) {
-            if (node->v4.child[i]
-                && !NODEPTR_CHILD_IS_REPEAT(&node->v4, i))
-            {
-                if (NODEPTR_CHILD_IS_LEAF(&node->v4, i)) {
-                    LEAFIDX_FREE(ipset, node->v4.child[i]);
-                } else {
-                    to_visit[depth++] = node->v4.child[i];
-                }
-            }
-        }
-        /* clear the child array and bitmaps */
-        memset(node->v4.child, 0, sizeof(node->v4.child));
-        SET_BMAP_CLEAR_ALL(node->v4.child_is_leaf);
-        SET_BMAP_CLEAR_ALL(node->v4.child_repeated);
+    assert(ipset);
+    assert(1 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
+    assert(0 == ipset->no_autoconvert);
+
+    rv = ipsetCreate(&tmp_ipset, 1, 1);
+    if (rv) {
+        return rv;
     }
 
-    while (depth) {
-        node_idx = to_visit[--depth];
-        node = NODE_PTR(ipset, node_idx);
-        for (i = 0; i < IPSET_NUM_CHILDREN; ++i) {
-            if (node->v4.child[i]
-                && !NODEPTR_CHILD_IS_REPEAT(&node->v4, i))
-            {
-                if (NODEPTR_CHILD_IS_LEAF(&node->v4, i)) {
-                    LEAFIDX_FREE(ipset, node->v4.child[i]);
-                } else {
-                    to_visit[depth++] = node->v4.child[i];
-                }
-            }
+    iptree = ipset->s.v2;
+    ipset->s.v3 = tmp_ipset->s.v3;
+    ipset->is_iptree = 0;
+    ipset->is_ipv6 = 1;
+
+    ASSERT_OK(skIPTreeCIDRBlockIteratorBind(&cidr_iter, iptree));
+    while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
+           == SK_ITERATOR_OK)
+    {
+        skipaddrSetV6FromUint32(&ipaddr, &cidr.addr);
+        cidr.mask += 96;
+
+        rv = skIPSetInsertAddress(ipset, &ipaddr, cidr.mask);
+        if (rv) {
+            /* restore ipset to its original settings */
+            ipset->s.v2 = iptree;
+            ipset->is_iptree = 1;
+            ipset->is_ipv6 = 0;
+
+            skIPSetDestroy(&tmp_ipset);
+            return rv;
         }
-        NODEIDX_FREE(ipset, node_idx);
     }
+
+    tmp_ipset->is_ipv6 = 0;
+    tmp_ipset->is_iptree = 1;
+    tmp_ipset->s.v2 = iptree;
+
+    skIPSetDestroy(&tmp_ipset);
+
+    skIPSetClean(ipset);
+
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetFindV4(ipset, ip, prefix, &find_state);
- *  status = ipsetFindV6(ipset, ip, prefix, &find_state);
- *
- *    Searches for 'ip'/'prefix' in the Radix-tree based 'ipset'.
- *    'ip' is an integer presentation of the IP address in native byte
- *    order.
- *
- *    Returns SKIPSET_OK if it is found exactly or if a CIDR block
- *    containing it is found: searching for 10.0.0.2 and find
- *    10.0.0.0/24.
- *
- *    Returns SKIPSET_ERR_SUBSET when a subset of target is found:
- *    search for 10.0.0.0/24 and find 10.0.0.2.
- *
- *    Returns SKIPSET_ERR_EMPTY if the IPset is empty.
+ *  status = ipsetConvertV4toV6(ipset);
  *
- *    Returns SKIPSET_ERR_MULTILEAF if it is not found but the search
- *    failed at a position where a leaf can be inserted.
+ *    Helper function for skIPSetConvert();
  *
- *    Returns SKIPSET_ERR_NOTFOUND if it is not found and the
- *    SKIPSET_ERR_MULTILEAF case does not apply.
+ *    Convert the contents of a Radix-Tree based 'ipset' so it
+ *    contains IPv6 addresses.
  *
- *    When 'find_state' is non-NULL, its fields will be set to the
- *    final location visited in the tree.  Specifically, 'node_idx' is
- *    set to the index of the node where the search terminated;
- *    'bitpos' is set to the number of bits of the IP address that
- *    were searched; 'parent_idx' is set to the index of the parent of
- *    the node in 'node_idx'.  If 'node_idx' is the root of the tree,
- *    'parent_idx' will be UINT32_MAX; 'result' will be the same as
- *    the return status of the function.
+ *    The IPv4 addresses in the IPset will be mapped into the
+ *    "::ffff:0.0.0.0/96" address space.  Return SKIPSET_OK on
+ *    success, or SKIPSET_ERR_ALLOC if memory cannot be allocated to
+ *    hold the IPv6 addresses.
  */
 static int
-ipsetFindV4(
-    const skipset_t    *ipset,
-    const uint32_t      ipv4,
-    const uint32_t      prefix,
-    ipset_find_t       *find_state)
+ipsetConvertV4toV6(
+    skipset_t          *ipset)
 {
-    const ipset_node_v4_t *node;
-    const ipset_leaf_v4_t *leaf = NULL;
-    uint32_t parent_idx;
-    uint32_t node_idx;
-    uint32_t which_child;
-    uint32_t j;
-    uint8_t bitpos;
+    ipset_node_v6_t *node6;
+    ipset_node_v4_t *node4;
+    ipset_leaf_v6_t *leaf6;
+    ipset_leaf_v4_t *leaf4;
+    size_t num_entries;
+    size_t ip_offset;
+    uint32_t i;
     int rv;
 
-    /*
-     *  The 'bitpos' value specifies the number of bits that match
-     *  between the IP on the current node/leaf and the search IP
-     *  (starting from the most significant bit).
-     *
-     *  On a node at any level in the tree, if bitpos is less than the
-     *  prefix on that node, we cannot descend to the next level in
-     *  the tree.  Otherwise, before descending, we check to see
-     *  whether the node's prefix is greater than the search prefix;
-     *  if it is, there is no need to continue and the function
-     *  returns SUBSET.
-     *
-     *  Whether the descent into the tree stops due to reaching a leaf
-     *  or due to not matching enough bits on a node, the return
-     *  status depends on three values: (1)the number of bits that
-     *  were matched, (2)the prefix on the node/leaf, and (3)the
-     *  search prefix.  If bitpos is less than the search prefix, the
-     *  search failed and NOTFOUND is returned.  If both bitpos and
-     *  the search prefix are at least equal to the prefix on the
-     *  node/leaf, the search returns OK.  For any other combination,
-     *  the search returns SUBSET.
-     *
-     *  If the search is on the node and wants to descend into the
-     *  tree but there is no child at that position, the search either
-     *  returns SUBSET or MULTILEAF.  The search returns SUBSET if the
-     *  search prefix covers multiple children on the node and at
-     *  least one of those children is occupied.  Otherwise, the
-     *  search returns MULTILEAF, denoting that a leaf can be safely
-     *  added at this position.
-     */
-
     assert(ipset);
-    assert(prefix > 0 || ipv4 == 0);
-    assert(prefix <= 32);
     assert(0 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
-
-    parent_idx = IPSET_NO_PARENT;
-    node_idx = IPSET_ROOT_INDEX(ipset);
-    which_child = IPSET_NUM_CHILDREN;
-    bitpos = 0;
-    rv = SKIPSET_ERR_SUBSET;
+    assert(sizeof(ipset_node_v4_t) == ipset->s.v3->nodes.entry_size);
 
     if (IPSET_ISEMPTY(ipset)) {
-        rv = SKIPSET_ERR_EMPTY;
-        goto END;
+        goto SET_ATTRIBUTES;
     }
 
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        leaf = LEAF_PTR_V4(ipset, node_idx);
-        /* find number of bits this leaf's IP and the search IP have
-         * in common */
-        COUNT_MATCHING_BITS32(&bitpos, (ipv4 ^ (leaf->ip)));
-        if (bitpos < leaf->prefix) {
-            if (bitpos < prefix) {
-                /* not found */
-                rv = SKIPSET_ERR_NOTFOUND;
-            } else {
-                bitpos = prefix;
-                /* rv = SKIPSET_ERR_SUBSET; */
-            }
-        } else {
-            /* make certain bitpos is not greater than this leaf's
-             * prefix */
-            bitpos = leaf->prefix;
-            if (prefix >= leaf->prefix) {
-                rv = SKIPSET_OK;
-            }
-            /* else rv = SKIPSET_ERR_SUBSET; */
+    /* compute the number of bytes required to hold the nodes once
+     * they are converted to IPv6, then divide by the IPv4 node size
+     * to get the number of IPv4 nodes to request.  The -1/+1 handle a
+     * partial node. */
+    num_entries
+        = (((ipset->s.v3->nodes.entry_count * sizeof(ipset_node_v6_t) - 1)
+            / sizeof(ipset_node_v4_t)) + 1);
+    if (num_entries > ipset->s.v3->nodes.entry_capacity) {
+        rv = ipsetAllocEntries(&ipset->s.v3->nodes, num_entries);
+        if (rv) {
+            return rv;
         }
-        goto END;
     }
 
-    do {
-        assert(node_idx < ipset->s.v3->nodes.entry_count);
-        node = NODE_PTR_V4(ipset, node_idx);
-        if (bitpos < node->prefix) {
-            COUNT_MATCHING_BITS32(&bitpos, (ipv4 ^ (node->ip)));
-            if (bitpos < node->prefix) {
-                /* cannot descend any farther into tree */
-                if (bitpos < prefix) {
-                    /* not found */
-                    rv = SKIPSET_ERR_NOTFOUND;
-                    goto END;
-                }
-                bitpos = prefix;
-                /* rv = SKIPSET_ERR_SUBSET; */
-                goto END;
-            }
-            /* else bitpos >= node->prefix */
-            if (prefix <= node->prefix) {
-                bitpos = prefix;
-                /* rv = SKIPSET_ERR_SUBSET; */
-                goto END;
-            }
-            /* else descend to next level */
+    /* repeat for the leaves */
+    num_entries
+        = (((ipset->s.v3->leaves.entry_count * sizeof(ipset_leaf_v6_t) - 1)
+            / sizeof(ipset_leaf_v4_t)) + 1);
+    if (num_entries > ipset->s.v3->leaves.entry_capacity) {
+        rv = ipsetAllocEntries(&ipset->s.v3->leaves, num_entries);
+        if (rv) {
+            return rv;
         }
+    }
 
-        /* go to the appropriate child */
-        parent_idx = node_idx;
-        which_child = WHICH_CHILD_V4(ipv4, node->prefix);
-        node_idx = node->child[which_child];
-        if (0 == node_idx) {
-            if (NUM_BITS > prefix - node->prefix) {
-                /* the 'prefix' covers multiple child[] entries; see
-                 * if any others are occupied */
-                for (j = 1;
-                     ((j < (1u << (NUM_BITS - (prefix - node->prefix))))
-                      && ((which_child + j) < IPSET_NUM_CHILDREN));
-                     ++j)
-                {
-                    if (node->child[which_child + j]) {
-                        /* rv = SKIPSET_ERR_SUBSET; */
-                        goto END;
-                    }
-                }
-            }
-            node_idx = which_child;
-            rv = SKIPSET_ERR_MULTILEAF;
-            goto END;
-        }
-        if (BITMAP_GETBIT(node->child_is_leaf, which_child)) {
-            leaf = LEAF_PTR_V4(ipset, node_idx);
-            COUNT_MATCHING_BITS32(&bitpos, (ipv4 ^ (leaf->ip)));
-            if (bitpos < leaf->prefix) {
-                if (bitpos < prefix) {
-                    /* not found */
-                    rv = SKIPSET_ERR_NOTFOUND;
-                } else {
-                    bitpos = prefix;
-                    /* rv = SKIPSET_ERR_SUBSET; */
-                }
-            } else {
-                bitpos = leaf->prefix;
-                if (prefix >= leaf->prefix) {
-                    rv = SKIPSET_OK;
-                }
-                /* else rv = SKIPSET_ERR_SUBSET; */
-            }
-            goto END;
-        }
+    /* modify the nodes */
 
-        bitpos = node->prefix + NUM_BITS;
+    ip_offset = offsetof(ipset_node_v4_t, ip);
+    assert(offsetof(ipset_node_v6_t, ip) >= ip_offset);
 
-    } while (bitpos < prefix);
+    /* break the NODE_PTR() abstraction here.  Count from
+     * 'entry_count' down to 1, converting each node from a V4 node to
+     * a V6 node. */
+    node4 = &(((ipset_node_v4_t*)ipset->s.v3->nodes.buf)
+              [ipset->s.v3->nodes.entry_count-1]);
+    node6 = &(((ipset_node_v6_t*)ipset->s.v3->nodes.buf)
+              [ipset->s.v3->nodes.entry_count-1]);
 
-  END:
-    if (find_state) {
-        find_state->parent_idx = parent_idx;
-        find_state->node_idx = node_idx;
-        find_state->parents_child = which_child;
-        find_state->bitpos = bitpos;
-        find_state->result = rv;
-        find_state->node_is_leaf = (leaf != NULL);
+    for (i = ipset->s.v3->nodes.entry_count - 1; i > 0; --i, --node4, --node6){
+        /* copy and convert the IP; must do the IP first, since its
+         * location is overwritten by the memmove() call */
+        node6->ip.ip[1] = UINT64_C(0xffff00000000) | node4->ip;
+        node6->ip.ip[0] = 0;
+        /* use memmove to copy the node except for the IP; must use
+         * memmove() since the nodes overlap */
+        memmove(node6, node4, ip_offset);
+        node6->prefix += 96;
+        /* node6->pad_align = 0 */
     }
-    return rv;
+    assert(0 == i);
+    assert((void*)node4 == (void*)ipset->s.v3->nodes.buf);
+    assert((void*)node6 == (void*)ipset->s.v3->nodes.buf);
+
+    /* node-0 is unused; clear out the IP address */
+    node6->ip.ip[0] = 0;
+    node6->ip.ip[1] = 0;
+
+    /* repeat for the leaves */
+
+    ip_offset = offsetof(ipset_leaf_v4_t, ip);
+    assert(offsetof(ipset_leaf_v6_t, ip) >= ip_offset);
+
+    /* break the LEAF_PTR() abstraction here.  Count from
+     * 'entry_count' down to 0, converting each leaf from a V4 leaf to
+     * a V6 leaf. */
+    leaf4 = &(((ipset_leaf_v4_t*)ipset->s.v3->leaves.buf)
+              [ipset->s.v3->leaves.entry_count-1]);
+    leaf6 = &(((ipset_leaf_v6_t*)ipset->s.v3->leaves.buf)
+              [ipset->s.v3->leaves.entry_count-1]);
+
+    for (i = ipset->s.v3->leaves.entry_count - 1; i > 0; --i, --leaf4, --leaf6)
+    {
+        /* use memcpy to copy the leaf; can use memcpy, since leaf6 is
+         * twice the size of leaf4 */
+        memcpy(leaf6, leaf4, ip_offset);
+        leaf6->prefix += 96;
+        /* copy and convert the IP */
+        leaf6->ip.ip[1] = UINT64_C(0xffff00000000) | leaf4->ip;
+        leaf6->ip.ip[0] = 0;
+    }
+    assert(0 == i);
+    assert((void*)leaf4 == (void*)ipset->s.v3->leaves.buf);
+    assert((void*)leaf6 == (void*)ipset->s.v3->leaves.buf);
+
+    /* clear the IP address in leaf-0 */
+    leaf6->ip.ip[0] = 0;
+    leaf6->ip.ip[1] = 0;
+
+  SET_ATTRIBUTES:
+    /* set the IPset attributes for IPv6 */
+    ipset->s.v3->nodes.entry_size = sizeof(ipset_node_v6_t);
+    ipset->s.v3->leaves.entry_size = sizeof(ipset_leaf_v6_t);
+    ipset->is_ipv6 = 1;
+    ipset->is_dirty = 1;
+
+    /* adjust the capacities.  this may result in a few wasted bytes
+     * until the next realloc() */
+    ipset->s.v3->nodes.entry_capacity
+        = (ipset->s.v3->nodes.entry_capacity
+           * sizeof(ipset_node_v4_t) / sizeof(ipset_node_v6_t));
+    assert(ipset->s.v3->nodes.entry_capacity >= ipset->s.v3->nodes.entry_count);
+    ipset->s.v3->leaves.entry_capacity
+        = (ipset->s.v3->leaves.entry_capacity
+           * sizeof(ipset_leaf_v4_t) / sizeof(ipset_leaf_v6_t));
+    assert(ipset->s.v3->leaves.entry_capacity
+           >= ipset->s.v3->leaves.entry_count);
+
+    return SKIPSET_OK;
 }
 
-#if SK_ENABLE_IPV6
+
+/*
+ *  status = ipsetConvertV6toV4(ipset);
+ *
+ *    Helper function for skIPSetConvert();
+ *
+ *    Convert the contents of 'ipset' so it contains only IPv4
+ *    addresses.  This function should not be called on IPsets that
+ *    contain IPv6 addresses outside of "::ffff:0.0.0.0/96".
+ */
 static int
-ipsetFindV6(
-    const skipset_t    *ipset,
-    const ipset_ipv6_t *ipv6,
-    const uint32_t      prefix,
-    ipset_find_t       *find_state)
+ipsetConvertV6toV4(
+    skipset_t          *ipset)
 {
-    const ipset_node_v6_t *node;
-    const ipset_leaf_v6_t *leaf = NULL;
-    uint32_t parent_idx;
-    uint32_t node_idx;
-    uint32_t which_child;
-    uint8_t bitpos;
-    uint32_t j;
-    int ip_idx;
-    int rv;
+    ipset_node_v6_t *node6;
+    ipset_node_v4_t *node4;
+    ipset_leaf_v6_t *leaf6;
+    ipset_leaf_v4_t *leaf4;
+    size_t ip_offset;
+    uint32_t i;
 
     assert(ipset);
-    assert(ipv6);
-    assert(0 < prefix && prefix <= 128);
     assert(0 == ipset->is_iptree);
-    assert(1 == ipset->is_ipv6);
-
-    parent_idx = IPSET_NO_PARENT;
-    node_idx = IPSET_ROOT_INDEX(ipset);
-    which_child = IPSET_NUM_CHILDREN;
-    bitpos = 0;
-    ip_idx = 0;
-    rv = SKIPSET_ERR_SUBSET;
+    assert(sizeof(ipset_node_v6_t) == ipset->s.v3->nodes.entry_size);
+    assert(sizeof(ipset_leaf_v6_t) == ipset->s.v3->leaves.entry_size);
+    assert(0 == skIPSetContainsV6(ipset));
 
     if (IPSET_ISEMPTY(ipset)) {
-        rv = SKIPSET_ERR_EMPTY;
-        goto END;
+        goto SET_ATTRIBUTES;
     }
 
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        leaf = LEAF_PTR_V6(ipset, node_idx);
-        /* find number of bits this leaf's IP and the search IP have
-         * in common */
-        if (ipv6->ip[0] == leaf->ip.ip[0]) {
-            COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[1] ^ leaf->ip.ip[1]));
-            bitpos += 64;
-        } else {
-            COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[0] ^ leaf->ip.ip[0]));
-        }
-        if (bitpos < leaf->prefix) {
-            if (bitpos < prefix) {
-                /* not found */
-                rv = SKIPSET_ERR_NOTFOUND;
-            } else {
-                bitpos = prefix;
-                /* rv = SKIPSET_ERR_SUBSET; */
-            }
-        } else {
-            /* make certain bitpos is not greater than this leaf's
-             * prefix */
-            bitpos = leaf->prefix;
-            if (prefix >= leaf->prefix) {
-                rv = SKIPSET_OK;
-            }
-            /* else rv = SKIPSET_ERR_SUBSET; */
-        }
-        goto END;
+    ip_offset = offsetof(ipset_node_v4_t, ip);
+    assert(offsetof(ipset_node_v6_t, ip) >= ip_offset);
+
+    /* break the NODE_PTR() abstraction here.  Count from 0 to
+     * 'entry_count', converting each node from a V6 node to a V4
+     * node. */
+    node4 = (ipset_node_v4_t*)ipset->s.v3->nodes.buf;
+    node6 = (ipset_node_v6_t*)ipset->s.v3->nodes.buf;
+
+    /* just need to set the IP to 0 for node 0 */
+    node4->ip = 0;
+
+    for (i = 1, ++node4, ++node6;
+         i < ipset->s.v3->nodes.entry_count;
+         ++i, ++node4, ++node6)
+    {
+        memmove(node4, node6, ip_offset);
+        node4->ip = (uint32_t)(node6->ip.ip[1] & UINT32_MAX);
+        node4->prefix -= 96;
     }
 
-    do {
-        assert(node_idx < ipset->s.v3->nodes.entry_count);
-        node = NODE_PTR_V6(ipset, node_idx);
-        if (bitpos < node->prefix) {
-            COUNT_MATCHING_BITS64(&bitpos,
-                                  (ipv6->ip[ip_idx] ^ node->ip.ip[ip_idx]));
-            bitpos += (ip_idx * 64);
-            if (bitpos < node->prefix) {
-                if (64 == bitpos && 0 == ip_idx) {
-                    ++ip_idx;
-                    continue;
-                }
-                /* cannot descend any farther into tree */
-                if (bitpos < prefix) {
-                    /* not found */
-                    rv = SKIPSET_ERR_NOTFOUND;
-                    goto END;
-                }
-                bitpos = prefix;
-                /* rv = SKIPSET_ERR_SUBSET; */
-                goto END;
-            }
-            /* else bitpos >= node->prefix */
-            if (prefix <= node->prefix) {
-                bitpos = prefix;
-                /* rv = SKIPSET_ERR_SUBSET; */
-                goto END;
-            }
-        }
 
-        /* go to the appropriate child */
-        parent_idx = node_idx;
-        which_child = WHICH_CHILD_V6(ipv6, node->prefix);
-        node_idx = node->child[which_child];
-        if (0 == node_idx) {
-            if (NUM_BITS > prefix - node->prefix) {
-                /* the 'prefix' covers multiple child[] entries; see
-                 * if any others are occupied */
-                for (j = 1;
-                     ((j < (1u << (NUM_BITS - (prefix - node->prefix))))
-                      && ((which_child + j) < IPSET_NUM_CHILDREN));
-                     ++j)
-                {
-                    if (node->child[which_child + j]) {
-                        /* rv = SKIPSET_ERR_SUBSET; */
-                        goto END;
-                    }
-                }
-            }
-            node_idx = which_child;
-            rv = SKIPSET_ERR_MULTILEAF;
-            goto END;
-        }
-        if (BITMAP_GETBIT(node->child_is_leaf, which_child)) {
-            leaf = LEAF_PTR_V6(ipset, node_idx);
-            if ((1 == ip_idx) || (ipv6->ip[0] == leaf->ip.ip[0])) {
-                COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[1] ^ leaf->ip.ip[1]));
-                bitpos += 64;
-            } else {
-                COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[0] ^ leaf->ip.ip[0]));
-            }
-            if (bitpos < leaf->prefix) {
-                if (bitpos < prefix) {
-                    /* not found */
-                    rv = SKIPSET_ERR_NOTFOUND;
-                } else {
-                    bitpos = prefix;
-                    /* rv = SKIPSET_ERR_SUBSET; */
-                }
-            } else {
-                bitpos = leaf->prefix;
-                if (prefix >= leaf->prefix) {
-                    rv = SKIPSET_OK;
-                }
-                /* else rv = SKIPSET_ERR_SUBSET; */
-            }
-            goto END;
-        }
+    /* Repeat the same process for the leaves */
 
-        bitpos = node->prefix + NUM_BITS;
+    ip_offset = offsetof(ipset_leaf_v4_t, ip);
+    assert(offsetof(ipset_leaf_v6_t, ip) >= ip_offset);
 
-    } while (bitpos < prefix);
+    leaf4 = (ipset_leaf_v4_t*)ipset->s.v3->leaves.buf;
+    leaf6 = (ipset_leaf_v6_t*)ipset->s.v3->leaves.buf;
 
-  END:
-    if (find_state) {
-        find_state->parent_idx = parent_idx;
-        find_state->node_idx = node_idx;
-        find_state->parents_child = which_child;
-        find_state->bitpos = bitpos;
-        find_state->result = rv;
-        find_state->node_is_leaf = (leaf != NULL);
+    leaf4->ip = 0;
+
+    for (i = 1, ++leaf4, ++leaf6;
+         i < ipset->s.v3->leaves.entry_count;
+         ++i, ++leaf4, ++leaf6)
+    {
+        memcpy(leaf4, leaf6, ip_offset);
+        leaf4->ip = (uint32_t)(leaf6->ip.ip[1] & UINT32_MAX);
+        leaf4->prefix -= 96;
     }
-    return rv;
+
+  SET_ATTRIBUTES:
+    /* set the IPset attributes for IPv4 */
+    ipset->s.v3->nodes.entry_size = sizeof(ipset_node_v4_t);
+    ipset->s.v3->leaves.entry_size = sizeof(ipset_leaf_v4_t);
+    ipset->is_ipv6 = 0;
+    ipset->is_dirty = 1;
+
+    /* adjust the capacities.  this may result in a waste of a few
+     * bytes */
+    ipset->s.v3->nodes.entry_capacity
+        = (ipset->s.v3->nodes.entry_capacity
+           * sizeof(ipset_node_v6_t) / sizeof(ipset_node_v4_t));
+    ipset->s.v3->leaves.entry_capacity
+        = (ipset->s.v3->leaves.entry_capacity
+           * sizeof(ipset_leaf_v6_t) / sizeof(ipset_leaf_v4_t));
+
+    return SKIPSET_OK;
 }
 #endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  remove_count = ipsetFixNodeSingleChild(ipset, node_idx, non_recursive);
- *
- *    Determine if the node specified by 'node_idx' has multiple
- *    children.  If it does, do not modify 'ipset' and return 0.
- *
- *    If the node specified by 'node_idx' as one child---which may be
- *    a leaf or another node---modify the node's parent to replace the
- *    node with node's child and return 1.
+ *  status  = ipsetCopyOnWrite(ipset);
  *
- *    If the node specified by 'node_idx' has no children, remove the
- *    node from the node's parent.  If 'non_recursive' is non-zero, do
- *    no further processing and return 1.  If 'non_recursive' is 0,
- *    repeat the process using the parent of the node that was just
- *    removed.  For this final case, the return status will be a count
- *    of the number of nodes removed.
+ *    Use the IPSET_COPY_ON_WRITE() macro to invoke this function,
+ *    which only calls this function when necessary.
  *
- *    I do not believe anything uses the return value; this function
- *    could be changed to "return" void.
+ *    Change the IPset 'ipset' so that it uses in-core memory to hold
+ *    its nodes instead of using mmap()ed data.  Return 0 on success,
+ *    or SKIPSET_ERR_ALLOC if memory cannot be allocated.
  */
 static int
-ipsetFixNodeSingleChild(
-    skipset_t          *ipset,
-    uint32_t            node_idx,
-    int                 non_recursive)
+ipsetCopyOnWrite(
+    skipset_t          *ipset)
 {
-    ipset_find_t find_state;
-    ipset_node_t *parent;
-    ipset_node_t *node;
-    uint32_t which_child;
-    uint32_t child_idx = 0;
-    uint32_t i;
-    int remove_count = 0;
-
-    assert(ipset);
-    assert(0 == ipset->is_iptree);
-    assert(node_idx > 0 && node_idx < ipset->s.v3->nodes.entry_count);
-
-    node = NODE_PTR(ipset, node_idx);
+    uint8_t *node_buf;
+    uint8_t *leaf_buf;
+    int rv;
 
-    for (;;) {
-        which_child = IPSET_NUM_CHILDREN;
-        for (i = 0; i < IPSET_NUM_CHILDREN; ++i) {
-            if ((node->v4.child[i])
-                && !NODEPTR_CHILD_IS_REPEAT(&node->v4, i))
-            {
-                if (which_child != IPSET_NUM_CHILDREN) {
-                    /* more than one child; we are done. */
-                    return remove_count;
-                }
-                which_child = i;
-            }
-        }
+    assert(ipset->s.v3->mapped_file && ipset->s.v3->mapped_size);
 
-        if (which_child < IPSET_NUM_CHILDREN) {
-            /* the node has a single child; modify the node's parent
-             * to replace the node with the node's child */
-            if (!NODEPTR_CHILD_IS_LEAF(&node->v4, which_child)) {
-                /* the single child is another node; the easiest way
-                 * to handle this case is to copy the child over the
-                 * node, and leave the parent untouched */
-                node_idx = node->v4.child[which_child];
-                memcpy(node, NODE_PTR(ipset, node_idx),
-                       ipset->s.v3->nodes.entry_size);
-                break;
-            }
+    /* cache the current buffer values in case the allocation fails */
+    node_buf = ipset->s.v3->nodes.buf;
+    leaf_buf = ipset->s.v3->leaves.buf;
 
-            child_idx = node->v4.child[which_child];
-        }
+    /* clear the values so we can allocate the space */
+    ipset->s.v3->nodes.buf = NULL;
+    ipset->s.v3->nodes.entry_capacity = 0;
+    ipset->s.v3->leaves.buf = NULL;
+    ipset->s.v3->leaves.entry_capacity = 0;
 
-        /* find the node in order to get a handle to the node's
-         * parent */
-        if (0 == node->v4.prefix) {
-            /* cannot call ipsetFindVx() with a prefix of 0, but that
-             * can only happen at the root */
-            find_state.parent_idx = IPSET_NO_PARENT;
-#if SK_ENABLE_IPV6
-        } else if (ipset->is_ipv6) {
-#ifndef NDEBUG
-            int rv =
-#endif
-                ipsetFindV6(ipset, &node->v6.ip, node->v6.prefix, &find_state);
-            assert(SKIPSET_OK == rv || SKIPSET_ERR_SUBSET == rv);
-            assert(find_state.node_idx == node_idx && !find_state.node_is_leaf);
-#endif  /* SK_ENABLE_IPV6 */
-        } else {
-#ifndef NDEBUG
-            int rv =
-#endif
-                ipsetFindV4(ipset, node->v4.ip, node->v4.prefix, &find_state);
-            assert(SKIPSET_OK == rv || SKIPSET_ERR_SUBSET == rv);
-            assert(find_state.node_idx == node_idx && !find_state.node_is_leaf);
-        }
+    rv = ipsetAllocEntries(&ipset->s.v3->nodes, ipset->s.v3->nodes.entry_count);
+    if (rv) {
+        ipset->s.v3->nodes.buf = node_buf;
+        ipset->s.v3->nodes.entry_capacity = ipset->s.v3->nodes.entry_count;
+        ipset->s.v3->leaves.buf = leaf_buf;
+        ipset->s.v3->leaves.entry_capacity = ipset->s.v3->leaves.entry_count;
+        return rv;
+    }
+    rv = ipsetAllocEntries(&ipset->s.v3->leaves,
+                           ipset->s.v3->leaves.entry_count);
+    if (rv) {
+        free(ipset->s.v3->nodes.buf);
+        ipset->s.v3->nodes.buf = node_buf;
+        ipset->s.v3->nodes.entry_capacity = ipset->s.v3->nodes.entry_count;
+        ipset->s.v3->leaves.buf = leaf_buf;
+        ipset->s.v3->leaves.entry_capacity = ipset->s.v3->leaves.entry_count;
+        return rv;
+    }
 
-        if (which_child < IPSET_NUM_CHILDREN) {
-            /* wire the nodes's parent to the child (which is a leaf),
-             * then free the node */
-            if (IPSET_NO_PARENT == find_state.parent_idx) {
-                /* this node was the root */
-                IPSET_ROOT_INDEX_SET(ipset, child_idx, 1);
-            } else {
-                parent = NODE_PTR(ipset, find_state.parent_idx);
-                parent->v4.child[find_state.parents_child] = child_idx;
-                SET_BMAP_SET(parent->v4.child_is_leaf,
-                             find_state.parents_child);
-            }
-            break;
-        }
-        /* delete the node from the parent */
-        if (IPSET_NO_PARENT == find_state.parent_idx) {
-            /* this node was the root */
-            skIPSetRemoveAll(ipset);
-            ++remove_count;
-            return remove_count;
-        }
+    /* copy the mmap()ed data into the newly allocated space */
+    memcpy(ipset->s.v3->nodes.buf, node_buf,
+           (ipset->s.v3->nodes.entry_count * ipset->s.v3->nodes.entry_size));
+    memcpy(ipset->s.v3->leaves.buf, leaf_buf,
+           (ipset->s.v3->leaves.entry_count * ipset->s.v3->leaves.entry_size));
 
-        parent = NODE_PTR(ipset, find_state.parent_idx);
-        parent->v4.child[find_state.parents_child] = 0;
-        if (non_recursive) {
-            break;
-        }
+    /* unmap the space */
+    munmap(ipset->s.v3->mapped_file, ipset->s.v3->mapped_size);
 
-        /* we have deleted the node from the parent.  see if the
-         * parent now has a single child  */
-        NODEIDX_FREE(ipset, node_idx);
-        ++remove_count;
-        node_idx = find_state.parent_idx;
-        node = parent;
-    }
+    ipset->s.v3->mapped_file = NULL;
+    ipset->s.v3->mapped_size = 0;
 
-    NODEIDX_FREE(ipset, node_idx);
-    ++remove_count;
-    return remove_count;
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetInsertAddressIPTree(ipset, ip, prefix);
+ *  status = ipsetCountCallbackV4(ipv4, prefix, &count_state)
+ *  status = ipsetCountCallbackV6(ipv6, prefix, &count_state)
  *
- *    Helper function for skIPSetInsertAddress(); may also be called
- *    by other internal functions.
+ *    Helper function for skIPSetCount().
  *
- *    Insert the CIDR block 'ip'/'prefix' into 'ipset'.
+ *    Compute (1 << 'prefix') to get the number of IPs in this block
+ *    and update the count in 'count_state'.
  */
 static int
-ipsetInsertAddressIPTree(
-    skipset_t          *ipset,
-    uint32_t            ipv4,
-    uint32_t            prefix)
-{
-    const uint32_t prefix_as_bits[] = {
-        0xFFFFFFFF, 0xFFFF, 0xFF, 0xF, 0x3, 0x1
-    };
-    uint32_t ipv4_end;
-
-    assert(ipset);
-    assert(1 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
-    assert(prefix > 0 || ipv4 == 0);
-    assert(prefix <= 32);
+ipsetCountCallbackV4(
+    uint32_t     UNUSED(ipv4),
+    uint32_t            prefix,
+    void               *v_count_state)
+{
+    ipset_count_t *count_state = (ipset_count_t*)v_count_state;
 
-    if (prefix >= 27) {
-        IPTREE_NODE_ALLOC(ipset, ipv4 >> 16);
-        ipset->s.v2->nodes[ipv4 >> 16]->addressBlock[(ipv4 & 0xFFFF) >> 5]
-            |= (prefix_as_bits[prefix - 27] << ((ipv4) & 0x1F));
+    count_state->lower += ((uint64_t)1) << (32 - prefix);
+    return 0;
+}
 
-    } else if (prefix <= 16) {
-        ipv4_end = ((UINT32_MAX >> prefix) | ipv4) >> 16;
-        ipv4 >>= 16;
-        do {
-            IPTREE_NODE_ALLOC(ipset, ipv4);
-            memset(ipset->s.v2->nodes[ipv4]->addressBlock,
-                   0xFF, sizeof(skIPNode_t));
-        } while (ipv4++ < ipv4_end);
+#if SK_ENABLE_IPV6
+static int
+ipsetCountCallbackV6(
+    const ipset_ipv6_t  UNUSED(*ipv6),
+    uint32_t                    prefix,
+    void                       *v_count_state)
+{
+    ipset_count_t *count_state = (ipset_count_t*)v_count_state;
+    uint64_t tmp;
 
+    if (prefix <= 64) {
+        count_state->upper += (((uint64_t)1) << (64 - prefix));
     } else {
-        /* 16 < prefix < 27 */
-
-        IPTREE_NODE_ALLOC(ipset, ipv4 >> 16);
-        memset(&ipset->s.v2->nodes[ipv4>>16]->addressBlock[(ipv4 & 0xFFFF)>>5],
-               0xFF, (sizeof(skIPNode_t) >> (prefix - 16)));
+        tmp = (((uint64_t)1) << (128 - prefix));
+        if ((UINT64_MAX - count_state->lower) > tmp) {
+            count_state->lower += tmp;
+        } else {
+            ++count_state->upper;
+            count_state->lower -= ((UINT64_MAX - tmp) + 1);
+        }
     }
 
-    return SKIPSET_OK;
+    return 0;
 }
+#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetInsertAddressV4(ipset, ip, prefix, find_state);
- *  status = ipsetInsertAddressV6(ipset, ip, prefix, find_state);
+ *  occupied = ipsetCountOccupiedLeaves(ipset);
  *
- *    Helper function for skIPSetInsertAddress(); may also be called
- *    by other internal functions.
+ *    Return the number of occupied leaves in 'ipset'.
+ */
+static uint32_t
+ipsetCountOccupiedLeaves(
+    const skipset_t    *ipset)
+{
+    const ipset_leaf_t *leaf;
+    uint32_t leaves_in_use;
+    uint32_t leaves_free_idx;
+
+    /* handle a leaf at the root as a special case */
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        return 1;
+    }
+
+    /* determine the number of leaves currently in use by subtracting
+     * the leaves on the free list from the total number of leaves */
+    leaves_in_use = ipset->s.v3->leaves.entry_count;
+    for (leaves_free_idx = ipset->s.v3->leaves.free_list;
+         0 != leaves_free_idx;
+         leaves_free_idx = LEAFPTR_FREE_LIST(leaf))
+    {
+        assert(leaves_free_idx < ipset->s.v3->leaves.entry_count);
+        --leaves_in_use;
+        leaf = LEAF_PTR(ipset, leaves_free_idx);
+    }
+
+    if (ipset->s.v3->leaves.entry_count < leaves_in_use) {
+        skAbort();
+    }
+
+    return leaves_in_use;
+}
+
+
+/*
+ *  status = ipsetCreate(ipset, support_ipv6, force_radix);
  *
- *    Insert the CIDR block 'ip'/'prefix' into the Radix-Tree based
- *    'ipset'.  'find_state' may be NULL.  If not NULL, 'find_state'
- *    should be the result of calling ipsetFindVx() for the
- *    'ip'/'prefix'.  Do not call this function with a non-NULL
- *    'find_state' if ipsetFindVx() found the IP address.
+ *    Helper function for skIPSetCreate() and used internally.
  *
- *    Return SKIPSET_OK when the IP was successfully inserted, or
- *    SKIPSET_ERR_ALLOC if there is not enough memory to insert the
- *    IP.
+ *    Allocates and initializes a new IPset at the space specified by
+ *    '*ipset'.  The set is initially empty.  When 'support_ipv6' is
+ *    non-zero, the IPset will be initialized to store IPv6 addresses;
+ *    otherwise it will be initialized to hold IPv4 addresses.  When
+ *    creating an IPv4 IPset, the IPTree format from SiLK-2 will be
+ *    used unless the 'force_radix' parameter has a non-zero value.
  */
 static int
-ipsetInsertAddressV4(
-    skipset_t          *ipset,
-    const uint32_t      ipv4,
-    const uint32_t      prefix,
-    const ipset_find_t *find_state)
+ipsetCreate(
+    skipset_t         **ipset_out,
+    int                 support_ipv6,
+    int                 force_radix)
 {
-    ipset_find_t find_state_local;
-    ipset_node_v4_t *parent = NULL;
-    ipset_leaf_v4_t *leaf = NULL;
-    ipset_node_v4_t *new_node;
-    uint32_t new_node_idx;
-    uint32_t new_leaf_idx[IPSET_NUM_CHILDREN];
-    uint32_t which_child;
-    uint32_t bitpos;
-    uint32_t i;
-    uint32_t j;
-    int rv;
+    skipset_t *set;
 
-    assert(ipset);
-    assert(prefix > 0 || ipv4 == 0);
-    assert(prefix <= 32);
-    assert(0 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
+    assert(ipset_out);
 
-    /* use the passed in 'find_state' if given */
-    if (find_state) {
-        rv = find_state->result;
-    } else {
-        rv = ipsetFindV4(ipset, ipv4, prefix, &find_state_local);
-        /* if IP was found, we can return */
-        if (SKIPSET_OK == rv) {
-            return SKIPSET_OK;
-        }
-        find_state = &find_state_local;
+    set = (skipset_t*)calloc(1, sizeof(skipset_t));
+    if (!set) {
+        return SKIPSET_ERR_ALLOC;
     }
-    ipset->is_dirty = 1;
 
-    if (SKIPSET_ERR_EMPTY == rv) {
-        /* tree was previously empty */
-        /* create a new leaf to hold the IP. create an extra node and
-         * extra leaf since node#0 and leaf#0 are always empty */
-        if (ipsetNewEntries(ipset, 1, 2, &new_node_idx, new_leaf_idx)) {
+    if (support_ipv6) {
+        set->s.v3 = (skipset_v3_t*)calloc(1, sizeof(skipset_v3_t));
+        if (!set->s.v3) {
+            free(set);
             return SKIPSET_ERR_ALLOC;
         }
-        assert(0 == new_node_idx);
-        assert(0 == new_leaf_idx[0]);
-        assert(1 == new_leaf_idx[1]);
-        IPSET_ROOT_INDEX_SET(ipset, new_leaf_idx[1], 1);
-        leaf = LEAF_PTR_V4(ipset, new_leaf_idx[IPSET_ROOT_INDEX(ipset)]);
-        leaf->ip = ipv4;
-        leaf->prefix = prefix;
-        return SKIPSET_OK;
+        set->s.v3->nodes.entry_size = sizeof(ipset_node_v6_t);
+        set->s.v3->leaves.entry_size = sizeof(ipset_leaf_v6_t);
+        set->is_ipv6 = 1;
+        set->is_iptree = 0;
+    } else if (force_radix) {
+        set->s.v3 = (skipset_v3_t*)calloc(1, sizeof(skipset_v3_t));
+        if (!set->s.v3) {
+            free(set);
+            return SKIPSET_ERR_ALLOC;
+        }
+        set->s.v3->nodes.entry_size = sizeof(ipset_node_v4_t);
+        set->s.v3->leaves.entry_size = sizeof(ipset_leaf_v4_t);
+        set->is_ipv6 = 0;
+        set->is_iptree = 0;
+    } else {
+        if (skIPTreeCreate(&set->s.v2)) {
+            free(set);
+            return SKIPSET_ERR_ALLOC;
+        }
+        set->is_ipv6 = 0;
+        set->is_iptree = 1;
     }
 
-    if (SKIPSET_ERR_SUBSET == rv) {
-        /* we're adding an IP/PREFIX where part of the IP space
-         * already exists in the IPSet.  Modify this node's values to
-         * hold the larger block, and remove any nodes below here. */
-        if (IPSET_NO_PARENT == find_state->parent_idx) {
-            if (IPSET_ROOT_IS_LEAF(ipset)) {
-                leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
-            } else {
-                new_leaf_idx[0] = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
-                leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
-            }
-            leaf->ip = ipv4;
-            leaf->prefix = prefix;
-            return SKIPSET_OK;
-        }
+    *ipset_out = set;
+    return SKIPSET_OK;
 
-        /* get a handle to the parent */
-        parent = NODE_PTR_V4(ipset, find_state->parent_idx);
 
-        if (NUM_BITS <= prefix - parent->prefix) {
-            /* leaf has a single child[] entry on the parent */
-            if (find_state->node_is_leaf) {
-                /* we can modify the leaf and be done */
-                leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
-            } else {
-                /* need to replace the node with a leaf */
-                new_leaf_idx[0]
-                    = ipsetReplaceNodeWithLeaf(ipset, (ipset_node_t*)parent,
-                                               find_state->parents_child);
-                leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
-            }
-            leaf->ip = ipv4;
-            leaf->prefix = prefix;
-            return SKIPSET_OK;
-        }
+}
 
-        /* this leaf will cover several child[] entries on the parent.
-         * destroy any existing children and attempt to find a leaf on
-         * this level to use  */
-        new_leaf_idx[0] = 0;
-        for (i = find_state->parents_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i]
-                && !NODEPTR_CHILD_IS_REPEAT(parent, i))
-            {
-                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                    /* delete this subtree */
-                    ipsetDestroySubtree(ipset, parent->child[i], 1);
-                } else if (0 == new_leaf_idx[0]) {
-                    /* found a leaf to use */
-                    new_leaf_idx[0] = parent->child[i];
-                } else {
-                    /* do not need this leaf */
-                    LEAFIDX_FREE(ipset, parent->child[i]);
-                }
-            }
-        }
 
-        if (0 == new_leaf_idx[0]) {
-            /* no leaves available, need to allocate one */
-            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
-                return SKIPSET_ERR_ALLOC;
-            }
-        }
+/*
+ *  status = ipsetCreateContainer(ipset);
+ *
+ *    Helper function for skIPSetCreate() and used internally.
+ *
+ *    Allocates and initializes a new, empty IPv4 IPset that uses /16
+ *    containers at the space specified by '*ipset'.
+ */
+static int
+ipsetCreateContainer(
+    skipset_t         **ipset_out)
+{
+    skipset_t *set;
 
-        leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
-        leaf->ip = ipv4;
-        leaf->prefix = prefix;
+    assert(ipset_out);
 
-        /* set child[] entries on 'parent' to point at the new leaf */
-        /* set additional child[]s to also point at the leaf */
-        for (i = find_state->parents_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            parent->child[i] = new_leaf_idx[0];
-        }
-        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
-        NODEPTR_CHILD_SET_REPEAT2(parent, 1+find_state->parents_child, i - 1);
-        return SKIPSET_OK;
+    set = (skipset_t*)calloc(1, sizeof(skipset_t));
+    if (!set) {
+        return SKIPSET_ERR_ALLOC;
+    }
+    set->s.cont = (skipset_cont_t*)calloc(1, sizeof(skipset_cont_t));
+    if (!set->s.cont) {
+        free(set);
+        return SKIPSET_ERR_ALLOC;
     }
+    set->is_container = 1;
 
-    if (SKIPSET_ERR_MULTILEAF == rv) {
-        /* get a handle to the current node */
-        parent = NODE_PTR_V4(ipset, find_state->parent_idx);
+    *ipset_out = set;
+    return SKIPSET_OK;
+}
 
-        if (NUM_BITS <= prefix - parent->prefix) {
-            /* need to add a single leaf and have a single child[]
-             * entry on 'parent' point to that leaf */
-            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
-                return SKIPSET_ERR_ALLOC;
-            }
-            /* get a handle to the newly created leaf and copy the new
-             * IP there */
-            leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
-            leaf->ip = ipv4;
-            leaf->prefix = prefix;
 
-            /* set pointer on 'parent' to point at the new leaf */
-            parent->child[find_state->parents_child] = new_leaf_idx[0];
-            NODEPTR_CHILD_SET_LEAF(parent, find_state->parents_child);
-            return SKIPSET_OK;
-        }
+/*
+ *  ipsetDestroySubtree(ipset, node_idx, destroy_self);
+ *
+ *    Puts all the child nodes of 'node_idx' onto the free list.  If
+ *    'destroy_self' is non-zero, the 'node_idx' node is also added to
+ *    the free list.  If 'destroy_self' is zero, the child indexes on
+ *    'node_idx' are set to 0.
+ */
+static void
+ipsetDestroySubtree(
+    skipset_t          *ipset,
+    uint32_t            node_idx,
+    int                 destroy_self)
+{
+    uint32_t to_visit[IPSET_MAX_DEPTH];
+    uint32_t depth = 0;
+    ipset_node_t *node;
+    int i;
 
-        /* this leaf will cover several child[] entries on the parent.
-         * see if any are occupied. */
-        new_leaf_idx[0] = 0;
-        for (i = find_state->parents_child + 1, j = 1u;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i] && NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                new_leaf_idx[0] = parent->child[i];
-                break;
-            }
-        }
-        if (new_leaf_idx[0] == 0) {
-            /* no leaves available, need to allocate one */
-            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
-                return SKIPSET_ERR_ALLOC;
+    if (destroy_self) {
+        /* add this node to the list of nodes to destroy */
+        to_visit[depth++] = node_idx;
+    } else {
+        /* destroy any leaves off of this node; add this node's child
+         * nodes to the list list of nodes to destroy */
+        node = NODE_PTR(ipset, node_idx);
+        for (i = 0; i < IPSET_NUM_CHILDREN; ++i) {
+            if (node->v4.child[i]
+                && !NODEPTR_CHILD_IS_REPEAT(&node->v4, i))
+            {
+                if (NODEPTR_CHILD_IS_LEAF(&node->v4, i)) {
+                    LEAFIDX_FREE(ipset, node->v4.child[i]);
+                } else {
+                    to_visit[depth++] = node->v4.child[i];
+                }
             }
         }
+        /* clear the child array and bitmaps */
+        memset(node->v4.child, 0, sizeof(node->v4.child));
+        SET_BMAP_CLEAR_ALL(node->v4.child_is_leaf);
+        SET_BMAP_CLEAR_ALL(node->v4.child_repeated);
+    }
 
-        leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
-        leaf->ip = ipv4;
-        leaf->prefix = prefix;
-
-        /* set child[] on 'parent' to point at the new leaf */
-        parent->child[find_state->parents_child] = new_leaf_idx[0];
-
-        /* set additional child[]s to also point at the leaf */
-        for (i = find_state->parents_child + 1, j = 1u;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i]) {
-                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                    /* delete this subtree */
-                    ipsetDestroySubtree(ipset, parent->child[i], 1);
-                } else if (parent->child[i] != new_leaf_idx[0]) {
-                    /* do not need this leaf */
-                    LEAFIDX_FREE(ipset, parent->child[i]);
+    while (depth) {
+        node_idx = to_visit[--depth];
+        node = NODE_PTR(ipset, node_idx);
+        for (i = 0; i < IPSET_NUM_CHILDREN; ++i) {
+            if (node->v4.child[i]
+                && !NODEPTR_CHILD_IS_REPEAT(&node->v4, i))
+            {
+                if (NODEPTR_CHILD_IS_LEAF(&node->v4, i)) {
+                    LEAFIDX_FREE(ipset, node->v4.child[i]);
+                } else {
+                    to_visit[depth++] = node->v4.child[i];
                 }
             }
-            parent->child[i] = new_leaf_idx[0];
         }
-        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
-        if (j > 1) {
-            NODEPTR_CHILD_SET_REPEAT2(parent, 1 + find_state->parents_child,
-                                      i - 1);
-        }
-        return SKIPSET_OK;
+        NODEIDX_FREE(ipset, node_idx);
     }
+}
 
-    /* we must add a new node and a new leaf to the tree.  The leaf
-     * holds the IP being inserted.  The node holds the CIDR block
-     * containing the leaf and our current node---that is, it becomes
-     * a new parent; we must also update the index on the current
-     * node's parent to point to the new parent. */
 
-    /* create the two new entries */
-    if (ipsetNewEntries(ipset, 1, 1, &new_node_idx, new_leaf_idx)) {
-        return SKIPSET_ERR_ALLOC;
-    }
+/*
+ *  status = ipsetFindV4(ipset, ip, prefix, &find_state);
+ *  status = ipsetFindV6(ipset, ip, prefix, &find_state);
+ *
+ *    Searches for 'ip'/'prefix' in the Radix-tree based 'ipset'.
+ *    'ip' is an integer presentation of the IP address in native byte
+ *    order.
+ *
+ *    Returns SKIPSET_OK if it is found exactly or if a CIDR block
+ *    containing it is found: searching for 10.0.0.2 and find
+ *    10.0.0.0/24.
+ *
+ *    Returns SKIPSET_ERR_SUBSET when a subset of target is found:
+ *    search for 10.0.0.0/24 and find 10.0.0.2.
+ *
+ *    Returns SKIPSET_ERR_EMPTY if the IPset is empty.
+ *
+ *    Returns SKIPSET_ERR_MULTILEAF if it is not found but the search
+ *    failed at a position where a leaf can be inserted.
+ *
+ *    Returns SKIPSET_ERR_NOTFOUND if it is not found and the
+ *    SKIPSET_ERR_MULTILEAF case does not apply.
+ *
+ *    When 'find_state' is non-NULL, its fields will be set to the
+ *    final location visited in the tree.  Specifically, 'node_idx' is
+ *    set to the index of the node where the search terminated;
+ *    'bitpos' is set to the number of bits of the IP address that
+ *    were searched; 'parent_idx' is set to the index of the parent of
+ *    the node in 'node_idx'.  If 'node_idx' is the root of the tree,
+ *    'parent_idx' will be UINT32_MAX; 'result' will be the same as
+ *    the return status of the function.
+ */
+static int
+ipsetFindV4(
+    const skipset_t    *ipset,
+    const uint32_t      ipv4,
+    const uint32_t      prefix,
+    ipset_find_t       *find_state)
+{
+    const ipset_node_v4_t *node;
+    const ipset_leaf_v4_t *leaf = NULL;
+    uint32_t parent_idx;
+    uint32_t node_idx;
+    uint32_t which_child;
+    uint32_t j;
+    uint8_t bitpos;
+    int rv;
 
-    /* get a handle to the newly created node */
-    new_node = NODE_PTR_V4(ipset, new_node_idx);
+    /*
+     *  The 'bitpos' value specifies the number of bits that match
+     *  between the IP on the current node/leaf and the search IP
+     *  (starting from the most significant bit).
+     *
+     *  On a node at any level in the tree, if bitpos is less than the
+     *  prefix on that node, we cannot descend to the next level in
+     *  the tree.  Otherwise, before descending, we check to see
+     *  whether the node's prefix is greater than the search prefix;
+     *  if it is, there is no need to continue and the function
+     *  returns SUBSET.
+     *
+     *  Whether the descent into the tree stops due to reaching a leaf
+     *  or due to not matching enough bits on a node, the return
+     *  status depends on three values: (1)the number of bits that
+     *  were matched, (2)the prefix on the node/leaf, and (3)the
+     *  search prefix.  If bitpos is less than the search prefix, the
+     *  search failed and NOTFOUND is returned.  If both bitpos and
+     *  the search prefix are at least equal to the prefix on the
+     *  node/leaf, the search returns OK.  For any other combination,
+     *  the search returns SUBSET.
+     *
+     *  If the search is on the node and wants to descend into the
+     *  tree but there is no child at that position, the search either
+     *  returns SUBSET or MULTILEAF.  The search returns SUBSET if the
+     *  search prefix covers multiple children on the node and at
+     *  least one of those children is occupied.  Otherwise, the
+     *  search returns MULTILEAF, denoting that a leaf can be safely
+     *  added at this position.
+     */
 
-    bitpos = find_state->bitpos & ~(NUM_BITS - 1);
+    assert(ipset);
+    assert(prefix > 0 || ipv4 == 0);
+    assert(prefix <= 32);
+    assert(0 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
 
-    /* get a handle to the newly created leaf, copy the inserted IP
-     * there, and link it to the new_node. */
-    leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
-    leaf->ip = ipv4;
-    leaf->prefix = prefix;
-    which_child = WHICH_CHILD_V4(ipv4, bitpos);
-    if (NUM_BITS <= prefix - bitpos) {
-        /* adding a single child[] entry */
-        new_node->child[which_child] = new_leaf_idx[0];
-        NODEPTR_CHILD_SET_LEAF(new_node, which_child);
+    parent_idx = IPSET_NO_PARENT;
+    node_idx = IPSET_ROOT_INDEX(ipset);
+    which_child = IPSET_NUM_CHILDREN;
+    bitpos = 0;
+    rv = SKIPSET_ERR_SUBSET;
 
-    } else {
-        /* this leaf will cover several child[] values on the node. */
-        for (i = which_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - bitpos)));
-             ++i, ++j)
-        {
-            new_node->child[i] = new_leaf_idx[0];
-        }
-        NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
-        NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
+    if (IPSET_ISEMPTY(ipset)) {
+        rv = SKIPSET_ERR_EMPTY;
+        goto END;
     }
 
-    /* the following code is slightly different depending on whether
-     * search stopped on a node or on a leaf */
-    if (find_state->node_is_leaf) {
-        /* get a handle to the current leaf that is being moved down
-         * the tree */
-        leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
-
-        /* copy the leaf's IP to the new parent, masking off the lower
-         * bits */
-        new_node->prefix = bitpos;
-        new_node->ip = leaf->ip & ~(UINT32_MAX >> new_node->prefix);
-
-        /* put the leaf under new_node */
-        which_child = WHICH_CHILD_V4(leaf->ip, new_node->prefix);
-        if (NUM_BITS <= leaf->prefix - new_node->prefix) {
-            /* leaf occupies a single child[] entry */
-            new_node->child[which_child] = find_state->node_idx;
-            NODEPTR_CHILD_SET_LEAF(new_node, which_child);
-
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        leaf = LEAF_PTR_V4(ipset, node_idx);
+        /* find number of bits this leaf's IP and the search IP have
+         * in common */
+        COUNT_MATCHING_BITS32(&bitpos, (ipv4 ^ (leaf->ip)));
+        if (bitpos < leaf->prefix) {
+            if (bitpos < prefix) {
+                /* not found */
+                rv = SKIPSET_ERR_NOTFOUND;
+            } else {
+                bitpos = prefix;
+                /* rv = SKIPSET_ERR_SUBSET; */
+            }
         } else {
-            for (i = which_child, j = 0;
-                 j < (1u << (NUM_BITS - (leaf->prefix - new_node->prefix)));
-                 ++i, ++j)
-            {
-                new_node->child[i] = find_state->node_idx;
+            /* make certain bitpos is not greater than this leaf's
+             * prefix */
+            bitpos = leaf->prefix;
+            if (prefix >= leaf->prefix) {
+                rv = SKIPSET_OK;
             }
-            NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
-            NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
+            /* else rv = SKIPSET_ERR_SUBSET; */
         }
+        goto END;
+    }
 
-        /* get a handle to the parent, and update the child pointer on
-         * the parent */
-        if (find_state->parent_idx == IPSET_NO_PARENT) {
-            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
-        } else {
-            parent = NODE_PTR_V4(ipset, find_state->parent_idx);
-            which_child = WHICH_CHILD_V4(leaf->ip, parent->prefix);
-            assert(parent->child[which_child] == find_state->node_idx);
-            parent->child[which_child] = new_node_idx;
-            NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+    do {
+        assert(node_idx < ipset->s.v3->nodes.entry_count);
+        node = NODE_PTR_V4(ipset, node_idx);
+        if (bitpos < node->prefix) {
+            COUNT_MATCHING_BITS32(&bitpos, (ipv4 ^ (node->ip)));
+            if (bitpos < node->prefix) {
+                /* cannot descend any farther into tree */
+                if (bitpos < prefix) {
+                    /* not found */
+                    rv = SKIPSET_ERR_NOTFOUND;
+                    goto END;
+                }
+                bitpos = prefix;
+                /* rv = SKIPSET_ERR_SUBSET; */
+                goto END;
+            }
+            /* else bitpos >= node->prefix */
+            if (prefix <= node->prefix) {
+                bitpos = prefix;
+                /* rv = SKIPSET_ERR_SUBSET; */
+                goto END;
+            }
+            /* else descend to next level */
         }
 
-    } else {
-        /* get a handle to the current node that is being moved down
-         * the tree */
-        ipset_node_v4_t *node = NODE_PTR_V4(ipset, find_state->node_idx);
+        /* go to the appropriate child */
+        parent_idx = node_idx;
+        which_child = WHICH_CHILD_V4(ipv4, node->prefix);
+        node_idx = node->child[which_child];
+        if (0 == node_idx) {
+            if (NUM_BITS > prefix - node->prefix) {
+                /* the 'prefix' covers multiple child[] entries; see
+                 * if any others are occupied */
+                for (j = 1;
+                     ((j < (1u << (NUM_BITS - (prefix - node->prefix))))
+                      && ((which_child + j) < IPSET_NUM_CHILDREN));
+                     ++j)
+                {
+                    if (node->child[which_child + j]) {
+                        /* rv = SKIPSET_ERR_SUBSET; */
+                        goto END;
+                    }
+                }
+            }
+            node_idx = which_child;
+            rv = SKIPSET_ERR_MULTILEAF;
+            goto END;
+        }
+        if (BITMAP_GETBIT(node->child_is_leaf, which_child)) {
+            leaf = LEAF_PTR_V4(ipset, node_idx);
+            COUNT_MATCHING_BITS32(&bitpos, (ipv4 ^ (leaf->ip)));
+            if (bitpos < leaf->prefix) {
+                if (bitpos < prefix) {
+                    /* not found */
+                    rv = SKIPSET_ERR_NOTFOUND;
+                } else {
+                    bitpos = prefix;
+                    /* rv = SKIPSET_ERR_SUBSET; */
+                }
+            } else {
+                bitpos = leaf->prefix;
+                if (prefix >= leaf->prefix) {
+                    rv = SKIPSET_OK;
+                }
+                /* else rv = SKIPSET_ERR_SUBSET; */
+            }
+            goto END;
+        }
 
-        /* copy the current node's IP to the new parent, masking off
-         * the lower bits */
-        new_node->prefix = bitpos;
-        new_node->ip = node->ip & ~(UINT32_MAX >> bitpos);
+        bitpos = node->prefix + NUM_BITS;
 
-        /* put the current node under new_node */
-        which_child = WHICH_CHILD_V4(node->ip, new_node->prefix);
-        new_node->child[which_child] = find_state->node_idx;
+    } while (bitpos < prefix);
 
-        /* get a handle to the parent, and update the child pointer on
-         * the parent */
-        if (find_state->parent_idx == IPSET_NO_PARENT) {
-            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
-        } else {
-            parent = NODE_PTR_V4(ipset, find_state->parent_idx);
-            which_child = WHICH_CHILD_V4(node->ip, parent->prefix);
-            assert(parent->child[which_child] == find_state->node_idx);
-            parent->child[which_child] = new_node_idx;
-        }
+  END:
+    if (find_state) {
+        find_state->parent_idx = parent_idx;
+        find_state->node_idx = node_idx;
+        find_state->parents_child = which_child;
+        find_state->bitpos = bitpos;
+        find_state->result = rv;
+        find_state->node_is_leaf = (leaf != NULL);
     }
-
-    return SKIPSET_OK;
+    return rv;
 }
 
 #if SK_ENABLE_IPV6
 static int
-ipsetInsertAddressV6(
-    skipset_t          *ipset,
+ipsetFindV6(
+    const skipset_t    *ipset,
     const ipset_ipv6_t *ipv6,
     const uint32_t      prefix,
-    const ipset_find_t *find_state)
+    ipset_find_t       *find_state)
 {
-    ipset_find_t find_state_local;
-    ipset_node_v6_t *parent = NULL;
-    ipset_leaf_v6_t *leaf = NULL;
-    ipset_node_v6_t *new_node;
-    uint32_t new_node_idx;
-    uint32_t new_leaf_idx[IPSET_NUM_CHILDREN];
+    const ipset_node_v6_t *node;
+    const ipset_leaf_v6_t *leaf = NULL;
+    uint32_t parent_idx;
+    uint32_t node_idx;
     uint32_t which_child;
-    uint32_t bitpos;
-    uint32_t i;
+    uint8_t bitpos;
     uint32_t j;
+    int ip_idx;
     int rv;
 
     assert(ipset);
@@ -3292,2264 +3748,4596 @@ ipsetInsertAddressV6(
     assert(0 == ipset->is_iptree);
     assert(1 == ipset->is_ipv6);
 
-    if (find_state) {
-        rv = find_state->result;
-    } else {
-        rv = ipsetFindV6(ipset, ipv6, prefix, &find_state_local);
-        /* if IP was found, we can return */
-        if (SKIPSET_OK == rv) {
-            return SKIPSET_OK;
-        }
-        find_state = &find_state_local;
-    }
-    ipset->is_dirty = 1;
+    parent_idx = IPSET_NO_PARENT;
+    node_idx = IPSET_ROOT_INDEX(ipset);
+    which_child = IPSET_NUM_CHILDREN;
+    bitpos = 0;
+    ip_idx = 0;
+    rv = SKIPSET_ERR_SUBSET;
 
-    if (SKIPSET_ERR_EMPTY == rv) {
-        /* tree was previously empty */
-        /* create a new node to hold the IP */
-        if (ipsetNewEntries(ipset, 1, 2, &new_node_idx, new_leaf_idx)) {
-            return SKIPSET_ERR_ALLOC;
-        }
-        assert(0 == new_node_idx);
-        assert(0 == new_leaf_idx[0]);
-        assert(1 == new_leaf_idx[1]);
-        IPSET_ROOT_INDEX_SET(ipset, new_leaf_idx[1], 1);
-        leaf = LEAF_PTR_V6(ipset, new_leaf_idx[IPSET_ROOT_INDEX(ipset)]);
-        IPSET_IPV6_COPY(&leaf->ip, ipv6);
-        leaf->prefix = prefix;
-        return SKIPSET_OK;
+    if (IPSET_ISEMPTY(ipset)) {
+        rv = SKIPSET_ERR_EMPTY;
+        goto END;
     }
 
-    if (SKIPSET_ERR_SUBSET == rv) {
-        /* we're adding an IP/PREFIX where part of the IP space
-         * already exists in the IPSet.  Modify this node's values to
-         * hold the larger block, and remove any nodes below here. */
-        if (IPSET_NO_PARENT == find_state->parent_idx) {
-            if (IPSET_ROOT_IS_LEAF(ipset)) {
-                leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        leaf = LEAF_PTR_V6(ipset, node_idx);
+        /* find number of bits this leaf's IP and the search IP have
+         * in common */
+        if (ipv6->ip[0] == leaf->ip.ip[0]) {
+            COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[1] ^ leaf->ip.ip[1]));
+            bitpos += 64;
+        } else {
+            COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[0] ^ leaf->ip.ip[0]));
+        }
+        if (bitpos < leaf->prefix) {
+            if (bitpos < prefix) {
+                /* not found */
+                rv = SKIPSET_ERR_NOTFOUND;
             } else {
-                new_leaf_idx[0] = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
-                leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+                bitpos = prefix;
+                /* rv = SKIPSET_ERR_SUBSET; */
             }
-            IPSET_IPV6_COPY(&leaf->ip, ipv6);
-            leaf->prefix = prefix;
-            return SKIPSET_OK;
-        }
-
-        /* get a handle to the parent */
-        parent = NODE_PTR_V6(ipset, find_state->parent_idx);
-
-        if (NUM_BITS <= prefix - parent->prefix) {
-            /* leaf has a single child[] entry on the parent */
-            if (find_state->node_is_leaf) {
-                /* we can modify the leaf and be done */
-                leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
-            } else {
-                /* need to replace the node with a leaf */
-                new_leaf_idx[0]
-                    = ipsetReplaceNodeWithLeaf(ipset, (ipset_node_t*)parent,
-                                               find_state->parents_child);
-                leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+        } else {
+            /* make certain bitpos is not greater than this leaf's
+             * prefix */
+            bitpos = leaf->prefix;
+            if (prefix >= leaf->prefix) {
+                rv = SKIPSET_OK;
             }
-            IPSET_IPV6_COPY(&leaf->ip, ipv6);
-            leaf->prefix = prefix;
-            return SKIPSET_OK;
+            /* else rv = SKIPSET_ERR_SUBSET; */
         }
+        goto END;
+    }
 
-        /* this leaf will cover several child[] entries on the parent.
-         * destroy any existing children and attempt to find a leaf on
-         * this level to use  */
-        new_leaf_idx[0] = 0;
-        for (i = find_state->parents_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i]
-                && !NODEPTR_CHILD_IS_REPEAT(parent, i))
-            {
-                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                    /* delete this subtree */
-                    ipsetDestroySubtree(ipset, parent->child[i], 1);
-                } else if (0 == new_leaf_idx[0]) {
-                    /* found a leaf to use */
-                    new_leaf_idx[0] = parent->child[i];
-                } else {
-                    /* do not need this leaf */
-                    LEAFIDX_FREE(ipset, parent->child[i]);
+    do {
+        assert(node_idx < ipset->s.v3->nodes.entry_count);
+        node = NODE_PTR_V6(ipset, node_idx);
+        if (bitpos < node->prefix) {
+            COUNT_MATCHING_BITS64(&bitpos,
+                                  (ipv6->ip[ip_idx] ^ node->ip.ip[ip_idx]));
+            bitpos += (ip_idx * 64);
+            if (bitpos < node->prefix) {
+                if (64 == bitpos && 0 == ip_idx) {
+                    ++ip_idx;
+                    continue;
+                }
+                /* cannot descend any farther into tree */
+                if (bitpos < prefix) {
+                    /* not found */
+                    rv = SKIPSET_ERR_NOTFOUND;
+                    goto END;
                 }
+                bitpos = prefix;
+                /* rv = SKIPSET_ERR_SUBSET; */
+                goto END;
             }
-        }
-
-        if (0 == new_leaf_idx[0]) {
-            /* no leaves available, need to allocate one */
-            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
-                return SKIPSET_ERR_ALLOC;
+            /* else bitpos >= node->prefix */
+            if (prefix <= node->prefix) {
+                bitpos = prefix;
+                /* rv = SKIPSET_ERR_SUBSET; */
+                goto END;
             }
         }
 
-        leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
-        IPSET_IPV6_COPY(&leaf->ip, ipv6);
-        leaf->prefix = prefix;
-
-        /* set child[] entries on 'parent' to point at the new leaf */
-        /* set additional child[]s to also point at the leaf */
-        for (i = find_state->parents_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            parent->child[i] = new_leaf_idx[0];
-        }
-        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
-        NODEPTR_CHILD_SET_REPEAT2(parent, 1+find_state->parents_child, i - 1);
-        return SKIPSET_OK;
-    }
-
-    if (SKIPSET_ERR_MULTILEAF == rv) {
-        /* get a handle to the current node */
-        parent = NODE_PTR_V6(ipset, find_state->parent_idx);
-
-        if (NUM_BITS <= prefix - parent->prefix) {
-            /* need to add a single leaf and have a single child[]
-             * entry on 'parent' point to that leaf */
-            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
-                return SKIPSET_ERR_ALLOC;
+        /* go to the appropriate child */
+        parent_idx = node_idx;
+        which_child = WHICH_CHILD_V6(ipv6, node->prefix);
+        node_idx = node->child[which_child];
+        if (0 == node_idx) {
+            if (NUM_BITS > prefix - node->prefix) {
+                /* the 'prefix' covers multiple child[] entries; see
+                 * if any others are occupied */
+                for (j = 1;
+                     ((j < (1u << (NUM_BITS - (prefix - node->prefix))))
+                      && ((which_child + j) < IPSET_NUM_CHILDREN));
+                     ++j)
+                {
+                    if (node->child[which_child + j]) {
+                        /* rv = SKIPSET_ERR_SUBSET; */
+                        goto END;
+                    }
+                }
             }
-            /* get a handle to the newly created leaf and copy the new
-             * IP there */
-            leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
-            IPSET_IPV6_COPY(&leaf->ip, ipv6);
-            leaf->prefix = prefix;
-
-            /* set pointer on 'parent' to point at the new leaf */
-            parent->child[find_state->parents_child] = new_leaf_idx[0];
-            NODEPTR_CHILD_SET_LEAF(parent, find_state->parents_child);
-            return SKIPSET_OK;
+            node_idx = which_child;
+            rv = SKIPSET_ERR_MULTILEAF;
+            goto END;
         }
-
-        /* this leaf will cover several child[] entries on the parent.
-         * see if any are occupied. */
-        new_leaf_idx[0] = 0;
-        for (i = find_state->parents_child + 1, j = 1u;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i] && NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                new_leaf_idx[0] = parent->child[i];
-                break;
+        if (BITMAP_GETBIT(node->child_is_leaf, which_child)) {
+            leaf = LEAF_PTR_V6(ipset, node_idx);
+            if ((1 == ip_idx) || (ipv6->ip[0] == leaf->ip.ip[0])) {
+                COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[1] ^ leaf->ip.ip[1]));
+                bitpos += 64;
+            } else {
+                COUNT_MATCHING_BITS64(&bitpos, (ipv6->ip[0] ^ leaf->ip.ip[0]));
             }
-        }
-        if (new_leaf_idx[0] == 0) {
-            /* no leaves available, need to allocate one */
-            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
-                return SKIPSET_ERR_ALLOC;
+            if (bitpos < leaf->prefix) {
+                if (bitpos < prefix) {
+                    /* not found */
+                    rv = SKIPSET_ERR_NOTFOUND;
+                } else {
+                    bitpos = prefix;
+                    /* rv = SKIPSET_ERR_SUBSET; */
+                }
+            } else {
+                bitpos = leaf->prefix;
+                if (prefix >= leaf->prefix) {
+                    rv = SKIPSET_OK;
+                }
+                /* else rv = SKIPSET_ERR_SUBSET; */
             }
+            goto END;
         }
 
-        leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
-        IPSET_IPV6_COPY(&leaf->ip, ipv6);
-        leaf->prefix = prefix;
+        bitpos = node->prefix + NUM_BITS;
 
-        /* set child[] on 'parent' to point at the new leaf */
-        parent->child[find_state->parents_child] = new_leaf_idx[0];
+    } while (bitpos < prefix);
 
-        /* set additional child[]s to also point at the leaf */
-        for (i = find_state->parents_child + 1, j = 1u;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i]) {
-                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                    /* delete this subtree */
-                    ipsetDestroySubtree(ipset, parent->child[i], 1);
-                } else if (parent->child[i] != new_leaf_idx[0]) {
-                    /* do not need this leaf */
-                    LEAFIDX_FREE(ipset, parent->child[i]);
-                }
-            }
-            parent->child[i] = new_leaf_idx[0];
-        }
-        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
-        if (j > 1) {
-            NODEPTR_CHILD_SET_REPEAT2(parent, 1 + find_state->parents_child,
-                                      i - 1);
-        }
-        return SKIPSET_OK;
+  END:
+    if (find_state) {
+        find_state->parent_idx = parent_idx;
+        find_state->node_idx = node_idx;
+        find_state->parents_child = which_child;
+        find_state->bitpos = bitpos;
+        find_state->result = rv;
+        find_state->node_is_leaf = (leaf != NULL);
     }
+    return rv;
+}
+#endif  /* SK_ENABLE_IPV6 */
 
-    /* we must add a new node and a new leaf to the tree.  The leaf
-     * holds the IP being inserted.  The node holds the CIDR block
-     * containing the leaf and our current node---that is, it becomes
-     * a new parent; we must also update the index on the current
-     * node's parent to point to the new parent. */
 
-    /* create the two new entries */
-    if (ipsetNewEntries(ipset, 1, 1, &new_node_idx, new_leaf_idx)) {
-        return SKIPSET_ERR_ALLOC;
-    }
+/*
+ *  remove_count = ipsetFixNodeSingleChild(ipset, node_idx, non_recursive);
+ *
+ *    Determine if the node specified by 'node_idx' has multiple
+ *    children.  If it does, do not modify 'ipset' and return 0.
+ *
+ *    If the node specified by 'node_idx' as one child---which may be
+ *    a leaf or another node---modify the node's parent to replace the
+ *    node with node's child and return 1.
+ *
+ *    If the node specified by 'node_idx' has no children, remove the
+ *    node from the node's parent.  If 'non_recursive' is non-zero, do
+ *    no further processing and return 1.  If 'non_recursive' is 0,
+ *    repeat the process using the parent of the node that was just
+ *    removed.  For this final case, the return status will be a count
+ *    of the number of nodes removed.
+ *
+ *    I do not believe anything uses the return value; this function
+ *    could be changed to "return" void.
+ */
+static int
+ipsetFixNodeSingleChild(
+    skipset_t          *ipset,
+    uint32_t            node_idx,
+    int                 non_recursive)
+{
+    ipset_find_t find_state;
+    ipset_node_t *parent;
+    ipset_node_t *node;
+    uint32_t which_child;
+    uint32_t child_idx = 0;
+    uint32_t i;
+    int remove_count = 0;
 
-    /* get a handle to the newly created node */
-    new_node = NODE_PTR_V6(ipset, new_node_idx);
+    assert(ipset);
+    assert(0 == ipset->is_iptree);
+    assert(node_idx > 0 && node_idx < ipset->s.v3->nodes.entry_count);
 
-    bitpos = find_state->bitpos & ~(NUM_BITS - 1);
+    node = NODE_PTR(ipset, node_idx);
 
-    /* get a handle to the newly created leaf, copy the inserted IP
-     * there, and link it to the new_node */
-    leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
-    IPSET_IPV6_COPY(&leaf->ip, ipv6);
-    leaf->prefix = prefix;
-    which_child = WHICH_CHILD_V6(ipv6, bitpos);
-    if (NUM_BITS <= prefix - bitpos) {
-        /* adding a single child[] entry */
-        new_node->child[which_child] = new_leaf_idx[0];
-        NODEPTR_CHILD_SET_LEAF(new_node, which_child);
-
-    } else {
-        /* this leaf will cover several child[] values on the node. */
-        for (i = which_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - bitpos)));
-             ++i, ++j)
-        {
-            new_node->child[i] = new_leaf_idx[0];
+    for (;;) {
+        which_child = IPSET_NUM_CHILDREN;
+        for (i = 0; i < IPSET_NUM_CHILDREN; ++i) {
+            if ((node->v4.child[i])
+                && !NODEPTR_CHILD_IS_REPEAT(&node->v4, i))
+            {
+                if (which_child != IPSET_NUM_CHILDREN) {
+                    /* more than one child; we are done. */
+                    return remove_count;
+                }
+                which_child = i;
+            }
         }
-        NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
-        NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
-    }
-
-    /* the following code is slightly different depending on whether
-     * search stopped on a node or on a leaf */
-    if (find_state->node_is_leaf) {
-        /* get a handle to the current leaf that is being moved down
-         * the tree */
-        leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
-
-        /* copy the leaf's IP to the new parent, masking off the lower
-         * bits */
-        new_node->prefix = bitpos;
-        IPSET_IPV6_COPY_AND_MASK(&new_node->ip, &leaf->ip, bitpos);
-
-        /* put the leaf under new_node */
-        which_child = WHICH_CHILD_V6(&leaf->ip, new_node->prefix);
-        if (NUM_BITS <= leaf->prefix - new_node->prefix) {
-            /* leaf occupies a single child[] entry */
-            new_node->child[which_child] = find_state->node_idx;
-            NODEPTR_CHILD_SET_LEAF(new_node, which_child);
 
-        } else {
-            for (i = which_child, j = 0;
-                 j < (1u << (NUM_BITS - (leaf->prefix - new_node->prefix)));
-                 ++i, ++j)
-            {
-                new_node->child[i] = find_state->node_idx;
+        if (which_child < IPSET_NUM_CHILDREN) {
+            /* the node has a single child; modify the node's parent
+             * to replace the node with the node's child */
+            if (!NODEPTR_CHILD_IS_LEAF(&node->v4, which_child)) {
+                /* the single child is another node; the easiest way
+                 * to handle this case is to copy the child over the
+                 * node, and leave the parent untouched */
+                node_idx = node->v4.child[which_child];
+                memcpy(node, NODE_PTR(ipset, node_idx),
+                       ipset->s.v3->nodes.entry_size);
+                break;
             }
-            NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
-            NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
+
+            child_idx = node->v4.child[which_child];
         }
 
-        /* get a handle to the parent, and update the child pointer on
-         * the parent */
-        if (find_state->parent_idx == IPSET_NO_PARENT) {
-            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
+        /* find the node in order to get a handle to the node's
+         * parent */
+        if (0 == node->v4.prefix) {
+            /* cannot call ipsetFindVx() with a prefix of 0, but that
+             * can only happen at the root */
+            find_state.parent_idx = IPSET_NO_PARENT;
+#if SK_ENABLE_IPV6
+        } else if (ipset->is_ipv6) {
+#ifndef NDEBUG
+            int rv =
+#endif
+                ipsetFindV6(ipset, &node->v6.ip, node->v6.prefix, &find_state);
+            assert(SKIPSET_OK == rv || SKIPSET_ERR_SUBSET == rv);
+            assert(find_state.node_idx == node_idx && !find_state.node_is_leaf);
+#endif  /* SK_ENABLE_IPV6 */
         } else {
-            parent = NODE_PTR_V6(ipset, find_state->parent_idx);
-            which_child = WHICH_CHILD_V6(&leaf->ip, parent->prefix);
-            assert(parent->child[which_child] == find_state->node_idx);
-            parent->child[which_child] = new_node_idx;
-            NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+#ifndef NDEBUG
+            int rv =
+#endif
+                ipsetFindV4(ipset, node->v4.ip, node->v4.prefix, &find_state);
+            assert(SKIPSET_OK == rv || SKIPSET_ERR_SUBSET == rv);
+            assert(find_state.node_idx == node_idx && !find_state.node_is_leaf);
         }
 
-    } else {
-        /* get a handle to the current node that is being moved down
-         * the tree */
-        ipset_node_v6_t *node = NODE_PTR_V6(ipset, find_state->node_idx);
-
-        /* copy the current node's IP to the new parent, masking off
-         * the lower bits */
-        new_node->prefix = bitpos;
-        IPSET_IPV6_COPY_AND_MASK(&new_node->ip, &node->ip, bitpos);
-
-        /* put the current node under new_node */
-        which_child = WHICH_CHILD_V6(&node->ip, new_node->prefix);
-        new_node->child[which_child] = find_state->node_idx;
+        if (which_child < IPSET_NUM_CHILDREN) {
+            /* wire the nodes's parent to the child (which is a leaf),
+             * then free the node */
+            if (IPSET_NO_PARENT == find_state.parent_idx) {
+                /* this node was the root */
+                IPSET_ROOT_INDEX_SET(ipset, child_idx, 1);
+            } else {
+                parent = NODE_PTR(ipset, find_state.parent_idx);
+                parent->v4.child[find_state.parents_child] = child_idx;
+                SET_BMAP_SET(parent->v4.child_is_leaf,
+                             find_state.parents_child);
+            }
+            break;
+        }
+        /* delete the node from the parent */
+        if (IPSET_NO_PARENT == find_state.parent_idx) {
+            /* this node was the root */
+            skIPSetRemoveAll(ipset);
+            ++remove_count;
+            return remove_count;
+        }
 
-        /* get a handle to the parent, and update the child pointer on
-         * the parent */
-        if (find_state->parent_idx == IPSET_NO_PARENT) {
-            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
-        } else {
-            parent = NODE_PTR_V6(ipset, find_state->parent_idx);
-            which_child = WHICH_CHILD_V6(&node->ip, parent->prefix);
-            assert(parent->child[which_child] == find_state->node_idx);
-            parent->child[which_child] = new_node_idx;
+        parent = NODE_PTR(ipset, find_state.parent_idx);
+        parent->v4.child[find_state.parents_child] = 0;
+        if (non_recursive) {
+            break;
         }
+
+        /* we have deleted the node from the parent.  see if the
+         * parent now has a single child  */
+        NODEIDX_FREE(ipset, node_idx);
+        ++remove_count;
+        node_idx = find_state.parent_idx;
+        node = parent;
     }
 
-    return SKIPSET_OK;
+    NODEIDX_FREE(ipset, node_idx);
+    ++remove_count;
+    return remove_count;
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetInsertRangeIPTree(ipset, ipaddr_start, ipaddr_end);
+ *  status = ipsetInsertAddressIPTree(ipset, ip, prefix);
  *
- *    Insert all IPv4 addresses from ipaddr_start to ipaddr_end
- *    inclusive into the IPset 'ipset'.
+ *    Helper function for skIPSetInsertAddress(); may also be called
+ *    by other internal functions.
+ *
+ *    Insert the CIDR block 'ip'/'prefix' into 'ipset'.
  */
 static int
-ipsetInsertRangeIPTree(
+ipsetInsertAddressIPTree(
     skipset_t          *ipset,
-    const skipaddr_t   *ipaddr_start,
-    const skipaddr_t   *ipaddr_end)
+    uint32_t            ipv4,
+    uint32_t            prefix)
 {
-    skipaddr_t ipaddr4_start;
-    skipaddr_t ipaddr4_end;
-    skipaddr_t ipaddr4_next;
-    uint32_t prefix;
-    int rv = SKIPSET_OK;
+    const uint32_t prefix_as_bits[] = {
+        0xFFFFFFFF, 0xFFFF, 0xFF, 0xF, 0x3, 0x1
+    };
+    uint32_t ipv4_end;
 
     assert(ipset);
     assert(1 == ipset->is_iptree);
     assert(0 == ipset->is_ipv6);
+    assert(prefix > 0 || ipv4 == 0);
+    assert(prefix <= 32);
 
-    /* must be a valid range of IPv4 addresses containing two or more
-     * IP addresses */
-    assert(skipaddrCompare(ipaddr_start, ipaddr_end) < 0);
-    assert(!skipaddrIsV6(ipaddr_start) && !skipaddrIsV6(ipaddr_end));
-
-#if  SK_ENABLE_IPV6
-    if (skipaddrIsV6(ipaddr_start)) {
-        if (skipaddrV6toV4(ipaddr_start, &ipaddr4_start)) {
-            return SKIPSET_ERR_IPV6;
-        }
-    } else
-#endif  /* SK_ENABLE_IPV6 */
-    {
-        skipaddrCopy(&ipaddr4_start, ipaddr_start);
-    }
+    if (prefix >= 27) {
+        IPTREE_NODE_ALLOC(ipset, ipv4 >> 16);
+        ipset->s.v2->nodes[ipv4 >> 16]->addressBlock[(ipv4 & 0xFFFF) >> 5]
+            |= (prefix_as_bits[prefix - 27] << ((ipv4) & 0x1F));
 
-#if  SK_ENABLE_IPV6
-    if (skipaddrIsV6(ipaddr_end)) {
-        if (skipaddrV6toV4(ipaddr_end, &ipaddr4_end)) {
-            return SKIPSET_ERR_IPV6;
-        }
-    } else
-#endif  /* SK_ENABLE_IPV6 */
-    {
-        skipaddrCopy(&ipaddr4_end, ipaddr_end);
-    }
+    } else if (prefix <= 16) {
+        ipv4_end = ((UINT32_MAX >> prefix) | ipv4) >> 16;
+        ipv4 >>= 16;
+        do {
+            IPTREE_NODE_ALLOC(ipset, ipv4);
+            memset(ipset->s.v2->nodes[ipv4]->addressBlock,
+                   0xFF, sizeof(skIPNode_t));
+        } while (ipv4++ < ipv4_end);
 
-    ipset->is_dirty = 1;
+    } else {
+        /* 16 < prefix < 27 */
 
-    do {
-        prefix = skCIDRComputePrefix(&ipaddr4_start, &ipaddr4_end,
-                                     &ipaddr4_next);
-        rv = ipsetInsertAddressIPTree(ipset, skipaddrGetV4(&ipaddr4_start),
-                                      prefix);
-        skipaddrCopy(&ipaddr4_start, &ipaddr4_next);
-    } while (SKIPSET_OK == rv && !skipaddrIsZero(&ipaddr4_start));
+        IPTREE_NODE_ALLOC(ipset, ipv4 >> 16);
+        memset(&ipset->s.v2->nodes[ipv4>>16]->addressBlock[(ipv4 & 0xFFFF)>>5],
+               0xFF, (sizeof(skIPNode_t) >> (prefix - 16)));
+    }
 
-    return rv;
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetInsertRangeV4(ipset, v4_start, num_ips);
+ *  status = ipsetInsertAddressV4(ipset, ip, prefix, find_state);
+ *  status = ipsetInsertAddressV6(ipset, ip, prefix, find_state);
  *
- *    Insert a CIDR block of size 'num_ips' that starts at 'v4_start'.
- *    'num_ips' must be an even multiple of 256 (a /24) and 'v4_start'
- *    must be the start of the /24.  'v4_start' is in native byte
- *    order.
- */
-static int
-ipsetInsertRangeV4(
-    skipset_t          *ipset,
-    uint32_t            v4_start,
-    uint32_t            num_ips)
-{
-    static const uint32_t bitmask[] = {
-        /*  0- 3 */ 0xffffffff, 0x7fffffff, 0x3fffffff, 0x1fffffff,
-        /*  4- 7 */  0xfffffff,  0x7ffffff,  0x3ffffff,  0x1ffffff,
-        /*  8-11 */   0xffffff,   0x7fffff,   0x3fffff,   0x1fffff,
-        /* 12-15 */    0xfffff,    0x7ffff,    0x3ffff,    0x1ffff,
-        /* 16-19 */     0xffff,     0x7fff,     0x3fff,     0x1fff,
-        /* 20-23 */      0xfff,      0x7ff,      0x3ff,      0x1ff,
-        /* 24-27 */       0xff,       0x7f,       0x3f,       0x1f,
-        /* 28-31 */        0xf,        0x7,        0x3,        0x1,
-        /* 32    */        0x0
-    };
-
-    uint32_t range_start;
-    int prefix;
-    int rv;
-
-    assert(0 == (v4_start & 0xFF));
-    assert(0 == (num_ips & 0xFF));
-    assert(num_ips > 0);
-
-    do {
-        /* compute the log-base-2 (position of most significant bit)
-         * of the number of IPs in the range, and subtract that from
-         * 32 to get the widest possible CIDR block */
-        prefix = 32 - skIntegerLog2(num_ips);
-
-        /* tighten the range if we need to, in case the IPs don't fall
-         * into a single CIDR block (e.g., 10.0.6.0--10.0.9.0) */
-        while ((range_start = (v4_start & ~(bitmask[prefix]))) < v4_start) {
-            ++prefix;
-        }
-
-        /* assert that the CIDR block is within the limits */
-        assert(range_start == v4_start);
-        assert((range_start | (bitmask[prefix])) <= (num_ips - 1 + v4_start));
-
-        /* insert the CIDR block */
-        rv = ipsetInsertAddressV4(ipset, v4_start, prefix, NULL);
-        if (rv) {
-            break;
-        }
-
-        /* compute the start of the next CIDR block and the number of
-         * IPs yet to process */
-        v4_start += (1u << (32 - prefix));
-        num_ips -= (1u << (32 - prefix));
-
-    } while (num_ips);
-
-    return rv;
-}
-
-
-/*
- *  status = ipsetIntersectCallback(ipaddr, prefix, state);
+ *    Helper function for skIPSetInsertAddress(); may also be called
+ *    by other internal functions.
  *
- *    Callback function used by skIPSetIntersect().
+ *    Insert the CIDR block 'ip'/'prefix' into the Radix-Tree based
+ *    'ipset'.  'find_state' may be NULL.  If not NULL, 'find_state'
+ *    should be the result of calling ipsetFindVx() for the
+ *    'ip'/'prefix'.  Do not call this function with a non-NULL
+ *    'find_state' if ipsetFindVx() found the IP address.
  *
- *    This function will return SKIPSET_OK to continue walking over
- *    the IPs, SKIPSET_ERR_ALLOC for an allocation error, or
- *    SKIPSET_ERR_SUBSET when the iterator runs out of IPs to
- *    visit---which will stop the skIPSetWalk().
+ *    Return SKIPSET_OK when the IP was successfully inserted, or
+ *    SKIPSET_ERR_ALLOC if there is not enough memory to insert the
+ *    IP.
  */
 static int
-ipsetIntersectCallback(
-    skipaddr_t         *start_addr,
-    uint32_t            prefix,
-    void               *v_state)
+ipsetInsertAddressV4(
+    skipset_t          *ipset,
+    const uint32_t      ipv4,
+    const uint32_t      prefix,
+    const ipset_find_t *find_state)
 {
-    ipset_intersect_t *state = (ipset_intersect_t*)v_state;
-    skipaddr_t walk_addr[2];
-    int walk_next = 0;
+    ipset_find_t find_state_local;
+    ipset_node_v4_t *parent = NULL;
+    ipset_leaf_v4_t *leaf = NULL;
+    ipset_node_v4_t *new_node;
+    uint32_t new_node_idx;
+    uint32_t new_leaf_idx[IPSET_NUM_CHILDREN];
+    uint32_t which_child;
+    uint32_t bitpos;
+    uint32_t i;
+    uint32_t j;
+    int rv;
 
-    /* get the start and end IPs for the CIDR block */
-    skCIDR2IPRange(start_addr, prefix, &walk_addr[0], &walk_addr[1]);
+    assert(ipset);
+    assert(prefix > 0 || ipv4 == 0);
+    assert(prefix <= 32);
+    assert(0 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
 
-    for (;;) {
-        /* test (iter.final <= walk.final) */
-        if (skipaddrCompare(&state->addr[1], &walk_addr[1]) <= 0) {
+    /* use the passed in 'find_state' if given */
+    if (find_state) {
+        rv = find_state->result;
+    } else {
+        rv = ipsetFindV4(ipset, ipv4, prefix, &find_state_local);
+        /* if IP was found, we can return */
+        if (SKIPSET_OK == rv) {
+            return SKIPSET_OK;
+        }
+        find_state = &find_state_local;
+    }
+    ipset->is_dirty = 1;
 
-            /* test (iter.begin >= walk.begin) */
-            if (skipaddrCompare(&state->addr[0], &walk_addr[0]) >= 0) {
-                /* The iter block is completely contained in---or
-                 * identical to---the walk block.  Add the iter
-                 * block to the vector.
-                 *
-                 * iter block:             |---------|
-                 * walk block: |---------------------------------|
-                 */
-                if (skVectorAppendValue(state->vec_add, state->addr)) {
-                    return SKIPSET_ERR_ALLOC;
-                }
+    if (SKIPSET_ERR_EMPTY == rv) {
+        /* tree was previously empty */
+        /* create a new leaf to hold the IP. create an extra node and
+         * extra leaf since node#0 and leaf#0 are always empty */
+        if (ipsetNewEntries(ipset, 1, 2, &new_node_idx, new_leaf_idx)) {
+            return SKIPSET_ERR_ALLOC;
+        }
+        assert(0 == new_node_idx);
+        assert(0 == new_leaf_idx[0]);
+        assert(1 == new_leaf_idx[1]);
+        IPSET_ROOT_INDEX_SET(ipset, new_leaf_idx[1], 1);
+        leaf = LEAF_PTR_V4(ipset, new_leaf_idx[IPSET_ROOT_INDEX(ipset)]);
+        leaf->ip = ipv4;
+        leaf->prefix = prefix;
+        return SKIPSET_OK;
+    }
 
-                /* test (iter.final >= walk.begin) */
-            } else if (skipaddrCompare(&state->addr[1], &walk_addr[0]) >= 0) {
-                /* Add the IPs between walk.begin and iter.final.
-                 *
-                 * iter block:             |---------|
-                 * walk block:                 |---------|
-                 */
-                skipaddrCopy(&state->addr[0], &walk_addr[0]);
-                if (skVectorAppendValue(state->vec_add, state->addr)) {
-                    return SKIPSET_ERR_ALLOC;
-                }
+    if (SKIPSET_ERR_SUBSET == rv) {
+        /* we're adding an IP/PREFIX where part of the IP space
+         * already exists in the IPSet.  Modify this node's values to
+         * hold the larger block, and remove any nodes below here. */
+        if (IPSET_NO_PARENT == find_state->parent_idx) {
+            if (IPSET_ROOT_IS_LEAF(ipset)) {
+                leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
+            } else {
+                new_leaf_idx[0] = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
+                leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
             }
+            leaf->ip = ipv4;
+            leaf->prefix = prefix;
+            return SKIPSET_OK;
+        }
 
-            /* Else, the iter block is completely below the current walk
-             * block; and there is nothing to do.
-             *
-             * iter block:             |---------|
-             * walk block:                         |---------|
-             */
+        /* get a handle to the parent */
+        parent = NODE_PTR_V4(ipset, find_state->parent_idx);
 
-            /* If the end IPs are identical, refresh both blocks; else
-             * go to next iter block */
-            if (skipaddrCompare(&state->addr[1], &walk_addr[1]) == 0) {
-                walk_next = 1;
+        if (NUM_BITS <= prefix - parent->prefix) {
+            /* leaf has a single child[] entry on the parent */
+            if (find_state->node_is_leaf) {
+                /* we can modify the leaf and be done */
+                leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
+            } else {
+                /* need to replace the node with a leaf */
+                new_leaf_idx[0]
+                    = ipsetReplaceNodeWithLeaf(ipset, (ipset_node_t*)parent,
+                                               find_state->parents_child);
+                leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
             }
+            leaf->ip = ipv4;
+            leaf->prefix = prefix;
+            return SKIPSET_OK;
+        }
 
-            if (skIPSetIteratorNext(&state->iter, &state->addr[0], &prefix)) {
-                /* return some value so we stop walking over the IPs */
-                return SKIPSET_ERR_SUBSET;
+        /* this leaf will cover several child[] entries on the parent.
+         * destroy any existing children and attempt to find a leaf on
+         * this level to use  */
+        new_leaf_idx[0] = 0;
+        for (i = find_state->parents_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i]
+                && !NODEPTR_CHILD_IS_REPEAT(parent, i))
+            {
+                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                    /* delete this subtree */
+                    ipsetDestroySubtree(ipset, parent->child[i], 1);
+                } else if (0 == new_leaf_idx[0]) {
+                    /* found a leaf to use */
+                    new_leaf_idx[0] = parent->child[i];
+                } else {
+                    /* do not need this leaf */
+                    LEAFIDX_FREE(ipset, parent->child[i]);
+                }
             }
-            skCIDR2IPRange(&state->addr[0], prefix,
-                           &state->addr[0], &state->addr[1]);
-            if (walk_next) {
-                break;
+        }
+
+        if (0 == new_leaf_idx[0]) {
+            /* no leaves available, need to allocate one */
+            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
+                return SKIPSET_ERR_ALLOC;
             }
+        }
 
-        } else {
+        leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
+        leaf->ip = ipv4;
+        leaf->prefix = prefix;
 
-            /* test (iter.begin <= walk.begin) */
-            if (skipaddrCompare(&state->addr[0], &walk_addr[0]) <= 0) {
-                /* The walk is completely contained in the iter block.
-                 * Add the walk block to the vector.
-                 *
-                 * iter block:             |---------|
-                 * walk block:               |-----|
-                 */
-                if (skVectorAppendValue(state->vec_add, walk_addr)) {
-                    return SKIPSET_ERR_ALLOC;
-                }
+        /* set child[] entries on 'parent' to point at the new leaf */
+        /* set additional child[]s to also point at the leaf */
+        for (i = find_state->parents_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            parent->child[i] = new_leaf_idx[0];
+        }
+        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
+        NODEPTR_CHILD_SET_REPEAT2(parent, 1+find_state->parents_child, i - 1);
+        return SKIPSET_OK;
+    }
 
-                /* test (iter.begin <= walk.final) */
-            } else if (skipaddrCompare(&state->addr[0], &walk_addr[1]) <= 0) {
-                /* Add the IPs between iter.begin and walk.final.
-                 *
-                 * iter block:             |---------|
-                 * walk block:         |---------|
-                 */
-                skipaddrCopy(&walk_addr[0], &state->addr[0]);
-                if (skVectorAppendValue(state->vec_add, walk_addr)) {
-                    return SKIPSET_ERR_ALLOC;
-                }
-            }
+    if (SKIPSET_ERR_MULTILEAF == rv) {
+        /* get a handle to the current node */
+        parent = NODE_PTR_V4(ipset, find_state->parent_idx);
 
-            /* Else, the iter block is completely above the walk block,
-             * and there is nothing to do.
-             *
-             * iter block:             |---------|
-             * walk block: |---------|
-             */
+        if (NUM_BITS <= prefix - parent->prefix) {
+            /* need to add a single leaf and have a single child[]
+             * entry on 'parent' point to that leaf */
+            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            /* get a handle to the newly created leaf and copy the new
+             * IP there */
+            leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
+            leaf->ip = ipv4;
+            leaf->prefix = prefix;
 
-            /* Go to next walk block */
-            break;
+            /* set pointer on 'parent' to point at the new leaf */
+            parent->child[find_state->parents_child] = new_leaf_idx[0];
+            NODEPTR_CHILD_SET_LEAF(parent, find_state->parents_child);
+            return SKIPSET_OK;
         }
-    }
-    return SKIPSET_OK;
-}
-
-
-/*
- *  ipsetIteratorNextIPTree(iter, ipaddr, prefix);
- *
- *    Helper function for skIPSetIteratorNext() when the IPset is a
- *    SiLK-2 style IPTree.
- */
-static int
-ipsetIteratorNextIPTree(
-    skipset_iterator_t *iter,
-    skipaddr_t         *ipaddr,
-    uint32_t           *prefix)
-{
-    skIPTreeCIDRBlock_t cidr;
-    int rv = SK_ITERATOR_NO_MORE_ENTRIES;
 
-    switch (iter->v6policy) {
-      case SK_IPV6POLICY_ONLY:
-        /* since we do not support IPv6 addresses in the IPTree data
-         * structure, there is nothing to return */
-        break;
-
-      case SK_IPV6POLICY_FORCE:
-#if !SK_ENABLE_IPV6
-        break;
-#else
-        if (iter->cidr_blocks) {
-            rv = skIPTreeCIDRBlockIteratorNext(&cidr, &iter->iter.v2cidr);
-            if (SK_ITERATOR_OK == rv) {
-                skipaddrSetV6FromUint32(ipaddr, &cidr.addr);
-                *prefix = 96 + cidr.mask;
+        /* this leaf will cover several child[] entries on the parent.
+         * see if any are occupied. */
+        new_leaf_idx[0] = 0;
+        for (i = find_state->parents_child + 1, j = 1u;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i] && NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                new_leaf_idx[0] = parent->child[i];
+                break;
             }
-        } else {
-            rv = skIPTreeIteratorNext(&cidr.addr, &iter->iter.v2ip);
-            if (SK_ITERATOR_OK == rv) {
-                skipaddrSetV6FromUint32(ipaddr, &cidr.addr);
-                *prefix = 128;
+        }
+        if (new_leaf_idx[0] == 0) {
+            /* no leaves available, need to allocate one */
+            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
+                return SKIPSET_ERR_ALLOC;
             }
         }
-        break;
-#endif  /* #else of #if !SK_ENABLE_IPV6 */
 
-      case SK_IPV6POLICY_MIX:
-      case SK_IPV6POLICY_ASV4:
-      case SK_IPV6POLICY_IGNORE:
-        if (iter->cidr_blocks) {
-            rv = skIPTreeCIDRBlockIteratorNext(&cidr, &iter->iter.v2cidr);
-            if (SK_ITERATOR_OK == rv) {
-                skipaddrSetV4(ipaddr, &cidr.addr);
-                *prefix = cidr.mask;
-            }
-        } else {
-            rv = skIPTreeIteratorNext(&cidr.addr, &iter->iter.v2ip);
-            if (SK_ITERATOR_OK == rv) {
-                skipaddrSetV4(ipaddr, &cidr.addr);
-                *prefix = 32;
+        leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
+        leaf->ip = ipv4;
+        leaf->prefix = prefix;
+
+        /* set child[] on 'parent' to point at the new leaf */
+        parent->child[find_state->parents_child] = new_leaf_idx[0];
+
+        /* set additional child[]s to also point at the leaf */
+        for (i = find_state->parents_child + 1, j = 1u;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i]) {
+                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                    /* delete this subtree */
+                    ipsetDestroySubtree(ipset, parent->child[i], 1);
+                } else if (parent->child[i] != new_leaf_idx[0]) {
+                    /* do not need this leaf */
+                    LEAFIDX_FREE(ipset, parent->child[i]);
+                }
             }
+            parent->child[i] = new_leaf_idx[0];
         }
-        break;
+        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
+        if (j > 1) {
+            NODEPTR_CHILD_SET_REPEAT2(parent, 1 + find_state->parents_child,
+                                      i - 1);
+        }
+        return SKIPSET_OK;
     }
-    return rv;
-}
-
 
-/*
- *  ipsetIteratorNextRangeV4(iter);
- *  ipsetIteratorNextRangeV6(iter);
- *
- *    Helper functions for skIPSetIteratorNext().
- *
- *    Update the IPset iterator 'iter' to contain the starting and
- *    stopping IPs values for the CIDR block on the current leaf.
- *    Assumes the 'cur' field on the iterator is pointing at a valid
- *    leaf.
- */
-static void
-ipsetIteratorNextRangeV4(
-    skipset_iterator_t *iter)
-{
-    ipset_leaf_v4_t *leaf = LEAF_PTR_V4(iter->ipset, iter->iter.v3.cur);
+    /* we must add a new node and a new leaf to the tree.  The leaf
+     * holds the IP being inserted.  The node holds the CIDR block
+     * containing the leaf and our current node---that is, it becomes
+     * a new parent; we must also update the index on the current
+     * node's parent to point to the new parent. */
 
-    if (32 == leaf->prefix) {
-        iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip;
-    } else {
-        iter->iter.v3.data[0] = leaf->ip;
-        iter->iter.v3.data[2] = (leaf->ip | (UINT32_MAX >> leaf->prefix));
+    /* create the two new entries */
+    if (ipsetNewEntries(ipset, 1, 1, &new_node_idx, new_leaf_idx)) {
+        return SKIPSET_ERR_ALLOC;
     }
-}
 
-#if SK_ENABLE_IPV6
-static void
-ipsetIteratorNextRangeV6(
-    skipset_iterator_t *iter)
-{
-    ipset_leaf_v6_t *leaf = LEAF_PTR_V6(iter->ipset, iter->iter.v3.cur);
+    /* get a handle to the newly created node */
+    new_node = NODE_PTR_V4(ipset, new_node_idx);
 
-    if (SK_IPV6POLICY_ASV4 == iter->v6policy) {
-        /* check stopping condition */
-        if (leaf->ip.ip[0] != 0
-            || ((UINT64_C(0xffffffff00000000) & leaf->ip.ip[1])
-                != UINT64_C(0x0000ffff00000000)))
+    bitpos = find_state->bitpos & ~(NUM_BITS - 1);
+
+    /* get a handle to the newly created leaf, copy the inserted IP
+     * there, and link it to the new_node. */
+    leaf = LEAF_PTR_V4(ipset, new_leaf_idx[0]);
+    leaf->ip = ipv4;
+    leaf->prefix = prefix;
+    which_child = WHICH_CHILD_V4(ipv4, bitpos);
+    if (NUM_BITS <= prefix - bitpos) {
+        /* adding a single child[] entry */
+        new_node->child[which_child] = new_leaf_idx[0];
+        NODEPTR_CHILD_SET_LEAF(new_node, which_child);
+
+    } else {
+        /* this leaf will cover several child[] values on the node. */
+        for (i = which_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - bitpos)));
+             ++i, ++j)
         {
-            iter->iter.v3.cur = iter->ipset->s.v3->leaves.entry_count;
-            return;
+            new_node->child[i] = new_leaf_idx[0];
         }
+        NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
+        NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
     }
 
-    if (leaf->prefix > 64) {
-        if (leaf->prefix == 128) {
-            iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip.ip[0];
-            iter->iter.v3.data[1] = iter->iter.v3.data[3] = leaf->ip.ip[1];
+    /* the following code is slightly different depending on whether
+     * search stopped on a node or on a leaf */
+    if (find_state->node_is_leaf) {
+        /* get a handle to the current leaf that is being moved down
+         * the tree */
+        leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
+
+        /* copy the leaf's IP to the new parent, masking off the lower
+         * bits */
+        new_node->prefix = bitpos;
+        new_node->ip = leaf->ip & ~(UINT32_MAX >> new_node->prefix);
+
+        /* put the leaf under new_node */
+        which_child = WHICH_CHILD_V4(leaf->ip, new_node->prefix);
+        if (NUM_BITS <= leaf->prefix - new_node->prefix) {
+            /* leaf occupies a single child[] entry */
+            new_node->child[which_child] = find_state->node_idx;
+            NODEPTR_CHILD_SET_LEAF(new_node, which_child);
+
         } else {
-            iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip.ip[0];
-            iter->iter.v3.data[1] = leaf->ip.ip[1];
-            iter->iter.v3.data[3] = (leaf->ip.ip[1]
-                             | (UINT64_MAX >> (leaf->prefix - 64)));
+            for (i = which_child, j = 0;
+                 j < (1u << (NUM_BITS - (leaf->prefix - new_node->prefix)));
+                 ++i, ++j)
+            {
+                new_node->child[i] = find_state->node_idx;
+            }
+            NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
+            NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
         }
-    } else if (leaf->prefix == 64) {
-        iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip.ip[0];
-        iter->iter.v3.data[1] = iter->iter.v3.data[3] = UINT64_MAX;
-    } else {
-        iter->iter.v3.data[0] = leaf->ip.ip[0];
-        iter->iter.v3.data[2] = (leaf->ip.ip[0]
-                         | (UINT64_MAX >> leaf->prefix));
-        iter->iter.v3.data[1] = iter->iter.v3.data[3] = UINT64_MAX;
-    }
-}
-#endif  /* SK_ENABLE_IPV6 */
 
+        /* get a handle to the parent, and update the child pointer on
+         * the parent */
+        if (find_state->parent_idx == IPSET_NO_PARENT) {
+            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
+        } else {
+            parent = NODE_PTR_V4(ipset, find_state->parent_idx);
+            which_child = WHICH_CHILD_V4(leaf->ip, parent->prefix);
+            assert(parent->child[which_child] == find_state->node_idx);
+            parent->child[which_child] = new_node_idx;
+            NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+        }
 
-/*
- *  cmp = ipsetLeafCompareV4(leaf_a, leaf_b);
- *  cmp = ipsetLeafCompareV6(leaf_a, leaf_b);
- *
- *    Return -1, 0, 1 depending on whether the IP on leaf_a is less
- *    than, equal to, or greater than the IP on leaf_b.
- *
- *    This function compares the first IP in each leaf; it does not
- *    consider the case where one leaf contains a netblock that is a
- *    subset of the netblock on another leaf.
- */
-static int
-ipsetLeafCompareV4(
-    const void         *va,
-    const void         *vb)
-{
-    const uint32_t a = ((const ipset_leaf_v4_t *)va)->ip;
-    const uint32_t b = ((const ipset_leaf_v4_t *)vb)->ip;
-    if (a < b) {
-        return -1;
-    }
-    return (a > b);
-}
-
-#if SK_ENABLE_IPV6
-static int
-ipsetLeafCompareV6(
-    const void         *va,
-    const void         *vb)
-{
-    const ipset_ipv6_t *a = &((const ipset_leaf_v6_t *)va)->ip;
-    const ipset_ipv6_t *b = &((const ipset_leaf_v6_t *)vb)->ip;
-    if (a->ip[0] < b->ip[0]) {
-        return -1;
-    }
-    if (a->ip[0] > b->ip[0]) {
-        return 1;
-    }
-    if (a->ip[1] < b->ip[1]) {
-        return -1;
-    }
-    return (a->ip[1] > b->ip[1]);
-}
-#endif  /* SK_ENABLE_IPV6 */
-
-
-/*
- *  status = ipsetMaskAddLeavesV4(ipset, mask_prefix, leaf);
- *  status = ipsetMaskAddLeavesV6(ipset, mask_prefix, leaf);
- *
- *    Helper function for ipsetMaskVx().
- *
- *    Given 'leaf' that contains a CIDR block, remove 'leaf' from the
- *    'ipset' and add new leaves, where each new leaf is a single IP
- *    address (a /32 or /128), and the step size between the IPs is
- *    1<<(32-mask_prefix) or 1<<(128-mask_prefix).
- *
- *    Return SKIPSET_OK or SKIPSET_ERR_ALLOC.
- */
-static int
-ipsetMaskAddLeavesV4(
-    skipset_t          *ipset,
-    const uint32_t      mask_prefix,
-    ipset_leaf_v4_t    *leaf)
-{
-    const uint32_t step = 1u << (32 - mask_prefix);
-    uint32_t ipv4;
-    uint32_t final;
-    int rv;
-
-    /* get the ip address */
-    ipv4 = leaf->ip;
+    } else {
+        /* get a handle to the current node that is being moved down
+         * the tree */
+        ipset_node_v4_t *node = NODE_PTR_V4(ipset, find_state->node_idx);
 
-    /* compute the final ip address for our stopping condition */
-    final = ((ipv4 | (UINT32_MAX >> leaf->prefix))
-             & ~(UINT32_MAX >> mask_prefix));
+        /* copy the current node's IP to the new parent, masking off
+         * the lower bits */
+        new_node->prefix = bitpos;
+        new_node->ip = node->ip & ~(UINT32_MAX >> bitpos);
 
-    /* set the prefix so this leaf is a single IP */
-    leaf->prefix = 32;
+        /* put the current node under new_node */
+        which_child = WHICH_CHILD_V4(node->ip, new_node->prefix);
+        new_node->child[which_child] = find_state->node_idx;
 
-    while (ipv4 < final) {
-        ipv4 += step;
-        rv = ipsetInsertAddressV4(ipset, ipv4, 32, NULL);
-        if (rv) {
-            return rv;
+        /* get a handle to the parent, and update the child pointer on
+         * the parent */
+        if (find_state->parent_idx == IPSET_NO_PARENT) {
+            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
+        } else {
+            parent = NODE_PTR_V4(ipset, find_state->parent_idx);
+            which_child = WHICH_CHILD_V4(node->ip, parent->prefix);
+            assert(parent->child[which_child] == find_state->node_idx);
+            parent->child[which_child] = new_node_idx;
         }
     }
+
     return SKIPSET_OK;
 }
 
 #if SK_ENABLE_IPV6
 static int
-ipsetMaskAddLeavesV6(
+ipsetInsertAddressV6(
     skipset_t          *ipset,
-    const uint32_t      mask_prefix,
-    ipset_leaf_v6_t    *leaf)
+    const ipset_ipv6_t *ipv6,
+    const uint32_t      prefix,
+    const ipset_find_t *find_state)
 {
-    ipset_ipv6_t ipv6;
-    ipset_ipv6_t final;
-    ipset_ipv6_t step;
+    ipset_find_t find_state_local;
+    ipset_node_v6_t *parent = NULL;
+    ipset_leaf_v6_t *leaf = NULL;
+    ipset_node_v6_t *new_node;
+    uint32_t new_node_idx;
+    uint32_t new_leaf_idx[IPSET_NUM_CHILDREN];
+    uint32_t which_child;
+    uint32_t bitpos;
+    uint32_t i;
+    uint32_t j;
     int rv;
 
-    /* get the first address in this block */
-    ipv6.ip[0] = leaf->ip.ip[0];
-    ipv6.ip[1] = leaf->ip.ip[1];
-
-    /* code in the bodies of the following if/else differ by size of
-     * prefix */
-    if (mask_prefix <= 64) {
-        /* this affects only the most significant 64 bits */
-        assert(leaf->prefix < 64);
-
-        /* determine the final address in this block */
-        final.ip[0] = ((ipv6.ip[0] | (UINT64_MAX >> leaf->prefix))
-                       & ((mask_prefix < 64)
-                          ? ~(UINT64_MAX >> mask_prefix)
-                          : UINT64_MAX));
-
-        /* get the step size */
-        step.ip[0] = UINT64_C(1) << (64 - mask_prefix);
-
-        /* modify starting leaf to be a single IP */
-        leaf->prefix = 128;
+    assert(ipset);
+    assert(ipv6);
+    assert(0 < prefix && prefix <= 128);
+    assert(0 == ipset->is_iptree);
+    assert(1 == ipset->is_ipv6);
 
-        while (ipv6.ip[0] < final.ip[0]) {
-            ipv6.ip[0] += step.ip[0];
-            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
-            if (rv) { return rv; }
+    if (find_state) {
+        rv = find_state->result;
+    } else {
+        rv = ipsetFindV6(ipset, ipv6, prefix, &find_state_local);
+        /* if IP was found, we can return */
+        if (SKIPSET_OK == rv) {
+            return SKIPSET_OK;
         }
+        find_state = &find_state_local;
+    }
+    ipset->is_dirty = 1;
 
-    } else if (leaf->prefix > 64) {
-        /* this affects only the least significant 64 bits */
-        assert(mask_prefix > 64);
-
-        /* determine the final address in this block */
-        final.ip[1] = ((ipv6.ip[1] | (UINT64_MAX >> (leaf->prefix - 64)))
-                       & ~(UINT64_MAX >> (mask_prefix - 64)));
-
-        /* get the step size */
-        step.ip[1] = UINT64_C(1) << (128 - mask_prefix);
-
-        /* modify starting leaf to be a single IP */
-        leaf->prefix = 128;
-
-        while (ipv6.ip[1] < final.ip[1]) {
-            ipv6.ip[1] += step.ip[1];
-            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
-            if (rv) { return rv; }
+    if (SKIPSET_ERR_EMPTY == rv) {
+        /* tree was previously empty */
+        /* create a new node to hold the IP */
+        if (ipsetNewEntries(ipset, 1, 2, &new_node_idx, new_leaf_idx)) {
+            return SKIPSET_ERR_ALLOC;
         }
+        assert(0 == new_node_idx);
+        assert(0 == new_leaf_idx[0]);
+        assert(1 == new_leaf_idx[1]);
+        IPSET_ROOT_INDEX_SET(ipset, new_leaf_idx[1], 1);
+        leaf = LEAF_PTR_V6(ipset, new_leaf_idx[IPSET_ROOT_INDEX(ipset)]);
+        IPSET_IPV6_COPY(&leaf->ip, ipv6);
+        leaf->prefix = prefix;
+        return SKIPSET_OK;
+    }
 
-    } else {
-        assert(mask_prefix > 64);
-        assert(leaf->prefix <= 64);
-
-        /* determine the final address in this block */
-        final.ip[0] = ipv6.ip[0] | ((leaf->prefix < 64)
-                                    ? (UINT64_MAX >> leaf->prefix)
-                                    : 0);
-        final.ip[1] = ~(UINT64_MAX >> (mask_prefix - 64));
-
-        /* get the step size */
-        step.ip[1] = UINT64_C(1) << (128 - mask_prefix);
-
-        /* modify starting leaf to be a single IP */
-        leaf->prefix = 128;
-
-        while (ipv6.ip[0] < final.ip[0]) {
-            if (ipv6.ip[1] <= UINT64_MAX - step.ip[1]) {
-                ipv6.ip[1] += step.ip[1];
+    if (SKIPSET_ERR_SUBSET == rv) {
+        /* we're adding an IP/PREFIX where part of the IP space
+         * already exists in the IPSet.  Modify this node's values to
+         * hold the larger block, and remove any nodes below here. */
+        if (IPSET_NO_PARENT == find_state->parent_idx) {
+            if (IPSET_ROOT_IS_LEAF(ipset)) {
+                leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
             } else {
-                /* handle rollover */
-                ++ipv6.ip[0];
-                ipv6.ip[1] -= (UINT64_MAX - step.ip[1]) + 1;
+                new_leaf_idx[0] = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
+                leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
             }
-            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
-            if (rv) { return rv; }
-        }
-        while (ipv6.ip[1] < final.ip[1]) {
-            ipv6.ip[1] += step.ip[1];
-            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
-            if (rv) { return rv; }
+            IPSET_IPV6_COPY(&leaf->ip, ipv6);
+            leaf->prefix = prefix;
+            return SKIPSET_OK;
         }
-    }
-
-    return SKIPSET_OK;
-}
-#endif  /* SK_ENABLE_IPV6 */
 
+        /* get a handle to the parent */
+        parent = NODE_PTR_V6(ipset, find_state->parent_idx);
 
-/*
- *  status = ipsetMaskV4(ipset, mask_prefix)
- *  status = ipsetMaskV6(ipset, mask_prefix)
- *
- *    Helper function for skIPSetMask().
- *
- *    For each block of size 'mask_prefix', if any IPs in that block
- *    are set, remove all IPs in the block and replace with with a
- *    single IP.
- */
-static int
-ipsetMaskV4(
-    skipset_t          *ipset,
-    const uint32_t      mask_prefix)
-{
-    ipset_node_v4_t *node;
-    ipset_leaf_v4_t *leaf;
-    uint32_t child_idx;
-    uint32_t node_idx;
-    uint32_t new_leaf_idx;
-    uint32_t children_per_leaf;
-    uint32_t ipv4;
-    uint32_t i;
-    uint32_t j;
-    uint32_t depth;
-    uint32_t to_visit[IPSET_MAX_DEPTH_V4];
-    int rv = SKIPSET_OK;
+        if (NUM_BITS <= prefix - parent->prefix) {
+            /* leaf has a single child[] entry on the parent */
+            if (find_state->node_is_leaf) {
+                /* we can modify the leaf and be done */
+                leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
+            } else {
+                /* need to replace the node with a leaf */
+                new_leaf_idx[0]
+                    = ipsetReplaceNodeWithLeaf(ipset, (ipset_node_t*)parent,
+                                               find_state->parents_child);
+                leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+            }
+            IPSET_IPV6_COPY(&leaf->ip, ipv6);
+            leaf->prefix = prefix;
+            return SKIPSET_OK;
+        }
 
-    ipset->is_dirty = 1;
+        /* this leaf will cover several child[] entries on the parent.
+         * destroy any existing children and attempt to find a leaf on
+         * this level to use  */
+        new_leaf_idx[0] = 0;
+        for (i = find_state->parents_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i]
+                && !NODEPTR_CHILD_IS_REPEAT(parent, i))
+            {
+                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                    /* delete this subtree */
+                    ipsetDestroySubtree(ipset, parent->child[i], 1);
+                } else if (0 == new_leaf_idx[0]) {
+                    /* found a leaf to use */
+                    new_leaf_idx[0] = parent->child[i];
+                } else {
+                    /* do not need this leaf */
+                    LEAFIDX_FREE(ipset, parent->child[i]);
+                }
+            }
+        }
 
-    /* handle case where root is a leaf */
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        leaf = LEAF_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
-        if (leaf->prefix >= mask_prefix) {
-            /* leaf spans fewer IPs than specified by 'mask_prefix'.
-             * Modify the leaf's IP and prefix and return */
-            leaf->ip &= ~(UINT32_MAX >> mask_prefix);
-            leaf->prefix = 32;
-            return SKIPSET_OK;
+        if (0 == new_leaf_idx[0]) {
+            /* no leaves available, need to allocate one */
+            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
+                return SKIPSET_ERR_ALLOC;
+            }
         }
-        /* else, this leaf's prefix is more course (holds more IPs)
-         * than what we want; we must split the leaf into multiple
-         * nodes and leaves */
-        return ipsetMaskAddLeavesV4(ipset, mask_prefix, leaf);
-    }
 
-    /* handle case where root contains a node whose prefix is
-     * more-precise than the 'mask_prefix' */
-    node = NODE_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
-    if (node->prefix >= mask_prefix) {
-        ipv4 = node->ip;
-        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
-        leaf = LEAF_PTR_V4(ipset, new_leaf_idx);
-        leaf->ip = ipv4 &  ~(UINT32_MAX >> mask_prefix);
-        leaf->prefix = 32;
+        leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+        IPSET_IPV6_COPY(&leaf->ip, ipv6);
+        leaf->prefix = prefix;
+
+        /* set child[] entries on 'parent' to point at the new leaf */
+        /* set additional child[]s to also point at the leaf */
+        for (i = find_state->parents_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            parent->child[i] = new_leaf_idx[0];
+        }
+        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
+        NODEPTR_CHILD_SET_REPEAT2(parent, 1+find_state->parents_child, i - 1);
         return SKIPSET_OK;
     }
 
-    /* visit the nodes in the tree */
-    depth = 0;
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+    if (SKIPSET_ERR_MULTILEAF == rv) {
+        /* get a handle to the current node */
+        parent = NODE_PTR_V6(ipset, find_state->parent_idx);
 
-    while (depth) {
-        node_idx = to_visit[--depth];
-        node = NODE_PTR_V4(ipset, node_idx);
+        if (NUM_BITS <= prefix - parent->prefix) {
+            /* need to add a single leaf and have a single child[]
+             * entry on 'parent' point to that leaf */
+            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            /* get a handle to the newly created leaf and copy the new
+             * IP there */
+            leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+            IPSET_IPV6_COPY(&leaf->ip, ipv6);
+            leaf->prefix = prefix;
 
-        if (mask_prefix - node->prefix > NUM_BITS) {
-            /* this node is not at the bottom level of the tree; add
-             * child nodes of this node to the 'to_visit' list. modify
-             * any leaves to hold a single IP */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if ((0 == node->child[i])
-                    || NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    /* no-op */
-                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                    /* node; add to vist list unless its prefix is
-                     * larger than the mask, in which case replace
-                     * with a leaf */
-                    if (NODE_PTR_V4(ipset, node->child[i])->prefix
-                        <= mask_prefix)
-                    {
-                        to_visit[depth++] = node->child[i];
-                    } else {
-                        ipv4 = NODE_PTR_V4(ipset,node->child[i])->ip;
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                        leaf->ip = ipv4 & ~(UINT32_MAX >> mask_prefix);
-                        leaf->prefix = 32;
-                    }
-                } else {
-                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                    if (leaf->prefix >= mask_prefix) {
-                        leaf->ip &= ~(UINT32_MAX >> mask_prefix);
-                        leaf->prefix = 32;
-                    } else {
-                        /* this leaf's prefix is more course (holds
-                         * more IPs) than what we want; similar to
-                         * code above that handle leaf at the root */
+            /* set pointer on 'parent' to point at the new leaf */
+            parent->child[find_state->parents_child] = new_leaf_idx[0];
+            NODEPTR_CHILD_SET_LEAF(parent, find_state->parents_child);
+            return SKIPSET_OK;
+        }
 
-                        if (NUM_BITS > leaf->prefix - node->prefix) {
-                            /* leaf occupies multiple child[] entries;
-                             * clear all but the current one */
-                            for (j = 1;
-                                 ((j < (1u << (NUM_BITS -
-                                               (leaf->prefix - node->prefix))))
-                                  && ((i + j) < IPSET_NUM_CHILDREN));
-                                 ++j)
-                            {
-                                node->child[i+j] = 0;
-                            }
-                            NODEPTR_CHILD_CLEAR_LEAF2(node, i + 1, i + j - 1);
-                            NODEPTR_CHILD_CLEAR_REPEAT2(node, i + 1, i + j - 1);
-                        }
-                        rv = ipsetMaskAddLeavesV4(ipset, mask_prefix, leaf);
-                        if (rv) { return rv; }
-                        node = NODE_PTR_V4(ipset, node_idx);
-                    }
-                }
+        /* this leaf will cover several child[] entries on the parent.
+         * see if any are occupied. */
+        new_leaf_idx[0] = 0;
+        for (i = find_state->parents_child + 1, j = 1u;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i] && NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                new_leaf_idx[0] = parent->child[i];
+                break;
+            }
+        }
+        if (new_leaf_idx[0] == 0) {
+            /* no leaves available, need to allocate one */
+            if (ipsetNewEntries(ipset, 0, 1, NULL, new_leaf_idx)) {
+                return SKIPSET_ERR_ALLOC;
             }
+        }
 
-        } else if (mask_prefix - node->prefix == NUM_BITS) {
-            /* this node is on the bottom level of the tree, and every
-             * occupied child[] will become an independent leaf */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]) {
-                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                    } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
-                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
-                            return SKIPSET_ERR_ALLOC;
-                        }
-                        node->child[i] = new_leaf_idx;
-                        NODEPTR_CHILD_CLEAR_REPEAT(node, i);
-                    }
-                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                    leaf->ip = ((node->ip
-                                 | (i << (32 - NUM_BITS - node->prefix)))
-                                & ~(UINT32_MAX >> mask_prefix));
-                    leaf->prefix = 32;
+        leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+        IPSET_IPV6_COPY(&leaf->ip, ipv6);
+        leaf->prefix = prefix;
+
+        /* set child[] on 'parent' to point at the new leaf */
+        parent->child[find_state->parents_child] = new_leaf_idx[0];
+
+        /* set additional child[]s to also point at the leaf */
+        for (i = find_state->parents_child + 1, j = 1u;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i]) {
+                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                    /* delete this subtree */
+                    ipsetDestroySubtree(ipset, parent->child[i], 1);
+                } else if (parent->child[i] != new_leaf_idx[0]) {
+                    /* do not need this leaf */
+                    LEAFIDX_FREE(ipset, parent->child[i]);
                 }
             }
+            parent->child[i] = new_leaf_idx[0];
+        }
+        NODEPTR_CHILD_SET_LEAF2(parent, find_state->parents_child, i - 1);
+        if (j > 1) {
+            NODEPTR_CHILD_SET_REPEAT2(parent, 1 + find_state->parents_child,
+                                      i - 1);
+        }
+        return SKIPSET_OK;
+    }
 
-            /* if node has a single child, we need to replace the node
-             * with the child on the node's parent */
-            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+    /* we must add a new node and a new leaf to the tree.  The leaf
+     * holds the IP being inserted.  The node holds the CIDR block
+     * containing the leaf and our current node---that is, it becomes
+     * a new parent; we must also update the index on the current
+     * node's parent to point to the new parent. */
 
-        } else {
-            /* this node is on the bottom level of the tree. multiple
-             * child[] entries will become a single leaf */
-            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
-            child_idx = UINT32_MAX;
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                for (j = 0; j < children_per_leaf; ++j) {
-                    --i;
-                    if (node->child[i]) {
-                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            ipsetDestroySubtree(ipset, node->child[i], 1);
-                            node->child[i] = 0;
-                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            node->child[i] = 0;
-                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
-                            child_idx = i;
-                        } else {
-                            LEAFIDX_FREE(ipset, node->child[child_idx]);
-                            NODEPTR_CHILD_CLEAR_LEAF(node, child_idx);
-                            node->child[child_idx] = 0;
-                            child_idx = i;
-                        }
-                    }
-                }
+    /* create the two new entries */
+    if (ipsetNewEntries(ipset, 1, 1, &new_node_idx, new_leaf_idx)) {
+        return SKIPSET_ERR_ALLOC;
+    }
 
-                /* the if() is entered when 'i' is looking at the
-                 * start of a group of child[] entries and any of the
-                 * child[] entries for this group of entries was
-                 * occupied. */
-                if (child_idx != UINT32_MAX) {
-                    if (IPSET_NUM_CHILDREN == child_idx) {
-                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
-                            return SKIPSET_ERR_ALLOC;
-                        }
-                        node->child[i] = new_leaf_idx;
-                    } else if (child_idx != i) {
-                        node->child[i] = node->child[child_idx];
-                        node->child[child_idx] = 0;
-                    }
-                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                    leaf->ip = ((node->ip
-                                 | (i << (32 - NUM_BITS - node->prefix)))
-                                & ~(UINT32_MAX >> mask_prefix));
-                    leaf->prefix = 32;
-                    NODEPTR_CHILD_SET_LEAF(node, i);
-                    NODEPTR_CHILD_CLEAR_LEAF2(node, i+1,
-                                              i + children_per_leaf - 1);
-                    NODEPTR_CHILD_CLEAR_REPEAT2(node, i,
-                                                i + children_per_leaf - 1);
+    /* get a handle to the newly created node */
+    new_node = NODE_PTR_V6(ipset, new_node_idx);
 
-                    /* reset for next group */
-                    child_idx = UINT32_MAX;
-                }
+    bitpos = find_state->bitpos & ~(NUM_BITS - 1);
+
+    /* get a handle to the newly created leaf, copy the inserted IP
+     * there, and link it to the new_node */
+    leaf = LEAF_PTR_V6(ipset, new_leaf_idx[0]);
+    IPSET_IPV6_COPY(&leaf->ip, ipv6);
+    leaf->prefix = prefix;
+    which_child = WHICH_CHILD_V6(ipv6, bitpos);
+    if (NUM_BITS <= prefix - bitpos) {
+        /* adding a single child[] entry */
+        new_node->child[which_child] = new_leaf_idx[0];
+        NODEPTR_CHILD_SET_LEAF(new_node, which_child);
+
+    } else {
+        /* this leaf will cover several child[] values on the node. */
+        for (i = which_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - bitpos)));
+             ++i, ++j)
+        {
+            new_node->child[i] = new_leaf_idx[0];
+        }
+        NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
+        NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
+    }
+
+    /* the following code is slightly different depending on whether
+     * search stopped on a node or on a leaf */
+    if (find_state->node_is_leaf) {
+        /* get a handle to the current leaf that is being moved down
+         * the tree */
+        leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
+
+        /* copy the leaf's IP to the new parent, masking off the lower
+         * bits */
+        new_node->prefix = bitpos;
+        IPSET_IPV6_COPY_AND_MASK(&new_node->ip, &leaf->ip, bitpos);
+
+        /* put the leaf under new_node */
+        which_child = WHICH_CHILD_V6(&leaf->ip, new_node->prefix);
+        if (NUM_BITS <= leaf->prefix - new_node->prefix) {
+            /* leaf occupies a single child[] entry */
+            new_node->child[which_child] = find_state->node_idx;
+            NODEPTR_CHILD_SET_LEAF(new_node, which_child);
+
+        } else {
+            for (i = which_child, j = 0;
+                 j < (1u << (NUM_BITS - (leaf->prefix - new_node->prefix)));
+                 ++i, ++j)
+            {
+                new_node->child[i] = find_state->node_idx;
             }
+            NODEPTR_CHILD_SET_LEAF2(new_node, which_child, i - 1);
+            NODEPTR_CHILD_SET_REPEAT2(new_node, 1 + which_child, i - 1);
+        }
 
-            /* if node has a single child, we need to replace the node
-             * with the child on the node's parent */
-            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+        /* get a handle to the parent, and update the child pointer on
+         * the parent */
+        if (find_state->parent_idx == IPSET_NO_PARENT) {
+            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
+        } else {
+            parent = NODE_PTR_V6(ipset, find_state->parent_idx);
+            which_child = WHICH_CHILD_V6(&leaf->ip, parent->prefix);
+            assert(parent->child[which_child] == find_state->node_idx);
+            parent->child[which_child] = new_node_idx;
+            NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+        }
+
+    } else {
+        /* get a handle to the current node that is being moved down
+         * the tree */
+        ipset_node_v6_t *node = NODE_PTR_V6(ipset, find_state->node_idx);
+
+        /* copy the current node's IP to the new parent, masking off
+         * the lower bits */
+        new_node->prefix = bitpos;
+        IPSET_IPV6_COPY_AND_MASK(&new_node->ip, &node->ip, bitpos);
+
+        /* put the current node under new_node */
+        which_child = WHICH_CHILD_V6(&node->ip, new_node->prefix);
+        new_node->child[which_child] = find_state->node_idx;
+
+        /* get a handle to the parent, and update the child pointer on
+         * the parent */
+        if (find_state->parent_idx == IPSET_NO_PARENT) {
+            IPSET_ROOT_INDEX_SET(ipset, new_node_idx, 0);
+        } else {
+            parent = NODE_PTR_V6(ipset, find_state->parent_idx);
+            which_child = WHICH_CHILD_V6(&node->ip, parent->prefix);
+            assert(parent->child[which_child] == find_state->node_idx);
+            parent->child[which_child] = new_node_idx;
         }
     }
 
     return SKIPSET_OK;
 }
+#endif  /* SK_ENABLE_IPV6 */
 
-#if SK_ENABLE_IPV6
+
+/*
+ *  status = ipsetInsertRangeIPTree(ipset, ipaddr_start, ipaddr_end);
+ *
+ *    Insert all IPv4 addresses from ipaddr_start to ipaddr_end
+ *    inclusive into the IPset 'ipset'.
+ */
 static int
-ipsetMaskV6(
+ipsetInsertRangeIPTree(
     skipset_t          *ipset,
-    const uint32_t      mask_prefix)
+    const skipaddr_t   *ipaddr_start,
+    const skipaddr_t   *ipaddr_end)
 {
-    ipset_node_v6_t *node;
-    ipset_leaf_v6_t *leaf;
-    uint32_t child_idx;
-    uint32_t node_idx;
-    uint32_t new_leaf_idx;
-    uint32_t children_per_leaf;
-    ipset_ipv6_t ipv6;
-    uint32_t i;
-    uint32_t j;
-    uint32_t depth;
-    uint32_t to_visit[IPSET_MAX_DEPTH_V6];
+    skipaddr_t ipaddr4_start;
+    skipaddr_t ipaddr4_end;
+    skipaddr_t ipaddr4_next;
+    uint32_t prefix;
     int rv = SKIPSET_OK;
 
-    ipset->is_dirty = 1;
+    assert(ipset);
+    assert(1 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
 
-    /* handle case where root is a leaf */
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        leaf = LEAF_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
-        if (leaf->prefix >= mask_prefix) {
-            /* leaf spans fewer IPs than specified by 'mask_prefix'.
-             * Modify the leaf's IP and prefix and return */
-            IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
-            leaf->prefix = 128;
-            return SKIPSET_OK;
+    /* must be a valid range of IPv4 addresses containing two or more
+     * IP addresses */
+    assert(skipaddrCompare(ipaddr_start, ipaddr_end) < 0);
+    assert(!skipaddrIsV6(ipaddr_start) && !skipaddrIsV6(ipaddr_end));
+
+#if  SK_ENABLE_IPV6
+    if (skipaddrIsV6(ipaddr_start)) {
+        if (skipaddrV6toV4(ipaddr_start, &ipaddr4_start)) {
+            return SKIPSET_ERR_IPV6;
         }
-        /* else, this leaf's prefix is more course (holds more IPs)
-         * than what we want; we must split the leaf into multiple
-         * nodes and leaves */
-        return ipsetMaskAddLeavesV6(ipset, mask_prefix, leaf);
+    } else
+#endif  /* SK_ENABLE_IPV6 */
+    {
+        skipaddrCopy(&ipaddr4_start, ipaddr_start);
     }
 
-    /* handle case where root contains a node whose prefix is
-     * more-precise than the 'mask_prefix' */
-    node = NODE_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
-    if (node->prefix >= mask_prefix) {
-        IPSET_IPV6_COPY(&ipv6, &node->ip);
-        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
-        leaf = LEAF_PTR_V6(ipset, new_leaf_idx);
-        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
-        leaf->prefix = 128;
-        return SKIPSET_OK;
+#if  SK_ENABLE_IPV6
+    if (skipaddrIsV6(ipaddr_end)) {
+        if (skipaddrV6toV4(ipaddr_end, &ipaddr4_end)) {
+            return SKIPSET_ERR_IPV6;
+        }
+    } else
+#endif  /* SK_ENABLE_IPV6 */
+    {
+        skipaddrCopy(&ipaddr4_end, ipaddr_end);
     }
 
-    /* visit the nodes in the tree */
-    depth = 0;
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+    ipset->is_dirty = 1;
 
-    while (depth) {
-        node_idx = to_visit[--depth];
-        node = NODE_PTR_V6(ipset, node_idx);
+    do {
+        prefix = skCIDRComputePrefix(&ipaddr4_start, &ipaddr4_end,
+                                     &ipaddr4_next);
+        rv = ipsetInsertAddressIPTree(ipset, skipaddrGetV4(&ipaddr4_start),
+                                      prefix);
+        skipaddrCopy(&ipaddr4_start, &ipaddr4_next);
+    } while (SKIPSET_OK == rv && !skipaddrIsZero(&ipaddr4_start));
 
-        if (mask_prefix - node->prefix > NUM_BITS) {
-            /* this node is not at the bottom level of the tree; add
-             * child nodes of this node to the 'to_visit' list. modify
-             * any leaves to hold a single IP. */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if ((0 == node->child[i])
-                    || NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    /* no-op */
-                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                    /* node; add to vist list unless its prefix is
-                     * larger than the mask, in which case replace
-                     * with a leaf */
-                    if (NODE_PTR_V6(ipset, node->child[i])->prefix
-                        <= mask_prefix)
-                    {
-                        to_visit[depth++] = node->child[i];
-                    } else {
-                        IPSET_IPV6_COPY(&ipv6,
-                                        &NODE_PTR_V6(ipset,node->child[i])->ip);
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
-                        leaf->prefix = 128;
-                    }
-                } else {
-                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                    if (leaf->prefix >= mask_prefix) {
-                        IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
-                        leaf->prefix = 128;
-                    } else {
-                        /* this leaf's prefix is more course (holds
-                         * more IPs) than what we want; similar to
-                         * code above that handle leaf at the root */
+    return rv;
+}
 
-                        if (NUM_BITS > leaf->prefix - node->prefix) {
-                            /* leaf occupies multiple child[] entries;
-                             * clear all but the current one */
-                            for (j = 1;
-                                 ((j < (1u << (NUM_BITS -
-                                               (leaf->prefix - node->prefix))))
-                                  && ((i + j) < IPSET_NUM_CHILDREN));
-                                 ++j)
-                            {
-                                node->child[i+j] = 0;
-                            }
-                            NODEPTR_CHILD_CLEAR_LEAF2(node, i + 1, i + j - 1);
-                            NODEPTR_CHILD_CLEAR_REPEAT2(node, i + 1, i + j - 1);
-                        }
-                        rv = ipsetMaskAddLeavesV6(ipset, mask_prefix, leaf);
-                        if (rv) { return rv; }
-                        node = NODE_PTR_V6(ipset, node_idx);
-                    }
-                }
-            }
 
-        } else if (mask_prefix - node->prefix == NUM_BITS) {
-            /* this node is on the bottom level of the tree, and every
-             * occupied child[] will become an independent leaf */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]) {
-                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                    } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
-                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
-                            return SKIPSET_ERR_ALLOC;
-                        }
-                        node->child[i] = new_leaf_idx;
-                        NODEPTR_CHILD_CLEAR_REPEAT(node, i);
-                    }
-                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                    leaf->prefix = 128;
-                    if (node->prefix <= 64 - NUM_BITS) {
-                        leaf->ip.ip[0] = ((node->ip.ip[0]
-                                           | (((uint64_t)i)
-                                              << (64-NUM_BITS- node->prefix)))
-                                          & ((mask_prefix < 64)
-                                             ? ~(UINT64_MAX >> mask_prefix)
-                                             : UINT64_MAX));
-                        leaf->ip.ip[1] = 0;
-                    } else {
-                        leaf->ip.ip[0] = node->ip.ip[0];
-                        leaf->ip.ip[1] = ((node->ip.ip[1]
-                                           | (((uint64_t)i)
-                                              << (128-NUM_BITS- node->prefix)))
-                                          & ~(UINT64_MAX >> (mask_prefix-64)));
-                    }
-                }
-            }
+/*
+ *  status = ipsetInsertRangeV4(ipset, v4_start, num_ips);
+ *
+ *    Insert a CIDR block of size 'num_ips' that starts at 'v4_start'.
+ *    'num_ips' must be an even multiple of 256 (a /24) and 'v4_start'
+ *    must be the start of the /24.  'v4_start' is in native byte
+ *    order.
+ */
+static int
+ipsetInsertRangeV4(
+    skipset_t          *ipset,
+    uint32_t            v4_start,
+    uint32_t            num_ips)
+{
+    static const uint32_t bitmask[] = {
+        /*  0- 3 */ 0xffffffff, 0x7fffffff, 0x3fffffff, 0x1fffffff,
+        /*  4- 7 */  0xfffffff,  0x7ffffff,  0x3ffffff,  0x1ffffff,
+        /*  8-11 */   0xffffff,   0x7fffff,   0x3fffff,   0x1fffff,
+        /* 12-15 */    0xfffff,    0x7ffff,    0x3ffff,    0x1ffff,
+        /* 16-19 */     0xffff,     0x7fff,     0x3fff,     0x1fff,
+        /* 20-23 */      0xfff,      0x7ff,      0x3ff,      0x1ff,
+        /* 24-27 */       0xff,       0x7f,       0x3f,       0x1f,
+        /* 28-31 */        0xf,        0x7,        0x3,        0x1,
+        /* 32    */        0x0
+    };
 
-            /* if node has a single child, we need to replace the node
-             * with the child on the node's parent */
-            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+    uint32_t range_start;
+    int prefix;
+    int rv;
 
-        } else {
-            /* this node is on the bottom level of the tree. multiple
-             * child[] entries will become a single leaf */
-            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
-            child_idx = UINT32_MAX;
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                for (j = 0; j < children_per_leaf; ++j) {
-                    --i;
-                    if (node->child[i]) {
-                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            ipsetDestroySubtree(ipset, node->child[i], 1);
-                            node->child[i] = 0;
-                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            node->child[i] = 0;
-                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
-                            child_idx = i;
-                        } else {
-                            LEAFIDX_FREE(ipset, node->child[child_idx]);
-                            NODEPTR_CHILD_CLEAR_LEAF(node, child_idx);
-                            node->child[child_idx] = 0;
-                            child_idx = i;
-                        }
-                    }
-                }
+    assert(0 == (v4_start & 0xFF));
+    assert(0 == (num_ips & 0xFF));
+    assert(num_ips > 0);
 
-                /* the if() is entered when 'i' is looking at the
-                 * start of a group of child[] entries and any of the
-                 * child[] entries for this group of entries was
-                 * occupied. */
-                if (child_idx != UINT32_MAX) {
-                    if (IPSET_NUM_CHILDREN == child_idx) {
-                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
-                            return SKIPSET_ERR_ALLOC;
-                        }
-                        node->child[i] = new_leaf_idx;
-                    } else if (child_idx != i) {
-                        node->child[i] = node->child[child_idx];
-                        node->child[child_idx] = 0;
-                    }
-                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                    leaf->prefix = 128;
-                    if (node->prefix <= 64 - NUM_BITS) {
-                        leaf->ip.ip[0] = ((node->ip.ip[0]
-                                           | (((uint64_t)i)
-                                              << (64-NUM_BITS- node->prefix)))
-                                          & ((mask_prefix < 64)
-                                             ? ~(UINT64_MAX >> mask_prefix)
-                                             : UINT64_MAX));
-                        leaf->ip.ip[1] = 0;
-                    } else {
-                        leaf->ip.ip[0] = node->ip.ip[0];
-                        leaf->ip.ip[1] = ((node->ip.ip[1]
-                                           | (((uint64_t)i)
-                                              << (128-NUM_BITS- node->prefix)))
-                                          & ~(UINT64_MAX >> (mask_prefix-64)));
-                    }
-                    NODEPTR_CHILD_SET_LEAF(node, i);
-                    NODEPTR_CHILD_CLEAR_LEAF2(node, i+1,
-                                              i + children_per_leaf - 1);
-                    NODEPTR_CHILD_CLEAR_REPEAT2(node, i,
-                                                i + children_per_leaf - 1);
+    do {
+        /* compute the log-base-2 (position of most significant bit)
+         * of the number of IPs in the range, and subtract that from
+         * 32 to get the widest possible CIDR block */
+        prefix = 32 - skIntegerLog2(num_ips);
 
-                    child_idx = UINT32_MAX;
-                }
-            }
+        /* tighten the range if we need to, in case the IPs don't fall
+         * into a single CIDR block (e.g., 10.0.6.0--10.0.9.0) */
+        while ((range_start = (v4_start & ~(bitmask[prefix]))) < v4_start) {
+            ++prefix;
+        }
 
-            /* if node has a single child, we need to replace the node
-             * with the child on the node's parent */
-            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+        /* assert that the CIDR block is within the limits */
+        assert(range_start == v4_start);
+        assert((range_start | (bitmask[prefix])) <= (num_ips - 1 + v4_start));
+
+        /* insert the CIDR block */
+        rv = ipsetInsertAddressV4(ipset, v4_start, prefix, NULL);
+        if (rv) {
+            break;
         }
-    }
 
-    return SKIPSET_OK;
+        /* compute the start of the next CIDR block and the number of
+         * IPs yet to process */
+        v4_start += (1u << (32 - prefix));
+        num_ips -= (1u << (32 - prefix));
+
+    } while (num_ips);
+
+    return rv;
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetMaskAndFillIPTree(ipset, mask_prefix)
+ *  status = ipsetIntersectCallback(ipaddr, prefix, state);
  *
- *    Helper function for skIPSetMaskAndFill().
+ *    Callback function used by skIPSetIntersect().
  *
- *    For each block of size 'mask_prefix', if any IPs in that block
- *    are set, fill the entire block.
+ *    This function will return SKIPSET_OK to continue walking over
+ *    the IPs, SKIPSET_ERR_ALLOC for an allocation error, or
+ *    SKIPSET_ERR_SUBSET when the iterator runs out of IPs to
+ *    visit---which will stop the skIPSetWalk().
  */
 static int
-ipsetMaskAndFillIPTree(
-    skipset_t          *ipset,
-    const uint32_t      mask_prefix)
+ipsetIntersectCallback(
+    skipaddr_t         *start_addr,
+    uint32_t            prefix,
+    void               *v_state)
 {
-    uint32_t all_ones;
-    int step;
-    int i, j, k;
+    ipset_intersect_t *state = (ipset_intersect_t*)v_state;
+    skipaddr_t walk_addr[2];
+    int walk_next = 0;
 
-    assert(ipset);
-    assert(1 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
-    assert(mask_prefix < 32 && mask_prefix > 0);
+    /* get the start and end IPs for the CIDR block */
+    skCIDR2IPRange(start_addr, prefix, &walk_addr[0], &walk_addr[1]);
 
-    ipset->is_dirty = 1;
+    for (;;) {
+        /* test (iter.final <= walk.final) */
+        if (skipaddrCompare(&state->addr[1], &walk_addr[1]) <= 0) {
 
-    if (mask_prefix <= 16) {
-        step = 1 << (16 - mask_prefix);
-        for (i = 0; i < SKIP_BBLOCK_COUNT; i += step) {
-            for (k = (i + step - 1); k >= i; --k) {
-                if (ipset->s.v2->nodes[k] != NULL) {
-                    break;
-                }
-            }
-            if (k < i) {
-                continue;
-            }
-            for (k = (i + step - 1); k >= i; --k) {
-                IPTREE_NODE_ALLOC(ipset, k);
-                memset(ipset->s.v2->nodes[k]->addressBlock, 0xff,
-                       sizeof(ipset->s.v2->nodes[k]->addressBlock));
+            /* test (iter.begin >= walk.begin) */
+            if (skipaddrCompare(&state->addr[0], &walk_addr[0]) >= 0) {
+                /* The iter block is completely contained in---or
+                 * identical to---the walk block.  Add the iter
+                 * block to the vector.
+                 *
+                 * iter block:             |---------|
+                 * walk block: |---------------------------------|
+                 */
+                if (skVectorAppendValue(state->vec_add, state->addr)) {
+                    return SKIPSET_ERR_ALLOC;
+                }
+
+                /* test (iter.final >= walk.begin) */
+            } else if (skipaddrCompare(&state->addr[1], &walk_addr[0]) >= 0) {
+                /* Add the IPs between walk.begin and iter.final.
+                 *
+                 * iter block:             |---------|
+                 * walk block:                 |---------|
+                 */
+                skipaddrCopy(&state->addr[0], &walk_addr[0]);
+                if (skVectorAppendValue(state->vec_add, state->addr)) {
+                    return SKIPSET_ERR_ALLOC;
+                }
             }
-        }
-        return SKIPSET_OK;
-    }
 
-    if (mask_prefix <= 27) {
-        step = 1 << (27 - mask_prefix);
-        for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
-            if (ipset->s.v2->nodes[i] == NULL) {
-                continue;
+            /* Else, the iter block is completely below the current walk
+             * block; and there is nothing to do.
+             *
+             * iter block:             |---------|
+             * walk block:                         |---------|
+             */
+
+            /* If the end IPs are identical, refresh both blocks; else
+             * go to next iter block */
+            if (skipaddrCompare(&state->addr[1], &walk_addr[1]) == 0) {
+                walk_next = 1;
             }
-            for (j = 0; j < SKIP_BBLOCK_SIZE; j += step) {
-                for (k = (j + step - 1); k >= j; --k) {
-                    if (ipset->s.v2->nodes[i]->addressBlock[k]) {
-                        break;
-                    }
-                }
-                if (k < j) {
-                    continue;
-                }
-                for (k = (j + step - 1); k >= j; --k) {
-                    ipset->s.v2->nodes[i]->addressBlock[k] = UINT32_MAX;
-                }
+
+            if (skIPSetIteratorNext(&state->iter, &state->addr[0], &prefix)) {
+                /* return some value so we stop walking over the IPs */
+                return SKIPSET_ERR_SUBSET;
+            }
+            skCIDR2IPRange(&state->addr[0], prefix,
+                           &state->addr[0], &state->addr[1]);
+            if (walk_next) {
+                break;
             }
-        }
-        return SKIPSET_OK;
-    }
 
-    /* operate on each integer */
-    step = 1 << (32 - mask_prefix);
-    all_ones = UINT32_MAX >> (32 - step);
-    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
-        if (ipset->s.v2->nodes[i] == NULL) {
-            continue;
-        }
-        for (j = 0; j < SKIP_BBLOCK_SIZE; ++j) {
-            for (k = 0; k < 32; k += step) {
-                if (GET_MASKED_BITS(ipset->s.v2->nodes[i]->addressBlock[j],
-                                    k, step))
-                {
-                    SET_MASKED_BITS(ipset->s.v2->nodes[i]->addressBlock[j],
-                                    all_ones, k, step);
+        } else {
+
+            /* test (iter.begin <= walk.begin) */
+            if (skipaddrCompare(&state->addr[0], &walk_addr[0]) <= 0) {
+                /* The walk is completely contained in the iter block.
+                 * Add the walk block to the vector.
+                 *
+                 * iter block:             |---------|
+                 * walk block:               |-----|
+                 */
+                if (skVectorAppendValue(state->vec_add, walk_addr)) {
+                    return SKIPSET_ERR_ALLOC;
+                }
+
+                /* test (iter.begin <= walk.final) */
+            } else if (skipaddrCompare(&state->addr[0], &walk_addr[1]) <= 0) {
+                /* Add the IPs between iter.begin and walk.final.
+                 *
+                 * iter block:             |---------|
+                 * walk block:         |---------|
+                 */
+                skipaddrCopy(&walk_addr[0], &state->addr[0]);
+                if (skVectorAppendValue(state->vec_add, walk_addr)) {
+                    return SKIPSET_ERR_ALLOC;
                 }
             }
+
+            /* Else, the iter block is completely above the walk block,
+             * and there is nothing to do.
+             *
+             * iter block:             |---------|
+             * walk block: |---------|
+             */
+
+            /* Go to next walk block */
+            break;
         }
     }
-
     return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetMaskAndFillV4(ipset, mask_prefix)
- *  status = ipsetMaskAndFillV6(ipset, mask_prefix)
+ *  ipsetIteratorNextContainer(iter, ipaddr, prefix);
  *
- *    Helper function for skIPSetMaskAndFill().
+ *    Helper function for skIPSetIteratorNext() when the IPset uses
+ *    /16 containers.
  *
- *    For each block of size 'mask_prefix', if any IPs in that block
- *    are set, fill the entire block.
+ *    The iterator's 'cur' member holds the /16 being visited and
+ *    'data[0]' the position within it.  When 'data[1]' is non-zero,
+ *    'data[2]' and 'data[3]' hold the next IP to return and the last
+ *    IP of the current range.
  */
 static int
-ipsetMaskAndFillV4(
-    skipset_t          *ipset,
-    const uint32_t      mask_prefix)
+ipsetIteratorNextContainer(
+    skipset_iterator_t *iter,
+    skipaddr_t         *ipaddr,
+    uint32_t           *prefix)
 {
-    ipset_node_v4_t *node;
-    ipset_leaf_v4_t *leaf;
-    uint32_t child_idx;
-    uint32_t node_idx;
-    uint32_t new_leaf_idx;
-    uint32_t children_per_leaf;
+    uint32_t pos;
+    uint32_t first;
+    uint32_t last;
     uint32_t ipv4;
-    uint32_t i;
-    uint32_t j;
-    uint32_t depth;
-    uint32_t to_visit[IPSET_MAX_DEPTH_V4];
+    uint32_t fin4;
 
-    ipset->is_dirty = 1;
+    if (!iter->iter.v3.data[1]) {
+        pos = (uint32_t)iter->iter.v3.data[0];
+        if (!ipsetContainerNextRange(iter->ipset->s.cont, &iter->iter.v3.cur,
+                                     &pos, &first, &last))
+        {
+            iter->iter.v3.cur = SKIP_BBLOCK_COUNT;
+            return SK_ITERATOR_NO_MORE_ENTRIES;
+        }
+        iter->iter.v3.data[0] = pos;
+        iter->iter.v3.data[1] = 1;
+        iter->iter.v3.data[2] = first;
+        iter->iter.v3.data[3] = last;
+    }
 
-    /* handle case where root is a leaf */
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        leaf = LEAF_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
-        if (leaf->prefix > mask_prefix) {
-            /* leaf spans fewer IPs than specified by 'mask_prefix'.
-             * Modify the leaf's IP and prefix and return */
-            leaf->ip &= ~(UINT32_MAX >> mask_prefix);
-            leaf->prefix = mask_prefix;
-            return SKIPSET_OK;
+    ipv4 = (uint32_t)iter->iter.v3.data[2];
+    fin4 = (uint32_t)iter->iter.v3.data[3];
+    if (iter->cidr_blocks) {
+        *prefix = ipsetContainerCidrPrefix(ipv4, fin4);
+        if (*prefix < 32) {
+            fin4 = ipv4 | (UINT32_MAX >> *prefix);
+        } else {
+            fin4 = ipv4;
         }
-        /* else, this leaf's prefix is more course (holds more IPs)
-         * than the mask_prefix, and there is no need to change it. */
-        return SKIPSET_OK;
+    } else {
+        *prefix = 32;
+        fin4 = ipv4;
+    }
+    if (fin4 == (uint32_t)iter->iter.v3.data[3]) {
+        iter->iter.v3.data[1] = 0;
+    } else {
+        iter->iter.v3.data[2] = fin4 + 1;
     }
 
-    /* handle case where root contains a node whose prefix is
-     * more-precise than the 'mask_prefix' */
-    node = NODE_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
-    if (node->prefix >= mask_prefix) {
-        ipv4 = node->ip;
-        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
-        leaf = LEAF_PTR_V4(ipset, new_leaf_idx);
-        leaf->ip = ipv4 &  ~(UINT32_MAX >> mask_prefix);
-        leaf->prefix = mask_prefix;
-        return SKIPSET_OK;
+#if SK_ENABLE_IPV6
+    if (SK_IPV6POLICY_FORCE == iter->v6policy) {
+        skipaddrSetV6FromUint32(ipaddr, &ipv4);
+        *prefix += 96;
+        return SK_ITERATOR_OK;
     }
+#endif  /* SK_ENABLE_IPV6 */
+    skipaddrSetV4(ipaddr, &ipv4);
+    return SK_ITERATOR_OK;
+}
 
-    /* visit the nodes in the tree */
-    depth = 0;
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
 
-    while (depth) {
-        node_idx = to_visit[--depth];
-        node = NODE_PTR_V4(ipset, node_idx);
+/*
+ *  ipsetIteratorNextIPTree(iter, ipaddr, prefix);
+ *
+ *    Helper function for skIPSetIteratorNext() when the IPset is a
+ *    SiLK-2 style IPTree.
+ */
+static int
+ipsetIteratorNextIPTree(
+    skipset_iterator_t *iter,
+    skipaddr_t         *ipaddr,
+    uint32_t           *prefix)
+{
+    skIPTreeCIDRBlock_t cidr;
+    int rv = SK_ITERATOR_NO_MORE_ENTRIES;
 
-        if (mask_prefix - node->prefix > NUM_BITS) {
-            /* this node is not at the bottom level of the tree; add
-             * child nodes of this node to the 'to_visit' list. modify
-             * any leaves to hold a single block */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if ((0 == node->child[i])
-                    || NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    /* no-op */
-                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                    /* node; add to vist list unless its prefix is
-                     * larger than or equal to the mask, in which case
-                     * replace with a leaf */
-                    if (NODE_PTR_V4(ipset, node->child[i])->prefix
-                        < mask_prefix)
-                    {
-                        to_visit[depth++] = node->child[i];
-                    } else {
-                        ipv4 = NODE_PTR_V4(ipset,node->child[i])->ip;
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                        leaf->ip = ipv4 & ~(UINT32_MAX >> mask_prefix);
-                        leaf->prefix = mask_prefix;
-                    }
-                } else {
-                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                    if (leaf->prefix > mask_prefix) {
-                        leaf->ip &= ~(UINT32_MAX >> mask_prefix);
-                        leaf->prefix = mask_prefix;
-                    }
-                }
+    switch (iter->v6policy) {
+      case SK_IPV6POLICY_ONLY:
+        /* since we do not support IPv6 addresses in the IPTree data
+         * structure, there is nothing to return */
+        break;
+
+      case SK_IPV6POLICY_FORCE:
+#if !SK_ENABLE_IPV6
+        break;
+#else
+        if (iter->cidr_blocks) {
+            rv = skIPTreeCIDRBlockIteratorNext(&cidr, &iter->iter.v2cidr);
+            if (SK_ITERATOR_OK == rv) {
+                skipaddrSetV6FromUint32(ipaddr, &cidr.addr);
+                *prefix = 96 + cidr.mask;
+            }
+        } else {
+            rv = skIPTreeIteratorNext(&cidr.addr, &iter->iter.v2ip);
+            if (SK_ITERATOR_OK == rv) {
+                skipaddrSetV6FromUint32(ipaddr, &cidr.addr);
+                *prefix = 128;
             }
+        }
+        break;
+#endif  /* #else of #if !SK_ENABLE_IPV6 */
 
-        } else if (mask_prefix - node->prefix == NUM_BITS) {
-            /* this node is on the bottom level of the tree, and every
-             * occupied child[] will become an independent leaf */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]
-                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                    } else {
-                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                        if (leaf->prefix <= mask_prefix) {
-                            continue;
-                        }
-                    }
-                    leaf->ip = ((node->ip
-                                 | (i << (32 - NUM_BITS - node->prefix)))
-                                & ~(UINT32_MAX >> mask_prefix));
-                    leaf->prefix = mask_prefix;
-                }
+      case SK_IPV6POLICY_MIX:
+      case SK_IPV6POLICY_ASV4:
+      case SK_IPV6POLICY_IGNORE:
+        if (iter->cidr_blocks) {
+            rv = skIPTreeCIDRBlockIteratorNext(&cidr, &iter->iter.v2cidr);
+            if (SK_ITERATOR_OK == rv) {
+                skipaddrSetV4(ipaddr, &cidr.addr);
+                *prefix = cidr.mask;
             }
-
         } else {
-            /* this node is on the bottom level of the tree. multiple
-             * child[] entries will become a single leaf */
-            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
-            child_idx = UINT32_MAX;
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                for (j = 0; j < children_per_leaf; ++j) {
-                    --i;
-                    if (node->child[i]) {
-                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            ipsetDestroySubtree(ipset, node->child[i], 1);
-                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
-                            leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                            if (leaf->prefix <= mask_prefix) {
-                                assert(0 == j);
-                                i -= children_per_leaf - 1;
-                                break;
-                            }
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            node->child[i] = 0;
-                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
-                            child_idx = i;
-                        } else {
-                            LEAFIDX_FREE(ipset, node->child[child_idx]);
-                            node->child[child_idx] = 0;
-                            child_idx = i;
-                        }
-                    }
-                }
-
-                /* the if() is entered when 'i' is looking at the
-                 * start of a group of child[] entries and any of the
-                 * child[] entries for this group of entries was
-                 * occupied. */
-                if (child_idx != UINT32_MAX) {
-                    if (IPSET_NUM_CHILDREN == child_idx) {
-                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
-                            return SKIPSET_ERR_ALLOC;
-                        }
-                        node->child[i] = new_leaf_idx;
-                    } else if (child_idx != i) {
-                        node->child[i] = node->child[child_idx];
-                    }
-                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
-                    leaf->ip = ((node->ip
-                                 | (i << (32 - NUM_BITS - node->prefix)))
-                                & ~(UINT32_MAX >> mask_prefix));
-                    leaf->prefix = mask_prefix;
-                    NODEPTR_CHILD_SET_LEAF2(node, i,
-                                            i + children_per_leaf - 1);
-                    NODEPTR_CHILD_SET_REPEAT2(node, i+1,
-                                              i + children_per_leaf - 1);
-                    for (j = 1; j < children_per_leaf; ++j) {
-                        node->child[i + j] = node->child[i];
-                    }
-                    /* reset for next group */
-                    child_idx = UINT32_MAX;
-                }
+            rv = skIPTreeIteratorNext(&cidr.addr, &iter->iter.v2ip);
+            if (SK_ITERATOR_OK == rv) {
+                skipaddrSetV4(ipaddr, &cidr.addr);
+                *prefix = 32;
             }
         }
+        break;
     }
+    return rv;
+}
 
-    return SKIPSET_OK;
+
+/*
+ *  ipsetIteratorNextRangeV4(iter);
+ *  ipsetIteratorNextRangeV6(iter);
+ *
+ *    Helper functions for skIPSetIteratorNext().
+ *
+ *    Update the IPset iterator 'iter' to contain the starting and
+ *    stopping IPs values for the CIDR block on the current leaf.
+ *    Assumes the 'cur' field on the iterator is pointing at a valid
+ *    leaf.
+ */
+static void
+ipsetIteratorNextRangeV4(
+    skipset_iterator_t *iter)
+{
+    ipset_leaf_v4_t *leaf = LEAF_PTR_V4(iter->ipset, iter->iter.v3.cur);
+
+    if (32 == leaf->prefix) {
+        iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip;
+    } else {
+        iter->iter.v3.data[0] = leaf->ip;
+        iter->iter.v3.data[2] = (leaf->ip | (UINT32_MAX >> leaf->prefix));
+    }
 }
 
 #if SK_ENABLE_IPV6
-static int
-ipsetMaskAndFillV6(
-    skipset_t          *ipset,
-    const uint32_t      mask_prefix)
+static void
+ipsetIteratorNextRangeV6(
+    skipset_iterator_t *iter)
 {
-    ipset_node_v6_t *node;
-    ipset_leaf_v6_t *leaf;
-    uint32_t child_idx;
-    uint32_t node_idx;
-    uint32_t new_leaf_idx;
-    uint32_t children_per_leaf;
-    ipset_ipv6_t ipv6;
-    uint32_t i;
-    uint32_t j;
-    uint32_t depth;
-    uint32_t to_visit[IPSET_MAX_DEPTH_V6];
+    ipset_leaf_v6_t *leaf = LEAF_PTR_V6(iter->ipset, iter->iter.v3.cur);
 
-    ipset->is_dirty = 1;
+    if (SK_IPV6POLICY_ASV4 == iter->v6policy) {
+        /* check stopping condition */
+        if (leaf->ip.ip[0] != 0
+            || ((UINT64_C(0xffffffff00000000) & leaf->ip.ip[1])
+                != UINT64_C(0x0000ffff00000000)))
+        {
+            iter->iter.v3.cur = iter->ipset->s.v3->leaves.entry_count;
+            return;
+        }
+    }
 
-    /* handle case where root is a leaf */
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        leaf = LEAF_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
-        if (leaf->prefix > mask_prefix) {
-            /* leaf spans fewer IPs than specified by 'mask_prefix'.
-             * Modify the leaf's IP and prefix and return */
-            IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
-            leaf->prefix = mask_prefix;
-            return SKIPSET_OK;
+    if (leaf->prefix > 64) {
+        if (leaf->prefix == 128) {
+            iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip.ip[0];
+            iter->iter.v3.data[1] = iter->iter.v3.data[3] = leaf->ip.ip[1];
+        } else {
+            iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip.ip[0];
+            iter->iter.v3.data[1] = leaf->ip.ip[1];
+            iter->iter.v3.data[3] = (leaf->ip.ip[1]
+                             | (UINT64_MAX >> (leaf->prefix - 64)));
         }
-        /* else, this leaf's prefix is more course (holds more IPs)
-         * than the mask_prefix, and there is no need to change it */
-        return SKIPSET_OK;
+    } else if (leaf->prefix == 64) {
+        iter->iter.v3.data[0] = iter->iter.v3.data[2] = leaf->ip.ip[0];
+        iter->iter.v3.data[1] = iter->iter.v3.data[3] = UINT64_MAX;
+    } else {
+        iter->iter.v3.data[0] = leaf->ip.ip[0];
+        iter->iter.v3.data[2] = (leaf->ip.ip[0]
+                         | (UINT64_MAX >> leaf->prefix));
+        iter->iter.v3.data[1] = iter->iter.v3.data[3] = UINT64_MAX;
     }
+}
+#endif  /* SK_ENABLE_IPV6 */
 
-    /* handle case where root contains a node whose prefix is
-     * more-precise than the 'mask_prefix' */
-    node = NODE_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
-    if (node->prefix >= mask_prefix) {
-        IPSET_IPV6_COPY(&ipv6, &node->ip);
-        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
-        leaf = LEAF_PTR_V6(ipset, new_leaf_idx);
-        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
-        leaf->prefix = mask_prefix;
-        return SKIPSET_OK;
+
+/*
+ *  cmp = ipsetLeafCompareV4(leaf_a, leaf_b);
+ *  cmp = ipsetLeafCompareV6(leaf_a, leaf_b);
+ *
+ *    Return -1, 0, 1 depending on whether the IP on leaf_a is less
+ *    than, equal to, or greater than the IP on leaf_b.
+ *
+ *    This function compares the first IP in each leaf; it does not
+ *    consider the case where one leaf contains a netblock that is a
+ *    subset of the netblock on another leaf.
+ */
+static int
+ipsetLeafCompareV4(
+    const void         *va,
+    const void         *vb)
+{
+    const uint32_t a = ((const ipset_leaf_v4_t *)va)->ip;
+    const uint32_t b = ((const ipset_leaf_v4_t *)vb)->ip;
+    if (a < b) {
+        return -1;
+    }
+    return (a > b);
+}
+
+#if SK_ENABLE_IPV6
+static int
+ipsetLeafCompareV6(
+    const void         *va,
+    const void         *vb)
+{
+    const ipset_ipv6_t *a = &((const ipset_leaf_v6_t *)va)->ip;
+    const ipset_ipv6_t *b = &((const ipset_leaf_v6_t *)vb)->ip;
+    if (a->ip[0] < b->ip[0]) {
+        return -1;
+    }
+    if (a->ip[0] > b->ip[0]) {
+        return 1;
+    }
+    if (a->ip[1] < b->ip[1]) {
+        return -1;
     }
+    return (a->ip[1] > b->ip[1]);
+}
+#endif  /* SK_ENABLE_IPV6 */
+
+
+/*
+ *  status = ipsetMaskAddLeavesV4(ipset, mask_prefix, leaf);
+ *  status = ipsetMaskAddLeavesV6(ipset, mask_prefix, leaf);
+ *
+ *    Helper function for ipsetMaskVx().
+ *
+ *    Given 'leaf' that contains a CIDR block, remove 'leaf' from the
+ *    'ipset' and add new leaves, where each new leaf is a single IP
+ *    address (a /32 or /128), and the step size between the IPs is
+ *    1<<(32-mask_prefix) or 1<<(128-mask_prefix).
+ *
+ *    Return SKIPSET_OK or SKIPSET_ERR_ALLOC.
+ */
+static int
+ipsetMaskAddLeavesV4(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix,
+    ipset_leaf_v4_t    *leaf)
+{
+    const uint32_t step = 1u << (32 - mask_prefix);
+    uint32_t ipv4;
+    uint32_t final;
+    int rv;
+
+    /* get the ip address */
+    ipv4 = leaf->ip;
+
+    /* compute the final ip address for our stopping condition */
+    final = ((ipv4 | (UINT32_MAX >> leaf->prefix))
+             & ~(UINT32_MAX >> mask_prefix));
+
+    /* set the prefix so this leaf is a single IP */
+    leaf->prefix = 32;
+
+    while (ipv4 < final) {
+        ipv4 += step;
+        rv = ipsetInsertAddressV4(ipset, ipv4, 32, NULL);
+        if (rv) {
+            return rv;
+        }
+    }
+    return SKIPSET_OK;
+}
+
+#if SK_ENABLE_IPV6
+static int
+ipsetMaskAddLeavesV6(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix,
+    ipset_leaf_v6_t    *leaf)
+{
+    ipset_ipv6_t ipv6;
+    ipset_ipv6_t final;
+    ipset_ipv6_t step;
+    int rv;
+
+    /* get the first address in this block */
+    ipv6.ip[0] = leaf->ip.ip[0];
+    ipv6.ip[1] = leaf->ip.ip[1];
+
+    /* code in the bodies of the following if/else differ by size of
+     * prefix */
+    if (mask_prefix <= 64) {
+        /* this affects only the most significant 64 bits */
+        assert(leaf->prefix < 64);
+
+        /* determine the final address in this block */
+        final.ip[0] = ((ipv6.ip[0] | (UINT64_MAX >> leaf->prefix))
+                       & ((mask_prefix < 64)
+                          ? ~(UINT64_MAX >> mask_prefix)
+                          : UINT64_MAX));
+
+        /* get the step size */
+        step.ip[0] = UINT64_C(1) << (64 - mask_prefix);
+
+        /* modify starting leaf to be a single IP */
+        leaf->prefix = 128;
+
+        while (ipv6.ip[0] < final.ip[0]) {
+            ipv6.ip[0] += step.ip[0];
+            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
+            if (rv) { return rv; }
+        }
+
+    } else if (leaf->prefix > 64) {
+        /* this affects only the least significant 64 bits */
+        assert(mask_prefix > 64);
+
+        /* determine the final address in this block */
+        final.ip[1] = ((ipv6.ip[1] | (UINT64_MAX >> (leaf->prefix - 64)))
+                       & ~(UINT64_MAX >> (mask_prefix - 64)));
+
+        /* get the step size */
+        step.ip[1] = UINT64_C(1) << (128 - mask_prefix);
+
+        /* modify starting leaf to be a single IP */
+        leaf->prefix = 128;
+
+        while (ipv6.ip[1] < final.ip[1]) {
+            ipv6.ip[1] += step.ip[1];
+            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
+            if (rv) { return rv; }
+        }
+
+    } else {
+        assert(mask_prefix > 64);
+        assert(leaf->prefix <= 64);
+
+        /* determine the final address in this block */
+        final.ip[0] = ipv6.ip[0] | ((leaf->prefix < 64)
+                                    ? (UINT64_MAX >> leaf->prefix)
+                                    : 0);
+        final.ip[1] = ~(UINT64_MAX >> (mask_prefix - 64));
+
+        /* get the step size */
+        step.ip[1] = UINT64_C(1) << (128 - mask_prefix);
+
+        /* modify starting leaf to be a single IP */
+        leaf->prefix = 128;
+
+        while (ipv6.ip[0] < final.ip[0]) {
+            if (ipv6.ip[1] <= UINT64_MAX - step.ip[1]) {
+                ipv6.ip[1] += step.ip[1];
+            } else {
+                /* handle rollover */
+                ++ipv6.ip[0];
+                ipv6.ip[1] -= (UINT64_MAX - step.ip[1]) + 1;
+            }
+            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
+            if (rv) { return rv; }
+        }
+        while (ipv6.ip[1] < final.ip[1]) {
+            ipv6.ip[1] += step.ip[1];
+            rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
+            if (rv) { return rv; }
+        }
+    }
+
+    return SKIPSET_OK;
+}
+#endif  /* SK_ENABLE_IPV6 */
+
+
+/*
+ *  status = ipsetMaskV4(ipset, mask_prefix)
+ *  status = ipsetMaskV6(ipset, mask_prefix)
+ *
+ *    Helper function for skIPSetMask().
+ *
+ *    For each block of size 'mask_prefix', if any IPs in that block
+ *    are set, remove all IPs in the block and replace with with a
+ *    single IP.
+ */
+static int
+ipsetMaskV4(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix)
+{
+    ipset_node_v4_t *node;
+    ipset_leaf_v4_t *leaf;
+    uint32_t child_idx;
+    uint32_t node_idx;
+    uint32_t new_leaf_idx;
+    uint32_t children_per_leaf;
+    uint32_t ipv4;
+    uint32_t i;
+    uint32_t j;
+    uint32_t depth;
+    uint32_t to_visit[IPSET_MAX_DEPTH_V4];
+    int rv = SKIPSET_OK;
+
+    ipset->is_dirty = 1;
+
+    /* handle case where root is a leaf */
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        leaf = LEAF_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
+        if (leaf->prefix >= mask_prefix) {
+            /* leaf spans fewer IPs than specified by 'mask_prefix'.
+             * Modify the leaf's IP and prefix and return */
+            leaf->ip &= ~(UINT32_MAX >> mask_prefix);
+            leaf->prefix = 32;
+            return SKIPSET_OK;
+        }
+        /* else, this leaf's prefix is more course (holds more IPs)
+         * than what we want; we must split the leaf into multiple
+         * nodes and leaves */
+        return ipsetMaskAddLeavesV4(ipset, mask_prefix, leaf);
+    }
+
+    /* handle case where root contains a node whose prefix is
+     * more-precise than the 'mask_prefix' */
+    node = NODE_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
+    if (node->prefix >= mask_prefix) {
+        ipv4 = node->ip;
+        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
+        leaf = LEAF_PTR_V4(ipset, new_leaf_idx);
+        leaf->ip = ipv4 &  ~(UINT32_MAX >> mask_prefix);
+        leaf->prefix = 32;
+        return SKIPSET_OK;
+    }
+
+    /* visit the nodes in the tree */
+    depth = 0;
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+
+    while (depth) {
+        node_idx = to_visit[--depth];
+        node = NODE_PTR_V4(ipset, node_idx);
+
+        if (mask_prefix - node->prefix > NUM_BITS) {
+            /* this node is not at the bottom level of the tree; add
+             * child nodes of this node to the 'to_visit' list. modify
+             * any leaves to hold a single IP */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if ((0 == node->child[i])
+                    || NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    /* no-op */
+                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                    /* node; add to vist list unless its prefix is
+                     * larger than the mask, in which case replace
+                     * with a leaf */
+                    if (NODE_PTR_V4(ipset, node->child[i])->prefix
+                        <= mask_prefix)
+                    {
+                        to_visit[depth++] = node->child[i];
+                    } else {
+                        ipv4 = NODE_PTR_V4(ipset,node->child[i])->ip;
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                        leaf->ip = ipv4 & ~(UINT32_MAX >> mask_prefix);
+                        leaf->prefix = 32;
+                    }
+                } else {
+                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                    if (leaf->prefix >= mask_prefix) {
+                        leaf->ip &= ~(UINT32_MAX >> mask_prefix);
+                        leaf->prefix = 32;
+                    } else {
+                        /* this leaf's prefix is more course (holds
+                         * more IPs) than what we want; similar to
+                         * code above that handle leaf at the root */
+
+                        if (NUM_BITS > leaf->prefix - node->prefix) {
+                            /* leaf occupies multiple child[] entries;
+                             * clear all but the current one */
+                            for (j = 1;
+                                 ((j < (1u << (NUM_BITS -
+                                               (leaf->prefix - node->prefix))))
+                                  && ((i + j) < IPSET_NUM_CHILDREN));
+                                 ++j)
+                            {
+                                node->child[i+j] = 0;
+                            }
+                            NODEPTR_CHILD_CLEAR_LEAF2(node, i + 1, i + j - 1);
+                            NODEPTR_CHILD_CLEAR_REPEAT2(node, i + 1, i + j - 1);
+                        }
+                        rv = ipsetMaskAddLeavesV4(ipset, mask_prefix, leaf);
+                        if (rv) { return rv; }
+                        node = NODE_PTR_V4(ipset, node_idx);
+                    }
+                }
+            }
+
+        } else if (mask_prefix - node->prefix == NUM_BITS) {
+            /* this node is on the bottom level of the tree, and every
+             * occupied child[] will become an independent leaf */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]) {
+                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                    } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
+                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
+                            return SKIPSET_ERR_ALLOC;
+                        }
+                        node->child[i] = new_leaf_idx;
+                        NODEPTR_CHILD_CLEAR_REPEAT(node, i);
+                    }
+                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                    leaf->ip = ((node->ip
+                                 | (i << (32 - NUM_BITS - node->prefix)))
+                                & ~(UINT32_MAX >> mask_prefix));
+                    leaf->prefix = 32;
+                }
+            }
+
+            /* if node has a single child, we need to replace the node
+             * with the child on the node's parent */
+            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+
+        } else {
+            /* this node is on the bottom level of the tree. multiple
+             * child[] entries will become a single leaf */
+            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
+            child_idx = UINT32_MAX;
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                for (j = 0; j < children_per_leaf; ++j) {
+                    --i;
+                    if (node->child[i]) {
+                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            ipsetDestroySubtree(ipset, node->child[i], 1);
+                            node->child[i] = 0;
+                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            node->child[i] = 0;
+                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
+                            child_idx = i;
+                        } else {
+                            LEAFIDX_FREE(ipset, node->child[child_idx]);
+                            NODEPTR_CHILD_CLEAR_LEAF(node, child_idx);
+                            node->child[child_idx] = 0;
+                            child_idx = i;
+                        }
+                    }
+                }
+
+                /* the if() is entered when 'i' is looking at the
+                 * start of a group of child[] entries and any of the
+                 * child[] entries for this group of entries was
+                 * occupied. */
+                if (child_idx != UINT32_MAX) {
+                    if (IPSET_NUM_CHILDREN == child_idx) {
+                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
+                            return SKIPSET_ERR_ALLOC;
+                        }
+                        node->child[i] = new_leaf_idx;
+                    } else if (child_idx != i) {
+                        node->child[i] = node->child[child_idx];
+                        node->child[child_idx] = 0;
+                    }
+                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                    leaf->ip = ((node->ip
+                                 | (i << (32 - NUM_BITS - node->prefix)))
+                                & ~(UINT32_MAX >> mask_prefix));
+                    leaf->prefix = 32;
+                    NODEPTR_CHILD_SET_LEAF(node, i);
+                    NODEPTR_CHILD_CLEAR_LEAF2(node, i+1,
+                                              i + children_per_leaf - 1);
+                    NODEPTR_CHILD_CLEAR_REPEAT2(node, i,
+                                                i + children_per_leaf - 1);
+
+                    /* reset for next group */
+                    child_idx = UINT32_MAX;
+                }
+            }
+
+            /* if node has a single child, we need to replace the node
+             * with the child on the node's parent */
+            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+        }
+    }
+
+    return SKIPSET_OK;
+}
+
+#if SK_ENABLE_IPV6
+static int
+ipsetMaskV6(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix)
+{
+    ipset_node_v6_t *node;
+    ipset_leaf_v6_t *leaf;
+    uint32_t child_idx;
+    uint32_t node_idx;
+    uint32_t new_leaf_idx;
+    uint32_t children_per_leaf;
+    ipset_ipv6_t ipv6;
+    uint32_t i;
+    uint32_t j;
+    uint32_t depth;
+    uint32_t to_visit[IPSET_MAX_DEPTH_V6];
+    int rv = SKIPSET_OK;
+
+    ipset->is_dirty = 1;
+
+    /* handle case where root is a leaf */
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        leaf = LEAF_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
+        if (leaf->prefix >= mask_prefix) {
+            /* leaf spans fewer IPs than specified by 'mask_prefix'.
+             * Modify the leaf's IP and prefix and return */
+            IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
+            leaf->prefix = 128;
+            return SKIPSET_OK;
+        }
+        /* else, this leaf's prefix is more course (holds more IPs)
+         * than what we want; we must split the leaf into multiple
+         * nodes and leaves */
+        return ipsetMaskAddLeavesV6(ipset, mask_prefix, leaf);
+    }
+
+    /* handle case where root contains a node whose prefix is
+     * more-precise than the 'mask_prefix' */
+    node = NODE_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
+    if (node->prefix >= mask_prefix) {
+        IPSET_IPV6_COPY(&ipv6, &node->ip);
+        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
+        leaf = LEAF_PTR_V6(ipset, new_leaf_idx);
+        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
+        leaf->prefix = 128;
+        return SKIPSET_OK;
+    }
+
+    /* visit the nodes in the tree */
+    depth = 0;
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+
+    while (depth) {
+        node_idx = to_visit[--depth];
+        node = NODE_PTR_V6(ipset, node_idx);
+
+        if (mask_prefix - node->prefix > NUM_BITS) {
+            /* this node is not at the bottom level of the tree; add
+             * child nodes of this node to the 'to_visit' list. modify
+             * any leaves to hold a single IP. */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if ((0 == node->child[i])
+                    || NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    /* no-op */
+                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                    /* node; add to vist list unless its prefix is
+                     * larger than the mask, in which case replace
+                     * with a leaf */
+                    if (NODE_PTR_V6(ipset, node->child[i])->prefix
+                        <= mask_prefix)
+                    {
+                        to_visit[depth++] = node->child[i];
+                    } else {
+                        IPSET_IPV6_COPY(&ipv6,
+                                        &NODE_PTR_V6(ipset,node->child[i])->ip);
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
+                        leaf->prefix = 128;
+                    }
+                } else {
+                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                    if (leaf->prefix >= mask_prefix) {
+                        IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
+                        leaf->prefix = 128;
+                    } else {
+                        /* this leaf's prefix is more course (holds
+                         * more IPs) than what we want; similar to
+                         * code above that handle leaf at the root */
+
+                        if (NUM_BITS > leaf->prefix - node->prefix) {
+                            /* leaf occupies multiple child[] entries;
+                             * clear all but the current one */
+                            for (j = 1;
+                                 ((j < (1u << (NUM_BITS -
+                                               (leaf->prefix - node->prefix))))
+                                  && ((i + j) < IPSET_NUM_CHILDREN));
+                                 ++j)
+                            {
+                                node->child[i+j] = 0;
+                            }
+                            NODEPTR_CHILD_CLEAR_LEAF2(node, i + 1, i + j - 1);
+                            NODEPTR_CHILD_CLEAR_REPEAT2(node, i + 1, i + j - 1);
+                        }
+                        rv = ipsetMaskAddLeavesV6(ipset, mask_prefix, leaf);
+                        if (rv) { return rv; }
+                        node = NODE_PTR_V6(ipset, node_idx);
+                    }
+                }
+            }
+
+        } else if (mask_prefix - node->prefix == NUM_BITS) {
+            /* this node is on the bottom level of the tree, and every
+             * occupied child[] will become an independent leaf */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]) {
+                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                    } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
+                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
+                            return SKIPSET_ERR_ALLOC;
+                        }
+                        node->child[i] = new_leaf_idx;
+                        NODEPTR_CHILD_CLEAR_REPEAT(node, i);
+                    }
+                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                    leaf->prefix = 128;
+                    if (node->prefix <= 64 - NUM_BITS) {
+                        leaf->ip.ip[0] = ((node->ip.ip[0]
+                                           | (((uint64_t)i)
+                                              << (64-NUM_BITS- node->prefix)))
+                                          & ((mask_prefix < 64)
+                                             ? ~(UINT64_MAX >> mask_prefix)
+                                             : UINT64_MAX));
+                        leaf->ip.ip[1] = 0;
+                    } else {
+                        leaf->ip.ip[0] = node->ip.ip[0];
+                        leaf->ip.ip[1] = ((node->ip.ip[1]
+                                           | (((uint64_t)i)
+                                              << (128-NUM_BITS- node->prefix)))
+                                          & ~(UINT64_MAX >> (mask_prefix-64)));
+                    }
+                }
+            }
+
+            /* if node has a single child, we need to replace the node
+             * with the child on the node's parent */
+            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+
+        } else {
+            /* this node is on the bottom level of the tree. multiple
+             * child[] entries will become a single leaf */
+            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
+            child_idx = UINT32_MAX;
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                for (j = 0; j < children_per_leaf; ++j) {
+                    --i;
+                    if (node->child[i]) {
+                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            ipsetDestroySubtree(ipset, node->child[i], 1);
+                            node->child[i] = 0;
+                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            node->child[i] = 0;
+                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
+                            child_idx = i;
+                        } else {
+                            LEAFIDX_FREE(ipset, node->child[child_idx]);
+                            NODEPTR_CHILD_CLEAR_LEAF(node, child_idx);
+                            node->child[child_idx] = 0;
+                            child_idx = i;
+                        }
+                    }
+                }
+
+                /* the if() is entered when 'i' is looking at the
+                 * start of a group of child[] entries and any of the
+                 * child[] entries for this group of entries was
+                 * occupied. */
+                if (child_idx != UINT32_MAX) {
+                    if (IPSET_NUM_CHILDREN == child_idx) {
+                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
+                            return SKIPSET_ERR_ALLOC;
+                        }
+                        node->child[i] = new_leaf_idx;
+                    } else if (child_idx != i) {
+                        node->child[i] = node->child[child_idx];
+                        node->child[child_idx] = 0;
+                    }
+                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                    leaf->prefix = 128;
+                    if (node->prefix <= 64 - NUM_BITS) {
+                        leaf->ip.ip[0] = ((node->ip.ip[0]
+                                           | (((uint64_t)i)
+                                              << (64-NUM_BITS- node->prefix)))
+                                          & ((mask_prefix < 64)
+                                             ? ~(UINT64_MAX >> mask_prefix)
+                                             : UINT64_MAX));
+                        leaf->ip.ip[1] = 0;
+                    } else {
+                        leaf->ip.ip[0] = node->ip.ip[0];
+                        leaf->ip.ip[1] = ((node->ip.ip[1]
+                                           | (((uint64_t)i)
+                                              << (128-NUM_BITS- node->prefix)))
+                                          & ~(UINT64_MAX >> (mask_prefix-64)));
+                    }
+                    NODEPTR_CHILD_SET_LEAF(node, i);
+                    NODEPTR_CHILD_CLEAR_LEAF2(node, i+1,
+                                              i + children_per_leaf - 1);
+                    NODEPTR_CHILD_CLEAR_REPEAT2(node, i,
+                                                i + children_per_leaf - 1);
+
+                    child_idx = UINT32_MAX;
+                }
+            }
+
+            /* if node has a single child, we need to replace the node
+             * with the child on the node's parent */
+            ipsetFixNodeSingleChild(ipset, node_idx, 1);
+        }
+    }
+
+    return SKIPSET_OK;
+}
+#endif  /* SK_ENABLE_IPV6 */
+
+
+/*
+ *  status = ipsetMaskAndFillIPTree(ipset, mask_prefix)
+ *
+ *    Helper function for skIPSetMaskAndFill().
+ *
+ *    For each block of size 'mask_prefix', if any IPs in that block
+ *    are set, fill the entire block.
+ */
+static int
+ipsetMaskAndFillIPTree(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix)
+{
+    uint32_t all_ones;
+    int step;
+    int i, j, k;
+
+    assert(ipset);
+    assert(1 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
+    assert(mask_prefix < 32 && mask_prefix > 0);
+
+    ipset->is_dirty = 1;
+
+    if (mask_prefix <= 16) {
+        step = 1 << (16 - mask_prefix);
+        for (i = 0; i < SKIP_BBLOCK_COUNT; i += step) {
+            for (k = (i + step - 1); k >= i; --k) {
+                if (ipset->s.v2->nodes[k] != NULL) {
+                    break;
+                }
+            }
+            if (k < i) {
+                continue;
+            }
+            for (k = (i + step - 1); k >= i; --k) {
+                IPTREE_NODE_ALLOC(ipset, k);
+                memset(ipset->s.v2->nodes[k]->addressBlock, 0xff,
+                       sizeof(ipset->s.v2->nodes[k]->addressBlock));
+            }
+        }
+        return SKIPSET_OK;
+    }
+
+    if (mask_prefix <= 27) {
+        step = 1 << (27 - mask_prefix);
+        for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+            if (ipset->s.v2->nodes[i] == NULL) {
+                continue;
+            }
+            for (j = 0; j < SKIP_BBLOCK_SIZE; j += step) {
+                for (k = (j + step - 1); k >= j; --k) {
+                    if (ipset->s.v2->nodes[i]->addressBlock[k]) {
+                        break;
+                    }
+                }
+                if (k < j) {
+                    continue;
+                }
+                for (k = (j + step - 1); k >= j; --k) {
+                    ipset->s.v2->nodes[i]->addressBlock[k] = UINT32_MAX;
+                }
+            }
+        }
+        return SKIPSET_OK;
+    }
+
+    /* operate on each integer */
+    step = 1 << (32 - mask_prefix);
+    all_ones = UINT32_MAX >> (32 - step);
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        if (ipset->s.v2->nodes[i] == NULL) {
+            continue;
+        }
+        for (j = 0; j < SKIP_BBLOCK_SIZE; ++j) {
+            for (k = 0; k < 32; k += step) {
+                if (GET_MASKED_BITS(ipset->s.v2->nodes[i]->addressBlock[j],
+                                    k, step))
+                {
+                    SET_MASKED_BITS(ipset->s.v2->nodes[i]->addressBlock[j],
+                                    all_ones, k, step);
+                }
+            }
+        }
+    }
+
+    return SKIPSET_OK;
+}
+
+
+/*
+ *  status = ipsetMaskAndFillV4(ipset, mask_prefix)
+ *  status = ipsetMaskAndFillV6(ipset, mask_prefix)
+ *
+ *    Helper function for skIPSetMaskAndFill().
+ *
+ *    For each block of size 'mask_prefix', if any IPs in that block
+ *    are set, fill the entire block.
+ */
+static int
+ipsetMaskAndFillV4(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix)
+{
+    ipset_node_v4_t *node;
+    ipset_leaf_v4_t *leaf;
+    uint32_t child_idx;
+    uint32_t node_idx;
+    uint32_t new_leaf_idx;
+    uint32_t children_per_leaf;
+    uint32_t ipv4;
+    uint32_t i;
+    uint32_t j;
+    uint32_t depth;
+    uint32_t to_visit[IPSET_MAX_DEPTH_V4];
+
+    ipset->is_dirty = 1;
+
+    /* handle case where root is a leaf */
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        leaf = LEAF_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
+        if (leaf->prefix > mask_prefix) {
+            /* leaf spans fewer IPs than specified by 'mask_prefix'.
+             * Modify the leaf's IP and prefix and return */
+            leaf->ip &= ~(UINT32_MAX >> mask_prefix);
+            leaf->prefix = mask_prefix;
+            return SKIPSET_OK;
+        }
+        /* else, this leaf's prefix is more course (holds more IPs)
+         * than the mask_prefix, and there is no need to change it. */
+        return SKIPSET_OK;
+    }
+
+    /* handle case where root contains a node whose prefix is
+     * more-precise than the 'mask_prefix' */
+    node = NODE_PTR_V4(ipset, IPSET_ROOT_INDEX(ipset));
+    if (node->prefix >= mask_prefix) {
+        ipv4 = node->ip;
+        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
+        leaf = LEAF_PTR_V4(ipset, new_leaf_idx);
+        leaf->ip = ipv4 &  ~(UINT32_MAX >> mask_prefix);
+        leaf->prefix = mask_prefix;
+        return SKIPSET_OK;
+    }
+
+    /* visit the nodes in the tree */
+    depth = 0;
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+
+    while (depth) {
+        node_idx = to_visit[--depth];
+        node = NODE_PTR_V4(ipset, node_idx);
+
+        if (mask_prefix - node->prefix > NUM_BITS) {
+            /* this node is not at the bottom level of the tree; add
+             * child nodes of this node to the 'to_visit' list. modify
+             * any leaves to hold a single block */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if ((0 == node->child[i])
+                    || NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    /* no-op */
+                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                    /* node; add to vist list unless its prefix is
+                     * larger than or equal to the mask, in which case
+                     * replace with a leaf */
+                    if (NODE_PTR_V4(ipset, node->child[i])->prefix
+                        < mask_prefix)
+                    {
+                        to_visit[depth++] = node->child[i];
+                    } else {
+                        ipv4 = NODE_PTR_V4(ipset,node->child[i])->ip;
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                        leaf->ip = ipv4 & ~(UINT32_MAX >> mask_prefix);
+                        leaf->prefix = mask_prefix;
+                    }
+                } else {
+                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                    if (leaf->prefix > mask_prefix) {
+                        leaf->ip &= ~(UINT32_MAX >> mask_prefix);
+                        leaf->prefix = mask_prefix;
+                    }
+                }
+            }
+
+        } else if (mask_prefix - node->prefix == NUM_BITS) {
+            /* this node is on the bottom level of the tree, and every
+             * occupied child[] will become an independent leaf */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]
+                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                    } else {
+                        leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                        if (leaf->prefix <= mask_prefix) {
+                            continue;
+                        }
+                    }
+                    leaf->ip = ((node->ip
+                                 | (i << (32 - NUM_BITS - node->prefix)))
+                                & ~(UINT32_MAX >> mask_prefix));
+                    leaf->prefix = mask_prefix;
+                }
+            }
+
+        } else {
+            /* this node is on the bottom level of the tree. multiple
+             * child[] entries will become a single leaf */
+            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
+            child_idx = UINT32_MAX;
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                for (j = 0; j < children_per_leaf; ++j) {
+                    --i;
+                    if (node->child[i]) {
+                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            ipsetDestroySubtree(ipset, node->child[i], 1);
+                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
+                            leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                            if (leaf->prefix <= mask_prefix) {
+                                assert(0 == j);
+                                i -= children_per_leaf - 1;
+                                break;
+                            }
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            node->child[i] = 0;
+                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
+                            child_idx = i;
+                        } else {
+                            LEAFIDX_FREE(ipset, node->child[child_idx]);
+                            node->child[child_idx] = 0;
+                            child_idx = i;
+                        }
+                    }
+                }
+
+                /* the if() is entered when 'i' is looking at the
+                 * start of a group of child[] entries and any of the
+                 * child[] entries for this group of entries was
+                 * occupied. */
+                if (child_idx != UINT32_MAX) {
+                    if (IPSET_NUM_CHILDREN == child_idx) {
+                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
+                            return SKIPSET_ERR_ALLOC;
+                        }
+                        node->child[i] = new_leaf_idx;
+                    } else if (child_idx != i) {
+                        node->child[i] = node->child[child_idx];
+                    }
+                    leaf = LEAF_PTR_V4(ipset, node->child[i]);
+                    leaf->ip = ((node->ip
+                                 | (i << (32 - NUM_BITS - node->prefix)))
+                                & ~(UINT32_MAX >> mask_prefix));
+                    leaf->prefix = mask_prefix;
+                    NODEPTR_CHILD_SET_LEAF2(node, i,
+                                            i + children_per_leaf - 1);
+                    NODEPTR_CHILD_SET_REPEAT2(node, i+1,
+                                              i + children_per_leaf - 1);
+                    for (j = 1; j < children_per_leaf; ++j) {
+                        node->child[i + j] = node->child[i];
+                    }
+                    /* reset for next group */
+                    child_idx = UINT32_MAX;
+                }
+            }
+        }
+    }
+
+    return SKIPSET_OK;
+}
+
+#if SK_ENABLE_IPV6
+static int
+ipsetMaskAndFillV6(
+    skipset_t          *ipset,
+    const uint32_t      mask_prefix)
+{
+    ipset_node_v6_t *node;
+    ipset_leaf_v6_t *leaf;
+    uint32_t child_idx;
+    uint32_t node_idx;
+    uint32_t new_leaf_idx;
+    uint32_t children_per_leaf;
+    ipset_ipv6_t ipv6;
+    uint32_t i;
+    uint32_t j;
+    uint32_t depth;
+    uint32_t to_visit[IPSET_MAX_DEPTH_V6];
+
+    ipset->is_dirty = 1;
+
+    /* handle case where root is a leaf */
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        leaf = LEAF_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
+        if (leaf->prefix > mask_prefix) {
+            /* leaf spans fewer IPs than specified by 'mask_prefix'.
+             * Modify the leaf's IP and prefix and return */
+            IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
+            leaf->prefix = mask_prefix;
+            return SKIPSET_OK;
+        }
+        /* else, this leaf's prefix is more course (holds more IPs)
+         * than the mask_prefix, and there is no need to change it */
+        return SKIPSET_OK;
+    }
+
+    /* handle case where root contains a node whose prefix is
+     * more-precise than the 'mask_prefix' */
+    node = NODE_PTR_V6(ipset, IPSET_ROOT_INDEX(ipset));
+    if (node->prefix >= mask_prefix) {
+        IPSET_IPV6_COPY(&ipv6, &node->ip);
+        new_leaf_idx = ipsetReplaceNodeWithLeaf(ipset, NULL, 0);
+        leaf = LEAF_PTR_V6(ipset, new_leaf_idx);
+        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
+        leaf->prefix = mask_prefix;
+        return SKIPSET_OK;
+    }
+
+    /* visit the nodes in the tree */
+    depth = 0;
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+
+    while (depth) {
+        node_idx = to_visit[--depth];
+        node = NODE_PTR_V6(ipset, node_idx);
+
+        if (mask_prefix - node->prefix > NUM_BITS) {
+            /* this node is not at the bottom level of the tree; add
+             * child nodes of this node to the 'to_visit' list. modify
+             * any leaves to hold a single block. */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if ((0 == node->child[i])
+                    || NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    /* no-op */
+                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                    /* node; add to vist list unless its prefix is
+                     * larger than or equal to the mask, in which case
+                     * replace with a leaf */
+                    if (NODE_PTR_V6(ipset, node->child[i])->prefix
+                        < mask_prefix)
+                    {
+                        to_visit[depth++] = node->child[i];
+                    } else {
+                        IPSET_IPV6_COPY(&ipv6,
+                                        &NODE_PTR_V6(ipset,node->child[i])->ip);
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
+                        leaf->prefix = mask_prefix;
+                    }
+                } else {
+                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                    if (leaf->prefix > mask_prefix) {
+                        IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
+                        leaf->prefix = mask_prefix;
+                    }
+                }
+            }
+
+        } else if (mask_prefix - node->prefix == NUM_BITS) {
+            /* this node is on the bottom level of the tree, and every
+             * occupied child[] will become an independent leaf */
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]
+                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
+                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                    } else {
+                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                        if (leaf->prefix <= mask_prefix) {
+                            continue;
+                        }
+                    }
+                    leaf->prefix = mask_prefix;
+                    if (node->prefix <= 64 - NUM_BITS) {
+                        leaf->ip.ip[0] = ((node->ip.ip[0]
+                                           | (((uint64_t)i)
+                                              << (64-NUM_BITS- node->prefix)))
+                                          & ((mask_prefix < 64)
+                                             ? ~(UINT64_MAX >> mask_prefix)
+                                             : UINT64_MAX));
+                        leaf->ip.ip[1] = 0;
+                    } else {
+                        leaf->ip.ip[0] = node->ip.ip[0];
+                        leaf->ip.ip[1] = ((node->ip.ip[1]
+                                           | (((uint64_t)i)
+                                              << (128-NUM_BITS- node->prefix)))
+                                          & ~(UINT64_MAX >> (mask_prefix-64)));
+                    }
+                }
+            }
+
+        } else {
+            /* this node is on the bottom level of the tree. multiple
+             * child[] entries will become a single leaf */
+            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
+            child_idx = UINT32_MAX;
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                for (j = 0; j < children_per_leaf; ++j) {
+                    --i;
+                    if (node->child[i]) {
+                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                            ipsetDestroySubtree(ipset, node->child[i], 1);
+                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
+                            leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                            if (leaf->prefix <= mask_prefix) {
+                                assert(0 == j);
+                                i -= children_per_leaf - 1;
+                                break;
+                            }
+                            if (UINT32_MAX == child_idx) {
+                                child_idx = IPSET_NUM_CHILDREN;
+                            }
+                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
+                            child_idx = i;
+                        } else {
+                            LEAFIDX_FREE(ipset, node->child[child_idx]);
+                            NODEPTR_CHILD_CLEAR_LEAF(node, child_idx);
+                            child_idx = i;
+                        }
+                    }
+                }
+
+                /* the if() is entered when 'i' is looking at the
+                 * start of a group of child[] entries and any of the
+                 * child[] entries for this group of entries was
+                 * occupied. */
+                if (child_idx != UINT32_MAX) {
+                    if (IPSET_NUM_CHILDREN == child_idx) {
+                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
+                            return SKIPSET_ERR_ALLOC;
+                        }
+                        node->child[i] = new_leaf_idx;
+                    } else if (child_idx != i) {
+                        node->child[i] = node->child[child_idx];
+                    }
+                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
+                    leaf->prefix = mask_prefix;
+                    if (node->prefix <= 64 - NUM_BITS) {
+                        leaf->ip.ip[0] = ((node->ip.ip[0]
+                                           | (((uint64_t)i)
+                                              << (64-NUM_BITS- node->prefix)))
+                                          & ((mask_prefix < 64)
+                                             ? ~(UINT64_MAX >> mask_prefix)
+                                             : UINT64_MAX));
+                        leaf->ip.ip[1] = 0;
+                    } else {
+                        leaf->ip.ip[0] = node->ip.ip[0];
+                        leaf->ip.ip[1] = ((node->ip.ip[1]
+                                           | (((uint64_t)i)
+                                              << (128-NUM_BITS- node->prefix)))
+                                          & ~(UINT64_MAX >> (mask_prefix-64)));
+                    }
+                    NODEPTR_CHILD_SET_LEAF2(node, i,
+                                            i + children_per_leaf - 1);
+                    NODEPTR_CHILD_SET_REPEAT2(node, i+1,
+                                              i + children_per_leaf - 1);
+                    for (j = 1; j < children_per_leaf; ++j) {
+                        node->child[i + j] = node->child[i];
+                    }
+
+                    child_idx = UINT32_MAX;
+                }
+            }
+        }
+    }
+
+    return SKIPSET_OK;
+}
+#endif  /* SK_ENABLE_IPV6 */
+
+
+/*
+ *  status = ipsetNewEntries(ipset, num_nodes, num_leaves, node_indexes, leaf_indexes);
+ *
+ *    Determine where 'num_nodes' new nodes and 'num_leaves' new
+ *    leaves can be stored and return the index(es) to that/those
+ *    location(s) in the arrays specified by the 'node_indexes' and
+ *    'leaf_indexes' parameters.  The new nodes and leaves will be
+ *    zeroed before returning.
+ *
+ *    When a size value is 0, its corresponding array may be NULL.
+ *
+ *    If a value is 0, its array will not be modified, so any pointers
+ *    into that array remain valid.  Specifically, if you have a
+ *    handle to a node and request new leaves, the handle to the node
+ *    remains valid.
+ *
+ *    Uses space at the end of the currently allocated arrays first,
+ *    then returns entries from the free list.  Finally, calls
+ *    ipsetAllocEntries() if no nodes or leaves are available.  Return
+ *    0 on success, or SKIPSET_ERR_ALLOC on failure.
+ *
+ *    If the leaves buffer is reallocated, this function sets the
+ *    'realloc_leaves' bit on the 'ipset'.
+ */
+static int
+ipsetNewEntries(
+    skipset_t          *ipset,
+    uint32_t            num_nodes,
+    uint32_t            num_leaves,
+    uint32_t           *node_indexes,
+    uint32_t           *leaf_indexes)
+#ifndef IPSET_DEBUG_MEMORY
+{
+    /* this is the normal function defintion of ipsetNewEntries() */
+
+    assert(ipset);
+    assert(ipset->s.v3->nodes.entry_capacity >= ipset->s.v3->nodes.entry_count);
+    assert(ipset->s.v3->leaves.entry_capacity
+           >= ipset->s.v3->leaves.entry_count);
+
+    if (num_leaves <= (ipset->s.v3->leaves.entry_capacity
+                       - ipset->s.v3->leaves.entry_count))
+    {
+        /* grab leaves from end of the "fresh" memory */
+        while (num_leaves) {
+            *leaf_indexes = ipset->s.v3->leaves.entry_count;
+            ++ipset->s.v3->leaves.entry_count;
+            ++leaf_indexes;
+            --num_leaves;
+        }
+        if (num_nodes) {
+            goto ALLOC_NODES;
+        }
+        return SKIPSET_OK;
+    }
+    while (num_leaves && (ipset->s.v3->leaves.entry_count
+                          < ipset->s.v3->leaves.entry_capacity))
+    {
+        /* grab as many leaves from end of the "fresh" memory as we can */
+        *leaf_indexes = ipset->s.v3->leaves.entry_count;
+        ++ipset->s.v3->leaves.entry_count;
+        ++leaf_indexes;
+        --num_leaves;
+    }
+    while (num_leaves && ipset->s.v3->leaves.free_list) {
+        /* grab as many leaves from the free list as we can */
+        ipset_leaf_t *leaf;
+        *leaf_indexes = ipset->s.v3->leaves.free_list;
+        leaf = LEAF_PTR(ipset, *leaf_indexes);
+        ipset->s.v3->leaves.free_list = LEAFPTR_FREE_LIST(leaf);
+        memset(leaf, 0, ipset->s.v3->leaves.entry_size);
+        ++leaf_indexes;
+        --num_leaves;
+    }
+    if (num_leaves) {
+        /* allocate new memory and use it; set the flag to denote that
+         * new leaves have been allocated. */
+        if (ipset->s.v3->leaves.entry_capacity > 0) {
+            ipset->s.v3->realloc_leaves = 1;
+        }
+        do {
+            if (ipsetAllocEntries(&ipset->s.v3->leaves, 0)) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            while (num_leaves && (ipset->s.v3->leaves.entry_count
+                                  < ipset->s.v3->leaves.entry_capacity))
+            {
+                *leaf_indexes = ipset->s.v3->leaves.entry_count;
+                ++ipset->s.v3->leaves.entry_count;
+                ++leaf_indexes;
+                --num_leaves;
+            }
+        } while (num_leaves);
+    }
+
+  ALLOC_NODES:
+    if (num_nodes
+        <= (ipset->s.v3->nodes.entry_capacity - ipset->s.v3->nodes.entry_count))
+    {
+        /* grab nodes from end of the "fresh" memory */
+        while (num_nodes) {
+            *node_indexes = ipset->s.v3->nodes.entry_count;
+            ++ipset->s.v3->nodes.entry_count;
+            ++node_indexes;
+            --num_nodes;
+        }
+        return SKIPSET_OK;
+    }
+    while (num_nodes && (ipset->s.v3->nodes.entry_count
+                         < ipset->s.v3->nodes.entry_capacity))
+    {
+        /* grab as many nodes from end of the "fresh" memory as we can */
+        *node_indexes = ipset->s.v3->nodes.entry_count;
+        ++ipset->s.v3->nodes.entry_count;
+        ++node_indexes;
+        --num_nodes;
+    }
+    while (num_nodes && ipset->s.v3->nodes.free_list) {
+        /* grab as many nodes from the free list as we can */
+        ipset_node_t *node;
+        *node_indexes = ipset->s.v3->nodes.free_list;
+        node = NODE_PTR(ipset, *node_indexes);
+        ipset->s.v3->nodes.free_list = NODEPTR_FREE_LIST(node);
+        memset(node, 0, ipset->s.v3->nodes.entry_size);
+        ++node_indexes;
+        --num_nodes;
+    }
+    while (num_nodes) {
+        /* allocate new memory and use it */
+        if (ipsetAllocEntries(&ipset->s.v3->nodes, 0)) {
+            return SKIPSET_ERR_ALLOC;
+        }
+        while (num_nodes && (ipset->s.v3->nodes.entry_count
+                             < ipset->s.v3->nodes.entry_capacity))
+        {
+            *node_indexes = ipset->s.v3->nodes.entry_count;
+            ++ipset->s.v3->nodes.entry_count;
+            ++node_indexes;
+            --num_nodes;
+        }
+    }
+
+    return SKIPSET_OK;
+}
+#else  /* #ifndef IPSET_DEBUG_MEMORY */
+{
+    /*
+     *  This is a debugging defintion of ipsetNewEntries().
+     *
+     *  This definition uses the free list first, so we properly
+     *  handle cases where a call to ipsetNewEntries() follows a call
+     *  to ipsetDestroySubtree().  (The calling code does not expect
+     *  the ipsetNewEntries() call to fail in this case.)
+     *
+     *  If additional nodes and/or leaves are required, the function
+     *  moves the location of the nodes and/or leaves array(s).  The
+     *  objective is to find places the in code that are holding a
+     *  stale pointer---that is, places that do not properly handle
+     *  the case where a realloc may occur.
+     *
+     *  In addition, the function allocates only as many nodes/leaves
+     *  as are requested, so writing beyond the array can be detected
+     *  by memory checkers.
+     */
+
+    void *new_mem;
+    uint32_t new_size;
+
+    assert(ipset);
+    assert(ipset->s.v3->nodes.entry_capacity >= ipset->s.v3->nodes.entry_count);
+    assert(ipset->s.v3->leaves.entry_capacity
+           >= ipset->s.v3->leaves.entry_count);
+
+    if (num_leaves) {
+        while (num_leaves && ipset->s.v3->leaves.free_list) {
+            ipset_leaf_t *leaf;
+            *leaf_indexes = ipset->s.v3->leaves.free_list;
+            leaf = LEAF_PTR(ipset, *leaf_indexes);
+            ipset->s.v3->leaves.free_list = LEAFPTR_FREE_LIST(leaf);
+            memset(leaf, 0, ipset->s.v3->leaves.entry_size);
+            ++leaf_indexes;
+            --num_leaves;
+        }
+        if (num_leaves) {
+            if (ipset->s.v3->leaves.entry_capacity
+                && ((ipset->s.v3->leaves.entry_capacity + num_leaves)
+                    % IPSET_INITIAL_ENTRY_COUNT) < num_leaves)
+            {
+                ipset->s.v3->realloc_leaves = 1;
+            }
+            new_size = ipset->s.v3->leaves.entry_capacity + num_leaves;
+            new_mem = malloc(new_size * ipset->s.v3->leaves.entry_size);
+            if (!new_mem) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            if (ipset->s.v3->leaves.buf) {
+                memcpy(new_mem, ipset->s.v3->leaves.buf,
+                       (ipset->s.v3->leaves.entry_count
+                        * ipset->s.v3->leaves.entry_size));
+                free(ipset->s.v3->leaves.buf);
+            }
+            ipset->s.v3->leaves.buf = new_mem;
+            ipset->s.v3->leaves.entry_capacity = new_size;
+            do {
+                *leaf_indexes = ipset->s.v3->leaves.entry_count;
+                memset(LEAF_PTR(ipset, *leaf_indexes), 0,
+                       ipset->s.v3->leaves.entry_size);
+                ++ipset->s.v3->leaves.entry_count;
+                ++leaf_indexes;
+                --num_leaves;
+                assert(ipset->s.v3->leaves.entry_capacity
+                       >= ipset->s.v3->leaves.entry_count);
+            } while (num_leaves);
+        }
+    }
+
+    if (num_nodes) {
+        while (num_nodes && ipset->s.v3->nodes.free_list) {
+            ipset_node_t *node;
+            *node_indexes = ipset->s.v3->nodes.free_list;
+            node = NODE_PTR(ipset, *node_indexes);
+            ipset->s.v3->nodes.free_list = NODEPTR_FREE_LIST(node);
+            memset(node, 0, ipset->s.v3->nodes.entry_size);
+            ++node_indexes;
+            --num_nodes;
+        }
+        if (num_nodes) {
+            new_size = ipset->s.v3->nodes.entry_capacity + num_nodes;
+            new_mem = malloc(new_size * ipset->s.v3->nodes.entry_size);
+            if (!new_mem) {
+                return SKIPSET_ERR_ALLOC;
+            }
+            if (ipset->s.v3->nodes.buf) {
+                memcpy(new_mem, ipset->s.v3->nodes.buf,
+                       (ipset->s.v3->nodes.entry_count
+                        * ipset->s.v3->nodes.entry_size));
+                free(ipset->s.v3->nodes.buf);
+            }
+            ipset->s.v3->nodes.buf = new_mem;
+            ipset->s.v3->nodes.entry_capacity = new_size;
+            do {
+                *node_indexes = ipset->s.v3->nodes.entry_count;
+                memset(NODE_PTR(ipset, *node_indexes), 0,
+                       ipset->s.v3->nodes.entry_size);
+                ++ipset->s.v3->nodes.entry_count;
+                ++node_indexes;
+                --num_nodes;
+                assert(ipset->s.v3->nodes.entry_capacity
+                       >= ipset->s.v3->nodes.entry_count);
+            } while (num_nodes);
+        }
+    }
+
+    return SKIPSET_OK;
+}
+#endif  /* #else of #ifndef IPSET_DEBUG_MEMORY */
+
+
+/*
+ *  status = ipsetOptionsHandler(cData, opt_index, opt_arg);
+ *
+ *    Parse an option that was registered by skIPSetOptionsRegister().
+ *    Return 0 on success, or non-zero on failure.
+ */
+static int
+ipsetOptionsHandler(
+    clientData          cData,
+    int                 opt_index,
+    char               *opt_arg)
+{
+    skipset_options_t *ipset_opts = (skipset_options_t*)cData;
+    uint32_t tmp32;
+    int rv;
+
+    switch (opt_index) {
+      case OPT_IPSET_RECORD_VERSION:
+        rv = skStringParseUint32(&tmp32, opt_arg, IPSET_REC_VERSION_DEFAULT,
+                                 IPSET_REC_VERSION_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        if (1 == tmp32) {
+            skAppPrintErr("Invalid %s '%s': Illegal version number",
+                          ipset_options[opt_index].name, opt_arg);
+            return -1;
+        }
+        ipset_opts->record_version = (uint16_t)tmp32;
+        break;
+
+      case OPT_IPSET_INVOCATION_STRIP:
+        ipset_opts->invocation_strip = 1;
+        break;
+
+      default:
+        skAbortBadCase(opt_index);
+    }
+
+    return 0;
+
+  PARSE_ERROR:
+    skAppPrintErr("Invalid %s '%s': %s",
+                  ipset_options[opt_index].name, opt_arg,
+                  skStringParseStrerror(rv));
+    return -1;
+}
+
+
+/*
+ *  status = ipsetPrintCallback(ip, prefix, &print_state);
+ *
+ *    Helper function for skIPSetPrint().
+ *
+ *    Print a textual representation of the 'ip' and 'prefix'.  The
+ *    stream to print to and the format to use are present in the
+ *    'print_state' argument.
+ */
+static int
+ipsetPrintCallback(
+    skipaddr_t         *ip,
+    uint32_t            prefix,
+    void               *v_print_state)
+{
+    ipset_print_t *print_state = (ipset_print_t*)v_print_state;
+    char ipbuf[SK_NUM2DOT_STRLEN+1];
+    int rv = SKIPSET_OK;
+
+    /* print ip and its prefix, then return */
+    skipaddrString(ipbuf, ip, print_state->ip_format);
+    if (skipaddrIsV6(ip) ? (prefix == 128) : (prefix == 32)) {
+        if (skStreamPrint(print_state->stream, "%s\n", ipbuf)) {
+            rv = SKIPSET_ERR_FILEIO;
+        }
+    } else {
+        if (skStreamPrint(print_state->stream, ("%s/%" PRIu32 "\n"),
+                          ipbuf, prefix))
+        {
+            rv = SKIPSET_ERR_FILEIO;
+        }
+    }
+
+    return rv;
+}
+
+
+/*
+ *  status = ipsetReadCidrbmapIntoIPTree(&ipset, stream, hdr);
+ *
+ *    Helper function for skIPSetRead() via ipsetReadCidrbmap().
+ *
+ *    Read an IPset containing only IPv4 addresses in the
+ *    IPSET_REC_VERSION_CIDR_BMAP format from 'stream' and create a
+ *    SiLK-2 IPTree data structure.
+ *
+ *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    file format.
+ */
+static int
+ipsetReadCidrbmapIntoIPTree(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    skipset_t *ipset = NULL;
+    sk_header_entry_t *hentry;
+    uint8_t read_buf[sizeof(uint32_t) + sizeof(uint8_t)];
+    uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+    int swap_flag;
+    uint32_t slash24;
+    uint32_t slash16;
+    ssize_t b;
+    int i;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    assert(hdr);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
+                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
+    {
+        skAbort();
+    }
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
+    }
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        skAbort();
+    }
+    if (sizeof(uint32_t) != skHentryIPSetGetLeafSize(hentry)) {
+        skAbort();
+    }
+
+    swap_flag = !skHeaderIsNativeByteOrder(hdr);
+
+    rv = ipsetCreate(&ipset, 0, 0);
+    if (rv != SKIPSET_OK) {
+        goto END;
+    }
+
+    while ((b = skStreamRead(stream, read_buf, sizeof(read_buf)))
+           == sizeof(read_buf))
+    {
+        if (swap_flag) {
+            slash24 = BSWAP32(*(uint32_t*)read_buf);
+        } else {
+            slash24 = *(uint32_t*)read_buf;
+        }
+        /* handle the prefix bit */
+        if (read_buf[sizeof(uint32_t)] <= 32) {
+            /* IPv4 and one byte that is CIDR block */
+            rv = ipsetInsertAddressIPTree(ipset, slash24,
+                                          read_buf[sizeof(uint32_t)]);
+            if (rv) {
+                goto END;
+            }
+        } else if (read_buf[sizeof(uint32_t)] != SET_CIDR_BMAP_256) {
+            skAppPrintErr("Unexpected value for prefix %u",
+                          read_buf[sizeof(uint32_t)]);
+            skAbort();
+        } else {
+            /* IPv4 and 256-element bitmap */
+            if ((b = skStreamRead(stream, bmap, sizeof(bmap)))
+                != sizeof(bmap))
+            {
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
+            }
+            if (swap_flag) {
+                for (i = 0; i < IPTREE_WORDS_PER_SLASH24; ++i) {
+                    bmap[i] = BSWAP32(bmap[i]);
+                }
+            }
+            /* Put the first two octets of the base IP into slash16,
+             * and allocate the space for the /16 if we need to */
+            slash16 = (slash24 >> 16);
+            if (NULL == ipset->s.v2->nodes[slash16]) {
+                ipset->s.v2->nodes[slash16]
+                    = (skIPNode_t*)calloc(1, sizeof(skIPNode_t));
+                if (NULL == ipset->s.v2->nodes[slash16]) {
+                    rv = SKIPSET_ERR_ALLOC;
+                    goto END;
+                }
+            }
+            /* Locate where this /24 occurs inside the larger /16,
+             * then copy it into place.  Following is equivalent to
+             * (((slash24 >> 8) & 0xFF) * 8); */
+            slash24 = ((slash24 & 0x0000FF00) >> 5);
+            memcpy((ipset->s.v2->nodes[slash16]->addressBlock + slash24),
+                   bmap, sizeof(bmap));
+        }
+    }
+    if (b != 0) {
+        /* read error */
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
+}
+
+
+/*
+ *  status = ipsetReadCidrbmapIntoRadixV4(&ipset, stream, hdr, is_ipv6);
+ *  status = ipsetReadCidrbmapIntoRadixV6(&ipset, stream, hdr, is_ipv6);
+ *
+ *    Helper function for skIPSetRead() via ipsetReadCidrbmap().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_CIDR_BMAP format from
+ *    'stream' and create a radix-tree IPset data structure.
+ *
+ *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    file format.
+ */
+static int
+ipsetReadCidrbmapIntoRadixV4(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    skipset_t *ipset = NULL;
+    sk_header_entry_t *hentry;
+    uint8_t read_buf[sizeof(uint32_t) + sizeof(uint8_t)];
+    uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+    int swap_flag;
+    uint32_t slash24;
+    uint32_t ipv4;
+    ssize_t b;
+    int i;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    assert(hdr);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
+                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
+    {
+        skAbort();
+    }
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
+    }
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        skAbort();
+    }
+    if (sizeof(uint32_t) != skHentryIPSetGetLeafSize(hentry)) {
+        skAbort();
+    }
+
+    swap_flag = !skHeaderIsNativeByteOrder(hdr);
+
+    rv = ipsetCreate(&ipset, 0, 1);
+    if (rv != SKIPSET_OK) {
+        goto END;
+    }
+
+    while ((b = skStreamRead(stream, read_buf, sizeof(read_buf)))
+           == sizeof(read_buf))
+    {
+        if (swap_flag) {
+            slash24 = BSWAP32(*(uint32_t*)read_buf);
+        } else {
+            slash24 = *(uint32_t*)read_buf;
+        }
+        /* handle the prefix bit */
+        if (read_buf[sizeof(uint32_t)] <= 32) {
+            /* IPv4 and one byte that is CIDR block */
+            rv = ipsetInsertAddressV4(ipset, slash24,
+                                      read_buf[sizeof(uint32_t)], NULL);
+            if (rv) { goto END; }
+        } else if (read_buf[sizeof(uint32_t)] != SET_CIDR_BMAP_256) {
+            skAppPrintErr("Unexpected value for prefix %u",
+                          read_buf[sizeof(uint32_t)]);
+            skAbort();
+        } else {
+            /* IPv4 base address and 256-bit bitmap */
+            if ((b = skStreamRead(stream, bmap, sizeof(bmap)))
+                != sizeof(bmap))
+            {
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
+            }
+            /* loop over the uint32_t in this block */
+            i = 0;
+            while (i < 8) {
+                switch (i) {
+                  case 0: case 4:
+                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*4)==0){
+                        i += 4;
+                        continue;
+                    }
+                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*4)==0){
+                        ipv4 = slash24 | (i << 5);
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 25, NULL);
+                        if (rv) { goto END; }
+                        i += 4;
+                        continue;
+                    }
+                    /* FALLTHROUGH */
+                  case 2: case 6:
+                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*2)==0){
+                        i += 2;
+                        continue;
+                    }
+                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*2)==0){
+                        ipv4 = slash24 | (i << 5);
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 26, NULL);
+                        if (rv) { goto END; }
+                        i += 2;
+                        continue;
+                    }
+                    /* FALLTHROUGH */
+                  default:
+                    if (0 == bmap[i]) {
+                        ++i;
+                        continue;
+                    }
+                    if (UINT32_MAX == bmap[i]) {
+                        ipv4 = slash24 | (i << 5);
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 27, NULL);
+                        if (rv) { goto END; }
+                        ++i;
+                        continue;
+                    }
+                    break;
+                }
+
+                ipv4 = slash24 | (i << 5);
+
+                if (swap_flag) {
+                    bmap[i] = BSWAP32(bmap[i]);
+                }
+                while (bmap[i]) {
+                    /* find position of least significant bit */
+                    if (!(bmap[i] & 0x1)) {
+                        if ((bmap[i] & 0xFFFF) == 0) {
+                            bmap[i] >>= 16;
+                            ipv4 += 16;
+                        }
+                        if ((bmap[i] & 0xFF) == 0) {
+                            bmap[i] >>= 8;
+                            ipv4 += 8;
+                        }
+                        if ((bmap[i] & 0xF) == 0) {
+                            bmap[i] >>= 4;
+                            ipv4 += 4;
+                        }
+                        if ((bmap[i] & 0x3) == 0) {
+                            bmap[i] >>= 2;
+                            ipv4 += 2;
+                        }
+                        if ((bmap[i] & 0x1) == 0) {
+                            bmap[i] >>= 1;
+                            ipv4 += 1;
+                        }
+                    }
+                    /* find number of consecutive high bits that
+                     * map into a CIDR block */
+                    switch (ipv4 & 0x1F) {
+                      case 0: case 16:
+                        if ((bmap[i] & 0xFFFF) == 0xFFFF) {
+                            rv = ipsetInsertAddressV4(ipset, ipv4, 28, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 16;
+                            ipv4 += 16;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      case 8: case 24:
+                        if ((bmap[i] & 0xFF) == 0xFF) {
+                            rv = ipsetInsertAddressV4(ipset, ipv4, 29, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 8;
+                            ipv4 += 8;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      case 4: case 12: case 20: case 28:
+                        if ((bmap[i] & 0xF) == 0xF) {
+                            rv = ipsetInsertAddressV4(ipset, ipv4, 30, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 4;
+                            ipv4 += 4;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      case  2: case  6: case 10: case 14:
+                      case 18: case 22: case 26: case 30:
+                        if ((bmap[i] & 0x3) == 0x3) {
+                            rv = ipsetInsertAddressV4(ipset, ipv4, 31, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 2;
+                            ipv4 += 2;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      default:
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 32, NULL);
+                        if (rv) { goto END; }
+                        bmap[i] >>= 1;
+                        ++ipv4;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    if (b != 0) {
+        /* read error */
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+
+    skIPSetClean(ipset);
+
+    /* Success */
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
+}
+
+#if SK_ENABLE_IPV6
+static int
+ipsetReadCidrbmapIntoRadixV6(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    skipset_t *ipset = NULL;
+    sk_header_entry_t *hentry;
+    uint8_t read_buf[IPSET_LEN_V6 + sizeof(uint8_t)];
+    uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+    int swap_flag;
+    ipset_ipv6_t slash120;
+    ipset_ipv6_t ipv6;
+    ssize_t b;
+    int i;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    assert(hdr);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
+                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
+    {
+        skAbort();
+    }
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
+    }
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        skAbort();
+    }
+    if (IPSET_LEN_V6 != skHentryIPSetGetLeafSize(hentry)) {
+        skAbort();
+    }
+
+    swap_flag = !skHeaderIsNativeByteOrder(hdr);
+
+    rv = ipsetCreate(&ipset, 1, 1);
+    if (rv != SKIPSET_OK) {
+        goto END;
+    }
+
+    while ((b = skStreamRead(stream, read_buf, sizeof(read_buf)))
+           == sizeof(read_buf))
+    {
+        IPSET_IPV6_FROM_ARRAY(&slash120, read_buf);
+        /* handle the prefix bit */
+        if (read_buf[IPSET_LEN_V6] <= 128) {
+            /* IPv6 and one byte CIDR prefix */
+            rv = ipsetInsertAddressV6(ipset, &slash120,
+                                      read_buf[IPSET_LEN_V6], NULL);
+            if (rv) { goto END; }
+        } else if (read_buf[IPSET_LEN_V6] != SET_CIDR_BMAP_256) {
+            skAppPrintErr("Unexpected value for prefix %u",
+                          read_buf[sizeof(uint32_t)]);
+            skAbort();
+        } else {
+            /* IPv6 base address and 256-bit bitmap */
+            if ((b = skStreamRead(stream, bmap, sizeof(bmap)))
+                != sizeof(bmap))
+            {
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
+            }
+
+            ipv6.ip[0] = slash120.ip[0];
+
+            /* loop over the uint32_t in this block */
+            i = 0;
+            while (i < 8) {
+                switch (i) {
+                  case 0: case 4:
+                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*4)==0){
+                        i += 4;
+                        continue;
+                    }
+                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*4)==0){
+                        ipv6.ip[1] = slash120.ip[1] | (i << 5);
+                        rv = ipsetInsertAddressV6(ipset, &ipv6, 121, NULL);
+                        if (rv) { goto END; }
+                        i += 4;
+                        continue;
+                    }
+                    /* FALLTHROUGH */
+                  case 2: case 6:
+                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*2)==0){
+                        i += 2;
+                        continue;
+                    }
+                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*2)==0){
+                        ipv6.ip[1] = slash120.ip[1] | (i << 5);
+                        rv = ipsetInsertAddressV6(ipset, &ipv6, 122, NULL);
+                        if (rv) { goto END; }
+                        i += 2;
+                        continue;
+                    }
+                    /* FALLTHROUGH */
+                  default:
+                    if (0 == bmap[i]) {
+                        ++i;
+                        continue;
+                    }
+                    if (UINT32_MAX == bmap[i]) {
+                        ipv6.ip[1] = slash120.ip[1] | (i << 5);
+                        rv = ipsetInsertAddressV6(ipset, &ipv6, 123, NULL);
+                        if (rv) { goto END; }
+                        ++i;
+                        continue;
+                    }
+                    break;
+                }
+
+                ipv6.ip[1] = slash120.ip[1] | (i << 5);
+
+                if (swap_flag) {
+                    bmap[i] = BSWAP32(bmap[i]);
+                }
+
+                while (bmap[i]) {
+                    /* find position of least significant bit */
+                    if (!(bmap[i] & 0x1)) {
+                        if ((bmap[i] & 0xFFFF) == 0) {
+                            bmap[i] >>= 16;
+                            ipv6.ip[1] += 16;
+                        }
+                        if ((bmap[i] & 0xFF) == 0) {
+                            bmap[i] >>= 8;
+                            ipv6.ip[1] += 8;
+                        }
+                        if ((bmap[i] & 0xF) == 0) {
+                            bmap[i] >>= 4;
+                            ipv6.ip[1] += 4;
+                        }
+                        if ((bmap[i] & 0x3) == 0) {
+                            bmap[i] >>= 2;
+                            ipv6.ip[1] += 2;
+                        }
+                        if ((bmap[i] & 0x1) == 0) {
+                            bmap[i] >>= 1;
+                            ipv6.ip[1] += 1;
+                        }
+                    }
+                    /* find number of consecutive high bits that
+                     * map into a CIDR block */
+                    switch (ipv6.ip[1] & 0x1F) {
+                      case 0: case 16:
+                        if ((bmap[i] & 0xFFFF) == 0xFFFF) {
+                            rv = ipsetInsertAddressV6(ipset, &ipv6, 124, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 16;
+                            ipv6.ip[1] += 16;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      case 8: case 24:
+                        if ((bmap[i] & 0xFF) == 0xFF) {
+                            rv = ipsetInsertAddressV6(ipset, &ipv6, 125, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 8;
+                            ipv6.ip[1] += 8;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      case 4: case 12: case 20: case 28:
+                        if ((bmap[i] & 0xF) == 0xF) {
+                            rv = ipsetInsertAddressV6(ipset, &ipv6, 126, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 4;
+                            ipv6.ip[1] += 4;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      case  2: case  6: case 10: case 14:
+                      case 18: case 22: case 26: case 30:
+                        if ((bmap[i] & 0x3) == 0x3) {
+                            rv = ipsetInsertAddressV6(ipset, &ipv6, 127, NULL);
+                            if (rv) { goto END; }
+                            bmap[i] >>= 2;
+                            ipv6.ip[1] += 2;
+                            continue;
+                        }
+                        /* FALLTHROUGH */
+                      default:
+                        rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
+                        if (rv) { goto END; }
+                        bmap[i] >>= 1;
+                        ++ipv6.ip[1];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    if (b != 0) {
+        /* read error */
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+
+    skIPSetClean(ipset);
+
+    /* Success */
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
+}
+#endif  /* SK_ENABLE_IPV6 */
+
+
+/*
+ *  status = ipsetReadCidrbmap(&ipset, stream, hdr);
+ *
+ *    Helper function for skIPSetRead().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_CIDR_BMAP format from
+ *    'stream'.
+ *
+ *    This function reads the header then calls another helper
+ *    function depending on the data structure being used.
+ */
+static int
+ipsetReadCidrbmap(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    sk_header_entry_t *hentry;
+    int is_ipv6;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    assert(hdr);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
+                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
+    {
+        skAbort();
+    }
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
+    }
+
+    /* read and verify the header */
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        return SKIPSET_ERR_FILEHEADER;
+    }
+    /* most sizes are zero */
+    if (0 != skHentryIPSetGetChildPerNode(hentry)
+        || 0 != skHentryIPSetGetRootIndex(hentry)
+        || 0 != skHentryIPSetGetNodeCount(hentry)
+        || 0 != skHentryIPSetGetNodeSize(hentry)
+        || 0 != skHentryIPSetGetLeafCount(hentry))
+    {
+        return SKIPSET_ERR_FILEHEADER;
+    }
+    if (sizeof(uint32_t) == skHentryIPSetGetLeafSize(hentry)) {
+        is_ipv6 = 0;
+    } else if (IPSET_LEN_V6 == skHentryIPSetGetLeafSize(hentry)) {
+        is_ipv6 = 1;
+    } else {
+        /* Unrecognized record size */
+        return SKIPSET_ERR_FILEHEADER;
+    }
+
+    if (is_ipv6) {
+#if  !SK_ENABLE_IPV6
+        /* IPv6 IPSet not supported by this build of SiLK */
+        return SKIPSET_ERR_IPV6;
+#else
+        return ipsetReadCidrbmapIntoRadixV6(ipset_out, stream, hdr);
+#endif
+    }
+    if (IPSET_USE_IPTREE) {
+        /* Read IPv4-only file into the IPTree format */
+        return ipsetReadCidrbmapIntoIPTree(ipset_out, stream, hdr);
+    }
+    return ipsetReadCidrbmapIntoRadixV4(ipset_out, stream, hdr);
+}
+
+
+/*
+ *  status = ipsetReadLegacyIntoIPTree(&ipset, stream, hdr);
+ *
+ *    Helper function for skIPSetRead() via ipsetReadLegacy().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_LEGACY format from
+ *    'stream' and create a SiLK-2 IPTree data structure.
+ *
+ *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
+ *    file format.
+ */
+static int
+ipsetReadLegacyIntoIPTree(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    skipset_t *ipset = NULL;
+    int swap_flag;
+    uint32_t block24[1 + IPTREE_WORDS_PER_SLASH24];
+    uint32_t slash24;
+    uint32_t slash16;
+    ssize_t b;
+    int i;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    assert(hdr);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, 0,
+                                IPSET_REC_VERSION_LEGACY, NULL))
+    {
+        skAbort();
+    }
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
+    }
+
+    swap_flag = !skHeaderIsNativeByteOrder(hdr);
+
+    rv = ipsetCreate(&ipset, 0, 0);
+    if (rv != SKIPSET_OK) {
+        goto END;
+    }
+
+    while ((b = skStreamRead(stream, block24, sizeof(block24)))
+           == sizeof(block24))
+    {
+        if (swap_flag) {
+            for (i = 0; i < 1+IPTREE_WORDS_PER_SLASH24; ++i) {
+                block24[i] = BSWAP32(block24[i]);
+            }
+        }
+
+        /* Put the first two octets of the base IP into slash16, and
+         * allocate the space for the /16 if we need to */
+        slash16 = (block24[0] >> 16);
+        if (NULL == ipset->s.v2->nodes[slash16]) {
+            ipset->s.v2->nodes[slash16]
+                = (skIPNode_t*)calloc(1, sizeof(skIPNode_t));
+            if (NULL == ipset->s.v2->nodes[slash16]) {
+                rv = SKIPSET_ERR_ALLOC;
+                goto END;
+            }
+        }
+
+        /* Locate where this /24 occurs inside the larger /16, then
+         * copy it into place.  Following is equivalent to
+         * (((block24[0] >> 8) & 0xFF) * 8); */
+        slash24 = ((block24[0] & 0x0000FF00) >> 5);
+        memcpy((ipset->s.v2->nodes[slash16]->addressBlock + slash24),
+               block24 + 1, IPTREE_WORDS_PER_SLASH24 * sizeof(uint32_t));
+    }
+    if (b != 0) {
+        /* read error */
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
+}
+
+
+/*
+ *  status = ipsetReadLegacyIntoRadix(&ipset, stream, hdr);
+ *
+ *    Helper function for skIPSetRead() via ipsetReadLegacy().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_LEGACY format from
+ *    'stream' and create a radix-tree IPset data structure.
+ *
+ *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
+ *    file format.
+ */
+static int
+ipsetReadLegacyIntoRadix(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    skipset_t *ipset = NULL;
+    int swap_flag;
+    uint32_t contig_start = 0;
+    uint32_t contig_length = 0;
+    uint32_t block24[1+IPTREE_WORDS_PER_SLASH24];
+    uint32_t slash24;
+    uint32_t ipv4;
+    ssize_t b;
+    int i;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    assert(hdr);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, 0,
+                                IPSET_REC_VERSION_LEGACY, NULL))
+    {
+        skAbort();
+    }
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
+    }
+
+    swap_flag = !skHeaderIsNativeByteOrder(hdr);
+
+    rv = ipsetCreate(&ipset, 0, 1);
+    if (rv != SKIPSET_OK) {
+        goto END;
+    }
+
+    while ((b = skStreamRead(stream, block24, sizeof(block24)))
+           == sizeof(block24))
+    {
+        /* the /24 value is the first value in the array */
+        slash24 = (((swap_flag) ? BSWAP32(block24[0]) : block24[0])
+                   & 0xFFFFFF00);
+
+        /* handle case where the entire /24 is set */
+        if (0 == memcmp(&block24[1], bmap256_full, sizeof(bmap256_full))) {
+            if (contig_length) {
+                /* we have a previous /24 */
+                if ((contig_start + contig_length) == slash24) {
+                    /* add this block to the current block */
+                    contig_length += 256;
+                    continue;
+                }
+
+                /* there is a hole between these CIDR blocks. insert
+                 * the previous block of contiguous IPs to the IPset */
+                rv = ipsetInsertRangeV4(ipset, contig_start, contig_length);
+                if (rv) {
+                    goto END;
+                }
+            }
+            /* start a new run of contiguous IPs */
+            contig_start = slash24;
+            contig_length = 256;
+            continue;
+        }
+
+        if (contig_length) {
+            /* we have a previous /24, but the block we just read
+             * contains holes and cannot be added to it; handle this
+             * existing CIDR block first */
+            rv = ipsetInsertRangeV4(ipset, contig_start, contig_length);
+            if (rv) {
+                goto END;
+            }
+            contig_length = 0;
+        }
 
-    /* visit the nodes in the tree */
-    depth = 0;
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+        /* loop over the uint32_t in this block */
+        i = 1;
+        while (i < 9) {
+            if (0 == block24[i]) {
+                ++i;
+                continue;
+            }
 
-    while (depth) {
-        node_idx = to_visit[--depth];
-        node = NODE_PTR_V6(ipset, node_idx);
+            ipv4 = slash24 | ((i - 1) << 5);
 
-        if (mask_prefix - node->prefix > NUM_BITS) {
-            /* this node is not at the bottom level of the tree; add
-             * child nodes of this node to the 'to_visit' list. modify
-             * any leaves to hold a single block. */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if ((0 == node->child[i])
-                    || NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    /* no-op */
-                } else if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                    /* node; add to vist list unless its prefix is
-                     * larger than or equal to the mask, in which case
-                     * replace with a leaf */
-                    if (NODE_PTR_V6(ipset, node->child[i])->prefix
-                        < mask_prefix)
+            if (0xFFFFFFFF == block24[i]) {
+                /* Check for a longer run of high bits by checking the
+                 * value in adjacent uint32_t's. */
+                switch (i) {
+                  case 1: case 5:
+                    /* check 3 addtional uint32_t's to attempt to
+                     * make a /25 */
+                    if (memcmp(&block24[i+1], bmap256_full, sizeof(uint32_t)*3)
+                        == 0)
                     {
-                        to_visit[depth++] = node->child[i];
-                    } else {
-                        IPSET_IPV6_COPY(&ipv6,
-                                        &NODE_PTR_V6(ipset,node->child[i])->ip);
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                        IPSET_IPV6_COPY_AND_MASK(&leaf->ip, &ipv6, mask_prefix);
-                        leaf->prefix = mask_prefix;
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 25, NULL);
+                        i += 4;
+                        break;
                     }
-                } else {
-                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                    if (leaf->prefix > mask_prefix) {
-                        IPSET_IPV6_APPLY_CIDR(&leaf->ip, mask_prefix);
-                        leaf->prefix = mask_prefix;
+                    /* FALLTHROUGH */
+
+                  case 3: case 7:
+                    /* check one additional uint32_t to attempt to
+                     * make a /26 */
+                    if (block24[i+1] == 0xFFFFFFFF) {
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 26, NULL);
+                        i += 2;
+                        break;
                     }
+                    /* FALLTHROUGH */
+
+                  default:
+                    /* we only have a /27 */
+                    rv = ipsetInsertAddressV4(ipset, ipv4, 27, NULL);
+                    ++i;
+                    break;
                 }
+                if (rv) {
+                    goto END;
+                }
+                continue;
             }
 
-        } else if (mask_prefix - node->prefix == NUM_BITS) {
-            /* this node is on the bottom level of the tree, and every
-             * occupied child[] will become an independent leaf */
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]
-                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                        ipsetReplaceNodeWithLeaf(ipset,(ipset_node_t*)node,i);
-                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                    } else {
-                        leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                        if (leaf->prefix <= mask_prefix) {
-                            continue;
-                        }
+            if (swap_flag) {
+                block24[i] = BSWAP32(block24[i]);
+            }
+            while (block24[i]) {
+                assert((ipv4 - (slash24 | ((i - 1) << 5))) < 32);
+                /* find position of least significant bit */
+                if (!(block24[i] & 0x1)) {
+                    if ((block24[i] & 0xFFFF) == 0) {
+                        block24[i] >>= 16;
+                        ipv4 += 16;
                     }
-                    leaf->prefix = mask_prefix;
-                    if (node->prefix <= 64 - NUM_BITS) {
-                        leaf->ip.ip[0] = ((node->ip.ip[0]
-                                           | (((uint64_t)i)
-                                              << (64-NUM_BITS- node->prefix)))
-                                          & ((mask_prefix < 64)
-                                             ? ~(UINT64_MAX >> mask_prefix)
-                                             : UINT64_MAX));
-                        leaf->ip.ip[1] = 0;
-                    } else {
-                        leaf->ip.ip[0] = node->ip.ip[0];
-                        leaf->ip.ip[1] = ((node->ip.ip[1]
-                                           | (((uint64_t)i)
-                                              << (128-NUM_BITS- node->prefix)))
-                                          & ~(UINT64_MAX >> (mask_prefix-64)));
+                    if ((block24[i] & 0xFF) == 0) {
+                        block24[i] >>= 8;
+                        ipv4 += 8;
+                    }
+                    if ((block24[i] & 0xF) == 0) {
+                        block24[i] >>= 4;
+                        ipv4 += 4;
+                    }
+                    if ((block24[i] & 0x3) == 0) {
+                        block24[i] >>= 2;
+                        ipv4 += 2;
+                    }
+                    if ((block24[i] & 0x1) == 0) {
+                        block24[i] >>= 1;
+                        ipv4 += 1;
                     }
                 }
-            }
 
-        } else {
-            /* this node is on the bottom level of the tree. multiple
-             * child[] entries will become a single leaf */
-            children_per_leaf = 1u << (NUM_BITS- (mask_prefix - node->prefix));
-            child_idx = UINT32_MAX;
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                for (j = 0; j < children_per_leaf; ++j) {
-                    --i;
-                    if (node->child[i]) {
-                        if (!NODEPTR_CHILD_IS_LEAF(node, i)) {
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                            ipsetDestroySubtree(ipset, node->child[i], 1);
-                        } else if (NODEPTR_CHILD_IS_REPEAT(node, i)) {
-                            leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                            if (leaf->prefix <= mask_prefix) {
-                                assert(0 == j);
-                                i -= children_per_leaf - 1;
-                                break;
-                            }
-                            if (UINT32_MAX == child_idx) {
-                                child_idx = IPSET_NUM_CHILDREN;
-                            }
-                        } else if (child_idx >= IPSET_NUM_CHILDREN) {
-                            child_idx = i;
-                        } else {
-                            LEAFIDX_FREE(ipset, node->child[child_idx]);
-                            NODEPTR_CHILD_CLEAR_LEAF(node, child_idx);
-                            child_idx = i;
-                        }
+                /* find number of consecutive high bits that map into
+                 * a CIDR block */
+                switch (ipv4 & 0x1F) {
+                  case 0: case 16:
+                    /* we can consider at least 16 bits in this
+                     * uint32_t---no need to check for 32 bits since
+                     * we would have caught that above */
+                    if ((block24[i] & 0xFFFF) == 0xFFFF) {
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 28, NULL);
+                        block24[i] >>= 16;
+                        ipv4 += 16;
+                        break;
                     }
-                }
+                    /* FALLTHROUGH */
 
-                /* the if() is entered when 'i' is looking at the
-                 * start of a group of child[] entries and any of the
-                 * child[] entries for this group of entries was
-                 * occupied. */
-                if (child_idx != UINT32_MAX) {
-                    if (IPSET_NUM_CHILDREN == child_idx) {
-                        if (ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx)){
-                            return SKIPSET_ERR_ALLOC;
-                        }
-                        node->child[i] = new_leaf_idx;
-                    } else if (child_idx != i) {
-                        node->child[i] = node->child[child_idx];
+                  case 8: case 24:
+                    /* we can consider at least 8 bits in this uint32_t */
+                    if ((block24[i] & 0xFF) == 0xFF) {
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 29, NULL);
+                        block24[i] >>= 8;
+                        ipv4 += 8;
+                        break;
                     }
-                    leaf = LEAF_PTR_V6(ipset, node->child[i]);
-                    leaf->prefix = mask_prefix;
-                    if (node->prefix <= 64 - NUM_BITS) {
-                        leaf->ip.ip[0] = ((node->ip.ip[0]
-                                           | (((uint64_t)i)
-                                              << (64-NUM_BITS- node->prefix)))
-                                          & ((mask_prefix < 64)
-                                             ? ~(UINT64_MAX >> mask_prefix)
-                                             : UINT64_MAX));
-                        leaf->ip.ip[1] = 0;
-                    } else {
-                        leaf->ip.ip[0] = node->ip.ip[0];
-                        leaf->ip.ip[1] = ((node->ip.ip[1]
-                                           | (((uint64_t)i)
-                                              << (128-NUM_BITS- node->prefix)))
-                                          & ~(UINT64_MAX >> (mask_prefix-64)));
+                    /* FALLTHROUGH */
+
+                  case 4: case 12: case 20: case 28:
+                    if ((block24[i] & 0xF) == 0xF) {
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 30, NULL);
+                        block24[i] >>= 4;
+                        ipv4 += 4;
+                        break;
                     }
-                    NODEPTR_CHILD_SET_LEAF2(node, i,
-                                            i + children_per_leaf - 1);
-                    NODEPTR_CHILD_SET_REPEAT2(node, i+1,
-                                              i + children_per_leaf - 1);
-                    for (j = 1; j < children_per_leaf; ++j) {
-                        node->child[i + j] = node->child[i];
+                    /* FALLTHROUGH */
+
+                  case  2: case  6: case 10: case 14:
+                  case 18: case 22: case 26: case 30:
+                    if ((block24[i] & 0x3) == 0x3) {
+                        rv = ipsetInsertAddressV4(ipset, ipv4, 31, NULL);
+                        block24[i] >>= 2;
+                        ipv4 += 2;
+                        break;
                     }
+                    /* FALLTHROUGH */
+
+                  default:
+                    rv = ipsetInsertAddressV4(ipset, ipv4, 32, NULL);
+                    block24[i] >>= 1;
+                    ++ipv4;
+                    break;
+                }
+                if (rv) {
+                    goto END;
+                }
+            }
+        }
+    }
+
+    if (b == -1) {
+        /* read error */
+        rv = -1;
+        goto END;
+    }
 
-                    child_idx = UINT32_MAX;
-                }
-            }
+    /* close final block */
+    if (contig_length) {
+        rv = ipsetInsertRangeV4(ipset, contig_start, contig_length);
+        if (rv) {
+            goto END;
         }
     }
 
-    return SKIPSET_OK;
+    /* ipset should already be clean since we went to all the effort
+     * to add the largest possible blocks */
+    skIPSetClean(ipset);
+
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetNewEntries(ipset, num_nodes, num_leaves, node_indexes, leaf_indexes);
+ *  status = ipsetReadLegacy(&ipset, stream, hdr);
  *
- *    Determine where 'num_nodes' new nodes and 'num_leaves' new
- *    leaves can be stored and return the index(es) to that/those
- *    location(s) in the arrays specified by the 'node_indexes' and
- *    'leaf_indexes' parameters.  The new nodes and leaves will be
- *    zeroed before returning.
+ *    Helper function for skIPSetRead().
  *
- *    When a size value is 0, its corresponding array may be NULL.
+ *    Read an IPset in the IPSET_REC_VERSION_LEGACY format from
+ *    'stream'.
  *
- *    If a value is 0, its array will not be modified, so any pointers
- *    into that array remain valid.  Specifically, if you have a
- *    handle to a node and request new leaves, the handle to the node
- *    remains valid.
+ *    This function reads the header then calls another helper
+ *    function depending on the data structure being used.
+ */
+static int
+ipsetReadLegacy(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    if (IPSET_USE_IPTREE) {
+        return ipsetReadLegacyIntoIPTree(ipset_out, stream, hdr);
+    }
+    return ipsetReadLegacyIntoRadix(ipset_out, stream, hdr);
+}
+
+
+/*
+ *  status = ipsetReadRadixIntoIPTree(&ipset, stream, hdr);
  *
- *    Uses space at the end of the currently allocated arrays first,
- *    then returns entries from the free list.  Finally, calls
- *    ipsetAllocEntries() if no nodes or leaves are available.  Return
- *    0 on success, or SKIPSET_ERR_ALLOC on failure.
+ *    Helper function for skIPSetRead() via ipsetReadRadix().
  *
- *    If the leaves buffer is reallocated, this function sets the
- *    'realloc_leaves' bit on the 'ipset'.
+ *    Read an IPset in the IPSET_REC_VERSION_RADIX format containing
+ *    only IPv4 addresses from 'stream' and create a SiLK-2 IPTree
+ *    data structure.
+ *
+ *    See '#define IPSET_REC_VERSION_RADIX' for description of the
+ *    file format.
  */
 static int
-ipsetNewEntries(
-    skipset_t          *ipset,
-    uint32_t            num_nodes,
-    uint32_t            num_leaves,
-    uint32_t           *node_indexes,
-    uint32_t           *leaf_indexes)
-#ifndef IPSET_DEBUG_MEMORY
+ipsetReadRadixIntoIPTree(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
 {
-    /* this is the normal function defintion of ipsetNewEntries() */
-
-    assert(ipset);
-    assert(ipset->s.v3->nodes.entry_capacity >= ipset->s.v3->nodes.entry_count);
-    assert(ipset->s.v3->leaves.entry_capacity
-           >= ipset->s.v3->leaves.entry_count);
+    skipset_t *ipset = NULL;
+    sk_header_entry_t *hentry;
+    ipset_leaf_v4_t leaf;
+    ssize_t bytes;
+    ssize_t b;
+    size_t count = 0;
+    int rv;
 
-    if (num_leaves <= (ipset->s.v3->leaves.entry_capacity
-                       - ipset->s.v3->leaves.entry_count))
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_RADIX,
+                                IPSET_REC_VERSION_RADIX, NULL))
     {
-        /* grab leaves from end of the "fresh" memory */
-        while (num_leaves) {
-            *leaf_indexes = ipset->s.v3->leaves.entry_count;
-            ++ipset->s.v3->leaves.entry_count;
-            ++leaf_indexes;
-            --num_leaves;
-        }
-        if (num_nodes) {
-            goto ALLOC_NODES;
-        }
-        return SKIPSET_OK;
+        skAbort();
     }
-    while (num_leaves && (ipset->s.v3->leaves.entry_count
-                          < ipset->s.v3->leaves.entry_capacity))
-    {
-        /* grab as many leaves from end of the "fresh" memory as we can */
-        *leaf_indexes = ipset->s.v3->leaves.entry_count;
-        ++ipset->s.v3->leaves.entry_count;
-        ++leaf_indexes;
-        --num_leaves;
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
     }
-    while (num_leaves && ipset->s.v3->leaves.free_list) {
-        /* grab as many leaves from the free list as we can */
-        ipset_leaf_t *leaf;
-        *leaf_indexes = ipset->s.v3->leaves.free_list;
-        leaf = LEAF_PTR(ipset, *leaf_indexes);
-        ipset->s.v3->leaves.free_list = LEAFPTR_FREE_LIST(leaf);
-        memset(leaf, 0, ipset->s.v3->leaves.entry_size);
-        ++leaf_indexes;
-        --num_leaves;
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        skAbort();
     }
-    if (num_leaves) {
-        /* allocate new memory and use it; set the flag to denote that
-         * new leaves have been allocated. */
-        if (ipset->s.v3->leaves.entry_capacity > 0) {
-            ipset->s.v3->realloc_leaves = 1;
-        }
-        do {
-            if (ipsetAllocEntries(&ipset->s.v3->leaves, 0)) {
-                return SKIPSET_ERR_ALLOC;
+    if (sizeof(ipset_leaf_v4_t) != skHentryIPSetGetLeafSize(hentry)) {
+        skAbort();
+    }
+
+    /* create the set */
+    rv = ipsetCreate(&ipset, 0, 0);
+    if (rv != SKIPSET_OK) {
+        goto END;
+    }
+
+    /* skip over the nodes since we only need the IPs in the leaves */
+    bytes = (skHentryIPSetGetNodeCount(hentry)
+             * skHentryIPSetGetNodeSize(hentry));
+    b = skStreamRead(stream, NULL, bytes);
+    if (b != bytes) {
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+
+    /* skip the first leaf, which contains no data */
+    bytes = skHentryIPSetGetLeafSize(hentry);
+    b = skStreamRead(stream, &leaf, bytes);
+    if (b != bytes) {
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+    ++count;
+
+    if (!skHeaderIsNativeByteOrder(hdr)) {
+        /* if the data is not in native byte order, we need to
+         * byte-swap the values */
+        while ((b = skStreamRead(stream, &leaf, bytes)) == bytes) {
+            ++count;
+            rv = ipsetInsertAddressIPTree(ipset, BSWAP32(leaf.ip),leaf.prefix);
+            if (rv) {
+                goto END;
             }
-            while (num_leaves && (ipset->s.v3->leaves.entry_count
-                                  < ipset->s.v3->leaves.entry_capacity))
-            {
-                *leaf_indexes = ipset->s.v3->leaves.entry_count;
-                ++ipset->s.v3->leaves.entry_count;
-                ++leaf_indexes;
-                --num_leaves;
+        }
+    } else {
+        while ((b = skStreamRead(stream, &leaf, bytes)) == bytes) {
+            ++count;
+            rv = ipsetInsertAddressIPTree(ipset, leaf.ip, leaf.prefix);
+            if (rv) {
+                goto END;
             }
-        } while (num_leaves);
+        }
     }
 
-  ALLOC_NODES:
-    if (num_nodes
-        <= (ipset->s.v3->nodes.entry_capacity - ipset->s.v3->nodes.entry_count))
+    if (0 != b) {
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
+    }
+    assert(skHentryIPSetGetLeafCount(hentry) == count);
+
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
+}
+
+
+/*
+ *  ok = ipsetRadixIsMappable(stream, hdr);
+ *
+ *    Helper function for ipsetReadRadix() and
+ *    ipsetReadRadixIntoRadix().
+ *
+ *    Return 1 if the IPSET_REC_VERSION_RADIX data that follows the
+ *    header 'hdr' in 'stream' may be mmap()ed and used in place; that
+ *    is, if 'stream' is a seekable file that is not gzipped and whose
+ *    data is uncompressed, in native byte order, and starts on an
+ *    IPSET_RADIX_DATA_ALIGN boundary.  Return 0 otherwise.
+ */
+static int
+ipsetRadixIsMappable(
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
+{
+    off_t data_start;
+
+    if (!skStreamIsSeekable(stream)
+        || skStreamIsGzipped(stream)
+        || !skHeaderIsNativeByteOrder(hdr)
+        || (SK_COMPMETHOD_NONE != skHeaderGetCompressionMethod(hdr)))
+    {
+        return 0;
+    }
+    data_start = skStreamTell(stream);
+    return ((data_start > 0) && (0 == data_start % IPSET_RADIX_DATA_ALIGN));
+}
+
+
+/*
+ *  status = ipsetReadRadixIntoRadix(&ipset, stream, hdr, is_ipv6);
+ *
+ *    Helper function for skIPSetRead() via ipsetReadRadix().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_RADIX format from
+ *    'stream' and create a radix-tree IPset data structure.
+ *
+ *    See '#define IPSET_REC_VERSION_RADIX' for description of the
+ *    file format.
+ */
+static int
+ipsetReadRadixIntoRadix(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr,
+    int                 is_ipv6)
+{
+    skipset_t *ipset = NULL;
+    sk_header_entry_t *hentry;
+    ssize_t bytes;
+    ssize_t b;
+    size_t i;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset_out);
+    assert(stream);
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_RADIX,
+                                IPSET_REC_VERSION_RADIX, NULL))
     {
-        /* grab nodes from end of the "fresh" memory */
-        while (num_nodes) {
-            *node_indexes = ipset->s.v3->nodes.entry_count;
-            ++ipset->s.v3->nodes.entry_count;
-            ++node_indexes;
-            --num_nodes;
-        }
-        return SKIPSET_OK;
+        skAbort();
     }
-    while (num_nodes && (ipset->s.v3->nodes.entry_count
-                         < ipset->s.v3->nodes.entry_capacity))
-    {
-        /* grab as many nodes from end of the "fresh" memory as we can */
-        *node_indexes = ipset->s.v3->nodes.entry_count;
-        ++ipset->s.v3->nodes.entry_count;
-        ++node_indexes;
-        --num_nodes;
+    if (skHeaderGetRecordLength(hdr) != 1) {
+        skAbort();
     }
-    while (num_nodes && ipset->s.v3->nodes.free_list) {
-        /* grab as many nodes from the free list as we can */
-        ipset_node_t *node;
-        *node_indexes = ipset->s.v3->nodes.free_list;
-        node = NODE_PTR(ipset, *node_indexes);
-        ipset->s.v3->nodes.free_list = NODEPTR_FREE_LIST(node);
-        memset(node, 0, ipset->s.v3->nodes.entry_size);
-        ++node_indexes;
-        --num_nodes;
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        skAbort();
     }
-    while (num_nodes) {
-        /* allocate new memory and use it */
-        if (ipsetAllocEntries(&ipset->s.v3->nodes, 0)) {
-            return SKIPSET_ERR_ALLOC;
-        }
-        while (num_nodes && (ipset->s.v3->nodes.entry_count
-                             < ipset->s.v3->nodes.entry_capacity))
-        {
-            *node_indexes = ipset->s.v3->nodes.entry_count;
-            ++ipset->s.v3->nodes.entry_count;
-            ++node_indexes;
-            --num_nodes;
-        }
+
+    /* create the set */
+    rv = ipsetCreate(&ipset, is_ipv6, 1);
+    if (rv != SKIPSET_OK) {
+        goto END;
     }
 
-    return SKIPSET_OK;
-}
-#else  /* #ifndef IPSET_DEBUG_MEMORY */
-{
-    /*
-     *  This is a debugging defintion of ipsetNewEntries().
-     *
-     *  This definition uses the free list first, so we properly
-     *  handle cases where a call to ipsetNewEntries() follows a call
-     *  to ipsetDestroySubtree().  (The calling code does not expect
-     *  the ipsetNewEntries() call to fail in this case.)
-     *
-     *  If additional nodes and/or leaves are required, the function
-     *  moves the location of the nodes and/or leaves array(s).  The
-     *  objective is to find places the in code that are holding a
-     *  stale pointer---that is, places that do not properly handle
-     *  the case where a realloc may occur.
-     *
-     *  In addition, the function allocates only as many nodes/leaves
-     *  as are requested, so writing beyond the array can be detected
-     *  by memory checkers.
-     */
+    /* if no nodes or only node#0, root is a leaf */
+    IPSET_ROOT_INDEX_SET(ipset, skHentryIPSetGetRootIndex(hentry),
+                         (skHentryIPSetGetNodeCount(hentry) <= 1));
 
-    void *new_mem;
-    uint32_t new_size;
+    if (ipsetRadixIsMappable(stream, hdr)) {
+        /* attempt to mmap() the file */
 
-    assert(ipset);
-    assert(ipset->s.v3->nodes.entry_capacity >= ipset->s.v3->nodes.entry_count);
-    assert(ipset->s.v3->leaves.entry_capacity
-           >= ipset->s.v3->leaves.entry_count);
+        /* get file size and offset where the data begins */
+        off_t file_size = skFileSize(skStreamGetPathname(stream));
+        off_t data_start = skStreamTell(stream);
+        size_t node_bytes;
+        size_t leaf_bytes;
+        uint8_t *buf;
 
-    if (num_leaves) {
-        while (num_leaves && ipset->s.v3->leaves.free_list) {
-            ipset_leaf_t *leaf;
-            *leaf_indexes = ipset->s.v3->leaves.free_list;
-            leaf = LEAF_PTR(ipset, *leaf_indexes);
-            ipset->s.v3->leaves.free_list = LEAFPTR_FREE_LIST(leaf);
-            memset(leaf, 0, ipset->s.v3->leaves.entry_size);
-            ++leaf_indexes;
-            --num_leaves;
+        node_bytes = ((size_t)skHentryIPSetGetNodeCount(hentry)
+                      * ipset->s.v3->nodes.entry_size);
+        leaf_bytes = ((size_t)skHentryIPSetGetLeafCount(hentry)
+                      * ipset->s.v3->leaves.entry_size);
+
+        if ((0 < data_start) && (data_start < file_size)
+            && ((size_t)(file_size - data_start) >= node_bytes + leaf_bytes)
+            && (UINT32_MAX > file_size))
+        {
+            ipset->s.v3->mapped_size = (size_t)file_size;
+            ipset->s.v3->mapped_file = mmap(0, ipset->s.v3->mapped_size,
+                                            PROT_READ, MAP_SHARED,
+                                            skStreamGetDescriptor(stream), 0);
+            if (MAP_FAILED == ipset->s.v3->mapped_file) {
+                ipset->s.v3->mapped_file = NULL;
+                ipset->s.v3->mapped_size = 0;
+            } else {
+                /* move to start of data section (the nodes) */
+                buf = (uint8_t*)ipset->s.v3->mapped_file + data_start;
+                ipset->s.v3->nodes.buf = buf;
+                ipset->s.v3->nodes.entry_count
+                    = skHentryIPSetGetNodeCount(hentry);
+                ipset->s.v3->nodes.entry_capacity
+                    = ipset->s.v3->nodes.entry_count;
+
+                /* move over the nodes (to the leaves)  */
+                buf += node_bytes;
+                ipset->s.v3->leaves.buf = buf;
+                ipset->s.v3->leaves.entry_count
+                    = skHentryIPSetGetLeafCount(hentry);
+                ipset->s.v3->leaves.entry_capacity
+                    = ipset->s.v3->leaves.entry_count;
+            }
         }
-        if (num_leaves) {
-            if (ipset->s.v3->leaves.entry_capacity
-                && ((ipset->s.v3->leaves.entry_capacity + num_leaves)
-                    % IPSET_INITIAL_ENTRY_COUNT) < num_leaves)
-            {
-                ipset->s.v3->realloc_leaves = 1;
+    }
+
+    if (NULL == ipset->s.v3->mapped_file) {
+        /* Allocate and read the nodes */
+        rv = ipsetAllocEntries(&ipset->s.v3->nodes,
+                               skHentryIPSetGetNodeCount(hentry));
+        if (rv) {
+            goto END;
+        }
+
+        bytes = (skHentryIPSetGetNodeCount(hentry)
+                 * ipset->s.v3->nodes.entry_size);
+        b = skStreamRead(stream, ipset->s.v3->nodes.buf, bytes);
+        if (b != bytes) {
+            if (b > 0) {
+                /* short read */
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
             }
-            new_size = ipset->s.v3->leaves.entry_capacity + num_leaves;
-            new_mem = malloc(new_size * ipset->s.v3->leaves.entry_size);
-            if (!new_mem) {
-                return SKIPSET_ERR_ALLOC;
+            if (b == -1) {
+                /* read error */
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
             }
-            if (ipset->s.v3->leaves.buf) {
-                memcpy(new_mem, ipset->s.v3->leaves.buf,
-                       (ipset->s.v3->leaves.entry_count
-                        * ipset->s.v3->leaves.entry_size));
-                free(ipset->s.v3->leaves.buf);
+        }
+        ipset->s.v3->nodes.entry_count = skHentryIPSetGetNodeCount(hentry);
+
+        /* now, if the data is not in native byte order, we need to
+         * byte-swap the values */
+        if (!skHeaderIsNativeByteOrder(hdr)) {
+#if SK_ENABLE_IPV6
+            if (ipset->is_ipv6) {
+                ipset_node_v6_t *node;
+                for (i = 0, node = (ipset_node_v6_t*)ipset->s.v3->nodes.buf;
+                     i < ipset->s.v3->nodes.entry_count;
+                     ++i, ++node)
+                {
+                    node->child[0] = BSWAP32(node->child[0]);
+                    node->child[1] = BSWAP32(node->child[1]);
+                    node->ip.ip[0] = BSWAP64(node->ip.ip[0]);
+                    node->ip.ip[1] = BSWAP64(node->ip.ip[1]);
+                }
+            } else
+#endif  /* SK_ENABLE_IPV6 */
+            {
+                ipset_node_v4_t *node;
+                for (i = 0, node = (ipset_node_v4_t*)ipset->s.v3->nodes.buf;
+                     i < ipset->s.v3->nodes.entry_count;
+                     ++i, ++node)
+                {
+                    node->child[0] = BSWAP32(node->child[0]);
+                    node->child[1] = BSWAP32(node->child[1]);
+                    node->ip = BSWAP32(node->ip);
+                }
             }
-            ipset->s.v3->leaves.buf = new_mem;
-            ipset->s.v3->leaves.entry_capacity = new_size;
-            do {
-                *leaf_indexes = ipset->s.v3->leaves.entry_count;
-                memset(LEAF_PTR(ipset, *leaf_indexes), 0,
-                       ipset->s.v3->leaves.entry_size);
-                ++ipset->s.v3->leaves.entry_count;
-                ++leaf_indexes;
-                --num_leaves;
-                assert(ipset->s.v3->leaves.entry_capacity
-                       >= ipset->s.v3->leaves.entry_count);
-            } while (num_leaves);
         }
-    }
 
-    if (num_nodes) {
-        while (num_nodes && ipset->s.v3->nodes.free_list) {
-            ipset_node_t *node;
-            *node_indexes = ipset->s.v3->nodes.free_list;
-            node = NODE_PTR(ipset, *node_indexes);
-            ipset->s.v3->nodes.free_list = NODEPTR_FREE_LIST(node);
-            memset(node, 0, ipset->s.v3->nodes.entry_size);
-            ++node_indexes;
-            --num_nodes;
+        /* Allocate and read the leaves */
+        rv = ipsetAllocEntries(&ipset->s.v3->leaves,
+                               skHentryIPSetGetLeafCount(hentry));
+        if (rv) {
+            goto END;
         }
-        if (num_nodes) {
-            new_size = ipset->s.v3->nodes.entry_capacity + num_nodes;
-            new_mem = malloc(new_size * ipset->s.v3->nodes.entry_size);
-            if (!new_mem) {
-                return SKIPSET_ERR_ALLOC;
+
+        bytes = (skHentryIPSetGetLeafCount(hentry)
+                 * ipset->s.v3->leaves.entry_size);
+        b = skStreamRead(stream, ipset->s.v3->leaves.buf, bytes);
+        if (b != bytes) {
+            if (b > 0) {
+                /* short read */
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
             }
-            if (ipset->s.v3->nodes.buf) {
-                memcpy(new_mem, ipset->s.v3->nodes.buf,
-                       (ipset->s.v3->nodes.entry_count
-                        * ipset->s.v3->nodes.entry_size));
-                free(ipset->s.v3->nodes.buf);
+            if (b == -1) {
+                /* read error */
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
+            }
+        }
+        ipset->s.v3->leaves.entry_count = skHentryIPSetGetLeafCount(hentry);
+
+        /* now, if the data is not in native byte order, we need to
+         * byte-swap the values */
+        if (!skHeaderIsNativeByteOrder(hdr)) {
+#if SK_ENABLE_IPV6
+            if (ipset->is_ipv6) {
+                ipset_leaf_v6_t *leaf;
+                for (i = 0, leaf = (ipset_leaf_v6_t*)ipset->s.v3->leaves.buf;
+                     i < ipset->s.v3->leaves.entry_count;
+                     ++i, ++leaf)
+                {
+                    leaf->ip.ip[0] = BSWAP64(leaf->ip.ip[0]);
+                    leaf->ip.ip[1] = BSWAP64(leaf->ip.ip[1]);
+                }
+            } else
+#endif  /* SK_ENABLE_IPV6 */
+            {
+                ipset_leaf_v4_t *leaf;
+                for (i = 0, leaf = (ipset_leaf_v4_t*)ipset->s.v3->leaves.buf;
+                     i < ipset->s.v3->leaves.entry_count;
+                     ++i, ++leaf)
+                {
+                    leaf->ip = BSWAP32(leaf->ip);
+                }
             }
-            ipset->s.v3->nodes.buf = new_mem;
-            ipset->s.v3->nodes.entry_capacity = new_size;
-            do {
-                *node_indexes = ipset->s.v3->nodes.entry_count;
-                memset(NODE_PTR(ipset, *node_indexes), 0,
-                       ipset->s.v3->nodes.entry_size);
-                ++ipset->s.v3->nodes.entry_count;
-                ++node_indexes;
-                --num_nodes;
-                assert(ipset->s.v3->nodes.entry_capacity
-                       >= ipset->s.v3->nodes.entry_count);
-            } while (num_nodes);
         }
     }
 
-    return SKIPSET_OK;
+    /* check that the file is valid */
+    rv = ipsetVerify(ipset);
+    if (rv) {
+        goto END;
+    }
+
+    *ipset_out = ipset;
+    rv = SKIPSET_OK;
+
+  END:
+    if (rv != SKIPSET_OK) {
+        skIPSetDestroy(&ipset);
+    }
+    return rv;
 }
-#endif  /* #else of #ifndef IPSET_DEBUG_MEMORY */
 
 
 /*
- *  status = ipsetOptionsHandler(cData, opt_index, opt_arg);
+ *  status = ipsetReadRadix(&ipset, stream, hdr);
  *
- *    Parse an option that was registered by skIPSetOptionsRegister().
- *    Return 0 on success, or non-zero on failure.
+ *    Helper function for skIPSetRead().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_RADIX format from
+ *    'stream'.
+ *
+ *    This function reads the header then calls another helper
+ *    function depending on the data structure being used.
  */
 static int
-ipsetOptionsHandler(
-    clientData          cData,
-    int                 opt_index,
-    char               *opt_arg)
+ipsetReadRadix(
+    skipset_t         **ipset_out,
+    skstream_t         *stream,
+    sk_file_header_t   *hdr)
 {
-    skipset_options_t *ipset_opts = (skipset_options_t*)cData;
-    uint32_t tmp32;
-    int rv;
+    sk_header_entry_t *hentry;
+    int is_ipv6;
 
-    switch (opt_index) {
-      case OPT_IPSET_RECORD_VERSION:
-        rv = skStringParseUint32(&tmp32, opt_arg, IPSET_REC_VERSION_DEFAULT,
-                                 IPSET_REC_VERSION_MAX);
-        if (rv) {
-            goto PARSE_ERROR;
-        }
-        if (1 == tmp32) {
-            skAppPrintErr("Invalid %s '%s': Illegal version number",
-                          ipset_options[opt_index].name, opt_arg);
-            return -1;
-        }
-        ipset_opts->record_version = (uint16_t)tmp32;
-        break;
+    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
+    if (NULL == hentry) {
+        return SKIPSET_ERR_FILEHEADER;
+    }
 
-      case OPT_IPSET_INVOCATION_STRIP:
-        ipset_opts->invocation_strip = 1;
-        break;
+    /* Verify that children/node is what we expect */
+    if (IPSET_NUM_CHILDREN != skHentryIPSetGetChildPerNode(hentry)) {
+        return SKIPSET_ERR_FILEHEADER;
+    }
 
-      default:
-        skAbortBadCase(opt_index);
+    /* See if leaf and node sizes are for IPv4 or IPv6.  We must check
+     * IPv4 first, since IPv4 and IPv6 sizes are identical when SiLK
+     * is built without IPv6 support */
+    if (sizeof(ipset_leaf_v4_t) == skHentryIPSetGetLeafSize(hentry)
+        && sizeof(ipset_node_v4_t) == skHentryIPSetGetNodeSize(hentry))
+    {
+        is_ipv6 = 0;
+    }
+    else if (sizeof(ipset_leaf_v6_t) == skHentryIPSetGetLeafSize(hentry)
+             && sizeof(ipset_node_v6_t) == skHentryIPSetGetNodeSize(hentry))
+    {
+        is_ipv6 = 1;
+#if  !SK_ENABLE_IPV6
+        /* IPv6 IPSet not supported by this build of SiLK */
+        return SKIPSET_ERR_IPV6;
+#endif
+    } else {
+        /* Unrecognized record sizes */
+        return SKIPSET_ERR_FILEHEADER;
     }
 
-    return 0;
+    /* check for an empty IPset */
+    if (0 == skHentryIPSetGetNodeCount(hentry)
+        && 0 == skHentryIPSetGetLeafCount(hentry))
+    {
+        if (!is_ipv6 && IPSET_USE_IPTREE) {
+            return ipsetCreate(ipset_out, 0, 0);
+        }
+        return ipsetCreate(ipset_out, is_ipv6, 1);
+    }
 
-  PARSE_ERROR:
-    skAppPrintErr("Invalid %s '%s': %s",
-                  ipset_options[opt_index].name, opt_arg,
-                  skStringParseStrerror(rv));
-    return -1;
+    if (!is_ipv6 && IPSET_USE_IPTREE && !ipsetRadixIsMappable(stream, hdr)) {
+        /* Read IPv4-only file into the IPTree format.  A file that
+         * can be mmap()ed is used in place as a Radix-Tree instead,
+         * so that it does not need to be read into memory. */
+        return ipsetReadRadixIntoIPTree(ipset_out, stream, hdr);
+    }
+    return ipsetReadRadixIntoRadix(ipset_out, stream, hdr, is_ipv6);
 }
 
 
 /*
- *  status = ipsetPrintCallback(ip, prefix, &print_state);
+ *  status = ipsetReadSlash16Container(stream, swap_flag, cont_hdr, bmap, buf);
  *
- *    Helper function for skIPSetPrint().
+ *    Helper function for ipsetReadSlash16IntoIPTree() and
+ *    ipsetReadSlash16IntoRadixV4().
  *
- *    Print a textual representation of the 'ip' and 'prefix'.  The
- *    stream to print to and the format to use are present in the
- *    'print_state' argument.
+ *    Read the body of the container whose two-word header is
+ *    'cont_hdr' from 'stream' and set the bits for its IPs in the
+ *    65536-bit bitmap 'bmap'.  'buf' is scratch space that must hold
+ *    SET_SLASH16_MAX_VALUES uint16_t values.  Return SKIPSET_OK on
+ *    success, SKIPSET_ERR_FILEIO on read error, or
+ *    SKIPSET_ERR_CORRUPT for an unknown container type or count.
+ *
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
+ *    file format.
  */
 static int
-ipsetPrintCallback(
-    skipaddr_t         *ip,
-    uint32_t            prefix,
-    void               *v_print_state)
+ipsetReadSlash16Container(
+    skstream_t         *stream,
+    int                 swap_flag,
+    const uint32_t      cont_hdr[2],
+    uint32_t           *bmap,
+    uint16_t           *buf)
 {
-    ipset_print_t *print_state = (ipset_print_t*)v_print_state;
-    char ipbuf[SK_NUM2DOT_STRLEN+1];
-    int rv = SKIPSET_OK;
+    uint32_t *words;
+    uint32_t count;
+    uint32_t i;
+    size_t len;
 
-    /* print ip and its prefix, then return */
-    skipaddrString(ipbuf, ip, print_state->ip_format);
-    if (skipaddrIsV6(ip) ? (prefix == 128) : (prefix == 32)) {
-        if (skStreamPrint(print_state->stream, "%s\n", ipbuf)) {
-            rv = SKIPSET_ERR_FILEIO;
+    count = cont_hdr[1];
+
+    switch (cont_hdr[0] & 0xFFFF) {
+      case SET_SLASH16_ARRAY:
+        if (0 == count || count > SET_SLASH16_MAX_VALUES) {
+            return SKIPSET_ERR_CORRUPT;
         }
-    } else {
-        if (skStreamPrint(print_state->stream, ("%s/%" PRIu32 "\n"),
-                          ipbuf, prefix))
-        {
-            rv = SKIPSET_ERR_FILEIO;
+        len = count * sizeof(uint16_t);
+        if (skStreamRead(stream, buf, len) != (ssize_t)len) {
+            return SKIPSET_ERR_FILEIO;
+        }
+        for (i = 0; i < count; ++i) {
+            if (swap_flag) {
+                buf[i] = BSWAP16(buf[i]);
+            }
+            bmap[buf[i] >> 5] |= (1u << (buf[i] & 0x1F));
+        }
+        break;
+
+      case SET_SLASH16_BITMAP:
+        len = sizeof(skIPNode_t);
+        words = (uint32_t*)buf;
+        if (skStreamRead(stream, words, len) != (ssize_t)len) {
+            return SKIPSET_ERR_FILEIO;
+        }
+        if (swap_flag) {
+            for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+                bmap[i] |= BSWAP32(words[i]);
+            }
+        } else {
+            for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+                bmap[i] |= words[i];
+            }
+        }
+        break;
+
+      case SET_SLASH16_RUN:
+        if (0 == count || count > (SET_SLASH16_MAX_VALUES >> 1)) {
+            return SKIPSET_ERR_CORRUPT;
+        }
+        len = 2 * count * sizeof(uint16_t);
+        if (skStreamRead(stream, buf, len) != (ssize_t)len) {
+            return SKIPSET_ERR_FILEIO;
+        }
+        for (i = 0; i < 2 * count; i += 2) {
+            if (swap_flag) {
+                buf[i] = BSWAP16(buf[i]);
+                buf[i+1] = BSWAP16(buf[i+1]);
+            }
+            if (buf[i] > buf[i+1]) {
+                return SKIPSET_ERR_CORRUPT;
+            }
+            ipsetSlash16SetRange(bmap, buf[i], buf[i+1]);
         }
+        break;
+
+      default:
+        return SKIPSET_ERR_CORRUPT;
     }
 
-    return rv;
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetReadCidrbmapIntoIPTree(&ipset, stream, hdr);
+ *  status = ipsetReadSlash16IntoContainer(&ipset, stream, hdr);
  *
- *    Helper function for skIPSetRead() via ipsetReadCidrbmap().
+ *    Helper function for skIPSetRead() via ipsetReadSlash16().
  *
- *    Read an IPset containing only IPv4 addresses in the
- *    IPSET_REC_VERSION_CIDR_BMAP format from 'stream' and create a
- *    SiLK-2 IPTree data structure.
+ *    Read an IPset in the IPSET_REC_VERSION_SLASH16 format from
+ *    'stream' and create an IPset that uses /16 containers.  Each
+ *    container is read directly into the container for its /16.  An
+ *    array that is not in ascending order, a list of runs that
+ *    overlap or are adjacent, and a container that is larger than a
+ *    bitmap are converted to a bitmap.
  *
- *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
  *    file format.
  */
 static int
-ipsetReadCidrbmapIntoIPTree(
+ipsetReadSlash16IntoContainer(
     skipset_t         **ipset_out,
     skstream_t         *stream,
     sk_file_header_t   *hdr)
 {
     skipset_t *ipset = NULL;
-    sk_header_entry_t *hentry;
-    uint8_t read_buf[sizeof(uint32_t) + sizeof(uint8_t)];
-    uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
-    int swap_flag;
-    uint32_t slash24;
+    ipset_slash16_t *node = NULL;
+    uint32_t *tmp = NULL;
+    uint32_t cont_hdr[2];
     uint32_t slash16;
+    uint32_t count;
+    uint32_t width;
+    uint32_t i;
+    uint16_t *vals;
+    int in_order;
+    int swap_flag;
+    size_t len;
     ssize_t b;
-    int i;
     int rv;
 
     /* sanity check input */
     assert(ipset_out);
     assert(stream);
     assert(hdr);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
-                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
-    {
-        skAbort();
-    }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
-    }
-    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
-    if (NULL == hentry) {
-        skAbort();
-    }
-    if (sizeof(uint32_t) != skHentryIPSetGetLeafSize(hentry)) {
-        skAbort();
-    }
 
     swap_flag = !skHeaderIsNativeByteOrder(hdr);
 
-    rv = ipsetCreate(&ipset, 0, 0);
+    tmp = (uint32_t*)malloc(sizeof(skIPNode_t));
+    if (NULL == tmp) {
+        rv = SKIPSET_ERR_ALLOC;
+        goto END;
+    }
+
+    rv = ipsetCreateContainer(&ipset);
     if (rv != SKIPSET_OK) {
         goto END;
     }
 
-    while ((b = skStreamRead(stream, read_buf, sizeof(read_buf)))
-           == sizeof(read_buf))
+    while ((b = skStreamRead(stream, cont_hdr, sizeof(cont_hdr)))
+           == sizeof(cont_hdr))
     {
         if (swap_flag) {
-            slash24 = BSWAP32(*(uint32_t*)read_buf);
-        } else {
-            slash24 = *(uint32_t*)read_buf;
+            cont_hdr[0] = BSWAP32(cont_hdr[0]);
+            cont_hdr[1] = BSWAP32(cont_hdr[1]);
         }
-        /* handle the prefix bit */
-        if (read_buf[sizeof(uint32_t)] <= 32) {
-            /* IPv4 and one byte that is CIDR block */
-            rv = ipsetInsertAddressIPTree(ipset, slash24,
-                                          read_buf[sizeof(uint32_t)]);
-            if (rv) {
+        slash16 = cont_hdr[0] >> 16;
+        count = cont_hdr[1];
+
+        switch (cont_hdr[0] & 0xFFFF) {
+          case SET_SLASH16_ARRAY:
+            if (0 == count || count > SET_SLASH16_MAX_VALUES) {
+                rv = SKIPSET_ERR_CORRUPT;
                 goto END;
             }
-        } else if (read_buf[sizeof(uint32_t)] != SET_CIDR_BMAP_256) {
-            skAppPrintErr("Unexpected value for prefix %u",
-                          read_buf[sizeof(uint32_t)]);
-            skAbort();
+            width = 1;
+            break;
+          case SET_SLASH16_RUN:
+            if (0 == count || count > (SET_SLASH16_MAX_VALUES >> 1)) {
+                rv = SKIPSET_ERR_CORRUPT;
+                goto END;
+            }
+            width = 2;
+            break;
+          case SET_SLASH16_BITMAP:
+            width = 0;
+            break;
+          default:
+            rv = SKIPSET_ERR_CORRUPT;
+            goto END;
+        }
+
+        node = ipsetSlash16Create((cont_hdr[0] & 0xFFFF), width * count);
+        if (NULL == node) {
+            rv = SKIPSET_ERR_ALLOC;
+            goto END;
+        }
+
+        if (0 == width) {
+            len = sizeof(skIPNode_t);
+            if (skStreamRead(stream, node->b.bmap, len) != (ssize_t)len) {
+                rv = SKIPSET_ERR_FILEIO;
+                goto END;
+            }
+            if (swap_flag) {
+                for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+                    node->b.bmap[i] = BSWAP32(node->b.bmap[i]);
+                }
+            }
         } else {
-            /* IPv4 and 256-element bitmap */
-            if ((b = skStreamRead(stream, bmap, sizeof(bmap)))
-                != sizeof(bmap))
-            {
+            len = width * count * sizeof(uint16_t);
+            vals = node->b.vals;
+            if (skStreamRead(stream, vals, len) != (ssize_t)len) {
                 rv = SKIPSET_ERR_FILEIO;
                 goto END;
             }
-            if (swap_flag) {
-                for (i = 0; i < IPTREE_WORDS_PER_SLASH24; ++i) {
-                    bmap[i] = BSWAP32(bmap[i]);
+            if (swap_flag) {
+                for (i = 0; i < width * count; ++i) {
+                    vals[i] = BSWAP16(vals[i]);
+                }
+            }
+            node->count = count;
+            if (1 == width) {
+                in_order = (count <= SET_SLASH16_ARRAY_MAX);
+                for (i = 1; i < count && in_order; ++i) {
+                    in_order = (vals[i - 1] < vals[i]);
+                }
+            } else {
+                in_order = (count <= SET_SLASH16_RUN_MAX);
+                for (i = 0; i < 2 * count; i += 2) {
+                    if (vals[i] > vals[i + 1]) {
+                        rv = SKIPSET_ERR_CORRUPT;
+                        goto END;
+                    }
+                    if (i && (uint32_t)vals[i - 1] + 1 >= vals[i]) {
+                        in_order = 0;
+                    }
                 }
             }
-            /* Put the first two octets of the base IP into slash16,
-             * and allocate the space for the /16 if we need to */
-            slash16 = (slash24 >> 16);
-            if (NULL == ipset->s.v2->nodes[slash16]) {
-                ipset->s.v2->nodes[slash16]
-                    = (skIPNode_t*)calloc(1, sizeof(skIPNode_t));
-                if (NULL == ipset->s.v2->nodes[slash16]) {
-                    rv = SKIPSET_ERR_ALLOC;
+            if (!in_order) {
+                rv = ipsetSlash16ToBitmap(node);
+                if (rv) {
                     goto END;
                 }
             }
-            /* Locate where this /24 occurs inside the larger /16,
-             * then copy it into place.  Following is equivalent to
-             * (((slash24 >> 8) & 0xFF) * 8); */
-            slash24 = ((slash24 & 0x0000FF00) >> 5);
-            memcpy((ipset->s.v2->nodes[slash16]->addressBlock + slash24),
-                   bmap, sizeof(bmap));
         }
+
+        if (ipset->s.cont->slash16[slash16]) {
+            rv = ipsetSlash16Union(ipset->s.cont->slash16[slash16], node, tmp);
+            ipsetSlash16Destroy(node);
+            if (rv) {
+                node = NULL;
+                goto END;
+            }
+        } else {
+            ipset->s.cont->slash16[slash16] = node;
+        }
+        node = NULL;
     }
     if (b != 0) {
         /* read error */
@@ -5557,10 +8345,18 @@ ipsetReadCidrbmapIntoIPTree(
         goto END;
     }
 
+    ipset->is_dirty = 1;
+    rv = skIPSetClean(ipset);
+    if (rv) {
+        goto END;
+    }
+
     *ipset_out = ipset;
     rv = SKIPSET_OK;
 
   END:
+    ipsetSlash16Destroy(node);
+    free(tmp);
     if (rv != SKIPSET_OK) {
         skIPSetDestroy(&ipset);
     }
@@ -5569,210 +8365,70 @@ ipsetReadCidrbmapIntoIPTree(
 
 
 /*
- *  status = ipsetReadCidrbmapIntoRadixV4(&ipset, stream, hdr, is_ipv6);
- *  status = ipsetReadCidrbmapIntoRadixV6(&ipset, stream, hdr, is_ipv6);
+ *  status = ipsetReadSlash16IntoIPTree(&ipset, stream, hdr);
  *
- *    Helper function for skIPSetRead() via ipsetReadCidrbmap().
+ *    Helper function for skIPSetRead() via ipsetReadSlash16().
  *
- *    Read an IPset in the IPSET_REC_VERSION_CIDR_BMAP format from
- *    'stream' and create a radix-tree IPset data structure.
+ *    Read an IPset in the IPSET_REC_VERSION_SLASH16 format from
+ *    'stream' and create a SiLK-2 IPTree data structure.  Each
+ *    container is decoded directly into the skIPNode_t for its /16.
  *
- *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
  *    file format.
  */
 static int
-ipsetReadCidrbmapIntoRadixV4(
+ipsetReadSlash16IntoIPTree(
     skipset_t         **ipset_out,
     skstream_t         *stream,
     sk_file_header_t   *hdr)
 {
     skipset_t *ipset = NULL;
-    sk_header_entry_t *hentry;
-    uint8_t read_buf[sizeof(uint32_t) + sizeof(uint8_t)];
-    uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+    uint16_t *buf = NULL;
+    uint32_t cont_hdr[2];
+    uint32_t slash16;
     int swap_flag;
-    uint32_t slash24;
-    uint32_t ipv4;
     ssize_t b;
-    int i;
     int rv;
 
     /* sanity check input */
     assert(ipset_out);
     assert(stream);
     assert(hdr);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
-                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
-    {
-        skAbort();
-    }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
-    }
-    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
-    if (NULL == hentry) {
-        skAbort();
-    }
-    if (sizeof(uint32_t) != skHentryIPSetGetLeafSize(hentry)) {
-        skAbort();
-    }
 
     swap_flag = !skHeaderIsNativeByteOrder(hdr);
 
-    rv = ipsetCreate(&ipset, 0, 1);
+    buf = (uint16_t*)malloc(SET_SLASH16_MAX_VALUES * sizeof(uint16_t));
+    if (NULL == buf) {
+        rv = SKIPSET_ERR_ALLOC;
+        goto END;
+    }
+
+    rv = ipsetCreate(&ipset, 0, 0);
     if (rv != SKIPSET_OK) {
         goto END;
     }
 
-    while ((b = skStreamRead(stream, read_buf, sizeof(read_buf)))
-           == sizeof(read_buf))
+    while ((b = skStreamRead(stream, cont_hdr, sizeof(cont_hdr)))
+           == sizeof(cont_hdr))
     {
         if (swap_flag) {
-            slash24 = BSWAP32(*(uint32_t*)read_buf);
-        } else {
-            slash24 = *(uint32_t*)read_buf;
+            cont_hdr[0] = BSWAP32(cont_hdr[0]);
+            cont_hdr[1] = BSWAP32(cont_hdr[1]);
         }
-        /* handle the prefix bit */
-        if (read_buf[sizeof(uint32_t)] <= 32) {
-            /* IPv4 and one byte that is CIDR block */
-            rv = ipsetInsertAddressV4(ipset, slash24,
-                                      read_buf[sizeof(uint32_t)], NULL);
-            if (rv) { goto END; }
-        } else if (read_buf[sizeof(uint32_t)] != SET_CIDR_BMAP_256) {
-            skAppPrintErr("Unexpected value for prefix %u",
-                          read_buf[sizeof(uint32_t)]);
-            skAbort();
-        } else {
-            /* IPv4 base address and 256-bit bitmap */
-            if ((b = skStreamRead(stream, bmap, sizeof(bmap)))
-                != sizeof(bmap))
-            {
-                rv = SKIPSET_ERR_FILEIO;
+        slash16 = cont_hdr[0] >> 16;
+        if (NULL == ipset->s.v2->nodes[slash16]) {
+            ipset->s.v2->nodes[slash16]
+                = (skIPNode_t*)calloc(1, sizeof(skIPNode_t));
+            if (NULL == ipset->s.v2->nodes[slash16]) {
+                rv = SKIPSET_ERR_ALLOC;
                 goto END;
             }
-            /* loop over the uint32_t in this block */
-            i = 0;
-            while (i < 8) {
-                switch (i) {
-                  case 0: case 4:
-                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*4)==0){
-                        i += 4;
-                        continue;
-                    }
-                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*4)==0){
-                        ipv4 = slash24 | (i << 5);
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 25, NULL);
-                        if (rv) { goto END; }
-                        i += 4;
-                        continue;
-                    }
-                    /* FALLTHROUGH */
-                  case 2: case 6:
-                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*2)==0){
-                        i += 2;
-                        continue;
-                    }
-                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*2)==0){
-                        ipv4 = slash24 | (i << 5);
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 26, NULL);
-                        if (rv) { goto END; }
-                        i += 2;
-                        continue;
-                    }
-                    /* FALLTHROUGH */
-                  default:
-                    if (0 == bmap[i]) {
-                        ++i;
-                        continue;
-                    }
-                    if (UINT32_MAX == bmap[i]) {
-                        ipv4 = slash24 | (i << 5);
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 27, NULL);
-                        if (rv) { goto END; }
-                        ++i;
-                        continue;
-                    }
-                    break;
-                }
-
-                ipv4 = slash24 | (i << 5);
-
-                if (swap_flag) {
-                    bmap[i] = BSWAP32(bmap[i]);
-                }
-                while (bmap[i]) {
-                    /* find position of least significant bit */
-                    if (!(bmap[i] & 0x1)) {
-                        if ((bmap[i] & 0xFFFF) == 0) {
-                            bmap[i] >>= 16;
-                            ipv4 += 16;
-                        }
-                        if ((bmap[i] & 0xFF) == 0) {
-                            bmap[i] >>= 8;
-                            ipv4 += 8;
-                        }
-                        if ((bmap[i] & 0xF) == 0) {
-                            bmap[i] >>= 4;
-                            ipv4 += 4;
-                        }
-                        if ((bmap[i] & 0x3) == 0) {
-                            bmap[i] >>= 2;
-                            ipv4 += 2;
-                        }
-                        if ((bmap[i] & 0x1) == 0) {
-                            bmap[i] >>= 1;
-                            ipv4 += 1;
-                        }
-                    }
-                    /* find number of consecutive high bits that
-                     * map into a CIDR block */
-                    switch (ipv4 & 0x1F) {
-                      case 0: case 16:
-                        if ((bmap[i] & 0xFFFF) == 0xFFFF) {
-                            rv = ipsetInsertAddressV4(ipset, ipv4, 28, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 16;
-                            ipv4 += 16;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      case 8: case 24:
-                        if ((bmap[i] & 0xFF) == 0xFF) {
-                            rv = ipsetInsertAddressV4(ipset, ipv4, 29, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 8;
-                            ipv4 += 8;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      case 4: case 12: case 20: case 28:
-                        if ((bmap[i] & 0xF) == 0xF) {
-                            rv = ipsetInsertAddressV4(ipset, ipv4, 30, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 4;
-                            ipv4 += 4;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      case  2: case  6: case 10: case 14:
-                      case 18: case 22: case 26: case 30:
-                        if ((bmap[i] & 0x3) == 0x3) {
-                            rv = ipsetInsertAddressV4(ipset, ipv4, 31, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 2;
-                            ipv4 += 2;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      default:
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 32, NULL);
-                        if (rv) { goto END; }
-                        bmap[i] >>= 1;
-                        ++ipv4;
-                        break;
-                    }
-                }
-            }
+        }
+        rv = ipsetReadSlash16Container(
+            stream, swap_flag, cont_hdr,
+            ipset->s.v2->nodes[slash16]->addressBlock, buf);
+        if (rv) {
+            goto END;
         }
     }
     if (b != 0) {
@@ -5781,212 +8437,105 @@ ipsetReadCidrbmapIntoRadixV4(
         goto END;
     }
 
-    skIPSetClean(ipset);
-
-    /* Success */
     *ipset_out = ipset;
     rv = SKIPSET_OK;
 
   END:
+    free(buf);
     if (rv != SKIPSET_OK) {
         skIPSetDestroy(&ipset);
     }
     return rv;
 }
 
-#if SK_ENABLE_IPV6
+
+/*
+ *  status = ipsetReadSlash16IntoRadixV4(&ipset, stream, hdr);
+ *
+ *    Helper function for skIPSetRead() via ipsetReadSlash16().
+ *
+ *    Read an IPset in the IPSET_REC_VERSION_SLASH16 format from
+ *    'stream' and create a radix-tree IPset data structure.  Each
+ *    container is decoded into a bitmap, and the ranges of IPs in
+ *    the bitmap are added to the IPset as CIDR blocks.
+ *
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
+ *    file format.
+ */
 static int
-ipsetReadCidrbmapIntoRadixV6(
+ipsetReadSlash16IntoRadixV4(
     skipset_t         **ipset_out,
     skstream_t         *stream,
     sk_file_header_t   *hdr)
 {
     skipset_t *ipset = NULL;
-    sk_header_entry_t *hentry;
-    uint8_t read_buf[IPSET_LEN_V6 + sizeof(uint8_t)];
-    uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+    skIPNode_t *bmap = NULL;
+    uint16_t *buf = NULL;
+    uint32_t cont_hdr[2];
+    uint32_t num_runs;
+    uint32_t first;
+    uint32_t last;
+    uint32_t bits;
+    uint32_t i;
     int swap_flag;
-    ipset_ipv6_t slash120;
-    ipset_ipv6_t ipv6;
     ssize_t b;
-    int i;
     int rv;
 
     /* sanity check input */
     assert(ipset_out);
     assert(stream);
-    assert(hdr);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
-                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
-    {
-        skAbort();
-    }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
-    }
-    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
-    if (NULL == hentry) {
-        skAbort();
-    }
-    if (IPSET_LEN_V6 != skHentryIPSetGetLeafSize(hentry)) {
-        skAbort();
-    }
+    assert(hdr);
 
     swap_flag = !skHeaderIsNativeByteOrder(hdr);
 
-    rv = ipsetCreate(&ipset, 1, 1);
+    bmap = (skIPNode_t*)malloc(sizeof(skIPNode_t));
+    buf = (uint16_t*)malloc(SET_SLASH16_MAX_VALUES * sizeof(uint16_t));
+    if (NULL == bmap || NULL == buf) {
+        rv = SKIPSET_ERR_ALLOC;
+        goto END;
+    }
+
+    rv = ipsetCreate(&ipset, 0, 1);
     if (rv != SKIPSET_OK) {
         goto END;
     }
 
-    while ((b = skStreamRead(stream, read_buf, sizeof(read_buf)))
-           == sizeof(read_buf))
+    while ((b = skStreamRead(stream, cont_hdr, sizeof(cont_hdr)))
+           == sizeof(cont_hdr))
     {
-        IPSET_IPV6_FROM_ARRAY(&slash120, read_buf);
-        /* handle the prefix bit */
-        if (read_buf[IPSET_LEN_V6] <= 128) {
-            /* IPv6 and one byte CIDR prefix */
-            rv = ipsetInsertAddressV6(ipset, &slash120,
-                                      read_buf[IPSET_LEN_V6], NULL);
-            if (rv) { goto END; }
-        } else if (read_buf[IPSET_LEN_V6] != SET_CIDR_BMAP_256) {
-            skAppPrintErr("Unexpected value for prefix %u",
-                          read_buf[sizeof(uint32_t)]);
-            skAbort();
-        } else {
-            /* IPv6 base address and 256-bit bitmap */
-            if ((b = skStreamRead(stream, bmap, sizeof(bmap)))
-                != sizeof(bmap))
-            {
-                rv = SKIPSET_ERR_FILEIO;
-                goto END;
-            }
-
-            ipv6.ip[0] = slash120.ip[0];
+        if (swap_flag) {
+            cont_hdr[0] = BSWAP32(cont_hdr[0]);
+            cont_hdr[1] = BSWAP32(cont_hdr[1]);
+        }
+        memset(bmap, 0, sizeof(skIPNode_t));
+        rv = ipsetReadSlash16Container(stream, swap_flag, cont_hdr,
+                                       bmap->addressBlock, buf);
+        if (rv) {
+            goto END;
+        }
 
-            /* loop over the uint32_t in this block */
-            i = 0;
-            while (i < 8) {
-                switch (i) {
-                  case 0: case 4:
-                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*4)==0){
-                        i += 4;
-                        continue;
-                    }
-                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*4)==0){
-                        ipv6.ip[1] = slash120.ip[1] | (i << 5);
-                        rv = ipsetInsertAddressV6(ipset, &ipv6, 121, NULL);
-                        if (rv) { goto END; }
-                        i += 4;
-                        continue;
-                    }
-                    /* FALLTHROUGH */
-                  case 2: case 6:
-                    if (memcmp(&bmap[i], bmap256_zero, sizeof(uint32_t)*2)==0){
-                        i += 2;
-                        continue;
-                    }
-                    if (memcmp(&bmap[i], bmap256_full, sizeof(uint32_t)*2)==0){
-                        ipv6.ip[1] = slash120.ip[1] | (i << 5);
-                        rv = ipsetInsertAddressV6(ipset, &ipv6, 122, NULL);
-                        if (rv) { goto END; }
-                        i += 2;
-                        continue;
-                    }
-                    /* FALLTHROUGH */
-                  default:
-                    if (0 == bmap[i]) {
-                        ++i;
-                        continue;
-                    }
-                    if (UINT32_MAX == bmap[i]) {
-                        ipv6.ip[1] = slash120.ip[1] | (i << 5);
-                        rv = ipsetInsertAddressV6(ipset, &ipv6, 123, NULL);
-                        if (rv) { goto END; }
-                        ++i;
-                        continue;
-                    }
-                    break;
+        /* add each range in the /16 as the largest CIDR blocks that
+         * it contains */
+        num_runs = ipsetSlash16FindRuns(bmap->addressBlock, buf);
+        for (i = 0; i < 2 * num_runs; i += 2) {
+            first = (cont_hdr[0] & 0xFFFF0000) | buf[i];
+            last = (cont_hdr[0] & 0xFFFF0000) | buf[i+1];
+            for (;;) {
+                bits = 0;
+                while (bits < 16
+                       && 0 == (first & ((2u << bits) - 1))
+                       && (first + (2u << bits) - 1) <= last)
+                {
+                    ++bits;
                 }
-
-                ipv6.ip[1] = slash120.ip[1] | (i << 5);
-
-                if (swap_flag) {
-                    bmap[i] = BSWAP32(bmap[i]);
+                rv = ipsetInsertAddressV4(ipset, first, 32 - bits, NULL);
+                if (rv) {
+                    goto END;
                 }
-
-                while (bmap[i]) {
-                    /* find position of least significant bit */
-                    if (!(bmap[i] & 0x1)) {
-                        if ((bmap[i] & 0xFFFF) == 0) {
-                            bmap[i] >>= 16;
-                            ipv6.ip[1] += 16;
-                        }
-                        if ((bmap[i] & 0xFF) == 0) {
-                            bmap[i] >>= 8;
-                            ipv6.ip[1] += 8;
-                        }
-                        if ((bmap[i] & 0xF) == 0) {
-                            bmap[i] >>= 4;
-                            ipv6.ip[1] += 4;
-                        }
-                        if ((bmap[i] & 0x3) == 0) {
-                            bmap[i] >>= 2;
-                            ipv6.ip[1] += 2;
-                        }
-                        if ((bmap[i] & 0x1) == 0) {
-                            bmap[i] >>= 1;
-                            ipv6.ip[1] += 1;
-                        }
-                    }
-                    /* find number of consecutive high bits that
-                     * map into a CIDR block */
-                    switch (ipv6.ip[1] & 0x1F) {
-                      case 0: case 16:
-                        if ((bmap[i] & 0xFFFF) == 0xFFFF) {
-                            rv = ipsetInsertAddressV6(ipset, &ipv6, 124, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 16;
-                            ipv6.ip[1] += 16;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      case 8: case 24:
-                        if ((bmap[i] & 0xFF) == 0xFF) {
-                            rv = ipsetInsertAddressV6(ipset, &ipv6, 125, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 8;
-                            ipv6.ip[1] += 8;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      case 4: case 12: case 20: case 28:
-                        if ((bmap[i] & 0xF) == 0xF) {
-                            rv = ipsetInsertAddressV6(ipset, &ipv6, 126, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 4;
-                            ipv6.ip[1] += 4;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      case  2: case  6: case 10: case 14:
-                      case 18: case 22: case 26: case 30:
-                        if ((bmap[i] & 0x3) == 0x3) {
-                            rv = ipsetInsertAddressV6(ipset, &ipv6, 127, NULL);
-                            if (rv) { goto END; }
-                            bmap[i] >>= 2;
-                            ipv6.ip[1] += 2;
-                            continue;
-                        }
-                        /* FALLTHROUGH */
-                      default:
-                        rv = ipsetInsertAddressV6(ipset, &ipv6, 128, NULL);
-                        if (rv) { goto END; }
-                        bmap[i] >>= 1;
-                        ++ipv6.ip[1];
-                        break;
-                    }
+                if (first + (1u << bits) - 1 == last) {
+                    break;
                 }
+                first += (1u << bits);
             }
         }
     }
@@ -6003,40 +8552,40 @@ ipsetReadCidrbmapIntoRadixV6(
     rv = SKIPSET_OK;
 
   END:
+    free(bmap);
+    free(buf);
     if (rv != SKIPSET_OK) {
         skIPSetDestroy(&ipset);
     }
     return rv;
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetReadCidrbmap(&ipset, stream, hdr);
+ *  status = ipsetReadSlash16(&ipset, stream, hdr);
  *
  *    Helper function for skIPSetRead().
  *
- *    Read an IPset in the IPSET_REC_VERSION_CIDR_BMAP format from
+ *    Read an IPset in the IPSET_REC_VERSION_SLASH16 format from
  *    'stream'.
  *
- *    This function reads the header then calls another helper
+ *    This function checks the header then calls another helper
  *    function depending on the data structure being used.
  */
 static int
-ipsetReadCidrbmap(
+ipsetReadSlash16(
     skipset_t         **ipset_out,
     skstream_t         *stream,
     sk_file_header_t   *hdr)
 {
     sk_header_entry_t *hentry;
-    int is_ipv6;
 
     /* sanity check input */
     assert(ipset_out);
     assert(stream);
     assert(hdr);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_CIDR_BMAP,
-                                IPSET_REC_VERSION_CIDR_BMAP, NULL))
+    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_SLASH16,
+                                IPSET_REC_VERSION_SLASH16, NULL))
     {
         skAbort();
     }
@@ -6044,1736 +8593,2560 @@ ipsetReadCidrbmap(
         skAbort();
     }
 
-    /* read and verify the header */
+    /* read and verify the header; the file holds only IPv4 */
     hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
     if (NULL == hentry) {
         return SKIPSET_ERR_FILEHEADER;
     }
-    /* most sizes are zero */
     if (0 != skHentryIPSetGetChildPerNode(hentry)
         || 0 != skHentryIPSetGetRootIndex(hentry)
         || 0 != skHentryIPSetGetNodeCount(hentry)
         || 0 != skHentryIPSetGetNodeSize(hentry)
-        || 0 != skHentryIPSetGetLeafCount(hentry))
+        || 0 != skHentryIPSetGetLeafCount(hentry)
+        || sizeof(uint32_t) != skHentryIPSetGetLeafSize(hentry))
     {
         return SKIPSET_ERR_FILEHEADER;
     }
-    if (sizeof(uint32_t) == skHentryIPSetGetLeafSize(hentry)) {
-        is_ipv6 = 0;
-    } else if (IPSET_LEN_V6 == skHentryIPSetGetLeafSize(hentry)) {
-        is_ipv6 = 1;
-    } else {
-        /* Unrecognized record size */
-        return SKIPSET_ERR_FILEHEADER;
-    }
 
-    if (is_ipv6) {
-#if  !SK_ENABLE_IPV6
-        /* IPv6 IPSet not supported by this build of SiLK */
-        return SKIPSET_ERR_IPV6;
-#else
-        return ipsetReadCidrbmapIntoRadixV6(ipset_out, stream, hdr);
-#endif
+    if (IPSET_USE_CONTAINER) {
+        return ipsetReadSlash16IntoContainer(ipset_out, stream, hdr);
     }
     if (IPSET_USE_IPTREE) {
-        /* Read IPv4-only file into the IPTree format */
-        return ipsetReadCidrbmapIntoIPTree(ipset_out, stream, hdr);
+        return ipsetReadSlash16IntoIPTree(ipset_out, stream, hdr);
     }
-    return ipsetReadCidrbmapIntoRadixV4(ipset_out, stream, hdr);
+    return ipsetReadSlash16IntoRadixV4(ipset_out, stream, hdr);
 }
 
 
 /*
- *  status = ipsetReadLegacyIntoIPTree(&ipset, stream, hdr);
- *
- *    Helper function for skIPSetRead() via ipsetReadLegacy().
+ *  status = ipsetRecordGetV4(rwrec, src_dst_nh, &ipv4);
  *
- *    Read an IPset in the IPSET_REC_VERSION_LEGACY format from
- *    'stream' and create a SiLK-2 IPTree data structure.
+ *    Helper function for skIPSetCheckRecords().
  *
- *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
- *    file format.
+ *    Set 'ipv4' to the source, destination, or next hop IP address of
+ *    'rwrec' when 'src_dst_nh' is 1, 2, or 4, respectively.  Return 0
+ *    on success, or -1 when the address is IPv6 and cannot be
+ *    converted to IPv4.
  */
 static int
-ipsetReadLegacyIntoIPTree(
-    skipset_t         **ipset_out,
-    skstream_t         *stream,
-    sk_file_header_t   *hdr)
+ipsetRecordGetV4(
+    const rwRec        *rwrec,
+    int                 src_dst_nh,
+    uint32_t           *ipv4)
 {
-    skipset_t *ipset = NULL;
-    int swap_flag;
-    uint32_t block24[1 + IPTREE_WORDS_PER_SLASH24];
-    uint32_t slash24;
-    uint32_t slash16;
-    ssize_t b;
-    int i;
-    int rv;
+#if SK_ENABLE_IPV6
+    if (rwRecIsIPv6(rwrec)) {
+        skipaddr_t ipaddr;
 
-    /* sanity check input */
-    assert(ipset_out);
-    assert(stream);
-    assert(hdr);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, 0,
-                                IPSET_REC_VERSION_LEGACY, NULL))
-    {
-        skAbort();
+        switch (src_dst_nh) {
+          case 1:
+            rwRecMemGetSIP(rwrec, &ipaddr);
+            break;
+          case 2:
+            rwRecMemGetDIP(rwrec, &ipaddr);
+            break;
+          case 4:
+            rwRecMemGetNhIP(rwrec, &ipaddr);
+            break;
+          default:
+            skAbortBadCase(src_dst_nh);
+        }
+        return (skipaddrGetAsV4(&ipaddr, ipv4) ? -1 : 0);
     }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
+#endif  /* SK_ENABLE_IPV6 */
+
+    switch (src_dst_nh) {
+      case 1:
+        *ipv4 = rwRecGetSIPv4(rwrec);
+        break;
+      case 2:
+        *ipv4 = rwRecGetDIPv4(rwrec);
+        break;
+      case 4:
+        *ipv4 = rwRecGetNhIPv4(rwrec);
+        break;
+      default:
+        skAbortBadCase(src_dst_nh);
     }
+    return 0;
+}
 
-    swap_flag = !skHeaderIsNativeByteOrder(hdr);
 
-    rv = ipsetCreate(&ipset, 0, 0);
-    if (rv != SKIPSET_OK) {
-        goto END;
-    }
+/*
+ *  rv = ipsetRemoveAddressIPTree(ipset, ipv4, prefix);
+ *
+ *    Helper function for skIPSetRemoveAddress(); may also be called
+ *    by other internal functions.
+ */
+static int
+ipsetRemoveAddressIPTree(
+    skipset_t          *ipset,
+    uint32_t            ipv4,
+    uint32_t            prefix)
+{
+    uint32_t ipv4_end;
+
+    assert(ipset);
+    assert(1 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
+    assert(prefix > 0 || ipv4 == 0);
+    assert(prefix <= 32);
 
-    while ((b = skStreamRead(stream, block24, sizeof(block24)))
-           == sizeof(block24))
-    {
-        if (swap_flag) {
-            for (i = 0; i < 1+IPTREE_WORDS_PER_SLASH24; ++i) {
-                block24[i] = BSWAP32(block24[i]);
-            }
+    if (32 == prefix) {
+        if (ipset->s.v2->nodes[ipv4 >> 16]) {
+            skIPTreeNodeClear(ipv4, ipset->s.v2->nodes[ipv4 >> 16]);
         }
 
-        /* Put the first two octets of the base IP into slash16, and
-         * allocate the space for the /16 if we need to */
-        slash16 = (block24[0] >> 16);
-        if (NULL == ipset->s.v2->nodes[slash16]) {
-            ipset->s.v2->nodes[slash16]
-                = (skIPNode_t*)calloc(1, sizeof(skIPNode_t));
-            if (NULL == ipset->s.v2->nodes[slash16]) {
-                rv = SKIPSET_ERR_ALLOC;
-                goto END;
+    } else if (prefix <= 16) {
+        ipv4_end = ((UINT32_MAX >> prefix) | ipv4) >> 16;
+        ipv4 >>= 16;
+        do {
+            if (ipset->s.v2->nodes[ipv4]) {
+                free(ipset->s.v2->nodes[ipv4]);
+                ipset->s.v2->nodes[ipv4] = NULL;
             }
+        } while (ipv4++ < ipv4_end);
+
+    } else if (prefix <= 27) {
+        ipv4_end = ((UINT32_MAX >> prefix) | ipv4) >> 5;
+        ipv4 >>= 5;
+        if (NULL == ipset->s.v2->nodes[ipv4 >> 11]) {
+            goto END;
         }
+        do {
+            /* nodes are allocated on /16, already shifted by 5, need
+             * to shift by 11 more to get the complete shift by 16.
+             * Mask by 0x7ff (0xffff>>5) to get addressBlock */
+            memset(&ipset->s.v2->nodes[ipv4>>11]->addressBlock[ipv4 & 0x07FF],
+                   0, sizeof(uint32_t));
+        } while (ipv4++ < ipv4_end);
 
-        /* Locate where this /24 occurs inside the larger /16, then
-         * copy it into place.  Following is equivalent to
-         * (((block24[0] >> 8) & 0xFF) * 8); */
-        slash24 = ((block24[0] & 0x0000FF00) >> 5);
-        memcpy((ipset->s.v2->nodes[slash16]->addressBlock + slash24),
-               block24 + 1, IPTREE_WORDS_PER_SLASH24 * sizeof(uint32_t));
-    }
-    if (b != 0) {
-        /* read error */
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+    } else {
+        if (NULL == ipset->s.v2->nodes[ipv4 >> 16]) {
+            goto END;
+        }
+        ipv4_end = (UINT32_MAX >> prefix) | ipv4;
+        do {
+            skIPTreeNodeClear(ipv4, ipset->s.v2->nodes[ipv4 >> 16]);
+        } while (ipv4++ < ipv4_end);
     }
 
-    *ipset_out = ipset;
-    rv = SKIPSET_OK;
-
   END:
-    if (rv != SKIPSET_OK) {
-        skIPSetDestroy(&ipset);
-    }
-    return rv;
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetReadLegacyIntoRadix(&ipset, stream, hdr);
+ *  rv = ipsetRemoveAddressV4(ipset, ipv4, prefix, find_state);
+ *  rv = ipsetRemoveAddressV6(ipset, ipv6, prefix, find_state);
  *
- *    Helper function for skIPSetRead() via ipsetReadLegacy().
+ *    Helper function for skIPSetRemoveAddress(); may also be called
+ *    by other internal functions.
  *
- *    Read an IPset in the IPSET_REC_VERSION_LEGACY format from
- *    'stream' and create a radix-tree IPset data structure.
+ *    Remove the CIDR block ipv4/prefix or ipv6/prefix from the IPset.
  *
- *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
- *    file format.
+ *    'find_state' should be NULL or the result of calling
+ *    ipsetFindV4() or ipsetFindV6() on the ip/prefix pair.  When
+ *    'find_state' is NULL, this function does the address search
+ *    itself.
+ *
+ *    Return SKIPSET_OK if the address block was successfully removed
+ *    or if the address block does not appear in the IPset.  Return
+ *    SKIPSET_ERR_ALLOC if there is a memory allocation error.
  */
 static int
-ipsetReadLegacyIntoRadix(
-    skipset_t         **ipset_out,
-    skstream_t         *stream,
-    sk_file_header_t   *hdr)
+ipsetRemoveAddressV4(
+    skipset_t          *ipset,
+    const uint32_t      ipv4,
+    const uint32_t      prefix,
+    const ipset_find_t *find_state)
 {
-    skipset_t *ipset = NULL;
-    int swap_flag;
-    uint32_t contig_start = 0;
-    uint32_t contig_length = 0;
-    uint32_t block24[1+IPTREE_WORDS_PER_SLASH24];
-    uint32_t slash24;
-    uint32_t ipv4;
-    ssize_t b;
-    int i;
+    ipset_find_t find_state_local;
+    ipset_node_v4_t *parent = NULL;
+    ipset_leaf_v4_t *leaf;
+    uint32_t which_child;
+    uint32_t i;
+    uint32_t j;
     int rv;
 
-    /* sanity check input */
-    assert(ipset_out);
-    assert(stream);
-    assert(hdr);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, 0,
-                                IPSET_REC_VERSION_LEGACY, NULL))
-    {
-        skAbort();
-    }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
+    assert(ipset);
+    assert(sizeof(ipset_node_v4_t) == ipset->s.v3->nodes.entry_size);
+    assert(prefix > 0 || ipv4 == 0);
+    assert(prefix <= 32);
+    assert(0 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
+
+    /* use the passed in 'find_state' if given */
+    if (find_state) {
+        rv = find_state->result;
+    } else {
+        rv = ipsetFindV4(ipset, ipv4, prefix, &find_state_local);
+        /* if IP was not found, we can return */
+        if (SKIPSET_ERR_NOTFOUND == rv
+            || SKIPSET_ERR_EMPTY == rv
+            || SKIPSET_ERR_MULTILEAF == rv)
+        {
+            return SKIPSET_OK;
+        }
+        find_state = &find_state_local;
     }
+    ipset->is_dirty = 1;
 
-    swap_flag = !skHeaderIsNativeByteOrder(hdr);
+    /* if we matched a CIDR block in the IPset that is larger than the
+     * block/address we want to remove, we must break the CIDR
+     * block. */
+    if ((SKIPSET_OK == rv) && (find_state->bitpos < prefix)) {
+        uint32_t old_ipv4, mid_ipv4, old_prefix;
 
-    rv = ipsetCreate(&ipset, 0, 1);
-    if (rv != SKIPSET_OK) {
-        goto END;
-    }
+        assert(1 == find_state->node_is_leaf);
 
-    while ((b = skStreamRead(stream, block24, sizeof(block24)))
-           == sizeof(block24))
-    {
-        /* the /24 value is the first value in the array */
-        slash24 = (((swap_flag) ? BSWAP32(block24[0]) : block24[0])
-                   & 0xFFFFFF00);
+        leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
+        old_ipv4 = leaf->ip;
+        old_prefix = leaf->prefix;
 
-        /* handle case where the entire /24 is set */
-        if (0 == memcmp(&block24[1], bmap256_full, sizeof(bmap256_full))) {
-            if (contig_length) {
-                /* we have a previous /24 */
-                if ((contig_start + contig_length) == slash24) {
-                    /* add this block to the current block */
-                    contig_length += 256;
-                    continue;
+        /* remove the current IP */
+        if (IPSET_NO_PARENT == find_state->parent_idx) {
+            skIPSetRemoveAll(ipset);
+        } else {
+            parent = NODE_PTR_V4(ipset, find_state->parent_idx);
+            which_child = WHICH_CHILD_V4(leaf->ip, parent->prefix);
+            if (NUM_BITS <= leaf->prefix - parent->prefix) {
+                /* leaf occupies a single child[] entry */
+                parent->child[which_child] = 0;
+                NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+            } else {
+                for (i = which_child, j = 0;
+                     j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
+                     ++i, ++j)
+                {
+                    parent->child[i] = 0;
                 }
+                NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
+                NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
+            }
+            LEAFIDX_FREE(ipset, find_state->node_idx);
+        }
 
-                /* there is a hole between these CIDR blocks. insert
-                 * the previous block of contiguous IPs to the IPset */
-                rv = ipsetInsertRangeV4(ipset, contig_start, contig_length);
-                if (rv) {
-                    goto END;
+        /* insert all IPs not part of the removed block */
+        do {
+            ++old_prefix;
+            /* find midpoint of this block */
+            mid_ipv4 = old_ipv4 | (1u << (32 - old_prefix));
+            if (ipv4 < mid_ipv4) {
+                /* insert upper half of old CIDR block */
+                rv = ipsetInsertAddressV4(ipset, mid_ipv4, old_prefix, NULL);
+                /* no change to old_ipv4 */
+            } else {
+                /* insert lower half of old CIDR block */
+                rv = ipsetInsertAddressV4(ipset, old_ipv4, old_prefix, NULL);
+                /* adjust old_ipv4 to the base of the upper half */
+                old_ipv4 = mid_ipv4;
+            }
+        } while (0 == rv && old_prefix < prefix);
+
+        /* all done */
+        return rv;
+    }
+
+    /* otherwise, we exactly matched the node we want to remove, or we
+     * are removing a CIDR block that is only partially populated.
+     * These cases are handled the same way: modify the parent of the
+     * node to remove the node we found. */
+
+    /* handle the simple case */
+    if (IPSET_NO_PARENT == find_state->parent_idx) {
+        return skIPSetRemoveAll(ipset);
+    }
+    parent = NODE_PTR_V4(ipset, find_state->parent_idx);
+
+    if (SKIPSET_ERR_SUBSET == rv
+        && (NUM_BITS > prefix - parent->prefix))
+    {
+        /* need to clear multiple child[] entries */
+        which_child = WHICH_CHILD_V4(ipv4, parent->prefix);
+        for (i = which_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i]) {
+                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                    ipsetDestroySubtree(ipset, parent->child[i], 1);
+                    parent->child[i] = 0;
+                } else if (NODEPTR_CHILD_IS_REPEAT(parent, i)) {
+                    parent->child[i] = 0;
+                } else {
+                    LEAFIDX_FREE(ipset, parent->child[i]);
+                    parent->child[i] = 0;
                 }
             }
-            /* start a new run of contiguous IPs */
-            contig_start = slash24;
-            contig_length = 256;
-            continue;
         }
+        NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
+        NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
 
-        if (contig_length) {
-            /* we have a previous /24, but the block we just read
-             * contains holes and cannot be added to it; handle this
-             * existing CIDR block first */
-            rv = ipsetInsertRangeV4(ipset, contig_start, contig_length);
-            if (rv) {
-                goto END;
+        /* handle case where node has a single child */
+        ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
+        return SKIPSET_OK;
+    }
+
+    if (!find_state->node_is_leaf) {
+        /* remove this node from the parent, and delete the node and
+         * everything below it */
+        parent->child[find_state->parents_child] = 0;
+        ipsetDestroySubtree(ipset, find_state->node_idx, 1);
+    } else {
+        /* remove this leaf from the parent */
+        leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
+        if (NUM_BITS <= leaf->prefix - parent->prefix) {
+            /* leaf occupies a single child[] entry */
+            parent->child[find_state->parents_child] = 0;
+            NODEPTR_CHILD_CLEAR_LEAF(parent, find_state->parents_child);
+        } else {
+            /* leaf occupies multiple child[] entries */
+            which_child = WHICH_CHILD_V4(leaf->ip, parent->prefix);
+            for (i = which_child, j = 0;
+                 j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
+                 ++i, ++j)
+            {
+                parent->child[i] = 0;
             }
-            contig_length = 0;
+            NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
+            NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
         }
+        LEAFIDX_FREE(ipset, find_state->node_idx);
+    }
 
-        /* loop over the uint32_t in this block */
-        i = 1;
-        while (i < 9) {
-            if (0 == block24[i]) {
-                ++i;
-                continue;
-            }
+    /* handle case where node has a single child */
+    ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
+    return SKIPSET_OK;
+}
 
-            ipv4 = slash24 | ((i - 1) << 5);
+#if SK_ENABLE_IPV6
+static int
+ipsetRemoveAddressV6(
+    skipset_t          *ipset,
+    const ipset_ipv6_t *ipv6,
+    const uint32_t      prefix,
+    const ipset_find_t *find_state)
+{
+    ipset_find_t find_state_local;
+    ipset_node_v6_t *parent = NULL;
+    ipset_leaf_v6_t *leaf;
+    uint32_t which_child;
+    uint32_t i;
+    uint32_t j;
+    int rv;
 
-            if (0xFFFFFFFF == block24[i]) {
-                /* Check for a longer run of high bits by checking the
-                 * value in adjacent uint32_t's. */
-                switch (i) {
-                  case 1: case 5:
-                    /* check 3 addtional uint32_t's to attempt to
-                     * make a /25 */
-                    if (memcmp(&block24[i+1], bmap256_full, sizeof(uint32_t)*3)
-                        == 0)
-                    {
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 25, NULL);
-                        i += 4;
-                        break;
-                    }
-                    /* FALLTHROUGH */
+    assert(ipset);
+    assert(sizeof(ipset_node_v6_t) == ipset->s.v3->nodes.entry_size);
+    assert(0 < prefix && prefix <= 128);
+    assert(0 == ipset->is_iptree);
+    assert(1 == ipset->is_ipv6);
 
-                  case 3: case 7:
-                    /* check one additional uint32_t to attempt to
-                     * make a /26 */
-                    if (block24[i+1] == 0xFFFFFFFF) {
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 26, NULL);
-                        i += 2;
-                        break;
-                    }
-                    /* FALLTHROUGH */
+    /* use the passed in 'find_state' if given */
+    if (find_state) {
+        rv = find_state->result;
+    } else {
+        rv = ipsetFindV6(ipset, ipv6, prefix, &find_state_local);
+        /* if IP was not found, we can return */
+        if (SKIPSET_ERR_NOTFOUND == rv
+            || SKIPSET_ERR_EMPTY == rv
+            || SKIPSET_ERR_MULTILEAF == rv)
+        {
+            return SKIPSET_OK;
+        }
+        find_state = &find_state_local;
+    }
+    ipset->is_dirty = 1;
 
-                  default:
-                    /* we only have a /27 */
-                    rv = ipsetInsertAddressV4(ipset, ipv4, 27, NULL);
-                    ++i;
-                    break;
-                }
-                if (rv) {
-                    goto END;
+    /* if we matched a CIDR block in the IPset that is larger than the
+     * block/address we want to remove, we must break the CIDR
+     * block. */
+    if ((SKIPSET_OK == rv) && (find_state->bitpos < prefix)) {
+        ipset_ipv6_t old_ipv6, mid_ipv6;
+        uint32_t old_prefix;
+
+        assert(1 == find_state->node_is_leaf);
+
+        leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
+        IPSET_IPV6_COPY(&old_ipv6, &leaf->ip);
+        old_prefix = leaf->prefix;
+
+        /* remove the current IP */
+        if (IPSET_NO_PARENT == find_state->parent_idx) {
+            skIPSetRemoveAll(ipset);
+        } else {
+            parent = NODE_PTR_V6(ipset, find_state->parent_idx);
+            which_child = WHICH_CHILD_V6(&leaf->ip, parent->prefix);
+            if (NUM_BITS <= leaf->prefix - parent->prefix) {
+                /* leaf occupies a single child[] entry */
+                parent->child[which_child] = 0;
+                NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+            } else {
+                for (i = which_child, j = 0;
+                     j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
+                     ++i, ++j)
+                {
+                    parent->child[i] = 0;
                 }
-                continue;
+                NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
+                NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
             }
+            LEAFIDX_FREE(ipset, find_state->node_idx);
+        }
 
-            if (swap_flag) {
-                block24[i] = BSWAP32(block24[i]);
-            }
-            while (block24[i]) {
-                assert((ipv4 - (slash24 | ((i - 1) << 5))) < 32);
-                /* find position of least significant bit */
-                if (!(block24[i] & 0x1)) {
-                    if ((block24[i] & 0xFFFF) == 0) {
-                        block24[i] >>= 16;
-                        ipv4 += 16;
-                    }
-                    if ((block24[i] & 0xFF) == 0) {
-                        block24[i] >>= 8;
-                        ipv4 += 8;
-                    }
-                    if ((block24[i] & 0xF) == 0) {
-                        block24[i] >>= 4;
-                        ipv4 += 4;
-                    }
-                    if ((block24[i] & 0x3) == 0) {
-                        block24[i] >>= 2;
-                        ipv4 += 2;
-                    }
-                    if ((block24[i] & 0x1) == 0) {
-                        block24[i] >>= 1;
-                        ipv4 += 1;
+        /* insert all IPs not part of the removed block */
+        IPSET_IPV6_COPY(&mid_ipv6, &old_ipv6);
+        do {
+            ++old_prefix;
+            if (old_prefix <= 64) {
+                /* find midpoint of this block */
+                mid_ipv6.ip[0]
+                    = old_ipv6.ip[0] | (UINT64_C(1) << (64 - old_prefix));
+                if (ipv6->ip[0] < mid_ipv6.ip[0]) {
+                    /* insert upper half of old CIDR block */
+                    rv = ipsetInsertAddressV6(ipset, &mid_ipv6, old_prefix,
+                                              NULL);
+                    /* no change to old_ipv6 */
+                    if (64 == old_prefix) {
+                        /* reset mid_ipv6 so it is correct for lower
+                         * half of the IP */
+                        mid_ipv6.ip[0] = old_ipv6.ip[0];
                     }
+                } else {
+                    /* insert lower hald of old CIDR block */
+                    rv = ipsetInsertAddressV6(ipset, &old_ipv6, old_prefix,
+                                              NULL);
+                    /* adjust old_ipv6 to the base of the upper half */
+                    old_ipv6.ip[0] = mid_ipv6.ip[0];
                 }
+            } else {
+                mid_ipv6.ip[1]
+                    = old_ipv6.ip[1] | (UINT64_C(1) << (128 - old_prefix));
+                if (ipv6->ip[1] < mid_ipv6.ip[1]) {
+                    rv = ipsetInsertAddressV6(ipset, &mid_ipv6, old_prefix,
+                                              NULL);
+                } else {
+                    rv = ipsetInsertAddressV6(ipset, &old_ipv6, old_prefix,
+                                              NULL);
+                    old_ipv6.ip[1] = mid_ipv6.ip[1];
+                }
+            }
+        } while (0 == rv && old_prefix < prefix);
 
-                /* find number of consecutive high bits that map into
-                 * a CIDR block */
-                switch (ipv4 & 0x1F) {
-                  case 0: case 16:
-                    /* we can consider at least 16 bits in this
-                     * uint32_t---no need to check for 32 bits since
-                     * we would have caught that above */
-                    if ((block24[i] & 0xFFFF) == 0xFFFF) {
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 28, NULL);
-                        block24[i] >>= 16;
-                        ipv4 += 16;
-                        break;
-                    }
-                    /* FALLTHROUGH */
-
-                  case 8: case 24:
-                    /* we can consider at least 8 bits in this uint32_t */
-                    if ((block24[i] & 0xFF) == 0xFF) {
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 29, NULL);
-                        block24[i] >>= 8;
-                        ipv4 += 8;
-                        break;
-                    }
-                    /* FALLTHROUGH */
+        /* done */
+        return rv;
+    }
 
-                  case 4: case 12: case 20: case 28:
-                    if ((block24[i] & 0xF) == 0xF) {
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 30, NULL);
-                        block24[i] >>= 4;
-                        ipv4 += 4;
-                        break;
-                    }
-                    /* FALLTHROUGH */
+    /* otherwise, we exactly matched the node we want to remove, or we
+     * are removing a CIDR block that is only partially populated.
+     * These cases are handled the same way: modify the parent of the
+     * node to remove the node we found. */
 
-                  case  2: case  6: case 10: case 14:
-                  case 18: case 22: case 26: case 30:
-                    if ((block24[i] & 0x3) == 0x3) {
-                        rv = ipsetInsertAddressV4(ipset, ipv4, 31, NULL);
-                        block24[i] >>= 2;
-                        ipv4 += 2;
-                        break;
-                    }
-                    /* FALLTHROUGH */
+    /* handle the simple case */
+    if (IPSET_NO_PARENT == find_state->parent_idx) {
+        return skIPSetRemoveAll(ipset);
+    }
 
-                  default:
-                    rv = ipsetInsertAddressV4(ipset, ipv4, 32, NULL);
-                    block24[i] >>= 1;
-                    ++ipv4;
-                    break;
-                }
-                if (rv) {
-                    goto END;
+    parent = NODE_PTR_V6(ipset, find_state->parent_idx);
+
+    if (SKIPSET_ERR_SUBSET == rv
+        && (NUM_BITS > prefix - parent->prefix))
+    {
+        /* need to clear multiple child[] entries */
+        which_child = WHICH_CHILD_V6(ipv6, parent->prefix);
+        for (i = which_child, j = 0;
+             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
+             ++i, ++j)
+        {
+            if (parent->child[i]) {
+                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
+                    ipsetDestroySubtree(ipset, parent->child[i], 1);
+                    parent->child[i] = 0;
+                } else if (NODEPTR_CHILD_IS_REPEAT(parent, i)) {
+                    parent->child[i] = 0;
+                } else {
+                    LEAFIDX_FREE(ipset, parent->child[i]);
+                    parent->child[i] = 0;
                 }
             }
         }
-    }
+        NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
+        NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
 
-    if (b == -1) {
-        /* read error */
-        rv = -1;
-        goto END;
+        /* handle case where node has a single child */
+        ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
+        return SKIPSET_OK;
     }
 
-    /* close final block */
-    if (contig_length) {
-        rv = ipsetInsertRangeV4(ipset, contig_start, contig_length);
-        if (rv) {
-            goto END;
+    if (!find_state->node_is_leaf) {
+        /* remove this node from the parent, and delete the node and
+         * everything below it */
+        parent->child[find_state->parents_child] = 0;
+        ipsetDestroySubtree(ipset, find_state->node_idx, 1);
+    } else {
+        /* remove this leaf from the parent */
+        leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
+        if (NUM_BITS <= leaf->prefix - parent->prefix) {
+            /* leaf occupies a single child[] entry */
+            parent->child[find_state->parents_child] = 0;
+            NODEPTR_CHILD_CLEAR_LEAF(parent, find_state->parents_child);
+        } else {
+            /* leaf occupies multiple child[] entries */
+            which_child = WHICH_CHILD_V6(&leaf->ip, parent->prefix);
+            for (i = which_child, j = 0;
+                 j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
+                 ++i, ++j)
+            {
+                parent->child[i] = 0;
+            }
+            NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
+            NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
         }
+        LEAFIDX_FREE(ipset, find_state->node_idx);
     }
 
-    /* ipset should already be clean since we went to all the effort
-     * to add the largest possible blocks */
-    skIPSetClean(ipset);
-
-    *ipset_out = ipset;
-    rv = SKIPSET_OK;
-
-  END:
-    if (rv != SKIPSET_OK) {
-        skIPSetDestroy(&ipset);
-    }
-    return rv;
+    /* handle case where node has a single child */
+    ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
+    return SKIPSET_OK;
 }
+#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetReadLegacy(&ipset, stream, hdr);
+ *  new_leaf_id = ipsetReplaceNodeWithLeaf(ipset, parent, which_child);
  *
- *    Helper function for skIPSetRead().
+ *    Replace the node at position child['which_child'] on the node
+ *    'parent' with a leaf.  Return the index of the new leaf.
  *
- *    Read an IPset in the IPSET_REC_VERSION_LEGACY format from
- *    'stream'.
+ *    If 'parent' is NULL, the node at the root of the 'ipset' is
+ *    replaced with a leaf.
  *
- *    This function reads the header then calls another helper
- *    function depending on the data structure being used.
+ *    This function always succeeds, since destroying the node and its
+ *    subtree provides leaf entries on the free_list.
  */
-static int
-ipsetReadLegacy(
-    skipset_t         **ipset_out,
-    skstream_t         *stream,
-    sk_file_header_t   *hdr)
+static uint32_t
+ipsetReplaceNodeWithLeaf(
+    skipset_t          *ipset,
+    ipset_node_t       *parent,
+    uint32_t            which_child)
 {
-    if (IPSET_USE_IPTREE) {
-        return ipsetReadLegacyIntoIPTree(ipset_out, stream, hdr);
+    uint32_t new_leaf_idx;
+
+    assert(ipset);
+    assert(which_child < IPSET_NUM_CHILDREN);
+
+    if (NULL == parent) {
+        assert(0 == IPSET_ROOT_IS_LEAF(ipset));
+        ipsetDestroySubtree(ipset, IPSET_ROOT_INDEX(ipset), 1);
+        ASSERT_OK(ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx));
+        IPSET_ROOT_INDEX_SET(ipset, new_leaf_idx, 1);
+    } else {
+        assert(0 == NODEPTR_CHILD_IS_LEAF(&parent->v4, which_child));
+        ipsetDestroySubtree(ipset, parent->v4.child[which_child], 1);
+        ASSERT_OK(ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx));
+        parent->v4.child[which_child] = new_leaf_idx;
+        NODEPTR_CHILD_SET_LEAF(&parent->v4, which_child);
     }
-    return ipsetReadLegacyIntoRadix(ipset_out, stream, hdr);
+
+    return new_leaf_idx;
 }
 
 
+
 /*
- *  status = ipsetReadRadixIntoIPTree(&ipset, stream, hdr);
+ *  status = ipsetSlash16AddRange(node, first, last);
  *
- *    Helper function for skIPSetRead() via ipsetReadRadix().
- *
- *    Read an IPset in the IPSET_REC_VERSION_RADIX format containing
- *    only IPv4 addresses from 'stream' and create a SiLK-2 IPTree
- *    data structure.
+ *    Helper function for ipsetContainerInsertRange().
  *
- *    See '#define IPSET_REC_VERSION_RADIX' for description of the
- *    file format.
+ *    Add the IPs from 'first' to 'last' inclusive, which are the 16
+ *    least significant bits of the IPs, to the /16 container 'node'.
+ *    An array or a list of runs that would become larger than a
+ *    bitmap is converted to a bitmap.  Return SKIPSET_OK on success,
+ *    or SKIPSET_ERR_ALLOC if memory cannot be allocated.
  */
 static int
-ipsetReadRadixIntoIPTree(
-    skipset_t         **ipset_out,
-    skstream_t         *stream,
-    sk_file_header_t   *hdr)
-{
-    skipset_t *ipset = NULL;
-    sk_header_entry_t *hentry;
-    ipset_leaf_v4_t leaf;
-    ssize_t bytes;
-    ssize_t b;
-    size_t count = 0;
+ipsetSlash16AddRange(
+    ipset_slash16_t    *node,
+    uint32_t            first,
+    uint32_t            last)
+{
+    uint16_t *vals;
+    uint32_t new_count;
+    uint32_t ip;
+    uint32_t i;
+    uint32_t j;
     int rv;
 
-    /* sanity check input */
-    assert(ipset_out);
-    assert(stream);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_RADIX,
-                                IPSET_REC_VERSION_RADIX, NULL))
+    assert(first <= last);
+    assert(last <= UINT16_MAX);
+
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        /* the values from i to j-1 are already in the range */
+        i = ipsetSlash16Search(node->b.vals, node->count, 1, first);
+        j = ipsetSlash16Search(node->b.vals, node->count, 1, last + 1);
+        new_count = node->count - (j - i) + (last - first + 1);
+        if (new_count > SET_SLASH16_ARRAY_MAX) {
+            break;
+        }
+        rv = ipsetSlash16Reserve(node, new_count);
+        if (rv) {
+            return rv;
+        }
+        vals = node->b.vals;
+        memmove(&vals[i + (last - first + 1)], &vals[j],
+                (node->count - j) * sizeof(uint16_t));
+        for (ip = first; ip <= last; ++ip, ++i) {
+            vals[i] = (uint16_t)ip;
+        }
+        node->count = new_count;
+        return SKIPSET_OK;
+
+      case SET_SLASH16_RUN:
+        /* the ranges from i to j-1 overlap or are adjacent to the new
+         * range, and they are replaced by a single range */
+        vals = node->b.vals;
+        i = ipsetSlash16Search(vals, node->count, 2, (first ? first - 1 : 0));
+        for (j = i; j < node->count && vals[2 * j] <= last + 1; ++j)
+            ;                   /* empty */
+        new_count = node->count - (j - i) + 1;
+        if (new_count > SET_SLASH16_RUN_MAX) {
+            break;
+        }
+        if (i < j) {
+            if (vals[2 * i] < first) {
+                first = vals[2 * i];
+            }
+            if (vals[2 * j - 1] > last) {
+                last = vals[2 * j - 1];
+            }
+        }
+        rv = ipsetSlash16Reserve(node, 2 * new_count);
+        if (rv) {
+            return rv;
+        }
+        vals = node->b.vals;
+        memmove(&vals[2 * (i + 1)], &vals[2 * j],
+                2 * (node->count - j) * sizeof(uint16_t));
+        vals[2 * i] = (uint16_t)first;
+        vals[2 * i + 1] = (uint16_t)last;
+        node->count = new_count;
+        return SKIPSET_OK;
+
+      case SET_SLASH16_BITMAP:
+        break;
+
+      default:
+        skAbortBadCase(node->type);
+    }
+
+    rv = ipsetSlash16ToBitmap(node);
+    if (rv) {
+        return rv;
+    }
+    ipsetSlash16SetRange(node->b.bmap, first, last);
+    return SKIPSET_OK;
+}
+
+
+/*
+ *  type = ipsetSlash16ChooseType(num_ips, num_runs);
+ *
+ *    Helper function for ipsetSlash16Optimize() and
+ *    ipsetWriteSlash16Container().
+ *
+ *    Return the type of the smallest container for a /16 that holds
+ *    'num_ips' IPs in 'num_runs' ranges.  A range in a list of runs
+ *    takes two uint16_t's and an IP in an array takes one.
+ */
+static uint32_t
+ipsetSlash16ChooseType(
+    uint32_t            num_ips,
+    uint32_t            num_runs)
+{
+    if (num_runs <= (num_ips >> 1)
+        && 2 * num_runs * sizeof(uint16_t) < sizeof(skIPNode_t))
     {
-        skAbort();
+        return SET_SLASH16_RUN;
     }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
+    if (num_ips * sizeof(uint16_t) < sizeof(skIPNode_t)) {
+        return SET_SLASH16_ARRAY;
     }
-    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
-    if (NULL == hentry) {
-        skAbort();
+    return SET_SLASH16_BITMAP;
+}
+
+
+/*
+ *  ipsetSlash16ClearRange(bmap, first, last);
+ *
+ *    Clear the bits from 'first' to 'last' inclusive in the
+ *    65536-bit bitmap 'bmap'.
+ */
+static void
+ipsetSlash16ClearRange(
+    uint32_t           *bmap,
+    uint32_t            first,
+    uint32_t            last)
+{
+    uint32_t first_mask = UINT32_MAX << (first & 0x1F);
+    uint32_t last_mask = UINT32_MAX >> (0x1F - (last & 0x1F));
+
+    assert(first <= last);
+    assert(last <= UINT16_MAX);
+
+    first >>= 5;
+    last >>= 5;
+    if (first == last) {
+        bmap[first] &= ~(first_mask & last_mask);
+        return;
     }
-    if (sizeof(ipset_leaf_v4_t) != skHentryIPSetGetLeafSize(hentry)) {
-        skAbort();
+    bmap[first] &= ~first_mask;
+    if (last - first > 1) {
+        memset(&bmap[first + 1], 0, (last - first - 1) * sizeof(uint32_t));
     }
+    bmap[last] &= ~last_mask;
+}
 
-    /* create the set */
-    rv = ipsetCreate(&ipset, 0, 0);
-    if (rv != SKIPSET_OK) {
-        goto END;
+
+/*
+ *  found = ipsetSlash16Contains(node, ip);
+ *
+ *    Return 1 if the /16 container 'node' holds the IP whose 16 least
+ *    significant bits are 'ip', or 0 otherwise.
+ */
+static int
+ipsetSlash16Contains(
+    const ipset_slash16_t  *node,
+    uint32_t                ip)
+{
+    uint32_t i;
+
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        i = ipsetSlash16Search(node->b.vals, node->count, 1, ip);
+        return (i < node->count && node->b.vals[i] == ip);
+
+      case SET_SLASH16_RUN:
+        i = ipsetSlash16Search(node->b.vals, node->count, 2, ip);
+        return (i < node->count && node->b.vals[2 * i] <= ip);
+
+      case SET_SLASH16_BITMAP:
+        return ((node->b.bmap[ip >> 5] >> (ip & 0x1F)) & 0x1);
+
+      default:
+        skAbortBadCase(node->type);
     }
+}
 
-    /* skip over the nodes since we only need the IPs in the leaves */
-    bytes = (skHentryIPSetGetNodeCount(hentry)
-             * skHentryIPSetGetNodeSize(hentry));
-    b = skStreamRead(stream, NULL, bytes);
-    if (b != bytes) {
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+
+/*
+ *  node = ipsetSlash16Copy(src);
+ *
+ *    Return a new /16 container that holds the same IPs as 'src', or
+ *    NULL if memory cannot be allocated.
+ */
+static ipset_slash16_t *
+ipsetSlash16Copy(
+    const ipset_slash16_t  *src)
+{
+    ipset_slash16_t *node;
+    uint32_t width;
+
+    if (SET_SLASH16_BITMAP == src->type) {
+        node = ipsetSlash16Create(SET_SLASH16_BITMAP, 0);
+        if (node) {
+            memcpy(node->b.bmap, src->b.bmap, sizeof(skIPNode_t));
+            node->count = src->count;
+        }
+        return node;
     }
 
-    /* skip the first leaf, which contains no data */
-    bytes = skHentryIPSetGetLeafSize(hentry);
-    b = skStreamRead(stream, &leaf, bytes);
-    if (b != bytes) {
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+    width = ((SET_SLASH16_RUN == src->type) ? 2 : 1);
+    node = ipsetSlash16Create(src->type, width * src->count);
+    if (node) {
+        memcpy(node->b.vals, src->b.vals,
+               width * src->count * sizeof(uint16_t));
+        node->count = src->count;
     }
-    ++count;
+    return node;
+}
 
-    if (!skHeaderIsNativeByteOrder(hdr)) {
-        /* if the data is not in native byte order, we need to
-         * byte-swap the values */
-        while ((b = skStreamRead(stream, &leaf, bytes)) == bytes) {
-            ++count;
-            rv = ipsetInsertAddressIPTree(ipset, BSWAP32(leaf.ip),leaf.prefix);
-            if (rv) {
-                goto END;
-            }
+
+/*
+ *  num_ips = ipsetSlash16CountIPs(node);
+ *
+ *    Return the number of IPs in the /16 container 'node'.
+ */
+static uint32_t
+ipsetSlash16CountIPs(
+    const ipset_slash16_t  *node)
+{
+    uint32_t num_ips = 0;
+    uint32_t bits;
+    uint32_t i;
+
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        num_ips = node->count;
+        break;
+
+      case SET_SLASH16_RUN:
+        for (i = 0; i < 2 * node->count; i += 2) {
+            num_ips += 1 + node->b.vals[i + 1] - node->b.vals[i];
         }
-    } else {
-        while ((b = skStreamRead(stream, &leaf, bytes)) == bytes) {
-            ++count;
-            rv = ipsetInsertAddressIPTree(ipset, leaf.ip, leaf.prefix);
-            if (rv) {
-                goto END;
+        break;
+
+      case SET_SLASH16_BITMAP:
+        for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+            if (node->b.bmap[i]) {
+                BITS_IN_WORD32(&bits, node->b.bmap[i]);
+                num_ips += bits;
             }
         }
-    }
+        break;
 
-    if (0 != b) {
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+      default:
+        skAbortBadCase(node->type);
     }
-    assert(skHentryIPSetGetLeafCount(hentry) == count);
 
-    *ipset_out = ipset;
-    rv = SKIPSET_OK;
+    return num_ips;
+}
 
-  END:
-    if (rv != SKIPSET_OK) {
-        skIPSetDestroy(&ipset);
+
+/*
+ *  node = ipsetSlash16Create(type, capacity);
+ *
+ *    Create an empty /16 container of the specified 'type'.  For an
+ *    array or a list of runs, allocate room for 'capacity' uint16_t
+ *    values.  For a bitmap, 'capacity' is ignored.  Return NULL if
+ *    memory cannot be allocated.
+ */
+static ipset_slash16_t *
+ipsetSlash16Create(
+    uint32_t            type,
+    uint32_t            capacity)
+{
+    ipset_slash16_t *node;
+
+    node = (ipset_slash16_t*)calloc(1, sizeof(ipset_slash16_t));
+    if (NULL == node) {
+        return NULL;
     }
-    return rv;
+    node->type = type;
+    if (SET_SLASH16_BITMAP == type) {
+        node->b.bmap = (uint32_t*)calloc(SKIP_BBLOCK_SIZE, sizeof(uint32_t));
+        if (NULL == node->b.bmap) {
+            free(node);
+            return NULL;
+        }
+    } else {
+        if (capacity < 2) {
+            capacity = 2;
+        }
+        node->b.vals = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+        if (NULL == node->b.vals) {
+            free(node);
+            return NULL;
+        }
+        node->capacity = capacity;
+    }
+    return node;
 }
 
 
 /*
- *  status = ipsetReadRadixIntoRadix(&ipset, stream, hdr, is_ipv6);
- *
- *    Helper function for skIPSetRead() via ipsetReadRadix().
+ *  ipsetSlash16Destroy(node);
  *
- *    Read an IPset in the IPSET_REC_VERSION_RADIX format from
- *    'stream' and create a radix-tree IPset data structure.
+ *    Free the /16 container 'node'.  Do nothing if 'node' is NULL.
+ */
+static void
+ipsetSlash16Destroy(
+    ipset_slash16_t    *node)
+{
+    if (node) {
+        if (SET_SLASH16_BITMAP == node->type) {
+            free(node->b.bmap);
+        } else {
+            free(node->b.vals);
+        }
+        free(node);
+    }
+}
+
+
+/*
+ *  ipsetSlash16FillBitmap(node, bmap);
  *
- *    See '#define IPSET_REC_VERSION_RADIX' for description of the
- *    file format.
+ *    Set the bits in the 65536-bit bitmap 'bmap' for the IPs in the
+ *    /16 container 'node'.  Bits that are already set in 'bmap' are
+ *    not modified.
  */
-static int
-ipsetReadRadixIntoRadix(
-    skipset_t         **ipset_out,
-    skstream_t         *stream,
-    sk_file_header_t   *hdr,
-    int                 is_ipv6)
+static void
+ipsetSlash16FillBitmap(
+    const ipset_slash16_t  *node,
+    uint32_t               *bmap)
 {
-    skipset_t *ipset = NULL;
-    sk_header_entry_t *hentry;
-    ssize_t bytes;
-    ssize_t b;
-    size_t i;
-    int rv;
+    const uint32_t *src;
+    const uint16_t *vals;
+    uint32_t i;
 
-    /* sanity check input */
-    assert(ipset_out);
-    assert(stream);
-    if (skStreamCheckSilkHeader(stream, FT_IPSET, IPSET_REC_VERSION_RADIX,
-                                IPSET_REC_VERSION_RADIX, NULL))
-    {
-        skAbort();
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        vals = node->b.vals;
+        for (i = 0; i < node->count; ++i) {
+            bmap[vals[i] >> 5] |= (1u << (vals[i] & 0x1F));
+        }
+        break;
+
+      case SET_SLASH16_RUN:
+        vals = node->b.vals;
+        for (i = 0; i < 2 * node->count; i += 2) {
+            ipsetSlash16SetRange(bmap, vals[i], vals[i + 1]);
+        }
+        break;
+
+      case SET_SLASH16_BITMAP:
+        src = node->b.bmap;
+        for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+            bmap[i] |= src[i];
+        }
+        break;
+
+      default:
+        skAbortBadCase(node->type);
     }
-    if (skHeaderGetRecordLength(hdr) != 1) {
-        skAbort();
+}
+
+
+/*
+ *  num_runs = ipsetSlash16FindRuns(bmap, runs);
+ *
+ *    Helper function for reading and writing the
+ *    IPSET_REC_VERSION_SLASH16 format.
+ *
+ *    Find the ranges of consecutive high bits in the 65536-bit bitmap
+ *    'bmap', fill 'runs' with the first and last bit position of each
+ *    range, and return the number of ranges.  'runs' must have room
+ *    for SET_SLASH16_MAX_VALUES uint16_t values.
+ */
+static uint32_t
+ipsetSlash16FindRuns(
+    const uint32_t     *bmap,
+    uint16_t           *runs)
+{
+    uint32_t num_runs = 0;
+    uint32_t in_run = 0;
+    uint32_t word;
+    uint32_t bit;
+    uint32_t i;
+
+    for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+        word = bmap[i];
+        /* skip words that do not change the state of the run */
+        if (word == (in_run ? UINT32_MAX : 0)) {
+            continue;
+        }
+        for (bit = 0; bit < 32; ++bit) {
+            if (((word >> bit) & 0x1) == in_run) {
+                continue;
+            }
+            if (in_run) {
+                runs[2 * num_runs + 1] = (uint16_t)((i << 5) + bit - 1);
+                ++num_runs;
+            } else {
+                runs[2 * num_runs] = (uint16_t)((i << 5) + bit);
+            }
+            in_run = !in_run;
+        }
     }
-    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
-    if (NULL == hentry) {
-        skAbort();
+    if (in_run) {
+        runs[2 * num_runs + 1] = UINT16_MAX;
+        ++num_runs;
     }
 
-    /* create the set */
-    rv = ipsetCreate(&ipset, is_ipv6, 1);
-    if (rv != SKIPSET_OK) {
-        goto END;
-    }
+    return num_runs;
+}
 
-    /* if no nodes or only node#0, root is a leaf */
-    IPSET_ROOT_INDEX_SET(ipset, skHentryIPSetGetRootIndex(hentry),
-                         (skHentryIPSetGetNodeCount(hentry) <= 1));
 
-    if (skStreamIsSeekable(stream)
-        && skHeaderIsNativeByteOrder(hdr)
-        && (SK_COMPMETHOD_NONE == skHeaderGetCompressionMethod(hdr)))
-    {
-        /* attempt to mmap() the file */
+/*
+ *  num_ips = ipsetSlash16FindValues(bmap, vals);
+ *
+ *    Helper function for ipsetSlash16Optimize() and
+ *    ipsetWriteSlash16Container().
+ *
+ *    Fill 'vals' with the position of each high bit in the 65536-bit
+ *    bitmap 'bmap' in ascending order, and return the number of high
+ *    bits.  'vals' must have room for that many uint16_t values.
+ */
+static uint32_t
+ipsetSlash16FindValues(
+    const uint32_t     *bmap,
+    uint16_t           *vals)
+{
+    uint32_t num_ips = 0;
+    uint32_t word;
+    uint32_t bit;
+    uint32_t i;
 
-        /* get file size and offset where the data begins */
-        off_t file_size = skFileSize(skStreamGetPathname(stream));
-        off_t data_start = skStreamTell(stream);
-        uint8_t *buf;
+    for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+        for (word = bmap[i], bit = 0; word; word >>= 1, ++bit) {
+            if (word & 0x1) {
+                vals[num_ips++] = (uint16_t)((i << 5) | bit);
+            }
+        }
+    }
+    return num_ips;
+}
 
-        if ((0 < data_start) && (data_start < file_size)
-            && (UINT32_MAX > file_size))
-        {
-            ipset->s.v3->mapped_size = (size_t)file_size;
-            ipset->s.v3->mapped_file = mmap(0, ipset->s.v3->mapped_size,
-                                            PROT_READ, MAP_SHARED,
-                                            skStreamGetDescriptor(stream), 0);
-            if (MAP_FAILED == ipset->s.v3->mapped_file) {
-                ipset->s.v3->mapped_file = NULL;
-                ipset->s.v3->mapped_size = 0;
-            } else {
-                /* this is the start of the file */
-                buf = (uint8_t*)ipset->s.v3->mapped_file;
 
-                /* move to start of data section (the nodes) */
-                buf += data_start;
-                ipset->s.v3->nodes.buf = buf;
-                ipset->s.v3->nodes.entry_count
-                    = skHentryIPSetGetNodeCount(hentry);
+/*
+ *  found = ipsetSlash16HasRange(node, first, last);
+ *
+ *    Return 1 if the /16 container 'node' holds any IP from 'first'
+ *    to 'last' inclusive, which are the 16 least significant bits of
+ *    the IPs, or 0 otherwise.
+ */
+static int
+ipsetSlash16HasRange(
+    const ipset_slash16_t  *node,
+    uint32_t                first,
+    uint32_t                last)
+{
+    const uint32_t *bmap;
+    uint32_t first_mask;
+    uint32_t last_mask;
+    uint32_t i;
 
-                /* move over the nodes (to the leaves)  */
-                buf += (skHentryIPSetGetNodeCount(hentry)
-                        * ipset->s.v3->nodes.entry_size);
-                ipset->s.v3->leaves.buf = buf;
-                ipset->s.v3->nodes.entry_count
-                    = skHentryIPSetGetLeafCount(hentry);
+    assert(first <= last);
+    assert(last <= UINT16_MAX);
 
-                /* move over the leaves to the end of the file */
-                buf += (skHentryIPSetGetLeafCount(hentry)
-                        * ipset->s.v3->leaves.entry_size);
-                if (buf >= ((uint8_t*)ipset->s.v3->mapped_file
-                            + ipset->s.v3->mapped_size))
-                {
-                    /* error */
-                    munmap(ipset->s.v3->mapped_file, ipset->s.v3->mapped_size);
-                    ipset->s.v3->mapped_file = NULL;
-                    ipset->s.v3->mapped_size = 0;
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        i = ipsetSlash16Search(node->b.vals, node->count, 1, first);
+        return (i < node->count && node->b.vals[i] <= last);
 
-                    ipset->s.v3->nodes.buf = NULL;
-                    ipset->s.v3->nodes.entry_count = 0;
+      case SET_SLASH16_RUN:
+        i = ipsetSlash16Search(node->b.vals, node->count, 2, first);
+        return (i < node->count && node->b.vals[2 * i] <= last);
 
-                    ipset->s.v3->leaves.buf = NULL;
-                    ipset->s.v3->nodes.entry_count = 0;
-                }
+      case SET_SLASH16_BITMAP:
+        bmap = node->b.bmap;
+        first_mask = UINT32_MAX << (first & 0x1F);
+        last_mask = UINT32_MAX >> (0x1F - (last & 0x1F));
+        first >>= 5;
+        last >>= 5;
+        if (first == last) {
+            return (0 != (bmap[first] & first_mask & last_mask));
+        }
+        if (bmap[first] & first_mask) {
+            return 1;
+        }
+        for (i = first + 1; i < last; ++i) {
+            if (bmap[i]) {
+                return 1;
             }
         }
+        return (0 != (bmap[last] & last_mask));
+
+      default:
+        skAbortBadCase(node->type);
     }
+}
 
-    if (NULL == ipset->s.v3->mapped_file) {
-        /* Allocate and read the nodes */
-        rv = ipsetAllocEntries(&ipset->s.v3->nodes,
-                               skHentryIPSetGetNodeCount(hentry));
-        if (rv) {
-            goto END;
-        }
 
-        bytes = (skHentryIPSetGetNodeCount(hentry)
-                 * ipset->s.v3->nodes.entry_size);
-        b = skStreamRead(stream, ipset->s.v3->nodes.buf, bytes);
-        if (b != bytes) {
-            if (b > 0) {
-                /* short read */
-                rv = SKIPSET_ERR_FILEIO;
-                goto END;
-            }
-            if (b == -1) {
-                /* read error */
-                rv = SKIPSET_ERR_FILEIO;
-                goto END;
+/*
+ *  status = ipsetSlash16Intersect(dst, src, tmp);
+ *
+ *    Helper function for ipsetContainerIntersect().
+ *
+ *    Remove from the /16 container 'dst' the IPs that are not in the
+ *    /16 container 'src'.  'tmp' is scratch space that must hold an
+ *    skIPNode_t.  Return SKIPSET_OK on success, SKIPSET_ERR_EMPTY
+ *    when 'dst' no longer holds any IPs, or SKIPSET_ERR_ALLOC if
+ *    memory cannot be allocated.
+ */
+static int
+ipsetSlash16Intersect(
+    ipset_slash16_t        *dst,
+    const ipset_slash16_t  *src,
+    uint32_t               *tmp)
+{
+    const uint32_t *src_bmap;
+    uint32_t *dst_bmap;
+    uint16_t *vals;
+    uint32_t nonzero = 0;
+    uint32_t count = 0;
+    uint32_t i;
+    int rv;
+
+    if (SET_SLASH16_ARRAY == dst->type) {
+        /* keep the values that are in 'src' */
+        vals = dst->b.vals;
+        for (i = 0; i < dst->count; ++i) {
+            if (ipsetSlash16Contains(src, vals[i])) {
+                vals[count++] = vals[i];
             }
         }
-        ipset->s.v3->nodes.entry_count = skHentryIPSetGetNodeCount(hentry);
+        dst->count = count;
+        return (count ? SKIPSET_OK : SKIPSET_ERR_EMPTY);
+    }
 
-        /* now, if the data is not in native byte order, we need to
-         * byte-swap the values */
-        if (!skHeaderIsNativeByteOrder(hdr)) {
-#if SK_ENABLE_IPV6
-            if (ipset->is_ipv6) {
-                ipset_node_v6_t *node;
-                for (i = 0, node = (ipset_node_v6_t*)ipset->s.v3->nodes.buf;
-                     i < ipset->s.v3->nodes.entry_count;
-                     ++i, ++node)
-                {
-                    node->child[0] = BSWAP32(node->child[0]);
-                    node->child[1] = BSWAP32(node->child[1]);
-                    node->ip.ip[0] = BSWAP64(node->ip.ip[0]);
-                    node->ip.ip[1] = BSWAP64(node->ip.ip[1]);
-                }
-            } else
-#endif  /* SK_ENABLE_IPV6 */
-            {
-                ipset_node_v4_t *node;
-                for (i = 0, node = (ipset_node_v4_t*)ipset->s.v3->nodes.buf;
-                     i < ipset->s.v3->nodes.entry_count;
-                     ++i, ++node)
-                {
-                    node->child[0] = BSWAP32(node->child[0]);
-                    node->child[1] = BSWAP32(node->child[1]);
-                    node->ip = BSWAP32(node->ip);
-                }
+    if (SET_SLASH16_ARRAY == src->type) {
+        /* the result is the values of 'src' that are in 'dst' */
+        vals = (uint16_t*)tmp;
+        for (i = 0; i < src->count; ++i) {
+            if (ipsetSlash16Contains(dst, src->b.vals[i])) {
+                vals[count++] = src->b.vals[i];
             }
         }
+        if (0 == count) {
+            return SKIPSET_ERR_EMPTY;
+        }
+        vals = (uint16_t*)malloc(count * sizeof(uint16_t));
+        if (NULL == vals) {
+            return SKIPSET_ERR_ALLOC;
+        }
+        memcpy(vals, tmp, count * sizeof(uint16_t));
+        if (SET_SLASH16_BITMAP == dst->type) {
+            free(dst->b.bmap);
+        } else {
+            free(dst->b.vals);
+        }
+        dst->b.vals = vals;
+        dst->type = SET_SLASH16_ARRAY;
+        dst->count = count;
+        dst->capacity = count;
+        return SKIPSET_OK;
+    }
 
-        /* Allocate and read the leaves */
-        rv = ipsetAllocEntries(&ipset->s.v3->leaves,
-                               skHentryIPSetGetLeafCount(hentry));
-        if (rv) {
-            goto END;
-        }
+    /* neither is an array; intersect the bitmaps.  The loop has no
+     * branches so the compiler may vectorize it */
+    rv = ipsetSlash16ToBitmap(dst);
+    if (rv) {
+        return rv;
+    }
+    if (SET_SLASH16_BITMAP == src->type) {
+        src_bmap = src->b.bmap;
+    } else {
+        memset(tmp, 0, sizeof(skIPNode_t));
+        ipsetSlash16FillBitmap(src, tmp);
+        src_bmap = tmp;
+    }
+    dst_bmap = dst->b.bmap;
+    for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+        dst_bmap[i] &= src_bmap[i];
+        nonzero |= dst_bmap[i];
+    }
+    return (nonzero ? SKIPSET_OK : SKIPSET_ERR_EMPTY);
+}
 
-        bytes = (skHentryIPSetGetLeafCount(hentry)
-                 * ipset->s.v3->leaves.entry_size);
-        b = skStreamRead(stream, ipset->s.v3->leaves.buf, bytes);
-        if (b != bytes) {
-            if (b > 0) {
-                /* short read */
-                rv = SKIPSET_ERR_FILEIO;
-                goto END;
+
+/*
+ *  found = ipsetSlash16Intersects(a, b);
+ *
+ *    Helper function for ipsetContainerCheckIPSet().
+ *
+ *    Return 1 if the /16 containers 'a' and 'b' have any IPs in
+ *    common, or 0 otherwise.
+ */
+static int
+ipsetSlash16Intersects(
+    const ipset_slash16_t  *a,
+    const ipset_slash16_t  *b)
+{
+    const ipset_slash16_t *swap;
+    uint32_t i;
+
+    /* visit the values of an array or the ranges of a list of runs
+     * and look for them in the other container */
+    if (SET_SLASH16_BITMAP == a->type
+        || (SET_SLASH16_RUN == a->type && SET_SLASH16_ARRAY == b->type))
+    {
+        swap = a;
+        a = b;
+        b = swap;
+    }
+
+    switch (a->type) {
+      case SET_SLASH16_ARRAY:
+        for (i = 0; i < a->count; ++i) {
+            if (ipsetSlash16Contains(b, a->b.vals[i])) {
+                return 1;
             }
-            if (b == -1) {
-                /* read error */
-                rv = SKIPSET_ERR_FILEIO;
-                goto END;
+        }
+        return 0;
+
+      case SET_SLASH16_RUN:
+        for (i = 0; i < 2 * a->count; i += 2) {
+            if (ipsetSlash16HasRange(b, a->b.vals[i], a->b.vals[i + 1])) {
+                return 1;
             }
         }
-        ipset->s.v3->leaves.entry_count = skHentryIPSetGetLeafCount(hentry);
+        return 0;
 
-        /* now, if the data is not in native byte order, we need to
-         * byte-swap the values */
-        if (!skHeaderIsNativeByteOrder(hdr)) {
-#if SK_ENABLE_IPV6
-            if (ipset->is_ipv6) {
-                ipset_leaf_v6_t *leaf;
-                for (i = 0, leaf = (ipset_leaf_v6_t*)ipset->s.v3->leaves.buf;
-                     i < ipset->s.v3->leaves.entry_count;
-                     ++i, ++leaf)
-                {
-                    leaf->ip.ip[0] = BSWAP64(leaf->ip.ip[0]);
-                    leaf->ip.ip[1] = BSWAP64(leaf->ip.ip[1]);
-                }
-            } else
-#endif  /* SK_ENABLE_IPV6 */
-            {
-                ipset_leaf_v4_t *leaf;
-                for (i = 0, leaf = (ipset_leaf_v4_t*)ipset->s.v3->leaves.buf;
-                     i < ipset->s.v3->leaves.entry_count;
-                     ++i, ++leaf)
-                {
-                    leaf->ip = BSWAP32(leaf->ip);
-                }
+      case SET_SLASH16_BITMAP:
+        for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+            if (a->b.bmap[i] & b->b.bmap[i]) {
+                return 1;
             }
         }
-    }
+        return 0;
 
-    /* check that the file is valid */
-    rv = ipsetVerify(ipset);
-    if (rv) {
-        goto END;
+      default:
+        skAbortBadCase(a->type);
     }
+}
 
-    *ipset_out = ipset;
-    rv = SKIPSET_OK;
 
-  END:
-    if (rv != SKIPSET_OK) {
-        skIPSetDestroy(&ipset);
+/*
+ *  found = ipsetSlash16NextRange(node, &pos, &first, &last);
+ *
+ *    Helper function for ipsetContainerNextRange().
+ *
+ *    Find the first range of consecutive IPs in the /16 container
+ *    'node' that begins at or after position 'pos', set 'first' and
+ *    'last' to the 16 least significant bits of the range's first
+ *    and last IPs, update 'pos' so the next call finds the following
+ *    range, and return 1.  Return 0 when there are no more ranges.
+ *    'pos' is an index into an array or into a list of runs, or a bit
+ *    position in a bitmap, and it should be 0 on the first call.
+ */
+static int
+ipsetSlash16NextRange(
+    const ipset_slash16_t  *node,
+    uint32_t               *pos,
+    uint32_t               *first,
+    uint32_t               *last)
+{
+    const uint32_t *bmap;
+    const uint16_t *vals;
+    uint32_t word;
+    uint32_t bit;
+    uint32_t i;
+
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        vals = node->b.vals;
+        i = *pos;
+        if (i >= node->count) {
+            return 0;
+        }
+        *first = *last = vals[i];
+        for (++i; i < node->count && vals[i] == *last + 1; ++i) {
+            ++*last;
+        }
+        *pos = i;
+        return 1;
+
+      case SET_SLASH16_RUN:
+        vals = node->b.vals;
+        i = *pos;
+        if (i >= node->count) {
+            return 0;
+        }
+        *first = vals[2 * i];
+        *last = vals[2 * i + 1];
+        *pos = i + 1;
+        return 1;
+
+      case SET_SLASH16_BITMAP:
+        bmap = node->b.bmap;
+        i = *pos >> 5;
+        if (i >= SKIP_BBLOCK_SIZE) {
+            return 0;
+        }
+        /* find the first high bit at or after 'pos' */
+        word = bmap[i] & (UINT32_MAX << (*pos & 0x1F));
+        while (0 == word) {
+            if (++i == SKIP_BBLOCK_SIZE) {
+                *pos = SET_SLASH16_MAX_VALUES;
+                return 0;
+            }
+            word = bmap[i];
+        }
+        BITS_IN_WORD32(&bit, (word & (~word + 1)) - 1);
+        *first = (i << 5) + bit;
+        /* find the first low bit after 'first' */
+        word = ~bmap[i] & (UINT32_MAX << bit);
+        while (0 == word) {
+            if (++i == SKIP_BBLOCK_SIZE) {
+                *last = UINT16_MAX;
+                *pos = SET_SLASH16_MAX_VALUES;
+                return 1;
+            }
+            word = ~bmap[i];
+        }
+        BITS_IN_WORD32(&bit, (word & (~word + 1)) - 1);
+        *last = (i << 5) + bit - 1;
+        *pos = *last + 1;
+        return 1;
+
+      default:
+        skAbortBadCase(node->type);
     }
-    return rv;
 }
 
 
 /*
- *  status = ipsetReadRadix(&ipset, stream, hdr);
+ *  status = ipsetSlash16Optimize(node, tmp);
  *
- *    Helper function for skIPSetRead().
- *
- *    Read an IPset in the IPSET_REC_VERSION_RADIX format from
- *    'stream'.
+ *    Helper function for ipsetContainerClean().
  *
- *    This function reads the header then calls another helper
- *    function depending on the data structure being used.
+ *    Convert the /16 container 'node' to the type that uses the least
+ *    memory, using the same rule as the IPSET_REC_VERSION_SLASH16
+ *    writer, and set the count of IPs in a bitmap.  'tmp' is scratch
+ *    space that must hold an skIPNode_t.  Return SKIPSET_ERR_EMPTY if
+ *    'node' holds no IPs, or SKIPSET_OK otherwise.  If memory cannot
+ *    be allocated, 'node' is left unchanged.
  */
 static int
-ipsetReadRadix(
-    skipset_t         **ipset_out,
-    skstream_t         *stream,
-    sk_file_header_t   *hdr)
-{
-    sk_header_entry_t *hentry;
-    int is_ipv6;
+ipsetSlash16Optimize(
+    ipset_slash16_t    *node,
+    uint32_t           *tmp)
+{
+    const uint32_t *bmap;
+    uint16_t *vals;
+    uint32_t num_ips = 0;
+    uint32_t num_runs = 0;
+    uint32_t carry = 0;
+    uint32_t word;
+    uint32_t bits;
+    uint32_t type;
+    uint32_t i;
 
-    hentry = skHeaderGetFirstMatch(hdr, SK_HENTRY_IPSET_ID);
-    if (NULL == hentry) {
-        return SKIPSET_ERR_FILEHEADER;
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        num_ips = node->count;
+        for (i = 0; i < node->count; ++i) {
+            if (0 == i || node->b.vals[i] != node->b.vals[i - 1] + 1) {
+                ++num_runs;
+            }
+        }
+        break;
+
+      case SET_SLASH16_RUN:
+        num_ips = ipsetSlash16CountIPs(node);
+        num_runs = node->count;
+        break;
+
+      case SET_SLASH16_BITMAP:
+        for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+            word = node->b.bmap[i];
+            if (word) {
+                BITS_IN_WORD32(&bits, word);
+                num_ips += bits;
+                /* a run begins at each high bit whose lower
+                 * neighbor is low */
+                BITS_IN_WORD32(&bits, word & ~((word << 1) | carry));
+                num_runs += bits;
+            }
+            carry = word >> 31;
+        }
+        break;
+
+      default:
+        skAbortBadCase(node->type);
     }
 
-    /* Verify that children/node is what we expect */
-    if (IPSET_NUM_CHILDREN != skHentryIPSetGetChildPerNode(hentry)) {
-        return SKIPSET_ERR_FILEHEADER;
+    if (0 == num_ips) {
+        return SKIPSET_ERR_EMPTY;
+    }
+    if (SET_SLASH16_BITMAP == node->type) {
+        node->count = num_ips;
     }
 
-    /* See if leaf and node sizes are for IPv4 or IPv6.  We must check
-     * IPv4 first, since IPv4 and IPv6 sizes are identical when SiLK
-     * is built without IPv6 support */
-    if (sizeof(ipset_leaf_v4_t) == skHentryIPSetGetLeafSize(hentry)
-        && sizeof(ipset_node_v4_t) == skHentryIPSetGetNodeSize(hentry))
-    {
-        is_ipv6 = 0;
+    type = ipsetSlash16ChooseType(num_ips, num_runs);
+    if (type == node->type) {
+        return SKIPSET_OK;
     }
-    else if (sizeof(ipset_leaf_v6_t) == skHentryIPSetGetLeafSize(hentry)
-             && sizeof(ipset_node_v6_t) == skHentryIPSetGetNodeSize(hentry))
-    {
-        is_ipv6 = 1;
-#if  !SK_ENABLE_IPV6
-        /* IPv6 IPSet not supported by this build of SiLK */
-        return SKIPSET_ERR_IPV6;
-#endif
+    if (SET_SLASH16_BITMAP == type) {
+        if (0 == ipsetSlash16ToBitmap(node)) {
+            node->count = num_ips;
+        }
+        return SKIPSET_OK;
+    }
+
+    /* get the IPs as a bitmap, then find the values or the runs */
+    if (SET_SLASH16_BITMAP == node->type) {
+        bmap = node->b.bmap;
     } else {
-        /* Unrecognized record sizes */
-        return SKIPSET_ERR_FILEHEADER;
+        memset(tmp, 0, sizeof(skIPNode_t));
+        ipsetSlash16FillBitmap(node, tmp);
+        bmap = tmp;
+    }
+    if (SET_SLASH16_ARRAY == type) {
+        vals = (uint16_t*)malloc(num_ips * sizeof(uint16_t));
+        if (NULL == vals) {
+            return SKIPSET_OK;
+        }
+        ipsetSlash16FindValues(bmap, vals);
+        node->count = num_ips;
+    } else {
+        vals = (uint16_t*)malloc(2 * num_runs * sizeof(uint16_t));
+        if (NULL == vals) {
+            return SKIPSET_OK;
+        }
+        ipsetSlash16FindRuns(bmap, vals);
+        node->count = num_runs;
     }
+    if (SET_SLASH16_BITMAP == node->type) {
+        free(node->b.bmap);
+    } else {
+        free(node->b.vals);
+    }
+    node->b.vals = vals;
+    node->type = type;
+    node->capacity = ((SET_SLASH16_ARRAY == type) ? num_ips : 2 * num_runs);
+    return SKIPSET_OK;
+}
 
-    /* check for an empty IPset */
-    if (0 == skHentryIPSetGetNodeCount(hentry)
-        && 0 == skHentryIPSetGetLeafCount(hentry))
-    {
-        if (!is_ipv6 && IPSET_USE_IPTREE) {
-            return ipsetCreate(ipset_out, 0, 0);
+
+/*
+ *  status = ipsetSlash16RemoveRange(node, first, last);
+ *
+ *    Helper function for ipsetContainerRemoveRange().
+ *
+ *    Remove the IPs from 'first' to 'last' inclusive, which are the
+ *    16 least significant bits of the IPs, from the /16 container
+ *    'node'.  Return SKIPSET_OK on success, SKIPSET_ERR_EMPTY when an
+ *    array or a list of runs no longer holds any IPs, or
+ *    SKIPSET_ERR_ALLOC if memory cannot be allocated.
+ */
+static int
+ipsetSlash16RemoveRange(
+    ipset_slash16_t    *node,
+    uint32_t            first,
+    uint32_t            last)
+{
+    uint16_t keep[4];
+    uint16_t *vals;
+    uint32_t num_keep = 0;
+    uint32_t new_count;
+    uint32_t i;
+    uint32_t j;
+    int rv;
+
+    assert(first <= last);
+    assert(last <= UINT16_MAX);
+
+    switch (node->type) {
+      case SET_SLASH16_ARRAY:
+        vals = node->b.vals;
+        i = ipsetSlash16Search(vals, node->count, 1, first);
+        j = ipsetSlash16Search(vals, node->count, 1, last + 1);
+        memmove(&vals[i], &vals[j], (node->count - j) * sizeof(uint16_t));
+        node->count -= j - i;
+        return (node->count ? SKIPSET_OK : SKIPSET_ERR_EMPTY);
+
+      case SET_SLASH16_RUN:
+        /* the ranges from i to j-1 overlap the removed range; the
+         * parts of ranges i and j-1 outside of it remain */
+        vals = node->b.vals;
+        i = ipsetSlash16Search(vals, node->count, 2, first);
+        for (j = i; j < node->count && vals[2 * j] <= last; ++j)
+            ;                   /* empty */
+        if (i == j) {
+            return SKIPSET_OK;
         }
-        return ipsetCreate(ipset_out, is_ipv6, 1);
+        if (vals[2 * i] < first) {
+            keep[2 * num_keep] = vals[2 * i];
+            keep[2 * num_keep + 1] = (uint16_t)(first - 1);
+            ++num_keep;
+        }
+        if (vals[2 * j - 1] > last) {
+            keep[2 * num_keep] = (uint16_t)(last + 1);
+            keep[2 * num_keep + 1] = vals[2 * j - 1];
+            ++num_keep;
+        }
+        new_count = node->count - (j - i) + num_keep;
+        if (new_count > SET_SLASH16_RUN_MAX) {
+            break;
+        }
+        rv = ipsetSlash16Reserve(node, 2 * new_count);
+        if (rv) {
+            return rv;
+        }
+        vals = node->b.vals;
+        memmove(&vals[2 * (i + num_keep)], &vals[2 * j],
+                2 * (node->count - j) * sizeof(uint16_t));
+        memcpy(&vals[2 * i], keep, 2 * num_keep * sizeof(uint16_t));
+        node->count = new_count;
+        return (node->count ? SKIPSET_OK : SKIPSET_ERR_EMPTY);
+
+      case SET_SLASH16_BITMAP:
+        break;
+
+      default:
+        skAbortBadCase(node->type);
     }
 
-    if (!is_ipv6 && IPSET_USE_IPTREE) {
-        /* Read IPv4-only file into the IPTree format */
-        return ipsetReadRadixIntoIPTree(ipset_out, stream, hdr);
+    rv = ipsetSlash16ToBitmap(node);
+    if (rv) {
+        return rv;
     }
-    return ipsetReadRadixIntoRadix(ipset_out, stream, hdr, is_ipv6);
+    ipsetSlash16ClearRange(node->b.bmap, first, last);
+    return SKIPSET_OK;
 }
 
 
 /*
- *  rv = ipsetRemoveAddressIPTree(ipset, ipv4, prefix);
+ *  status = ipsetSlash16Reserve(node, capacity);
  *
- *    Helper function for skIPSetRemoveAddress(); may also be called
- *    by other internal functions.
+ *    Grow the values of the array or list of runs 'node' so it has
+ *    room for at least 'capacity' uint16_t values.  Return SKIPSET_OK
+ *    on success, or SKIPSET_ERR_ALLOC if memory cannot be allocated.
  */
 static int
-ipsetRemoveAddressIPTree(
-    skipset_t          *ipset,
-    uint32_t            ipv4,
-    uint32_t            prefix)
+ipsetSlash16Reserve(
+    ipset_slash16_t    *node,
+    uint32_t            capacity)
 {
-    uint32_t ipv4_end;
-
-    assert(ipset);
-    assert(1 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
-    assert(prefix > 0 || ipv4 == 0);
-    assert(prefix <= 32);
-
-    if (32 == prefix) {
-        if (ipset->s.v2->nodes[ipv4 >> 16]) {
-            skIPTreeNodeClear(ipv4, ipset->s.v2->nodes[ipv4 >> 16]);
-        }
+    uint16_t *vals;
+    uint32_t new_cap;
 
-    } else if (prefix <= 16) {
-        ipv4_end = ((UINT32_MAX >> prefix) | ipv4) >> 16;
-        ipv4 >>= 16;
-        do {
-            if (ipset->s.v2->nodes[ipv4]) {
-                free(ipset->s.v2->nodes[ipv4]);
-                ipset->s.v2->nodes[ipv4] = NULL;
-            }
-        } while (ipv4++ < ipv4_end);
+    assert(SET_SLASH16_BITMAP != node->type);
 
-    } else if (prefix <= 27) {
-        ipv4_end = ((UINT32_MAX >> prefix) | ipv4) >> 5;
-        ipv4 >>= 5;
-        if (NULL == ipset->s.v2->nodes[ipv4 >> 11]) {
-            goto END;
-        }
-        do {
-            /* nodes are allocated on /16, already shifted by 5, need
-             * to shift by 11 more to get the complete shift by 16.
-             * Mask by 0x7ff (0xffff>>5) to get addressBlock */
-            memset(&ipset->s.v2->nodes[ipv4>>11]->addressBlock[ipv4 & 0x07FF],
-                   0, sizeof(uint32_t));
-        } while (ipv4++ < ipv4_end);
+    if (capacity <= node->capacity) {
+        return SKIPSET_OK;
+    }
+    new_cap = 2 * node->capacity;
+    if (new_cap < capacity) {
+        new_cap = capacity;
+    }
+    vals = (uint16_t*)realloc(node->b.vals, new_cap * sizeof(uint16_t));
+    if (NULL == vals) {
+        return SKIPSET_ERR_ALLOC;
+    }
+    node->b.vals = vals;
+    node->capacity = new_cap;
+    return SKIPSET_OK;
+}
 
-    } else {
-        if (NULL == ipset->s.v2->nodes[ipv4 >> 16]) {
-            goto END;
+
+/*
+ *  idx = ipsetSlash16Search(vals, count, width, value);
+ *
+ *    Search the 'count' entries in 'vals', where each entry is
+ *    'width' uint16_t values and the entries are in ascending order,
+ *    and return the index of the first entry whose final value is not
+ *    less than 'value', or 'count' when there is none.  A 'width' of
+ *    1 searches an array and a 'width' of 2 searches a list of runs
+ *    by the last IP of each range.
+ */
+static uint32_t
+ipsetSlash16Search(
+    const uint16_t     *vals,
+    uint32_t            count,
+    uint32_t            width,
+    uint32_t            value)
+{
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    uint32_t mid;
+
+    while (lo < hi) {
+        mid = lo + ((hi - lo) >> 1);
+        if (vals[mid * width + width - 1] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-        ipv4_end = (UINT32_MAX >> prefix) | ipv4;
-        do {
-            skIPTreeNodeClear(ipv4, ipset->s.v2->nodes[ipv4 >> 16]);
-        } while (ipv4++ < ipv4_end);
     }
-
-  END:
-    return SKIPSET_OK;
+    return lo;
 }
 
 
 /*
- *  rv = ipsetRemoveAddressV4(ipset, ipv4, prefix, find_state);
- *  rv = ipsetRemoveAddressV6(ipset, ipv6, prefix, find_state);
+ *  ipsetSlash16SetRange(bmap, first, last);
  *
- *    Helper function for skIPSetRemoveAddress(); may also be called
- *    by other internal functions.
+ *    Helper function for reading the IPSET_REC_VERSION_SLASH16
+ *    format.
  *
- *    Remove the CIDR block ipv4/prefix or ipv6/prefix from the IPset.
+ *    Set the bits from 'first' to 'last' inclusive in the 65536-bit
+ *    bitmap 'bmap'.
+ */
+static void
+ipsetSlash16SetRange(
+    uint32_t           *bmap,
+    uint32_t            first,
+    uint32_t            last)
+{
+    uint32_t first_mask = UINT32_MAX << (first & 0x1F);
+    uint32_t last_mask = UINT32_MAX >> (0x1F - (last & 0x1F));
+
+    assert(first <= last);
+    assert(last <= UINT16_MAX);
+
+    first >>= 5;
+    last >>= 5;
+    if (first == last) {
+        bmap[first] |= (first_mask & last_mask);
+        return;
+    }
+    bmap[first] |= first_mask;
+    if (last - first > 1) {
+        memset(&bmap[first + 1], 0xFF, (last - first - 1) * sizeof(uint32_t));
+    }
+    bmap[last] |= last_mask;
+}
+
+
+/*
+ *  status = ipsetSlash16Subtract(dst, src);
  *
- *    'find_state' should be NULL or the result of calling
- *    ipsetFindV4() or ipsetFindV6() on the ip/prefix pair.  When
- *    'find_state' is NULL, this function does the address search
- *    itself.
+ *    Helper function for ipsetContainerSubtract().
  *
- *    Return SKIPSET_OK if the address block was successfully removed
- *    or if the address block does not appear in the IPset.  Return
- *    SKIPSET_ERR_ALLOC if there is a memory allocation error.
+ *    Remove from the /16 container 'dst' the IPs that are in the /16
+ *    container 'src'.  Return SKIPSET_OK on success, SKIPSET_ERR_EMPTY
+ *    when 'dst' no longer holds any IPs, or SKIPSET_ERR_ALLOC if
+ *    memory cannot be allocated.
  */
 static int
-ipsetRemoveAddressV4(
-    skipset_t          *ipset,
-    const uint32_t      ipv4,
-    const uint32_t      prefix,
-    const ipset_find_t *find_state)
-{
-    ipset_find_t find_state_local;
-    ipset_node_v4_t *parent = NULL;
-    ipset_leaf_v4_t *leaf;
-    uint32_t which_child;
+ipsetSlash16Subtract(
+    ipset_slash16_t        *dst,
+    const ipset_slash16_t  *src)
+{
+    const uint32_t *src_bmap;
+    uint32_t *dst_bmap;
+    uint16_t *vals;
+    uint32_t nonzero = 0;
+    uint32_t count = 0;
     uint32_t i;
-    uint32_t j;
     int rv;
 
-    assert(ipset);
-    assert(sizeof(ipset_node_v4_t) == ipset->s.v3->nodes.entry_size);
-    assert(prefix > 0 || ipv4 == 0);
-    assert(prefix <= 32);
-    assert(0 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
+    if (SET_SLASH16_ARRAY == dst->type) {
+        /* keep the values that are not in 'src' */
+        vals = dst->b.vals;
+        for (i = 0; i < dst->count; ++i) {
+            if (!ipsetSlash16Contains(src, vals[i])) {
+                vals[count++] = vals[i];
+            }
+        }
+        dst->count = count;
+        return (count ? SKIPSET_OK : SKIPSET_ERR_EMPTY);
+    }
 
-    /* use the passed in 'find_state' if given */
-    if (find_state) {
-        rv = find_state->result;
-    } else {
-        rv = ipsetFindV4(ipset, ipv4, prefix, &find_state_local);
-        /* if IP was not found, we can return */
-        if (SKIPSET_ERR_NOTFOUND == rv
-            || SKIPSET_ERR_EMPTY == rv
-            || SKIPSET_ERR_MULTILEAF == rv)
-        {
-            return SKIPSET_OK;
+    rv = ipsetSlash16ToBitmap(dst);
+    if (rv) {
+        return rv;
+    }
+    dst_bmap = dst->b.bmap;
+    switch (src->type) {
+      case SET_SLASH16_ARRAY:
+        vals = src->b.vals;
+        for (i = 0; i < src->count; ++i) {
+            dst_bmap[vals[i] >> 5] &= ~(1u << (vals[i] & 0x1F));
         }
-        find_state = &find_state_local;
+        break;
+
+      case SET_SLASH16_RUN:
+        vals = src->b.vals;
+        for (i = 0; i < 2 * src->count; i += 2) {
+            ipsetSlash16ClearRange(dst_bmap, vals[i], vals[i + 1]);
+        }
+        break;
+
+      case SET_SLASH16_BITMAP:
+        src_bmap = src->b.bmap;
+        for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+            dst_bmap[i] &= ~src_bmap[i];
+        }
+        break;
+
+      default:
+        skAbortBadCase(src->type);
     }
-    ipset->is_dirty = 1;
+    for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+        nonzero |= dst_bmap[i];
+    }
+    return (nonzero ? SKIPSET_OK : SKIPSET_ERR_EMPTY);
+}
 
-    /* if we matched a CIDR block in the IPset that is larger than the
-     * block/address we want to remove, we must break the CIDR
-     * block. */
-    if ((SKIPSET_OK == rv) && (find_state->bitpos < prefix)) {
-        uint32_t old_ipv4, mid_ipv4, old_prefix;
 
-        assert(1 == find_state->node_is_leaf);
+/*
+ *  status = ipsetSlash16ToBitmap(node);
+ *
+ *    Convert the /16 container 'node' to a bitmap.  Do nothing if
+ *    'node' is already a bitmap.  The count of IPs in the bitmap is
+ *    set to 0 since it is not known until the set is cleaned.  Return
+ *    SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory cannot be
+ *    allocated, in which case 'node' is unchanged.
+ */
+static int
+ipsetSlash16ToBitmap(
+    ipset_slash16_t    *node)
+{
+    uint32_t *bmap;
 
-        leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
-        old_ipv4 = leaf->ip;
-        old_prefix = leaf->prefix;
+    if (SET_SLASH16_BITMAP == node->type) {
+        return SKIPSET_OK;
+    }
+    bmap = (uint32_t*)calloc(SKIP_BBLOCK_SIZE, sizeof(uint32_t));
+    if (NULL == bmap) {
+        return SKIPSET_ERR_ALLOC;
+    }
+    ipsetSlash16FillBitmap(node, bmap);
+    free(node->b.vals);
+    node->b.bmap = bmap;
+    node->type = SET_SLASH16_BITMAP;
+    node->count = 0;
+    node->capacity = 0;
+    return SKIPSET_OK;
+}
 
-        /* remove the current IP */
-        if (IPSET_NO_PARENT == find_state->parent_idx) {
-            skIPSetRemoveAll(ipset);
-        } else {
-            parent = NODE_PTR_V4(ipset, find_state->parent_idx);
-            which_child = WHICH_CHILD_V4(leaf->ip, parent->prefix);
-            if (NUM_BITS <= leaf->prefix - parent->prefix) {
-                /* leaf occupies a single child[] entry */
-                parent->child[which_child] = 0;
-                NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
+
+/*
+ *  status = ipsetSlash16Union(dst, src, tmp);
+ *
+ *    Helper function for ipsetContainerUnion().
+ *
+ *    Add to the /16 container 'dst' the IPs in the /16 container
+ *    'src'.  Two arrays or two lists of runs are merged when the
+ *    result fits the same type; otherwise the result is a bitmap.
+ *    'tmp' is scratch space that must hold an skIPNode_t.  Return
+ *    SKIPSET_OK on success, or SKIPSET_ERR_ALLOC if memory cannot be
+ *    allocated.
+ */
+static int
+ipsetSlash16Union(
+    ipset_slash16_t        *dst,
+    const ipset_slash16_t  *src,
+    uint32_t               *tmp)
+{
+    const uint16_t *a;
+    const uint16_t *b;
+    uint16_t *out = (uint16_t*)tmp;
+    uint32_t count = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    int rv;
+
+    if (SET_SLASH16_ARRAY == dst->type && SET_SLASH16_ARRAY == src->type
+        && dst->count + src->count <= SET_SLASH16_ARRAY_MAX)
+    {
+        /* merge the sorted arrays into 'tmp' */
+        a = dst->b.vals;
+        b = src->b.vals;
+        while (i < dst->count && j < src->count) {
+            if (a[i] < b[j]) {
+                out[count++] = a[i++];
+            } else if (a[i] > b[j]) {
+                out[count++] = b[j++];
             } else {
-                for (i = which_child, j = 0;
-                     j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
-                     ++i, ++j)
-                {
-                    parent->child[i] = 0;
-                }
-                NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
-                NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
+                out[count++] = a[i++];
+                ++j;
             }
-            LEAFIDX_FREE(ipset, find_state->node_idx);
         }
+        while (i < dst->count) {
+            out[count++] = a[i++];
+        }
+        while (j < src->count) {
+            out[count++] = b[j++];
+        }
+        rv = ipsetSlash16Reserve(dst, count);
+        if (rv) {
+            return rv;
+        }
+        memcpy(dst->b.vals, out, count * sizeof(uint16_t));
+        dst->count = count;
+        return SKIPSET_OK;
+    }
 
-        /* insert all IPs not part of the removed block */
-        do {
-            ++old_prefix;
-            /* find midpoint of this block */
-            mid_ipv4 = old_ipv4 | (1u << (32 - old_prefix));
-            if (ipv4 < mid_ipv4) {
-                /* insert upper half of old CIDR block */
-                rv = ipsetInsertAddressV4(ipset, mid_ipv4, old_prefix, NULL);
-                /* no change to old_ipv4 */
+    if (SET_SLASH16_RUN == dst->type && SET_SLASH16_RUN == src->type
+        && dst->count + src->count <= SET_SLASH16_RUN_MAX)
+    {
+        /* merge the ranges in order of their first IP into 'tmp',
+         * joining those that overlap or are adjacent */
+        a = dst->b.vals;
+        b = src->b.vals;
+        while (i < dst->count || j < src->count) {
+            const uint16_t *next;
+            if (j == src->count
+                || (i < dst->count && a[2 * i] <= b[2 * j]))
+            {
+                next = &a[2 * i++];
             } else {
-                /* insert lower half of old CIDR block */
-                rv = ipsetInsertAddressV4(ipset, old_ipv4, old_prefix, NULL);
-                /* adjust old_ipv4 to the base of the upper half */
-                old_ipv4 = mid_ipv4;
+                next = &b[2 * j++];
             }
-        } while (0 == rv && old_prefix < prefix);
+            if (count && (uint32_t)next[0] <= (uint32_t)out[2*count-1] + 1) {
+                if (next[1] > out[2 * count - 1]) {
+                    out[2 * count - 1] = next[1];
+                }
+            } else {
+                out[2 * count] = next[0];
+                out[2 * count + 1] = next[1];
+                ++count;
+            }
+        }
+        rv = ipsetSlash16Reserve(dst, 2 * count);
+        if (rv) {
+            return rv;
+        }
+        memcpy(dst->b.vals, out, 2 * count * sizeof(uint16_t));
+        dst->count = count;
+        return SKIPSET_OK;
+    }
 
-        /* all done */
+    rv = ipsetSlash16ToBitmap(dst);
+    if (rv) {
         return rv;
     }
+    ipsetSlash16FillBitmap(src, dst->b.bmap);
+    dst->count = 0;
+    return SKIPSET_OK;
+}
 
-    /* otherwise, we exactly matched the node we want to remove, or we
-     * are removing a CIDR block that is only partially populated.
-     * These cases are handled the same way: modify the parent of the
-     * node to remove the node we found. */
 
-    /* handle the simple case */
-    if (IPSET_NO_PARENT == find_state->parent_idx) {
-        return skIPSetRemoveAll(ipset);
+/*
+ *  ipsetSortLeaves(ipset);
+ *
+ *    Sort the leaves so they occur in ascending order in memory.
+ */
+static void
+ipsetSortLeaves(
+    skipset_t          *ipset)
+{
+    uint32_t to_visit[IPSET_MAX_DEPTH];
+#if   IPSET_NUM_CHILDREN < 256
+    uint8_t children[IPSET_MAX_DEPTH];
+#else
+    uint16_t children[IPSET_MAX_DEPTH];
+#endif
+    uint32_t child_idx;
+    uint32_t depth;
+    uint32_t cur;
+    ipset_node_t *node;
+
+    /* first, ensure the tree is compact */
+    ipsetCompact(ipset);
+
+    /* nothing to do if the root is a leaf */
+    if (IPSET_ROOT_IS_LEAF(ipset)) {
+        return;
     }
-    parent = NODE_PTR_V4(ipset, find_state->parent_idx);
 
-    if (SKIPSET_ERR_SUBSET == rv
-        && (NUM_BITS > prefix - parent->prefix))
-    {
-        /* need to clear multiple child[] entries */
-        which_child = WHICH_CHILD_V4(ipv4, parent->prefix);
-        for (i = which_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
-        {
-            if (parent->child[i]) {
-                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                    ipsetDestroySubtree(ipset, parent->child[i], 1);
-                    parent->child[i] = 0;
-                } else if (NODEPTR_CHILD_IS_REPEAT(parent, i)) {
-                    parent->child[i] = 0;
-                } else {
-                    LEAFIDX_FREE(ipset, parent->child[i]);
-                    parent->child[i] = 0;
-                }
+    /* the new index to assign to each leaf */
+    child_idx = 0;
+
+    /* visit the leaves in the tree to update the indexes */
+    depth = 0;
+    to_visit[depth] = IPSET_ROOT_INDEX(ipset);
+    children[depth++] = 0;
+
+    cur = 0;
+    while (depth) {
+      VISIT_NODE:
+        node = NODE_PTR(ipset, to_visit[cur]);
+        for ( ; children[cur] < IPSET_NUM_CHILDREN; ++children[cur]) {
+            if (0 == node->v4.child[children[cur]]) {
+                /* no-op */
+            } else if (!NODEPTR_CHILD_IS_LEAF(&node->v4, children[cur])) {
+                /* this is a node; push this node onto the visit list
+                 * and break out of the for() loop to visit the node
+                 * immediately */
+                to_visit[depth] = node->v4.child[children[cur]];
+                children[depth++] = 0;
+                /* we're done with this entry on the node */
+                ++children[cur];
+                ++cur;
+                goto VISIT_NODE;
+            } else if (NODEPTR_CHILD_IS_REPEAT(&node->v4, children[cur])) {
+                /* leaf is a repeat, use current child_idx */
+                node->v4.child[children[cur]] = child_idx;
+            } else {
+                /* this is a new leaf */
+                ++child_idx;
+                node->v4.child[children[cur]] = child_idx;
             }
         }
-        NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
-        NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
+        assert(IPSET_NUM_CHILDREN == children[cur]);
+        --cur;
+        --depth;
+    }
 
-        /* handle case where node has a single child */
-        ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
-        return SKIPSET_OK;
+    /* child_idx is number of leaves if we ignore the entry at 0 */
+    if (child_idx+1 != ipset->s.v3->leaves.entry_count) {
+        skAbort();
     }
 
-    if (!find_state->node_is_leaf) {
-        /* remove this node from the parent, and delete the node and
-         * everything below it */
-        parent->child[find_state->parents_child] = 0;
-        ipsetDestroySubtree(ipset, find_state->node_idx, 1);
-    } else {
-        /* remove this leaf from the parent */
-        leaf = LEAF_PTR_V4(ipset, find_state->node_idx);
-        if (NUM_BITS <= leaf->prefix - parent->prefix) {
-            /* leaf occupies a single child[] entry */
-            parent->child[find_state->parents_child] = 0;
-            NODEPTR_CHILD_CLEAR_LEAF(parent, find_state->parents_child);
-        } else {
-            /* leaf occupies multiple child[] entries */
-            which_child = WHICH_CHILD_V4(leaf->ip, parent->prefix);
-            for (i = which_child, j = 0;
-                 j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
-                 ++i, ++j)
-            {
-                parent->child[i] = 0;
-            }
-            NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
-            NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
-        }
-        LEAFIDX_FREE(ipset, find_state->node_idx);
+    /* sort the leaves, ignoring the entry at position 0 */
+#if SK_ENABLE_IPV6
+    if (ipset->is_ipv6) {
+        skQSort(ipset->s.v3->leaves.buf + ipset->s.v3->leaves.entry_size,
+                child_idx, ipset->s.v3->leaves.entry_size, ipsetLeafCompareV6);
+    } else
+#endif
+    {
+        skQSort(ipset->s.v3->leaves.buf + ipset->s.v3->leaves.entry_size,
+                child_idx, ipset->s.v3->leaves.entry_size, ipsetLeafCompareV4);
     }
+}
 
-    /* handle case where node has a single child */
-    ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
-    return SKIPSET_OK;
+
+/*
+ *  status = ipsetSubtractCallbackV4(ipv4, prefix, ipset);
+ *  status = ipsetSubtractCallbackV6(ipv6, prefix, ipset);
+ *  status = ipsetSubtractCallback(ipaddr, prefix, ipset);
+ *
+ *    Helper callback function for skIPSetSubtract().
+ *
+ *    Removes the CIDR block specified by 'ipaddr'/'prefix' from
+ *    'ipset'.
+ */
+static int
+ipsetSubtractCallbackV4(
+    uint32_t            ipv4,
+    uint32_t            prefix,
+    void               *v_ipset)
+{
+    return ipsetRemoveAddressV4((skipset_t*)v_ipset, ipv4, prefix, NULL);
 }
 
 #if SK_ENABLE_IPV6
 static int
-ipsetRemoveAddressV6(
-    skipset_t          *ipset,
+ipsetSubtractCallbackV6(
     const ipset_ipv6_t *ipv6,
-    const uint32_t      prefix,
-    const ipset_find_t *find_state)
+    uint32_t            prefix,
+    void               *v_ipset)
 {
-    ipset_find_t find_state_local;
-    ipset_node_v6_t *parent = NULL;
-    ipset_leaf_v6_t *leaf;
-    uint32_t which_child;
-    uint32_t i;
-    uint32_t j;
-    int rv;
+    return ipsetRemoveAddressV6((skipset_t*)v_ipset, ipv6, prefix, NULL);
+}
+#endif  /* SK_ENABLE_IPV6 */
 
-    assert(ipset);
-    assert(sizeof(ipset_node_v6_t) == ipset->s.v3->nodes.entry_size);
-    assert(0 < prefix && prefix <= 128);
-    assert(0 == ipset->is_iptree);
-    assert(1 == ipset->is_ipv6);
+static int
+ipsetSubtractCallback(
+    skipaddr_t         *ipaddr,
+    uint32_t            prefix,
+    void               *v_ipset)
+{
+    return skIPSetRemoveAddress((skipset_t*)v_ipset, ipaddr, prefix);
+}
 
-    /* use the passed in 'find_state' if given */
-    if (find_state) {
-        rv = find_state->result;
-    } else {
-        rv = ipsetFindV6(ipset, ipv6, prefix, &find_state_local);
-        /* if IP was not found, we can return */
-        if (SKIPSET_ERR_NOTFOUND == rv
-            || SKIPSET_ERR_EMPTY == rv
-            || SKIPSET_ERR_MULTILEAF == rv)
-        {
-            return SKIPSET_OK;
-        }
-        find_state = &find_state_local;
-    }
-    ipset->is_dirty = 1;
 
-    /* if we matched a CIDR block in the IPset that is larger than the
-     * block/address we want to remove, we must break the CIDR
-     * block. */
-    if ((SKIPSET_OK == rv) && (find_state->bitpos < prefix)) {
-        ipset_ipv6_t old_ipv6, mid_ipv6;
-        uint32_t old_prefix;
+/*
+ *  status = ipsetUnionCallbackIPTree(ipv4, prefix, ipset);
+ *  status = ipsetUnionCallbackV4(ipv4, prefix, ipset);
+ *  status = ipsetUnionCallbackV6(ipv6, prefix, ipset);
+ *  status = ipsetUnionCallback(ipaddr, prefix, ipset);
+ *
+ *    Helper callback function for skIPSetUnion().
+ *
+ *    Adds the CIDR block specified by 'ipaddr'/'prefix' to 'ipset'.
+ */
+static int
+ipsetUnionCallbackIPTree(
+    uint32_t            ipv4,
+    uint32_t            prefix,
+    void               *v_ipset)
+{
+    return ipsetInsertAddressIPTree((skipset_t*)v_ipset, ipv4, prefix);
+}
 
-        assert(1 == find_state->node_is_leaf);
+static int
+ipsetUnionCallbackV4(
+    uint32_t            ipv4,
+    uint32_t            prefix,
+    void               *v_ipset)
+{
+    return ipsetInsertAddressV4((skipset_t*)v_ipset, ipv4, prefix, NULL);
+}
 
-        leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
-        IPSET_IPV6_COPY(&old_ipv6, &leaf->ip);
-        old_prefix = leaf->prefix;
+#if SK_ENABLE_IPV6
+static int
+ipsetUnionCallbackV6(
+    const ipset_ipv6_t *ipv6,
+    uint32_t            prefix,
+    void               *v_ipset)
+{
+    return ipsetInsertAddressV6((skipset_t*)v_ipset, ipv6, prefix, NULL);
+}
+#endif  /* SK_ENABLE_IPV6 */
 
-        /* remove the current IP */
-        if (IPSET_NO_PARENT == find_state->parent_idx) {
-            skIPSetRemoveAll(ipset);
-        } else {
-            parent = NODE_PTR_V6(ipset, find_state->parent_idx);
-            which_child = WHICH_CHILD_V6(&leaf->ip, parent->prefix);
-            if (NUM_BITS <= leaf->prefix - parent->prefix) {
-                /* leaf occupies a single child[] entry */
-                parent->child[which_child] = 0;
-                NODEPTR_CHILD_CLEAR_LEAF(parent, which_child);
-            } else {
-                for (i = which_child, j = 0;
-                     j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
-                     ++i, ++j)
-                {
-                    parent->child[i] = 0;
-                }
-                NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
-                NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
-            }
-            LEAFIDX_FREE(ipset, find_state->node_idx);
-        }
+static int
+ipsetUnionCallback(
+    skipaddr_t         *ipaddr,
+    uint32_t            prefix,
+    void               *v_ipset)
+{
+    return skIPSetInsertAddress((skipset_t*)v_ipset, ipaddr, prefix);
+}
 
-        /* insert all IPs not part of the removed block */
-        IPSET_IPV6_COPY(&mid_ipv6, &old_ipv6);
-        do {
-            ++old_prefix;
-            if (old_prefix <= 64) {
-                /* find midpoint of this block */
-                mid_ipv6.ip[0]
-                    = old_ipv6.ip[0] | (UINT64_C(1) << (64 - old_prefix));
-                if (ipv6->ip[0] < mid_ipv6.ip[0]) {
-                    /* insert upper half of old CIDR block */
-                    rv = ipsetInsertAddressV6(ipset, &mid_ipv6, old_prefix,
-                                              NULL);
-                    /* no change to old_ipv6 */
-                    if (64 == old_prefix) {
-                        /* reset mid_ipv6 so it is correct for lower
-                         * half of the IP */
-                        mid_ipv6.ip[0] = old_ipv6.ip[0];
-                    }
-                } else {
-                    /* insert lower hald of old CIDR block */
-                    rv = ipsetInsertAddressV6(ipset, &old_ipv6, old_prefix,
-                                              NULL);
-                    /* adjust old_ipv6 to the base of the upper half */
-                    old_ipv6.ip[0] = mid_ipv6.ip[0];
-                }
-            } else {
-                mid_ipv6.ip[1]
-                    = old_ipv6.ip[1] | (UINT64_C(1) << (128 - old_prefix));
-                if (ipv6->ip[1] < mid_ipv6.ip[1]) {
-                    rv = ipsetInsertAddressV6(ipset, &mid_ipv6, old_prefix,
-                                              NULL);
-                } else {
-                    rv = ipsetInsertAddressV6(ipset, &old_ipv6, old_prefix,
-                                              NULL);
-                    old_ipv6.ip[1] = mid_ipv6.ip[1];
-                }
+
+/*
+ *  status = ipsetVerify(ipset);
+ *
+ *    Verify that all the indexes in a Radix-Tree based IPset are
+ *    valid---that is, less than number of allocated nodes and leaves.
+ *    Return SKIPSET_OK on success, or SKIPSET_ERR_CORRUPT on failure.
+ *    Verify that every prefix is less than the maximum.
+ */
+static int
+ipsetVerify(
+    const skipset_t    *ipset)
+{
+    uint32_t bitmap_size;
+    sk_bitmap_t *isfree = NULL;
+    uint32_t node_idx;
+    uint32_t j;
+    int rv = SKIPSET_ERR_CORRUPT;
+
+    if (NULL == ipset || 1 == ipset->is_iptree || 1 == ipset->is_container) {
+        return SKIPSET_OK;
+    }
+    if (ipset->s.v3->nodes.entry_count > ipset->s.v3->nodes.entry_capacity) {
+        return rv;
+    }
+    if (ipset->s.v3->leaves.entry_count > ipset->s.v3->leaves.entry_capacity) {
+        return rv;
+    }
+
+    if (IPSET_ISEMPTY(ipset)) {
+        return SKIPSET_OK;
+    }
+
+    if (ipset->s.v3->root_is_leaf) {
+        ipset_leaf_t *leaf;
+
+        if (IPSET_ROOT_INDEX(ipset) >= ipset->s.v3->leaves.entry_count) {
+            return rv;
+        }
+        leaf = LEAF_PTR(ipset, IPSET_ROOT_INDEX(ipset));
+        if (ipset->is_ipv6) {
+            if (leaf->v4.prefix > 128) {
+                return rv;
             }
-        } while (0 == rv && old_prefix < prefix);
+        } else if (leaf->v4.prefix > 32) {
+            return rv;
+        }
+        return SKIPSET_OK;
 
-        /* done */
+    } else if (IPSET_ROOT_INDEX(ipset) >= ipset->s.v3->nodes.entry_count) {
         return rv;
     }
 
-    /* otherwise, we exactly matched the node we want to remove, or we
-     * are removing a CIDR block that is only partially populated.
-     * These cases are handled the same way: modify the parent of the
-     * node to remove the node we found. */
+    /* create a bitmap to note which nodes and leaves are on the free
+     * list.  this is the size of the bitmap */
+    if (ipset->s.v3->nodes.entry_count > ipset->s.v3->leaves.entry_count) {
+        bitmap_size = ipset->s.v3->nodes.entry_count;
+    } else {
+        bitmap_size = ipset->s.v3->leaves.entry_count;
+    }
+    if (skBitmapCreate(&isfree, bitmap_size)) {
+        rv = SKIPSET_ERR_ALLOC;
+        goto END;
+    }
 
-    /* handle the simple case */
-    if (IPSET_NO_PARENT == find_state->parent_idx) {
-        return skIPSetRemoveAll(ipset);
+    /* fill the bitmap for nodes on the free list */
+    for (node_idx = ipset->s.v3->nodes.free_list;
+         0 != node_idx;
+         node_idx = NODEIDX_FREE_LIST(ipset, node_idx))
+    {
+        if (node_idx >= ipset->s.v3->nodes.entry_count) {
+            goto END;
+        }
+        skBitmapSetBit(isfree, node_idx);
     }
 
-    parent = NODE_PTR_V6(ipset, find_state->parent_idx);
+#if SK_ENABLE_IPV6
+    if (ipset->is_ipv6) {
+        ipset_node_v6_t *node;
+        ipset_leaf_v6_t *leaf;
 
-    if (SKIPSET_ERR_SUBSET == rv
-        && (NUM_BITS > prefix - parent->prefix))
-    {
-        /* need to clear multiple child[] entries */
-        which_child = WHICH_CHILD_V6(ipv6, parent->prefix);
-        for (i = which_child, j = 0;
-             j < (1u << (NUM_BITS - (prefix - parent->prefix)));
-             ++i, ++j)
+        for (node_idx = 0, node = (ipset_node_v6_t*)ipset->s.v3->nodes.buf;
+             node_idx < ipset->s.v3->nodes.entry_count;
+             ++node_idx, ++node)
         {
-            if (parent->child[i]) {
-                if (!NODEPTR_CHILD_IS_LEAF(parent, i)) {
-                    ipsetDestroySubtree(ipset, parent->child[i], 1);
-                    parent->child[i] = 0;
-                } else if (NODEPTR_CHILD_IS_REPEAT(parent, i)) {
-                    parent->child[i] = 0;
-                } else {
-                    LEAFIDX_FREE(ipset, parent->child[i]);
-                    parent->child[i] = 0;
+            if (skBitmapGetBit(isfree, node_idx)) {
+                continue;
+            }
+            if (node->prefix > 128) {
+                goto END;
+            }
+            for (j = 0; j < IPSET_NUM_CHILDREN; ++j) {
+                if (NODEPTR_CHILD_IS_LEAF(node, j)) {
+                    if (node->child[j] >= ipset->s.v3->leaves.entry_count) {
+                        goto END;
+                    }
+                } else if (node->child[j] >= ipset->s.v3->nodes.entry_count) {
+                    goto END;
                 }
             }
         }
-        NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
-        NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
-
-        /* handle case where node has a single child */
-        ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
-        return SKIPSET_OK;
-    }
 
-    if (!find_state->node_is_leaf) {
-        /* remove this node from the parent, and delete the node and
-         * everything below it */
-        parent->child[find_state->parents_child] = 0;
-        ipsetDestroySubtree(ipset, find_state->node_idx, 1);
-    } else {
-        /* remove this leaf from the parent */
-        leaf = LEAF_PTR_V6(ipset, find_state->node_idx);
-        if (NUM_BITS <= leaf->prefix - parent->prefix) {
-            /* leaf occupies a single child[] entry */
-            parent->child[find_state->parents_child] = 0;
-            NODEPTR_CHILD_CLEAR_LEAF(parent, find_state->parents_child);
-        } else {
-            /* leaf occupies multiple child[] entries */
-            which_child = WHICH_CHILD_V6(&leaf->ip, parent->prefix);
-            for (i = which_child, j = 0;
-                 j < (1u << (NUM_BITS - (leaf->prefix - parent->prefix)));
-                 ++i, ++j)
-            {
-                parent->child[i] = 0;
+        skBitmapClearAllBits(isfree);
+        /* mark leaves that are on the free list */
+        for (node_idx = ipset->s.v3->leaves.free_list;
+             0 != node_idx;
+             node_idx = LEAFIDX_FREE_LIST(ipset, node_idx))
+        {
+            if (node_idx >= ipset->s.v3->leaves.entry_count) {
+                goto END;
             }
-            NODEPTR_CHILD_CLEAR_LEAF2(parent, which_child, i - 1);
-            NODEPTR_CHILD_CLEAR_REPEAT2(parent, which_child, i - 1);
+            skBitmapSetBit(isfree, node_idx);
         }
-        LEAFIDX_FREE(ipset, find_state->node_idx);
-    }
 
-    /* handle case where node has a single child */
-    ipsetFixNodeSingleChild(ipset, find_state->parent_idx, 0);
-    return SKIPSET_OK;
-}
+        for (node_idx = 0, leaf = (ipset_leaf_v6_t*)ipset->s.v3->leaves.buf;
+             node_idx < ipset->s.v3->leaves.entry_count;
+             ++node_idx, ++leaf)
+        {
+            if (skBitmapGetBit(isfree, node_idx)) {
+                continue;
+            }
+            if (leaf->prefix > 128) {
+                goto END;
+            }
+        }
+    } else
 #endif  /* SK_ENABLE_IPV6 */
+    {
+        ipset_node_v4_t *node;
+        ipset_leaf_v4_t *leaf;
 
+        for (node_idx = 0, node = (ipset_node_v4_t*)ipset->s.v3->nodes.buf;
+             node_idx < ipset->s.v3->nodes.entry_count;
+             ++node_idx, ++node)
+        {
+            if (skBitmapGetBit(isfree, node_idx)) {
+                continue;
+            }
+            if (node->prefix > 32) {
+                goto END;
+            }
+            for (j = 0; j < IPSET_NUM_CHILDREN; ++j) {
+                if (NODEPTR_CHILD_IS_LEAF(node, j)) {
+                    if (node->child[j] >= ipset->s.v3->leaves.entry_count) {
+                        goto END;
+                    }
+                } else if (node->child[j] >= ipset->s.v3->nodes.entry_count) {
+                    goto END;
+                }
+            }
+        }
 
-/*
- *  new_leaf_id = ipsetReplaceNodeWithLeaf(ipset, parent, which_child);
- *
- *    Replace the node at position child['which_child'] on the node
- *    'parent' with a leaf.  Return the index of the new leaf.
- *
- *    If 'parent' is NULL, the node at the root of the 'ipset' is
- *    replaced with a leaf.
- *
- *    This function always succeeds, since destroying the node and its
- *    subtree provides leaf entries on the free_list.
- */
-static uint32_t
-ipsetReplaceNodeWithLeaf(
-    skipset_t          *ipset,
-    ipset_node_t       *parent,
-    uint32_t            which_child)
-{
-    uint32_t new_leaf_idx;
-
-    assert(ipset);
-    assert(which_child < IPSET_NUM_CHILDREN);
+        skBitmapClearAllBits(isfree);
+        /* mark leaves that are on the free list */
+        for (node_idx = ipset->s.v3->leaves.free_list;
+             0 != node_idx;
+             node_idx = LEAFIDX_FREE_LIST(ipset, node_idx))
+        {
+            if (node_idx >= ipset->s.v3->leaves.entry_count) {
+                goto END;
+            }
+            skBitmapSetBit(isfree, node_idx);
+        }
 
-    if (NULL == parent) {
-        assert(0 == IPSET_ROOT_IS_LEAF(ipset));
-        ipsetDestroySubtree(ipset, IPSET_ROOT_INDEX(ipset), 1);
-        ASSERT_OK(ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx));
-        IPSET_ROOT_INDEX_SET(ipset, new_leaf_idx, 1);
-    } else {
-        assert(0 == NODEPTR_CHILD_IS_LEAF(&parent->v4, which_child));
-        ipsetDestroySubtree(ipset, parent->v4.child[which_child], 1);
-        ASSERT_OK(ipsetNewEntries(ipset, 0, 1, NULL, &new_leaf_idx));
-        parent->v4.child[which_child] = new_leaf_idx;
-        NODEPTR_CHILD_SET_LEAF(&parent->v4, which_child);
+        for (node_idx = 0, leaf = (ipset_leaf_v4_t*)ipset->s.v3->leaves.buf;
+             node_idx < ipset->s.v3->leaves.entry_count;
+             ++node_idx, ++leaf)
+        {
+            if (skBitmapGetBit(isfree, node_idx)) {
+                continue;
+            }
+            if (leaf->prefix > 128) {
+                goto END;
+            }
+        }
     }
 
-    return new_leaf_idx;
-}
+    rv = SKIPSET_OK;
 
+  END:
+    if (isfree) {
+        skBitmapDestroy(&isfree);
+    }
+    return rv;
+}
 
 
 /*
- *  ipsetSortLeaves(ipset);
+ *  status = ipsetWalkInternalV4(ipset, callback, cb_data);
+ *  status = ipsetWalkInternalV6(ipset, callback, cb_data);
+ *
+ *    These are internal functions for walking over the contents a
+ *    Radix-Tree based IPset.  They are NOT helper functions for
+ *    skIPSetWalk().  The helper functions for skIPSetWalk() are named
+ *    ipsetWalkV4() and ipsetWalkV6().
+ *
+ *    These function visit the leaves in an IPset in order from lowest
+ *    to highest.  They will use the iterator if the IPset is clean,
+ *    or recursively walk the nodes if the IPset is dirty.
+ *
+ *    These functions always invoke the 'callback' with the IP/prefix
+ *    pair---that is they do not visit individual IP addresses.
+ *
+ *    The callback will be invoked with the IP in the form stored
+ *    internally by the IPset, eliminating the conversion to/from an
+ *    skipaddr_t that skIPSetWalk() performs.
+ *
+ *    The function stops visiting the leaves when the callback returns
+ *    a value other than SKIPSET_OK.
  *
- *    Sort the leaves so they occur in ascending order in memory.
+ *    Return SKIPSET_OK if the IPset is empty; otherwise, return the
+ *    value returned by the final call to the callback.
  */
-static void
-ipsetSortLeaves(
-    skipset_t          *ipset)
+static int
+ipsetWalkInternalV4(
+    const skipset_t    *ipset,
+    ipset_walk_v4_fn_t  callback,
+    void               *cb_data)
 {
-    uint32_t to_visit[IPSET_MAX_DEPTH];
-#if   IPSET_NUM_CHILDREN < 256
-    uint8_t children[IPSET_MAX_DEPTH];
-#else
-    uint16_t children[IPSET_MAX_DEPTH];
-#endif
-    uint32_t child_idx;
+    uint8_t is_leaf[IPSET_MAX_DEPTH_V4];
+    uint32_t to_visit[IPSET_MAX_DEPTH_V4];
+    const ipset_node_v4_t *node;
+    const ipset_leaf_v4_t *leaf;
     uint32_t depth;
-    uint32_t cur;
-    ipset_node_t *node;
+    uint32_t i;
+    int rv = SKIPSET_OK;
 
-    /* first, ensure the tree is compact */
-    ipsetCompact(ipset);
+    assert(ipset);
+    assert(0 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
+    assert(callback);
 
-    /* nothing to do if the root is a leaf */
-    if (IPSET_ROOT_IS_LEAF(ipset)) {
-        return;
+    if (IPSET_ISEMPTY(ipset)) {
+        return SKIPSET_OK;
     }
 
-    /* the new index to assign to each leaf */
-    child_idx = 0;
+    /* use the iterator if we can */
+    if (!ipset->is_dirty) {
+        uint32_t cur = IPSET_ITER_FIRST_LEAF;
+        while (0 == rv && cur < ipset->s.v3->leaves.entry_count) {
+            leaf = LEAF_PTR_V4(ipset, cur);
+            rv = callback(leaf->ip, leaf->prefix, cb_data);
+            ++cur;
+        }
+        return rv;
+    }
 
-    /* visit the leaves in the tree to update the indexes */
     depth = 0;
-    to_visit[depth] = IPSET_ROOT_INDEX(ipset);
-    children[depth++] = 0;
+    is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
 
-    cur = 0;
     while (depth) {
-      VISIT_NODE:
-        node = NODE_PTR(ipset, to_visit[cur]);
-        for ( ; children[cur] < IPSET_NUM_CHILDREN; ++children[cur]) {
-            if (0 == node->v4.child[children[cur]]) {
-                /* no-op */
-            } else if (!NODEPTR_CHILD_IS_LEAF(&node->v4, children[cur])) {
-                /* this is a node; push this node onto the visit list
-                 * and break out of the for() loop to visit the node
-                 * immediately */
-                to_visit[depth] = node->v4.child[children[cur]];
-                children[depth++] = 0;
-                /* we're done with this entry on the node */
-                ++children[cur];
-                ++cur;
-                goto VISIT_NODE;
-            } else if (NODEPTR_CHILD_IS_REPEAT(&node->v4, children[cur])) {
-                /* leaf is a repeat, use current child_idx */
-                node->v4.child[children[cur]] = child_idx;
-            } else {
-                /* this is a new leaf */
-                ++child_idx;
-                node->v4.child[children[cur]] = child_idx;
+        if (is_leaf[--depth]) {
+            /* handle a leaf node */
+            leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
+            rv = callback(leaf->ip, leaf->prefix, cb_data);
+            if (0 != rv) {
+                break;
+            }
+        } else {
+            /* push children onto the stack in reverse order */
+            node = NODE_PTR_V4(ipset, to_visit[depth]);
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]
+                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
+                    to_visit[depth++] = node->child[i];
+                }
             }
         }
-        assert(IPSET_NUM_CHILDREN == children[cur]);
-        --cur;
-        --depth;
-    }
-
-    /* child_idx is number of leaves if we ignore the entry at 0 */
-    if (child_idx+1 != ipset->s.v3->leaves.entry_count) {
-        skAbort();
     }
+    return rv;
+}
 
-    /* sort the leaves, ignoring the entry at position 0 */
 #if SK_ENABLE_IPV6
-    if (ipset->is_ipv6) {
-        skQSort(ipset->s.v3->leaves.buf + ipset->s.v3->leaves.entry_size,
-                child_idx, ipset->s.v3->leaves.entry_size, ipsetLeafCompareV6);
-    } else
-#endif
-    {
-        skQSort(ipset->s.v3->leaves.buf + ipset->s.v3->leaves.entry_size,
-                child_idx, ipset->s.v3->leaves.entry_size, ipsetLeafCompareV4);
+static int
+ipsetWalkInternalV6(
+    const skipset_t    *ipset,
+    ipset_walk_v6_fn_t  callback,
+    void               *cb_data)
+{
+    uint8_t is_leaf[IPSET_MAX_DEPTH_V6];
+    uint32_t to_visit[IPSET_MAX_DEPTH_V6];
+    const ipset_node_v6_t *node;
+    const ipset_leaf_v6_t *leaf;
+    uint32_t depth;
+    uint32_t i;
+    int rv = SKIPSET_OK;
+
+    assert(ipset);
+    assert(0 == ipset->is_iptree);
+    assert(1 == ipset->is_ipv6);
+    assert(callback);
+
+    if (IPSET_ISEMPTY(ipset)) {
+        return SKIPSET_OK;
     }
-}
 
+    /* use the iterator if we can */
+    if (!ipset->is_dirty) {
+        uint32_t cur = IPSET_ITER_FIRST_LEAF;
+        while (0 == rv && cur < ipset->s.v3->leaves.entry_count) {
+            leaf = LEAF_PTR_V6(ipset, cur);
+            rv = callback(&leaf->ip, leaf->prefix, cb_data);
+            ++cur;
+        }
+        return rv;
+    }
 
-/*
- *  status = ipsetSubtractCallbackV4(ipv4, prefix, ipset);
- *  status = ipsetSubtractCallbackV6(ipv6, prefix, ipset);
- *  status = ipsetSubtractCallback(ipaddr, prefix, ipset);
- *
- *    Helper callback function for skIPSetSubtract().
- *
- *    Removes the CIDR block specified by 'ipaddr'/'prefix' from
- *    'ipset'.
- */
-static int
-ipsetSubtractCallbackV4(
-    uint32_t            ipv4,
-    uint32_t            prefix,
-    void               *v_ipset)
-{
-    return ipsetRemoveAddressV4((skipset_t*)v_ipset, ipv4, prefix, NULL);
-}
+    depth = 0;
+    is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
 
-#if SK_ENABLE_IPV6
-static int
-ipsetSubtractCallbackV6(
-    const ipset_ipv6_t *ipv6,
-    uint32_t            prefix,
-    void               *v_ipset)
-{
-    return ipsetRemoveAddressV6((skipset_t*)v_ipset, ipv6, prefix, NULL);
+    while (depth) {
+        if (is_leaf[--depth]) {
+            /* handle a leaf node */
+            leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
+            rv = callback(&leaf->ip, leaf->prefix, cb_data);
+            if (0 != rv) {
+                break;
+            }
+        } else {
+            /* push children onto the stack in reverse order */
+            node = NODE_PTR_V6(ipset, to_visit[depth]);
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]
+                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
+                    to_visit[depth++] = node->child[i];
+                }
+            }
+        }
+    }
+    return rv;
 }
 #endif  /* SK_ENABLE_IPV6 */
 
-static int
-ipsetSubtractCallback(
-    skipaddr_t         *ipaddr,
-    uint32_t            prefix,
-    void               *v_ipset)
-{
-    return skIPSetRemoveAddress((skipset_t*)v_ipset, ipaddr, prefix);
-}
-
 
 /*
- *  status = ipsetUnionCallbackIPTree(ipv4, prefix, ipset);
- *  status = ipsetUnionCallbackV4(ipv4, prefix, ipset);
- *  status = ipsetUnionCallbackV6(ipv6, prefix, ipset);
- *  status = ipsetUnionCallback(ipaddr, prefix, ipset);
+ *  status = ipsetWalkContainer(ipset, cidr_blocks, v6_policy, callback, cb_data);
  *
- *    Helper callback function for skIPSetUnion().
+ *    Helper function for skIPSetWalk().
  *
- *    Adds the CIDR block specified by 'ipaddr'/'prefix' to 'ipset'.
+ *    Invoke the 'callback' function on all IPs in the 'ipset' that
+ *    uses /16 containers.  The IPset does not need to be clean.
  */
 static int
-ipsetUnionCallbackIPTree(
-    uint32_t            ipv4,
-    uint32_t            prefix,
-    void               *v_ipset)
-{
-    return ipsetInsertAddressIPTree((skipset_t*)v_ipset, ipv4, prefix);
-}
-
-static int
-ipsetUnionCallbackV4(
-    uint32_t            ipv4,
-    uint32_t            prefix,
-    void               *v_ipset)
+ipsetWalkContainer(
+    const skipset_t    *ipset,
+    uint32_t            cidr_blocks,
+    sk_ipv6policy_t     v6_policy,
+    skipset_walk_fn_t   callback,
+    void               *cb_data)
 {
-    return ipsetInsertAddressV4((skipset_t*)v_ipset, ipv4, prefix, NULL);
-}
+    skipset_iterator_t iter;
+    skipaddr_t ipaddr;
+    uint32_t prefix;
+    int rv;
 
-#if SK_ENABLE_IPV6
-static int
-ipsetUnionCallbackV6(
-    const ipset_ipv6_t *ipv6,
-    uint32_t            prefix,
-    void               *v_ipset)
-{
-    return ipsetInsertAddressV6((skipset_t*)v_ipset, ipv6, prefix, NULL);
-}
-#endif  /* SK_ENABLE_IPV6 */
+    assert(ipset);
+    assert(1 == ipset->is_container);
 
-static int
-ipsetUnionCallback(
-    skipaddr_t         *ipaddr,
-    uint32_t            prefix,
-    void               *v_ipset)
-{
-    return skIPSetInsertAddress((skipset_t*)v_ipset, ipaddr, prefix);
+    /* bind the iterator directly since the IPset may be dirty */
+    memset(&iter, 0, sizeof(skipset_iterator_t));
+    iter.ipset = ipset;
+    iter.v6policy = v6_policy;
+    iter.cidr_blocks = (cidr_blocks ? 1 : 0);
+    skIPSetIteratorReset(&iter);
+
+    while (skIPSetIteratorNext(&iter, &ipaddr, &prefix) == SK_ITERATOR_OK) {
+        rv = (*callback)(&ipaddr, prefix, cb_data);
+        if (rv) {
+            return rv;
+        }
+    }
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetVerify(ipset);
+ *  status = ipsetWalkIPTree(ipset, walk_state);
  *
- *    Verify that all the indexes in a Radix-Tree based IPset are
- *    valid---that is, less than number of allocated nodes and leaves.
- *    Return SKIPSET_OK on success, or SKIPSET_ERR_CORRUPT on failure.
- *    Verify that every prefix is less than the maximum.
+ *    Helper function for skIPSetWalk().
+ *
+ *    Invoke the 'callback' function on all IPs in the 'ipset'.
  */
 static int
-ipsetVerify(
-    const skipset_t    *ipset)
+ipsetWalkIPTree(
+    const skipset_t    *ipset,
+    uint32_t            cidr_blocks,
+    sk_ipv6policy_t     v6_policy,
+    skipset_walk_fn_t   callback,
+    void               *cb_data)
 {
-    uint32_t bitmap_size;
-    sk_bitmap_t *isfree = NULL;
-    uint32_t node_idx;
-    uint32_t j;
-    int rv = SKIPSET_ERR_CORRUPT;
+    skipaddr_t ipaddr;
+    int rv = SKIPSET_OK;
 
-    if (NULL == ipset || 1 == ipset->is_iptree) {
-        return SKIPSET_OK;
-    }
-    if (ipset->s.v3->nodes.entry_count > ipset->s.v3->nodes.entry_capacity) {
-        return rv;
-    }
-    if (ipset->s.v3->leaves.entry_count > ipset->s.v3->leaves.entry_capacity) {
-        return rv;
-    }
+    assert(ipset);
+    assert(1 == ipset->is_iptree);
+    assert(0 == ipset->is_ipv6);
 
-    if (IPSET_ISEMPTY(ipset)) {
+    if (SK_IPV6POLICY_ONLY == v6_policy) {
+        /* caller wants only IPv6 addresses, and there are none in an
+         * IPv4 IPset. */
         return SKIPSET_OK;
     }
-
-    if (ipset->s.v3->root_is_leaf) {
-        ipset_leaf_t *leaf;
-
-        if (IPSET_ROOT_INDEX(ipset) >= ipset->s.v3->leaves.entry_count) {
-            return rv;
-        }
-        leaf = LEAF_PTR(ipset, IPSET_ROOT_INDEX(ipset));
-        if (ipset->is_ipv6) {
-            if (leaf->v4.prefix > 128) {
-                return rv;
-            }
-        } else if (leaf->v4.prefix > 32) {
-            return rv;
-        }
+#if !SK_ENABLE_IPV6
+    if (SK_IPV6POLICY_FORCE == v6_policy) {
         return SKIPSET_OK;
-
-    } else if (IPSET_ROOT_INDEX(ipset) >= ipset->s.v3->nodes.entry_count) {
-        return rv;
     }
+#endif
 
-    /* create a bitmap to note which nodes and leaves are on the free
-     * list.  this is the size of the bitmap */
-    if (ipset->s.v3->nodes.entry_count > ipset->s.v3->leaves.entry_count) {
-        bitmap_size = ipset->s.v3->nodes.entry_count;
-    } else {
-        bitmap_size = ipset->s.v3->leaves.entry_count;
-    }
-    if (skBitmapCreate(&isfree, bitmap_size)) {
-        rv = SKIPSET_ERR_ALLOC;
-        goto END;
-    }
+    if (cidr_blocks) {
+        skIPTreeCIDRBlockIterator_t cidr_iter;
+        skIPTreeCIDRBlock_t cidr;
 
-    /* fill the bitmap for nodes on the free list */
-    for (node_idx = ipset->s.v3->nodes.free_list;
-         0 != node_idx;
-         node_idx = NODEIDX_FREE_LIST(ipset, node_idx))
-    {
-        if (node_idx >= ipset->s.v3->nodes.entry_count) {
-            goto END;
-        }
-        skBitmapSetBit(isfree, node_idx);
-    }
+        ASSERT_OK(skIPTreeCIDRBlockIteratorBind(&cidr_iter, ipset->s.v2));
 
 #if SK_ENABLE_IPV6
-    if (ipset->is_ipv6) {
-        ipset_node_v6_t *node;
-        ipset_leaf_v6_t *leaf;
-
-        for (node_idx = 0, node = (ipset_node_v6_t*)ipset->s.v3->nodes.buf;
-             node_idx < ipset->s.v3->nodes.entry_count;
-             ++node_idx, ++node)
-        {
-            if (skBitmapGetBit(isfree, node_idx)) {
-                continue;
-            }
-            if (node->prefix > 128) {
-                goto END;
-            }
-            for (j = 0; j < IPSET_NUM_CHILDREN; ++j) {
-                if (NODEPTR_CHILD_IS_LEAF(node, j)) {
-                    if (node->child[j] >= ipset->s.v3->leaves.entry_count) {
-                        goto END;
-                    }
-                } else if (node->child[j] >= ipset->s.v3->nodes.entry_count) {
-                    goto END;
+        if (SK_IPV6POLICY_FORCE == v6_policy) {
+            while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
+                   == SK_ITERATOR_OK)
+            {
+                skipaddrSetV6FromUint32(&ipaddr, &cidr.addr);
+                cidr.mask += 96;
+                rv = (*callback)(&ipaddr, cidr.mask, cb_data);
+                if (rv) {
+                    return rv;
                 }
             }
-        }
-
-        skBitmapClearAllBits(isfree);
-        /* mark leaves that are on the free list */
-        for (node_idx = ipset->s.v3->leaves.free_list;
-             0 != node_idx;
-             node_idx = LEAFIDX_FREE_LIST(ipset, node_idx))
-        {
-            if (node_idx >= ipset->s.v3->leaves.entry_count) {
-                goto END;
-            }
-            skBitmapSetBit(isfree, node_idx);
-        }
-
-        for (node_idx = 0, leaf = (ipset_leaf_v6_t*)ipset->s.v3->leaves.buf;
-             node_idx < ipset->s.v3->leaves.entry_count;
-             ++node_idx, ++leaf)
-        {
-            if (skBitmapGetBit(isfree, node_idx)) {
-                continue;
-            }
-            if (leaf->prefix > 128) {
-                goto END;
-            }
-        }
-    } else
+        } else
 #endif  /* SK_ENABLE_IPV6 */
-    {
-        ipset_node_v4_t *node;
-        ipset_leaf_v4_t *leaf;
-
-        for (node_idx = 0, node = (ipset_node_v4_t*)ipset->s.v3->nodes.buf;
-             node_idx < ipset->s.v3->nodes.entry_count;
-             ++node_idx, ++node)
         {
-            if (skBitmapGetBit(isfree, node_idx)) {
-                continue;
-            }
-            if (node->prefix > 32) {
-                goto END;
-            }
-            for (j = 0; j < IPSET_NUM_CHILDREN; ++j) {
-                if (NODEPTR_CHILD_IS_LEAF(node, j)) {
-                    if (node->child[j] >= ipset->s.v3->leaves.entry_count) {
-                        goto END;
-                    }
-                } else if (node->child[j] >= ipset->s.v3->nodes.entry_count) {
-                    goto END;
+            while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
+                   == SK_ITERATOR_OK)
+            {
+                skipaddrSetV4(&ipaddr, &cidr.addr);
+                rv = (*callback)(&ipaddr, cidr.mask, cb_data);
+                if (rv) {
+                    return rv;
                 }
             }
         }
 
-        skBitmapClearAllBits(isfree);
-        /* mark leaves that are on the free list */
-        for (node_idx = ipset->s.v3->leaves.free_list;
-             0 != node_idx;
-             node_idx = LEAFIDX_FREE_LIST(ipset, node_idx))
-        {
-            if (node_idx >= ipset->s.v3->leaves.entry_count) {
-                goto END;
-            }
-            skBitmapSetBit(isfree, node_idx);
-        }
+    } else {
+        skIPTreeIterator_t ip_iter;
+        uint32_t ip;
 
-        for (node_idx = 0, leaf = (ipset_leaf_v4_t*)ipset->s.v3->leaves.buf;
-             node_idx < ipset->s.v3->leaves.entry_count;
-             ++node_idx, ++leaf)
-        {
-            if (skBitmapGetBit(isfree, node_idx)) {
-                continue;
+        ASSERT_OK(skIPTreeIteratorBind(&ip_iter, ipset->s.v2));
+
+#if SK_ENABLE_IPV6
+        if (SK_IPV6POLICY_FORCE == v6_policy) {
+            while ((rv = skIPTreeIteratorNext(&ip, &ip_iter))
+                   == SK_ITERATOR_OK)
+            {
+                skipaddrSetV6FromUint32(&ipaddr, &ip);
+                rv = (*callback)(&ipaddr, 128, cb_data);
+                if (rv) {
+                    return rv;
+                }
             }
-            if (leaf->prefix > 128) {
-                goto END;
+        } else
+#endif  /* SK_ENABLE_IPV6 */
+        {
+            while ((rv = skIPTreeIteratorNext(&ip, &ip_iter))
+                   == SK_ITERATOR_OK)
+            {
+                skipaddrSetV4(&ipaddr, &ip);
+                rv = (*callback)(&ipaddr, 32, cb_data);
+                if (rv) {
+                    return rv;
+                }
             }
         }
     }
 
-    rv = SKIPSET_OK;
-
-  END:
-    if (isfree) {
-        skBitmapDestroy(&isfree);
-    }
-    return rv;
+    return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetWalkInternalV4(ipset, callback, cb_data);
- *  status = ipsetWalkInternalV6(ipset, callback, cb_data);
+ *  status = ipsetWalkV4(ipset, walk_state);
+ *  status = ipsetWalkV6(ipset, walk_state);
  *
- *    These are internal functions for walking over the contents a
- *    Radix-Tree based IPset.  They are NOT helper functions for
- *    skIPSetWalk().  The helper functions for skIPSetWalk() are named
- *    ipsetWalkV4() and ipsetWalkV6().
+ *    Helper function for skIPSetWalk().
  *
  *    These function visit the leaves in an IPset in order from lowest
  *    to highest.  They will use the iterator if the IPset is clean,
- *    or recursively walk the nodes if the IPset is dirty.
+ *    or walk the nodes if the IPset is dirty.
  *
- *    These functions always invoke the 'callback' with the IP/prefix
- *    pair---that is they do not visit individual IP addresses.
+ *    Depending on 'walk_state', the callback is invoked on the CIDR
+ *    blocks as stored in the tree or on individual IP addresses.
  *
- *    The callback will be invoked with the IP in the form stored
- *    internally by the IPset, eliminating the conversion to/from an
- *    skipaddr_t that skIPSetWalk() performs.
+ *    The callback will be invoked with the IP converted to an
+ *    skipaddr_t.  The 'walk_state' determines whether the skipaddr_t
+ *    contains an IPv4 or IPv6 representation of the IP address.
  *
  *    The function stops visiting the leaves when the callback returns
  *    a value other than SKIPSET_OK.
  *
  *    Return SKIPSET_OK if the IPset is empty; otherwise, return the
  *    value returned by the final call to the callback.
+ *
+ *    Do not confuse these helper functions for skIPSetWalk() with the
+ *    internal functions for walking over an IPset, which are
+ *    ipsetWalkInternalV4() and ipsetWalkInternalV6().
  */
 static int
-ipsetWalkInternalV4(
+ipsetWalkV4(
     const skipset_t    *ipset,
-    ipset_walk_v4_fn_t  callback,
-    void               *cb_data)
+    const ipset_walk_t *walk_state)
 {
     uint8_t is_leaf[IPSET_MAX_DEPTH_V4];
     uint32_t to_visit[IPSET_MAX_DEPTH_V4];
     const ipset_node_v4_t *node;
     const ipset_leaf_v4_t *leaf;
+    skipaddr_t ipaddr;
     uint32_t depth;
+    uint32_t ipv4;
+    uint32_t fin4;
     uint32_t i;
-    int rv = SKIPSET_OK;
+    int rv = 0;
 
     assert(ipset);
-    assert(0 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
-    assert(callback);
+    assert(walk_state);
+    assert(walk_state->callback);
+    assert(walk_state->v6policy != SK_IPV6POLICY_ONLY);
 
-    if (IPSET_ISEMPTY(ipset)) {
-        return SKIPSET_OK;
-    }
+    depth = 0;
+    is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
+    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
 
-    /* use the iterator if we can */
-    if (!ipset->is_dirty) {
-        uint32_t cur = IPSET_ITER_FIRST_LEAF;
-        while (0 == rv && cur < ipset->s.v3->leaves.entry_count) {
-            leaf = LEAF_PTR_V4(ipset, cur);
-            rv = callback(leaf->ip, leaf->prefix, cb_data);
-            ++cur;
+    if (walk_state->cidr_blocks) {
+        while (depth) {
+            if (!is_leaf[--depth]) {
+                node = NODE_PTR_V4(ipset, to_visit[depth]);
+                for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                    --i;
+                    if (node->child[i]
+                        && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                    {
+                        is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
+                        to_visit[depth++] = node->child[i];
+                    }
+                }
+            } else {
+                /* handle a leaf node */
+                leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
+#if SK_ENABLE_IPV6
+                if (SK_IPV6POLICY_FORCE == walk_state->v6policy) {
+                    skipaddrSetV6FromUint32(&ipaddr, &leaf->ip);
+                    rv = walk_state->callback(&ipaddr, 96 + leaf->prefix,
+                                              walk_state->cb_data);
+                } else
+#endif  /* SK_ENABLE_IPV6 */
+                {
+                    skipaddrSetV4(&ipaddr, &leaf->ip);
+                    rv = walk_state->callback(&ipaddr, leaf->prefix,
+                                              walk_state->cb_data);
+                }
+                if (0 != rv) {
+                    break;
+                }
+            }
         }
         return rv;
     }
 
-    depth = 0;
-    is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
-
+    /* Walk over IPset, running the callback function with each
+     * individual IP address */
     while (depth) {
-        if (is_leaf[--depth]) {
-            /* handle a leaf node */
-            leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
-            rv = callback(leaf->ip, leaf->prefix, cb_data);
-            if (0 != rv) {
-                break;
-            }
-        } else {
-            /* push children onto the stack in reverse order */
+        if (!is_leaf[--depth]) {
             node = NODE_PTR_V4(ipset, to_visit[depth]);
             for (i = IPSET_NUM_CHILDREN; i > 0; ) {
                 --i;
@@ -7784,6 +11157,50 @@ ipsetWalkInternalV4(
                     to_visit[depth++] = node->child[i];
                 }
             }
+
+#if SK_ENABLE_IPV6
+        } else if (SK_IPV6POLICY_FORCE == walk_state->v6policy) {
+            /* handle a leaf node where IPv6 addresses are to be
+             * returned */
+            leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
+            if (32 == leaf->prefix) {
+                skipaddrSetV6FromUint32(&ipaddr, &leaf->ip);
+                rv = walk_state->callback(&ipaddr, 128, walk_state->cb_data);
+            } else {
+                /* else visit each IP in the block */
+                ipv4 = leaf->ip;
+                fin4 = leaf->ip | (UINT32_MAX >> leaf->prefix);
+
+                do {
+                    skipaddrSetV6FromUint32(&ipaddr, &ipv4);
+                    rv = walk_state->callback(&ipaddr, 128,
+                                              walk_state->cb_data);
+                } while ((0 == rv) && (ipv4++ < fin4));
+            }
+            if (0 != rv) {
+                break;
+            }
+#endif  /* SK_ENABLE_IPV6 */
+
+        } else {
+            /* handle a leaf node */
+            leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
+            if (32 == leaf->prefix) {
+                skipaddrSetV4(&ipaddr, &leaf->ip);
+                rv = walk_state->callback(&ipaddr, leaf->prefix,
+                                          walk_state->cb_data);
+            } else {
+                /* else visit each IP in the block */
+                ipv4 = leaf->ip;
+                fin4 = leaf->ip | (UINT32_MAX >> leaf->prefix);
+                do {
+                    skipaddrSetV4(&ipaddr, &ipv4);
+                    rv = walk_state->callback(&ipaddr, 32, walk_state->cb_data);
+                } while ((0 == rv) && (ipv4++ < fin4));
+            }
+            if (0 != rv) {
+                break;
+            }
         }
     }
     return rv;
@@ -7791,548 +11208,773 @@ ipsetWalkInternalV4(
 
 #if SK_ENABLE_IPV6
 static int
-ipsetWalkInternalV6(
+ipsetWalkV6(
     const skipset_t    *ipset,
-    ipset_walk_v6_fn_t  callback,
-    void               *cb_data)
+    const ipset_walk_t *walk_state)
 {
     uint8_t is_leaf[IPSET_MAX_DEPTH_V6];
     uint32_t to_visit[IPSET_MAX_DEPTH_V6];
     const ipset_node_v6_t *node;
     const ipset_leaf_v6_t *leaf;
+    skipaddr_t ipaddr;
     uint32_t depth;
-    uint32_t i;
-    int rv = SKIPSET_OK;
+    ipset_ipv6_t ipv6;
+    ipset_ipv6_t fin6;
+    int i;
+    int rv = 0;
 
     assert(ipset);
-    assert(0 == ipset->is_iptree);
-    assert(1 == ipset->is_ipv6);
-    assert(callback);
+    assert(walk_state);
+    assert(walk_state->callback);
+    assert(walk_state->v6policy != SK_IPV6POLICY_IGNORE);
 
-    if (IPSET_ISEMPTY(ipset)) {
-        return SKIPSET_OK;
+    if (SK_IPV6POLICY_ASV4 != walk_state->v6policy) {
+        /* visit all the nodes in the tree */
+        depth = 0;
+        is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
+        to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+    } else {
+        /* limit to the nodes under ::ffff:0:0/96 */
+        ipset_find_t find_state;
+
+        ipv6.ip[0] = 0;
+        ipv6.ip[1] = UINT64_C(0xffff00000000);
+
+        rv = ipsetFindV6(ipset, &ipv6, 96, &find_state);
+        if (SKIPSET_OK != rv && SKIPSET_ERR_SUBSET != rv) {
+            /* no IPv4 addresses in the IPset */
+            return SKIPSET_OK;
+        }
+        depth = 0;
+        is_leaf[depth] = find_state.node_is_leaf;
+        to_visit[depth++] = find_state.node_idx;
+        rv = 0;
     }
 
-    /* use the iterator if we can */
-    if (!ipset->is_dirty) {
-        uint32_t cur = IPSET_ITER_FIRST_LEAF;
-        while (0 == rv && cur < ipset->s.v3->leaves.entry_count) {
-            leaf = LEAF_PTR_V6(ipset, cur);
-            rv = callback(&leaf->ip, leaf->prefix, cb_data);
-            ++cur;
+    if (walk_state->cidr_blocks) {
+        while (depth) {
+            if (!is_leaf[--depth]) {
+                node = NODE_PTR_V6(ipset, to_visit[depth]);
+                for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                    --i;
+                    if (node->child[i]
+                        && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                    {
+                        is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
+                        to_visit[depth++] = node->child[i];
+                    }
+                }
+            } else {
+                /* handle a leaf node */
+                leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
+                if (SK_IPV6POLICY_ASV4 == walk_state->v6policy) {
+                    IPSET_IPV6_TO_ADDR_V4(&leaf->ip, &ipaddr);
+                    rv = walk_state->callback(&ipaddr, leaf->prefix - 96,
+                                              walk_state->cb_data);
+                } else {
+                    IPSET_IPV6_TO_ADDR(&leaf->ip, &ipaddr);
+                    rv = walk_state->callback(&ipaddr, leaf->prefix,
+                                              walk_state->cb_data);
+                }
+                if (0 != rv) {
+                    break;
+                }
+            }
         }
         return rv;
     }
 
-    depth = 0;
-    is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+    /* Walk over IPset, running the callback function with each
+     * individual IP address */
+    while (depth) {
+        if (!is_leaf[--depth]) {
+            node = NODE_PTR_V6(ipset, to_visit[depth]);
+            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
+                --i;
+                if (node->child[i]
+                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
+                {
+                    is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
+                    to_visit[depth++] = node->child[i];
+                }
+            }
+
+        } else if (SK_IPV6POLICY_ASV4 == walk_state->v6policy) {
+            /* handle a leaf node where IPv4 addresses are to be
+             * returned */
+            leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
+            if (128 == leaf->prefix) {
+                IPSET_IPV6_TO_ADDR_V4(&leaf->ip, &ipaddr);
+                rv = walk_state->callback(&ipaddr, 32, walk_state->cb_data);
+            } else {
+                /* else visit each IP in the block; convert CIDR block
+                 * to current IP (ipv4) and final IP (fin4) */
+                uint32_t ipv4;
+                uint32_t fin4;
+
+                assert(96 <= leaf->prefix);
+                assert(0 == leaf->ip.ip[0]);
+                assert(UINT64_C(0x0000ffff00000000)
+                       == (UINT64_C(0xffffffff00000000) & leaf->ip.ip[1]));
+                ipv4 = (uint32_t)(UINT64_C(0x00000000ffffffff)
+                                  & leaf->ip.ip[1]);
+                fin4 = ipv4 | (UINT32_MAX >> (leaf->prefix - 96));
+
+                do {
+                    skipaddrSetV4(&ipaddr, &ipv4);
+                    rv = walk_state->callback(&ipaddr, 32,
+                                              walk_state->cb_data);
+                } while ((0 == rv) && (ipv4++ < fin4));
+            }
+            if (0 != rv) {
+                break;
+            }
+
+        } else {
+            /* handle a leaf node */
+            leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
+            if (128 == leaf->prefix) {
+                IPSET_IPV6_TO_ADDR(&leaf->ip, &ipaddr);
+                rv = walk_state->callback(&ipaddr, leaf->prefix,
+                                          walk_state->cb_data);
+            } else {
+                /* else visit each IP in the block; convert CIDR block
+                 * to current IP (ipv6) and final IP (fin6) */
+                if (leaf->prefix > 64) {
+                    ipv6.ip[0] = fin6.ip[0] = leaf->ip.ip[0];
+                    ipv6.ip[1] = leaf->ip.ip[1];
+                    fin6.ip[1] = (leaf->ip.ip[1]
+                                  | (UINT64_MAX >> (leaf->prefix - 64)));
+                } else if (leaf->prefix == 64) {
+                    ipv6.ip[0] = fin6.ip[0] = leaf->ip.ip[0];
+                    ipv6.ip[1] = fin6.ip[1] = UINT64_MAX;
+                } else {
+                    ipv6.ip[0] = leaf->ip.ip[0];
+                    fin6.ip[0] = (leaf->ip.ip[0]
+                                  | (UINT64_MAX >> leaf->prefix));
+                    ipv6.ip[1] = fin6.ip[1] = UINT64_MAX;
+                }
 
-    while (depth) {
-        if (is_leaf[--depth]) {
-            /* handle a leaf node */
-            leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
-            rv = callback(&leaf->ip, leaf->prefix, cb_data);
-            if (0 != rv) {
-                break;
-            }
-        } else {
-            /* push children onto the stack in reverse order */
-            node = NODE_PTR_V6(ipset, to_visit[depth]);
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]
-                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
-                    to_visit[depth++] = node->child[i];
+                for (;;) {
+                    IPSET_IPV6_TO_ADDR(&ipv6, &ipaddr);
+                    rv = walk_state->callback(&ipaddr,128,walk_state->cb_data);
+                    if (rv) {
+                        return rv;
+                    }
+                    if (ipv6.ip[1] < fin6.ip[1]) {
+                        ++ipv6.ip[1];
+                    } else if (ipv6.ip[0] < fin6.ip[0]) {
+                        if (ipv6.ip[1] == UINT64_MAX) {
+                            ++ipv6.ip[0];
+                            ipv6.ip[1] = 0;
+                        } else {
+                            ++ipv6.ip[1];
+                        }
+                    } else {
+                        break;
+                    }
                 }
             }
         }
     }
+
     return rv;
 }
 #endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetWalkIPTree(ipset, walk_state);
+ *  status = ipsetWriteCidrbmapFromIPTree(ipset, stream);
  *
- *    Helper function for skIPSetWalk().
+ *    Helper function for skIPSetWrite() via ipsetWriteCidrbmap().
  *
- *    Invoke the 'callback' function on all IPs in the 'ipset'.
+ *    Write an IPset from the SiLK-2 IPTree data structure to 'stream'
+ *    in the IPSET_REC_VERSION_CIDR_BMAP format.
+ *
+ *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    file format.
  */
 static int
-ipsetWalkIPTree(
+ipsetWriteCidrbmapFromIPTree(
     const skipset_t    *ipset,
-    uint32_t            cidr_blocks,
-    sk_ipv6policy_t     v6_policy,
-    skipset_walk_fn_t   callback,
-    void               *cb_data)
+    skstream_t         *stream)
 {
-    skipaddr_t ipaddr;
-    int rv = SKIPSET_OK;
+    sk_file_header_t *hdr;
+    uint8_t write_buf[sizeof(uint32_t) + sizeof(uint8_t)];
+    skIPNode_t *slash16;
+    uint32_t slash24;
+    uint32_t i;
+    uint32_t j;
+    ssize_t rv;
+    struct build_cidr_st {
+        /* starting ip for this netblock */
+        uint32_t start;
+        /* number of trailing 0s; used to set CIDR mask */
+        uint32_t trail_zero;
+        /* maximum number of /24s this block can hold */
+        uint32_t max_block;
+        /* number of the max_block we have seen so far */
+        uint32_t count;
+    } build_cidr;
 
-    assert(ipset);
-    assert(1 == ipset->is_iptree);
-    assert(0 == ipset->is_ipv6);
+#define WRITE_BUILD_CIDR                                                \
+    while (build_cidr.count) {                                          \
+        --build_cidr.trail_zero;                                        \
+        if (build_cidr.count >= (1u << (build_cidr.trail_zero - 8))) {  \
+            *(uint32_t*)write_buf = build_cidr.start;                   \
+            write_buf[sizeof(uint32_t)]                                 \
+                = (uint8_t)(32 - build_cidr.trail_zero);                \
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));   \
+            if (rv != sizeof(write_buf)) {                              \
+                return SKIPSET_ERR_FILEIO;                              \
+            }                                                           \
+            build_cidr.count -= (1 << (build_cidr.trail_zero - 8));     \
+            build_cidr.start |= (0x100 << (build_cidr.trail_zero - 8)); \
+        }                                                               \
+    }
 
-    if (SK_IPV6POLICY_ONLY == v6_policy) {
-        /* caller wants only IPv6 addresses, and there are none in an
-         * IPv4 IPset. */
-        return SKIPSET_OK;
+    /* sanity check input */
+    assert(ipset);
+    assert(stream);
+    if (ipset->is_dirty || !ipset->is_iptree || ipset->is_ipv6) {
+        skAbort();
     }
-#if !SK_ENABLE_IPV6
-    if (SK_IPV6POLICY_FORCE == v6_policy) {
-        return SKIPSET_OK;
+    hdr = skStreamGetSilkHeader(stream);
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+        skAbort();
     }
-#endif
 
-    if (cidr_blocks) {
-        skIPTreeCIDRBlockIterator_t cidr_iter;
-        skIPTreeCIDRBlock_t cidr;
+    memset(&build_cidr, 0, sizeof(build_cidr));
 
-        ASSERT_OK(skIPTreeCIDRBlockIteratorBind(&cidr_iter, ipset->s.v2));
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        /* slash16 represents a /16 */
+        slash16 = ipset->s.v2->nodes[i];
+        if (NULL == slash16) {
+            /* no data in this /16; write any CIDR range that was
+             * being built */
+            WRITE_BUILD_CIDR;
+            continue;
+        }
 
-#if SK_ENABLE_IPV6
-        if (SK_IPV6POLICY_FORCE == v6_policy) {
-            while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
-                   == SK_ITERATOR_OK)
+        /* There is data in this /16, walk over the addressBlocks by
+         * 8s, which is equivalent to visiting each /24. */
+        for (j = 0; j < SKIP_BBLOCK_SIZE; j += IPTREE_WORDS_PER_SLASH24) {
+
+            if (0 == memcmp(slash16->addressBlock + j,
+                            bmap256_zero, sizeof(bmap256_zero)))
             {
-                skipaddrSetV6FromUint32(&ipaddr, &cidr.addr);
-                cidr.mask += 96;
-                rv = (*callback)(&ipaddr, cidr.mask, cb_data);
-                if (rv) {
-                    return rv;
-                }
+                /* no data in this /24; write existing CIDR block */
+                WRITE_BUILD_CIDR;
+                continue;
             }
-        } else
-#endif  /* SK_ENABLE_IPV6 */
-        {
-            while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
-                   == SK_ITERATOR_OK)
+            if (0 == memcmp(slash16->addressBlock + j,
+                            bmap256_full, sizeof(bmap256_full)))
             {
-                skipaddrSetV4(&ipaddr, &cidr.addr);
-                rv = (*callback)(&ipaddr, cidr.mask, cb_data);
-                if (rv) {
-                    return rv;
+                /* this /24 is full; if CIDR block is being built,
+                 * this block must be contiguous with it */
+                if (build_cidr.count) {
+                    ++build_cidr.count;
+                    if (build_cidr.count == build_cidr.max_block) {
+                        /* cidr block is at its maximum size */
+                        *(uint32_t*)write_buf = build_cidr.start;
+                        write_buf[sizeof(uint32_t)]
+                            = (uint8_t)(32 - build_cidr.trail_zero);
+                        rv = skStreamWrite(stream,write_buf,sizeof(write_buf));
+                        if (rv != sizeof(write_buf)) {
+                            return SKIPSET_ERR_FILEIO;
+                        }
+                        build_cidr.count = 0;
+                    }
+                    continue;
                 }
-            }
-        }
-
-    } else {
-        skIPTreeIterator_t ip_iter;
-        uint32_t ip;
 
-        ASSERT_OK(skIPTreeIteratorBind(&ip_iter, ipset->s.v2));
+                /* no existing CIDR block to join; start a new one */
+                build_cidr.start = ((i << 16) | (j << 5)) & 0xFFFFFF00;
+                if (build_cidr.start & 0x100) {
+                    /* the third octet is odd, so this block cannot be
+                     * combined with another */
+                    *(uint32_t*)write_buf = build_cidr.start;
+                    write_buf[sizeof(uint32_t)] = 24;
+                    rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+                    if (rv != sizeof(write_buf)) {
+                        return SKIPSET_ERR_FILEIO;
+                    }
+                    continue;
+                }
 
-#if SK_ENABLE_IPV6
-        if (SK_IPV6POLICY_FORCE == v6_policy) {
-            while ((rv = skIPTreeIteratorNext(&ip, &ip_iter))
-                   == SK_ITERATOR_OK)
-            {
-                skipaddrSetV6FromUint32(&ipaddr, &ip);
-                rv = (*callback)(&ipaddr, 128, cb_data);
-                if (rv) {
-                    return rv;
+                /* compute the maximum number of blocks that can be
+                 * joined with this one by computing the number of
+                 * trailing 0s on the IP---we know the least
+                 * significant 8 bits are already 0. */
+                slash24 = build_cidr.start >> 8;
+                if (0 == slash24) {
+                    build_cidr.trail_zero = 32;
+                } else {
+                    build_cidr.trail_zero = 9;
+                    if ((slash24 & 0xFFFF) == 0) {
+                        slash24 >>= 16;
+                        build_cidr.trail_zero += 16;
+                    }
+                    if ((slash24 & 0xFF) == 0) {
+                        slash24 >>= 8;
+                        build_cidr.trail_zero += 8;
+                    }
+                    if ((slash24 & 0xF) == 0) {
+                        slash24 >>= 4;
+                        build_cidr.trail_zero += 4;
+                    }
+                    if ((slash24 & 0x3) == 0) {
+                        slash24 >>= 2;
+                        build_cidr.trail_zero += 2;
+                    }
+                    build_cidr.trail_zero -= (slash24 & 1);
                 }
+                build_cidr.max_block = (1 << (build_cidr.trail_zero - 8));
+                build_cidr.count = 1;
+                continue;
             }
-        } else
-#endif  /* SK_ENABLE_IPV6 */
-        {
-            while ((rv = skIPTreeIteratorNext(&ip, &ip_iter))
-                   == SK_ITERATOR_OK)
-            {
-                skipaddrSetV4(&ipaddr, &ip);
-                rv = (*callback)(&ipaddr, 32, cb_data);
-                if (rv) {
-                    return rv;
-                }
+
+            /* there is some data in this /24.  First, handle any CIDR
+             * range that was being build.  Then, write this block as
+             * a base address and bitmap. */
+            WRITE_BUILD_CIDR;
+
+            /* write the IP and the 'bitmap-follows' value  */
+            *(uint32_t*)write_buf = (((i << 16) | (j << 5)) & 0xFFFFFF00);
+            write_buf[sizeof(uint32_t)] = SET_CIDR_BMAP_256;
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
+            }
+            /* write the complete /24: 8 uint32_t's */
+            rv = skStreamWrite(stream, slash16->addressBlock + j,
+                               sizeof(bmap256_zero));
+            if (rv != sizeof(bmap256_zero)) {
+                return SKIPSET_ERR_FILEIO;
             }
         }
     }
 
+    rv = skStreamFlush(stream);
+    if (rv) {
+        return SKIPSET_ERR_FILEIO;
+    }
+
     return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetWalkV4(ipset, walk_state);
- *  status = ipsetWalkV6(ipset, walk_state);
- *
- *    Helper function for skIPSetWalk().
- *
- *    These function visit the leaves in an IPset in order from lowest
- *    to highest.  They will use the iterator if the IPset is clean,
- *    or walk the nodes if the IPset is dirty.
- *
- *    Depending on 'walk_state', the callback is invoked on the CIDR
- *    blocks as stored in the tree or on individual IP addresses.
- *
- *    The callback will be invoked with the IP converted to an
- *    skipaddr_t.  The 'walk_state' determines whether the skipaddr_t
- *    contains an IPv4 or IPv6 representation of the IP address.
+ *  status = ipsetWriteCidrbmapFromRadixV4(&ipset, stream, hdr);
+ *  status = ipsetWriteCidrbmapFromRadixV6(&ipset, stream, hdr);
  *
- *    The function stops visiting the leaves when the callback returns
- *    a value other than SKIPSET_OK.
+ *    Helper function for skIPSetWrite() via ipsetWriteCidrbmap().
  *
- *    Return SKIPSET_OK if the IPset is empty; otherwise, return the
- *    value returned by the final call to the callback.
+ *    Write an IPset from the radix-tree IPset data structure to
+ *    'stream' in the IPSET_REC_VERSION_CIDR_BMAP format.
  *
- *    Do not confuse these helper functions for skIPSetWalk() with the
- *    internal functions for walking over an IPset, which are
- *    ipsetWalkInternalV4() and ipsetWalkInternalV6().
+ *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    file format.
  */
 static int
-ipsetWalkV4(
+ipsetWriteCidrbmapFromRadixV4(
     const skipset_t    *ipset,
-    const ipset_walk_t *walk_state)
+    skstream_t         *stream)
 {
-    uint8_t is_leaf[IPSET_MAX_DEPTH_V4];
-    uint32_t to_visit[IPSET_MAX_DEPTH_V4];
-    const ipset_node_v4_t *node;
-    const ipset_leaf_v4_t *leaf;
-    skipaddr_t ipaddr;
-    uint32_t depth;
+    sk_file_header_t *hdr;
+    skipset_iterator_t iter;
+    struct state_st {
+        /* starting ip for this netblock, or an unmasked IP if
+         * 'is_first' is set. */
+        uint32_t  base_ip;
+        /* the 256-bit bitmap */
+        uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+        /* the prefix for 'base_ip' if 'is_first' is set */
+        uint8_t   prefix;
+        /* if set, this structure contains data */
+        uint8_t   is_dirty;
+        /* if set, base_ip holds a single, unmasked IP, and prefix is
+         * its prefix */
+        uint8_t   is_first;
+    } state;
+    /* the bitmap holds 256 bits or a /24 */
+    const uint32_t bmap_prefix = 24;
+    /* each uint32_t in the bitmap holds a /27 */
+    const uint32_t word_prefix = 27;
+    uint8_t write_buf[sizeof(uint32_t) + 1];
     uint32_t ipv4;
-    uint32_t fin4;
-    uint32_t i;
-    int rv = 0;
+    skipaddr_t ipaddr;
+    uint32_t prefix;
+    uint32_t buf_idx;
+    ssize_t rv;
 
+    /* sanity check input */
     assert(ipset);
-    assert(walk_state);
-    assert(walk_state->callback);
-    assert(walk_state->v6policy != SK_IPV6POLICY_ONLY);
+    assert(stream);
+    if (ipset->is_dirty || ipset->is_iptree || ipset->is_ipv6) {
+        skAbort();
+    }
+    hdr = skStreamGetSilkHeader(stream);
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+        skAbort();
+    }
 
-    depth = 0;
-    is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
-    to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
+    memset(&state, 0, sizeof(state));
 
-    if (walk_state->cidr_blocks) {
-        while (depth) {
-            if (!is_leaf[--depth]) {
-                node = NODE_PTR_V4(ipset, to_visit[depth]);
-                for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                    --i;
-                    if (node->child[i]
-                        && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                    {
-                        is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
-                        to_visit[depth++] = node->child[i];
-                    }
+    skIPSetIteratorBind(&iter, ipset, 1, SK_IPV6POLICY_ASV4);
+    while (skIPSetIteratorNext(&iter, &ipaddr, &prefix) == SK_ITERATOR_OK){
+        ipv4 = skipaddrGetV4(&ipaddr);
+        if (state.is_dirty && (prefix <= bmap_prefix
+                               || (state.base_ip ^ ipv4) > 0xFF))
+        {
+            /* 'ipv4' is not in the same /24 as 'state'; write the IP
+             * or bitmap currently in 'state' */
+            if (state.is_first) {
+                /* write the single ip and prefix */
+                *(uint32_t*)write_buf = state.base_ip;
+                write_buf[sizeof(uint32_t)] = (uint8_t)state.prefix;
+                rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+                if (rv != sizeof(write_buf)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
+                state.is_first = 0;
             } else {
-                /* handle a leaf node */
-                leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
-#if SK_ENABLE_IPV6
-                if (SK_IPV6POLICY_FORCE == walk_state->v6policy) {
-                    skipaddrSetV6FromUint32(&ipaddr, &leaf->ip);
-                    rv = walk_state->callback(&ipaddr, 96 + leaf->prefix,
-                                              walk_state->cb_data);
-                } else
-#endif  /* SK_ENABLE_IPV6 */
-                {
-                    skipaddrSetV4(&ipaddr, &leaf->ip);
-                    rv = walk_state->callback(&ipaddr, leaf->prefix,
-                                              walk_state->cb_data);
+                /* write base ip, 'bitmap-follows' value for the
+                 * prefix, and the bitmap */
+                *(uint32_t*)write_buf = state.base_ip;
+                write_buf[sizeof(uint32_t)] = SET_CIDR_BMAP_256;
+                rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+                if (rv != sizeof(write_buf)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
-                if (0 != rv) {
-                    break;
+                rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
+                if (rv != sizeof(state.bmap)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
             }
+            state.is_dirty = 0;
         }
-        return rv;
-    }
 
-    /* Walk over IPset, running the callback function with each
-     * individual IP address */
-    while (depth) {
-        if (!is_leaf[--depth]) {
-            node = NODE_PTR_V4(ipset, to_visit[depth]);
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]
-                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
-                    to_visit[depth++] = node->child[i];
-                }
+        if (prefix <= bmap_prefix) {
+            /* prefix is larger than the bitmap; write the block as an
+             * IP and prefix */
+            *(uint32_t*)write_buf = ipv4;
+            write_buf[sizeof(uint32_t)] = (uint8_t)prefix;
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
             }
+            continue;
+        }
+        if (!state.is_dirty) {
+            /* 'state' is empty; initialize 'state' with this IP and
+             * look for more IPs in this /24. */
+            state.is_dirty = 1;
+            state.base_ip = ipv4;
+            state.prefix = (uint8_t)prefix;
+            state.is_first = 1;
+            continue;
+        }
+        if (state.is_first) {
+            /* found a second IP in this /24; convert 'state' to hold
+             * a bitmap */
+            state.is_first = 0;
+            memset(state.bmap, 0, sizeof(state.bmap));
 
-#if SK_ENABLE_IPV6
-        } else if (SK_IPV6POLICY_FORCE == walk_state->v6policy) {
-            /* handle a leaf node where IPv6 addresses are to be
-             * returned */
-            leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
-            if (32 == leaf->prefix) {
-                skipaddrSetV6FromUint32(&ipaddr, &leaf->ip);
-                rv = walk_state->callback(&ipaddr, 128, walk_state->cb_data);
+            buf_idx = ((state.base_ip & 0xFF) >> 5);
+            if (state.prefix <= word_prefix) {
+                /* prefix spans one or more uint32_t's */
+                memset(&(state.bmap[buf_idx]), 0xff,
+                       (sizeof(uint32_t) << (word_prefix - state.prefix)));
             } else {
-                /* else visit each IP in the block */
-                ipv4 = leaf->ip;
-                fin4 = leaf->ip | (UINT32_MAX >> leaf->prefix);
-
-                do {
-                    skipaddrSetV6FromUint32(&ipaddr, &ipv4);
-                    rv = walk_state->callback(&ipaddr, 128,
-                                              walk_state->cb_data);
-                } while ((0 == rv) && (ipv4++ < fin4));
-            }
-            if (0 != rv) {
-                break;
+                state.bmap[buf_idx]
+                    |= (((1 << (1 << (32 - state.prefix))) - 1)
+                        << (state.base_ip & 0x1f));
             }
-#endif  /* SK_ENABLE_IPV6 */
+            /* mask base_ip as a /24 */
+            state.base_ip = state.base_ip & 0xFFFFFF00;
+        }
+        assert((ipv4 & 0xFFFFFF00) == state.base_ip);
 
+        /* add the current IP/prefix to the bitmap */
+        buf_idx = ((ipv4 & 0xFF) >> 5);
+        if (prefix <= word_prefix) {
+            /* set several uint32_t's */
+            memset(&(state.bmap[buf_idx]), 0xff,
+                   (sizeof(uint32_t) << (word_prefix - prefix)));
         } else {
-            /* handle a leaf node */
-            leaf = LEAF_PTR_V4(ipset, to_visit[depth]);
-            if (32 == leaf->prefix) {
-                skipaddrSetV4(&ipaddr, &leaf->ip);
-                rv = walk_state->callback(&ipaddr, leaf->prefix,
-                                          walk_state->cb_data);
-            } else {
-                /* else visit each IP in the block */
-                ipv4 = leaf->ip;
-                fin4 = leaf->ip | (UINT32_MAX >> leaf->prefix);
-                do {
-                    skipaddrSetV4(&ipaddr, &ipv4);
-                    rv = walk_state->callback(&ipaddr, 32, walk_state->cb_data);
-                } while ((0 == rv) && (ipv4++ < fin4));
+            state.bmap[buf_idx] |= (((1 << (1 << (32 - prefix))) - 1)
+                                    << (ipv4 & 0x1f));
+        }
+    }
+
+    /* write any IP or bitmap still in 'state' */
+    if (state.is_dirty) {
+        if (state.is_first) {
+            *(uint32_t*)write_buf = state.base_ip;
+            write_buf[sizeof(uint32_t)] = (uint8_t)state.prefix;
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
             }
-            if (0 != rv) {
-                break;
+        } else {
+            *(uint32_t*)write_buf = state.base_ip;
+            write_buf[sizeof(uint32_t)] = SET_CIDR_BMAP_256;
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
+            }
+            rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
+            if (rv != sizeof(state.bmap)) {
+                return SKIPSET_ERR_FILEIO;
             }
         }
     }
-    return rv;
+
+    return SKIPSET_OK;
 }
 
 #if SK_ENABLE_IPV6
 static int
-ipsetWalkV6(
+ipsetWriteCidrbmapFromRadixV6(
     const skipset_t    *ipset,
-    const ipset_walk_t *walk_state)
+    skstream_t         *stream)
 {
-    uint8_t is_leaf[IPSET_MAX_DEPTH_V6];
-    uint32_t to_visit[IPSET_MAX_DEPTH_V6];
-    const ipset_node_v6_t *node;
-    const ipset_leaf_v6_t *leaf;
-    skipaddr_t ipaddr;
-    uint32_t depth;
+    sk_file_header_t *hdr;
+    skipset_iterator_t iter;
+    struct state_st {
+        /* starting ip for this netblock, or an unmasked IP if
+         * 'is_first' is set. */
+        ipset_ipv6_t  base_ip;
+        /* the 256-bit bitmap */
+        uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
+        /* the prefix for 'base_ip' if 'is_first' is set */
+        uint8_t   prefix;
+        /* if set, this structure contains data */
+        uint8_t   is_dirty;
+        /* if set, base_ip holds a single, unmasked IP, and prefix is
+         * its prefix */
+        uint8_t   is_first;
+    } state;
+    /* the bitmap holds 256 bits or a /120 */
+    const uint32_t bmap_prefix = 120;
+    /* each uint32_t in the bitmap holds a /123 */
+    const uint32_t word_prefix = 123;
+    uint8_t write_buf[IPSET_LEN_V6 + sizeof(uint8_t)];
     ipset_ipv6_t ipv6;
-    ipset_ipv6_t fin6;
-    int i;
-    int rv = 0;
+    skipaddr_t ipaddr;
+    uint32_t prefix;
+    uint32_t buf_idx;
+    ssize_t rv;
 
+    /* sanity check input */
     assert(ipset);
-    assert(walk_state);
-    assert(walk_state->callback);
-    assert(walk_state->v6policy != SK_IPV6POLICY_IGNORE);
-
-    if (SK_IPV6POLICY_ASV4 != walk_state->v6policy) {
-        /* visit all the nodes in the tree */
-        depth = 0;
-        is_leaf[depth] = IPSET_ROOT_IS_LEAF(ipset);
-        to_visit[depth++] = IPSET_ROOT_INDEX(ipset);
-    } else {
-        /* limit to the nodes under ::ffff:0:0/96 */
-        ipset_find_t find_state;
-
-        ipv6.ip[0] = 0;
-        ipv6.ip[1] = UINT64_C(0xffff00000000);
-
-        rv = ipsetFindV6(ipset, &ipv6, 96, &find_state);
-        if (SKIPSET_OK != rv && SKIPSET_ERR_SUBSET != rv) {
-            /* no IPv4 addresses in the IPset */
-            return SKIPSET_OK;
-        }
-        depth = 0;
-        is_leaf[depth] = find_state.node_is_leaf;
-        to_visit[depth++] = find_state.node_idx;
-        rv = 0;
+    assert(stream);
+    if (ipset->is_dirty || ipset->is_iptree || !ipset->is_ipv6) {
+        skAbort();
+    }
+    hdr = skStreamGetSilkHeader(stream);
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+        skAbort();
     }
 
-    if (walk_state->cidr_blocks) {
-        while (depth) {
-            if (!is_leaf[--depth]) {
-                node = NODE_PTR_V6(ipset, to_visit[depth]);
-                for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                    --i;
-                    if (node->child[i]
-                        && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                    {
-                        is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
-                        to_visit[depth++] = node->child[i];
-                    }
+    memset(&state, 0, sizeof(state));
+
+    skIPSetIteratorBind(&iter, ipset, 1, SK_IPV6POLICY_FORCE);
+    while (skIPSetIteratorNext(&iter, &ipaddr, &prefix) == SK_ITERATOR_OK) {
+        IPSET_IPV6_FROM_ADDRV6(&ipv6, &ipaddr);
+        if (state.is_dirty
+            && (prefix <= bmap_prefix
+                || (state.base_ip.ip[0] != ipv6.ip[0])
+                || ((state.base_ip.ip[1] ^ ipv6.ip[1]) > 0xFF)))
+        {
+            /* 'ipv6' is not in the same /120 as 'state'; write the IP
+             * or bitmap currently in 'state' */
+            if (state.is_first) {
+                /* write the single ip and prefix */
+                IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
+                write_buf[IPSET_LEN_V6] = (uint8_t)state.prefix;
+                rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+                if (rv != sizeof(write_buf)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
+                state.is_first = 0;
             } else {
-                /* handle a leaf node */
-                leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
-                if (SK_IPV6POLICY_ASV4 == walk_state->v6policy) {
-                    IPSET_IPV6_TO_ADDR_V4(&leaf->ip, &ipaddr);
-                    rv = walk_state->callback(&ipaddr, leaf->prefix - 96,
-                                              walk_state->cb_data);
-                } else {
-                    IPSET_IPV6_TO_ADDR(&leaf->ip, &ipaddr);
-                    rv = walk_state->callback(&ipaddr, leaf->prefix,
-                                              walk_state->cb_data);
+                /* write base ip, 'bitmap-follows' value for the
+                 * prefix, and the bitmap */
+                IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
+                write_buf[IPSET_LEN_V6] = SET_CIDR_BMAP_256;
+                rv = skStreamWrite(stream, &write_buf, sizeof(write_buf));
+                if (rv != sizeof(write_buf)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
-                if (0 != rv) {
-                    break;
+                rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
+                if (rv != sizeof(state.bmap)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
             }
+            state.is_dirty = 0;
         }
-        return rv;
-    }
 
-    /* Walk over IPset, running the callback function with each
-     * individual IP address */
-    while (depth) {
-        if (!is_leaf[--depth]) {
-            node = NODE_PTR_V6(ipset, to_visit[depth]);
-            for (i = IPSET_NUM_CHILDREN; i > 0; ) {
-                --i;
-                if (node->child[i]
-                    && !NODEPTR_CHILD_IS_REPEAT(node, i))
-                {
-                    is_leaf[depth] = NODEPTR_CHILD_IS_LEAF(node, i);
-                    to_visit[depth++] = node->child[i];
-                }
+        if (prefix <= bmap_prefix) {
+            /* prefix is larger than the bitmap; write the block as an
+             * IP and prefix */
+            IPSET_IPV6_TO_ARRAY(&ipv6, write_buf);
+            write_buf[IPSET_LEN_V6] = (uint8_t)prefix;
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
             }
+            continue;
+        }
+        if (!state.is_dirty) {
+            /* 'state' is empty; initialize 'state' with this IP and
+             * look for more IPs in this /120. */
+            state.is_dirty = 1;
+            IPSET_IPV6_COPY(&state.base_ip, &ipv6);
+            state.prefix = (uint8_t)prefix;
+            state.is_first = 1;
+            continue;
+        }
+        if (state.is_first) {
+            /* found a second IP in this /120; convert 'state' to hold
+             * a bitmap */
+            state.is_first = 0;
+            memset(state.bmap, 0, sizeof(state.bmap));
 
-        } else if (SK_IPV6POLICY_ASV4 == walk_state->v6policy) {
-            /* handle a leaf node where IPv4 addresses are to be
-             * returned */
-            leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
-            if (128 == leaf->prefix) {
-                IPSET_IPV6_TO_ADDR_V4(&leaf->ip, &ipaddr);
-                rv = walk_state->callback(&ipaddr, 32, walk_state->cb_data);
+            buf_idx = ((state.base_ip.ip[1] & 0xFF) >> 5);
+            if (state.prefix <= word_prefix) {
+                /* prefix spans one or more uint32_t's */
+                memset(&(state.bmap[buf_idx]), 0xff,
+                       (sizeof(uint32_t) << (word_prefix-state.prefix)));
             } else {
-                /* else visit each IP in the block; convert CIDR block
-                 * to current IP (ipv4) and final IP (fin4) */
-                uint32_t ipv4;
-                uint32_t fin4;
-
-                assert(96 <= leaf->prefix);
-                assert(0 == leaf->ip.ip[0]);
-                assert(UINT64_C(0x0000ffff00000000)
-                       == (UINT64_C(0xffffffff00000000) & leaf->ip.ip[1]));
-                ipv4 = (uint32_t)(UINT64_C(0x00000000ffffffff)
-                                  & leaf->ip.ip[1]);
-                fin4 = ipv4 | (UINT32_MAX >> (leaf->prefix - 96));
-
-                do {
-                    skipaddrSetV4(&ipaddr, &ipv4);
-                    rv = walk_state->callback(&ipaddr, 32,
-                                              walk_state->cb_data);
-                } while ((0 == rv) && (ipv4++ < fin4));
-            }
-            if (0 != rv) {
-                break;
+                state.bmap[buf_idx]
+                    |= (((1 << (1 << (128 - state.prefix))) - 1)
+                        << (state.base_ip.ip[1] & 0x1f));
             }
+            /* mask base_ip as a /120 */
+            state.base_ip.ip[1] = (state.base_ip.ip[1] & ~UINT64_C(0xFF));
+        }
+        assert(ipv6.ip[0] == state.base_ip.ip[0]);
+        assert((ipv6.ip[1] & ~UINT64_C(0xFF)) == state.base_ip.ip[1]);
 
+        /* add the current IP/prefix to the bitmap */
+        buf_idx = ((ipv6.ip[1] & 0xFF) >> 5);
+        if (prefix <= word_prefix) {
+            /* set several uint32_t's */
+            memset(&(state.bmap[buf_idx]), 0xff,
+                   (sizeof(uint32_t) << (word_prefix - prefix)));
         } else {
-            /* handle a leaf node */
-            leaf = LEAF_PTR_V6(ipset, to_visit[depth]);
-            if (128 == leaf->prefix) {
-                IPSET_IPV6_TO_ADDR(&leaf->ip, &ipaddr);
-                rv = walk_state->callback(&ipaddr, leaf->prefix,
-                                          walk_state->cb_data);
-            } else {
-                /* else visit each IP in the block; convert CIDR block
-                 * to current IP (ipv6) and final IP (fin6) */
-                if (leaf->prefix > 64) {
-                    ipv6.ip[0] = fin6.ip[0] = leaf->ip.ip[0];
-                    ipv6.ip[1] = leaf->ip.ip[1];
-                    fin6.ip[1] = (leaf->ip.ip[1]
-                                  | (UINT64_MAX >> (leaf->prefix - 64)));
-                } else if (leaf->prefix == 64) {
-                    ipv6.ip[0] = fin6.ip[0] = leaf->ip.ip[0];
-                    ipv6.ip[1] = fin6.ip[1] = UINT64_MAX;
-                } else {
-                    ipv6.ip[0] = leaf->ip.ip[0];
-                    fin6.ip[0] = (leaf->ip.ip[0]
-                                  | (UINT64_MAX >> leaf->prefix));
-                    ipv6.ip[1] = fin6.ip[1] = UINT64_MAX;
-                }
+            state.bmap[buf_idx] |= (((1 << (1 << (128 - prefix))) - 1)
+                                    << (ipv6.ip[1] & 0x1f));
+        }
+    }
 
-                for (;;) {
-                    IPSET_IPV6_TO_ADDR(&ipv6, &ipaddr);
-                    rv = walk_state->callback(&ipaddr,128,walk_state->cb_data);
-                    if (rv) {
-                        return rv;
-                    }
-                    if (ipv6.ip[1] < fin6.ip[1]) {
-                        ++ipv6.ip[1];
-                    } else if (ipv6.ip[0] < fin6.ip[0]) {
-                        if (ipv6.ip[1] == UINT64_MAX) {
-                            ++ipv6.ip[0];
-                            ipv6.ip[1] = 0;
-                        } else {
-                            ++ipv6.ip[1];
-                        }
-                    } else {
-                        break;
-                    }
-                }
+    /* write any IP or bitmap still in 'state' */
+    if (state.is_dirty) {
+        if (state.is_first) {
+            IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
+            write_buf[IPSET_LEN_V6] = (uint8_t)state.prefix;
+            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
+            }
+        } else {
+            IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
+            write_buf[IPSET_LEN_V6] = SET_CIDR_BMAP_256;
+            rv = skStreamWrite(stream, &write_buf, sizeof(write_buf));
+            if (rv != sizeof(write_buf)) {
+                return SKIPSET_ERR_FILEIO;
+            }
+            rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
+            if (rv != sizeof(state.bmap)) {
+                return SKIPSET_ERR_FILEIO;
             }
         }
     }
 
-    return rv;
+    return SKIPSET_OK;
 }
 #endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetWriteCidrbmapFromIPTree(ipset, stream);
+ *  status = ipsetWriteCidrbmap(&ipset, stream, hdr);
  *
- *    Helper function for skIPSetWrite() via ipsetWriteCidrbmap().
+ *    Helper function for skIPSetWrite().
+ *
+ *    Write an IPset to 'stream' in the IPSET_REC_VERSION_CIDR_BMAP
+ *    format.
+ *
+ *    This function writes the header then calls another helper
+ *    function depending on the data structure being used.
+ */
+static int
+ipsetWriteCidrbmap(
+    const skipset_t    *ipset,
+    skstream_t         *stream)
+{
+    sk_file_header_t *hdr;
+    int rv;
+
+    /* sanity check input */
+    assert(ipset);
+    assert(stream);
+    if (ipset->is_dirty) {
+        skAbort();
+    }
+    hdr = skStreamGetSilkHeader(stream);
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+        skAbort();
+    }
+
+    /* Add the appropriate header */
+    rv = skHeaderAddIPSet(hdr, 0, 0,
+                          ipset->is_ipv6 ? IPSET_LEN_V6 : sizeof(uint32_t),
+                          0, 0, 0);
+    if (rv) {
+        skAppPrintErr("%s", skHeaderStrerror(rv));
+        return SKIPSET_ERR_FILEIO;
+    }
+    rv = skStreamWriteSilkHeader(stream);
+    if (rv) {
+        return SKIPSET_ERR_FILEIO;
+    }
+
+    if (ipset->is_iptree) {
+        return ipsetWriteCidrbmapFromIPTree(ipset, stream);
+    }
+#if SK_ENABLE_IPV6
+    if (ipset->is_ipv6) {
+        return ipsetWriteCidrbmapFromRadixV6(ipset, stream);
+    }
+#endif
+    return ipsetWriteCidrbmapFromRadixV4(ipset, stream);
+}
+
+
+/*
+ *  status = ipsetWriteLegacyFromIPTree(ipset, stream);
+ *
+ *    Helper function for skIPSetWrite() via ipsetWriteLegacy().
  *
  *    Write an IPset from the SiLK-2 IPTree data structure to 'stream'
- *    in the IPSET_REC_VERSION_CIDR_BMAP format.
+ *    in the IPSET_REC_VERSION_LEGACY format.
  *
- *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
  *    file format.
  */
 static int
-ipsetWriteCidrbmapFromIPTree(
+ipsetWriteLegacyFromIPTree(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
     sk_file_header_t *hdr;
-    uint8_t write_buf[sizeof(uint32_t) + sizeof(uint8_t)];
     skIPNode_t *slash16;
     uint32_t slash24;
     uint32_t i;
     uint32_t j;
     ssize_t rv;
-    struct build_cidr_st {
-        /* starting ip for this netblock */
-        uint32_t start;
-        /* number of trailing 0s; used to set CIDR mask */
-        uint32_t trail_zero;
-        /* maximum number of /24s this block can hold */
-        uint32_t max_block;
-        /* number of the max_block we have seen so far */
-        uint32_t count;
-    } build_cidr;
-
-#define WRITE_BUILD_CIDR                                                \
-    while (build_cidr.count) {                                          \
-        --build_cidr.trail_zero;                                        \
-        if (build_cidr.count >= (1u << (build_cidr.trail_zero - 8))) {  \
-            *(uint32_t*)write_buf = build_cidr.start;                   \
-            write_buf[sizeof(uint32_t)]                                 \
-                = (uint8_t)(32 - build_cidr.trail_zero);                \
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));   \
-            if (rv != sizeof(write_buf)) {                              \
-                return SKIPSET_ERR_FILEIO;                              \
-            }                                                           \
-            build_cidr.count -= (1 << (build_cidr.trail_zero - 8));     \
-            build_cidr.start |= (0x100 << (build_cidr.trail_zero - 8)); \
-        }                                                               \
-    }
 
     /* sanity check input */
     assert(ipset);
@@ -8341,482 +11983,279 @@ ipsetWriteCidrbmapFromIPTree(
         skAbort();
     }
     hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_LEGACY) {
         skAbort();
     }
 
-    memset(&build_cidr, 0, sizeof(build_cidr));
-
-    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+    for (i = 0; i < SKIP_BBLOCK_COUNT; i++) {
         /* slash16 represents a /16 */
         slash16 = ipset->s.v2->nodes[i];
         if (NULL == slash16) {
-            /* no data in this /16; write any CIDR range that was
-             * being built */
-            WRITE_BUILD_CIDR;
             continue;
         }
 
         /* There is data in this /16, walk over the addressBlocks by
          * 8s, which is equivalent to visiting each /24. */
         for (j = 0; j < SKIP_BBLOCK_SIZE; j += IPTREE_WORDS_PER_SLASH24) {
-
-            if (0 == memcmp(slash16->addressBlock + j,
-                            bmap256_zero, sizeof(bmap256_zero)))
-            {
-                /* no data in this /24; write existing CIDR block */
-                WRITE_BUILD_CIDR;
-                continue;
-            }
-            if (0 == memcmp(slash16->addressBlock + j,
-                            bmap256_full, sizeof(bmap256_full)))
+            if (memcmp(slash16->addressBlock + j,
+                       bmap256_zero, sizeof(bmap256_zero)))
             {
-                /* this /24 is full; if CIDR block is being built,
-                 * this block must be contiguous with it */
-                if (build_cidr.count) {
-                    ++build_cidr.count;
-                    if (build_cidr.count == build_cidr.max_block) {
-                        /* cidr block is at its maximum size */
-                        *(uint32_t*)write_buf = build_cidr.start;
-                        write_buf[sizeof(uint32_t)]
-                            = (uint8_t)(32 - build_cidr.trail_zero);
-                        rv = skStreamWrite(stream,write_buf,sizeof(write_buf));
-                        if (rv != sizeof(write_buf)) {
-                            return SKIPSET_ERR_FILEIO;
-                        }
-                        build_cidr.count = 0;
-                    }
-                    continue;
-                }
-
-                /* no existing CIDR block to join; start a new one */
-                build_cidr.start = ((i << 16) | (j << 5)) & 0xFFFFFF00;
-                if (build_cidr.start & 0x100) {
-                    /* the third octet is odd, so this block cannot be
-                     * combined with another */
-                    *(uint32_t*)write_buf = build_cidr.start;
-                    write_buf[sizeof(uint32_t)] = 24;
-                    rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-                    if (rv != sizeof(write_buf)) {
-                        return SKIPSET_ERR_FILEIO;
-                    }
-                    continue;
+                /* there is data in this /24; write the base address. */
+                slash24 = ((i << 16) | (j << 5)) & 0xFFFFFF00;
+                rv = skStreamWrite(stream, &slash24, sizeof(uint32_t));
+                if (rv != sizeof(uint32_t)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
-
-                /* compute the maximum number of blocks that can be
-                 * joined with this one by computing the number of
-                 * trailing 0s on the IP---we know the least
-                 * significant 8 bits are already 0. */
-                slash24 = build_cidr.start >> 8;
-                if (0 == slash24) {
-                    build_cidr.trail_zero = 32;
-                } else {
-                    build_cidr.trail_zero = 9;
-                    if ((slash24 & 0xFFFF) == 0) {
-                        slash24 >>= 16;
-                        build_cidr.trail_zero += 16;
-                    }
-                    if ((slash24 & 0xFF) == 0) {
-                        slash24 >>= 8;
-                        build_cidr.trail_zero += 8;
-                    }
-                    if ((slash24 & 0xF) == 0) {
-                        slash24 >>= 4;
-                        build_cidr.trail_zero += 4;
-                    }
-                    if ((slash24 & 0x3) == 0) {
-                        slash24 >>= 2;
-                        build_cidr.trail_zero += 2;
-                    }
-                    build_cidr.trail_zero -= (slash24 & 1);
+                /* write the complete /24: 8 uint32_t's */
+                rv = skStreamWrite(stream, slash16->addressBlock + j,
+                                   sizeof(bmap256_zero));
+                if (rv != sizeof(bmap256_zero)) {
+                    return SKIPSET_ERR_FILEIO;
                 }
-                build_cidr.max_block = (1 << (build_cidr.trail_zero - 8));
-                build_cidr.count = 1;
-                continue;
             }
+        }
+    }
+
+    rv = skStreamFlush(stream);
+    if (rv) {
+        return SKIPSET_ERR_FILEIO;
+    }
+
+    return SKIPSET_OK;
+}
+
+
+/*
+ *  status = ipsetWriteLegacyFromRadixCallbackV4(ipv4, prefix, &state);
+ *  status = ipsetWriteLegacyFromRadixCallback(ipaddr, prefix, &state);
+ *
+ *    Callback function used by ipsetWriteLegacyFromRadix().
+ *
+ *    This function is the callback invoked by skIPSetWalk().  When
+ *    the current 'ipaddr' and 'prefix' are part of the same /24
+ *    contained in 'state'->buffer, the IPs are added to that buffer.
+ *    Otherwise, the buffer is printed if it contains data, and then
+ *    the buffer is initialized with new data.
+ */
+static int
+ipsetWriteLegacyFromRadixCallbackV4(
+    uint32_t            ipv4,
+    uint32_t            prefix,
+    void               *v_state)
+{
+    ipset_write_silk2_t *state = (ipset_write_silk2_t*)v_state;
+    uint32_t slash24;
+    uint32_t buf_idx;
+    int i;
+    ssize_t rv;
 
-            /* there is some data in this /24.  First, handle any CIDR
-             * range that was being build.  Then, write this block as
-             * a base address and bitmap. */
-            WRITE_BUILD_CIDR;
+    /* get the /24 that holds this IP */
+    slash24 = ipv4 & 0xFFFFFF00;
 
-            /* write the IP and the 'bitmap-follows' value  */
-            *(uint32_t*)write_buf = (((i << 16) | (j << 5)) & 0xFFFFFF00);
-            write_buf[sizeof(uint32_t)] = SET_CIDR_BMAP_256;
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
+    if (prefix <= 24) {
+        /* write the buffer if it contains data */
+        if (state->buffer_is_dirty) {
+            rv = skStreamWrite(state->stream, state->buffer,
+                               sizeof(state->buffer));
+            if (rv != sizeof(state->buffer)) {
                 return SKIPSET_ERR_FILEIO;
             }
-            /* write the complete /24: 8 uint32_t's */
-            rv = skStreamWrite(stream, slash16->addressBlock + j,
-                               sizeof(bmap256_zero));
-            if (rv != sizeof(bmap256_zero)) {
+            state->buffer_is_dirty = 0;
+        }
+
+        /* initialize the buffer to all-1s */
+        memset(state->buffer, 0xff, sizeof(state->buffer));
+
+        /* loop over all /24s in this block and print each one */
+        for (i = 0; i < (1 << (24 - prefix)); ++i, slash24 += 256) {
+            state->buffer[0] = slash24;
+
+            rv = skStreamWrite(state->stream, state->buffer,
+                               sizeof(state->buffer));
+            if (rv != sizeof(state->buffer)) {
                 return SKIPSET_ERR_FILEIO;
             }
         }
+
+        return SKIPSET_OK;
     }
 
-    rv = skStreamFlush(stream);
-    if (rv) {
-        return SKIPSET_ERR_FILEIO;
+    if (!state->buffer_is_dirty) {
+        /* initialize the block to hold this /24 */
+        memset(state->buffer, 0, sizeof(state->buffer));
+        state->buffer[0] = slash24;
+        state->buffer_is_dirty = 1;
+    } else if (state->buffer[0] != slash24) {
+        /* the /24s are different---print the block and reset it */
+        rv = skStreamWrite(state->stream, state->buffer,sizeof(state->buffer));
+        if (rv != sizeof(state->buffer)) {
+            return SKIPSET_ERR_FILEIO;
+        }
+        memset(state->buffer, 0, sizeof(state->buffer));
+        state->buffer[0] = slash24;
+    }
+    /* else data is in the same /24 */
+
+    /* add our IPs to the bitmap */
+    buf_idx = 1 + ((ipv4 & 0xFF) >> 5);
+
+    if (prefix <= 27) {
+        /* set several uint32_t's */
+        memset(&(state->buffer[buf_idx]), 0xff,
+               ((1 << (27 - prefix)) * sizeof(uint32_t)));
+    } else {
+        state->buffer[buf_idx] |= ((UINT32_MAX >> (32 - (1 << (32 - prefix))))
+                                   << (ipv4 & 0x1f & (0x1f << (32 - prefix))));
     }
 
     return SKIPSET_OK;
 }
 
+#if SK_ENABLE_IPV6
+static int
+ipsetWriteLegacyFromRadixCallback(
+    skipaddr_t         *ipaddr,
+    uint32_t            prefix,
+    void               *v_state)
+{
+    uint32_t ipv4;
+
+    /* get the IPv4 address */
+    if (skipaddrGetAsV4(ipaddr, &ipv4)) {
+        return SKIPSET_ERR_IPV6;
+    }
+    return ipsetWriteLegacyFromRadixCallbackV4(ipv4, prefix, v_state);
+}
+#endif  /* SK_ENABLE_IPV6 */
+
 
 /*
- *  status = ipsetWriteCidrbmapFromRadixV4(&ipset, stream, hdr);
- *  status = ipsetWriteCidrbmapFromRadixV6(&ipset, stream, hdr);
+ *  status = ipsetWriteLegacyFromRadix(ipset, stream);
  *
- *    Helper function for skIPSetWrite() via ipsetWriteCidrbmap().
+ *    Helper function for skIPSetWrite() via ipsetWriteLegacy().
  *
  *    Write an IPset from the radix-tree IPset data structure to
- *    'stream' in the IPSET_REC_VERSION_CIDR_BMAP format.
+ *    'stream' in the IPSET_REC_VERSION_LEGACY format.
  *
- *    See '#define IPSET_REC_VERSION_CIDR_BMAP' for description of the
+ *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
  *    file format.
  */
 static int
-ipsetWriteCidrbmapFromRadixV4(
+ipsetWriteLegacyFromRadix(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
     sk_file_header_t *hdr;
-    skipset_iterator_t iter;
-    struct state_st {
-        /* starting ip for this netblock, or an unmasked IP if
-         * 'is_first' is set. */
-        uint32_t  base_ip;
-        /* the 256-bit bitmap */
-        uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
-        /* the prefix for 'base_ip' if 'is_first' is set */
-        uint8_t   prefix;
-        /* if set, this structure contains data */
-        uint8_t   is_dirty;
-        /* if set, base_ip holds a single, unmasked IP, and prefix is
-         * its prefix */
-        uint8_t   is_first;
-    } state;
-    /* the bitmap holds 256 bits or a /24 */
-    const uint32_t bmap_prefix = 24;
-    /* each uint32_t in the bitmap holds a /27 */
-    const uint32_t word_prefix = 27;
-    uint8_t write_buf[sizeof(uint32_t) + 1];
-    uint32_t ipv4;
-    skipaddr_t ipaddr;
-    uint32_t prefix;
-    uint32_t buf_idx;
+    ipset_write_silk2_t write_state;
     ssize_t rv;
 
     /* sanity check input */
     assert(ipset);
     assert(stream);
-    if (ipset->is_dirty || ipset->is_iptree || ipset->is_ipv6) {
+    if (ipset->is_dirty || ipset->is_iptree || skIPSetContainsV6(ipset)) {
         skAbort();
     }
     hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_LEGACY) {
         skAbort();
     }
 
-    memset(&state, 0, sizeof(state));
-
-    skIPSetIteratorBind(&iter, ipset, 1, SK_IPV6POLICY_ASV4);
-    while (skIPSetIteratorNext(&iter, &ipaddr, &prefix) == SK_ITERATOR_OK){
-        ipv4 = skipaddrGetV4(&ipaddr);
-        if (state.is_dirty && (prefix <= bmap_prefix
-                               || (state.base_ip ^ ipv4) > 0xFF))
-        {
-            /* 'ipv4' is not in the same /24 as 'state'; write the IP
-             * or bitmap currently in 'state' */
-            if (state.is_first) {
-                /* write the single ip and prefix */
-                *(uint32_t*)write_buf = state.base_ip;
-                write_buf[sizeof(uint32_t)] = (uint8_t)state.prefix;
-                rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-                if (rv != sizeof(write_buf)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-                state.is_first = 0;
-            } else {
-                /* write base ip, 'bitmap-follows' value for the
-                 * prefix, and the bitmap */
-                *(uint32_t*)write_buf = state.base_ip;
-                write_buf[sizeof(uint32_t)] = SET_CIDR_BMAP_256;
-                rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-                if (rv != sizeof(write_buf)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-                rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
-                if (rv != sizeof(state.bmap)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-            }
-            state.is_dirty = 0;
-        }
-
-        if (prefix <= bmap_prefix) {
-            /* prefix is larger than the bitmap; write the block as an
-             * IP and prefix */
-            *(uint32_t*)write_buf = ipv4;
-            write_buf[sizeof(uint32_t)] = (uint8_t)prefix;
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-            continue;
-        }
-        if (!state.is_dirty) {
-            /* 'state' is empty; initialize 'state' with this IP and
-             * look for more IPs in this /24. */
-            state.is_dirty = 1;
-            state.base_ip = ipv4;
-            state.prefix = (uint8_t)prefix;
-            state.is_first = 1;
-            continue;
-        }
-        if (state.is_first) {
-            /* found a second IP in this /24; convert 'state' to hold
-             * a bitmap */
-            state.is_first = 0;
-            memset(state.bmap, 0, sizeof(state.bmap));
+    memset(&write_state, 0, sizeof(write_state));
+    write_state.stream = stream;
 
-            buf_idx = ((state.base_ip & 0xFF) >> 5);
-            if (state.prefix <= word_prefix) {
-                /* prefix spans one or more uint32_t's */
-                memset(&(state.bmap[buf_idx]), 0xff,
-                       (sizeof(uint32_t) << (word_prefix - state.prefix)));
-            } else {
-                state.bmap[buf_idx]
-                    |= (((1 << (1 << (32 - state.prefix))) - 1)
-                        << (state.base_ip & 0x1f));
-            }
-            /* mask base_ip as a /24 */
-            state.base_ip = state.base_ip & 0xFFFFFF00;
-        }
-        assert((ipv4 & 0xFFFFFF00) == state.base_ip);
+#if SK_ENABLE_IPV6
+    if (ipset->is_ipv6) {
+        rv = skIPSetWalk(ipset, 1, SK_IPV6POLICY_ASV4,
+                         &ipsetWriteLegacyFromRadixCallback,
+                         (void*)&write_state);
+    } else
+#endif
+    {
+        rv = ipsetWalkInternalV4(ipset, ipsetWriteLegacyFromRadixCallbackV4,
+                                 (void*)&write_state);
+    }
+    if (rv != 0) {
+        return rv;
+    }
 
-        /* add the current IP/prefix to the bitmap */
-        buf_idx = ((ipv4 & 0xFF) >> 5);
-        if (prefix <= word_prefix) {
-            /* set several uint32_t's */
-            memset(&(state.bmap[buf_idx]), 0xff,
-                   (sizeof(uint32_t) << (word_prefix - prefix)));
-        } else {
-            state.bmap[buf_idx] |= (((1 << (1 << (32 - prefix))) - 1)
-                                    << (ipv4 & 0x1f));
+    if (write_state.buffer_is_dirty) {
+        rv = skStreamWrite(stream, write_state.buffer,
+                           sizeof(write_state.buffer));
+        if (rv != sizeof(write_state.buffer)) {
+            return SKIPSET_ERR_FILEIO;
         }
     }
 
-    /* write any IP or bitmap still in 'state' */
-    if (state.is_dirty) {
-        if (state.is_first) {
-            *(uint32_t*)write_buf = state.base_ip;
-            write_buf[sizeof(uint32_t)] = (uint8_t)state.prefix;
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-        } else {
-            *(uint32_t*)write_buf = state.base_ip;
-            write_buf[sizeof(uint32_t)] = SET_CIDR_BMAP_256;
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-            rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
-            if (rv != sizeof(state.bmap)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-        }
+    rv = skStreamFlush(stream);
+    if (rv) {
+        return SKIPSET_ERR_FILEIO;
     }
 
     return SKIPSET_OK;
 }
 
-#if SK_ENABLE_IPV6
+
+/*
+ *  status = ipsetWriteLegacy(&ipset, stream);
+ *
+ *    Helper function for skIPSetWrite().
+ *
+ *    Write an IPset to 'stream' in the IPSET_REC_VERSION_LEGACY
+ *    format.
+ *
+ *    This function writes the header then calls another helper
+ *    function depending on the data structure being used.
+ */
 static int
-ipsetWriteCidrbmapFromRadixV6(
+ipsetWriteLegacy(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
     sk_file_header_t *hdr;
-    skipset_iterator_t iter;
-    struct state_st {
-        /* starting ip for this netblock, or an unmasked IP if
-         * 'is_first' is set. */
-        ipset_ipv6_t  base_ip;
-        /* the 256-bit bitmap */
-        uint32_t bmap[IPTREE_WORDS_PER_SLASH24];
-        /* the prefix for 'base_ip' if 'is_first' is set */
-        uint8_t   prefix;
-        /* if set, this structure contains data */
-        uint8_t   is_dirty;
-        /* if set, base_ip holds a single, unmasked IP, and prefix is
-         * its prefix */
-        uint8_t   is_first;
-    } state;
-    /* the bitmap holds 256 bits or a /120 */
-    const uint32_t bmap_prefix = 120;
-    /* each uint32_t in the bitmap holds a /123 */
-    const uint32_t word_prefix = 123;
-    uint8_t write_buf[IPSET_LEN_V6 + sizeof(uint8_t)];
-    ipset_ipv6_t ipv6;
-    skipaddr_t ipaddr;
-    uint32_t prefix;
-    uint32_t buf_idx;
-    ssize_t rv;
+    int rv;
 
     /* sanity check input */
     assert(ipset);
     assert(stream);
-    if (ipset->is_dirty || ipset->is_iptree || !ipset->is_ipv6) {
+    if (ipset->is_dirty || skIPSetContainsV6(ipset)) {
         skAbort();
     }
     hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_LEGACY) {
         skAbort();
     }
 
-    memset(&state, 0, sizeof(state));
-
-    skIPSetIteratorBind(&iter, ipset, 1, SK_IPV6POLICY_FORCE);
-    while (skIPSetIteratorNext(&iter, &ipaddr, &prefix) == SK_ITERATOR_OK) {
-        IPSET_IPV6_FROM_ADDRV6(&ipv6, &ipaddr);
-        if (state.is_dirty
-            && (prefix <= bmap_prefix
-                || (state.base_ip.ip[0] != ipv6.ip[0])
-                || ((state.base_ip.ip[1] ^ ipv6.ip[1]) > 0xFF)))
-        {
-            /* 'ipv6' is not in the same /120 as 'state'; write the IP
-             * or bitmap currently in 'state' */
-            if (state.is_first) {
-                /* write the single ip and prefix */
-                IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
-                write_buf[IPSET_LEN_V6] = (uint8_t)state.prefix;
-                rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-                if (rv != sizeof(write_buf)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-                state.is_first = 0;
-            } else {
-                /* write base ip, 'bitmap-follows' value for the
-                 * prefix, and the bitmap */
-                IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
-                write_buf[IPSET_LEN_V6] = SET_CIDR_BMAP_256;
-                rv = skStreamWrite(stream, &write_buf, sizeof(write_buf));
-                if (rv != sizeof(write_buf)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-                rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
-                if (rv != sizeof(state.bmap)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-            }
-            state.is_dirty = 0;
-        }
-
-        if (prefix <= bmap_prefix) {
-            /* prefix is larger than the bitmap; write the block as an
-             * IP and prefix */
-            IPSET_IPV6_TO_ARRAY(&ipv6, write_buf);
-            write_buf[IPSET_LEN_V6] = (uint8_t)prefix;
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-            continue;
-        }
-        if (!state.is_dirty) {
-            /* 'state' is empty; initialize 'state' with this IP and
-             * look for more IPs in this /120. */
-            state.is_dirty = 1;
-            IPSET_IPV6_COPY(&state.base_ip, &ipv6);
-            state.prefix = (uint8_t)prefix;
-            state.is_first = 1;
-            continue;
-        }
-        if (state.is_first) {
-            /* found a second IP in this /120; convert 'state' to hold
-             * a bitmap */
-            state.is_first = 0;
-            memset(state.bmap, 0, sizeof(state.bmap));
-
-            buf_idx = ((state.base_ip.ip[1] & 0xFF) >> 5);
-            if (state.prefix <= word_prefix) {
-                /* prefix spans one or more uint32_t's */
-                memset(&(state.bmap[buf_idx]), 0xff,
-                       (sizeof(uint32_t) << (word_prefix-state.prefix)));
-            } else {
-                state.bmap[buf_idx]
-                    |= (((1 << (1 << (128 - state.prefix))) - 1)
-                        << (state.base_ip.ip[1] & 0x1f));
-            }
-            /* mask base_ip as a /120 */
-            state.base_ip.ip[1] = (state.base_ip.ip[1] & ~UINT64_C(0xFF));
-        }
-        assert(ipv6.ip[0] == state.base_ip.ip[0]);
-        assert((ipv6.ip[1] & ~UINT64_C(0xFF)) == state.base_ip.ip[1]);
-
-        /* add the current IP/prefix to the bitmap */
-        buf_idx = ((ipv6.ip[1] & 0xFF) >> 5);
-        if (prefix <= word_prefix) {
-            /* set several uint32_t's */
-            memset(&(state.bmap[buf_idx]), 0xff,
-                   (sizeof(uint32_t) << (word_prefix - prefix)));
-        } else {
-            state.bmap[buf_idx] |= (((1 << (1 << (128 - prefix))) - 1)
-                                    << (ipv6.ip[1] & 0x1f));
-        }
+    rv = skStreamWriteSilkHeader(stream);
+    if (rv) {
+        return SKIPSET_ERR_FILEIO;
     }
 
-    /* write any IP or bitmap still in 'state' */
-    if (state.is_dirty) {
-        if (state.is_first) {
-            IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
-            write_buf[IPSET_LEN_V6] = (uint8_t)state.prefix;
-            rv = skStreamWrite(stream, write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-        } else {
-            IPSET_IPV6_TO_ARRAY(&state.base_ip, write_buf);
-            write_buf[IPSET_LEN_V6] = SET_CIDR_BMAP_256;
-            rv = skStreamWrite(stream, &write_buf, sizeof(write_buf));
-            if (rv != sizeof(write_buf)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-            rv = skStreamWrite(stream, state.bmap, sizeof(state.bmap));
-            if (rv != sizeof(state.bmap)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-        }
+    if (ipset->is_iptree) {
+        return ipsetWriteLegacyFromIPTree(ipset, stream);
     }
-
-    return SKIPSET_OK;
+    return ipsetWriteLegacyFromRadix(ipset, stream);
 }
-#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = ipsetWriteCidrbmap(&ipset, stream, hdr);
+ *  status = ipsetWriteRadix(ipset, stream);
  *
  *    Helper function for skIPSetWrite().
  *
- *    Write an IPset to 'stream' in the IPSET_REC_VERSION_CIDR_BMAP
+ *    Write an IPset to 'stream' in the IPSET_REC_VERSION_RADIX
  *    format.
  *
- *    This function writes the header then calls another helper
- *    function depending on the data structure being used.
+ *    See '#define IPSET_REC_VERSION_RADIX' for description of the
+ *    file format.
  */
 static int
-ipsetWriteCidrbmap(
+ipsetWriteRadix(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
     sk_file_header_t *hdr;
-    int rv;
+    skipset_t *set3 = NULL;
+    ssize_t rv;
 
     /* sanity check input */
     assert(ipset);
@@ -8825,438 +12264,435 @@ ipsetWriteCidrbmap(
         skAbort();
     }
     hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_CIDR_BMAP) {
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_RADIX) {
         skAbort();
     }
 
-    /* Add the appropriate header */
-    rv = skHeaderAddIPSet(hdr, 0, 0,
-                          ipset->is_ipv6 ? IPSET_LEN_V6 : sizeof(uint32_t),
-                          0, 0, 0);
+    /* we must convert the IPTree to a Radix-Tree when writing an
+     * IPTree-based IPset to the IPSET_REC_VERSION_RADIX format */
+    if (ipset->is_iptree) {
+        skIPTreeCIDRBlockIterator_t cidr_iter;
+        skIPTreeCIDRBlock_t cidr;
+
+        /* create a Radix-based IPv4 IPset */
+        rv = ipsetCreate(&set3, 0, 1);
+        if (rv) {
+            goto END;
+        }
+
+        /* add the elements from 'ipset' to 'set3' */
+        ASSERT_OK(skIPTreeCIDRBlockIteratorBind(&cidr_iter, ipset->s.v2));
+        while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
+               == SK_ITERATOR_OK)
+        {
+            rv = ipsetInsertAddressV4(set3, cidr.addr, cidr.mask, NULL);
+            if (rv) {
+                goto END;
+            }
+        }
+        rv = skIPSetClean(set3);
+        if (rv) {
+            goto END;
+        }
+
+        ipset = set3;
+    }
+
+    if (ipset->is_iptree) {
+        skAbort();
+    }
+
+    /* Add the appropriate header, and pad it so the arrays may be
+     * used in place when the file is mmap()ed */
+    rv = skHeaderAddIPSet(hdr, IPSET_NUM_CHILDREN,
+                          ipset->s.v3->leaves.entry_count,
+                          ipset->s.v3->leaves.entry_size,
+                          ipset->s.v3->nodes.entry_count,
+                          ipset->s.v3->nodes.entry_size,
+                          IPSET_ROOT_INDEX(ipset));
+    if (0 == rv) {
+        rv = skHeaderSetPaddingModulus(hdr, IPSET_RADIX_DATA_ALIGN);
+    }
     if (rv) {
         skAppPrintErr("%s", skHeaderStrerror(rv));
-        return SKIPSET_ERR_FILEIO;
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
     }
     rv = skStreamWriteSilkHeader(stream);
     if (rv) {
-        return SKIPSET_ERR_FILEIO;
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
     }
 
-    if (ipset->is_iptree) {
-        return ipsetWriteCidrbmapFromIPTree(ipset, stream);
+    /* write the arrays */
+    if (ipset->s.v3->nodes.entry_count) {
+        rv = skStreamWrite(stream, ipset->s.v3->nodes.buf,
+                           ((size_t)ipset->s.v3->nodes.entry_size
+                            * ipset->s.v3->nodes.entry_count));
+        if ((size_t)rv != ((size_t)ipset->s.v3->nodes.entry_size
+                           * ipset->s.v3->nodes.entry_count))
+        {
+            rv = SKIPSET_ERR_FILEIO;
+            goto END;
+        }
     }
-#if SK_ENABLE_IPV6
-    if (ipset->is_ipv6) {
-        return ipsetWriteCidrbmapFromRadixV6(ipset, stream);
+    if (ipset->s.v3->leaves.entry_count) {
+        rv = skStreamWrite(stream, ipset->s.v3->leaves.buf,
+                           ((size_t)ipset->s.v3->leaves.entry_size
+                            * ipset->s.v3->leaves.entry_count));
+        if ((size_t)rv != ((size_t)ipset->s.v3->leaves.entry_size
+                           * ipset->s.v3->leaves.entry_count))
+        {
+            rv = SKIPSET_ERR_FILEIO;
+            goto END;
+        }
+    }
+
+    rv = skStreamFlush(stream);
+    if (rv) {
+        rv = SKIPSET_ERR_FILEIO;
+        goto END;
     }
-#endif
-    return ipsetWriteCidrbmapFromRadixV4(ipset, stream);
+
+    /* success */
+    rv = SKIPSET_OK;
+
+  END:
+    skIPSetDestroy(&set3);
+    return rv;
 }
 
 
 /*
- *  status = ipsetWriteLegacyFromIPTree(ipset, stream);
+ *  status = ipsetWriteSlash16Container(stream, slash16, bmap, buf);
  *
- *    Helper function for skIPSetWrite() via ipsetWriteLegacy().
+ *    Helper function for ipsetWriteSlash16FromIPTree() and
+ *    ipsetWriteSlash16FromRadixV4().
  *
- *    Write an IPset from the SiLK-2 IPTree data structure to 'stream'
- *    in the IPSET_REC_VERSION_LEGACY format.
+ *    Write the IPs in the 65536-bit bitmap 'bmap' to 'stream' as a
+ *    single container for the /16 'slash16', choosing the smallest of
+ *    the array, bitmap, and run containers with
+ *    ipsetSlash16ChooseType().  Write nothing if 'bmap'
+ *    is empty.  'buf' is scratch space that must hold
+ *    SET_SLASH16_MAX_VALUES uint16_t values.
  *
- *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
  *    file format.
  */
 static int
-ipsetWriteLegacyFromIPTree(
-    const skipset_t    *ipset,
-    skstream_t         *stream)
-{
-    sk_file_header_t *hdr;
-    skIPNode_t *slash16;
-    uint32_t slash24;
+ipsetWriteSlash16Container(
+    skstream_t         *stream,
+    uint32_t            slash16,
+    const uint32_t     *bmap,
+    uint16_t           *buf)
+{
+    uint32_t cont_hdr[2];
+    const void *body;
+    uint32_t num_ips = 0;
+    uint32_t num_runs;
+    uint32_t bits;
     uint32_t i;
-    uint32_t j;
+    size_t len;
     ssize_t rv;
 
-    /* sanity check input */
-    assert(ipset);
-    assert(stream);
-    if (ipset->is_dirty || !ipset->is_iptree || ipset->is_ipv6) {
-        skAbort();
+    for (i = 0; i < SKIP_BBLOCK_SIZE; ++i) {
+        if (bmap[i]) {
+            BITS_IN_WORD32(&bits, bmap[i]);
+            num_ips += bits;
+        }
     }
-    hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_LEGACY) {
-        skAbort();
+    if (0 == num_ips) {
+        return SKIPSET_OK;
     }
 
-    for (i = 0; i < SKIP_BBLOCK_COUNT; i++) {
-        /* slash16 represents a /16 */
-        slash16 = ipset->s.v2->nodes[i];
-        if (NULL == slash16) {
-            continue;
-        }
-
-        /* There is data in this /16, walk over the addressBlocks by
-         * 8s, which is equivalent to visiting each /24. */
-        for (j = 0; j < SKIP_BBLOCK_SIZE; j += IPTREE_WORDS_PER_SLASH24) {
-            if (memcmp(slash16->addressBlock + j,
-                       bmap256_zero, sizeof(bmap256_zero)))
-            {
-                /* there is data in this /24; write the base address. */
-                slash24 = ((i << 16) | (j << 5)) & 0xFFFFFF00;
-                rv = skStreamWrite(stream, &slash24, sizeof(uint32_t));
-                if (rv != sizeof(uint32_t)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-                /* write the complete /24: 8 uint32_t's */
-                rv = skStreamWrite(stream, slash16->addressBlock + j,
-                                   sizeof(bmap256_zero));
-                if (rv != sizeof(bmap256_zero)) {
-                    return SKIPSET_ERR_FILEIO;
-                }
-            }
-        }
+    num_runs = ipsetSlash16FindRuns(bmap, buf);
+    switch (ipsetSlash16ChooseType(num_ips, num_runs)) {
+      case SET_SLASH16_RUN:
+        cont_hdr[0] = (slash16 << 16) | SET_SLASH16_RUN;
+        cont_hdr[1] = num_runs;
+        len = 2 * num_runs * sizeof(uint16_t);
+        body = buf;
+        break;
+      case SET_SLASH16_ARRAY:
+        cont_hdr[0] = (slash16 << 16) | SET_SLASH16_ARRAY;
+        cont_hdr[1] = ipsetSlash16FindValues(bmap, buf);
+        len = num_ips * sizeof(uint16_t);
+        body = buf;
+        break;
+      default:
+        cont_hdr[0] = (slash16 << 16) | SET_SLASH16_BITMAP;
+        cont_hdr[1] = num_ips;
+        len = sizeof(skIPNode_t);
+        body = bmap;
+        break;
     }
 
-    rv = skStreamFlush(stream);
-    if (rv) {
+    rv = skStreamWrite(stream, cont_hdr, sizeof(cont_hdr));
+    if (rv != sizeof(cont_hdr)) {
+        return SKIPSET_ERR_FILEIO;
+    }
+    rv = skStreamWrite(stream, body, len);
+    if (rv != (ssize_t)len) {
         return SKIPSET_ERR_FILEIO;
     }
-
     return SKIPSET_OK;
 }
 
 
 /*
- *  status = ipsetWriteLegacyFromRadixCallbackV4(ipv4, prefix, &state);
- *  status = ipsetWriteLegacyFromRadixCallback(ipaddr, prefix, &state);
+ *  status = ipsetWriteSlash16FromContainer(ipset, stream);
  *
- *    Callback function used by ipsetWriteLegacyFromRadix().
+ *    Helper function for skIPSetWrite() via ipsetWriteSlash16().
  *
- *    This function is the callback invoked by skIPSetWalk().  When
- *    the current 'ipaddr' and 'prefix' are part of the same /24
- *    contained in 'state'->buffer, the IPs are added to that buffer.
- *    Otherwise, the buffer is printed if it contains data, and then
- *    the buffer is initialized with new data.
+ *    Write an IPset that uses /16 containers to 'stream' in the
+ *    IPSET_REC_VERSION_SLASH16 format.  Since a clean IPset holds
+ *    each /16 in the container the file would use, each container is
+ *    written as-is.
+ *
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
+ *    file format.
  */
 static int
-ipsetWriteLegacyFromRadixCallbackV4(
-    uint32_t            ipv4,
-    uint32_t            prefix,
-    void               *v_state)
+ipsetWriteSlash16FromContainer(
+    const skipset_t    *ipset,
+    skstream_t         *stream)
 {
-    ipset_write_silk2_t *state = (ipset_write_silk2_t*)v_state;
-    uint32_t slash24;
-    uint32_t buf_idx;
-    int i;
+    const ipset_slash16_t *node;
+    uint32_t cont_hdr[2];
+    uint32_t i;
+    size_t len;
     ssize_t rv;
 
-    /* get the /24 that holds this IP */
-    slash24 = ipv4 & 0xFFFFFF00;
+    /* sanity check input */
+    assert(ipset);
+    assert(stream);
+    if (ipset->is_dirty || !ipset->is_container) {
+        skAbort();
+    }
 
-    if (prefix <= 24) {
-        /* write the buffer if it contains data */
-        if (state->buffer_is_dirty) {
-            rv = skStreamWrite(state->stream, state->buffer,
-                               sizeof(state->buffer));
-            if (rv != sizeof(state->buffer)) {
-                return SKIPSET_ERR_FILEIO;
-            }
-            state->buffer_is_dirty = 0;
+    for (i = 0; i < SKIP_BBLOCK_COUNT; ++i) {
+        node = ipset->s.cont->slash16[i];
+        if (NULL == node) {
+            continue;
         }
-
-        /* initialize the buffer to all-1s */
-        memset(state->buffer, 0xff, sizeof(state->buffer));
-
-        /* loop over all /24s in this block and print each one */
-        for (i = 0; i < (1 << (24 - prefix)); ++i, slash24 += 256) {
-            state->buffer[0] = slash24;
-
-            rv = skStreamWrite(state->stream, state->buffer,
-                               sizeof(state->buffer));
-            if (rv != sizeof(state->buffer)) {
-                return SKIPSET_ERR_FILEIO;
-            }
+        switch (node->type) {
+          case SET_SLASH16_ARRAY:
+            len = node->count * sizeof(uint16_t);
+            break;
+          case SET_SLASH16_RUN:
+            len = 2 * node->count * sizeof(uint16_t);
+            break;
+          case SET_SLASH16_BITMAP:
+            len = sizeof(skIPNode_t);
+            break;
+          default:
+            skAbortBadCase(node->type);
         }
+        cont_hdr[0] = (i << 16) | node->type;
+        cont_hdr[1] = node->count;
 
-        return SKIPSET_OK;
-    }
-
-    if (!state->buffer_is_dirty) {
-        /* initialize the block to hold this /24 */
-        memset(state->buffer, 0, sizeof(state->buffer));
-        state->buffer[0] = slash24;
-        state->buffer_is_dirty = 1;
-    } else if (state->buffer[0] != slash24) {
-        /* the /24s are different---print the block and reset it */
-        rv = skStreamWrite(state->stream, state->buffer,sizeof(state->buffer));
-        if (rv != sizeof(state->buffer)) {
+        rv = skStreamWrite(stream, cont_hdr, sizeof(cont_hdr));
+        if (rv != sizeof(cont_hdr)) {
+            return SKIPSET_ERR_FILEIO;
+        }
+        rv = skStreamWrite(stream, node->b.vals, len);
+        if (rv != (ssize_t)len) {
             return SKIPSET_ERR_FILEIO;
         }
-        memset(state->buffer, 0, sizeof(state->buffer));
-        state->buffer[0] = slash24;
-    }
-    /* else data is in the same /24 */
-
-    /* add our IPs to the bitmap */
-    buf_idx = 1 + ((ipv4 & 0xFF) >> 5);
-
-    if (prefix <= 27) {
-        /* set several uint32_t's */
-        memset(&(state->buffer[buf_idx]), 0xff,
-               ((1 << (27 - prefix)) * sizeof(uint32_t)));
-    } else {
-        state->buffer[buf_idx] |= ((UINT32_MAX >> (32 - (1 << (32 - prefix))))
-                                   << (ipv4 & 0x1f & (0x1f << (32 - prefix))));
     }
-
     return SKIPSET_OK;
 }
 
-#if SK_ENABLE_IPV6
-static int
-ipsetWriteLegacyFromRadixCallback(
-    skipaddr_t         *ipaddr,
-    uint32_t            prefix,
-    void               *v_state)
-{
-    uint32_t ipv4;
-
-    /* get the IPv4 address */
-    if (skipaddrGetAsV4(ipaddr, &ipv4)) {
-        return SKIPSET_ERR_IPV6;
-    }
-    return ipsetWriteLegacyFromRadixCallbackV4(ipv4, prefix, v_state);
-}
-#endif  /* SK_ENABLE_IPV6 */
-
 
 /*
- *  status = ipsetWriteLegacyFromRadix(ipset, stream);
+ *  status = ipsetWriteSlash16FromIPTree(ipset, stream);
  *
- *    Helper function for skIPSetWrite() via ipsetWriteLegacy().
+ *    Helper function for skIPSetWrite() via ipsetWriteSlash16().
  *
- *    Write an IPset from the radix-tree IPset data structure to
- *    'stream' in the IPSET_REC_VERSION_LEGACY format.
+ *    Write an IPset from the SiLK-2 IPTree data structure to 'stream'
+ *    in the IPSET_REC_VERSION_SLASH16 format.  Each skIPNode_t is
+ *    written as one container.
  *
- *    See '#define IPSET_REC_VERSION_LEGACY' for description of the
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
  *    file format.
  */
 static int
-ipsetWriteLegacyFromRadix(
+ipsetWriteSlash16FromIPTree(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
-    sk_file_header_t *hdr;
-    ipset_write_silk2_t write_state;
-    ssize_t rv;
+    uint16_t *buf;
+    uint32_t i;
+    int rv = SKIPSET_OK;
 
     /* sanity check input */
     assert(ipset);
     assert(stream);
-    if (ipset->is_dirty || ipset->is_iptree || skIPSetContainsV6(ipset)) {
-        skAbort();
-    }
-    hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_LEGACY) {
+    if (ipset->is_dirty || !ipset->is_iptree || ipset->is_ipv6) {
         skAbort();
     }
 
-    memset(&write_state, 0, sizeof(write_state));
-    write_state.stream = stream;
-
-#if SK_ENABLE_IPV6
-    if (ipset->is_ipv6) {
-        rv = skIPSetWalk(ipset, 1, SK_IPV6POLICY_ASV4,
-                         &ipsetWriteLegacyFromRadixCallback,
-                         (void*)&write_state);
-    } else
-#endif
-    {
-        rv = ipsetWalkInternalV4(ipset, ipsetWriteLegacyFromRadixCallbackV4,
-                                 (void*)&write_state);
-    }
-    if (rv != 0) {
-        return rv;
+    buf = (uint16_t*)malloc(SET_SLASH16_MAX_VALUES * sizeof(uint16_t));
+    if (NULL == buf) {
+        return SKIPSET_ERR_ALLOC;
     }
 
-    if (write_state.buffer_is_dirty) {
-        rv = skStreamWrite(stream, write_state.buffer,
-                           sizeof(write_state.buffer));
-        if (rv != sizeof(write_state.buffer)) {
-            return SKIPSET_ERR_FILEIO;
+    for (i = 0; i < SKIP_BBLOCK_COUNT && SKIPSET_OK == rv; ++i) {
+        if (ipset->s.v2->nodes[i]) {
+            rv = ipsetWriteSlash16Container(
+                stream, i, ipset->s.v2->nodes[i]->addressBlock, buf);
         }
     }
 
-    rv = skStreamFlush(stream);
-    if (rv) {
-        return SKIPSET_ERR_FILEIO;
-    }
-
-    return SKIPSET_OK;
+    free(buf);
+    return rv;
 }
 
 
 /*
- *  status = ipsetWriteLegacy(&ipset, stream);
+ *  status = ipsetWriteSlash16FromRadixV4(ipset, stream);
  *
- *    Helper function for skIPSetWrite().
+ *    Helper function for skIPSetWrite() via ipsetWriteSlash16().
  *
- *    Write an IPset to 'stream' in the IPSET_REC_VERSION_LEGACY
- *    format.
+ *    Write an IPset from the radix-tree IPset data structure to
+ *    'stream' in the IPSET_REC_VERSION_SLASH16 format.  The CIDR
+ *    blocks in each /16 are collected into a bitmap that is written
+ *    when the iterator moves to the next /16.
  *
- *    This function writes the header then calls another helper
- *    function depending on the data structure being used.
+ *    See '#define IPSET_REC_VERSION_SLASH16' for description of the
+ *    file format.
  */
 static int
-ipsetWriteLegacy(
+ipsetWriteSlash16FromRadixV4(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
-    sk_file_header_t *hdr;
+    skipset_iterator_t iter;
+    skipaddr_t ipaddr;
+    skIPNode_t *bmap = NULL;
+    uint16_t *buf = NULL;
+    uint32_t slash16 = 0;
+    uint32_t prefix;
+    uint32_t first;
+    uint32_t last;
+    uint32_t range_end;
+    int is_dirty = 0;
     int rv;
 
     /* sanity check input */
     assert(ipset);
     assert(stream);
-    if (ipset->is_dirty || skIPSetContainsV6(ipset)) {
+    if (ipset->is_dirty || ipset->is_iptree || skIPSetContainsV6(ipset)) {
         skAbort();
     }
-    hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_LEGACY) {
-        skAbort();
+
+    bmap = (skIPNode_t*)calloc(1, sizeof(skIPNode_t));
+    buf = (uint16_t*)malloc(SET_SLASH16_MAX_VALUES * sizeof(uint16_t));
+    if (NULL == bmap || NULL == buf) {
+        rv = SKIPSET_ERR_ALLOC;
+        goto END;
+    }
+
+    skIPSetIteratorBind(&iter, ipset, 1, SK_IPV6POLICY_ASV4);
+    while (skIPSetIteratorNext(&iter, &ipaddr, &prefix) == SK_ITERATOR_OK){
+        first = skipaddrGetV4(&ipaddr);
+        last = ((prefix < 32) ? (first | (UINT32_MAX >> prefix)) : first);
+
+        /* a CIDR block larger than a /16 spans several containers */
+        for (;;) {
+            if (is_dirty && (first >> 16) != slash16) {
+                rv = ipsetWriteSlash16Container(stream, slash16,
+                                                bmap->addressBlock, buf);
+                if (rv) {
+                    goto END;
+                }
+                memset(bmap, 0, sizeof(skIPNode_t));
+            }
+            slash16 = first >> 16;
+            is_dirty = 1;
+            range_end = (((last >> 16) == slash16) ? last : (first | 0xFFFF));
+            ipsetSlash16SetRange(bmap->addressBlock,
+                                 first & 0xFFFF, range_end & 0xFFFF);
+            if (range_end == last) {
+                break;
+            }
+            first = range_end + 1;
+        }
+    }
+    if (is_dirty) {
+        rv = ipsetWriteSlash16Container(stream, slash16,
+                                        bmap->addressBlock, buf);
+        if (rv) {
+            goto END;
+        }
     }
 
-    rv = skStreamWriteSilkHeader(stream);
-    if (rv) {
-        return SKIPSET_ERR_FILEIO;
-    }
+    rv = SKIPSET_OK;
 
-    if (ipset->is_iptree) {
-        return ipsetWriteLegacyFromIPTree(ipset, stream);
-    }
-    return ipsetWriteLegacyFromRadix(ipset, stream);
+  END:
+    free(bmap);
+    free(buf);
+    return rv;
 }
 
 
 /*
- *  status = ipsetWriteRadix(ipset, stream);
+ *  status = ipsetWriteSlash16(ipset, stream);
  *
  *    Helper function for skIPSetWrite().
  *
- *    Write an IPset to 'stream' in the IPSET_REC_VERSION_RADIX
- *    format.
+ *    Write an IPset containing only IPv4 addresses to 'stream' in the
+ *    IPSET_REC_VERSION_SLASH16 format.
  *
- *    See '#define IPSET_REC_VERSION_RADIX' for description of the
- *    file format.
+ *    This function writes the header then calls another helper
+ *    function depending on the data structure being used.
  */
 static int
-ipsetWriteRadix(
+ipsetWriteSlash16(
     const skipset_t    *ipset,
     skstream_t         *stream)
 {
     sk_file_header_t *hdr;
-    skipset_t *set3 = NULL;
-    ssize_t rv;
+    int rv;
 
     /* sanity check input */
     assert(ipset);
     assert(stream);
-    if (ipset->is_dirty) {
+    if (ipset->is_dirty || skIPSetContainsV6(ipset)) {
         skAbort();
     }
     hdr = skStreamGetSilkHeader(stream);
-    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_RADIX) {
-        skAbort();
-    }
-
-    /* we must convert the IPTree to a Radix-Tree when writing an
-     * IPTree-based IPset to the IPSET_REC_VERSION_RADIX format */
-    if (ipset->is_iptree) {
-        skIPTreeCIDRBlockIterator_t cidr_iter;
-        skIPTreeCIDRBlock_t cidr;
-
-        /* create a Radix-based IPv4 IPset */
-        rv = ipsetCreate(&set3, 0, 1);
-        if (rv) {
-            goto END;
-        }
-
-        /* add the elements from 'ipset' to 'set3' */
-        ASSERT_OK(skIPTreeCIDRBlockIteratorBind(&cidr_iter, ipset->s.v2));
-        while ((rv = skIPTreeCIDRBlockIteratorNext(&cidr, &cidr_iter))
-               == SK_ITERATOR_OK)
-        {
-            rv = ipsetInsertAddressV4(set3, cidr.addr, cidr.mask, NULL);
-            if (rv) {
-                goto END;
-            }
-        }
-        rv = skIPSetClean(set3);
-        if (rv) {
-            goto END;
-        }
-
-        ipset = set3;
-    }
-
-    if (ipset->is_iptree) {
+    if (skHeaderGetRecordVersion(hdr) != IPSET_REC_VERSION_SLASH16) {
         skAbort();
     }
 
     /* Add the appropriate header */
-    rv = skHeaderAddIPSet(hdr, IPSET_NUM_CHILDREN,
-                          ipset->s.v3->leaves.entry_count,
-                          ipset->s.v3->leaves.entry_size,
-                          ipset->s.v3->nodes.entry_count,
-                          ipset->s.v3->nodes.entry_size,
-                          IPSET_ROOT_INDEX(ipset));
+    rv = skHeaderAddIPSet(hdr, 0, 0, sizeof(uint32_t), 0, 0, 0);
     if (rv) {
         skAppPrintErr("%s", skHeaderStrerror(rv));
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+        return SKIPSET_ERR_FILEIO;
     }
     rv = skStreamWriteSilkHeader(stream);
     if (rv) {
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+        return SKIPSET_ERR_FILEIO;
     }
 
-    /* write the arrays */
-    if (ipset->s.v3->nodes.entry_count) {
-        rv = skStreamWrite(stream, ipset->s.v3->nodes.buf,
-                           ((size_t)ipset->s.v3->nodes.entry_size
-                            * ipset->s.v3->nodes.entry_count));
-        if ((size_t)rv != ((size_t)ipset->s.v3->nodes.entry_size
-                           * ipset->s.v3->nodes.entry_count))
-        {
-            rv = SKIPSET_ERR_FILEIO;
-            goto END;
-        }
+    if (ipset->is_container) {
+        rv = ipsetWriteSlash16FromContainer(ipset, stream);
+    } else if (ipset->is_iptree) {
+        rv = ipsetWriteSlash16FromIPTree(ipset, stream);
+    } else {
+        rv = ipsetWriteSlash16FromRadixV4(ipset, stream);
     }
-    if (ipset->s.v3->leaves.entry_count) {
-        rv = skStreamWrite(stream, ipset->s.v3->leaves.buf,
-                           ((size_t)ipset->s.v3->leaves.entry_size
-                            * ipset->s.v3->leaves.entry_count));
-        if ((size_t)rv != ((size_t)ipset->s.v3->leaves.entry_size
-                           * ipset->s.v3->leaves.entry_count))
-        {
-            rv = SKIPSET_ERR_FILEIO;
-            goto END;
-        }
+    if (rv) {
+        return rv;
     }
 
     rv = skStreamFlush(stream);
     if (rv) {
-        rv = SKIPSET_ERR_FILEIO;
-        goto END;
+        return SKIPSET_ERR_FILEIO;
     }
-
-    /* success */
-    rv = SKIPSET_OK;
-
-  END:
-    skIPSetDestroy(&set3);
-    return rv;
+    return SKIPSET_OK;
 }
 
 
@@ -9292,7 +12728,7 @@ skIPSetCheckAddress(
 {
     uint32_t ipv4;
 
-    if (ipset->is_iptree) {
+    if (ipset->is_iptree || ipset->is_container) {
 #if SK_ENABLE_IPV6
         if (skipaddrIsV6(ipaddr)) {
             /* attempt to convert to IPv4 */
@@ -9306,6 +12742,9 @@ skIPSetCheckAddress(
             ipv4 = skipaddrGetV4(ipaddr);
         }
 
+        if (ipset->is_container) {
+            return ipsetContainerCheckAddress(ipset->s.cont, ipv4);
+        }
         return skIPTreeCheckAddress(ipset->s.v2, ipv4);
     }
 
@@ -9333,6 +12772,58 @@ skIPSetCheckAddress(
 }
 
 
+/* Check an array of IPs against 'ipset' */
+uint32_t
+skIPSetCheckAddresses(
+    const skipset_t    *ipset,
+    const skipaddr_t   *ips,
+    uint32_t            count,
+    uint8_t            *found)
+{
+    uint32_t ipv4[IPSET_CHECK_BATCH];
+    uint8_t valid[IPSET_CHECK_BATCH];
+    uint8_t hit[IPSET_CHECK_BATCH];
+    uint32_t num_found = 0;
+    uint32_t base;
+    uint32_t len;
+    uint32_t i;
+
+#if SK_ENABLE_IPV6
+    if (ipset->is_ipv6) {
+        for (i = 0; i < count; ++i) {
+            found[i] = (uint8_t)skIPSetCheckAddress(ipset, &ips[i]);
+            num_found += found[i];
+        }
+        return num_found;
+    }
+#endif  /* SK_ENABLE_IPV6 */
+
+    for (base = 0; base < count; base += len) {
+        len = count - base;
+        if (len > IPSET_CHECK_BATCH) {
+            len = IPSET_CHECK_BATCH;
+        }
+        for (i = 0; i < len; ++i) {
+#if SK_ENABLE_IPV6
+            if (skipaddrIsV6(&ips[base + i])) {
+                ipv4[i] = 0;
+                valid[i] = !skipaddrGetAsV4(&ips[base + i], &ipv4[i]);
+                continue;
+            }
+#endif
+            ipv4[i] = skipaddrGetV4(&ips[base + i]);
+            valid[i] = 1;
+        }
+        ipsetCheckBatchV4(ipset, ipv4, len, hit);
+        for (i = 0; i < len; ++i) {
+            found[base + i] = (hit[i] & valid[i]);
+            num_found += found[base + i];
+        }
+    }
+    return num_found;
+}
+
+
 /* Return true if 'ipset1' and 'ipset2' have any IPs in common. */
 int
 skIPSetCheckIPSet(
@@ -9350,6 +12841,25 @@ skIPSetCheckIPSet(
         return 0;
     }
 
+    if (ipset1->is_container || ipset2->is_container) {
+        if (ipset1->is_container && ipset2->is_container) {
+            return ipsetContainerCheckIPSet(ipset1->s.cont, ipset2->s.cont);
+        }
+        /* visit the IPv4 addresses of the other IPset and search for
+         * them in the containers */
+        if (ipset1->is_container) {
+            walk_set = ipset2;
+            search_set = ipset1;
+        } else {
+            walk_set = ipset1;
+            search_set = ipset2;
+        }
+        rv = skIPSetWalk(walk_set, 1, SK_IPV6POLICY_ASV4,
+                         &ipsetCheckIPSetCallbackContainer,
+                         (void*)search_set->s.cont);
+        return (SKIPSET_ERR_SUBSET == rv);
+    }
+
     if (ipset1->is_iptree) {
         if (ipset2->is_iptree) {
             /* both are SiLK-2 IPTrees */
@@ -9432,6 +12942,9 @@ skIPSetCheckIPWildcard(
     if (ipset->is_iptree) {
         return skIPTreeCheckIntersectIPWildcard(ipset->s.v2, ipwild);
     }
+    if (ipset->is_container) {
+        return ipsetContainerCheckIPWildcard(ipset->s.cont, ipwild);
+    }
 
     /* Iterate over the IPs from the wildcard */
 #if SK_ENABLE_IPV6
@@ -9588,16 +13101,90 @@ skIPSetCheckRecord(
     if (ipset->is_iptree) {
         return skIPTreeCheckAddress(ipset->s.v2, ipv4);
     }
+    if (ipset->is_container) {
+        return ipsetContainerCheckAddress(ipset->s.cont, ipv4);
+    }
     return (ipsetFindV4(ipset, ipv4, 32, NULL) == SKIPSET_OK);
 }
 
 
+/* Check a block of records against 'ipset' */
+uint32_t
+skIPSetCheckRecords(
+    const skipset_t    *ipset,
+    const rwRec        *recs,
+    const uint32_t     *sel,
+    uint32_t            count,
+    int                 src_dst_nh,
+    uint8_t            *found)
+{
+    uint32_t ipv4[IPSET_CHECK_BATCH];
+    uint8_t valid[IPSET_CHECK_BATCH];
+    uint8_t hit[IPSET_CHECK_BATCH];
+    const rwRec *rwrec;
+    uint32_t num_found = 0;
+    uint32_t base;
+    uint32_t len;
+    uint32_t i;
+    int which;
+
+    if (0 == src_dst_nh || (src_dst_nh & ~7)) {
+        skAbortBadCase(src_dst_nh);
+    }
+
+    memset(found, 0, count * sizeof(uint8_t));
+
+#if SK_ENABLE_IPV6
+    if (ipset->is_ipv6) {
+        for (i = 0; i < count; ++i) {
+            rwrec = (sel ? &recs[sel[i]] : &recs[i]);
+            for (which = 1; which <= 4 && !found[i]; which <<= 1) {
+                if (src_dst_nh & which) {
+                    found[i] = (uint8_t)skIPSetCheckRecord(ipset, rwrec,
+                                                           which);
+                }
+            }
+            num_found += found[i];
+        }
+        return num_found;
+    }
+#endif  /* SK_ENABLE_IPV6 */
+
+    for (base = 0; base < count; base += len) {
+        len = count - base;
+        if (len > IPSET_CHECK_BATCH) {
+            len = IPSET_CHECK_BATCH;
+        }
+        for (which = 1; which <= 4; which <<= 1) {
+            if (0 == (src_dst_nh & which)) {
+                continue;
+            }
+            for (i = 0; i < len; ++i) {
+                rwrec = (sel ? &recs[sel[base + i]] : &recs[base + i]);
+                ipv4[i] = 0;
+                valid[i] = !ipsetRecordGetV4(rwrec, which, &ipv4[i]);
+            }
+            ipsetCheckBatchV4(ipset, ipv4, len, hit);
+            for (i = 0; i < len; ++i) {
+                found[base + i] |= (hit[i] & valid[i]);
+            }
+        }
+        for (i = 0; i < len; ++i) {
+            num_found += found[base + i];
+        }
+    }
+    return num_found;
+}
+
+
 /* Make the ipset use as few nodes as possible and make sure the ipset
  * uses a contiguous region of memory. */
 int
 skIPSetClean(
     skipset_t          *ipset)
 {
+    int rv;
+
     if (!ipset) {
         return SKIPSET_ERR_BADINPUT;
     }
@@ -9608,6 +13195,14 @@ skIPSetClean(
     if (!ipset->is_dirty) {
         return SKIPSET_OK;
     }
+    if (ipset->is_container) {
+        rv = ipsetContainerClean(ipset->s.cont);
+        if (rv) {
+            return rv;
+        }
+        ipset->is_dirty = 0;
+        return SKIPSET_OK;
+    }
     if (0 == ipset->s.v3->nodes.entry_count) {
         skIPSetRemoveAll(ipset);
         ipset->is_dirty = 0;
@@ -9722,6 +13317,9 @@ skIPSetConvert(
     if (ipset->is_iptree) {
         return ipsetConvertIPTreetoV6(ipset);
     }
+    if (ipset->is_container) {
+        return ipsetConvertContainertoV6(ipset);
+    }
 
     IPSET_COPY_ON_WRITE(ipset);
 
@@ -9756,6 +13354,15 @@ skIPSetCountIPs(
         }
         return c;
     }
+    if (ipset->is_container) {
+        uint64_t c;
+
+        c = ipsetContainerCountIPs(ipset->s.cont);
+        if (count) {
+            *count = (double)c;
+        }
+        return c;
+    }
 
     memset(&count_state, 0, sizeof(ipset_count_t));
 
@@ -9916,6 +13523,9 @@ skIPSetCreate(
     }
 #endif  /* SK_ENABLE_IPV6 */
 
+    if (!support_ipv6 && IPSET_CONTAINER_ALWAYS == IPSET_USE_CONTAINER) {
+        return ipsetCreateContainer(ipset);
+    }
     if (IPSET_USE_IPTREE) {
         return ipsetCreate(ipset, support_ipv6, 0);
     }
@@ -9938,6 +13548,13 @@ skIPSetDestroy(
         *ipset = NULL;
         return;
     }
+    if ((*ipset)->is_container) {
+        ipsetContainerRemoveAll((*ipset)->s.cont);
+        free((*ipset)->s.cont);
+        free(*ipset);
+        *ipset = NULL;
+        return;
+    }
 
     if (getenv(IPSET_ENVAR_DESTROY_PRINT)) {
         skIPSetDebugPrint(*ipset);
@@ -10076,6 +13693,12 @@ skIPSetInsertAddress(
         ipset->is_dirty = 1;
         return ipsetInsertAddressIPTree(ipset, ipv4, prefix);
     }
+    if (ipset->is_container) {
+        ipset->is_dirty = 1;
+        return ipsetContainerInsertRange(
+            ipset->s.cont, ipv4,
+            ((prefix < 32) ? (ipv4 | (UINT32_MAX >> prefix)) : ipv4));
+    }
 
     rv = ipsetFindV4(ipset, ipv4, prefix, &find_state);
     if (SKIPSET_OK == rv) {
@@ -10208,6 +13831,14 @@ skIPSetInsertRange(
         }
 #endif  /* #else of #if !SK_ENABLE_IPV6 */
     }
+    if (ipset->is_container
+        && !skipaddrIsV6(ipaddr_start) && !skipaddrIsV6(ipaddr_end))
+    {
+        ipset->is_dirty = 1;
+        return ipsetContainerInsertRange(ipset->s.cont,
+                                         skipaddrGetV4(ipaddr_start),
+                                         skipaddrGetV4(ipaddr_end));
+    }
 
     /* get a modifiable version of the beginning IP */
     skipaddrCopy(&this_start, ipaddr_start);
@@ -10248,12 +13879,18 @@ skIPSetIntersect(
         skIPTreeIntersect(result_ipset->s.v2, ipset->s.v2);
         return SKIPSET_OK;
     }
+    if (result_ipset->is_container && ipset->is_container) {
+        result_ipset->is_dirty = 1;
+        return ipsetContainerIntersect(result_ipset->s.cont, ipset->s.cont);
+    }
 
     /* handle trivial cases */
-    if (!result_ipset->is_iptree && IPSET_ISEMPTY(result_ipset)) {
+    if (!result_ipset->is_iptree && !result_ipset->is_container
+        && IPSET_ISEMPTY(result_ipset))
+    {
         return SKIPSET_OK;
     }
-    if (!ipset->is_iptree && IPSET_ISEMPTY(ipset)) {
+    if (!ipset->is_iptree && !ipset->is_container && IPSET_ISEMPTY(ipset)) {
         skIPSetRemoveAll(result_ipset);
         return SKIPSET_OK;
     }
@@ -10377,6 +14014,12 @@ skIPSetIteratorNext(
     if (iter->ipset->is_iptree) {
         return ipsetIteratorNextIPTree(iter, ipaddr, prefix);
     }
+    if (iter->ipset->is_container) {
+        if (iter->iter.v3.cur >= SKIP_BBLOCK_COUNT) {
+            return SK_ITERATOR_NO_MORE_ENTRIES;
+        }
+        return ipsetIteratorNextContainer(iter, ipaddr, prefix);
+    }
 
     if (iter->iter.v3.cur >= iter->ipset->s.v3->leaves.entry_count) {
         return SK_ITERATOR_NO_MORE_ENTRIES;
@@ -10507,6 +14150,23 @@ skIPSetIteratorReset(
         }
         return;
     }
+    if (iter->ipset->is_container) {
+        memset(&iter->iter.v3, 0, sizeof(iter->iter.v3));
+#if SK_ENABLE_IPV6
+        if (iter->v6policy == SK_IPV6POLICY_ONLY) {
+            /* caller wants only IPv6 addresses, and there are none in
+             * an IPv4 IPset. */
+            iter->iter.v3.cur = SKIP_BBLOCK_COUNT;
+        }
+#else
+        if (iter->v6policy > SK_IPV6POLICY_MIX) {
+            /* caller wants IPv6 addresses, which are not supported in
+             * IPv4-only SiLK. */
+            iter->iter.v3.cur = SKIP_BBLOCK_COUNT;
+        }
+#endif  /* #else of #if SK_ENABLE_IPV6 */
+        return;
+    }
 
     iter->iter.v3.cur = IPSET_ITER_FIRST_LEAF;
     if (IPSET_ISEMPTY(iter->ipset)) {
@@ -10656,6 +14316,9 @@ skIPSetMask(
         skIPTreeMask(ipset->s.v2, mask_prefix);
         return SKIPSET_OK;
     }
+    if (ipset->is_container) {
+        return ipsetContainerMask(ipset, mask_prefix, 0);
+    }
 
     if (IPSET_ISEMPTY(ipset)) {
         return SKIPSET_OK;
@@ -10700,6 +14363,9 @@ skIPSetMaskAndFill(
     if (ipset->is_iptree) {
         return ipsetMaskAndFillIPTree(ipset, mask_prefix);
     }
+    if (ipset->is_container) {
+        return ipsetContainerMask(ipset, mask_prefix, 1);
+    }
 
     if (IPSET_ISEMPTY(ipset)) {
         return SKIPSET_OK;
@@ -11004,7 +14670,7 @@ skIPSetDebugPrint(
     sk_bitmap_t *isfree;
     int width = 0;
 
-    if (ipset->is_iptree) {
+    if (ipset->is_iptree || ipset->is_container) {
         return;
     }
 
@@ -11167,16 +14833,28 @@ skIPSetRead(
 
     if (skHeaderGetRecordVersion(hdr) < IPSET_REC_VERSION_RADIX) {
         /* Handle files in IPSET_REC_VERSION_LEGACY format */
-        return ipsetReadLegacy(ipset_out, stream, hdr);
-    }
-    if (skHeaderGetRecordVersion(hdr) == IPSET_REC_VERSION_RADIX) {
-        return ipsetReadRadix(ipset_out, stream, hdr);
-    }
-    if (skHeaderGetRecordVersion(hdr) == IPSET_REC_VERSION_CIDR_BMAP) {
-        return ipsetReadCidrbmap(ipset_out, stream, hdr);
+        rv = ipsetReadLegacy(ipset_out, stream, hdr);
+    } else if (skHeaderGetRecordVersion(hdr) == IPSET_REC_VERSION_RADIX) {
+        rv = ipsetReadRadix(ipset_out, stream, hdr);
+    } else if (skHeaderGetRecordVersion(hdr) == IPSET_REC_VERSION_CIDR_BMAP) {
+        rv = ipsetReadCidrbmap(ipset_out, stream, hdr);
+    } else if (skHeaderGetRecordVersion(hdr) == IPSET_REC_VERSION_SLASH16) {
+        return ipsetReadSlash16(ipset_out, stream, hdr);
+    } else {
+        skAbort();
     }
 
-    skAbort();
+    /* the other formats are read into an IPTree; convert it when all
+     * IPv4 IPsets use /16 containers */
+    if (SKIPSET_OK == rv && (*ipset_out)->is_iptree
+        && IPSET_CONTAINER_ALWAYS == IPSET_USE_CONTAINER)
+    {
+        rv = ipsetConvertIPTreetoContainer(*ipset_out);
+        if (rv) {
+            skIPSetDestroy(ipset_out);
+        }
+    }
+    return rv;
 }
 
 
@@ -11275,6 +14953,12 @@ skIPSetRemoveAddress(
     if (ipset->is_iptree) {
         return ipsetRemoveAddressIPTree(ipset, ipv4, prefix);
     }
+    if (ipset->is_container) {
+        ipset->is_dirty = 1;
+        return ipsetContainerRemoveRange(
+            ipset->s.cont, ipv4,
+            ((prefix < 32) ? (ipv4 | (UINT32_MAX >> prefix)) : ipv4));
+    }
 
     rv = ipsetFindV4(ipset, ipv4, prefix, &find_state);
     /* if IP was not found, we can return */
@@ -11307,6 +14991,11 @@ skIPSetRemoveAll(
         ASSERT_OK(skIPTreeRemoveAll(ipset->s.v2));
         return SKIPSET_OK;
     }
+    if (ipset->is_container) {
+        ipsetContainerRemoveAll(ipset->s.cont);
+        ipset->is_dirty = 0;
+        return SKIPSET_OK;
+    }
 
     IPSET_COPY_ON_WRITE(ipset);
 
@@ -11471,6 +15160,25 @@ skIPSetSubtract(
         return SKIPSET_OK;
     }
 
+    if (result_ipset->is_container) {
+        result_ipset->is_dirty = 1;
+        if (ipset->is_container) {
+            return ipsetContainerSubtract(result_ipset->s.cont,
+                                          ipset->s.cont);
+        }
+        /* remove the IPv4 addresses of the other IPset */
+        return skIPSetWalk(ipset, 1, SK_IPV6POLICY_ASV4,
+                           &ipsetSubtractCallback, (void*)result_ipset);
+    }
+    if (ipset->is_container) {
+        /* only 'ipset' uses /16 containers */
+        return ipsetWalkContainer(ipset, 1, (result_ipset->is_ipv6
+                                             ? SK_IPV6POLICY_FORCE
+                                             : SK_IPV6POLICY_ASV4),
+                                  &ipsetSubtractCallback,
+                                  (void*)result_ipset);
+    }
+
     if (ipset->is_iptree) {
         if (result_ipset->is_iptree) {
             /* both are in the SiLK-2 format (IPTree) */
@@ -11536,6 +15244,34 @@ skIPSetUnion(
         return SKIPSET_OK;
     }
 
+    if (result_ipset->is_container) {
+        if (ipset->is_container) {
+            result_ipset->is_dirty = 1;
+            return ipsetContainerUnion(result_ipset->s.cont, ipset->s.cont);
+        }
+        if (!skIPSetContainsV6(ipset)) {
+            result_ipset->is_dirty = 1;
+            return skIPSetWalk(ipset, 1, SK_IPV6POLICY_ASV4,
+                               &ipsetUnionCallback, (void*)result_ipset);
+        }
+#if SK_ENABLE_IPV6
+        if (result_ipset->no_autoconvert) {
+            return SKIPSET_ERR_IPV6;
+        }
+        rv = ipsetConvertContainertoV6(result_ipset);
+        if (rv) {
+            return rv;
+        }
+#endif  /* SK_ENABLE_IPV6 */
+    }
+    if (ipset->is_container) {
+        /* only 'ipset' uses /16 containers */
+        return ipsetWalkContainer(ipset, 1, (result_ipset->is_ipv6
+                                             ? SK_IPV6POLICY_FORCE
+                                             : SK_IPV6POLICY_ASV4),
+                                  &ipsetUnionCallback, (void*)result_ipset);
+    }
+
     if (ipset->is_iptree) {
         if (result_ipset->is_iptree) {
             /* both are in the SiLK-2 format (IPTree) */
@@ -11630,6 +15366,10 @@ skIPSetWalk(
         return ipsetWalkIPTree(ipset, cidr_blocks, v6_policy,
                                callback, cb_data);
     }
+    if (ipset->is_container) {
+        return ipsetWalkContainer(ipset, cidr_blocks, v6_policy,
+                                  callback, cb_data);
+    }
 
     if (IPSET_ISEMPTY(ipset)) {
         return SKIPSET_OK;
@@ -11723,7 +15463,9 @@ skIPSetWrite(
     } else if (skIPSetContainsV6(ipset)) {
         switch (opts->record_version) {
           case IPSET_REC_VERSION_LEGACY:
-            /* Cannot write an IPv6 IPset into a legacy IPset file */
+          case IPSET_REC_VERSION_SLASH16:
+            /* Cannot write an IPv6 IPset into a legacy or an
+             * IPv4-only IPset file */
             return SKIPSET_ERR_IPV6;
           case IPSET_REC_VERSION_RADIX:
           case IPSET_REC_VERSION_CIDR_BMAP:
@@ -11737,6 +15479,7 @@ skIPSetWrite(
           case IPSET_REC_VERSION_LEGACY:
           case IPSET_REC_VERSION_RADIX:
           case IPSET_REC_VERSION_CIDR_BMAP:
+          case IPSET_REC_VERSION_SLASH16:
             record_version = opts->record_version;
             break;
           default:
@@ -11747,6 +15490,27 @@ skIPSetWrite(
         return SKIPSET_ERR_BADINPUT;
     }
 
+    if (ipset->is_container && IPSET_REC_VERSION_SLASH16 != record_version) {
+        /* only the IPSET_REC_VERSION_SLASH16 format is written
+         * directly from /16 containers; copy the IPs into a radix
+         * tree to write the other formats */
+        skipset_t *radix_ipset;
+
+        rv = ipsetCreate(&radix_ipset, 0, 1);
+        if (rv) {
+            return (int)rv;
+        }
+        rv = ipsetWalkContainer(ipset, 1, SK_IPV6POLICY_ASV4,
+                                &ipsetUnionCallback, (void*)radix_ipset);
+        if (0 == rv) {
+            skIPSetClean(radix_ipset);
+            radix_ipset->options = ipset->options;
+            rv = skIPSetWrite(radix_ipset, stream);
+        }
+        skIPSetDestroy(&radix_ipset);
+        return (int)rv;
+    }
+
     /* prep the header */
     hdr = skStreamGetSilkHeader(stream);
     skHeaderSetFileFormat(hdr, FT_IPSET);
@@ -11781,6 +15545,9 @@ skIPSetWrite(
     if (IPSET_REC_VERSION_CIDR_BMAP == record_version) {
         return ipsetWriteCidrbmap(ipset, stream);
     }
+    if (IPSET_REC_VERSION_SLASH16 == record_version) {
+        return ipsetWriteSlash16(ipset, stream);
+    }
 
     skAbort();
 }
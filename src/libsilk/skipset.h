@@ -273,6 +273,26 @@ skIPSetCheckAddress(
     const skipaddr_t   *ip);
 
 
+/**
+ *    Check the 'count' IP addresses in the array 'ips' against
+ *    'ipset' in one call.  Set the corresponding element of the array
+ *    'found' to 1 if the IP is present in 'ipset' or to 0 otherwise,
+ *    and return the number of IPs that were found.  IP version
+ *    conversion is handled as in skIPSetCheckAddress().
+ *
+ *    This gives the same answers as calling skIPSetCheckAddress() for
+ *    each IP, but for IPv4 IPsets the lookups of the IPs are
+ *    interleaved so that fetching the data for one IP overlaps with
+ *    the checks of the others.
+ */
+uint32_t
+skIPSetCheckAddresses(
+    const skipset_t    *ipset,
+    const skipaddr_t   *ips,
+    uint32_t            count,
+    uint8_t            *found);
+
+
 /**
  *    Return 1 if the IPsets 'ipset1' and 'ipset2' have any IPs in
  *    common; otherwise, return 0.
@@ -338,6 +358,34 @@ skIPSetCheckRecord(
     skIPSetCheckRecord((ipset), (rwrec), 4)
 
 
+/**
+ *    Check a block of SiLK Flow records against 'ipset' in one call.
+ *
+ *    When 'sel' is NULL, check the 'count' records 'recs[0]' through
+ *    'recs[count-1]'.  Otherwise, 'sel' is an array of 'count'
+ *    indexes into 'recs' of the records to check.
+ *
+ *    'src_dst_nh' selects the IP address(es) to check as in
+ *    skIPSetCheckRecord(), except the values may be combined with
+ *    bitwise OR: a value of 3 checks whether either the source or the
+ *    destination IP address is in 'ipset'.
+ *
+ *    Set the i'th element of the array 'found' to 1 if the i'th
+ *    record checked has a selected IP in 'ipset' or to 0 otherwise,
+ *    and return the number of records that were found.
+ *
+ *    See also skIPSetCheckAddresses().
+ */
+uint32_t
+skIPSetCheckRecords(
+    const skipset_t    *ipset,
+    const rwRec        *recs,
+    const uint32_t     *sel,
+    uint32_t            count,
+    int                 src_dst_nh,
+    uint8_t            *found);
+
+
 /**
  *    Combines adjacent CIDR blocks into a larger blocks and makes
  *    certain the IPs in 'ipset' use a contiguous region of memory.
@@ -0,0 +1,369 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  skmerge-test.c
+**
+**  a simple testing harness for the skmerge k-way merge library
+**
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: skmerge-test.c $");
+
+#include <silk/skmerge.h>
+#include <silk/skstream.h>
+
+
+#define MAX_SOURCES 5
+#define MAX_LENGTH  8
+
+/* the number of stream sources and the records read at once */
+#define STREAM_SOURCES  3
+#define STREAM_READ     1000
+
+/* a record: a key and the source and position it came from */
+typedef struct test_rec_st {
+    int key;
+    int tag;
+} test_rec_t;
+
+/* a source of records */
+typedef struct test_src_st {
+    const int  *keys;
+    int         count;
+    int         pos;
+    int         id;
+} test_src_t;
+
+static int cmpfun_data = 0x55555555;
+
+static const int source_keys[MAX_SOURCES][MAX_LENGTH] = {
+    {  1,  4,  4,  9, 12, 20, 31, 40},
+    {  2,  4,  5,  9, 13, 21, 30, 41},
+    {  0,  4,  9,  9, 14, 22, 29, 42},
+    { 15, 16, 17, 18, 19, 50, 60, 70},
+    {  3,  3,  3,  3,  3,  3,  3,  3}
+};
+
+/* the number of records in each stream source.  The first holds
+ * more records than the merge buffers, and it is the only source
+ * left for its final records, which skMergeRead() copies in
+ * batches. */
+static const int stream_length[STREAM_SOURCES] = {5000, 1500, 300};
+
+
+static int
+compare(
+    const void         *rec_a,
+    const void         *rec_b,
+    void               *cmp_data)
+{
+    const test_rec_t *a = (const test_rec_t*)rec_a;
+    const test_rec_t *b = (const test_rec_t*)rec_b;
+
+    if (cmpfun_data != *(int*)cmp_data) {
+        fprintf(stderr, "Invalid cmp_data passed to compare().\n");
+        exit(EXIT_FAILURE);
+    }
+    if (a->key < b->key) {
+        return -1;
+    }
+    return (a->key > b->key);
+}
+
+
+static uint64_t
+prefix(
+    const void         *rec,
+    void        UNUSED(*cmp_data))
+{
+    /* records with keys in the same group of 8 have the same prefix */
+    return ((const test_rec_t*)rec)->key >> 3;
+}
+
+
+static int
+readSource(
+    void               *src_data,
+    void               *rec)
+{
+    test_src_t *src = (test_src_t*)src_data;
+    test_rec_t *r = (test_rec_t*)rec;
+
+    if (src->pos >= src->count) {
+        return 0;
+    }
+    r->key = src->keys[src->pos];
+    r->tag = 100 * src->id + src->pos;
+    ++src->pos;
+    return 1;
+}
+
+
+static void
+addSources(
+    sk_merge_t         *merge,
+    test_src_t         *src,
+    int                 num_sources,
+    int                 length)
+{
+    int i;
+
+    for (i = 0; i < num_sources; ++i) {
+        src[i].keys = source_keys[i];
+        src[i].count = length;
+        src[i].pos = 0;
+        src[i].id = i;
+        if (SKMERGE_OK != skMergeAddSource(merge, &readSource, &src[i])) {
+            printf("Cannot add source %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+/*
+ *    Write a temporary file holding 'count' records whose keys are
+ *    'id', 'id' + STREAM_SOURCES, 'id' + 2 * STREAM_SOURCES, ...,
+ *    followed by the first 'extra' octets of another record.  Return
+ *    the name of the file.
+ */
+static char *
+createStreamFile(
+    int                 id,
+    int                 count,
+    size_t              extra)
+{
+    char *name = strdup("/tmp/skmerge-test.XXXXXX");
+    test_rec_t r;
+    FILE *fp;
+    int fd;
+    int i;
+
+    fd = mkstemp(name);
+    if (-1 == fd || NULL == (fp = fdopen(fd, "wb"))) {
+        printf("Cannot create temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i <= count; ++i) {
+        r.key = STREAM_SOURCES * i + id;
+        r.tag = 10000 * id + i;
+        if (i < count) {
+            fwrite(&r, sizeof(r), 1, fp);
+        } else if (extra) {
+            fwrite(&r, extra, 1, fp);
+        }
+    }
+    if (fclose(fp)) {
+        printf("Cannot write temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    return name;
+}
+
+
+/*
+ *    Merge STREAM_SOURCES streams using skMergeRead().  When
+ *    'partial' is true, the final stream ends in a partial record.
+ */
+static void
+mergeStreams(
+    int                 partial)
+{
+    test_rec_t buf[STREAM_READ];
+    skstream_t *stream[STREAM_SOURCES];
+    char *name[STREAM_SOURCES];
+    sk_merge_t *merge;
+    ssize_t err;
+    size_t source;
+    size_t count;
+    size_t i;
+    long key_sum = 0;
+    int prev_key = -1;
+    int in_order = 1;
+    int rv;
+    int j;
+
+    printf("\n** merging %d streams%s using read...\n", STREAM_SOURCES,
+           (partial ? " ending in a partial record" : ""));
+    merge = skMergeCreate(sizeof(test_rec_t), STREAM_SOURCES, &compare,
+                          &cmpfun_data);
+    if (NULL == merge) {
+        printf("Cannot create merge\n");
+        exit(EXIT_FAILURE);
+    }
+    for (j = 0; j < STREAM_SOURCES; ++j) {
+        name[j] = createStreamFile(
+            j, stream_length[j],
+            ((partial && STREAM_SOURCES - 1 == j) ? sizeof(test_rec_t) / 2
+             : 0));
+        stream[j] = NULL;
+        if ((rv = skStreamCreate(&stream[j], SK_IO_READ,
+                                 SK_CONTENT_OTHERBINARY))
+            || (rv = skStreamBind(stream[j], name[j]))
+            || (rv = skStreamOpen(stream[j])))
+        {
+            printf("Cannot open stream %d\n", j);
+            exit(EXIT_FAILURE);
+        }
+        if (SKMERGE_OK != skMergeAddStream(merge, stream[j])) {
+            printf("Cannot add stream %d\n", j);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    while ((count = skMergeRead(merge, buf, STREAM_READ)) > 0) {
+        for (i = 0; i < count; ++i) {
+            if (buf[i].key < prev_key) {
+                in_order = 0;
+            }
+            prev_key = buf[i].key;
+            key_sum += buf[i].key;
+        }
+        printf("read %u: %d/%d .. %d/%d\n", (unsigned)count,
+               buf[0].key, buf[0].tag, buf[count-1].key, buf[count-1].tag);
+    }
+    printf("%s; sum of keys %ld\n", (in_order ? "in order" : "NOT IN ORDER"),
+           key_sum);
+
+    err = skMergeGetError(merge, &source);
+    if (0 == err) {
+        printf("no error\n");
+    } else if (SKSTREAM_ERR_READ_SHORT == err) {
+        printf("partial record in stream %u\n", (unsigned)source);
+    } else {
+        printf("error %ld in stream %u\n", (long)err, (unsigned)source);
+    }
+
+    skMergeDestroy(&merge);
+    for (j = 0; j < STREAM_SOURCES; ++j) {
+        skStreamDestroy(&stream[j]);
+        unlink(name[j]);
+        free(name[j]);
+    }
+}
+
+
+int main(void)
+{
+    test_src_t src[MAX_SOURCES];
+    test_rec_t buf[6];
+    const void *top;
+    sk_merge_t *merge;
+    size_t source;
+    size_t count;
+    size_t i;
+    int num_sources;
+    int use_prefix;
+
+    for (use_prefix = 0; use_prefix < 2; ++use_prefix) {
+        merge = skMergeCreate(sizeof(test_rec_t), MAX_SOURCES, &compare,
+                              &cmpfun_data);
+        if (NULL == merge) {
+            printf("Cannot create merge\n");
+            exit(EXIT_FAILURE);
+        }
+        if (use_prefix) {
+            skMergeSetPrefixFunction(merge, &prefix);
+        }
+
+        for (num_sources = 0; num_sources <= MAX_SOURCES; ++num_sources) {
+            printf("\n** merging %d sources%s using top/next...\n",
+                   num_sources, (use_prefix ? " with prefix" : ""));
+            addSources(merge, src, num_sources, MAX_LENGTH - num_sources);
+            while (SKMERGE_OK == skMergeTop(merge, &top, &source)) {
+                printf("%4d  %3d  %u\n", ((const test_rec_t*)top)->key,
+                       ((const test_rec_t*)top)->tag, (unsigned)source);
+                skMergeNext(merge);
+            }
+            skMergeReset(merge);
+
+            printf("\n** merging %d sources%s using read...\n",
+                   num_sources, (use_prefix ? " with prefix" : ""));
+            addSources(merge, src, num_sources, MAX_LENGTH);
+            while ((count = skMergeRead(merge, buf, 6)) > 0) {
+                printf("read %u:", (unsigned)count);
+                for (i = 0; i < count; ++i) {
+                    printf(" %d/%d", buf[i].key, buf[i].tag);
+                }
+                printf("\n");
+            }
+            skMergeReset(merge);
+        }
+
+        printf("\n** adding too many sources...");
+        addSources(merge, src, MAX_SOURCES, MAX_LENGTH);
+        if (SKMERGE_ERR_FULL == skMergeAddSource(merge, &readSource, src)) {
+            printf("OK\n");
+        } else {
+            printf("NOPE\n");
+        }
+        skMergeDestroy(&merge);
+        skMergeDestroy(&merge);
+    }
+
+    mergeStreams(0);
+    mergeStreams(1);
+
+    return 0;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -0,0 +1,652 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  skmerge.c
+**
+**    A k-way merge of sorted sources using a tournament (loser) tree.
+**
+**    The tree has L leaves, where L is the smallest power of two that
+**    is at least the number of sources.  Leaf i holds the current
+**    record of source i; leaves beyond the number of sources hold
+**    sources that are always exhausted.  The internal nodes are
+**    stored in tree[1] through tree[L-1], where the children of node
+**    n are 2n and 2n+1 and leaf i is node L+i.  Each internal node
+**    holds the index of the source that lost the match played at
+**    that node, and tree[0] holds the overall winner.
+**
+**    To advance, the winner's source reads its next record, and that
+**    record replays the matches on the path from its leaf to the
+**    root, swapping places with any stored loser that beats it.  This
+**    takes one comparison per level and, unlike a heap, never needs
+**    to compare siblings.
+**
+*/
+
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: skmerge.c $");
+
+#include <silk/skmerge.h>
+#include <silk/skstream.h>
+
+
+/* TYPEDEFS AND DEFINES */
+
+/*
+ *    The approximate number of octets to read from a stream source
+ *    at one time.  The merge reads at least one record.
+ */
+#define MERGE_STREAM_BUFSIZE  0x4000
+
+/*
+ *    A source of records.
+ */
+typedef struct merge_source_st {
+    /* the stream to read, or NULL for a callback source */
+    skstream_t         *stream;
+    /* the callback and its data, for a callback source */
+    sk_merge_read_fn_t  read_fn;
+    void               *src_data;
+    /* buffer of records; holds one record for a callback source */
+    uint8_t            *buf;
+    /* the allocated size of 'buf' */
+    size_t              buf_cap;
+    /* the number of valid octets in 'buf' */
+    size_t              buf_len;
+    /* the current record, or NULL when the source is exhausted */
+    const uint8_t      *rec;
+    /* the prefix of the current record's key */
+    uint64_t            prefix;
+    /* for a stream, a read error to report once the complete records
+     * read before it have been used */
+    ssize_t             pending_err;
+} merge_source_t;
+
+/* The merge object */
+struct sk_merge_st {
+    /* the sources; 'leaf_count' entries are valid once started */
+    merge_source_t     *src;
+    /* the loser tree; 'leaf_count' entries */
+    size_t             *tree;
+    sk_merge_cmp_fn_t   cmp_fn;
+    void               *cmp_data;
+    sk_merge_prefix_fn_t prefix_fn;
+    size_t              rec_size;
+    size_t              max_sources;
+    size_t              source_count;
+    /* the number of leaves in the tree; a power of 2 */
+    size_t              leaf_count;
+    /* the number of sources that are not exhausted */
+    size_t              active_count;
+    /* the first read error and the source where it occurred */
+    ssize_t             err_value;
+    size_t              err_source;
+    /* whether the first record from each source has been read */
+    unsigned            started :1;
+};
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  is_before = mergeBeats(merge, a, b);
+ *
+ *    Return true if the current record of source 'a' must be returned
+ *    before that of source 'b'.  An exhausted source loses to every
+ *    other source.  Ties are broken by source index.
+ */
+static int
+mergeBeats(
+    const sk_merge_t   *merge,
+    size_t              a,
+    size_t              b)
+{
+    const merge_source_t *sa = &merge->src[a];
+    const merge_source_t *sb = &merge->src[b];
+    int rv;
+
+    if (NULL == sa->rec) {
+        return 0;
+    }
+    if (NULL == sb->rec) {
+        return 1;
+    }
+    if (merge->prefix_fn && sa->prefix != sb->prefix) {
+        return (sa->prefix < sb->prefix);
+    }
+    rv = merge->cmp_fn(sa->rec, sb->rec, merge->cmp_data);
+    if (rv) {
+        return (rv < 0);
+    }
+    return (a < b);
+}
+
+
+/*
+ *  mergeSetError(merge, source, err);
+ *
+ *    Record the read error 'err' on 'source' unless an earlier error
+ *    has been recorded, and mark the source as exhausted.
+ */
+static void
+mergeSetError(
+    sk_merge_t         *merge,
+    size_t              source,
+    ssize_t             err)
+{
+    if (0 == merge->err_value) {
+        merge->err_value = err;
+        merge->err_source = source;
+    }
+    merge->src[source].rec = NULL;
+}
+
+
+/*
+ *  mergeFill(merge, source);
+ *
+ *    Read the next record or block of records from 'source' into its
+ *    buffer, and set its current record, or set the current record
+ *    to NULL when the source is exhausted.  Decrement the active
+ *    count when the source becomes exhausted.  When a stream ends in
+ *    a partial record or a read fails after some complete records
+ *    were read, those records are used and the error is recorded on
+ *    the following call.
+ */
+static void
+mergeFill(
+    sk_merge_t         *merge,
+    size_t              source)
+{
+    merge_source_t *s = &merge->src[source];
+    ssize_t got;
+    ssize_t more;
+    size_t partial;
+    int rv;
+
+    if (NULL == s->stream) {
+        rv = s->read_fn(s->src_data, s->buf);
+        if (1 == rv) {
+            s->rec = s->buf;
+        } else if (0 == rv) {
+            s->rec = NULL;
+        } else {
+            mergeSetError(merge, source, rv);
+        }
+    } else if (s->pending_err) {
+        mergeSetError(merge, source, s->pending_err);
+    } else {
+        got = skStreamRead(s->stream, s->buf, s->buf_cap);
+        if (got > 0) {
+            partial = (size_t)got % merge->rec_size;
+            if (partial) {
+                /* complete the final record */
+                more = skStreamRead(s->stream, s->buf + got,
+                                    merge->rec_size - partial);
+                if (more == (ssize_t)(merge->rec_size - partial)) {
+                    got += more;
+                } else {
+                    s->pending_err = ((more < 0)
+                                      ? more : SKSTREAM_ERR_READ_SHORT);
+                    got -= partial;
+                    if (0 == got) {
+                        mergeSetError(merge, source, s->pending_err);
+                        goto END;
+                    }
+                }
+            }
+            s->buf_len = (size_t)got;
+            s->rec = s->buf;
+        } else if (0 == got) {
+            s->rec = NULL;
+        } else {
+            mergeSetError(merge, source, got);
+        }
+    }
+
+  END:
+    if (NULL == s->rec) {
+        --merge->active_count;
+    } else if (merge->prefix_fn) {
+        s->prefix = merge->prefix_fn(s->rec, merge->cmp_data);
+    }
+}
+
+
+/*
+ *  mergeAdvance(merge, source);
+ *
+ *    Move 'source' to its next record, reading from the source when
+ *    its buffer is empty.
+ */
+static void
+mergeAdvance(
+    sk_merge_t         *merge,
+    size_t              source)
+{
+    merge_source_t *s = &merge->src[source];
+
+    if (s->stream) {
+        s->rec += merge->rec_size;
+        if (s->rec < s->buf + s->buf_len) {
+            if (merge->prefix_fn) {
+                s->prefix = merge->prefix_fn(s->rec, merge->cmp_data);
+            }
+            return;
+        }
+    }
+    mergeFill(merge, source);
+}
+
+
+/*
+ *  winner = mergeBuild(merge, node);
+ *
+ *    Play the matches in the subtree rooted at 'node', store the
+ *    loser of each match in the tree, and return the winner.
+ */
+static size_t
+mergeBuild(
+    sk_merge_t         *merge,
+    size_t              node)
+{
+    size_t left;
+    size_t right;
+
+    if (node >= merge->leaf_count) {
+        return node - merge->leaf_count;
+    }
+    left = mergeBuild(merge, 2 * node);
+    right = mergeBuild(merge, 2 * node + 1);
+    if (mergeBeats(merge, left, right)) {
+        merge->tree[node] = right;
+        return left;
+    }
+    merge->tree[node] = left;
+    return right;
+}
+
+
+/*
+ *  mergeReplay(merge);
+ *
+ *    Replay the matches from the leaf of the current winner to the
+ *    root after the winner's record has changed.
+ */
+static void
+mergeReplay(
+    sk_merge_t         *merge)
+{
+    size_t winner = merge->tree[0];
+    size_t node = (merge->leaf_count + winner) >> 1;
+    size_t tmp;
+
+    for ( ; node > 0; node >>= 1) {
+        if (mergeBeats(merge, merge->tree[node], winner)) {
+            tmp = merge->tree[node];
+            merge->tree[node] = winner;
+            winner = tmp;
+        }
+    }
+    merge->tree[0] = winner;
+}
+
+
+/*
+ *  mergeStart(merge);
+ *
+ *    Read the first record from every source and build the tree.
+ */
+static void
+mergeStart(
+    sk_merge_t         *merge)
+{
+    size_t i;
+
+    merge->started = 1;
+    merge->leaf_count = 1;
+    while (merge->leaf_count < merge->source_count) {
+        merge->leaf_count <<= 1;
+    }
+    merge->active_count = merge->source_count;
+    for (i = 0; i < merge->source_count; ++i) {
+        mergeFill(merge, i);
+    }
+    for ( ; i < merge->leaf_count; ++i) {
+        merge->src[i].rec = NULL;
+    }
+    merge->tree[0] = mergeBuild(merge, 1);
+}
+
+
+/*
+ *  rv = mergeAddSource(merge, stream, read_fn, src_data);
+ *
+ *    Helper for skMergeAddStream() and skMergeAddSource().
+ */
+static int
+mergeAddSource(
+    sk_merge_t         *merge,
+    skstream_t         *stream,
+    sk_merge_read_fn_t  read_fn,
+    void               *src_data)
+{
+    merge_source_t *s;
+    size_t cap;
+    uint8_t *buf;
+
+    if (merge->started || merge->source_count >= merge->max_sources) {
+        return SKMERGE_ERR_FULL;
+    }
+    s = &merge->src[merge->source_count];
+
+    if (NULL == stream) {
+        cap = merge->rec_size;
+    } else if (merge->rec_size >= MERGE_STREAM_BUFSIZE) {
+        cap = merge->rec_size;
+    } else {
+        cap = MERGE_STREAM_BUFSIZE - MERGE_STREAM_BUFSIZE % merge->rec_size;
+    }
+    if (s->buf_cap != cap) {
+        buf = (uint8_t*)realloc(s->buf, cap);
+        if (NULL == buf) {
+            return SKMERGE_ERR_MEMORY;
+        }
+        s->buf = buf;
+        s->buf_cap = cap;
+    }
+    s->stream = stream;
+    s->read_fn = read_fn;
+    s->src_data = src_data;
+    s->buf_len = 0;
+    s->rec = NULL;
+    s->pending_err = 0;
+    ++merge->source_count;
+    return SKMERGE_OK;
+}
+
+
+sk_merge_t *
+skMergeCreate(
+    size_t              rec_size,
+    size_t              max_sources,
+    sk_merge_cmp_fn_t   cmp_fn,
+    void               *cmp_data)
+{
+    sk_merge_t *merge;
+    size_t leaf_count;
+
+    if (0 == rec_size || 0 == max_sources || NULL == cmp_fn) {
+        return NULL;
+    }
+    leaf_count = 1;
+    while (leaf_count < max_sources) {
+        leaf_count <<= 1;
+    }
+
+    merge = (sk_merge_t*)calloc(1, sizeof(sk_merge_t));
+    if (NULL == merge) {
+        return NULL;
+    }
+    merge->src = (merge_source_t*)calloc(leaf_count, sizeof(merge_source_t));
+    merge->tree = (size_t*)calloc(leaf_count, sizeof(size_t));
+    if (NULL == merge->src || NULL == merge->tree) {
+        free(merge->src);
+        free(merge->tree);
+        free(merge);
+        return NULL;
+    }
+    merge->rec_size = rec_size;
+    merge->max_sources = max_sources;
+    merge->cmp_fn = cmp_fn;
+    merge->cmp_data = cmp_data;
+    return merge;
+}
+
+
+void
+skMergeDestroy(
+    sk_merge_t        **merge)
+{
+    size_t i;
+
+    if (NULL == merge || NULL == *merge) {
+        return;
+    }
+    for (i = 0; i < (*merge)->max_sources; ++i) {
+        free((*merge)->src[i].buf);
+    }
+    free((*merge)->src);
+    free((*merge)->tree);
+    free(*merge);
+    *merge = NULL;
+}
+
+
+void
+skMergeSetPrefixFunction(
+    sk_merge_t             *merge,
+    sk_merge_prefix_fn_t    prefix_fn)
+{
+    assert(merge);
+    assert(0 == merge->source_count);
+    merge->prefix_fn = prefix_fn;
+}
+
+
+int
+skMergeAddStream(
+    sk_merge_t         *merge,
+    skstream_t         *stream)
+{
+    assert(merge);
+    assert(stream);
+    return mergeAddSource(merge, stream, NULL, NULL);
+}
+
+
+int
+skMergeAddSource(
+    sk_merge_t         *merge,
+    sk_merge_read_fn_t  read_fn,
+    void               *src_data)
+{
+    assert(merge);
+    assert(read_fn);
+    return mergeAddSource(merge, NULL, read_fn, src_data);
+}
+
+
+size_t
+skMergeGetSourceCount(
+    const sk_merge_t   *merge)
+{
+    assert(merge);
+    return merge->source_count;
+}
+
+
+int
+skMergeTop(
+    sk_merge_t         *merge,
+    const void        **rec,
+    size_t             *source)
+{
+    assert(merge);
+    assert(rec);
+
+    if (!merge->started) {
+        mergeStart(merge);
+    }
+    if (0 == merge->active_count) {
+        return SKMERGE_ERR_EMPTY;
+    }
+    *rec = merge->src[merge->tree[0]].rec;
+    if (source) {
+        *source = merge->tree[0];
+    }
+    return SKMERGE_OK;
+}
+
+
+int
+skMergeNext(
+    sk_merge_t         *merge)
+{
+    assert(merge);
+
+    if (!merge->started) {
+        mergeStart(merge);
+    }
+    if (0 == merge->active_count) {
+        return SKMERGE_ERR_EMPTY;
+    }
+    mergeAdvance(merge, merge->tree[0]);
+    mergeReplay(merge);
+    return ((merge->active_count) ? SKMERGE_OK : SKMERGE_ERR_EMPTY);
+}
+
+
+size_t
+skMergeRead(
+    sk_merge_t         *merge,
+    void               *buf,
+    size_t              count)
+{
+    uint8_t *out = (uint8_t*)buf;
+    merge_source_t *s;
+    size_t avail;
+    size_t n = 0;
+
+    assert(merge);
+    assert(buf);
+
+    if (!merge->started) {
+        mergeStart(merge);
+    }
+    while (n < count && merge->active_count > 1) {
+        s = &merge->src[merge->tree[0]];
+        memcpy(out, s->rec, merge->rec_size);
+        out += merge->rec_size;
+        ++n;
+        mergeAdvance(merge, merge->tree[0]);
+        mergeReplay(merge);
+    }
+    if (n < count && 1 == merge->active_count) {
+        /* only one source remains; copy its records directly */
+        s = &merge->src[merge->tree[0]];
+        while (n < count && s->rec) {
+            if (s->stream) {
+                avail = ((s->buf + s->buf_len - s->rec) / merge->rec_size);
+                if (avail > count - n) {
+                    avail = count - n;
+                }
+                memcpy(out, s->rec, avail * merge->rec_size);
+                out += avail * merge->rec_size;
+                n += avail;
+                s->rec += (avail - 1) * merge->rec_size;
+            } else {
+                memcpy(out, s->rec, merge->rec_size);
+                out += merge->rec_size;
+                ++n;
+            }
+            mergeAdvance(merge, merge->tree[0]);
+        }
+    }
+    return n;
+}
+
+
+ssize_t
+skMergeGetError(
+    const sk_merge_t   *merge,
+    size_t             *source)
+{
+    assert(merge);
+    if (merge->err_value && source) {
+        *source = merge->err_source;
+    }
+    return merge->err_value;
+}
+
+
+void
+skMergeReset(
+    sk_merge_t         *merge)
+{
+    size_t i;
+
+    assert(merge);
+    for (i = 0; i < merge->source_count; ++i) {
+        merge->src[i].stream = NULL;
+        merge->src[i].read_fn = NULL;
+        merge->src[i].src_data = NULL;
+        merge->src[i].rec = NULL;
+    }
+    merge->source_count = 0;
+    merge->leaf_count = 0;
+    merge->active_count = 0;
+    merge->err_value = 0;
+    merge->err_source = 0;
+    merge->started = 0;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
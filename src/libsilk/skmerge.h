@@ -0,0 +1,310 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  skmerge.h
+**
+**    A k-way merge of sorted sources using a tournament (loser) tree.
+**
+*/
+#ifndef _SKMERGE_H
+#define _SKMERGE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <silk/silk.h>
+
+RCSIDENTVAR(rcsID_SKMERGE_H, "$SiLK: skmerge.h $");
+
+#include <silk/silk_types.h>
+
+/**
+ *  @file
+ *
+ *    Merge records from multiple sorted sources into a single sorted
+ *    sequence.
+ *
+ *    The merge keeps the current record of each source in a loser
+ *    tree, so that producing each record requires one comparison per
+ *    level of the tree---about log2(k) comparisons for k sources,
+ *    half the number that a heap requires.  The caller may provide a
+ *    function that computes an integer prefix of each record's key;
+ *    the prefixes are cached and compared before calling the full
+ *    comparison function.
+ *
+ *    A source is either an skstream_t containing fixed-size records,
+ *    which the merge reads in blocks, or a caller-supplied function
+ *    that returns one record at a time.  Records that compare as
+ *    equal are returned in the order in which their sources were
+ *    added, making the merge stable.
+ *
+ *    This file is part of libsilk.
+ */
+
+
+/**
+ *    Return value to indicate success
+ */
+#define SKMERGE_OK 0
+
+/**
+ *    Return value when the merge has no more records.
+ */
+#define SKMERGE_ERR_EMPTY 1
+
+/**
+ *    Return value when attempting to add more sources than the merge
+ *    was created to hold, or to add a source once the merge has
+ *    started.
+ */
+#define SKMERGE_ERR_FULL 2
+
+/**
+ *    Return value when memory cannot be allocated.
+ */
+#define SKMERGE_ERR_MEMORY 3
+
+
+/**
+ *    The merge object
+ */
+typedef struct sk_merge_st sk_merge_t;
+
+/**
+ *    The signature of the comparison function that the caller passes
+ *    to skMergeCreate().  The function must return a value less than,
+ *    equal to, or greater than 0 when the record 'rec_a' sorts
+ *    before, the same as, or after 'rec_b'.  The third argument is
+ *    the 'cmp_data' that was passed to skMergeCreate().
+ */
+typedef int (*sk_merge_cmp_fn_t)(
+    const void         *rec_a,
+    const void         *rec_b,
+    void               *cmp_data);
+
+/**
+ *    The signature of the optional function that computes the key
+ *    prefix of the record 'rec'; see skMergeSetPrefixFunction().  The
+ *    second argument is the 'cmp_data' that was passed to
+ *    skMergeCreate().
+ */
+typedef uint64_t (*sk_merge_prefix_fn_t)(
+    const void         *rec,
+    void               *cmp_data);
+
+/**
+ *    The signature of the function that reads a record from a source
+ *    that was added by skMergeAddSource().  The function must copy the
+ *    next record from the source 'src_data' into 'rec' and return 1,
+ *    return 0 when the source has no more records, or return -1 on
+ *    error.
+ */
+typedef int (*sk_merge_read_fn_t)(
+    void               *src_data,
+    void               *rec);
+
+
+/**
+ *    Create a merge object that merges records of 'rec_size' octets
+ *    from as many as 'max_sources' sources, using 'cmp_fn' to order
+ *    the records.  'cmp_data' is passed as the final argument to
+ *    'cmp_fn'.  Return NULL if memory cannot be allocated.
+ */
+sk_merge_t *
+skMergeCreate(
+    size_t              rec_size,
+    size_t              max_sources,
+    sk_merge_cmp_fn_t   cmp_fn,
+    void               *cmp_data);
+
+
+/**
+ *    Destroy the merge object at '*merge' and set '*merge' to NULL.
+ *    Do nothing if 'merge' or '*merge' is NULL.  The streams added to
+ *    the merge are not closed.
+ */
+void
+skMergeDestroy(
+    sk_merge_t        **merge);
+
+
+/**
+ *    Use 'prefix_fn' to compute a prefix of the key for each record
+ *    that enters the merge.  The prefixes must agree with the
+ *    comparison function: when the prefix of record A is less than
+ *    that of record B, A must sort before B, and records that compare
+ *    as equal must have the same prefix.  The comparison function is
+ *    only called when two prefixes are equal.  This function must be
+ *    called before any source is added.
+ */
+void
+skMergeSetPrefixFunction(
+    sk_merge_t             *merge,
+    sk_merge_prefix_fn_t    prefix_fn);
+
+
+/**
+ *    Add 'stream' as a source of records to 'merge'.  The stream must
+ *    be open for reading and contain sorted records that are each
+ *    'rec_size' octets.  The merge reads the stream in blocks; the
+ *    caller must not read from the stream while the merge is in use.
+ *
+ *    Return SKMERGE_OK on success, SKMERGE_ERR_FULL if 'merge' has
+ *    'max_sources' sources or has started, or SKMERGE_ERR_MEMORY if
+ *    the read buffer cannot be allocated.
+ */
+int
+skMergeAddStream(
+    sk_merge_t         *merge,
+    skstream_t         *stream);
+
+
+/**
+ *    Add a source of records to 'merge' that calls 'read_fn' with
+ *    'src_data' to get each record.  The records that 'read_fn'
+ *    returns must be sorted.  Return values are as for
+ *    skMergeAddStream().
+ */
+int
+skMergeAddSource(
+    sk_merge_t         *merge,
+    sk_merge_read_fn_t  read_fn,
+    void               *src_data);
+
+
+/**
+ *    Return the number of sources that have been added to 'merge'.
+ */
+size_t
+skMergeGetSourceCount(
+    const sk_merge_t   *merge);
+
+
+/**
+ *    Set 'rec' to point to the lowest record in 'merge' and, when
+ *    'source' is not NULL, set 'source' to the index of the source
+ *    that holds it, where the first source added is 0.  The record
+ *    remains valid until the next call to skMergeNext(),
+ *    skMergeRead(), or skMergeReset().  Return SKMERGE_ERR_EMPTY if
+ *    no records remain.
+ *
+ *    The first call to this function, skMergeNext(), or skMergeRead()
+ *    reads the first record from every source; no sources may be
+ *    added after that.
+ */
+int
+skMergeTop(
+    sk_merge_t         *merge,
+    const void        **rec,
+    size_t             *source);
+
+
+/**
+ *    Replace the lowest record in 'merge' with the next record from
+ *    its source.  Return SKMERGE_ERR_EMPTY if no records remain after
+ *    the lowest record is removed.
+ */
+int
+skMergeNext(
+    sk_merge_t         *merge);
+
+
+/**
+ *    Copy as many as 'count' records from 'merge' into 'buf' in
+ *    order, removing them from the merge.  Return the number of
+ *    records copied, which is less than 'count' only when no records
+ *    remain.
+ */
+size_t
+skMergeRead(
+    sk_merge_t         *merge,
+    void               *buf,
+    size_t              count);
+
+
+/**
+ *    Return 0 if every read from the sources of 'merge' succeeded.
+ *    Otherwise, return the value that the failed read returned, and,
+ *    when 'source' is not NULL, set it to the index of that source.
+ *    For a stream, the value is the return value of skStreamRead(),
+ *    or SKSTREAM_ERR_READ_SHORT when the stream ends in a partial
+ *    record.  A source whose read fails is treated as having no more
+ *    records once the complete records read before the failure have
+ *    been returned.
+ */
+ssize_t
+skMergeGetError(
+    const sk_merge_t   *merge,
+    size_t             *source);
+
+
+/**
+ *    Remove all sources from 'merge' so that it may be used for a new
+ *    merge.  The streams that were added to the merge are not closed.
+ */
+void
+skMergeReset(
+    sk_merge_t         *merge);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _SKMERGE_H */
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
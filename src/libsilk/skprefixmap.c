@@ -112,6 +112,30 @@
 **    Version 5: (SiLK-3.5.0) Key is an IPv6 address.  There is no
 **    dictionary, and the value represents the country code.
 **
+**    In every version the tree is written as an array of records in
+**    the byte order given in the file's header.  When an uncompressed
+**    file in native byte order is read from disk and the tree is
+**    suitably aligned, skPrefixMapRead() mmap()s the file and uses
+**    the tree in place, so processes that load the same map share a
+**    single copy of it.  The tree is copied into memory the first
+**    time the map is modified.  skPrefixMapWrite() pads the header so
+**    that the tree is aligned.
+**
+**    Since walking the tree requires a memory access for each bit of
+**    the key, the tree may be compiled into a read-only poptrie
+**    (Asai and Ohara, "Poptrie: A Compressed Trie with
+**    Population Count for Fast and Scalable Software IP Routing Table
+**    Lookup", SIGCOMM 2015): a table indexed by the first 16 bits of
+**    the key followed by nodes that each examine 6 bits and locate
+**    their children and leaves by counting bits.
+**    skPrefixMapFindValue() and skPrefixMapFindString() use the
+**    poptrie when it exists; functions that need the prefix length of
+**    the matching entry walk the tree.  Building the poptrie costs
+**    about as much as walking the tree once for each of its nodes, so
+**    those two functions build it only after they have walked the
+**    tree that many times.  A tool that looks up a few keys never
+**    pays for it.  The poptrie is discarded when the map is modified.
+**
 */
 
 #include <silk/silk.h>
@@ -134,9 +158,48 @@ typedef struct skPrefixMapRecord_st {
     uint32_t right;
 } skPrefixMapRecord_t;
 
+/*
+ *    A node in the poptrie, a read-only copy of the tree that is
+ *    compiled for fast lookups.  Each node examines
+ *    the next SKPMAP_POPTRIE_STRIDE bits of the key.  A high bit in
+ *    'vector' means that index leads to another node; those nodes are
+ *    stored consecutively beginning at 'base1'.  A high bit in
+ *    'leafvec' marks an index whose leaf value differs from that of
+ *    the preceding leaf index; the values are stored consecutively in
+ *    the leaves array beginning at 'base0'.  In both cases the
+ *    position is found by counting the bits that are set at or below
+ *    the index.
+ */
+typedef struct skPrefixMapPoptrieNode_st {
+    uint64_t    vector;
+    uint64_t    leafvec;
+    uint32_t    base0;
+    uint32_t    base1;
+} skPrefixMapPoptrieNode_t;
+
+typedef struct skPrefixMapPoptrie_st {
+    /* the first SKPMAP_POPTRIE_DIRECT bits of the key index this
+     * table; each entry is a leaf or the index of a node */
+    uint32_t                   *direct;
+    /* the nodes */
+    skPrefixMapPoptrieNode_t   *nodes;
+    /* the leaf values */
+    uint32_t                   *leaves;
+    /* number of nodes in use and allocated */
+    uint32_t                    nodes_used;
+    uint32_t                    nodes_size;
+    /* number of leaf values in use and allocated */
+    uint32_t                    leaves_used;
+    uint32_t                    leaves_size;
+} skPrefixMapPoptrie_t;
+
 struct skPrefixMap_st {
-    /* the nodes that make up the tree */
+    /* the nodes that make up the tree; may point into 'mapped_file' */
     skPrefixMapRecord_t    *tree;
+    /* pointer to mmap()ed file, or NULL if 'tree' was allocated */
+    void                   *mapped_file;
+    /* the size of the mmap()ed space */
+    size_t                  mapped_size;
     /* the name of the map */
     char                   *mapname;
     /* all terms in dictionary joined by '\0', or NULL for vers 1,5 */
@@ -163,6 +226,19 @@ struct skPrefixMap_st {
     struct rbtree          *word_map;
     /* Memory pool for word map entries */
     sk_mempool_t           *word_map_pool;
+    /* compiled copy of the tree used by skPrefixMapFindValue() and
+     * skPrefixMapFindString(), or NULL */
+    skPrefixMapPoptrie_t   *poptrie;
+    /* protects 'poptrie_lookups' and the setting of 'poptrie', since
+     * lookups may be made by several threads.  Lookups read
+     * 'poptrie' without the lock; the poptrie is complete before the
+     * pointer is published */
+    pthread_mutex_t         poptrie_mutex;
+    /* number of lookups that have walked the tree since the tree was
+     * last modified */
+    uint32_t                poptrie_lookups;
+    /* whether the tree is never compiled into a poptrie */
+    unsigned                poptrie_disabled :1;
     /* type of data in the map */
     skPrefixMapContent_t    content_type;
 };
@@ -192,6 +268,62 @@ typedef struct skPrefixMapDictNode_st {
 #define SKPMAP_WORDS_COUNT_INIT    8192
 #define SKPMAP_WORDS_COUNT_GROW    2048
 
+/* The header of a prefix map file is padded to a multiple of this
+ * many bytes so that the tree, which follows the header and the
+ * record count, may be used in place when the file is mmap()ed */
+#define SKPMAP_DATA_ALIGN          8
+
+/* Ensure that the tree of a prefix map is in-core; if required, copy
+ * the mmap()ed tree into allocated memory */
+#define SKPMAP_COPY_ON_WRITE(cow_map)                   \
+    if (NULL == (cow_map)->mapped_file) { /* no-op */ } \
+    else if (prefixMapCopyOnWrite(cow_map)) {           \
+        return SKPREFIXMAP_ERR_MEMORY;                  \
+    }
+
+
+/* The number of bits that index the direct table of the poptrie and
+ * the number of bits examined by each of its nodes.  The node stride
+ * must be 6 so a node's children fit in a 64-bit vector, and since
+ * (64 - 16) is a multiple of 6, no node straddles the two 64-bit
+ * halves of an IPv6 key. */
+#define SKPMAP_POPTRIE_DIRECT      16
+#define SKPMAP_POPTRIE_STRIDE      6
+
+/* Name of an environment variable that determines how a prefix map
+ * is represented for lookups.  When its value is "tree", the tree is
+ * never compiled into a poptrie; when it is "poptrie", the tree is
+ * compiled when the map is read.  Not intended for end users. */
+#define SKPMAP_ENVAR_INCORE_FORMAT "SKPREFIXMAP_INCORE_FORMAT"
+
+/* The minimum number of lookups that walk the tree before the tree
+ * is compiled into a poptrie.  For larger trees the number is the
+ * number of nodes in the tree. */
+#define SKPMAP_POPTRIE_LAZY_MIN    (1 << 16)
+
+/* The initial number of nodes and leaves to allocate for the
+ * poptrie */
+#define SKPMAP_POPTRIE_SIZE_INIT   (1 << 10)
+
+/* Return the poptrie node index given by the SKPMAP_POPTRIE_STRIDE
+ * bits beginning at bit 'pi_pos' of the 128-bit key whose most
+ * significant half is 'pi_hi' and least significant half is 'pi_lo',
+ * where bit 0 is the most significant bit.  Bits beyond the end of
+ * the key are zero. */
+#define SKPMAP_POPTRIE_INDEX(pi_hi, pi_lo, pi_pos)              \
+    ((unsigned int)                                             \
+     (((pi_pos) < 64)                                           \
+      ? (((pi_hi) >> (58 - (pi_pos))) & 0x3F)                   \
+      : (((pi_pos) <= 122)                                      \
+         ? (((pi_lo) >> (122 - (pi_pos))) & 0x3F)               \
+         : (((pi_lo) << ((pi_pos) - 122)) & 0x3F))))
+
+/* Return the number of high bits in 'pc_word', a uint64_t */
+#if defined(__GNUC__)
+#define SKPMAP_POPCOUNT64(pc_word)  ((uint32_t)__builtin_popcountll(pc_word))
+#else
+#define SKPMAP_POPCOUNT64(pc_word)  prefixMapPopcount64(pc_word)
+#endif
 
 #define SKPMAP_KEY_FROM_PROTO_PORT(kfpp)                \
     ((((skPrefixMapProtoPort_t*)(kfpp))->proto << 16)   \
@@ -242,6 +374,9 @@ static const uint8_t max_ip128[16] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
 
 /* LOCAL FUNCTION PROTOTYPES */
 
+static int
+prefixMapCopyOnWrite(
+    skPrefixMap_t      *map);
 static skPrefixMapErr_t
 prefixMapGrowDictionaryBuff(
     skPrefixMap_t      *map,
@@ -254,6 +389,28 @@ static skPrefixMapErr_t
 prefixMapGrowTree(
     skPrefixMap_t      *map);
 static int
+prefixMapPoptrieDescend(
+    const skPrefixMap_t    *map,
+    uint32_t               *entries,
+    uint32_t                node,
+    uint32_t                depth,
+    uint32_t                bits,
+    uint32_t                max_depth);
+static void
+prefixMapPoptrieDestroy(
+    skPrefixMap_t      *map);
+static int
+prefixMapPoptrieFillNode(
+    const skPrefixMap_t    *map,
+    skPrefixMapPoptrie_t   *pt,
+    uint32_t                idx,
+    uint32_t                node,
+    uint32_t                depth,
+    uint32_t                max_depth);
+static void
+prefixMapPoptrieFree(
+    skPrefixMapPoptrie_t   *pt);
+static int
 prefixMapWordCompare(
     const void         *va,
     const void         *vb,
@@ -509,6 +666,40 @@ prefixMapAdd128(
 #endif  /* SK_ENABLE_IPV6 */
 
 
+/*
+ *  status = prefixMapCopyOnWrite(map);
+ *
+ *    Use the SKPMAP_COPY_ON_WRITE() macro to invoke this function,
+ *    which only calls this function when necessary.
+ *
+ *    Copy the mmap()ed tree of 'map' into allocated memory and unmap
+ *    the file.  Return 0 on success, or -1 if memory cannot be
+ *    allocated.
+ */
+static int
+prefixMapCopyOnWrite(
+    skPrefixMap_t      *map)
+{
+    skPrefixMapRecord_t *tree;
+
+    assert(map->mapped_file && map->mapped_size);
+
+    tree = ((skPrefixMapRecord_t*)
+            malloc(map->tree_size * sizeof(skPrefixMapRecord_t)));
+    if (NULL == tree) {
+        return -1;
+    }
+    memcpy(tree, map->tree, map->tree_size * sizeof(skPrefixMapRecord_t));
+
+    munmap(map->mapped_file, map->mapped_size);
+    map->mapped_file = NULL;
+    map->mapped_size = 0;
+    map->tree = tree;
+
+    return 0;
+}
+
+
 /*
  *  err = prefixMapDictionaryInsertHelper(map, pdict_val, word);
  *
@@ -852,6 +1043,505 @@ prefixMapGrowTree(
 }
 
 
+#if !defined(__GNUC__)
+/*
+ *  count = prefixMapPopcount64(word);
+ *
+ *    Return the number of bits that are high in 'word'.
+ */
+static uint32_t
+prefixMapPopcount64(
+    uint64_t            word)
+{
+    uint32_t count;
+
+    BITS_IN_WORD64(&count, word);
+    return count;
+}
+#endif  /* !defined(__GNUC__) */
+
+
+/*
+ *  status = prefixMapPoptrieAddNodes(map, pt, count, &idx);
+ *
+ *    Helper function for prefixMapPoptrieCreate() and
+ *    prefixMapPoptrieFillNode().
+ *
+ *    Reserve 'count' consecutive nodes in the poptrie 'pt' being
+ *    compiled from the tree of 'map' and set the value 'idx' points
+ *    to to the index of the first.  Return 0 on success, or -1 if
+ *    memory cannot be allocated or if the poptrie has more nodes than
+ *    the tree, which only occurs when the tree is malformed.
+ */
+static int
+prefixMapPoptrieAddNodes(
+    const skPrefixMap_t    *map,
+    skPrefixMapPoptrie_t   *pt,
+    uint32_t                count,
+    uint32_t               *idx)
+{
+    skPrefixMapPoptrieNode_t *old_ptr;
+    uint32_t grow;
+
+    if (count > map->tree_used - pt->nodes_used) {
+        return -1;
+    }
+    if (count > pt->nodes_size - pt->nodes_used) {
+        grow = pt->nodes_size;
+        do {
+            grow *= 2;
+        } while (count > grow - pt->nodes_used);
+
+        old_ptr = pt->nodes;
+        pt->nodes = ((skPrefixMapPoptrieNode_t*)
+                     realloc(pt->nodes,
+                             grow * sizeof(skPrefixMapPoptrieNode_t)));
+        if (NULL == pt->nodes) {
+            pt->nodes = old_ptr;
+            return -1;
+        }
+        pt->nodes_size = grow;
+    }
+    *idx = pt->nodes_used;
+    pt->nodes_used += count;
+    return 0;
+}
+
+
+/*
+ *  poptrie = prefixMapPoptrieCreate(map);
+ *
+ *    Compile the tree of 'map' into a poptrie for use by
+ *    prefixMapPoptrieFind() and return it.  Return NULL if memory
+ *    cannot be allocated or the tree is malformed.  Since this only
+ *    reads the tree, other threads may look up keys in 'map' while
+ *    it runs.
+ */
+static skPrefixMapPoptrie_t *
+prefixMapPoptrieCreate(
+    const skPrefixMap_t    *map)
+{
+    skPrefixMapPoptrie_t *pt;
+    uint32_t max_depth;
+    uint32_t node;
+    uint32_t idx;
+    uint32_t i;
+
+    max_depth = ((SKPREFIXMAP_CONT_ADDR_V6 == map->content_type) ? 128 : 32);
+
+    pt = (skPrefixMapPoptrie_t*)calloc(1, sizeof(skPrefixMapPoptrie_t));
+    if (NULL == pt) {
+        return NULL;
+    }
+
+    pt->direct = ((uint32_t*)
+                  malloc((1 << SKPMAP_POPTRIE_DIRECT) * sizeof(uint32_t)));
+    pt->nodes_size = SKPMAP_POPTRIE_SIZE_INIT;
+    pt->nodes = ((skPrefixMapPoptrieNode_t*)
+                 malloc(pt->nodes_size * sizeof(skPrefixMapPoptrieNode_t)));
+    pt->leaves_size = SKPMAP_POPTRIE_SIZE_INIT;
+    pt->leaves = (uint32_t*)malloc(pt->leaves_size * sizeof(uint32_t));
+    if (NULL == pt->direct || NULL == pt->nodes || NULL == pt->leaves) {
+        goto ERROR;
+    }
+
+    /* fill the direct table from the top of the tree, then replace
+     * each entry that refers to a node of the tree with a node of the
+     * poptrie */
+    if (prefixMapPoptrieDescend(map, pt->direct, 0, 0,
+                                SKPMAP_POPTRIE_DIRECT, max_depth))
+    {
+        goto ERROR;
+    }
+    for (i = 0; i < (1 << SKPMAP_POPTRIE_DIRECT); ++i) {
+        node = pt->direct[i];
+        if (SKPMAP_IS_NODE(node)) {
+            if (prefixMapPoptrieAddNodes(map, pt, 1, &idx)
+                || prefixMapPoptrieFillNode(map, pt, idx, node,
+                                            SKPMAP_POPTRIE_DIRECT, max_depth))
+            {
+                goto ERROR;
+            }
+            pt->direct[i] = idx;
+        }
+    }
+
+    /* release the unused space */
+    if (pt->nodes_used < pt->nodes_size && pt->nodes_used > 0) {
+        skPrefixMapPoptrieNode_t *nodes;
+        nodes = ((skPrefixMapPoptrieNode_t*)
+                 realloc(pt->nodes,
+                         pt->nodes_used * sizeof(skPrefixMapPoptrieNode_t)));
+        if (nodes) {
+            pt->nodes = nodes;
+            pt->nodes_size = pt->nodes_used;
+        }
+    }
+    if (pt->leaves_used < pt->leaves_size && pt->leaves_used > 0) {
+        uint32_t *leaves;
+        leaves = ((uint32_t*)
+                  realloc(pt->leaves, pt->leaves_used * sizeof(uint32_t)));
+        if (leaves) {
+            pt->leaves = leaves;
+            pt->leaves_size = pt->leaves_used;
+        }
+    }
+
+    return pt;
+
+  ERROR:
+    prefixMapPoptrieFree(pt);
+    return NULL;
+}
+
+
+/*
+ *  status = prefixMapPoptrieDescend(map, entries, node, depth, bits, max_depth);
+ *
+ *    Helper function for prefixMapPoptrieCreate() and
+ *    prefixMapPoptrieFillNode().
+ *
+ *    Walk every path of length 'bits' from 'node', which is a leaf
+ *    or the index of a node at 'depth' in the tree of 'map', and
+ *    store the result of each walk in the (1 << 'bits') elements of
+ *    'entries', where the first element is the result of walking
+ *    left at every step.  A result is either a leaf or the index of
+ *    the node where the walk stopped.  Return -1 if a walk reaches a
+ *    node at 'max_depth', which means the tree is malformed.
+ */
+static int
+prefixMapPoptrieDescend(
+    const skPrefixMap_t    *map,
+    uint32_t               *entries,
+    uint32_t                node,
+    uint32_t                depth,
+    uint32_t                bits,
+    uint32_t                max_depth)
+{
+    uint32_t i;
+
+    if (SKPMAP_IS_LEAF(node)) {
+        for (i = 0; i < (UINT32_C(1) << bits); ++i) {
+            entries[i] = node;
+        }
+        return 0;
+    }
+    if (0 == bits) {
+        entries[0] = node;
+        return 0;
+    }
+    if (depth >= max_depth) {
+        return -1;
+    }
+    if (prefixMapPoptrieDescend(map, entries, map->tree[node].left,
+                                depth + 1, bits - 1, max_depth))
+    {
+        return -1;
+    }
+    return prefixMapPoptrieDescend(map, entries + (UINT32_C(1) << (bits - 1)),
+                                   map->tree[node].right,
+                                   depth + 1, bits - 1, max_depth);
+}
+
+
+/*
+ *  prefixMapPoptrieDestroy(map);
+ *
+ *    Free the poptrie of 'map', if any, and restart the count of
+ *    lookups that leads to building a new one.  Since the poptrie is
+ *    a read-only copy of the tree, this must be called whenever the
+ *    tree is modified.
+ */
+static void
+prefixMapPoptrieDestroy(
+    skPrefixMap_t      *map)
+{
+    prefixMapPoptrieFree(map->poptrie);
+    map->poptrie = NULL;
+    map->poptrie_lookups = 0;
+}
+
+
+/*
+ *  prefixMapPoptrieFree(pt);
+ *
+ *    Free the poptrie 'pt'.  Do nothing if 'pt' is NULL.
+ */
+static void
+prefixMapPoptrieFree(
+    skPrefixMapPoptrie_t   *pt)
+{
+    if (pt) {
+        free(pt->direct);
+        free(pt->nodes);
+        free(pt->leaves);
+        free(pt);
+    }
+}
+
+
+/*
+ *  prefixMapPoptrieInit(map);
+ *
+ *    Initialize the members of the newly allocated 'map' that control
+ *    when its tree is compiled into a poptrie.
+ */
+static void
+prefixMapPoptrieInit(
+    skPrefixMap_t      *map)
+{
+    const char *envar;
+
+    pthread_mutex_init(&map->poptrie_mutex, NULL);
+    envar = getenv(SKPMAP_ENVAR_INCORE_FORMAT);
+    if (envar && 0 == strcasecmp("tree", envar)) {
+        map->poptrie_disabled = 1;
+    }
+}
+
+
+/*
+ *  prefixMapPoptrieLookup(map);
+ *
+ *    Note that a lookup in 'map' walked the tree.  When the number of
+ *    such lookups reaches the number of nodes in the tree (and at
+ *    least SKPMAP_POPTRIE_LAZY_MIN), the time spent walking the tree
+ *    equals the time needed to compile it, so compile the tree into
+ *    a poptrie for the lookups that follow.
+ *
+ *    The poptrie is a cache that does not change the contents of
+ *    'map', which is why 'map' is const.  Lookups in other threads
+ *    continue to walk the tree while this thread compiles it.
+ */
+static void
+prefixMapPoptrieLookup(
+    const skPrefixMap_t    *const_map)
+{
+    skPrefixMap_t *map = (skPrefixMap_t*)const_map;
+    skPrefixMapPoptrie_t *pt;
+    uint32_t threshold;
+    int build = 0;
+
+    threshold = ((map->tree_used > SKPMAP_POPTRIE_LAZY_MIN)
+                 ? map->tree_used : SKPMAP_POPTRIE_LAZY_MIN);
+
+    pthread_mutex_lock(&map->poptrie_mutex);
+    if (map->poptrie_lookups < threshold) {
+        ++map->poptrie_lookups;
+        build = (map->poptrie_lookups == threshold);
+    }
+    pthread_mutex_unlock(&map->poptrie_mutex);
+
+    if (build) {
+        /* if this fails, the count remains at the threshold and the
+         * lookups continue to walk the tree */
+        pt = prefixMapPoptrieCreate(map);
+        pthread_mutex_lock(&map->poptrie_mutex);
+        map->poptrie = pt;
+        pthread_mutex_unlock(&map->poptrie_mutex);
+    }
+}
+
+
+/*
+ *  status = prefixMapPoptrieFillNode(map, pt, idx, node, depth, max_depth);
+ *
+ *    Helper function for prefixMapPoptrieCreate().  This function is
+ *    recursive.
+ *
+ *    Fill the node at 'idx' in the poptrie 'pt' with the tree of
+ *    'map' below 'node', the index of a node at 'depth' in the tree,
+ *    and add the nodes and leaves beneath it.  Return 0 on success or -1
+ *    on failure.
+ */
+static int
+prefixMapPoptrieFillNode(
+    const skPrefixMap_t    *map,
+    skPrefixMapPoptrie_t   *pt,
+    uint32_t                idx,
+    uint32_t                node,
+    uint32_t                depth,
+    uint32_t                max_depth)
+{
+    uint32_t entries[1 << SKPMAP_POPTRIE_STRIDE];
+    uint32_t *old_ptr;
+    uint64_t vector = 0;
+    uint64_t leafvec = 0;
+    uint32_t prev = 0;
+    uint32_t base0;
+    uint32_t base1;
+    uint32_t i;
+
+    if (prefixMapPoptrieDescend(map, entries, node, depth,
+                                SKPMAP_POPTRIE_STRIDE, max_depth))
+    {
+        return -1;
+    }
+
+    /* note the entries that are nodes; store the leaf values,
+     * skipping a value that matches the previous leaf */
+    base0 = pt->leaves_used;
+    for (i = 0; i < (1 << SKPMAP_POPTRIE_STRIDE); ++i) {
+        if (SKPMAP_IS_NODE(entries[i])) {
+            vector |= UINT64_C(1) << i;
+        } else if (0 == leafvec || entries[i] != prev) {
+            if (pt->leaves_used == pt->leaves_size) {
+                old_ptr = pt->leaves;
+                pt->leaves = ((uint32_t*)
+                              realloc(pt->leaves, (2 * pt->leaves_size
+                                                   * sizeof(uint32_t))));
+                if (NULL == pt->leaves) {
+                    pt->leaves = old_ptr;
+                    return -1;
+                }
+                pt->leaves_size *= 2;
+            }
+            pt->leaves[pt->leaves_used++] = SKPMAP_LEAF_VALUE(entries[i]);
+            leafvec |= UINT64_C(1) << i;
+            prev = entries[i];
+        }
+    }
+
+    base1 = 0;
+    if (vector
+        && prefixMapPoptrieAddNodes(map, pt, SKPMAP_POPCOUNT64(vector),
+                                    &base1))
+    {
+        return -1;
+    }
+
+    pt->nodes[idx].vector = vector;
+    pt->nodes[idx].leafvec = leafvec;
+    pt->nodes[idx].base0 = base0;
+    pt->nodes[idx].base1 = base1;
+
+    for (i = 0; i < (1 << SKPMAP_POPTRIE_STRIDE); ++i) {
+        if (SKPMAP_IS_NODE(entries[i])) {
+            if (prefixMapPoptrieFillNode(map, pt, base1, entries[i],
+                                         depth + SKPMAP_POPTRIE_STRIDE,
+                                         max_depth))
+            {
+                return -1;
+            }
+            ++base1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  dict_val = prefixMapPoptrieFind(map, pt, key);
+ *
+ *    Return the dict_val for the given key, or SKPREFIXMAP_NOT_FOUND,
+ *    using the poptrie 'pt' of 'map'.  Unlike prefixMapFind(), this
+ *    does not determine the depth of the leaf.
+ */
+static uint32_t
+prefixMapPoptrieFind(
+    const skPrefixMap_t            *map,
+    const skPrefixMapPoptrie_t     *pt,
+    const void                     *key)
+{
+    const skPrefixMapPoptrieNode_t *pn;
+    uint64_t hi;
+    uint64_t lo = 0;
+    uint64_t bit;
+    uint32_t key32;
+    uint32_t entry;
+    unsigned int pos;
+
+    switch (map->content_type) {
+#if SK_ENABLE_IPV6
+      case SKPREFIXMAP_CONT_ADDR_V6:
+        {
+            uint8_t key128[16];
+
+            if (skipaddrIsV6((const skipaddr_t*)key)) {
+                skipaddrGetV6((const skipaddr_t*)key, key128);
+            } else {
+                skipaddrGetAsV6((const skipaddr_t*)key, key128);
+            }
+            memcpy(&hi, key128, sizeof(hi));
+            memcpy(&lo, key128 + sizeof(hi), sizeof(lo));
+            hi = ntoh64(hi);
+            lo = ntoh64(lo);
+        }
+        break;
+#endif  /* SK_ENABLE_IPV6 */
+
+      case SKPREFIXMAP_CONT_PROTO_PORT:
+        key32 = SKPMAP_KEY_FROM_PROTO_PORT(key);
+        hi = (uint64_t)key32 << 32;
+        break;
+
+      case SKPREFIXMAP_CONT_ADDR_V4:
+#if !SK_ENABLE_IPV6
+        key32 = skipaddrGetV4((const skipaddr_t*)key);
+#else
+        if (skipaddrGetAsV4((const skipaddr_t*)key, &key32)) {
+            return SKPREFIXMAP_NOT_FOUND;
+        }
+#endif
+        hi = (uint64_t)key32 << 32;
+        break;
+
+      default:
+        skAbortBadCase(map->content_type);
+    }
+
+    entry = pt->direct[hi >> (64 - SKPMAP_POPTRIE_DIRECT)];
+    if (SKPMAP_IS_LEAF(entry)) {
+        return SKPMAP_LEAF_VALUE(entry);
+    }
+    pn = &pt->nodes[entry];
+    pos = SKPMAP_POPTRIE_DIRECT;
+    for (;;) {
+        /* 'bit' is the index into the node; ((bit << 1) - 1) masks
+         * the bits at or below the index */
+        bit = UINT64_C(1) << SKPMAP_POPTRIE_INDEX(hi, lo, pos);
+        if (0 == (pn->vector & bit)) {
+            return pt->leaves[pn->base0 - 1
+                              + SKPMAP_POPCOUNT64(pn->leafvec
+                                                  & ((bit << 1) - 1))];
+        }
+        pn = &pt->nodes[pn->base1 - 1
+                        + SKPMAP_POPCOUNT64(pn->vector & ((bit << 1) - 1))];
+        pos += SKPMAP_POPTRIE_STRIDE;
+    }
+}
+
+
+/*
+ *  status = prefixMapReadData(map, in, &offset, buf, len);
+ *
+ *    Helper function for skPrefixMapRead().
+ *
+ *    Fill 'buf' with the next 'len' bytes of the prefix map file.
+ *    When the file is mmap()ed, copy the bytes that begin at 'offset'
+ *    in the mapping; otherwise read them from 'in'.  Advance 'offset'
+ *    by 'len'.  Return 0 on success or -1 on a short read.
+ */
+static int
+prefixMapReadData(
+    const skPrefixMap_t    *map,
+    skstream_t             *in,
+    size_t                 *offset,
+    void                   *buf,
+    size_t                  len)
+{
+    if (NULL == map->mapped_file) {
+        return ((skStreamRead(in, buf, len) == (ssize_t)len) ? 0 : -1);
+    }
+    if (len > map->mapped_size - *offset) {
+        return -1;
+    }
+    memcpy(buf, (uint8_t*)map->mapped_file + *offset, len);
+    *offset += len;
+    return 0;
+}
+
+
 /* Compare two skPrefixMapDictNode_t's.  Used by the rbtree. */
 static int
 prefixMapWordCompare(
@@ -880,6 +1570,9 @@ skPrefixMapAddRange(
         return SKPREFIXMAP_ERR_ARGS;
     }
 
+    SKPMAP_COPY_ON_WRITE(map);
+    prefixMapPoptrieDestroy(map);
+
     switch (map->content_type) {
 #if SK_ENABLE_IPV6
       case SKPREFIXMAP_CONT_ADDR_V6:
@@ -963,6 +1656,7 @@ skPrefixMapCreate(
     (*map)->tree[0].left = SKPMAP_MAKE_LEAF(SKPREFIXMAP_MAX_VALUE);
     (*map)->tree[0].right = SKPMAP_MAKE_LEAF(SKPREFIXMAP_MAX_VALUE);
     (*map)->tree_used = 1;
+    prefixMapPoptrieInit(*map);
 
     return SKPREFIXMAP_OK;
 }
@@ -976,6 +1670,7 @@ skPrefixMapDelete(
     if (NULL == map) {
         return;
     }
+    pthread_mutex_destroy(&map->poptrie_mutex);
     if ( map->tree != NULL ) {
         if (map->mapname) {
             free(map->mapname);
@@ -986,12 +1681,15 @@ skPrefixMapDelete(
         if (map->dict_words) {
             free(map->dict_words);
         }
-        if (map->tree) {
+        if (map->mapped_file) {
+            munmap(map->mapped_file, map->mapped_size);
+        } else if (map->tree) {
             free(map->tree);
         }
         if (map->word_map) {
             rbdestroy(map->word_map);
         }
+        prefixMapPoptrieDestroy(map);
         skMemoryPoolDestroy(&map->word_map_pool);
         memset(map, 0, sizeof(skPrefixMap_t));
     }
@@ -1177,8 +1875,7 @@ skPrefixMapFindString(
     char                   *out_buf,
     size_t                  bufsize)
 {
-    int depth;
-    return skPrefixMapDictionaryGetEntry(map, prefixMapFind(map, key, &depth),
+    return skPrefixMapDictionaryGetEntry(map, skPrefixMapFindValue(map, key),
                                          out_buf, bufsize);
 }
 
@@ -1189,7 +1886,15 @@ skPrefixMapFindValue(
     const skPrefixMap_t    *map,
     const void             *key)
 {
+    const skPrefixMapPoptrie_t *pt = map->poptrie;
     int depth;
+
+    if (pt) {
+        return prefixMapPoptrieFind(map, pt, key);
+    }
+    if (!map->poptrie_disabled) {
+        prefixMapPoptrieLookup(map);
+    }
     return prefixMapFind(map, key, &depth);
 }
 
@@ -1513,9 +2218,12 @@ skPrefixMapRead(
     uint32_t max_key_used;
     uint32_t swapFlag;
     uint32_t i;
+    off_t data_start = -1;
+    size_t offset = 0;
     char *current;
     char *start;
     char *end;
+    const char *envar;
     skPrefixMapErr_t err;
     int rv;
 
@@ -1549,6 +2257,12 @@ skPrefixMapRead(
 
     swapFlag = !skHeaderIsNativeByteOrder(hdr);
 
+    /* when the tree may be used in place, note where the data begins;
+     * the position in a gzipped file is not a position in the data */
+    if (skStreamIsSeekable(in) && !skStreamIsGzipped(in) && !swapFlag) {
+        data_start = skStreamTell(in);
+    }
+
     /* Read record count */
     if (skStreamRead(in, &(record_count), sizeof(record_count))
         != sizeof(record_count))
@@ -1572,6 +2286,7 @@ skPrefixMapRead(
         skAppPrintErr("Failed to allocate memory for prefix map.");
         return SKPREFIXMAP_ERR_MEMORY;
     }
+    prefixMapPoptrieInit(*map);
 
     /* most files have a dictionary */
     has_dictionary = 1;
@@ -1610,12 +2325,41 @@ skPrefixMapRead(
         skAbortBadCase(vers);
     }
 
-    (*map)->tree = ((skPrefixMapRecord_t*)
-                    malloc(record_count * sizeof(skPrefixMapRecord_t)));
-    if (NULL == (*map)->tree) {
-        skAppPrintErr("Failed to allocate memory for prefix map data.");
-        err = SKPREFIXMAP_ERR_MEMORY;
-        goto ERROR;
+    /* mmap() the file if the tree is aligned and the file is large
+     * enough to hold it */
+    if ((data_start > 0) && (0 == data_start % SKPMAP_DATA_ALIGN)) {
+        off_t file_size = skFileSize(skStreamGetPathname(in));
+
+        offset = (size_t)data_start + sizeof(uint32_t);
+        if ((file_size > 0)
+            && ((uint64_t)file_size >= offset)
+            && (((uint64_t)file_size - offset)
+                >= ((uint64_t)record_count * sizeof(skPrefixMapRecord_t)))
+            && ((uint64_t)file_size == (size_t)file_size))
+        {
+            (*map)->mapped_size = (size_t)file_size;
+            (*map)->mapped_file = mmap(0, (*map)->mapped_size, PROT_READ,
+                                       MAP_SHARED, skStreamGetDescriptor(in),
+                                       0);
+            if (MAP_FAILED == (*map)->mapped_file) {
+                (*map)->mapped_file = NULL;
+                (*map)->mapped_size = 0;
+            } else {
+                (*map)->tree = ((skPrefixMapRecord_t*)
+                                ((uint8_t*)(*map)->mapped_file + offset));
+                offset += record_count * sizeof(skPrefixMapRecord_t);
+            }
+        }
+    }
+
+    if (NULL == (*map)->mapped_file) {
+        (*map)->tree = ((skPrefixMapRecord_t*)
+                        malloc(record_count * sizeof(skPrefixMapRecord_t)));
+        if (NULL == (*map)->tree) {
+            skAppPrintErr("Failed to allocate memory for prefix map data.");
+            err = SKPREFIXMAP_ERR_MEMORY;
+            goto ERROR;
+        }
     }
     (*map)->tree_size = record_count;
     (*map)->tree_used = record_count;
@@ -1633,9 +2377,11 @@ skPrefixMapRead(
     }
 
     /* Allocation completed successfully, read in the records. */
-    if (skStreamRead(in, (*map)->tree,
-                     (record_count * sizeof(skPrefixMapRecord_t)))
-        != (ssize_t)(record_count * sizeof(skPrefixMapRecord_t)))
+    if ((*map)->mapped_file) {
+        /* the records are used in place */
+    } else if (skStreamRead(in, (*map)->tree,
+                            (record_count * sizeof(skPrefixMapRecord_t)))
+               != (ssize_t)(record_count * sizeof(skPrefixMapRecord_t)))
     {
         skAppPrintErr("Failed to read all records from input file.");
         err = SKPREFIXMAP_ERR_IO;
@@ -1653,8 +2399,8 @@ skPrefixMapRead(
     /* Allocate and read the dictionary. */
     if ( has_dictionary ) {
         /* Get number of entries */
-        if (skStreamRead(in, &((*map)->dict_buf_size), sizeof(uint32_t))
-            != (ssize_t)sizeof(uint32_t))
+        if (prefixMapReadData(*map, in, &offset, &((*map)->dict_buf_size),
+                              sizeof(uint32_t)))
         {
             skAppPrintErr("Error reading dictionary from input file.");
             err = SKPREFIXMAP_ERR_IO;
@@ -1672,8 +2418,8 @@ skPrefixMapRead(
         }
 
         /* Dictionary is allocated; now read in data. */
-        if (skStreamRead(in, (*map)->dict_buf, (*map)->dict_buf_size)
-            != (ssize_t)(*map)->dict_buf_size)
+        if (prefixMapReadData(*map, in, &offset, (*map)->dict_buf,
+                              (*map)->dict_buf_size))
         {
             skAppPrintErr("Failed to read dictionary from input file.");
             err = SKPREFIXMAP_ERR_IO;
@@ -1811,8 +2557,7 @@ skPrefixMapRead(
     if (i < record_count) {
         if (max_key_used >= i) {
             skAppPrintErr("Prefix map is malformed (contains invalid child).");
-            free((*map)->tree);
-            free(*map);
+            skPrefixMapDelete(*map);
             *map = NULL;
             return SKPREFIXMAP_ERR_IO;
         }
@@ -1823,6 +2568,11 @@ skPrefixMapRead(
      * steps.  What's a good way to do that?
      */
 
+    envar = getenv(SKPMAP_ENVAR_INCORE_FORMAT);
+    if (envar && 0 == strcasecmp("poptrie", envar)) {
+        (*map)->poptrie = prefixMapPoptrieCreate(*map);
+    }
+
     return SKPREFIXMAP_OK;
 
   ERROR:
@@ -1906,6 +2656,8 @@ skPrefixMapSetDefaultVal(
         return SKPREFIXMAP_ERR_NOTEMPTY;
     }
 
+    SKPMAP_COPY_ON_WRITE(map);
+    prefixMapPoptrieDestroy(map);
     map->tree[0].left = SKPMAP_MAKE_LEAF(dict_val);
     map->tree[0].right = SKPMAP_MAKE_LEAF(dict_val);
     return SKPREFIXMAP_OK;
@@ -2003,6 +2755,7 @@ skPrefixMapWrite(
     skHeaderSetRecordVersion(hdr, vers);
     skHeaderSetCompressionMethod(hdr, SK_COMPMETHOD_NONE);
     skHeaderSetRecordLength(hdr, 1);
+    skHeaderSetPaddingModulus(hdr, SKPMAP_DATA_ALIGN);
 
     /* add the prefixmap header if a mapname was given */
     if (map->mapname) {
@@ -2331,6 +2331,12 @@ sksiteCompmethodCheck(
 #endif
 #if SK_ENABLE_LZO
       case SK_COMPMETHOD_LZO1X:
+#endif
+#if SK_ENABLE_LZ4
+      case SK_COMPMETHOD_LZ4:
+#endif
+#if SK_ENABLE_ZSTD
+      case SK_COMPMETHOD_ZSTD:
 #endif
         return SK_COMPMETHOD_IS_AVAIL;
     }
@@ -2356,6 +2362,21 @@ sksiteCompmethodGetBest(
 }
 
 
+sk_compmethod_t
+sksiteCompmethodGetFast(
+    void)
+{
+    /* zlib and zstd are not considered: they use too much CPU */
+#if   SK_ENABLE_LZ4
+    return SK_COMPMETHOD_LZ4;
+#elif SK_ENABLE_LZO
+    return SK_COMPMETHOD_LZO1X;
+#else
+    return SK_COMPMETHOD_NONE;
+#endif
+}
+
+
 sk_compmethod_t
 sksiteCompmethodGetDefault(
     void)
@@ -3591,15 +3612,36 @@ sksiteValidateSensors(
 
 /** DATA_ROOTDIR File Iteration (fglob) *******************************/
 
+/*
+ *    An entry in the prefetch queue of the repository iterator: a
+ *    file that the iterator has found but not yet returned.
+ */
+typedef struct repo_prefetch_st {
+    sksite_fileattr_t   attr;
+    int                 is_missing;
+    char                path[PATH_MAX];
+} repo_prefetch_t;
+
 /* typedef struct sksite_repo_iter_st sksite_repo_iter_t; */
 struct sksite_repo_iter_st {
-    sk_vector_t    *sen_ft_vec;
-    size_t          sensor_idx;
-    sktime_t        time_start;
-    sktime_t        time_end;
-    sktime_t        time_idx;
-    uint32_t        flags;
-    uint8_t         first_call;
+    sk_vector_t        *sen_ft_vec;
+    size_t              sensor_idx;
+    sktime_t            time_start;
+    sktime_t            time_end;
+    sktime_t            time_idx;
+    /* ring of files that have been found and whose contents the
+     * kernel has been asked to read ahead */
+    repo_prefetch_t    *prefetch;
+    /* number of entries in the 'prefetch' ring */
+    uint32_t            prefetch_depth;
+    /* index of the oldest entry in 'prefetch' */
+    uint32_t            prefetch_head;
+    /* number of entries in 'prefetch' that are in use */
+    uint32_t            prefetch_count;
+    uint32_t            flags;
+    uint8_t             first_call;
+    /* whether the iterator has found the final file */
+    uint8_t             prefetch_eof;
 };
 
 typedef struct sensor_flowtype_st {
@@ -3672,7 +3714,7 @@ siteRepoIterIncrement(
 
 
 /*
- *  more_files = siteRepoIterNext(iter, &attr, name, name_len, &is_missing);
+ *  more_files = siteRepoIterFind(iter, &attr, name, name_len, &is_missing);
  *
  *    Increment the file iterator so that it points to the next file,
  *    set the values in 'attr' to the tuple for that file, set 'name'
@@ -3683,7 +3725,7 @@ siteRepoIterIncrement(
  *    SK_ITERATOR_NO_MORE_ENTRIES if there are no more files.
  */
 static int
-siteRepoIterNext(
+siteRepoIterFind(
     sksite_repo_iter_t *iter,
     sksite_fileattr_t  *attr,
     char               *name,
@@ -3736,6 +3778,112 @@ siteRepoIterNext(
 }
 
 
+/*
+ *  siteRepoIterPrefetchFile(path);
+ *
+ *    Tell the kernel that the file at 'path' will be read soon, so
+ *    that it begins reading the file into the page cache while the
+ *    caller is processing the files that precede it.  This function
+ *    does not wait for the data, and errors are ignored since the
+ *    caller reports them when it opens the file.
+ */
+static void
+siteRepoIterPrefetchFile(
+    const char         *path)
+{
+#ifdef POSIX_FADV_WILLNEED
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd != -1) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#else
+    (void)path;
+#endif  /* POSIX_FADV_WILLNEED */
+}
+
+
+/*
+ *  more_files = siteRepoIterNext(iter, &attr, name, name_len, &is_missing,
+ *                                prefetch);
+ *
+ *    Behave as siteRepoIterFind(), except first return any files in
+ *    the prefetch queue of 'iter'.
+ *
+ *    When 'prefetch' is non-zero and the iterator's prefetch depth is
+ *    non-zero, fill the prefetch queue before returning its oldest
+ *    entry, and ask the kernel to read ahead each existing file that
+ *    is added to the queue.  Callers that only want the file
+ *    attributes should pass 0 for 'prefetch'.
+ */
+static int
+siteRepoIterNext(
+    sksite_repo_iter_t *iter,
+    sksite_fileattr_t  *attr,
+    char               *name,
+    size_t              name_len,
+    int                *is_missing,
+    int                 prefetch)
+{
+    repo_prefetch_t *pf;
+    size_t len;
+
+    if (prefetch && iter->prefetch_depth && !iter->prefetch_eof) {
+        if (NULL == iter->prefetch) {
+            iter->prefetch = ((repo_prefetch_t*)
+                              malloc(iter->prefetch_depth
+                                     * sizeof(repo_prefetch_t)));
+            if (NULL == iter->prefetch) {
+                /* disable prefetching */
+                iter->prefetch_depth = 0;
+                return siteRepoIterFind(iter, attr, name, name_len,
+                                        is_missing);
+            }
+        }
+        while (iter->prefetch_count < iter->prefetch_depth) {
+            pf = &iter->prefetch[((iter->prefetch_head + iter->prefetch_count)
+                                  % iter->prefetch_depth)];
+            if (siteRepoIterFind(iter, &pf->attr, pf->path,
+                                 sizeof(pf->path), &pf->is_missing))
+            {
+                iter->prefetch_eof = 1;
+                break;
+            }
+            if (!pf->is_missing) {
+                siteRepoIterPrefetchFile(pf->path);
+            }
+            ++iter->prefetch_count;
+        }
+    }
+
+    while (iter->prefetch_count) {
+        pf = &iter->prefetch[iter->prefetch_head];
+        iter->prefetch_head = (iter->prefetch_head + 1) % iter->prefetch_depth;
+        --iter->prefetch_count;
+
+        len = strlen(pf->path);
+        if (len >= name_len) {
+            /* the name does not fit; treat as siteRepoIterFind() does
+             * when it cannot generate the name */
+            continue;
+        }
+        memcpy(name, pf->path, len + 1);
+        *attr = pf->attr;
+        if (is_missing) {
+            *is_missing = pf->is_missing;
+        }
+        return SK_ITERATOR_OK;
+    }
+
+    if (iter->prefetch_eof) {
+        return SK_ITERATOR_NO_MORE_ENTRIES;
+    }
+    return siteRepoIterFind(iter, attr, name, name_len, is_missing);
+}
+
+
 int
 sksiteRepoIteratorCreate(
     sksite_repo_iter_t    **iter,
@@ -3750,6 +3898,8 @@ sksiteRepoIteratorCreate(
     flowtypeID_t ft;
     classID_t class_id;
     sensorID_t sid;
+    const char *env;
+    uint32_t depth;
     size_t i, j;
 
     if (NULL == iter
@@ -3782,6 +3932,14 @@ sksiteRepoIteratorCreate(
     (*iter)->time_end = end_time;
     (*iter)->flags = flags;
 
+    (*iter)->prefetch_depth = SKSITE_REPO_PREFETCH_DEFAULT;
+    env = getenv(SILK_REPO_PREFETCH_ENVAR);
+    if (env && *env
+        && 0 == skStringParseUint32(&depth, env, 0, SKSITE_REPO_PREFETCH_MAX))
+    {
+        (*iter)->prefetch_depth = depth;
+    }
+
     for (i = 0; 0 == skVectorGetValue(&ft, flowtypes_vec, i); ++i) {
         class_id = sksiteFlowtypeGetClassID(ft);
         if (NULL == sensor_vec) {
@@ -3822,6 +3980,7 @@ sksiteRepoIteratorDestroy(
         if ((*iter)->sen_ft_vec) {
             skVectorDestroy((*iter)->sen_ft_vec);
         }
+        free((*iter)->prefetch);
         memset(*iter, 0, sizeof(sksite_repo_iter_t));
         free(*iter);
     }
@@ -3836,7 +3995,8 @@ sksiteRepoIteratorNextFileattr(
 {
     char path[PATH_MAX];
 
-    return siteRepoIterNext(iter, fileattr, path, sizeof(path), is_missing);
+    return siteRepoIterNext(iter, fileattr, path, sizeof(path), is_missing,
+                            1);
 }
 
 int
@@ -3848,7 +4008,7 @@ sksiteRepoIteratorNextPath(
 {
     sksite_fileattr_t attr;
 
-    return siteRepoIterNext(iter, &attr, path, path_len, is_missing);
+    return siteRepoIterNext(iter, &attr, path, path_len, is_missing, 1);
 }
 
 
@@ -3869,7 +4029,8 @@ sksiteRepoIteratorNextStream(
     }
 
     do {
-        rv = siteRepoIterNext(iter, &attr, path, sizeof(path), is_missing);
+        rv = siteRepoIterNext(iter, &attr, path, sizeof(path), is_missing,
+                              1);
         if (0 != rv) {
             return rv;
         }
@@ -3912,7 +4073,8 @@ sksiteRepoIteratorGetFileattrs(
 
     while (attr_max_count > 0) {
         --attr_max_count;
-        rv = siteRepoIterNext(iter, attr, path, sizeof(path), &is_missing);
+        rv = siteRepoIterNext(iter, attr, path, sizeof(path), &is_missing,
+                              0);
         if (rv) {
             return count;
         }
@@ -3937,7 +4099,7 @@ sksiteRepoIteratorRemainingFileattrs(
         return -1;
     }
 
-    while (siteRepoIterNext(iter, &attr, path, sizeof(path), &is_missing)
+    while (siteRepoIterNext(iter, &attr, path, sizeof(path), &is_missing, 0)
            == SK_ITERATOR_OK)
     {
         if (skVectorAppendValue(fileattr_vec, &attr)) {
@@ -3957,6 +4119,29 @@ sksiteRepoIteratorReset(
     iter->time_idx = iter->time_start;
     iter->sensor_idx = 0;
     iter->first_call = 1;
+    iter->prefetch_head = 0;
+    iter->prefetch_count = 0;
+    iter->prefetch_eof = 0;
+}
+
+
+int
+sksiteRepoIteratorSetPrefetch(
+    sksite_repo_iter_t *iter,
+    uint32_t            depth)
+{
+    assert(iter);
+
+    if (depth > SKSITE_REPO_PREFETCH_MAX || iter->prefetch_count) {
+        return -1;
+    }
+    if (depth != iter->prefetch_depth) {
+        free(iter->prefetch);
+        iter->prefetch = NULL;
+        iter->prefetch_depth = depth;
+        iter->prefetch_head = 0;
+    }
+    return 0;
 }
 
 
@@ -90,6 +90,13 @@ RCSIDENTVAR(rcsID_SKSITE_H, "$SiLK: sksite.h b7b8edebba12 2015-01-05 18:05:21Z m
  */
 #define SILK_CONFIG_FILE_ENVAR "SILK_CONFIG_FILE"
 
+/**
+ *    Name of environment variable that specifies the number of files
+ *    that a repository iterator (sksite_repo_iter_t) finds ahead of
+ *    the file it returns.  See sksiteRepoIteratorSetPrefetch().
+ */
+#define SILK_REPO_PREFETCH_ENVAR "SILK_REPO_PREFETCH"
+
 
 /* Add an option for processing the silk.conf configuration file */
 #define SK_SITE_FLAG_CONFIG_FILE  0x01
@@ -921,6 +928,16 @@ sk_compmethod_t
 sksiteCompmethodGetBest(
     void);
 
+/**
+ *    Return the fastest compression method from all those that are
+ *    available; that is, the method that compresses and decompresses
+ *    with the least CPU time.  Return SK_COMPMETHOD_NONE when no fast
+ *    method is available.  Used for temporary files.
+ */
+sk_compmethod_t
+sksiteCompmethodGetFast(
+    void);
+
 /**
  *    Return the default compression method.
  */
@@ -1359,6 +1376,19 @@ typedef struct sksite_fileattr_st {
 
 #define RETURN_MISSING (1 << 0)
 
+/**
+ *    The default number of files that a repository iterator finds
+ *    ahead of the file it returns.  See
+ *    sksiteRepoIteratorSetPrefetch().
+ */
+#define SKSITE_REPO_PREFETCH_DEFAULT  8
+
+/**
+ *    The maximum number of files that a repository iterator may find
+ *    ahead of the file it returns.
+ */
+#define SKSITE_REPO_PREFETCH_MAX  1024
+
 
 /**
  *    Create a new iterator that will return files from the data
@@ -1515,6 +1545,32 @@ void
 sksiteRepoIteratorReset(
     sksite_repo_iter_t *iter);
 
+/**
+ *    Set the number of files that the repository iterator 'iter'
+ *    finds ahead of the file it returns to 'depth'.
+ *
+ *    When 'depth' is non-zero, sksiteRepoIteratorNextFileattr(),
+ *    sksiteRepoIteratorNextPath(), and sksiteRepoIteratorNextStream()
+ *    keep a queue of up to 'depth' upcoming files, and the iterator
+ *    asks the operating system to begin reading each existing file
+ *    as the file is added to the queue.  This hides the latency of
+ *    the first read of each file when the repository is on slow
+ *    storage.  A 'depth' of 0 disables the queue.
+ *
+ *    The default depth is SKSITE_REPO_PREFETCH_DEFAULT, or the value
+ *    of the SILK_REPO_PREFETCH environment variable when the iterator
+ *    is created.
+ *
+ *    Return 0 on success.  Return -1 if 'depth' is larger than
+ *    SKSITE_REPO_PREFETCH_MAX or if the queue is not empty; that is,
+ *    this function must be called before iterating over the files
+ *    or just after a call to sksiteRepoIteratorReset().
+ */
+int
+sksiteRepoIteratorSetPrefetch(
+    sksite_repo_iter_t *iter,
+    uint32_t            depth);
+
 
 #ifdef __cplusplus
 }
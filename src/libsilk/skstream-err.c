@@ -468,6 +468,10 @@ streamLastErrFunc(
         FILENAME_MSG("Initial data has already been read or written");
         break;
 
+      case SKSTREAM_ERR_BAD_COLUMNS:
+        FILENAME_MSG("Columnar record data is malformed");
+        break;
+
       case SKSTREAM_ERR_BAD_MAGIC:
         FILENAME_MSG("File does not appear to be a SiLK data file");
         break;
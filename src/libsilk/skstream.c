@@ -63,6 +63,7 @@
 
 RCSIDENT("$SiLK: skstream.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 
+#include <silk/rwascii.h>
 #include <silk/skstream.h>
 #include <silk/sksite.h>
 #include "skiobuf.h"
@@ -89,6 +90,90 @@ RCSIDENT("$SiLK: skstream.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #define SILK_ICMP_SPORT_HANDLER_ENVAR "SILK_ICMP_SPORT_HANDLER"
 
 
+/*
+ *    Name of environment variable that, when set to a non-empty
+ *    value other than "0", causes streams that write compressed SiLK
+ *    Flow files to add a block index to the file.  This variable
+ *    determines the setting of the 'silk_block_index' global.
+ */
+#define SILK_BLOCK_INDEX_ENVAR "SILK_BLOCK_INDEX"
+
+
+/*
+ *    Name of environment variable that, when set to "0", prevents
+ *    streams from using mmap() to read uncompressed SiLK Flow files.
+ *    This variable determines the setting of the 'silk_stream_mmap'
+ *    global.
+ */
+#define SILK_STREAM_MMAP_ENVAR "SILK_STREAM_MMAP"
+
+
+/*
+ *    Name of environment variable that holds the compression level
+ *    to use when writing SiLK files with the zstd compression
+ *    method.  This variable determines the setting of the
+ *    'silk_zstd_level' global.
+ */
+#define SILK_ZSTD_LEVEL_ENVAR "SILK_ZSTD_LEVEL"
+
+
+/*
+ *    Name of environment variable that holds the number of threads
+ *    each stream uses to compress or decompress the blocks of a
+ *    compressed file.  This variable determines the setting of the
+ *    'silk_compression_threads' global.
+ */
+#define SILK_COMPRESSION_THREADS_ENVAR "SILK_COMPRESSION_THREADS"
+
+
+/*
+ *    The block index at the end of a SiLK Flow file holds a 4-byte
+ *    compressed block size of 0, an entry for each block, and a
+ *    footer.  An entry holds the members of an skstream_block_t in
+ *    order, each in network byte order, with the IP addresses in
+ *    their 16-byte IPv6 form.  The footer holds the number of
+ *    entries, the size of an entry, the version of the index, and a
+ *    magic number, each as a 4-byte value in network byte order.
+ *
+ *    Releases of SiLK that do not support the index append blocks
+ *    after it, and those releases stop reading at the index.  This
+ *    library reads past an index that is followed by more blocks; see
+ *    streamBlockindexPassOver().
+ */
+#define BLOCKINDEX_ENTRY_SIZE   (4 + 32 + 4 * 8 + 4 * 16)
+#define BLOCKINDEX_FOOTER_SIZE  16
+#define BLOCKINDEX_MAGIC        0x736b6269
+
+/*
+ *    Values in the 'skip' member of an sk_stream_blockindex_t: the
+ *    block filter has not seen the block, accepted it, or rejected
+ *    it.
+ */
+#define BLOCKINDEX_UNCHECKED    0
+#define BLOCKINDEX_ACCEPTED     1
+#define BLOCKINDEX_REJECTED     2
+
+
+/*
+ *    True when the records in the mmap()ed file of 'smip_stream' may
+ *    be unpacked where they lie in the mapping.  This requires that
+ *    the records are in native byte order, since swapping modifies
+ *    the bytes, and that the platform allows unaligned access.
+ */
+#ifdef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+#  define STREAM_MAP_IN_PLACE(smip_stream)  0
+#else
+#  define STREAM_MAP_IN_PLACE(smip_stream)  (!(smip_stream)->swapFlag)
+#endif
+
+
+/*
+ *    The size of the buffer that skStreamReadRecords() and
+ *    skStreamWriteRecords() use to hold packed records.
+ */
+#define STREAM_BATCH_BUFSIZE  (256 * SK_MAX_RECORD_SIZE)
+
+
 /*
  *    Return SKSTREAM_ERR_NULL_ARGUMENT when 'srin_stream' is NULL.
  */
@@ -106,6 +191,7 @@ RCSIDENT("$SiLK: skstream.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
       case FT_RWAUGROUTING:                                     \
       case FT_RWAUGWEB:                                         \
       case FT_RWAUGSNMPOUT:                                     \
+      case FT_RWCOLUMNAR:                                       \
       case FT_RWFILTER:                                         \
       case FT_FLOWCAP:                                          \
       case FT_RWGENERIC:                                        \
@@ -132,6 +218,35 @@ RCSIDENT("$SiLK: skstream.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  */
 static int silk_icmp_nochange = 0;
 
+/*
+ *    If nonzero, add a block index to compressed SiLK Flow files that
+ *    are written.  This is 0 unless the SILK_BLOCK_INDEX envar is
+ *    set.  See streamBlockindexPrepareWrite().
+ */
+static int silk_block_index = 0;
+
+/*
+ *    If nonzero, use mmap() to read uncompressed SiLK Flow files.
+ *    This is 1 unless the SILK_STREAM_MMAP envar is set to "0".  See
+ *    streamMapCreate().
+ */
+static int silk_stream_mmap = 1;
+
+/*
+ *    The compression level to use when writing zstd-compressed
+ *    files, or 0 to use the default level of the IOBuf.  This is
+ *    set from the SILK_ZSTD_LEVEL envar.  See streamIOBufCreate().
+ */
+static uint32_t silk_zstd_level = 0;
+
+/*
+ *    The number of worker threads the IOBuf of a stream uses to
+ *    compress or decompress blocks; values below 2 process the
+ *    blocks on the caller's thread.  This is set from the
+ *    SILK_COMPRESSION_THREADS envar.  See streamIOBufCreate().
+ */
+static uint32_t silk_compression_threads = 0;
+
 #ifdef SILK_CLOBBER_ENVAR
 /*
  *    If nonzero, enable clobbering (overwriting) of existing files
@@ -142,6 +257,15 @@ static int silk_clobber = 0;
 
 /* LOCAL FUNCTION PROTOTYPES */
 
+static void
+streamBlockindexDestroy(
+    skstream_t         *stream);
+
+static int
+streamBlockindexRead(
+    skstream_t         *stream,
+    off_t              *index_pos);
+
 static ssize_t
 streamIOBufRead(
     skstream_t         *stream,
@@ -162,6 +286,720 @@ streamIOBufSeek(
 
 /* FUNCTION DEFINITIONS */
 
+/*
+ *  streamBlockindexAddBlock(bi, block);
+ *
+ *    Append a copy of 'block' to the array of block summaries in
+ *    'bi'.  Return SKSTREAM_OK on success or SKSTREAM_ERR_ALLOC if
+ *    the array cannot be grown.
+ */
+static int
+streamBlockindexAddBlock(
+    sk_stream_blockindex_t *bi,
+    const skstream_block_t *block)
+{
+    skstream_block_t *old_blocks;
+    size_t new_cap;
+
+    if (bi->count == bi->capacity) {
+        new_cap = ((bi->capacity) ? (2 * bi->capacity) : 64);
+        old_blocks = bi->blocks;
+        bi->blocks = ((skstream_block_t*)
+                      realloc(bi->blocks, new_cap * sizeof(skstream_block_t)));
+        if (NULL == bi->blocks) {
+            bi->blocks = old_blocks;
+            return SKSTREAM_ERR_ALLOC;
+        }
+        bi->capacity = new_cap;
+    }
+    memcpy(&bi->blocks[bi->count], block, sizeof(skstream_block_t));
+    ++bi->count;
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  streamBlockindexAddRecord(stream, ar);
+ *
+ *    Update the block index of 'stream' after the packed record 'ar'
+ *    has been written to the IOBuf.  When the IOBuf has written the
+ *    block that held the previous records, move the summary of that
+ *    block into the index.  Then add the record to the summary of the
+ *    current block.
+ *
+ *    The record is unpacked from 'ar' so the summary describes the
+ *    values a reader sees, which may differ from the values the
+ *    caller wrote due to the precision of the file format.
+ *
+ *    If memory cannot be allocated, stop maintaining the index.
+ */
+static void
+streamBlockindexAddRecord(
+    skstream_t         *stream,
+    const uint8_t      *ar)
+{
+    sk_stream_blockindex_t *bi = stream->blockindex;
+    skstream_block_t *blk = &bi->cur;
+    uint8_t ar_copy[SK_MAX_RECORD_SIZE];
+    uint64_t iobuf_blocks;
+    rwRec rec;
+    skipaddr_t sip;
+    skipaddr_t dip;
+    sktime_t stime;
+    sktime_t etime;
+    uint8_t proto;
+
+    iobuf_blocks = skIOBufBlockCount(stream->iobuf);
+    if (iobuf_blocks != bi->iobuf_blocks) {
+        if (blk->rec_count) {
+            if (streamBlockindexAddBlock(bi, blk)) {
+                streamBlockindexDestroy(stream);
+                return;
+            }
+        }
+        memset(blk, 0, sizeof(skstream_block_t));
+        bi->iobuf_blocks = iobuf_blocks;
+    }
+
+    memcpy(ar_copy, ar, stream->recLen);
+    RWREC_CLEAR(&rec);
+    stream->rwUnpackFn(stream, &rec, ar_copy);
+
+    proto = rwRecGetProto(&rec);
+    stime = rwRecGetStartTime(&rec);
+    etime = rwRecGetEndTime(&rec);
+    rwRecMemGetSIP(&rec, &sip);
+    rwRecMemGetDIP(&rec, &dip);
+
+    blk->proto[proto >> 5] |= (UINT32_C(1) << (proto & 0x1F));
+    if (0 == blk->rec_count) {
+        blk->stime_min = blk->stime_max = stime;
+        blk->etime_min = blk->etime_max = etime;
+        skipaddrCopy(&blk->sip_min, &sip);
+        skipaddrCopy(&blk->sip_max, &sip);
+        skipaddrCopy(&blk->dip_min, &dip);
+        skipaddrCopy(&blk->dip_max, &dip);
+    } else {
+        if (stime < blk->stime_min) {
+            blk->stime_min = stime;
+        } else if (stime > blk->stime_max) {
+            blk->stime_max = stime;
+        }
+        if (etime < blk->etime_min) {
+            blk->etime_min = etime;
+        } else if (etime > blk->etime_max) {
+            blk->etime_max = etime;
+        }
+        if (skipaddrCompare(&sip, &blk->sip_min) < 0) {
+            skipaddrCopy(&blk->sip_min, &sip);
+        } else if (skipaddrCompare(&sip, &blk->sip_max) > 0) {
+            skipaddrCopy(&blk->sip_max, &sip);
+        }
+        if (skipaddrCompare(&dip, &blk->dip_min) < 0) {
+            skipaddrCopy(&blk->dip_min, &dip);
+        } else if (skipaddrCompare(&dip, &blk->dip_max) > 0) {
+            skipaddrCopy(&blk->dip_max, &dip);
+        }
+    }
+    ++blk->rec_count;
+}
+
+
+/*
+ *  streamBlockindexCreate(stream);
+ *
+ *    Create the block index state on 'stream'.  Return SKSTREAM_OK on
+ *    success or SKSTREAM_ERR_ALLOC on failure.
+ */
+static int
+streamBlockindexCreate(
+    skstream_t         *stream)
+{
+    assert(NULL == stream->blockindex);
+
+    stream->blockindex = ((sk_stream_blockindex_t*)
+                          calloc(1, sizeof(sk_stream_blockindex_t)));
+    if (NULL == stream->blockindex) {
+        return SKSTREAM_ERR_ALLOC;
+    }
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  streamBlockindexDestroy(stream);
+ *
+ *    Free the block index state on 'stream', if any.  When writing,
+ *    this causes the stream to close without writing an index.
+ */
+static void
+streamBlockindexDestroy(
+    skstream_t         *stream)
+{
+    if (stream->blockindex) {
+        free(stream->blockindex->blocks);
+        free(stream->blockindex->skip);
+        free(stream->blockindex);
+        stream->blockindex = NULL;
+    }
+}
+
+
+/*
+ *  streamBlockindexPackIP(buf, ipaddr);
+ *  streamBlockindexUnpackIP(ipaddr, buf, is_max);
+ *
+ *    Pack 'ipaddr' into the 16 bytes at 'buf' as an IPv6 address, or
+ *    unpack those 16 bytes into 'ipaddr'.  When IPv6 is not enabled,
+ *    an IPv6 address is unpacked as the smallest IPv4 address if
+ *    'is_max' is 0 or as the largest IPv4 address otherwise.
+ */
+static void
+streamBlockindexPackIP(
+    uint8_t            *buf,
+    const skipaddr_t   *ipaddr)
+{
+#if SK_ENABLE_IPV6
+    skipaddrGetAsV6(ipaddr, buf);
+#else
+    uint32_t ipv4 = htonl(skipaddrGetV4(ipaddr));
+
+    memset(buf, 0, 10);
+    buf[10] = buf[11] = 0xFF;
+    memcpy(&buf[12], &ipv4, sizeof(ipv4));
+#endif  /* SK_ENABLE_IPV6 */
+}
+
+static void
+streamBlockindexUnpackIP(
+    skipaddr_t         *ipaddr,
+    const uint8_t      *buf,
+    int          UNUSED(is_max))
+{
+#if SK_ENABLE_IPV6
+    skipaddrSetV6(ipaddr, buf);
+#else
+    static const uint8_t v4inv6[12] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF
+    };
+    uint32_t ipv4;
+
+    if (0 == memcmp(buf, v4inv6, sizeof(v4inv6))) {
+        memcpy(&ipv4, &buf[12], sizeof(ipv4));
+        ipv4 = ntohl(ipv4);
+    } else {
+        ipv4 = (is_max ? UINT32_MAX : 0);
+    }
+    skipaddrSetV4(ipaddr, &ipv4);
+#endif  /* SK_ENABLE_IPV6 */
+}
+
+
+/*
+ *  status = streamBlockindexPassOver(stream);
+ *
+ *    Called by streamIOBufRead() when it reads a compressed block
+ *    size of 0 from a file whose header has a 'blockindex' entry.
+ *    Releases of SiLK that do not support the index append records
+ *    after it, and the marker that begins the index would end the
+ *    file for those records.  If the marker begins an index that is
+ *    followed by more data, move the file position of 'stream' past
+ *    the index and return 1.  Return 0 if the marker is the end of
+ *    the file, or -1 on a read or seek error.
+ */
+static int
+streamBlockindexPassOver(
+    skstream_t         *stream)
+{
+    uint8_t footer[BLOCKINDEX_FOOTER_SIZE];
+    uint32_t u32[4];
+    uint32_t count;
+    off_t entries_pos;
+    off_t end_pos;
+    off_t pos;
+
+    entries_pos = lseek(stream->fd, 0, SEEK_CUR);
+    end_pos = lseek(stream->fd, 0, SEEK_END);
+    if (-1 == entries_pos || -1 == end_pos) {
+        stream->errnum = errno;
+        stream->err_info = SKSTREAM_ERR_SYS_LSEEK;
+        return -1;
+    }
+
+    /* in the usual case the index ends the file; check its footer
+     * first so an unmodified file needs a single read */
+    count = 0;
+    pos = end_pos - BLOCKINDEX_FOOTER_SIZE;
+    for (;;) {
+        if (pos < entries_pos) {
+            break;
+        }
+        if (-1 == lseek(stream->fd, pos, SEEK_SET)) {
+            stream->errnum = errno;
+            stream->err_info = SKSTREAM_ERR_SYS_LSEEK;
+            return -1;
+        }
+        if (skreadn(stream->fd, footer, sizeof(footer)) != sizeof(footer)) {
+            stream->errnum = errno;
+            stream->err_info = SKSTREAM_ERR_READ;
+            return -1;
+        }
+        memcpy(u32, footer, sizeof(u32));
+        if (ntohl(u32[1]) == BLOCKINDEX_ENTRY_SIZE
+            && ntohl(u32[2]) == SKSTREAM_BLOCKINDEX_VERSION
+            && ntohl(u32[3]) == BLOCKINDEX_MAGIC
+            && (pos - entries_pos
+                == (off_t)ntohl(u32[0]) * BLOCKINDEX_ENTRY_SIZE))
+        {
+            pos += BLOCKINDEX_FOOTER_SIZE;
+            break;
+        }
+        /* otherwise look for the footer of an index that holds
+         * 'count' entries */
+        pos = entries_pos + (off_t)count * BLOCKINDEX_ENTRY_SIZE;
+        if (pos + BLOCKINDEX_FOOTER_SIZE >= end_pos) {
+            pos = end_pos;
+            break;
+        }
+        ++count;
+    }
+
+    if (pos >= end_pos || pos < entries_pos) {
+        /* this is the end of the data */
+        pos = entries_pos;
+    }
+    if (-1 == lseek(stream->fd, pos, SEEK_SET)) {
+        stream->errnum = errno;
+        stream->err_info = SKSTREAM_ERR_SYS_LSEEK;
+        return -1;
+    }
+    return (pos != entries_pos);
+}
+
+
+/*
+ *  streamBlockindexPrepareAppend(stream);
+ *
+ *    Prepare 'stream', which is open for appending and whose header
+ *    has been read, to maintain the file's block index.  If the
+ *    file's header has a 'blockindex' entry and the index is present
+ *    at the end of the file, read the index and truncate the file to
+ *    remove it; the stream writes the updated index when it is
+ *    closed.  If the file does not have a valid index, the stream
+ *    does not write one.  Return SKSTREAM_OK unless there is an
+ *    error reading or truncating the file.
+ */
+static int
+streamBlockindexPrepareAppend(
+    skstream_t         *stream)
+{
+    off_t index_pos;
+    int rv;
+
+    assert(SK_IO_APPEND == stream->io_mode);
+
+    if (!stream->is_silk_flow
+        || !stream->is_seekable
+        || stream->is_unbuffered
+        || (SK_COMPMETHOD_NONE
+            == skHeaderGetCompressionMethod(stream->silk_hdr))
+        || (NULL == skHeaderGetFirstMatch(stream->silk_hdr,
+                                          SK_HENTRY_BLOCKINDEX_ID)))
+    {
+        return SKSTREAM_OK;
+    }
+#if SK_ENABLE_ZLIB
+    if (stream->gz) {
+        return SKSTREAM_OK;
+    }
+#endif
+
+    rv = streamBlockindexCreate(stream);
+    if (rv) {
+        return rv;
+    }
+    rv = streamBlockindexRead(stream, &index_pos);
+    if (rv) {
+        streamBlockindexDestroy(stream);
+        return ((SKSTREAM_ERR_UNSUPPORT_FORMAT == rv) ? SKSTREAM_OK : rv);
+    }
+    if (ftruncate(stream->fd, index_pos) == -1) {
+        stream->errnum = errno;
+        streamBlockindexDestroy(stream);
+        return SKSTREAM_ERR_SYS_FTRUNCATE;
+    }
+    stream->blockindex->base_count = stream->blockindex->count;
+    stream->blockindex->base_end = index_pos;
+
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  status = streamBlockindexPrepareWrite(stream);
+ *
+ *    Called while writing the header to 'stream'.  Remove any
+ *    'blockindex' header entry that was copied from another file.
+ *    If the SILK_BLOCK_INDEX environment variable is set and the
+ *    stream writes compressed SiLK Flow records to a seekable file,
+ *    add a 'blockindex' entry and create the state used to build the
+ *    index.
+ */
+static int
+streamBlockindexPrepareWrite(
+    skstream_t         *stream)
+{
+    int rv;
+
+    if (skHeaderGetFirstMatch(stream->silk_hdr, SK_HENTRY_BLOCKINDEX_ID)
+        && SKHDR_LOCK_MODIFIABLE == skHeaderGetLockStatus(stream->silk_hdr))
+    {
+        rv = skHeaderRemoveAllMatching(stream->silk_hdr,
+                                       SK_HENTRY_BLOCKINDEX_ID);
+        if (rv) {
+            return rv;
+        }
+    }
+
+    if (!silk_block_index
+        || !stream->is_silk_flow
+        || !stream->is_seekable
+        || stream->is_mpi
+        || stream->is_unbuffered
+        || stream->columnar
+        || (SK_COMPMETHOD_NONE
+            == skHeaderGetCompressionMethod(stream->silk_hdr)))
+    {
+        return SKSTREAM_OK;
+    }
+#if SK_ENABLE_ZLIB
+    if (stream->gz) {
+        return SKSTREAM_OK;
+    }
+#endif
+
+    if (NULL == skHeaderGetFirstMatch(stream->silk_hdr,
+                                      SK_HENTRY_BLOCKINDEX_ID))
+    {
+        rv = skHeaderAddBlockindex(stream->silk_hdr,
+                                   SKSTREAM_BLOCKINDEX_VERSION);
+        if (rv) {
+            return rv;
+        }
+    }
+    return streamBlockindexCreate(stream);
+}
+
+
+/*
+ *  status = streamBlockindexRead(stream, &index_pos);
+ *
+ *    Read the block index from the end of the file that 'stream' is
+ *    bound to into the block index state of 'stream', and set
+ *    'index_pos' to the offset where the index begins.  The file
+ *    position is not restored.
+ *
+ *    Return SKSTREAM_OK on success, SKSTREAM_ERR_UNSUPPORT_FORMAT if
+ *    the end of the file does not hold a valid index, or another
+ *    error code if the file cannot be read.
+ */
+static int
+streamBlockindexRead(
+    skstream_t         *stream,
+    off_t              *index_pos)
+{
+    sk_stream_blockindex_t *bi = stream->blockindex;
+    skstream_block_t block;
+    uint8_t footer[BLOCKINDEX_FOOTER_SIZE];
+    uint8_t *buf = NULL;
+    uint8_t *b;
+    uint32_t u32[4];
+    uint64_t u64;
+    uint32_t count;
+    off_t data_pos;
+    off_t end_pos;
+    size_t len;
+    size_t i;
+    int j;
+    int rv = SKSTREAM_ERR_UNSUPPORT_FORMAT;
+
+    assert(bi);
+
+    /* the index must follow the header */
+    data_pos = lseek(stream->fd, 0, SEEK_CUR);
+    end_pos = lseek(stream->fd, 0, SEEK_END);
+    if (-1 == data_pos || -1 == end_pos) {
+        stream->errnum = errno;
+        return SKSTREAM_ERR_SYS_LSEEK;
+    }
+    if (end_pos - data_pos < (off_t)(4 + BLOCKINDEX_FOOTER_SIZE)) {
+        return SKSTREAM_ERR_UNSUPPORT_FORMAT;
+    }
+
+    /* read and check the footer */
+    if (-1 == lseek(stream->fd, end_pos - BLOCKINDEX_FOOTER_SIZE, SEEK_SET)) {
+        stream->errnum = errno;
+        return SKSTREAM_ERR_SYS_LSEEK;
+    }
+    if (skreadn(stream->fd, footer, sizeof(footer)) != sizeof(footer)) {
+        stream->errnum = errno;
+        return SKSTREAM_ERR_READ;
+    }
+    memcpy(u32, footer, sizeof(u32));
+    count = ntohl(u32[0]);
+    if (ntohl(u32[1]) != BLOCKINDEX_ENTRY_SIZE
+        || ntohl(u32[2]) != SKSTREAM_BLOCKINDEX_VERSION
+        || ntohl(u32[3]) != BLOCKINDEX_MAGIC
+        || ((uint64_t)(end_pos - data_pos)
+            < (4 + BLOCKINDEX_FOOTER_SIZE
+               + (uint64_t)count * BLOCKINDEX_ENTRY_SIZE)))
+    {
+        return SKSTREAM_ERR_UNSUPPORT_FORMAT;
+    }
+
+    /* read the end-of-blocks marker and the entries */
+    len = 4 + (size_t)count * BLOCKINDEX_ENTRY_SIZE;
+    *index_pos = end_pos - BLOCKINDEX_FOOTER_SIZE - (off_t)len;
+    buf = (uint8_t*)malloc(len);
+    if (NULL == buf) {
+        return SKSTREAM_ERR_ALLOC;
+    }
+    if (-1 == lseek(stream->fd, *index_pos, SEEK_SET)) {
+        stream->errnum = errno;
+        rv = SKSTREAM_ERR_SYS_LSEEK;
+        goto END;
+    }
+    if (skreadn(stream->fd, buf, len) != (ssize_t)len) {
+        stream->errnum = errno;
+        rv = SKSTREAM_ERR_READ;
+        goto END;
+    }
+    if (0 != memcmp(buf, "\0\0\0\0", 4)) {
+        goto END;
+    }
+
+    bi->count = 0;
+    for (i = 0, b = buf + 4; i < count; ++i) {
+        memcpy(&block.rec_count, b, 4);
+        block.rec_count = ntohl(block.rec_count);
+        b += 4;
+        for (j = 0; j < 8; ++j, b += 4) {
+            memcpy(&block.proto[j], b, 4);
+            block.proto[j] = ntohl(block.proto[j]);
+        }
+        memcpy(&u64, b, 8);
+        block.stime_min = (sktime_t)ntoh64(u64);
+        memcpy(&u64, b + 8, 8);
+        block.stime_max = (sktime_t)ntoh64(u64);
+        memcpy(&u64, b + 16, 8);
+        block.etime_min = (sktime_t)ntoh64(u64);
+        memcpy(&u64, b + 24, 8);
+        block.etime_max = (sktime_t)ntoh64(u64);
+        b += 32;
+        streamBlockindexUnpackIP(&block.sip_min, b, 0);
+        streamBlockindexUnpackIP(&block.sip_max, b + 16, 1);
+        streamBlockindexUnpackIP(&block.dip_min, b + 32, 0);
+        streamBlockindexUnpackIP(&block.dip_max, b + 48, 1);
+        b += 64;
+        if (0 == block.rec_count) {
+            goto END;
+        }
+        rv = streamBlockindexAddBlock(bi, &block);
+        if (rv) {
+            goto END;
+        }
+    }
+    rv = SKSTREAM_OK;
+
+  END:
+    free(buf);
+    return rv;
+}
+
+
+/*
+ *  rejected = streamBlockindexReject(stream, n);
+ *
+ *    Return 1 if the block filter of 'stream' rejects the block at
+ *    position 'n' in the block index, or 0 if the records in the
+ *    block must be read.  The filter sees each block once: the IOBuf
+ *    asks about a block when it reaches the block, which may be
+ *    before the caller does when worker threads read ahead.
+ */
+static int
+streamBlockindexReject(
+    skstream_t         *stream,
+    size_t              n)
+{
+    sk_stream_blockindex_t *bi = stream->blockindex;
+
+    if (NULL == bi || n >= bi->count) {
+        return 0;
+    }
+    if (BLOCKINDEX_UNCHECKED == bi->skip[n]) {
+        if (NULL == bi->block_fn) {
+            return 0;
+        }
+        bi->skip[n] = (bi->block_fn(&bi->blocks[n], bi->cb_data)
+                       ? BLOCKINDEX_ACCEPTED : BLOCKINDEX_REJECTED);
+    }
+    return (BLOCKINDEX_REJECTED == bi->skip[n]);
+}
+
+
+/*
+ *  status = streamBlockindexSkip(stream);
+ *
+ *    Called by skStreamReadRecord() before reading each record when
+ *    'stream' has a block filter.  When the current block has no more
+ *    records, move past the following blocks that the filter rejects;
+ *    the IOBuf seeks over those blocks without reading them.  After
+ *    the last block in the index, stop filtering and read any
+ *    remaining records normally.
+ *
+ *    Return SKSTREAM_OK on success or an error code when reading
+ *    fails.
+ */
+static int
+streamBlockindexSkip(
+    skstream_t         *stream)
+{
+    sk_stream_blockindex_t *bi = stream->blockindex;
+    const skstream_block_t *blk;
+
+    if (bi->recs_left) {
+        --bi->recs_left;
+        return SKSTREAM_OK;
+    }
+
+    while (bi->next < bi->count) {
+        blk = &bi->blocks[bi->next];
+        if (!streamBlockindexReject(stream, bi->next++)) {
+            bi->recs_left = blk->rec_count - 1;
+            return SKSTREAM_OK;
+        }
+        stream->rec_count += blk->rec_count;
+    }
+
+    bi->block_fn = NULL;
+    return SKSTREAM_OK;
+}
+
+
+/*
+ *  skip = streamBlockindexSkipBlock(block_number, stream);
+ *
+ *    Callback invoked by the IOBuf of 'stream' before it reads each
+ *    compressed block.  Return 1 if the block filter rejects the
+ *    block so the IOBuf seeks over it, or 0 otherwise.
+ */
+static int
+streamBlockindexSkipBlock(
+    uint64_t            block_number,
+    void               *v_stream)
+{
+    skstream_t *stream = (skstream_t*)v_stream;
+
+    if (NULL == stream->blockindex
+        || block_number >= stream->blockindex->count)
+    {
+        return 0;
+    }
+    return streamBlockindexReject(stream, (size_t)block_number);
+}
+
+
+/*
+ *  status = streamBlockindexWrite(stream);
+ *
+ *    Write the block index to the end of the file that 'stream' is
+ *    writing.  The IOBuf must have been flushed.  If the index does
+ *    not describe every block in the file, do not write it.  Return
+ *    SKSTREAM_OK on success or an error code on failure.
+ */
+static int
+streamBlockindexWrite(
+    skstream_t         *stream)
+{
+    sk_stream_blockindex_t *bi = stream->blockindex;
+    const skstream_block_t *blk;
+    uint8_t *buf;
+    uint8_t *b;
+    uint32_t u32;
+    uint64_t u64;
+    size_t len;
+    size_t i;
+    int j;
+    int rv = SKSTREAM_OK;
+
+    assert(bi);
+
+    /* add the summary of the final block */
+    if (bi->cur.rec_count) {
+        rv = streamBlockindexAddBlock(bi, &bi->cur);
+        if (rv) {
+            return rv;
+        }
+        memset(&bi->cur, 0, sizeof(skstream_block_t));
+    }
+    if (bi->count - bi->base_count
+        != skIOBufBlockCount(stream->iobuf) - bi->iobuf_base)
+    {
+        return SKSTREAM_OK;
+    }
+
+    len = 4 + bi->count * BLOCKINDEX_ENTRY_SIZE + BLOCKINDEX_FOOTER_SIZE;
+    buf = (uint8_t*)calloc(1, len);
+    if (NULL == buf) {
+        return SKSTREAM_ERR_ALLOC;
+    }
+
+    /* the first 4 bytes are an end-of-blocks marker */
+    for (i = 0, b = buf + 4; i < bi->count; ++i) {
+        blk = &bi->blocks[i];
+        u32 = htonl(blk->rec_count);
+        memcpy(b, &u32, 4);
+        b += 4;
+        for (j = 0; j < 8; ++j, b += 4) {
+            u32 = htonl(blk->proto[j]);
+            memcpy(b, &u32, 4);
+        }
+        u64 = hton64((uint64_t)blk->stime_min);
+        memcpy(b, &u64, 8);
+        u64 = hton64((uint64_t)blk->stime_max);
+        memcpy(b + 8, &u64, 8);
+        u64 = hton64((uint64_t)blk->etime_min);
+        memcpy(b + 16, &u64, 8);
+        u64 = hton64((uint64_t)blk->etime_max);
+        memcpy(b + 24, &u64, 8);
+        b += 32;
+        streamBlockindexPackIP(b, &blk->sip_min);
+        streamBlockindexPackIP(b + 16, &blk->sip_max);
+        streamBlockindexPackIP(b + 32, &blk->dip_min);
+        streamBlockindexPackIP(b + 48, &blk->dip_max);
+        b += 64;
+    }
+
+    /* the footer */
+    u32 = htonl((uint32_t)bi->count);
+    memcpy(b, &u32, 4);
+    u32 = htonl(BLOCKINDEX_ENTRY_SIZE);
+    memcpy(b + 4, &u32, 4);
+    u32 = htonl(SKSTREAM_BLOCKINDEX_VERSION);
+    memcpy(b + 8, &u32, 4);
+    u32 = htonl(BLOCKINDEX_MAGIC);
+    memcpy(b + 12, &u32, 4);
+
+    if (skwriten(stream->fd, buf, len) != (ssize_t)len) {
+        stream->errnum = errno;
+        rv = SKSTREAM_ERR_WRITE;
+    }
+    free(buf);
+
+    return rv;
+}
+
+
 /*
  *    Update 'stream' with the sensor, type, and starting-hour stored
  *    in the stream's header if 'stream' is bound to a packed hourly
@@ -306,6 +1144,90 @@ streamCheckUnopened(
 }
 
 
+/*
+ *  columns = streamColumnsForIPv6Policy(stream, columns);
+ *
+ *    Return the SK_COLUMN_* values in 'columns' plus those that the
+ *    IPv6 policy of 'stream' needs.  Converting a record between IPv4
+ *    and IPv6 uses its IP addresses; when they are not decoded, an
+ *    IPv6 record cannot be converted and the policy drops it.
+ */
+static uint32_t
+streamColumnsForIPv6Policy(
+    const skstream_t   *stream,
+    uint32_t            columns)
+{
+    switch (stream->v6policy) {
+      case SK_IPV6POLICY_ASV4:
+      case SK_IPV6POLICY_FORCE:
+        return columns | SK_COLUMN_SIP | SK_COLUMN_DIP | SK_COLUMN_NHIP;
+      case SK_IPV6POLICY_MIX:
+      case SK_IPV6POLICY_IGNORE:
+      case SK_IPV6POLICY_ONLY:
+        break;
+    }
+    return columns;
+}
+
+
+/*
+ *  streamFixIcmpRecord(stream, rwrec);
+ *
+ *    Modify the ICMP record 'rwrec' read from 'stream' whose ICMP
+ *    type and code were incorrectly encoded in the source port.  The
+ *    caller checks whether 'rwrec' needs to be fixed.
+ */
+static void
+streamFixIcmpRecord(
+    const skstream_t   *stream,
+    rwRec              *rwrec)
+{
+    /*
+     *  There are two ways for the ICMP Type/Code to appear in
+     *  "sPort" instead of in "dPort".
+     *
+     *  (1) The flow was an IPFIX bi-flow record read prior to
+     *  SiLK-3.4.0 where the sPort and dPort of the second record
+     *  were reversed when they should not have been.  Here, the
+     *  sPort contains ((type<<8)|code).
+     *
+     *  (2) The flow was a NetFlowV5 record read from a buggy
+     *  Cisco router and read prior to SiLK-0.8.0.  Here, the
+     *  sPort contains ((code<<8)|type).
+     *
+     *  The following assumes buggy ICMP flow records were created
+     *  from IPFIX sources unless they were created prior to SiLK
+     *  1.0 and appear in certain file formats more closely
+     *  associated with NetFlowV5.
+     *
+     *  Prior to SiLK-3.4.0, the buggy ICMP record would propagate
+     *  through the tool suite and be written to binary output
+     *  files.  As of 3.4.0, we modify the record on read.
+     */
+    if (skHeaderGetFileVersion(stream->silk_hdr) >= 16) {
+        /* File created by SiLK 1.0 or later; most likely the
+         * buggy value originated from an IPFIX source. */
+        rwRecSetDPort(rwrec, rwRecGetSPort(rwrec));
+    } else {
+        switch(skHeaderGetFileFormat(stream->silk_hdr)) {
+          case FT_RWFILTER:
+          case FT_RWNOTROUTED:
+          case FT_RWROUTED:
+          case FT_RWSPLIT:
+          case FT_RWWWW:
+            /* Most likely from a PDU source */
+            rwRecSetDPort(rwrec, BSWAP16(rwRecGetSPort(rwrec)));
+            break;
+          default:
+            /* Assume it is from an IPFIX source */
+            rwRecSetDPort(rwrec, rwRecGetSPort(rwrec));
+            break;
+        }
+    }
+    rwRecSetSPort(rwrec, 0);
+}
+
+
 #if SK_ENABLE_ZLIB
 /*
  *  status = streamGZFlush(stream);
@@ -463,6 +1385,16 @@ streamIOBufCreate(
         goto END;
     }
 
+    /* set the block size requested by skStreamSetBlockSize() */
+    if (stream->iobuf_block_size) {
+        if (-1 == skIOBufSetBlockSize(stream->iobuf,
+                                      stream->iobuf_block_size))
+        {
+            rv = SKSTREAM_ERR_IOBUF;
+            goto END;
+        }
+    }
+
     /* get the information for SiLK files */
     if (stream->is_silk) {
         /* make certain the record size is non-zero */
@@ -509,6 +1441,28 @@ streamIOBufCreate(
         }
     }
 
+#if SK_ENABLE_ZSTD
+    /* set the compression level when writing zstd */
+    if (SK_COMPMETHOD_ZSTD == compmethod && silk_zstd_level
+        && SK_IO_READ != stream->io_mode)
+    {
+        if (skIOBufSetZstdLevel(stream->iobuf, (int)silk_zstd_level) == -1) {
+            rv = SKSTREAM_ERR_IOBUF;
+            goto END;
+        }
+    }
+#endif  /* SK_ENABLE_ZSTD */
+
+    /* use worker threads for compressed data */
+    if (SK_COMPMETHOD_NONE != compmethod && silk_compression_threads > 1) {
+        if (skIOBufSetThreads(stream->iobuf, silk_compression_threads)
+            == -1)
+        {
+            rv = SKSTREAM_ERR_IOBUF;
+            goto END;
+        }
+    }
+
   END:
     return rv;
 }
@@ -595,69 +1549,284 @@ streamIOBufRead(
     size_t              count)
 {
     ssize_t rv;
+    int pass;
+
+    for (;;) {
+        rv = skreadn(stream->fd, buf, count);
+        if (rv == -1) {
+            stream->is_iobuf_error = 1;
+            stream->errnum = errno;
+            stream->err_info = SKSTREAM_ERR_READ;
+            return rv;
+        }
+        /* a compressed block size of 0 may begin a block index that
+         * has more blocks after it */
+        if (rv != sizeof(uint32_t)
+            || SK_IO_READ != stream->io_mode
+            || !stream->is_seekable
+            || 0 != memcmp(buf, "\0\0\0\0", sizeof(uint32_t))
+            || NULL == stream->silk_hdr
+            || NULL == skHeaderGetFirstMatch(stream->silk_hdr,
+                                             SK_HENTRY_BLOCKINDEX_ID))
+        {
+            return rv;
+        }
+        pass = streamBlockindexPassOver(stream);
+        if (0 == pass) {
+            return rv;
+        }
+        if (-1 == pass) {
+            stream->is_iobuf_error = 1;
+            return -1;
+        }
+    }
+}
+
+
+/*
+ *  status = streamIOBufWrite(stream, buf, count);
+ *
+ *    Write 'count' bytes from 'buf' to the file descriptor associated
+ *    with 'stream'.
+ *
+ *    This function is a callback invoked by skIOBufWrite().
+ */
+static ssize_t
+streamIOBufWrite(
+    skstream_t         *stream,
+    const void         *buf,
+    size_t              count)
+{
+    ssize_t rv;
 
-    rv = skreadn(stream->fd, buf, count);
+    rv = skwriten(stream->fd, buf, count);
     if (rv == -1) {
         stream->is_iobuf_error = 1;
         stream->errnum = errno;
-        stream->err_info = SKSTREAM_ERR_READ;
+        stream->err_info = SKSTREAM_ERR_WRITE;
+    }
+    return rv;
+}
+
+
+/*
+ *  status = streamIOBufSeek(stream, offset, whence);
+ *
+ *    Seeks to a location in 'stream' from 'whence' modified by 'offset'.
+ *
+ *    This function is a callback invoked by skIOBufRead() when the
+ *    buffer in which to return the data is NULL.
+ */
+static off_t
+streamIOBufSeek(
+    skstream_t         *stream,
+    off_t               offset,
+    int                 whence)
+{
+    off_t rv;
+
+    rv = lseek(stream->fd, offset, whence);
+    if (rv == (off_t)(-1)) {
+        if (errno != ESPIPE) {
+            stream->is_iobuf_error = 1;
+            stream->errnum = errno;
+            stream->err_info = SKSTREAM_ERR_SYS_LSEEK;
+        }
+    }
+    return rv;
+}
+
+
+#if SK_ENABLE_IPV6
+/*
+ *  count = streamIPv6PolicyApply(stream, recs, count);
+ *
+ *    Apply the IPv6 policy of 'stream' to the 'count' records in
+ *    'recs' that skStreamReadRecords() has read: convert the records
+ *    the policy requires to be converted and remove the records the
+ *    policy ignores.  Return the number of records that remain.
+ */
+static size_t
+streamIPv6PolicyApply(
+    const skstream_t   *stream,
+    rwRec              *recs,
+    size_t              count)
+{
+    rwRec *end = recs + count;
+    rwRec *src;
+    rwRec *dst;
+
+    switch (stream->v6policy) {
+      case SK_IPV6POLICY_MIX:
+        return count;
+
+      case SK_IPV6POLICY_FORCE:
+        for (src = recs; src < end; ++src) {
+            if (!rwRecIsIPv6(src)) {
+                rwRecConvertToIPv6(src);
+            }
+        }
+        return count;
+
+      case SK_IPV6POLICY_IGNORE:
+      case SK_IPV6POLICY_ASV4:
+      case SK_IPV6POLICY_ONLY:
+        break;
+    }
+
+    for (src = dst = recs; src < end; ++src) {
+        if (rwRecIsIPv6(src)) {
+            if (SK_IPV6POLICY_ONLY != stream->v6policy
+                && (SK_IPV6POLICY_IGNORE == stream->v6policy
+                    || rwRecConvertToIPv4(src)))
+            {
+                continue;
+            }
+        } else if (SK_IPV6POLICY_ONLY == stream->v6policy) {
+            continue;
+        }
+        if (dst != src) {
+            memcpy(dst, src, sizeof(rwRec));
+        }
+        ++dst;
     }
-    return rv;
+    return (dst - recs);
 }
+#endif  /* SK_ENABLE_IPV6 */
 
 
 /*
- *  status = streamIOBufWrite(stream, buf, count);
+ *  count = streamFinishRecords(stream, recs, count);
  *
- *    Write 'count' bytes from 'buf' to the file descriptor associated
- *    with 'stream'.
+ *    Helper for skStreamReadRecords() and skStreamUnpackRecords().
  *
- *    This function is a callback invoked by skIOBufWrite().
+ *    Fix the incorrectly encoded ICMP Type/Code of the 'count'
+ *    records in 'recs' that were unpacked from 'stream' (see
+ *    skStreamReadRecord()) and apply the IPv6 policy of 'stream' to
+ *    them.  Return the number of records that remain.  Since this
+ *    does not modify 'stream', it may be called on several threads at
+ *    once.
  */
-static ssize_t
-streamIOBufWrite(
-    skstream_t         *stream,
-    const void         *buf,
+static size_t
+streamFinishRecords(
+    const skstream_t   *stream,
+    rwRec              *recs,
     size_t              count)
 {
-    ssize_t rv;
+    rwRec *r;
 
-    rv = skwriten(stream->fd, buf, count);
-    if (rv == -1) {
-        stream->is_iobuf_error = 1;
-        stream->errnum = errno;
-        stream->err_info = SKSTREAM_ERR_WRITE;
+    if (!silk_icmp_nochange) {
+        for (r = recs; r < recs + count; ++r) {
+            if (rwRecIsICMP(r)
+                && rwRecGetSPort(r) != 0
+                && rwRecGetDPort(r) == 0)
+            {
+                streamFixIcmpRecord(stream, r);
+            }
+        }
     }
-    return rv;
+#if SK_ENABLE_IPV6
+    count = streamIPv6PolicyApply(stream, recs, count);
+#endif
+    return count;
 }
 
 
+#ifndef SK_HAVE_ALIGNED_ACCESS_REQUIRED
 /*
- *  status = streamIOBufSeek(stream, offset, whence);
+ *  status = streamReadPackedBatch(stream, buf, count, &packed, &packed_count);
  *
- *    Seeks to a location in 'stream' from 'whence' modified by 'offset'.
+ *    Helper for skStreamReadRecords() and skStreamReadPackedRecords().
  *
- *    This function is a callback invoked by skIOBufRead() when the
- *    buffer in which to return the data is NULL.
+ *    Get up to 'count' packed records from the IOBuf or the mapped
+ *    file of 'stream', skipping the blocks that the block filter
+ *    rejects.  Set 'packed' to the location of the records and
+ *    'packed_count' to the number of complete records there.  The
+ *    records are read into 'buf', which must hold 'count' records,
+ *    unless they are used in place in the mapped file.
+ *
+ *    Set 'packed' to NULL when no records could be read this way:
+ *    when an error occurs, when the mapped file has no complete
+ *    record remaining, and when the stream has neither an IOBuf nor a
+ *    mapped file.  Return SKSTREAM_OK or the status that ended the
+ *    read; when the status is an error and 'packed' is not NULL,
+ *    the records in 'packed' precede the error and are valid.
  */
-static off_t
-streamIOBufSeek(
+static int
+streamReadPackedBatch(
     skstream_t         *stream,
-    off_t               offset,
-    int                 whence)
+    uint8_t            *buf,
+    size_t              count,
+    uint8_t           **packed,
+    size_t             *packed_count)
 {
-    off_t rv;
+    ssize_t saw;
+    size_t n;
+    int rv = SKSTREAM_OK;
 
-    rv = lseek(stream->fd, offset, whence);
-    if (rv == (off_t)(-1)) {
-        if (errno != ESPIPE) {
-            stream->is_iobuf_error = 1;
-            stream->errnum = errno;
-            stream->err_info = SKSTREAM_ERR_SYS_LSEEK;
+    *packed = NULL;
+    *packed_count = 0;
+
+    if (stream->iobuf) {
+        if (stream->blockindex && stream->blockindex->block_fn) {
+            /* skip rejected blocks, and do not read beyond the end of
+             * the current block */
+            rv = streamBlockindexSkip(stream);
+            if (rv) {
+                return rv;
+            }
+            if (stream->blockindex->block_fn) {
+                if (count > 1u + stream->blockindex->recs_left) {
+                    count = 1u + stream->blockindex->recs_left;
+                }
+                stream->blockindex->recs_left -= count - 1;
+            }
+        }
+        saw = skIOBufRead(stream->iobuf, buf, count * stream->recLen);
+        if (saw != (ssize_t)(count * stream->recLen)) {
+            /* EOF or error; return the complete records.  The IOBuf
+             * returns the records it read before an error and reports
+             * the error on the next read, so a short read of complete
+             * records is not the end of the stream */
+            if (-1 == saw) {
+                stream->is_eof = 1;
+                return SKSTREAM_ERR_IOBUF;
+            }
+            if (saw % stream->recLen) {
+                stream->is_eof = 1;
+                stream->errobj.num = saw % stream->recLen;
+                rv = SKSTREAM_ERR_READ_SHORT;
+            } else if (0 == saw) {
+                stream->is_eof = 1;
+                rv = SKSTREAM_ERR_EOF;
+            }
+            count = saw / stream->recLen;
+        }
+        *packed = buf;
+        *packed_count = count;
+    } else if (stream->map_data) {
+        n = (stream->map_len - stream->map_pos) / stream->recLen;
+        if (0 == n) {
+            /* let skStreamReadRecord() report EOF or short read */
+            return SKSTREAM_OK;
+        }
+        if (count > n) {
+            count = n;
         }
+        if (STREAM_MAP_IN_PLACE(stream)) {
+            *packed = stream->map_data + stream->map_pos;
+        } else {
+            *packed = buf;
+            memcpy(buf, stream->map_data + stream->map_pos,
+                   count * stream->recLen);
+        }
+        stream->map_pos += count * stream->recLen;
+        *packed_count = count;
     }
+
     return rv;
 }
+#endif  /* SK_HAVE_ALIGNED_ACCESS_REQUIRED */
 
 
 /*
@@ -770,6 +1939,121 @@ streamInvokePager(
 
 
 
+/*
+ *  is_mapped = streamMapCreate(stream);
+ *
+ *    Called when creating the IOBuf for 'stream', which is reading a
+ *    SiLK Flow file whose header has been read.  If the records in
+ *    the file are not compressed and the file is a regular file,
+ *    mmap() the file so that records may be unpacked directly from
+ *    the mapped region, and return 1.  Return 0 if the file is not
+ *    mapped, in which case the stream uses an IOBuf as usual.
+ */
+static int
+streamMapCreate(
+    skstream_t         *stream)
+{
+    struct stat st;
+    off_t pos;
+    void *map;
+
+    assert(stream);
+    assert(NULL == stream->map_data);
+
+    if (!silk_stream_mmap
+        || SK_IO_READ != stream->io_mode
+        || !stream->is_silk_flow
+        || !stream->is_seekable
+        || stream->is_mpi
+        || stream->is_unbuffered
+        || stream->columnar
+        || (SK_COMPMETHOD_NONE
+            != skHeaderGetCompressionMethod(stream->silk_hdr)))
+    {
+        return 0;
+    }
+#if SK_ENABLE_ZLIB
+    if (stream->gz) {
+        return 0;
+    }
+#endif
+
+    pos = lseek(stream->fd, 0, SEEK_CUR);
+    if (-1 == pos
+        || -1 == fstat(stream->fd, &st)
+        || !S_ISREG(st.st_mode)
+        || st.st_size <= pos
+        || (uint64_t)st.st_size > (uint64_t)SSIZE_MAX)
+    {
+        return 0;
+    }
+
+    map = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, stream->fd, 0);
+    if (MAP_FAILED == map) {
+        return 0;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    stream->map_data = (uint8_t*)map;
+    stream->map_len = (size_t)st.st_size;
+    stream->map_pos = (size_t)pos;
+    stream->pre_iobuf_pos = pos;
+
+    return 1;
+}
+
+
+/*
+ *  streamMapDestroy(stream);
+ *
+ *    Unmap the file that 'stream' mapped in streamMapCreate(), if
+ *    any.
+ */
+static void
+streamMapDestroy(
+    skstream_t         *stream)
+{
+    if (stream->map_data) {
+        munmap(stream->map_data, stream->map_len);
+        stream->map_data = NULL;
+        stream->map_len = 0;
+        stream->map_pos = 0;
+    }
+}
+
+
+/*
+ *  count = streamMapRead(stream, buf, count);
+ *
+ *    Copy up to 'count' bytes from the file that 'stream' has mapped
+ *    into 'buf', or skip over them when 'buf' is NULL.  Return the
+ *    number of bytes copied, which is less than 'count' at the end
+ *    of the file.
+ */
+static ssize_t
+streamMapRead(
+    skstream_t         *stream,
+    void               *buf,
+    size_t              count)
+{
+    size_t avail;
+
+    assert(stream->map_data);
+
+    avail = stream->map_len - stream->map_pos;
+    if (count > avail) {
+        count = avail;
+    }
+    if (buf) {
+        memcpy(buf, stream->map_data + stream->map_pos, count);
+    }
+    stream->map_pos += count;
+    return (ssize_t)count;
+}
+
+
 /*
  *  status = streamOpenAppend(stream);
  *
@@ -1067,7 +2351,8 @@ streamPostOpen(
 
 /*
  *    Invoke the SiLK Flow file format-specific function that sets the
- *    rwUnpackFn() and rwPackFn() function pointers on 'stream'.
+ *    rwUnpackFn(), rwPackFn(), rwUnpackBatchFn(), and rwPackBatchFn()
+ *    function pointers on 'stream'.
  */
 static int
 streamPrepareFormat(
@@ -1090,6 +2375,12 @@ streamPrepareFormat(
       case FT_RWAUGSNMPOUT:
         return augsnmpoutioPrepare(stream);
 
+      case FT_RWCOLUMNAR:
+#if SK_ENABLE_IPV6
+        stream->supports_ipv6 = 1;
+#endif
+        return columnarioPrepare(stream);
+
       case FT_RWFILTER:
         return filterioPrepare(stream);
 
@@ -1536,6 +2827,10 @@ skStreamClose(
             }
         }
     } else if (stream->fd != -1) {
+        if (stream->columnar && stream->io_mode != SK_IO_READ) {
+            /* write the final group of records */
+            rv = columnarioFlush(stream);
+        }
         if (stream->iobuf && stream->io_mode != SK_IO_READ) {
             if (skIOBufFlush(stream->iobuf) == -1) {
                 if (stream->is_iobuf_error) {
@@ -1544,8 +2839,12 @@ skStreamClose(
                 } else {
                     rv = SKSTREAM_ERR_IOBUF;
                 }
+            } else if (stream->blockindex) {
+                rv = streamBlockindexWrite(stream);
             }
         }
+        streamBlockindexDestroy(stream);
+        streamMapDestroy(stream);
 #if SK_ENABLE_ZLIB
         if (stream->gz) {
             /* Close the gzFile */
@@ -1662,6 +2961,12 @@ skStreamDestroy(
         (*stream)->iobuf = NULL;
     }
 
+    /* Destroy the block index */
+    streamBlockindexDestroy(*stream);
+
+    /* Destroy the columnar state */
+    columnarioDestroy(*stream);
+
     /* Destroy the header */
     skHeaderDestroy(&((*stream)->silk_hdr));
 
@@ -1771,6 +3076,12 @@ skStreamFlush(
         goto END;
     }
 
+    if (stream->columnar) {
+        /* write the pending group of records */
+        rv = columnarioFlush(stream);
+        if (rv) { goto END; }
+    }
+
     if (stream->fp) {
         if (EOF == fflush(stream->fp)) {
             stream->errnum = errno;
@@ -1800,6 +3111,62 @@ skStreamFlush(
 }
 
 
+/* return the columns that hold the data for a field */
+uint32_t
+skStreamGetColumnsForField(
+    uint32_t            field_id)
+{
+    switch (field_id) {
+      case RWREC_FIELD_SIP:
+        return SK_COLUMN_SIP;
+      case RWREC_FIELD_DIP:
+        return SK_COLUMN_DIP;
+      case RWREC_FIELD_NHIP:
+        return SK_COLUMN_NHIP;
+      case RWREC_FIELD_SPORT:
+        return SK_COLUMN_SPORT;
+      case RWREC_FIELD_DPORT:
+      case RWREC_FIELD_ICMP_TYPE:
+      case RWREC_FIELD_ICMP_CODE:
+        return SK_COLUMN_DPORT | SK_COLUMN_PROTO;
+      case RWREC_FIELD_PROTO:
+        return SK_COLUMN_PROTO;
+      case RWREC_FIELD_PKTS:
+        return SK_COLUMN_PKTS;
+      case RWREC_FIELD_BYTES:
+        return SK_COLUMN_BYTES;
+      case RWREC_FIELD_FLAGS:
+      case RWREC_FIELD_INIT_FLAGS:
+      case RWREC_FIELD_REST_FLAGS:
+      case RWREC_FIELD_TCP_STATE:
+        return SK_COLUMN_FLAGS;
+      case RWREC_FIELD_STIME:
+      case RWREC_FIELD_STIME_MSEC:
+        return SK_COLUMN_STIME;
+      case RWREC_FIELD_ELAPSED:
+      case RWREC_FIELD_ELAPSED_MSEC:
+        return SK_COLUMN_ELAPSED;
+      case RWREC_FIELD_ETIME:
+      case RWREC_FIELD_ETIME_MSEC:
+        return SK_COLUMN_STIME | SK_COLUMN_ELAPSED;
+      case RWREC_FIELD_SID:
+        return SK_COLUMN_SENSOR;
+      case RWREC_FIELD_INPUT:
+        return SK_COLUMN_INPUT;
+      case RWREC_FIELD_OUTPUT:
+        return SK_COLUMN_OUTPUT;
+      case RWREC_FIELD_APPLICATION:
+        return SK_COLUMN_APPLICATION;
+      case RWREC_FIELD_FTYPE_CLASS:
+      case RWREC_FIELD_FTYPE_TYPE:
+        return SK_COLUMN_FLOWTYPE;
+      default:
+        break;
+    }
+    return SK_COLUMN_ALL;
+}
+
+
 /* return the content type */
 skcontent_t
 skStreamGetContentType(
@@ -2274,16 +3641,23 @@ off_t
 skStreamGetUpperBound(
     skstream_t         *stream)
 {
+    off_t pending = 0;
+
     assert(stream);
     assert(stream->fd != -1);
 
     if (stream->io_mode == SK_IO_READ) {
         return 0;
     }
+    if (stream->columnar) {
+        /* the group of records that has not been written */
+        pending = columnarioPendingSize(stream);
+    }
     if (stream->iobuf) {
-        return stream->pre_iobuf_pos + skIOBufTotalUpperBound(stream->iobuf);
+        return (stream->pre_iobuf_pos + skIOBufTotalUpperBound(stream->iobuf)
+                + pending);
     }
-    return lseek(stream->fd, 0, SEEK_CUR);
+    return lseek(stream->fd, 0, SEEK_CUR) + pending;
 }
 
 
@@ -2298,6 +3672,30 @@ skStreamInitialize(
         silk_icmp_nochange = 1;
     }
 
+    env = getenv(SILK_STREAM_MMAP_ENVAR);
+    if (NULL != env && 0 == strcmp(env, "0")) {
+        silk_stream_mmap = 0;
+    }
+
+    env = getenv(SILK_BLOCK_INDEX_ENVAR);
+    if (NULL != env && '\0' != env[0] && 0 != strcmp(env, "0")) {
+        silk_block_index = 1;
+    }
+
+    env = getenv(SILK_COMPRESSION_THREADS_ENVAR);
+    if (NULL != env && '\0' != env[0]) {
+        if (skStringParseUint32(&silk_compression_threads, env, 0, 256)) {
+            silk_compression_threads = 0;
+        }
+    }
+
+    env = getenv(SILK_ZSTD_LEVEL_ENVAR);
+    if (NULL != env && '\0' != env[0]) {
+        if (skStringParseUint32(&silk_zstd_level, env, 1, INT32_MAX)) {
+            silk_zstd_level = 0;
+        }
+    }
+
 #ifdef SILK_CLOBBER_ENVAR
     env = getenv(SILK_CLOBBER_ENVAR);
     if (NULL != env && *env && *env != '0') {
@@ -2309,6 +3707,19 @@ skStreamInitialize(
 }
 
 
+int
+skStreamIsGzipped(
+    const skstream_t   *stream)
+{
+    assert(stream);
+#if SK_ENABLE_ZLIB
+    return (NULL != stream->gz);
+#else
+    return 0;
+#endif
+}
+
+
 int
 skStreamIsSeekable(
     const skstream_t   *stream)
@@ -2644,6 +4055,9 @@ skStreamRead(
     assert(stream->io_mode == SK_IO_READ || stream->io_mode == SK_IO_APPEND);
     assert(stream->fd != -1);
 
+    if (stream->map_data) {
+        return (stream->last_rv = streamMapRead(stream, buf, count));
+    }
     if (stream->iobuf) {
         saw = skIOBufRead(stream->iobuf, buf, count);
         if (saw >= 0) {
@@ -2746,7 +4160,9 @@ skStreamReadRecord(
     uint8_t *ar = force_align.fa_ar;
 #endif  /* SK_HAVE_ALIGNED_ACCESS_REQUIRED */
 
+    uint8_t *packed;
     ssize_t saw;
+    size_t n;
     int rv = SKSTREAM_OK;
 
     if (stream->is_eof) {
@@ -2763,10 +4179,36 @@ skStreamReadRecord(
     /* label is used by the IPv6 policy to ignore a record */
   NEXT_RECORD:
 
+    /* skip blocks that the caller's block filter rejects */
+    if (stream->blockindex && stream->blockindex->block_fn) {
+        rv = streamBlockindexSkip(stream);
+        if (rv) {
+            goto END;
+        }
+    }
+
+    if (stream->columnar) {
+        /* take the record from the current group of records */
+        rv = columnarioReadRecords(stream, rwrec, 1, &n);
+        if (rv) {
+            stream->is_eof = 1;
+            goto END;
+        }
+        goto UNPACKED;
+    }
+
     /* read the packed record as a byte array */
+    packed = ar;
     if (stream->iobuf) {
         /* avoid function call for the common case */
         saw = skIOBufRead(stream->iobuf, ar, stream->recLen);
+    } else if (stream->map_data && STREAM_MAP_IN_PLACE(stream)
+               && stream->map_len - stream->map_pos >= stream->recLen)
+    {
+        /* unpack the record from the mapped file */
+        packed = stream->map_data + stream->map_pos;
+        stream->map_pos += stream->recLen;
+        saw = stream->recLen;
     } else {
         saw = skStreamRead(stream, ar, stream->recLen);
     }
@@ -2797,13 +4239,16 @@ skStreamReadRecord(
 
     /* convert the byte array to an rwRec in native byte order */
 #if SK_ENABLE_IPV6
-    stream->rwUnpackFn(stream, rwrec, ar);
+    stream->rwUnpackFn(stream, rwrec, packed);
 #else
-    if (stream->rwUnpackFn(stream, rwrec, ar) == SKSTREAM_ERR_UNSUPPORT_IPV6) {
+    if (stream->rwUnpackFn(stream, rwrec, packed)
+        == SKSTREAM_ERR_UNSUPPORT_IPV6)
+    {
         goto NEXT_RECORD;
     }
 #endif
 
+  UNPACKED:
     /* Handle incorrectly encoded ICMP Type/Code unless the
      * SILK_ICMP_SPORT_HANDLER environment variable is set to none. */
     if (rwRecIsICMP(rwrec)
@@ -2811,93 +4256,188 @@ skStreamReadRecord(
         && rwRecGetDPort(rwrec) == 0
         && !silk_icmp_nochange)
     {
-        /*
-         *  There are two ways for the ICMP Type/Code to appear in
-         *  "sPort" instead of in "dPort".
-         *
-         *  (1) The flow was an IPFIX bi-flow record read prior to
-         *  SiLK-3.4.0 where the sPort and dPort of the second record
-         *  were reversed when they should not have been.  Here, the
-         *  sPort contains ((type<<8)|code).
-         *
-         *  (2) The flow was a NetFlowV5 record read from a buggy
-         *  Cisco router and read prior to SiLK-0.8.0.  Here, the
-         *  sPort contains ((code<<8)|type).
-         *
-         *  The following assumes buggy ICMP flow records were created
-         *  from IPFIX sources unless they were created prior to SiLK
-         *  1.0 and appear in certain file formats more closely
-         *  associated with NetFlowV5.
-         *
-         *  Prior to SiLK-3.4.0, the buggy ICMP record would propagate
-         *  through the tool suite and be written to binary output
-         *  files.  As of 3.4.0, we modify the record on read.
-         */
-        if (skHeaderGetFileVersion(stream->silk_hdr) >= 16) {
-            /* File created by SiLK 1.0 or later; most likely the
-             * buggy value originated from an IPFIX source. */
-            rwRecSetDPort(rwrec, rwRecGetSPort(rwrec));
-        } else {
-            switch(skHeaderGetFileFormat(stream->silk_hdr)) {
-              case FT_RWFILTER:
-              case FT_RWNOTROUTED:
-              case FT_RWROUTED:
-              case FT_RWSPLIT:
-              case FT_RWWWW:
-                /* Most likely from a PDU source */
-                rwRecSetDPort(rwrec, BSWAP16(rwRecGetSPort(rwrec)));
+        streamFixIcmpRecord(stream, rwrec);
+    }
+
+    /* Write to the copy-input stream */
+    if (stream->copyInputFD) {
+        skStreamWriteRecord(stream->copyInputFD, rwrec);
+    }
+
+    /* got a record */
+    ++stream->rec_count;
+
+#if SK_ENABLE_IPV6
+    switch (stream->v6policy) {
+      case SK_IPV6POLICY_MIX:
+        break;
+
+      case SK_IPV6POLICY_IGNORE:
+        if (rwRecIsIPv6(rwrec)) {
+            goto NEXT_RECORD;
+        }
+        break;
+
+      case SK_IPV6POLICY_ASV4:
+        if (rwRecIsIPv6(rwrec)) {
+            if (rwRecConvertToIPv4(rwrec)) {
+                goto NEXT_RECORD;
+            }
+        }
+        break;
+
+      case SK_IPV6POLICY_FORCE:
+        if (!rwRecIsIPv6(rwrec)) {
+            rwRecConvertToIPv6(rwrec);
+        }
+        break;
+
+      case SK_IPV6POLICY_ONLY:
+        if (!rwRecIsIPv6(rwrec)) {
+            goto NEXT_RECORD;
+        }
+        break;
+    }
+#endif /* SK_ENABLE_IPV6 */
+
+  END:
+    return (stream->last_rv = rv);
+}
+
+
+int
+skStreamReadRecords(
+    skstream_t         *stream,
+    rwGenericRec_V5    *recs,
+    size_t              count,
+    size_t             *recs_read)
+{
+#ifndef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+    uint8_t buf[STREAM_BATCH_BUFSIZE];
+    uint8_t *packed;
+    size_t want;
+    size_t n;
+#endif
+    rwRec *rwrec = recs;
+    int rv = SKSTREAM_OK;
+
+    assert(stream);
+    assert(recs);
+    assert(recs_read);
+
+#ifndef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+    /* unless each record must be written to the copy-input stream,
+     * get the packed records from the IOBuf or the mapped file in
+     * batches and unpack each batch in a single call */
+    while (rwrec < recs + count
+           && !stream->is_eof
+           && NULL == stream->copyInputFD)
+    {
+        want = count - (rwrec - recs);
+        if (want > STREAM_BATCH_BUFSIZE / stream->recLen) {
+            want = STREAM_BATCH_BUFSIZE / stream->recLen;
+        }
+
+        if (stream->columnar) {
+            /* the records are decoded directly into 'rwrec' */
+            packed = NULL;
+            rv = columnarioReadRecords(stream, rwrec, want, &n);
+            if (rv) {
+                stream->is_eof = 1;
                 break;
-              default:
-                /* Assume it is from an IPFIX source */
-                rwRecSetDPort(rwrec, rwRecGetSPort(rwrec));
+            }
+        } else {
+            rv = streamReadPackedBatch(stream, buf, want, &packed, &want);
+            if (NULL == packed) {
                 break;
             }
         }
-        rwRecSetSPort(rwrec, 0);
+
+        if (NULL == stream->columnar) {
+            /* convert the byte arrays to rwRecs in native byte order */
+            n = stream->rwUnpackBatchFn(stream, rwrec, packed, want);
+        }
+
+        stream->rec_count += n;
+        rwrec += streamFinishRecords(stream, rwrec, n);
+        if (rv) {
+            break;
+        }
+    }
+#endif  /* SK_HAVE_ALIGNED_ACCESS_REQUIRED */
+
+    /* read any remaining records one at a time */
+    while (SKSTREAM_OK == rv && rwrec < recs + count) {
+        rv = skStreamReadRecord(stream, rwrec);
+        if (rv) {
+            break;
+        }
+        ++rwrec;
     }
 
-    /* Write to the copy-input stream */
-    if (stream->copyInputFD) {
-        skStreamWriteRecord(stream->copyInputFD, rwrec);
-    }
+    *recs_read = rwrec - recs;
+    return (stream->last_rv = rv);
+}
+
+
+int
+skStreamReadPackedRecords(
+    skstream_t         *stream,
+    uint8_t            *buf,
+    size_t              count,
+    size_t             *recs_read)
+{
+#ifndef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+    uint8_t *packed;
+    size_t n;
+#endif
+    int rv = SKSTREAM_OK;
+
+    assert(stream);
+    assert(buf);
+    assert(recs_read);
 
-    /* got a record */
-    ++stream->rec_count;
+    *recs_read = 0;
 
-#if SK_ENABLE_IPV6
-    switch (stream->v6policy) {
-      case SK_IPV6POLICY_MIX:
-        break;
+#ifdef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+    rv = SKSTREAM_ERR_UNSUPPORT_CONTENT;
+#else
+    if (!stream->is_silk_flow || stream->columnar || stream->copyInputFD
+        || (NULL == stream->iobuf && NULL == stream->map_data))
+    {
+        return (stream->last_rv = SKSTREAM_ERR_UNSUPPORT_CONTENT);
+    }
 
-      case SK_IPV6POLICY_IGNORE:
-        if (rwRecIsIPv6(rwrec)) {
-            goto NEXT_RECORD;
+    while (SKSTREAM_OK == rv && *recs_read < count) {
+        if (stream->is_eof) {
+            rv = SKSTREAM_ERR_EOF;
+            break;
         }
-        break;
-
-      case SK_IPV6POLICY_ASV4:
-        if (rwRecIsIPv6(rwrec)) {
-            if (rwRecConvertToIPv4(rwrec)) {
-                goto NEXT_RECORD;
+        rv = streamReadPackedBatch(stream, buf, count - *recs_read,
+                                   &packed, &n);
+        if (NULL == packed) {
+            if (SKSTREAM_OK == rv) {
+                /* the mapped file has no complete record left */
+                stream->is_eof = 1;
+                n = stream->map_len - stream->map_pos;
+                if (0 == n) {
+                    rv = SKSTREAM_ERR_EOF;
+                } else {
+                    stream->errobj.num = n;
+                    rv = SKSTREAM_ERR_READ_SHORT;
+                }
             }
+            break;
         }
-        break;
-
-      case SK_IPV6POLICY_FORCE:
-        if (!rwRecIsIPv6(rwrec)) {
-            rwRecConvertToIPv6(rwrec);
-        }
-        break;
-
-      case SK_IPV6POLICY_ONLY:
-        if (!rwRecIsIPv6(rwrec)) {
-            goto NEXT_RECORD;
+        if (packed != buf) {
+            memcpy(buf, packed, n * stream->recLen);
         }
-        break;
+        buf += n * stream->recLen;
+        *recs_read += n;
+        stream->rec_count += n;
     }
-#endif /* SK_ENABLE_IPV6 */
+#endif  /* SK_HAVE_ALIGNED_ACCESS_REQUIRED */
 
-  END:
     return (stream->last_rv = rv);
 }
 
@@ -2951,6 +4491,9 @@ skStreamReadSilkHeader(
 
     /* Move to end of file is stream was open for append */
     if (stream->io_mode == SK_IO_APPEND) {
+        /* remove the block index; it is rewritten on close */
+        rv = streamBlockindexPrepareAppend(stream);
+        if (rv) { goto END; }
         if (-1 == lseek(stream->fd, 0, SEEK_END)) {
             stream->errnum = errno;
             rv = SKSTREAM_ERR_SYS_LSEEK;
@@ -2961,6 +4504,11 @@ skStreamReadSilkHeader(
     /* we have the complete header */
     stream->have_hdr = 1;
 
+    /* read uncompressed records directly from a mapped file */
+    if (streamMapCreate(stream)) {
+        goto END;
+    }
+
     rv = streamIOBufCreate(stream);
     if (rv) { goto END; }
 
@@ -3010,6 +4558,154 @@ skStreamReadSilkHeaderStart(
 }
 
 
+int
+skStreamSetBlockFilter(
+    skstream_t             *stream,
+    skstream_block_fn_t     block_fn,
+    void                   *cb_data)
+{
+    off_t pos;
+    off_t index_pos;
+    int rv;
+
+    STREAM_RETURN_IF_NULL(stream);
+
+    rv = streamCheckOpen(stream);
+    if (rv) { goto END; }
+
+    rv = streamCheckAttributes(stream, SK_IO_READ, SK_CONTENT_SILK_FLOW);
+    if (rv) { goto END; }
+
+    if (!stream->have_hdr) {
+        rv = skStreamReadSilkHeader(stream, NULL);
+        if (rv) { goto END; }
+    }
+    if (stream->rec_count) {
+        rv = SKSTREAM_ERR_PREV_DATA;
+        goto END;
+    }
+    if (stream->copyInputFD) {
+        rv = SKSTREAM_ERR_PREV_COPYINPUT;
+        goto END;
+    }
+    if (stream->blockindex) {
+        stream->blockindex->block_fn = block_fn;
+        stream->blockindex->cb_data = cb_data;
+        if (stream->blockindex->skip) {
+            memset(stream->blockindex->skip, BLOCKINDEX_UNCHECKED,
+                   stream->blockindex->count);
+        }
+        goto END;
+    }
+
+    if (!stream->is_seekable
+        || NULL == stream->iobuf
+        || (SK_COMPMETHOD_NONE
+            == skHeaderGetCompressionMethod(stream->silk_hdr))
+        || (NULL == skHeaderGetFirstMatch(stream->silk_hdr,
+                                          SK_HENTRY_BLOCKINDEX_ID)))
+    {
+        rv = SKSTREAM_ERR_UNSUPPORT_FORMAT;
+        goto END;
+    }
+#if SK_ENABLE_ZLIB
+    if (stream->gz) {
+        rv = SKSTREAM_ERR_UNSUPPORT_FORMAT;
+        goto END;
+    }
+#endif
+
+    /* read the index, then return to the start of the data */
+    pos = lseek(stream->fd, 0, SEEK_CUR);
+    if (-1 == pos) {
+        stream->errnum = errno;
+        rv = SKSTREAM_ERR_SYS_LSEEK;
+        goto END;
+    }
+    rv = streamBlockindexCreate(stream);
+    if (rv) { goto END; }
+    rv = streamBlockindexRead(stream, &index_pos);
+    if (-1 == lseek(stream->fd, pos, SEEK_SET)) {
+        stream->errnum = errno;
+        rv = SKSTREAM_ERR_SYS_LSEEK;
+    }
+    if (rv) {
+        streamBlockindexDestroy(stream);
+        goto END;
+    }
+    stream->blockindex->block_fn = block_fn;
+    stream->blockindex->cb_data = cb_data;
+    if (stream->blockindex->count) {
+        stream->blockindex->skip
+            = (uint8_t*)calloc(stream->blockindex->count, sizeof(uint8_t));
+        if (NULL == stream->blockindex->skip) {
+            streamBlockindexDestroy(stream);
+            rv = SKSTREAM_ERR_ALLOC;
+            goto END;
+        }
+    }
+
+    /* have the IOBuf seek over rejected blocks, so worker threads
+     * never read ahead or uncompress them */
+    if (skIOBufSetSkipBlock(stream->iobuf, streamBlockindexSkipBlock,
+                            (void*)stream) == -1)
+    {
+        streamBlockindexDestroy(stream);
+        rv = SKSTREAM_ERR_IOBUF;
+    }
+
+  END:
+    return (stream->last_rv = rv);
+}
+
+
+int
+skStreamSetColumnProjection(
+    skstream_t         *stream,
+    uint32_t            columns)
+{
+    int rv;
+
+    STREAM_RETURN_IF_NULL(stream);
+
+    rv = streamCheckOpen(stream);
+    if (rv) { goto END; }
+
+    rv = streamCheckAttributes(stream, SK_IO_READ, SK_CONTENT_SILK_FLOW);
+    if (rv) { goto END; }
+
+    if (!stream->have_hdr) {
+        rv = skStreamReadSilkHeader(stream, NULL);
+        if (rv) { goto END; }
+    }
+    if (NULL == stream->columnar) {
+        goto END;
+    }
+    if (stream->rec_count) {
+        rv = SKSTREAM_ERR_PREV_DATA;
+        goto END;
+    }
+
+    /* the ICMP type and code fix in skStreamReadRecord() needs the
+     * protocol and both ports */
+    if (columns & (SK_COLUMN_SPORT | SK_COLUMN_DPORT)) {
+        columns |= SK_COLUMN_SPORT | SK_COLUMN_DPORT | SK_COLUMN_PROTO;
+    }
+    columns = streamColumnsForIPv6Policy(stream, columns) & SK_COLUMN_ALL;
+    columnarioSetColumns(stream, columns);
+
+    /* blocks that worker threads read ahead cannot be skipped */
+    if (columns != SK_COLUMN_ALL && stream->iobuf
+        && skIOBufSetThreads(stream->iobuf, 0) == -1)
+    {
+        rv = SKSTREAM_ERR_IOBUF;
+    }
+
+  END:
+    return (stream->last_rv = rv);
+}
+
+
 int
 skStreamSetCommentStart(
     skstream_t         *stream,
@@ -3061,6 +4757,9 @@ skStreamSetCopyInput(
         return (read_stream->last_rv = SKSTREAM_ERR_PREV_DATA);
     }
 
+    /* the copy stream must see every record */
+    streamBlockindexDestroy(read_stream);
+
     read_stream->copyInputFD = write_stream;
     return (read_stream->last_rv = SKSTREAM_OK);
 }
@@ -3080,6 +4779,36 @@ skStreamSetIPv6Policy(
     if (rv) { goto END; }
 
     stream->v6policy = policy;
+    if (stream->columnar) {
+        columnarioSetColumns(
+            stream, streamColumnsForIPv6Policy(
+                stream, columnarioGetColumns(stream)));
+    }
+
+  END:
+    return (stream->last_rv = rv);
+}
+
+
+int
+skStreamSetBlockSize(
+    skstream_t         *stream,
+    uint32_t            block_size)
+{
+    int rv = SKSTREAM_OK;
+
+    STREAM_RETURN_IF_NULL(stream);
+
+    if (stream->iobuf || stream->is_dirty) {
+        rv = SKSTREAM_ERR_PREV_DATA;
+        goto END;
+    }
+    if (0 == block_size || block_size > SKIOBUF_MAX_BLOCKSIZE) {
+        rv = SKSTREAM_ERR_INVALID_INPUT;
+        goto END;
+    }
+
+    stream->iobuf_block_size = block_size;
 
   END:
     return (stream->last_rv = rv);
@@ -3130,6 +4859,10 @@ skStreamSkipRecords(
     }
     *records_skipped = 0;
 
+    /* the block filter cannot track the position once records are
+     * skipped, so stop using it */
+    streamBlockindexDestroy(stream);
+
     /* when some other stream is expecting to see the records, we need
      * to read each record individually */
     if (stream->copyInputFD) {
@@ -3145,6 +4878,39 @@ skStreamSkipRecords(
         goto END;
     }
 
+    if (stream->columnar) {
+        rv = columnarioSkipRecords(stream, skip_count, records_skipped);
+        stream->rec_count += *records_skipped;
+        if (rv) {
+            stream->is_eof = 1;
+        }
+        goto END;
+    }
+
+    if (stream->map_data) {
+        /* move over the records in the mapped file */
+        tmp = (stream->map_len - stream->map_pos) / stream->recLen;
+        if ((size_t)tmp > skip_count) {
+            tmp = skip_count;
+        }
+        stream->map_pos += tmp * stream->recLen;
+        stream->rec_count += tmp;
+        *records_skipped = tmp;
+        if ((size_t)tmp == skip_count) {
+            rv = SKSTREAM_OK;
+            goto END;
+        }
+        stream->is_eof = 1;
+        saw = stream->map_len - stream->map_pos;
+        if (saw) {
+            stream->errobj.num = saw;
+            rv = SKSTREAM_ERR_READ_SHORT;
+        } else {
+            rv = SKSTREAM_ERR_EOF;
+        }
+        goto END;
+    }
+
     if (!stream->iobuf) {
         rv = streamSkipRecordsNonIOBuf(stream, skip_count, records_skipped);
         goto END;
@@ -3257,6 +5023,20 @@ skStreamTruncate(
         rv = SKSTREAM_ERR_SYS_FTRUNCATE;
     }
 
+    /* the block index remains valid only when the file is truncated
+     * to the position where the stream began writing blocks */
+    if (stream->blockindex) {
+        if (SKSTREAM_OK == rv && length == stream->blockindex->base_end) {
+            stream->blockindex->count = stream->blockindex->base_count;
+            memset(&stream->blockindex->cur, 0, sizeof(skstream_block_t));
+            stream->blockindex->iobuf_base
+                = stream->blockindex->iobuf_blocks
+                = skIOBufBlockCount(stream->iobuf);
+        } else {
+            streamBlockindexDestroy(stream);
+        }
+    }
+
   END:
     return (stream->last_rv = rv);
 }
@@ -3292,6 +5072,25 @@ skStreamUnbind(
 }
 
 
+size_t
+skStreamUnpackRecords(
+    const skstream_t   *stream,
+    rwRec              *recs,
+    const uint8_t      *buf,
+    size_t              count)
+{
+    size_t n;
+
+    assert(stream);
+    assert(stream->rwUnpackBatchFn);
+
+    /* the unpack functions only read the stream */
+    n = stream->rwUnpackBatchFn((skstream_t*)stream, recs, (uint8_t*)buf,
+                                count);
+    return streamFinishRecords(stream, recs, n);
+}
+
+
 ssize_t
 skStreamWrite(
     skstream_t         *stream,
@@ -3426,6 +5225,16 @@ skStreamWriteRecord(
     }
 #endif /* SK_ENABLE_IPV6 */
 
+    if (stream->columnar) {
+        /* add the record to the group; the group is written when
+         * full */
+        rv = columnarioWriteRecord(stream, rp);
+        if (rv == SKSTREAM_OK) {
+            ++stream->rec_count;
+        }
+        return (stream->last_rv = rv);
+    }
+
     /* Convert the record into a byte array in the appropriate byte order */
     rv = stream->rwPackFn(stream, rp, ar);
     if (rv != SKSTREAM_OK) {
@@ -3439,6 +5248,9 @@ skStreamWriteRecord(
             == (ssize_t)stream->recLen)
         {
             ++stream->rec_count;
+            if (stream->blockindex) {
+                streamBlockindexAddRecord(stream, ar);
+            }
             return (stream->last_rv = SKSTREAM_OK);
         } else if (stream->is_iobuf_error) {
             stream->is_iobuf_error = 0;
@@ -3458,6 +5270,103 @@ skStreamWriteRecord(
 }
 
 
+int
+skStreamWriteRecords(
+    skstream_t             *stream,
+    const rwGenericRec_V5  *recs,
+    size_t                  count,
+    size_t                 *recs_written)
+{
+#ifndef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+    uint8_t buf[STREAM_BATCH_BUFSIZE];
+    size_t want;
+    size_t n;
+#endif
+    const rwRec *rwrec = recs;
+    int rv = SKSTREAM_OK;
+
+    assert(stream);
+    assert(stream->io_mode == SK_IO_WRITE || stream->io_mode == SK_IO_APPEND);
+    assert(stream->is_silk_flow);
+    assert(stream->fd != -1);
+    assert(recs || 0 == count);
+    assert(recs_written);
+
+    if (!stream->is_dirty) {
+        rv = skStreamWriteSilkHeader(stream);
+        if (rv) {
+            *recs_written = 0;
+            return (stream->last_rv = rv);
+        }
+    }
+
+#ifndef SK_HAVE_ALIGNED_ACCESS_REQUIRED
+    /* pack the records in batches and write each batch to the IOBuf
+     * in a single call, unless the IPv6 policy may modify the records
+     * or the block index must examine each record */
+    if (stream->iobuf && NULL == stream->blockindex
+        && NULL == stream->columnar
+#if SK_ENABLE_IPV6
+        && SK_IPV6POLICY_MIX == stream->v6policy
+#endif
+        )
+    {
+        while (rwrec < recs + count) {
+            want = count - (rwrec - recs);
+            if (want > STREAM_BATCH_BUFSIZE / stream->recLen) {
+                want = STREAM_BATCH_BUFSIZE / stream->recLen;
+            }
+#if SK_ENABLE_IPV6
+            if (stream->supports_ipv6 == 0) {
+                /* stop before an IPv6 record; skStreamWriteRecord()
+                 * reports the error */
+                for (n = 0; n < want && !rwRecIsIPv6(&rwrec[n]); ++n)
+                    ;                   /* empty */
+                want = n;
+                if (0 == want) {
+                    break;
+                }
+            }
+#endif  /* SK_ENABLE_IPV6 */
+
+            n = stream->rwPackBatchFn(stream, rwrec, buf, want, &rv);
+            if (n) {
+                if (skIOBufWrite(stream->iobuf, buf, n * stream->recLen)
+                    != (ssize_t)(n * stream->recLen))
+                {
+                    if (stream->is_iobuf_error) {
+                        stream->is_iobuf_error = 0;
+                    } else {
+                        stream->err_info = SKSTREAM_ERR_IOBUF;
+                    }
+                    rv = -1;
+                    break;
+                }
+                stream->rec_count += n;
+                rwrec += n;
+            }
+            if (rv) {
+                stream->errobj.rec = rwrec;
+                break;
+            }
+        }
+    }
+#endif  /* SK_HAVE_ALIGNED_ACCESS_REQUIRED */
+
+    /* write any remaining records one at a time */
+    while (SKSTREAM_OK == rv && rwrec < recs + count) {
+        rv = skStreamWriteRecord(stream, rwrec);
+        if (rv) {
+            break;
+        }
+        ++rwrec;
+    }
+
+    *recs_written = rwrec - recs;
+    return (stream->last_rv = rv);
+}
+
+
 int
 skStreamWriteSilkHeader(
     skstream_t         *stream)
@@ -3542,6 +5451,11 @@ skStreamWriteSilkHeader(
         streamCacheHeader(stream);
     }
 
+    if (stream->is_silk_flow) {
+        rv = streamBlockindexPrepareWrite(stream);
+        if (rv) { goto END; }
+    }
+
     stream->is_dirty = 1;
     skHeaderSetLock(stream->silk_hdr, SKHDR_LOCK_FIXED);
 
@@ -3553,6 +5467,10 @@ skStreamWriteSilkHeader(
     rv = streamIOBufCreate(stream);
     if (rv) { goto END; }
 
+    if (stream->blockindex) {
+        stream->blockindex->base_end = stream->pre_iobuf_pos;
+    }
+
   END:
     return (stream->last_rv = rv);
 }
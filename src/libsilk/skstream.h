@@ -244,6 +244,9 @@ typedef enum {
     /** The call to ftruncate() failed. */
     SKSTREAM_ERR_SYS_FTRUNCATE = -9,
 
+    /** The encoded records in an FT_RWCOLUMNAR file are malformed. */
+    SKSTREAM_ERR_BAD_COLUMNS = -10,
+
 
     /* The following set of errors are general errors that occur when
      * opening a SiLK file for read, write, or append. */
@@ -325,6 +328,90 @@ typedef enum {
 #define SKSTREAM_ERROR_IS_FATAL(err) ((err) != SKSTREAM_OK && (err) < 64)
 
 
+/**
+ *    A summary of the records in one compressed block of a SiLK Flow
+ *    file, as stored in the file's block index.  See
+ *    skStreamSetBlockFilter().
+ *
+ *    When the environment variable SILK_BLOCK_INDEX is set to a
+ *    non-empty value other than "0", a stream that writes compressed
+ *    SiLK Flow records to a seekable file adds a block index to the
+ *    end of the file.  A stream that appends to a file that has a
+ *    block index maintains the index regardless of the environment
+ *    variable.
+ */
+typedef struct skstream_block_st {
+    /** number of records in the block */
+    uint32_t    rec_count;
+    /** bitmap of the protocols of the records in the block; see
+     * SKSTREAM_BLOCK_HAS_PROTO() */
+    uint32_t    proto[8];
+    /** range of the start times of the records */
+    sktime_t    stime_min;
+    sktime_t    stime_max;
+    /** range of the end times of the records */
+    sktime_t    etime_min;
+    sktime_t    etime_max;
+    /** range of the source addresses of the records */
+    skipaddr_t  sip_min;
+    skipaddr_t  sip_max;
+    /** range of the destination addresses of the records */
+    skipaddr_t  dip_min;
+    skipaddr_t  dip_max;
+} skstream_block_t;
+
+
+/**
+ *  SKSTREAM_BLOCK_HAS_PROTO(block, protocol);
+ *
+ *    Evaluates to a true value if a record in the skstream_block_t
+ *    'block' has the protocol 'protocol', false otherwise.
+ */
+#define SKSTREAM_BLOCK_HAS_PROTO(block, protocol)               \
+    ((block)->proto[(uint8_t)(protocol) >> 5]                   \
+     & (UINT32_C(1) << ((uint8_t)(protocol) & 0x1F)))
+
+
+/*
+ *    The columns of the records in an FT_RWCOLUMNAR file.  A caller
+ *    that needs only some of the fields of each record may pass the
+ *    bitwise OR of these values to skStreamSetColumnProjection().
+ */
+#define SK_COLUMN_SIP           (UINT32_C(1) <<  0)
+#define SK_COLUMN_DIP           (UINT32_C(1) <<  1)
+#define SK_COLUMN_NHIP          (UINT32_C(1) <<  2)
+#define SK_COLUMN_SPORT         (UINT32_C(1) <<  3)
+#define SK_COLUMN_DPORT         (UINT32_C(1) <<  4)
+#define SK_COLUMN_PROTO         (UINT32_C(1) <<  5)
+#define SK_COLUMN_PKTS          (UINT32_C(1) <<  6)
+#define SK_COLUMN_BYTES         (UINT32_C(1) <<  7)
+/* the flags, initial flags, session flags, and TCP state */
+#define SK_COLUMN_FLAGS         (UINT32_C(1) <<  8)
+#define SK_COLUMN_STIME         (UINT32_C(1) <<  9)
+#define SK_COLUMN_ELAPSED       (UINT32_C(1) << 10)
+#define SK_COLUMN_SENSOR        (UINT32_C(1) << 11)
+#define SK_COLUMN_FLOWTYPE      (UINT32_C(1) << 12)
+#define SK_COLUMN_INPUT         (UINT32_C(1) << 13)
+#define SK_COLUMN_OUTPUT        (UINT32_C(1) << 14)
+#define SK_COLUMN_APPLICATION   (UINT32_C(1) << 15)
+#define SK_COLUMN_MEMO          (UINT32_C(1) << 16)
+/* all columns */
+#define SK_COLUMN_ALL           ((UINT32_C(1) << 17) - 1)
+
+
+/**
+ *    Signature of the function that a caller of
+ *    skStreamSetBlockFilter() provides.  The function is called with
+ *    the summary of a block of records in the file and the 'cb_data'
+ *    the caller provided.  The function must return a true value if
+ *    the block may contain records of interest or false if the
+ *    records in the block may be skipped.
+ */
+typedef int (*skstream_block_fn_t)(
+    const skstream_block_t *block,
+    void                   *cb_data);
+
+
 /**
  *    Set 'stream' to operate on the file specified in 'pathname';
  *    'pathname' may also be one of "stdin", "stdout", or "stderr".
@@ -682,6 +769,17 @@ skStreamInitialize(
     void);
 
 
+/**
+ *    Return a non-zero value if 'stream' reads or writes a file that
+ *    is compressed as a whole with gzip; return 0 otherwise.  The
+ *    offsets that skStreamTell() returns for such a stream are not
+ *    offsets into the data the stream reads or writes.
+ */
+int
+skStreamIsGzipped(
+    const skstream_t   *stream);
+
+
 /**
  *    Return a non-zero value if 'stream' is a seekable stream; return
  *    0 otherwise.
@@ -917,6 +1015,53 @@ skStreamReadRecord(
     rwRec              *rec);
 
 
+/**
+ *    Read up to 'count' SiLK Flow records from 'stream' into the
+ *    array 'recs' and set the value in 'recs_read' to the number of
+ *    records read.  Return SKSTREAM_OK when 'count' records are
+ *    read.  Otherwise, return the status that stopped the read, such
+ *    as SKSTREAM_ERR_EOF at the end of the file; the records read
+ *    before that status are valid.
+ *
+ *    When possible, the function gets the packed records from the
+ *    stream in batches and unpacks each batch with a loop specific to
+ *    the file's format, avoiding the per-record overhead of
+ *    skStreamReadRecord().  When the records of an uncompressed file
+ *    are read from a mapped region of memory (see SILK_STREAM_MMAP in
+ *    silk(7)), the records are unpacked directly from the mapping.
+ */
+int
+skStreamReadRecords(
+    skstream_t         *stream,
+    rwRec              *recs,
+    size_t              count,
+    size_t             *recs_read);
+
+
+/**
+ *    Read up to 'count' SiLK Flow records from 'stream' into 'buf'
+ *    without unpacking them, and set the value in 'recs_read' to the
+ *    number of records read.  Each record occupies the record length
+ *    given in the header of 'stream', so 'buf' must hold 'count'
+ *    times that many bytes.  The records may be unpacked later, on
+ *    any thread, by skStreamUnpackRecords().  The stream's block
+ *    filter is honored.  The return value is that of
+ *    skStreamReadRecords().
+ *
+ *    Return SKSTREAM_ERR_UNSUPPORT_CONTENT without reading any records
+ *    when the records of 'stream' cannot be read this way; for
+ *    example, when 'stream' is an FT_RWCOLUMNAR file or when it
+ *    copies its input to another stream.  Use skStreamReadRecords()
+ *    for such a stream.
+ */
+int
+skStreamReadPackedRecords(
+    skstream_t         *stream,
+    uint8_t            *buf,
+    size_t              count,
+    size_t             *recs_read);
+
+
 /**
  *    Attempt to read the SiLK file header from 'stream', putting the
  *    data into 'hdr'.  This function requires that 'stream' contain
@@ -980,6 +1125,70 @@ skStreamReadToEndOfFile(
     ssize_t            *length);
 
 
+/**
+ *    Use the block index of the file that 'stream' is reading to skip
+ *    the records in blocks that the caller does not need.  Before
+ *    reading each compressed block of records, 'stream' calls
+ *    'block_fn' with the summary of the block and 'cb_data'.  When
+ *    'block_fn' returns false, skStreamReadRecord() does not return
+ *    the records in that block, and the block is neither read nor
+ *    uncompressed, even by the worker threads that read ahead.
+ *
+ *    This function must be called after reading the stream's header
+ *    and before reading any records.  The stream must be a seekable
+ *    SK_IO_READ stream of SiLK Flow records, and must not be the
+ *    input stream given to skStreamSetCopyInput().  Calling
+ *    skStreamSkipRecords() disables the filter.
+ *
+ *    Return SKSTREAM_OK if the file has a block index and the filter
+ *    is in place.  Return SKSTREAM_ERR_UNSUPPORT_FORMAT if the file
+ *    does not have a block index.  A stream that returns that error
+ *    can still be read normally.  Other errors may also be returned.
+ */
+int
+skStreamSetBlockFilter(
+    skstream_t             *stream,
+    skstream_block_fn_t     block_fn,
+    void                   *cb_data);
+
+
+/**
+ *    Tell 'stream' that the caller only uses the fields of each
+ *    record that are in the columns 'columns', a bitwise OR of the
+ *    SK_COLUMN_* values.  When 'stream' is reading an FT_RWCOLUMNAR
+ *    file, it does not read or decode the other columns, and those
+ *    fields are 0 in the records that skStreamReadRecord() returns.
+ *    For other file formats this function has no effect.
+ *
+ *    Whenever the source port or the destination port is requested,
+ *    the protocol and both ports are decoded so that ICMP type and
+ *    code values are handled correctly.  When the IPv6 policy of
+ *    'stream' is SK_IPV6POLICY_ASV4 or SK_IPV6POLICY_FORCE, the IP
+ *    addresses are decoded so the records can be converted.  The
+ *    projection is ignored when the stream is given to
+ *    skStreamSetCopyInput().
+ *
+ *    This function must be called after reading the stream's header
+ *    and before reading any records.  Return SKSTREAM_OK on success
+ *    or an error code on failure.
+ */
+int
+skStreamSetColumnProjection(
+    skstream_t         *stream,
+    uint32_t            columns);
+
+
+/**
+ *    Return the SK_COLUMN_* values that hold the data for the field
+ *    'field_id', which must be one of the rwrec_printable_fields_t
+ *    values defined in rwascii.h.  Return SK_COLUMN_ALL for an
+ *    unknown field.
+ */
+uint32_t
+skStreamGetColumnsForField(
+    uint32_t            field_id);
+
+
 /**
  *    Set the comment string for a textual input file to
  *    'comment_start'.  This function requires that 'stream' be an
@@ -1028,6 +1237,25 @@ skStreamSetIPv6Policy(
     sk_ipv6policy_t     policy);
 
 
+/**
+ *    Set the size of the blocks that the buffering layer of 'stream'
+ *    reads and writes to 'block_size' octets.  For a compressed
+ *    stream, this is the amount of data compressed as a unit.  When
+ *    not set, SKSTREAM_DEFAULT_BLOCKSIZE is used.  A reader handles
+ *    blocks of any size, so a file written with a non-default block
+ *    size may be read by any stream.
+ *
+ *    This must be called before the first read or write.  Return
+ *    SKSTREAM_ERR_PREV_DATA if the stream has been used, or
+ *    SKSTREAM_ERR_INVALID_INPUT if 'block_size' is 0 or is larger
+ *    than the maximum the buffering layer supports.
+ */
+int
+skStreamSetBlockSize(
+    skstream_t         *stream,
+    uint32_t            block_size);
+
+
 /**
  *    Do not use buffering on this stream.  This must be called prior
  *    to opening the stream.
@@ -1121,6 +1349,25 @@ skStreamUnbind(
     skstream_t         *stream);
 
 
+/**
+ *    Unpack the 'count' records in 'buf' that
+ *    skStreamReadPackedRecords() read from 'stream' into the array
+ *    'recs', apply the IPv6 policy of 'stream', and return the number
+ *    of records stored in 'recs'.
+ *
+ *    This function does not modify 'stream', so several threads may
+ *    unpack records read from the same stream at once, and they may
+ *    do so while another thread reads from it.  'stream' must not be
+ *    destroyed until the records have been unpacked.
+ */
+size_t
+skStreamUnpackRecords(
+    const skstream_t   *stream,
+    rwRec              *recs,
+    const uint8_t      *buf,
+    size_t              count);
+
+
 /**
  *    Attempt to write 'count' bytes from 'buf' to 'stream'.  Return
  *    the number of bytes actually written or -1 on error.
@@ -1146,6 +1393,28 @@ skStreamWriteRecord(
     const rwRec        *rec);
 
 
+/**
+ *    Write the 'count' SiLK Flow records in the array 'recs' to
+ *    'stream' and set the value in 'recs_written' to the number of
+ *    records processed.  Return SKSTREAM_OK when every record is
+ *    processed.  Otherwise, return the status from writing the record
+ *    at position 'recs_written' in 'recs', which was not written.
+ *    When that status is not fatal (see SKSTREAM_ERROR_IS_FATAL()),
+ *    the caller may report it and call this function again on the
+ *    records that follow.  As with skStreamWriteRecord(), a record
+ *    that the IPv6 policy ignores counts as processed.
+ *
+ *    When possible, the records are packed and written in batches,
+ *    avoiding the per-record overhead of skStreamWriteRecord().
+ */
+int
+skStreamWriteRecords(
+    skstream_t         *stream,
+    const rwRec        *recs,
+    size_t              count,
+    size_t             *recs_written);
+
+
 /**
  *    Attempt to write 'hdr_size' bytes from 'buf' to 'stream', with
  *    the following caveat: the first eight bytes of 'hdr' will be
@@ -243,7 +243,131 @@ RCSIDENTVAR(rcsID_SKSTREAM_PRIV_H, "$SiLK: skstream_priv.h b7b8edebba12 2015-01-
 #endif  /* SK_NO_TCP_STATE_FIX */
 
 
+/*
+ *  STREAM_DEFINE_UNPACK_BATCH(batch_fn, unpack_fn);
+ *
+ *    Define a static function named 'batch_fn' that converts 'count'
+ *    consecutive packed records in the byte array 'ar' into the array
+ *    of records 'recs' by calling the record format's unpack function
+ *    'unpack_fn' on each one.  Since 'unpack_fn' is called directly
+ *    rather than through the stream's rwUnpackFn pointer, the
+ *    compiler may inline it into the loop.
+ *
+ *    The defined function returns the number of records stored in
+ *    'recs'.  That is less than 'count' when 'ar' contains IPv6
+ *    records and SiLK does not support IPv6.
+ */
+#define STREAM_DEFINE_UNPACK_BATCH(batch_fn, unpack_fn)             \
+    static size_t                                                   \
+    batch_fn(                                                       \
+        skstream_t         *stream,                                 \
+        rwGenericRec_V5    *recs,                                   \
+        uint8_t            *ar,                                     \
+        size_t              count)                                  \
+    {                                                               \
+        const size_t reclen = stream->recLen;                       \
+        rwGenericRec_V5 *r = recs;                                  \
+        size_t i;                                                   \
+                                                                    \
+        for (i = 0; i < count; ++i, ar += reclen) {                 \
+            RWREC_CLEAR(r);                                         \
+            if (unpack_fn(stream, r, ar)                            \
+                != SKSTREAM_ERR_UNSUPPORT_IPV6)                     \
+            {                                                       \
+                ++r;                                                \
+            }                                                       \
+        }                                                           \
+        return (r - recs);                                          \
+    }
+
+
+/*
+ *  STREAM_DEFINE_PACK_BATCH(batch_fn, pack_fn);
+ *
+ *    Define a static function named 'batch_fn' that converts 'count'
+ *    records in the array 'recs' into consecutive packed records in
+ *    the byte array 'ar' by calling the record format's pack function
+ *    'pack_fn' on each one.
+ *
+ *    The defined function returns the number of records packed and
+ *    sets the value in 'rv' to SKSTREAM_OK.  If 'pack_fn' fails, the
+ *    function stops at that record, sets 'rv' to the error code, and
+ *    returns the number of records packed before it.
+ */
+#define STREAM_DEFINE_PACK_BATCH(batch_fn, pack_fn)                 \
+    static size_t                                                   \
+    batch_fn(                                                       \
+        skstream_t             *stream,                             \
+        const rwGenericRec_V5  *recs,                               \
+        uint8_t                *ar,                                 \
+        size_t                  count,                              \
+        int                    *rv)                                 \
+    {                                                               \
+        const size_t reclen = stream->recLen;                       \
+        size_t i;                                                   \
+                                                                    \
+        for (i = 0; i < count; ++i, ar += reclen) {                 \
+            *rv = pack_fn(stream, &recs[i], ar);                    \
+            if (*rv != SKSTREAM_OK) {                               \
+                return i;                                           \
+            }                                                       \
+        }                                                           \
+        *rv = SKSTREAM_OK;                                          \
+        return count;                                               \
+    }
+
+
+
+
 
+/*
+ *    The version of the block index that follows the compressed
+ *    blocks of a SiLK Flow file.  This is stored in the 'blockindex'
+ *    header entry.
+ */
+#define SKSTREAM_BLOCKINDEX_VERSION  1
+
+
+/*
+ *    The state of the block index for a stream.  When writing, the
+ *    summary of each block is added to 'blocks' once the block is
+ *    written, and the index is written when the stream is closed.
+ *    When reading, 'blocks' holds the index read from the file.
+ */
+typedef struct sk_stream_blockindex_st {
+    /* the summary of each block in the file */
+    skstream_block_t   *blocks;
+    /* number of entries in 'blocks' and number allocated */
+    size_t              count;
+    size_t              capacity;
+    /* when writing, the summary of the block being filled */
+    skstream_block_t    cur;
+    /* when writing, the skIOBufBlockCount() when 'cur' was begun */
+    uint64_t            iobuf_blocks;
+    /* when writing, the number of entries in 'blocks' and the size of
+     * the file when the stream was opened, and the value of
+     * skIOBufBlockCount() at that size.  Used to restore the index
+     * when skStreamTruncate() returns the file to that size. */
+    size_t              base_count;
+    off_t               base_end;
+    uint64_t            iobuf_base;
+    /* when reading, the index into 'blocks' of the next block */
+    size_t              next;
+    /* when reading, the number of records left in the current block */
+    uint32_t            recs_left;
+    /* when reading, the function and data for skStreamSetBlockFilter() */
+    skstream_block_fn_t block_fn;
+    void               *cb_data;
+    /* when reading, whether 'block_fn' accepted or rejected each entry
+     * in 'blocks'; see streamBlockindexReject() */
+    uint8_t            *skip;
+} sk_stream_blockindex_t;
+
+
+/*
+ *    The state of an FT_RWCOLUMNAR stream; defined in rwcolumnario.c.
+ */
+typedef struct sk_stream_columnar_st sk_stream_columnar_t;
 
 
 struct skstream_st {
@@ -275,19 +399,44 @@ struct skstream_st {
     int                   (*rwUnpackFn)(skstream_t*, rwRec*, uint8_t*);
     /* Pointer to a function to convert a record into an array of bytes */
     int                   (*rwPackFn)(skstream_t*, const rwRec*, uint8_t*);
+    /* Pointers to functions that unpack and pack arrays of records;
+     * see STREAM_DEFINE_UNPACK_BATCH() and STREAM_DEFINE_PACK_BATCH() */
+    size_t                (*rwUnpackBatchFn)(skstream_t*, rwRec*, uint8_t*,
+                                             size_t);
+    size_t                (*rwPackBatchFn)(skstream_t*, const rwRec*,
+                                           uint8_t*, size_t, int*);
     /* The stream to copy the input to---for support of the --all-dest
      * and --copy-input switches */
     skstream_t             *copyInputFD;
 
+    /* The index of the compressed blocks in the file, or NULL when
+     * the stream is not using an index */
+    sk_stream_blockindex_t *blockindex;
+
+    /* The group of records being read or written when the stream
+     * is an FT_RWCOLUMNAR file, or NULL */
+    sk_stream_columnar_t   *columnar;
+
     /* An object to hold the parameter that caused the last error */
     union {
         uint32_t        num;
         const rwRec    *rec;
     }                       errobj;
 
+    /* When reading an uncompressed SiLK Flow file that has been
+     * mmap()ed, the start of the mapped file, the length of the
+     * mapping, and the offset of the next byte to read.  'map_data'
+     * is NULL when the file is not mapped. */
+    uint8_t                *map_data;
+    size_t                  map_len;
+    size_t                  map_pos;
+
     /* Offset where the skIOBuf was created */
     off_t                   pre_iobuf_pos;
 
+    /* Block size to use for the skIOBuf, or 0 for the default */
+    uint32_t                iobuf_block_size;
+
     /* Return value from most recent function skStream* call.  See
      * also err_info.  Should we combine these into a single value? */
     ssize_t                 last_rv;
@@ -385,6 +534,9 @@ struct skstream_st {
 /*  *****  Functions exported from each rw<format>io.c file  *****  */
 
 
+int
+columnarioPrepare(
+    skstream_t         *rwIOS);
 int
 augmentedioPrepare(
     skstream_t         *rwIOS);
@@ -488,6 +640,86 @@ wwwioGetRecLen(
 
 
 
+/*  *****  rwcolumnario.c  *****  */
+
+int
+columnarioReadRecords(
+    skstream_t         *stream,
+    rwGenericRec_V5    *recs,
+    size_t              count,
+    size_t             *recs_read);
+/*
+ *    Copy up to 'count' records from the FT_RWCOLUMNAR 'stream' into
+ *    'recs', reading and decoding the next group of records when
+ *    needed, and set 'recs_read' to the number copied.  Return
+ *    SKSTREAM_OK when at least one record is copied; otherwise
+ *    return SKSTREAM_ERR_EOF or an error code and set 'recs_read'
+ *    to 0.
+ */
+
+int
+columnarioSkipRecords(
+    skstream_t         *stream,
+    size_t              skip_count,
+    size_t             *records_skipped);
+/*
+ *    Move over 'skip_count' records in the FT_RWCOLUMNAR 'stream'
+ *    and set 'records_skipped' to the number moved over.  Groups
+ *    that are skipped entirely are not decoded.  Return SKSTREAM_OK
+ *    or the error code that stopped the skip.
+ */
+
+int
+columnarioWriteRecord(
+    skstream_t             *stream,
+    const rwGenericRec_V5  *rwrec);
+/*
+ *    Add 'rwrec' to the group being written to the FT_RWCOLUMNAR
+ *    'stream', and write the group when it is full.
+ */
+
+int
+columnarioFlush(
+    skstream_t         *stream);
+/*
+ *    Write the records in the group being written to the
+ *    FT_RWCOLUMNAR 'stream', if any.
+ */
+
+size_t
+columnarioPendingSize(
+    const skstream_t   *stream);
+/*
+ *    Return the maximum number of bytes that columnarioFlush() may
+ *    write for the FT_RWCOLUMNAR 'stream'.
+ */
+
+uint32_t
+columnarioGetColumns(
+    const skstream_t   *stream);
+/*
+ *    Return the columns that are decoded when reading the
+ *    FT_RWCOLUMNAR 'stream'.
+ */
+
+void
+columnarioSetColumns(
+    skstream_t         *stream,
+    uint32_t            columns);
+/*
+ *    Decode only the columns in 'columns' when reading the
+ *    FT_RWCOLUMNAR 'stream'.
+ */
+
+void
+columnarioDestroy(
+    skstream_t         *stream);
+/*
+ *    Free the FT_RWCOLUMNAR state of 'stream', if any.
+ */
+
+
+
 /*  *****  rwpack.c  *****  */
 
 #ifdef RWPACK_BYTES_PACKETS
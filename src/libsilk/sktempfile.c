@@ -61,6 +61,7 @@
 
 RCSIDENT("$SiLK: sktempfile.c 68120faf4b40 2015-02-19 21:10:20Z mthomas $");
 
+#include <silk/sksite.h>
 #include <silk/sktempfile.h>
 #include <silk/skvector.h>
 #include <silk/utils.h>
@@ -72,6 +73,18 @@ RCSIDENT("$SiLK: sktempfile.c 68120faf4b40 2015-02-19 21:10:20Z mthomas $");
  * positive integer. */
 #define SKTEMPFILE_DEBUG_ENVAR "SILK_TEMPFILE_DEBUG"
 
+/* The compression method to use for temporary files is the method
+ * named by this environment variable, or the method returned by
+ * sksiteCompmethodGetFast() when the variable is not set or names an
+ * unavailable method. */
+#define SKTEMPFILE_COMPRESSION_ENVAR "SILK_TEMPFILE_COMPRESSION"
+
+/* Size of the blocks written to and read from temporary files; the
+ * size of each write(2) and the unit of compression.  The compressed
+ * form of a block must be no larger than SKIOBUF_MAX_BLOCKSIZE, so
+ * this is well below that value. */
+#define SKTEMPFILE_BLOCKSIZE 0x80000
+
 
 /* typedef struct sk_tempfilectx_st sk_tempfilectx_t; */
 struct sk_tempfilectx_st {
@@ -81,6 +94,9 @@ struct sk_tempfilectx_st {
     /* names of temporary files */
     sk_vector_t *tf_names;
 
+    /* compression method used by skTempFileCreateStream() */
+    sk_compmethod_t tf_compmethod;
+
     /* whether to enable debugging */
     unsigned     print_debug :1;
 
@@ -136,6 +152,42 @@ const char * const sktempfile_null = "NULL";
 /* FUNCTION DEFINITIONS */
 
 
+/*
+ *  compmethod = tempfileGetCompmethod();
+ *
+ *    Return the compression method to use for temporary files: the
+ *    available method whose name is the value of the
+ *    SILK_TEMPFILE_COMPRESSION environment variable, or the fastest
+ *    available method.  Temporary files are written once and read
+ *    once, so the speed of compression matters more than the size of
+ *    the file.
+ */
+static sk_compmethod_t
+tempfileGetCompmethod(
+    void)
+{
+    char name[64];
+    const char *env_value;
+    sk_compmethod_t cm;
+
+    env_value = getenv(SKTEMPFILE_COMPRESSION_ENVAR);
+    if (env_value && env_value[0]) {
+        for (cm = 0; cm < SK_COMPMETHOD_BEST; ++cm) {
+            if (0 == sksiteCompmethodCheck(cm)) {
+                break;
+            }
+            if (SK_COMPMETHOD_IS_AVAIL == sksiteCompmethodCheck(cm)) {
+                sksiteCompmethodGetName(name, sizeof(name), cm);
+                if (0 == strcasecmp(name, env_value)) {
+                    return cm;
+                }
+            }
+        }
+    }
+    return sksiteCompmethodGetFast();
+}
+
+
 /* find the tmpdir to use, initialize template, create vector */
 int
 skTempFileInitialize(
@@ -192,6 +244,8 @@ skTempFileInitialize(
         t->print_debug = 1;
     }
 
+    t->tf_compmethod = tempfileGetCompmethod();
+
     TEMPFILE_DEBUG1(t, "Initialization complete for '%s'", t->tf_template);
 
     *tmpctx = t;
@@ -318,13 +372,13 @@ skTempFileCreateStream(
     ssize_t rv;
     int saved_errno;
 
-    compmethod = SK_COMPMETHOD_BEST;
-
     if (NULL == tmpctx || NULL == tmp_idx) {
         errno = 0;
         return NULL;
     }
 
+    compmethod = tmpctx->tf_compmethod;
+
     /* should only fail due to an allocation error */
     if (skStreamCreate(&stream, SK_IO_WRITE, SK_CONTENT_SILK)) {
         saved_errno = errno;
@@ -354,6 +408,14 @@ skTempFileCreateStream(
         goto ERROR;
     }
 
+    /* use large blocks to reduce the number of writes */
+    if ((rv = skStreamSetBlockSize(stream, SKTEMPFILE_BLOCKSIZE))) {
+        saved_errno = skStreamGetLastErrno(stream);
+        skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
+        TEMPFILE_DEBUG1(tmpctx, "Cannot set block size: %s", errbuf);
+        goto ERROR;
+    }
+
     /* open the file */
     if ((rv = skStreamMakeTemp(stream))) {
         saved_errno = skStreamGetLastErrno(stream);
@@ -471,6 +533,13 @@ skTempFileOpenStream(
         goto ERROR;
     }
 
+    if ((rv = skStreamSetBlockSize(stream, SKTEMPFILE_BLOCKSIZE))) {
+        saved_errno = skStreamGetLastErrno(stream);
+        skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
+        TEMPFILE_DEBUG1(tmpctx, "Cannot set block size: %s", errbuf);
+        goto ERROR;
+    }
+
     if ((rv = skStreamOpen(stream))) {
         saved_errno = skStreamGetLastErrno(stream);
         skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
@@ -478,6 +547,14 @@ skTempFileOpenStream(
         goto ERROR;
     }
 
+#ifdef POSIX_FADV_SEQUENTIAL
+    /* the file is read once from start to end, typically while
+     * merging with other files; ask the kernel to read ahead
+     * aggressively so that the merge does not wait on each file */
+    posix_fadvise(skStreamGetDescriptor(stream), 0, 0,
+                  POSIX_FADV_SEQUENTIAL);
+#endif
+
     if ((rv = skStreamReadSilkHeader(stream, &hdr))) {
         saved_errno = skStreamGetLastErrno(stream);
         skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
@@ -65,6 +65,7 @@ RCSIDENT("$SiLK: skunique.c 7801981cf8ef 2015-02-13 21:26:51Z mthomas $");
 #include <silk/rwascii.h>
 #include <silk/rwrec.h>
 #include <silk/skheap.h>
+#include <silk/skmerge.h>
 #include <silk/skstream.h>
 #include <silk/sktempfile.h>
 #include <silk/skunique.h>
@@ -91,6 +92,11 @@ RCSIDENT("$SiLK: skunique.c 7801981cf8ef 2015-02-13 21:26:51Z mthomas $");
 
 #define HASH_INITIAL_SIZE    500000
 
+/* The most memory a hash table uses when no memory limit is set: the
+ * largest array of buckets hashlib allows plus the array it replaces
+ * while growing.  With threads, the partitions divide this amount. */
+#define HASH_DEFAULT_MEMORY_LIMIT  (3 * (uint64_t)MAX_MEMORY_BLOCK / 2)
+
 #define MAX_MERGE_FILES 1024
 
 #define COMP_FUNC_CAST(cfc_func)                                \
@@ -584,6 +590,55 @@ skFieldListGetFieldCount(
 }
 
 
+/*  return the record columns the fields in field_list read */
+uint32_t
+skFieldListGetColumns(
+    const sk_fieldlist_t   *field_list)
+{
+    uint32_t columns = 0;
+    size_t i;
+
+    assert(field_list);
+    for (i = 0; i < field_list->num_fields; ++i) {
+        switch (field_list->fields[i].id) {
+          case SK_FIELD_SIPv6:
+            columns |= SK_COLUMN_SIP;
+            break;
+          case SK_FIELD_DIPv6:
+            columns |= SK_COLUMN_DIP;
+            break;
+          case SK_FIELD_NHIPv6:
+            columns |= SK_COLUMN_NHIP;
+            break;
+          case SK_FIELD_RECORDS:
+            break;
+          case SK_FIELD_SUM_PACKETS:
+            columns |= SK_COLUMN_PKTS;
+            break;
+          case SK_FIELD_SUM_BYTES:
+            columns |= SK_COLUMN_BYTES;
+            break;
+          case SK_FIELD_SUM_ELAPSED:
+            columns |= SK_COLUMN_ELAPSED;
+            break;
+          case SK_FIELD_MIN_STARTTIME:
+            columns |= SK_COLUMN_STIME;
+            break;
+          case SK_FIELD_MAX_ENDTIME:
+            columns |= SK_COLUMN_STIME | SK_COLUMN_ELAPSED;
+            break;
+          case SK_FIELD_CALLER:
+            return SK_COLUMN_ALL;
+          default:
+            /* the remaining ids match those in rwascii.h */
+            columns |= skStreamGetColumnsForField(field_list->fields[i].id);
+            break;
+        }
+    }
+    return columns;
+}
+
+
 /*  get pointer to a specific field in an encoded buffer */
 #define FIELD_PTR(all_fields_buffer, flent)     \
     ((all_fields_buffer) + (flent)->offset)
@@ -1774,6 +1829,11 @@ typedef struct sk_uniq_field_info_st {
     /* number of distinct fields */
     uint8_t                 distinct_num_fields;
     uint8_t                 distinct_octets;
+
+    /* when non-zero, distinct fields larger than one octet are
+     * estimated with HyperLogLog sketches having 2^sketch_bits
+     * registers; see skUniqueSetDistinctApprox() */
+    uint8_t                 sketch_bits;
 } sk_uniq_field_info_t;
 
 
@@ -2020,17 +2080,35 @@ typedef enum {
      * see.  DISTINCT_BITMAP is used for values up to 8bits;
      * DISTINCT_SHORTLIST is used for larger values where we have seen
      * no more than 32 distinct values.  Once the DISTINCT_SHORTLIST
-     * is full, it is converted to a DISTINCT_HASHSET. */
+     * is full, it is converted to a DISTINCT_HASHSET, or to a
+     * DISTINCT_SKETCH when distinct counts are being estimated. */
     DISTINCT_BITMAP,
     DISTINCT_SHORTLIST,
-    DISTINCT_HASHSET
+    DISTINCT_HASHSET,
+    DISTINCT_SKETCH
 } distinct_type_t;
 
 
+/*
+ *    A HyperLogLog sketch.  Each value is hashed to 64 bits; the top
+ *    'sketch_bits' bits of the hash select a register, and the
+ *    register holds the largest position of the first 1-bit seen in
+ *    the remaining bits.  The sum of 2^-register and the number of
+ *    zero registers are maintained as registers change so that the
+ *    estimate is cheap to compute.
+ */
+typedef struct uniq_sketch_st {
+    double              sk_sum;
+    uint32_t            sk_zeros;
+    uint8_t             sk_reg[1];
+} uniq_sketch_t;
+
+
 typedef union distinct_tracker_un {
     sk_short_list_t    *dv_shortlist;
     HashSet            *dv_hashset;
     sk_bitmap_t        *dv_bitmap;
+    uniq_sketch_t      *dv_sketch;
 } distinct_tracker_t;
 
 typedef struct distinct_value_st {
@@ -2042,6 +2120,199 @@ typedef struct distinct_value_st {
 } distinct_value_t;
 
 
+/*
+ *    The approximate number of bytes used by a bitmap and by a short
+ *    list that count distinct values of 'm_octets' octets.
+ */
+#define UNIQ_BITMAP_BYTES(m_octets)                             \
+    (sizeof(sk_bitmap_t) + ((1u << ((m_octets) * CHAR_BIT)) / CHAR_BIT))
+#define UNIQ_SHORTLIST_BYTES(m_octets)                                  \
+    (offsetof(sk_short_list_t, sl_data)                                 \
+     + (m_octets) * SK_SHORT_LIST_MAX_ELEMENTS)
+
+/*
+ *    The number of registers in a sketch, and the approximate number
+ *    of bytes a sketch uses.
+ */
+#define UNIQ_SKETCH_REGISTERS(m_bits)  ((size_t)1 << (m_bits))
+#define UNIQ_SKETCH_BYTES(m_bits)                                       \
+    (offsetof(uniq_sketch_t, sk_reg) + UNIQ_SKETCH_REGISTERS(m_bits))
+
+/*
+ *    In a temporary file, a distinct count with this bit set is an
+ *    estimate, and the distinct file holds the registers of the
+ *    sketch rather than the distinct values.  The bit is also set in
+ *    the 'dv_count' of a DISTINCT_SKETCH.
+ */
+#define UNIQ_SKETCH_FLAG  (UINT64_C(1) << 63)
+
+/*
+ *    The number of octets in the distinct file for a distinct field
+ *    described by 'm_dist' whose count in the main file is 'm_count'.
+ */
+#define UNIQ_DISTINCT_DATA_OCTETS(m_fi, m_dist, m_count)                \
+    (((m_count) & UNIQ_SKETCH_FLAG)                                     \
+     ? UNIQ_SKETCH_REGISTERS((m_fi)->sketch_bits)                       \
+     : (size_t)(m_dist)->dv_octets * (m_count))
+
+/* defined in hashlib.c */
+void
+hashlittle2(
+    const void         *key,
+    size_t              length,
+    uint32_t           *pc,
+    uint32_t           *pb);
+
+
+/*
+ *  uniqSketchPosition(value, octets, bits, &reg_idx, &rank);
+ *
+ *    Hash the 'octets' octets at 'value' and set 'reg_idx' to the
+ *    register of a sketch with 2^'bits' registers that the value
+ *    selects and 'rank' to the value the register should hold.
+ */
+static void
+uniqSketchPosition(
+    const uint8_t      *value,
+    uint8_t             octets,
+    uint8_t             bits,
+    uint32_t           *reg_idx,
+    uint8_t            *rank)
+{
+    uint32_t hi = 0;
+    uint32_t lo = 0;
+    uint64_t h;
+    uint8_t r;
+
+    hashlittle2(value, octets, &hi, &lo);
+    h = ((uint64_t)hi << 32) | lo;
+
+    *reg_idx = (uint32_t)(h >> (64 - bits));
+    h <<= bits;
+    for (r = 1; r <= 64 - bits && !(h & UINT64_C(0x8000000000000000)); ++r) {
+        h <<= 1;
+    }
+    *rank = r;
+}
+
+
+/*
+ *  estimate = uniqSketchEstimate(sum, zeros, bits);
+ *
+ *    Return the estimated number of distinct values of a sketch with
+ *    2^'bits' registers given the sum of 2^-register over the
+ *    registers and the number of registers that are zero.  Use
+ *    linear counting when the estimate is small.
+ */
+static uint64_t
+uniqSketchEstimate(
+    double              sum,
+    uint32_t            zeros,
+    uint8_t             bits)
+{
+    const double m = (double)UNIQ_SKETCH_REGISTERS(bits);
+    double alpha;
+    double est;
+
+    switch (bits) {
+      case 4:
+        alpha = 0.673;
+        break;
+      case 5:
+        alpha = 0.697;
+        break;
+      case 6:
+        alpha = 0.709;
+        break;
+      default:
+        alpha = 0.7213 / (1.0 + 1.079 / m);
+        break;
+    }
+    est = alpha * m * m / sum;
+    if (est <= 2.5 * m && zeros) {
+        est = m * log(m / zeros);
+    }
+    return (uint64_t)(est + 0.5);
+}
+
+
+/*
+ *  estimate = uniqSketchEstimateRegisters(registers, bits);
+ *
+ *    Return the estimated number of distinct values for the 2^'bits'
+ *    sketch registers in 'registers'.
+ */
+static uint64_t
+uniqSketchEstimateRegisters(
+    const uint8_t      *registers,
+    uint8_t             bits)
+{
+    double sum = 0.0;
+    uint32_t zeros = 0;
+    size_t i;
+
+    for (i = 0; i < UNIQ_SKETCH_REGISTERS(bits); ++i) {
+        sum += 1.0 / (double)(UINT64_C(1) << registers[i]);
+        if (0 == registers[i]) {
+            ++zeros;
+        }
+    }
+    return uniqSketchEstimate(sum, zeros, bits);
+}
+
+
+/*
+ *  sketch = uniqSketchCreate(bits);
+ *
+ *    Create an empty sketch with 2^'bits' registers.  Return NULL on
+ *    allocation error.
+ */
+static uniq_sketch_t *
+uniqSketchCreate(
+    uint8_t             bits)
+{
+    uniq_sketch_t *sketch;
+
+    sketch = (uniq_sketch_t*)calloc(1, UNIQ_SKETCH_BYTES(bits));
+    if (sketch) {
+        sketch->sk_sum = (double)UNIQ_SKETCH_REGISTERS(bits);
+        sketch->sk_zeros = (uint32_t)UNIQ_SKETCH_REGISTERS(bits);
+    }
+    return sketch;
+}
+
+
+/*
+ *  changed = uniqSketchAdd(sketch, bits, value, octets);
+ *
+ *    Add the 'octets' octets at 'value' to 'sketch', which has
+ *    2^'bits' registers.  Return 1 if a register changed, 0
+ *    otherwise.
+ */
+static int
+uniqSketchAdd(
+    uniq_sketch_t      *sketch,
+    uint8_t             bits,
+    const uint8_t      *value,
+    uint8_t             octets)
+{
+    uint32_t idx;
+    uint8_t rank;
+
+    uniqSketchPosition(value, octets, bits, &idx, &rank);
+    if (rank <= sketch->sk_reg[idx]) {
+        return 0;
+    }
+    if (0 == sketch->sk_reg[idx]) {
+        --sketch->sk_zeros;
+    }
+    sketch->sk_sum += (1.0 / (double)(UINT64_C(1) << rank)
+                       - 1.0 / (double)(UINT64_C(1) << sketch->sk_reg[idx]));
+    sketch->sk_reg[idx] = rank;
+    return 1;
+}
+
+
 static int
 uniqDistinctShortlistCmp(
     const void         *field_buffer1,
@@ -2086,6 +2357,10 @@ uniqDistinctFree(
                 dist->dv_v.dv_hashset = NULL;
             }
             break;
+          case DISTINCT_SKETCH:
+            free(dist->dv_v.dv_sketch);
+            dist->dv_v.dv_sketch = NULL;
+            break;
         }
     }
     free(distincts);
@@ -2150,10 +2425,11 @@ uniqDistinctAllocMerging(
 
 
 /*
- *  ok = uniqDistinctAlloc(field_info, &distincts);
+ *  ok = uniqDistinctAlloc(field_info, &distincts, memory_used);
  *
  *    Create the data structures required by 'field_info' to count
- *    distinct values and fill 'distincts' with the structures.
+ *    distinct values and fill 'distincts' with the structures.  When
+ *    'memory_used' is not NULL, add to it the bytes allocated.
  *
  *    To allocate the distincts structure but not the data structures
  *    used for counting distinct items, use
@@ -2166,7 +2442,8 @@ uniqDistinctAllocMerging(
 static int
 uniqDistinctAlloc(
     const sk_uniq_field_info_t     *field_info,
-    distinct_value_t              **new_distincts)
+    distinct_value_t              **new_distincts,
+    uint64_t                       *memory_used)
 {
     sk_fieldlist_iterator_t fl_iter;
     sk_fieldentry_t *field;
@@ -2211,6 +2488,19 @@ uniqDistinctAlloc(
         assert(dist <= distincts + field_info->distinct_num_fields);
     }
 
+    if (memory_used) {
+        *memory_used += (field_info->distinct_num_fields
+                         * sizeof(distinct_value_t));
+        for (dist = distincts;
+             dist < distincts + field_info->distinct_num_fields;
+             ++dist)
+        {
+            *memory_used += ((DISTINCT_BITMAP == dist->dv_type)
+                             ? UNIQ_BITMAP_BYTES(dist->dv_octets)
+                             : UNIQ_SHORTLIST_BYTES(dist->dv_octets));
+        }
+    }
+
     *new_distincts = distincts;
     return 0;
 
@@ -2221,15 +2511,45 @@ uniqDistinctAlloc(
 
 
 /*
- *  status = uniqDistinctShortListToHashSet(dist);
+ *  status = uniqDistinctHashSetInsert(hashset, key, memory_used);
+ *
+ *    Insert 'key' into 'hashset' as hashset_insert() does.  When
+ *    'memory_used' is not NULL, add to it the number of bytes the
+ *    hash-set grew.
+ */
+static int
+uniqDistinctHashSetInsert(
+    HashSet            *set_ptr,
+    const uint8_t      *key_ptr,
+    uint64_t           *memory_used)
+{
+    uint64_t before;
+    int rv;
+
+    if (NULL == memory_used) {
+        return hashset_insert(set_ptr, key_ptr);
+    }
+    /* the table may also shrink as it finishes growing; unsigned
+     * arithmetic makes the sum correct in either case */
+    before = hashlib_count_bytes(set_ptr->table);
+    rv = hashset_insert(set_ptr, key_ptr);
+    *memory_used += hashlib_count_bytes(set_ptr->table) - before;
+    return rv;
+}
+
+
+/*
+ *  status = uniqDistinctShortListToHashSet(dist, memory_used);
  *
  *    Convert the distinct count at 'dist' from using a short-list to
- *    count entries to the hash-set.  Return 0 on success, or -1 if
- *    there is a memory allocation failure.
+ *    count entries to the hash-set.  When 'memory_used' is not NULL,
+ *    adjust it by the change in memory.  Return 0 on success, or -1
+ *    if there is a memory allocation failure.
  */
 static int
 uniqDistinctShortListToHashSet(
-    distinct_value_t   *dist)
+    distinct_value_t   *dist,
+    uint64_t           *memory_used)
 {
     HashSet *hashset = NULL;
     uint32_t i;
@@ -2265,6 +2585,10 @@ uniqDistinctShortListToHashSet(
     skShortListDestroy(&dist->dv_v.dv_shortlist);
     dist->dv_v.dv_hashset = hashset;
     dist->dv_type = DISTINCT_HASHSET;
+    if (memory_used) {
+        *memory_used += (hashlib_count_bytes(hashset->table)
+                         - UNIQ_SHORTLIST_BYTES(dist->dv_octets));
+    }
     return 0;
 
   ERROR:
@@ -2274,63 +2598,120 @@ uniqDistinctShortListToHashSet(
 
 
 /*
- *  status = uniqDistinctIncrement(uniq_fields, distincts, key);
+ *  status = uniqDistinctShortListToSketch(dist, bits, memory_used);
  *
- *    Increment the distinct counters given 'key'.  Return 0 on
- *    success or -1 on memory allocation failure.
+ *    Convert the distinct count at 'dist' from using a short-list to
+ *    count entries to a sketch having 2^'bits' registers.  When
+ *    'memory_used' is not NULL, adjust it by the change in memory.
+ *    Return 0 on success, or -1 if there is a memory allocation
+ *    failure.
  */
 static int
-uniqDistinctIncrement(
+uniqDistinctShortListToSketch(
+    distinct_value_t   *dist,
+    uint8_t             bits,
+    uint64_t           *memory_used)
+{
+    uniq_sketch_t *sketch;
+    uint32_t i;
+
+    assert(DISTINCT_SHORTLIST == dist->dv_type);
+
+    sketch = uniqSketchCreate(bits);
+    if (NULL == sketch) {
+        TRACEMSG(("%s:%d: Error allocating sketch", __FILE__, __LINE__));
+        return -1;
+    }
+    for (i = skShortListCountEntries(dist->dv_v.dv_shortlist); i > 0; ) {
+        --i;
+        uniqSketchAdd(
+            sketch, bits,
+            (uint8_t*)skShortListGetElement(dist->dv_v.dv_shortlist, i),
+            dist->dv_octets);
+    }
+
+    skShortListDestroy(&dist->dv_v.dv_shortlist);
+    dist->dv_v.dv_sketch = sketch;
+    dist->dv_type = DISTINCT_SKETCH;
+    dist->dv_count = (UNIQ_SKETCH_FLAG
+                      | uniqSketchEstimate(sketch->sk_sum, sketch->sk_zeros,
+                                           bits));
+    if (memory_used) {
+        *memory_used += (UNIQ_SKETCH_BYTES(bits)
+                         - UNIQ_SHORTLIST_BYTES(dist->dv_octets));
+    }
+    return 0;
+}
+
+
+/*
+ *  uniqDistinctSketchInsert(dist, bits, value);
+ *
+ *    Add 'value' to the sketch at 'dist', which has 2^'bits'
+ *    registers, and update the estimate in the 'dv_count' member of
+ *    'dist' when the sketch changes.
+ */
+static void
+uniqDistinctSketchInsert(
+    distinct_value_t   *dist,
+    uint8_t             bits,
+    const uint8_t      *value)
+{
+    uniq_sketch_t *sketch = dist->dv_v.dv_sketch;
+
+    assert(DISTINCT_SKETCH == dist->dv_type);
+    if (uniqSketchAdd(sketch, bits, value, dist->dv_octets)) {
+        dist->dv_count = (UNIQ_SKETCH_FLAG
+                          | uniqSketchEstimate(sketch->sk_sum,
+                                               sketch->sk_zeros, bits));
+    }
+}
+
+
+/*
+ *  status = uniqDistinctInsert(field_info, dist, value, memory_used);
+ *
+ *    Add 'value' to the distinct counter 'dist'.  When 'memory_used'
+ *    is not NULL, add to it the number of bytes the counter grew.
+ *    Return 0 on success or -1 on memory allocation failure.
+ */
+static int
+uniqDistinctInsert(
     const sk_uniq_field_info_t *field_info,
-    distinct_value_t           *distincts,
-    const uint8_t              *key)
+    distinct_value_t           *dist,
+    const uint8_t              *value,
+    uint64_t                   *memory_used)
 {
-    distinct_value_t *dist;
-    uint8_t i;
     int rv;
 
-    for (i = 0; i < field_info->distinct_num_fields; ++i) {
-        dist = &distincts[i];
-        switch (dist->dv_type) {
-          case DISTINCT_BITMAP:
-            skBitmapSetBit(dist->dv_v.dv_bitmap,
-                           *(uint8_t*)DISTINCT_PTR(key, distincts, i));
-            dist->dv_count = skBitmapGetHighCount(dist->dv_v.dv_bitmap);
+    switch (dist->dv_type) {
+      case DISTINCT_BITMAP:
+        skBitmapSetBit(dist->dv_v.dv_bitmap, *value);
+        dist->dv_count = skBitmapGetHighCount(dist->dv_v.dv_bitmap);
+        break;
+      case DISTINCT_SHORTLIST:
+        rv = skShortListInsert(dist->dv_v.dv_shortlist, (void*)value);
+        switch (rv) {
+          case SK_SHORT_LIST_OK:
+            ++dist->dv_count;
             break;
-          case DISTINCT_SHORTLIST:
-            rv = skShortListInsert(dist->dv_v.dv_shortlist,
-                                   (void*)DISTINCT_PTR(key,distincts,i));
-            switch (rv) {
-              case SK_SHORT_LIST_OK:
-                ++dist->dv_count;
-                break;
-              case SK_SHORT_LIST_OK_DUPLICATE:
-                break;
-              case SK_SHORT_LIST_ERR_FULL:
-                if (uniqDistinctShortListToHashSet(dist)) {
-                    return -1;
-                }
-                rv = hashset_insert(dist->dv_v.dv_hashset,
-                                    DISTINCT_PTR(key,distincts,i));
-                switch (rv) {
-                  case OK:
-                    ++dist->dv_count;
-                    break;
-                  case OK_DUPLICATE:
-                    break;
-                  default:
-                    TRACEMSG(("%s:%d: Error inserting value into hashset",
-                              __FILE__, __LINE__));
+          case SK_SHORT_LIST_OK_DUPLICATE:
+            break;
+          case SK_SHORT_LIST_ERR_FULL:
+            if (field_info->sketch_bits) {
+                if (uniqDistinctShortListToSketch(
+                        dist, field_info->sketch_bits, memory_used))
+                {
                     return -1;
                 }
+                uniqDistinctSketchInsert(dist, field_info->sketch_bits, value);
                 break;
-              default:
-                skAbortBadCase(rv);
             }
-            break;
-          case DISTINCT_HASHSET:
-            rv = hashset_insert(dist->dv_v.dv_hashset,
-                                DISTINCT_PTR(key, distincts, i));
+            if (uniqDistinctShortListToHashSet(dist, memory_used)) {
+                return -1;
+            }
+            rv = uniqDistinctHashSetInsert(dist->dv_v.dv_hashset, value,
+                                           memory_used);
             switch (rv) {
               case OK:
                 ++dist->dv_count;
@@ -2343,9 +2724,106 @@ uniqDistinctIncrement(
                 return -1;
             }
             break;
+          default:
+            skAbortBadCase(rv);
+        }
+        break;
+      case DISTINCT_HASHSET:
+        rv = uniqDistinctHashSetInsert(dist->dv_v.dv_hashset, value,
+                                       memory_used);
+        switch (rv) {
+          case OK:
+            ++dist->dv_count;
+            break;
+          case OK_DUPLICATE:
+            break;
+          default:
+            TRACEMSG(("%s:%d: Error inserting value into hashset",
+                      __FILE__, __LINE__));
+            return -1;
+        }
+        break;
+      case DISTINCT_SKETCH:
+        uniqDistinctSketchInsert(dist, field_info->sketch_bits, value);
+        break;
+    }
+
+    return 0;
+}
+
+
+/*
+ *  status = uniqDistinctIncrement(uniq_fields, distincts, key, memory_used);
+ *
+ *    Increment the distinct counters given 'key'.  When 'memory_used'
+ *    is not NULL, add to it the number of bytes the counters grew.
+ *    Return 0 on success or -1 on memory allocation failure.
+ */
+static int
+uniqDistinctIncrement(
+    const sk_uniq_field_info_t *field_info,
+    distinct_value_t           *distincts,
+    const uint8_t              *key,
+    uint64_t                   *memory_used)
+{
+    uint8_t i;
+
+    for (i = 0; i < field_info->distinct_num_fields; ++i) {
+        if (uniqDistinctInsert(field_info, &distincts[i],
+                               DISTINCT_PTR(key, distincts, i), memory_used))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ *  status = uniqDistinctMergeRegisters(field_info, dist, registers,
+ *                                      memory_used);
+ *
+ *    Merge the sketch registers in 'registers' into the distinct
+ *    counter 'dist', converting 'dist' to a sketch if it is counting
+ *    exactly.  When 'memory_used' is not NULL, add to it the number
+ *    of bytes the counter grew.  Return 0 on success or -1 on memory
+ *    allocation failure.
+ */
+static int
+uniqDistinctMergeRegisters(
+    const sk_uniq_field_info_t *field_info,
+    distinct_value_t           *dist,
+    const uint8_t              *registers,
+    uint64_t                   *memory_used)
+{
+    const uint8_t bits = field_info->sketch_bits;
+    uniq_sketch_t *sketch;
+    size_t r;
+
+    assert(bits);
+    if (DISTINCT_SHORTLIST == dist->dv_type) {
+        if (uniqDistinctShortListToSketch(dist, bits, memory_used)) {
+            return -1;
         }
     }
+    assert(DISTINCT_SKETCH == dist->dv_type);
 
+    sketch = dist->dv_v.dv_sketch;
+    for (r = 0; r < UNIQ_SKETCH_REGISTERS(bits); ++r) {
+        if (registers[r] > sketch->sk_reg[r]) {
+            if (0 == sketch->sk_reg[r]) {
+                --sketch->sk_zeros;
+            }
+            sketch->sk_sum
+                += (1.0 / (double)(UINT64_C(1) << registers[r])
+                    - 1.0 / (double)(UINT64_C(1) << sketch->sk_reg[r]));
+            sketch->sk_reg[r] = registers[r];
+        }
+    }
+    dist->dv_count = (UNIQ_SKETCH_FLAG
+                      | uniqSketchEstimate(sketch->sk_sum, sketch->sk_zeros,
+                                           bits));
     return 0;
 }
 
@@ -2363,14 +2841,16 @@ uniqDistinctSetOutputBuf(
     uint8_t                    *out_buf)
 {
     const distinct_value_t *dist;
+    uint64_t count;
     uint8_t i;
 
     for (i = 0; i < field_info->distinct_num_fields; ++i) {
         dist = &distincts[i];
+        count = dist->dv_count & ~UNIQ_SKETCH_FLAG;
         switch (dist->dv_octets) {
           case 1:
             *((uint8_t*)DISTINCT_PTR(out_buf, distincts, i))
-                = (uint8_t)(dist->dv_count);
+                = (uint8_t)(count);
             break;
 
           case 3:
@@ -2382,7 +2862,7 @@ uniqDistinctSetOutputBuf(
                     uint64_t  u64;
                     uint8_t   ar[8];
                 } array_uint64;
-                array_uint64.u64 = dist->dv_count;
+                array_uint64.u64 = count;
 #if SK_BIG_ENDIAN
                 memcpy(DISTINCT_PTR(out_buf, distincts, i),
                        &array_uint64.ar[8-dist->dv_octets], dist->dv_octets);
@@ -2396,42 +2876,42 @@ uniqDistinctSetOutputBuf(
 #if !SKUNIQ_USE_MEMCPY
           case 2:
             *((uint16_t*)DISTINCT_PTR(out_buf, distincts, i))
-                = (uint16_t)(dist->dv_count);
+                = (uint16_t)(count);
             break;
           case 4:
             *((uint32_t*)DISTINCT_PTR(out_buf, distincts, i))
-                = (uint32_t)(dist->dv_count);
+                = (uint32_t)(count);
             break;
           case 8:
             *((uint64_t*)DISTINCT_PTR(out_buf, distincts, i))
-                = dist->dv_count;
+                = count;
             break;
           default:
             *((uint64_t*)DISTINCT_PTR(out_buf, distincts, i))
-                = dist->dv_count;
+                = count;
             break;
 #else  /* SKUNIQ_USE_MEMCPY */
           case 2:
             {
-                uint16_t val16 = (uint16_t)(dist->dv_count);
+                uint16_t val16 = (uint16_t)(count);
                 memcpy(DISTINCT_PTR(out_buf, distincts, i),
                        &val16, sizeof(val16));
             }
             break;
           case 4:
             {
-                uint32_t val32 = (uint32_t)(dist->dv_count);
+                uint32_t val32 = (uint32_t)(count);
                 memcpy(DISTINCT_PTR(out_buf, distincts, i),
                        &val32, sizeof(val32));
             }
             break;
           case 8:
             memcpy(DISTINCT_PTR(out_buf, distincts, i),
-                   &dist->dv_count, sizeof(uint64_t));
+                   &count, sizeof(uint64_t));
             break;
           default:
             memcpy(DISTINCT_PTR(out_buf, distincts, i),
-                   &dist->dv_count, sizeof(uint64_t));
+                   &count, sizeof(uint64_t));
             break;
 #endif  /* #else of #if !SKUNIQ_USE_MEMCPY */
         }
@@ -2474,16 +2954,31 @@ uniqDistinctReset(
                 return -1;
             }
             break;
-        }
-        dist->dv_count = 0;
-    }
-    return 0;
-}
-
-
-/* **************************************************************** */
-
-/*    SKUNIQUE INTERNAL WRAPPERS FOR OPEN, READ AND WRITE OF TEMP FILES */
+          case DISTINCT_SKETCH:
+            /* return to counting exactly */
+            free(dist->dv_v.dv_sketch);
+            dist->dv_v.dv_sketch = NULL;
+            dist->dv_type = DISTINCT_SHORTLIST;
+            if (skShortListCreate(
+                    &dist->dv_v.dv_shortlist, dist->dv_octets,
+                    uniqDistinctShortlistCmp, (void*)&dist->dv_octets))
+            {
+                TRACEMSG(("%s:%d: Error allocating short list",
+                          __FILE__, __LINE__));
+                dist->dv_v.dv_shortlist = NULL;
+                return -1;
+            }
+            break;
+        }
+        dist->dv_count = 0;
+    }
+    return 0;
+}
+
+
+/* **************************************************************** */
+
+/*    SKUNIQUE INTERNAL WRAPPERS FOR OPEN, READ AND WRITE OF TEMP FILES */
 
 /* **************************************************************** */
 
@@ -2675,6 +3170,10 @@ uniqTempWriteHelper(
  *      for each distinct field:
  *          number of distinct values
  *          distinct value 1, distinct value 2, ...
+ *
+ *    When the distinct field is a sketch, the number of distinct
+ *    values is the estimate with UNIQ_SKETCH_FLAG set, and the
+ *    registers of the sketch replace the distinct values.
  */
 static int
 uniqTempWriteTriple(
@@ -2749,10 +3248,109 @@ uniqTempWriteTriple(
                 uniqTempWrite(dist_fp, hash_key, dist->dv_octets);
             }
             break;
+
+          case DISTINCT_SKETCH:
+            assert(dist->dv_count & UNIQ_SKETCH_FLAG);
+            uniqTempWrite(dist_fp, dist->dv_v.dv_sketch->sk_reg,
+                          UNIQ_SKETCH_REGISTERS(field_info->sketch_bits));
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ *  status = uniqDistinctMergeSketches(field_info, dist, fps, file_ids,
+ *                                     file_ids_len, num_distinct,
+ *                                     registers, err_fn);
+ *
+ *    Merge the distinct field 'dist' of a single key from several
+ *    temporary files when at least one of the files holds a sketch
+ *    for the field.
+ *
+ *    'file_ids' is an array of 'file_ids_len' indexes into 'fps';
+ *    the distinct file paired with fps[idx] is fps[idx + 1], and the
+ *    distinct count that was read from fps[idx] is num_distinct[idx].
+ *    The registers of the sketches are combined and the exact values
+ *    are added to the result in 'registers', a buffer large enough to
+ *    hold the registers of one sketch.  Set the 'dv_count' member of
+ *    'dist' to the estimate with UNIQ_SKETCH_FLAG set.
+ *
+ *    Return 0 on success, or -1 on read error after reporting the
+ *    error with 'err_fn'.
+ */
+static int
+uniqDistinctMergeSketches(
+    const sk_uniq_field_info_t *field_info,
+    distinct_value_t           *dist,
+    skstream_t                 *fps[],
+    const uint16_t              file_ids[],
+    uint16_t                    file_ids_len,
+    const uint64_t              num_distinct[],
+    uint8_t                    *registers,
+    sk_msg_fn_t                 err_fn)
+{
+    const size_t num_registers
+        = UNIQ_SKETCH_REGISTERS(field_info->sketch_bits);
+    uint8_t buf[4096];
+    uint64_t count;
+    uint32_t idx;
+    size_t len;
+    size_t k;
+    size_t r;
+    uint16_t fps_index;
+    uint16_t j;
+    uint8_t rank;
+    int last_errno;
+
+    memset(registers, 0, num_registers);
+
+    for (j = 0; j < file_ids_len; ++j) {
+        fps_index = file_ids[j];
+        count = num_distinct[fps_index];
+        if (count & UNIQ_SKETCH_FLAG) {
+            /* keep the larger of each pair of registers */
+            for (k = 0; k < num_registers; k += len) {
+                len = num_registers - k;
+                if (len > sizeof(buf)) {
+                    len = sizeof(buf);
+                }
+                if (!uniqTempRead(fps[fps_index + 1], buf, len)) {
+                    goto READ_ERROR;
+                }
+                for (r = 0; r < len; ++r) {
+                    if (buf[r] > registers[k + r]) {
+                        registers[k + r] = buf[r];
+                    }
+                }
+            }
+        } else {
+            /* add each exact value */
+            for ( ; count > 0; --count) {
+                if (!uniqTempRead(fps[fps_index + 1], buf, dist->dv_octets)) {
+                    goto READ_ERROR;
+                }
+                uniqSketchPosition(buf, dist->dv_octets,
+                                   field_info->sketch_bits, &idx, &rank);
+                if (rank > registers[idx]) {
+                    registers[idx] = rank;
+                }
+            }
         }
     }
 
+    dist->dv_count = (UNIQ_SKETCH_FLAG
+                      | uniqSketchEstimateRegisters(registers,
+                                                    field_info->sketch_bits));
     return 0;
+
+  READ_ERROR:
+    last_errno = skStreamGetLastErrno(fps[fps_index + 1]);
+    err_fn("Cannot read distinct values from temporary file: %s",
+           (last_errno ? strerror(last_errno) : "EOF"));
+    return -1;
 }
 
 
@@ -2762,6 +3360,10 @@ uniqTempWriteTriple(
 
 /* **************************************************************** */
 
+/* a partition of the keys when aggregating with threads; see
+ * skUniqueSetThreads() */
+typedef struct uniq_part_st uniq_part_t;
+
 /* structure for binning records */
 
 /* typedef struct sk_unique_st sk_unique_t; */
@@ -2799,6 +3401,35 @@ struct sk_unique_st {
 
     uint32_t                hash_value_octets;
 
+    /* number of entries to allocate when creating the hash table */
+    uint32_t                hash_initial_size;
+
+    /* number of threads requested by skUniqueSetThreads() */
+    uint32_t                thread_count;
+
+    /* the limit given to skUniqueSetMemoryLimit(), or 0 for none */
+    uint64_t                memory_limit;
+
+    /* the bytes used by the structures that count distinct values
+     * for the keys in the current hash table */
+    uint64_t                distinct_bytes;
+
+    /* the most bytes used by the hash table and distinct counts */
+    uint64_t                peak_memory;
+
+    /* the number of records the bins summarize: those given to
+     * skUniqueAddRecord() and those in the files given to
+     * skUniqueAddPartial() */
+    uint64_t                record_count;
+
+    /* the precision given to skUniqueSetDistinctApprox(), or 0 */
+    uint8_t                 distinct_approx;
+
+    /* when 'thread_count' is greater than 1, the array of
+     * 'thread_count' partitions that aggregate the records; NULL
+     * otherwise */
+    uniq_part_t            *parts;
+
     /* whether the output should be sorted */
     unsigned                sort_output :1;
 
@@ -2823,20 +3454,41 @@ uniqueCreateHashTable(
 {
     uint8_t no_val[HASHLIB_MAX_VALUE_WIDTH];
 
+    uint32_t estimate = uniq->hash_initial_size;
+    uint64_t table_bytes;
+
     memset(no_val, 0, sizeof(no_val));
 
-    uniq->ht = hashlib_create_table(uniq->fi.key_octets,
-                                    uniq->hash_value_octets,
-                                    HTT_INPLACE,
-                                    no_val,
-                                    NULL,
-                                    0,
-                                    HASH_INITIAL_SIZE,
-                                    DEFAULT_LOAD_FACTOR);
-    if (NULL == uniq->ht) {
-        uniq->err_fn("Error allocating hash table");
-        return -1;
+    for (;;) {
+        uniq->ht = hashlib_create_table(uniq->fi.key_octets,
+                                        uniq->hash_value_octets,
+                                        HTT_INPLACE,
+                                        no_val,
+                                        NULL,
+                                        0,
+                                        estimate,
+                                        DEFAULT_LOAD_FACTOR);
+        if (NULL == uniq->ht) {
+            uniq->err_fn("Error allocating hash table");
+            return -1;
+        }
+        if (0 == uniq->memory_limit) {
+            return 0;
+        }
+        /* with a memory limit, start the table at no more than a
+         * quarter of the limit so it has room to grow */
+        table_bytes = hashlib_count_bytes(uniq->ht);
+        if (table_bytes <= uniq->memory_limit / 4 || estimate < 2) {
+            break;
+        }
+        hashlib_free_table(uniq->ht);
+        estimate = (uint32_t)((double)estimate * (uniq->memory_limit / 4)
+                              / table_bytes);
+        if (estimate < 1) {
+            estimate = 1;
+        }
     }
+    hashlib_set_memory_limit(uniq->ht, uniq->memory_limit);
     return 0;
 }
 
@@ -2858,6 +3510,7 @@ uniqueDestroyHashTable(
     if (NULL == uniq->ht) {
         return;
     }
+    uniq->distinct_bytes = 0;
     if (0 == uniq->fi.distinct_num_fields) {
         hashlib_free_table(uniq->ht);
         uniq->ht = NULL;
@@ -2992,6 +3645,437 @@ uniqueDumpHashToTemp(
 }
 
 
+/*
+ *  status = uniqueCheckMemory(uniq);
+ *
+ *    Update the peak memory used by 'uniq'.  If the hash table and
+ *    the distinct counts use more than the memory limit, write the
+ *    entries to a temporary file and create a new hash table.  Return
+ *    0 on success, or -1 on failure.
+ */
+static int
+uniqueCheckMemory(
+    sk_unique_t        *uniq)
+{
+    uint64_t used;
+
+    if (0 == uniq->memory_limit && !uniq->print_debug) {
+        return 0;
+    }
+    used = hashlib_count_bytes(uniq->ht) + uniq->distinct_bytes;
+    if (used > uniq->peak_memory) {
+        uniq->peak_memory = used;
+    }
+    if (0 == uniq->memory_limit) {
+        return 0;
+    }
+    if (used <= uniq->memory_limit) {
+        /* the table may grow into the memory the distinct counts do
+         * not use */
+        hashlib_set_memory_limit(uniq->ht, (uniq->memory_limit
+                                            - uniq->distinct_bytes));
+        return 0;
+    }
+
+    UNIQUE_DEBUG(uniq, ((SKUNIQUE_DEBUG_ENVAR ": Using %" PRIu64 " bytes;"
+                         " exceeds limit of %" PRIu64 " bytes"),
+                        used, uniq->memory_limit));
+    if (uniqueDumpHashToTemp(uniq)) {
+        return -1;
+    }
+    return uniqueCreateHashTable(uniq);
+}
+
+
+/* **************************************************************** */
+
+/*    SKUNIQUE PARALLEL AGGREGATION */
+
+/* **************************************************************** */
+
+/*
+ *    When skUniqueSetThreads() is called with more than one thread,
+ *    the sk_unique_t object given to skUniqueAddRecord() does not
+ *    aggregate records itself.  Instead, it has an array of
+ *    partitions, each of which holds a separate sk_unique_t object
+ *    and a thread that adds records to that object.
+ *    skUniqueAddRecord() computes a hash of the record's key, copies
+ *    the record into a batch for the partition that the hash selects,
+ *    and hands the batch to that partition's thread once it is full.
+ *    Each partition spills to its own temporary files when its hash
+ *    table is full.  No key appears in more than one partition, so
+ *    the partitions' results never need to be merged with each other.
+ */
+
+/* number of records in a batch handed to a partition's thread */
+#define UNIQ_PART_BATCH_RECS  2048
+
+/* number of batches per partition; the reader may fill one batch
+ * while the thread empties the others */
+#define UNIQ_PART_BATCHES  4
+
+/* typedef struct uniq_part_st uniq_part_t; */
+struct uniq_part_st {
+    /* the object that aggregates the keys in this partition */
+    sk_unique_t        *uniq;
+
+    /* the ring of batches of records, and the number of records in
+     * each batch */
+    rwRec              *batch[UNIQ_PART_BATCHES];
+    size_t              batch_count[UNIQ_PART_BATCHES];
+
+    /* the thread that adds the records in the batches to 'uniq' */
+    pthread_t           thread;
+
+    /* protects the members below */
+    pthread_mutex_t     mutex;
+
+    /* signaled when a batch is filled or the input ends */
+    pthread_cond_t      filled_cond;
+
+    /* signaled when the thread empties a batch */
+    pthread_cond_t      emptied_cond;
+
+    /* the batch that skUniqueAddRecord() is filling, the next batch
+     * for the thread to empty, and the number of filled batches */
+    unsigned            fill_idx;
+    unsigned            drain_idx;
+    unsigned            filled;
+
+    /* whether all records have been added */
+    unsigned            end_of_input :1;
+
+    /* whether the thread failed to add a record or to prepare 'uniq'
+     * for output */
+    unsigned            error        :1;
+
+    /* whether the thread was started */
+    unsigned            started      :1;
+};
+
+
+/*
+ *  part_idx = uniqPartitionForKey(key, key_octets, part_count);
+ *
+ *    Return the partition in the range [0, part_count) for the
+ *    binary key 'key' of length 'key_octets'.
+ */
+static uint32_t
+uniqPartitionForKey(
+    const uint8_t      *key,
+    size_t              key_octets,
+    uint32_t            part_count)
+{
+    /* FNV-1a; the upper 32 bits are scaled to the partition count */
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+    size_t i;
+
+    for (i = 0; i < key_octets; ++i) {
+        h ^= key[i];
+        h *= UINT64_C(0x100000001b3);
+    }
+    return (uint32_t)(((h >> 32) * part_count) >> 32);
+}
+
+
+/*
+ *  NULL = uniqPartitionThread(v_part);
+ *
+ *    THREAD ENTRY POINT
+ *
+ *    Add the records in each filled batch of the partition 'v_part'
+ *    to the partition's unique object.  Once the input ends, prepare
+ *    the unique object for output, which sorts or writes its hash
+ *    table in parallel with the other partitions.
+ */
+static void *
+uniqPartitionThread(
+    void               *v_part)
+{
+    uniq_part_t *part = (uniq_part_t*)v_part;
+    const rwRec *rec;
+    size_t count;
+    size_t i;
+
+    pthread_mutex_lock(&part->mutex);
+    for (;;) {
+        while (0 == part->filled && !part->end_of_input) {
+            pthread_cond_wait(&part->filled_cond, &part->mutex);
+        }
+        if (0 == part->filled) {
+            break;
+        }
+        rec = part->batch[part->drain_idx];
+        count = part->batch_count[part->drain_idx];
+        pthread_mutex_unlock(&part->mutex);
+
+        /* the reader does not touch a filled batch, so the records
+         * may be added without holding the mutex */
+        if (!part->error) {
+            for (i = 0; i < count; ++i) {
+                if (skUniqueAddRecord(part->uniq, &rec[i])) {
+                    part->error = 1;
+                    break;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&part->mutex);
+        part->batch_count[part->drain_idx] = 0;
+        part->drain_idx = (part->drain_idx + 1) % UNIQ_PART_BATCHES;
+        --part->filled;
+        pthread_cond_signal(&part->emptied_cond);
+    }
+    pthread_mutex_unlock(&part->mutex);
+
+    if (!part->error && skUniquePrepareForOutput(part->uniq)) {
+        part->error = 1;
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  status = uniqPartitionHandOff(part);
+ *
+ *    Give the batch that the reader is filling to the thread of the
+ *    partition 'part', and wait until the next batch in the ring is
+ *    empty.  Return 0 on success, or -1 if the thread has reported an
+ *    error.
+ */
+static int
+uniqPartitionHandOff(
+    uniq_part_t        *part)
+{
+    int rv;
+
+    pthread_mutex_lock(&part->mutex);
+    ++part->filled;
+    part->fill_idx = (part->fill_idx + 1) % UNIQ_PART_BATCHES;
+    pthread_cond_signal(&part->filled_cond);
+    while (UNIQ_PART_BATCHES == part->filled) {
+        pthread_cond_wait(&part->emptied_cond, &part->mutex);
+    }
+    rv = (part->error ? -1 : 0);
+    pthread_mutex_unlock(&part->mutex);
+    return rv;
+}
+
+
+/*
+ *  uniqPartitionsStop(uniq);
+ *
+ *    Hand the partially filled batch of each partition on 'uniq' to
+ *    its thread, tell the thread that the input has ended, and wait
+ *    for each thread to exit.
+ */
+static void
+uniqPartitionsStop(
+    sk_unique_t        *uniq)
+{
+    uniq_part_t *part;
+    uint32_t p;
+
+    for (p = 0; p < uniq->thread_count; ++p) {
+        part = &uniq->parts[p];
+        if (!part->started) {
+            continue;
+        }
+        pthread_mutex_lock(&part->mutex);
+        if (part->batch_count[part->fill_idx] && !part->end_of_input) {
+            ++part->filled;
+            part->fill_idx = (part->fill_idx + 1) % UNIQ_PART_BATCHES;
+        }
+        part->end_of_input = 1;
+        pthread_cond_signal(&part->filled_cond);
+        pthread_mutex_unlock(&part->mutex);
+    }
+    for (p = 0; p < uniq->thread_count; ++p) {
+        part = &uniq->parts[p];
+        if (part->started) {
+            pthread_join(part->thread, NULL);
+            part->started = 0;
+        }
+    }
+}
+
+
+/*
+ *  uniqPartitionsDestroy(uniq);
+ *
+ *    Stop the threads of the partitions on 'uniq' and destroy the
+ *    partitions and their unique objects.
+ */
+static void
+uniqPartitionsDestroy(
+    sk_unique_t        *uniq)
+{
+    uniq_part_t *part;
+    uint32_t p;
+    unsigned i;
+
+    if (NULL == uniq->parts) {
+        return;
+    }
+    uniqPartitionsStop(uniq);
+
+    for (p = 0; p < uniq->thread_count; ++p) {
+        part = &uniq->parts[p];
+        skUniqueDestroy(&part->uniq);
+        for (i = 0; i < UNIQ_PART_BATCHES; ++i) {
+            free(part->batch[i]);
+        }
+        pthread_mutex_destroy(&part->mutex);
+        pthread_cond_destroy(&part->filled_cond);
+        pthread_cond_destroy(&part->emptied_cond);
+    }
+    free(uniq->parts);
+    uniq->parts = NULL;
+}
+
+
+/*
+ *  status = uniqPartitionsCreate(uniq);
+ *
+ *    Create a partition for each thread requested on 'uniq', create
+ *    and prepare the unique object of each partition using the
+ *    settings on 'uniq', and start the threads.  Return 0 on success,
+ *    or -1 on failure.
+ */
+static int
+uniqPartitionsCreate(
+    sk_unique_t        *uniq)
+{
+    uniq_part_t *part;
+    uint32_t p;
+    unsigned i;
+
+    uniq->parts = (uniq_part_t*)calloc(uniq->thread_count,
+                                       sizeof(uniq_part_t));
+    if (NULL == uniq->parts) {
+        uniq->err_fn("Error allocating partitions for threads");
+        return -1;
+    }
+    for (p = 0; p < uniq->thread_count; ++p) {
+        part = &uniq->parts[p];
+        pthread_mutex_init(&part->mutex, NULL);
+        pthread_cond_init(&part->filled_cond, NULL);
+        pthread_cond_init(&part->emptied_cond, NULL);
+    }
+
+    for (p = 0; p < uniq->thread_count; ++p) {
+        part = &uniq->parts[p];
+        for (i = 0; i < UNIQ_PART_BATCHES; ++i) {
+            part->batch[i] = (rwRec*)malloc(UNIQ_PART_BATCH_RECS
+                                            * sizeof(rwRec));
+            if (NULL == part->batch[i]) {
+                uniq->err_fn("Error allocating record buffers for threads");
+                goto ERROR;
+            }
+        }
+        if (skUniqueCreate(&part->uniq)) {
+            uniq->err_fn("Error allocating unique object for thread");
+            goto ERROR;
+        }
+        /* the partitions share the memory a single table would use,
+         * so that N threads do not use N times as much memory */
+        part->uniq->hash_initial_size
+            = HASH_INITIAL_SIZE / uniq->thread_count;
+        part->uniq->memory_limit
+            = (uniq->memory_limit ? uniq->memory_limit
+               : HASH_DEFAULT_MEMORY_LIMIT) / uniq->thread_count;
+        part->uniq->distinct_approx = uniq->distinct_approx;
+        skUniqueSetErrorFunction(part->uniq, uniq->err_fn);
+        skUniqueSetTempDirectory(part->uniq, uniq->temp_dir);
+        if (uniq->sort_output) {
+            skUniqueSetSortedOutput(part->uniq);
+        }
+        if (skUniqueSetFields(part->uniq, uniq->fi.key_fields,
+                              uniq->fi.distinct_fields,
+                              uniq->fi.value_fields)
+            || skUniquePrepareForInput(part->uniq))
+        {
+            goto ERROR;
+        }
+        errno = pthread_create(&part->thread, NULL,
+                               uniqPartitionThread, part);
+        if (errno) {
+            uniq->err_fn("Error starting thread: %s", strerror(errno));
+            goto ERROR;
+        }
+        part->started = 1;
+    }
+
+    UNIQUE_DEBUG(uniq, ((SKUNIQUE_DEBUG_ENVAR
+                         ": Aggregating with %" PRIu32 " threads"),
+                        uniq->thread_count));
+    return 0;
+
+  ERROR:
+    uniqPartitionsDestroy(uniq);
+    return -1;
+}
+
+
+/*
+ *  status = uniqPartitionsAddRecord(uniq, rwrec);
+ *
+ *    Implementation of skUniqueAddRecord() when using threads.  Copy
+ *    'rwrec' into the batch of the partition that its key selects.
+ *    Return 0 on success, or -1 if the partition's thread has
+ *    reported an error.
+ */
+static int
+uniqPartitionsAddRecord(
+    sk_unique_t        *uniq,
+    const rwRec        *rwrec)
+{
+    uint8_t key[HASHLIB_MAX_KEY_WIDTH];
+    uniq_part_t *part;
+    size_t *count;
+
+    skFieldListRecToBinary(uniq->fi.key_fields, rwrec, key);
+    part = &uniq->parts[uniqPartitionForKey(key, uniq->fi.key_octets,
+                                            uniq->thread_count)];
+
+    count = &part->batch_count[part->fill_idx];
+    RWREC_COPY(&part->batch[part->fill_idx][*count], rwrec);
+    if (++*count == UNIQ_PART_BATCH_RECS) {
+        return uniqPartitionHandOff(part);
+    }
+    return 0;
+}
+
+
+/*
+ *  status = uniqPartitionsPrepareForOutput(uniq);
+ *
+ *    Implementation of skUniquePrepareForOutput() when using threads.
+ *    Wait for each partition's thread to add its remaining records
+ *    and prepare its unique object for output.  Return 0 on success,
+ *    or -1 if any thread reported an error.
+ */
+static int
+uniqPartitionsPrepareForOutput(
+    sk_unique_t        *uniq)
+{
+    uint32_t p;
+    int rv = 0;
+
+    uniqPartitionsStop(uniq);
+    for (p = 0; p < uniq->thread_count; ++p) {
+        if (uniq->parts[p].error) {
+            rv = -1;
+        }
+        /* the partitions may peak at different times, so this is an
+         * upper bound */
+        uniq->peak_memory += uniq->parts[p].uniq->peak_memory;
+    }
+    return rv;
+}
+
+
 /*  create a new unique object */
 int
 skUniqueCreate(
@@ -3009,6 +4093,7 @@ skUniqueCreate(
 
     u->temp_idx = -1;
     u->max_temp_idx = -1;
+    u->hash_initial_size = HASH_INITIAL_SIZE;
     u->err_fn = &skMsgNone;
 
     env_value = getenv(SKUNIQUE_DEBUG_ENVAR);
@@ -3036,6 +4121,7 @@ skUniqueDestroy(
     u = *uniq;
     *uniq = NULL;
 
+    uniqPartitionsDestroy(u);
     if (u->temp_fp) {
         uniqTempClose(u->temp_fp);
         u->temp_fp = NULL;
@@ -3074,8 +4160,124 @@ skUniqueSetSortedOutput(
 }
 
 
-/*  specify the temporary directory. */
-void
+/*  specify the number of threads to use for aggregating */
+int
+skUniqueSetThreads(
+    sk_unique_t        *uniq,
+    uint32_t            thread_count)
+{
+    assert(uniq);
+
+    if (uniq->ready_for_input) {
+        uniq->err_fn("May not call skUniqueSetThreads"
+                     " after calling skUniquePrepareForInput");
+        return -1;
+    }
+    if (thread_count > SK_UNIQUE_THREADS_MAX) {
+        uniq->err_fn("Thread count %" PRIu32 " exceeds maximum of %d",
+                     thread_count, SK_UNIQUE_THREADS_MAX);
+        return -1;
+    }
+    uniq->thread_count = thread_count;
+    return 0;
+}
+
+
+/*  specify the memory limit. */
+int
+skUniqueSetMemoryLimit(
+    sk_unique_t        *uniq,
+    uint64_t            max_bytes)
+{
+    assert(uniq);
+
+    if (uniq->ready_for_input) {
+        uniq->err_fn("May not call skUniqueSetMemoryLimit"
+                     " after calling skUniquePrepareForInput");
+        return -1;
+    }
+    if (max_bytes && max_bytes < SK_UNIQUE_MEMORY_LIMIT_MIN) {
+        uniq->err_fn(("Memory limit %" PRIu64 " is less than minimum of %d"),
+                     max_bytes, SK_UNIQUE_MEMORY_LIMIT_MIN);
+        return -1;
+    }
+    uniq->memory_limit = max_bytes;
+    return 0;
+}
+
+
+/*  return the peak memory used by the unique object */
+uint64_t
+skUniqueGetPeakMemory(
+    const sk_unique_t  *uniq)
+{
+    assert(uniq);
+
+    if (!uniq->ready_for_output) {
+        return 0;
+    }
+    return uniq->peak_memory;
+}
+
+
+/*  specify that distinct counts are estimated. */
+int
+skUniqueSetDistinctApprox(
+    sk_unique_t        *uniq,
+    unsigned int        precision)
+{
+    assert(uniq);
+
+    if (uniq->ready_for_input) {
+        uniq->err_fn("May not call skUniqueSetDistinctApprox"
+                     " after calling skUniquePrepareForInput");
+        return -1;
+    }
+    if (precision
+        && (precision < SK_UNIQUE_DISTINCT_APPROX_MIN
+            || precision > SK_UNIQUE_DISTINCT_APPROX_MAX))
+    {
+        uniq->err_fn("Precision %u is not between %d and %d",
+                     precision, SK_UNIQUE_DISTINCT_APPROX_MIN,
+                     SK_UNIQUE_DISTINCT_APPROX_MAX);
+        return -1;
+    }
+    uniq->distinct_approx = (uint8_t)precision;
+    return 0;
+}
+
+
+/*  parse the method for estimating distinct counts. */
+int
+skUniqueParseDistinctApprox(
+    const char         *arg,
+    unsigned int       *precision)
+{
+    const char hll[] = "hll";
+    const char hll_p[] = "hll:p=";
+    uint32_t tmp32;
+
+    assert(arg);
+    assert(precision);
+
+    if (0 == strcmp(arg, hll)) {
+        *precision = SK_UNIQUE_DISTINCT_APPROX_DEFAULT;
+        return 0;
+    }
+    if (0 != strncmp(arg, hll_p, strlen(hll_p))
+        || skStringParseUint32(&tmp32, arg + strlen(hll_p),
+                               SK_UNIQUE_DISTINCT_APPROX_MIN,
+                               SK_UNIQUE_DISTINCT_APPROX_MAX))
+    {
+        return -1;
+    }
+    *precision = tmp32;
+    return 0;
+}
+
+
+/*  specify the temporary directory. */
+void
 skUniqueSetTempDirectory(
     sk_unique_t        *uniq,
     const char         *temp_dir)
@@ -3155,6 +4357,16 @@ skUniquePrepareForInput(
     if (uniqCheckFields(&uniq->fi, uniq->err_fn)) {
         return -1;
     }
+    uniq->fi.sketch_bits = uniq->distinct_approx;
+
+    /* when using threads, the partitions do the work */
+    if (uniq->thread_count > 1) {
+        if (uniqPartitionsCreate(uniq)) {
+            return -1;
+        }
+        uniq->ready_for_input = 1;
+        return 0;
+    }
 
     /* set sizes for the hash table */
     SAFE_SET(uniq->hash_value_octets,
@@ -3208,7 +4420,6 @@ skUniqueAddRecord(
     int rv;
 
     assert(uniq);
-    assert(uniq->ht);
     assert(rwrec);
 
     if (!uniq->ready_for_input) {
@@ -3216,6 +4427,11 @@ skUniqueAddRecord(
                      " before calling skUniquePrepareForInput");
         return -1;
     }
+    ++uniq->record_count;
+    if (uniq->parts) {
+        return uniqPartitionsAddRecord(uniq, rwrec);
+    }
+    assert(uniq->ht);
 
     for (;;) {
         skFieldListRecToBinary(uniq->fi.key_fields, rwrec, field_buf);
@@ -3232,11 +4448,15 @@ skUniqueAddRecord(
             if (uniq->fi.distinct_num_fields) {
                 skFieldListRecToBinary(uniq->fi.distinct_fields, rwrec,
                                        field_buf);
-                if (uniqDistinctAlloc(&uniq->fi, &distincts)) {
+                if (uniqDistinctAlloc(&uniq->fi, &distincts,
+                                      &uniq->distinct_bytes))
+                {
                     memory_error |= 2;
                     break;
                 }
-                if (uniqDistinctIncrement(&uniq->fi, distincts, field_buf)) {
+                if (uniqDistinctIncrement(&uniq->fi, distincts, field_buf,
+                                          &uniq->distinct_bytes))
+                {
                     memory_error |= 4;
                     break;
                 }
@@ -3244,7 +4464,7 @@ skUniqueAddRecord(
                        sizeof(void*));
             }
             skFieldListAddRecToBuffer(uniq->fi.value_fields, rwrec, hash_val);
-            return 0;
+            return uniqueCheckMemory(uniq);
 
           case OK_DUPLICATE:
             /* existing key; merge the distinct fields first, then
@@ -3254,95 +4474,622 @@ skUniqueAddRecord(
                        sizeof(void*));
                 skFieldListRecToBinary(uniq->fi.distinct_fields, rwrec,
                                        field_buf);
-                if (uniqDistinctIncrement(&uniq->fi, distincts, field_buf)) {
+                if (uniqDistinctIncrement(&uniq->fi, distincts, field_buf,
+                                          &uniq->distinct_bytes))
+                {
                     memory_error |= 8;
                     break;
                 }
             }
             skFieldListAddRecToBuffer(uniq->fi.value_fields, rwrec, hash_val);
-            return 0;
+            /* only the distinct counts may have grown */
+            return ((uniq->fi.distinct_num_fields)
+                    ? uniqueCheckMemory(uniq)
+                    : 0);
 
           case ERR_OUTOFMEMORY:
           case ERR_NOMOREBLOCKS:
             memory_error |= 1;
             break;
 
-          default:
-            uniq->err_fn("Unexpected return code '%d' from hash table insert",
-                         rv);
-            return -1;
+          default:
+            uniq->err_fn("Unexpected return code '%d' from hash table insert",
+                         rv);
+            return -1;
+        }
+
+        /* ran out of memory somewhere */
+        TRACEMSG((("%s:%d: Memory error code is %" PRIu32),
+                  __FILE__, __LINE__, memory_error));
+
+        if (memory_error > (1u << 31)) {
+            /* this is our second memory error */
+            if (OK != rv) {
+                uniq->err_fn(("Unexpected return code '%d'"
+                              " from hash table insert on new hash table"),
+                             rv);
+            } else {
+                uniq->err_fn(("Error allocating memory after writing"
+                              " hash table to temporary file"));
+            }
+            return -1;
+        }
+        memory_error |= (1u << 31);
+
+        /*
+         *  If (memory_error & 8) then there is a partially updated
+         *  distinct count.  This should not matter as long as we can
+         *  write the current values to disk and then reset
+         *  everything.  At worst, the distinct value for this key
+         *  will appear in two separate temporary files, but that
+         *  should be resolved then the distinct values from the two
+         *  files for this key are merged.
+         */
+
+        /* out of memory */
+        if (uniqueDumpHashToTemp(uniq)) {
+            return -1;
+        }
+        /* re-create the hash table */
+        if (uniqueCreateHashTable(uniq)) {
+            return -1;
+        }
+    }
+
+    return 0;                   /* NOTREACHED */
+}
+
+
+/*  get ready to return records to the caller. */
+int
+skUniquePrepareForOutput(
+    sk_unique_t        *uniq)
+{
+    if (uniq->ready_for_output) {
+        return 0;
+    }
+    if (!uniq->ready_for_input) {
+        uniq->err_fn("May not call skUniquePrepareForOutput"
+                     " before calling skUniquePrepareForInput");
+        return -1;
+    }
+
+    if (uniq->parts) {
+        if (uniqPartitionsPrepareForOutput(uniq)) {
+            return -1;
+        }
+        UNIQUE_DEBUG(uniq, ((SKUNIQUE_DEBUG_ENVAR ": Peak memory use was"
+                             " at most %" PRIu64 " bytes"),
+                            uniq->peak_memory));
+        uniq->ready_for_output = 1;
+        return 0;
+    }
+
+    UNIQUE_DEBUG(uniq, (SKUNIQUE_DEBUG_ENVAR ": Peak memory use was %" PRIu64
+                        " bytes", uniq->peak_memory));
+
+    if (uniq->temp_idx > 0) {
+        /* dump the current/final hash entries to a file */
+        if (uniqueDumpHashToTemp(uniq)) {
+            return -1;
+        }
+    } else if (uniq->sort_output) {
+        /* need to sort using the skFieldListCompareBuffers function */
+        hashlib_sort_entries_usercmp(uniq->ht,
+                                     COMP_FUNC_CAST(skFieldListCompareBuffers),
+                                     (void*)uniq->fi.key_fields);
+    }
+
+    uniq->ready_for_output = 1;
+    return 0;
+}
+
+
+/* **************************************************************** */
+
+/*    SKUNIQUE PARTIAL AGGREGATE FILES */
+
+/* **************************************************************** */
+
+/*
+ *    The version of the FT_RWAGGREGATE file that
+ *    skUniqueWritePartial() writes.
+ */
+#define UNIQ_PARTIAL_VERSION  1
+
+/*
+ *    After its SiLK header, an FT_RWAGGREGATE file holds a
+ *    uniq_partial_desc_t, then a uniq_partial_field_t for each key
+ *    field, each value field, and each distinct field, in that order,
+ *    then the entries.  An entry is written as uniqTempWriteTriple()
+ *    writes it when the distinct file is the main file:
+ *
+ *      the key_buffer
+ *      the value_buffer
+ *      for each distinct field:
+ *          number of distinct values
+ *          distinct value 1, distinct value 2, ...  (or the registers)
+ *
+ *    A key may appear in more than one entry, since the entries of
+ *    each temporary file and of each partition are copied in turn;
+ *    the entries are merged when the file is read.  All values are
+ *    in native byte order.
+ */
+typedef struct uniq_partial_desc_st {
+    /* the number of records the bins summarize */
+    uint64_t            record_count;
+    uint8_t             key_num_fields;
+    uint8_t             key_octets;
+    uint8_t             value_num_fields;
+    uint8_t             value_octets;
+    uint8_t             distinct_num_fields;
+    uint8_t             distinct_octets;
+    uint8_t             sketch_bits;
+    uint8_t             unused;
+} uniq_partial_desc_t;
+
+typedef struct uniq_partial_field_st {
+    uint32_t            id;
+    uint32_t            octets;
+} uniq_partial_field_t;
+
+
+/*
+ *  uniqPartialWriteFields(stream, fields, num_fields);
+ *
+ *    Write a uniq_partial_field_t for each of the 'num_fields' fields
+ *    in 'fields' to 'stream'.  Exit the application on write error.
+ */
+static void
+uniqPartialWriteFields(
+    skstream_t             *stream,
+    const sk_fieldlist_t   *fields,
+    uint8_t                 num_fields)
+{
+    sk_fieldlist_iterator_t fl_iter;
+    sk_fieldentry_t *field;
+    uniq_partial_field_t pf;
+
+    if (0 == num_fields) {
+        return;
+    }
+    skFieldListIteratorBind(fields, &fl_iter);
+    while (NULL != (field = skFieldListIteratorNext(&fl_iter))) {
+        pf.id = skFieldListEntryGetId(field);
+        pf.octets = skFieldListEntryGetBinOctets(field);
+        uniqTempWrite(stream, &pf, sizeof(pf));
+    }
+}
+
+
+/*
+ *  status = uniqPartialCheckFields(stream, fields, num_fields);
+ *
+ *    Read 'num_fields' uniq_partial_field_t structures from 'stream'
+ *    and compare them with the fields in 'fields'.  Return 0 if they
+ *    match, 1 if they differ, or -1 on read error.
+ */
+static int
+uniqPartialCheckFields(
+    skstream_t             *stream,
+    const sk_fieldlist_t   *fields,
+    uint8_t                 num_fields)
+{
+    sk_fieldlist_iterator_t fl_iter;
+    sk_fieldentry_t *field;
+    uniq_partial_field_t pf;
+
+    if (0 == num_fields) {
+        return 0;
+    }
+    skFieldListIteratorBind(fields, &fl_iter);
+    while (NULL != (field = skFieldListIteratorNext(&fl_iter))) {
+        if (!uniqTempRead(stream, &pf, sizeof(pf))) {
+            return -1;
+        }
+        if (pf.id != (uint32_t)skFieldListEntryGetId(field)
+            || pf.octets != skFieldListEntryGetBinOctets(field))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  status = uniqPartialCopyTemp(uniq, stream, temp_idx);
+ *
+ *    Copy the entries in the temporary file 'temp_idx' on 'uniq', and
+ *    in its distinct file when there are distinct fields, to the
+ *    partial aggregate file 'stream'.  Return 0 on success, or -1 on
+ *    failure.
+ */
+static int
+uniqPartialCopyTemp(
+    sk_unique_t        *uniq,
+    skstream_t         *stream,
+    int                 temp_idx)
+{
+    const sk_uniq_field_info_t *fi = &uniq->fi;
+    distinct_value_t *distincts = NULL;
+    skstream_t *fp;
+    skstream_t *dist_fp = NULL;
+    uint8_t buf[4096];
+    uint64_t count;
+    size_t octets;
+    size_t len;
+    uint8_t i;
+    int rv = -1;
+
+    assert(fi->key_octets <= sizeof(buf));
+    assert(fi->value_octets <= sizeof(buf));
+
+    fp = uniqTempReopen(uniq->tmpctx, temp_idx);
+    if (NULL == fp) {
+        uniq->err_fn("Error opening existing temporary file '%s': %s",
+                     skTempFileGetName(uniq->tmpctx, temp_idx),
+                     strerror(errno));
+        return -1;
+    }
+    if (fi->distinct_num_fields) {
+        dist_fp = uniqTempReopen(uniq->tmpctx, temp_idx + 1);
+        if (NULL == dist_fp) {
+            uniq->err_fn("Error opening existing temporary file '%s': %s",
+                         skTempFileGetName(uniq->tmpctx, temp_idx + 1),
+                         strerror(errno));
+            goto END;
+        }
+        if (uniqDistinctAllocMerging(fi, &distincts)) {
+            uniq->err_fn("Error allocating space for distinct counts");
+            goto END;
+        }
+    }
+
+    while (uniqTempRead(fp, buf, fi->key_octets)) {
+        uniqTempWrite(stream, buf, fi->key_octets);
+        if (fi->value_octets) {
+            if (!uniqTempRead(fp, buf, fi->value_octets)) {
+                goto READ_ERROR;
+            }
+            uniqTempWrite(stream, buf, fi->value_octets);
+        }
+        for (i = 0; i < fi->distinct_num_fields; ++i) {
+            if (!uniqTempRead(fp, &count, sizeof(uint64_t))) {
+                goto READ_ERROR;
+            }
+            uniqTempWrite(stream, &count, sizeof(uint64_t));
+            for (octets = UNIQ_DISTINCT_DATA_OCTETS(fi, &distincts[i], count);
+                 octets > 0;
+                 octets -= len)
+            {
+                len = ((octets < sizeof(buf)) ? octets : sizeof(buf));
+                if (!uniqTempRead(dist_fp, buf, len)) {
+                    goto READ_ERROR;
+                }
+                uniqTempWrite(stream, buf, len);
+            }
+        }
+    }
+    rv = 0;
+    goto END;
+
+  READ_ERROR:
+    uniq->err_fn("Cannot read from temporary file '%s'",
+                 skTempFileGetName(uniq->tmpctx, temp_idx));
+  END:
+    uniqDistinctFree(fi, distincts);
+    uniqTempClose(fp);
+    if (dist_fp) {
+        uniqTempClose(dist_fp);
+    }
+    return rv;
+}
+
+
+/*
+ *  status = uniqPartialWriteEntries(uniq, stream);
+ *
+ *    Write the entries of 'uniq', which must be ready for output, to
+ *    the partial aggregate file 'stream'.  Return 0 on success, or -1
+ *    on failure.
+ */
+static int
+uniqPartialWriteEntries(
+    sk_unique_t        *uniq,
+    skstream_t         *stream)
+{
+    distinct_value_t *distincts = NULL;
+    uint8_t *hash_key;
+    uint8_t *hash_val;
+    HASH_ITER ithash;
+    int step;
+    int i;
+
+    if (uniq->temp_idx > 0) {
+        /* skUniquePrepareForOutput() wrote the final entries to a
+         * temporary file; temp_idx is the unused intermediate file */
+        step = ((uniq->fi.distinct_num_fields) ? 2 : 1);
+        for (i = 0; i < uniq->temp_idx; i += step) {
+            if (uniqPartialCopyTemp(uniq, stream, i)) {
+                return -1;
+            }
         }
+        return 0;
+    }
 
-        /* ran out of memory somewhere */
-        TRACEMSG((("%s:%d: Memory error code is %" PRIu32),
-                  __FILE__, __LINE__, memory_error));
-
-        if (memory_error > (1u << 31)) {
-            /* this is our second memory error */
-            if (OK != rv) {
-                uniq->err_fn(("Unexpected return code '%d'"
-                              " from hash table insert on new hash table"),
-                             rv);
-            } else {
-                uniq->err_fn(("Error allocating memory after writing"
-                              " hash table to temporary file"));
-            }
-            return -1;
+    ithash = hashlib_create_iterator(uniq->ht);
+    while (hashlib_iterate(uniq->ht, &ithash, &hash_key, &hash_val)
+           != ERR_NOMOREENTRIES)
+    {
+        if (uniq->fi.distinct_num_fields) {
+            memcpy(&distincts, hash_val + uniq->fi.value_octets,
+                   sizeof(void*));
         }
-        memory_error |= (1u << 31);
+        uniqTempWriteTriple(&uniq->fi, stream, stream,
+                            hash_key, hash_val, distincts);
+    }
+    return 0;
+}
 
-        /*
-         *  If (memory_error & 8) then there is a partially updated
-         *  distinct count.  This should not matter as long as we can
-         *  write the current values to disk and then reset
-         *  everything.  At worst, the distinct value for this key
-         *  will appear in two separate temporary files, but that
-         *  should be resolved then the distinct values from the two
-         *  files for this key are merged.
-         */
 
-        /* out of memory */
-        if (uniqueDumpHashToTemp(uniq)) {
-            return -1;
-        }
-        /* re-create the hash table */
-        if (uniqueCreateHashTable(uniq)) {
+/*  write the bins to a partial aggregate file */
+int
+skUniqueWritePartial(
+    sk_unique_t        *uniq,
+    skstream_t         *stream)
+{
+    sk_file_header_t *hdr;
+    uniq_partial_desc_t desc;
+    uint32_t p;
+    ssize_t rv;
+
+    assert(uniq);
+    assert(stream);
+
+    if (!uniq->ready_for_output) {
+        uniq->err_fn("May not call skUniqueWritePartial"
+                     " before calling skUniquePrepareForOutput");
+        return -1;
+    }
+
+    hdr = skStreamGetSilkHeader(stream);
+    skHeaderSetFileFormat(hdr, FT_RWAGGREGATE);
+    skHeaderSetRecordVersion(hdr, UNIQ_PARTIAL_VERSION);
+    skHeaderSetRecordLength(hdr, 1);
+    rv = skStreamWriteSilkHeader(stream);
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, uniq->err_fn);
+        return -1;
+    }
+
+    memset(&desc, 0, sizeof(desc));
+    desc.record_count = uniq->record_count;
+    desc.key_num_fields = uniq->fi.key_num_fields;
+    desc.key_octets = uniq->fi.key_octets;
+    desc.value_num_fields = uniq->fi.value_num_fields;
+    desc.value_octets = uniq->fi.value_octets;
+    desc.distinct_num_fields = uniq->fi.distinct_num_fields;
+    desc.distinct_octets = uniq->fi.distinct_octets;
+    desc.sketch_bits = uniq->fi.sketch_bits;
+    uniqTempWrite(stream, &desc, sizeof(desc));
+    uniqPartialWriteFields(stream, uniq->fi.key_fields,
+                           uniq->fi.key_num_fields);
+    uniqPartialWriteFields(stream, uniq->fi.value_fields,
+                           uniq->fi.value_num_fields);
+    uniqPartialWriteFields(stream, uniq->fi.distinct_fields,
+                           uniq->fi.distinct_num_fields);
+
+    if (NULL == uniq->parts) {
+        return uniqPartialWriteEntries(uniq, stream);
+    }
+    for (p = 0; p < uniq->thread_count; ++p) {
+        if (uniqPartialWriteEntries(uniq->parts[p].uniq, stream)) {
             return -1;
         }
     }
-
-    return 0;                   /* NOTREACHED */
+    return 0;
 }
 
 
-/*  get ready to return records to the caller. */
+/*  merge the bins in a partial aggregate file into a unique object */
 int
-skUniquePrepareForOutput(
-    sk_unique_t        *uniq)
+skUniqueAddPartial(
+    sk_unique_t        *uniq,
+    skstream_t         *stream,
+    uint64_t           *record_count)
 {
-    if (uniq->ready_for_output) {
-        return 0;
-    }
+    const sk_uniq_field_info_t *fi;
+    sk_file_header_t *hdr;
+    uniq_partial_desc_t desc;
+    distinct_value_t *distincts = NULL;
+    uint8_t key[HASHLIB_MAX_KEY_WIDTH];
+    uint8_t value[HASHLIB_MAX_VALUE_WIDTH];
+    uint8_t *registers = NULL;
+    uint8_t *hash_val;
+    uint64_t count;
+    ssize_t rv;
+    uint8_t i;
+    int retried;
+    int last_errno;
+    int status = -1;
+
+    assert(uniq);
+    assert(stream);
+    fi = &uniq->fi;
+
     if (!uniq->ready_for_input) {
-        uniq->err_fn("May not call skUniquePrepareForOutput"
+        uniq->err_fn("May not call skUniqueAddPartial"
                      " before calling skUniquePrepareForInput");
         return -1;
     }
+    if (uniq->parts) {
+        uniq->err_fn("May not call skUniqueAddPartial when using threads");
+        return -1;
+    }
+    assert(uniq->ht);
 
-    if (uniq->temp_idx > 0) {
-        /* dump the current/final hash entries to a file */
-        if (uniqueDumpHashToTemp(uniq)) {
+    rv = skStreamReadSilkHeader(stream, &hdr);
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, uniq->err_fn);
+        return -1;
+    }
+    if (skStreamCheckSilkHeader(stream, FT_RWAGGREGATE, UNIQ_PARTIAL_VERSION,
+                                UNIQ_PARTIAL_VERSION, uniq->err_fn))
+    {
+        return -1;
+    }
+    if (!skHeaderIsNativeByteOrder(hdr)) {
+        uniq->err_fn(("Cannot merge '%s': File was written on a machine"
+                      " having a different byte order"),
+                     skStreamGetPathname(stream));
+        return -1;
+    }
+
+    /* the file must have been written with the same fields */
+    if (!uniqTempRead(stream, &desc, sizeof(desc))) {
+        goto READ_ERROR;
+    }
+    if (desc.key_num_fields != fi->key_num_fields
+        || desc.key_octets != fi->key_octets
+        || desc.value_num_fields != fi->value_num_fields
+        || desc.value_octets != fi->value_octets
+        || desc.distinct_num_fields != fi->distinct_num_fields
+        || desc.distinct_octets != fi->distinct_octets)
+    {
+        goto FIELD_ERROR;
+    }
+    switch (uniqPartialCheckFields(stream, fi->key_fields,
+                                   fi->key_num_fields)
+            | uniqPartialCheckFields(stream, fi->value_fields,
+                                     fi->value_num_fields)
+            | uniqPartialCheckFields(stream, fi->distinct_fields,
+                                     fi->distinct_num_fields))
+    {
+      case 0:
+        break;
+      case 1:
+        goto FIELD_ERROR;
+      default:
+        goto READ_ERROR;
+    }
+    if (desc.sketch_bits) {
+        /* exact values may be added to a sketch, but a sketch cannot
+         * be added to an exact count or to a sketch of another size */
+        if (desc.sketch_bits != fi->sketch_bits) {
+            uniq->err_fn(("Cannot merge '%s': File estimates distinct"
+                          " counts with a precision of %u"),
+                         skStreamGetPathname(stream),
+                         (unsigned int)desc.sketch_bits);
+            return -1;
+        }
+        registers = (uint8_t*)malloc(UNIQ_SKETCH_REGISTERS(desc.sketch_bits));
+        if (NULL == registers) {
+            uniq->err_fn("Error allocating space for sketch registers");
             return -1;
         }
-    } else if (uniq->sort_output) {
-        /* need to sort using the skFieldListCompareBuffers function */
-        hashlib_sort_entries_usercmp(uniq->ht,
-                                     COMP_FUNC_CAST(skFieldListCompareBuffers),
-                                     (void*)uniq->fi.key_fields);
+    }
+    uniq->record_count += desc.record_count;
+    if (record_count) {
+        *record_count += desc.record_count;
     }
 
-    uniq->ready_for_output = 1;
-    return 0;
+    while ((rv = skStreamRead(stream, key, fi->key_octets)) != 0) {
+        if (rv != fi->key_octets) {
+            goto READ_ERROR;
+        }
+        if (fi->value_octets && !uniqTempRead(stream, value, fi->value_octets))
+        {
+            goto READ_ERROR;
+        }
+
+        /* when the hash table is full, write it to a temporary file
+         * and try again with a new table */
+        for (retried = 0; ; retried = 1) {
+            rv = hashlib_insert(uniq->ht, key, &hash_val);
+            if (OK == rv || OK_DUPLICATE == rv) {
+                break;
+            }
+            if ((ERR_OUTOFMEMORY != rv && ERR_NOMOREBLOCKS != rv) || retried) {
+                uniq->err_fn("Unexpected return code '%d'"
+                             " from hash table insert", (int)rv);
+                goto END;
+            }
+            if (uniqueDumpHashToTemp(uniq) || uniqueCreateHashTable(uniq)) {
+                goto END;
+            }
+        }
+
+        if (OK == rv) {
+            skFieldListInitializeBuffer(fi->value_fields, hash_val);
+            if (fi->distinct_num_fields) {
+                if (uniqDistinctAlloc(fi, &distincts, &uniq->distinct_bytes)) {
+                    uniq->err_fn("Error allocating space for distinct counts");
+                    goto END;
+                }
+                memcpy(hash_val + fi->value_octets, &distincts,
+                       sizeof(void*));
+            }
+        } else if (fi->distinct_num_fields) {
+            memcpy(&distincts, hash_val + fi->value_octets, sizeof(void*));
+        }
+        if (fi->value_octets) {
+            skFieldListMergeBuffers(fi->value_fields, hash_val, value);
+        }
+
+        for (i = 0; i < fi->distinct_num_fields; ++i) {
+            if (!uniqTempRead(stream, &count, sizeof(uint64_t))) {
+                goto READ_ERROR;
+            }
+            if (count & UNIQ_SKETCH_FLAG) {
+                if (NULL == registers
+                    || !uniqTempRead(stream, registers,
+                                     UNIQ_SKETCH_REGISTERS(desc.sketch_bits)))
+                {
+                    goto READ_ERROR;
+                }
+                if (uniqDistinctMergeRegisters(fi, &distincts[i], registers,
+                                               &uniq->distinct_bytes))
+                {
+                    uniq->err_fn("Error allocating space for a sketch");
+                    goto END;
+                }
+                continue;
+            }
+            for ( ; count > 0; --count) {
+                if (!uniqTempRead(stream, key, distincts[i].dv_octets)) {
+                    goto READ_ERROR;
+                }
+                if (uniqDistinctInsert(fi, &distincts[i], key,
+                                       &uniq->distinct_bytes))
+                {
+                    uniq->err_fn("Error allocating space for distinct counts");
+                    goto END;
+                }
+            }
+        }
+
+        if (uniqueCheckMemory(uniq)) {
+            goto END;
+        }
+    }
+
+    status = 0;
+    goto END;
+
+  FIELD_ERROR:
+    uniq->err_fn("Cannot merge '%s': File was written using other fields",
+                 skStreamGetPathname(stream));
+    goto END;
+
+  READ_ERROR:
+    last_errno = skStreamGetLastErrno(stream);
+    uniq->err_fn("Cannot read partial aggregate file '%s': %s",
+                 skStreamGetPathname(stream),
+                 (last_errno ? strerror(last_errno) : "Unexpected EOF"));
+  END:
+    free(registers);
+    return status;
 }
 
 
@@ -3609,9 +5356,15 @@ typedef struct uniqiter_tempfiles_st {
 
     /* heap the stores the indexes used by the 'fps' and 'key'
      * members. comparison function uses the 'key' member of this
-     * structure and returns the keys in ascending order */
+     * structure and returns the keys in ascending order.  used only
+     * when distinct fields are present */
     skheap_t           *heap;
 
+    /* merge that reads the key and value from each file in 'fps'
+     * and returns them in ascending order of key.  used only when no
+     * distinct fields are present */
+    sk_merge_t         *merge;
+
     /* temporary files that are currently open; number of valid files
      * specified by the 'open_count' member */
     skstream_t         *fps[MAX_MERGE_FILES];
@@ -3649,6 +5402,10 @@ typedef struct uniqiter_tempfiles_st {
      * key */
     uint8_t             distinct_value[MAX_MERGE_FILES][HASHLIB_MAX_KEY_WIDTH];
 
+    /* registers used when merging sketches; NULL unless distinct
+     * counts are estimated */
+    uint8_t            *sketch;
+
 } uniqiter_tempfiles_t;
 
 /* no support for distinct fields */
@@ -3658,6 +5415,7 @@ typedef struct uniqiter_temp_nodist_st {
     sk_uniqiter_free_fn_t   free_fn;
     sk_unique_t            *uniq;
     skheap_t               *heap;
+    sk_merge_t             *merge;
     skstream_t             *fps[MAX_MERGE_FILES];
     uint8_t                 key[MAX_MERGE_FILES][HASHLIB_MAX_KEY_WIDTH];
     uint8_t                 returned_buf[HASH_MAX_NODE_BYTES];
@@ -3678,6 +5436,17 @@ uniqIterTempfilesHeapDistCmp(
     const skheapnode_t  a,
     void               *v_iter);
 
+static int
+uniqIterTempfilesMergeKeysCmp(
+    const void         *a,
+    const void         *b,
+    void               *v_iter);
+
+static int
+uniqIterTempfilesNodistAddFiles(
+    uniqiter_temp_nodist_t *iter,
+    uint16_t                open_count);
+
 static int
 uniqIterTempfilesMergeOne(
     uniqiter_tempfiles_t   *iter,
@@ -3744,7 +5513,21 @@ uniqIterTempfilesReset(
         return -1;
     }
 
-    step = 1 + (iter->uniq->fi.distinct_num_fields > 0);
+    if (0 == iter->uniq->fi.distinct_num_fields) {
+        switch (uniqIterTempfilesNodistAddFiles(
+                    (uniqiter_temp_nodist_t*)iter, iter->open_count))
+        {
+          case 0:
+            return 0;
+          case 1:
+            iter->uniq->err_fn(
+                "Could not read records from any temporary files");
+            break;
+        }
+        return -1;
+    }
+
+    step = 2;
 
     /* Read the first key from each temp file into the 'key[]' array
      * on the iterator; add the file's index to the heap */
@@ -3936,10 +5719,12 @@ uniqIterTempfilesDestroy(
         if (iter->uniq->fi.distinct_num_fields) {
             uniqDistinctFree(&iter->uniq->fi, iter->distincts);
             skHeapFree(iter->dist_heap);
+            skHeapFree(iter->heap);
+            free(iter->sketch);
+        } else {
+            skMergeDestroy(&iter->merge);
         }
 
-        skHeapFree(iter->heap);
-
         free(iter);
         *v_iter = NULL;
     }
@@ -3971,12 +5756,6 @@ uniqIterTempfilesCreate(
         goto ERROR;
     }
 
-    iter->heap = skHeapCreate2(uniqIterTempfilesHeapKeysCmp, MAX_MERGE_FILES,
-                               sizeof(uint16_t), NULL, iter);
-    if (NULL == iter->heap) {
-        goto ERROR;
-    }
-
     iter->uniq = uniq;
     iter->reset_fn = uniqIterTempfilesReset;
     iter->free_fn = uniqIterTempfilesDestroy;
@@ -3984,9 +5763,25 @@ uniqIterTempfilesCreate(
     /* set up the handling of distinct field(s) */
     if (0 == uniq->fi.distinct_num_fields) {
         iter->next_fn = uniqIterTempfilesNodistNext;
+
+        /* create the merge that operates over the key and value */
+        iter->merge = skMergeCreate(
+            uniq->fi.key_octets + uniq->fi.value_octets, MAX_MERGE_FILES,
+            uniqIterTempfilesMergeKeysCmp, iter);
+        if (NULL == iter->merge) {
+            goto ERROR;
+        }
     } else {
         iter->next_fn = uniqIterTempfilesNext;
 
+        /* create the heap that operates over the keys */
+        iter->heap = skHeapCreate2(uniqIterTempfilesHeapKeysCmp,
+                                   MAX_MERGE_FILES, sizeof(uint16_t),
+                                   NULL, iter);
+        if (NULL == iter->heap) {
+            goto ERROR;
+        }
+
         /* create the heap that operates over the distinct fields */
         iter->dist_heap = skHeapCreate2(uniqIterTempfilesHeapDistCmp,
                                         MAX_MERGE_FILES, sizeof(uint16_t),
@@ -3997,6 +5792,14 @@ uniqIterTempfilesCreate(
         if (uniqDistinctAllocMerging(&uniq->fi, &iter->distincts)) {
             goto ERROR;
         }
+        if (uniq->fi.sketch_bits) {
+            iter->sketch = (uint8_t*)malloc(
+                UNIQ_SKETCH_REGISTERS(uniq->fi.sketch_bits));
+            if (NULL == iter->sketch) {
+                uniqDistinctFree(&uniq->fi, iter->distincts);
+                goto ERROR;
+            }
+        }
     }
 
     if (uniqIterTempfilesReset((sk_unique_iterator_t*)iter)) {
@@ -4009,6 +5812,7 @@ uniqIterTempfilesCreate(
 
   ERROR:
     if (iter) {
+        skMergeDestroy(&iter->merge);
         skHeapFree(iter->dist_heap);
         skHeapFree(iter->heap);
         free(iter);
@@ -4018,6 +5822,80 @@ uniqIterTempfilesCreate(
 }
 
 
+/*
+ *  status = uniqIterTempfilesNodistCheckError(iter);
+ *
+ *    Check whether the merge on 'iter' stopped reading a temporary
+ *    file because of an error.  If so, report the error and return
+ *    -1.  Otherwise return 0.
+ */
+static int
+uniqIterTempfilesNodistCheckError(
+    uniqiter_temp_nodist_t *iter)
+{
+    char errbuf[2 * PATH_MAX];
+    ssize_t rv;
+    size_t src;
+
+    rv = skMergeGetError(iter->merge, &src);
+    if (0 == rv) {
+        return 0;
+    }
+    skStreamLastErrMessage(iter->fps[src], rv, errbuf, sizeof(errbuf));
+    UNIQUE_DEBUG(iter->uniq,
+                 ((SKUNIQUE_DEBUG_ENVAR
+                   ": Cannot read from temporary file #%u"),
+                  UNIQUE_TMPNUM_READ(iter, (uint16_t)src)));
+    iter->uniq->err_fn("Cannot read from temporary file: %s", errbuf);
+    return -1;
+}
+
+
+/*
+ *  status = uniqIterTempfilesNodistAddFiles(iter, open_count);
+ *
+ *    Add the first 'open_count' temporary files in the 'fps' member
+ *    of 'iter' to the
+ *    merge object on 'iter'.  The merge reads each file as a
+ *    sequence of records, each containing a key and a value.
+ *
+ *    This function may only be used when no distinct fields are
+ *    present.
+ *
+ *    Return 0 when at least one file contains a record, 1 when all
+ *    files are empty, or -1 on error.
+ */
+static int
+uniqIterTempfilesNodistAddFiles(
+    uniqiter_temp_nodist_t *iter,
+    uint16_t                open_count)
+{
+    const void *rec;
+    uint16_t j;
+
+    assert(0 == iter->uniq->fi.distinct_num_fields);
+
+    skMergeReset(iter->merge);
+
+    for (j = 0; j < open_count; ++j) {
+        if (skMergeAddStream(iter->merge, iter->fps[j])) {
+            iter->uniq->err_fn("Error allocating space for merging files");
+            return -1;
+        }
+    }
+
+    /* reading the first record from each file */
+    if (SKMERGE_OK == skMergeTop(iter->merge, &rec, NULL)) {
+        UNIQUE_DEBUG(iter->uniq,
+                     ((SKUNIQUE_DEBUG_ENVAR
+                       ": Merging %u open temporary files"),
+                      open_count));
+        return 0;
+    }
+    return uniqIterTempfilesNodistCheckError(iter) ? -1 : 1;
+}
+
+
 /*
  *    Helper function to merge the aggregate values from multiple
  *    temporary files into a single value for a single key.
@@ -4025,98 +5903,51 @@ uniqIterTempfilesCreate(
  *    This function may only be used when no distinct fields are
  *    present.
  *
- *    Fill 'cached_key' with the key for the file whose index is in
- *    'lowest'.
+ *    Fill 'cached_key' with the lowest key in the merge on 'iter'.
  *
  *    Initialize the buffer in 'merged_values' to hold the merging
  *    (e.g., the sum) of the aggregate value fields.
  *
- *    Across all the temporary files open on 'iter', read the values
- *    for keys that match 'cached_key' and add that value to
- *    'merged_values'.
+ *    Across all the temporary files open on 'iter', remove the
+ *    records whose key matches 'cached_key' from the merge and add
+ *    their values to 'merged_values'.
  *
- *    Return 0 on success or -1 on read failure.
+ *    Return 0 on success, 1 when the merge has no more records, or
+ *    -1 on read failure.
  */
 static int
 uniqIterTempfilesNodistMergeValues(
     uniqiter_temp_nodist_t *iter,
-    uint16_t                lowest,
     uint8_t                *cached_key,
     uint8_t                *merged_values)
 {
-    uint8_t buf[4096];
-    uint16_t *top_heap;
-    uint32_t heap_count;
-    int last_errno;
-
-    /* should only be called with value fields and no distinct fields */
-    assert(0 == iter->uniq->fi.distinct_num_fields);
-    assert(0 < iter->uniq->fi.value_octets);
-
-    /* lowest should be the file index at the top of the heap */
-    assert(SKHEAP_OK == skHeapPeekTop(iter->heap, (skheapnode_t*)&top_heap));
-    assert(lowest == *top_heap);
-
-    heap_count = skHeapGetNumberEntries(iter->heap);
-
-    memcpy(cached_key, iter->key[lowest], iter->uniq->fi.key_octets);
-
-    skFieldListInitializeBuffer(iter->uniq->fi.value_fields, merged_values);
-
-    /* repeat as long as the key of the item at top of the heap
-     * matches the cached_key */
-    do {
-        /* read the value and merge it into the current value */
-        if (!uniqTempRead(iter->fps[lowest], buf, iter->uniq->fi.value_octets))
-        {
-            last_errno = skStreamGetLastErrno(iter->fps[lowest]);
-            UNIQUE_DEBUG(iter->uniq,
-                         ((SKUNIQUE_DEBUG_ENVAR
-                           ": Cannot read from temporary file #%u"),
-                          UNIQUE_TMPNUM_READ(iter, lowest)));
-            iter->uniq->err_fn(
-                "Cannot read value field from temporary file: %s",
-                (last_errno ? strerror(last_errno) :"EOF"));
-            return -1;
-        }
-        skFieldListMergeBuffers(
-            iter->uniq->fi.value_fields, merged_values, buf);
+    const uint8_t *rec;
 
-        /* replace the key for the value we just processed */
-        if (uniqTempRead(iter->fps[lowest], iter->key[lowest],
-                         iter->uniq->fi.key_octets))
-        {
-            /* read succeeded. insert the new entry into the
-             * heap. */
-            skHeapReplaceTop(iter->heap, &lowest, NULL);
-            /* keys within a file should always be unique and sorted
-             * when no distinct fields are present */
-            assert(skFieldListCompareBuffers(cached_key, iter->key[lowest],
-                                             iter->uniq->fi.key_fields) < 0);
-        } else {
-            /* read failed or no more data for this file; remove it
-             * from the heap */
-            UNIQUE_DEBUG(iter->uniq,
-                         ((SKUNIQUE_DEBUG_ENVAR
-                           ": Finished reading file #%u, %u files remain"),
-                          UNIQUE_TMPNUM_READ(iter, lowest),
-                          skHeapGetNumberEntries(iter->heap) - 1));
-            skHeapExtractTop(iter->heap, NULL);
-            --heap_count;
-            if (0 == heap_count) {
-                break;
-            }
-        }
+    /* should only be called with value fields and no distinct fields */
+    assert(0 == iter->uniq->fi.distinct_num_fields);
+    assert(0 < iter->uniq->fi.value_octets);
 
-        /* get the new value at the top of the heap; if its key
-         * matches cached_key, add its values to merged_values. */
-        skHeapPeekTop(iter->heap, (skheapnode_t*)&top_heap);
-        lowest = *top_heap;
+    if (skMergeTop(iter->merge, (const void**)&rec, NULL) != SKMERGE_OK) {
+        return (uniqIterTempfilesNodistCheckError(iter) ? -1 : 1);
+    }
 
-    } while (skFieldListCompareBuffers(
-                 cached_key, iter->key[lowest], iter->uniq->fi.key_fields)==0);
+    memcpy(cached_key, rec, iter->uniq->fi.key_octets);
 
-    return 0;
+    skFieldListInitializeBuffer(iter->uniq->fi.value_fields, merged_values);
+
+    /* repeat as long as the key of the lowest record matches the
+     * cached_key; keys within a file are unique when no distinct
+     * fields are present, so each match is from a different file */
+    do {
+        skFieldListMergeBuffers(iter->uniq->fi.value_fields, merged_values,
+                                rec + iter->uniq->fi.key_octets);
+        skMergeNext(iter->merge);
+    } while ((skMergeTop(iter->merge, (const void**)&rec, NULL)
+              == SKMERGE_OK)
+             && (0 == skFieldListCompareBuffers(
+                     cached_key, rec, iter->uniq->fi.key_fields)));
+
+    return uniqIterTempfilesNodistCheckError(iter);
 }
 
 
@@ -4136,8 +5967,6 @@ uniqIterTempfilesNodistNext(
     uint8_t               **value_fields_buffer)
 {
     uniqiter_temp_nodist_t *iter = (uniqiter_temp_nodist_t*)v_iter;
-    uint16_t lowest;
-    uint16_t *top_heap;
     uint8_t cached_key[HASHLIB_MAX_KEY_WIDTH];
     uint8_t merged_values[HASHLIB_MAX_VALUE_WIDTH];
 
@@ -4147,18 +5976,10 @@ uniqIterTempfilesNodistNext(
     assert(0 == iter->uniq->fi.distinct_num_fields);
     assert(iter->uniq->fi.value_octets > 0);
 
-    /* get the index of the file with the lowest key; which is at
-     * the top of the heap */
-    if (SKHEAP_OK != skHeapPeekTop(iter->heap, (skheapnode_t*)&top_heap)) {
-        return SK_ITERATOR_NO_MORE_ENTRIES;
-    }
-    lowest = *top_heap;
-
-    if (uniqIterTempfilesNodistMergeValues(
-            iter, lowest, cached_key, merged_values))
+    if (uniqIterTempfilesNodistMergeValues(iter, cached_key, merged_values))
     {
-        /* error reading from files */
-        skHeapEmpty(iter->heap);
+        /* no more records or error reading from files */
+        skMergeReset(iter->merge);
         return SK_ITERATOR_NO_MORE_ENTRIES;
     }
 
@@ -4174,6 +5995,33 @@ uniqIterTempfilesNodistNext(
 }
 
 
+/*
+ *  cmp = uniqIterTempfilesMergeKeysCmp(a, b, v_iter);
+ *
+ *    Comparison callback function used by the merge when no distinct
+ *    fields are present.
+ *
+ *    The values in 'a' and 'b' are records read from the temporary
+ *    files, each of which begins with a key.  The function calls the
+ *    field comparison function to compare the keys and returns the
+ *    result.
+ *
+ *    The context value in 'v_iter' is the uniqiter_temp_nodist_t
+ *    object that holds the fields describing the sort order.
+ */
+static int
+uniqIterTempfilesMergeKeysCmp(
+    const void         *a,
+    const void         *b,
+    void               *v_iter)
+{
+    uniqiter_temp_nodist_t *iter = (uniqiter_temp_nodist_t*)v_iter;
+
+    return skFieldListCompareBuffers((const uint8_t*)a, (const uint8_t*)b,
+                                     iter->uniq->fi.key_fields);
+}
+
+
 /*
  *  status = uniqIterTempfilesHeapKeysCmp(b, a, v_iter);
  *
@@ -4220,8 +6068,10 @@ uniqIterTempfilesHeapDistCmp(
     assert(iter);
     assert(iter->cur_dist);
 
-    dist_a = iter->distinct_value[*(uint16_t*)a] + iter->cur_dist->dv_offset;
-    dist_b = iter->distinct_value[*(uint16_t*)b] + iter->cur_dist->dv_offset;
+    /* the merge reads each file's current value of the field being
+     * merged into the start of its distinct_value[] entry */
+    dist_a = iter->distinct_value[*(uint16_t*)a];
+    dist_b = iter->distinct_value[*(uint16_t*)b];
 
     return memcmp(dist_a, dist_b, iter->cur_dist->dv_octets);
 }
@@ -4232,9 +6082,9 @@ uniqIterTempfilesHeapDistCmp(
  *    file.  May only be used when there are no distinct fields; when
  *    distinct fields are present, use uniqIterTempfilesMergeFiles().
  *
- *    Read the values from the 'open_count' temporary files stored on
- *    'iter', merge the values when the keys are identical, and store
- *    the result in the file whose index is 'temp_idx_offset'.
+ *    Read the records from the 'open_count' temporary files stored
+ *    on 'iter', merge the values when the keys are identical, and
+ *    store the result in the intermediate temporary file.
  *
  *    Return 0 on success or -1 on failure.
  */
@@ -4242,76 +6092,32 @@ static int
 uniqIterTempfilesNodistMergeFiles(
     uniqiter_temp_nodist_t *iter)
 {
-    uint16_t *top_heap;
-    uint16_t lowest;
     uint8_t cached_key[HASHLIB_MAX_KEY_WIDTH];
     uint8_t merged_values[HASHLIB_MAX_VALUE_WIDTH];
+    int rv;
 
     /* should only be called with value fields and no distinct fields */
     assert(0 == iter->uniq->fi.distinct_num_fields);
     assert(0 < iter->uniq->fi.value_octets);
 
-    /* exit this while() loop once all records for all opened files
-     * have been read or until there is only one file remaining */
-    while (skHeapGetNumberEntries(iter->heap) > 1) {
-        /* get the index of the file with the lowest key; which is at
-         * the top of the heap */
-        skHeapPeekTop(iter->heap, (skheapnode_t*)&top_heap);
-        lowest = *top_heap;
-
-        /* for all files that match the lowest key key, merge their
-         * values into 'merged_values' */
-        if (uniqIterTempfilesNodistMergeValues(
-                iter, lowest, cached_key, merged_values))
-        {
-            return -1;
-        }
-
-        /* write the lowest key/value pair to the intermediate
-         * temp file */
+    /* for each key, merge the values of all files that contain the
+     * key and write the key/value pair to the intermediate temp
+     * file */
+    while (0 == (rv = uniqIterTempfilesNodistMergeValues(
+                     iter, cached_key, merged_values)))
+    {
         uniqTempWrite(iter->uniq->temp_fp, cached_key,
                       iter->uniq->fi.key_octets);
         uniqTempWrite(iter->uniq->temp_fp, merged_values,
                       iter->uniq->fi.value_octets);
     }
-
-    /* copy the data from the remaining file as blocks */
-    if (skHeapExtractTop(iter->heap, (skheapnode_t*)&top_heap) == SKHEAP_OK) {
-        uint8_t buf[4096];
-        ssize_t rv;
-
-        if (skHeapGetNumberEntries(iter->heap) != 0) {
-            skAbort();
-        }
-        lowest = *top_heap;
-
-        /* write the key that's in memory */
-        uniqTempWrite(
-            iter->uniq->temp_fp, iter->key[lowest], iter->uniq->fi.key_octets);
-
-        /* inline the body of uniqTempRead() since that function does
-         * not support partial reads */
-
-        while ((rv = skStreamRead(iter->fps[lowest], buf, sizeof(buf))) > 0) {
-            uniqTempWrite(iter->uniq->temp_fp, buf, rv);
-        }
-        if (-1 == rv) {
-            char errbuf[2 * PATH_MAX];
-
-            skStreamLastErrMessage(
-                iter->fps[lowest], rv, errbuf, sizeof(errbuf));
-            TRACEMSG(("%s:%d: Failed to read %" SK_PRIuZ " bytes: %s",
-                      __FILE__, __LINE__, sizeof(buf), errbuf));
-            iter->uniq->err_fn("Cannot read from temporary file: %s",
-                               errbuf);
-            return -1;
-        }
-        UNIQUE_DEBUG(iter->uniq,
-                     ((SKUNIQUE_DEBUG_ENVAR
-                       ": Finished reading file #%u, 0 files remain"),
-                      UNIQUE_TMPNUM_READ(iter, lowest)));
+    if (-1 == rv) {
+        return -1;
     }
 
+    UNIQUE_DEBUG(iter->uniq,
+                 (SKUNIQUE_DEBUG_ENVAR ": Finished reading files"));
+
     return 0;
 }
 
@@ -4390,7 +6196,7 @@ uniqIterTempfilesMergeOne(
 
         /* determine the number of bytes to read */
         assert(dist->dv_octets > 0);
-        to_read = dist->dv_octets * dist_count;
+        to_read = UNIQ_DISTINCT_DATA_OCTETS(&iter->uniq->fi, dist, dist_count);
 
         if (!write_to_temp) {
             /* no need to read the data, just skip over it by using
@@ -4453,6 +6259,7 @@ uniqIterTempfilesMergeValuesDist(
     uint16_t fps_index;
     uint16_t i;
     uint16_t j;
+    int sketched;
     int last_errno;
 
     /* Should only be called when distinct fields are present */
@@ -4502,9 +6309,8 @@ uniqIterTempfilesMergeValuesDist(
          * field across all open files */
         distinct_count = 0;
 
-        /* for each file: read the number of distinct entries, read
-         * the first distinct value, and store the index in
-         * the dist_heap using a comparitor over the distinct value */
+        /* for each file, read the number of distinct entries */
+        sketched = 0;
         for (j = 0; j < file_ids_len; ++j) {
             fps_index = file_ids[j];
             if (!uniqTempRead(iter->fps[fps_index], &num_distinct[fps_index],
@@ -4521,6 +6327,32 @@ uniqIterTempfilesMergeValuesDist(
                 return -1;
             }
 
+            if (num_distinct[fps_index] & UNIQ_SKETCH_FLAG) {
+                sketched = 1;
+            }
+        }
+        if (sketched) {
+            /* at least one file holds a sketch, so the result is a
+             * sketch */
+            if (uniqDistinctMergeSketches(
+                    &iter->uniq->fi, dist, iter->fps, file_ids, file_ids_len,
+                    num_distinct, iter->sketch, iter->uniq->err_fn))
+            {
+                return -1;
+            }
+            if (write_to_temp) {
+                uniqTempWrite(
+                    iter->uniq->dist_fp, iter->sketch,
+                    UNIQ_SKETCH_REGISTERS(iter->uniq->fi.sketch_bits));
+            }
+            continue;
+        }
+
+        /* for each file, read the first distinct value and store the
+         * index in the dist_heap using a comparitor over the distinct
+         * value */
+        for (j = 0; j < file_ids_len; ++j) {
+            fps_index = file_ids[j];
             if (num_distinct[fps_index]) {
                 if (!uniqTempRead(iter->fps[fps_index + 1],
                                   iter->distinct_value[fps_index],
@@ -4722,9 +6554,9 @@ uniqIterTempfilesMergeFiles(
         }
     }
 
-    if (skHeapExtractTop(iter->heap, (skheapnode_t*)&top_heap) == SKHEAP_OK) {
-        lowest = *top_heap;
-
+    /* the heap copies the entry it removes, so extract the index
+     * directly into 'lowest' */
+    if (skHeapExtractTop(iter->heap, (skheapnode_t)&lowest) == SKHEAP_OK) {
         assert(0 == skHeapGetNumberEntries(iter->heap));
 
         do {
@@ -4792,7 +6624,8 @@ uniqIterTempfilesOpenAll(
     /* This loop repeats as long as we haven't opened all of the temp
      * files generated while reading the flows. */
     for (;;) {
-        assert(skHeapGetNumberEntries(iter->heap) == 0);
+        assert(NULL == iter->heap
+               || skHeapGetNumberEntries(iter->heap) == 0);
 
         /* store the index of the first temporary file being processed
          * this time on the iterator */
@@ -4876,7 +6709,22 @@ uniqIterTempfilesOpenAll(
         /* Else, we could not open all temp files, so merge all opened
          * temp files into the intermediate file */
 
-        step = 1 + (iter->uniq->fi.distinct_num_fields > 0);
+        if (0 == iter->uniq->fi.distinct_num_fields) {
+            rv = uniqIterTempfilesNodistAddFiles(
+                (uniqiter_temp_nodist_t*)iter, open_count);
+            if (-1 == rv) {
+                return -1;
+            }
+            if (0 == rv) {
+                rv = (uniqIterTempfilesNodistMergeFiles(
+                          (uniqiter_temp_nodist_t*)iter));
+            } else {
+                rv = 0;
+            }
+            goto CLOSE_FILES;
+        }
+
+        step = 2;
 
         /* Read the first key from each temp file into the 'key[]'
          * array on the iterator; add file's index to the heap */
@@ -4908,18 +6756,14 @@ uniqIterTempfilesOpenAll(
                        " open temporary files"),
                       skHeapGetNumberEntries(iter->heap), open_count));
 
-        if (0 == iter->uniq->fi.distinct_num_fields) {
-            rv = (uniqIterTempfilesNodistMergeFiles(
-                      (uniqiter_temp_nodist_t*)iter));
-        } else {
-            rv = uniqIterTempfilesMergeFiles(iter);
-        }
+        rv = uniqIterTempfilesMergeFiles(iter);
+        assert(rv || skHeapGetNumberEntries(iter->heap) == 0);
+
+      CLOSE_FILES:
         if (rv) {
             return -1;
         }
 
-        assert(skHeapGetNumberEntries(iter->heap) == 0);
-
         /* Close all the temp files that we processed this time. */
         for (i = 0; i < open_count; ++i) {
             uniqTempClose(iter->fps[i]);
@@ -4929,11 +6773,15 @@ uniqIterTempfilesOpenAll(
             skTempFileRemove(iter->uniq->tmpctx, j);
         }
 
-        /* Close the intermediate temp file. */
+        /* Close the intermediate temp file(s). */
         UNIQUE_DEBUG(iter->uniq,
                      ((SKUNIQUE_DEBUG_ENVAR ": Finished writing '%s'"),
                       UNIQUE_TMPNAME_OUT(iter->uniq)));
         uniqTempClose(iter->uniq->temp_fp);
+        if (iter->uniq->dist_fp) {
+            uniqTempClose(iter->uniq->dist_fp);
+            iter->uniq->dist_fp = NULL;
+        }
 
         /* Open a new intermediate temp file. */
         iter->uniq->temp_fp = uniqTempCreate(iter->uniq->tmpctx,
@@ -4963,6 +6811,238 @@ uniqIterTempfilesOpenAll(
 }
 
 
+/****************************************************************
+ * Iterator for handling the partitions created by threads
+ ***************************************************************/
+
+typedef struct uniqiter_parts_st {
+    sk_uniqiter_reset_fn_t  reset_fn;
+    sk_uniqiter_next_fn_t   next_fn;
+    sk_uniqiter_free_fn_t   free_fn;
+    sk_unique_t            *uniq;
+    /* an iterator over the unique object of each partition */
+    sk_unique_iterator_t  **child;
+    /* when the output is sorted, the current row of each partition:
+     * its key, distinct, and value buffers, and whether the
+     * partition has a current row */
+    uint8_t               **key;
+    uint8_t               **distinct;
+    uint8_t               **value;
+    uint8_t                *has_row;
+    /* when the output is unsorted, the partition being visited; when
+     * sorted, the partition whose row was returned last, or
+     * UINT32_MAX if no row has been returned */
+    uint32_t                cur;
+} uniqiter_parts_t;
+
+
+/*
+ *  uniqIterPartsStart(iter);
+ *
+ *    Prepare 'iter' to return rows from its newly created or reset
+ *    child iterators.
+ */
+static void
+uniqIterPartsStart(
+    uniqiter_parts_t   *iter)
+{
+    uint32_t p;
+
+    if (!iter->uniq->sort_output) {
+        iter->cur = 0;
+        return;
+    }
+
+    /* get the first row from each partition */
+    for (p = 0; p < iter->uniq->thread_count; ++p) {
+        iter->has_row[p]
+            = (SK_ITERATOR_OK == skUniqueIteratorNext(iter->child[p],
+                                                      &iter->key[p],
+                                                      &iter->distinct[p],
+                                                      &iter->value[p]));
+    }
+    iter->cur = UINT32_MAX;
+}
+
+
+/*
+ *  status = uniqIterPartsReset(iter);
+ *
+ *    Implementation for skUniqueIteratorReset().
+ */
+static int
+uniqIterPartsReset(
+    sk_unique_iterator_t   *v_iter)
+{
+    uniqiter_parts_t *iter = (uniqiter_parts_t*)v_iter;
+    uint32_t p;
+
+    UNIQUE_DEBUG(iter->uniq, ((SKUNIQUE_DEBUG_ENVAR ": Resetting partition"
+                               " iterator; num partitions = %" PRIu32),
+                              iter->uniq->thread_count));
+
+    for (p = 0; p < iter->uniq->thread_count; ++p) {
+        if (skUniqueIteratorReset(iter->child[p])) {
+            return -1;
+        }
+    }
+    uniqIterPartsStart(iter);
+    return 0;
+}
+
+
+/*
+ *  status = uniqIterPartsNext(iter, &key, &distinct, &value);
+ *
+ *    Implementation for skUniqueIteratorNext().
+ *
+ *    When the output is unsorted, visit the partitions in turn.  When
+ *    sorted, return the row with the lowest key among the partitions'
+ *    current rows.  A key appears in only one partition, so there are
+ *    no ties and no values to merge.
+ */
+static int
+uniqIterPartsNext(
+    sk_unique_iterator_t           *v_iter,
+    uint8_t                       **key_fields_buffer,
+    uint8_t                       **distinct_fields_buffer,
+    uint8_t                       **value_fields_buffer)
+{
+    uniqiter_parts_t *iter = (uniqiter_parts_t*)v_iter;
+    const uint32_t part_count = iter->uniq->thread_count;
+    uint32_t lowest;
+    uint32_t p;
+
+    if (!iter->uniq->sort_output) {
+        for ( ; iter->cur < part_count; ++iter->cur) {
+            if (SK_ITERATOR_OK
+                == skUniqueIteratorNext(iter->child[iter->cur],
+                                        key_fields_buffer,
+                                        distinct_fields_buffer,
+                                        value_fields_buffer))
+            {
+                return SK_ITERATOR_OK;
+            }
+        }
+        return SK_ITERATOR_NO_MORE_ENTRIES;
+    }
+
+    /* advance the partition whose row the caller has consumed */
+    if (iter->cur < part_count) {
+        p = iter->cur;
+        iter->has_row[p]
+            = (SK_ITERATOR_OK == skUniqueIteratorNext(iter->child[p],
+                                                      &iter->key[p],
+                                                      &iter->distinct[p],
+                                                      &iter->value[p]));
+    }
+
+    lowest = UINT32_MAX;
+    for (p = 0; p < part_count; ++p) {
+        if (iter->has_row[p]
+            && (UINT32_MAX == lowest
+                || skFieldListCompareBuffers(iter->key[p], iter->key[lowest],
+                                             iter->uniq->fi.key_fields) < 0))
+        {
+            lowest = p;
+        }
+    }
+    iter->cur = lowest;
+    if (UINT32_MAX == lowest) {
+        return SK_ITERATOR_NO_MORE_ENTRIES;
+    }
+    *key_fields_buffer = iter->key[lowest];
+    *distinct_fields_buffer = iter->distinct[lowest];
+    *value_fields_buffer = iter->value[lowest];
+    return SK_ITERATOR_OK;
+}
+
+
+/*
+ *  uniqIterPartsDestroy(&iter);
+ *
+ *    Implementation for skUniqueIteratorDestroy().
+ */
+static void
+uniqIterPartsDestroy(
+    sk_unique_iterator_t  **v_iter)
+{
+    uniqiter_parts_t *iter;
+    uint32_t p;
+
+    if (v_iter && *v_iter) {
+        iter = *(uniqiter_parts_t**)v_iter;
+        if (iter->child) {
+            for (p = 0; p < iter->uniq->thread_count; ++p) {
+                skUniqueIteratorDestroy(&iter->child[p]);
+            }
+            free(iter->child);
+        }
+        free(iter->key);
+        free(iter->distinct);
+        free(iter->value);
+        free(iter->has_row);
+        memset(iter, 0, sizeof(uniqiter_parts_t));
+        free(iter);
+        *v_iter = NULL;
+    }
+}
+
+
+/*
+ *  status = uniqIterPartsCreate(uniq, &iter);
+ *
+ *    Helper function for skUniqueIteratorCreate().
+ */
+static int
+uniqIterPartsCreate(
+    sk_unique_t            *uniq,
+    sk_unique_iterator_t  **new_iter)
+{
+    uniqiter_parts_t *iter;
+    uint32_t p;
+
+    iter = (uniqiter_parts_t*)calloc(1, sizeof(uniqiter_parts_t));
+    if (NULL == iter) {
+        uniq->err_fn("Error allocating unique iterator");
+        return -1;
+    }
+
+    iter->uniq = uniq;
+    iter->reset_fn = uniqIterPartsReset;
+    iter->next_fn = uniqIterPartsNext;
+    iter->free_fn = uniqIterPartsDestroy;
+
+    iter->child = ((sk_unique_iterator_t**)
+                   calloc(uniq->thread_count, sizeof(sk_unique_iterator_t*)));
+    iter->key = (uint8_t**)calloc(uniq->thread_count, sizeof(uint8_t*));
+    iter->distinct = (uint8_t**)calloc(uniq->thread_count, sizeof(uint8_t*));
+    iter->value = (uint8_t**)calloc(uniq->thread_count, sizeof(uint8_t*));
+    iter->has_row = (uint8_t*)calloc(uniq->thread_count, sizeof(uint8_t));
+    if (!iter->child || !iter->key || !iter->distinct || !iter->value
+        || !iter->has_row)
+    {
+        uniq->err_fn("Error allocating unique iterator");
+        uniqIterPartsDestroy((sk_unique_iterator_t**)&iter);
+        return -1;
+    }
+
+    for (p = 0; p < uniq->thread_count; ++p) {
+        if (skUniqueIteratorCreate(uniq->parts[p].uniq, &iter->child[p])) {
+            uniqIterPartsDestroy((sk_unique_iterator_t**)&iter);
+            return -1;
+        }
+    }
+
+    /* the children were reset when they were created; resetting them
+     * again would re-read temporary files that their merges removed */
+    uniqIterPartsStart(iter);
+
+    *new_iter = (sk_unique_iterator_t*)iter;
+    return 0;
+}
+
+
 /****************************************************************
  * Public Interface for Iterating over the bins
  ***************************************************************/
@@ -4981,6 +7061,9 @@ skUniqueIteratorCreate(
                      " before calling skUniquePrepareForOutput");
         return -1;
     }
+    if (uniq->parts) {
+        return uniqIterPartsCreate(uniq, new_iter);
+    }
     if (uniq->temp_idx > 0) {
         return uniqIterTempfilesCreate(uniq, new_iter);
     }
@@ -5116,6 +7199,14 @@ struct sk_sort_unique_st {
      * key */
     uint8_t             distinct_value[MAX_MERGE_FILES][HASHLIB_MAX_KEY_WIDTH];
 
+    /* registers used when merging sketches; NULL unless distinct
+     * counts are estimated */
+    uint8_t            *sketch;
+
+    /* the precision given to skPresortedUniqueSetDistinctApprox(),
+     * or 0 */
+    uint8_t             distinct_approx;
+
     /* flag to detect recursive calls to skPresortedUniqueProcess() */
     unsigned                processing : 1;
 
@@ -5271,8 +7362,10 @@ sortuniqHeapDistCmp(
     assert(uniq);
     assert(uniq->cur_dist);
 
-    dist_a = uniq->distinct_value[*(uint16_t*)a] + uniq->cur_dist->dv_offset;
-    dist_b = uniq->distinct_value[*(uint16_t*)b] + uniq->cur_dist->dv_offset;
+    /* the merge reads each file's current value of the field being
+     * merged into the start of its distinct_value[] entry */
+    dist_a = uniq->distinct_value[*(uint16_t*)a];
+    dist_b = uniq->distinct_value[*(uint16_t*)b];
 
     return memcmp(dist_a, dist_b, uniq->cur_dist->dv_octets);
 }
@@ -5465,7 +7558,7 @@ sortuniqReadSilkTotemp(
             skFieldListRecToBinary(
                 uniq->fi.distinct_fields, &uniq->rec[lowest], distinct_buffer);
             if (uniqDistinctIncrement(
-                    &uniq->fi, uniq->distincts, distinct_buffer))
+                    &uniq->fi, uniq->distincts, distinct_buffer, NULL))
             {
                 /* increment failed; write the current values to disk
                  * and then reset the values and distincts */
@@ -5623,7 +7716,7 @@ sortuniqMergeSingleFile(
 
         /* determine the number of bytes to read */
         assert(dist->dv_octets > 0);
-        to_read = dist->dv_octets * dist_count;
+        to_read = UNIQ_DISTINCT_DATA_OCTETS(&uniq->fi, dist, dist_count);
 
         if (output_fn) {
             /* no need to read the data, just skip over it by using
@@ -5710,6 +7803,7 @@ sortuniqMergeValuesDist(
     uint16_t fps_index;
     uint16_t i;
     uint16_t j;
+    int sketched;
     int last_errno;
     int rv;
 
@@ -5757,9 +7851,8 @@ sortuniqMergeValuesDist(
          * field across all open files */
         distinct_count = 0;
 
-        /* for each file: read the number of distinct entries, read
-         * the first distinct value, and store the index in
-         * the dist_heap using a comparitor over the distinct value */
+        /* for each file, read the number of distinct entries */
+        sketched = 0;
         for (j = 0; j < file_ids_len; ++j) {
             fps_index = file_ids[j];
             if (!uniqTempRead(uniq->fps[fps_index], &num_distinct[fps_index],
@@ -5776,6 +7869,31 @@ sortuniqMergeValuesDist(
                 return -1;
             }
 
+            if (num_distinct[fps_index] & UNIQ_SKETCH_FLAG) {
+                sketched = 1;
+            }
+        }
+        if (sketched) {
+            /* at least one file holds a sketch, so the result is a
+             * sketch */
+            if (uniqDistinctMergeSketches(
+                    &uniq->fi, dist, uniq->fps, file_ids, file_ids_len,
+                    num_distinct, uniq->sketch, uniq->err_fn))
+            {
+                return -1;
+            }
+            if (!output_fn) {
+                uniqTempWrite(uniq->dist_fp, uniq->sketch,
+                              UNIQ_SKETCH_REGISTERS(uniq->fi.sketch_bits));
+            }
+            continue;
+        }
+
+        /* for each file, read the first distinct value and store the
+         * index in the dist_heap using a comparitor over the distinct
+         * value */
+        for (j = 0; j < file_ids_len; ++j) {
+            fps_index = file_ids[j];
             if (num_distinct[fps_index]) {
                 if (!uniqTempRead(uniq->fps[fps_index + 1],
                                   uniq->distinct_value[fps_index],
@@ -6208,6 +8326,7 @@ skPresortedUniqueDestroy(
     if (u->distincts) {
         uniqDistinctFree(&u->fi, u->distincts);
     }
+    free(u->sketch);
 
     free(u);
 }
@@ -6255,6 +8374,31 @@ skPresortedUniqueSetErrorFunction(
 }
 
 
+/*  specify that distinct counts are estimated */
+int
+skPresortedUniqueSetDistinctApprox(
+    sk_sort_unique_t   *uniq,
+    unsigned int        precision)
+{
+    assert(uniq);
+
+    if (uniq->processing) {
+        return -1;
+    }
+    if (precision
+        && (precision < SK_UNIQUE_DISTINCT_APPROX_MIN
+            || precision > SK_UNIQUE_DISTINCT_APPROX_MAX))
+    {
+        uniq->err_fn("Precision %u is not between %d and %d",
+                     precision, SK_UNIQUE_DISTINCT_APPROX_MIN,
+                     SK_UNIQUE_DISTINCT_APPROX_MAX);
+        return -1;
+    }
+    uniq->distinct_approx = (uint8_t)precision;
+    return 0;
+}
+
+
 /*  set the temporary directory used by 'uniq' to 'temp_dir' */
 void
 skPresortedUniqueSetTempDirectory(
@@ -6363,6 +8507,7 @@ skPresortedUniqueProcess(
     if (uniqCheckFields(&uniq->fi, uniq->err_fn)) {
         return -1;
     }
+    uniq->fi.sketch_bits = uniq->distinct_approx;
 
     if (skTempFileInitialize(&uniq->tmpctx, uniq->temp_dir, NULL,uniq->err_fn))
     {
@@ -6371,7 +8516,7 @@ skPresortedUniqueProcess(
 
     /* set up distinct fields */
     if (uniq->fi.distinct_num_fields) {
-        if (uniqDistinctAlloc(&uniq->fi, &uniq->distincts)) {
+        if (uniqDistinctAlloc(&uniq->fi, &uniq->distincts, NULL)) {
             uniq->err_fn("Error allocating space for distinct counts");
             return -1;
         }
@@ -6384,6 +8529,15 @@ skPresortedUniqueProcess(
             uniq->err_fn("Error allocating distinct heap");
             return -1;
         }
+
+        if (uniq->fi.sketch_bits) {
+            uniq->sketch = (uint8_t*)malloc(
+                UNIQ_SKETCH_REGISTERS(uniq->fi.sketch_bits));
+            if (NULL == uniq->sketch) {
+                uniq->err_fn("Error allocating space for distinct counts");
+                return -1;
+            }
+        }
     }
 
     /* This outer loop is over the SiLK Flow input files and it
@@ -229,6 +229,18 @@ size_t
 skFieldListGetFieldCount(
     const sk_fieldlist_t   *field_list);
 
+/*
+ *  columns = skFieldListGetColumns(field_list);
+ *
+ *    Return the SK_COLUMN_* bits for the SiLK Flow record columns
+ *    that 'field_list' reads, for use with
+ *    skStreamSetColumnProjection().  Return SK_COLUMN_ALL when
+ *    'field_list' contains an SK_FIELD_CALLER field.
+ */
+uint32_t
+skFieldListGetColumns(
+    const sk_fieldlist_t   *field_list);
+
 /*
  *  size = skFieldListGetBufferSize(field_list);
  *
@@ -690,6 +702,130 @@ skUniqueSetErrorFunction(
     sk_unique_t        *uniq,
     sk_msg_fn_t         err_fn);
 
+/*
+ *    The maximum number of threads that skUniqueSetThreads() accepts.
+ */
+#define SK_UNIQUE_THREADS_MAX  64
+
+/*
+ *  ok = skUniqueSetThreads(uniq, thread_count);
+ *
+ *    Specify that the unique object 'uniq' should aggregate the
+ *    records using 'thread_count' threads.  skUniqueAddRecord()
+ *    assigns each record to a partition by a hash of its key, and a
+ *    separate thread aggregates each partition in its own hash table
+ *    and temporary files.  Since the partitions have no keys in
+ *    common, the iterator returns the bins of one partition after
+ *    another, or, when sorted output is requested, chooses the lowest
+ *    key across the partitions.  Without sorted output, the order of
+ *    the bins differs from that of a single thread.
+ *
+ *    A 'thread_count' of 0 or 1 disables the threads.  The fields
+ *    given to skUniqueSetFields() must be safe to use from multiple
+ *    threads.  This function must be called before calling
+ *    skUniquePrepareForInput(); it returns -1 if it is called
+ *    afterward or if 'thread_count' is larger than
+ *    SK_UNIQUE_THREADS_MAX.
+ */
+int
+skUniqueSetThreads(
+    sk_unique_t        *uniq,
+    uint32_t            thread_count);
+
+/*
+ *    The smallest memory limit that skUniqueSetMemoryLimit() accepts.
+ */
+#define SK_UNIQUE_MEMORY_LIMIT_MIN  0x100000
+
+/*
+ *  ok = skUniqueSetMemoryLimit(uniq, max_bytes);
+ *
+ *    Specify that the unique object 'uniq' should use no more than
+ *    approximately 'max_bytes' bytes for its hash table and the
+ *    structures that count distinct values.  The initial hash table
+ *    is sized to a fraction of the limit, the table grows only while
+ *    it fits, and the entries are written to a temporary file once
+ *    the limit is reached.  When threads are used, each partition
+ *    receives an equal share of the limit.  A 'max_bytes' of 0
+ *    removes the limit; the table then grows until memory is
+ *    exhausted or the table reaches its maximum size.  Use
+ *    skUniqueGetPeakMemory() to get the peak memory used.
+ *
+ *    This function must be called before calling
+ *    skUniquePrepareForInput(); it returns -1 if it is called
+ *    afterward or if 'max_bytes' is non-zero and less than
+ *    SK_UNIQUE_MEMORY_LIMIT_MIN.
+ */
+int
+skUniqueSetMemoryLimit(
+    sk_unique_t        *uniq,
+    uint64_t            max_bytes);
+
+/*
+ *  bytes = skUniqueGetPeakMemory(uniq);
+ *
+ *    Return the largest number of bytes that the hash table and the
+ *    structures that count distinct values of 'uniq' used while
+ *    records were added.  When threads are used, this is the sum of
+ *    the peaks of the partitions and is an upper bound.  The value is
+ *    only measured when a limit was given to skUniqueSetMemoryLimit()
+ *    or the SILK_UNIQUE_DEBUG environment variable is set, and it is
+ *    not complete until skUniquePrepareForOutput() has been called;
+ *    otherwise the function returns 0.
+ */
+uint64_t
+skUniqueGetPeakMemory(
+    const sk_unique_t  *uniq);
+
+/*
+ *    The smallest, largest, and default precision that
+ *    skUniqueSetDistinctApprox() accepts.
+ */
+#define SK_UNIQUE_DISTINCT_APPROX_MIN      4
+#define SK_UNIQUE_DISTINCT_APPROX_MAX      18
+#define SK_UNIQUE_DISTINCT_APPROX_DEFAULT  12
+
+/*
+ *  ok = skUniqueSetDistinctApprox(uniq, precision);
+ *
+ *    Specify that the unique object 'uniq' should estimate the number
+ *    of distinct values rather than count them exactly.  A distinct
+ *    field that is larger than one octet is counted exactly until a
+ *    key has seen more than a few dozen values; the values are then
+ *    folded into a HyperLogLog sketch of 2^'precision' one-octet
+ *    registers, and the key's count becomes an estimate whose
+ *    standard error is about 1.04/sqrt(2^'precision'): 1.6% for a
+ *    precision of 12 and 0.8% for 14.  Sketches are written to the
+ *    temporary files and are merged with other sketches and exact
+ *    values when the files are merged.  A 'precision' of 0 restores
+ *    exact counting.
+ *
+ *    This function must be called before calling
+ *    skUniquePrepareForInput(); it returns -1 if it is called
+ *    afterward or if 'precision' is non-zero and outside the range
+ *    SK_UNIQUE_DISTINCT_APPROX_MIN to SK_UNIQUE_DISTINCT_APPROX_MAX.
+ */
+int
+skUniqueSetDistinctApprox(
+    sk_unique_t        *uniq,
+    unsigned int        precision);
+
+/*
+ *  ok = skUniqueParseDistinctApprox(arg, &precision);
+ *
+ *    Parse the string 'arg', which names a method for estimating
+ *    distinct counts, and set 'precision' to the value to pass to
+ *    skUniqueSetDistinctApprox() or skPresortedUniqueSetDistinctApprox().
+ *    The only method is HyperLogLog, which is given as "hll" to use
+ *    SK_UNIQUE_DISTINCT_APPROX_DEFAULT or as "hll:p=N" to use a
+ *    precision of N.  Return 0 on success, or -1 if 'arg' is not
+ *    valid.
+ */
+int
+skUniqueParseDistinctApprox(
+    const char         *arg,
+    unsigned int       *precision);
+
 /*
  *  ok = skUniqueSetFields(uniq, keys, distincts, values);
  *
@@ -788,6 +924,57 @@ skUniqueAddRecord(
     sk_unique_t        *uniq,
     const rwRec        *rwrec);
 
+/*
+ *  ok = skUniqueAddPartial(uniq, stream, record_count);
+ *
+ *    Merge the bins in the partial aggregate file 'stream', which
+ *    skUniqueWritePartial() created, into the unique object 'uniq'.
+ *    'stream' must be open for reading and its header must not have
+ *    been read.  The values of a bin are merged with
+ *    skFieldListMergeBuffers(), and its distinct values are added to
+ *    the key's distinct counts, so the result is the same as if
+ *    'uniq' had read the records that made the file.  This function
+ *    may be called any number of times, and calls may be mixed with
+ *    calls to skUniqueAddRecord().  When 'record_count' is not NULL,
+ *    add to it the number of records that the bins in the file
+ *    summarize.
+ *
+ *    The file must have been written using the same key, value, and
+ *    distinct fields in the same order, on a machine having the same
+ *    byte order.  A file whose distinct counts were estimated may
+ *    only be added to an object estimating with the same precision.
+ *    Return -1 if the file differs, if it cannot be read, or if
+ *    'uniq' is using threads.  Otherwise, return 0.
+ */
+int
+skUniqueAddPartial(
+    sk_unique_t        *uniq,
+    skstream_t         *stream,
+    uint64_t           *record_count);
+
+/*
+ *  ok = skUniqueWritePartial(uniq, stream);
+ *
+ *    Write the bins in the unique object 'uniq' to 'stream' as a
+ *    partial aggregate file that skUniqueAddPartial() may merge with
+ *    other such files.  The file has a SiLK header of type
+ *    FT_RWAGGREGATE, the number of records the bins summarize, a
+ *    description of the fields, and, for each bin, the key, the
+ *    values, and the distinct values (or the registers of the sketch
+ *    estimating them) of each distinct field.  The number of records
+ *    counts the records given to skUniqueAddRecord() and those
+ *    summarized by the files given to skUniqueAddPartial().  'stream'
+ *    must be open for writing; this function writes the header.
+ *
+ *    This function must be called after skUniquePrepareForOutput()
+ *    and before skUniqueIteratorCreate().  Return 0 on success, or
+ *    -1 on failure.  Exit the application on write error.
+ */
+int
+skUniqueWritePartial(
+    sk_unique_t        *uniq,
+    skstream_t         *stream);
+
 /*
  *  ok = skUniqueIteratorCreate(uniq, &iter);
  *
@@ -976,6 +1163,19 @@ skPresortedUniqueSetErrorFunction(
     sk_sort_unique_t   *uniq,
     sk_msg_fn_t         err_fn);
 
+/*
+ *  ok = skPresortedUniqueSetDistinctApprox(ps_uniq, precision);
+ *
+ *    Specify that the unique object 'ps_uniq' should estimate the
+ *    number of distinct values as described in
+ *    skUniqueSetDistinctApprox().  It is an error to call this
+ *    function once skPresortedUniqueProcess() has been called.
+ */
+int
+skPresortedUniqueSetDistinctApprox(
+    sk_sort_unique_t   *ps_uniq,
+    unsigned int        precision);
+
 /*
  *  ok = skPresortedUniqueSetFields(ps_uniq, keys, distincts, values);
  *
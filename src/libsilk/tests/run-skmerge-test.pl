@@ -0,0 +1,12 @@
+#! /usr/bin/perl -w
+# MD5: 03cb2742bb1cf51e008fb8c0bfa26fa1
+# TEST: ./skmerge-test 2>&1
+
+use strict;
+use SiLKTests;
+
+my $skmerge_test = check_silk_app('skmerge-test');
+my $cmd = "$skmerge_test 2>&1";
+my $md5 = "03cb2742bb1cf51e008fb8c0bfa26fa1";
+
+check_md5_output($md5, $cmd);
@@ -7749,6 +7749,12 @@ silk_get_compression_methods(
 #endif
 #if SK_ENABLE_LZO
         "LZO1X",
+#endif
+#if SK_ENABLE_LZ4
+        "LZ4",
+#endif
+#if SK_ENABLE_ZSTD
+        "ZSTD",
 #endif
         NULL
     };
@@ -8259,6 +8265,8 @@ init_silkfile_module(
     PyModule_AddIntConstant(mod, "NO_COMPRESSION", SK_COMPMETHOD_NONE);
     PyModule_AddIntConstant(mod, "ZLIB", SK_COMPMETHOD_ZLIB);
     PyModule_AddIntConstant(mod, "LZO1X", SK_COMPMETHOD_LZO1X);
+    PyModule_AddIntConstant(mod, "LZ4", SK_COMPMETHOD_LZ4);
+    PyModule_AddIntConstant(mod, "ZSTD", SK_COMPMETHOD_ZSTD);
 
     PyModule_AddObject(mod, "BAG_COUNTER_MAX",
                        PyLong_FromUnsignedLongLong(SKBAG_COUNTER_MAX));
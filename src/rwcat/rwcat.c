@@ -101,17 +101,21 @@ static silk_endian_t byte_order = SILK_ENDIAN_ANY;
  * SK_IPV6POLICY_ASV4 */
 static sk_ipv6policy_t ipv6_policy = SK_IPV6POLICY_MIX;
 
+/* whether to write the output in the FT_RWCOLUMNAR format */
+static int columnar_output = 0;
+
 
 /* OPTIONS SETUP */
 
 typedef enum {
-    OPT_OUTPUT_PATH, OPT_BYTE_ORDER, OPT_IPV4_OUTPUT
+    OPT_OUTPUT_PATH, OPT_BYTE_ORDER, OPT_IPV4_OUTPUT, OPT_COLUMNAR_OUTPUT
 } appOptionsEnum;
 
 static struct option appOptions[] = {
     {"output-path",     REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {"byte-order",      REQUIRED_ARG, 0, OPT_BYTE_ORDER},
     {"ipv4-output",     NO_ARG,       0, OPT_IPV4_OUTPUT},
+    {"columnar-output", NO_ARG,       0, OPT_COLUMNAR_OUTPUT},
     {0,0,0,0}           /* sentinel entry */
 };
 
@@ -120,6 +124,7 @@ static const char *appHelp[] = {
     ("Write the output in this byte order. Def. 'native'.\n"
      "\tChoices: 'native', 'little', 'big'"),
     ("Force the output to contain only IPv4 addresses. Def. no"),
+    ("Write the output in the columnar file format. Def. no"),
     (char *)NULL
 };
 
@@ -285,6 +290,15 @@ appSetup(
     }
 #endif  /* SK_ENABLE_IPV6 */
 
+    if (columnar_output) {
+        rv = skHeaderSetFileFormat(out_hdr, FT_RWCOLUMNAR);
+        if (rv) {
+            skStreamPrintLastErr(out_ios, rv, &skAppPrintErr);
+            skStreamDestroy(&out_ios);
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /* set the header, add the notes (if given), open output, and
      * write header */
     if ((rv = skHeaderSetCompressionMethod(out_hdr, comp_method))
@@ -352,6 +366,10 @@ appOptionsHandler(
       case OPT_IPV4_OUTPUT:
         ipv6_policy = SK_IPV6POLICY_ASV4;
         break;
+
+      case OPT_COLUMNAR_OUTPUT:
+        columnar_output = 1;
+        break;
     } /* switch */
 
     return 0;                     /* OK */
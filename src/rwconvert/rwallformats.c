@@ -105,6 +105,7 @@ static unsigned int stream_format[] = {
     FT_RWAUGROUTING,
     FT_RWAUGWEB,
     FT_RWAUGSNMPOUT,
+    FT_RWCOLUMNAR,
     FT_RWFILTER,
     FT_RWGENERIC,
     FT_RWIPV6,
@@ -13,6 +13,7 @@ $NAME =~ s,.*/,,;
 my $rwallformats = check_silk_app('rwallformats');
 my $rwfilter = check_silk_app('rwfilter');
 my $rwfileinfo = check_silk_app('rwfileinfo');
+my $rwcut = check_silk_app('rwcut');
 my %file;
 $file{data} = get_data_or_exit77('data');
 
@@ -26,6 +27,12 @@ if (!check_exit_status($cmd)) {
     exit 1;
 }
 
+# the files in the columnar format must read back as the input did
+my $cut_args = ("--fields=1-15,20,21,26-29 --ipv6-policy=ignore"
+                ." --timestamp-format=epoch --ip-format=decimal --delimited");
+my $input_md5;
+compute_md5(\$input_md5, "$rwfilter --stime=2009/02/13:20:00-2009/02/13:20 --sensor=S2 --proto=6 --aport=80,8080,443 --pass=stdout $file{data} | $rwcut $cut_args", 0);
+
 # get list of expected MD5s for each file from the end of this file;
 # some files have multiple checksums due to differences in LZO
 my %checksums;
@@ -42,6 +49,12 @@ while (<DATA>) {
     elsif (!$SiLKTests::SK_ENABLE_LZO && $tail_name =~ /-c2-/) {
         # skip
     }
+    elsif (!$SiLKTests::SK_ENABLE_LZ4 && $tail_name =~ /-c3-/) {
+        # skip
+    }
+    elsif (!$SiLKTests::SK_ENABLE_ZSTD && $tail_name =~ /-c4-/) {
+        # skip
+    }
     else {
         $checksums{$tail_name} = [$expect];
     }
@@ -51,6 +64,8 @@ while (<DATA>) {
 my @mismatch;
 # array to store names of files that are unknown to this script
 my @unknown;
+# array to store names of columnar files that do not read back
+my @unreadable;
 
 # find the files in the data directory and compare their MD5 hashes
 File::Find::find({wanted => \&check_file, no_chdir => 1}, $tmpdir);
@@ -71,6 +86,13 @@ if (@mismatch) {
     }
 }
 
+# print names of columnar files whose records differ from the input
+if (@unreadable) {
+    die("$NAME: Records differ from the input in ", scalar(@unreadable),
+        " columnar file", ((@unreadable == 1) ? "" : "s"), ": ",
+        join(", ", @unreadable), "\n");
+}
+
 # print names of unknown files
 if (@unknown) {
     my $max = 2;
@@ -131,6 +153,15 @@ sub check_file
     delete $checksums{$tail_name};
 
     my $md5;
+    if ($tail_name =~ /^FT_RWCOLUMNAR-/) {
+        compute_md5(\$md5, "$rwcut $cut_args $path", 0);
+        if ($md5 ne $input_md5) {
+            push @unreadable, $tail_name;
+        }
+    }
+    # a checksum of "-" means the file is only checked by reading it
+    return if $sums[0] eq '-';
+
     compute_md5(\$md5, "cat $path", 0);
     return if grep {$_ eq $md5} @sums;
     push @mismatch, $tail_name;
@@ -144,366 +175,622 @@ aad19fce22233c7766afcb5bacc72148  FT_FLOWCAP-v2-c0-L.dat
 735b483a42705c8ed0338290af7058fd  FT_FLOWCAP-v2-c1-L.dat
 17328ebc0908190bd40d55f25bc23dc6  FT_FLOWCAP-v2-c2-B.dat
 17452fc1de6627ec5bee7c9943bd08b3  FT_FLOWCAP-v2-c2-L.dat
+a9a3a89f9c4fa2f0e3c9aa7fe24da428  FT_FLOWCAP-v2-c3-B.dat
+28bcfc60ded9333e625ea5aeac9b3d78  FT_FLOWCAP-v2-c3-L.dat
+6a9d21ab30fa7359ccd569a5e5eeb5ea  FT_FLOWCAP-v2-c4-B.dat
+96fe88bf85480dc28781e72a939ddb63  FT_FLOWCAP-v2-c4-L.dat
 cee1b1f74822b31a7441a8211fa5bfed  FT_FLOWCAP-v3-c0-B.dat
 a93c68d3143fe1f5c341f56ab860492b  FT_FLOWCAP-v3-c0-L.dat
 86dca7d5924c99c676f2613b9a655fdc  FT_FLOWCAP-v3-c1-B.dat
 ffe123fdb7dd8e01099575c3f9219ba3  FT_FLOWCAP-v3-c1-L.dat
 2aab9a2a193d09ac293e5a60c0853a73  FT_FLOWCAP-v3-c2-B.dat
 085b796186e4392ff8df1436bf5b57f0  FT_FLOWCAP-v3-c2-L.dat
+b1bf2bc7bf340b60ecaf5b04611de8fa  FT_FLOWCAP-v3-c3-B.dat
+f1427d2f912447c21c70e726ace73b8a  FT_FLOWCAP-v3-c3-L.dat
+71d95b9de1c42879c40fbf45f9ae7bea  FT_FLOWCAP-v3-c4-B.dat
+0044ad746890b52e809fce956757e9c7  FT_FLOWCAP-v3-c4-L.dat
 ca48fd33ad7dd52b39b2fd7845c5068c  FT_FLOWCAP-v4-c0-B.dat
 be8884450fa255feafb1c29237543abe  FT_FLOWCAP-v4-c0-L.dat
 c18e37c1d921c4085a9a468c034d4cec  FT_FLOWCAP-v4-c1-B.dat
 a816fd63f0e0679318620f6df349ff1a  FT_FLOWCAP-v4-c1-L.dat
 cc5788bf9bd9170c8e1866133b9db791  FT_FLOWCAP-v4-c2-B.dat
 7268776400d7f2e33b9be03dd119a989  FT_FLOWCAP-v4-c2-L.dat
+8f778ee19fe2d748df60700bdf81a58d  FT_FLOWCAP-v4-c3-B.dat
+09cfed2178ef78bb8055928c9315826c  FT_FLOWCAP-v4-c3-L.dat
+49445c6511acbac656769396ff9a997d  FT_FLOWCAP-v4-c4-B.dat
+ae5e647348b1193d4f5bde90a046f2f6  FT_FLOWCAP-v4-c4-L.dat
 7528be67c52e6f0dd5752ef39d9a8c8e  FT_FLOWCAP-v5-c0-B.dat
 a85ad2f2bdb42130027602e743bdc04c  FT_FLOWCAP-v5-c0-L.dat
 adb12ec96e46e3d7afd7cbb8dc2b0260  FT_FLOWCAP-v5-c1-B.dat
 345a487a83ff21b06dd5c4b50446998a  FT_FLOWCAP-v5-c1-L.dat
 375dbf3a0b1d7eb32d2873405ed78f20  FT_FLOWCAP-v5-c2-B.dat
 f52996762d83f050fe0e95bbb47c0a16  FT_FLOWCAP-v5-c2-L.dat
+386ff0647f117fc00601bafe4cd90a81  FT_FLOWCAP-v5-c3-B.dat
+f4a4d6b86b08d95196bd26ed580078cc  FT_FLOWCAP-v5-c3-L.dat
+6e1a83f814ce535ebba6e230fc947e69  FT_FLOWCAP-v5-c4-B.dat
+5eeb0ee22740a6e97c7dbf002c48e491  FT_FLOWCAP-v5-c4-L.dat
 c1cc1ca72b1732d6ffb2f2c2085d4c89  FT_FLOWCAP-v6-c0-B.dat
 02580d776eb78efbc269641247589afd  FT_FLOWCAP-v6-c0-L.dat
 259634b5542115cd8fb92ff156eaca2c  FT_FLOWCAP-v6-c1-B.dat
 16c8f6e3d0792de285a86af6b00ed723  FT_FLOWCAP-v6-c1-L.dat
 8cf761c5a5f90a5ee76e2302d61946c4  FT_FLOWCAP-v6-c2-B.dat
 64329ca995c82e4f2df92af5338c4693  FT_FLOWCAP-v6-c2-L.dat
+af02bbd11b3560625922a60f75029e7b  FT_FLOWCAP-v6-c3-B.dat
+cb53c751e5fd960855e135aea82faee8  FT_FLOWCAP-v6-c3-L.dat
+ce1f7791bd1420b8f342e3038fbde581  FT_FLOWCAP-v6-c4-B.dat
+15a1c59bf2b07af79635b856844b91a7  FT_FLOWCAP-v6-c4-L.dat
 4a50279ac5644e9303abed48e86932e9  FT_RWAUGMENTED-v1-c0-B.dat
 3bf9a754b721f9baed5430524a81367c  FT_RWAUGMENTED-v1-c0-L.dat
 a5e5d3717c3ff3392677b15620167b9f  FT_RWAUGMENTED-v1-c1-B.dat
 45cac95bc7c791923aab9feaabfa2c5b  FT_RWAUGMENTED-v1-c1-L.dat
 b1f2ef65432af17c8c23eae012e5e677  FT_RWAUGMENTED-v1-c2-B.dat
 8055ba43f57bccb4237d21abd815949b  FT_RWAUGMENTED-v1-c2-L.dat
+9394fe5cc33ce9113713b2bd9079da4d  FT_RWAUGMENTED-v1-c3-B.dat
+74dac7dcd94c42165945849783eb9028  FT_RWAUGMENTED-v1-c3-L.dat
+2786ffaea29f24a7b74ba13c630fe539  FT_RWAUGMENTED-v1-c4-B.dat
+407927c63b2f3ab61a789402bd6070cd  FT_RWAUGMENTED-v1-c4-L.dat
 373b4efb3dcd689d43bd1a872d8a0b82  FT_RWAUGMENTED-v2-c0-B.dat
 e49b4d08689b220153101d6a306fa144  FT_RWAUGMENTED-v2-c0-L.dat
 cd2058d07fdf08190ddd1ba70dc9ed19  FT_RWAUGMENTED-v2-c1-B.dat
 49476b3038a4dec8aad8de2bb731d2e9  FT_RWAUGMENTED-v2-c1-L.dat
 42377ff91107814405349029e54c96a5  FT_RWAUGMENTED-v2-c2-B.dat
 f21bcd9349a304f81195f947b151880b  FT_RWAUGMENTED-v2-c2-L.dat
+4992c0ae56ff1d4a0b37d751e5638ef6  FT_RWAUGMENTED-v2-c3-B.dat
+17523c67ddc72e3ee1c9c87a712e51e2  FT_RWAUGMENTED-v2-c3-L.dat
+155a6a9f502295a5a53176f906240664  FT_RWAUGMENTED-v2-c4-B.dat
+c53237b30d8f2df3b8a496e49ae7efb4  FT_RWAUGMENTED-v2-c4-L.dat
 b2bd70fb60cfcb7f61e928508b2fcbb0  FT_RWAUGMENTED-v3-c0-B.dat
 dd3828107a232b67e074d3b2883d2ca1  FT_RWAUGMENTED-v3-c0-L.dat
 564cadb0881704e57e641acdca8d2505  FT_RWAUGMENTED-v3-c1-B.dat
 55febe0cad038fc447683285a22dffda  FT_RWAUGMENTED-v3-c1-L.dat
 028414eca3693c58658c21a5d74a0756  FT_RWAUGMENTED-v3-c2-B.dat
 5b3da2eb1dbb9720ae439bbaaaa8d2d7  FT_RWAUGMENTED-v3-c2-L.dat
+7570707115c3680e6a21dba565f9f11d  FT_RWAUGMENTED-v3-c3-B.dat
+668741e2b023b4e4eb077d23339231b9  FT_RWAUGMENTED-v3-c3-L.dat
+ff2c7208fb3db94632a9e16c006c417f  FT_RWAUGMENTED-v3-c4-B.dat
+139e67eba13254ecc61a1364051196fa  FT_RWAUGMENTED-v3-c4-L.dat
 262f51d3ae0f756e0127aa08538519b1  FT_RWAUGMENTED-v4-c0-B.dat
 144aba6d77cd68ea8370460f74a4461c  FT_RWAUGMENTED-v4-c0-L.dat
 92093094295a885840f97b1c836ea23d  FT_RWAUGMENTED-v4-c1-B.dat
 0c76232bc7fdb51a19d95ccec8677d18  FT_RWAUGMENTED-v4-c1-L.dat
 15e7a96c911a2c0a7c369a62612d4ce0  FT_RWAUGMENTED-v4-c2-B.dat
 345545ae3004e0db2b2a8f352e079876  FT_RWAUGMENTED-v4-c2-L.dat
+9ef29b39adf06b19cacf6ccb69ec9b91  FT_RWAUGMENTED-v4-c3-B.dat
+05bd9df2d31443b675ba202ac18d28b6  FT_RWAUGMENTED-v4-c3-L.dat
+1a06b3dcea6c8a8a3713a4f7ccee7d78  FT_RWAUGMENTED-v4-c4-B.dat
+b5d5533c6f50d50c80ad022311b73583  FT_RWAUGMENTED-v4-c4-L.dat
 a837739733c2ff3df2148bb5cd4947af  FT_RWAUGMENTED-v5-c0-B.dat
 d2480d6252e5efe1ec04b1a1bde56241  FT_RWAUGMENTED-v5-c0-L.dat
 df4441021aaf12ce64736a4bce232359  FT_RWAUGMENTED-v5-c1-B.dat
 0faa9c6d01d0a335f94dcc6aabfac87d  FT_RWAUGMENTED-v5-c1-L.dat
 4fe6788bdd83da5e25723649ace4aca4  FT_RWAUGMENTED-v5-c2-B.dat
 8da2469163cd8f18965ad1cccfedb138  FT_RWAUGMENTED-v5-c2-L.dat
+e61aa490aa1a2b367861a00d710853d7  FT_RWAUGMENTED-v5-c3-B.dat
+e14718ea5c6c8f4ec1b71501129de79e  FT_RWAUGMENTED-v5-c3-L.dat
+c71f6cc0c503b280fb6d1512350e3c24  FT_RWAUGMENTED-v5-c4-B.dat
+0bbbcc4c9d002f687dd8a67a08249327  FT_RWAUGMENTED-v5-c4-L.dat
 98f941dd108eb9adb6cd2345e84f3446  FT_RWAUGROUTING-v1-c0-B.dat
 142535ea5803b315fe462c577f489981  FT_RWAUGROUTING-v1-c0-L.dat
 385a009413348bd9907bc4ee9b42971d  FT_RWAUGROUTING-v1-c1-B.dat
 9e1a77905d37ab7b0b09e0451c8957ba  FT_RWAUGROUTING-v1-c1-L.dat
 f0345fe39fa5ba8c2850e1d0fc7e3512  FT_RWAUGROUTING-v1-c2-B.dat
 b2ce0a2060dd7394e18e44ab8479739d  FT_RWAUGROUTING-v1-c2-L.dat
+66213a086f85cbb48f9a7a29a78cee0e  FT_RWAUGROUTING-v1-c3-B.dat
+d44399c8625da3a0d44b630a3c092283  FT_RWAUGROUTING-v1-c3-L.dat
+1094b1f86b969c6e4957f7f181249dcf  FT_RWAUGROUTING-v1-c4-B.dat
+5210ddfea5a8eaf4f2f1609698910036  FT_RWAUGROUTING-v1-c4-L.dat
 6c15e70f39c472ce767cb980b60f0906  FT_RWAUGROUTING-v2-c0-B.dat
 75399a83966d3aaee25fab55e6880670  FT_RWAUGROUTING-v2-c0-L.dat
 83c2f84eff7b0d9bf60d2ce8c754cf0b  FT_RWAUGROUTING-v2-c1-B.dat
 6378188823a34aaf9e410ec3ebca6662  FT_RWAUGROUTING-v2-c1-L.dat
 fee5b7e3606874f0547bf24980cec47e  FT_RWAUGROUTING-v2-c2-B.dat
 b0e1615a33b13a784c88fe4bc5d4760d  FT_RWAUGROUTING-v2-c2-L.dat
+5253f86e110cb39a421e0c2467da640e  FT_RWAUGROUTING-v2-c3-B.dat
+117e7275ebe0f9874efe37e1b723044c  FT_RWAUGROUTING-v2-c3-L.dat
+0896b0e7b380c75c6f4b1487efb8a614  FT_RWAUGROUTING-v2-c4-B.dat
+1a69de211cf297d85dfb016dd1d4f9c4  FT_RWAUGROUTING-v2-c4-L.dat
 38de6be29e51e2ae9612ad38ad13c38d  FT_RWAUGROUTING-v3-c0-B.dat
 f6de88739278985c7b8f3b4e3b359d0f  FT_RWAUGROUTING-v3-c0-L.dat
 c4ff7dc4cb28933647ca1ad9a2383850  FT_RWAUGROUTING-v3-c1-B.dat
 bcfd975c66e9166a95b28b76cd1c49a9  FT_RWAUGROUTING-v3-c1-L.dat
 2b2187ed21d638f88432e31441a9b8be  FT_RWAUGROUTING-v3-c2-B.dat
 af234bd2185ae67b6ee988bf7b3ffb25  FT_RWAUGROUTING-v3-c2-L.dat
+3bdc473ce0a7e6f1b8a9bb654ba8e73b  FT_RWAUGROUTING-v3-c3-B.dat
+642884a51c161c4831633132441d6ec5  FT_RWAUGROUTING-v3-c3-L.dat
+f7866d94b3562d1ceffa22acd440ba47  FT_RWAUGROUTING-v3-c4-B.dat
+46a403918606e92b88d11d4b97a23e87  FT_RWAUGROUTING-v3-c4-L.dat
 c971232239be750b0ce8ef6078955f9a  FT_RWAUGROUTING-v4-c0-B.dat
 bac0c79592ffa00c6cfe37af3aee49a6  FT_RWAUGROUTING-v4-c0-L.dat
 053445f125f46dc694c60bb8981f7b92  FT_RWAUGROUTING-v4-c1-B.dat
 ed5bdbdddf969a7717cc6c4e29d6b1a7  FT_RWAUGROUTING-v4-c1-L.dat
 1958a0255faea25ff0309ac0c33f2e6f  FT_RWAUGROUTING-v4-c2-B.dat
 378a8c3a4ce5507ff77ed4205eb2e1b9  FT_RWAUGROUTING-v4-c2-L.dat
+23a0b319a109f550e8fdd9884bd9a9d0  FT_RWAUGROUTING-v4-c3-B.dat
+c2dcfe24277ac76ffdbb6d8f582112f1  FT_RWAUGROUTING-v4-c3-L.dat
+fdd26955f41ab8f46a517d0d2526085a  FT_RWAUGROUTING-v4-c4-B.dat
+e7575cfe0e8dfa47e74f68c4209bbd3e  FT_RWAUGROUTING-v4-c4-L.dat
 f5eb6d15777dd5ce35a31b5869f0b3bc  FT_RWAUGROUTING-v5-c0-B.dat
 0ccdac22beb624a192afca1b1dbb6e48  FT_RWAUGROUTING-v5-c0-L.dat
 1f927fbb39227e6787d8d5c9d980fb89  FT_RWAUGROUTING-v5-c1-B.dat
 9327907535e2f22f3be63ac80bb50c6e  FT_RWAUGROUTING-v5-c1-L.dat
 c280bc817bd45b18a4d215c6a42ca6d8  FT_RWAUGROUTING-v5-c2-B.dat
 040ee413492170a753c1bc77d98c34c6  FT_RWAUGROUTING-v5-c2-L.dat
+3f7ad3425ebf8e20ec3f120f511c7a4d  FT_RWAUGROUTING-v5-c3-B.dat
+39064121f2afeb2b71866fe5546363af  FT_RWAUGROUTING-v5-c3-L.dat
+5354ae0350f56c080346f0bdaeae84bd  FT_RWAUGROUTING-v5-c4-B.dat
+0d601ecef01a66baede505e4df84fb9d  FT_RWAUGROUTING-v5-c4-L.dat
 149c0f889c54d264053645ed0f02931a  FT_RWAUGSNMPOUT-v1-c0-B.dat
 0cd1a08bdc4ddc2aac2192a84d7141d9  FT_RWAUGSNMPOUT-v1-c0-L.dat
 7b252a5581fd720576dd48b707720c4a  FT_RWAUGSNMPOUT-v1-c1-B.dat
 0753e9733faa189a22f75f7190a5e29e  FT_RWAUGSNMPOUT-v1-c1-L.dat
 d2956ea1e10a511257265490d46cdec0  FT_RWAUGSNMPOUT-v1-c2-B.dat
 5d3b367607de68d1a2de072bdecfb870  FT_RWAUGSNMPOUT-v1-c2-L.dat
+8daa603a448bd5747c45e8b524683b45  FT_RWAUGSNMPOUT-v1-c3-B.dat
+b338873b6acc5b8381505ff4b0b28b7c  FT_RWAUGSNMPOUT-v1-c3-L.dat
+963d2bd33b38d80fee4e5af7118f1f54  FT_RWAUGSNMPOUT-v1-c4-B.dat
+316b7999fb13e62a87ad1d20ed887cf3  FT_RWAUGSNMPOUT-v1-c4-L.dat
 ae2efb2041e4b72ef737de7c22a0018d  FT_RWAUGSNMPOUT-v2-c0-B.dat
 d736603959b74a839365489823f37354  FT_RWAUGSNMPOUT-v2-c0-L.dat
 3a7a9ee77c5572e850274c82d2caa238  FT_RWAUGSNMPOUT-v2-c1-B.dat
 adc9b15e3e734d3786172a192b36ad22  FT_RWAUGSNMPOUT-v2-c1-L.dat
 85ab41120bc52410764b37d5331e0df7  FT_RWAUGSNMPOUT-v2-c2-B.dat
 d7d2d6dfd254167b8c866bea1d713340  FT_RWAUGSNMPOUT-v2-c2-L.dat
+7998df9197748b5c5e050677daa0bf03  FT_RWAUGSNMPOUT-v2-c3-B.dat
+14a8b9307363abd31ec68a7dd38c10bd  FT_RWAUGSNMPOUT-v2-c3-L.dat
+ccce156daa4656ac59282fff9818b433  FT_RWAUGSNMPOUT-v2-c4-B.dat
+734f4b3e71344ec0ad1908d396a2b165  FT_RWAUGSNMPOUT-v2-c4-L.dat
 a3bd51c268884138d6264aaa648fb345  FT_RWAUGSNMPOUT-v3-c0-B.dat
 3143664e6fa8a9f234d1aad9af982ece  FT_RWAUGSNMPOUT-v3-c0-L.dat
 c5896cb89ebb0f8f2d0283beb8f870f6  FT_RWAUGSNMPOUT-v3-c1-B.dat
 96ddce6ce8f6c771813c37e25ecd7823  FT_RWAUGSNMPOUT-v3-c1-L.dat
 e9b386334dcdbf368301499546d1ac21  FT_RWAUGSNMPOUT-v3-c2-B.dat
 2e42052b89abfb6807e28bca0c5773f6  FT_RWAUGSNMPOUT-v3-c2-L.dat
+f67e1193d910fa8f8721ffa1904f0fda  FT_RWAUGSNMPOUT-v3-c3-B.dat
+e8a1c47995a4c52f9ef4af6c9c9ce638  FT_RWAUGSNMPOUT-v3-c3-L.dat
+e776a124f186142d9c921f6cd839373c  FT_RWAUGSNMPOUT-v3-c4-B.dat
+f180a42be09ef62df5a0dd6f278e3ef1  FT_RWAUGSNMPOUT-v3-c4-L.dat
 2c877ee05351789df6aa8059311278c1  FT_RWAUGSNMPOUT-v4-c0-B.dat
 8bd3676ddb668cb8024ef9a8dc2bb2f3  FT_RWAUGSNMPOUT-v4-c0-L.dat
 5d42754bbf97415a1c20954b4416e615  FT_RWAUGSNMPOUT-v4-c1-B.dat
 e3e4ca6136c8541600b1178c508dde73  FT_RWAUGSNMPOUT-v4-c1-L.dat
 28ff462463d46cdf67eae9d1c4cab296  FT_RWAUGSNMPOUT-v4-c2-B.dat
 eb30d1b37ef7b04f0a019339e890d1a4  FT_RWAUGSNMPOUT-v4-c2-L.dat
+ad57d81f02c1c16db3f9e35166775838  FT_RWAUGSNMPOUT-v4-c3-B.dat
+83a4362ff37823da984e90fffe2ccabd  FT_RWAUGSNMPOUT-v4-c3-L.dat
+71458a80dd6e4b367626f1daecd65948  FT_RWAUGSNMPOUT-v4-c4-B.dat
+9c237ac45af971fb342482facc585673  FT_RWAUGSNMPOUT-v4-c4-L.dat
 518c0691f788ef76fb71fe58d3d921b3  FT_RWAUGSNMPOUT-v5-c0-B.dat
 0fe6d5e27c443f63a5a31e7045189e19  FT_RWAUGSNMPOUT-v5-c0-L.dat
 d4b8d59f94c25fb0ed1c75c5ffd333a1  FT_RWAUGSNMPOUT-v5-c1-B.dat
 34ebc0473675b006a1c324276b5bf40c  FT_RWAUGSNMPOUT-v5-c1-L.dat
 9ff94772e1145cd86e74d6097284c86a  FT_RWAUGSNMPOUT-v5-c2-B.dat
 56620fa7b835ef1a9259876be4a9d5c5  FT_RWAUGSNMPOUT-v5-c2-L.dat
+a51b7ca0d80db47372b14209ed6f8e19  FT_RWAUGSNMPOUT-v5-c3-B.dat
+028c2772ca7b0b9d7b0219193fa06b90  FT_RWAUGSNMPOUT-v5-c3-L.dat
+295a5d1225f9fd82dd48296e0e6b083c  FT_RWAUGSNMPOUT-v5-c4-B.dat
+a217aef1b67eda9f31229482df2be1cb  FT_RWAUGSNMPOUT-v5-c4-L.dat
 3e8a44d3508c1759901f66681433b28a  FT_RWAUGWEB-v1-c0-B.dat
 242d72f8797f1bfd645f95d0863dda01  FT_RWAUGWEB-v1-c0-L.dat
 258e9e083d17f50ff5254e768f8ae1b3  FT_RWAUGWEB-v1-c1-B.dat
 4d51c8409541472060562b96e0b88b3d  FT_RWAUGWEB-v1-c1-L.dat
 2af82b075b071d77133155e417a7838f  FT_RWAUGWEB-v1-c2-B.dat
 fc29b6b2b7d8073abeb4f2e44b16e16a  FT_RWAUGWEB-v1-c2-L.dat
+92324bd5c218e7dc4db10b108db6b566  FT_RWAUGWEB-v1-c3-B.dat
+346db9613aef3d411c8d955bdd5da69e  FT_RWAUGWEB-v1-c3-L.dat
+44c27ebf947d66791893af154531cead  FT_RWAUGWEB-v1-c4-B.dat
+736a22a74596043f8c23915a810486a5  FT_RWAUGWEB-v1-c4-L.dat
 fb8842cf8fc017d74ddf481bcfeccc3c  FT_RWAUGWEB-v2-c0-B.dat
 10a7545e53e6359186ec43e9625911df  FT_RWAUGWEB-v2-c0-L.dat
 9e5906f38d5ac464bce779618b26adac  FT_RWAUGWEB-v2-c1-B.dat
 1af8a48b20bb309da7f099535a02faad  FT_RWAUGWEB-v2-c1-L.dat
 0db77a6c2e5d9503c5150656b19b2dc4  FT_RWAUGWEB-v2-c2-B.dat
 147f54af0fe2c71c574a541e41caba89  FT_RWAUGWEB-v2-c2-L.dat
+81f4acfb7f9ab3f36f8e59f47c06fa6d  FT_RWAUGWEB-v2-c3-B.dat
+3b8b4addfb0bc4ba42999e9ff938c88f  FT_RWAUGWEB-v2-c3-L.dat
+69b921548a9ffd6a6881668ecc3a72b4  FT_RWAUGWEB-v2-c4-B.dat
+78db8c64094b58caaced1e410a97dd1c  FT_RWAUGWEB-v2-c4-L.dat
 0dbcf4148f9ef1d5134b60032d8f955c  FT_RWAUGWEB-v3-c0-B.dat
 1b60b8c8a9d5d7208956e4b0a0e65c50  FT_RWAUGWEB-v3-c0-L.dat
 8917f6d3683d6a8eea94bf2c24d16387  FT_RWAUGWEB-v3-c1-B.dat
 56e77c0ddee1e255c861b7c404447878  FT_RWAUGWEB-v3-c1-L.dat
 3369dd55203b75c770a2b6a6b7c3ec54  FT_RWAUGWEB-v3-c2-B.dat
 1701fbb1ac43031ceb4ffe3828b48c05  FT_RWAUGWEB-v3-c2-L.dat
+f3949cd38472fd73a2a26fa970b5fc63  FT_RWAUGWEB-v3-c3-B.dat
+d684b447f454faf477c851369c22911d  FT_RWAUGWEB-v3-c3-L.dat
+fa10e134c76a6f75bc8417392d3a8620  FT_RWAUGWEB-v3-c4-B.dat
+103c283aa25f3195c0c69d339d12c36a  FT_RWAUGWEB-v3-c4-L.dat
 d6b90b5d7a3c9a97a03d0e2c9f583f42  FT_RWAUGWEB-v4-c0-B.dat
 539b181b898acd59e463ff779a7c059e  FT_RWAUGWEB-v4-c0-L.dat
 8d7523adafeb5364c66eba36dca77c80  FT_RWAUGWEB-v4-c1-B.dat
 f60be431bbee22799abe42c0990ff8b4  FT_RWAUGWEB-v4-c1-L.dat
 6bd8f17373a7eb9b203123618435058b  FT_RWAUGWEB-v4-c2-B.dat
 d899792cdebb3ec7017326ea9c07ce81  FT_RWAUGWEB-v4-c2-L.dat
+22e38e38fda48ee2860b48389d6eba4b  FT_RWAUGWEB-v4-c3-B.dat
+14d17e25077347750c7836596a2894fa  FT_RWAUGWEB-v4-c3-L.dat
+6edb14355cfd8dcd34ab77886a3c9089  FT_RWAUGWEB-v4-c4-B.dat
+672fb1c395160cb9193f96005068d959  FT_RWAUGWEB-v4-c4-L.dat
 1ff83fc66e0f959967fbe7fc94068071  FT_RWAUGWEB-v5-c0-B.dat
 f958d7a2d8f5522802a714934a0fc38e  FT_RWAUGWEB-v5-c0-L.dat
 be5e60a075f8371045a66157b34271f0  FT_RWAUGWEB-v5-c1-B.dat
 a4609989704d4904e94ad83ed79b55d0  FT_RWAUGWEB-v5-c1-L.dat
 84a277ff0adebe0d72221f3c03770605  FT_RWAUGWEB-v5-c2-B.dat
 de709ae76c4326f845b4f9c908a93f93  FT_RWAUGWEB-v5-c2-L.dat
+0ef2f33199cc48e18c55b81657617dd7  FT_RWAUGWEB-v5-c3-B.dat
+f322d53d37805ab81c0fff0ff202a2d9  FT_RWAUGWEB-v5-c3-L.dat
+50bf41ba9d509422aabdbd654e4979a0  FT_RWAUGWEB-v5-c4-B.dat
+c2685108cc3abd9a758ba13a8e1f5b37  FT_RWAUGWEB-v5-c4-L.dat
+68231af092a15894531042b192ce1189  FT_RWCOLUMNAR-v1-c0-B.dat
+cfc4bc88660277dcb9b198590fa7c540  FT_RWCOLUMNAR-v1-c0-L.dat
+421572869134570757146da169cb26ac  FT_RWCOLUMNAR-v1-c1-B.dat
+3166687703a3cb7817f0e84553f293d7  FT_RWCOLUMNAR-v1-c1-L.dat
+# the bytes of an LZO-compressed columnar file depend on the version
+# of the LZO library; check those files only by reading them
+-                                 FT_RWCOLUMNAR-v1-c2-B.dat
+-                                 FT_RWCOLUMNAR-v1-c2-L.dat
+d52d7b595aa2ad12389235b15b73c38e  FT_RWCOLUMNAR-v1-c3-B.dat
+dbec77f724c00a4f222ff293f13174c9  FT_RWCOLUMNAR-v1-c3-L.dat
+f60a879e05e627a2600c030c43b8ec8f  FT_RWCOLUMNAR-v1-c4-B.dat
+f0e992fb8552623dca6da719d9ea029e  FT_RWCOLUMNAR-v1-c4-L.dat
 6986dfb3ca505b391d5f9fa9be1cda30  FT_RWFILTER-v1-c0-B.dat
 cea530e72ae2b25052dbc5e96d9d0aa5  FT_RWFILTER-v1-c0-L.dat
 091cf3a98cf8c1ec3d30e1d3f4936b7a  FT_RWFILTER-v1-c1-B.dat
 78ca148b710d9cb00105aa4f8c0a1cc1  FT_RWFILTER-v1-c1-L.dat
 f714e7a5380e16cb1fd7cb81d7c1a20b  FT_RWFILTER-v1-c2-B.dat
 103f8d51add43fe1cf1f1e6e5ec0b765  FT_RWFILTER-v1-c2-L.dat
+331b25fe6dccb7670b038c33cf0d810d  FT_RWFILTER-v1-c3-B.dat
+fd1b92ea52d55fa35b140dcdcb308dda  FT_RWFILTER-v1-c3-L.dat
+3fcb5f452df10cc2474c2dd0d50da0f1  FT_RWFILTER-v1-c4-B.dat
+f8ca2e48ecf18592db37d9ccc7cb713b  FT_RWFILTER-v1-c4-L.dat
 c1fc3a70265e72fbebe417ef8d675093  FT_RWFILTER-v2-c0-B.dat
 d64003c3c6d3abed3c0df4db0529fd7b  FT_RWFILTER-v2-c0-L.dat
 26c4e838cdeb201d791727e112fb96d8  FT_RWFILTER-v2-c1-B.dat
 3987ba7f0b485dce4b65ff0d6fbe2d2a  FT_RWFILTER-v2-c1-L.dat
 264217bbf4768eb9b5a7b2304ed71c21  FT_RWFILTER-v2-c2-B.dat
 9838648a479719d6c891832cb8b8d42d  FT_RWFILTER-v2-c2-L.dat
+b86485402ab9c9d846520ced12b938a3  FT_RWFILTER-v2-c3-B.dat
+91f8fc4802cae45d24dfba34563f452d  FT_RWFILTER-v2-c3-L.dat
+935c6146326d2bc533320b614eb66b0c  FT_RWFILTER-v2-c4-B.dat
+6b71083c18c17fbe37dce39003a9edc8  FT_RWFILTER-v2-c4-L.dat
 82e819749752c149e6517bcf4c8c2e61  FT_RWFILTER-v3-c0-B.dat
 0fd4b025dcb2d0adcdcc86b79eba6bb0  FT_RWFILTER-v3-c0-L.dat
 29c6934e0d4cd6df4a34cb1225080257  FT_RWFILTER-v3-c1-B.dat
 0ecc5cd71f91388ca3e8565046ad7e73  FT_RWFILTER-v3-c1-L.dat
 cc3bc63da36bab23aeaaa58ee69d54d0  FT_RWFILTER-v3-c2-B.dat
 fab739247996547627ce22e31d4bac89  FT_RWFILTER-v3-c2-L.dat
+9776701d9bc25737f50f89c09f7111c8  FT_RWFILTER-v3-c3-B.dat
+257bdb251d23a86725f627a403da49f3  FT_RWFILTER-v3-c3-L.dat
+cb2ef789e263f8b5b26ae61d94b6c4a1  FT_RWFILTER-v3-c4-B.dat
+139ec0b26361600b1678c86c425e2fb1  FT_RWFILTER-v3-c4-L.dat
 4d67c6ff508ee230c297195531fdf9a6  FT_RWFILTER-v4-c0-B.dat
 8e0dccab479e7f961961e5f41155c255  FT_RWFILTER-v4-c0-L.dat
 2aa64ffe5dc55c6808f1028961bf1fff  FT_RWFILTER-v4-c1-B.dat
 ebb415f850e0831a0b0fb986382e10d9  FT_RWFILTER-v4-c1-L.dat
 e96b80f6ca5903cedea61d001bec5008  FT_RWFILTER-v4-c2-B.dat
 dc5d2ffe74ff1b7ec6843a63abc23536  FT_RWFILTER-v4-c2-L.dat
+382f11334c72009b053e6e9a22509699  FT_RWFILTER-v4-c3-B.dat
+33076751e76e6539ba293349e0a8e3fd  FT_RWFILTER-v4-c3-L.dat
+68b043d09410b61b965f8479a1278b9c  FT_RWFILTER-v4-c4-B.dat
+d37604b629b64e59658201ad2663ea02  FT_RWFILTER-v4-c4-L.dat
 e5b1e8db7a40a8f0ddb1982168a8181f  FT_RWFILTER-v5-c0-B.dat
 8b6c7f61e15b9226e1ceaf899aed253e  FT_RWFILTER-v5-c0-L.dat
 1e17cf9578609c27e1b9ca574caa4d9a  FT_RWFILTER-v5-c1-B.dat
 7cde0994c0758c2240b2b63b7d312a1f  FT_RWFILTER-v5-c1-L.dat
 3ca1de6d51d1b892d2e061ae08792cae  FT_RWFILTER-v5-c2-B.dat
 5e00a4bde82f084cf12bd7f179a33d36  FT_RWFILTER-v5-c2-L.dat
+7ee6a467d59718b47246b7038abb5b35  FT_RWFILTER-v5-c3-B.dat
+6d1af8955dd37457ae0769b51f199250  FT_RWFILTER-v5-c3-L.dat
+b3480d98b1fe8927cb2003b4ba93ca41  FT_RWFILTER-v5-c4-B.dat
+d22be69b4500c9696198110a9e569c6a  FT_RWFILTER-v5-c4-L.dat
 7dcaa52987c38d63b84a5b7c5ce33941  FT_RWGENERIC-v0-c0-B.dat
 fd656c86111fe47d0cbf13ed392bed67  FT_RWGENERIC-v0-c0-L.dat
 27893661440063991af0c88614fed945  FT_RWGENERIC-v0-c1-B.dat
 f3122e81b9b23638187aa3376cc65ac5  FT_RWGENERIC-v0-c1-L.dat
 5f7e5c8de1a6266b77f42d0ac4d10d73  FT_RWGENERIC-v0-c2-B.dat
 bc415d8b1b19e9390c165e8d35a1a6bf  FT_RWGENERIC-v0-c2-L.dat
+67b27b9bcac48c94d75d7db592e0f230  FT_RWGENERIC-v0-c3-B.dat
+c6389ee2463b12602c4c4115f25d67cf  FT_RWGENERIC-v0-c3-L.dat
+9e31acbdc02d61af1c7bf030953a70bc  FT_RWGENERIC-v0-c4-B.dat
+a0d01a3768f410b811aabc01801e3291  FT_RWGENERIC-v0-c4-L.dat
 513984dc560dde040158a1971320680c  FT_RWGENERIC-v1-c0-B.dat
 1640b04c5156437dcb9c3f7395fe98c1  FT_RWGENERIC-v1-c0-L.dat
 099d36f38bfebec3ec35952b327ce13c  FT_RWGENERIC-v1-c1-B.dat
 e3d4609ba3e3729f4f0d7b7335f3ed44  FT_RWGENERIC-v1-c1-L.dat
 4ba13eb429dfcc94d73386c3215249cd  FT_RWGENERIC-v1-c2-B.dat
 d51f3cb16cb0830019bfca4b1cd70247  FT_RWGENERIC-v1-c2-L.dat
+098baca8ac9f0d1241df1fb783712ced  FT_RWGENERIC-v1-c3-B.dat
+c4da12c2a7adcb9fefff8806c167c840  FT_RWGENERIC-v1-c3-L.dat
+29dfa4b6751289bc47d9186992a12d5c  FT_RWGENERIC-v1-c4-B.dat
+eb46913971b931f80471e88d723e05bc  FT_RWGENERIC-v1-c4-L.dat
 947f1421d65b62e736c08d7a79f0ff42  FT_RWGENERIC-v2-c0-B.dat
 d05b78204f16fb235fc150b1be56d0b7  FT_RWGENERIC-v2-c0-L.dat
 a490c651a771b764ab218a6bb5e3a6e8  FT_RWGENERIC-v2-c1-B.dat
 35742b3af08059c433ad65ae8e295105  FT_RWGENERIC-v2-c1-L.dat
 4c1ed99c498491657b6105525b21ab67  FT_RWGENERIC-v2-c2-B.dat
 bf959c2fb40352f6234df8b9f3717e1f  FT_RWGENERIC-v2-c2-L.dat
+7cb78ed6916641efb4248b5782763468  FT_RWGENERIC-v2-c3-B.dat
+d815713a12b5f19cff7215ec492de279  FT_RWGENERIC-v2-c3-L.dat
+3a7f3a28a8639d1c235ad391ea41aa9e  FT_RWGENERIC-v2-c4-B.dat
+d9a6b895ece5d2226e24e2811426165c  FT_RWGENERIC-v2-c4-L.dat
 d6a93bcf2a9a6020bed0835ceb646ea2  FT_RWGENERIC-v3-c0-B.dat
 0f0add9723e5b1fc24330730297c1b34  FT_RWGENERIC-v3-c0-L.dat
 f57e0dd0e62b5c927f117101c88caeaa  FT_RWGENERIC-v3-c1-B.dat
 0e849cf5ab4fb0df06f07e614d305991  FT_RWGENERIC-v3-c1-L.dat
 152de2e564e5c7177ae6defeff387bf7  FT_RWGENERIC-v3-c2-B.dat
 aee6d908907c55f7c430bfb7aa5c1bcb  FT_RWGENERIC-v3-c2-L.dat
+50ee15cac1afd05818ce58c4be3f2d26  FT_RWGENERIC-v3-c3-B.dat
+33b230357126e01797f64c85ee758b1d  FT_RWGENERIC-v3-c3-L.dat
+cc458c015ef48f284146bbaa302cd259  FT_RWGENERIC-v3-c4-B.dat
+48872637610e157b9551f3f63453cc69  FT_RWGENERIC-v3-c4-L.dat
 71d4e55cd818777ee5438be65f7ccac5  FT_RWGENERIC-v4-c0-B.dat
 14f984703521151b77b2a63669abefe4  FT_RWGENERIC-v4-c0-L.dat
 d8b9226e8477614aebbb376a78dc5576  FT_RWGENERIC-v4-c1-B.dat
 8291163b094e4a2ce441446ee6d6b4d0  FT_RWGENERIC-v4-c1-L.dat
 069bacaccc25fadc2e2bbd1432857d16  FT_RWGENERIC-v4-c2-B.dat
 dd18b1eabe121da6f8ac7c323e504e04  FT_RWGENERIC-v4-c2-L.dat
+b572b20d3627b8ad00ecfe8afa92d47e  FT_RWGENERIC-v4-c3-B.dat
+a5d2556fbb52b54c060a286fa491688e  FT_RWGENERIC-v4-c3-L.dat
+de027dd8d6126ecbbae9b81b12cf35a0  FT_RWGENERIC-v4-c4-B.dat
+4dff740c9d8e5179b1ad9551bf02cdfa  FT_RWGENERIC-v4-c4-L.dat
 dd89f00bd51f03caf9de1e7812108005  FT_RWGENERIC-v5-c0-B.dat
 223ab374329314618fe9d8a1d2f300e8  FT_RWGENERIC-v5-c0-L.dat
 0884d019bfed192007a770275cfc52a7  FT_RWGENERIC-v5-c1-B.dat
 518368e2e59f58adf0d21c796c73aa7e  FT_RWGENERIC-v5-c1-L.dat
 3fa208bcfe8d3aaf76111ed9d7b154a1  FT_RWGENERIC-v5-c2-B.dat
 aeb77d2fcb5bbd7d8d13c48de54d36ff  FT_RWGENERIC-v5-c2-L.dat
+883a0c74165a07112e67f1cb9d6fbffe  FT_RWGENERIC-v5-c3-B.dat
+01b4fecd2c3b88969a6a60ce917e3f47  FT_RWGENERIC-v5-c3-L.dat
+b6ed86295ae7a47e07c7aa129e6266eb  FT_RWGENERIC-v5-c4-B.dat
+085d6d554a52191bbc2fe3c78206d845  FT_RWGENERIC-v5-c4-L.dat
 2f9f457aa09dadb79ce6e6b9cac7aa05  FT_RWIPV6-v1-c0-B.dat
 9c18ef017e67ee89fa0daabc31daa233  FT_RWIPV6-v1-c0-L.dat
 699212297d2621249b08d909de8b80a3  FT_RWIPV6-v1-c1-B.dat
 0dfa265492d6a1c62d78882ef32a9964  FT_RWIPV6-v1-c1-L.dat
 893d07912f8754ab1f611826f93a8cfa  FT_RWIPV6-v1-c2-B.dat
 9584e20a7b9641afd78422afbd81a09b  FT_RWIPV6-v1-c2-L.dat
+82736002c8a2743825439c473ba966db  FT_RWIPV6-v1-c3-B.dat
+904f4f4d765b54d99beb5cd747577178  FT_RWIPV6-v1-c3-L.dat
+cac44054a3a247f3dad798c8cf9cfafa  FT_RWIPV6-v1-c4-B.dat
+eb3e45df7a845ebbdb99753eb2620f79  FT_RWIPV6-v1-c4-L.dat
 acc4780b215db74a91c541c98811e77f  FT_RWIPV6-v2-c0-B.dat
 1c69b295749a55894504e9d5d00042e5  FT_RWIPV6-v2-c0-L.dat
 6ff220d018769f8caa8aa3d96b9c92e5  FT_RWIPV6-v2-c1-B.dat
 2b4d41ee54c55a1dec7d0f01e4eef410  FT_RWIPV6-v2-c1-L.dat
 d3f5dcce303ef4395641299a4ea316cb  FT_RWIPV6-v2-c2-B.dat
 f147e9fa29126c13c715aba56df5d842  FT_RWIPV6-v2-c2-L.dat
+d48262afbe1d139e9ed0da311f431055  FT_RWIPV6-v2-c3-B.dat
+c7c83bdfac512e3b681b07298f493183  FT_RWIPV6-v2-c3-L.dat
+78703f3a538ff385426e4f6dc045acff  FT_RWIPV6-v2-c4-B.dat
+63013ac62b6a2fd47ef3b337efffbb42  FT_RWIPV6-v2-c4-L.dat
 c603a50b2fe0f71073449bb00ffdcd7b  FT_RWIPV6ROUTING-v1-c0-B.dat
 5ce7f5f312d053e719a09de2bdf4dd48  FT_RWIPV6ROUTING-v1-c0-L.dat
 01db8a0206495ffa9cb3853b6a263565  FT_RWIPV6ROUTING-v1-c1-B.dat
 78ad670f0cf3c3d67cea0e9ceda29be4  FT_RWIPV6ROUTING-v1-c1-L.dat
 f2c65c5fabba2f150acb324ebdb26b51  FT_RWIPV6ROUTING-v1-c2-B.dat
 58f02ba420d0860f0f5dd860827e7d61  FT_RWIPV6ROUTING-v1-c2-L.dat
+7673a904c7b31975cf90a7fae7169922  FT_RWIPV6ROUTING-v1-c3-B.dat
+0db4deb7db076b4d635b00c9617637e4  FT_RWIPV6ROUTING-v1-c3-L.dat
+2ca0219ff18c1d7d0d79a9d3a9c19ca5  FT_RWIPV6ROUTING-v1-c4-B.dat
+a871828d320dbcba4645eade60b1a64e  FT_RWIPV6ROUTING-v1-c4-L.dat
 0655e3c8de4049f43adf2f9eceff540b  FT_RWIPV6ROUTING-v2-c0-B.dat
 5ed32a580fcf09eefd1016f68b3eab3b  FT_RWIPV6ROUTING-v2-c0-L.dat
 59aefe73f0b406ac0c5b2dae4db48aec  FT_RWIPV6ROUTING-v2-c1-B.dat
 95207e7656f6e575ba0363f9db673592  FT_RWIPV6ROUTING-v2-c1-L.dat
 ba749a6064c4b274960437ca1b1d11c8  FT_RWIPV6ROUTING-v2-c2-B.dat
 7d0990a104def93b4350ed12bab74e69  FT_RWIPV6ROUTING-v2-c2-L.dat
+3ff880ed24923d78656b11798485f702  FT_RWIPV6ROUTING-v2-c3-B.dat
+065058a21868a4f21c7832c70bd5a0a6  FT_RWIPV6ROUTING-v2-c3-L.dat
+2d61e5f1c37a38e04e1d8c30908e184b  FT_RWIPV6ROUTING-v2-c4-B.dat
+3a7a68cf3c181e678cf8ee307d60e240  FT_RWIPV6ROUTING-v2-c4-L.dat
 df514250db00d79242f13463b7245c70  FT_RWIPV6ROUTING-v3-c0-B.dat
 041296f90b30ede7da5f81d7c3864074  FT_RWIPV6ROUTING-v3-c0-L.dat
 d68e6034f3621bfad96967aec9e753c9  FT_RWIPV6ROUTING-v3-c1-B.dat
 f695cab19a9a761ffcf918db10d936d8  FT_RWIPV6ROUTING-v3-c1-L.dat
 4d7af74d80435e84e6775f09ea41ddb6  FT_RWIPV6ROUTING-v3-c2-B.dat
 aa9f2303e3c62bb5ac60e4bd404b41bf  FT_RWIPV6ROUTING-v3-c2-L.dat
+63b697d63af27ef39998300b17f018a6  FT_RWIPV6ROUTING-v3-c3-B.dat
+fdbf0c97ed6967e6abcb0c6024732b20  FT_RWIPV6ROUTING-v3-c3-L.dat
+b3702262f1dff686a578fdd1fbf5027d  FT_RWIPV6ROUTING-v3-c4-B.dat
+e031e5e85f206ce484d6ac083265daf5  FT_RWIPV6ROUTING-v3-c4-L.dat
 63ab6740566b8c6af7d43c2948ee8e82  FT_RWNOTROUTED-v1-c0-B.dat
 c0fe797de574e9d2fd85447032910ff6  FT_RWNOTROUTED-v1-c0-L.dat
 d305bcb80c26979cfa5aaaa19c74530c  FT_RWNOTROUTED-v1-c1-B.dat
 4d54be7afa877687d4ec504f6a3ad060  FT_RWNOTROUTED-v1-c1-L.dat
 ba6c890bd067b4459ddb411bc04f547e  FT_RWNOTROUTED-v1-c2-B.dat
 bf52e8553b91ac3f5eae64583c6dabb9  FT_RWNOTROUTED-v1-c2-L.dat
+472469fdd9c8e8dee3b59f28f6981e0a  FT_RWNOTROUTED-v1-c3-B.dat
+c13354d8dd32c09ecaad2f1a0909afea  FT_RWNOTROUTED-v1-c3-L.dat
+28e32ade2a713404670d42d168867779  FT_RWNOTROUTED-v1-c4-B.dat
+191d14606a3fd67c3d1ba2735efe1bf2  FT_RWNOTROUTED-v1-c4-L.dat
 c68a35d9f1f8536fda5b27b7a2e7fc9b  FT_RWNOTROUTED-v2-c0-B.dat
 2389313df8dab0ae4c0c732cedbb5ea1  FT_RWNOTROUTED-v2-c0-L.dat
 500b1718ee443086107097de48f9ca77  FT_RWNOTROUTED-v2-c1-B.dat
 8a81a6828631802676faa183ad16a117  FT_RWNOTROUTED-v2-c1-L.dat
 48d90f0351183137fb0db6bb24b79a8a  FT_RWNOTROUTED-v2-c2-B.dat
 e321d9f627262e931838c6df4ed0209e  FT_RWNOTROUTED-v2-c2-L.dat
+ff29b1f1aa0f2efd46869e39f82cfd8a  FT_RWNOTROUTED-v2-c3-B.dat
+44723943441763bd06329db44fd3d3c2  FT_RWNOTROUTED-v2-c3-L.dat
+c9d6dfdf15e8ab29c62bbb6be9666c8f  FT_RWNOTROUTED-v2-c4-B.dat
+cf757a29868e46865c2a96cdb0213d02  FT_RWNOTROUTED-v2-c4-L.dat
 8a5362f0ab8f6bcbd48463878c23c94d  FT_RWNOTROUTED-v3-c0-B.dat
 b572af9ccec4743025b7c28d66cf2d2d  FT_RWNOTROUTED-v3-c0-L.dat
 540025825039fae3208d91d3567881c2  FT_RWNOTROUTED-v3-c1-B.dat
 68ceda0aff331556818f48f0c35e20a8  FT_RWNOTROUTED-v3-c1-L.dat
 60f5962b9d2d1de58aa530934473d004  FT_RWNOTROUTED-v3-c2-B.dat
 044eec2be252b10c34adc4fe32d6cfa0  FT_RWNOTROUTED-v3-c2-L.dat
+34f5ed05d1670590fa3aef769ef6ba88  FT_RWNOTROUTED-v3-c3-B.dat
+e2d61d87ce89e69fe8cf0c22dc374574  FT_RWNOTROUTED-v3-c3-L.dat
+5351d12c313838752e5cab8ced8e82c7  FT_RWNOTROUTED-v3-c4-B.dat
+dfb97cd9052bdc42c15ad3014dcb7cc9  FT_RWNOTROUTED-v3-c4-L.dat
 72e1c54caaa54243661c0a0c1a9de78b  FT_RWNOTROUTED-v4-c0-B.dat
 96f05809a0f851cd5baf40ef450e514e  FT_RWNOTROUTED-v4-c0-L.dat
 da068228b2ba1390c5fa065529ed65d1  FT_RWNOTROUTED-v4-c1-B.dat
 5aa97d6d58b9dbc40b0e1c4880a42cd1  FT_RWNOTROUTED-v4-c1-L.dat
 342ad55b44619fa4258e9857936b3c29  FT_RWNOTROUTED-v4-c2-B.dat
 ad7338ea337bcfb54177950e83f34ece  FT_RWNOTROUTED-v4-c2-L.dat
+2d50661a70e0b8802b2a25987027fa60  FT_RWNOTROUTED-v4-c3-B.dat
+8a7adfa5337e4d8576daaaec34663311  FT_RWNOTROUTED-v4-c3-L.dat
+0c8fb8cfdc4a585b2cf17ab0424561ee  FT_RWNOTROUTED-v4-c4-B.dat
+34a528dd05904eb252e5d1ed8e2e7b03  FT_RWNOTROUTED-v4-c4-L.dat
 db20862725dc8c2b7ae234eb74f2e6dd  FT_RWNOTROUTED-v5-c0-B.dat
 5a5fdb68fa587d361ad47ab3071a0150  FT_RWNOTROUTED-v5-c0-L.dat
 152f9f6672ef4556c5b611459b6cdbee  FT_RWNOTROUTED-v5-c1-B.dat
 29642a8c73b50035ca5e2b0f6fae2dd4  FT_RWNOTROUTED-v5-c1-L.dat
 c1a0505018059c833fb3d1b41e0b7ce7  FT_RWNOTROUTED-v5-c2-B.dat
 f8bf559b9a06dc7dd3cbeeef8c45716d  FT_RWNOTROUTED-v5-c2-L.dat
+e42922a416b1b3e4650246fac8326c48  FT_RWNOTROUTED-v5-c3-B.dat
+62aece0e1522045c79c9dcde74eaaf43  FT_RWNOTROUTED-v5-c3-L.dat
+9a2f4a557b1aed3afe781d15123e992e  FT_RWNOTROUTED-v5-c4-B.dat
+81e1cc30c89792ee1ffc1325ff1c3f59  FT_RWNOTROUTED-v5-c4-L.dat
 45e616c2ea42dfc32ea7f238e2e2cfe5  FT_RWROUTED-v1-c0-B.dat
 82c16c2a864c206de65bc5119767dff1  FT_RWROUTED-v1-c0-L.dat
 fa9d7a6c0e8267b967c128349d010392  FT_RWROUTED-v1-c1-B.dat
 1a1b604369c33b30b1322353328c13e6  FT_RWROUTED-v1-c1-L.dat
 2f9184009ad2b56a4df53f3d40796352  FT_RWROUTED-v1-c2-B.dat
 3ce7398124bccbb727ee3ad436b4e25e  FT_RWROUTED-v1-c2-L.dat
+5ea1f34328a732e2aee4b4c434ec8503  FT_RWROUTED-v1-c3-B.dat
+51014d10c86ef0f59bd7dad7d63af345  FT_RWROUTED-v1-c3-L.dat
+4f4205c65c3d7b72d0a7015f2f5d1b05  FT_RWROUTED-v1-c4-B.dat
+e33eee20ff9a7c339fa6b8e67d421e26  FT_RWROUTED-v1-c4-L.dat
 cb581ce9f132280ca46394fdaae64e63  FT_RWROUTED-v2-c0-B.dat
 5e56afa64d9351d69c2ae973d5f663ed  FT_RWROUTED-v2-c0-L.dat
 576e4ce47503cf80d7992db86b99d2dc  FT_RWROUTED-v2-c1-B.dat
 36493734239e466cb9c892b1864a197f  FT_RWROUTED-v2-c1-L.dat
 deeddd3127643705a1fd0b50c1b8ca7b  FT_RWROUTED-v2-c2-B.dat
 cbbe239c3af9e33ed6212a55b527a45e  FT_RWROUTED-v2-c2-L.dat
+f3e59bb8ab994acef0bd634fdcbcabc0  FT_RWROUTED-v2-c3-B.dat
+9fd1851bba2e8e4337fd212daa2500c9  FT_RWROUTED-v2-c3-L.dat
+7948ad1bd9b728942ef8479a236c3318  FT_RWROUTED-v2-c4-B.dat
+1769d7bd23742f2f7a2a9df13c108845  FT_RWROUTED-v2-c4-L.dat
 077f02f2ee0d4a6ec5ac3b50e231a4d2  FT_RWROUTED-v3-c0-B.dat
 f3a099444867927403f4fdd06a10a8ea  FT_RWROUTED-v3-c0-L.dat
 b99deaad26c4199c189ab21111d3c698  FT_RWROUTED-v3-c1-B.dat
 f67ea6d04eff01384f2809999e9dda53  FT_RWROUTED-v3-c1-L.dat
 5b4c3aec0f06c80a67a2d2975720d6cc  FT_RWROUTED-v3-c2-B.dat
 a5b89aa73ac64b9d988e8b7d0f96a301  FT_RWROUTED-v3-c2-L.dat
+f28cc6c9ae17950e0463a5da8e614172  FT_RWROUTED-v3-c3-B.dat
+a6f49e0caf6bd8c96f171c4574e9fd6c  FT_RWROUTED-v3-c3-L.dat
+b027a3e5db6633ef5356ca65836b5f4d  FT_RWROUTED-v3-c4-B.dat
+be6b3008fa956296f5312adc4a411f42  FT_RWROUTED-v3-c4-L.dat
 f17d7d2aa5427eaff43c4fac1574857f  FT_RWROUTED-v4-c0-B.dat
 5034cea9260da8a6dad733b5f7c78d5a  FT_RWROUTED-v4-c0-L.dat
 9e755deb6b1aad2aebed1cec1ab39ea1  FT_RWROUTED-v4-c1-B.dat
 0dd46efea48cd2d08c14ea3f6987ea1e  FT_RWROUTED-v4-c1-L.dat
 a89778891e1ba5f86b2cc095465284ed  FT_RWROUTED-v4-c2-B.dat
 8ed64ad91f5c7c98f8fa4e03ff8873e4  FT_RWROUTED-v4-c2-L.dat
+26163280cc60269b8fe649d0c31c66ae  FT_RWROUTED-v4-c3-B.dat
+13e7d74b8b8d1afadb853d12bfc1a6d2  FT_RWROUTED-v4-c3-L.dat
+802dc938d55ba47ed16e20438952d9ab  FT_RWROUTED-v4-c4-B.dat
+c3d6033b2d9ade3e55b10db5a3ea658f  FT_RWROUTED-v4-c4-L.dat
 e9e16d7a47a3ba266bc5df8584d1b88f  FT_RWROUTED-v5-c0-B.dat
 e5d2153a62b3691069e49dfb15ac71b7  FT_RWROUTED-v5-c0-L.dat
 53ca49143ecb4ebd9ec5513c6fe1e62e  FT_RWROUTED-v5-c1-B.dat
 27bb27f62bd0bd74e4dc5c6e664fb95a  FT_RWROUTED-v5-c1-L.dat
 0668ecd5cd56a9c8bd94dc92dc021123  FT_RWROUTED-v5-c2-B.dat
 f946ee0f1b13a987c555f0aab85bf411  FT_RWROUTED-v5-c2-L.dat
+a0a36f969fcbdf40b88de3a9c00f6c80  FT_RWROUTED-v5-c3-B.dat
+edd15ff939c3a6083e306703d48c2d0a  FT_RWROUTED-v5-c3-L.dat
+31abc921d3aa1379393989e207b526f8  FT_RWROUTED-v5-c4-B.dat
+17f055f89a9d28c0c93983b6b7dce104  FT_RWROUTED-v5-c4-L.dat
 6be74a9eff6b196a51e97dfcc8e31d0a  FT_RWSPLIT-v1-c0-B.dat
 ead8c12cd4ceed70f9d1cdbde78b37de  FT_RWSPLIT-v1-c0-L.dat
 11a9157a43acfc36a5d6837cdf46899c  FT_RWSPLIT-v1-c1-B.dat
 db25ad2e4c631bd22a4e55b829102ba0  FT_RWSPLIT-v1-c1-L.dat
 2981a349f762c728dc94d06d6db0f0a3  FT_RWSPLIT-v1-c2-B.dat
 9f668bae733c50a8991ee3cec869cbed  FT_RWSPLIT-v1-c2-L.dat
+fd8b75a7c151cb129a3e8af657f0f86c  FT_RWSPLIT-v1-c3-B.dat
+fe18525488f8d436e995650981626eb3  FT_RWSPLIT-v1-c3-L.dat
+8c513c17fdb600d51237d673b12c8aec  FT_RWSPLIT-v1-c4-B.dat
+9ed77ed62d5810850368ca0eb40f2309  FT_RWSPLIT-v1-c4-L.dat
 d2210f9a7d15e606b4a9bdadcb05e017  FT_RWSPLIT-v2-c0-B.dat
 3a796fa45a437dcb01eeb16cf0bcc6d4  FT_RWSPLIT-v2-c0-L.dat
 79bd8edb052c5644d92f402a13805f68  FT_RWSPLIT-v2-c1-B.dat
 1e6bcff7d83ce045b27fcaafc305a34d  FT_RWSPLIT-v2-c1-L.dat
 b933981892054094ab04faa9dceb1f34  FT_RWSPLIT-v2-c2-B.dat
 104c0dee9f0dfae12ed6ec08d4fd9519  FT_RWSPLIT-v2-c2-L.dat
+cfb849582d64c802a1c21e57cc0e5c4b  FT_RWSPLIT-v2-c3-B.dat
+45c16b9b1ad86545af2fb7d459a75cd0  FT_RWSPLIT-v2-c3-L.dat
+baa283c3f8981b8e65a4c41a59cb8366  FT_RWSPLIT-v2-c4-B.dat
+d4e4a8d839607a04cceb83e0966abc23  FT_RWSPLIT-v2-c4-L.dat
 d43215bde7090e7badc8c9fb4f133095  FT_RWSPLIT-v3-c0-B.dat
 366b18ddbd8d7d5ea7a3bcdea35cebdf  FT_RWSPLIT-v3-c0-L.dat
 4a09747c160f6e23c085e2c2bcf60151  FT_RWSPLIT-v3-c1-B.dat
 a76c1ef9e575c1b84030a7158d57acb2  FT_RWSPLIT-v3-c1-L.dat
 22e485baeb50cee6ef7315399bd0dbf9  FT_RWSPLIT-v3-c2-B.dat
 99f031786758815819964b0d42388fc2  FT_RWSPLIT-v3-c2-L.dat
+533f0d8ed576f79b338bf758e499d1d4  FT_RWSPLIT-v3-c3-B.dat
+6637ea3184a7663ec521769563a22894  FT_RWSPLIT-v3-c3-L.dat
+abb65fba46539f73a4c444e83229e1cb  FT_RWSPLIT-v3-c4-B.dat
+5261ef15da3fc33c9947e243b64dea44  FT_RWSPLIT-v3-c4-L.dat
 6ea55e3e335e04f9b1a4a845ad7b3223  FT_RWSPLIT-v4-c0-B.dat
 0fa608aacfea2014dc4556072853fdf0  FT_RWSPLIT-v4-c0-L.dat
 9c9528e2f6bff9acaf3b8347d9dd2c0c  FT_RWSPLIT-v4-c1-B.dat
 244f5c16ea72549132f67ae5506f02d4  FT_RWSPLIT-v4-c1-L.dat
 be1126439a83f8b295fab6b355d92430  FT_RWSPLIT-v4-c2-B.dat
 b1d788cec04da73ac18c0df4fc858db5  FT_RWSPLIT-v4-c2-L.dat
+e92cd6f7838084a4da4bf605eececed9  FT_RWSPLIT-v4-c3-B.dat
+1c0d4b8b4b91e664d3bc7b8f8f4bd061  FT_RWSPLIT-v4-c3-L.dat
+845538761461012c5a8de38b13c43077  FT_RWSPLIT-v4-c4-B.dat
+d3e223ab663e03eedd3e5c1f7ea7b825  FT_RWSPLIT-v4-c4-L.dat
 a4405165075cb9286a941c90bb68019d  FT_RWSPLIT-v5-c0-B.dat
 cd3c855001d584165bc8ea62afa352c9  FT_RWSPLIT-v5-c0-L.dat
 298e49f809f86d6d265a725383a2aa9c  FT_RWSPLIT-v5-c1-B.dat
 554014f72af33a165fc5ede025f3d160  FT_RWSPLIT-v5-c1-L.dat
 3690b7caf4c2e17960f8b8e3eb632c29  FT_RWSPLIT-v5-c2-B.dat
 5a47281757ea51957f0b9c8d9514b9ca  FT_RWSPLIT-v5-c2-L.dat
+39f4f5b8dfeab97b117e0e8690f52138  FT_RWSPLIT-v5-c3-B.dat
+62b735204bba0ed8474c6a031f662d97  FT_RWSPLIT-v5-c3-L.dat
+93ea6ab36c3901d466b33ed1dc716f97  FT_RWSPLIT-v5-c4-B.dat
+67e29122e9a457129723679eec6a52a9  FT_RWSPLIT-v5-c4-L.dat
 0e1b1e8228b57886008a97cb765c331b  FT_RWWWW-v1-c0-B.dat
 6c123a6c98d83c8cf317d0254c002cb6  FT_RWWWW-v1-c0-L.dat
 089f3ea77e04dab201087a299f5d3ae0  FT_RWWWW-v1-c1-B.dat
 4a857fcec93a5f9b283cb80b12d69f17  FT_RWWWW-v1-c1-L.dat
 fa07a51f375a495e8ae5efa2ec5115fb  FT_RWWWW-v1-c2-B.dat
 be8c53ead9dbe25bbe4158c87844db72  FT_RWWWW-v1-c2-L.dat
+0da9be60a0e52e38b9543249ffc3dcc6  FT_RWWWW-v1-c3-B.dat
+b4eb3cada357c600a74c8b064674a6c3  FT_RWWWW-v1-c3-L.dat
+0794a645db2aef2dd3422aa7cf0840aa  FT_RWWWW-v1-c4-B.dat
+9a868961c48679ddfa789758883c0ca6  FT_RWWWW-v1-c4-L.dat
 9f1f0176f53e5cc804b1bddfc2421b98  FT_RWWWW-v2-c0-B.dat
 4a9b9dbc6f98dc0d5df5b9f83b1b140f  FT_RWWWW-v2-c0-L.dat
 27a3e17dcc5525c9d200b4d61ae5f487  FT_RWWWW-v2-c1-B.dat
 8b3b01eb20974cf574b60aec367e29e8  FT_RWWWW-v2-c1-L.dat
 3237bae27c7c20ff91760dfea299b690  FT_RWWWW-v2-c2-B.dat
 3e060aeb0fd815f70ccdb9a36191c73b  FT_RWWWW-v2-c2-L.dat
+73ebd68f7624c74c8283e56141655a8d  FT_RWWWW-v2-c3-B.dat
+8e4510ee37ef2c3fedb0bef8aea55d1b  FT_RWWWW-v2-c3-L.dat
+666f753f356c05c0be31d326f55ce03b  FT_RWWWW-v2-c4-B.dat
+8098283e00684b6b7a72cdd62b16d75a  FT_RWWWW-v2-c4-L.dat
 a726e5fc2c493da0856695a85fd11298  FT_RWWWW-v3-c0-B.dat
 cfdd861442b0a4a49723d57595681bf7  FT_RWWWW-v3-c0-L.dat
 7a027dd8366cf4b8d681d5a06ca37d8c  FT_RWWWW-v3-c1-B.dat
 e15f6c43b9b10b6d9da58329efe12bd8  FT_RWWWW-v3-c1-L.dat
 b55cb6891fcea6f5249ba629f8631e9b  FT_RWWWW-v3-c2-B.dat
 abc4c8b10b22ba1277c1a04343e2a874  FT_RWWWW-v3-c2-L.dat
+6ea01bd55ff780f5563235039f7d00f1  FT_RWWWW-v3-c3-B.dat
+c96d3e00097f7f89618495b9bf094f29  FT_RWWWW-v3-c3-L.dat
+662c62ff530e462d2a3ee0150f8fdef7  FT_RWWWW-v3-c4-B.dat
+558a8a4eed6cbc9ac82d5f0e0199f606  FT_RWWWW-v3-c4-L.dat
 b67d537959ff93208eafb81469c5a09c  FT_RWWWW-v4-c0-B.dat
 4c348bb299e4dd82ed24223aa0ed9a14  FT_RWWWW-v4-c0-L.dat
 cd0c4dca54ac9922397da0bd398dfacd  FT_RWWWW-v4-c1-B.dat
 3f406a8506b555adab4d8cd379a9d508  FT_RWWWW-v4-c1-L.dat
 b0ff24fded4b760dc6fcb008761749b0  FT_RWWWW-v4-c2-B.dat
 da6711570db3fcdfe2f9a9b82c6e51ff  FT_RWWWW-v4-c2-L.dat
+de64d8e1a3fba654e0aa815843e544aa  FT_RWWWW-v4-c3-B.dat
+6f1e3bd37ac6966897b6a972864b25e5  FT_RWWWW-v4-c3-L.dat
+1766428fd1a77cf593cb05e72807bb8c  FT_RWWWW-v4-c4-B.dat
+fc3ff8c2c6cf48e09df21e8df2ef0a76  FT_RWWWW-v4-c4-L.dat
 123deb72a005b827d60a8e211a13f077  FT_RWWWW-v5-c0-B.dat
 eed0098880ea791ccf34c4e1311887b4  FT_RWWWW-v5-c0-L.dat
 32810191c8b2c8265b4bafc5a3d3181a  FT_RWWWW-v5-c1-B.dat
 63355fc37c6141d131e5ad29a788d2f4  FT_RWWWW-v5-c1-L.dat
 224fe676195b48daa49fded2045bd983  FT_RWWWW-v5-c2-B.dat
 fed04907fc9b1b72e4c7c7955f491abe  FT_RWWWW-v5-c2-L.dat
+5dafef237438ba074bb515a9934647df  FT_RWWWW-v5-c3-B.dat
+848bcd7ae0e2c85cf8ef9b9ae29236be  FT_RWWWW-v5-c3-L.dat
+3357e0eac704745d026934f4ea096fcb  FT_RWWWW-v5-c4-B.dat
+82f3e8c67ec37bca22dae954b0e9c2b8  FT_RWWWW-v5-c4-L.dat
 
 # these are for LZ0 2.05
 a4e0ac1c437310d6c17be507c559afeb  FT_FLOWCAP-v2-c2-B.dat
@@ -78,6 +78,10 @@ RCSIDENT("$SiLK: rwcut.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
  * parameter to pass to that function. */
 #define CUT_SKIP_COUNT 65536
 
+/* The maximum number of records to read from an input stream in a
+ * single call to skStreamReadRecords(). */
+#define CUT_READ_COUNT 256
+
 /* EXPORTED VARIABLES */
 
 /* The object to convert the record to text; includes pointer to the
@@ -127,15 +131,19 @@ static int
 tailFile(
     skstream_t         *rwios)
 {
+    size_t count;
     int rv = SKSTREAM_OK;
 
-    while ((rv = skStreamReadRecord(rwios, tail_buf_cur)) == SKSTREAM_OK) {
-        ++tail_buf_cur;
+    /* read directly into the buffer, up to its end */
+    do {
+        rv = skStreamReadRecords(rwios, tail_buf_cur,
+                                 &tail_buf[tail_recs] - tail_buf_cur, &count);
+        tail_buf_cur += count;
         if (tail_buf_cur == &tail_buf[tail_recs]) {
             tail_buf_cur = tail_buf;
             tail_buf_full = 1;
         }
-    }
+    } while (SKSTREAM_OK == rv);
     if (SKSTREAM_ERR_EOF != rv) {
         skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
         return -1;
@@ -203,9 +211,12 @@ cutFile(
     skstream_t         *rwios)
 {
     static int copy_input_only = 0;
-    rwRec rwrec;
+    rwRec recs[CUT_READ_COUNT];
     int rv = SKSTREAM_OK;
     size_t num_skipped;
+    size_t count;
+    size_t want;
+    size_t i;
     int ret_val = 0;
 
     /* handle case where all requested records have been printed, but
@@ -239,19 +250,26 @@ cutFile(
 
     if (0 == num_recs) {
         /* print all records */
-        while ((rv = skStreamReadRecord(rwios, &rwrec)) == SKSTREAM_OK) {
-            rwAsciiPrintRec(ascii_str, &rwrec);
-        }
+        do {
+            rv = skStreamReadRecords(rwios, recs, CUT_READ_COUNT, &count);
+            for (i = 0; i < count; ++i) {
+                rwAsciiPrintRec(ascii_str, &recs[i]);
+            }
+        } while (SKSTREAM_OK == rv);
         if (SKSTREAM_ERR_EOF != rv) {
             ret_val = -1;
         }
     } else {
-        while (num_recs
-               && ((rv = skStreamReadRecord(rwios, &rwrec)) == SKSTREAM_OK))
-        {
-            rwAsciiPrintRec(ascii_str, &rwrec);
-            --num_recs;
-        }
+        /* do not read beyond the last record to print, since the
+         * remaining records may need to go to the copy-input stream */
+        do {
+            want = ((num_recs < CUT_READ_COUNT) ? num_recs : CUT_READ_COUNT);
+            rv = skStreamReadRecords(rwios, recs, want, &count);
+            for (i = 0; i < count; ++i) {
+                rwAsciiPrintRec(ascii_str, &recs[i]);
+            }
+            num_recs -= count;
+        } while (num_recs && SKSTREAM_OK == rv);
         switch (rv) {
           case SKSTREAM_OK:
           case SKSTREAM_ERR_EOF:
@@ -301,6 +319,13 @@ int main(int argc, char **argv)
                == 0)
         {
             skStreamSetIPv6Policy(rwios, ipv6_policy);
+            rv = skStreamSetColumnProjection(rwios,
+                                             rwAsciiGetColumns(ascii_str));
+            if (rv) {
+                skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+                skStreamDestroy(&rwios);
+                exit(EXIT_FAILURE);
+            }
             rv = tailFile(rwios);
             skStreamDestroy(&rwios);
             if (-1 == rv) {
@@ -331,6 +356,13 @@ int main(int argc, char **argv)
 
         do {
             skStreamSetIPv6Policy(rwios, ipv6_policy);
+            rv = skStreamSetColumnProjection(rwios,
+                                             rwAsciiGetColumns(ascii_str));
+            if (rv) {
+                skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+                skStreamDestroy(&rwios);
+                exit(EXIT_FAILURE);
+            }
             rv = cutFile(rwios);
             skStreamDestroy(&rwios);
             if (-1 == rv) {
@@ -0,0 +1,21 @@
+#! /usr/bin/perl -w
+# MD5: c910cc3e4afb28426de2ad934eb67314
+# TEST: ../rwcat/rwcat --compression-method=zlib --output-path=/tmp/rwcut-block-index-append-plain ../../tests/data.rwf && SILK_BLOCK_INDEX=1 ../rwcat/rwcat --compression-method=zlib --output-path=/tmp/rwcut-block-index-append-out ../../tests/data.rwf && ../rwfileinfo/rwfileinfo --fields=header-length --no-titles /tmp/rwcut-block-index-append-plain | ( read len ; tail -c +$((len + 1)) /tmp/rwcut-block-index-append-plain ) >> /tmp/rwcut-block-index-append-out && ./rwcut --fields=1-5,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles /tmp/rwcut-block-index-append-out
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my $rwcat = check_silk_app('rwcat');
+my $rwfileinfo = check_silk_app('rwfileinfo');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{plain} = make_tempname('plain');
+$temp{out} = make_tempname('out');
+skip_test("No zlib compression support")
+    unless 1 == $SiLKTests::SK_ENABLE_ZLIB;
+my $cmd = "$rwcat --compression-method=zlib --output-path=$temp{plain} $file{data} && SILK_BLOCK_INDEX=1 $rwcat --compression-method=zlib --output-path=$temp{out} $file{data} && $rwfileinfo --fields=header-length --no-titles $temp{plain} | ( read len ; tail -c +\$((len + 1)) $temp{plain} ) >> $temp{out} && $rwcut --fields=1-5,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles $temp{out}";
+my $md5 = "c910cc3e4afb28426de2ad934eb67314";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,19 @@
+#! /usr/bin/perl -w
+# MD5: ba63d539d704be56fd47a8c37b9053ff
+# TEST: ./rwcut --fields=1-10 --ipv6-policy=force --num-recs=5000 ../../tests/data.rwf | ../rwtuc/rwtuc | ../rwcat/rwcat --columnar-output --output-path=/tmp/rwcut-columnar-asv4-columnar.rw && ./rwcut --fields=sport,dport,proto --ipv6-policy=asv4 /tmp/rwcut-columnar-asv4-columnar.rw
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my $rwtuc = check_silk_app('rwtuc');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{columnar} = make_tempname('columnar.rw');
+check_features(qw(ipv6));
+my $cmd = "$rwcut --fields=1-10 --ipv6-policy=force --num-recs=5000 $file{data} | $rwtuc | $rwcat --columnar-output --output-path=$temp{columnar} && $rwcut --fields=sport,dport,proto --ipv6-policy=asv4 $temp{columnar}";
+my $md5 = "ba63d539d704be56fd47a8c37b9053ff";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: 239f304cddbeec7b8e0cc2af77ffd441
+# TEST: ../rwcat/rwcat --columnar-output --output-path=/tmp/rwcut-columnar-projection-columnar.rw ../../tests/data.rwf && ./rwcut --fields=dip,dport,bytes,stime --num-recs=10000 /tmp/rwcut-columnar-projection-columnar.rw
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{columnar} = make_tempname('columnar.rw');
+my $cmd = "$rwcat --columnar-output --output-path=$temp{columnar} $file{data} && $rwcut --fields=dip,dport,bytes,stime --num-recs=10000 $temp{columnar}";
+my $md5 = "239f304cddbeec7b8e0cc2af77ffd441";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: ead5679c2b281268a7b8a717e5907429
+# TEST: ../rwcat/rwcat --columnar-output --output-path=/tmp/rwcut-columnar-columnar.rw ../../tests/data.rwf && ./rwcut --fields=1-15,20,21,26-29 --ipv6-policy=ignore --timestamp-format=epoch --ip-format=decimal --delimited /tmp/rwcut-columnar-columnar.rw
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{columnar} = make_tempname('columnar.rw');
+my $cmd = "$rwcat --columnar-output --output-path=$temp{columnar} $file{data} && $rwcut --fields=1-15,20,21,26-29 --ipv6-policy=ignore --timestamp-format=epoch --ip-format=decimal --delimited $temp{columnar}";
+my $md5 = "ead5679c2b281268a7b8a717e5907429";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,19 @@
+#! /usr/bin/perl -w
+# ERR_MD5: 9fe484aee0ab6338c29e9483a0da251c
+# TEST: ../rwcat/rwcat --compression-method=zlib --output-path=/tmp/rwcut-truncated-compressed-out ../../tests/data.rwf && head -c 3000000 /tmp/rwcut-truncated-compressed-out | ./rwcut --fields=1-5 - 2>&1 >/dev/null
+
+use strict;
+use SiLKTests;
+
+my $rwcut = check_silk_app('rwcut');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{out} = make_tempname('out');
+skip_test("No zlib compression support")
+    unless 1 == $SiLKTests::SK_ENABLE_ZLIB;
+my $cmd = "$rwcat --compression-method=zlib --output-path=$temp{out} $file{data} && head -c 3000000 $temp{out} | $rwcut --fields=1-5 - 2>&1 >/dev/null";
+my $md5 = "9fe484aee0ab6338c29e9483a0da251c";
+
+check_md5_output($md5, $cmd, 1);
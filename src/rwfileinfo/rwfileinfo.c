@@ -112,6 +112,7 @@ enum info_fileinfo_id {
     RWINFO_PREFIX_MAP,
     RWINFO_IPSET,
     RWINFO_BAG,
+    RWINFO_BLOCK_INDEX,
     /* Last item is used to get a count of the above; it must be last */
     RWINFO_PROPERTY_COUNT
 };
@@ -145,7 +146,8 @@ static info_property_t info_props[RWINFO_PROPERTY_COUNT] = {
     {"annotations",         1},
     {"prefix-map",          1},
     {"ipset",               1},
-    {"bag",                 1}
+    {"bag",                 1},
+    {"block-index",         1}
 };
 
 /* whether to print the summary */
@@ -513,6 +515,34 @@ getNumberRecs(
 }
 
 
+/*
+ *  status = getNumberColumnarRecs(stream, &count);
+ *
+ *    As getNumberRecs(), except for a file in the FT_RWCOLUMNAR
+ *    format, whose records do not have a fixed size.  The records
+ *    are counted by skipping over them.
+ */
+static int
+getNumberColumnarRecs(
+    skstream_t         *stream,
+    int64_t            *count)
+{
+    size_t skipped;
+    int rv;
+
+    *count = 0;
+    do {
+        rv = skStreamSkipRecords(stream, SIZE_MAX, &skipped);
+        *count += skipped;
+    } while (SKSTREAM_OK == rv);
+    if (rv != SKSTREAM_ERR_EOF) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        return -1;
+    }
+    return 0;
+}
+
+
 /*
  *  status = printFileInfo(info, &total_recs, &total_bytes);
  *
@@ -654,7 +684,12 @@ printFileInfo(
     }
 
     if (info_props[RWINFO_COUNT_RECORDS].will_print) {
-        rv = getNumberRecs(stream, skHeaderGetRecordLength(hdr), &rec_count);
+        if (FT_RWCOLUMNAR == skHeaderGetFileFormat(hdr)) {
+            rv = getNumberColumnarRecs(stream, &rec_count);
+        } else {
+            rv = getNumberRecs(stream, skHeaderGetRecordLength(hdr),
+                               &rec_count);
+        }
         if (rv) {
             retval = -1;
         }
@@ -760,6 +795,17 @@ printFileInfo(
         }
     }
 
+    if (info_props[RWINFO_BLOCK_INDEX].will_print) {
+        he = skHeaderGetFirstMatch(hdr, SK_HENTRY_BLOCKINDEX_ID);
+        if (he) {
+            if (!no_titles) {
+                printf(LABEL_FMT, info_props[RWINFO_BLOCK_INDEX].label);
+            }
+            skHentryBlockindexPrint(he, stdout);
+            printf("\n");
+        }
+    }
+
     if (info_props[RWINFO_COMMAND_LINES].will_print) {
         count = 0;
         skHeaderIteratorBindType(&iter, hdr, SK_HENTRY_INVOCATION_ID);
@@ -95,6 +95,10 @@ FILE *dryrun_fp = NULL;
  * has not been provided */
 FILE *filenames_fp = NULL;
 
+/* where to print output for --print-plan; NULL when the switch has
+ * not been provided */
+FILE *print_plan_fp = NULL;
+
 /* input file specified by --input-pipe */
 const char *input_pipe = NULL;
 
@@ -115,11 +119,15 @@ int print_volume_stats = 0;
 /* total number of threads */
 uint32_t thread_count = RWFILTER_THREADS_DEFAULT;
 
+/* whether to split files into chunks and write records in the order
+ * they were read when using multiple threads */
+int ordered_output = 0;
+
 /* number of checks to preform */
 int checker_count = 0;
 
-/* function pointers to handle checking and or processing */
-checktype_t (*checker[MAX_CHECKERS])(rwRec*);
+/* the checks to perform, in the order they were specified */
+filter_checker_t checker[MAX_CHECKERS];
 
 
 
@@ -526,32 +534,25 @@ closeOneOutput(
 
 
 /*
- *  ok = filterFile(datafile, ipfile_basename, stats);
- *
- *    This is the actual filtering of the file 'datafile'.  The
- *    function will call the function to write the header if required.
- *    The 'ipfile_basename' parameter is passed to filterCheckFile();
- *    it should be NULL or contain the full-path (minus extension) of the
- *    file that contains Bloom filter or IPset information about the
- *    'datafile'.  The function returns 0 on success; or 1 if the
- *    input file could not be opened.
+ *  status = filterWriteRecords(recs, result, count, stats);
  *
- *    NOTE: There is a similar function, filterFileThreaded(), in
- *    rwfilterthread.c that is used when running with threads.
+ *    Process the block of 'count' records in 'recs' whose check
+ *    results are in 'result': add the records to the counts in
+ *    'stats' and write each record to the all-destinations and to
+ *    either the pass- or fail-destinations.  Stop when
+ *    'reading_records' becomes 0.  Return SKSTREAM_OK on success, or
+ *    the status of the last write that failed.
  */
-static int
-filterFile(
-    const char         *datafile,
-    const char         *ipfile_basename,
+int
+filterWriteRecords(
+    const rwRec        *recs,
+    const checktype_t  *result,
+    uint32_t            count,
     filter_stats_t     *stats)
 {
-    rwRec rwrec;
-    skstream_t *in_rwios;
-    int i;
-    int fail_entire_file = 0;
-    int result = RWF_PASS;
+    const rwRec *rwrec;
+    uint32_t i;
     int rv = SKSTREAM_OK;
-    int in_rv = SKSTREAM_OK;
 
     /* print record 'pr_rwrec' to all dest_type streams specified by
      * 'pr_dest_id' */
@@ -577,6 +578,179 @@ filterFile(
     }
 
 
+    for (i = 0; i < count && reading_records; ++i) {
+        rwrec = &recs[i];
+
+        /* increment number of read records */
+        INCR_REC_COUNT(stats->read, rwrec);
+
+        /* the all-dest */
+        if (dest_type[DEST_ALL].count) {
+            PRINT_REC_TO_DEST_ID(rwrec, DEST_ALL);
+#if 0 /* dest_type[DEST_ALL].max_records is never set */
+            /* close all streams for this destination type if we are
+             * at user's requested max.  If max_records is 0, this
+             * will never be true, and all records will be
+             * processed. */
+            if (stats->read.flows == dest_type[DEST_ALL].max_records) {
+                reading_records = closeOutputDests(DEST_ALL, 0);
+            }
+#endif  /* 0 */
+        }
+
+        switch (result[i]) {
+          case RWF_PASS:
+          case RWF_PASS_NOW:
+            /* increment number of record that pass */
+            INCR_REC_COUNT(stats->pass, rwrec);
+
+            /* the pass-dest */
+            if (dest_type[DEST_PASS].count) {
+                PRINT_REC_TO_DEST_ID(rwrec, DEST_PASS);
+                if (stats->pass.flows
+                    == dest_type[DEST_PASS].max_records)
+                {
+                    /* close all streams for this destination type
+                     * since we are at user's specified max. */
+                    reading_records = closeOutputDests(DEST_PASS, 0);
+                }
+            }
+            break;
+
+          case RWF_FAIL:
+            /* the fail-dest */
+            if (dest_type[DEST_FAIL].count) {
+                PRINT_REC_TO_DEST_ID(rwrec, DEST_FAIL);
+                if ((stats->read.flows - stats->pass.flows)
+                    == dest_type[DEST_FAIL].max_records)
+                {
+                    /* close all streams for this destination type
+                     * since we are at user's specified max. */
+                    reading_records = closeOutputDests(DEST_FAIL, 0);
+                }
+            }
+            break;
+
+          default:
+            break;
+        }
+    }
+
+  END:
+    return rv;
+}
+
+
+/*
+ *  read_block = filterBlockCallback(block, stats);
+ *
+ *    Callback invoked by skStreamReadRecord() for each block of
+ *    records in an input file that has a block index.  Return 0 when
+ *    filterCheckBlock() shows that no record in the block can pass,
+ *    after adding the block's records to the read count in 'stats'.
+ *    Otherwise, return 1 so the records are read.
+ */
+static int
+filterBlockCallback(
+    const skstream_block_t *block,
+    void                   *v_stats)
+{
+    filter_stats_t *stats = (filter_stats_t*)v_stats;
+
+    if (filterCheckBlock(block)) {
+        stats->read.flows += block->rec_count;
+        return 0;
+    }
+    return 1;
+}
+
+
+/*
+ *  filterSetBlockFilter(stream, stats);
+ *
+ *    When the records that fail the checks are not written anywhere
+ *    and their volume is not needed, tell 'stream' to skip the blocks
+ *    of records that cannot pass the checks.  The read count in
+ *    'stats' is incremented by the number of records skipped.  This
+ *    has no effect unless the file has a block index.
+ */
+void
+filterSetBlockFilter(
+    skstream_t         *stream,
+    filter_stats_t     *stats)
+{
+    if ((dest_type[DEST_ALL].count == 0)
+        && (dest_type[DEST_FAIL].count == 0)
+        && (print_volume_stats == 0))
+    {
+        skStreamSetBlockFilter(stream, filterBlockCallback, stats);
+    }
+}
+
+
+/*
+ *  filterSetColumnProjection(stream);
+ *
+ *    When the records are only counted and not written, tell 'stream'
+ *    to read only the columns that the checks examine.  This has no
+ *    effect unless the file uses the columnar format.
+ */
+void
+filterSetColumnProjection(
+    skstream_t         *stream)
+{
+    uint32_t columns;
+    int i;
+
+    if (dest_type[DEST_ALL].count || dest_type[DEST_FAIL].count
+        || dest_type[DEST_PASS].count)
+    {
+        return;
+    }
+    for (i = 0; i < checker_count; ++i) {
+        if (checker[i].fn != &filterCheck) {
+            return;
+        }
+    }
+    columns = filterGetCheckColumns();
+    if (print_volume_stats) {
+        columns |= SK_COLUMN_PKTS | SK_COLUMN_BYTES;
+    }
+    skStreamSetColumnProjection(stream, columns);
+}
+
+
+/*
+ *  ok = filterFile(datafile, ipfile_basename, stats);
+ *
+ *    This is the actual filtering of the file 'datafile'.  The
+ *    function will call the function to write the header if required.
+ *    The 'ipfile_basename' parameter is passed to filterCheckFile();
+ *    it should be NULL or contain the full-path (minus extension) of the
+ *    file that contains Bloom filter or IPset information about the
+ *    'datafile'.  The function returns 0 on success; or 1 if the
+ *    input file could not be opened.
+ *
+ *    NOTE: There is a similar function, filterFileThreaded(), in
+ *    rwfilterthread.c that is used when running with threads.
+ */
+int
+filterFile(
+    const char         *datafile,
+    const char         *ipfile_basename,
+    filter_stats_t     *stats)
+{
+    rwRec recs[RWFILTER_BATCH_RECS];
+    checktype_t result[RWFILTER_BATCH_RECS];
+    filter_plan_t plan;
+    skstream_t *in_rwios;
+    size_t nread;
+    uint32_t count;
+    uint32_t i;
+    int fail_entire_file = 0;
+    int rv = SKSTREAM_OK;
+    int in_rv = SKSTREAM_OK;
+
     /* nothing to do in dry-run mode but print the file names */
     if (dryrun_fp) {
         fprintf(dryrun_fp, "%s\n", datafile);
@@ -612,7 +786,6 @@ filterFile(
     if (filterCheckFile(in_rwios, ipfile_basename) == 1) {
         /* all records in the file will fail the user's tests */
         fail_entire_file = 1;
-        result = RWF_FAIL;
 
         /* determine if we can more efficiently handle the file */
         if ((dest_type[DEST_ALL].count == 0)
@@ -637,73 +810,37 @@ filterFile(
         }
     }
 
-    /* read and process each record */
-    while (reading_records
-           && (SKSTREAM_OK == (in_rv = skStreamReadRecord(in_rwios, &rwrec))))
-    {
-        /* increment number of read records */
-        INCR_REC_COUNT(stats->read, &rwrec);
+    /* skip blocks whose records cannot pass */
+    if (!fail_entire_file) {
+        filterSetBlockFilter(in_rwios, stats);
+        filterSetColumnProjection(in_rwios);
+    }
 
-        /* the all-dest */
-        if (dest_type[DEST_ALL].count) {
-            PRINT_REC_TO_DEST_ID(&rwrec, DEST_ALL);
-#if 0 /* dest_type[DEST_ALL].max_records is never set */
-            /* close all streams for this destination type if we are
-             * at user's requested max.  If max_records is 0, this
-             * will never be true, and all records will be
-             * processed. */
-            if (stats->read.flows == dest_type[DEST_ALL].max_records) {
-                reading_records = closeOutputDests(DEST_ALL, 0);
-            }
-#endif  /* 0 */
+    /* read and process the records in blocks */
+    filterPlanInit(&plan);
+    while (reading_records && SKSTREAM_OK == in_rv) {
+        /* fill the block */
+        in_rv = skStreamReadRecords(in_rwios, recs, RWFILTER_BATCH_RECS,
+                                    &nread);
+        count = (uint32_t)nread;
+        if (0 == count) {
+            break;
         }
 
-        if (!fail_entire_file) {
-            /* run all checker()'s until end or one doesn't pass */
-            for (i=0, result=RWF_PASS;
-                 i < checker_count && result == RWF_PASS;
-                 ++i)
-            {
-                result = (*(checker[i]))(&rwrec);
+        /* check every record in the block */
+        if (fail_entire_file) {
+            for (i = 0; i < count; ++i) {
+                result[i] = RWF_FAIL;
             }
+        } else {
+            filterCheckRecords(&plan, recs, count, result);
         }
 
-        switch (result) {
-          case RWF_PASS:
-          case RWF_PASS_NOW:
-            /* increment number of record that pass */
-            INCR_REC_COUNT(stats->pass, &rwrec);
-
-            /* the pass-dest */
-            if (dest_type[DEST_PASS].count) {
-                PRINT_REC_TO_DEST_ID(&rwrec, DEST_PASS);
-                if (stats->pass.flows == dest_type[DEST_PASS].max_records) {
-                    /* close all streams for this destination type
-                     * since we are at user's specified max. */
-                    reading_records = closeOutputDests(DEST_PASS, 0);
-                }
-            }
-            break;
-
-          case RWF_FAIL:
-            /* the fail-dest */
-            if (dest_type[DEST_FAIL].count) {
-                PRINT_REC_TO_DEST_ID(&rwrec, DEST_FAIL);
-                if ((stats->read.flows - stats->pass.flows)
-                    == dest_type[DEST_FAIL].max_records)
-                {
-                    /* close all streams for this destination type
-                     * since we are at user's specified max. */
-                    reading_records = closeOutputDests(DEST_FAIL, 0);
-                }
-            }
-            break;
+        /* process each record */
+        rv = filterWriteRecords(recs, result, count, stats);
+    } /* while (reading_records && in_rv == SKSTREAM_OK) */
 
-          default:
-            break;
-        }
-
-    } /* while (reading_records && skStreamReadRecord()) */
+    filterPlanFinish(&plan, datafile);
 
   END:
     if (in_rv == SKSTREAM_OK || in_rv == SKSTREAM_ERR_EOF) {
@@ -826,7 +963,11 @@ int main(int argc, char **argv)
         /* must dump the headers first */
         rv = writeHeaders(NULL);
         if (rv == SKSTREAM_OK) {
-            rv = threadedFilter(&stats);
+            if (ordered_output) {
+                rv = orderedFilter(&stats);
+            } else {
+                rv = threadedFilter(&stats);
+            }
         }
     } else
 #endif  /* SK_RWFILTER_THREADED */
@@ -84,6 +84,9 @@ RCSIDENTVAR(rcsID_RWFILTER_H, "$SiLK: rwfilter.h b7b8edebba12 2015-01-05 18:05:2
 /* where to send file names when --print-filenames is active */
 #define PRINT_FILENAMES_FH stderr
 
+/* where to send the filter plans when --print-plan is active */
+#define PRINT_PLAN_FH stderr
+
 /* whether rwfilter supports threads */
 #define SK_RWFILTER_THREADED 1
 
@@ -93,12 +96,29 @@ RCSIDENTVAR(rcsID_RWFILTER_H, "$SiLK: rwfilter.h b7b8edebba12 2015-01-05 18:05:2
 /* default number of threads to use */
 #define RWFILTER_THREADS_DEFAULT 1
 
+/* number of records in each chunk that is handed to a worker thread
+ * when --ordered-output is given; must be a multiple of
+ * RWFILTER_BATCH_RECS */
+#define RWFILTER_CHUNK_RECS  (16 * RWFILTER_BATCH_RECS)
+
 
 /* maximum number of dynamic libraries that we support */
 #define APP_MAX_DYNLIBS 8
 
-/* maximum number of filter checks */
-#define MAX_CHECKERS (APP_MAX_DYNLIBS + 2)
+/* maximum number of tests that filterCheck() supports */
+#define MAX_FILTER_CHECKS 64
+
+/* maximum number of filter checks: one for each filterCheck() test,
+ * one for tupleCheck(), and one for all the plug-ins */
+#define MAX_CHECKERS (MAX_FILTER_CHECKS + 2)
+
+/* number of records that are read and checked as a single block */
+#define RWFILTER_BATCH_RECS  512
+
+/* number of records at the start of each file that are used to
+ * measure the cost and selectivity of each check; must be a multiple
+ * of RWFILTER_BATCH_RECS */
+#define RWFILTER_PLAN_SAMPLE_RECS  (8 * RWFILTER_BATCH_RECS)
 
 /*
  *  The number and types of skstream_t output streams: pass, fail, all
@@ -146,6 +166,66 @@ typedef enum {
                                  * fails; run no more filters */
 } checktype_t;
 
+/*
+ *  sel_count = (*checker_fn)(test, recs, sel, sel_count, result);
+ *
+ *    Signature of a checker function.  'test' is the value of the
+ *    'test' member of the checker's filter_checker_t; it lets one
+ *    function implement several checks.  A checker is given a block
+ *    of records 'recs' and the selection vector 'sel', which holds the
+ *    'sel_count' indexes into 'recs' of the records that have passed
+ *    all previous checkers.  The checker applies its tests to the
+ *    selected records and compacts 'sel' so that it holds only the
+ *    records that pass; the relative order of the indexes in 'sel' is
+ *    maintained.  The return value is the new number of entries in
+ *    'sel'.
+ *
+ *    A record that fails is simply removed from 'sel'.  When a
+ *    checker removes a record for any other reason (RWF_PASS_NOW,
+ *    RWF_IGNORE), it must set that record's entry in 'result'.
+ */
+typedef uint32_t (*checker_fn_t)(
+    int                 test,
+    const rwRec        *recs,
+    uint32_t           *sel,
+    uint32_t            sel_count,
+    checktype_t        *result);
+
+/* a single check; the checks are stored in the checker[] array */
+typedef struct filter_checker_st {
+    /* function that implements the check */
+    checker_fn_t    fn;
+    /* value to pass as the 'test' argument to 'fn' */
+    int             test;
+    /* name of the check, for --print-plan */
+    const char     *name;
+    /* whether the position of this check is fixed at the end of the
+     * plan; true for checks that may return RWF_PASS_NOW or
+     * RWF_IGNORE, since moving them changes the result */
+    int             pinned;
+} filter_checker_t;
+
+/*
+ *    The filter plan is the order in which the checks are applied.
+ *    rwfilter measures the fraction of records each check passes and
+ *    the time each check takes over the first
+ *    RWFILTER_PLAN_SAMPLE_RECS records of every file, and then orders
+ *    the checks so that those that are cheap and that reject many
+ *    records run first.  Each thread has its own plan.
+ */
+typedef struct filter_plan_st {
+    /* number of records sampled from the current file */
+    uint32_t        sampled;
+    /* whether the order has been chosen for the current file */
+    int             chosen;
+    /* indexes into checker[] in the order to apply them */
+    int             order[MAX_CHECKERS];
+    /* for each checker, the number of sampled records that passed */
+    uint64_t        passed[MAX_CHECKERS];
+    /* for each checker, the time spent on the sampled records, in
+     * nanoseconds */
+    uint64_t        nsec[MAX_CHECKERS];
+} filter_plan_t;
 
 /*
  *  INCR_REC_COUNT(count, rec)
@@ -183,6 +263,10 @@ extern FILE *dryrun_fp;
  * has not been provided */
 extern FILE *filenames_fp;
 
+/* where to print output for --print-plan; NULL when the switch has
+ * not been provided */
+extern FILE *print_plan_fp;
+
 /* input file specified by --input-pipe; NULL when the switch has not
  * been provided */
 extern const char *input_pipe;
@@ -205,11 +289,15 @@ extern int print_volume_stats;
 /* number of total threads */
 extern uint32_t thread_count;
 
+/* whether to split files into chunks and write records in the order
+ * they were read when using multiple threads */
+extern int ordered_output;
+
 /* number of checks to preform */
 extern int checker_count;
 
-/* function pointers to handle checking and or processing */
-extern checktype_t (*checker[MAX_CHECKERS])(rwRec*);
+/* the checks to perform, in the order they were specified */
+extern filter_checker_t checker[MAX_CHECKERS];
 
 
 /* FUNCTION DECLARATIONS */
@@ -277,6 +365,41 @@ char *
 appNextInput(
     char               *buf,
     size_t              bufsize);
+int
+filterFile(
+    const char         *datafile,
+    const char         *ipfile_basename,
+    filter_stats_t     *stats);
+int
+filterWriteRecords(
+    const rwRec        *recs,
+    const checktype_t  *result,
+    uint32_t            count,
+    filter_stats_t     *stats);
+void
+filterSetBlockFilter(
+    skstream_t         *stream,
+    filter_stats_t     *stats);
+void
+filterSetColumnProjection(
+    skstream_t         *stream);
+
+
+/* filter plan functions (rwfilterplan.c) */
+
+void
+filterPlanInit(
+    filter_plan_t      *plan);
+void
+filterCheckRecords(
+    filter_plan_t      *plan,
+    const rwRec        *recs,
+    uint32_t            count,
+    checktype_t        *result);
+void
+filterPlanFinish(
+    filter_plan_t      *plan,
+    const char         *datafile);
 
 
 /* filtering  functions (rwfiltercheck.c) */
@@ -285,15 +408,28 @@ int
 filterCheckFile(
     skstream_t         *path,
     const char         *ip_dir);
-checktype_t
+int
+filterCheckBlock(
+    const skstream_block_t *block);
+uint32_t
 filterCheck(
-    const rwRec        *rwrec);
+    int                 test,
+    const rwRec        *recs,
+    uint32_t           *sel,
+    uint32_t            sel_count,
+    checktype_t        *result);
 void
 filterUsage(
     FILE*);
 int
 filterGetCheckCount(
     void);
+const char *
+filterGetCheckName(
+    int                 test);
+uint32_t
+filterGetCheckColumns(
+    void);
 int
 filterGetFGlobFilters(
     void);
@@ -316,9 +452,13 @@ tupleTeardown(
 void
 tupleUsage(
     FILE               *fh);
-checktype_t
+uint32_t
 tupleCheck(
-    const rwRec        *rwrec);
+    int                 test,
+    const rwRec        *recs,
+    uint32_t           *sel,
+    uint32_t            sel_count,
+    checktype_t        *result);
 int
 tupleGetCheckCount(
     void);
@@ -330,6 +470,9 @@ tupleGetCheckCount(
 int
 threadedFilter(
     filter_stats_t     *stats);
+int
+orderedFilter(
+    filter_stats_t     *stats);
 
 
 
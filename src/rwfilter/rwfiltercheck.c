@@ -92,7 +92,7 @@ RCSIDENT("$SiLK: rwfiltercheck.c b7b8edebba12 2015-01-05 18:05:21Z mthomas $");
 #define MAX_ATTRIBUTE_CHECKS        8
 
 /* number of filter checks.  Approx equal to number of options */
-#define FILTER_CHECK_MAX 64
+#define FILTER_CHECK_MAX MAX_FILTER_CHECKS
 
 /* number of IP Wildcards, IPsets, lists of CIDR blocks */
 #define IP_INDEX_COUNT     4
@@ -1060,395 +1060,565 @@ compatOptionsHandler(
 
 
 /*
- *  pass = filterCheck(&rwrec)
+ *  pass = filterCheckTest(&rwrec, check_id)
  *
- *    Check the rw record 'rwrec' against all of the checks the user
- *    specified.  If the record fails any check, RWF_PASS is returned.
- *    If the record passes all of the checks, RWF_FAIL is returned.
+ *    Check the rw record 'rwrec' against the single check 'check_id',
+ *    which is one of the values in the checkSet[] array.  Return 1 if
+ *    the record passes the check or 0 if it fails.
  */
-checktype_t
-filterCheck(
-    const rwRec        *rwrec)
+static int
+filterCheckTest(
+    const rwRec        *rwrec,
+    int                 check_id)
 {
     unsigned int i;
-    int j;
     int wanted;
     skipaddr_t ip1;
     skipaddr_t ip2;
     skcidr_t *cidr;
 
-/* If (test) is zero, the record fails the filter and a non-zero value
- * is returned.  Else we continue with additional checks. */
+/* If (test) is zero, the record fails the filter and zero is
+ * returned.  Else we continue with additional checks. */
 #define FILTER_CHECK(test) \
-    if (test) {/*pass*/} else return RWF_FAIL
+    if (test) {/*pass*/} else return 0
 
 
-    for (j = 0; j < checks->check_count; j++) {
-        switch (checks->checkSet[j]) {
+    switch (check_id) {
+      case OPT_STIME:
+        FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetStartTime(rwrec),
+                                 checks->sTime));
+        break;
 
-          case OPT_STIME:
-            FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetStartTime(rwrec),
-                                     checks->sTime));
-            break;
+      case OPT_ETIME:
+        FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetEndTime(rwrec),
+                                 checks->eTime));
+        break;
 
-          case OPT_ETIME:
-            FILTER_CHECK(CHECK_RANGE((uint64_t)rwRecGetEndTime(rwrec),
-                                     checks->eTime));
-            break;
+      case OPT_ACTIVE_TIME:
+        /* to pass the record; check that flow's start time is
+         * less than the max value of range and that flow's end
+         * time is greater than the min value of the range. */
+        FILTER_CHECK((uint64_t)rwRecGetStartTime(rwrec)
+                     <= checks->active_time.max);
+        FILTER_CHECK((uint64_t)rwRecGetEndTime(rwrec)
+                     >= checks->active_time.min);
+        break;
 
-          case OPT_ACTIVE_TIME:
-            /* to pass the record; check that flow's start time is
-             * less than the max value of range and that flow's end
-             * time is greater than the min value of the range. */
-            FILTER_CHECK((uint64_t)rwRecGetStartTime(rwrec)
-                         <= checks->active_time.max);
-            FILTER_CHECK((uint64_t)rwRecGetEndTime(rwrec)
-                         >= checks->active_time.min);
-            break;
+      case OPT_DURATION:
+        FILTER_CHECK(CHECK_RANGE(rwRecGetElapsed(rwrec),
+                                 checks->elapsed));
+        break;
 
-          case OPT_DURATION:
-            FILTER_CHECK(CHECK_RANGE(rwRecGetElapsed(rwrec),
-                                     checks->elapsed));
-            break;
+      case OPT_SPORT:
+        FILTER_CHECK(skBitmapGetBit(checks->sPort, rwRecGetSPort(rwrec)));
+        break;
 
-          case OPT_SPORT:
-            FILTER_CHECK(skBitmapGetBit(checks->sPort, rwRecGetSPort(rwrec)));
-            break;
+      case OPT_DPORT:
+        FILTER_CHECK(skBitmapGetBit(checks->dPort, rwRecGetDPort(rwrec)));
+        break;
 
-          case OPT_DPORT:
-            FILTER_CHECK(skBitmapGetBit(checks->dPort, rwRecGetDPort(rwrec)));
-            break;
+      case OPT_APORT:
+        FILTER_CHECK(skBitmapGetBit(checks->any_port, rwRecGetSPort(rwrec))
+                     || skBitmapGetBit(checks->any_port,
+                                       rwRecGetDPort(rwrec)));
+        break;
 
-          case OPT_APORT:
-            FILTER_CHECK(skBitmapGetBit(checks->any_port, rwRecGetSPort(rwrec))
-                         || skBitmapGetBit(checks->any_port,
-                                           rwRecGetDPort(rwrec)));
-            break;
+      case OPT_PROTOCOL:
+        FILTER_CHECK(skBitmapGetBit(checks->proto, rwRecGetProto(rwrec)));
+        break;
 
-          case OPT_PROTOCOL:
-            FILTER_CHECK(skBitmapGetBit(checks->proto, rwRecGetProto(rwrec)));
-            break;
+      case OPT_ICMP_TYPE:
+        FILTER_CHECK(rwRecIsICMP(rwrec)
+                     && skBitmapGetBit(checks->icmp_type,
+                                       rwRecGetIcmpType(rwrec)));
+        break;
 
-          case OPT_ICMP_TYPE:
-            FILTER_CHECK(rwRecIsICMP(rwrec)
-                         && skBitmapGetBit(checks->icmp_type,
-                                           rwRecGetIcmpType(rwrec)));
-            break;
+      case OPT_ICMP_CODE:
+        FILTER_CHECK(rwRecIsICMP(rwrec)
+                     && skBitmapGetBit(checks->icmp_code,
+                                       rwRecGetIcmpCode(rwrec)));
+        break;
 
-          case OPT_ICMP_CODE:
-            FILTER_CHECK(rwRecIsICMP(rwrec)
-                         && skBitmapGetBit(checks->icmp_code,
-                                           rwRecGetIcmpCode(rwrec)));
-            break;
+      case OPT_BYTES:
+        FILTER_CHECK(CHECK_RANGE(rwRecGetBytes(rwrec), checks->bytes));
+        break;
 
-          case OPT_BYTES:
-            FILTER_CHECK(CHECK_RANGE(rwRecGetBytes(rwrec), checks->bytes));
-            break;
+      case OPT_PACKETS:
+        FILTER_CHECK(CHECK_RANGE(rwRecGetPkts(rwrec), checks->pkts));
+        break;
 
-          case OPT_PACKETS:
-            FILTER_CHECK(CHECK_RANGE(rwRecGetPkts(rwrec), checks->pkts));
-            break;
+      case OPT_BYTES_PER_PACKET:
+        FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
+                                  / (double)rwRecGetPkts(rwrec)),
+                                 checks->bytes_per_packet));
+        break;
 
-          case OPT_BYTES_PER_PACKET:
+#if RATE_FILTERS
+      case OPT_BYTES_PER_SECOND:
+        if (rwRecGetElapsed(rwrec) > 0) {
             FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
-                                      / (double)rwRecGetPkts(rwrec)),
-                                     checks->bytes_per_packet));
-            break;
+                                      / (double)rwRecGetElapsed(rwrec)),
+                                     checks->bytes_per_second));
+        } else {
+            /* use a one second duration */
+            FILTER_CHECK(CHECK_RANGE((double)rwRecGetBytes(rwrec),
+                                     checks->bytes_per_second));
+        }
+        break;
 
-#if RATE_FILTERS
-          case OPT_BYTES_PER_SECOND:
-            if (rwRecGetElapsed(rwrec) > 0) {
-                FILTER_CHECK(CHECK_RANGE(((double)rwRecGetBytes(rwrec)
-                                          / (double)rwRecGetElapsed(rwrec)),
-                                         checks->bytes_per_second));
-            } else {
-                /* use a one second duration */
-                FILTER_CHECK(CHECK_RANGE((double)rwRecGetBytes(rwrec),
-                                         checks->bytes_per_second));
+      case OPT_PACKETS_PER_SECOND:
+        if (rwRecGetElapsed(rwrec) > 0) {
+            FILTER_CHECK(CHECK_RANGE(((double)rwRecGetPkts(rwrec)
+                                      / (double)rwRecGetElapsed(rwrec)),
+                                     checks->packets_per_second));
+        } else {
+            /* use a one second duration */
+            FILTER_CHECK(CHECK_RANGE((double)rwRecGetPkts(rwrec),
+                                     checks->packets_per_second));
+        }
+        break;
+#endif  /* RATE_FILTERS */
+
+      case OPT_NOT_SCIDR:
+      case OPT_SCIDR:
+        rwRecMemGetSIP(rwrec, &ip1);
+        wanted = checks->cidr_negated[SRC];
+        for (i = 0, cidr = checks->cidr_list[SRC];
+             i < checks->cidr_list_len[SRC];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)) {
+                wanted = !wanted;
+                break;
             }
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_PACKETS_PER_SECOND:
-            if (rwRecGetElapsed(rwrec) > 0) {
-                FILTER_CHECK(CHECK_RANGE(((double)rwRecGetPkts(rwrec)
-                                          / (double)rwRecGetElapsed(rwrec)),
-                                         checks->packets_per_second));
-            } else {
-                /* use a one second duration */
-                FILTER_CHECK(CHECK_RANGE((double)rwRecGetPkts(rwrec),
-                                         checks->packets_per_second));
+      case OPT_NOT_DCIDR:
+      case OPT_DCIDR:
+        rwRecMemGetDIP(rwrec, &ip1);
+        wanted = checks->cidr_negated[DST];
+        for (i = 0, cidr = checks->cidr_list[DST];
+             i < checks->cidr_list_len[DST];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)) {
+                wanted = !wanted;
+                break;
             }
-            break;
-#endif  /* RATE_FILTERS */
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_SCIDR:
-          case OPT_SCIDR:
-            rwRecMemGetSIP(rwrec, &ip1);
-            wanted = checks->cidr_negated[SRC];
-            for (i = 0, cidr = checks->cidr_list[SRC];
-                 i < checks->cidr_list_len[SRC];
-                 ++i, ++cidr)
+      case OPT_NOT_NHCIDR:
+      case OPT_NHCIDR:
+        rwRecMemGetNhIP(rwrec, &ip1);
+        wanted = checks->cidr_negated[NHIP];
+        for (i = 0, cidr = checks->cidr_list[NHIP];
+             i < checks->cidr_list_len[NHIP];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)) {
+                wanted = !wanted;
+                break;
+            }
+        }
+        FILTER_CHECK(wanted);
+        break;
+
+      case OPT_NOT_ANY_CIDR:
+      case OPT_ANY_CIDR:
+        rwRecMemGetSIP(rwrec, &ip1);
+        rwRecMemGetDIP(rwrec, &ip2);
+        wanted = checks->cidr_negated[ANY];
+        for (i = 0, cidr = checks->cidr_list[ANY];
+             i < checks->cidr_list_len[ANY];
+             ++i, ++cidr)
+        {
+            if (skcidrCheckIP(cidr, &ip1)
+                || skcidrCheckIP(cidr, &ip2))
             {
-                if (skcidrCheckIP(cidr, &ip1)) {
-                    wanted = !wanted;
-                    break;
-                }
+                wanted = !wanted;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_DCIDR:
-          case OPT_DCIDR:
-            rwRecMemGetDIP(rwrec, &ip1);
-            wanted = checks->cidr_negated[DST];
-            for (i = 0, cidr = checks->cidr_list[DST];
-                 i < checks->cidr_list_len[DST];
-                 ++i, ++cidr)
+      case OPT_NOT_SADDRESS:
+      case OPT_SADDRESS:
+        /* Check if record's sIP matches the bitmap.  The record
+         * FAILS the filter when the result of the check MATCHES
+         * the status of the negate flag.  E.g., the record
+         * matches the address-bitmap (skIPWildcardCheckIp()==1)
+         * and the user entered --not-saddr (ipwild_negate==1).
+         * Since the record FAILS when the values are equal, it
+         * will PASS when they are not-equal; i.e., when the
+         * XOR(^) of the two values is true.
+         */
+        rwRecMemGetSIP(rwrec, &ip1);
+        FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[SRC], &ip1)
+                     ^ checks->ipwild_negate[SRC]);
+        break;
+
+      case OPT_NOT_DADDRESS:
+      case OPT_DADDRESS:
+        rwRecMemGetDIP(rwrec, &ip1);
+        FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[DST], &ip1)
+                     ^ checks->ipwild_negate[DST]);
+        break;
+
+      case OPT_NOT_NEXT_HOP_ID:
+      case OPT_NEXT_HOP_ID:
+        rwRecMemGetNhIP(rwrec, &ip1);
+        FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[NHIP], &ip1)
+                     ^ checks->ipwild_negate[NHIP]);
+        break;
+
+      case OPT_NOT_ANY_ADDRESS:
+      case OPT_ANY_ADDRESS:
+        rwRecMemGetSIP(rwrec, &ip1);
+        rwRecMemGetDIP(rwrec, &ip2);
+        FILTER_CHECK((skIPWildcardCheckIp(&checks->ipwild[ANY], &ip1)
+                      | skIPWildcardCheckIp(&checks->ipwild[ANY], &ip2))
+                     ^ checks->ipwild_negate[ANY]);
+        break;
+
+      case OPT_NOT_SET_SIP:
+      case OPT_SET_SIP:
+        /* As with OPT_SADDRESS, for the record to pass the
+         * filter, the result of the check must not equal the
+         * result of the negate flag. */
+        FILTER_CHECK(skIPSetCheckRecordSIP(checks->ipset[SRC], rwrec)
+                     ^ checks->ipset_reject[SRC]);
+        break;
+
+      case OPT_NOT_SET_DIP:
+      case OPT_SET_DIP:
+        FILTER_CHECK(skIPSetCheckRecordDIP(checks->ipset[DST], rwrec)
+                     ^ checks->ipset_reject[DST]);
+        break;
+
+      case OPT_NOT_SET_NHIP:
+      case OPT_SET_NHIP:
+        FILTER_CHECK(skIPSetCheckRecordNhIP(checks->ipset[NHIP], rwrec)
+                     ^ checks->ipset_reject[NHIP]);
+        break;
+
+      case OPT_NOT_SET_ANY:
+      case OPT_SET_ANY:
+        FILTER_CHECK((skIPSetCheckRecordSIP(checks->ipset[ANY], rwrec)
+                      | skIPSetCheckRecordDIP(checks->ipset[ANY], rwrec))
+                     ^ checks->ipset_reject[ANY]);
+        break;
+
+      case OPT_INPUT_INDEX:
+        FILTER_CHECK(skBitmapGetBit(checks->input_index,
+                                    rwRecGetInput(rwrec)));
+        break;
+
+      case OPT_OUTPUT_INDEX:
+        FILTER_CHECK(skBitmapGetBit(checks->output_index,
+                                    rwRecGetOutput(rwrec)));
+        break;
+
+      case OPT_ANY_INDEX:
+        FILTER_CHECK(skBitmapGetBit(checks->any_index,rwRecGetInput(rwrec))
+                     || skBitmapGetBit(checks->any_index,
+                                       rwRecGetOutput(rwrec)));
+        break;
+
+        /*
+         * TCP check.  Passes if there's an intersection between
+         * the raised flags and the filter flags.
+         */
+      case OPT_TCP_FLAGS:
+        FILTER_CHECK(checks->flags & rwRecGetFlags(rwrec));
+        break;
+
+      case OPT_FLAGS_ALL:
+        wanted = 0;
+        for (i = 0; i < checks->count_flags_all; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetFlags(rwrec),
+                                    checks->flags_all[i]))
             {
-                if (skcidrCheckIP(cidr, &ip1)) {
-                    wanted = !wanted;
-                    break;
-                }
+                wanted = 1;
+                break; /* wanted */
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_NHCIDR:
-          case OPT_NHCIDR:
-            rwRecMemGetNhIP(rwrec, &ip1);
-            wanted = checks->cidr_negated[NHIP];
-            for (i = 0, cidr = checks->cidr_list[NHIP];
-                 i < checks->cidr_list_len[NHIP];
-                 ++i, ++cidr)
+      case OPT_FLAGS_INITIAL:
+        wanted = 0;
+        for (i = 0; i < checks->count_flags_init; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetInitFlags(rwrec),
+                                    checks->flags_init[i]))
             {
-                if (skcidrCheckIP(cidr, &ip1)) {
-                    wanted = !wanted;
-                    break;
-                }
+                wanted = 1;
+                break; /* wanted */
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_ANY_CIDR:
-          case OPT_ANY_CIDR:
-            rwRecMemGetSIP(rwrec, &ip1);
-            rwRecMemGetDIP(rwrec, &ip2);
-            wanted = checks->cidr_negated[ANY];
-            for (i = 0, cidr = checks->cidr_list[ANY];
-                 i < checks->cidr_list_len[ANY];
-                 ++i, ++cidr)
+      case OPT_FLAGS_SESSION:
+        wanted = 0;
+        for (i = 0; i < checks->count_flags_session; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetRestFlags(rwrec),
+                                    checks->flags_session[i]))
             {
-                if (skcidrCheckIP(cidr, &ip1)
-                    || skcidrCheckIP(cidr, &ip2))
-                {
-                    wanted = !wanted;
-                    break;
-                }
+                wanted = 1;
+                break;
             }
-            FILTER_CHECK(wanted);
-            break;
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_SADDRESS:
-          case OPT_SADDRESS:
-            /* Check if record's sIP matches the bitmap.  The record
-             * FAILS the filter when the result of the check MATCHES
-             * the status of the negate flag.  E.g., the record
-             * matches the address-bitmap (skIPWildcardCheckIp()==1)
-             * and the user entered --not-saddr (ipwild_negate==1).
-             * Since the record FAILS when the values are equal, it
-             * will PASS when they are not-equal; i.e., when the
-             * XOR(^) of the two values is true.
-             */
-            rwRecMemGetSIP(rwrec, &ip1);
-            FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[SRC], &ip1)
-                         ^ checks->ipwild_negate[SRC]);
-            break;
+      case OPT_ATTRIBUTES:
+        wanted = 0;
+        for (i = 0; i < checks->count_attributes; ++i) {
+            if (CHECK_TCP_HIGH_MASK(rwRecGetTcpState(rwrec),
+                                    checks->attributes[i]))
+            {
+                wanted = 1;
+                break;
+            }
+        }
+        FILTER_CHECK(wanted);
+        break;
 
-          case OPT_NOT_DADDRESS:
-          case OPT_DADDRESS:
-            rwRecMemGetDIP(rwrec, &ip1);
-            FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[DST], &ip1)
-                         ^ checks->ipwild_negate[DST]);
-            break;
+      case OPT_APPLICATION:
+        FILTER_CHECK(skBitmapGetBit(checks->application,
+                                    rwRecGetApplication(rwrec)));
+        break;
 
-          case OPT_NOT_NEXT_HOP_ID:
-          case OPT_NEXT_HOP_ID:
-            rwRecMemGetNhIP(rwrec, &ip1);
-            FILTER_CHECK(skIPWildcardCheckIp(&checks->ipwild[NHIP], &ip1)
-                         ^ checks->ipwild_negate[NHIP]);
+      case OPT_IP_VERSION:
+        switch (checks->ipv6_policy) {
+          case SK_IPV6POLICY_MIX:
             break;
-
-          case OPT_NOT_ANY_ADDRESS:
-          case OPT_ANY_ADDRESS:
-            rwRecMemGetSIP(rwrec, &ip1);
-            rwRecMemGetDIP(rwrec, &ip2);
-            FILTER_CHECK((skIPWildcardCheckIp(&checks->ipwild[ANY], &ip1)
-                          | skIPWildcardCheckIp(&checks->ipwild[ANY], &ip2))
-                         ^ checks->ipwild_negate[ANY]);
+          case SK_IPV6POLICY_ONLY:
+            FILTER_CHECK(rwRecIsIPv6(rwrec));
             break;
-
-          case OPT_NOT_SET_SIP:
-          case OPT_SET_SIP:
-            /* As with OPT_SADDRESS, for the record to pass the
-             * filter, the result of the check must not equal the
-             * result of the negate flag. */
-            FILTER_CHECK(skIPSetCheckRecordSIP(checks->ipset[SRC], rwrec)
-                         ^ checks->ipset_reject[SRC]);
+          case SK_IPV6POLICY_IGNORE:
+            FILTER_CHECK(!rwRecIsIPv6(rwrec));
             break;
+          case SK_IPV6POLICY_ASV4:
+          case SK_IPV6POLICY_FORCE:
+            /* can't happen */
+            skAbortBadCase(checks->ipv6_policy);
+        }
+        break;
 
-          case OPT_NOT_SET_DIP:
-          case OPT_SET_DIP:
-            FILTER_CHECK(skIPSetCheckRecordDIP(checks->ipset[DST], rwrec)
-                         ^ checks->ipset_reject[DST]);
-            break;
+      case OPT_SENSORS:
+        FILTER_CHECK(skBitmapGetBit(checks->sID, rwRecGetSensor(rwrec)));
+        break;
 
-          case OPT_NOT_SET_NHIP:
-          case OPT_SET_NHIP:
-            FILTER_CHECK(skIPSetCheckRecordNhIP(checks->ipset[NHIP], rwrec)
-                         ^ checks->ipset_reject[NHIP]);
-            break;
+      case OPT_FLOW_TYPE:
+        FILTER_CHECK(skBitmapGetBit(checks->flow_type,
+                                    rwRecGetFlowType(rwrec)));
+        break;
 
-          case OPT_NOT_SET_ANY:
-          case OPT_SET_ANY:
-            FILTER_CHECK((skIPSetCheckRecordSIP(checks->ipset[ANY], rwrec)
-                          | skIPSetCheckRecordDIP(checks->ipset[ANY], rwrec))
-                         ^ checks->ipset_reject[ANY]);
-            break;
+      case OPT_SCC:
+        rwRecMemGetSIP(rwrec, &ip1);
+        FILTER_CHECK(skBitmapGetBit(checks->scc,
+                                    skCountryLookupCode(&ip1)));
+        break;
 
-          case OPT_INPUT_INDEX:
-            FILTER_CHECK(skBitmapGetBit(checks->input_index,
-                                        rwRecGetInput(rwrec)));
-            break;
+      case OPT_DCC:
+        rwRecMemGetDIP(rwrec, &ip1);
+        FILTER_CHECK(skBitmapGetBit(checks->dcc,
+                                    skCountryLookupCode(&ip1)));
+        break;
 
-          case OPT_OUTPUT_INDEX:
-            FILTER_CHECK(skBitmapGetBit(checks->output_index,
-                                        rwRecGetOutput(rwrec)));
-            break;
+      case OPT_ANY_CC:
+        rwRecMemGetSIP(rwrec, &ip1);
+        rwRecMemGetDIP(rwrec, &ip2);
+        FILTER_CHECK(skBitmapGetBit(checks->any_cc,
+                                    skCountryLookupCode(&ip1))
+                     || skBitmapGetBit(checks->any_cc,
+                                       skCountryLookupCode(&ip2)));
+        break;
 
-          case OPT_ANY_INDEX:
-            FILTER_CHECK(skBitmapGetBit(checks->any_index,rwRecGetInput(rwrec))
-                         || skBitmapGetBit(checks->any_index,
-                                           rwRecGetOutput(rwrec)));
-            break;
+      default:
+        skAbortBadCase(check_id);
+    }
 
-            /*
-             * TCP check.  Passes if there's an intersection between
-             * the raised flags and the filter flags.
-             */
-          case OPT_TCP_FLAGS:
-            FILTER_CHECK(checks->flags & rwRecGetFlags(rwrec));
-            break;
+    return 1;                     /* WANTED! */
+}
 
-          case OPT_FLAGS_ALL:
-            wanted = 0;
-            for (i = 0; i < checks->count_flags_all; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetFlags(rwrec),
-                                        checks->flags_all[i]))
-                {
-                    wanted = 1;
-                    break; /* wanted */
-                }
-            }
-            FILTER_CHECK(wanted);
-            break;
 
-          case OPT_FLAGS_INITIAL:
-            wanted = 0;
-            for (i = 0; i < checks->count_flags_init; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetInitFlags(rwrec),
-                                        checks->flags_init[i]))
-                {
-                    wanted = 1;
-                    break; /* wanted */
-                }
-            }
-            FILTER_CHECK(wanted);
-            break;
+/*
+ *  sel_count = filterCheck(test, recs, sel, sel_count, result)
+ *
+ *    Check the block of records 'recs' against the check the user
+ *    specified at position 'test' in the checkSet[] array.  'sel'
+ *    holds the 'sel_count' indexes into 'recs' of the records to
+ *    check.  The check is applied across the entire selection, and
+ *    the records that fail it are removed from 'sel'.  Return the
+ *    number of records that pass; their indexes are at the front of
+ *    'sel'.
+ *
+ *    The simple range and bitmap checks are written as tight loops
+ *    that keep every record's index and advance the output position
+ *    only when the record passes; the IPset checks probe the IPset
+ *    for all selected records with skIPSetCheckRecords(); the
+ *    remaining checks call filterCheckTest() for each selected
+ *    record.
+ */
+uint32_t
+filterCheck(
+    int                 test,
+    const rwRec        *recs,
+    uint32_t           *sel,
+    uint32_t            sel_count,
+    checktype_t  UNUSED(*result))
+{
+    const rwRec *rwrec;
+    uint8_t found[RWFILTER_BATCH_RECS];
+    uint32_t kept;
+    uint32_t i;
+
+/* Narrow 'sel' to the records for which (cond) is non-zero.  (cond)
+ * should reference the record using the 'rwrec' variable. */
+#define FILTER_CHECK_BATCH(cond)                \
+    for (i = 0, kept = 0; i < sel_count; ++i) { \
+        rwrec = &recs[sel[i]];                  \
+        sel[kept] = sel[i];                     \
+        kept += !!(cond);                       \
+    }                                           \
+    sel_count = kept
+
+/* Narrow 'sel' to the records where an IP chosen by (src_dst_nh) is
+ * in the IPset at position (idx), or is not in it when the IPset
+ * was given to a --not-*set switch.  The IPset is probed for the
+ * entire selection at once. */
+#define FILTER_CHECK_IPSET_BATCH(idx, src_dst_nh)                       \
+    skIPSetCheckRecords(checks->ipset[idx], recs, sel, sel_count,       \
+                        (src_dst_nh), found);                           \
+    for (i = 0, kept = 0; i < sel_count; ++i) {                         \
+        sel[kept] = sel[i];                                             \
+        kept += (found[i] ^ !!checks->ipset_reject[idx]);               \
+    }                                                                   \
+    sel_count = kept
+
+/* Branch-free version of CHECK_RANGE() */
+#define CHECK_RANGE_BATCH(v, r)   (((v) >= (r).min) & ((v) <= (r).max))
+
+
+    assert(test >= 0 && test < checks->check_count);
+
+    switch (checks->checkSet[test]) {
+      case OPT_STIME:
+        FILTER_CHECK_BATCH(
+            CHECK_RANGE_BATCH((uint64_t)rwRecGetStartTime(rwrec),
+                              checks->sTime));
+        break;
 
-          case OPT_FLAGS_SESSION:
-            wanted = 0;
-            for (i = 0; i < checks->count_flags_session; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetRestFlags(rwrec),
-                                        checks->flags_session[i]))
-                {
-                    wanted = 1;
-                    break;
-                }
-            }
-            FILTER_CHECK(wanted);
-            break;
+      case OPT_ETIME:
+        FILTER_CHECK_BATCH(
+            CHECK_RANGE_BATCH((uint64_t)rwRecGetEndTime(rwrec),
+                              checks->eTime));
+        break;
 
-          case OPT_ATTRIBUTES:
-            wanted = 0;
-            for (i = 0; i < checks->count_attributes; ++i) {
-                if (CHECK_TCP_HIGH_MASK(rwRecGetTcpState(rwrec),
-                                        checks->attributes[i]))
-                {
-                    wanted = 1;
-                    break;
-                }
-            }
-            FILTER_CHECK(wanted);
-            break;
+      case OPT_ACTIVE_TIME:
+        FILTER_CHECK_BATCH(
+            (((uint64_t)rwRecGetStartTime(rwrec)
+              <= checks->active_time.max)
+             & ((uint64_t)rwRecGetEndTime(rwrec)
+                >= checks->active_time.min)));
+        break;
 
-          case OPT_APPLICATION:
-            FILTER_CHECK(skBitmapGetBit(checks->application,
-                                        rwRecGetApplication(rwrec)));
-            break;
+      case OPT_DURATION:
+        FILTER_CHECK_BATCH(
+            CHECK_RANGE_BATCH((uint64_t)rwRecGetElapsed(rwrec),
+                              checks->elapsed));
+        break;
 
-          case OPT_IP_VERSION:
-            switch (checks->ipv6_policy) {
-              case SK_IPV6POLICY_MIX:
-                break;
-              case SK_IPV6POLICY_ONLY:
-                FILTER_CHECK(rwRecIsIPv6(rwrec));
-                break;
-              case SK_IPV6POLICY_IGNORE:
-                FILTER_CHECK(!rwRecIsIPv6(rwrec));
-                break;
-              case SK_IPV6POLICY_ASV4:
-              case SK_IPV6POLICY_FORCE:
-                /* can't happen */
-                skAbortBadCase(checks->ipv6_policy);
-            }
-            break;
+      case OPT_SPORT:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->sPort, rwRecGetSPort(rwrec)));
+        break;
 
-          case OPT_SENSORS:
-            FILTER_CHECK(skBitmapGetBit(checks->sID, rwRecGetSensor(rwrec)));
-            break;
+      case OPT_DPORT:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->dPort, rwRecGetDPort(rwrec)));
+        break;
 
-          case OPT_FLOW_TYPE:
-            FILTER_CHECK(skBitmapGetBit(checks->flow_type,
-                                        rwRecGetFlowType(rwrec)));
-            break;
+      case OPT_APORT:
+        FILTER_CHECK_BATCH(
+            (skBitmapGetBit(checks->any_port, rwRecGetSPort(rwrec))
+             | skBitmapGetBit(checks->any_port, rwRecGetDPort(rwrec))));
+        break;
 
-          case OPT_SCC:
-            rwRecMemGetSIP(rwrec, &ip1);
-            FILTER_CHECK(skBitmapGetBit(checks->scc,
-                                        skCountryLookupCode(&ip1)));
-            break;
+      case OPT_PROTOCOL:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->proto, rwRecGetProto(rwrec)));
+        break;
 
-          case OPT_DCC:
-            rwRecMemGetDIP(rwrec, &ip1);
-            FILTER_CHECK(skBitmapGetBit(checks->dcc,
-                                        skCountryLookupCode(&ip1)));
-            break;
+      case OPT_BYTES:
+        FILTER_CHECK_BATCH(
+            CHECK_RANGE_BATCH((uint64_t)rwRecGetBytes(rwrec),
+                              checks->bytes));
+        break;
 
-          case OPT_ANY_CC:
-            rwRecMemGetSIP(rwrec, &ip1);
-            rwRecMemGetDIP(rwrec, &ip2);
-            FILTER_CHECK(skBitmapGetBit(checks->any_cc,
-                                        skCountryLookupCode(&ip1))
-                         || skBitmapGetBit(checks->any_cc,
-                                           skCountryLookupCode(&ip2)));
-            break;
+      case OPT_PACKETS:
+        FILTER_CHECK_BATCH(
+            CHECK_RANGE_BATCH((uint64_t)rwRecGetPkts(rwrec),
+                              checks->pkts));
+        break;
 
-          default:
-            skAbortBadCase(checks->checkSet[j]);
-        }
-    } /* outer for */
+      case OPT_INPUT_INDEX:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->input_index, rwRecGetInput(rwrec)));
+        break;
+
+      case OPT_OUTPUT_INDEX:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->output_index, rwRecGetOutput(rwrec)));
+        break;
+
+      case OPT_TCP_FLAGS:
+        FILTER_CHECK_BATCH(checks->flags & rwRecGetFlags(rwrec));
+        break;
+
+      case OPT_SENSORS:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->sID, rwRecGetSensor(rwrec)));
+        break;
+
+      case OPT_FLOW_TYPE:
+        FILTER_CHECK_BATCH(
+            skBitmapGetBit(checks->flow_type, rwRecGetFlowType(rwrec)));
+        break;
 
-    return RWF_PASS;                     /* WANTED! */
+      case OPT_NOT_SET_SIP:
+      case OPT_SET_SIP:
+        FILTER_CHECK_IPSET_BATCH(SRC, 1);
+        break;
+
+      case OPT_NOT_SET_DIP:
+      case OPT_SET_DIP:
+        FILTER_CHECK_IPSET_BATCH(DST, 2);
+        break;
+
+      case OPT_NOT_SET_NHIP:
+      case OPT_SET_NHIP:
+        FILTER_CHECK_IPSET_BATCH(NHIP, 4);
+        break;
+
+      case OPT_NOT_SET_ANY:
+      case OPT_SET_ANY:
+        FILTER_CHECK_IPSET_BATCH(ANY, 1 | 2);
+        break;
+
+      default:
+        FILTER_CHECK_BATCH(filterCheckTest(rwrec, checks->checkSet[test]));
+        break;
+    }
+
+    return sel_count;
 }
 
 
@@ -1881,6 +2051,216 @@ filterCheckFile(
 }
 
 
+/*
+ *  in_range = blockCheckCidrList(cidr_list, cidr_count, lo, hi);
+ *
+ *    Return 1 if any of the 'cidr_count' CIDR blocks in 'cidr_list'
+ *    contains an IP address between 'lo' and 'hi' inclusive; return
+ *    0 otherwise.
+ */
+static int
+blockCheckCidrList(
+    const skcidr_t     *cidr_list,
+    unsigned int        cidr_count,
+    const skipaddr_t   *lo,
+    const skipaddr_t   *hi)
+{
+    skipaddr_t cidr_min;
+    unsigned int i;
+
+    for (i = 0; i < cidr_count; ++i) {
+        if (skcidrCheckIP(&cidr_list[i], lo)) {
+            return 1;
+        }
+        /* since 'lo' is not in the CIDR block, the block overlaps
+         * the range only when the block begins within the range */
+        skcidrGetIPAddr(&cidr_list[i], &cidr_min);
+        if (skipaddrCompare(lo, &cidr_min) < 0
+            && skipaddrCompare(&cidr_min, hi) <= 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ *  in_range = blockCheckIPWildcard(ipwild, lo, hi);
+ *
+ *    Return 0 if the IP Wildcard 'ipwild' cannot contain an IP
+ *    address between 'lo' and 'hi' inclusive, based on the smallest
+ *    and largest addresses in 'ipwild'; return 1 otherwise.
+ */
+static int
+blockCheckIPWildcard(
+    const skIPWildcard_t   *ipwild,
+    const skipaddr_t       *lo,
+    const skipaddr_t       *hi)
+{
+    skipaddr_t wild_min;
+    skipaddr_t wild_max;
+    uint32_t ipv4_min = 0;
+    uint32_t ipv4_max = 0;
+    int i;
+
+#if SK_ENABLE_IPV6
+    if (skIPWildcardIsV6(ipwild)) {
+        uint8_t ipv6_min[16];
+        uint8_t ipv6_max[16];
+
+        for (i = 0; i < 8; ++i) {
+            ipv6_min[2 * i] = (uint8_t)(ipwild->m_min[i] >> 8);
+            ipv6_min[2 * i + 1] = (uint8_t)(ipwild->m_min[i] & 0xFF);
+            ipv6_max[2 * i] = (uint8_t)(ipwild->m_max[i] >> 8);
+            ipv6_max[2 * i + 1] = (uint8_t)(ipwild->m_max[i] & 0xFF);
+        }
+        skipaddrSetV6(&wild_min, ipv6_min);
+        skipaddrSetV6(&wild_max, ipv6_max);
+        return (skipaddrCompare(&wild_min, hi) <= 0
+                && skipaddrCompare(lo, &wild_max) <= 0);
+    }
+#endif  /* SK_ENABLE_IPV6 */
+
+    for (i = 0; i < 4; ++i) {
+        ipv4_min = (ipv4_min << 8) | ipwild->m_min[i];
+        ipv4_max = (ipv4_max << 8) | ipwild->m_max[i];
+    }
+    skipaddrSetV4(&wild_min, &ipv4_min);
+    skipaddrSetV4(&wild_max, &ipv4_max);
+    return (skipaddrCompare(&wild_min, hi) <= 0
+            && skipaddrCompare(lo, &wild_max) <= 0);
+}
+
+
+/*
+ *  skip = filterCheckBlock(block);
+ *
+ *    Check whether any record in the block of a SiLK Flow file
+ *    described by 'block' may match the user's query.  This function
+ *    is the block-level counterpart of filterCheckFile(), and it uses
+ *    the ranges of times and IP addresses and the protocols that the
+ *    file's block index records for the block.
+ *
+ *    Returns 1 if the block should be skipped, 0 if its records
+ *    should be read.
+ */
+int
+filterCheckBlock(
+    const skstream_block_t *block)
+{
+    int skip_block = 0;
+    int wanted;
+    int i;
+    int j;
+
+    for (j = 0; ((0 == skip_block) && (j < checks->check_count)); ++j) {
+
+        switch (checks->checkSet[j]) {
+          case OPT_STIME:
+            if (((uint64_t)block->stime_min > checks->sTime.max)
+                || ((uint64_t)block->stime_max < checks->sTime.min))
+            {
+                skip_block = 1;
+            }
+            break;
+
+          case OPT_ETIME:
+            if (((uint64_t)block->etime_min > checks->eTime.max)
+                || ((uint64_t)block->etime_max < checks->eTime.min))
+            {
+                skip_block = 1;
+            }
+            break;
+
+          case OPT_ACTIVE_TIME:
+            if (((uint64_t)block->stime_min > checks->active_time.max)
+                || ((uint64_t)block->etime_max < checks->active_time.min))
+            {
+                skip_block = 1;
+            }
+            break;
+
+          case OPT_PROTOCOL:
+            wanted = 0;
+            for (i = 0; i < MAX_PROTOCOLS; ++i) {
+                if (SKSTREAM_BLOCK_HAS_PROTO(block, i)
+                    && skBitmapGetBit(checks->proto, i))
+                {
+                    wanted = 1;
+                    break;
+                }
+            }
+            skip_block = !wanted;
+            break;
+
+          case OPT_SCIDR:
+            if (!checks->cidr_negated[SRC]) {
+                skip_block = !blockCheckCidrList(checks->cidr_list[SRC],
+                                                 checks->cidr_list_len[SRC],
+                                                 &block->sip_min,
+                                                 &block->sip_max);
+            }
+            break;
+
+          case OPT_DCIDR:
+            if (!checks->cidr_negated[DST]) {
+                skip_block = !blockCheckCidrList(checks->cidr_list[DST],
+                                                 checks->cidr_list_len[DST],
+                                                 &block->dip_min,
+                                                 &block->dip_max);
+            }
+            break;
+
+          case OPT_ANY_CIDR:
+            if (!checks->cidr_negated[ANY]) {
+                skip_block
+                    = (!blockCheckCidrList(checks->cidr_list[ANY],
+                                           checks->cidr_list_len[ANY],
+                                           &block->sip_min, &block->sip_max)
+                       && !blockCheckCidrList(checks->cidr_list[ANY],
+                                              checks->cidr_list_len[ANY],
+                                              &block->dip_min,
+                                              &block->dip_max));
+            }
+            break;
+
+          case OPT_SADDRESS:
+            if (!checks->ipwild_negate[SRC]) {
+                skip_block = !blockCheckIPWildcard(&checks->ipwild[SRC],
+                                                   &block->sip_min,
+                                                   &block->sip_max);
+            }
+            break;
+
+          case OPT_DADDRESS:
+            if (!checks->ipwild_negate[DST]) {
+                skip_block = !blockCheckIPWildcard(&checks->ipwild[DST],
+                                                   &block->dip_min,
+                                                   &block->dip_max);
+            }
+            break;
+
+          case OPT_ANY_ADDRESS:
+            if (!checks->ipwild_negate[ANY]) {
+                skip_block = (!blockCheckIPWildcard(&checks->ipwild[ANY],
+                                                    &block->sip_min,
+                                                    &block->sip_max)
+                              && !blockCheckIPWildcard(&checks->ipwild[ANY],
+                                                       &block->dip_min,
+                                                       &block->dip_max));
+            }
+            break;
+
+          default:
+            break;
+        }
+    }
+
+    return skip_block;
+}
+
+
 /*
  * int filterSetup()
  *
@@ -2042,6 +2422,128 @@ filterGetCheckCount(
 }
 
 
+/*
+ *  columns = filterGetCheckColumns();
+ *
+ *    Return the SK_COLUMN_* bits for the record fields that the
+ *    active checks examine.
+ */
+uint32_t
+filterGetCheckColumns(
+    void)
+{
+    const uint32_t ports = (SK_COLUMN_SPORT | SK_COLUMN_DPORT
+                            | SK_COLUMN_PROTO);
+    const uint32_t ips = (SK_COLUMN_SIP | SK_COLUMN_DIP | SK_COLUMN_NHIP);
+    uint32_t columns = 0;
+    int i;
+
+    for (i = 0; i < checks->check_count; ++i) {
+        switch (checks->checkSet[i]) {
+          case OPT_STIME:
+            columns |= SK_COLUMN_STIME;
+            break;
+          case OPT_ETIME:
+          case OPT_ACTIVE_TIME:
+            columns |= SK_COLUMN_STIME | SK_COLUMN_ELAPSED;
+            break;
+          case OPT_DURATION:
+            columns |= SK_COLUMN_ELAPSED;
+            break;
+          case OPT_SPORT:
+          case OPT_DPORT:
+          case OPT_APORT:
+          case OPT_ICMP_TYPE:
+          case OPT_ICMP_CODE:
+            columns |= ports;
+            break;
+          case OPT_PROTOCOL:
+            columns |= SK_COLUMN_PROTO;
+            break;
+          case OPT_BYTES:
+          case OPT_PACKETS:
+          case OPT_BYTES_PER_PACKET:
+            columns |= SK_COLUMN_PKTS | SK_COLUMN_BYTES;
+            break;
+#if RATE_FILTERS
+          case OPT_BYTES_PER_SECOND:
+          case OPT_PACKETS_PER_SECOND:
+            columns |= (SK_COLUMN_PKTS | SK_COLUMN_BYTES
+                        | SK_COLUMN_ELAPSED);
+            break;
+#endif
+          case OPT_SCIDR: case OPT_DCIDR: case OPT_ANY_CIDR: case OPT_NHCIDR:
+          case OPT_NOT_SCIDR: case OPT_NOT_DCIDR:
+          case OPT_NOT_ANY_CIDR: case OPT_NOT_NHCIDR:
+          case OPT_SADDRESS: case OPT_DADDRESS:
+          case OPT_ANY_ADDRESS: case OPT_NEXT_HOP_ID:
+          case OPT_NOT_SADDRESS: case OPT_NOT_DADDRESS:
+          case OPT_NOT_ANY_ADDRESS: case OPT_NOT_NEXT_HOP_ID:
+          case OPT_SET_SIP: case OPT_SET_DIP:
+          case OPT_SET_ANY: case OPT_SET_NHIP:
+          case OPT_NOT_SET_SIP: case OPT_NOT_SET_DIP:
+          case OPT_NOT_SET_ANY: case OPT_NOT_SET_NHIP:
+          case OPT_SCC: case OPT_DCC: case OPT_ANY_CC:
+            columns |= ips;
+            break;
+          case OPT_INPUT_INDEX:
+          case OPT_OUTPUT_INDEX:
+          case OPT_ANY_INDEX:
+            columns |= SK_COLUMN_INPUT | SK_COLUMN_OUTPUT;
+            break;
+          case OPT_TCP_FLAGS:
+          case OPT_FIN_FLAG: case OPT_SYN_FLAG:
+          case OPT_RST_FLAG: case OPT_PSH_FLAG:
+          case OPT_ACK_FLAG: case OPT_URG_FLAG:
+          case OPT_ECE_FLAG: case OPT_CWR_FLAG:
+          case OPT_FLAGS_ALL: case OPT_FLAGS_INITIAL:
+          case OPT_FLAGS_SESSION: case OPT_ATTRIBUTES:
+            columns |= SK_COLUMN_FLAGS | SK_COLUMN_PROTO;
+            break;
+          case OPT_APPLICATION:
+            columns |= SK_COLUMN_APPLICATION;
+            break;
+          case OPT_IP_VERSION:
+            /* the IP version is always read */
+            break;
+          case OPT_SENSORS:
+            columns |= SK_COLUMN_SENSOR;
+            break;
+          case OPT_FLOW_TYPE:
+            columns |= SK_COLUMN_FLOWTYPE;
+            break;
+          default:
+            return SK_COLUMN_ALL;
+        }
+    }
+    return columns;
+}
+
+
+/*
+ *  name = filterGetCheckName(test);
+ *
+ *    Return the name of the check at position 'test' in the
+ *    checkSet[] array.  This is the name of the switch that enabled
+ *    the check.
+ */
+const char *
+filterGetCheckName(
+    int                 test)
+{
+    assert(test >= 0 && test < checks->check_count);
+
+    switch (checks->checkSet[test]) {
+      case OPT_SENSORS:
+        return "sensors";
+      case OPT_FLOW_TYPE:
+        return "flowtypes";
+      default:
+        return filterOptions[checks->checkSet[test]].name;
+    }
+}
+
+
 /*
  *  status = filterGetFGlobFilters();
  *
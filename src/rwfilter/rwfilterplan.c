@@ -0,0 +1,350 @@
+/*
+** Copyright (C) 2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+*/
+
+/*
+**  rwfilterplan.c
+**
+**    Functions to apply the checks to blocks of records and to
+**    choose the order in which the checks are applied.
+**
+**    For the first RWFILTER_PLAN_SAMPLE_RECS records of each file,
+**    every check that may be reordered is run on every record, and
+**    the number of records it passes and the time it takes are
+**    recorded.  Once the sample is complete, the checks are sorted
+**    by the ratio of their cost per record to the fraction of records
+**    they reject.  Applying the checks in that order minimizes the
+**    expected cost per record when the checks are independent.
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwfilterplan.c $");
+
+#include "rwfilter.h"
+
+
+/* TYPEDEFS AND DEFINES */
+
+/* the number of nanoseconds in a second */
+#define PLAN_NSEC_PER_SEC  1000000000
+
+
+/* FUNCTION DEFINITIONS */
+
+/*
+ *  nsec = planGetTime();
+ *
+ *    Return the current time in nanoseconds.  The value is only
+ *    useful when compared to another value returned by this function.
+ */
+static uint64_t
+planGetTime(
+    void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+
+    if (0 == clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        return ((uint64_t)ts.tv_sec * PLAN_NSEC_PER_SEC
+                + (uint64_t)ts.tv_nsec);
+    }
+#endif
+    {
+        struct timeval tv;
+
+        gettimeofday(&tv, NULL);
+        return ((uint64_t)tv.tv_sec * PLAN_NSEC_PER_SEC
+                + (uint64_t)tv.tv_usec * 1000);
+    }
+}
+
+
+/*
+ *  rank = planRank(plan, idx);
+ *
+ *    Return the value used to sort the checker at position 'idx' in
+ *    checker[]: its cost per sampled record divided by the fraction of
+ *    sampled records it rejects.  A checker that rejects no records
+ *    gets the largest rank.
+ */
+static double
+planRank(
+    const filter_plan_t    *plan,
+    int                     idx)
+{
+    double cost;
+    double reject;
+
+    /* add 1 nanosecond to the cost so a check whose time is below
+     * the resolution of the clock is not treated as free */
+    cost = (1.0 + (double)plan->nsec[idx]) / (double)plan->sampled;
+    reject = ((double)(plan->sampled - plan->passed[idx])
+              / (double)plan->sampled);
+    if (reject <= 0.0) {
+        return HUGE_VAL;
+    }
+    return cost / reject;
+}
+
+
+/*
+ *  planChoose(plan);
+ *
+ *    Sort the checkers in 'plan->order' using the measurements taken
+ *    from the sampled records.  Checkers that are pinned remain at
+ *    the end of the plan in their original order.  The sort is
+ *    stable so checks with equal rank keep the order the user gave.
+ */
+static void
+planChoose(
+    filter_plan_t      *plan)
+{
+    double rank[MAX_CHECKERS];
+    double r;
+    int movable;
+    int idx;
+    int i;
+    int j;
+
+    plan->chosen = 1;
+    if (0 == plan->sampled) {
+        return;
+    }
+
+    /* pinned checkers are always at the end of checker[] */
+    for (movable = 0;
+         movable < checker_count && !checker[movable].pinned;
+         ++movable)
+        ;   /* empty */
+
+    for (i = 0; i < movable; ++i) {
+        rank[i] = planRank(plan, i);
+    }
+
+    /* insertion sort; there are few checkers */
+    for (i = 1; i < movable; ++i) {
+        idx = plan->order[i];
+        r = rank[idx];
+        for (j = i; j > 0 && rank[plan->order[j-1]] > r; --j) {
+            plan->order[j] = plan->order[j-1];
+        }
+        plan->order[j] = idx;
+    }
+}
+
+
+/*
+ *  planSample(plan, recs, count);
+ *
+ *    Run every checker that may be reordered on all 'count' records
+ *    in 'recs', and add the number of records each checker passes
+ *    and the time it takes to the measurements in 'plan'.
+ */
+static void
+planSample(
+    filter_plan_t      *plan,
+    const rwRec        *recs,
+    uint32_t            count)
+{
+    checktype_t result[RWFILTER_BATCH_RECS];
+    uint32_t sel[RWFILTER_BATCH_RECS];
+    uint32_t sel_count;
+    uint64_t t0;
+    uint32_t i;
+    int c;
+
+    for (c = 0; c < checker_count && !checker[c].pinned; ++c) {
+        for (i = 0; i < count; ++i) {
+            sel[i] = i;
+        }
+        t0 = planGetTime();
+        sel_count = (*(checker[c].fn))(checker[c].test, recs, sel, count,
+                                       result);
+        plan->nsec[c] += planGetTime() - t0;
+        plan->passed[c] += sel_count;
+    }
+    plan->sampled += count;
+
+    if (plan->sampled >= RWFILTER_PLAN_SAMPLE_RECS) {
+        planChoose(plan);
+    }
+}
+
+
+/*
+ *  filterPlanInit(plan);
+ *
+ *    Initialize 'plan' prior to processing a file.  The checkers are
+ *    applied in the order the user specified them until the sample
+ *    of records has been measured.
+ */
+void
+filterPlanInit(
+    filter_plan_t      *plan)
+{
+    int c;
+
+    memset(plan, 0, sizeof(filter_plan_t));
+    for (c = 0; c < checker_count; ++c) {
+        plan->order[c] = c;
+    }
+
+    /* nothing to choose when there is at most one movable checker */
+    if (checker_count < 2 || checker[1].pinned) {
+        plan->chosen = 1;
+    }
+}
+
+
+/*
+ *  filterCheckRecords(plan, recs, count, result);
+ *
+ *    Run the checker functions over the block of 'count' records in
+ *    'recs' in the order specified by 'plan', and fill 'result' with
+ *    the checktype_t for each record.  Each checker function is
+ *    called once for the entire block and is given the selection
+ *    vector of records that passed the previous checkers; a record is
+ *    RWF_PASS when it survives every checker.  'count' must not be
+ *    larger than RWFILTER_BATCH_RECS.
+ *
+ *    While the sample for 'plan' is incomplete, the records are also
+ *    used to measure each checker.
+ */
+void
+filterCheckRecords(
+    filter_plan_t      *plan,
+    const rwRec        *recs,
+    uint32_t            count,
+    checktype_t        *result)
+{
+    uint32_t sel[RWFILTER_BATCH_RECS];
+    uint32_t sel_count;
+    uint32_t i;
+    int c;
+
+    assert(count <= RWFILTER_BATCH_RECS);
+
+    if (!plan->chosen) {
+        planSample(plan, recs, count);
+    }
+
+    for (i = 0; i < count; ++i) {
+        sel[i] = i;
+        result[i] = RWF_FAIL;
+    }
+    sel_count = count;
+
+    /* run all checker()'s until end or no record remains */
+    for (c = 0; c < checker_count && sel_count > 0; ++c) {
+        const filter_checker_t *chk = &checker[plan->order[c]];
+        sel_count = (*(chk->fn))(chk->test, recs, sel, sel_count, result);
+    }
+
+    for (i = 0; i < sel_count; ++i) {
+        result[sel[i]] = RWF_PASS;
+    }
+}
+
+
+/*
+ *  filterPlanFinish(plan, datafile);
+ *
+ *    Complete the processing of 'plan' once all records in the file
+ *    'datafile' have been checked.  Choose the order if the file had
+ *    fewer records than the sample size, and print the plan when
+ *    --print-plan was given.
+ */
+void
+filterPlanFinish(
+    filter_plan_t      *plan,
+    const char         *datafile)
+{
+    const filter_checker_t *chk;
+    int idx;
+    int c;
+
+    if (!plan->chosen) {
+        planChoose(plan);
+    }
+    if (NULL == print_plan_fp || 0 == plan->sampled) {
+        return;
+    }
+
+    /* lock the stream so the plans of multiple threads do not mix */
+    flockfile(print_plan_fp);
+    fprintf(print_plan_fp, "%s: plan from %" PRIu32 " sampled records\n",
+            datafile, plan->sampled);
+    for (c = 0; c < checker_count; ++c) {
+        idx = plan->order[c];
+        chk = &checker[idx];
+        if (chk->pinned) {
+            fprintf(print_plan_fp, "%4d  %-20s  (fixed position)\n",
+                    c + 1, chk->name);
+        } else {
+            fprintf(print_plan_fp,
+                    "%4d  %-20s  pass %6.2f%%  cost %8.2f ns/rec\n",
+                    c + 1, chk->name,
+                    (100.0 * (double)plan->passed[idx]
+                     / (double)plan->sampled),
+                    ((double)plan->nsec[idx] / (double)plan->sampled));
+        }
+    }
+    funlockfile(print_plan_fp);
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
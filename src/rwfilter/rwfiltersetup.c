@@ -106,10 +106,10 @@ static const char *app_plugin_names[] = {
 typedef enum {
     OPT_DRY_RUN,
 #if SK_RWFILTER_THREADED
-    OPT_THREADS,
+    OPT_THREADS, OPT_ORDERED_OUTPUT,
 #endif
     OPT_MAX_PASS_RECORDS, OPT_MAX_FAIL_RECORDS,
-    OPT_PRINT_FILE, OPT_PLUGIN,
+    OPT_PRINT_FILE, OPT_PRINT_PLAN, OPT_PLUGIN,
     OPT_INPUT_PIPE, OPT_XARGS,
     OPT_PASS_DEST, OPT_FAIL_DEST, OPT_ALL_DEST,
     OPT_PRINT_STAT, OPT_PRINT_VOLUME
@@ -119,10 +119,12 @@ static struct option appOptions[] = {
     {"dry-run",                 NO_ARG,       0, OPT_DRY_RUN},
 #if SK_RWFILTER_THREADED
     {"threads",                 REQUIRED_ARG, 0, OPT_THREADS},
+    {"ordered-output",          NO_ARG,       0, OPT_ORDERED_OUTPUT},
 #endif
     {"max-pass-records",        REQUIRED_ARG, 0, OPT_MAX_PASS_RECORDS},
     {"max-fail-records",        REQUIRED_ARG, 0, OPT_MAX_FAIL_RECORDS},
     {"print-filenames",         NO_ARG,       0, OPT_PRINT_FILE},
+    {"print-plan",              NO_ARG,       0, OPT_PRINT_PLAN},
     {"plugin",                  REQUIRED_ARG, 0, OPT_PLUGIN},
 
     {"input-pipe",              REQUIRED_ARG, 0, OPT_INPUT_PIPE},
@@ -139,12 +141,18 @@ static const char *appHelp[] = {
     "Parse command line switches but do not process records",
 #if SK_RWFILTER_THREADED
     "Use this number of threads. Def $SILK_RWFILTER_THREADS or 1",
+    ("When using multiple threads, split each input file\n"
+     "\tinto chunks that are checked in parallel and write the records in\n"
+     "\tthe order they were read. Def. Process whole files in parallel and\n"
+     "\twrite records in any order"),
 #endif
     ("Write at most this many records to\n"
      "\tthe pass-destination; 0 for all.  Def. 0"),
     ("Write at most this many records to\n"
      "\tthe fail-destination; 0 for all.  Def. 0"),
     "Print names of input files during processing. Def. No",
+    ("Print the order in which the checks are applied to\n"
+     "\teach input file and the measurements used to choose it. Def. No"),
     ("Augment processing with the specified plug-in.\n"
      "\tSwitch may be repeated to load multiple plug-ins. No default"),
     ("Read SiLK flow records from a pipe: 'stdin' or\n"
@@ -172,7 +180,9 @@ static int  appOptionsHandler(clientData cData, int opt_index, char *opt_arg);
 static int  filterCheckInputs(int argc);
 static int  filterCheckOutputs(void);
 static int  filterOpenOutputs(void);
-static checktype_t filterPluginCheck(rwRec *rec);
+static uint32_t filterPluginCheck(int test, const rwRec *recs,
+                                  uint32_t *sel, uint32_t sel_count,
+                                  checktype_t *result);
 static int  filterSetCheckers(void);
 
 
@@ -501,6 +511,10 @@ appOptionsHandler(
             goto PARSE_ERROR;
         }
         break;
+
+      case OPT_ORDERED_OUTPUT:
+        ordered_output = 1;
+        break;
 #endif  /* SK_RWFILTER_THREADED */
 
       case OPT_INPUT_PIPE:
@@ -531,6 +545,10 @@ appOptionsHandler(
         filenames_fp = PRINT_FILENAMES_FH;
         break;
 
+      case OPT_PRINT_PLAN:
+        print_plan_fp = PRINT_PLAN_FH;
+        break;
+
       case OPT_PRINT_VOLUME:
         print_volume_stats = 1;
         /* FALLTHROUGH */
@@ -876,21 +894,30 @@ filterOpenOutputs(
 /*
  *  count = filterSetCheckers();
  *
- *    Set the array of function pointers to the pass/fail checking
- *    routines, and return the number of pointers that were set.  If a
- *    check-routine is a plug-in, call the plug-in's initialize()
- *    routine.  If the initialize() routine fails, return -1.  A
- *    return code of 0 means no filtering rules were specified.
+ *    Fill the checker[] array with the pass/fail checking routines,
+ *    and return the number of entries that were set.  Each test in
+ *    filterCheck() is a separate entry so that the tests may be
+ *    reordered individually.  If a check-routine is a plug-in, call
+ *    the plug-in's initialize() routine.  If the initialize() routine
+ *    fails, return -1.  A return code of 0 means no filtering rules
+ *    were specified.
  */
 static int
 filterSetCheckers(
     void)
 {
     int count = 0;
+    int num_checks;
+    int i;
     int rv;
 
-    if (filterGetCheckCount() > 0) {
-        checker[count] = (checktype_t (*)(rwRec*))filterCheck;
+    num_checks = filterGetCheckCount();
+    assert(num_checks <= MAX_FILTER_CHECKS);
+    for (i = 0; i < num_checks; ++i) {
+        checker[count].fn = &filterCheck;
+        checker[count].test = i;
+        checker[count].name = filterGetCheckName(i);
+        checker[count].pinned = 0;
         ++count;
     }
 
@@ -899,12 +926,20 @@ filterSetCheckers(
         return -1;
     }
     if (rv) {
-        checker[count] = (checktype_t (*)(rwRec*))tupleCheck;
+        checker[count].fn = &tupleCheck;
+        checker[count].test = 0;
+        checker[count].name = "tuple-file";
+        checker[count].pinned = 0;
         ++count;
     }
 
+    /* a plug-in may return RWF_PASS_NOW or RWF_IGNORE, so the
+     * plug-ins must remain last */
     if (skPluginFiltersRegistered()) {
-        checker[count] = &filterPluginCheck;
+        checker[count].fn = &filterPluginCheck;
+        checker[count].test = 0;
+        checker[count].name = "plug-ins";
+        checker[count].pinned = 1;
         ++count;
     }
 
@@ -913,29 +948,46 @@ filterSetCheckers(
 
 
 /*
- *  result = filterPluginCheck(rec);
+ *  sel_count = filterPluginCheck(test, recs, sel, sel_count, result);
  *
- *    Runs plugin rwfilter functions, and converts the result to an
- *    RWF enum.
+ *    Runs plugin rwfilter functions on each selected record in
+ *    'recs', and converts the result to an RWF enum.  Records that
+ *    fail are removed from 'sel'; records the plug-in passes-now or
+ *    ignores are removed from 'sel' and have their 'result' set.
  */
-static checktype_t
+static uint32_t
 filterPluginCheck(
-    rwRec              *rec)
+    int          UNUSED(test),
+    const rwRec        *recs,
+    uint32_t           *sel,
+    uint32_t            sel_count,
+    checktype_t        *result)
 {
-    skplugin_err_t err = skPluginRunFilterFn(rec, NULL);
-    switch (err) {
-      case SKPLUGIN_FILTER_PASS:
-        return RWF_PASS;
-      case SKPLUGIN_FILTER_PASS_NOW:
-        return RWF_PASS_NOW;
-      case SKPLUGIN_FILTER_IGNORE:
-        return RWF_IGNORE;
-      case SKPLUGIN_FILTER_FAIL:
-        return RWF_FAIL;
-      default:
-        skAppPrintErr("Plugin-based filter failed with error code %d", err);
-        exit(EXIT_FAILURE);
+    skplugin_err_t err;
+    uint32_t kept;
+    uint32_t i;
+
+    for (i = 0, kept = 0; i < sel_count; ++i) {
+        err = skPluginRunFilterFn(&recs[sel[i]], NULL);
+        switch (err) {
+          case SKPLUGIN_FILTER_PASS:
+            sel[kept++] = sel[i];
+            break;
+          case SKPLUGIN_FILTER_PASS_NOW:
+            result[sel[i]] = RWF_PASS_NOW;
+            break;
+          case SKPLUGIN_FILTER_IGNORE:
+            result[sel[i]] = RWF_IGNORE;
+            break;
+          case SKPLUGIN_FILTER_FAIL:
+            break;
+          default:
+            skAppPrintErr("Plugin-based filter failed with error code %d",
+                          err);
+            exit(EXIT_FAILURE);
+        }
     }
+    return kept;
 }
 
 
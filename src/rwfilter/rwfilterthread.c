@@ -81,6 +81,94 @@ typedef struct filter_thread_st {
     int             rv;
 } filter_thread_t;
 
+/*
+ *    When --ordered-output is given, the main thread reads each input
+ *    file and splits it into chunks of RWFILTER_CHUNK_RECS packed
+ *    records.  The worker threads unpack the records and apply the
+ *    checks to the chunks in parallel, and a single writer thread
+ *    updates the statistics and writes the records of each chunk in
+ *    the order the chunks were read.
+ *
+ *    A chunk moves from the free list, to the work queue, to the
+ *    'done' array, and back to the free list.  The 'done' array is
+ *    indexed by the chunk's sequence number modulo the number of
+ *    chunks; since no more than that number of chunks are in use at
+ *    once, each in-use chunk has its own slot.
+ */
+
+/*
+ *    An input file read with --ordered-output.  The workers need the
+ *    file's stream to unpack its records, so the file is closed once
+ *    the main thread has finished reading it and every chunk of the
+ *    file has been written.  The main thread and each chunk hold a
+ *    reference; the holder of the last reference prints the file's
+ *    plan and closes the file.
+ */
+typedef struct filter_input_st {
+    /* the open input file */
+    skstream_t     *stream;
+    /* the plan for the file, chosen by the worker that checks the
+     * first chunk of the file */
+    filter_plan_t   plan;
+    /* number of references; protected by the mutex of the
+     * filter_ordered_t */
+    uint32_t        refs;
+    /* whether 'plan' has been chosen; protected by the mutex */
+    int             plan_ready;
+    /* whether filterCheckFile() said every record fails */
+    int             fail_entire_file;
+    /* name of the file */
+    char            datafile[PATH_MAX];
+} filter_input_t;
+
+typedef struct filter_chunk_st filter_chunk_t;
+struct filter_chunk_st {
+    /* next chunk on the free list or the work queue */
+    filter_chunk_t *next;
+    /* the file the records came from */
+    filter_input_t *input;
+    /* the packed records as read from the file */
+    uint8_t        *packed;
+    /* the records and the result of checking each */
+    rwRec          *recs;
+    checktype_t    *result;
+    /* position of this chunk in the output */
+    uint64_t        seq;
+    /* number of records in 'packed' that have not been unpacked */
+    uint32_t        packed_count;
+    /* number of records in 'recs' */
+    uint32_t        count;
+    /* whether this is the first chunk of the file, whose records are
+     * used to choose the file's plan */
+    int             first;
+};
+
+typedef struct filter_ordered_st {
+    pthread_mutex_t     mutex;
+    /* signaled when a chunk is put on the free list */
+    pthread_cond_t      free_cond;
+    /* signaled when a chunk is added to the work queue */
+    pthread_cond_t      work_cond;
+    /* signaled when a chunk is added to the done array */
+    pthread_cond_t      done_cond;
+    filter_chunk_t     *chunks;
+    filter_chunk_t     *free_list;
+    filter_chunk_t     *work_head;
+    filter_chunk_t     *work_tail;
+    filter_chunk_t    **done;
+    uint32_t            num_chunks;
+    /* the sequence number to give the next chunk that is read */
+    uint64_t            next_seq;
+    /* counts of records read and passed by the writer thread */
+    filter_stats_t      stats;
+    /* the thread that writes the records */
+    pthread_t           writer;
+    /* set when the writer thread encounters a fatal error */
+    int                 writer_rv;
+    /* set once the main thread has read all of its input */
+    int                 reading_done;
+} filter_ordered_t;
+
 
 /* LOCAL VARIABLE DEFINITIONS */
 
@@ -139,6 +227,7 @@ dumpBuffer(
     const rwRec *recbuf_pos;
     const rwRec *end_rec;
     uint64_t total_rec_count;
+    size_t num_written;
     int close_after_add = 0;
     int recompute_reading = 0;
     int i;
@@ -170,8 +259,17 @@ dumpBuffer(
 
     do {
         dest_next = dest->next;
-        for (recbuf_pos = recbuf; recbuf_pos < end_rec; ++recbuf_pos) {
-            rv = skStreamWriteRecord(dest->ios, recbuf_pos);
+        /* write the records in batches; skip over a record that
+         * has a non-fatal error */
+        for (recbuf_pos = recbuf;
+             recbuf_pos < end_rec;
+             recbuf_pos += num_written + 1)
+        {
+            rv = skStreamWriteRecords(dest->ios, recbuf_pos,
+                                      end_rec - recbuf_pos, &num_written);
+            if (SKSTREAM_OK == rv) {
+                break;
+            }
             if (SKSTREAM_ERROR_IS_FATAL(rv)) {
                 if (skStreamGetLastErrno(dest->ios) == EPIPE) {
                     /* close this stream */
@@ -246,11 +344,16 @@ filterFileThreaded(
     rwRec              *recbuf[],
     uint32_t            recbuf_count[])
 {
-    rwRec rwrec;
+    rwRec recs[RWFILTER_BATCH_RECS];
+    checktype_t result[RWFILTER_BATCH_RECS];
+    filter_plan_t plan;
+    const rwRec *rwrec;
     skstream_t *in_rwios;
+    size_t nread;
+    uint32_t count;
+    uint32_t j;
     int i;
     int fail_entire_file = 0;
-    int result = RWF_PASS;
     int rv = SKSTREAM_OK;
     int in_rv = SKSTREAM_OK;
     rwRec *recbuf_pos[DESTINATION_TYPES];
@@ -294,7 +397,6 @@ filterFileThreaded(
     if (filterCheckFile(in_rwios, ipfile_basename) == 1) {
         /* all records in the file will fail the user's tests */
         fail_entire_file = 1;
-        result = RWF_FAIL;
 
         /* determine if we can more efficiently handle the file */
         if ((dest_type[DEST_ALL].count == 0)
@@ -319,85 +421,103 @@ filterFileThreaded(
         }
     }
 
-    /* read and process each record */
-    while (reading_records
-           && (SKSTREAM_OK == (in_rv = skStreamReadRecord(in_rwios, &rwrec))))
-    {
-        /* increment number of read records */
-        INCR_REC_COUNT(stats->read, &rwrec);
-
-        /* the all-dest */
-        if (dest_type[DEST_ALL].count) {
-            memcpy(recbuf_pos[DEST_ALL], &rwrec, sizeof(rwRec));
-            ++recbuf_pos[DEST_ALL];
-            ++recbuf_count[DEST_ALL];
-            if (recbuf_count[DEST_ALL] == recbuf_max_recs) {
-                rv = dumpBuffer(DEST_ALL, recbuf[DEST_ALL],
-                                recbuf_count[DEST_ALL]);
-                if (rv) {
-                    goto END;
-                }
-                recbuf_pos[DEST_ALL] = recbuf[DEST_ALL];
-                recbuf_count[DEST_ALL] = 0;
-            }
+    /* skip blocks whose records cannot pass */
+    if (!fail_entire_file) {
+        filterSetBlockFilter(in_rwios, stats);
+        filterSetColumnProjection(in_rwios);
+    }
+
+    /* read and process the records in blocks */
+    filterPlanInit(&plan);
+    while (reading_records && SKSTREAM_OK == in_rv) {
+        /* fill the block */
+        in_rv = skStreamReadRecords(in_rwios, recs, RWFILTER_BATCH_RECS,
+                                    &nread);
+        count = (uint32_t)nread;
+        if (0 == count) {
+            break;
         }
 
-        if (!fail_entire_file) {
-            /* run all checker()'s until end or one doesn't pass */
-            for (i=0, result=RWF_PASS;
-                 i < checker_count && result == RWF_PASS;
-                 ++i)
-            {
-                result = (*(checker[i]))(&rwrec);
+        /* check every record in the block */
+        if (fail_entire_file) {
+            for (j = 0; j < count; ++j) {
+                result[j] = RWF_FAIL;
             }
+        } else {
+            filterCheckRecords(&plan, recs, count, result);
         }
 
-        switch (result) {
-          case RWF_PASS:
-          case RWF_PASS_NOW:
-            /* increment number of record that pass */
-            INCR_REC_COUNT(stats->pass, &rwrec);
-
-            /* the pass-dest */
-            if (dest_type[DEST_PASS].count) {
-                memcpy(recbuf_pos[DEST_PASS], &rwrec, sizeof(rwRec));
-                ++recbuf_pos[DEST_PASS];
-                ++recbuf_count[DEST_PASS];
-                if (recbuf_count[DEST_PASS] == recbuf_max_recs) {
-                    rv = dumpBuffer(DEST_PASS, recbuf[DEST_PASS],
-                                    recbuf_count[DEST_PASS]);
+        /* process each record */
+        for (j = 0; j < count && reading_records; ++j) {
+            rwrec = &recs[j];
+
+            /* increment number of read records */
+            INCR_REC_COUNT(stats->read, rwrec);
+
+            /* the all-dest */
+            if (dest_type[DEST_ALL].count) {
+                memcpy(recbuf_pos[DEST_ALL], rwrec, sizeof(rwRec));
+                ++recbuf_pos[DEST_ALL];
+                ++recbuf_count[DEST_ALL];
+                if (recbuf_count[DEST_ALL] == recbuf_max_recs) {
+                    rv = dumpBuffer(DEST_ALL, recbuf[DEST_ALL],
+                                    recbuf_count[DEST_ALL]);
                     if (rv) {
                         goto END;
                     }
-                    recbuf_pos[DEST_PASS] = recbuf[DEST_PASS];
-                    recbuf_count[DEST_PASS] = 0;
+                    recbuf_pos[DEST_ALL] = recbuf[DEST_ALL];
+                    recbuf_count[DEST_ALL] = 0;
                 }
             }
-            break;
 
-          case RWF_FAIL:
-            /* the fail-dest */
-            if (dest_type[DEST_FAIL].count) {
-                memcpy(recbuf_pos[DEST_FAIL], &rwrec, sizeof(rwRec));
-                ++recbuf_pos[DEST_FAIL];
-                ++recbuf_count[DEST_FAIL];
-                if (recbuf_count[DEST_FAIL] == recbuf_max_recs) {
-                    rv = dumpBuffer(DEST_FAIL, recbuf[DEST_FAIL],
-                                    recbuf_count[DEST_FAIL]);
-                    if (rv) {
-                        goto END;
+            switch (result[j]) {
+              case RWF_PASS:
+              case RWF_PASS_NOW:
+                /* increment number of record that pass */
+                INCR_REC_COUNT(stats->pass, rwrec);
+
+                /* the pass-dest */
+                if (dest_type[DEST_PASS].count) {
+                    memcpy(recbuf_pos[DEST_PASS], rwrec, sizeof(rwRec));
+                    ++recbuf_pos[DEST_PASS];
+                    ++recbuf_count[DEST_PASS];
+                    if (recbuf_count[DEST_PASS] == recbuf_max_recs) {
+                        rv = dumpBuffer(DEST_PASS, recbuf[DEST_PASS],
+                                        recbuf_count[DEST_PASS]);
+                        if (rv) {
+                            goto END;
+                        }
+                        recbuf_pos[DEST_PASS] = recbuf[DEST_PASS];
+                        recbuf_count[DEST_PASS] = 0;
                     }
-                    recbuf_pos[DEST_FAIL] = recbuf[DEST_FAIL];
-                    recbuf_count[DEST_FAIL] = 0;
                 }
-            }
-            break;
+                break;
+
+              case RWF_FAIL:
+                /* the fail-dest */
+                if (dest_type[DEST_FAIL].count) {
+                    memcpy(recbuf_pos[DEST_FAIL], rwrec, sizeof(rwRec));
+                    ++recbuf_pos[DEST_FAIL];
+                    ++recbuf_count[DEST_FAIL];
+                    if (recbuf_count[DEST_FAIL] == recbuf_max_recs) {
+                        rv = dumpBuffer(DEST_FAIL, recbuf[DEST_FAIL],
+                                        recbuf_count[DEST_FAIL]);
+                        if (rv) {
+                            goto END;
+                        }
+                        recbuf_pos[DEST_FAIL] = recbuf[DEST_FAIL];
+                        recbuf_count[DEST_FAIL] = 0;
+                    }
+                }
+                break;
 
-          default:
-            break;
+              default:
+                break;
+            }
         }
+    } /* while (reading_records && in_rv == SKSTREAM_OK) */
 
-    } /* while (reading_records && skStreamReadRecord()) */
+    filterPlanFinish(&plan, datafile);
 
   END:
     if (in_rv == SKSTREAM_OK || in_rv == SKSTREAM_ERR_EOF) {
@@ -623,6 +743,532 @@ threadedFilter(
 }
 
 
+/*
+ *  chunk = orderedGetFreeChunk(ord);
+ *
+ *    Wait for a chunk to be available on the free list of 'ord' and
+ *    return it.  Return NULL if processing stops while waiting.
+ */
+static filter_chunk_t *
+orderedGetFreeChunk(
+    filter_ordered_t   *ord)
+{
+    filter_chunk_t *chunk;
+
+    pthread_mutex_lock(&ord->mutex);
+    while (NULL == ord->free_list && reading_records) {
+        pthread_cond_wait(&ord->free_cond, &ord->mutex);
+    }
+    chunk = ord->free_list;
+    if (chunk && reading_records) {
+        ord->free_list = chunk->next;
+        chunk->next = NULL;
+    } else {
+        chunk = NULL;
+    }
+    pthread_mutex_unlock(&ord->mutex);
+
+    return chunk;
+}
+
+
+/*
+ *  orderedPutFreeChunk(ord, chunk);
+ *
+ *    Return 'chunk' to the free list of 'ord'.
+ */
+static void
+orderedPutFreeChunk(
+    filter_ordered_t   *ord,
+    filter_chunk_t     *chunk)
+{
+    pthread_mutex_lock(&ord->mutex);
+    chunk->next = ord->free_list;
+    ord->free_list = chunk;
+    pthread_cond_signal(&ord->free_cond);
+    pthread_mutex_unlock(&ord->mutex);
+}
+
+
+/*
+ *  orderedReleaseInput(ord, input);
+ *
+ *    Release a reference to 'input'.  When it is the last reference,
+ *    print the plan of the file when requested, close the file, and
+ *    free 'input'.
+ */
+static void
+orderedReleaseInput(
+    filter_ordered_t   *ord,
+    filter_input_t     *input)
+{
+    uint32_t refs;
+
+    pthread_mutex_lock(&ord->mutex);
+    refs = --input->refs;
+    pthread_mutex_unlock(&ord->mutex);
+
+    if (0 == refs) {
+        filterPlanFinish(&input->plan, input->datafile);
+        skStreamDestroy(&input->stream);
+        free(input);
+    }
+}
+
+
+/*
+ *  ok = orderedReadFile(ord, datafile, stats);
+ *
+ *    Open the file 'datafile', split its records into chunks, and add
+ *    the chunks to the work queue of 'ord'.  The chunks hold the
+ *    packed records, which the workers unpack.  When the file's
+ *    records cannot be read packed, such as an FT_RWCOLUMNAR file,
+ *    the records are unpacked here.  The number of files and the
+ *    number of records skipped without being read are added to
+ *    'stats'.  Return 0 on success or 1 if the input file could not
+ *    be opened or read.
+ */
+static int
+orderedReadFile(
+    filter_ordered_t   *ord,
+    const char         *datafile,
+    filter_stats_t     *stats)
+{
+    filter_input_t *input;
+    filter_chunk_t *chunk;
+    skstream_t *in_rwios;
+    size_t nread;
+    int first = 1;
+    int packed = 1;
+    int in_rv;
+
+    /* nothing to do in dry-run mode but print the file names */
+    if (dryrun_fp) {
+        fprintf(dryrun_fp, "%s\n", datafile);
+        return 0;
+    }
+
+    /* print filenames if requested */
+    if (filenames_fp) {
+        fprintf(filenames_fp, "%s\n", datafile);
+    }
+
+    input = (filter_input_t*)calloc(1, sizeof(filter_input_t));
+    if (NULL == input) {
+        skAppPrintOutOfMemory(NULL);
+        return 1;
+    }
+    input->refs = 1;
+    filterPlanInit(&input->plan);
+    strncpy(input->datafile, datafile, sizeof(input->datafile));
+    input->datafile[sizeof(input->datafile)-1] = '\0';
+
+    /* open the input file */
+    in_rv = skStreamOpenSilkFlow(&input->stream, datafile, SK_IO_READ);
+    in_rwios = input->stream;
+    if (in_rv) {
+        goto END;
+    }
+
+    ++stats->files;
+
+    /* determine if all the records in the file will fail the checks */
+    if (filterCheckFile(in_rwios, NULL) == 1) {
+        input->fail_entire_file = 1;
+
+        /* determine if we can more efficiently handle the file */
+        if ((dest_type[DEST_ALL].count == 0)
+            && (dest_type[DEST_FAIL].count == 0))
+        {
+            if (print_stat == NULL) {
+                goto END;
+            }
+            if (print_volume_stats == 0) {
+                size_t skipped = 0;
+                in_rv = skStreamSkipRecords(in_rwios, SIZE_MAX, &skipped);
+                stats->read.flows += skipped;
+                goto END;
+            }
+        }
+    }
+
+    /* skip blocks whose records cannot pass */
+    if (!input->fail_entire_file) {
+        filterSetBlockFilter(in_rwios, stats);
+        filterSetColumnProjection(in_rwios);
+    }
+
+    /* read the records into chunks and queue each chunk */
+    while (SKSTREAM_OK == in_rv
+           && (chunk = orderedGetFreeChunk(ord)) != NULL)
+    {
+        if (packed) {
+            in_rv = skStreamReadPackedRecords(in_rwios, chunk->packed,
+                                              RWFILTER_CHUNK_RECS, &nread);
+            if (SKSTREAM_ERR_UNSUPPORT_CONTENT == in_rv) {
+                packed = 0;
+            }
+        }
+        if (packed) {
+            chunk->packed_count = (uint32_t)nread;
+            chunk->count = 0;
+        } else {
+            in_rv = skStreamReadRecords(in_rwios, chunk->recs,
+                                        RWFILTER_CHUNK_RECS, &nread);
+            chunk->packed_count = 0;
+            chunk->count = (uint32_t)nread;
+        }
+        if (0 == nread) {
+            orderedPutFreeChunk(ord, chunk);
+            break;
+        }
+        chunk->input = input;
+        chunk->first = first;
+        first = 0;
+
+        pthread_mutex_lock(&ord->mutex);
+        ++input->refs;
+        chunk->seq = ord->next_seq++;
+        if (ord->work_tail) {
+            ord->work_tail->next = chunk;
+        } else {
+            ord->work_head = chunk;
+        }
+        ord->work_tail = chunk;
+        pthread_cond_signal(&ord->work_cond);
+        pthread_mutex_unlock(&ord->mutex);
+    }
+
+  END:
+    if (in_rv == SKSTREAM_OK || in_rv == SKSTREAM_ERR_EOF) {
+        in_rv = 0;
+    } else {
+        skStreamPrintLastErr(in_rwios, in_rv, &skAppPrintErr);
+        in_rv = 1;
+    }
+
+    /* the file is closed once its chunks have been written */
+    orderedReleaseInput(ord, input);
+
+    return in_rv;
+}
+
+
+/*
+ *  orderedWorkerThread(ord);
+ *
+ *    THREAD ENTRY POINT.
+ *
+ *    Take chunks from the work queue of 'ord', unpack the records in
+ *    each chunk and apply the checks to them, and put the chunk into
+ *    the done array.  Stop when the work queue is empty and the main
+ *    thread has finished reading.
+ *
+ *    Each file has a single plan.  The worker that checks the first
+ *    chunk of a file measures the checks on those records and chooses
+ *    the plan; chunks of the file that are checked before the plan is
+ *    chosen use the order the user gave.
+ */
+static void *
+orderedWorkerThread(
+    void               *v_ord)
+{
+    filter_ordered_t *ord = (filter_ordered_t*)v_ord;
+    filter_chunk_t *chunk;
+    filter_input_t *input;
+    filter_plan_t plan;
+    uint32_t count;
+    uint32_t i;
+
+    skthread_ignore_signals();
+
+    for (;;) {
+        pthread_mutex_lock(&ord->mutex);
+        while (NULL == ord->work_head && !ord->reading_done) {
+            pthread_cond_wait(&ord->work_cond, &ord->mutex);
+        }
+        chunk = ord->work_head;
+        if (NULL == chunk) {
+            pthread_mutex_unlock(&ord->mutex);
+            break;
+        }
+        ord->work_head = chunk->next;
+        if (NULL == ord->work_head) {
+            ord->work_tail = NULL;
+        }
+        chunk->next = NULL;
+        pthread_mutex_unlock(&ord->mutex);
+
+        input = chunk->input;
+        if (chunk->packed_count && reading_records) {
+            chunk->count = skStreamUnpackRecords(input->stream, chunk->recs,
+                                                 chunk->packed,
+                                                 chunk->packed_count);
+        }
+
+        if (input->fail_entire_file) {
+            for (i = 0; i < chunk->count; ++i) {
+                chunk->result[i] = RWF_FAIL;
+            }
+        } else if (reading_records) {
+            if (chunk->first) {
+                filterPlanInit(&plan);
+            } else {
+                pthread_mutex_lock(&ord->mutex);
+                if (input->plan_ready) {
+                    memcpy(&plan, &input->plan, sizeof(plan));
+                } else {
+                    filterPlanInit(&plan);
+                }
+                pthread_mutex_unlock(&ord->mutex);
+                /* only the first chunk is sampled */
+                plan.chosen = 1;
+            }
+            for (i = 0; i < chunk->count; i += count) {
+                count = chunk->count - i;
+                if (count > RWFILTER_BATCH_RECS) {
+                    count = RWFILTER_BATCH_RECS;
+                }
+                filterCheckRecords(&plan, &chunk->recs[i], count,
+                                   &chunk->result[i]);
+            }
+            if (chunk->first) {
+                pthread_mutex_lock(&ord->mutex);
+                memcpy(&input->plan, &plan, sizeof(plan));
+                input->plan_ready = 1;
+                pthread_mutex_unlock(&ord->mutex);
+            }
+        }
+
+        pthread_mutex_lock(&ord->mutex);
+        ord->done[chunk->seq % ord->num_chunks] = chunk;
+        pthread_cond_signal(&ord->done_cond);
+        pthread_mutex_unlock(&ord->mutex);
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  orderedWriterThread(ord);
+ *
+ *    THREAD ENTRY POINT.
+ *
+ *    Take the chunks from the done array of 'ord' in the order they
+ *    were read, write their records to the output streams, and return
+ *    the chunks to the free list.  Stop once every chunk that the
+ *    main thread read has been written.  The counts of records read
+ *    and passed are stored in the 'stats' member of 'ord'.  Once a
+ *    chunk is written, release its reference to its input file.
+ */
+static void *
+orderedWriterThread(
+    void               *v_ord)
+{
+    filter_ordered_t *ord = (filter_ordered_t*)v_ord;
+    filter_chunk_t *chunk;
+    filter_chunk_t **slot;
+    uint64_t seq = 0;
+    int rv;
+
+    skthread_ignore_signals();
+
+    for (;;) {
+        pthread_mutex_lock(&ord->mutex);
+        slot = &ord->done[seq % ord->num_chunks];
+        while (NULL == *slot
+               && !(ord->reading_done && seq == ord->next_seq))
+        {
+            pthread_cond_wait(&ord->done_cond, &ord->mutex);
+        }
+        chunk = *slot;
+        *slot = NULL;
+        pthread_mutex_unlock(&ord->mutex);
+        if (NULL == chunk) {
+            break;
+        }
+        assert(chunk->seq == seq);
+        ++seq;
+
+        if (reading_records) {
+            rv = filterWriteRecords(chunk->recs, chunk->result,
+                                    chunk->count, &ord->stats);
+            if (rv) {
+                ord->writer_rv = -1;
+            }
+            if (!reading_records) {
+                /* wake the main thread if it is waiting for a chunk */
+                pthread_mutex_lock(&ord->mutex);
+                pthread_cond_broadcast(&ord->free_cond);
+                pthread_mutex_unlock(&ord->mutex);
+            }
+        }
+
+        orderedReleaseInput(ord, chunk->input);
+        chunk->input = NULL;
+        orderedPutFreeChunk(ord, chunk);
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  status = orderedFilter(&stats);
+ *
+ *    The "main" to use when rwfilter is used with threads and the
+ *    --ordered-output switch.
+ *
+ *    Creates the chunks, the worker threads, and the writer thread,
+ *    then reads each input file into chunks on the main thread.  Once
+ *    all input files have been processed, fills in the statistics
+ *    structure 'stats'.  Returns 0 on success, non-zero on error.
+ *
+ *    The main thread only reads the packed records; the workers
+ *    unpack them.  Decompression of the file's blocks happens on
+ *    other threads when the SILK_COMPRESSION_THREADS environment
+ *    variable is set.  If the threads cannot be created, uses
+ *    filterFile() on each file.
+ */
+int
+orderedFilter(
+    filter_stats_t     *stats)
+{
+    filter_ordered_t ord;
+    pthread_t *worker = NULL;
+    char datafile[PATH_MAX];
+    uint32_t num_workers = 0;
+    uint32_t i;
+    int have_writer = 0;
+    int rv = 0;
+
+    /* get the main thread */
+    main_thread = pthread_self();
+
+    /* set a signal handler */
+    if (skAppSetSignalHandler(&appHandleSignal)) {
+        skAppPrintErr("Unable to set signal handler");
+        exit(EXIT_FAILURE);
+    }
+    /* override that signal handler and ignore SIGPIPE */
+    filterIgnoreSigPipe();
+
+    memset(&ord, 0, sizeof(ord));
+    pthread_mutex_init(&ord.mutex, NULL);
+    pthread_cond_init(&ord.free_cond, NULL);
+    pthread_cond_init(&ord.work_cond, NULL);
+    pthread_cond_init(&ord.done_cond, NULL);
+
+    /* allow two chunks per worker so a worker need not wait for the
+     * reader, plus one for the writer and one for the reader */
+    ord.num_chunks = 2 * thread_count + 2;
+    ord.chunks = (filter_chunk_t*)calloc(ord.num_chunks,
+                                         sizeof(filter_chunk_t));
+    ord.done = (filter_chunk_t**)calloc(ord.num_chunks,
+                                        sizeof(filter_chunk_t*));
+    worker = (pthread_t*)calloc(thread_count, sizeof(pthread_t));
+    if (NULL == ord.chunks || NULL == ord.done || NULL == worker) {
+        skAppPrintOutOfMemory(NULL);
+        rv = -1;
+        goto END;
+    }
+    for (i = 0; i < ord.num_chunks; ++i) {
+        ord.chunks[i].packed
+            = (uint8_t*)malloc(RWFILTER_CHUNK_RECS * SK_MAX_RECORD_SIZE);
+        ord.chunks[i].recs
+            = (rwRec*)malloc(RWFILTER_CHUNK_RECS * sizeof(rwRec));
+        ord.chunks[i].result
+            = (checktype_t*)malloc(RWFILTER_CHUNK_RECS * sizeof(checktype_t));
+        if (NULL == ord.chunks[i].packed || NULL == ord.chunks[i].recs
+            || NULL == ord.chunks[i].result)
+        {
+            skAppPrintOutOfMemory(NULL);
+            rv = -1;
+            goto END;
+        }
+        ord.chunks[i].next = ord.free_list;
+        ord.free_list = &ord.chunks[i];
+    }
+
+    /* create the threads.  If the writer or every worker cannot be
+     * created, stop any thread that was created and process the
+     * input on the main thread. */
+    if (pthread_create(&ord.writer, NULL, &orderedWriterThread, &ord)) {
+        goto SERIAL;
+    }
+    have_writer = 1;
+    for (num_workers = 0; num_workers < thread_count; ++num_workers) {
+        if (pthread_create(&worker[num_workers], NULL, &orderedWorkerThread,
+                           &ord))
+        {
+            break;
+        }
+    }
+    if (0 == num_workers) {
+        goto SERIAL;
+    }
+
+    /* the main thread reads the input */
+    while (appNextInput(datafile, sizeof(datafile)) != NULL) {
+        /* if an error occurs opening/reading input, ignore it */
+        orderedReadFile(&ord, datafile, stats);
+    }
+
+  SERIAL:
+    pthread_mutex_lock(&ord.mutex);
+    ord.reading_done = 1;
+    pthread_cond_broadcast(&ord.work_cond);
+    pthread_cond_broadcast(&ord.done_cond);
+    pthread_mutex_unlock(&ord.mutex);
+
+    /* join with the threads */
+    for (i = 0; i < num_workers; ++i) {
+        pthread_join(worker[i], NULL);
+    }
+    if (have_writer) {
+        pthread_join(ord.writer, NULL);
+    }
+
+    if (0 == num_workers) {
+        skAppPrintErr("Unable to create threads; processing input serially");
+        while (appNextInput(datafile, sizeof(datafile)) != NULL) {
+            if (filterFile(datafile, NULL, stats) < 0) {
+                rv = -1;
+                break;
+            }
+        }
+        goto END;
+    }
+
+    rv = ord.writer_rv;
+    stats->read.flows += ord.stats.read.flows;
+    stats->read.pkts  += ord.stats.read.pkts;
+    stats->read.bytes += ord.stats.read.bytes;
+    stats->pass.flows += ord.stats.pass.flows;
+    stats->pass.pkts  += ord.stats.pass.pkts;
+    stats->pass.bytes += ord.stats.pass.bytes;
+
+  END:
+    if (ord.chunks) {
+        for (i = 0; i < ord.num_chunks; ++i) {
+            free(ord.chunks[i].packed);
+            free(ord.chunks[i].recs);
+            free(ord.chunks[i].result);
+        }
+        free(ord.chunks);
+    }
+    free(ord.done);
+    free(worker);
+    pthread_cond_destroy(&ord.free_cond);
+    pthread_cond_destroy(&ord.work_cond);
+    pthread_cond_destroy(&ord.done_cond);
+    pthread_mutex_destroy(&ord.mutex);
+
+    return rv;
+}
+
+
 /*
 ** Local Variables:
 ** mode:c
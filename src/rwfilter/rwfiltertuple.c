@@ -423,13 +423,13 @@ tupleGetCheckCount(
 
 
 /*
- *  pass = tupleCheck(rwrec);
+ *  pass = tupleCheckRecord(rwrec);
  *
  *    Return RWF_FAIL if the record's attributes DO NOT match those read
  *    from the tuple file.  Return RWF_PASS if they do match.
  */
-checktype_t
-tupleCheck(
+static checktype_t
+tupleCheckRecord(
     const rwRec        *rwrec)
 {
     uint8_t key[SK_MAX_RECORD_SIZE];
@@ -524,6 +524,32 @@ tupleCheck(
 }
 
 
+/*
+ *  sel_count = tupleCheck(test, recs, sel, sel_count, result);
+ *
+ *    Remove from the selection vector 'sel' the indexes of the
+ *    records in 'recs' that DO NOT match the tuples read from the
+ *    tuple file.  Return the number of records that match.
+ */
+uint32_t
+tupleCheck(
+    int          UNUSED(test),
+    const rwRec        *recs,
+    uint32_t           *sel,
+    uint32_t            sel_count,
+    checktype_t  UNUSED(*result))
+{
+    uint32_t kept;
+    uint32_t i;
+
+    for (i = 0, kept = 0; i < sel_count; ++i) {
+        sel[kept] = sel[i];
+        kept += (RWF_PASS == tupleCheckRecord(&recs[sel[i]]));
+    }
+    return kept;
+}
+
+
 /*
  *  gt_lt_eq = tupleCompare(key_a, key_b, config);
  *
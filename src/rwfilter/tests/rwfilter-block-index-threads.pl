@@ -0,0 +1,21 @@
+#! /usr/bin/perl -w
+# MD5: 58a448de62e97ec377c59a1671ca4b4f
+# TEST: SILK_BLOCK_INDEX=1 ./rwfilter --proto=0- --compression-method=zlib --pass=/tmp/rwfilter-block-index-out ../../tests/data.rwf && SILK_COMPRESSION_THREADS=4 ./rwfilter --stime=2009/02/13:00:00-2009/02/13:00:30 --saddress=192.168.x.x --pass=stdout /tmp/rwfilter-block-index-out | ../rwcut/rwcut --fields=1-5,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{out} = make_tempname('out');
+skip_test("No zlib compression support")
+    unless 1 == $SiLKTests::SK_ENABLE_ZLIB;
+# read the indexed file using worker threads, which only uncompress
+# the blocks that rwfilter does not skip
+my $cmd = "SILK_BLOCK_INDEX=1 $rwfilter --proto=0- --compression-method=zlib --pass=$temp{out} $file{data} && SILK_COMPRESSION_THREADS=4 $rwfilter --stime=2009/02/13:00:00-2009/02/13:00:30 --saddress=192.168.x.x --pass=stdout $temp{out} | $rwcut --fields=1-5,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles";
+my $md5 = "58a448de62e97ec377c59a1671ca4b4f";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: 27351621725e25ffce80260590018385
+# TEST: ../rwcat/rwcat --columnar-output --output-path=/tmp/rwfilter-columnar-columnar.rw ../../tests/data.rwf && ./rwfilter --proto=6 --dport=80,443 --print-volume-statistics=stdout /tmp/rwfilter-columnar-columnar.rw
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{columnar} = make_tempname('columnar.rw');
+my $cmd = "$rwcat --columnar-output --output-path=$temp{columnar} $file{data} && $rwfilter --proto=6 --dport=80,443 --print-volume-statistics=stdout $temp{columnar}";
+my $md5 = "27351621725e25ffce80260590018385";
+
+check_md5_output($md5, $cmd);
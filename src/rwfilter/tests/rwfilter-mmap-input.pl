@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: 72f3148e8bbf278d36ad3d83b0662c82
+# TEST: ./rwfilter --proto=0- --compression-method=none --pass=/tmp/rwfilter-mmap-input-out ../../tests/data.rwf && ./rwfilter --proto=17 --sport=53 --pass=stdout /tmp/rwfilter-mmap-input-out | ../rwcut/rwcut --fields=1-10,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{out} = make_tempname('out');
+my $cmd = "$rwfilter --proto=0- --compression-method=none --pass=$temp{out} $file{data} && $rwfilter --proto=17 --sport=53 --pass=stdout $temp{out} | $rwcut --fields=1-10,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles";
+my $md5 = "72f3148e8bbf278d36ad3d83b0662c82";
+
+check_md5_output($md5, $cmd);
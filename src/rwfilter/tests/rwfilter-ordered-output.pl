@@ -0,0 +1,15 @@
+#! /usr/bin/perl -w
+# MD5: a0e50b6c36d6ffed1cc497bd915b3538
+# TEST: ./rwfilter --threads=4 --ordered-output --proto=17 --max-pass=5000 --pass=stdout ../../tests/data.rwf ../../tests/data.rwf | ../rwcut/rwcut --fields=1-5,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwfilter --threads=4 --ordered-output --proto=17 --max-pass=5000 --pass=stdout $file{data} $file{data} | $rwcut --fields=1-5,stime --ipv6-policy=ignore --timestamp-format=epoch --delimited --no-titles";
+my $md5 = "a0e50b6c36d6ffed1cc497bd915b3538";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: b026324c6904b2a9cb4b88d6d61c81d1
+# TEST: ./rwfilter --threads=4 --ordered-output --proto=17 --dport=53 --print-plan --pass=/dev/null ../../tests/data.rwf 2>&1 | grep -c ' sampled records$'
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwfilter --threads=4 --ordered-output --proto=17 --dport=53 --print-plan --pass=/dev/null $file{data} 2>&1 | grep -c ' sampled records\$'";
+my $md5 = "b026324c6904b2a9cb4b88d6d61c81d1";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,19 @@
+#! /usr/bin/perl -w
+# MD5: f505b584fbcc6493b3454eb895e0fb6c
+# TEST: ./rwfilter --dport=0-65535 --sport=0-65535 --proto=17 --print-plan --pass=/dev/null ../../tests/data.rwf 2>&1 | grep -v ' sampled records$' | awk '{print $1, $2, $4}'
+
+use strict;
+use SiLKTests;
+
+my $rwfilter = check_silk_app('rwfilter');
+my %file;
+$file{data} = get_data_or_exit77('data');
+
+# --dport and --sport pass every record, so whatever they cost they
+# must follow --proto, and they must keep the order they were given;
+# print the position, name, and pass rate of each check but not its
+# cost, which depends on the clock
+my $cmd = "$rwfilter --dport=0-65535 --sport=0-65535 --proto=17 --print-plan --pass=/dev/null $file{data} 2>&1 | grep -v ' sampled records\$' | awk '{print \$1, \$2, \$4}'";
+my $md5 = "f505b584fbcc6493b3454eb895e0fb6c";
+
+check_md5_output($md5, $cmd);
@@ -328,8 +328,8 @@ static packlogic_plugin_t packlogic;
 
 /* A pointer to the function to use to determine the file format to
  * use when writing flow records to disk.  This will be
- * packlogic.determine_fileformat_fn unless --pack-interfaces is
- * given. */
+ * packlogic.determine_fileformat_fn unless --pack-interfaces or
+ * --pack-columnar is given. */
 static fileFormat_t (*determine_fileformat_fn)(
     const skpc_probe_t *probe,
     flowtypeID_t        ftype);
@@ -357,6 +357,9 @@ static int daemonized = 0;
 /* non-zero when file locking is disabled */
 static int no_file_locking = 0;
 
+/* Whether to write newly created files in the FT_RWCOLUMNAR format */
+static int pack_columnar = 0;
+
 /* suffix used for mkstemp().  Note: we use sizeof() on this */
 static const char temp_suffix[] = ".XXXXXX";
 
@@ -504,7 +507,7 @@ typedef enum {
     OPT_NO_FILE_LOCKING,
     OPT_FLUSH_TIMEOUT,
     OPT_STREAM_CACHE_SIZE,
-    OPT_PACK_INTERFACES, OPT_BYTE_ORDER,
+    OPT_PACK_INTERFACES, OPT_PACK_COLUMNAR, OPT_BYTE_ORDER,
     OPT_ERROR_DIRECTORY,
     OPT_ARCHIVE_DIRECTORY, OPT_FLAT_ARCHIVE, OPT_POST_ARCHIVE_COMMAND,
     OPT_SENSOR_CONFIG, OPT_VERIFY_SENSOR_CONFIG,
@@ -526,6 +529,7 @@ static struct option appOptions[] = {
     {"flush-timeout",           REQUIRED_ARG, 0, OPT_FLUSH_TIMEOUT},
     {"file-cache-size",         REQUIRED_ARG, 0, OPT_STREAM_CACHE_SIZE},
     {"pack-interfaces",         NO_ARG,       0, OPT_PACK_INTERFACES},
+    {"pack-columnar",           NO_ARG,       0, OPT_PACK_COLUMNAR},
     {"byte-order",              REQUIRED_ARG, 0, OPT_BYTE_ORDER},
 
     {"error-directory",         REQUIRED_ARG, 0, OPT_ERROR_DIRECTORY},
@@ -565,6 +569,8 @@ static const char *appHelp[] = {
      "\twriting simultaneously"),
     ("Include SNMP interface indexes in packed records\n"
      "\t(useful for debugging the router configuration). Def. No"),
+    ("Write newly created files in the columnar format, which\n"
+     "\tholds every field and speeds queries that use few fields. Def. No"),
     ("Byte order to use for newly packed files:\n"
      "\tChoices: 'native', 'little', or 'big'. Def. native"),
 
@@ -649,6 +655,10 @@ static fileFormat_t
 determineFileFormatPackInterfaces(
     const skpc_probe_t *probe,
     flowtypeID_t        ftype);
+static fileFormat_t
+determineFileFormatPackColumnar(
+    const skpc_probe_t *probe,
+    flowtypeID_t        ftype);
 
 
 /* FUNCTION DEFINITIONS */
@@ -1241,6 +1251,10 @@ appOptionsProcessOpt(
         }
         break;
 
+      case OPT_PACK_COLUMNAR:
+        pack_columnar = 1;
+        break;
+
       case OPT_NO_FILE_LOCKING:
         no_file_locking = 1;
         break;
@@ -1443,6 +1457,9 @@ validateOptions(
             exit(EXIT_FAILURE);
         }
     }
+    if (pack_columnar) {
+        determine_fileformat_fn = &determineFileFormatPackColumnar;
+    }
 
     /* setup the site packing logic */
     if ((packlogic.setup_fn != NULL) && (packlogic.setup_fn() != 0)) {
@@ -2813,6 +2830,22 @@ determineFileFormatPackInterfaces(
 }
 
 
+/*
+ *  format = determineFileFormatPackColumnar(probe, ftype);
+ *
+ *    This function is used when the user requests --pack-columnar.
+ *    The FT_RWCOLUMNAR format holds every field of the record, so it
+ *    replaces whatever format the packing logic plug-in chooses.
+ */
+static fileFormat_t
+determineFileFormatPackColumnar(
+    const skpc_probe_t  UNUSED(*probe),
+    flowtypeID_t         UNUSED(ftype))
+{
+    return FT_RWCOLUMNAR;
+}
+
+
 /*
  *  direction = cacheKeyCompare(a, b, config);
  *
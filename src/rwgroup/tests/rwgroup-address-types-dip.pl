@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: 93858cb8293bb0de0cfd33b5339262ce
+# MD5: 5940f8c2f2f08774d152f9236a2f6907
 # TEST: ../rwsort/rwsort --fields=dtype ../../tests/data.rwf | ./rwgroup --id-fields=dtype | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
 
 use strict;
@@ -13,6 +13,6 @@ $file{data} = get_data_or_exit77('data');
 $file{address_types} = get_data_or_exit77('address_types');
 $ENV{SILK_ADDRESS_TYPES} = "$SiLKTests::PWD/$file{address_types}";
 my $cmd = "$rwsort --fields=dtype $file{data} | $rwgroup --id-fields=dtype | $rwcat --compression-method=none --byte-order=little --ipv4-output";
-my $md5 = "93858cb8293bb0de0cfd33b5339262ce";
+my $md5 = "5940f8c2f2f08774d152f9236a2f6907";
 
 check_md5_output($md5, $cmd);
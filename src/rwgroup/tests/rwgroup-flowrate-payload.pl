@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: be74854ab699c2e8cee1414ce4171a7d
+# MD5: 4d79fab412f738d4a92b06d34c33a89c
 # TEST: ../rwsort/rwsort --plugin=flowrate.so --fields=payload-bytes ../../tests/data.rwf | ./rwgroup --plugin=flowrate.so --id-fields=payload-bytes | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
 
 use strict;
@@ -15,6 +15,6 @@ add_plugin_dirs('/src/plugins');
 skip_test('Cannot load flowrate plugin')
     unless check_app_switch($rwsort.' --plugin=flowrate.so', 'fields', qr/payload-rate/);
 my $cmd = "$rwsort --plugin=flowrate.so --fields=payload-bytes $file{data} | $rwgroup --plugin=flowrate.so --id-fields=payload-bytes | $rwcat --compression-method=none --byte-order=little --ipv4-output";
-my $md5 = "be74854ab699c2e8cee1414ce4171a7d";
+my $md5 = "4d79fab412f738d4a92b06d34c33a89c";
 
 check_md5_output($md5, $cmd);
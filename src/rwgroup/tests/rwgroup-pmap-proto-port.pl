@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: 32ccba8cb86dd0d635a955abcda1b932
+# MD5: a5f35d57ad4da7e42500e4305de3ae56
 # TEST: ../rwfilter/rwfilter --type=in,inweb --pass=stdout ../../tests/data.rwf | ../rwsort/rwsort --pmap-file=../../tests/proto-port-map.pmap --fields=sval | ./rwgroup --pmap-file=../../tests/proto-port-map.pmap --id-fields=sval | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
 
 use strict;
@@ -13,6 +13,6 @@ my %file;
 $file{data} = get_data_or_exit77('data');
 $file{proto_port_map} = get_data_or_exit77('proto_port_map');
 my $cmd = "$rwfilter --type=in,inweb --pass=stdout $file{data} | $rwsort --pmap-file=$file{proto_port_map} --fields=sval | $rwgroup --pmap-file=$file{proto_port_map} --id-fields=sval | $rwcat --compression-method=none --byte-order=little --ipv4-output";
-my $md5 = "32ccba8cb86dd0d635a955abcda1b932";
+my $md5 = "a5f35d57ad4da7e42500e4305de3ae56";
 
 check_md5_output($md5, $cmd);
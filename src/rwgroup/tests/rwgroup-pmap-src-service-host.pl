@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: 44efab1abb941a646df2bbfe4d2b0550
+# MD5: bad10a89a22c8613bafd5890fd7b268b
 # TEST: ../rwfilter/rwfilter --type=in,inweb --pass=stdout ../../tests/data.rwf | ../rwsort/rwsort --pmap-file=../../tests/ip-map.pmap --fields=src-service-host | ./rwgroup --pmap-file=../../tests/ip-map.pmap --id-fields=src-service-host | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
 
 use strict;
@@ -13,6 +13,6 @@ my %file;
 $file{data} = get_data_or_exit77('data');
 $file{ip_map} = get_data_or_exit77('ip_map');
 my $cmd = "$rwfilter --type=in,inweb --pass=stdout $file{data} | $rwsort --pmap-file=$file{ip_map} --fields=src-service-host | $rwgroup --pmap-file=$file{ip_map} --id-fields=src-service-host | $rwcat --compression-method=none --byte-order=little --ipv4-output";
-my $md5 = "44efab1abb941a646df2bbfe4d2b0550";
+my $md5 = "bad10a89a22c8613bafd5890fd7b268b";
 
 check_md5_output($md5, $cmd);
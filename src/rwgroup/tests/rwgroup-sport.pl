@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: e49ed3e324fcca7bed3f79588e9e0327
+# MD5: 7a6f242909205321b39142d6c4be229d
 # TEST: ../rwsort/rwsort --fields=3 ../../tests/data.rwf | ./rwgroup --id-fields=3 | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
 
 use strict;
@@ -11,6 +11,6 @@ my $rwsort = check_silk_app('rwsort');
 my %file;
 $file{data} = get_data_or_exit77('data');
 my $cmd = "$rwsort --fields=3 $file{data} | $rwgroup --id-fields=3 | $rwcat --compression-method=none --byte-order=little --ipv4-output";
-my $md5 = "e49ed3e324fcca7bed3f79588e9e0327";
+my $md5 = "7a6f242909205321b39142d6c4be229d";
 
 check_md5_output($md5, $cmd);
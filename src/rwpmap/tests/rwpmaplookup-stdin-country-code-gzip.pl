@@ -0,0 +1,20 @@
+#! /usr/bin/perl -w
+# MD5: 75956e032078476702336e2ca3228577
+# TEST: gzip -c ../../tests/fake-cc.pmap > /tmp/rwpmaplookup-stdin-country-code-gzip-map.pmap.gz && ../rwcut/rwcut --fields=sip --ipv6-policy=ignore --no-title --start-rec=1000 --num-rec=1000 --delimited ../../tests/data.rwf | ./rwpmaplookup --country-codes=/tmp/rwpmaplookup-stdin-country-code-gzip-map.pmap.gz --fields=value,input --delimited
+
+use strict;
+use SiLKTests;
+
+my $rwpmaplookup = check_silk_app('rwpmaplookup');
+my $rwcut = check_silk_app('rwcut');
+my %file;
+$file{data} = get_data_or_exit77('data');
+$file{fake_cc} = get_data_or_exit77('fake_cc');
+my %temp;
+$temp{map} = make_tempname('map.pmap.gz');
+skip_test("No zlib compression support")
+    unless 1 == $SiLKTests::SK_ENABLE_ZLIB;
+my $cmd = "gzip -c $file{fake_cc} > $temp{map} && $rwcut --fields=sip --ipv6-policy=ignore --no-title --start-rec=1000 --num-rec=1000 --delimited $file{data} | $rwpmaplookup --country-codes=$temp{map} --fields=value,input --delimited";
+my $md5 = "75956e032078476702336e2ca3228577";
+
+check_md5_output($md5, $cmd);
@@ -57,6 +57,16 @@
  *    Manipulate IPset files to produce a new IPset.  Supports
  *    operations such as union, intersection, difference, and
  *    sampling.
+ *
+ *    When --threads is greater than 1, the union, intersection, and
+ *    difference operations read the input IPsets in parallel.  Each
+ *    thread takes the next input file from the command line and
+ *    folds it into its own partial result; once the input is
+ *    exhausted the partial results are combined pairwise in a
+ *    tree-shaped reduction, with the pairs at each level combined in
+ *    parallel.  For the difference operation the threads compute the
+ *    union of the second and subsequent IPsets, which is subtracted
+ *    from the first IPset at the end.
  */
 
 #include <silk/silk.h>
@@ -96,6 +106,28 @@ typedef struct sample_state_st {
 #define RWSETTOOL_INVOCATION_HISTORY 0
 #endif
 
+/* environment variable that determines number of threads */
+#define RWSETTOOL_THREADS_ENVAR  "SILK_RWSETTOOL_THREADS"
+
+/* maximum number of threads the user may request */
+#define RWSETTOOL_THREADS_MAX  64
+
+/* structure for a thread that reads IPsets and combines them, or
+ * that combines two partial results */
+typedef struct combine_job_st {
+    /* the partial result; NULL when the job has not read an IPset */
+    skipset_t  *ipset;
+    /* during the reduction, the partial result to fold into 'ipset' */
+    skipset_t  *other;
+    /* the operation to use: OPT_UNION or OPT_INTERSECT */
+    int         op;
+    /* command line arguments, for appNextInput() */
+    int         argc;
+    char      **argv;
+    /* non-zero if the job encountered an error */
+    int         err;
+} combine_job_t;
+
 
 /* LOCAL VARIABLES */
 
@@ -131,6 +163,15 @@ static int fill_blocks = 0;
 /* options for writing the IPset */
 static skipset_options_t set_options;
 
+/* number of threads to use for union, intersect, and difference */
+static uint32_t thread_count = 1;
+
+/* protects appNextInput() and 'input_error' when using threads */
+static pthread_mutex_t input_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* set when a thread encounters an error, so the others stop reading */
+static int input_error = 0;
+
 
 /* OPTIONS SETUP */
 
@@ -144,6 +185,7 @@ typedef enum {
     OPT_SAMPLE_SIZE,
     OPT_SAMPLE_RATIO,
     OPT_SAMPLE_SEED,
+    OPT_THREADS,
     OPT_OUTPUT_PATH
 } appOptionsEnum;
 
@@ -157,6 +199,7 @@ static struct option appOptions[] = {
     {"size",            REQUIRED_ARG, 0, OPT_SAMPLE_SIZE},
     {"ratio",           REQUIRED_ARG, 0, OPT_SAMPLE_RATIO},
     {"seed",            REQUIRED_ARG, 0, OPT_SAMPLE_SEED},
+    {"threads",         REQUIRED_ARG, 0, OPT_THREADS},
     {"output-path",     REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {0, 0, 0, 0}        /* sentinel entry */
 };
@@ -181,6 +224,9 @@ static const char *appHelp[] = {
     ("Specify the probability, as a floating point value between\n"
      "\t0.0 and 1.0, that an individual IP will be sampled"),
     "Specify the random number seed for the --sample operation",
+    ("Read and combine the input IPsets for the --union,\n"
+     "\t--intersect, and --difference operations using this number of\n"
+     "\tthreads. Def. $" RWSETTOOL_THREADS_ENVAR " or 1"),
     "Write the resulting IPset to this location. Def. stdout",
     (char *) NULL
 };
@@ -297,6 +343,21 @@ appSetup(
         exit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    {
+        char *env;
+        uint32_t tc;
+
+        env = getenv(RWSETTOOL_THREADS_ENVAR);
+        if (env && env[0]) {
+            if (skStringParseUint32(&tc, env, 1, RWSETTOOL_THREADS_MAX)
+                == 0)
+            {
+                thread_count = tc;
+            }
+        }
+    }
+
     /* parse options */
     arg_index = skOptionsParse(argc, argv);
     if (arg_index < 0) {
@@ -484,6 +545,14 @@ appOptionsHandler(
         }
         break;
 
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1,
+                                 RWSETTOOL_THREADS_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
       case OPT_OUTPUT_PATH:
         if (out_stream) {
             skAppPrintErr("Invalid %s: Switch used multiple times",
@@ -574,6 +643,279 @@ appNextInput(
 }
 
 
+/*
+ *  status = appReadSet(&stream, &ipset);
+ *
+ *    Read an IPset from 'stream' into a new IPset whose location is
+ *    stored in 'ipset', and destroy the stream.  Return 0 on success.
+ *    On error, print a message and return non-zero.
+ */
+static int
+appReadSet(
+    skstream_t        **stream,
+    skipset_t         **ipset)
+{
+    int rv;
+
+    rv = skIPSetRead(ipset, *stream);
+    if (rv) {
+        if (rv == SKIPSET_ERR_FILEIO) {
+            skStreamPrintLastErr(*stream,
+                                 skStreamGetLastReturnValue(*stream),
+                                 &skAppPrintErr);
+        } else {
+            skAppPrintErr("Unable to read IPset from '%s': %s",
+                          skStreamGetPathname(*stream),
+                          skIPSetStrerror(rv));
+        }
+    }
+    skStreamDestroy(stream);
+    return rv;
+}
+
+
+/*
+ *  status = combineSets(out_set, in_set, op);
+ *
+ *    Modify 'out_set' by applying the operation 'op'---one of
+ *    OPT_UNION, OPT_MASK, OPT_FILL_BLOCKS, OPT_INTERSECT, or
+ *    OPT_DIFFERENCE---with 'in_set'.  Return 0 on success.  On error,
+ *    print a message and return non-zero.
+ */
+static int
+combineSets(
+    skipset_t          *out_set,
+    const skipset_t    *in_set,
+    int                 op)
+{
+    int rv = 0;
+
+    switch (op) {
+      case OPT_UNION:
+      case OPT_MASK:
+      case OPT_FILL_BLOCKS:
+        /* convert output set to IPv6 if required */
+        if (skIPSetContainsV6(in_set) && !skIPSetIsV6(out_set)) {
+            rv = skIPSetConvert(out_set, 6);
+            if (rv) {
+                break;
+            }
+        }
+        rv = skIPSetUnion(out_set, in_set);
+        break;
+
+      case OPT_INTERSECT:
+        rv = skIPSetIntersect(out_set, in_set);
+        break;
+
+      case OPT_DIFFERENCE:
+        skIPSetSubtract(out_set, in_set);
+        break;
+
+      default:
+        skAbortBadCase(op);
+    }
+
+    if (rv) {
+        skAppPrintErr("Error in %s operation: %s",
+                      appOptions[operation].name, skIPSetStrerror(rv));
+    }
+    return rv;
+}
+
+
+/*
+ *    Thread entry point to read IPsets from the command line until
+ *    the input is exhausted or an error occurs, folding each into the
+ *    job's partial result.
+ */
+static void *
+combineReadJob(
+    void               *v_job)
+{
+    combine_job_t *job = (combine_job_t *)v_job;
+    skstream_t *in_stream;
+    skipset_t *in_set;
+    int have_input;
+
+    for (;;) {
+        pthread_mutex_lock(&input_mutex);
+        if (input_error) {
+            have_input = 0;
+        } else {
+            have_input = appNextInput(job->argc, job->argv, &in_stream);
+            if (have_input < 0) {
+                input_error = 1;
+            }
+        }
+        pthread_mutex_unlock(&input_mutex);
+        if (have_input != 1) {
+            break;
+        }
+
+        in_set = NULL;
+        if (appReadSet(&in_stream, &in_set)) {
+            goto ERROR;
+        }
+        if (NULL == job->ipset) {
+            job->ipset = in_set;
+            continue;
+        }
+        if (combineSets(job->ipset, in_set, job->op)) {
+            skIPSetDestroy(&in_set);
+            goto ERROR;
+        }
+        skIPSetDestroy(&in_set);
+    }
+    if (have_input < 0) {
+        job->err = 1;
+    }
+    return NULL;
+
+  ERROR:
+    job->err = 1;
+    pthread_mutex_lock(&input_mutex);
+    input_error = 1;
+    pthread_mutex_unlock(&input_mutex);
+    return NULL;
+}
+
+
+/*
+ *    Thread entry point to fold the job's 'other' partial result into
+ *    its 'ipset' during the reduction.
+ */
+static void *
+combineMergeJob(
+    void               *v_job)
+{
+    combine_job_t *job = (combine_job_t *)v_job;
+
+    if (NULL == job->other) {
+        return NULL;
+    }
+    if (NULL == job->ipset) {
+        job->ipset = job->other;
+        job->other = NULL;
+        return NULL;
+    }
+    if (combineSets(job->ipset, job->other, job->op)) {
+        job->err = 1;
+    }
+    skIPSetDestroy(&job->other);
+    return NULL;
+}
+
+
+/*
+ *  combineRunJobs(job_fn, jobs, job_count);
+ *
+ *    Call 'job_fn' on each of the 'job_count' entries in 'jobs',
+ *    each in its own thread, and wait for them to complete.  The
+ *    calling thread runs the first job.  A job whose thread cannot
+ *    be created is run by the calling thread.
+ */
+static void
+combineRunJobs(
+    void             *(*job_fn)(void *),
+    combine_job_t     **jobs,
+    uint32_t            job_count)
+{
+    pthread_t threads[RWSETTOOL_THREADS_MAX];
+    int started[RWSETTOOL_THREADS_MAX];
+    uint32_t i;
+
+    assert(job_count <= RWSETTOOL_THREADS_MAX);
+
+    for (i = 1; i < job_count; ++i) {
+        started[i] = (0 == pthread_create(&threads[i], NULL, job_fn,
+                                          jobs[i]));
+    }
+    job_fn(jobs[0]);
+    for (i = 1; i < job_count; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            job_fn(jobs[i]);
+        }
+    }
+}
+
+
+/*
+ *  status = combineSetsThreaded(argc, argv, out_set);
+ *
+ *    Read the remaining IPsets on the command line using
+ *    'thread_count' threads and combine them with 'out_set' according
+ *    to the global 'operation'.  Return 0 on success, or non-zero on
+ *    error.
+ *
+ *    Each thread builds a partial result from the files it reads.
+ *    The partial results are then reduced pairwise: at each level the
+ *    partial result in slot 'i' absorbs the one in slot 'i + step',
+ *    with every pair at that level handled by its own thread.
+ */
+static int
+combineSetsThreaded(
+    int                 argc,
+    char              **argv,
+    skipset_t          *out_set)
+{
+    combine_job_t jobs[RWSETTOOL_THREADS_MAX];
+    combine_job_t *run[RWSETTOOL_THREADS_MAX];
+    uint32_t job_count;
+    uint32_t run_count;
+    uint32_t step;
+    uint32_t i;
+    int err = 0;
+
+    job_count = thread_count;
+    if ((uint32_t)(argc - arg_index) < job_count) {
+        job_count = (uint32_t)(argc - arg_index);
+    }
+    assert(job_count > 1);
+
+    memset(jobs, 0, sizeof(jobs));
+    memset(run, 0, sizeof(run));
+    for (i = 0; i < job_count; ++i) {
+        /* for a difference, build the union of the IPsets to remove */
+        jobs[i].op = ((OPT_INTERSECT == operation) ? OPT_INTERSECT
+                      : OPT_UNION);
+        jobs[i].argc = argc;
+        jobs[i].argv = argv;
+        run[i] = &jobs[i];
+    }
+
+    combineRunJobs(&combineReadJob, run, job_count);
+    for (i = 0; i < job_count; ++i) {
+        err |= jobs[i].err;
+    }
+
+    for (step = 1; 0 == err && step < job_count; step <<= 1) {
+        run_count = 0;
+        for (i = 0; i + step < job_count; i += (step << 1)) {
+            jobs[i].other = jobs[i + step].ipset;
+            jobs[i + step].ipset = NULL;
+            run[run_count++] = &jobs[i];
+        }
+        combineRunJobs(&combineMergeJob, run, run_count);
+        for (i = 0; i < run_count; ++i) {
+            err |= run[i]->err;
+        }
+    }
+
+    if (0 == err && jobs[0].ipset) {
+        err = combineSets(out_set, jobs[0].ipset, operation);
+    }
+
+    for (i = 0; i < job_count; ++i) {
+        skIPSetDestroy(&jobs[i].ipset);
+        skIPSetDestroy(&jobs[i].other);
+    }
+    return err;
+}
+
+
 /*
  *  status = sampleRatioCallback(ipaddr, prefix, &state);
  *
@@ -825,75 +1167,32 @@ int main(int argc, char **argv)
         if (have_input != 1) {
             return EXIT_FAILURE;
         }
-        rv = skIPSetRead(&out_set, in_stream);
-        if (rv) {
-            if (rv == SKIPSET_ERR_FILEIO) {
-                skStreamPrintLastErr(in_stream,
-                                     skStreamGetLastReturnValue(in_stream),
-                                     &skAppPrintErr);
-            } else {
-                skAppPrintErr("Unable to read IPset from '%s': %s",
-                              skStreamGetPathname(in_stream),
-                              skIPSetStrerror(rv));
-            }
-            skStreamDestroy(&in_stream);
+        if (appReadSet(&in_stream, &out_set)) {
             skIPSetDestroy(&out_set);
             return EXIT_FAILURE;
         }
-        skStreamDestroy(&in_stream);
         skIPSetOptionsBind(out_set, &set_options);
 
-        /* read remaining sets */
-        while (1 == (have_input = appNextInput(argc, argv, &in_stream))) {
-            rv = skIPSetRead(&in_set, in_stream);
-            if (rv) {
-                if (rv == SKIPSET_ERR_FILEIO) {
-                    skStreamPrintLastErr(in_stream,
-                                         skStreamGetLastReturnValue(in_stream),
-                                         &skAppPrintErr);
-                } else {
-                    skAppPrintErr("Unable to read IPset from '%s': %s",
-                                  skStreamGetPathname(in_stream),
-                                  skIPSetStrerror(rv));
-                }
-                skStreamDestroy(&in_stream);
+        if (thread_count > 1 && (argc - arg_index) > 1) {
+            /* read and combine remaining sets using threads */
+            if (combineSetsThreaded(argc, argv, out_set)) {
+                skIPSetDestroy(&out_set);
                 return EXIT_FAILURE;
             }
-            skStreamDestroy(&in_stream);
-
-            switch (operation) {
-              case OPT_UNION:
-              case OPT_MASK:
-              case OPT_FILL_BLOCKS:
-                /* convert output set to IPv6 if required */
-                if (skIPSetContainsV6(in_set) && !skIPSetIsV6(out_set)) {
-                    rv = skIPSetConvert(out_set, 6);
-                    if (rv) {
-                        break;
-                    }
+            have_input = 0;
+        } else {
+            /* read remaining sets */
+            while (1 == (have_input = appNextInput(argc, argv, &in_stream))) {
+                if (appReadSet(&in_stream, &in_set)) {
+                    skIPSetDestroy(&out_set);
+                    return EXIT_FAILURE;
+                }
+                rv = combineSets(out_set, in_set, operation);
+                skIPSetDestroy(&in_set);
+                if (rv) {
+                    skIPSetDestroy(&out_set);
+                    return EXIT_FAILURE;
                 }
-                rv = skIPSetUnion(out_set, in_set);
-                break;
-
-              case OPT_INTERSECT:
-                rv = skIPSetIntersect(out_set, in_set);
-                break;
-
-              case OPT_DIFFERENCE:
-                skIPSetSubtract(out_set, in_set);
-                break;
-
-              default:
-                skAbortBadCase(operation);
-            }
-
-            skIPSetDestroy(&in_set);
-            in_set = NULL;
-
-            if (rv) {
-                skAppPrintErr("Error in %s operation: %s",
-                              appOptions[operation].name, skIPSetStrerror(rv));
-                return EXIT_FAILURE;
             }
         }
         if (0 != have_input) {
@@ -0,0 +1,25 @@
+#! /usr/bin/perl -w
+# MD5: e1cdefa5f9d18f8d695822e677a05efb
+# TEST: ./rwsettool --union --record-version=3 --compression-method=none --output-path=/tmp/union.set ../../tests/set1-v4.set ../../tests/set2-v4.set && ./rwsettool --difference /tmp/union.set ../../tests/set2-v4.set | ./rwsetcat --cidr
+
+use strict;
+use SiLKTests;
+
+my $rwsettool = check_silk_app('rwsettool');
+my $rwsetcat = check_silk_app('rwsetcat');
+my %file;
+$file{v4set1} = get_data_or_exit77('v4set1');
+$file{v4set2} = get_data_or_exit77('v4set2');
+
+# create our tempdir
+my $tmpdir = make_tempdir();
+
+# write an uncompressed version 3 IPset to a file, which the second
+# rwsettool maps into memory and modifies via copy-on-write
+my $union = "$tmpdir/union.set";
+my $cmd = "$rwsettool --union --record-version=3 --compression-method=none"
+    ." --output-path=$union $file{v4set1} $file{v4set2}"
+    ." && $rwsettool --difference $union $file{v4set2} | $rwsetcat --cidr";
+my $md5 = "e1cdefa5f9d18f8d695822e677a05efb";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,28 @@
+#! /usr/bin/perl -w
+# MD5: e1cdefa5f9d18f8d695822e677a05efb
+# TEST: ./rwsettool --union --record-version=5 --output-path=/tmp/set1.set ../../tests/set1-v4.set && ./rwsettool --union --record-version=5 --output-path=/tmp/set2.set ../../tests/set2-v4.set && ./rwsettool --difference /tmp/set1.set /tmp/set2.set | ./rwsetcat --cidr
+
+use strict;
+use SiLKTests;
+
+my $rwsettool = check_silk_app('rwsettool');
+my $rwsetcat = check_silk_app('rwsetcat');
+my %file;
+$file{v4set1} = get_data_or_exit77('v4set1');
+$file{v4set2} = get_data_or_exit77('v4set2');
+
+# create our tempdir
+my $tmpdir = make_tempdir();
+
+# write both inputs as version 5 IPsets, which rwsettool reads into
+# /16 containers and combines without converting them
+my $set1 = "$tmpdir/set1.set";
+my $set2 = "$tmpdir/set2.set";
+my $cmd = "$rwsettool --union --record-version=5 --output-path=$set1"
+    ." $file{v4set1}"
+    ." && $rwsettool --union --record-version=5 --output-path=$set2"
+    ." $file{v4set2}"
+    ." && $rwsettool --difference $set1 $set2 | $rwsetcat --cidr";
+my $md5 = "e1cdefa5f9d18f8d695822e677a05efb";
+
+check_md5_output($md5, $cmd);
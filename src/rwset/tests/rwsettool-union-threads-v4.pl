@@ -0,0 +1,18 @@
+#! /usr/bin/perl -w
+# MD5: 94365076fcc58686569056c567d1da3c
+# TEST: ./rwsettool --union --threads=3 ../../tests/set1-v4.set ../../tests/set2-v4.set ../../tests/set3-v4.set ../../tests/set4-v4.set | ./rwsetcat --cidr
+
+use strict;
+use SiLKTests;
+
+my $rwsettool = check_silk_app('rwsettool');
+my $rwsetcat = check_silk_app('rwsetcat');
+my %file;
+$file{v4set1} = get_data_or_exit77('v4set1');
+$file{v4set2} = get_data_or_exit77('v4set2');
+$file{v4set3} = get_data_or_exit77('v4set3');
+$file{v4set4} = get_data_or_exit77('v4set4');
+my $cmd = "$rwsettool --union --threads=3 $file{v4set1} $file{v4set2} $file{v4set3} $file{v4set4} | $rwsetcat --cidr";
+my $md5 = "94365076fcc58686569056c567d1da3c";
+
+check_md5_output($md5, $cmd);
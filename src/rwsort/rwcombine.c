@@ -99,13 +99,16 @@
 RCSIDENT("$SiLK: rwcombine.c e24d53743a28 2015-01-16 22:48:56Z mthomas $");
 
 #include "rwcombine.h"
-#include <silk/skheap.h>
+#include <silk/skmerge.h>
 
 
 /* TYPEDEFS AND DEFINES */
 
 #define TIMEOUT_MASK (SK_TCPSTATE_TIMEOUT_KILLED|SK_TCPSTATE_TIMEOUT_STARTED)
 
+/* the number of records to read from the merge at one time */
+#define MERGE_BLOCK_RECS  1024
+
 
 /* EXPORTED VARIABLES */
 
@@ -550,24 +553,138 @@ rwrecCombine(
 }
 
 /*
- *  status = compHeapNodes(b, a, v_recs);
+ *  prefix = mergePrefix(rec, cmp_data);
  *
- *    Callback function used by the heap to compare two heapnodes,
- *    which are just indexes into an array of records.  'v_recs' is
- *    the array of records, where each record is NODE_SIZE bytes.
+ *    Prefix function for the merge, used when the first sort field
+ *    is an IP address.  Return the IPv4 address, or, for an IPv6
+ *    address, a value greater than every IPv4 address that holds the
+ *    leading bits of the address.
+ */
+static uint64_t
+mergePrefix(
+    const void         *rec,
+    void        UNUSED(*cmp_data))
+{
+    skipaddr_t ip;
+#if SK_ENABLE_IPV6
+    uint8_t ipv6[16];
+    uint64_t hi;
+#endif
+
+    switch (sort_fields[0]) {
+      case RWREC_FIELD_SIP:
+        rwRecMemGetSIP((const rwRec*)rec, &ip);
+        break;
+      case RWREC_FIELD_DIP:
+        rwRecMemGetDIP((const rwRec*)rec, &ip);
+        break;
+      case RWREC_FIELD_NHIP:
+        rwRecMemGetNhIP((const rwRec*)rec, &ip);
+        break;
+      default:
+        skAbortBadCase(sort_fields[0]);
+    }
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(&ip)) {
+        /* compareIPs() sorts IPv6 after IPv4 */
+        skipaddrGetV6(&ip, ipv6);
+        memcpy(&hi, ipv6, sizeof(hi));
+        return (UINT64_C(1) << 63) | (ntoh64(hi) >> 1);
+    }
+#endif
+    return skipaddrGetV4(&ip);
+}
+
+
+/*
+ *  mergeCompare(a, b, cmp_data);
  *
- *    Note the order of arguments is 'b', 'a'.
+ *    Comparison function for the merge; a wrapper over
+ *    rwrecCompare().
  */
 static int
-compHeapNodes(
-    const skheapnode_t  b,
-    const skheapnode_t  a,
-    void               *v_recs)
+mergeCompare(
+    const void         *a,
+    const void         *b,
+    void        UNUSED(*cmp_data))
+{
+    return rwrecCompare(a, b);
+}
+
+
+/*
+ *  mergeWriteRecords(fp_intermediate, recs, count);
+ *
+ *    Write the 'count' records in 'recs' to the intermediate
+ *    temporary file 'fp_intermediate', or, when 'fp_intermediate' is
+ *    NULL, count them and write them to the output file.  Exit the
+ *    application on a fatal error.
+ */
+static void
+mergeWriteRecords(
+    skstream_t         *fp_intermediate,
+    const uint8_t      *recs,
+    size_t              count)
 {
-    uint8_t *recs = (uint8_t*)v_recs;
+    char errbuf[2 * PATH_MAX];
+    const uint8_t *rec;
+    size_t written;
+    size_t k;
+    ssize_t rv;
 
-    return rwrecCompare(&recs[*(uint16_t*)a * NODE_SIZE],
-                        &recs[*(uint16_t*)b * NODE_SIZE]);
+    if (fp_intermediate) {
+        /* write the records to intermediate tmp file */
+        rv = skStreamWrite(fp_intermediate, recs, count * NODE_SIZE);
+        if ((ssize_t)(count * NODE_SIZE) != rv) {
+            if (rv > 0) {
+                snprintf(errbuf, sizeof(errbuf),
+                         "Short write %" SK_PRIdZ "/%" SK_PRIuZ " to '%s'",
+                         rv, count * NODE_SIZE,
+                         skStreamGetPathname(fp_intermediate));
+            } else {
+                skStreamLastErrMessage(
+                    fp_intermediate, rv, errbuf, sizeof(errbuf));
+            }
+            skAppPrintErr("Error writing to temporary file: %s", errbuf);
+            skStreamDestroy(&fp_intermediate);
+            appExit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    /* we successfully opened all (remaining) temp files, write the
+     * records to the final destination */
+    for (k = 0, rec = recs; k < count; ++k, rec += NODE_SIZE) {
+        switch (rwRecGetTcpState((const rwRec*)rec) & TIMEOUT_MASK) {
+          case 0:
+            ++counts.combined;
+            break;
+          case TIMEOUT_MASK:
+            ++counts.miss_start_end;
+            break;
+          case SK_TCPSTATE_TIMEOUT_KILLED:
+            ++counts.miss_end;
+            break;
+          case SK_TCPSTATE_TIMEOUT_STARTED:
+            ++counts.miss_start;
+            break;
+        }
+    }
+    while (count) {
+        rv = skStreamWriteRecords(out_stream, (const rwRec*)recs, count,
+                                  &written);
+        if (0 == rv) {
+            break;
+        }
+        skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
+        if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+            appExit(EXIT_FAILURE);
+        }
+        /* skip the record that failed */
+        ++written;
+        recs += written * NODE_SIZE;
+        count -= written;
+    }
 }
 
 
@@ -584,19 +701,23 @@ mergeFiles(
 {
     char errbuf[2 * PATH_MAX];
     skstream_t *fps[MAX_MERGE_FILES];
-    uint8_t recs[MAX_MERGE_FILES][NODE_SIZE];
     uint8_t lowest_rec[NODE_SIZE];
+    uint8_t *in_buf;
+    uint8_t *out_buf;
+    uint8_t *rec;
+    int have_lowest;
     int j;
     uint16_t open_count;
     uint16_t i;
-    uint16_t lowest;
-    uint16_t *top_heap;
     int tmp_idx_a;
     int tmp_idx_b;
     skstream_t *fp_intermediate = NULL;
     int tmp_idx_intermediate;
-    skheap_t *heap;
-    uint32_t heap_count;
+    sk_merge_t *merge;
+    size_t source;
+    size_t count;
+    size_t out_count;
+    size_t k;
     int opened_all_temps = 0;
     ssize_t rv;
 
@@ -606,17 +727,25 @@ mergeFiles(
     TRACEMSG(("Merging #%d through #%d into '%s'",
               tmp_idx_a, temp_file_idx, skStreamGetPathname(out_stream)));
 
-    heap = skHeapCreate2(compHeapNodes, MAX_MERGE_FILES, sizeof(uint16_t),
-                         NULL, recs);
-    if (NULL == heap) {
-        skAppPrintOutOfMemory("heap");
+    merge = skMergeCreate(NODE_SIZE, MAX_MERGE_FILES, &mergeCompare, NULL);
+    in_buf = (uint8_t*)malloc(2 * MERGE_BLOCK_RECS * NODE_SIZE);
+    if (NULL == merge || NULL == in_buf) {
+        skAppPrintOutOfMemory("merge");
         appExit(EXIT_FAILURE);
     }
+    out_buf = in_buf + MERGE_BLOCK_RECS * NODE_SIZE;
+    if (num_fields > 0
+        && (RWREC_FIELD_SIP == sort_fields[0]
+            || RWREC_FIELD_DIP == sort_fields[0]
+            || RWREC_FIELD_NHIP == sort_fields[0]))
+    {
+        skMergeSetPrefixFunction(merge, &mergePrefix);
+    }
 
     /* This loop repeats as long as we haven't read all of the temp
      * files generated in the sorting stage. */
     do {
-        assert(SKHEAP_ERR_EMPTY==skHeapPeekTop(heap,(skheapnode_t*)&top_heap));
+        skMergeReset(merge);
 
         /* the index of the last temp file to merge */
         tmp_idx_b = temp_file_idx;
@@ -656,40 +785,16 @@ mergeFiles(
                     appExit(EXIT_FAILURE);
                 }
             }
-
-            /* read the first record */
-            rv = skStreamRead(fps[open_count], recs[open_count], NODE_SIZE);
-            if (NODE_SIZE == rv) {
-                /* insert the file index into the heap */
-                skHeapInsert(heap, &open_count);
-                ++open_count;
-                if (open_count == MAX_MERGE_FILES) {
-                    /* We've reached the limit for this pass.  Set
-                     * tmp_idx_b to the file we just opened. */
-                    tmp_idx_b = j;
-                    TRACEMSG((("MAX_MERGE_FILES limit hit--"
-                               "merging #%d through #%d to #%d"),
-                              tmp_idx_a, tmp_idx_b, tmp_idx_intermediate));
-                    break;
-                }
-            } else if (0 == rv) {
-                TRACEMSG(("Ignoring empty temporary file '%s'",
-                          skTempFileGetName(tmpctx, j)));
-                skStreamDestroy(&fps[open_count]);
-            } else {
-                if (rv > 0) {
-                    snprintf(errbuf, sizeof(errbuf),
-                             "Short read %" SK_PRIdZ "/%" PRIu32 " from '%s'",
-                             rv, NODE_SIZE,
-                             skStreamGetPathname(fps[open_count]));
-                } else {
-                    skStreamLastErrMessage(
-                        fps[open_count], rv, errbuf, sizeof(errbuf));
-                }
-                skAppPrintErr(
-                    "Error reading first record from temporary file: %s",
-                    errbuf);
-                appExit(EXIT_FAILURE);
+            skMergeAddStream(merge, fps[open_count]);
+            ++open_count;
+            if (open_count == MAX_MERGE_FILES) {
+                /* We've reached the limit for this pass.  Set
+                 * tmp_idx_b to the file we just opened. */
+                tmp_idx_b = j;
+                TRACEMSG((("MAX_MERGE_FILES limit hit--"
+                           "merging #%d through #%d to #%d"),
+                          tmp_idx_a, tmp_idx_b, tmp_idx_intermediate));
+                break;
             }
         }
 
@@ -709,117 +814,51 @@ mergeFiles(
 
         TRACEMSG((("Merging %" PRIu16 " temporary files"), open_count));
 
-        heap_count = skHeapGetNumberEntries(heap);
-        assert(heap_count == open_count);
-
-        /* get the index of the file with the lowest record; which is
-         * at the top of the heap */
-        if (skHeapPeekTop(heap, (skheapnode_t*)&top_heap) != SKHEAP_OK) {
-            skAppPrintErr("Unable to open and read any temporary files.");
-            appExit(EXIT_FAILURE);
-        }
-        lowest = *top_heap;
-
-        /* exit this do...while() once all records for all opened
-         * files have been read */
-        do {
-            /* lowest_rec is the record pointed to by the index at the
-             * top of the heap */
-            memcpy(lowest_rec, recs[lowest], NODE_SIZE);
-
-            /* replace the record we just processed and loop over all
-             * files until we get a record that cannot be combined
-             * with 'lowest_rec' */
-            do {
-                if ((rv = skStreamRead(fps[lowest], recs[lowest], NODE_SIZE))
-                    == NODE_SIZE)
+        /* read the merged records in blocks, combine each record into
+         * 'lowest_rec' until finding a record that cannot be
+         * combined, and write 'lowest_rec' */
+        have_lowest = 0;
+        out_count = 0;
+        while ((count = skMergeRead(merge, in_buf, MERGE_BLOCK_RECS)) > 0) {
+            for (k = 0, rec = in_buf; k < count; ++k, rec += NODE_SIZE) {
+                if (have_lowest
+                    && 0 == rwrecCombine((rwRec*)lowest_rec, (rwRec*)rec))
                 {
-                    /* read succeeded; insert into heap and get new
-                     * record at top of heap */
-                    skHeapReplaceTop(heap, &lowest, NULL);
-                } else {
-                    /* read failed.  there is no more data for this
-                     * file; remove it from the heap; if the heap is
-                     * empty, exit the loop */
-                    skHeapExtractTop(heap, NULL);
-                    --heap_count;
-#if TRACEMSG_LEVEL > 0
-                    if (rv == 0) {
-                        TRACEMSG(
-                            ("Finished reading file #%u: EOF; %u files remain",
-                             (tmp_idx_a + lowest), heap_count));
-                    } else if (rv > 0) {
-                        TRACEMSG(
-                            ("Finished reading file #%u: Short read "
-                             "%" SK_PRIdZ "/%" PRIu32 "; %u files remain",
-                             tmp_idx_a + lowest, rv, NODE_SIZE, heap_count));
-                    } else {
-                        skStreamLastErrMessage(
-                            fps[open_count], rv, errbuf, sizeof(errbuf));
-                        TRACEMSG(
-                            ("Finished reading file #%u: %s; %u files remain",
-                             (tmp_idx_a + lowest), errbuf, heap_count));
-                    }
-#endif  /* TRACEMSG_LEVEL */
-                    if (0 == heap_count) {
-                        break;
-                    }
+                    continue;
                 }
-
-                /* get the index of the file with new lowest record;
-                 * if it can be combined with 'lowest_rec'; continue
-                 * the loop and read another record */
-                skHeapPeekTop(heap, (skheapnode_t*)&top_heap);
-                lowest = *top_heap;
-
-            } while (rwrecCombine((rwRec*)lowest_rec, (rwRec*)recs[lowest])
-                     == 0);
-
-            /* write the record */
-            if (fp_intermediate) {
-                /* write the record to intermediate tmp file */
-                rv = skStreamWrite(fp_intermediate, lowest_rec, NODE_SIZE);
-                if (NODE_SIZE != rv) {
-                    if (rv > 0) {
-                        snprintf(
-                            errbuf, sizeof(errbuf),
-                            "Short write %" SK_PRIdZ "/%" PRIu32 " to '%s'",
-                            rv,NODE_SIZE,skStreamGetPathname(fp_intermediate));
-                    } else {
-                        skStreamLastErrMessage(
-                            fps[open_count], rv, errbuf, sizeof(errbuf));
+                if (have_lowest) {
+                    memcpy(out_buf + out_count * NODE_SIZE, lowest_rec,
+                           NODE_SIZE);
+                    if (++out_count == MERGE_BLOCK_RECS) {
+                        mergeWriteRecords(fp_intermediate, out_buf,
+                                          out_count);
+                        out_count = 0;
                     }
-                    skAppPrintErr("Error writing to temporary file: %s",
-                                  errbuf);
-                    skStreamDestroy(&fp_intermediate);
-                    appExit(EXIT_FAILURE);
                 }
+                memcpy(lowest_rec, rec, NODE_SIZE);
+                have_lowest = 1;
+            }
+        }
+        if (have_lowest) {
+            memcpy(out_buf + out_count * NODE_SIZE, lowest_rec, NODE_SIZE);
+            ++out_count;
+        }
+        if (out_count) {
+            mergeWriteRecords(fp_intermediate, out_buf, out_count);
+        }
+
+        rv = skMergeGetError(merge, &source);
+        if (rv) {
+            if (SKSTREAM_ERR_READ_SHORT == rv) {
+                snprintf(errbuf, sizeof(errbuf), "Short read from '%s'",
+                         skStreamGetPathname(fps[source]));
             } else {
-                /* we successfully opened all (remaining) temp files,
-                 * write to record to the final destination */
-                switch (rwRecGetTcpState((rwRec*)lowest_rec) & TIMEOUT_MASK) {
-                  case 0:
-                    ++counts.combined;
-                    break;
-                  case TIMEOUT_MASK:
-                    ++counts.miss_start_end;
-                    break;
-                  case SK_TCPSTATE_TIMEOUT_KILLED:
-                    ++counts.miss_end;
-                    break;
-                  case SK_TCPSTATE_TIMEOUT_STARTED:
-                    ++counts.miss_start;
-                    break;
-                }
-                rv = skStreamWriteRecord(out_stream, (rwRec*)lowest_rec);
-                if (0 != rv) {
-                    skStreamPrintLastErr(out_stream, rv, &skAppPrintErr);
-                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                        appExit(EXIT_FAILURE);
-                    }
-                }
+                skStreamLastErrMessage(fps[source], rv, errbuf,
+                                       sizeof(errbuf));
             }
-        } while (heap_count > 0);
+            skAppPrintErr("Error reading from temporary file: %s", errbuf);
+            appExit(EXIT_FAILURE);
+        }
 
         TRACEMSG((("Finished processing #%d through #%d"),
                   tmp_idx_a, tmp_idx_b));
@@ -851,7 +890,8 @@ mergeFiles(
 
     } while (!opened_all_temps);
 
-    skHeapFree(heap);
+    free(in_buf);
+    skMergeDestroy(&merge);
 }
 
 
@@ -92,11 +92,13 @@
 RCSIDENT("$SiLK: rwdedupe.c e24d53743a28 2015-01-16 22:48:56Z mthomas $");
 
 #include "rwdedupe.h"
-#include <silk/skheap.h>
+#include <silk/skmerge.h>
 
 
 /* TYPEDEFS AND DEFINES */
 
+/* the number of records to read from the merge at one time */
+#define MERGE_BLOCK_RECS  1024
 
 
 /* EXPORTED VARIABLES */
@@ -315,24 +317,62 @@ rwrecCompare(
 
 
 /*
- *  status = compHeapNodes(b, a, v_recs);
+ *  prefix = mergePrefix(rec, cmp_data);
  *
- *    Callback function used by the heap two compare two heapnodes,
- *    there are just indexes into an array of records.  'v_recs' is
- *    the array of records, where each record is NODE_SIZE bytes.
+ *    Prefix function for the merge, used when the first sort field
+ *    is an IP address.  Return the IPv4 address, or, for an IPv6
+ *    address, a value greater than every IPv4 address that holds the
+ *    leading bits of the address.
+ */
+static uint64_t
+mergePrefix(
+    const void         *rec,
+    void        UNUSED(*cmp_data))
+{
+    skipaddr_t ip;
+#if SK_ENABLE_IPV6
+    uint8_t ipv6[16];
+    uint64_t hi;
+#endif
+
+    switch (sort_fields[0]) {
+      case RWREC_FIELD_SIP:
+        rwRecMemGetSIP((const rwRec*)rec, &ip);
+        break;
+      case RWREC_FIELD_DIP:
+        rwRecMemGetDIP((const rwRec*)rec, &ip);
+        break;
+      case RWREC_FIELD_NHIP:
+        rwRecMemGetNhIP((const rwRec*)rec, &ip);
+        break;
+      default:
+        skAbortBadCase(sort_fields[0]);
+    }
+#if SK_ENABLE_IPV6
+    if (skipaddrIsV6(&ip)) {
+        /* compareIPs() sorts IPv6 after IPv4 */
+        skipaddrGetV6(&ip, ipv6);
+        memcpy(&hi, ipv6, sizeof(hi));
+        return (UINT64_C(1) << 63) | (ntoh64(hi) >> 1);
+    }
+#endif
+    return skipaddrGetV4(&ip);
+}
+
+
+/*
+ *  mergeCompare(a, b, cmp_data);
  *
- *    Note the order of arguments is 'b', 'a'.
+ *    Comparison function for the merge; a wrapper over
+ *    rwrecCompare().
  */
 static int
-compHeapNodes(
-    const skheapnode_t  b,
-    const skheapnode_t  a,
-    void               *v_recs)
+mergeCompare(
+    const void         *a,
+    const void         *b,
+    void        UNUSED(*cmp_data))
 {
-    uint8_t *recs = (uint8_t*)v_recs;
-
-    return rwrecCompare(&recs[*(uint16_t*)a * NODE_SIZE],
-                        &recs[*(uint16_t*)b * NODE_SIZE]);
+    return rwrecCompare(a, b);
 }
 
 
@@ -349,19 +389,23 @@ mergeFiles(
 {
     char errbuf[2 * PATH_MAX];
     skstream_t *fps[MAX_MERGE_FILES];
-    uint8_t recs[MAX_MERGE_FILES][NODE_SIZE];
     uint8_t lowest_rec[NODE_SIZE];
+    uint8_t *buf;
+    uint8_t *rec;
+    int have_lowest;
     int j;
     uint16_t open_count;
     uint16_t i;
-    uint16_t lowest;
-    uint16_t *top_heap;
     int tmp_idx_a;
     int tmp_idx_b;
     skstream_t *fp_intermediate = NULL;
     int tmp_idx_intermediate;
-    skheap_t *heap;
-    uint32_t heap_count;
+    sk_merge_t *merge;
+    size_t source;
+    size_t count;
+    size_t kept;
+    size_t k;
+    size_t written;
     int opened_all_temps = 0;
     ssize_t rv;
 
@@ -371,17 +415,24 @@ mergeFiles(
     TRACEMSG(("Merging #%d through #%d to '%s'",
               tmp_idx_a, temp_file_idx, skStreamGetPathname(out_rwios)));
 
-    heap = skHeapCreate2(compHeapNodes, MAX_MERGE_FILES, sizeof(uint16_t),
-                         NULL, recs);
-    if (NULL == heap) {
-        skAppPrintOutOfMemory("heap");
+    merge = skMergeCreate(NODE_SIZE, MAX_MERGE_FILES, &mergeCompare, NULL);
+    buf = (uint8_t*)malloc(MERGE_BLOCK_RECS * NODE_SIZE);
+    if (NULL == merge || NULL == buf) {
+        skAppPrintOutOfMemory("merge");
         appExit(EXIT_FAILURE);
     }
+    if (num_fields > 0
+        && (RWREC_FIELD_SIP == sort_fields[0]
+            || RWREC_FIELD_DIP == sort_fields[0]
+            || RWREC_FIELD_NHIP == sort_fields[0]))
+    {
+        skMergeSetPrefixFunction(merge, &mergePrefix);
+    }
 
     /* This loop repeats as long as we haven't read all of the temp
      * files generated in the qsort stage. */
     do {
-        assert(SKHEAP_ERR_EMPTY==skHeapPeekTop(heap,(skheapnode_t*)&top_heap));
+        skMergeReset(merge);
 
         /* the index of the list temp file to merge */
         tmp_idx_b = temp_file_idx;
@@ -421,40 +472,16 @@ mergeFiles(
                     appExit(EXIT_FAILURE);
                 }
             }
-
-            /* read the first record */
-            rv = skStreamRead(fps[open_count], recs[open_count], NODE_SIZE);
-            if (NODE_SIZE == rv) {
-                /* insert the file index into the heap */
-                skHeapInsert(heap, &open_count);
-                ++open_count;
-                if (open_count == MAX_MERGE_FILES) {
-                    /* We've reached the limit for this pass.  Set
-                     * tmp_idx_b to the file we just opened. */
-                    tmp_idx_b = j;
-                    TRACEMSG((("MAX_MERGE_FILES limit hit--"
+            skMergeAddStream(merge, fps[open_count]);
+            ++open_count;
+            if (open_count == MAX_MERGE_FILES) {
+                /* We've reached the limit for this pass.  Set
+                 * tmp_idx_b to the file we just opened. */
+                tmp_idx_b = j;
+                TRACEMSG((("MAX_MERGE_FILES limit hit--"
                            "merging #%d through #%d to #%d"),
-                              tmp_idx_a, tmp_idx_b, tmp_idx_intermediate));
-                    break;
-                }
-            } else if (0 == rv) {
-                TRACEMSG(("Ignoring empty temporary file '%s'",
-                          skTempFileGetName(tmpctx, j)));
-                skStreamDestroy(&fps[open_count]);
-            } else {
-                if (rv > 0) {
-                    snprintf(errbuf, sizeof(errbuf),
-                             "Short read %" SK_PRIdZ "/%" PRIu32 " from '%s'",
-                             rv, NODE_SIZE,
-                             skStreamGetPathname(fps[open_count]));
-                } else {
-                    skStreamLastErrMessage(
-                        fps[open_count], rv, errbuf, sizeof(errbuf));
-                }
-                skAppPrintErr(
-                    "Error reading first record from temporary file: %s",
-                    errbuf);
-                appExit(EXIT_FAILURE);
+                          tmp_idx_a, tmp_idx_b, tmp_idx_intermediate));
+                break;
             }
         }
 
@@ -474,29 +501,29 @@ mergeFiles(
 
         TRACEMSG((("Merging %" PRIu16 " temporary files"), open_count));
 
-        heap_count = skHeapGetNumberEntries(heap);
-        assert(heap_count == open_count);
-
-        /* get the index of the file with the lowest record; which is
-         * at the top of the heap */
-        if (skHeapPeekTop(heap, (skheapnode_t*)&top_heap) != SKHEAP_OK) {
-            skAppPrintErr("Unable to open and read any temporary files.");
-            appExit(EXIT_FAILURE);
-        }
-        lowest = *top_heap;
-
-        /* exit this do...while() once all records for all opened
-         * files have been read */
-        do {
-            /* lowest_rec is the record pointed to by the index at the
-             * top of the heap */
-            memcpy(lowest_rec, recs[lowest], NODE_SIZE);
+        /* read the merged records in blocks, remove the records that
+         * are duplicates of the record written before them, and write
+         * the remaining records */
+        have_lowest = 0;
+        while ((count = skMergeRead(merge, buf, MERGE_BLOCK_RECS)) > 0) {
+            for (k = 0, kept = 0, rec = buf; k < count; ++k, rec += NODE_SIZE)
+            {
+                if (have_lowest && 0 == rwrecCompare(lowest_rec, rec)) {
+                    /* record is a duplicate; ignore it */
+                    continue;
+                }
+                memcpy(lowest_rec, rec, NODE_SIZE);
+                have_lowest = 1;
+                if (kept != k) {
+                    memcpy(buf + kept * NODE_SIZE, rec, NODE_SIZE);
+                }
+                ++kept;
+            }
 
-            /* write the record */
             if (fp_intermediate) {
-                /* write the record to intermediate tmp file */
-                rv = skStreamWrite(fp_intermediate, lowest_rec, NODE_SIZE);
-                if (NODE_SIZE != rv) {
+                /* write the records to intermediate tmp file */
+                rv = skStreamWrite(fp_intermediate, buf, kept * NODE_SIZE);
+                if ((ssize_t)(kept * NODE_SIZE) != rv) {
                     skAppPrintSyserror(
                         "Error writing record to temporary file '%s'",
                         skTempFileGetName(tmpctx, tmp_idx_intermediate));
@@ -504,70 +531,38 @@ mergeFiles(
                 }
             } else {
                 /* we successfully opened all (remaining) temp files,
-                 * write to record to the final destination */
-                rv = skStreamWriteRecord(out_rwios, (rwRec*)lowest_rec);
-                if (0 != rv) {
+                 * write the records to the final destination */
+                rec = buf;
+                while (kept) {
+                    rv = skStreamWriteRecords(out_rwios, (rwRec*)rec, kept,
+                                              &written);
+                    if (0 == rv) {
+                        break;
+                    }
                     skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
                     if (SKSTREAM_ERROR_IS_FATAL(rv)) {
                         appExit(EXIT_FAILURE);
                     }
+                    /* skip the record that failed */
+                    ++written;
+                    rec += written * NODE_SIZE;
+                    kept -= written;
                 }
             }
+        }
 
-            /* replace the record we just processed and loop over all
-             * files until we get a record that is not a duplicate */
-            do {
-                if ((rv = skStreamRead(fps[lowest], recs[lowest], NODE_SIZE))
-                    != NODE_SIZE)
-                {
-                    /* read failed.  there is no more data for this
-                     * file; remove it from the heap; if the heap is
-                     * empty, exit the loop */
-                    skHeapExtractTop(heap, NULL);
-                    --heap_count;
-#if TRACEMSG_LEVEL > 0
-                    if (rv == 0) {
-                        TRACEMSG(
-                            ("Finished reading file #%u: EOF; %u files remain",
-                             (tmp_idx_a + lowest), heap_count));
-                    } else if (rv > 0) {
-                        TRACEMSG(
-                            ("Finished reading file #%u: Short read "
-                             "%" SK_PRIdZ "/%" PRIu32 "; %u files remain",
-                             tmp_idx_a + lowest, rv, NODE_SIZE, heap_count));
-                    } else {
-                        skStreamLastErrMessage(
-                            fps[open_count], rv, errbuf, sizeof(errbuf));
-                        TRACEMSG(
-                            ("Finished reading file #%u: %s; %u files remain",
-                             (tmp_idx_a + lowest), errbuf, heap_count));
-                    }
-#endif  /* TRACEMSG_LEVEL */
-                    if (0 == heap_count) {
-                        break;
-                    }
-
-                } else if (rwrecCompare(lowest_rec, recs[lowest])) {
-                    /* read succeeded.  new record is not a
-                     * duplicate and we insert it into the heap */
-                    /* FIXME: This comparison reduces work when the
-                     * keys are the same, but it adds another
-                     * comparison when the keys are different; is this
-                     * an overall win or lose? */
-                    skHeapReplaceTop(heap, &lowest, NULL);
-
-                } else {
-                    /* read succeeded.  record is a duplicate; ignore
-                     * the record and leave the heap unchanged */
-                    continue;
-                }
-
-                /* get the record at the top of the heap and see if it
-                 * is a duplicate; if it is, ignore it. */
-                skHeapPeekTop(heap, (skheapnode_t*)&top_heap);
-                lowest = *top_heap;
-            } while (0 == rwrecCompare(lowest_rec, recs[lowest]));
-        } while (heap_count > 0);
+        rv = skMergeGetError(merge, &source);
+        if (rv) {
+            if (SKSTREAM_ERR_READ_SHORT == rv) {
+                snprintf(errbuf, sizeof(errbuf), "Short read from '%s'",
+                         skStreamGetPathname(fps[source]));
+            } else {
+                skStreamLastErrMessage(fps[source], rv, errbuf,
+                                       sizeof(errbuf));
+            }
+            skAppPrintErr("Error reading from temporary file: %s", errbuf);
+            appExit(EXIT_FAILURE);
+        }
 
         TRACEMSG((("Finished processing #%d through #%d"),
                   tmp_idx_a, tmp_idx_b));
@@ -600,7 +595,8 @@ mergeFiles(
 
     } while (!opened_all_temps);
 
-    skHeapFree(heap);
+    free(buf);
+    skMergeDestroy(&merge);
 }
 
 
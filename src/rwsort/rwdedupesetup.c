@@ -112,7 +112,8 @@ typedef enum {
     OPT_STIME_DELTA,
     OPT_DURATION_DELTA,
     OPT_OUTPUT_PATH,
-    OPT_BUFFER_SIZE
+    OPT_BUFFER_SIZE,
+    OPT_MEMORY_LIMIT
 } appOptionsEnum;
 
 static struct option appOptions[] = {
@@ -124,6 +125,7 @@ static struct option appOptions[] = {
     {"duration-delta",      REQUIRED_ARG, 0, OPT_DURATION_DELTA},
     {"output-path",         REQUIRED_ARG, 0, OPT_OUTPUT_PATH},
     {"buffer-size",         REQUIRED_ARG, 0, OPT_BUFFER_SIZE},
+    {"memory-limit",        REQUIRED_ARG, 0, OPT_MEMORY_LIMIT},
     {0,0,0,0}               /* sentinel entry */
 };
 
@@ -142,6 +144,8 @@ static const char *appHelp[] = {
     ("Destination for output (stdout|pipe).\n"
      "\tDefault is stdout if stdout is not a terminal"),
     NULL, /* generated dynamically */
+    ("Alias for --buffer-size, matching the switch that\n"
+     "\tlimits the memory of rwuniq and rwstats"),
     (char *)NULL
 };
 
@@ -505,6 +509,7 @@ appOptionsHandler(
         break;
 
       case OPT_BUFFER_SIZE:
+      case OPT_MEMORY_LIMIT:
         rv = skStringParseHumanUint64(&buffer_size, opt_arg,
                                       SK_HUMAN_NORMAL);
         if (rv) {
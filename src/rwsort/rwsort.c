@@ -71,7 +71,9 @@
 **
 **  Records are read and stored in this buffer; if the input ends
 **  before the buffer is filled, the records are sorted and printed to
-**  standard out or to the named output file.
+**  standard out or to the named output file.  The records are sorted
+**  with a radix sort on a byte-comparable key built from the --fields;
+**  see sortBuffer().
 **
 **  However, if the buffer fills before the input is completely read,
 **  the records in the buffer are sorted and written to a temporary
@@ -81,8 +83,15 @@
 **  where N is either all the temporary files, MAX_MERGE_FILES, or the
 **  maximum number that we can open before running out of file descriptors
 **  (EMFILE) or memory.  If we cannot open all temporary files, we
-**  merge the N files into a new temporary file, then add it to the
-**  list of files to merge.
+**  merge the N files into a new temporary file, which takes the
+**  place of those N files in the list of files to merge.  Records
+**  with identical keys are merged in the order they were read.
+**
+**  When the --threads switch is greater than 1, the radix sort and
+**  the merge use multiple threads.  Once the first temporary file is
+**  written, the buffer is divided in half so that one half may be
+**  sorted and written while records are read into the other.  The
+**  output does not depend on the number of threads.
 **
 **  When the temporary files are written to the same volume (file
 **  system) as the final output, the maximum disk usage will be
@@ -98,7 +107,7 @@
 RCSIDENT("$SiLK: rwsort.c 0a0b993ba012 2015-01-23 19:59:04Z mthomas $");
 
 #include "rwsort.h"
-#include <silk/skheap.h>
+#include <silk/skmerge.h>
 
 
 /* EXPORTED VARIABLES */
@@ -138,6 +147,9 @@ int presorted_input = 0;
 /* maximum amount of RAM to attempt to allocate */
 uint64_t sort_buffer_size = DEFAULT_SORT_BUFFER_SIZE;
 
+/* number of threads to use for sorting and merging */
+uint32_t thread_count = 1;
+
 
 
 /* FUNCTION DEFINITIONS */
@@ -369,256 +381,1488 @@ rwrecCompare(
 
 
 /*
- *  status = compHeapNodes(b, a, v_recs);
+ *    rwsort sorts the in-core buffer with a radix sort over a
+ *    byte-comparable key that is built for each record from the
+ *    --fields list.  Each entry in the key array is the key followed
+ *    by the index of the record in the buffer.  The key holds the
+ *    leading fields of the list that are not from plug-ins; when
+ *    plug-in fields are present, records with identical keys are
+ *    sorted with rwrecCompare() once the radix sort is complete.
  *
- *    Callback function used by the heap two compare two heapnodes,
- *    there are just indexes into an array of records.  'v_recs' is
- *    the array of records, where each record is MAX_NODE_SIZE bytes.
+ *    The radix sort is stable, so records with identical values for
+ *    all the --fields remain in the order in which they were read.
+ */
+
+/* the number of fields in sort_fields[] that are in the radix key;
+ * set by sortKeyInit() */
+static uint32_t sort_key_num_fields = 0;
+
+/* the number of IP addresses in the radix key */
+static uint32_t sort_key_num_ips = 0;
+
+/* the maximum number of octets in the radix key */
+static size_t sort_key_max_width = 0;
+
+/* the number of octets in the radix key for the current buffer */
+static size_t sort_key_width = 0;
+
+/* the number of octets used by an IP address in the radix key for
+ * the current buffer: 4 or 16 */
+static size_t sort_key_ip_width = 0;
+
+/* whether any buffer passed to sortBuffer() held an IPv6 record */
+static int sort_saw_ipv6 = 0;
+
+/* the radix key never exceeds this many octets; any fields beyond
+ * it are compared by rwrecCompare() */
+#define SORT_KEY_MAX_WIDTH  128
+
+/* buckets smaller than this are insertion sorted */
+#define SORT_RADIX_CUTOFF  32
+
+/* size of an entry in the key array: the key and the record index */
+#define SORT_KEY_ENTRY_SIZE(key_width)  ((key_width) + sizeof(uint32_t))
+
+/* write 'val' into the key at 'key_buf' in big endian byte order and
+ * advance 'key_buf' by 'key_len' octets */
+#define SORT_KEY_PUT(key_buf, key_len, val)                     \
+    {                                                           \
+        uint64_t skp_val = (uint64_t)(val);                     \
+        size_t skp_i = (key_len);                               \
+        while (skp_i > 0) {                                     \
+            --skp_i;                                            \
+            (key_buf)[skp_i] = (uint8_t)(skp_val & 0xFF);       \
+            skp_val >>= 8;                                      \
+        }                                                       \
+        (key_buf) += (key_len);                                 \
+    }
+
+/* write a time into the key; the sign bit is flipped so the unsigned
+ * key orders negative times first */
+#define SORT_KEY_PUT_TIME(key_buf, val)                                 \
+    SORT_KEY_PUT(key_buf, 8, ((uint64_t)(val) ^ UINT64_C(0x8000000000000000)))
+
+
+/*
+ *  sortKeyInit();
  *
- *    Note the order of arguments is 'b', 'a'.
+ *    Determine which of the --fields can be put into the radix key
+ *    and the maximum width of that key.
  */
-static int
-compHeapNodes(
-    const skheapnode_t  b,
-    const skheapnode_t  a,
-    void               *v_recs)
+static void
+sortKeyInit(
+    void)
 {
-    uint8_t *recs = (uint8_t*)v_recs;
+    size_t width = 0;
+    size_t field_width;
+    uint32_t i;
+
+    sort_key_num_ips = 0;
+    for (i = 0; i < num_fields; ++i) {
+        switch (sort_fields[i]) {
+          case RWREC_FIELD_SIP:
+          case RWREC_FIELD_DIP:
+          case RWREC_FIELD_NHIP:
+#if SK_ENABLE_IPV6
+            field_width = 16;
+#else
+            field_width = 4;
+#endif
+            break;
+          case RWREC_FIELD_STIME:
+          case RWREC_FIELD_STIME_MSEC:
+          case RWREC_FIELD_ETIME:
+          case RWREC_FIELD_ETIME_MSEC:
+            field_width = 8;
+            break;
+          case RWREC_FIELD_PKTS:
+          case RWREC_FIELD_BYTES:
+          case RWREC_FIELD_ELAPSED:
+          case RWREC_FIELD_ELAPSED_MSEC:
+            field_width = 4;
+            break;
+          case RWREC_FIELD_SPORT:
+          case RWREC_FIELD_DPORT:
+          case RWREC_FIELD_SID:
+          case RWREC_FIELD_INPUT:
+          case RWREC_FIELD_OUTPUT:
+          case RWREC_FIELD_APPLICATION:
+            field_width = 2;
+            break;
+          case RWREC_FIELD_PROTO:
+          case RWREC_FIELD_FLAGS:
+          case RWREC_FIELD_INIT_FLAGS:
+          case RWREC_FIELD_REST_FLAGS:
+          case RWREC_FIELD_TCP_STATE:
+          case RWREC_FIELD_FTYPE_CLASS:
+          case RWREC_FIELD_FTYPE_TYPE:
+          case RWREC_FIELD_ICMP_TYPE:
+          case RWREC_FIELD_ICMP_CODE:
+            field_width = 1;
+            break;
+          default:
+            /* a field from a plug-in; it and the fields that follow
+             * it are compared by rwrecCompare() */
+            goto END;
+        }
+        if (width + field_width > SORT_KEY_MAX_WIDTH) {
+            goto END;
+        }
+        width += field_width;
+        if (sort_fields[i] == RWREC_FIELD_SIP
+            || sort_fields[i] == RWREC_FIELD_DIP
+            || sort_fields[i] == RWREC_FIELD_NHIP)
+        {
+            ++sort_key_num_ips;
+        }
+    }
 
-    return rwrecCompare(&recs[*(uint16_t*)a * MAX_NODE_SIZE],
-                        &recs[*(uint16_t*)b * MAX_NODE_SIZE]);
+  END:
+    sort_key_num_fields = i;
+    sort_key_max_width = width;
+    sort_key_width = width;
+#if SK_ENABLE_IPV6
+    sort_key_ip_width = 16;
+#else
+    sort_key_ip_width = 4;
+#endif
 }
 
 
 /*
- *  status = fillRecordAndKey(rwios, buf);
+ *  k = sortKeyPutField(rec, field, ip_width, k);
  *
- *    Reads a flow record from 'rwios', computes the key based on the
- *    global key_fields[] settings, and fills in the parameter 'buf'
- *    with the record and then the key.  Return 1 if a record was
- *    read, or 0 if it was not.
+ *    Write the value of 'field' for 'rec' into the key at 'k', where
+ *    an IP address takes 'ip_width' octets, and return the position
+ *    after the value.  Does not reverse the value for --reverse.
  */
-static int
-fillRecordAndKey(
-    skstream_t         *rwios,
-    uint8_t            *buf)
+static uint8_t *
+sortKeyPutField(
+    const rwRec        *rec,
+    uint32_t            field,
+    size_t              ip_width,
+    uint8_t            *k)
 {
-    rwRec *rwrec = (rwRec*)buf;
-    skplugin_err_t err;
-    const char **name;
-    size_t i;
-    int rv;
+#if SK_ENABLE_IPV6
+    skipaddr_t ip;
+#else
+    (void)ip_width;
+#endif
 
-    rv = skStreamReadRecord(rwios, rwrec);
-    if (rv) {
-        /* end of file or error getting record */
-        if (SKSTREAM_ERR_EOF != rv) {
-            skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+    switch (field) {
+#if SK_ENABLE_IPV6
+      case RWREC_FIELD_SIP:
+        if (16 == ip_width) {
+            rwRecMemGetSIP(rec, &ip);
+            skipaddrGetAsV6(&ip, k);
+            k += 16;
+        } else {
+            SORT_KEY_PUT(k, 4, rwRecGetSIPv4(rec));
         }
-        return 0;
+        break;
+      case RWREC_FIELD_DIP:
+        if (16 == ip_width) {
+            rwRecMemGetDIP(rec, &ip);
+            skipaddrGetAsV6(&ip, k);
+            k += 16;
+        } else {
+            SORT_KEY_PUT(k, 4, rwRecGetDIPv4(rec));
+        }
+        break;
+      case RWREC_FIELD_NHIP:
+        if (16 == ip_width) {
+            rwRecMemGetNhIP(rec, &ip);
+            skipaddrGetAsV6(&ip, k);
+            k += 16;
+        } else {
+            SORT_KEY_PUT(k, 4, rwRecGetNhIPv4(rec));
+        }
+        break;
+#else
+      case RWREC_FIELD_SIP:
+        SORT_KEY_PUT(k, 4, rwRecGetSIPv4(rec));
+        break;
+      case RWREC_FIELD_DIP:
+        SORT_KEY_PUT(k, 4, rwRecGetDIPv4(rec));
+        break;
+      case RWREC_FIELD_NHIP:
+        SORT_KEY_PUT(k, 4, rwRecGetNhIPv4(rec));
+        break;
+#endif  /* SK_ENABLE_IPV6 */
+      case RWREC_FIELD_SPORT:
+        SORT_KEY_PUT(k, 2, rwRecGetSPort(rec));
+        break;
+      case RWREC_FIELD_DPORT:
+        SORT_KEY_PUT(k, 2, rwRecGetDPort(rec));
+        break;
+      case RWREC_FIELD_PROTO:
+        SORT_KEY_PUT(k, 1, rwRecGetProto(rec));
+        break;
+      case RWREC_FIELD_PKTS:
+        SORT_KEY_PUT(k, 4, rwRecGetPkts(rec));
+        break;
+      case RWREC_FIELD_BYTES:
+        SORT_KEY_PUT(k, 4, rwRecGetBytes(rec));
+        break;
+      case RWREC_FIELD_FLAGS:
+        SORT_KEY_PUT(k, 1, rwRecGetFlags(rec));
+        break;
+      case RWREC_FIELD_STIME:
+      case RWREC_FIELD_STIME_MSEC:
+        SORT_KEY_PUT_TIME(k, rwRecGetStartTime(rec));
+        break;
+      case RWREC_FIELD_ELAPSED:
+      case RWREC_FIELD_ELAPSED_MSEC:
+        SORT_KEY_PUT(k, 4, rwRecGetElapsed(rec));
+        break;
+      case RWREC_FIELD_ETIME:
+      case RWREC_FIELD_ETIME_MSEC:
+        SORT_KEY_PUT_TIME(k, rwRecGetEndTime(rec));
+        break;
+      case RWREC_FIELD_SID:
+        SORT_KEY_PUT(k, 2, rwRecGetSensor(rec));
+        break;
+      case RWREC_FIELD_INPUT:
+        SORT_KEY_PUT(k, 2, rwRecGetInput(rec));
+        break;
+      case RWREC_FIELD_OUTPUT:
+        SORT_KEY_PUT(k, 2, rwRecGetOutput(rec));
+        break;
+      case RWREC_FIELD_INIT_FLAGS:
+        SORT_KEY_PUT(k, 1, rwRecGetInitFlags(rec));
+        break;
+      case RWREC_FIELD_REST_FLAGS:
+        SORT_KEY_PUT(k, 1, rwRecGetRestFlags(rec));
+        break;
+      case RWREC_FIELD_TCP_STATE:
+        SORT_KEY_PUT(k, 1, rwRecGetTcpState(rec));
+        break;
+      case RWREC_FIELD_APPLICATION:
+        SORT_KEY_PUT(k, 2, rwRecGetApplication(rec));
+        break;
+      case RWREC_FIELD_FTYPE_CLASS:
+      case RWREC_FIELD_FTYPE_TYPE:
+        SORT_KEY_PUT(k, 1, rwRecGetFlowType(rec));
+        break;
+      case RWREC_FIELD_ICMP_TYPE:
+        SORT_KEY_PUT(k, 1, getIcmpType(rec));
+        break;
+      case RWREC_FIELD_ICMP_CODE:
+        SORT_KEY_PUT(k, 1, getIcmpCode(rec));
+        break;
+      default:
+        skAbortBadCase(field);
     }
+    return k;
+}
 
-    /* lookup data from plug-in */
-    for (i = 0; i < key_num_fields; ++i) {
-        err = skPluginFieldRunRecToBinFn(key_fields[i].kf_field_handle,
-                                         &(buf[key_fields[i].kf_offset]),
-                                         rwrec, NULL);
-        if (err != SKPLUGIN_OK) {
-            skPluginFieldName(key_fields[i].kf_field_handle, &name);
-            skAppPrintErr(("Plugin-based field %s failed "
-                           "converting to binary "
-                           "with error code %d"), name[0], err);
-            appExit(EXIT_FAILURE);
+
+/*
+ *  sortKeyFill(rec, key);
+ *
+ *    Fill 'key' with the radix key for 'rec'.
+ */
+static void
+sortKeyFill(
+    const rwRec        *rec,
+    uint8_t            *key)
+{
+    uint8_t *k = key;
+    uint32_t i;
+
+    for (i = 0; i < sort_key_num_fields; ++i) {
+        k = sortKeyPutField(rec, sort_fields[i], sort_key_ip_width, k);
+    }
+    assert((size_t)(k - key) == sort_key_width);
+
+    if (reverse) {
+        for (k = key; k < key + sort_key_width; ++k) {
+            *k = (uint8_t)~*k;
         }
     }
-    return 1;
 }
 
 
 /*
- *    Create and return a new temporary file, putting the index of the
- *    file in 'temp_idx'.  Exit the application on failure.
+ *  sortKeyRadix(entries, aux, count, depth);
+ *
+ *    Stable most-significant-digit radix sort of the 'count' entries
+ *    in 'entries' on the octets of the key starting at 'depth'.  All
+ *    entries have the same octets before 'depth'.  'aux' is scratch
+ *    space the same size as 'entries'.
  */
-static skstream_t *
-sortTempCreate(
-    int                *temp_idx)
+static void
+sortKeyRadix(
+    uint8_t            *entries,
+    uint8_t            *aux,
+    size_t              count,
+    size_t              depth)
 {
-    skstream_t *stream;
+    const size_t entry_size = SORT_KEY_ENTRY_SIZE(sort_key_width);
+    size_t bucket[256];
+    size_t start[256];
+    uint8_t tmp[SORT_KEY_ENTRY_SIZE(SORT_KEY_MAX_WIDTH)];
+    uint8_t *e;
+    size_t i, j;
+
+    if (count < SORT_RADIX_CUTOFF) {
+        /* insertion sort on the remaining octets */
+        for (i = 1; i < count; ++i) {
+            e = entries + i * entry_size;
+            for (j = i;
+                 (j > 0
+                  && (memcmp(e - entry_size + depth, e + depth,
+                             sort_key_width - depth) > 0));
+                 --j, e -= entry_size)
+            {
+                memcpy(tmp, e, entry_size);
+                memcpy(e, e - entry_size, entry_size);
+                memcpy(e - entry_size, tmp, entry_size);
+            }
+        }
+        return;
+    }
 
-    stream = skTempFileCreateStream(tmpctx, temp_idx);
-    if (NULL == stream) {
-        skAppPrintSyserror("Error creating new temporary file");
-        appExit(EXIT_FAILURE);
+    for ( ; depth < sort_key_width; ++depth) {
+        memset(bucket, 0, sizeof(bucket));
+        for (i = 0, e = entries + depth; i < count; ++i, e += entry_size) {
+            ++bucket[*e];
+        }
+        if (bucket[entries[depth]] == count) {
+            /* every entry has the same octet at this depth */
+            continue;
+        }
+
+        /* scatter the entries into 'aux' by this octet, and copy
+         * them back */
+        start[0] = 0;
+        for (i = 1; i < 256; ++i) {
+            start[i] = start[i-1] + bucket[i-1];
+        }
+        for (i = 0, e = entries; i < count; ++i, e += entry_size) {
+            memcpy(aux + entry_size * start[e[depth]]++, e, entry_size);
+        }
+        memcpy(entries, aux, count * entry_size);
+
+        /* sort each bucket on the next octet */
+        if (depth + 1 < sort_key_width) {
+            for (i = 0, e = entries; i < 256; ++i) {
+                if (bucket[i] > 1) {
+                    sortKeyRadix(e, aux, bucket[i], depth + 1);
+                }
+                e += bucket[i] * entry_size;
+            }
+        }
+        return;
     }
-    return stream;
 }
 
+
 /*
- *    Re-open the existing temporary file indexed by 'temp_idx'.
- *    Return the new stream.  Return NULL if we could not open the
- *    stream due to out-of-memory or out-of-file-handles error.  Exit
- *    the application on any other error.
+ *    When rwsort uses multiple threads, sortBuffer() divides the
+ *    records among the threads to build the keys and to distribute
+ *    the key entries by the first octet at which the keys differ.
+ *    The threads then take the resulting buckets, largest first,
+ *    and sort each with sortKeyRadix().  The buckets do not overlap
+ *    and each thread's range is scattered in order, so the result
+ *    is identical to that of the single-threaded sort.
  */
-static skstream_t *
-sortTempReopen(
-    int                 temp_idx)
+
+/* the minimum number of records to give each thread */
+#define SORT_THREAD_MIN_RECS  0x10000
+
+/* state shared by the threads that sort a buffer */
+typedef struct sort_parallel_st {
+    uint8_t            *record_buffer;
+    uint8_t            *entries;
+    uint8_t            *aux;
+    /* the octet of the key used to distribute the entries */
+    size_t              depth;
+    /* the position and number of the entries in each bucket */
+    size_t              bucket_start[256];
+    size_t              bucket_count[256];
+    /* the buckets in the order to sort them, largest first */
+    uint8_t             bucket_order[256];
+    /* the next position in bucket_order[] to sort */
+    unsigned int        next_bucket;
+    pthread_mutex_t     mutex;
+} sort_parallel_t;
+
+/* the work for a single thread: a range of records and the count
+ * (later, the scatter position) of each octet value in that range */
+typedef struct sort_job_st {
+    sort_parallel_t    *par;
+    uint32_t            begin;
+    uint32_t            end;
+    size_t              hist[256];
+} sort_job_t;
+
+
+/*
+ *  sortRunJobs(job_fn, jobs, job_count);
+ *
+ *    Call 'job_fn' on each of the 'job_count' entries in 'jobs',
+ *    each in its own thread, and wait for them to complete.  The
+ *    calling thread runs the first job.  A job whose thread cannot
+ *    be created is run by the calling thread.
+ */
+static void
+sortRunJobs(
+    void             *(*job_fn)(void *),
+    sort_job_t         *jobs,
+    uint32_t            job_count)
 {
-    skstream_t *stream;
+    pthread_t threads[RWSORT_THREADS_MAX];
+    int started[RWSORT_THREADS_MAX];
+    uint32_t i;
 
-    stream = skTempFileOpenStream(tmpctx, temp_idx);
-    if (NULL == stream) {
-        if ((errno != EMFILE) && (errno != ENOMEM)) {
-            skAppPrintSyserror(("Error opening existing temporary file '%s'"),
-                               skTempFileGetName(tmpctx, temp_idx));
-            appExit(EXIT_FAILURE);
+    assert(job_count <= RWSORT_THREADS_MAX);
+
+    for (i = 1; i < job_count; ++i) {
+        started[i] = (0 == pthread_create(&threads[i], NULL, job_fn,
+                                          &jobs[i]));
+    }
+    job_fn(&jobs[0]);
+    for (i = 1; i < job_count; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            job_fn(&jobs[i]);
+        }
+    }
+}
+
+
+/*
+ *    Thread entry point to build the key entries for the job's range
+ *    of records.
+ */
+static void *
+sortJobFillKeys(
+    void               *v_job)
+{
+    sort_job_t *job = (sort_job_t*)v_job;
+    const size_t entry_size = SORT_KEY_ENTRY_SIZE(sort_key_width);
+    uint8_t *e;
+    uint8_t *node;
+    uint32_t i;
+
+    e = job->par->entries + job->begin * entry_size;
+    node = job->par->record_buffer + job->begin * node_size;
+    for (i = job->begin; i < job->end; ++i, e += entry_size, node += node_size)
+    {
+        sortKeyFill((rwRec*)node, e);
+        memcpy(e + sort_key_width, &i, sizeof(uint32_t));
+    }
+    return NULL;
+}
+
+
+/*
+ *    Thread entry point to count the octet values at the current
+ *    depth for the job's range of key entries.
+ */
+static void *
+sortJobCount(
+    void               *v_job)
+{
+    sort_job_t *job = (sort_job_t*)v_job;
+    const size_t entry_size = SORT_KEY_ENTRY_SIZE(sort_key_width);
+    const uint8_t *e;
+    uint32_t i;
+
+    memset(job->hist, 0, sizeof(job->hist));
+    e = job->par->entries + job->begin * entry_size + job->par->depth;
+    for (i = job->begin; i < job->end; ++i, e += entry_size) {
+        ++job->hist[*e];
+    }
+    return NULL;
+}
+
+
+/*
+ *    Thread entry point to copy the job's range of key entries into
+ *    the scratch array at the positions in the job's 'hist'.
+ */
+static void *
+sortJobScatter(
+    void               *v_job)
+{
+    sort_job_t *job = (sort_job_t*)v_job;
+    const size_t entry_size = SORT_KEY_ENTRY_SIZE(sort_key_width);
+    const size_t depth = job->par->depth;
+    uint8_t *aux = job->par->aux;
+    const uint8_t *e;
+    uint32_t i;
+
+    e = job->par->entries + job->begin * entry_size;
+    for (i = job->begin; i < job->end; ++i, e += entry_size) {
+        memcpy(aux + entry_size * job->hist[e[depth]]++, e, entry_size);
+    }
+    return NULL;
+}
+
+
+/*
+ *    Thread entry point to sort buckets of key entries until no
+ *    buckets remain.
+ */
+static void *
+sortJobBuckets(
+    void               *v_job)
+{
+    sort_parallel_t *par = ((sort_job_t*)v_job)->par;
+    const size_t entry_size = SORT_KEY_ENTRY_SIZE(sort_key_width);
+    unsigned int b;
+
+    for (;;) {
+        pthread_mutex_lock(&par->mutex);
+        b = par->next_bucket++;
+        pthread_mutex_unlock(&par->mutex);
+        if (b >= 256) {
+            return NULL;
+        }
+        b = par->bucket_order[b];
+        if (par->bucket_count[b] < 2) {
+            /* the remaining buckets are smaller */
+            return NULL;
+        }
+        sortKeyRadix(par->entries + par->bucket_start[b] * entry_size,
+                     par->aux + par->bucket_start[b] * entry_size,
+                     par->bucket_count[b], par->depth + 1);
+    }
+}
+
+
+/*
+ *  sortKeyParallel(record_buffer, record_count, &entries, &aux, job_count);
+ *
+ *    Build the key entries for the 'record_count' records in
+ *    'record_buffer' and sort them using 'job_count' threads.
+ *    'entries' and 'aux' are arrays of key entries large enough to
+ *    hold one entry per record.  The sorted entries may end in
+ *    either array; on return, 'entries' refers to the array that
+ *    holds them and 'aux' to the other.
+ */
+static void
+sortKeyParallel(
+    uint8_t            *record_buffer,
+    uint32_t            record_count,
+    uint8_t           **entries,
+    uint8_t           **aux,
+    uint32_t            job_count)
+{
+    sort_job_t jobs[RWSORT_THREADS_MAX];
+    sort_parallel_t par;
+    size_t total[256];
+    size_t pos;
+    size_t n;
+    uint8_t *tmp;
+    uint32_t per_job;
+    unsigned int b, i, j;
+
+    memset(&par, 0, sizeof(par));
+    par.record_buffer = record_buffer;
+    par.entries = *entries;
+    par.aux = *aux;
+    pthread_mutex_init(&par.mutex, NULL);
+
+    per_job = record_count / job_count;
+    for (i = 0; i < job_count; ++i) {
+        jobs[i].par = &par;
+        jobs[i].begin = i * per_job;
+        jobs[i].end = ((i + 1 == job_count) ? record_count : (i+1) * per_job);
+    }
+
+    sortRunJobs(&sortJobFillKeys, jobs, job_count);
+
+    /* find the first octet where the keys differ */
+    for (par.depth = 0; par.depth < sort_key_width; ++par.depth) {
+        sortRunJobs(&sortJobCount, jobs, job_count);
+        memset(total, 0, sizeof(total));
+        for (i = 0; i < job_count; ++i) {
+            for (b = 0; b < 256; ++b) {
+                total[b] += jobs[i].hist[b];
+            }
+        }
+        if (total[par.entries[par.depth]] != record_count) {
+            break;
+        }
+    }
+    if (par.depth == sort_key_width) {
+        /* every key is identical; the entries are in order */
+        goto END;
+    }
+
+    /* determine where each job writes the entries for each octet
+     * value: the buckets in order, and within a bucket the jobs in
+     * order */
+    pos = 0;
+    for (b = 0; b < 256; ++b) {
+        par.bucket_start[b] = pos;
+        par.bucket_count[b] = total[b];
+        for (i = 0; i < job_count; ++i) {
+            n = jobs[i].hist[b];
+            jobs[i].hist[b] = pos;
+            pos += n;
+        }
+    }
+    sortRunJobs(&sortJobScatter, jobs, job_count);
+
+    /* the entries are now in 'aux' */
+    tmp = par.entries;
+    par.entries = par.aux;
+    par.aux = tmp;
+
+    if (par.depth + 1 < sort_key_width) {
+        /* sort the buckets by size, largest first */
+        for (b = 0; b < 256; ++b) {
+            for (j = b;
+                 (j > 0
+                  && (par.bucket_count[par.bucket_order[j-1]]
+                      < par.bucket_count[b]));
+                 --j)
+            {
+                par.bucket_order[j] = par.bucket_order[j-1];
+            }
+            par.bucket_order[j] = (uint8_t)b;
+        }
+        par.next_bucket = 0;
+        sortRunJobs(&sortJobBuckets, jobs, job_count);
+    }
+
+  END:
+    pthread_mutex_destroy(&par.mutex);
+    *entries = par.entries;
+    *aux = par.aux;
+}
+
+
+/*
+ *  sortPermute(record_buffer, record_count, source);
+ *
+ *    Move the 'record_count' nodes in 'record_buffer' so that the
+ *    node at position i is the node that was at position source[i],
+ *    by following the cycles of the permutation.  Modifies 'source'.
+ */
+static void
+sortPermute(
+    uint8_t            *record_buffer,
+    uint32_t            record_count,
+    uint32_t           *source)
+{
+    uint8_t tmp_node[MAX_NODE_SIZE];
+    uint32_t i, j, k;
+
+    for (i = 0; i < record_count; ++i) {
+        if (source[i] == i) {
+            continue;
+        }
+        memcpy(tmp_node, record_buffer + i * node_size, node_size);
+        j = i;
+        while ((k = source[j]) != i) {
+            memcpy(record_buffer + j * node_size,
+                   record_buffer + k * node_size, node_size);
+            source[j] = j;
+            j = k;
+        }
+        memcpy(record_buffer + j * node_size, tmp_node, node_size);
+        source[j] = j;
+    }
+}
+
+
+/*
+ *    Comparison function for skQSort() used by sortStable(): compare
+ *    the nodes whose positions in 'sort_stable_buffer' are 'a' and
+ *    'b' with rwrecCompare(), and break ties on the positions.
+ */
+static const uint8_t *sort_stable_buffer = NULL;
+
+static int
+sortStableCompare(
+    const void         *a,
+    const void         *b)
+{
+    uint32_t pos_a = *(const uint32_t*)a;
+    uint32_t pos_b = *(const uint32_t*)b;
+    int rv;
+
+    rv = rwrecCompare(sort_stable_buffer + pos_a * node_size,
+                      sort_stable_buffer + pos_b * node_size);
+    if (rv) {
+        return rv;
+    }
+    return ((pos_a < pos_b) ? -1 : (pos_a > pos_b));
+}
+
+
+/*
+ *  sortStable(record_buffer, record_count, source);
+ *
+ *    Sort the 'record_count' nodes in 'record_buffer' with
+ *    rwrecCompare(), keeping nodes that compare as equal in their
+ *    current order.  'source' is an array of at least 'record_count'
+ *    values used for the positions of the nodes.
+ */
+static void
+sortStable(
+    uint8_t            *record_buffer,
+    uint32_t            record_count,
+    uint32_t           *source)
+{
+    uint32_t i;
+
+    for (i = 0; i < record_count; ++i) {
+        source[i] = i;
+    }
+    sort_stable_buffer = record_buffer;
+    skQSort(source, record_count, sizeof(uint32_t), &sortStableCompare);
+    sort_stable_buffer = NULL;
+    sortPermute(record_buffer, record_count, source);
+}
+
+
+/*
+ *  sortBuffer(record_buffer, record_count);
+ *
+ *    Sort the 'record_count' nodes in 'record_buffer' by the
+ *    --fields.  Use the radix sort when there is a radix key and
+ *    memory for the key array can be allocated; otherwise, use
+ *    sortStable().  Either way, records with identical keys remain
+ *    in the order they were read.  Exit the application if memory
+ *    for sortStable() cannot be allocated.
+ */
+static void
+sortBuffer(
+    uint8_t            *record_buffer,
+    uint32_t            record_count)
+{
+    uint8_t *entries = NULL;
+    uint8_t *aux = NULL;
+    uint32_t *source;
+    size_t entry_size;
+    uint8_t *e;
+    uint8_t *node;
+    uint32_t job_count;
+    uint32_t i, j;
+
+    if (0 == sort_key_num_fields) {
+        if (record_count < 2) {
+            return;
+        }
+        source = (uint32_t*)malloc(record_count * sizeof(uint32_t));
+        if (NULL == source) {
+            skAppPrintOutOfMemory("sort index");
+            appExit(EXIT_FAILURE);
+        }
+        sortStable(record_buffer, record_count, source);
+        free(source);
+        return;
+    }
+
+#if SK_ENABLE_IPV6
+    /* when every record is IPv4, compare the IPs as 4 octets */
+    sort_key_ip_width = 4;
+    for (i = 0, node = record_buffer; i < record_count; ++i, node += node_size)
+    {
+        if (rwRecIsIPv6((rwRec*)node)) {
+            sort_key_ip_width = 16;
+            sort_saw_ipv6 = 1;
+            break;
+        }
+    }
+    sort_key_width = (sort_key_max_width
+                      - (16 - sort_key_ip_width) * sort_key_num_ips);
+#endif  /* SK_ENABLE_IPV6 */
+    if (record_count < 2) {
+        return;
+    }
+    entry_size = SORT_KEY_ENTRY_SIZE(sort_key_width);
+
+    entries = (uint8_t*)malloc(record_count * entry_size);
+    aux = (uint8_t*)malloc(record_count * entry_size);
+    if (NULL == entries || NULL == aux) {
+        TRACEMSG(("Cannot allocate radix key array; using sortStable()"));
+        free(entries);
+        free(aux);
+        source = (uint32_t*)malloc(record_count * sizeof(uint32_t));
+        if (NULL == source) {
+            skAppPrintOutOfMemory("sort index");
+            appExit(EXIT_FAILURE);
+        }
+        sortStable(record_buffer, record_count, source);
+        free(source);
+        return;
+    }
+
+    /* build the keys and sort them */
+    job_count = record_count / SORT_THREAD_MIN_RECS;
+    if (job_count > thread_count) {
+        job_count = thread_count;
+    }
+    if (job_count > 1) {
+        sortKeyParallel(record_buffer, record_count, &entries, &aux,
+                        job_count);
+    } else {
+        for (i = 0, e = entries, node = record_buffer;
+             i < record_count;
+             ++i, e += entry_size, node += node_size)
+        {
+            sortKeyFill((rwRec*)node, e);
+            memcpy(e + sort_key_width, &i, sizeof(uint32_t));
+        }
+        sortKeyRadix(entries, aux, record_count, 0);
+    }
+
+    /* get the source index of the record for each position in the
+     * sorted order, and move the records into that order by
+     * following the cycles of the permutation */
+    source = (uint32_t*)aux;
+    for (i = 0, e = entries + sort_key_width;
+         i < record_count;
+         ++i, e += entry_size)
+    {
+        memcpy(&source[i], e, sizeof(uint32_t));
+    }
+    sortPermute(record_buffer, record_count, source);
+
+    /* sort the runs of records with identical keys on the remaining
+     * fields, using 'source' for the positions */
+    if (sort_key_num_fields < num_fields) {
+        for (i = 0, e = entries; i < record_count; i = j) {
+            for (j = i + 1, e += entry_size;
+                 (j < record_count
+                  && 0 == memcmp(e - entry_size, e, sort_key_width));
+                 ++j, e += entry_size)
+                ;               /* empty */
+            if (j - i > 1) {
+                sortStable(record_buffer + i * node_size, j - i, source);
+            }
+        }
+    }
+
+    free(entries);
+    free(aux);
+}
+
+
+/*
+ *  fillKey(buf);
+ *
+ *    Compute the key fields that come from plug-ins for the record at
+ *    the start of 'buf' and store them in 'buf' after the record.
+ *    Exit the application on error.
+ */
+static void
+fillKey(
+    uint8_t            *buf)
+{
+    const rwRec *rwrec = (const rwRec*)buf;
+    skplugin_err_t err;
+    const char **name;
+    size_t i;
+
+    /* lookup data from plug-in */
+    for (i = 0; i < key_num_fields; ++i) {
+        err = skPluginFieldRunRecToBinFn(key_fields[i].kf_field_handle,
+                                         &(buf[key_fields[i].kf_offset]),
+                                         rwrec, NULL);
+        if (err != SKPLUGIN_OK) {
+            skPluginFieldName(key_fields[i].kf_field_handle, &name);
+            skAppPrintErr(("Plugin-based field %s failed "
+                           "converting to binary "
+                           "with error code %d"), name[0], err);
+            appExit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+/*
+ *  status = fillRecordAndKey(rwios, buf);
+ *
+ *    Reads a flow record from 'rwios', computes the key based on the
+ *    global key_fields[] settings, and fills in the parameter 'buf'
+ *    with the record and then the key.  Return 1 if a record was
+ *    read, or 0 if it was not.
+ */
+static int
+fillRecordAndKey(
+    skstream_t         *rwios,
+    uint8_t            *buf)
+{
+    int rv;
+
+    rv = skStreamReadRecord(rwios, (rwRec*)buf);
+    if (rv) {
+        /* end of file or error getting record */
+        if (SKSTREAM_ERR_EOF != rv) {
+            skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+        }
+        return 0;
+    }
+    fillKey(buf);
+    return 1;
+}
+
+
+/*
+ *  count = fillRecordsAndKeys(rwios, buf, max_recs);
+ *
+ *    Reads up to 'max_recs' flow records from 'rwios' into the
+ *    consecutive nodes of 'buf', each of which is 'node_size' bytes,
+ *    and computes the key for each as fillRecordAndKey() does.
+ *    Return the number of records read; 0 indicates end of file or
+ *    an error.
+ */
+static uint32_t
+fillRecordsAndKeys(
+    skstream_t         *rwios,
+    uint8_t            *buf,
+    uint32_t            max_recs)
+{
+    rwRec recs[SORT_READ_COUNT];
+    size_t count;
+    size_t i;
+    int rv;
+
+    if (sizeof(rwRec) == node_size) {
+        /* the nodes are just records; read directly into them */
+        rv = skStreamReadRecords(rwios, (rwRec*)buf, max_recs, &count);
+    } else {
+        if (max_recs > SORT_READ_COUNT) {
+            max_recs = SORT_READ_COUNT;
+        }
+        rv = skStreamReadRecords(rwios, recs, max_recs, &count);
+        for (i = 0; i < count; ++i, buf += node_size) {
+            memcpy(buf, &recs[i], sizeof(rwRec));
+            fillKey(buf);
+        }
+    }
+    if (rv && SKSTREAM_ERR_EOF != rv) {
+        skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+    }
+    return (uint32_t)count;
+}
+
+
+/*
+ *    Create and return a new temporary file, putting the index of the
+ *    file in 'temp_idx'.  Exit the application on failure.
+ */
+static skstream_t *
+sortTempCreate(
+    int                *temp_idx)
+{
+    skstream_t *stream;
+
+    stream = skTempFileCreateStream(tmpctx, temp_idx);
+    if (NULL == stream) {
+        skAppPrintSyserror("Error creating new temporary file");
+        appExit(EXIT_FAILURE);
+    }
+    return stream;
+}
+
+/*
+ *    Re-open the existing temporary file indexed by 'temp_idx'.
+ *    Return the new stream.  Return NULL if we could not open the
+ *    stream due to out-of-memory or out-of-file-handles error.  Exit
+ *    the application on any other error.
+ */
+static skstream_t *
+sortTempReopen(
+    int                 temp_idx)
+{
+    skstream_t *stream;
+
+    stream = skTempFileOpenStream(tmpctx, temp_idx);
+    if (NULL == stream) {
+        if ((errno != EMFILE) && (errno != ENOMEM)) {
+            skAppPrintSyserror(("Error opening existing temporary file '%s'"),
+                               skTempFileGetName(tmpctx, temp_idx));
+            appExit(EXIT_FAILURE);
+        }
+    }
+    return stream;
+}
+
+/*
+ *    Close a temporary file.  Exit the application if stream was open
+ *    for write and closing fails.
+ */
+static void
+sortTempClose(
+    skstream_t         *stream)
+{
+    char errbuf[2 * PATH_MAX];
+    ssize_t rv;
+
+    rv = skStreamClose(stream);
+    switch (rv) {
+      case SKSTREAM_OK:
+      case SKSTREAM_ERR_NOT_OPEN:
+      case SKSTREAM_ERR_CLOSED:
+        skStreamDestroy(&stream);
+        return;
+      case SKSTREAM_ERR_NULL_ARGUMENT:
+        return;
+    }
+
+    skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
+    skAppPrintErr("Error closing temporary file: %s", errbuf);
+    if (skStreamGetMode(stream) == SK_IO_WRITE) {
+        appExit(EXIT_FAILURE);
+    }
+    skStreamDestroy(&stream);
+}
+
+/*
+ *    Write 'stw_size' bytes from 'stw_buf' to 'stw_stream'.  Return
+ *    'stw_size' on success and exit the appliation on error or short
+ *    write.
+ */
+#define sortTempWrite(stw_stream, stw_buf, stw_size)                    \
+    sortTempWriteHelper(stw_stream, stw_buf, stw_size, __FILE__, __LINE__)
+
+static void
+sortTempWriteHelper(
+    skstream_t         *stream,
+    const void         *buf,
+    size_t              size,
+    const char         *file_name,
+    int                 file_line)
+{
+    char errbuf[2 * PATH_MAX];
+    ssize_t rv;
+
+    rv = skStreamWrite(stream, buf, size);
+    if (rv == (ssize_t)size) {
+        return;
+    }
+    skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
+
+#if TRACEMSG_LEVEL == 0
+    (void)file_name;
+    (void)file_line;
+#else
+    if (rv >= 0) {
+        TRACEMSG(("%s:%d: Failed to write %" SK_PRIuZ " bytes:"
+                  " Short write of %" SK_PRIdZ " on '%s'",
+                  file_name, file_line, size, rv, skStreamGetPathname(stream)));
+    } else {
+        TRACEMSG(("%s:%d: Failed to write %" SK_PRIuZ " bytes: %s",
+                  file_name, file_line, size, errbuf));
+    }
+#endif
+
+    if (rv >= 0) {
+        snprintf(errbuf,sizeof(errbuf),
+                 "Short write of %" SK_PRIdZ " bytes to '%s'",
+                 rv, skStreamGetPathname(stream));
+    }
+    skAppPrintErr("Error writing to temporary file: %s", errbuf);
+    appExit(EXIT_FAILURE);
+}
+
+/*
+ *    Write the contents of 'rec_buffer' to a new temp file, where
+ *    'rec_buffer' contains 'rec_count' records of size 'rec_size'.
+ *    Fill 'tmp_idx' with the new temporary file's index.  Exit the
+ *    application on error.
+ */
+static void
+sortTempWriteBuffer(
+    int                *tmp_idx,
+    const void         *rec_buffer,
+    uint32_t            rec_size,
+    uint32_t            rec_count)
+{
+    if (skTempFileWriteBufferStream(tmpctx, tmp_idx, rec_buffer,
+                                    rec_size, rec_count))
+    {
+        skAppPrintErr("Error saving sorted buffer to temporary file: %s",
+                      strerror(errno));
+        appExit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ *    The temporary files and presorted inputs are merged with an
+ *    sk_merge_t.  The merge compares records with rwrecCompare() and,
+ *    when the first of the --fields is in the radix key, first
+ *    compares a prefix computed from that field.  Records with
+ *    identical keys are returned in the order of the sources that
+ *    hold them.
+ */
+
+/* the number of octets an IP address takes in the merge prefix: 4
+ * when the merged records are all IPv4, 16 otherwise */
+static size_t merge_ip_width = 16;
+
+/* the number of records the merge reads and writes at one time; also
+ * the number of records in each block that a group's thread passes
+ * to the main thread */
+#define MERGE_BLOCK_RECS  1024
+
+
+/*
+ *  cmp = mergeCompare(a, b, cmp_data);
+ *
+ *    Comparison function for the merge; a wrapper over
+ *    rwrecCompare().
+ */
+static int
+mergeCompare(
+    const void         *a,
+    const void         *b,
+    void        UNUSED(*cmp_data))
+{
+    return rwrecCompare(a, b);
+}
+
+
+/*
+ *  prefix = mergePrefix(rec, cmp_data);
+ *
+ *    Prefix function for the merge.  Return the first eight octets
+ *    of the value of the first of the --fields as it appears in the
+ *    radix key.
+ */
+static uint64_t
+mergePrefix(
+    const void         *rec,
+    void        UNUSED(*cmp_data))
+{
+    uint8_t key[16];
+    uint64_t prefix = 0;
+    size_t len;
+    size_t i;
+
+    len = sortKeyPutField((const rwRec*)rec, sort_fields[0], merge_ip_width,
+                          key) - key;
+    if (len > sizeof(prefix)) {
+        len = sizeof(prefix);
+    }
+    for (i = 0; i < len; ++i) {
+        prefix = (prefix << 8) | key[i];
+    }
+    if (reverse) {
+        prefix = ~prefix;
+    }
+    return prefix;
+}
+
+
+/*
+ *  merge = mergeCreate(max_sources);
+ *
+ *    Create a merge for 'max_sources' sources of nodes.  Exit the
+ *    application on failure.
+ */
+static sk_merge_t *
+mergeCreate(
+    size_t              max_sources)
+{
+    sk_merge_t *merge;
+
+    merge = skMergeCreate(node_size, max_sources, &mergeCompare, NULL);
+    if (NULL == merge) {
+        skAppPrintOutOfMemory("merge");
+        appExit(EXIT_FAILURE);
+    }
+    if (sort_key_num_fields > 0) {
+        skMergeSetPrefixFunction(merge, &mergePrefix);
+    }
+    return merge;
+}
+
+
+/*
+ *  mergeCheckError(merge, fps);
+ *
+ *    Exit the application if a read from the temporary files in
+ *    'fps', which were added to 'merge' in order, failed.
+ */
+static void
+mergeCheckError(
+    const sk_merge_t   *merge,
+    skstream_t        **fps)
+{
+    size_t source;
+    ssize_t rv;
+
+    rv = skMergeGetError(merge, &source);
+    if (rv) {
+        skStreamPrintLastErr(fps[source], rv, &skAppPrintErr);
+        appExit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ *  mergeWriteNodes(fp_intermediate, nodes, count);
+ *
+ *    Write the 'count' records in 'nodes' to the intermediate
+ *    temporary file 'fp_intermediate', or to the output file when
+ *    'fp_intermediate' is NULL.  Exit the application on a fatal
+ *    error.
+ */
+static void
+mergeWriteNodes(
+    skstream_t         *fp_intermediate,
+    const uint8_t      *nodes,
+    size_t              count)
+{
+    size_t written;
+    int rv;
+
+    if (fp_intermediate) {
+        /* write records to intermediate tmp file */
+        sortTempWrite(fp_intermediate, nodes, count * node_size);
+    } else if (sizeof(rwRec) == node_size) {
+        /* the nodes are just records; write them as a batch */
+        while (count) {
+            rv = skStreamWriteRecords(out_rwios, (const rwRec*)nodes,
+                                      count, &written);
+            if (0 == rv) {
+                break;
+            }
+            skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
+            if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                appExit(EXIT_FAILURE);
+            }
+            /* skip the record that failed */
+            ++written;
+            nodes += written * node_size;
+            count -= written;
+        }
+    } else {
+        for ( ; count > 0; --count, nodes += node_size) {
+            rv = skStreamWriteRecord(out_rwios, (const rwRec*)nodes);
+            if (0 != rv) {
+                skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
+                if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                    appExit(EXIT_FAILURE);
+                }
+            }
         }
     }
-    return stream;
 }
 
+
 /*
- *    Close a temporary file.  Exit the application if stream was open
- *    for write and closing fails.
+ *  mergeAll(merge, fp_intermediate, buf);
+ *
+ *    Read all records from 'merge' and write them as
+ *    mergeWriteNodes() does, using 'buf', which holds
+ *    MERGE_BLOCK_RECS nodes.
  */
 static void
-sortTempClose(
-    skstream_t         *stream)
+mergeAll(
+    sk_merge_t         *merge,
+    skstream_t         *fp_intermediate,
+    uint8_t            *buf)
 {
-    char errbuf[2 * PATH_MAX];
-    ssize_t rv;
-
-    rv = skStreamClose(stream);
-    switch (rv) {
-      case SKSTREAM_OK:
-      case SKSTREAM_ERR_NOT_OPEN:
-      case SKSTREAM_ERR_CLOSED:
-        skStreamDestroy(&stream);
-        return;
-      case SKSTREAM_ERR_NULL_ARGUMENT:
-        return;
-    }
+    size_t count;
 
-    skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
-    skAppPrintErr("Error closing temporary file: %s", errbuf);
-    if (skStreamGetMode(stream) == SK_IO_WRITE) {
-        appExit(EXIT_FAILURE);
+    while ((count = skMergeRead(merge, buf, MERGE_BLOCK_RECS)) > 0) {
+        mergeWriteNodes(fp_intermediate, buf, count);
     }
-    skStreamDestroy(&stream);
 }
 
+
 /*
- *    Read 'str_size' bytes from 'str_stream' into 'str_buf'.  Return
- *    'str_size' on success or 0 for other condition (end-of-file,
- *    short read, error).
+ *    When rwsort uses multiple threads to merge the temporary files,
+ *    the open files are divided into groups of consecutive files.  A
+ *    thread merges each group into a queue of blocks of records, and
+ *    the main thread merges the records from the groups.  Since ties
+ *    are broken by the position of the file within its group and by
+ *    the position of the group, the output is identical to merging
+ *    all the files at once.
  */
-#define sortTempRead(str_stream, str_buf, str_size)                     \
-    sortTempReadHelper(str_stream, str_buf, str_size, __FILE__, __LINE__)
 
-static ssize_t
-sortTempReadHelper(
-    skstream_t         *stream,
-    void               *buf,
-    size_t              size,
-    const char         *file_name,
-    int                 file_line)
+/* number of blocks in the queue of each group */
+#define MERGE_QUEUE_BLOCKS  4
+
+typedef struct merge_group_st {
+    pthread_t           thread;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+    /* the temporary files in this group */
+    skstream_t        **fps;
+    uint16_t            count;
+    /* the blocks of merged records and the number in each */
+    uint8_t            *blocks;
+    uint32_t            block_recs[MERGE_QUEUE_BLOCKS];
+    /* the number of blocks the thread has filled and the number the
+     * main thread has emptied */
+    uint64_t            produced;
+    uint64_t            consumed;
+    /* position of the next record to read in the oldest block */
+    uint32_t            read_pos;
+    /* whether the thread has merged every record in the group */
+    int                 finished;
+} merge_group_t;
+
+
+/*
+ *    Thread entry point to merge the temporary files in a group into
+ *    the group's queue of blocks.
+ */
+static void *
+mergeGroupThread(
+    void               *v_group)
 {
-    ssize_t rv;
+    merge_group_t *group = (merge_group_t*)v_group;
+    const size_t block_size = MERGE_BLOCK_RECS * node_size;
+    sk_merge_t *merge;
+    uint8_t *block;
+    size_t block_recs;
+    uint16_t i;
 
-    rv = skStreamRead(stream, buf, size);
-    if (rv == (ssize_t)size) {
-        return rv;
+    merge = mergeCreate(group->count);
+    for (i = 0; i < group->count; ++i) {
+        skMergeAddStream(merge, group->fps[i]);
     }
-#if TRACEMSG_LEVEL == 0
-    (void)file_name;
-    (void)file_line;
-#else
-    if (rv == 0) {
-        TRACEMSG(("%s:%d: Failed to read %" SK_PRIuZ " bytes: EOF on '%s'",
-                  file_name, file_line, size, skStreamGetPathname(stream)));
-    } else if (rv > 0) {
-        TRACEMSG(("%s:%d: Failed to read %" SK_PRIuZ " bytes:"
-                  " Short read of %" SK_PRIdZ " on '%s'",
-                  file_name, file_line, size, rv, skStreamGetPathname(stream)));
-    } else {
-        char errbuf[2 * PATH_MAX];
 
-        skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
-        TRACEMSG(("%s:%d: Failed to read %" SK_PRIuZ " bytes: %s",
-                  file_name, file_line, size, errbuf));
-    }
-#endif
-    return 0;
+    do {
+        /* wait for an empty block */
+        pthread_mutex_lock(&group->mutex);
+        while (group->produced - group->consumed == MERGE_QUEUE_BLOCKS) {
+            pthread_cond_wait(&group->cond, &group->mutex);
+        }
+        pthread_mutex_unlock(&group->mutex);
+        block = (group->blocks
+                 + block_size * (group->produced % MERGE_QUEUE_BLOCKS));
+
+        block_recs = skMergeRead(merge, block, MERGE_BLOCK_RECS);
+
+        /* hand the block to the main thread */
+        pthread_mutex_lock(&group->mutex);
+        if (block_recs) {
+            group->block_recs[group->produced % MERGE_QUEUE_BLOCKS]
+                = (uint32_t)block_recs;
+            ++group->produced;
+        }
+        if (block_recs < MERGE_BLOCK_RECS) {
+            group->finished = 1;
+        }
+        pthread_cond_signal(&group->cond);
+        pthread_mutex_unlock(&group->mutex);
+    } while (MERGE_BLOCK_RECS == block_recs);
+
+    mergeCheckError(merge, group->fps);
+    skMergeDestroy(&merge);
+    return NULL;
 }
 
 
 /*
- *    Write 'stw_size' bytes from 'stw_buf' to 'stw_stream'.  Return
- *    'stw_size' on success and exit the appliation on error or short
- *    write.
+ *  status = mergeGroupRead(v_group, buf);
+ *
+ *    Read function for the merge of the groups.  Copy the next
+ *    merged record from the group 'v_group' into 'buf', waiting for
+ *    the group's thread to provide it.  Return 1 if a record was
+ *    copied, or 0 if the group has no more records.
  */
-#define sortTempWrite(stw_stream, stw_buf, stw_size)                    \
-    sortTempWriteHelper(stw_stream, stw_buf, stw_size, __FILE__, __LINE__)
-
-static void
-sortTempWriteHelper(
-    skstream_t         *stream,
-    const void         *buf,
-    size_t              size,
-    const char         *file_name,
-    int                 file_line)
+static int
+mergeGroupRead(
+    void               *v_group,
+    void               *buf)
 {
-    char errbuf[2 * PATH_MAX];
-    ssize_t rv;
-
-    rv = skStreamWrite(stream, buf, size);
-    if (rv == (ssize_t)size) {
-        return;
-    }
-    skStreamLastErrMessage(stream, rv, errbuf, sizeof(errbuf));
-
-#if TRACEMSG_LEVEL == 0
-    (void)file_name;
-    (void)file_line;
-#else
-    if (rv >= 0) {
-        TRACEMSG(("%s:%d: Failed to write %" SK_PRIuZ " bytes:"
-                  " Short write of %" SK_PRIdZ " on '%s'",
-                  file_name, file_line, size, rv, skStreamGetPathname(stream)));
-    } else {
-        TRACEMSG(("%s:%d: Failed to write %" SK_PRIuZ " bytes: %s",
-                  file_name, file_line, size, errbuf));
+    merge_group_t *group = (merge_group_t*)v_group;
+    unsigned int idx;
+
+    if (0 == group->read_pos) {
+        /* wait for a full block */
+        pthread_mutex_lock(&group->mutex);
+        while (group->produced == group->consumed && !group->finished) {
+            pthread_cond_wait(&group->cond, &group->mutex);
+        }
+        if (group->produced == group->consumed) {
+            pthread_mutex_unlock(&group->mutex);
+            return 0;
+        }
+        pthread_mutex_unlock(&group->mutex);
     }
-#endif
 
-    if (rv >= 0) {
-        snprintf(errbuf,sizeof(errbuf),
-                 "Short write of %" SK_PRIdZ " bytes to '%s'",
-                 rv, skStreamGetPathname(stream));
+    idx = group->consumed % MERGE_QUEUE_BLOCKS;
+    memcpy(buf, (group->blocks + MERGE_BLOCK_RECS * node_size * idx
+                 + group->read_pos * node_size), node_size);
+    if (++group->read_pos == group->block_recs[idx]) {
+        /* return the empty block to the group's thread */
+        pthread_mutex_lock(&group->mutex);
+        ++group->consumed;
+        group->read_pos = 0;
+        pthread_cond_signal(&group->cond);
+        pthread_mutex_unlock(&group->mutex);
     }
-    skAppPrintErr("Error writing to temporary file: %s", errbuf);
-    appExit(EXIT_FAILURE);
+    return 1;
 }
 
+
 /*
- *    Write the contents of 'rec_buffer' to a new temp file, where
- *    'rec_buffer' contains 'rec_count' records of size 'rec_size'.
- *    Fill 'tmp_idx' with the new temporary file's index.  Exit the
- *    application on error.
+ *  mergeGroups(fps, open_count, group_count, fp_intermediate, buf);
+ *
+ *    Merge the 'open_count' temporary files in 'fps' by dividing
+ *    them into 'group_count' groups that are merged by separate
+ *    threads.  Write the records as mergeAll() does.
  */
 static void
-sortTempWriteBuffer(
-    int                *tmp_idx,
-    const void         *rec_buffer,
-    uint32_t            rec_size,
-    uint32_t            rec_count)
+mergeGroups(
+    skstream_t        **fps,
+    uint16_t            open_count,
+    uint16_t            group_count,
+    skstream_t         *fp_intermediate,
+    uint8_t            *buf)
 {
-    if (skTempFileWriteBufferStream(tmpctx, tmp_idx, rec_buffer,
-                                    rec_size, rec_count))
-    {
-        skAppPrintErr("Error saving sorted buffer to temporary file: %s",
-                      strerror(errno));
-        appExit(EXIT_FAILURE);
+    merge_group_t groups[RWSORT_THREADS_MAX];
+    sk_merge_t *merge;
+    uint16_t first;
+    uint16_t g;
+
+    assert(group_count <= RWSORT_THREADS_MAX);
+    assert(group_count <= open_count);
+
+    TRACEMSG((("Merging %" PRIu16 " temporary files in %" PRIu16 " groups"),
+              open_count, group_count));
+
+    merge = mergeCreate(group_count);
+
+    memset(groups, 0, sizeof(groups));
+    for (g = 0, first = 0; g < group_count; ++g) {
+        groups[g].fps = fps + first;
+        groups[g].count = (open_count - first) / (group_count - g);
+        first += groups[g].count;
+        groups[g].blocks = (uint8_t*)malloc(MERGE_QUEUE_BLOCKS
+                                            * MERGE_BLOCK_RECS * node_size);
+        if (NULL == groups[g].blocks) {
+            skAppPrintOutOfMemory("merge buffer");
+            appExit(EXIT_FAILURE);
+        }
+        pthread_mutex_init(&groups[g].mutex, NULL);
+        pthread_cond_init(&groups[g].cond, NULL);
+        if (pthread_create(&groups[g].thread, NULL, &mergeGroupThread,
+                           &groups[g]))
+        {
+            skAppPrintErr("Unable to create merge thread");
+            appExit(EXIT_FAILURE);
+        }
+        skMergeAddSource(merge, &mergeGroupRead, &groups[g]);
+    }
+
+    mergeAll(merge, fp_intermediate, buf);
+
+    for (g = 0; g < group_count; ++g) {
+        pthread_join(groups[g].thread, NULL);
+        pthread_mutex_destroy(&groups[g].mutex);
+        pthread_cond_destroy(&groups[g].cond);
+        free(groups[g].blocks);
     }
+    skMergeDestroy(&merge);
 }
 
 
@@ -627,49 +1871,59 @@ sortTempWriteBuffer(
  *
  *    Merge the temporary files numbered from 0 to 'temp_file_idx'
  *    inclusive into the output file 'out_ios', maintaining sorted
- *    order.  Exits the application if an error occurs.
+ *    order.  Records with identical keys are written in the order of
+ *    the temporary files that hold them, so the output does not
+ *    depend on how the records were divided among the files.  Exits
+ *    the application if an error occurs.
  */
 static void
 mergeFiles(
     int                 temp_file_idx)
 {
     skstream_t *fps[MAX_MERGE_FILES];
-    uint8_t recs[MAX_MERGE_FILES][MAX_NODE_SIZE];
-    int j;
+    uint8_t *buf;
+    int *run_list;
+    int *runs;
+    int run_count;
+    int j, k;
     uint16_t open_count;
+    uint16_t group_count;
     uint16_t i;
-    uint16_t *top_heap;
-    uint16_t lowest;
-    int tmp_idx_a;
-    int tmp_idx_b;
     skstream_t *fp_intermediate = NULL;
     int tmp_idx_intermediate;
     int opened_all_temps = 0;
-    skheap_t *heap;
-    uint32_t heap_count;
-    int rv;
+    sk_merge_t *merge;
 
     TRACEMSG(("Merging #%d through #%d into '%s'",
               0, temp_file_idx, skStreamGetPathname(out_rwios)));
 
-    heap = skHeapCreate2(compHeapNodes, MAX_MERGE_FILES, sizeof(uint16_t),
-                         NULL, recs);
-    if (NULL == heap) {
-        skAppPrintOutOfMemory("heap");
+    /* the sorted buffers determine the width of IPs in the prefix */
+    merge_ip_width = (sort_saw_ipv6 ? 16 : 4);
+
+    merge = mergeCreate(MAX_MERGE_FILES);
+    buf = (uint8_t*)malloc(MERGE_BLOCK_RECS * node_size);
+    if (NULL == buf) {
+        skAppPrintOutOfMemory("merge buffer");
         appExit(EXIT_FAILURE);
     }
 
-    /* the index of the first temp file to the merge */
-    tmp_idx_a = 0;
+    /* the indexes of the temp files to merge, in the order in which
+     * their records were read.  When a pass cannot open every file,
+     * the files it merged are replaced by its intermediate file. */
+    run_count = temp_file_idx + 1;
+    run_list = (int*)malloc(run_count * sizeof(int));
+    if (NULL == run_list) {
+        skAppPrintOutOfMemory("temporary file list");
+        appExit(EXIT_FAILURE);
+    }
+    for (j = 0; j < run_count; ++j) {
+        run_list[j] = j;
+    }
+    runs = run_list;
 
     /* This loop repeats as long as we haven't read all of the temp
      * files generated in the sorting stage. */
     do {
-        assert(SKHEAP_ERR_EMPTY==skHeapPeekTop(heap,(skheapnode_t*)&top_heap));
-
-        /* the index of the last temp file to merge */
-        tmp_idx_b = temp_file_idx;
-
         /* open an intermediate temp file.  The merge-sort will have
          * to write records here if there are not enough file handles
          * available to open all the existing tempoary files. */
@@ -679,134 +1933,59 @@ mergeFiles(
         open_count = 0;
 
         /* Attempt to open up to MAX_MERGE_FILES, though we an open
-         * may fail due to lack of resources (EMFILE or ENOMEM) */
-        for (j = tmp_idx_a; j <= tmp_idx_b; ++j) {
-            fps[open_count] = sortTempReopen(j);
+         * may fail due to lack of resources (EMFILE or ENOMEM).  On
+         * exit from the loop, 'j' is the number of files that were
+         * opened. */
+        for (j = 0; j < run_count; ++j) {
+            fps[open_count] = sortTempReopen(runs[j]);
             if (NULL == fps[open_count]) {
                 if (0 == open_count) {
                     skAppPrintErr("Unable to open any temporary files");
                     appExit(EXIT_FAILURE);
                 }
-                /* We cannot open any more files.  Rewind counter by
-                 * one to catch this file on the next merge. */
-                assert(j > 0);
-                tmp_idx_b = j - 1;
-                TRACEMSG(
-                    ("EMFILE limit hit--merging #%d through #%d into #%d: %s",
-                     tmp_idx_a, tmp_idx_b, tmp_idx_intermediate,
-                     strerror(errno)));
+                /* We cannot open any more files.  This file is
+                 * handled on the next merge. */
+                TRACEMSG(("EMFILE limit hit--merging %d files into #%d: %s",
+                          j, tmp_idx_intermediate, strerror(errno)));
                 break;
             }
-
-            /* read the first record */
-            if (sortTempRead(fps[open_count], recs[open_count], node_size)) {
-                /* insert the file index into the heap */
-                skHeapInsert(heap, &open_count);
-                ++open_count;
-                if (open_count == MAX_MERGE_FILES) {
-                    /* We've reached the limit for this pass.  Set
-                     * tmp_idx_b to the file we just opened. */
-                    tmp_idx_b = j;
-                    TRACEMSG((("MAX_MERGE_FILES limit hit--"
-                               "merging #%d through #%d to #%d"),
-                              tmp_idx_a, tmp_idx_b, tmp_idx_intermediate));
-                    break;
-                }
-            } else {
-                if (skStreamGetLastReturnValue(fps[open_count]) != 0) {
-                    skAppPrintSyserror(("Error reading first record from"
-                                        " temporary file '%s'"),
-                                       skTempFileGetName(tmpctx, j));
-                    appExit(EXIT_FAILURE);
-                }
-                TRACEMSG(("Ignoring empty temporary file '%s'",
-                          skTempFileGetName(tmpctx, j)));
-                skStreamDestroy(&fps[open_count]);
+            ++open_count;
+            if (open_count == MAX_MERGE_FILES) {
+                /* We've reached the limit for this pass. */
+                ++j;
+                TRACEMSG((("MAX_MERGE_FILES limit hit--"
+                           "merging %d files to #%d"),
+                          j, tmp_idx_intermediate));
+                break;
             }
         }
 
         /* Here, we check to see if we've opened all temp files.  If
          * so, set a flag so we write data to final destination and
          * break out of the loop after we're done. */
-        if (tmp_idx_b == temp_file_idx) {
+        if (j == run_count) {
             opened_all_temps = 1;
             /* no longer need the intermediate temp file */
             sortTempClose(fp_intermediate);
             fp_intermediate = NULL;
-        } else {
-            /* we could not open all temp files, so merge all opened
-             * temp files into the intermediate file.  Add the
-             * intermediate file to the list of files to merge */
-            temp_file_idx = tmp_idx_intermediate;
         }
 
         TRACEMSG((("Merging %" PRIu16 " temporary files"), open_count));
 
-        heap_count = skHeapGetNumberEntries(heap);
-        assert(heap_count == open_count);
-
-        /* exit this while() once we are only processing a single
-         * file */
-        while (heap_count > 1) {
-            /* entry at the top of the heap has the lowest key */
-            skHeapPeekTop(heap, (skheapnode_t*)&top_heap);
-            lowest = *top_heap;
-
-            /* write the lowest record */
-            if (fp_intermediate) {
-                /* write record to intermediate tmp file */
-                sortTempWrite(fp_intermediate, recs[lowest], node_size);
-            } else {
-                /* we successfully opened all (remaining) temp files,
-                 * write to record to the final destination */
-                rv = skStreamWriteRecord(out_rwios,(rwRec*)recs[lowest]);
-                if (0 != rv) {
-                    skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
-                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                        appExit(EXIT_FAILURE);
-                    }
-                }
-            }
-
-            /* replace the record we just wrote */
-            if (sortTempRead(fps[lowest], recs[lowest], node_size)) {
-                /* read was successful.  "insert" the new entry into
-                 * the heap (which has same value as old entry). */
-                skHeapReplaceTop(heap, &lowest, NULL);
-            } else {
-                /* no more data for this file; remove it from the
-                 * heap */
-                skHeapExtractTop(heap, NULL);
-                --heap_count;
-                TRACEMSG(("Finished reading file #%u; %u files remain",
-                          tmp_idx_a + lowest, heap_count));
-            }
-        }
-
-        /* get index of the remaining file */
-        skHeapExtractTop(heap, &lowest);
-        assert(SKHEAP_ERR_EMPTY==skHeapPeekTop(heap,(skheapnode_t*)&top_heap));
-
-        /* read records from the remaining file */
-        if (fp_intermediate) {
-            do {
-                sortTempWrite(fp_intermediate, recs[lowest], node_size);
-            } while (sortTempRead(fps[lowest], recs[lowest], node_size));
+        group_count = ((thread_count < open_count / 2u)
+                       ? thread_count : open_count / 2u);
+        if (group_count > 1) {
+            mergeGroups(fps, open_count, group_count, fp_intermediate, buf);
         } else {
-            do {
-                rv = skStreamWriteRecord(out_rwios, (rwRec*)recs[lowest]);
-                if (0 != rv) {
-                    skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
-                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                        appExit(EXIT_FAILURE);
-                    }
-                }
-            } while (sortTempRead(fps[lowest], recs[lowest], node_size));
+            skMergeReset(merge);
+            for (i = 0; i < open_count; ++i) {
+                skMergeAddStream(merge, fps[i]);
+            }
+            mergeAll(merge, fp_intermediate, buf);
+            mergeCheckError(merge, fps);
         }
 
-        TRACEMSG(("Finished reading file #%u; 0 files remain", lowest));
-        TRACEMSG((("Finished processing #%d through #%d"),
-                  tmp_idx_a, tmp_idx_b));
+        TRACEMSG((("Finished processing %d temporary files"), j));
 
         /* Close all open temp files */
         for (i = 0; i < open_count; ++i) {
@@ -814,22 +1993,41 @@ mergeFiles(
         }
         /* Delete all temp files we opened (or attempted to open) this
          * time */
-        for (j = tmp_idx_a; j <= tmp_idx_b; ++j) {
-            skTempFileRemove(tmpctx, j);
+        for (k = 0; k < j; ++k) {
+            skTempFileRemove(tmpctx, runs[k]);
         }
 
-        /* Close the intermediate temp file. */
+        /* Close the intermediate temp file, and have it take the
+         * place of the files it holds */
         if (fp_intermediate) {
             sortTempClose(fp_intermediate);
             fp_intermediate = NULL;
+            runs += j - 1;
+            run_count -= j - 1;
+            runs[0] = tmp_idx_intermediate;
         }
 
-        /* Start the next merge with the next input temp file */
-        tmp_idx_a = tmp_idx_b + 1;
-
     } while (!opened_all_temps);
 
-    skHeapFree(heap);
+    free(run_list);
+    free(buf);
+    skMergeDestroy(&merge);
+}
+
+
+/*
+ *  status = presortedRead(v_rwios, buf);
+ *
+ *    Read function for the merge of presorted inputs.  Read a record
+ *    from the stream 'v_rwios' and its key into 'buf' as
+ *    fillRecordAndKey() does.
+ */
+static int
+presortedRead(
+    void               *v_rwios,
+    void               *buf)
+{
+    return fillRecordAndKey((skstream_t*)v_rwios, (uint8_t*)buf);
 }
 
 
@@ -856,25 +2054,26 @@ sortPresorted(
     void)
 {
     skstream_t *rwios[MAX_MERGE_FILES];
-    uint8_t recs[MAX_MERGE_FILES][MAX_NODE_SIZE];
+    uint8_t *buf;
     uint16_t i;
     uint16_t open_count;
-    uint16_t *top_heap;
-    uint16_t lowest;
     skstream_t *fp_intermediate = NULL;
     int temp_file_idx = -1;
     int opened_all_inputs = 0;
-    skheap_t *heap;
-    uint32_t heap_count;
+    sk_merge_t *merge;
     int rv;
 
     memset(rwios, 0, sizeof(rwios));
-    memset(recs, 0, sizeof(recs));
 
-    heap = skHeapCreate2(compHeapNodes, MAX_MERGE_FILES, sizeof(uint16_t),
-                         NULL, recs);
-    if (NULL == heap) {
-        skAppPrintOutOfMemory("heap");
+    /* nothing is known about the inputs, so compare IPs as IPv6 */
+    merge_ip_width = 16;
+    /* any temporary files hold a mix of the inputs */
+    sort_saw_ipv6 = 1;
+
+    merge = mergeCreate(MAX_MERGE_FILES);
+    buf = (uint8_t*)malloc(MERGE_BLOCK_RECS * node_size);
+    if (NULL == buf) {
+        skAppPrintOutOfMemory("merge buffer");
         appExit(EXIT_FAILURE);
     }
 
@@ -934,79 +2133,15 @@ sortPresorted(
             skAbortBadCase(rv);
         }
 
-        /* Read the first record from each file into the work buffer */
-        for (i = 0; i < open_count; ++i) {
-            if (fillRecordAndKey(rwios[i], recs[i])) {
-                /* insert the file index into the heap */
-                skHeapInsert(heap, &i);
-            }
-        }
-
-        heap_count = skHeapGetNumberEntries(heap);
-
-        TRACEMSG((("Merging %" PRIu32 " of %" PRIu16 " open presorted files"),
-                  heap_count, open_count));
-
-        /* exit this while() once we are only processing a single
-         * file */
-        while (heap_count > 1) {
-            /* entry at the top of the heap has the lowest key */
-            skHeapPeekTop(heap, (skheapnode_t*)&top_heap);
-            lowest = *top_heap;
-
-            /* write the lowest record */
-            if (fp_intermediate) {
-                /* we are using the intermediate temp file, so
-                 * write the record there. */
-                sortTempWrite(fp_intermediate, recs[lowest], node_size);
-            } else {
-                /* we are not using any temp files, write the
-                 * record to the final destination */
-                rv = skStreamWriteRecord(out_rwios, (rwRec*)recs[lowest]);
-                if (0 != rv) {
-                    skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
-                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                        appExit(EXIT_FAILURE);
-                    }
-                }
-            }
-
-            /* replace the record we just wrote */
-            if (fillRecordAndKey(rwios[lowest], recs[lowest])) {
-                /* read was successful.  "insert" the new entry into
-                 * the heap (which has same value as old entry). */
-                skHeapReplaceTop(heap, &lowest, NULL);
-            } else {
-                /* no more data for this file; remove it from the
-                 * heap */
-                skHeapExtractTop(heap, NULL);
-                --heap_count;
-                TRACEMSG(("Finished reading records from file #%u;"
-                          " %" PRIu32 " files remain",
-                          lowest, heap_count));
-            }
-        }
+        TRACEMSG((("Merging %" PRIu16 " open presorted files"), open_count));
 
-        /* read records from the remaining file */
-        if (SKHEAP_OK == skHeapExtractTop(heap, &lowest)) {
-            if (fp_intermediate) {
-                do {
-                    sortTempWrite(fp_intermediate, recs[lowest], node_size);
-                } while (fillRecordAndKey(rwios[lowest], recs[lowest]));
-            } else {
-                do {
-                    rv = skStreamWriteRecord(out_rwios, (rwRec*)recs[lowest]);
-                    if (0 != rv) {
-                        skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
-                        if (SKSTREAM_ERROR_IS_FATAL(rv)) {
-                            appExit(EXIT_FAILURE);
-                        }
-                    }
-                } while (fillRecordAndKey(rwios[lowest], recs[lowest]));
-            }
-            TRACEMSG(("Finished reading records from file #%u; 0 files remain",
-                      lowest));
+        /* merge the files into the intermediate temp file or, when
+         * there is none, the final destination */
+        skMergeReset(merge);
+        for (i = 0; i < open_count; ++i) {
+            skMergeAddSource(merge, &presortedRead, rwios[i]);
         }
+        mergeAll(merge, fp_intermediate, buf);
 
         /* Close the input files that we processed this time. */
         for (i = 0; i < open_count; ++i) {
@@ -1020,7 +2155,8 @@ sortPresorted(
         }
     } while (!opened_all_inputs);
 
-    skHeapFree(heap);
+    free(buf);
+    skMergeDestroy(&merge);
 
     /* If any temporary files were written, we now have to merge-sort
      * them */
@@ -1028,6 +2164,87 @@ sortPresorted(
 }
 
 
+/*
+ *    When rwsort uses multiple threads and the records do not fit
+ *    into the sort buffer, the buffer is divided in half once the
+ *    first temporary file has been written.  A thread sorts one half
+ *    and writes it to a temporary file while the main thread reads
+ *    records into the other half.
+ */
+typedef struct sort_spill_st {
+    pthread_t           thread;
+    uint8_t            *buffer;
+    uint32_t            count;
+    /* index of the most recent temporary file, or -1 if none */
+    int                 temp_idx;
+    /* whether 'thread' has been started and not joined */
+    int                 running;
+} sort_spill_t;
+
+
+/*
+ *    Thread entry point to sort the records in a sort_spill_t and
+ *    write them to a new temporary file.
+ */
+static void *
+sortSpillThread(
+    void               *v_spill)
+{
+    sort_spill_t *spill = (sort_spill_t*)v_spill;
+
+    TRACEMSG(("Sorting %" PRIu32 " records...", spill->count));
+    sortBuffer(spill->buffer, spill->count);
+    TRACEMSG(("Sorting %" PRIu32 " records...done", spill->count));
+
+    sortTempWriteBuffer(&spill->temp_idx, spill->buffer,
+                        node_size, spill->count);
+    return NULL;
+}
+
+
+/*
+ *  sortSpillWait(spill);
+ *
+ *    Wait for the thread started by sortSpillStart(), if any, to
+ *    finish.
+ */
+static void
+sortSpillWait(
+    sort_spill_t       *spill)
+{
+    if (spill->running) {
+        pthread_join(spill->thread, NULL);
+        spill->running = 0;
+    }
+}
+
+
+/*
+ *  sortSpillStart(spill, buffer, count);
+ *
+ *    Wait for the previous use of 'spill' to finish, then start a
+ *    thread to sort the 'count' records in 'buffer' and write them
+ *    to a temporary file.  If the thread cannot be started, do the
+ *    work in the calling thread.
+ */
+static void
+sortSpillStart(
+    sort_spill_t       *spill,
+    uint8_t            *buffer,
+    uint32_t            count)
+{
+    sortSpillWait(spill);
+
+    spill->buffer = buffer;
+    spill->count = count;
+    if (pthread_create(&spill->thread, NULL, &sortSpillThread, spill)) {
+        sortSpillThread(spill);
+    } else {
+        spill->running = 1;
+    }
+}
+
+
 /*
  *  int = sortRandom();
  *
@@ -1050,17 +2267,30 @@ sortRandom(
     int temp_file_idx = -1;
     skstream_t *input_rwios;        /* input stream */
     uint8_t *record_buffer = NULL;  /* Region of memory for records */
-    uint8_t *cur_node = NULL;       /* Ptr into record_buffer */
+    uint8_t *fill_buffer = NULL;    /* Part of record_buffer being filled */
+    uint8_t *cur_node = NULL;       /* Ptr into fill_buffer */
+    sort_spill_t spill;             /* Thread to sort and write a buffer */
+    int split_buffer = 0;           /* Whether buffer is in two halves */
     uint32_t buffer_max_recs;       /* max buffer size (in number of recs) */
     uint32_t buffer_recs;           /* current buffer size (# records) */
     uint32_t buffer_chunk_recs;     /* how to grow from current to max buf */
     uint32_t num_chunks;            /* how quickly to grow buffer */
     uint32_t record_count = 0;      /* Number of records read */
+    uint32_t count;
+    size_t num_written;
     int rv;
 
     /* Determine the maximum number of records that will fit into the
-     * buffer if it grows the maximum size */
-    buffer_max_recs = sort_buffer_size / node_size;
+     * buffer if it grows the maximum size.  When the radix sort is
+     * used, each record also needs two entries in the key arrays. */
+    sortKeyInit();
+    if (sort_key_num_fields) {
+        buffer_max_recs = (sort_buffer_size
+                           / (node_size + 2 * SORT_KEY_ENTRY_SIZE(
+                                  sort_key_max_width)));
+    } else {
+        buffer_max_recs = sort_buffer_size / node_size;
+    }
     TRACEMSG((("sort_buffer_size = %" PRIu64
                "\nnode_size = %" PRIu32
                "\nbuffer_max_recs = %" PRIu32),
@@ -1111,12 +2341,16 @@ sortRandom(
         appExit(EXIT_FAILURE);
     }
 
+    memset(&spill, 0, sizeof(spill));
+    spill.temp_idx = -1;
+
     record_count = 0;
-    cur_node = record_buffer;
+    fill_buffer = cur_node = record_buffer;
     while (input_rwios != NULL) {
-        /* read record */
-        rv = fillRecordAndKey(input_rwios, cur_node);
-        if (rv == 0) {
+        /* read records into the remainder of the buffer */
+        count = fillRecordsAndKeys(input_rwios, cur_node,
+                                   buffer_recs - record_count);
+        if (count == 0) {
             /* close current and open next */
             skStreamDestroy(&input_rwios);
             rv = appNextInput(&input_rwios);
@@ -1129,8 +2363,8 @@ sortRandom(
             continue;
         }
 
-        ++record_count;
-        cur_node += node_size;
+        record_count += count;
+        cur_node += count * node_size;
 
         if (record_count == buffer_recs) {
             /* Filled the current buffer */
@@ -1155,6 +2389,7 @@ sortRandom(
                 if (record_buffer) {
                     /* Success, make certain cur_node points into the
                      * new buffer */
+                    fill_buffer = record_buffer;
                     cur_node = (record_buffer + (record_count * node_size));
                 } else {
                     /* Unable to grow it */
@@ -1166,10 +2401,10 @@ sortRandom(
 
             /* Either buffer at maximum size or attempt to grow it
              * failed. */
-            if (record_count == buffer_max_recs) {
+            if (record_count == buffer_max_recs && thread_count < 2) {
                 /* Sort */
                 TRACEMSG(("Sorting %" PRIu32 " records...", record_count));
-                skQSort(record_buffer, record_count, node_size, &rwrecCompare);
+                sortBuffer(record_buffer, record_count);
                 TRACEMSG(("Sorting %" PRIu32 " records...done", record_count));
 
                 /* Write to temp file */
@@ -1179,19 +2414,50 @@ sortRandom(
                 /* Reset record buffer to 'empty' */
                 record_count = 0;
                 cur_node = record_buffer;
+
+            } else if (record_count == buffer_max_recs) {
+                /* Sort and write the records in the background */
+                sortSpillStart(&spill, fill_buffer, record_count);
+
+                if (!split_buffer) {
+                    /* This is the first temp file and it uses the
+                     * entire buffer.  Wait for it, then divide the
+                     * buffer in half */
+                    sortSpillWait(&spill);
+                    split_buffer = 1;
+                    buffer_max_recs /= 2;
+                    buffer_recs = buffer_max_recs;
+                    fill_buffer = record_buffer;
+                    TRACEMSG((("Dividing buffer into halves of %" PRIu32
+                               " records"), buffer_max_recs));
+                } else if (fill_buffer == record_buffer) {
+                    fill_buffer = record_buffer + buffer_max_recs * node_size;
+                } else {
+                    fill_buffer = record_buffer;
+                }
+
+                /* Reset record buffer to 'empty' */
+                record_count = 0;
+                cur_node = fill_buffer;
             }
         }
     }
 
+    /* Wait for any records being written in the background */
+    sortSpillWait(&spill);
+    if (spill.temp_idx >= 0) {
+        temp_file_idx = spill.temp_idx;
+    }
+
     /* Sort (and maybe store) last batch of records */
     if (record_count > 0) {
         TRACEMSG(("Sorting %" PRIu32 " records...", record_count));
-        skQSort(record_buffer, record_count, node_size, &rwrecCompare);
+        sortBuffer(fill_buffer, record_count);
         TRACEMSG(("Sorting %" PRIu32 " records...done", record_count));
 
         if (temp_file_idx >= 0) {
             /* Write last batch to temp file */
-            sortTempWriteBuffer(&temp_file_idx, record_buffer,
+            sortTempWriteBuffer(&temp_file_idx, fill_buffer,
                                 node_size, record_count);
         }
     }
@@ -1204,18 +2470,36 @@ sortRandom(
 
         TRACEMSG((("Writing %" PRIu32 " records to '%s'"),
                   record_count, skStreamGetPathname(out_rwios)));
-        for (c = 0, cur_node = record_buffer;
-             c < record_count;
-             ++c, cur_node += node_size)
-        {
-            rv = skStreamWriteRecord(out_rwios, (rwRec*)cur_node);
-            if (0 != rv) {
+        if (sizeof(rwRec) == node_size) {
+            /* the nodes are just records; write them in batches,
+             * skipping any record that cannot be written */
+            for (c = 0; c < record_count; c += num_written + 1) {
+                rv = skStreamWriteRecords(out_rwios,
+                                          (rwRec*)record_buffer + c,
+                                          record_count - c, &num_written);
+                if (0 == rv) {
+                    break;
+                }
                 skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
                 if (SKSTREAM_ERROR_IS_FATAL(rv)) {
                     free(record_buffer);
                     appExit(EXIT_FAILURE);
                 }
             }
+        } else {
+            for (c = 0, cur_node = record_buffer;
+                 c < record_count;
+                 ++c, cur_node += node_size)
+            {
+                rv = skStreamWriteRecord(out_rwios, (rwRec*)cur_node);
+                if (0 != rv) {
+                    skStreamPrintLastErr(out_rwios, rv, &skAppPrintErr);
+                    if (SKSTREAM_ERROR_IS_FATAL(rv)) {
+                        free(record_buffer);
+                        appExit(EXIT_FAILURE);
+                    }
+                }
+            }
         }
     }
     /* else a merge sort is required; which gets invoked from main() */
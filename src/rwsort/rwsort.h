@@ -126,6 +126,19 @@ RCSIDENTVAR(rcsID_RWSORT_H, "$SiLK: rwsort.h b7b8edebba12 2015-01-05 18:05:21Z m
  */
 #define MAX_NODE_SIZE  (256 + SK_MAX_RECORD_SIZE)
 
+/*
+ *    When plug-ins provide key fields, the maximum number of records
+ *    to read from an input stream in a single call to
+ *    skStreamReadRecords() before copying them into the nodes.
+ */
+#define SORT_READ_COUNT  256
+
+/* environment variable that determines number of threads */
+#define RWSORT_THREADS_ENVAR  "SILK_RWSORT_THREADS"
+
+/* maximum number of threads the user may request */
+#define RWSORT_THREADS_MAX  64
+
 /* for key fields that come from plug-ins, this struct will hold
  * information about a single field */
 typedef struct key_field_st {
@@ -176,6 +189,9 @@ extern int presorted_input;
 /* maximum amount of RAM to attempt to allocate */
 extern uint64_t sort_buffer_size;
 
+/* number of threads to use for sorting and merging */
+extern uint32_t thread_count;
+
 
 void
 appExit(
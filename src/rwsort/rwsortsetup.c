@@ -137,7 +137,9 @@ typedef enum {
     OPT_OUTPUT_PATH,
     OPT_PLUGIN,
     OPT_PRESORTED_INPUT,
-    OPT_SORT_BUFFER_SIZE
+    OPT_SORT_BUFFER_SIZE,
+    OPT_MEMORY_LIMIT,
+    OPT_THREADS
 } appOptionsEnum;
 
 static struct option appOptions[] = {
@@ -149,6 +151,8 @@ static struct option appOptions[] = {
     {"plugin",              REQUIRED_ARG, 0, OPT_PLUGIN},
     {"presorted-input",     NO_ARG,       0, OPT_PRESORTED_INPUT},
     {"sort-buffer-size",    REQUIRED_ARG, 0, OPT_SORT_BUFFER_SIZE},
+    {"memory-limit",        REQUIRED_ARG, 0, OPT_MEMORY_LIMIT},
+    {"threads",             REQUIRED_ARG, 0, OPT_THREADS},
     {0,0,0,0}               /* sentinel entry */
 };
 
@@ -165,6 +169,10 @@ static const char *appHelp[] = {
     ("Assume input has been presorted using\n"
      "\trwsort invoked with the exact same --fields value. Def. No"),
     NULL, /* generated dynamically */
+    ("Alias for --sort-buffer-size, matching the switch\n"
+     "\tthat limits the memory of rwuniq and rwstats"),
+    ("Sort and merge using this number of threads.\n"
+     "\tDef. $" RWSORT_THREADS_ENVAR " or 1"),
     (char *)NULL
 };
 
@@ -372,6 +380,19 @@ appSetup(
         appExit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    {
+        char *env;
+        uint32_t tc;
+
+        env = getenv(RWSORT_THREADS_ENVAR);
+        if (env && env[0]) {
+            if (skStringParseUint32(&tc, env, 1, RWSORT_THREADS_MAX) == 0) {
+                thread_count = tc;
+            }
+        }
+    }
+
     /* try to load hard-coded plugins */
     for (j = 0; app_static_plugins[j].name; ++j) {
         skPluginAddAsPlugin(app_static_plugins[j].name,
@@ -391,6 +412,11 @@ appSetup(
      * to resolve flowtype and sensor from input file names */
     sksiteConfigure(0);
 
+    /* do not use threads when a plug-in doesn't support them */
+    if ((thread_count > 1) && !skPluginIsThreadSafe()) {
+        thread_count = 1;
+    }
+
     /* create the --fields */
     if (createStringmaps()) {
         appExit(EXIT_FAILURE);
@@ -528,6 +554,7 @@ appOptionsHandler(
         break;
 
       case OPT_SORT_BUFFER_SIZE:
+      case OPT_MEMORY_LIMIT:
         rv = skStringParseHumanUint64(&sort_buffer_size, opt_arg,
                                       SK_HUMAN_NORMAL);
         if (rv) {
@@ -543,6 +570,14 @@ appOptionsHandler(
             return 1;
         }
         break;
+
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1,
+                                 RWSORT_THREADS_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
     }
 
     return 0;                     /* OK */
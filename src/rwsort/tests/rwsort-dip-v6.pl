@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: fb2abc3c8b7ec61c442412d2906672c4
+# MD5: 0a653c65087022b2eaf752092f46ed36
 # TEST: ./rwsort --fields=dip ../../tests/data-v6.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little
 
 use strict;
@@ -11,6 +11,6 @@ my %file;
 $file{v6data} = get_data_or_exit77('v6data');
 check_features(qw(ipv6));
 my $cmd = "$rwsort --fields=dip $file{v6data} | $rwcat --compression-method=none --byte-order=little";
-my $md5 = "fb2abc3c8b7ec61c442412d2906672c4";
+my $md5 = "0a653c65087022b2eaf752092f46ed36";
 
 check_md5_output($md5, $cmd);
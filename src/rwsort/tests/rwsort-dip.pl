@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: 4a1d670c84bcd15e29ce5a3fca077ec8
+# MD5: 14bb9b3fc49a531982c12fcc56a0d5cf
 # TEST: ./rwsort --fields=dip ../../tests/data.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little --ipv4-output
 
 use strict;
@@ -10,6 +10,6 @@ my $rwcat = check_silk_app('rwcat');
 my %file;
 $file{data} = get_data_or_exit77('data');
 my $cmd = "$rwsort --fields=dip $file{data} | $rwcat --compression-method=none --byte-order=little --ipv4-output";
-my $md5 = "4a1d670c84bcd15e29ce5a3fca077ec8";
+my $md5 = "14bb9b3fc49a531982c12fcc56a0d5cf";
 
 check_md5_output($md5, $cmd);
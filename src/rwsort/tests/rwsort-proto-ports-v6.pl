@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: b30c71f0658492d4943f02cc84993b58
+# MD5: 5156604965b8ff1692094c148fdcbc0d
 # TEST: ./rwsort --fields=5,3-4 ../../tests/data-v6.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little
 
 use strict;
@@ -11,6 +11,6 @@ my %file;
 $file{v6data} = get_data_or_exit77('v6data');
 check_features(qw(ipv6));
 my $cmd = "$rwsort --fields=5,3-4 $file{v6data} | $rwcat --compression-method=none --byte-order=little";
-my $md5 = "b30c71f0658492d4943f02cc84993b58";
+my $md5 = "5156604965b8ff1692094c148fdcbc0d";
 
 check_md5_output($md5, $cmd);
@@ -1,5 +1,5 @@
 #! /usr/bin/perl -w
-# MD5: 074e543300d34ba3caec280a4e4c2175
+# MD5: 43402e8157c677e887f7858a69e91711
 # TEST: ./rwsort --fields=1 ../../tests/data-v6.rwf | ../rwcat/rwcat --compression-method=none --byte-order=little
 
 use strict;
@@ -11,6 +11,6 @@ my %file;
 $file{v6data} = get_data_or_exit77('v6data');
 check_features(qw(ipv6));
 my $cmd = "$rwsort --fields=1 $file{v6data} | $rwcat --compression-method=none --byte-order=little";
-my $md5 = "074e543300d34ba3caec280a4e4c2175";
+my $md5 = "43402e8157c677e887f7858a69e91711";
 
 check_md5_output($md5, $cmd);
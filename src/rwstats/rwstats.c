@@ -299,6 +299,10 @@ size_t heap_offset_key = 0;
 size_t heap_offset_value = 0;
 size_t heap_offset_distinct = 0;
 
+/* when approximating, the offset of the maximum overestimate of the
+ * count, which follows the key in the heap node */
+size_t heap_offset_error = 0;
+
 /* the total byte length of a node in the heap */
 size_t heap_octets_node = 0;
 
@@ -324,6 +328,12 @@ uint64_t value_total = 0;
 /* how to handle IPv6 flows */
 sk_ipv6policy_t ipv6_policy = SK_IPV6POLICY_MIX;
 
+/* where to write the bins as a partial aggregate, or NULL */
+skstream_t *partial_output = NULL;
+
+/* maximum bytes to use for aggregating, or 0 for no limit */
+uint64_t memory_limit = 0;
+
 /* CIDR block mask for src and dest ips.  If 0, use all bits;
  * otherwise, the IP address should be bitwised ANDed with this
  * value. */
@@ -423,6 +433,12 @@ topnPrintHeader(
                 value_total, limit.title);
     }
     fprintf(output.of_fp, "\n");
+    if (app_flags.approximate) {
+        fprintf(output.of_fp,
+                ("APPROXIMATE: Each %s may exceed its true value by its"
+                 " Error; no bin's Error exceeds %" PRIu64 "\n"),
+                limit.title, approxGetBound());
+    }
 
     /* handle the no data case */
     if (limit.value[RWSTATS_COUNT] < 1) {
@@ -802,11 +818,20 @@ rwstatsPrintHeap(
  *
  *    For the *Btm* functions, return -1, 0, 1 depending on whether
  *    the value in 'node1' is <, ==, > the value in 'node2'.
+ *
+ *    When the values are equal, these functions compare the keys so
+ *    the bins that are kept and the order in which they are printed
+ *    do not depend on the order in which the bins were visited; the
+ *    smaller key is treated as the better bin.
  */
 
 #define COMPARE(cmp_a, cmp_b)                                   \
     (((cmp_a) < (cmp_b)) ? -1 : (((cmp_a) > (cmp_b)) ? 1 : 0))
 
+#define CMP_HEAP_KEYS(cmp_a, cmp_b)                                     \
+    skFieldListCompareBuffers(HEAP_PTR_KEY(cmp_a), HEAP_PTR_KEY(cmp_b), \
+                              key_fields)
+
 #define CMP_INT_HEAP_VALUES(cmp_out, cmp_type, cmp_a, cmp_b)    \
     {                                                           \
         cmp_type val_a;                                         \
@@ -845,7 +870,7 @@ rwstatsCompareValuesTop32(
 {
     int rv;
     CMP_INT_HEAP_VALUES(rv, uint32_t, node1, node2);
-    return -rv;
+    return ((0 == rv) ? CMP_HEAP_KEYS(node1, node2) : -rv);
 }
 
 static int
@@ -855,7 +880,7 @@ rwstatsCompareValuesBottom32(
 {
     int rv;
     CMP_INT_HEAP_VALUES(rv, uint32_t, node1, node2);
-    return rv;
+    return ((0 == rv) ? CMP_HEAP_KEYS(node1, node2) : rv);
 }
 
 static int
@@ -865,7 +890,7 @@ rwstatsCompareValuesTop64(
 {
     int rv;
     CMP_INT_HEAP_VALUES(rv, uint64_t, node1, node2);
-    return -rv;
+    return ((0 == rv) ? CMP_HEAP_KEYS(node1, node2) : -rv);
 }
 
 static int
@@ -875,7 +900,7 @@ rwstatsCompareValuesBottom64(
 {
     int rv;
     CMP_INT_HEAP_VALUES(rv, uint64_t, node1, node2);
-    return rv;
+    return ((0 == rv) ? CMP_HEAP_KEYS(node1, node2) : rv);
 }
 
 static int
@@ -952,6 +977,9 @@ rwstatsCompareDistinctsAny(
         break;
     }
 
+    if (0 == cmp) {
+        return CMP_HEAP_KEYS(node1, node2);
+    }
     return ((RWSTATS_DIR_TOP == direction) ? -cmp : cmp);
 }
 
@@ -992,8 +1020,9 @@ rwstatsThresholdMemory(
  *  ok = statsRandom();
  *
  *    Main control function that processes unsorted input (from files
- *    or from stdin) and fills the heap.  Returns 0 on success, -1 on
- *    failure.
+ *    or from stdin) and fills the heap.  The input is flow records, or
+ *    partial aggregate files when --merge-partials is given.  Returns
+ *    0 on success, -1 on failure.
  */
 static int
 statsRandom(
@@ -1004,7 +1033,9 @@ statsRandom(
     sk_unique_iterator_t *iter;
     uint8_t *outbuf[3] = {NULL, NULL, NULL};
     skstream_t *stream;
-    rwRec rwrec;
+    rwRec recs[READ_RECORDS_COUNT];
+    size_t num_recs;
+    size_t i;
     int rv = 0;
     size_t len;
     union count_un {
@@ -1017,11 +1048,22 @@ statsRandom(
 
     /* read SiLK Flow records and insert into the skunique data structure */
     while (0 == (rv = appNextInput(&stream))) {
-        while (SKSTREAM_OK == (rv = readRecord(stream, &rwrec))) {
-            if (0 != skUniqueAddRecord(uniq, &rwrec)) {
+        if (app_flags.merge_partials) {
+            rv = skUniqueAddPartial(uniq, stream, &record_count);
+            skStreamDestroy(&stream);
+            if (rv) {
                 return -1;
             }
+            continue;
         }
+        do {
+            rv = readRecords(stream, recs, READ_RECORDS_COUNT, &num_recs);
+            for (i = 0; i < num_recs; ++i) {
+                if (0 != skUniqueAddRecord(uniq, &recs[i])) {
+                    return -1;
+                }
+            }
+        } while (SKSTREAM_OK == rv);
         if (rv != SKSTREAM_ERR_EOF) {
             /* corrupt record in file */
             skStreamPrintLastErr(stream, rv, &skAppPrintErr);
@@ -1036,14 +1078,26 @@ statsRandom(
     }
 
     /* no more input; prepare for output */
-    skUniquePrepareForOutput(uniq);
+    if (skUniquePrepareForOutput(uniq)) {
+        return -1;
+    }
+    if (memory_limit) {
+        skAppPrintErr(("Bins used at most %" PRIu64 " bytes of the %" PRIu64
+                       "-byte memory limit"),
+                      skUniqueGetPeakMemory(uniq), memory_limit);
+    }
 
-    if (RWSTATS_PERCENTAGE == limit.type) {
-        /* the limit is a percentage of bytes, of packets, or of
-         * flows; compute the threshold given that we now know the
-         * total */
-        limit.value[RWSTATS_THRESHOLD]
-            = value_total * limit.value[RWSTATS_PERCENTAGE] / 100;
+    /* write the partial aggregate before the iterator merges the
+     * temporary files */
+    if (partial_output) {
+        if (skUniqueWritePartial(uniq, partial_output)) {
+            return -1;
+        }
+        rv = skStreamClose(partial_output);
+        if (rv) {
+            skStreamPrintLastErr(partial_output, rv, &skAppPrintErr);
+            return -1;
+        }
     }
 
     /* create the iterator over skUnique's bins */
@@ -1053,6 +1107,41 @@ statsRandom(
         return -1;
     }
 
+    /* when merging partial aggregates, no records were read; the
+     * total of the value is the sum over the bins */
+    if (app_flags.merge_partials && !limit.distinct) {
+        if (SK_FIELD_RECORDS == limit.fl_id) {
+            value_total = record_count;
+        } else if (SK_FIELD_SUM_BYTES == limit.fl_id
+                   || SK_FIELD_SUM_PACKETS == limit.fl_id)
+        {
+            len = skFieldListEntryGetBinOctets(limit.fl_entry);
+            while (skUniqueIteratorNext(iter, &outbuf[0], &outbuf[2],
+                                        &outbuf[1])
+                   == SK_ITERATOR_OK)
+            {
+                count.u64 = 0;
+                skFieldListExtractFromBuffer(value_fields, outbuf[1],
+                                             limit.fl_entry, count.ar);
+                value_total += ((sizeof(uint32_t) == len)
+                                ? count.u32 : count.u64);
+            }
+            if (skUniqueIteratorReset(iter)) {
+                skAppPrintErr("Unable to reset iterator");
+                skUniqueIteratorDestroy(&iter);
+                return -1;
+            }
+        }
+    }
+
+    if (RWSTATS_PERCENTAGE == limit.type) {
+        /* the limit is a percentage of bytes, of packets, or of
+         * flows; compute the threshold given that we now know the
+         * total */
+        limit.value[RWSTATS_THRESHOLD]
+            = value_total * limit.value[RWSTATS_PERCENTAGE] / 100;
+    }
+
     /* branch based on type of limit and type of value */
     if (RWSTATS_COUNT == limit.type) {
         /* fixed-size heap; this is easy to handle */
@@ -1269,6 +1358,107 @@ statsRandom(
 }
 
 
+/*
+ *  ok = statsApproximate();
+ *
+ *    Main control function when --approximate or --merge-summaries is
+ *    given.  Fills the Space-Saving summary from the flow records or
+ *    by merging the summary files, optionally writes the summary, and
+ *    fills the heap with the bins having the largest estimated
+ *    counts.  Returns 0 on success, -1 on failure.
+ */
+static int
+statsApproximate(
+    void)
+{
+    uint8_t *top_heap;
+    uint8_t newnode[HASHLIB_MAX_KEY_WIDTH + HASHLIB_MAX_VALUE_WIDTH
+                    + sizeof(uint64_t)];
+    const uint8_t *key;
+    skstream_t *stream;
+    rwRec recs[READ_RECORDS_COUNT];
+    size_t num_recs;
+    size_t i;
+    uint64_t count;
+    uint64_t error;
+    uint32_t count32;
+    uint32_t pos;
+    int rv = 0;
+
+    if (app_flags.merge_summaries) {
+        while (0 == (rv = appNextInput(&stream))) {
+            rv = approxMergeStream(stream);
+            skStreamDestroy(&stream);
+            if (rv) {
+                return -1;
+            }
+        }
+    } else {
+        if (approxCreate()) {
+            return -1;
+        }
+        while (0 == (rv = appNextInput(&stream))) {
+            do {
+                rv = readRecords(stream, recs, READ_RECORDS_COUNT, &num_recs);
+                for (i = 0; i < num_recs; ++i) {
+                    approxAddRecord(&recs[i]);
+                }
+            } while (SKSTREAM_OK == rv);
+            if (rv != SKSTREAM_ERR_EOF) {
+                /* corrupt record in file */
+                skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+                skStreamDestroy(&stream);
+                return -1;
+            }
+            skStreamDestroy(&stream);
+        }
+    }
+    if (rv == -1) {
+        /* error opening file */
+        return -1;
+    }
+
+    if (summary_output_path && approxWrite(summary_output_path)) {
+        return -1;
+    }
+
+    /* the value field is the only value, and the heap node holds the
+     * key's error after its key */
+    assert(heap_offset_value == 0);
+    memset(newnode, 0, sizeof(newnode));
+
+    pos = 0;
+    top_heap = NULL;
+    while (approxIteratorNext(&pos, &key, &count, &error) == SK_ITERATOR_OK) {
+        ++limit.entries;
+
+        if (SK_FIELD_RECORDS == limit.fl_id) {
+            assert(heap_octets_value == sizeof(uint32_t));
+            count32 = ((count > UINT32_MAX) ? UINT32_MAX : (uint32_t)count);
+            memcpy(HEAP_PTR_VALUE(newnode), &count32, sizeof(uint32_t));
+        } else {
+            assert(heap_octets_value == sizeof(uint64_t));
+            memcpy(HEAP_PTR_VALUE(newnode), &count, sizeof(uint64_t));
+        }
+        memcpy(HEAP_PTR_KEY(newnode), key, heap_octets_key);
+        memcpy(HEAP_PTR_ERROR(newnode), &error, sizeof(uint64_t));
+
+        if (heap_num_entries < limit.value[RWSTATS_COUNT]) {
+            skHeapInsert(heap, newnode);
+            ++heap_num_entries;
+            if (heap_num_entries == limit.value[RWSTATS_COUNT]) {
+                skHeapPeekTop(heap, (skheapnode_t*)&top_heap);
+            }
+        } else if (cmp_fn(top_heap, newnode) > 0) {
+            skHeapReplaceTop(heap, newnode, NULL);
+            skHeapPeekTop(heap, (skheapnode_t*)&top_heap);
+        }
+    }
+
+    return 0;
+}
+
+
 /*
  *  presortedEntryCallback(key, distinct, value, top_heap);
  *
@@ -1557,10 +1747,15 @@ topnMain(
 
     heap_octets_node = heap_octets_key+heap_octets_value+heap_octets_distinct;
 
-    /* heap node contains (VALUE, DISTINCT, KEY) */
+    /* heap node contains (VALUE, DISTINCT, KEY), followed by the
+     * ERROR when approximating */
     heap_offset_value = 0;
     heap_offset_distinct = heap_offset_value + heap_octets_value;
     heap_offset_key = heap_offset_distinct + heap_octets_distinct;
+    heap_offset_error = heap_offset_key + heap_octets_key;
+    if (app_flags.approximate) {
+        heap_octets_node += sizeof(uint64_t);
+    }
 
     /* get the initial size of the heap */
     if (RWSTATS_COUNT == limit.type) {
@@ -1584,6 +1779,8 @@ topnMain(
     /* read the flow records and fill the heap */
     if (app_flags.presorted_input) {
         rv = statsPresorted();
+    } else if (app_flags.approximate) {
+        rv = statsApproximate();
     } else {
         rv = statsRandom();
     }
@@ -83,6 +83,22 @@ RCSIDENTVAR(rcsID_RWSTATS_H, "$SiLK: rwstats.h c19d64b322b8 2015-02-09 22:11:47Z
 /* default sTime bin size to use when --bin-time is requested */
 #define DEFAULT_TIME_BIN  60
 
+/* maximum number of records to read from an input stream in a single
+ * call to readRecords() */
+#define READ_RECORDS_COUNT  256
+
+/* environment variable that determines number of threads */
+#define RWSTATS_THREADS_ENVAR  "SILK_RWSTATS_THREADS"
+
+/* the number of counters --approximate uses when none is specified
+ * is the larger of this value and APPROX_COUNTERS_PER_N times N */
+#define APPROX_COUNTERS_DEFAULT  10000
+#define APPROX_COUNTERS_PER_N    10
+
+/* the range of the number of counters for --approximate */
+#define APPROX_COUNTERS_MIN  1
+#define APPROX_COUNTERS_MAX  (1 << 26)
+
 
 #define HEAP_PTR_KEY(hp)                        \
     ((uint8_t*)(hp) + heap_offset_key)
@@ -93,6 +109,9 @@ RCSIDENTVAR(rcsID_RWSTATS_H, "$SiLK: rwstats.h c19d64b322b8 2015-02-09 22:11:47Z
 #define HEAP_PTR_DISTINCT(hp)                                   \
     ((uint8_t*)(hp) + heap_offset_distinct)
 
+#define HEAP_PTR_ERROR(hp)                      \
+    ((uint8_t*)(hp) + heap_offset_error)
+
 
 /* symbol names for whether this is a top-N or bottom-N */
 typedef enum {
@@ -160,6 +179,9 @@ typedef struct app_flags_st {
     unsigned no_final_delimiter :1;
     unsigned integer_sensors    :1;
     unsigned integer_tcp_flags  :1;
+    unsigned approximate        :1;      /* Use a Space-Saving summary */
+    unsigned merge_summaries    :1;      /* Inputs are summary files */
+    unsigned merge_partials     :1;      /* Inputs are partial aggregates */
 } app_flags_t;
 
 /* names for the columns */
@@ -183,6 +205,14 @@ typedef enum {
     OPT_TOP, OPT_BOTTOM,
 
     OPT_PRESORTED_INPUT,
+    OPT_THREADS,
+    OPT_MEMORY_LIMIT,
+    OPT_DISTINCT_APPROX,
+    OPT_APPROXIMATE,
+    OPT_SUMMARY_OUTPUT,
+    OPT_MERGE_SUMMARIES,
+    OPT_PARTIAL_OUTPUT,
+    OPT_MERGE_PARTIALS,
     OPT_NO_PERCENTS,
     OPT_BIN_TIME,
     OPT_TIMESTAMP_FORMAT,
@@ -238,6 +268,10 @@ extern size_t heap_offset_key;
 extern size_t heap_offset_value;
 extern size_t heap_offset_distinct;
 
+/* when approximating, the offset of the maximum overestimate of the
+ * count, which follows the key in the heap node */
+extern size_t heap_offset_error;
+
 /* the total byte length of a node in the heap */
 extern size_t heap_octets_node;
 
@@ -291,6 +325,19 @@ extern unsigned int time_fields_key;
 /* whether dPort is part of the key */
 extern unsigned int dport_key;
 
+/* number of counters in the summary.  When merging summaries, 0
+ * means to use the largest number of counters among the inputs */
+extern uint32_t approx_counters;
+
+/* where to write the summary, or NULL to not write it */
+extern const char *summary_output_path;
+
+/* where to write the bins as a partial aggregate, or NULL */
+extern skstream_t *partial_output;
+
+/* maximum bytes to use for aggregating, or 0 for no limit */
+extern uint64_t memory_limit;
+
 
 /* FUNCTION DECLARATIONS */
 
@@ -312,6 +359,12 @@ readRecord(
     skstream_t         *rwios,
     rwRec              *rwrec);
 int
+readRecords(
+    skstream_t         *rwios,
+    rwRec              *recs,
+    size_t              count,
+    size_t             *recs_read);
+int
 appNextInput(
     skstream_t        **rwios);
 void
@@ -334,6 +387,37 @@ protoStatsMain(
     void);
 
 
+/* rwstatsapprox.c: Functions for the approximate top-N */
+
+int
+approxParse(
+    const char         *arg);
+int
+approxCreate(
+    void);
+void
+approxDestroy(
+    void);
+void
+approxAddRecord(
+    const rwRec        *rwrec);
+int
+approxMergeStream(
+    skstream_t         *stream);
+int
+approxWrite(
+    const char         *path);
+uint64_t
+approxGetBound(
+    void);
+int
+approxIteratorNext(
+    uint32_t           *pos,
+    const uint8_t     **key,
+    uint64_t           *count,
+    uint64_t           *error);
+
+
 /* from rwstatslegacy.c */
 
 int
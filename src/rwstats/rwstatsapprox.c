@@ -0,0 +1,920 @@
+/*
+** Copyright (C) 2001-2015 by Carnegie Mellon University.
+**
+** @OPENSOURCE_HEADER_START@
+**
+** Use of the SILK system and related source code is subject to the terms
+** of the following licenses:
+**
+** GNU Public License (GPL) Rights pursuant to Version 2, June 1991
+** Government Purpose License Rights (GPLR) pursuant to DFARS 252.227.7013
+**
+** NO WARRANTY
+**
+** ANY INFORMATION, MATERIALS, SERVICES, INTELLECTUAL PROPERTY OR OTHER
+** PROPERTY OR RIGHTS GRANTED OR PROVIDED BY CARNEGIE MELLON UNIVERSITY
+** PURSUANT TO THIS LICENSE (HEREINAFTER THE "DELIVERABLES") ARE ON AN
+** "AS-IS" BASIS. CARNEGIE MELLON UNIVERSITY MAKES NO WARRANTIES OF ANY
+** KIND, EITHER EXPRESS OR IMPLIED AS TO ANY MATTER INCLUDING, BUT NOT
+** LIMITED TO, WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE,
+** MERCHANTABILITY, INFORMATIONAL CONTENT, NONINFRINGEMENT, OR ERROR-FREE
+** OPERATION. CARNEGIE MELLON UNIVERSITY SHALL NOT BE LIABLE FOR INDIRECT,
+** SPECIAL OR CONSEQUENTIAL DAMAGES, SUCH AS LOSS OF PROFITS OR INABILITY
+** TO USE SAID INTELLECTUAL PROPERTY, UNDER THIS LICENSE, REGARDLESS OF
+** WHETHER SUCH PARTY WAS AWARE OF THE POSSIBILITY OF SUCH DAMAGES.
+** LICENSEE AGREES THAT IT WILL NOT MAKE ANY WARRANTY ON BEHALF OF
+** CARNEGIE MELLON UNIVERSITY, EXPRESS OR IMPLIED, TO ANY PERSON
+** CONCERNING THE APPLICATION OF OR THE RESULTS TO BE OBTAINED WITH THE
+** DELIVERABLES UNDER THIS LICENSE.
+**
+** Licensee hereby agrees to defend, indemnify, and hold harmless Carnegie
+** Mellon University, its trustees, officers, employees, and agents from
+** all claims or demands made against them (and any related losses,
+** expenses, or attorney's fees) arising out of, or relating to Licensee's
+** and/or its sub licensees' negligent use or willful misuse of or
+** negligent conduct or willful misconduct regarding the Software,
+** facilities, or other rights or assistance granted by Carnegie Mellon
+** University under this License, including, but not limited to, any
+** claims of product liability, personal injury, death, damage to
+** property, or violation of any laws or regulations.
+**
+** Carnegie Mellon University Software Engineering Institute authored
+** documents are sponsored by the U.S. Department of Defense under
+** Contract FA8721-05-C-0003. Carnegie Mellon University retains
+** copyrights in all material produced under this contract. The U.S.
+** Government retains a non-exclusive, royalty-free license to publish or
+** reproduce these documents, or allow others to do so, for U.S.
+** Government purposes only pursuant to the copyright license under the
+** contract clause at 252.227.7013.
+**
+** @OPENSOURCE_HEADER_END@
+*/
+
+/*
+**  rwstatsapprox.c
+**
+**    Approximate top-N for rwstats using the Space-Saving algorithm
+**    of Metwally, Agrawal, and El Abbadi.
+**
+**    The summary monitors at most 'k' keys.  When a record arrives
+**    for a key that is not monitored and all counters are in use,
+**    the key with the smallest count is evicted and the new key
+**    inherits its count, which is remembered as the new key's error.
+**    A monitored key's count is never less than its true value and
+**    exceeds it by no more than its error, and the error is never
+**    more than the total of the value divided by 'k'.  Memory is
+**    proportional to 'k' no matter how many distinct keys the input
+**    contains.
+**
+**    Summaries may be written to a file and later merged.  A key
+**    missing from a summary may have been seen as often as that
+**    summary's bound (the count of the smallest counter when the
+**    summary is full), so the merged estimate of such a key adds the
+**    other summary's bound to both its count and its error.  After
+**    merging, the summary keeps the 'k' largest counts.
+**
+*/
+
+#include <silk/silk.h>
+
+RCSIDENT("$SiLK: rwstatsapprox.c $");
+
+#include "rwstats.h"
+
+
+/* LOCAL DEFINES AND TYPEDEFS */
+
+/* version of the FT_RWTOPNSUMMARY file format that is written */
+#define APPROX_FILE_VERSION  1
+
+/* the Space-Saving summary */
+typedef struct approx_summary_st {
+    /* the key of each counter, each 'key_octets' long */
+    uint8_t        *keys;
+    /* the estimated count of each counter */
+    uint64_t       *counts;
+    /* the maximum overestimate of each counter */
+    uint64_t       *errors;
+    /* the hash of each counter's key */
+    uint32_t       *hashes;
+    /* a min-heap of counter indexes ordered by count */
+    uint32_t       *heap;
+    /* the position of each counter in 'heap' */
+    uint32_t       *heap_pos;
+    /* open-addressed hash table holding counter index plus one, or 0
+     * for an empty slot */
+    uint32_t       *table;
+    /* the number of slots in 'table' minus one */
+    uint32_t        table_mask;
+    /* the maximum number of counters */
+    uint32_t        capacity;
+    /* the number of counters in use */
+    uint32_t        used;
+    /* an upper bound on the count of a key that is not monitored,
+     * ignoring the smallest counter when the summary is full */
+    uint64_t        bound;
+    /* the octet length of a key */
+    size_t          key_octets;
+} approx_summary_t;
+
+/* the fixed part of a summary file that follows the SiLK header */
+typedef struct approx_file_desc_st {
+    uint32_t        key_octets;
+    uint32_t        key_field_count;
+    uint32_t        value_id;
+    uint32_t        capacity;
+    uint32_t        used;
+    uint32_t        unused;
+    uint64_t        bound;
+    uint64_t        record_count;
+    uint64_t        value_total;
+} approx_file_desc_t;
+
+
+/* EXPORTED VARIABLES */
+
+/* number of counters in the summary.  When merging summaries, 0
+ * means to use the largest number of counters among the inputs */
+uint32_t approx_counters = 0;
+
+/* where to write the summary, or NULL to not write it */
+const char *summary_output_path = NULL;
+
+
+/* LOCAL VARIABLES */
+
+/* the summary */
+static approx_summary_t *summary = NULL;
+
+/* the summary whose counters are being sorted by approxSortCompare() */
+static const approx_summary_t *sort_summary = NULL;
+
+
+/* FUNCTION DEFINITIONS */
+
+/* defined in libsilk/hashlib.c */
+uint32_t
+hashlittle(
+    const void         *key,
+    size_t              length,
+    uint32_t            initval);
+
+#define APPROX_KEY(ak_sum, ak_idx)                      \
+    ((ak_sum)->keys + (size_t)(ak_idx) * (ak_sum)->key_octets)
+
+#define APPROX_HEAP_LESS(ahl_sum, ahl_a, ahl_b)                 \
+    ((ahl_sum)->counts[(ahl_sum)->heap[ahl_a]]                  \
+     < (ahl_sum)->counts[(ahl_sum)->heap[ahl_b]])
+
+#define APPROX_HEAP_SWAP(ahs_sum, ahs_a, ahs_b)                 \
+    {                                                           \
+        uint32_t ahs_tmp = (ahs_sum)->heap[ahs_a];              \
+        (ahs_sum)->heap[ahs_a] = (ahs_sum)->heap[ahs_b];        \
+        (ahs_sum)->heap[ahs_b] = ahs_tmp;                       \
+        (ahs_sum)->heap_pos[(ahs_sum)->heap[ahs_a]] = (ahs_a);  \
+        (ahs_sum)->heap_pos[(ahs_sum)->heap[ahs_b]] = (ahs_b);  \
+    }
+
+
+/*
+ *  approxSummaryDestroy(&sum);
+ *
+ *    Free all memory used by the summary at 'sum' and set 'sum' to
+ *    NULL.
+ */
+static void
+approxSummaryDestroy(
+    approx_summary_t  **sum)
+{
+    if (NULL == sum || NULL == *sum) {
+        return;
+    }
+    free((*sum)->keys);
+    free((*sum)->counts);
+    free((*sum)->errors);
+    free((*sum)->hashes);
+    free((*sum)->heap);
+    free((*sum)->heap_pos);
+    free((*sum)->table);
+    free(*sum);
+    *sum = NULL;
+}
+
+
+/*
+ *  sum = approxSummaryCreate(capacity, key_octets);
+ *
+ *    Create an empty summary able to monitor 'capacity' keys of
+ *    'key_octets' octets.  Return NULL on allocation error.
+ */
+static approx_summary_t *
+approxSummaryCreate(
+    uint32_t            capacity,
+    size_t              key_octets)
+{
+    approx_summary_t *sum;
+    uint32_t table_size;
+
+    assert(capacity > 0);
+
+    /* keep the table no more than half full */
+    table_size = 2;
+    while (table_size < 2 * (uint64_t)capacity) {
+        table_size <<= 1;
+    }
+
+    sum = (approx_summary_t*)calloc(1, sizeof(approx_summary_t));
+    if (NULL == sum) {
+        return NULL;
+    }
+    sum->capacity = capacity;
+    sum->key_octets = key_octets;
+    sum->table_mask = table_size - 1;
+
+    sum->keys = (uint8_t*)malloc((size_t)capacity * key_octets);
+    sum->counts = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    sum->errors = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    sum->hashes = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    sum->heap = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    sum->heap_pos = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    sum->table = (uint32_t*)calloc(table_size, sizeof(uint32_t));
+    if (!sum->keys || !sum->counts || !sum->errors || !sum->hashes
+        || !sum->heap || !sum->heap_pos || !sum->table)
+    {
+        approxSummaryDestroy(&sum);
+        return NULL;
+    }
+    return sum;
+}
+
+
+/*
+ *  approxHeapSiftDown(sum, pos);
+ *  approxHeapSiftUp(sum, pos);
+ *
+ *    Restore the heap property of the summary's min-heap after the
+ *    count of the counter at heap position 'pos' increased or was
+ *    added, respectively.
+ */
+static void
+approxHeapSiftDown(
+    approx_summary_t   *sum,
+    uint32_t            pos)
+{
+    uint32_t child;
+
+    for (;;) {
+        child = 2 * pos + 1;
+        if (child >= sum->used) {
+            return;
+        }
+        if (child + 1 < sum->used && APPROX_HEAP_LESS(sum, child + 1, child)) {
+            ++child;
+        }
+        if (!APPROX_HEAP_LESS(sum, child, pos)) {
+            return;
+        }
+        APPROX_HEAP_SWAP(sum, child, pos);
+        pos = child;
+    }
+}
+
+static void
+approxHeapSiftUp(
+    approx_summary_t   *sum,
+    uint32_t            pos)
+{
+    uint32_t parent;
+
+    while (pos > 0) {
+        parent = (pos - 1) / 2;
+        if (!APPROX_HEAP_LESS(sum, pos, parent)) {
+            return;
+        }
+        APPROX_HEAP_SWAP(sum, pos, parent);
+        pos = parent;
+    }
+}
+
+
+/*
+ *  slot = approxTableFind(sum, key, hash);
+ *
+ *    Return the slot of the hash table that holds 'key', whose hash
+ *    is 'hash', or the empty slot where 'key' would be inserted.
+ */
+static uint32_t
+approxTableFind(
+    const approx_summary_t *sum,
+    const uint8_t          *key,
+    uint32_t                hash)
+{
+    uint32_t slot;
+    uint32_t idx;
+
+    for (slot = hash & sum->table_mask;
+         0 != sum->table[slot];
+         slot = (slot + 1) & sum->table_mask)
+    {
+        idx = sum->table[slot] - 1;
+        if (sum->hashes[idx] == hash
+            && 0 == memcmp(APPROX_KEY(sum, idx), key, sum->key_octets))
+        {
+            break;
+        }
+    }
+    return slot;
+}
+
+
+/*
+ *  approxTableRemove(sum, slot);
+ *
+ *    Empty 'slot' in the hash table and move later entries of its
+ *    probe sequence back so that lookups do not stop early.
+ */
+static void
+approxTableRemove(
+    approx_summary_t   *sum,
+    uint32_t            slot)
+{
+    uint32_t next;
+    uint32_t home;
+
+    for (next = (slot + 1) & sum->table_mask;
+         0 != sum->table[next];
+         next = (next + 1) & sum->table_mask)
+    {
+        home = sum->hashes[sum->table[next] - 1] & sum->table_mask;
+        /* move the entry at 'next' to 'slot' unless its home slot
+         * lies cyclically in (slot, next] */
+        if ((slot <= next)
+            ? ((home <= slot) || (home > next))
+            : ((home <= slot) && (home > next)))
+        {
+            sum->table[slot] = sum->table[next];
+            slot = next;
+        }
+    }
+    sum->table[slot] = 0;
+}
+
+
+/*
+ *  idx = approxSummaryAppend(sum, slot, key, hash, count, error);
+ *
+ *    Add a counter for 'key' to 'sum', which must not be full, and
+ *    store its index in the empty hash table slot 'slot'.  Return
+ *    the index of the counter.
+ */
+static uint32_t
+approxSummaryAppend(
+    approx_summary_t   *sum,
+    uint32_t            slot,
+    const uint8_t      *key,
+    uint32_t            hash,
+    uint64_t            count,
+    uint64_t            error)
+{
+    uint32_t idx;
+
+    assert(sum->used < sum->capacity);
+    assert(0 == sum->table[slot]);
+
+    idx = sum->used++;
+    memcpy(APPROX_KEY(sum, idx), key, sum->key_octets);
+    sum->counts[idx] = count;
+    sum->errors[idx] = error;
+    sum->hashes[idx] = hash;
+    sum->table[slot] = idx + 1;
+    sum->heap[idx] = idx;
+    sum->heap_pos[idx] = idx;
+    approxHeapSiftUp(sum, idx);
+    return idx;
+}
+
+
+/*
+ *  bound = approxSummaryBound(sum);
+ *
+ *    Return an upper bound on the count of any key that 'sum' does
+ *    not monitor.
+ */
+static uint64_t
+approxSummaryBound(
+    const approx_summary_t *sum)
+{
+    if (sum->used < sum->capacity) {
+        return sum->bound;
+    }
+    return ((sum->counts[sum->heap[0]] > sum->bound)
+            ? sum->counts[sum->heap[0]]
+            : sum->bound);
+}
+
+
+/*
+ *  cmp = approxSortCompare(a, b);
+ *
+ *    Compare the counters of 'sort_summary' whose indexes are at 'a'
+ *    and 'b' so that larger counts sort first, breaking ties by key.
+ */
+static int
+approxSortCompare(
+    const void         *v_a,
+    const void         *v_b)
+{
+    uint32_t a = *(const uint32_t*)v_a;
+    uint32_t b = *(const uint32_t*)v_b;
+
+    if (sort_summary->counts[a] != sort_summary->counts[b]) {
+        return ((sort_summary->counts[a] > sort_summary->counts[b]) ? -1 : 1);
+    }
+    return memcmp(APPROX_KEY(sort_summary, a), APPROX_KEY(sort_summary, b),
+                  sort_summary->key_octets);
+}
+
+
+/*
+ *  new_sum = approxSummaryTruncate(sum, capacity);
+ *
+ *    Create a summary of 'capacity' counters that holds the counters
+ *    of 'sum' with the largest counts, and update the bound of the
+ *    new summary to cover the counters that were dropped.  Destroy
+ *    'sum' and return the new summary, or return NULL on allocation
+ *    error.
+ */
+static approx_summary_t *
+approxSummaryTruncate(
+    approx_summary_t   *sum,
+    uint32_t            capacity)
+{
+    approx_summary_t *new_sum = NULL;
+    uint32_t *order;
+    uint32_t keep;
+    uint32_t i;
+
+    order = (uint32_t*)malloc(sum->used * sizeof(uint32_t));
+    if (NULL == order) {
+        approxSummaryDestroy(&sum);
+        return NULL;
+    }
+    for (i = 0; i < sum->used; ++i) {
+        order[i] = i;
+    }
+    sort_summary = sum;
+    qsort(order, sum->used, sizeof(uint32_t), &approxSortCompare);
+    sort_summary = NULL;
+
+    new_sum = approxSummaryCreate(capacity, sum->key_octets);
+    if (NULL == new_sum) {
+        goto END;
+    }
+    new_sum->bound = sum->bound;
+    keep = ((sum->used < capacity) ? sum->used : capacity);
+    if (keep < sum->used && sum->counts[order[keep]] > new_sum->bound) {
+        /* a dropped key may have been seen this often */
+        new_sum->bound = sum->counts[order[keep]];
+    }
+    for (i = 0; i < keep; ++i) {
+        approxSummaryAppend(
+            new_sum,
+            approxTableFind(new_sum, APPROX_KEY(sum, order[i]),
+                            sum->hashes[order[i]]),
+            APPROX_KEY(sum, order[i]), sum->hashes[order[i]],
+            sum->counts[order[i]], sum->errors[order[i]]);
+    }
+
+  END:
+    free(order);
+    approxSummaryDestroy(&sum);
+    return new_sum;
+}
+
+
+/*
+ *  status = approxParse(arg);
+ *
+ *    Parse the argument to --approximate, which is "space-saving" or
+ *    "space-saving:k=K", and set 'approx_counters' to K, or to 0 when
+ *    K is not given.  Return 0 on success or -1 on error.
+ */
+int
+approxParse(
+    const char         *arg)
+{
+    static const char method[] = "space-saving";
+    const size_t method_len = sizeof(method) - 1;
+    int rv;
+
+    if (0 != strncmp(arg, method, method_len)) {
+        skAppPrintErr("Unrecognized approximation method '%s'", arg);
+        return -1;
+    }
+    arg += method_len;
+    if ('\0' == *arg) {
+        /* use the default, which depends on N */
+        approx_counters = 0;
+        return 0;
+    }
+    if (0 != strncmp(arg, ":k=", 3)) {
+        skAppPrintErr("Unrecognized text after approximation method '%s'",
+                      arg);
+        return -1;
+    }
+    rv = skStringParseUint32(&approx_counters, arg + 3,
+                             APPROX_COUNTERS_MIN, APPROX_COUNTERS_MAX);
+    if (rv) {
+        skAppPrintErr("Invalid number of counters '%s': %s",
+                      arg + 3, skStringParseStrerror(rv));
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  status = approxCreate();
+ *
+ *    Create the summary that approxAddRecord() fills.  Return 0 on
+ *    success or -1 on allocation error.
+ */
+int
+approxCreate(
+    void)
+{
+    assert(NULL == summary);
+    summary = approxSummaryCreate(approx_counters,
+                                  skFieldListGetBufferSize(key_fields));
+    if (NULL == summary) {
+        skAppPrintOutOfMemory("approximate summary");
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ *  approxDestroy();
+ *
+ *    Free the summary.
+ */
+void
+approxDestroy(
+    void)
+{
+    approxSummaryDestroy(&summary);
+}
+
+
+/*
+ *  approxAddRecord(rwrec);
+ *
+ *    Add the value of 'rwrec' to the counter for its key, evicting
+ *    the smallest counter when the key is not monitored and the
+ *    summary is full.
+ */
+void
+approxAddRecord(
+    const rwRec        *rwrec)
+{
+    approx_summary_t *sum = summary;
+    uint8_t key[HASHLIB_MAX_KEY_WIDTH];
+    uint64_t weight;
+    uint64_t min_count;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t idx;
+
+    switch (limit.fl_id) {
+      case SK_FIELD_SUM_BYTES:
+        weight = rwRecGetBytes(rwrec);
+        break;
+      case SK_FIELD_SUM_PACKETS:
+        weight = rwRecGetPkts(rwrec);
+        break;
+      default:
+        weight = 1;
+        break;
+    }
+
+    skFieldListRecToBinary(key_fields, rwrec, key);
+    hash = hashlittle(key, sum->key_octets, 0);
+
+    slot = approxTableFind(sum, key, hash);
+    if (0 != sum->table[slot]) {
+        /* key is monitored */
+        idx = sum->table[slot] - 1;
+        sum->counts[idx] += weight;
+        approxHeapSiftDown(sum, sum->heap_pos[idx]);
+        return;
+    }
+    if (sum->used < sum->capacity) {
+        approxSummaryAppend(sum, slot, key, hash, weight, 0);
+        return;
+    }
+
+    /* replace the key with the smallest count */
+    idx = sum->heap[0];
+    min_count = sum->counts[idx];
+    approxTableRemove(sum, approxTableFind(sum, APPROX_KEY(sum, idx),
+                                           sum->hashes[idx]));
+    memcpy(APPROX_KEY(sum, idx), key, sum->key_octets);
+    sum->hashes[idx] = hash;
+    sum->counts[idx] = min_count + weight;
+    sum->errors[idx] = min_count;
+    sum->table[approxTableFind(sum, key, hash)] = idx + 1;
+    approxHeapSiftDown(sum, 0);
+}
+
+
+/*
+ *  status = approxMergeStream(stream);
+ *
+ *    Read the summary in 'stream', which was written by
+ *    approxWrite(), and merge it into the summary, creating the
+ *    summary if needed.  Add the record count and value total of the
+ *    file to the globals.  Return 0 on success or -1 on error.
+ */
+int
+approxMergeStream(
+    skstream_t         *stream)
+{
+    sk_file_header_t *hdr;
+    approx_file_desc_t desc;
+    approx_summary_t *merged = NULL;
+    sk_fieldlist_iterator_t fl_iter;
+    sk_fieldentry_t *field;
+    uint8_t entry[HASHLIB_MAX_KEY_WIDTH + 2 * sizeof(uint64_t)];
+    uint64_t file_count;
+    uint64_t file_error;
+    uint64_t sum_bound;
+    uint32_t capacity;
+    uint32_t field_id;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t idx;
+    uint32_t i;
+    size_t key_octets;
+    size_t entry_octets;
+    ssize_t rv;
+
+    key_octets = skFieldListGetBufferSize(key_fields);
+    entry_octets = key_octets + 2 * sizeof(uint64_t);
+
+    rv = skStreamReadSilkHeader(stream, &hdr);
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+        return -1;
+    }
+    if (skStreamCheckSilkHeader(stream, FT_RWTOPNSUMMARY, APPROX_FILE_VERSION,
+                                APPROX_FILE_VERSION, &skAppPrintErr))
+    {
+        return -1;
+    }
+    if (!skHeaderIsNativeByteOrder(hdr)) {
+        skAppPrintErr(("Cannot merge summary '%s':"
+                       " Written on a machine with a different byte order"),
+                      skStreamGetPathname(stream));
+        return -1;
+    }
+
+    /* read and check the description of the summary */
+    rv = skStreamRead(stream, &desc, sizeof(desc));
+    if (rv != (ssize_t)sizeof(desc)) {
+        goto READ_ERROR;
+    }
+    if (desc.key_octets != key_octets
+        || desc.key_field_count != skFieldListGetFieldCount(key_fields)
+        || desc.value_id != (uint32_t)limit.fl_id
+        || 0 == desc.capacity || desc.used > desc.capacity)
+    {
+        goto MISMATCH;
+    }
+    skFieldListIteratorBind(key_fields, &fl_iter);
+    while (NULL != (field = skFieldListIteratorNext(&fl_iter))) {
+        rv = skStreamRead(stream, &field_id, sizeof(field_id));
+        if (rv != (ssize_t)sizeof(field_id)) {
+            goto READ_ERROR;
+        }
+        if (field_id != (uint32_t)skFieldListEntryGetId(field)) {
+            goto MISMATCH;
+        }
+    }
+
+    record_count += desc.record_count;
+    value_total += desc.value_total;
+
+    if (summary) {
+        sum_bound = approxSummaryBound(summary);
+        capacity = ((approx_counters) ? approx_counters
+                    : ((summary->capacity > desc.capacity)
+                       ? summary->capacity : desc.capacity));
+    } else {
+        sum_bound = 0;
+        capacity = ((approx_counters) ? approx_counters : desc.capacity);
+    }
+
+    /* the merged summary holds every key of both summaries until it
+     * is truncated */
+    merged = approxSummaryCreate(
+        (summary ? summary->used : 0) + (desc.used ? desc.used : 1),
+        key_octets);
+    if (NULL == merged) {
+        skAppPrintOutOfMemory("approximate summary");
+        return -1;
+    }
+    merged->bound = sum_bound + desc.bound;
+
+    /* assume each existing key is absent from the file */
+    for (i = 0; summary && i < summary->used; ++i) {
+        approxSummaryAppend(
+            merged,
+            approxTableFind(merged, APPROX_KEY(summary, i),
+                            summary->hashes[i]),
+            APPROX_KEY(summary, i), summary->hashes[i],
+            summary->counts[i] + desc.bound, summary->errors[i] + desc.bound);
+    }
+
+    for (i = 0; i < desc.used; ++i) {
+        rv = skStreamRead(stream, entry, entry_octets);
+        if (rv != (ssize_t)entry_octets) {
+            approxSummaryDestroy(&merged);
+            goto READ_ERROR;
+        }
+        memcpy(&file_count, entry + key_octets, sizeof(uint64_t));
+        memcpy(&file_error, entry + key_octets + sizeof(uint64_t),
+               sizeof(uint64_t));
+        hash = hashlittle(entry, key_octets, 0);
+        slot = approxTableFind(merged, entry, hash);
+        if (0 != merged->table[slot]) {
+            /* key is in both; replace the file's bound with its
+             * count */
+            idx = merged->table[slot] - 1;
+            merged->counts[idx] += file_count - desc.bound;
+            merged->errors[idx] += file_error - desc.bound;
+        } else {
+            approxSummaryAppend(merged, slot, entry, hash,
+                                file_count + sum_bound,
+                                file_error + sum_bound);
+        }
+    }
+
+    approxSummaryDestroy(&summary);
+    summary = approxSummaryTruncate(merged, capacity);
+    if (NULL == summary) {
+        skAppPrintOutOfMemory("approximate summary");
+        return -1;
+    }
+    return 0;
+
+  READ_ERROR:
+    if (rv < 0) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+    } else {
+        skAppPrintErr("Cannot merge summary '%s': Unexpected end of file",
+                      skStreamGetPathname(stream));
+    }
+    return -1;
+
+  MISMATCH:
+    skAppPrintErr(("Cannot merge summary '%s':"
+                   " Its key or value fields do not match --%s and --%s"),
+                  skStreamGetPathname(stream), "fields", "values");
+    return -1;
+}
+
+
+/*
+ *  status = approxWrite(path);
+ *
+ *    Write the summary, the record count, and the value total to the
+ *    file at 'path' so that a later invocation of rwstats may merge
+ *    it.  Return 0 on success or -1 on error.
+ */
+int
+approxWrite(
+    const char         *path)
+{
+    skstream_t *stream = NULL;
+    sk_file_header_t *hdr;
+    approx_file_desc_t desc;
+    sk_fieldlist_iterator_t fl_iter;
+    sk_fieldentry_t *field;
+    uint8_t entry[HASHLIB_MAX_KEY_WIDTH + 2 * sizeof(uint64_t)];
+    uint32_t field_id;
+    uint32_t i;
+    ssize_t rv;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.key_octets = summary->key_octets;
+    desc.key_field_count = skFieldListGetFieldCount(key_fields);
+    desc.value_id = (uint32_t)limit.fl_id;
+    desc.capacity = summary->capacity;
+    desc.used = summary->used;
+    desc.bound = approxSummaryBound(summary);
+    desc.record_count = record_count;
+    desc.value_total = value_total;
+
+    if ((rv = skStreamCreate(&stream, SK_IO_WRITE, SK_CONTENT_SILK))
+        || (rv = skStreamBind(stream, path)))
+    {
+        goto END;
+    }
+    hdr = skStreamGetSilkHeader(stream);
+    skHeaderSetFileFormat(hdr, FT_RWTOPNSUMMARY);
+    skHeaderSetRecordVersion(hdr, APPROX_FILE_VERSION);
+    skHeaderSetRecordLength(hdr, 1);
+    if ((rv = skStreamOpen(stream))
+        || (rv = skStreamWriteSilkHeader(stream)))
+    {
+        goto END;
+    }
+
+    if (skStreamWrite(stream, &desc, sizeof(desc)) != (ssize_t)sizeof(desc)) {
+        rv = -1;
+        goto END;
+    }
+    skFieldListIteratorBind(key_fields, &fl_iter);
+    while (NULL != (field = skFieldListIteratorNext(&fl_iter))) {
+        field_id = (uint32_t)skFieldListEntryGetId(field);
+        if (skStreamWrite(stream, &field_id, sizeof(field_id))
+            != (ssize_t)sizeof(field_id))
+        {
+            rv = -1;
+            goto END;
+        }
+    }
+    for (i = 0; i < summary->used; ++i) {
+        memcpy(entry, APPROX_KEY(summary, i), summary->key_octets);
+        memcpy(entry + summary->key_octets, &summary->counts[i],
+               sizeof(uint64_t));
+        memcpy(entry + summary->key_octets + sizeof(uint64_t),
+               &summary->errors[i], sizeof(uint64_t));
+        if (skStreamWrite(stream, entry,
+                          summary->key_octets + 2 * sizeof(uint64_t))
+            != (ssize_t)(summary->key_octets + 2 * sizeof(uint64_t)))
+        {
+            rv = -1;
+            goto END;
+        }
+    }
+    rv = skStreamClose(stream);
+
+  END:
+    if (rv) {
+        skStreamPrintLastErr(stream, rv, &skAppPrintErr);
+    }
+    skStreamDestroy(&stream);
+    return ((rv) ? -1 : 0);
+}
+
+
+/*
+ *  bound = approxGetBound();
+ *
+ *    Return an upper bound on the count of any key that the summary
+ *    does not monitor, which is also the largest error of any
+ *    counter.
+ */
+uint64_t
+approxGetBound(
+    void)
+{
+    return approxSummaryBound(summary);
+}
+
+
+/*
+ *  status = approxIteratorNext(&pos, &key, &count, &error);
+ *
+ *    Visit the counters of the summary.  'pos' must be 0 on the first
+ *    call.  Set 'key', 'count', and 'error' to the key, estimated
+ *    count, and maximum overestimate of the next counter and return
+ *    SK_ITERATOR_OK, or return SK_ITERATOR_NO_MORE_ENTRIES.
+ */
+int
+approxIteratorNext(
+    uint32_t           *pos,
+    const uint8_t     **key,
+    uint64_t           *count,
+    uint64_t           *error)
+{
+    if (NULL == summary || *pos >= summary->used) {
+        return SK_ITERATOR_NO_MORE_ENTRIES;
+    }
+    *key = APPROX_KEY(summary, *pos);
+    *count = summary->counts[*pos];
+    *error = summary->errors[*pos];
+    ++*pos;
+    return SK_ITERATOR_OK;
+}
+
+
+/*
+** Local Variables:
+** mode:c
+** indent-tabs-mode:nil
+** c-basic-offset:4
+** End:
+*/
@@ -119,6 +119,13 @@ static skstream_t *copy_input = NULL;
 /* temporary directory */
 static const char *temp_directory = NULL;
 
+/* number of threads to use for aggregating */
+static uint32_t thread_count = 1;
+
+/* precision of the sketches that estimate distinct counts, or 0 to
+ * count exactly */
+static unsigned int distinct_approx = 0;
+
 /* how to print IP addresses */
 static uint32_t ip_format = SKIPADDR_CANONICAL;
 
@@ -202,6 +209,14 @@ static struct option appOptions[] = {
     {"bottom",              NO_ARG,       0, OPT_BOTTOM},
 
     {"presorted-input",     NO_ARG,       0, OPT_PRESORTED_INPUT},
+    {"threads",             REQUIRED_ARG, 0, OPT_THREADS},
+    {"memory-limit",        REQUIRED_ARG, 0, OPT_MEMORY_LIMIT},
+    {"distinct-approx",     REQUIRED_ARG, 0, OPT_DISTINCT_APPROX},
+    {"approximate",         REQUIRED_ARG, 0, OPT_APPROXIMATE},
+    {"summary-output",      REQUIRED_ARG, 0, OPT_SUMMARY_OUTPUT},
+    {"merge-summaries",     NO_ARG,       0, OPT_MERGE_SUMMARIES},
+    {"partial-output",      REQUIRED_ARG, 0, OPT_PARTIAL_OUTPUT},
+    {"merge-partials",      NO_ARG,       0, OPT_MERGE_PARTIALS},
     {"no-percents",         NO_ARG,       0, OPT_NO_PERCENTS},
     {"bin-time",            OPTIONAL_ARG, 0, OPT_BIN_TIME},
     {"timestamp-format",    REQUIRED_ARG, 0, OPT_TIMESTAMP_FORMAT},
@@ -251,6 +266,28 @@ static const char *appHelp[] = {
 
     ("Assume input has been presorted using\n"
      "\trwsort invoked with the exact same --fields value. Def. No"),
+    ("Aggregate the records using this number of threads.\n"
+     "\tDef. $" RWSTATS_THREADS_ENVAR " or 1"),
+    ("Write bins to temporary files rather than use more than\n"
+     "\tthis much memory for bins, in bytes.  Append k, m, g, for kilo-,\n"
+     "\tmega-, giga-bytes, respectively. Def. No limit"),
+    ("Estimate distinct counts with HyperLogLog sketches of\n"
+     "\t2^P registers; specify as 'hll:p=P' with P from 4 to 18, or 'hll'\n"
+     "\tfor P=12.  Error is about 1.04/sqrt(2^P). Def. Exact counts"),
+    ("Find the top N bins in one pass with a Space-Saving\n"
+     "\tsummary of K counters; specify as 'space-saving:k=K' or\n"
+     "\t'space-saving' for K of the larger of 10000 and 10*N.  Requires\n"
+     "\t--count, --top, and a single value of Records, Bytes, or Packets.\n"
+     "\tAdds an Error column bounding each overcount. Def. Exact counts"),
+    ("Write the Space-Saving summary to this file so a later\n"
+     "\t--merge-summaries may combine it with others. Def. No"),
+    ("Treat the inputs as files written by --summary-output\n"
+     "\tand merge them; implies --approximate. Def. Inputs are flows"),
+    ("Also write the bins to this file as a partial aggregate\n"
+     "\tthat a later --merge-partials may combine with others. Def. No"),
+    ("Treat the inputs as files written by --partial-output\n"
+     "\tusing the same --fields and --values, and merge them. Def. Inputs\n"
+     "\tare flows"),
     ("Do not print the percentage columns. Def. Print percents"),
     ("When using 'sTime' or 'eTime' as a key, adjust time(s) to\n"
      "\tto appear in N-second bins (floor of time is used). Def. No, "),
@@ -285,6 +322,18 @@ static void helpFields(FILE *fh);
 static int  createStringmaps(void);
 static int  parseKeyFields(const char *field_string);
 static int  parseValueFields(const char *field_string);
+static void
+error_get_title(
+    char               *text_buf,
+    size_t              text_buf_size,
+    void               *v_fl_entry);
+static int
+error_to_ascii(
+    const rwRec        *rwrec,
+    char               *text_buf,
+    size_t              text_buf_size,
+    void               *v_fl_entry,
+    void               *v_heap_ptr);
 static int
 appAddPlugin(
     skplugin_field_t   *pi_field,
@@ -462,6 +511,19 @@ appSetup(
         appExit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    {
+        char *env;
+        uint32_t tc;
+
+        env = getenv(RWSTATS_THREADS_ENVAR);
+        if (env && env[0]) {
+            if (skStringParseUint32(&tc, env, 1, SK_UNIQUE_THREADS_MAX) == 0) {
+                thread_count = tc;
+            }
+        }
+    }
+
     /* try to load hard-coded plugins */
     for (j = 0; app_static_plugins[j].name; ++j) {
         skPluginAddAsPlugin(app_static_plugins[j].name,
@@ -524,6 +586,22 @@ appSetup(
     }
 
     /* make certain stdout is not being used for multiple outputs */
+    if (partial_output
+        && ((0 == strcmp(skStreamGetPathname(partial_output), "-"))
+            || (0 == strcmp(skStreamGetPathname(partial_output), "stdout"))))
+    {
+        if ((NULL == output.of_name)
+            || (0 == strcmp(output.of_name, "-"))
+            || (0 == strcmp(output.of_name, "stdout"))
+            || (copy_input
+                && ((0 == strcmp(skStreamGetPathname(copy_input), "-"))
+                    || (0 == strcmp(skStreamGetPathname(copy_input),
+                                    "stdout")))))
+        {
+            skAppPrintErr("May not use stdout for multiple output streams");
+            exit(EXIT_FAILURE);
+        }
+    }
     if (copy_input
         && ((0 == strcmp(skStreamGetPathname(copy_input), "-"))
             || (0 == strcmp(skStreamGetPathname(copy_input), "stdout"))))
@@ -558,6 +636,15 @@ appSetup(
         }
     }
 
+    /* open the --partial-output destination */
+    if (partial_output) {
+        rv = skStreamOpen(partial_output);
+        if (rv) {
+            skStreamPrintLastErr(partial_output, rv, &skAppPrintErr);
+            appExit(EXIT_FAILURE);
+        }
+    }
+
     /* set signal handler to clean up temp files on SIGINT, SIGTERM, etc */
     if (skAppSetSignalHandler(&appHandleSignal)) {
         appExit(EXIT_FAILURE);
@@ -589,6 +676,7 @@ appTeardown(
 
     skUniqueDestroy(&uniq);
     skPresortedUniqueDestroy(&ps_uniq);
+    approxDestroy();
 
     /* destroy field lists */
     skFieldListDestroy(&key_fields);
@@ -614,6 +702,8 @@ appTeardown(
         }
         skStreamDestroy(&copy_input);
     }
+    /* the --partial-output is closed after it is written */
+    skStreamDestroy(&partial_output);
 
     /* destroy string maps for keys and values */
     if (key_field_map) {
@@ -751,6 +841,73 @@ appOptionsHandler(
         app_flags.presorted_input = 1;
         break;
 
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1,
+                                 SK_UNIQUE_THREADS_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_MEMORY_LIMIT:
+        rv = skStringParseHumanUint64(&memory_limit, opt_arg,
+                                      SK_HUMAN_NORMAL);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        if (memory_limit < SK_UNIQUE_MEMORY_LIMIT_MIN) {
+            skAppPrintErr("The --%s value must be at least %d",
+                          appOptions[opt_index].name,
+                          SK_UNIQUE_MEMORY_LIMIT_MIN);
+            return 1;
+        }
+        break;
+
+      case OPT_DISTINCT_APPROX:
+        if (skUniqueParseDistinctApprox(opt_arg, &distinct_approx)) {
+            skAppPrintErr(("Invalid %s '%s': Expected 'hll' or 'hll:p=P'"
+                           " where P is between %d and %d"),
+                          appOptions[opt_index].name, opt_arg,
+                          SK_UNIQUE_DISTINCT_APPROX_MIN,
+                          SK_UNIQUE_DISTINCT_APPROX_MAX);
+            return 1;
+        }
+        break;
+
+      case OPT_APPROXIMATE:
+        if (approxParse(opt_arg)) {
+            return 1;
+        }
+        app_flags.approximate = 1;
+        break;
+
+      case OPT_SUMMARY_OUTPUT:
+        summary_output_path = opt_arg;
+        break;
+
+      case OPT_MERGE_SUMMARIES:
+        app_flags.merge_summaries = 1;
+        break;
+
+      case OPT_PARTIAL_OUTPUT:
+        if (partial_output) {
+            skAppPrintErr("Invalid %s: Switch used multiple times",
+                          appOptions[opt_index].name);
+            return 1;
+        }
+        if ((rv = skStreamCreate(&partial_output, SK_IO_WRITE,
+                                 SK_CONTENT_SILK))
+            || (rv = skStreamBind(partial_output, opt_arg)))
+        {
+            skStreamPrintLastErr(partial_output, rv, &skAppPrintErr);
+            return 1;
+        }
+        break;
+
+      case OPT_MERGE_PARTIALS:
+        app_flags.merge_partials = 1;
+        break;
+
       case OPT_NO_PERCENTS:
         app_flags.no_percents = 1;
         break;
@@ -962,6 +1119,106 @@ topnSetup(
         appExit(EXIT_FAILURE);
     }
 
+    /* check for switches that cannot be used with partial aggregates */
+    if (app_flags.merge_partials || partial_output) {
+        if (app_flags.presorted_input || app_flags.approximate
+            || app_flags.merge_summaries)
+        {
+            skAppPrintErr("Cannot use --%s with --%s",
+                          appOptions[(app_flags.presorted_input
+                                      ? OPT_PRESORTED_INPUT
+                                      : (app_flags.merge_summaries
+                                         ? OPT_MERGE_SUMMARIES
+                                         : OPT_APPROXIMATE))].name,
+                          appOptions[(app_flags.merge_partials
+                                      ? OPT_MERGE_PARTIALS
+                                      : OPT_PARTIAL_OUTPUT)].name);
+            appExit(EXIT_FAILURE);
+        }
+        if (app_flags.merge_partials && copy_input) {
+            skAppPrintErr("Cannot use --%s with --%s",
+                          appOptions[OPT_COPY_INPUT].name,
+                          appOptions[OPT_MERGE_PARTIALS].name);
+            appExit(EXIT_FAILURE);
+        }
+    }
+
+    if (app_flags.merge_summaries) {
+        app_flags.approximate = 1;
+    } else if (summary_output_path && !app_flags.approximate) {
+        skAppPrintErr("The --%s switch requires --%s",
+                      appOptions[OPT_SUMMARY_OUTPUT].name,
+                      appOptions[OPT_APPROXIMATE].name);
+        skAppUsage();
+    }
+
+    if (app_flags.approximate) {
+        /* the Space-Saving summary supports a subset of rwstats */
+        if (app_flags.presorted_input) {
+            skAppPrintErr("Cannot use --%s with --%s",
+                          appOptions[OPT_APPROXIMATE].name,
+                          appOptions[OPT_PRESORTED_INPUT].name);
+            appExit(EXIT_FAILURE);
+        }
+        if (RWSTATS_COUNT != limit.type || RWSTATS_DIR_TOP != direction) {
+            skAppPrintErr("The --%s switch requires --%s and --%s",
+                          appOptions[OPT_APPROXIMATE].name,
+                          appOptions[OPT_COUNT].name,
+                          appOptions[OPT_TOP].name);
+            appExit(EXIT_FAILURE);
+        }
+        if (limit.distinct
+            || (SK_FIELD_RECORDS != limit.fl_id
+                && SK_FIELD_SUM_BYTES != limit.fl_id
+                && SK_FIELD_SUM_PACKETS != limit.fl_id)
+            || skFieldListGetFieldCount(value_fields) != 1
+            || skFieldListGetFieldCount(distinct_fields) != 0)
+        {
+            skAppPrintErr(("The --%s switch requires a single --%s of"
+                           " Records, Bytes, or Packets"),
+                          appOptions[OPT_APPROXIMATE].name,
+                          appOptions[OPT_VALUES].name);
+            appExit(EXIT_FAILURE);
+        }
+        if (copy_input && app_flags.merge_summaries) {
+            skAppPrintErr("Cannot use --%s with --%s",
+                          appOptions[OPT_COPY_INPUT].name,
+                          appOptions[OPT_MERGE_SUMMARIES].name);
+            appExit(EXIT_FAILURE);
+        }
+        if (0 == approx_counters && !app_flags.merge_summaries) {
+            approx_counters = APPROX_COUNTERS_DEFAULT;
+            if (limit.value[RWSTATS_COUNT]
+                > APPROX_COUNTERS_DEFAULT / APPROX_COUNTERS_PER_N)
+            {
+                approx_counters
+                    = ((limit.value[RWSTATS_COUNT] * APPROX_COUNTERS_PER_N
+                        > APPROX_COUNTERS_MAX)
+                       ? APPROX_COUNTERS_MAX
+                       : (limit.value[RWSTATS_COUNT]
+                          * APPROX_COUNTERS_PER_N));
+            }
+        }
+        if (approx_counters && approx_counters < limit.value[RWSTATS_COUNT]) {
+            skAppPrintErr(("The number of counters for --%s (%" PRIu32
+                           ") must be at least the --%s (%" PRIu64 ")"),
+                          appOptions[OPT_APPROXIMATE].name, approx_counters,
+                          appOptions[OPT_COUNT].name,
+                          limit.value[RWSTATS_COUNT]);
+            appExit(EXIT_FAILURE);
+        }
+
+        /* add the column that holds the error of each count */
+        if (rwAsciiAppendCallbackFieldExtra(ascii_str, &error_get_title,
+                                            &error_to_ascii, NULL,
+                                            limit.bf_value->bf_text_len))
+        {
+            skAppPrintErr("Cannot add error field to stream");
+            appExit(EXIT_FAILURE);
+        }
+        return;
+    }
+
     /* create and initialize the uniq object */
     if (app_flags.presorted_input) {
         /* cannot use the --percentage limit when using
@@ -980,6 +1237,9 @@ topnSetup(
 
         skPresortedUniqueSetTempDirectory(ps_uniq, temp_directory);
         skPresortedUniqueSetErrorFunction(ps_uniq, skAppPrintErr);
+        if (skPresortedUniqueSetDistinctApprox(ps_uniq, distinct_approx)) {
+            appExit(EXIT_FAILURE);
+        }
 
         if (skPresortedUniqueSetFields(ps_uniq, key_fields, distinct_fields,
                                        value_fields))
@@ -1006,6 +1266,22 @@ topnSetup(
         skUniqueSetTempDirectory(uniq, temp_directory);
         skUniqueSetErrorFunction(uniq, skAppPrintErr);
 
+        /* do not use threads when a plug-in doesn't support them or
+         * when merging partial aggregates */
+        if ((thread_count > 1) && skPluginIsThreadSafe()
+            && !app_flags.merge_partials)
+        {
+            if (skUniqueSetThreads(uniq, thread_count)) {
+                appExit(EXIT_FAILURE);
+            }
+        }
+        if (skUniqueSetMemoryLimit(uniq, memory_limit)) {
+            appExit(EXIT_FAILURE);
+        }
+        if (skUniqueSetDistinctApprox(uniq, distinct_approx)) {
+            appExit(EXIT_FAILURE);
+        }
+
         if (skUniqueSetFields(uniq, key_fields, distinct_fields, value_fields)
             || skUniquePrepareForInput(uniq))
         {
@@ -1282,6 +1558,43 @@ value_to_ascii(
     return 0;
 }
 
+/*
+ *  error_get_title(buf, bufsize, NULL);
+ *
+ *    Invoked by rwAsciiPrintTitles() to get the title for the column
+ *    that holds the maximum overestimate of an approximate count.
+ */
+static void
+error_get_title(
+    char               *text_buf,
+    size_t              text_buf_size,
+    void        UNUSED(*v_fl_entry))
+{
+    strncpy(text_buf, "Error", text_buf_size);
+}
+
+/*
+ *  error_to_ascii(rwrec, buf, bufsize, NULL, extra);
+ *
+ *    Invoked by rwAsciiPrintRecExtra() to get the maximum
+ *    overestimate of an approximate count.  'extra' is the node from
+ *    the heap data structure.
+ */
+static int
+error_to_ascii(
+    const rwRec UNUSED(*rwrec),
+    char               *text_buf,
+    size_t              text_buf_size,
+    void        UNUSED(*v_fl_entry),
+    void               *v_heap_ptr)
+{
+    uint64_t val64;
+
+    memcpy(&val64, HEAP_PTR_ERROR(v_heap_ptr), sizeof(uint64_t));
+    snprintf(text_buf, text_buf_size, ("%" PRIu64), val64);
+    return 0;
+}
+
 /*
  *  builtin_distinct_get_title(buf, bufsize, field_entry);
  *
@@ -2582,6 +2895,84 @@ prepareFileForRead(
 }
 
 
+/*
+ *  prepareRecord(rwrec);
+ *
+ *    Add 'rwrec' to the record count and the value total.  Modify
+ *    the times on the record if the user has requested time binning.
+ *    Modify the IPs if the user has specified CIDR blocks.
+ */
+static void
+prepareRecord(
+    rwRec              *rwrec)
+{
+    sktime_t sTime;
+    sktime_t sTime_mod;
+    uint32_t elapsed;
+
+    ++record_count;
+    switch (limit.fl_id) {
+      case SK_FIELD_RECORDS:
+        ++value_total;
+        break;
+      case SK_FIELD_SUM_BYTES:
+        value_total += rwRecGetBytes(rwrec);
+        break;
+      case SK_FIELD_SUM_PACKETS:
+        value_total += rwRecGetPkts(rwrec);
+        break;
+      default:
+        break;
+    }
+
+    if (cidr_sip) {
+        rwRecSetSIPv4(rwrec, rwRecGetSIPv4(rwrec) & cidr_sip);
+    }
+    if (cidr_dip) {
+        rwRecSetDIPv4(rwrec, rwRecGetDIPv4(rwrec) & cidr_dip);
+    }
+    if (time_bin_size > 1) {
+        switch (time_fields) {
+          case PARSE_KEY_STIME:
+          case (PARSE_KEY_STIME | PARSE_KEY_ELAPSED):
+            /* adjust start time */
+            sTime = rwRecGetStartTime(rwrec);
+            sTime_mod = sTime % time_bin_size;
+            rwRecSetStartTime(rwrec, (sTime - sTime_mod));
+            break;
+          case PARSE_KEY_ALL_TIMES:
+          case (PARSE_KEY_STIME | PARSE_KEY_ETIME):
+            /* adjust sTime and elapsed/duration */
+            sTime = rwRecGetStartTime(rwrec);
+            sTime_mod = sTime % time_bin_size;
+            rwRecSetStartTime(rwrec, (sTime - sTime_mod));
+            /*
+             * the following sets elapsed to:
+             * ((eTime - (eTime % bin_size)) - (sTime - (sTime % bin_size)))
+             */
+            elapsed = rwRecGetElapsed(rwrec);
+            elapsed = (elapsed + sTime_mod
+                       - ((sTime + elapsed) % time_bin_size));
+            rwRecSetElapsed(rwrec, elapsed);
+            break;
+          case PARSE_KEY_ETIME:
+          case (PARSE_KEY_ETIME | PARSE_KEY_ELAPSED):
+            /* want to set eTime to (eTime - (eTime % bin_size)), but
+             * eTime is computed as (sTime + elapsed) */
+            sTime = rwRecGetStartTime(rwrec);
+            rwRecSetStartTime(rwrec,
+                              (sTime - ((sTime + rwRecGetElapsed(rwrec))
+                                        % time_bin_size)));
+            break;
+          case 0:
+          case PARSE_KEY_ELAPSED:
+          default:
+            skAbortBadCase(time_fields);
+        }
+    }
+}
+
+
 /*
  *  status = readRecord(stream, rwrec);
  *
@@ -2596,75 +2987,40 @@ readRecord(
     skstream_t         *rwios,
     rwRec              *rwrec)
 {
-    sktime_t sTime;
-    sktime_t sTime_mod;
-    uint32_t elapsed;
     int rv;
 
     rv = skStreamReadRecord(rwios, rwrec);
     if (SKSTREAM_OK == rv) {
-        ++record_count;
-        switch (limit.fl_id) {
-          case SK_FIELD_RECORDS:
-            ++value_total;
-            break;
-          case SK_FIELD_SUM_BYTES:
-            value_total += rwRecGetBytes(rwrec);
-            break;
-          case SK_FIELD_SUM_PACKETS:
-            value_total += rwRecGetPkts(rwrec);
-            break;
-          default:
-            break;
-        }
-
-        if (cidr_sip) {
-            rwRecSetSIPv4(rwrec, rwRecGetSIPv4(rwrec) & cidr_sip);
-        }
-        if (cidr_dip) {
-            rwRecSetDIPv4(rwrec, rwRecGetDIPv4(rwrec) & cidr_dip);
-        }
-        if (time_bin_size > 1) {
-            switch (time_fields) {
-              case PARSE_KEY_STIME:
-              case (PARSE_KEY_STIME | PARSE_KEY_ELAPSED):
-                /* adjust start time */
-                sTime = rwRecGetStartTime(rwrec);
-                sTime_mod = sTime % time_bin_size;
-                rwRecSetStartTime(rwrec, (sTime - sTime_mod));
-                break;
-              case PARSE_KEY_ALL_TIMES:
-              case (PARSE_KEY_STIME | PARSE_KEY_ETIME):
-                /* adjust sTime and elapsed/duration */
-                sTime = rwRecGetStartTime(rwrec);
-                sTime_mod = sTime % time_bin_size;
-                rwRecSetStartTime(rwrec, (sTime - sTime_mod));
-                /*
-                 * the following sets elapsed to:
-                 * ((eTime - (eTime % bin_size)) - (sTime - (sTime % bin_size)))
-                 */
-                elapsed = rwRecGetElapsed(rwrec);
-                elapsed = (elapsed + sTime_mod
-                           - ((sTime + elapsed) % time_bin_size));
-                rwRecSetElapsed(rwrec, elapsed);
-                break;
-              case PARSE_KEY_ETIME:
-              case (PARSE_KEY_ETIME | PARSE_KEY_ELAPSED):
-                /* want to set eTime to (eTime - (eTime % bin_size)), but
-                 * eTime is computed as (sTime + elapsed) */
-                sTime = rwRecGetStartTime(rwrec);
-                rwRecSetStartTime(rwrec,
-                                  (sTime - ((sTime + rwRecGetElapsed(rwrec))
-                                            % time_bin_size)));
-                break;
-              case 0:
-              case PARSE_KEY_ELAPSED:
-              default:
-                skAbortBadCase(time_fields);
-            }
-        }
+        prepareRecord(rwrec);
     }
+    return rv;
+}
+
+
+/*
+ *  status = readRecords(stream, recs, count, &recs_read);
+ *
+ *    Fill the array 'recs' with up to 'count' SiLK Flow records read
+ *    from 'stream' and set 'recs_read' to the number of records read.
+ *    Modify each record as readRecord() does.
+ *
+ *    Return the status of reading the records; see
+ *    skStreamReadRecords().
+ */
+int
+readRecords(
+    skstream_t         *rwios,
+    rwRec              *recs,
+    size_t              count,
+    size_t             *recs_read)
+{
+    size_t i;
+    int rv;
 
+    rv = skStreamReadRecords(rwios, recs, count, recs_read);
+    for (i = 0; i < *recs_read; ++i) {
+        prepareRecord(&recs[i]);
+    }
     return rv;
 }
 
@@ -2684,7 +3040,20 @@ appNextInput(
     int rv;
 
     rv = skOptionsCtxNextArgument(optctx, &path);
-    if (0 == rv) {
+    if (0 == rv && (app_flags.merge_summaries || app_flags.merge_partials)) {
+        /* the caller reads the header of the summary or aggregate */
+        if ((rv = skStreamCreate(rwios, SK_IO_READ, SK_CONTENT_SILK))
+            || (rv = skStreamBind(*rwios, path))
+            || (rv = skStreamOpen(*rwios)))
+        {
+            skStreamPrintLastErr(*rwios, rv, &skAppPrintErr);
+            skStreamDestroy(rwios);
+            return -1;
+        }
+        if (app_flags.print_filenames) {
+            fprintf(PRINT_FILENAMES_FH, "%s\n", path);
+        }
+    } else if (0 == rv) {
         rv = skStreamOpenSilkFlow(rwios, path, SK_IO_READ);
         if (rv) {
             skStreamPrintLastErr(*rwios, rv, &skAppPrintErr);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: 7a48b203581804cd9a29a9b4d98454e5
+# TEST: ./rwstats --fields=dip --count=10 --approximate=space-saving:k=1000 ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwstats = check_silk_app('rwstats');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwstats --fields=dip --count=10 --approximate=space-saving:k=1000 $file{data}";
+my $md5 = "7a48b203581804cd9a29a9b4d98454e5";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: 15310d0586af100534be8678add4a207
+# TEST: ./rwstats --fields=dport --count=20 ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwstats = check_silk_app('rwstats');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwstats --fields=dport --count=20 $file{data}";
+my $md5 = "15310d0586af100534be8678add4a207";
+
+check_md5_output($md5, $cmd);
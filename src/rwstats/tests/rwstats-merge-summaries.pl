@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: cd2d74b2ec53b06b22c9b1930b33ba03
+# TEST: ./rwstats --fields=dip --values=bytes --count=10 --approximate=space-saving:k=1000 --summary-output=stdout --output-path=/dev/null ../../tests/data.rwf | ./rwstats --fields=dip --values=bytes --count=10 --merge-summaries
+
+use strict;
+use SiLKTests;
+
+my $rwstats = check_silk_app('rwstats');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwstats --fields=dip --values=bytes --count=10 --approximate=space-saving:k=1000 --summary-output=stdout --output-path=/dev/null $file{data} | $rwstats --fields=dip --values=bytes --count=10 --merge-summaries";
+my $md5 = "cd2d74b2ec53b06b22c9b1930b33ba03";
+
+check_md5_output($md5, $cmd);
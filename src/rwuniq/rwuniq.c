@@ -148,6 +148,12 @@ unsigned int dport_key = 0;
 /* how to handle IPv6 flows */
 sk_ipv6policy_t ipv6_policy = SK_IPV6POLICY_MIX;
 
+/* where to write the bins as a partial aggregate, or NULL */
+skstream_t *partial_output = NULL;
+
+/* maximum bytes to use for aggregating, or 0 for no limit */
+uint64_t memory_limit = 0;
+
 /* Information about each potential "value" field the user can choose
  * to compute and display.  Ensure these appear in same order as in
  * the OPT_BYTES...OPT_DIP_DISTINCT values in appOptionsEnum. */
@@ -496,7 +502,9 @@ writeAsciiRecord(
  *  uniqRandom();
  *
  *    Main control function that creates a hash table, processes the
- *    input (files or stdin), and prints the results.
+ *    input (files or stdin), and prints the results.  The input is
+ *    flow records, or partial aggregate files when --merge-partials
+ *    is given.
  */
 static void
 uniqRandom(
@@ -505,15 +513,28 @@ uniqRandom(
     sk_unique_iterator_t *iter;
     uint8_t *outbuf[3];
     skstream_t *stream;
-    rwRec rwrec;
+    rwRec recs[READ_RECORDS_COUNT];
+    size_t count;
+    size_t i;
     int rv = 0;
 
     while (0 == (rv = appNextInput(&stream))) {
-        while (SKSTREAM_OK == (rv = readRecord(stream, &rwrec))) {
-            if (0 != skUniqueAddRecord(uniq, &rwrec)) {
+        if (app_flags.merge_partials) {
+            rv = skUniqueAddPartial(uniq, stream, NULL);
+            skStreamDestroy(&stream);
+            if (rv) {
                 appExit(EXIT_FAILURE);
             }
+            continue;
         }
+        do {
+            rv = readRecords(stream, recs, READ_RECORDS_COUNT, &count);
+            for (i = 0; i < count; ++i) {
+                if (0 != skUniqueAddRecord(uniq, &recs[i])) {
+                    appExit(EXIT_FAILURE);
+                }
+            }
+        } while (SKSTREAM_OK == rv);
         if (rv != SKSTREAM_ERR_EOF) {
             skStreamPrintLastErr(stream, rv, &skAppPrintErr);
             skStreamDestroy(&stream);
@@ -529,7 +550,27 @@ uniqRandom(
     /* Write out the headings */
     writeColTitles();
 
-    skUniquePrepareForOutput(uniq);
+    if (skUniquePrepareForOutput(uniq)) {
+        appExit(EXIT_FAILURE);
+    }
+    if (memory_limit) {
+        skAppPrintErr(("Bins used at most %" PRIu64 " bytes of the %" PRIu64
+                       "-byte memory limit"),
+                      skUniqueGetPeakMemory(uniq), memory_limit);
+    }
+
+    /* write the partial aggregate before the iterator merges the
+     * temporary files */
+    if (partial_output) {
+        if (skUniqueWritePartial(uniq, partial_output)) {
+            appExit(EXIT_FAILURE);
+        }
+        rv = skStreamClose(partial_output);
+        if (rv) {
+            skStreamPrintLastErr(partial_output, rv, &skAppPrintErr);
+            appExit(EXIT_FAILURE);
+        }
+    }
 
     /* create the iterator */
     rv = skUniqueIteratorCreate(uniq, &iter);
@@ -81,6 +81,13 @@ RCSIDENTVAR(rcsID_RWUNIQ_H, "$SiLK: rwuniq.h c19d64b322b8 2015-02-09 22:11:47Z m
 /* default sTime bin size to use when --bin-time is requested */
 #define DEFAULT_TIME_BIN  60
 
+/* maximum number of records to read from an input stream in a single
+ * call to readRecords() */
+#define READ_RECORDS_COUNT  256
+
+/* environment variable that determines number of threads */
+#define RWUNIQ_THREADS_ENVAR  "SILK_RWUNIQ_THREADS"
+
 
 /* struct to hold information about built-in aggregate value fields */
 typedef struct builtin_field_st {
@@ -115,6 +122,7 @@ typedef struct app_flags_st {
     unsigned integer_sensors    :1;
     unsigned integer_tcp_flags  :1;
     unsigned check_limits       :1;      /* Whether output must meet limits */
+    unsigned merge_partials     :1;      /* Inputs are partial aggregates */
 } app_flags_t;
 
 /* structure to get the distinct count when using IPv6 */
@@ -142,6 +150,12 @@ extern app_flags_t app_flags;
 /* how to handle IPv6 flows */
 extern sk_ipv6policy_t ipv6_policy;
 
+/* where to write the bins as a partial aggregate, or NULL */
+extern skstream_t *partial_output;
+
+/* maximum bytes to use for aggregating, or 0 for no limit */
+extern uint64_t memory_limit;
+
 extern builtin_field_t builtin_values[];
 
 extern const size_t num_builtin_values;
@@ -180,6 +194,12 @@ int
 readRecord(
     skstream_t         *rwios,
     rwRec              *rwrec);
+int
+readRecords(
+    skstream_t         *rwios,
+    rwRec              *recs,
+    size_t              count,
+    size_t             *recs_read);
 void
 setOutputHandle(
     void);
@@ -122,6 +122,13 @@ static skstream_t *copy_input = NULL;
 /* temporary directory */
 static const char *temp_directory = NULL;
 
+/* number of threads to use for aggregating */
+static uint32_t thread_count = 1;
+
+/* precision of the sketches that estimate distinct counts, or 0 to
+ * count exactly */
+static unsigned int distinct_approx = 0;
+
 /* how to print IP addresses */
 static uint32_t ip_format = SKIPADDR_CANONICAL;
 
@@ -131,6 +138,9 @@ static uint32_t time_flags = SKTIMESTAMP_NOMSEC;
 /* the floor of the sTime and/or eTime */
 static sktime_t time_bin_size = 0;
 
+/* the record columns the key, value, and distinct fields read */
+static uint32_t input_columns = SK_COLUMN_ALL;
+
 /* which of elapsed, sTime, and eTime were requested. uses the
  * PARSE_KEY_* values from rwuniq.h.  this value will be used to
  * initialize the 'time_fields_key' global. */
@@ -205,6 +215,11 @@ typedef enum {
     OPT_DIP_DISTINCT,
     OPT_PRESORTED_INPUT,
     OPT_SORT_OUTPUT,
+    OPT_THREADS,
+    OPT_MEMORY_LIMIT,
+    OPT_DISTINCT_APPROX,
+    OPT_PARTIAL_OUTPUT,
+    OPT_MERGE_PARTIALS,
     OPT_BIN_TIME,
     OPT_TIMESTAMP_FORMAT,
     OPT_EPOCH_TIME,
@@ -238,6 +253,11 @@ static struct option appOptions[] = {
     {"dip-distinct",        OPTIONAL_ARG, 0, OPT_DIP_DISTINCT},
     {"presorted-input",     NO_ARG,       0, OPT_PRESORTED_INPUT},
     {"sort-output",         NO_ARG,       0, OPT_SORT_OUTPUT},
+    {"threads",             REQUIRED_ARG, 0, OPT_THREADS},
+    {"memory-limit",        REQUIRED_ARG, 0, OPT_MEMORY_LIMIT},
+    {"distinct-approx",     REQUIRED_ARG, 0, OPT_DISTINCT_APPROX},
+    {"partial-output",      REQUIRED_ARG, 0, OPT_PARTIAL_OUTPUT},
+    {"merge-partials",      NO_ARG,       0, OPT_MERGE_PARTIALS},
     {"bin-time",            OPTIONAL_ARG, 0, OPT_BIN_TIME},
     {"timestamp-format",    REQUIRED_ARG, 0, OPT_TIMESTAMP_FORMAT},
     {"epoch-time",          NO_ARG,       0, OPT_EPOCH_TIME},
@@ -281,6 +301,19 @@ static const char *appHelp[] = {
     ("Assume input has been presorted using\n"
      "\trwsort invoked with the exact same --fields value. Def. No"),
     ("Present the output in sorted order. Def. No"),
+    ("Aggregate the records using this number of threads.\n"
+     "\tDef. $" RWUNIQ_THREADS_ENVAR " or 1"),
+    ("Write bins to temporary files rather than use more than\n"
+     "\tthis much memory for bins, in bytes.  Append k, m, g, for kilo-,\n"
+     "\tmega-, giga-bytes, respectively. Def. No limit"),
+    ("Estimate distinct counts with HyperLogLog sketches of\n"
+     "\t2^P registers; specify as 'hll:p=P' with P from 4 to 18, or 'hll'\n"
+     "\tfor P=12.  Error is about 1.04/sqrt(2^P). Def. Exact counts"),
+    ("Also write the bins to this file as a partial aggregate\n"
+     "\tthat a later --merge-partials may combine with others. Def. No"),
+    ("Treat the inputs as files written by --partial-output\n"
+     "\tusing the same --fields and --values, and merge them. Def. Inputs\n"
+     "\tare flows"),
     ("When using 'sTime' or 'eTime' as a key, adjust time(s) to\n"
      "\tto appear in N-second bins (floor of time is used). Def. No, "),
     NULL, /* generated dynamically */
@@ -453,6 +486,19 @@ appSetup(
         appExit(EXIT_FAILURE);
     }
 
+    /* check the thread count envar */
+    {
+        char *env;
+        uint32_t tc;
+
+        env = getenv(RWUNIQ_THREADS_ENVAR);
+        if (env && env[0]) {
+            if (skStringParseUint32(&tc, env, 1, SK_UNIQUE_THREADS_MAX) == 0) {
+                thread_count = tc;
+            }
+        }
+    }
+
     /* try to load hard-coded plugins */
     for (j = 0; app_static_plugins[j].name; ++j) {
         skPluginAddAsPlugin(app_static_plugins[j].name,
@@ -517,8 +563,48 @@ appSetup(
     if (parseValueFields(values_arg)) {
         appExit(EXIT_FAILURE);
     }
+    input_columns = (skFieldListGetColumns(key_fields)
+                     | skFieldListGetColumns(value_fields)
+                     | skFieldListGetColumns(distinct_fields));
+    if (time_bin_size > 1) {
+        input_columns |= SK_COLUMN_STIME | SK_COLUMN_ELAPSED;
+    }
+
+    /* check for switches that cannot be used with partial aggregates */
+    if (app_flags.merge_partials || partial_output) {
+        if (app_flags.presorted_input) {
+            skAppPrintErr("Cannot use --%s with --%s",
+                          appOptions[OPT_PRESORTED_INPUT].name,
+                          appOptions[(app_flags.merge_partials
+                                      ? OPT_MERGE_PARTIALS
+                                      : OPT_PARTIAL_OUTPUT)].name);
+            exit(EXIT_FAILURE);
+        }
+        if (app_flags.merge_partials && copy_input) {
+            skAppPrintErr("Cannot use --%s with --%s",
+                          appOptions[OPT_COPY_INPUT].name,
+                          appOptions[OPT_MERGE_PARTIALS].name);
+            exit(EXIT_FAILURE);
+        }
+    }
 
     /* make certain stdout is not being used for multiple outputs */
+    if (partial_output
+        && ((0 == strcmp(skStreamGetPathname(partial_output), "-"))
+            || (0 == strcmp(skStreamGetPathname(partial_output), "stdout"))))
+    {
+        if ((NULL == output.of_name)
+            || (0 == strcmp(output.of_name, "-"))
+            || (0 == strcmp(output.of_name, "stdout"))
+            || (copy_input
+                && ((0 == strcmp(skStreamGetPathname(copy_input), "-"))
+                    || (0 == strcmp(skStreamGetPathname(copy_input),
+                                    "stdout")))))
+        {
+            skAppPrintErr("May not use stdout for multiple output streams");
+            exit(EXIT_FAILURE);
+        }
+    }
     if (copy_input
         && ((0 == strcmp(skStreamGetPathname(copy_input), "-"))
             || (0 == strcmp(skStreamGetPathname(copy_input), "stdout"))))
@@ -540,6 +626,9 @@ appSetup(
 
         skPresortedUniqueSetTempDirectory(ps_uniq, temp_directory);
         skPresortedUniqueSetErrorFunction(ps_uniq, skAppPrintErr);
+        if (skPresortedUniqueSetDistinctApprox(ps_uniq, distinct_approx)) {
+            appExit(EXIT_FAILURE);
+        }
 
         if (skPresortedUniqueSetFields(ps_uniq, key_fields, distinct_fields,
                                        value_fields))
@@ -571,6 +660,22 @@ appSetup(
         skUniqueSetTempDirectory(uniq, temp_directory);
         skUniqueSetErrorFunction(uniq, skAppPrintErr);
 
+        /* do not use threads when a plug-in doesn't support them or
+         * when merging partial aggregates */
+        if ((thread_count > 1) && skPluginIsThreadSafe()
+            && !app_flags.merge_partials)
+        {
+            if (skUniqueSetThreads(uniq, thread_count)) {
+                appExit(EXIT_FAILURE);
+            }
+        }
+        if (skUniqueSetMemoryLimit(uniq, memory_limit)) {
+            appExit(EXIT_FAILURE);
+        }
+        if (skUniqueSetDistinctApprox(uniq, distinct_approx)) {
+            appExit(EXIT_FAILURE);
+        }
+
         if (skUniqueSetFields(uniq, key_fields, distinct_fields, value_fields)
             || skUniquePrepareForInput(uniq))
         {
@@ -600,6 +705,15 @@ appSetup(
         }
     }
 
+    /* open the --partial-output destination */
+    if (partial_output) {
+        rv = skStreamOpen(partial_output);
+        if (rv) {
+            skStreamPrintLastErr(partial_output, rv, &skAppPrintErr);
+            appExit(EXIT_FAILURE);
+        }
+    }
+
     /* set signal handler to clean up temp files on SIGINT, SIGTERM, etc */
     if (skAppSetSignalHandler(&appHandleSignal)) {
         appExit(EXIT_FAILURE);
@@ -656,6 +770,8 @@ appTeardown(
         }
         skStreamDestroy(&copy_input);
     }
+    /* the --partial-output is closed after it is written */
+    skStreamDestroy(&partial_output);
 
     /* destroy string maps for keys and values */
     if (key_field_map) {
@@ -785,6 +901,58 @@ appOptionsHandler(
         app_flags.sort_output = 1;
         break;
 
+      case OPT_THREADS:
+        rv = skStringParseUint32(&thread_count, opt_arg, 1,
+                                 SK_UNIQUE_THREADS_MAX);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        break;
+
+      case OPT_MEMORY_LIMIT:
+        rv = skStringParseHumanUint64(&memory_limit, opt_arg,
+                                      SK_HUMAN_NORMAL);
+        if (rv) {
+            goto PARSE_ERROR;
+        }
+        if (memory_limit < SK_UNIQUE_MEMORY_LIMIT_MIN) {
+            skAppPrintErr("The --%s value must be at least %d",
+                          appOptions[opt_index].name,
+                          SK_UNIQUE_MEMORY_LIMIT_MIN);
+            return 1;
+        }
+        break;
+
+      case OPT_DISTINCT_APPROX:
+        if (skUniqueParseDistinctApprox(opt_arg, &distinct_approx)) {
+            skAppPrintErr(("Invalid %s '%s': Expected 'hll' or 'hll:p=P'"
+                           " where P is between %d and %d"),
+                          appOptions[opt_index].name, opt_arg,
+                          SK_UNIQUE_DISTINCT_APPROX_MIN,
+                          SK_UNIQUE_DISTINCT_APPROX_MAX);
+            return 1;
+        }
+        break;
+
+      case OPT_PARTIAL_OUTPUT:
+        if (partial_output) {
+            skAppPrintErr("Invalid %s: Switch used multiple times",
+                          appOptions[opt_index].name);
+            return 1;
+        }
+        if ((rv = skStreamCreate(&partial_output, SK_IO_WRITE,
+                                 SK_CONTENT_SILK))
+            || (rv = skStreamBind(partial_output, opt_arg)))
+        {
+            skStreamPrintLastErr(partial_output, rv, &skAppPrintErr);
+            return 1;
+        }
+        break;
+
+      case OPT_MERGE_PARTIALS:
+        app_flags.merge_partials = 1;
+        break;
+
       case OPT_TIMESTAMP_FORMAT:
         if (timestampFormatParse(opt_arg, &time_flags)) {
             return 1;
@@ -2500,6 +2668,8 @@ static int
 prepareFileForRead(
     skstream_t         *rwios)
 {
+    int rv;
+
     if (app_flags.print_filenames) {
         fprintf(PRINT_FILENAMES_FH, "%s\n", skStreamGetPathname(rwios));
     }
@@ -2507,11 +2677,69 @@ prepareFileForRead(
         skStreamSetCopyInput(rwios, copy_input);
     }
     skStreamSetIPv6Policy(rwios, ipv6_policy);
+    rv = skStreamSetColumnProjection(rwios, input_columns);
+    if (rv) {
+        skStreamPrintLastErr(rwios, rv, &skAppPrintErr);
+        return -1;
+    }
 
     return 0;
 }
 
 
+/*
+ *  adjustRecordTimes(rwrec);
+ *
+ *    Modify the times on 'rwrec' to bin them by the user's requested
+ *    'time_bin_size'.
+ */
+static void
+adjustRecordTimes(
+    rwRec              *rwrec)
+{
+    sktime_t sTime;
+    sktime_t sTime_mod;
+    uint32_t elapsed;
+
+    switch (time_fields) {
+      case PARSE_KEY_STIME:
+      case (PARSE_KEY_STIME | PARSE_KEY_ELAPSED):
+        /* adjust start time */
+        sTime = rwRecGetStartTime(rwrec);
+        sTime_mod = sTime % time_bin_size;
+        rwRecSetStartTime(rwrec, (sTime - sTime_mod));
+        break;
+      case PARSE_KEY_ALL_TIMES:
+      case (PARSE_KEY_STIME | PARSE_KEY_ETIME):
+        /* adjust sTime and elapsed/duration */
+        sTime = rwRecGetStartTime(rwrec);
+        sTime_mod = sTime % time_bin_size;
+        rwRecSetStartTime(rwrec, (sTime - sTime_mod));
+        /*
+         * the following sets elapsed to:
+         * ((eTime - (eTime % bin_size)) - (sTime - (sTime % bin_size)))
+         */
+        elapsed = rwRecGetElapsed(rwrec);
+        elapsed = (elapsed + sTime_mod
+                   - ((sTime + elapsed) % time_bin_size));
+        rwRecSetElapsed(rwrec, elapsed);
+        break;
+      case PARSE_KEY_ETIME:
+      case (PARSE_KEY_ETIME | PARSE_KEY_ELAPSED):
+        /* want to set eTime to (eTime - (eTime % bin_size)), but
+         * eTime is computed as (sTime + elapsed) */
+        sTime = rwRecGetStartTime(rwrec);
+        rwRecSetStartTime(rwrec, (sTime - ((sTime + rwRecGetElapsed(rwrec))
+                                           % time_bin_size)));
+        break;
+      case 0:
+      case PARSE_KEY_ELAPSED:
+      default:
+        skAbortBadCase(time_fields);
+    }
+}
+
+
 /*
  *  status = readRecord(stream, rwrec);
  *
@@ -2525,53 +2753,42 @@ readRecord(
     skstream_t         *rwios,
     rwRec              *rwrec)
 {
-    sktime_t sTime;
-    sktime_t sTime_mod;
-    uint32_t elapsed;
     int rv;
 
     rv = skStreamReadRecord(rwios, rwrec);
-    if (SKSTREAM_OK == rv
-        && time_bin_size > 1)
-    {
-        switch (time_fields) {
-          case PARSE_KEY_STIME:
-          case (PARSE_KEY_STIME | PARSE_KEY_ELAPSED):
-            /* adjust start time */
-            sTime = rwRecGetStartTime(rwrec);
-            sTime_mod = sTime % time_bin_size;
-            rwRecSetStartTime(rwrec, (sTime - sTime_mod));
-            break;
-          case PARSE_KEY_ALL_TIMES:
-          case (PARSE_KEY_STIME | PARSE_KEY_ETIME):
-            /* adjust sTime and elapsed/duration */
-            sTime = rwRecGetStartTime(rwrec);
-            sTime_mod = sTime % time_bin_size;
-            rwRecSetStartTime(rwrec, (sTime - sTime_mod));
-            /*
-             * the following sets elapsed to:
-             * ((eTime - (eTime % bin_size)) - (sTime - (sTime % bin_size)))
-             */
-            elapsed = rwRecGetElapsed(rwrec);
-            elapsed = (elapsed + sTime_mod
-                       - ((sTime + elapsed) % time_bin_size));
-            rwRecSetElapsed(rwrec, elapsed);
-            break;
-          case PARSE_KEY_ETIME:
-          case (PARSE_KEY_ETIME | PARSE_KEY_ELAPSED):
-            /* want to set eTime to (eTime - (eTime % bin_size)), but
-             * eTime is computed as (sTime + elapsed) */
-            sTime = rwRecGetStartTime(rwrec);
-            rwRecSetStartTime(rwrec, (sTime - ((sTime + rwRecGetElapsed(rwrec))
-                                               % time_bin_size)));
-            break;
-          case 0:
-          case PARSE_KEY_ELAPSED:
-          default:
-            skAbortBadCase(time_fields);
-        }
+    if (SKSTREAM_OK == rv && time_bin_size > 1) {
+        adjustRecordTimes(rwrec);
     }
+    return rv;
+}
+
+
+/*
+ *  status = readRecords(stream, recs, count, &recs_read);
+ *
+ *    Fill the array 'recs' with up to 'count' SiLK Flow records read
+ *    from 'stream' and set 'recs_read' to the number of records read.
+ *    Modify the times on the records as readRecord() does.
+ *
+ *    Return the status of reading the records; see
+ *    skStreamReadRecords().
+ */
+int
+readRecords(
+    skstream_t         *rwios,
+    rwRec              *recs,
+    size_t              count,
+    size_t             *recs_read)
+{
+    size_t i;
+    int rv;
 
+    rv = skStreamReadRecords(rwios, recs, count, recs_read);
+    if (time_bin_size > 1) {
+        for (i = 0; i < *recs_read; ++i) {
+            adjustRecordTimes(&recs[i]);
+        }
+    }
     return rv;
 }
 
@@ -2591,7 +2808,20 @@ appNextInput(
     int rv;
 
     rv = skOptionsCtxNextArgument(optctx, &path);
-    if (0 == rv) {
+    if (0 == rv && app_flags.merge_partials) {
+        /* skUniqueAddPartial() reads the header */
+        if ((rv = skStreamCreate(rwios, SK_IO_READ, SK_CONTENT_SILK))
+            || (rv = skStreamBind(*rwios, path))
+            || (rv = skStreamOpen(*rwios)))
+        {
+            skStreamPrintLastErr(*rwios, rv, &skAppPrintErr);
+            skStreamDestroy(rwios);
+            return -1;
+        }
+        if (app_flags.print_filenames) {
+            fprintf(PRINT_FILENAMES_FH, "%s\n", path);
+        }
+    } else if (0 == rv) {
         rv = skStreamOpenSilkFlow(rwios, path, SK_IO_READ);
         if (rv) {
             skStreamPrintLastErr(*rwios, rv, &skAppPrintErr);
@@ -2599,7 +2829,10 @@ appNextInput(
             return -1;
         }
 
-        (void)prepareFileForRead(*rwios);
+        if (prepareFileForRead(*rwios)) {
+            skStreamDestroy(rwios);
+            return -1;
+        }
     }
 
     return rv;
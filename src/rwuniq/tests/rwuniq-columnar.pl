@@ -0,0 +1,17 @@
+#! /usr/bin/perl -w
+# MD5: b6a8f083c4b98ac7dfdfcbf10a8eca71
+# TEST: ../rwcat/rwcat --columnar-output --output-path=/tmp/rwuniq-columnar-columnar.rw ../../tests/data.rwf && ./rwuniq --fields=sip --values=bytes,records,distinct:dport --sort-output /tmp/rwuniq-columnar-columnar.rw
+
+use strict;
+use SiLKTests;
+
+my $rwuniq = check_silk_app('rwuniq');
+my $rwcat = check_silk_app('rwcat');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my %temp;
+$temp{columnar} = make_tempname('columnar.rw');
+my $cmd = "$rwcat --columnar-output --output-path=$temp{columnar} $file{data} && $rwuniq --fields=sip --values=bytes,records,distinct:dport --sort-output $temp{columnar}";
+my $md5 = "b6a8f083c4b98ac7dfdfcbf10a8eca71";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: 6966200360c84f1be45f3826f98cf7b4
+# TEST: ./rwuniq --distinct-approx=hll:p=10 --fields=proto --values=records,distinct:sip,distinct:dport --sort-output ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwuniq = check_silk_app('rwuniq');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwuniq --distinct-approx=hll:p=10 --fields=proto --values=records,distinct:sip,distinct:dport --sort-output $file{data}";
+my $md5 = "6966200360c84f1be45f3826f98cf7b4";
+
+check_md5_output($md5, $cmd);
@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: 4100b2d0e54ff33f6e0afead3b235020
+# TEST: ./rwuniq --memory-limit=1m --fields=sip,dport --values=records,bytes,distinct:sport --sort-output ../../tests/data.rwf
+
+use strict;
+use SiLKTests;
+
+my $rwuniq = check_silk_app('rwuniq');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwuniq --memory-limit=1m --fields=sip,dport --values=records,bytes,distinct:sport --sort-output $file{data}";
+my $md5 = "4100b2d0e54ff33f6e0afead3b235020";
+
+check_md5_output($md5, $cmd);
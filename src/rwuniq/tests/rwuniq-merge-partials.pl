@@ -0,0 +1,14 @@
+#! /usr/bin/perl -w
+# MD5: 4bdcf14da701d6bee44ded4777ae8711
+# TEST: ./rwuniq --fields=proto,dport --values=bytes,records,distinct:sip --partial-output=stdout --output-path=/dev/null ../../tests/data.rwf | ./rwuniq --fields=proto,dport --values=bytes,records,distinct:sip --sort-output --merge-partials
+
+use strict;
+use SiLKTests;
+
+my $rwuniq = check_silk_app('rwuniq');
+my %file;
+$file{data} = get_data_or_exit77('data');
+my $cmd = "$rwuniq --fields=proto,dport --values=bytes,records,distinct:sip --partial-output=stdout --output-path=/dev/null $file{data} | $rwuniq --fields=proto,dport --values=bytes,records,distinct:sip --sort-output --merge-partials";
+my $md5 = "4bdcf14da701d6bee44ded4777ae8711";
+
+check_md5_output($md5, $cmd);
@@ -318,7 +318,9 @@ $ENV{SILK_HEADER_NOVERSION} = 1;
 
 # unset several environment variables
 for my $e (qw(SILK_IPV6_POLICY SILK_PYTHON_TRACEBACK SILK_RWFILTER_THREADS
-              SILK_LOGSTATS_RWFILTER SILK_LOGSTATS SILK_LOGSTATS_DEBUG))
+              SILK_LOGSTATS_RWFILTER SILK_LOGSTATS SILK_LOGSTATS_DEBUG
+              SILK_BLOCK_INDEX SILK_COMPRESSION_THREADS SILK_STREAM_MMAP
+              SILK_ZSTD_LEVEL SILK_REPO_PREFETCH))
 {
     delete $ENV{$e};
 }